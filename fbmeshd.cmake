@@ -148,6 +148,7 @@ if(BUILD_TESTS)
       openr/fbmeshd/802.11s/Nl80211Handler.cpp
       openr/fbmeshd/802.11s/PeerSelector.cpp
       openr/fbmeshd/common/Constants.cpp
+      openr/fbmeshd/gateway-connectivity-monitor/StatsClient.cpp
       openr/fbmeshd/nl/GenericNetlinkFamily.cpp
       openr/fbmeshd/tests/Nl80211HandlerTest.cpp
   )
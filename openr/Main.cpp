@@ -6,6 +6,7 @@
  */
 
 #include <syslog.h>
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 
@@ -17,6 +18,9 @@
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/init/Init.h>
 #include <folly/system/ThreadName.h>
 #include <glog/logging.h>
@@ -30,14 +34,17 @@
 
 #include <openr/allocators/PrefixAllocator.h>
 #include <openr/common/BuildInfo.h>
+#include <openr/common/BusSerializer.h>
 #include <openr/common/Constants.h>
 #include <openr/common/Flags.h>
+#include <openr/common/StartupTracer.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStore.h>
 #include <openr/ctrl-server/OpenrCtrlHandler.h>
 #include <openr/decision/Decision.h>
 #include <openr/fib/Fib.h>
 #include <openr/health-checker/HealthChecker.h>
+#include <openr/if/gen-cpp2/Platform_constants.h>
 #include <openr/kvstore/KvStore.h>
 #include <openr/kvstore/KvStoreClient.h>
 #include <openr/link-monitor/LinkMonitor.h>
@@ -71,6 +78,10 @@ const DecisionPubUrl kDecisionPubUrl{"ipc:///tmp/decision-pub-url"};
 const fbzmq::SocketUrl kForceCrashServerUrl{"ipc:///tmp/force_crash_server"};
 
 const std::string inet6Path = "/proc/net/if_inet6";
+
+// Milestones of startup, done once routes are programmed
+const std::string kDecisionSyncMilestone{"decision_initial_sync"};
+const std::string kFibSyncMilestone{"fib_route_sync"};
 } // namespace
 
 // Disable background jemalloc background thread => new jemalloc-5 feature
@@ -118,13 +129,40 @@ waitForFibService(const fbzmq::ZmqEventLoop& evl) {
 }
 
 void
-submitCounters(const ZmqEventLoop& eventLoop, ZmqMonitorClient& monitorClient) {
+submitCounters(
+    const ZmqEventLoop& eventLoop,
+    ZmqMonitorClient& monitorClient,
+    const Watchdog* watchdog,
+    const StartupTracer& startupTracer) {
   VLOG(3) << "Submitting counters...";
   std::unordered_map<std::string, int64_t> counters{};
   counters["main.zmq_event_queue_size"] = eventLoop.getEventQueueSize();
+  if (watchdog) {
+    for (auto& kv : watchdog->getCounters()) {
+      counters.emplace(kv.first, kv.second);
+    }
+  }
+  for (auto& kv : startupTracer.getCounters()) {
+    counters.emplace(kv.first, kv.second);
+  }
   monitorClient.setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
+void
+logStartupEvent(
+    ZmqMonitorClient& monitorClient, const StartupTracer& startupTracer) {
+  fbzmq::LogSample sample{};
+  sample.addString("event", "OPENR_STARTUP");
+  sample.addString("node_name", FLAGS_node_name);
+  for (const auto& kv : startupTracer.getCounters()) {
+    sample.addInt(kv.first, kv.second);
+  }
+  monitorClient.addEventLog(fbzmq::thrift::EventLog(
+      apache::thrift::FRAGILE,
+      Constants::kEventLogCategory.toString(),
+      {sample.toJson()}));
+}
+
 void
 startEventLoop(
     std::vector<std::thread>& allThreads,
@@ -132,20 +170,38 @@ startEventLoop(
     std::unordered_map<OpenrModuleType, std::shared_ptr<OpenrEventLoop>>&
         moduleTypeToEvl,
     std::unique_ptr<Watchdog>& watchdog,
+    const std::unordered_map<std::string, ThreadSchedConfig>&
+        threadSchedConfigs,
+    StartupTracer& startupTracer,
     std::shared_ptr<OpenrEventLoop> evl) {
   const auto type = evl->moduleType;
   // enforce at most one module of each type
   CHECK_EQ(0, moduleTypeToEvl.count(type));
 
-  allThreads.emplace_back(std::thread([evl]() noexcept {
+  folly::Optional<ThreadSchedConfig> schedConfig;
+  auto configIt = threadSchedConfigs.find(evl->moduleName);
+  if (configIt != threadSchedConfigs.end()) {
+    schedConfig = configIt->second;
+  }
+
+  allThreads.emplace_back(std::thread([evl, schedConfig]() noexcept {
     LOG(INFO) << "Starting " << evl->moduleName << " thread ...";
-    folly::setThreadName(evl->moduleName);
+    folly::setThreadName(FLAGS_thread_name_prefix + evl->moduleName);
+    if (schedConfig and not applyThreadSchedConfig(*schedConfig)) {
+      LOG(ERROR) << "Failed to apply scheduling config of "
+                 << evl->moduleName << " thread";
+    }
     evl->run();
     LOG(INFO) << evl->moduleName << " thread got stopped.";
   }));
 
   evl->waitUntilRunning();
 
+  // span of module covers its construction along with startup of its thread
+  auto spanName = evl->moduleName;
+  folly::toLowerAscii(spanName);
+  startupTracer.addSpan(spanName);
+
   if (watchdog) {
     watchdog->addEvl(evl.get(), evl->moduleName);
   }
@@ -156,6 +212,9 @@ startEventLoop(
 
 int
 main(int argc, char** argv) {
+  // Time spent in phases of startup and until routes are programmed
+  StartupTracer startupTracer({kDecisionSyncMilestone, kFibSyncMilestone});
+
   // Set version string to show when `openr --version` is invoked
   std::stringstream ss;
   BuildInfo::log(ss);
@@ -259,6 +318,31 @@ main(int argc, char** argv) {
       moduleTypeToEvl;
   std::unique_ptr<Watchdog> watchdog{nullptr};
 
+  // CPU affinity and scheduling policy of module threads
+  std::unordered_map<std::string, ThreadSchedConfig> threadSchedConfigs;
+  try {
+    threadSchedConfigs = parseThreadSchedConfigs(
+        FLAGS_module_cpu_affinity, FLAGS_module_sched_policy);
+  } catch (std::exception const& err) {
+    LOG(ERROR) << "Invalid module thread config: " << err.what();
+    return -1;
+  }
+
+  // Worker pool shared by modules instead of their own ones. Module event
+  // loops keep their threads as they block polling their own sockets
+  std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor{nullptr};
+  if (FLAGS_shared_worker_threads == 1) {
+    // a Decision computation waits for its shards on another thread
+    LOG(ERROR) << "Shared worker pool needs at least 2 threads";
+    return -1;
+  }
+  if (FLAGS_shared_worker_threads > 1) {
+    sharedExecutor = std::make_shared<folly::CPUThreadPoolExecutor>(
+        FLAGS_shared_worker_threads,
+        std::make_shared<folly::NamedThreadFactory>(
+            FLAGS_thread_name_prefix + "Worker"));
+  }
+
   // Watchdog thread to monitor thread aliveness
   if (FLAGS_enable_watchdog) {
     watchdog = std::make_unique<Watchdog>(
@@ -298,7 +382,10 @@ main(int argc, char** argv) {
 
     // Create event publisher to handle event subscription
     eventPublisher = std::make_unique<PlatformPublisher>(
-        context, PlatformPublisherUrl{FLAGS_platform_pub_url});
+        context,
+        PlatformPublisherUrl{FLAGS_platform_pub_url},
+        nlEventLoop.get(),
+        std::chrono::milliseconds(FLAGS_platform_event_batch_window_ms));
 
     // Create Netlink Protocol object in a new thread
     nlProtocolSocket = std::make_unique<openr::Netlink::NetlinkProtocolSocket>(
@@ -313,8 +400,18 @@ main(int argc, char** argv) {
     nlProtocolSocketEventLoop->waitUntilRunning();
     allThreads.emplace_back(std::move(nlProtocolSocketThread));
 
+    // Only load routes of protocols NetlinkFibHandler programs or reads,
+    // kernel may have many routes of other protocols
+    std::vector<uint8_t> cachedRouteProtocols{RTPROT_STATIC};
+    for (const auto& kv : thrift::Platform_constants::clientIdtoProtocolId()) {
+      cachedRouteProtocols.emplace_back(kv.second);
+    }
     nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
-        nlEventLoop.get(), eventPublisher.get(), std::move(nlProtocolSocket));
+        nlEventLoop.get(),
+        eventPublisher.get(),
+        std::move(nlProtocolSocket),
+        FLAGS_enable_nexthop_objects,
+        std::move(cachedRouteProtocols));
     // Subscribe selected network events
     nlSocket->subscribeEvent(openr::fbnl::LINK_EVENT);
     nlSocket->subscribeEvent(openr::fbnl::ADDR_EVENT);
@@ -376,12 +473,15 @@ main(int argc, char** argv) {
     }
   }
 
+  startupTracer.addSpan("platform");
+
   const MonitorSubmitUrl monitorSubmitUrl{
       folly::sformat("tcp://[::1]:{}", FLAGS_monitor_rep_port)};
 
   ZmqMonitorClient monitorClient(context, monitorSubmitUrl);
   auto monitorTimer = fbzmq::ZmqTimeout::make(&mainEventLoop, [&]() noexcept {
-    submitCounters(mainEventLoop, monitorClient);
+    submitCounters(
+        mainEventLoop, monitorClient, watchdog.get(), startupTracer);
   });
   monitorTimer->scheduleTimeout(Constants::kMonitorSubmitInterval, true);
 
@@ -395,6 +495,7 @@ main(int argc, char** argv) {
   mainEventLoop.waitUntilRunning();
 
   waitForFibService(mainEventLoop);
+  startupTracer.addSpan("fib_service_wait");
 
   // Start config-store URL
   startEventLoop(
@@ -402,12 +503,16 @@ main(int argc, char** argv) {
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<PersistentStore>(
           FLAGS_node_name,
           FLAGS_config_store_filepath,
           context,
           std::chrono::milliseconds(FLAGS_persistent_store_initial_backoff_ms),
-          std::chrono::milliseconds(FLAGS_persistent_store_max_backoff_ms)));
+          std::chrono::milliseconds(FLAGS_persistent_store_max_backoff_ms),
+          false /* dryrun */,
+          monitorSubmitUrl));
 
   const PersistentStoreUrl configStoreInProcUrl{
       moduleTypeToEvl.at(OpenrModuleType::PERSISTENT_STORE)->inprocCmdUrl};
@@ -458,6 +563,18 @@ main(int argc, char** argv) {
       FLAGS_kvstore_flood_msg_burst_size <= 0) {
     kvstoreRate = folly::none;
   }
+  KvStoreFloodRate originatorUpdateRate(std::make_pair(
+      FLAGS_kvstore_originator_update_rate,
+      FLAGS_kvstore_originator_update_burst));
+  if (FLAGS_kvstore_originator_update_rate <= 0 ||
+      FLAGS_kvstore_originator_update_burst <= 0) {
+    originatorUpdateRate = folly::none;
+  }
+
+  folly::Optional<std::string> kvStoreSnapshotFile;
+  if (not FLAGS_kvstore_snapshot_file.empty()) {
+    kvStoreSnapshotFile = FLAGS_kvstore_snapshot_file;
+  }
 
   const KvStoreLocalPubUrl kvStoreLocalPubUrl{"inproc://kvstore_pub_local"};
   // Start KVStore
@@ -466,6 +583,8 @@ main(int argc, char** argv) {
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<KvStore>(
           context,
           FLAGS_node_name,
@@ -485,7 +604,18 @@ main(int argc, char** argv) {
           std::chrono::milliseconds(FLAGS_kvstore_ttl_decrement_ms),
           FLAGS_enable_flood_optimization,
           FLAGS_is_flood_root,
-          FLAGS_use_flood_optimization));
+          FLAGS_use_flood_optimization,
+          FLAGS_kvstore_range_sync,
+          FLAGS_kvstore_ttl_update_batching,
+          std::max(0, FLAGS_kvstore_worker_threads),
+          FLAGS_kvstore_value_deltas,
+          FLAGS_kvstore_dual_message_batching,
+          kvStoreSnapshotFile,
+          sharedExecutor,
+          std::max(0, FLAGS_kvstore_max_parallel_syncs),
+          originatorUpdateRate,
+          FLAGS_kvstore_peer_streams ? FLAGS_openr_ctrl_port : 0,
+          FLAGS_kvstore_spt_full_sync));
 
   const KvStoreLocalCmdUrl kvStoreLocalCmdUrl{
       moduleTypeToEvl.at(OpenrModuleType::KVSTORE)->inprocCmdUrl};
@@ -496,6 +626,8 @@ main(int argc, char** argv) {
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<PrefixManager>(
           FLAGS_node_name,
           configStoreInProcUrl,
@@ -507,7 +639,10 @@ main(int argc, char** argv) {
           FLAGS_enable_perf_measurement,
           kvHoldTime,
           std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
-          context));
+          context,
+          Constants::kPrefixMgrPersistThrottleTimeout,
+          FLAGS_prefix_db_shards,
+          FLAGS_kvstore_compress_prefix_db));
 
   const PrefixManagerLocalCmdUrl prefixManagerLocalCmdUrl{
       moduleTypeToEvl.at(OpenrModuleType::PREFIX_MANAGER)->inprocCmdUrl};
@@ -529,6 +664,8 @@ main(int argc, char** argv) {
         orderedEventLoops,
         moduleTypeToEvl,
         watchdog,
+        threadSchedConfigs,
+        startupTracer,
         std::make_shared<PrefixAllocator>(
             FLAGS_node_name,
             kvStoreLocalCmdUrl,
@@ -553,18 +690,31 @@ main(int argc, char** argv) {
   //
 
   if (FLAGS_enable_spark) {
+    // sub-second hold and keep-alive times take precedence if set
+    const std::chrono::milliseconds sparkHoldTime = FLAGS_spark_hold_time_ms > 0
+        ? std::chrono::milliseconds(FLAGS_spark_hold_time_ms)
+        : std::chrono::seconds(FLAGS_spark_hold_time_s);
+    const std::chrono::milliseconds sparkKeepAliveTime =
+        FLAGS_spark_keepalive_time_ms > 0
+        ? std::chrono::milliseconds(FLAGS_spark_keepalive_time_ms)
+        : std::chrono::seconds(FLAGS_spark_keepalive_time_s);
+    const auto sparkFastInitKeepAliveTime = std::min(
+        std::chrono::milliseconds(FLAGS_spark_fastinit_keepalive_time_ms),
+        sparkKeepAliveTime);
     startEventLoop(
         allThreads,
         orderedEventLoops,
         moduleTypeToEvl,
         watchdog,
+        threadSchedConfigs,
+        startupTracer,
         std::make_shared<Spark>(
             FLAGS_domain, // My domain
             FLAGS_node_name, // myNodeName
             static_cast<uint16_t>(FLAGS_spark_mcast_port),
-            std::chrono::seconds(FLAGS_spark_hold_time_s),
-            std::chrono::seconds(FLAGS_spark_keepalive_time_s),
-            std::chrono::milliseconds(FLAGS_spark_fastinit_keepalive_time_ms),
+            sparkHoldTime,
+            sparkKeepAliveTime,
+            sparkFastInitKeepAliveTime,
             maybeIpTos,
             FLAGS_enable_v4,
             FLAGS_enable_subnet_validation,
@@ -575,7 +725,8 @@ main(int argc, char** argv) {
             std::make_pair(
                 Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
             context,
-            FLAGS_enable_flood_optimization));
+            FLAGS_enable_flood_optimization,
+            FLAGS_spark_hardware_timestamps));
   }
 
   // Static list of prefixes to announce into the network as long as OpenR is
@@ -667,12 +818,27 @@ main(int argc, char** argv) {
     LOG(FATAL) << "Regex compile failed";
   }
 
+  folly::Optional<AdjacencyDampeningConfig> adjDampeningConfig;
+  if (FLAGS_enable_adj_dampening) {
+    adjDampeningConfig = AdjacencyDampeningConfig();
+    adjDampeningConfig->halfLife =
+        std::chrono::milliseconds(FLAGS_adj_dampening_half_life_ms);
+    adjDampeningConfig->maxSuppressTime =
+        std::chrono::milliseconds(FLAGS_adj_dampening_max_suppress_ms);
+  }
+
+  RttMetricConfig rttMetricConfig;
+  rttMetricConfig.bucketSize = FLAGS_rtt_metric_bucket_size;
+  rttMetricConfig.hysteresisPct = FLAGS_rtt_metric_hysteresis_pct;
+
   // Create link monitor instance.
   startEventLoop(
       allThreads,
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<LinkMonitor>(
           context,
           FLAGS_node_name,
@@ -706,7 +872,10 @@ main(int argc, char** argv) {
           kvHoldTime,
           std::chrono::milliseconds(FLAGS_link_flap_initial_backoff_ms),
           std::chrono::milliseconds(FLAGS_link_flap_max_backoff_ms),
-          std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms)));
+          std::chrono::milliseconds(FLAGS_kvstore_key_ttl_ms),
+          FLAGS_link_monitor_event_driven_sync,
+          adjDampeningConfig,
+          rttMetricConfig));
 
   // Wait for the above two threads to start and run before running
   // SPF in Decision module.  This is to make sure the Decision module
@@ -717,12 +886,22 @@ main(int argc, char** argv) {
     decisionGRWindow =
         std::chrono::seconds(FLAGS_decision_graceful_restart_window_s);
   }
+  const auto routeDeltaProtocol =
+      BusSerializer::parseProtocol(FLAGS_decision_route_delta_protocol);
+  if (not routeDeltaProtocol) {
+    LOG(ERROR) << "Invalid decision route delta protocol. Expected compact "
+               << "or binary, got '" << FLAGS_decision_route_delta_protocol
+               << "'";
+    return -1;
+  }
   // Start Decision Module
   startEventLoop(
       allThreads,
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<Decision>(
           FLAGS_node_name,
           FLAGS_enable_v4,
@@ -738,7 +917,37 @@ main(int argc, char** argv) {
           kvStoreLocalPubUrl,
           kDecisionPubUrl,
           monitorSubmitUrl,
-          context));
+          context,
+          std::max(0, FLAGS_decision_lfa_spf_threads),
+          FLAGS_decision_adaptive_debounce,
+          FLAGS_decision_compute_thread,
+          FLAGS_decision_persist_routes
+              ? folly::Optional<PersistentStoreUrl>(configStoreInProcUrl)
+              : folly::none,
+          std::max(0, FLAGS_decision_route_build_threads),
+          routeDeltaProtocol.value(),
+          sharedExecutor,
+          FLAGS_decision_record_file.empty()
+              ? folly::none
+              : folly::Optional<std::string>(FLAGS_decision_record_file),
+          FLAGS_decision_radix_heap_spf,
+          FLAGS_decision_specialized_spf));
+
+  // Routes to program ahead of others
+  std::vector<folly::CIDRNetwork> fibCriticalPrefixes;
+  try {
+    std::vector<std::string> prefixes;
+    folly::split(
+        ",", FLAGS_fib_critical_prefixes, prefixes, true /* ignore empty */);
+    for (auto const& prefix : prefixes) {
+      fibCriticalPrefixes.emplace_back(folly::IPAddress::createNetwork(prefix));
+    }
+  } catch (std::exception const& err) {
+    LOG(ERROR) << "Invalid fib critical prefix string specified. Expected "
+               << "comma separated list of IP/CIDR format, got '"
+               << FLAGS_fib_critical_prefixes << "'";
+    return -1;
+  }
 
   // Define and start Fib Module
   startEventLoop(
@@ -746,6 +955,8 @@ main(int argc, char** argv) {
       orderedEventLoops,
       moduleTypeToEvl,
       watchdog,
+      threadSchedConfigs,
+      startupTracer,
       std::make_shared<Fib>(
           FLAGS_node_name,
           FLAGS_fib_handler_port,
@@ -762,7 +973,29 @@ main(int argc, char** argv) {
           monitorSubmitUrl,
           kvStoreLocalCmdUrl,
           kvStoreLocalPubUrl,
-          context));
+          context,
+          FLAGS_fib_sync_chunk_size,
+          std::move(fibCriticalPrefixes),
+          routeDeltaProtocol.value(),
+          FLAGS_enable_fib_warm_boot));
+
+  // Log startup profile once Decision has synced and routes are programmed
+  auto reportStartupMilestone = [&](const std::string& milestone) {
+    if (startupTracer.markReady(milestone)) {
+      mainEventLoop.runInEventLoop([&]() noexcept {
+        logStartupEvent(monitorClient, startupTracer);
+      });
+    }
+  };
+  std::dynamic_pointer_cast<Decision>(
+      moduleTypeToEvl.at(OpenrModuleType::DECISION))
+      ->setInitialSyncCallback([reportStartupMilestone]() {
+        reportStartupMilestone(kDecisionSyncMilestone);
+      });
+  std::dynamic_pointer_cast<Fib>(moduleTypeToEvl.at(OpenrModuleType::FIB))
+      ->setRouteDbSyncedCallback([reportStartupMilestone]() {
+        reportStartupMilestone(kFibSyncMilestone);
+      });
 
   // Define and start HealthChecker
   if (FLAGS_enable_health_checker) {
@@ -771,6 +1004,8 @@ main(int argc, char** argv) {
         orderedEventLoops,
         moduleTypeToEvl,
         watchdog,
+        threadSchedConfigs,
+        startupTracer,
         std::make_shared<HealthChecker>(
             FLAGS_node_name,
             openr::thrift::HealthCheckOption(FLAGS_health_check_option),
@@ -859,7 +1094,14 @@ main(int argc, char** argv) {
   // Call external module for platform specific implementations
   if (FLAGS_enable_plugin) {
     pluginStart(PluginArgs{
-        FLAGS_node_name, context, prefixManagerLocalCmdUrl, kDecisionPubUrl});
+        FLAGS_node_name,
+        context,
+        prefixManagerLocalCmdUrl,
+        kDecisionPubUrl,
+        std::dynamic_pointer_cast<Decision>(
+            moduleTypeToEvl.at(OpenrModuleType::DECISION)),
+        std::dynamic_pointer_cast<PrefixManager>(
+            moduleTypeToEvl.at(OpenrModuleType::PREFIX_MANAGER))});
   }
 
   // Wait for main-event loop to return
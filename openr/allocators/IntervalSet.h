@@ -0,0 +1,131 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <iterator>
+#include <limits>
+#include <map>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+/**
+ * Set of integral values stored as disjoint inclusive intervals of consecutive
+ * values. Memory and lookup cost depend on number of runs rather than number
+ * of values, so densely allocated value ranges (e.g. sub-prefix indices of a
+ * large seed prefix) stay cheap to query for the next free value.
+ */
+template <typename T>
+class IntervalSet final {
+ public:
+  static_assert(std::is_integral<T>::value, "T is not an integral type");
+
+  // Returns false if value is present already
+  bool
+  insert(const T val) {
+    auto next = intervals_.upper_bound(val);
+    if (next != intervals_.begin()) {
+      auto prev = std::prev(next);
+      if (prev->second >= val) {
+        return false;
+      }
+      if (prev->second + 1 == val) {
+        // extend previous interval, possibly joining it with next one
+        prev->second = val;
+        if (next != intervals_.end() and next->first == val + 1) {
+          prev->second = next->second;
+          intervals_.erase(next);
+        }
+        ++size_;
+        return true;
+      }
+    }
+    if (next != intervals_.end() and next->first == val + 1) {
+      // prepend to next interval
+      const auto end = next->second;
+      intervals_.erase(next);
+      intervals_.emplace(val, end);
+    } else {
+      intervals_.emplace(val, val);
+    }
+    ++size_;
+    return true;
+  }
+
+  // Returns false if value is not present
+  bool
+  erase(const T val) {
+    auto it = findInterval(val);
+    if (it == intervals_.end()) {
+      return false;
+    }
+    const auto start = it->first;
+    const auto end = it->second;
+    intervals_.erase(it);
+    if (start < val) {
+      intervals_.emplace(start, val - 1);
+    }
+    if (val < end) {
+      intervals_.emplace(val + 1, end);
+    }
+    --size_;
+    return true;
+  }
+
+  bool
+  contains(const T val) const {
+    return findInterval(val) != intervals_.end();
+  }
+
+  // Smallest value >= val which is not present, none if there is no such
+  // value in type T
+  folly::Optional<T>
+  nextAbsent(const T val) const {
+    auto it = findInterval(val);
+    if (it == intervals_.end()) {
+      return val;
+    }
+    if (it->second == std::numeric_limits<T>::max()) {
+      return folly::none;
+    }
+    // intervals are disjoint and never adjacent
+    return it->second + 1;
+  }
+
+  // Number of values
+  uint64_t
+  size() const {
+    return size_;
+  }
+
+  // Number of intervals
+  size_t
+  getNumIntervals() const {
+    return intervals_.size();
+  }
+
+ private:
+  // Interval containing val, if any
+  typename std::map<T, T>::const_iterator
+  findInterval(const T val) const {
+    auto it = intervals_.upper_bound(val);
+    if (it == intervals_.begin()) {
+      return intervals_.end();
+    }
+    --it;
+    return it->second >= val ? it : intervals_.end();
+  }
+
+  // start -> end (inclusive). Intervals are disjoint and never adjacent.
+  std::map<T, T> intervals_;
+
+  uint64_t size_{0};
+};
+
+} // namespace openr
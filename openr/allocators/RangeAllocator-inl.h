@@ -54,7 +54,38 @@ RangeAllocator<T>::RangeAllocator(
       overrideOwner_(overrideOwner),
       backoff_(minBackoffDur, maxBackoffDur),
       checkValueInUseCb_(std::move(checkValueInUseCb)),
-      rangeAllocTtl_(rangeAllocTtl) {}
+      rangeAllocTtl_(rangeAllocTtl) {
+  // Track values claimed in KvStore from publications
+  kvStoreClient_->setKvCallback(
+      [this](
+          const std::string& key,
+          folly::Optional<thrift::Value> thriftVal) noexcept {
+        if (key.compare(0, keyPrefix_.size(), keyPrefix_) == 0) {
+          updateClaim(key, std::move(thriftVal));
+        }
+      });
+}
+
+template <typename T>
+void
+RangeAllocator<T>::updateClaim(
+    const std::string& key, folly::Optional<thrift::Value> thriftVal) noexcept {
+  auto it = keyVals_.find(key);
+  if (it != keyVals_.end()) {
+    blockedVals_.erase(
+        details::binaryToPrimitive<T>(it->second.value.value()));
+    keyVals_.erase(it);
+  }
+  if (not thriftVal.hasValue()) {
+    return;
+  }
+  // not owned by me and can't be overridden by me
+  if (not(overrideOwner_ and nodeName_ >= thriftVal->originatorId)) {
+    blockedVals_.insert(
+        details::binaryToPrimitive<T>(thriftVal->value.value()));
+  }
+  keyVals_.emplace(key, std::move(thriftVal.value()));
+}
 
 template <typename T>
 RangeAllocator<T>::~RangeAllocator() {
@@ -64,6 +95,7 @@ RangeAllocator<T>::~RangeAllocator() {
     eventLoop_->cancelTimeout(timeoutToken_.value());
     timeoutToken_.clear();
   }
+  kvStoreClient_->setKvCallback(nullptr);
 
   // Unsubscribe from KvStoreClient if we have been to
   if (myValue_) {
@@ -109,6 +141,13 @@ RangeAllocator<T>::startAllocator(
   }
   allocRangeSize_ = allocRange_.second - allocRange_.first + 1;
 
+  // Initial view of claimed values, kept up to date by kv callback
+  auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_);
+  CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
+  for (auto& kv : *maybeKeyMap) {
+    updateClaim(kv.first, std::move(kv.second));
+  }
+
   // Subscribe to changes in KvStore
   VLOG(2) << "RangeAllocator: Created. Scheduling first tryAllocate. "
           << "Node: " << nodeName_ << ", Prefix: " << keyPrefix_;
@@ -161,7 +200,11 @@ RangeAllocator<T>::tryAllocate(const T newVal) noexcept {
 
   // Check for any existing value in KvStore
   const auto newKey = createKey(newVal);
-  const auto maybeThriftVal = kvStoreClient_->getKey(newKey);
+  folly::Optional<thrift::Value> maybeThriftVal;
+  auto keyIt = keyVals_.find(newKey);
+  if (keyIt != keyVals_.end()) {
+    maybeThriftVal = keyIt->second;
+  }
   if (maybeThriftVal) {
     DCHECK_EQ(1, maybeThriftVal->version);
   }
@@ -247,29 +290,24 @@ RangeAllocator<T>::scheduleAllocate(const T seedVal) noexcept {
   std::uniform_int_distribution<T> dist(allocRange_.first, allocRange_.second);
   auto newVal = dist(gen);
 
-  const auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_);
-  CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
-  const auto valOwners =
-      folly::gen::from(*maybeKeyMap) |
-      folly::gen::map([](std::pair<std::string, thrift::Value> const& kv) {
-        return std::make_pair(
-            details::binaryToPrimitive<T>(kv.second.value.value()),
-            kv.second.originatorId);
-      }) |
-      folly::gen::as<
-          std::unordered_map<T /* value */, std::string /* owner */>>();
-
-  // look for a value I can own
+  // look for a value I can own, i.e. not owned yet or owned by lower
+  // originator if override is allowed. Runs of such values are skipped at once
   T i;
   for (i = 0; i < allocRangeSize_; ++i) {
-    const auto it = valOwners.find(newVal);
-    // not owned yet or owned by higher originator if override is allowed
-    if (it == valOwners.end() or (overrideOwner_ and nodeName_ >= it->second)) {
-      if (!checkValueInUseCb_ or !checkValueInUseCb_(newVal)) {
-        // found
+    auto maybeVal = blockedVals_.nextAbsent(newVal);
+    if (not maybeVal or *maybeVal > allocRange_.second) {
+      // wrap around
+      maybeVal = blockedVals_.nextAbsent(allocRange_.first);
+      if (not maybeVal or *maybeVal > allocRange_.second) {
+        i = allocRangeSize_;
         break;
       }
     }
+    newVal = *maybeVal;
+    if (!checkValueInUseCb_ or !checkValueInUseCb_(newVal)) {
+      // found
+      break;
+    }
     // try next
     newVal = (newVal < allocRange_.second) ? (newVal + 1) : allocRange_.first;
   }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <random>
 #include <string>
+#include <unordered_map>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
@@ -18,6 +19,7 @@
 #include <folly/Random.h>
 #include <folly/gen/Base.h>
 
+#include <openr/allocators/IntervalSet.h>
 #include <openr/common/ExponentialBackoff.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
 #include <openr/kvstore/KvStoreClient.h>
@@ -45,6 +47,9 @@ class RangeAllocator {
    * owner with a lower ID knowingly. In some applications like Terragraph, we
    * don't want this to occur so existing allocated values are not stolen by
    * higher priority allocator instances joining later
+   *
+   * Allocator keeps track of values claimed in KvStore via kv callback of
+   * kvStoreClient, which hence must not be used for anything else.
    */
   RangeAllocator(
       const std::string& nodeName,
@@ -115,6 +120,11 @@ class RangeAllocator {
   void keyValUpdated(
       const std::string& key, const thrift::Value& thriftVal) noexcept;
 
+  // Record claim of value of key in KvStore, or its removal
+  void updateClaim(
+      const std::string& key,
+      folly::Optional<thrift::Value> thriftVal) noexcept;
+
   /**
    * Utility function to create KvStore key for the value.
    */
@@ -174,6 +184,14 @@ class RangeAllocator {
 
   // KvStore TTL for value
   const std::chrono::milliseconds rangeAllocTtl_;
+
+  // Keys under keyPrefix_ in KvStore, i.e. claimed values. Loaded on start and
+  // updated from publications, so that picking a value to try does not need a
+  // dump of KvStore
+  std::unordered_map<std::string, thrift::Value> keyVals_;
+
+  // Claimed values which I can't own
+  IntervalSet<T> blockedVals_;
 };
 
 } // namespace openr
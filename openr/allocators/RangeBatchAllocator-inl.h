@@ -0,0 +1,324 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef RANGE_BATCH_ALLOCATOR_H_
+#error This file may only be included from RangeBatchAllocator.h
+#endif
+
+////////// Implementation details for RangeBatchAllocator.h /////////////
+
+namespace openr {
+
+template <typename T>
+RangeBatchAllocator<T>::RangeBatchAllocator(
+    const std::string& nodeName,
+    const std::string& keyPrefix,
+    KvStoreClient* const kvStoreClient,
+    std::function<void(size_t, folly::Optional<T>)> callback,
+    const std::chrono::milliseconds minBackoffDur /* = 50ms */,
+    const std::chrono::milliseconds maxBackoffDur /* = 2s */,
+    const bool overrideOwner /* = true */,
+    const std::chrono::milliseconds rangeAllocTtl)
+    : nodeName_(nodeName),
+      keyPrefix_(keyPrefix),
+      kvStoreClient_(kvStoreClient),
+      eventLoop_(kvStoreClient->getEventLoop()),
+      callback_(std::move(callback)),
+      overrideOwner_(overrideOwner),
+      rangeAllocTtl_(rangeAllocTtl),
+      backoff_(minBackoffDur, maxBackoffDur) {
+  // Track values claimed in KvStore from publications
+  kvStoreClient_->setKvCallback(
+      [this](
+          const std::string& key,
+          folly::Optional<thrift::Value> thriftVal) noexcept {
+        if (key.compare(0, keyPrefix_.size(), keyPrefix_) != 0) {
+          return;
+        }
+        if (thriftVal.hasValue()) {
+          keyVals_[key] = std::move(thriftVal.value());
+        } else {
+          keyVals_.erase(key);
+        }
+      });
+}
+
+template <typename T>
+RangeBatchAllocator<T>::~RangeBatchAllocator() {
+  VLOG(2) << "RangeBatchAllocator: Destructing " << nodeName_ << ", "
+          << keyPrefix_;
+  if (timeoutToken_) {
+    eventLoop_->cancelTimeout(timeoutToken_.value());
+    timeoutToken_.clear();
+  }
+  kvStoreClient_->setKvCallback(nullptr);
+
+  // Give up on values we requested or own
+  for (auto const& slot : slots_) {
+    auto const& val = slot.value ? slot.value : slot.requestedValue;
+    if (val) {
+      const auto key = createKey(*val);
+      kvStoreClient_->unsubscribeKey(key);
+      kvStoreClient_->unsetKey(key);
+    }
+  }
+}
+
+template <typename T>
+std::string
+RangeBatchAllocator<T>::createKey(const T val) const noexcept {
+  return folly::sformat("{}{}", keyPrefix_, val);
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::startAllocator(
+    const std::pair<T, T> allocRange,
+    const size_t numValues,
+    const std::vector<T>& initValues) {
+  CHECK(slots_.empty()) << "Already started";
+  CHECK_LE(allocRange.first, allocRange.second) << "Invalid range.";
+  CHECK_GT(numValues, 0);
+  CHECK_LE(
+      numValues - 1,
+      static_cast<uint64_t>(allocRange.second - allocRange.first))
+      << "Range can't fit " << numValues << " values";
+  allocRange_ = allocRange;
+
+  slots_.resize(numValues);
+  for (size_t i = 0; i < numValues and i < initValues.size(); ++i) {
+    if (initValues[i] < allocRange_.first or
+        initValues[i] > allocRange_.second) {
+      LOG(ERROR) << "Initial value " << initValues[i] << " is out of range";
+      continue;
+    }
+    slots_[i].initValue = initValues[i];
+  }
+
+  // Initial view of claimed values, kept up to date by kv callback
+  auto maybeKeyMap = kvStoreClient_->dumpAllWithPrefix(keyPrefix_);
+  CHECK(maybeKeyMap) << maybeKeyMap.error().errString;
+  for (auto& kv : *maybeKeyMap) {
+    keyVals_[kv.first] = std::move(kv.second);
+  }
+
+  VLOG(2) << "RangeBatchAllocator: Scheduling first tryAllocate of "
+          << numValues << " values. Node: " << nodeName_
+          << ", Prefix: " << keyPrefix_;
+  timeoutToken_ = eventLoop_->scheduleTimeout(
+      backoff_.getTimeRemainingUntilRetry(),
+      [this]() mutable noexcept { tryAllocate(); });
+}
+
+template <typename T>
+folly::Optional<std::vector<T>>
+RangeBatchAllocator<T>::getValues() const {
+  std::vector<T> values;
+  for (auto const& slot : slots_) {
+    if (not slot.value) {
+      return folly::none;
+    }
+    values.emplace_back(*slot.value);
+  }
+  return values;
+}
+
+template <typename T>
+folly::Optional<T>
+RangeBatchAllocator<T>::pickValue(
+    const Slot& slot, const std::unordered_set<T>& usedVals) const noexcept {
+  auto canOwn = [&](const T val) {
+    if (usedVals.count(val)) {
+      return false;
+    }
+    const auto it = keyVals_.find(createKey(val));
+    // not owned yet, owned by me or by lower originator if override allowed
+    return it == keyVals_.end() or it->second.originatorId == nodeName_ or
+        (overrideOwner_ and nodeName_ > it->second.originatorId);
+  };
+
+  if (slot.initValue and canOwn(*slot.initValue)) {
+    return slot.initValue;
+  }
+
+  // Start from a random value and look for next one I can own
+  std::uniform_int_distribution<T> dist(allocRange_.first, allocRange_.second);
+  std::mt19937_64 gen(folly::Random::rand64());
+  auto val = dist(gen);
+  const T rangeSize = allocRange_.second - allocRange_.first;
+  for (T i = 0; i <= rangeSize; ++i) {
+    if (canOwn(val)) {
+      return val;
+    }
+    val = (val < allocRange_.second) ? (val + 1) : allocRange_.first;
+    if (i == rangeSize) {
+      break; // avoid overflow of i on full range of T
+    }
+  }
+  return folly::none;
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::tryAllocate() noexcept {
+  timeoutToken_ = folly::none; // Cleanup allocation retry timer
+
+  // Values held by slots, never picked twice
+  std::unordered_set<T> usedVals;
+  for (auto const& slot : slots_) {
+    if (slot.value) {
+      usedVals.emplace(*slot.value);
+    } else if (slot.requestedValue) {
+      usedVals.emplace(*slot.requestedValue);
+    }
+  }
+
+  bool failed = false;
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    auto& slot = slots_[i];
+    if (slot.value or slot.requestedValue) {
+      continue;
+    }
+    const auto newVal = pickValue(slot, usedVals);
+    if (not newVal) {
+      LOG(ERROR) << "All values are owned by higher originatorIds";
+      failed = true;
+      break;
+    }
+    usedVals.emplace(*newVal);
+    if (not tryAllocateSlot(i, *newVal)) {
+      failed = true;
+    }
+  }
+
+  if (failed) {
+    scheduleAllocate();
+  }
+}
+
+template <typename T>
+bool
+RangeBatchAllocator<T>::tryAllocateSlot(
+    const size_t slot, const T newVal) noexcept {
+  VLOG(1) << "RangeBatchAllocator " << nodeName_ << ": trying to allocate "
+          << newVal << " for slot " << slot;
+
+  const auto newKey = createKey(newVal);
+  folly::Optional<thrift::Value> maybeThriftVal;
+  auto keyIt = keyVals_.find(newKey);
+  if (keyIt != keyVals_.end()) {
+    maybeThriftVal = keyIt->second;
+  }
+
+  // Same ownership rules as RangeAllocator::tryAllocate
+  const bool shouldOwnOther = not maybeThriftVal or
+      (overrideOwner_ && nodeName_ > maybeThriftVal->originatorId) or
+      (!overrideOwner_ && maybeThriftVal->ttl == Constants::kTtlInfinity);
+  const bool shouldOwnMine =
+      maybeThriftVal and (nodeName_ == maybeThriftVal->originatorId);
+  if (!shouldOwnOther && !shouldOwnMine) {
+    VLOG(1) << "RangeBatchAllocator: failed to allocate " << newVal
+            << " bcoz of " << maybeThriftVal->originatorId;
+    return false;
+  }
+
+  if (shouldOwnOther) {
+    slots_[slot].requestedValue = newVal;
+    auto ttlVersion = maybeThriftVal ? maybeThriftVal->ttlVersion + 1 : 0;
+    const auto ret = kvStoreClient_->setKey(
+        newKey,
+        thrift::Value(
+            apache::thrift::FRAGILE,
+            1 /* version */,
+            nodeName_ /* originatorId */,
+            details::primitiveToBinary(newVal) /* value */,
+            rangeAllocTtl_.count() /* ttl */,
+            ttlVersion /* ttl version */,
+            0 /* hash */));
+    CHECK(ret) << ret.error();
+  } else {
+    // We own it already, e.g. after reboot with KvStore intact
+    auto newValue = *maybeThriftVal;
+    newValue.ttlVersion += 1; // bump ttl version
+    newValue.ttl = rangeAllocTtl_.count(); // reset ttl
+    kvStoreClient_->setKey(newKey, newValue);
+    slots_[slot].value = newVal;
+    callback_(slot, newVal);
+  }
+
+  kvStoreClient_->subscribeKey(
+      newKey,
+      [this, slot](
+          const std::string& key,
+          folly::Optional<thrift::Value> thriftVal) noexcept {
+        if (thriftVal.hasValue()) {
+          keyValUpdated(slot, key, thriftVal.value());
+        }
+      },
+      false);
+  return true;
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::scheduleAllocate() noexcept {
+  if (timeoutToken_) {
+    return; // next round is already scheduled
+  }
+  backoff_.reportError();
+  timeoutToken_ = eventLoop_->scheduleTimeout(
+      backoff_.getTimeRemainingUntilRetry(),
+      [this]() mutable noexcept { tryAllocate(); });
+}
+
+template <typename T>
+void
+RangeBatchAllocator<T>::keyValUpdated(
+    const size_t slotIdx,
+    const std::string& key,
+    const thrift::Value& thriftVal) noexcept {
+  const T val = details::binaryToPrimitive<T>(thriftVal.value.value());
+  auto& slot = slots_.at(slotIdx);
+  CHECK_EQ(1, thriftVal.version);
+  CHECK(slot.requestedValue or slot.value);
+  CHECK_EQ(slot.value ? *slot.value : *slot.requestedValue, val);
+
+  // Intermediate override by a lower originator, wait for the final one
+  if (thriftVal.originatorId < nodeName_) {
+    return;
+  }
+
+  if (nodeName_ == thriftVal.originatorId) {
+    if (slot.value) {
+      return; // refresh of value we own
+    }
+    VLOG(3) << "RangeBatchAllocator " << nodeName_ << ": Won " << val
+            << " for slot " << slotIdx;
+    slot.requestedValue.clear();
+    slot.value = val;
+    callback_(slotIdx, val);
+    if (getValues()) {
+      backoff_.reportSuccess();
+    }
+    return;
+  }
+
+  VLOG(3) << "RangeBatchAllocator " << nodeName_ << ": Lost " << val
+          << " for slot " << slotIdx << " against " << thriftVal.originatorId;
+  slot.requestedValue.clear();
+  if (slot.value) {
+    slot.value.clear();
+    callback_(slotIdx, folly::none);
+  }
+  // Don't retry initial value we just lost
+  slot.initValue.clear();
+  kvStoreClient_->unsubscribeKey(key);
+  kvStoreClient_->unsetKey(key);
+  scheduleAllocate();
+}
+
+} // namespace openr
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <folly/Optional.h>
+
+#include <openr/allocators/RangeAllocator.h>
+#include <openr/common/ExponentialBackoff.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+#include <openr/kvstore/KvStoreClient.h>
+
+namespace openr {
+
+template <typename T = uint32_t>
+class RangeBatchAllocator {
+ public:
+  static_assert(std::is_integral<T>::value, "T is not an integral type");
+
+  /**
+   * RangeBatchAllocator elects `numValues` unique values from within the range
+   * at once, e.g. labels for many interfaces. Values are claimed via KvStore
+   * with the same keys and rules as RangeAllocator, so both can share a key
+   * prefix. Each value is held by a slot in [0, numValues).
+   *
+   * Every round tries all slots which have no value yet in parallel, picking
+   * distinct values which aren't claimed by anyone else as far as we know.
+   * Slots losing their value are retried together in next round, which is
+   * delayed with ExponentialBackoff.
+   *
+   * callback: tells you of new allocated value of a slot, or its withdrawal.
+   * overrideOwner: same as for RangeAllocator.
+   *
+   * Allocator keeps track of values claimed in KvStore via kv callback of
+   * kvStoreClient, which hence must not be used for anything else.
+   */
+  RangeBatchAllocator(
+      const std::string& nodeName,
+      const std::string& keyPrefix,
+      KvStoreClient* const kvStoreClient,
+      std::function<void(size_t /* slot */, folly::Optional<T>)> callback,
+      const std::chrono::milliseconds minBackoffDur =
+          std::chrono::milliseconds(50),
+      const std::chrono::milliseconds maxBackoffDur = std::chrono::seconds(2),
+      const bool overrideOwner = true,
+      const std::chrono::milliseconds rangeAllocTtl =
+          Constants::kRangeAllocTtl);
+
+  /**
+   * user must call this to start allocation
+   * allocRange: the range from which to allocate values (range is inclusive)
+   * numValues: number of values to allocate, must fit in allocRange
+   * initValues: preferred value of slots, values outside of range are ignored
+   */
+  void startAllocator(
+      const std::pair<T /* min */, T /* max */> allocRange,
+      const size_t numValues,
+      const std::vector<T>& initValues = {});
+
+  ~RangeBatchAllocator();
+
+  // Allocated value of slot if any
+  folly::Optional<T>
+  getValue(size_t slot) const {
+    return slots_.at(slot).value;
+  }
+
+  // Allocated values of all slots, if all of them are allocated
+  folly::Optional<std::vector<T>> getValues() const;
+
+ private:
+  // Non-copyable and non-movable
+  RangeBatchAllocator(RangeBatchAllocator const&) = delete;
+  RangeBatchAllocator& operator=(RangeBatchAllocator const&) = delete;
+
+  struct Slot {
+    // Allocated value
+    folly::Optional<T> value;
+    // Value being claimed in KvStore
+    folly::Optional<T> requestedValue;
+    // Preferred value, tried first
+    folly::Optional<T> initValue;
+  };
+
+  // Try to allocate a value for every free slot in one go
+  void tryAllocate() noexcept;
+
+  // Claim value for slot, returns false if it can't be owned
+  bool tryAllocateSlot(const size_t slot, const T newVal) noexcept;
+
+  // Pick a value to try which is neither claimed in KvStore by someone we
+  // can't override nor used by any other slot
+  folly::Optional<T> pickValue(
+      const Slot& slot, const std::unordered_set<T>& usedVals) const noexcept;
+
+  // Schedule next round of allocation with backoff
+  void scheduleAllocate() noexcept;
+
+  // Invoked whenever there is an update for value of slot
+  void keyValUpdated(
+      const size_t slot,
+      const std::string& key,
+      const thrift::Value& thriftVal) noexcept;
+
+  std::string createKey(const T val) const noexcept;
+
+  //
+  // Immutable state
+  //
+
+  const std::string nodeName_;
+  const std::string keyPrefix_;
+
+  // KvStoreClient instance used for communicating with KvStore
+  KvStoreClient* const kvStoreClient_{nullptr};
+
+  // EventLoop in which KvStoreClient is looping
+  fbzmq::ZmqEventLoop* const eventLoop_{nullptr};
+
+  // Callback function to let user know of newly allocated values
+  const std::function<void(size_t, folly::Optional<T>)> callback_{nullptr};
+
+  const bool overrideOwner_{true};
+
+  // KvStore TTL for values
+  const std::chrono::milliseconds rangeAllocTtl_;
+
+  //
+  // Mutable state
+  //
+
+  // Range from which values need to be allocated
+  std::pair<T /* min */, T /* max */> allocRange_;
+
+  std::vector<Slot> slots_;
+
+  // Exponential backoff to avoid frequent allocation retries
+  ExponentialBackoff<std::chrono::milliseconds> backoff_;
+
+  // Scheduled timeout token
+  folly::Optional<int64_t> timeoutToken_{folly::none};
+
+  // Keys under keyPrefix_ in KvStore, i.e. claimed values
+  std::unordered_map<std::string, thrift::Value> keyVals_;
+};
+
+} // namespace openr
+
+#define RANGE_BATCH_ALLOCATOR_H_
+#include "RangeBatchAllocator-inl.h"
+#undef RANGE_BATCH_ALLOCATOR_H_
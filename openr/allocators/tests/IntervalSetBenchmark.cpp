@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+
+#include <openr/allocators/IntervalSet.h>
+
+namespace openr {
+
+/**
+ * Claim n random indices out of 2n, the way n nodes allocate sub-prefixes of
+ * a seed prefix, then look up free index from random starting points like
+ * RangeAllocator does on every collision
+ */
+static void
+BM_IntervalSetAllocate(uint32_t iters, uint32_t n) {
+  auto suspender = folly::BenchmarkSuspender();
+  for (uint32_t i = 0; i < iters; i++) {
+    IntervalSet<uint32_t> claimed;
+    suspender.dismiss();
+    while (claimed.size() < n) {
+      claimed.insert(folly::Random::rand32(2 * n));
+    }
+    for (uint32_t j = 0; j < n; j++) {
+      const auto val = claimed.nextAbsent(folly::Random::rand32(2 * n));
+      folly::doNotOptimizeAway(val);
+    }
+    suspender.rehire();
+  }
+}
+
+BENCHMARK_PARAM(BM_IntervalSetAllocate, 1000);
+BENCHMARK_PARAM(BM_IntervalSetAllocate, 10000);
+BENCHMARK_PARAM(BM_IntervalSetAllocate, 100000);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstdint>
+#include <limits>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/allocators/IntervalSet.h>
+
+using namespace openr;
+
+TEST(IntervalSetTest, InsertErase) {
+  IntervalSet<uint32_t> set;
+  EXPECT_FALSE(set.contains(5));
+  EXPECT_EQ(5, set.nextAbsent(5));
+
+  EXPECT_TRUE(set.insert(5));
+  EXPECT_FALSE(set.insert(5));
+  EXPECT_TRUE(set.insert(7));
+  EXPECT_EQ(2, set.getNumIntervals());
+
+  // Filling the gap joins intervals
+  EXPECT_TRUE(set.insert(6));
+  EXPECT_EQ(1, set.getNumIntervals());
+  EXPECT_EQ(3, set.size());
+  EXPECT_EQ(8, set.nextAbsent(5));
+  EXPECT_EQ(4, set.nextAbsent(4));
+
+  // Extending at both ends
+  EXPECT_TRUE(set.insert(4));
+  EXPECT_TRUE(set.insert(8));
+  EXPECT_EQ(1, set.getNumIntervals());
+  EXPECT_EQ(9, set.nextAbsent(4));
+
+  // Erasing from the middle splits interval
+  EXPECT_TRUE(set.erase(6));
+  EXPECT_FALSE(set.erase(6));
+  EXPECT_FALSE(set.contains(6));
+  EXPECT_TRUE(set.contains(5));
+  EXPECT_TRUE(set.contains(7));
+  EXPECT_EQ(2, set.getNumIntervals());
+  EXPECT_EQ(6, set.nextAbsent(4));
+
+  // Erasing ends shrinks intervals
+  EXPECT_TRUE(set.erase(4));
+  EXPECT_TRUE(set.erase(8));
+  EXPECT_TRUE(set.erase(5));
+  EXPECT_TRUE(set.erase(7));
+  EXPECT_EQ(0, set.size());
+  EXPECT_EQ(0, set.getNumIntervals());
+}
+
+TEST(IntervalSetTest, Limits) {
+  const auto max = std::numeric_limits<int32_t>::max();
+  const auto min = std::numeric_limits<int32_t>::min();
+  IntervalSet<int32_t> set;
+  EXPECT_TRUE(set.insert(max));
+  EXPECT_TRUE(set.insert(max - 1));
+  EXPECT_TRUE(set.insert(min));
+  EXPECT_EQ(2, set.getNumIntervals());
+  EXPECT_FALSE(set.nextAbsent(max - 1).hasValue());
+  EXPECT_EQ(min + 1, set.nextAbsent(min));
+  EXPECT_TRUE(set.erase(max));
+  EXPECT_EQ(max, set.nextAbsent(max - 1));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
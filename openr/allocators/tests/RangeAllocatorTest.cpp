@@ -17,6 +17,7 @@
 #include <sodium.h>
 
 #include <openr/allocators/RangeAllocator.h>
+#include <openr/allocators/RangeBatchAllocator.h>
 #include <openr/kvstore/KvStoreWrapper.h>
 
 using folly::make_optional;
@@ -352,6 +353,61 @@ TEST_P(RangeAllocatorFixture, InsufficentRange) {
   }
 }
 
+/**
+ * Run a batch allocator on each of a few clients, all with the same seeds.
+ * Every one of them must end up with its own distinct set of values.
+ */
+TEST_P(RangeAllocatorFixture, BatchAllocation) {
+  const size_t numAllocators = 10;
+  const size_t numValues = 10;
+  const uint32_t start = 61;
+  const uint32_t end = start + 2 * numAllocators * numValues - 1;
+  const std::vector<uint32_t> initVals =
+      range(start, start + (uint32_t)numValues) | as<std::vector<uint32_t>>();
+
+  using namespace std::chrono_literals;
+  std::vector<std::unique_ptr<RangeBatchAllocator<uint32_t>>> allocators;
+  auto isDone = [&]() {
+    std::set<uint32_t> allVals;
+    for (auto const& allocator : allocators) {
+      auto vals = allocator->getValues();
+      if (not vals) {
+        return false;
+      }
+      allVals.insert(vals->begin(), vals->end());
+    }
+    return allVals.size() == numAllocators * numValues;
+  };
+
+  for (size_t i = 0; i < numAllocators; i++) {
+    allocators.emplace_back(std::make_unique<RangeBatchAllocator<uint32_t>>(
+        createClientName(i),
+        "value:",
+        clients[i].get(),
+        [&, i](size_t slot, folly::Optional<uint32_t> newVal) noexcept {
+          VLOG(1) << "client " << i << " slot " << slot << " got "
+                  << (newVal ? folly::to<std::string>(*newVal) : "none");
+          if (newVal) {
+            EXPECT_LE(start, *newVal);
+            EXPECT_GE(end, *newVal);
+          }
+          if (isDone()) {
+            LOG(INFO) << "We got everything, stopping eventLoop.";
+            eventLoop.stop();
+          }
+        },
+        10ms /* min backoff */,
+        100ms /* max backoff */,
+        overrideOwner));
+  }
+  for (auto& allocator : allocators) {
+    allocator->startAllocator({start, end}, numValues, initVals);
+  }
+
+  eventLoop.run();
+  EXPECT_TRUE(isDone());
+}
+
 } // namespace openr
 
 int
@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Expected.h>
+#include <folly/Optional.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+namespace openr {
+
+/**
+ * Thrift serializer of a message bus between modules of the same process,
+ * with protocol picked at runtime. Compact protocol is smaller on the wire,
+ * binary protocol skips varint encoding and is cheaper on CPU for large
+ * databases. Publisher and all subscribers of a bus must use same protocol.
+ */
+class BusSerializer final {
+ public:
+  enum class Protocol {
+    COMPACT = 0,
+    BINARY = 1,
+  };
+
+  explicit BusSerializer(Protocol protocol = Protocol::COMPACT)
+      : protocol_(protocol) {}
+
+  // Parse protocol name ("compact" or "binary"), none if unknown
+  static folly::Optional<Protocol>
+  parseProtocol(std::string const& name) {
+    if (name == "compact") {
+      return Protocol::COMPACT;
+    }
+    if (name == "binary") {
+      return Protocol::BINARY;
+    }
+    return folly::none;
+  }
+
+  Protocol
+  getProtocol() const {
+    return protocol_;
+  }
+
+  template <typename ThriftType>
+  folly::Expected<fbzmq::Message, fbzmq::Error>
+  toMessage(ThriftType const& obj) {
+    switch (protocol_) {
+    case Protocol::BINARY:
+      return fbzmq::Message::fromThriftObj(obj, binarySerializer_);
+    case Protocol::COMPACT:
+    default:
+      return fbzmq::Message::fromThriftObj(obj, compactSerializer_);
+    }
+  }
+
+  template <typename ThriftType>
+  folly::Expected<ThriftType, fbzmq::Error>
+  fromMessage(fbzmq::Message const& msg) {
+    switch (protocol_) {
+    case Protocol::BINARY:
+      return msg.readThriftObj<ThriftType>(binarySerializer_);
+    case Protocol::COMPACT:
+    default:
+      return msg.readThriftObj<ThriftType>(compactSerializer_);
+    }
+  }
+
+ private:
+  const Protocol protocol_{Protocol::COMPACT};
+
+  apache::thrift::CompactSerializer compactSerializer_;
+  apache::thrift::BinarySerializer binarySerializer_;
+};
+
+} // namespace openr
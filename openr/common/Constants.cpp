@@ -19,6 +19,8 @@ constexpr folly::StringPiece Constants::kGlobalPubIdTemplate;
 constexpr folly::StringPiece Constants::kGlobalSubIdTemplate;
 constexpr folly::StringPiece Constants::kNodeLabelRangePrefix;
 constexpr folly::StringPiece Constants::kOpenrCtrlSessionContext;
+constexpr size_t Constants::kMaxKvStoreSubscriberPendingPubs;
+constexpr size_t Constants::kMaxFibSubscriberPendingDeltas;
 constexpr folly::StringPiece Constants::kPeerSyncIdTemplate;
 constexpr folly::StringPiece Constants::kPlatformHost;
 constexpr folly::StringPiece Constants::kPrefixAllocMarker;
@@ -47,17 +49,42 @@ constexpr int32_t Constants::kLinkMonitorPubPort;
 constexpr int32_t Constants::kMaxSrLabel;
 constexpr int32_t Constants::kMonitorPubPort;
 constexpr int32_t Constants::kMonitorRepPort;
+constexpr int32_t Constants::kOpenrCompactHelloVersion;
 constexpr int32_t Constants::kOpenrSupportedVersion;
 constexpr int32_t Constants::kOpenrVersion;
 constexpr int32_t Constants::kSparkMcastPort;
 constexpr int32_t Constants::kSystemAgentPort;
 constexpr int64_t Constants::kDefaultAdjWeight;
 constexpr int64_t Constants::kTtlInfinity;
+constexpr size_t Constants::kMaxIncrementalSpfChanges;
+constexpr std::chrono::seconds Constants::kRouteDbConsistencyCheckInterval;
+constexpr size_t Constants::kParallelRouteBuildMinPrefixes;
+constexpr size_t Constants::kRouteBuildShardsPerThread;
+constexpr std::chrono::milliseconds Constants::kPersistedRouteDbThrottleTimeout;
+constexpr std::chrono::milliseconds Constants::kPersistedRouteDbPublishDelay;
 constexpr size_t Constants::kNumTimeSeries;
 constexpr std::chrono::milliseconds Constants::kFloodPendingPublication;
+constexpr std::chrono::milliseconds Constants::kFloodTtlUpdateInterval;
+constexpr size_t Constants::kKvStoreParallelMinKeys;
+constexpr size_t Constants::kMaxPeerPendingKeys;
+constexpr size_t Constants::kKvStoreMinDeltaValueSize;
+constexpr std::chrono::milliseconds Constants::kDualMessagesBatchInterval;
+constexpr std::chrono::seconds Constants::kKvStoreFullSyncTimeout;
+constexpr std::chrono::milliseconds Constants::kKvStoreSptFullSyncWait;
+constexpr size_t Constants::kKvStoreMaxHashDumps;
+constexpr size_t Constants::kKvStoreCompressMinValueSize;
+constexpr int64_t Constants::kKvStorePeerStreamCredits;
+constexpr size_t Constants::kKvStorePeerStreamMaxPendingBatches;
+constexpr size_t Constants::kKvStorePeerStreamMaxBufferedRequests;
+constexpr std::chrono::seconds Constants::kKvStoreSnapshotInterval;
+constexpr std::chrono::seconds Constants::kKvStoreSnapshotConfirmTimeout;
+constexpr size_t Constants::kKvStoreShardsPerThread;
+constexpr int32_t Constants::kKvStoreDumpPageSize;
 constexpr std::chrono::milliseconds Constants::kHealthCheckInterval;
 constexpr std::chrono::milliseconds Constants::kInitialBackoff;
 constexpr std::chrono::milliseconds Constants::kKvStoreDbTtl;
+constexpr int32_t Constants::kKvStoreSyncRangeBits;
+constexpr int32_t Constants::kKvStoreSyncRangeLevels;
 constexpr std::chrono::milliseconds Constants::kLinkImmediateTimeout;
 constexpr std::chrono::milliseconds Constants::kLinkThrottleTimeout;
 constexpr std::chrono::milliseconds Constants::kMaxBackoff;
@@ -65,6 +92,7 @@ constexpr std::chrono::milliseconds Constants::kMaxTtlUpdateInterval;
 constexpr std::chrono::milliseconds Constants::kPersistentStoreInitialBackoff;
 constexpr std::chrono::milliseconds Constants::kPersistentStoreMaxBackoff;
 constexpr std::chrono::milliseconds Constants::kPlatformConnTimeout;
+constexpr std::chrono::milliseconds Constants::kPlatformPollInterval;
 constexpr std::chrono::milliseconds Constants::kPlatformProcTimeout;
 constexpr std::chrono::milliseconds Constants::kPollTimeout;
 constexpr std::chrono::milliseconds Constants::kPrefixAllocatorRetryInterval;
@@ -74,15 +102,22 @@ constexpr std::chrono::milliseconds Constants::kRangeAllocTtl;
 constexpr std::chrono::milliseconds Constants::kReadTimeout;
 constexpr std::chrono::milliseconds Constants::kTtlDecrement;
 constexpr std::chrono::milliseconds Constants::kTtlInfInterval;
+constexpr std::chrono::milliseconds Constants::kTtlRefreshBatchWindow;
 constexpr std::chrono::milliseconds Constants::kTtlThreshold;
 constexpr std::chrono::seconds Constants::kConvergenceMaxDuration;
 constexpr std::chrono::seconds Constants::kKeepAliveIntvl;
 constexpr std::chrono::seconds Constants::kKeepAliveTime;
 constexpr std::chrono::seconds Constants::kMemoryThresholdTime;
 constexpr std::chrono::seconds Constants::kMonitorSubmitInterval;
+constexpr std::chrono::milliseconds Constants::kCounterCacheTtl;
+constexpr size_t Constants::kEventLogRingSize;
+constexpr size_t Constants::kMaxCachedCounterRegexes;
+constexpr size_t Constants::kMaxReplyBufferSize;
+constexpr size_t Constants::kMinReplyBufferSize;
 constexpr std::chrono::seconds Constants::kNetlinkSyncThrottleInterval;
 constexpr std::chrono::seconds Constants::kPlatformSyncInterval;
 constexpr std::chrono::seconds Constants::kPlatformThriftIdleTimeout;
+constexpr std::chrono::seconds Constants::kRedistAddrsSyncInterval;
 constexpr std::chrono::seconds Constants::kStoreSyncInterval;
 constexpr std::pair<int32_t, int32_t> Constants::kSrGlobalRange;
 constexpr std::pair<int32_t, int32_t> Constants::kSrLocalRange;
@@ -51,6 +51,10 @@ class Constants {
   // The maximum messages we can queue on sending socket
   static constexpr int kHighWaterMark{65536};
 
+  // Bounds of the buffer preallocated for serializing a module reply
+  static constexpr size_t kMinReplyBufferSize{4096};
+  static constexpr size_t kMaxReplyBufferSize{16 * 1024 * 1024};
+
   // Maximum label size
   static constexpr int32_t kMaxSrLabel{(1 << 20) - 1};
 
@@ -68,9 +72,19 @@ class Constants {
   // default interval to publish to monitor
   static constexpr std::chrono::seconds kMonitorSubmitInterval{5};
 
+  // max age of counter snapshot served by ctrl-server to regex and selected
+  // counter queries
+  static constexpr std::chrono::milliseconds kCounterCacheTtl{1000};
+
+  // max number of regexes whose results are cached by ctrl-server
+  static constexpr size_t kMaxCachedCounterRegexes{64};
+
   // event log category
   static constexpr folly::StringPiece kEventLogCategory{"perfpipe_aquaman"};
 
+  // number of latest events each module keeps for export and getEventLogs
+  static constexpr size_t kEventLogRingSize{1024};
+
   // ExponentialBackoff durations
   static constexpr std::chrono::milliseconds kInitialBackoff{64};
   static constexpr std::chrono::milliseconds kMaxBackoff{8192};
@@ -115,6 +129,34 @@ class Constants {
   // overloaded note metric value
   static constexpr uint64_t kOverloadNodeMetric{1ull << 32};
 
+  //
+  // Decision specific
+  //
+
+  // Max number of link/node state changes which are applied incrementally on
+  // the cached SPF results. Beyond this we fall back to full SPF computation
+  static constexpr size_t kMaxIncrementalSpfChanges{64};
+
+  // Interval of full route builds verifying the incrementally built routes
+  static constexpr std::chrono::seconds kRouteDbConsistencyCheckInterval{300};
+
+  // Min number of prefixes for building routes in parallel prefix shards.
+  // Fewer are built inline as fan-out would cost more than it saves
+  static constexpr size_t kParallelRouteBuildMinPrefixes{1024};
+
+  // Number of prefix shards per route build worker thread, balancing shards
+  // of unevenly expensive prefixes across workers
+  static constexpr size_t kRouteBuildShardsPerThread{4};
+
+  // Min interval between writes of the published routes to PersistentStore
+  static constexpr std::chrono::milliseconds kPersistedRouteDbThrottleTimeout{
+      1000};
+
+  // Delay before publishing routes restored from PersistentStore on restart,
+  // to let Fib subscribe first
+  static constexpr std::chrono::milliseconds kPersistedRouteDbPublishDelay{
+      1000};
+
   //
   // Spark specific
   //
@@ -143,9 +185,16 @@ class Constants {
   static constexpr std::chrono::milliseconds kPlatformConnTimeout{100};
   static constexpr std::chrono::milliseconds kPlatformProcTimeout{20000};
 
+  // Interval for polling responses of thrift calls in flight to Switch agent
+  static constexpr std::chrono::milliseconds kPlatformPollInterval{1};
+
   // time interval to sync between Open/R and Platform
   static constexpr std::chrono::seconds kPlatformSyncInterval{60};
 
+  // time interval of full sync of redistributed addresses to PrefixManager,
+  // changes are advertised incrementally in between
+  static constexpr std::chrono::seconds kRedistAddrsSyncInterval{300};
+
   // Timeout duration for which if a client connection has no activity, then it
   // will be dropped. We keep it 3 * kPlatformSyncInterval so that thrift
   // connection between OpenR and platform service remains up forever under
@@ -176,9 +225,71 @@ class Constants {
   // Kvstore timer for flooding pending publication
   static constexpr std::chrono::milliseconds kFloodPendingPublication{100};
 
+  // Kvstore interval for coalescing TTL refreshes into one flood
+  static constexpr std::chrono::milliseconds kFloodTtlUpdateInterval{100};
+
+  // Min number of key-values for merging a publication or dumping keys in
+  // parallel key shards. Fewer are processed inline
+  static constexpr size_t kKvStoreParallelMinKeys{4096};
+
+  // Max number of keys waiting to be flooded to a slow peer. Beyond it they
+  // are dropped and a full-sync with the peer is requested instead
+  static constexpr size_t kMaxPeerPendingKeys{10000};
+
+  // min size of values flooded as delta of their previous version
+  static constexpr size_t kKvStoreMinDeltaValueSize{1024};
+
+  // Kvstore interval for batching dual messages sent to peers
+  static constexpr std::chrono::milliseconds kDualMessagesBatchInterval{10};
+
+  // Kvstore interval for writing snapshots of changed key-values to disk
+  static constexpr std::chrono::seconds kKvStoreSnapshotInterval{10};
+
+  // Max time for peers to confirm key-values loaded from a snapshot. Those
+  // still unconfirmed are dropped afterwards
+  static constexpr std::chrono::seconds kKvStoreSnapshotConfirmTimeout{60};
+
+  // Max time for a peer to respond to a full-sync request, after which it is
+  // no longer counted as in flight
+  static constexpr std::chrono::seconds kKvStoreFullSyncTimeout{30};
+
+  // Max time full-syncs with added peers wait for the flood SPT to form, so
+  // that only those on it are synced with. All are synced with after it
+  static constexpr std::chrono::milliseconds kKvStoreSptFullSyncWait{2000};
+
+  // Max number of distinct filters whose hash dumps KvStore keeps for
+  // full-syncs and hash dump requests
+  static constexpr size_t kKvStoreMaxHashDumps{8};
+
+  // Max number of keys per page of full-sync responses and of dumps by
+  // KvStoreClient, requested with KeyDumpParams.limit
+  static constexpr int32_t kKvStoreDumpPageSize{10000};
+
+  // Min size of values compressed by KvStoreClient for key prefixes with
+  // compression enabled, smaller values are sent as is
+  static constexpr size_t kKvStoreCompressMinValueSize{1024};
+
+  // Flow control of KvStore peer streams. Subscribers request batches of flood
+  // requests in credits of kKvStorePeerStreamCredits. Flood requests are
+  // batched once kKvStorePeerStreamMaxPendingBatches batches await credits,
+  // and held back in KvStore beyond kKvStorePeerStreamMaxBufferedRequests
+  static constexpr int64_t kKvStorePeerStreamCredits{16};
+  static constexpr size_t kKvStorePeerStreamMaxPendingBatches{16};
+  static constexpr size_t kKvStorePeerStreamMaxBufferedRequests{1000};
+
+  // Number of key shards per KvStore worker thread
+  static constexpr size_t kKvStoreShardsPerThread{4};
+
   // KvStore database TTLs
   static constexpr std::chrono::milliseconds kKvStoreDbTtl{5min};
 
+  // Range sync splits each key range into 2^kKvStoreSyncRangeBits sub-ranges
+  // per level, down to kKvStoreSyncRangeLevels levels. 64k leaf ranges hold a
+  // few keys each in stores of a few hundred thousand keys. Levels must be
+  // even as the full-sync initiator compares the leaf ranges
+  static constexpr int32_t kKvStoreSyncRangeBits{4};
+  static constexpr int32_t kKvStoreSyncRangeLevels{4};
+
   // RangeAllocator keys TTLs
   static constexpr std::chrono::milliseconds kRangeAllocTtl{5min};
 
@@ -210,8 +321,20 @@ class Constants {
 
   static constexpr folly::StringPiece kOpenrCtrlSessionContext{"OpenrCtrl"};
 
+  // max publications buffered for a KvStore snoop stream before the lagging
+  // subscriber is dropped and has to re-subscribe for a fresh snapshot
+  static constexpr size_t kMaxKvStoreSubscriberPendingPubs{1000};
+
+  // max route deltas buffered for a Fib route stream before the lagging
+  // subscriber is dropped
+  static constexpr size_t kMaxFibSubscriberPendingDeltas{1000};
+
   // max interval to update TTL for each key in kvstore w/ finite TTL
   static constexpr std::chrono::milliseconds kMaxTtlUpdateInterval{2h};
+  // TTL updates of keys due within this window (and within a quarter of their
+  // refresh interval) are advertised early along with keys due now, in one
+  // request
+  static constexpr std::chrono::milliseconds kTtlRefreshBatchWindow{500};
   // TTL infinity, never expires
   // int version
   static constexpr int64_t kTtlInfinity{INT32_MIN};
@@ -236,6 +359,10 @@ class Constants {
   // the time we hold on to announce to KvStore
   static constexpr std::chrono::milliseconds kPrefixMgrKvThrottleTimeout{250};
 
+  // the time we hold on to save prefix changes to disk
+  static constexpr std::chrono::milliseconds kPrefixMgrPersistThrottleTimeout{
+      1000};
+
   // OpenR ports
 
   // Openr Ctrl thrift server port
@@ -278,11 +405,14 @@ class Constants {
   static constexpr int32_t kSparkMcastPort{6666};
 
   // Current OpenR version
-  static constexpr int32_t kOpenrVersion{20190228};
+  static constexpr int32_t kOpenrVersion{20191014};
 
   // Lowest Supported OpenR version
   static constexpr int32_t kOpenrSupportedVersion{20180307};
 
+  // Lowest OpenR version understanding compactNeighborInfos of spark hellos
+  static constexpr int32_t kOpenrCompactHelloVersion{20191014};
+
   // Threshold time in secs to crash after reaching critical memory
   static constexpr std::chrono::seconds kMemoryThresholdTime{600};
 
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConvergenceCollector.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+// Nearest-rank percentile of sorted durations
+int64_t
+getPercentile(const std::vector<int64_t>& sortedDurations, double percentile) {
+  const auto rank = static_cast<size_t>(percentile * sortedDurations.size());
+  return sortedDurations.at(std::min(rank, sortedDurations.size() - 1));
+}
+
+} // namespace
+
+ConvergenceCollector::ConvergenceCollector(size_t maxEvents)
+    : maxEvents_(maxEvents) {
+  CHECK_LT(0, maxEvents_);
+}
+
+bool
+ConvergenceCollector::addPerfEvents(const thrift::PerfEvents& perfEvents) {
+  const auto& events = perfEvents.events;
+  if (events.size() < 2) {
+    VLOG(2) << "Ignoring timeline with " << events.size() << " events";
+    return false;
+  }
+
+  const auto& origin = events.front();
+  const auto& last = events.back();
+  const std::chrono::milliseconds duration(last.unixTs - origin.unixTs);
+  if (duration.count() < 0) {
+    VLOG(2) << "Ignoring timeline of " << last.nodeName << " ending before "
+            << "its origin " << origin.eventDescr;
+    return false;
+  }
+
+  EventKey key{origin.unixTs, origin.nodeName, origin.eventDescr};
+  if (events_.size() >= maxEvents_ and key < events_.begin()->first) {
+    return false;
+  }
+
+  auto it = events_.find(key);
+  if (it == events_.end()) {
+    it = events_.emplace(std::move(key), EventConvergence{}).first;
+    it->second.origin = origin;
+    if (events_.size() > maxEvents_) {
+      events_.erase(events_.begin());
+    }
+  }
+  auto& event = it->second;
+
+  // Timeline of a node is received once over its perf database and stream
+  if (not event.nodeDurations.emplace(last.nodeName, duration).second) {
+    return false;
+  }
+  if (event.slowestNode.empty() or duration > event.duration) {
+    event.duration = duration;
+    event.slowestNode = last.nodeName;
+  }
+  for (size_t i = 1; i < events.size(); ++i) {
+    const std::chrono::milliseconds hopDuration(
+        events[i].unixTs - events[i - 1].unixTs);
+    if (event.slowestHop.toEvent.empty() or
+        hopDuration > event.slowestHop.duration) {
+      event.slowestHop = Hop{events[i].nodeName,
+                             events[i - 1].eventDescr,
+                             events[i].eventDescr,
+                             hopDuration};
+    }
+  }
+  return true;
+}
+
+size_t
+ConvergenceCollector::addPerfDb(const thrift::PerfDatabase& perfDb) {
+  size_t numAdded{0};
+  for (const auto& perfEvents : perfDb.eventInfo) {
+    numAdded += addPerfEvents(perfEvents);
+  }
+  return numAdded;
+}
+
+std::vector<ConvergenceCollector::EventConvergence>
+ConvergenceCollector::getEvents() const {
+  std::vector<EventConvergence> events;
+  events.reserve(events_.size());
+  for (const auto& kv : events_) {
+    events.emplace_back(kv.second);
+  }
+  return events;
+}
+
+std::map<std::string, int64_t>
+ConvergenceCollector::getCounters() const {
+  std::map<std::string, int64_t> counters;
+  counters["convergence.network_ms.count"] = events_.size();
+  if (events_.empty()) {
+    return counters;
+  }
+
+  std::vector<int64_t> durations;
+  durations.reserve(events_.size());
+  for (const auto& kv : events_) {
+    durations.emplace_back(kv.second.duration.count());
+  }
+  std::sort(durations.begin(), durations.end());
+  counters["convergence.network_ms.p50"] = getPercentile(durations, 0.5);
+  counters["convergence.network_ms.p90"] = getPercentile(durations, 0.9);
+  counters["convergence.network_ms.p99"] = getPercentile(durations, 0.99);
+  counters["convergence.network_ms.max"] = durations.back();
+  return counters;
+}
+
+} // namespace openr
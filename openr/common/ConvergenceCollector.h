@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Lsdb_types.h>
+
+namespace openr {
+
+/**
+ * Network wide convergence of events, joined from convergence timelines
+ * reported by Fib of many nodes (getPerfDb, subscribeAndGetPerfDb).
+ *
+ * Timelines of one event start with the same first event, recorded on the
+ * node where the event originated, and end once routes are programmed on the
+ * reporting node. An event has converged on the network once the slowest of
+ * its nodes has programmed routes. Only the latest maxEvents events are kept.
+ *
+ * Timestamps of events are compared across nodes as is, clocks are expected
+ * to be synchronized.
+ */
+class ConvergenceCollector {
+ public:
+  // Step between two consecutive events of a timeline
+  struct Hop {
+    // node which recorded toEvent
+    std::string nodeName;
+    std::string fromEvent;
+    std::string toEvent;
+    std::chrono::milliseconds duration{0};
+  };
+
+  struct EventConvergence {
+    // First event of all timelines of the event
+    thrift::PerfEvent origin;
+    // Duration from origin until routes are programmed, by reporting node
+    std::map<std::string, std::chrono::milliseconds> nodeDurations;
+    // Network wide convergence, duration of slowest node
+    std::chrono::milliseconds duration{0};
+    std::string slowestNode;
+    // Longest hop of all timelines
+    Hop slowestHop;
+  };
+
+  explicit ConvergenceCollector(size_t maxEvents = 1000);
+
+  /**
+   * Join timeline reported by a node. Returns false if it is ignored, as it
+   * is malformed, older than all kept events or already joined
+   */
+  bool addPerfEvents(const thrift::PerfEvents& perfEvents);
+
+  // Join all timelines of perf database, returns number of joined ones
+  size_t addPerfDb(const thrift::PerfDatabase& perfDb);
+
+  // Kept events, ordered by time of origin
+  std::vector<EventConvergence> getEvents() const;
+
+  size_t
+  getNumEvents() const {
+    return events_.size();
+  }
+
+  /**
+   * Count, percentiles and max of network wide convergence of kept events,
+   * as convergence.network_ms.{count,p50,p90,p99,max}
+   */
+  std::map<std::string, int64_t> getCounters() const;
+
+ private:
+  // Origin timestamp, node and description of event
+  using EventKey = std::tuple<int64_t, std::string, std::string>;
+
+  const size_t maxEvents_{0};
+
+  std::map<EventKey, EventConvergence> events_;
+};
+
+} // namespace openr
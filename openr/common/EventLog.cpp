@@ -0,0 +1,90 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "EventLog.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <fbzmq/service/logging/LogSample.h>
+#include <glog/logging.h>
+
+#include <openr/common/Constants.h>
+
+namespace openr {
+
+EventLogEntry::EventLogEntry(std::string event, std::string nodeName) {
+  strings.emplace_back("event", std::move(event));
+  strings.emplace_back("node_name", std::move(nodeName));
+}
+
+std::string
+EventLogEntry::toJson() const {
+  fbzmq::LogSample sample(timestamp);
+  for (auto const& kv : strings) {
+    sample.addString(kv.first, kv.second);
+  }
+  for (auto const& kv : ints) {
+    sample.addInt(kv.first, kv.second);
+  }
+  for (auto const& kv : stringVectors) {
+    sample.addStringVector(kv.first, kv.second);
+  }
+  return sample.toJson();
+}
+
+fbzmq::thrift::EventLog
+toEventLog(const std::vector<EventLogEntry>& entries) {
+  std::vector<std::string> samples;
+  samples.reserve(entries.size());
+  for (auto const& entry : entries) {
+    samples.emplace_back(entry.toJson());
+  }
+  return fbzmq::thrift::EventLog(
+      apache::thrift::FRAGILE,
+      Constants::kEventLogCategory.toString(),
+      std::move(samples));
+}
+
+EventLogRing::EventLogRing(size_t capacity) : slots_(capacity) {
+  CHECK_LT(0, capacity);
+}
+
+void
+EventLogRing::add(EventLogEntry entry) {
+  const auto seqNum = ++lastSeqNum_;
+  auto& slot = slots_[(seqNum - 1) % slots_.size()];
+  std::lock_guard<folly::SpinLock> lock(slot.lock);
+  // a writer lapped around the ring may have stored a newer event already
+  if (slot.seqNum < seqNum) {
+    slot.seqNum = seqNum;
+    slot.entry = std::move(entry);
+  }
+}
+
+std::vector<EventLogEntry>
+EventLogRing::getEntries(uint64_t seqNum, uint64_t* lastSeqNum) const {
+  const auto last = lastSeqNum_.load();
+  if (lastSeqNum) {
+    *lastSeqNum = last;
+  }
+  const auto first = std::max(
+      seqNum + 1, last > slots_.size() ? last - slots_.size() + 1 : 1);
+
+  std::vector<EventLogEntry> entries;
+  for (auto i = first; i <= last; ++i) {
+    auto const& slot = slots_[(i - 1) % slots_.size()];
+    std::lock_guard<folly::SpinLock> lock(slot.lock);
+    // skip events overwritten meanwhile, or claimed but not stored yet
+    if (slot.seqNum == i) {
+      entries.emplace_back(slot.entry);
+    }
+  }
+  return entries;
+}
+
+} // namespace openr
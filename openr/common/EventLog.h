@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
+#include <folly/SpinLock.h>
+
+namespace openr {
+
+/**
+ * Structured event, kept as typed fields and only rendered to the JSON of
+ * fbzmq::LogSample when exported
+ */
+struct EventLogEntry {
+  EventLogEntry() = default;
+  EventLogEntry(std::string event, std::string nodeName);
+
+  EventLogEntry&
+  addString(std::string key, std::string value) {
+    strings.emplace_back(std::move(key), std::move(value));
+    return *this;
+  }
+
+  EventLogEntry&
+  addInt(std::string key, int64_t value) {
+    ints.emplace_back(std::move(key), value);
+    return *this;
+  }
+
+  EventLogEntry&
+  addStringVector(std::string key, std::vector<std::string> values) {
+    stringVectors.emplace_back(std::move(key), std::move(values));
+    return *this;
+  }
+
+  std::string toJson() const;
+
+  std::chrono::system_clock::time_point timestamp{
+      std::chrono::system_clock::now()};
+  std::vector<std::pair<std::string, std::string>> strings;
+  std::vector<std::pair<std::string, int64_t>> ints;
+  std::vector<std::pair<std::string, std::vector<std::string>>> stringVectors;
+};
+
+// Render events into one EventLog of Constants::kEventLogCategory
+fbzmq::thrift::EventLog toEventLog(const std::vector<EventLogEntry>& entries);
+
+/**
+ * Fixed-size ring of the latest events, the oldest event is overwritten once
+ * full. Safe to add to and read from any thread: writers claim a slot with
+ * one atomic increment and only contend on the spin lock of that slot with
+ * readers copying it out.
+ *
+ * Events are numbered in order of adding, starting with 1, so that readers
+ * can fetch the events added since the last one they have seen.
+ */
+class EventLogRing {
+ public:
+  explicit EventLogRing(size_t capacity);
+
+  void add(EventLogEntry entry);
+
+  // Events numbered after seqNum, which were not overwritten yet, oldest
+  // first. Sets lastSeqNum to number of the latest event, if given
+  std::vector<EventLogEntry> getEntries(
+      uint64_t seqNum = 0, uint64_t* lastSeqNum = nullptr) const;
+
+  size_t
+  capacity() const {
+    return slots_.size();
+  }
+
+ private:
+  struct Slot {
+    mutable folly::SpinLock lock;
+    // number of event, 0 if not written yet
+    uint64_t seqNum{0};
+    EventLogEntry entry;
+  };
+
+  std::vector<Slot> slots_;
+
+  // number of last claimed slot
+  std::atomic<uint64_t> lastSeqNum_{0};
+};
+
+} // namespace openr
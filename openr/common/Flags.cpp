@@ -65,6 +65,12 @@ DEFINE_string(
     platform_pub_url,
     "ipc:///tmp/platform-pub-url",
     "Publisher URL for interface/address notifications");
+DEFINE_int32(
+    platform_event_batch_window_ms,
+    0,
+    "If set, link/address/neighbor events within this window are coalesced "
+    "and published as one batch, keeping last state of each. 0 publishes "
+    "every event");
 DEFINE_string(
     domain,
     "terragraph",
@@ -102,6 +108,17 @@ DEFINE_bool(enable_prefix_alloc, false, "Enable automatic prefix allocation");
 DEFINE_int32(alloc_prefix_len, 128, "Allocated prefix length");
 DEFINE_bool(static_prefix_alloc, false, "Perform static prefix allocation");
 DEFINE_bool(per_prefix_keys, false, "Create per IP prefix keys in Kvstore");
+DEFINE_int32(
+    prefix_db_shards,
+    0,
+    "Hash prefixes into this many prefix keys in KvStore, each flooded only "
+    "when its own prefixes change. Zero to advertise all prefixes in one key. "
+    "Ignored with per_prefix_keys");
+DEFINE_bool(
+    kvstore_compress_prefix_db,
+    false,
+    "Compress large prefix databases advertised in KvStore with zstd. All "
+    "nodes must support compressed values before enabling it");
 DEFINE_bool(
     set_loopback_address,
     false,
@@ -185,6 +202,23 @@ DEFINE_int32(
     spark_fastinit_keepalive_time_ms,
     100,
     "Fast initial keep alive time (in milliseconds)");
+DEFINE_int32(
+    spark_hold_time_ms,
+    0,
+    "Hold time (in milliseconds) for sub-second failure detection. Overrides "
+    "spark_hold_time_s if set, must be at least 3 times the keep-alive time");
+DEFINE_int32(
+    spark_keepalive_time_ms,
+    0,
+    "Keep-alive message interval (in milliseconds) for sub-second failure "
+    "detection. Overrides spark_keepalive_time_s if set. Fast initial keep "
+    "alive time is capped by it");
+DEFINE_bool(
+    spark_hardware_timestamps,
+    false,
+    "Use NIC hardware receive timestamps of hello packets for RTT measurement "
+    "where available. Hardware clocks must be synchronized with system clock, "
+    "e.g. by phc2sys");
 DEFINE_string(
     spark_report_url, "inproc://spark_server_report", "Spark Report URL");
 DEFINE_string(spark_cmd_url, "inproc://spark_server_cmd", "Spark Cmd URL");
@@ -199,6 +233,21 @@ DEFINE_bool(
     "If set, will send pings to other nodes in network at interval specified "
     "by health_checker_ping_interval flag");
 DEFINE_bool(enable_fib_sync, false, "Enable periodic syncFib to FibAgent");
+DEFINE_bool(
+    enable_fib_warm_boot,
+    false,
+    "If set, routes of FibAgent are read on startup and kept in place. Only "
+    "their difference to routes computed by Decision is programmed");
+DEFINE_string(
+    fib_critical_prefixes,
+    "",
+    "Comma separated list of prefixes. Routes within them are programmed "
+    "ahead of other routes, along with default and host routes");
+DEFINE_int32(
+    fib_sync_chunk_size,
+    0,
+    "If set, full sync with FibAgent is done in chunks of this many routes "
+    "using chunked sync APIs, bounding memory used by a sync on both sides");
 DEFINE_int32(
     health_check_option,
     static_cast<uint32_t>(
@@ -210,6 +259,12 @@ DEFINE_bool(
     enable_netlink_fib_handler,
     false,
     "If set, netlink fib handler will be started for route programming.");
+DEFINE_bool(
+    enable_nexthop_objects,
+    false,
+    "If set, netlink fib handler programs unicast routes with kernel nexthop "
+    "groups, shared by routes with the same nexthops. Requires kernel "
+    "support for nexthop objects (Linux 5.3+)");
 DEFINE_bool(
     enable_netlink_system_handler,
     true,
@@ -231,6 +286,35 @@ DEFINE_int32(
     link_flap_max_backoff_ms,
     60000,
     "Max backoff to dampen link flaps (in millseconds)");
+DEFINE_bool(
+    enable_adj_dampening,
+    false,
+    "Dampen flapping adjacencies, they are not advertised while their flap "
+    "penalty is too high");
+DEFINE_int32(
+    adj_dampening_half_life_ms,
+    60000,
+    "Time for flap penalty of adjacency to decay by half (in milliseconds)");
+DEFINE_int32(
+    adj_dampening_max_suppress_ms,
+    300000,
+    "Longest time a flapping adjacency can be suppressed after its last flap "
+    "(in milliseconds)");
+DEFINE_int32(
+    rtt_metric_bucket_size,
+    1,
+    "With enable_rtt_metric, round link metrics to multiples of this. Metric "
+    "unit is 100us of RTT");
+DEFINE_int32(
+    rtt_metric_hysteresis_pct,
+    0,
+    "With enable_rtt_metric, only change link metric if measured one differs "
+    "from it by more than this percentage of it");
+DEFINE_bool(
+    link_monitor_event_driven_sync,
+    false,
+    "Sync interfaces with platform only on start and on detected gaps in "
+    "platform events, instead of periodically");
 DEFINE_bool(
     enable_perf_measurement,
     true,
@@ -245,6 +329,53 @@ DEFINE_int32(
     250,
     "Decision debounce time to update spf in frequent adj db update "
     "(in milliseconds)");
+DEFINE_int32(
+    decision_lfa_spf_threads,
+    0,
+    "Number of worker threads used to run per neighbor SPF computations "
+    "when LFA is enabled. Set to 0 to run them on the Decision thread.");
+DEFINE_int32(
+    decision_route_build_threads,
+    0,
+    "Number of worker threads used to build unicast routes in parallel "
+    "prefix shards. Set to 0 to build them on the Decision thread.");
+DEFINE_bool(
+    decision_adaptive_debounce,
+    false,
+    "Adapt decision debounce window to the measured cost of route "
+    "computation, within decision_debounce_min_ms and "
+    "decision_debounce_max_ms");
+DEFINE_bool(
+    decision_compute_thread,
+    false,
+    "Compute routes on a dedicated thread so that Decision keeps processing "
+    "KvStore publications and serving requests during route computation");
+DEFINE_bool(
+    decision_persist_routes,
+    false,
+    "Persist published routes and re-publish them right after restart, "
+    "before the graceful restart window expires. Requires "
+    "decision_graceful_restart_window_s");
+DEFINE_bool(
+    decision_radix_heap_spf,
+    false,
+    "Run SPF over a radix heap of integer metrics instead of a binary heap");
+DEFINE_bool(
+    decision_specialized_spf,
+    false,
+    "Run full SPF with a Dijkstra loop specialized for the kind of run, "
+    "without per link checks for features the run doesn't use");
+DEFINE_string(
+    decision_record_file,
+    "",
+    "If set, KvStore publications processed by Decision are recorded to this "
+    "file with their time of receipt, for replay with openr_decision_replay");
+DEFINE_string(
+    decision_route_delta_protocol,
+    "compact",
+    "Thrift protocol of route deltas published by Decision to Fib, either "
+    "compact or binary. Binary is cheaper to encode and decode for large "
+    "route databases. Plugins subscribing to Decision must use the same");
 DEFINE_bool(
     enable_watchdog,
     true,
@@ -252,6 +383,31 @@ DEFINE_bool(
     "openr thread, if unhealthy thread is detected, force crash openr");
 DEFINE_int32(watchdog_interval_s, 20, "Watchdog thread healthcheck interval");
 DEFINE_int32(watchdog_threshold_s, 300, "Watchdog thread aliveness threshold");
+DEFINE_string(
+    module_cpu_affinity,
+    "",
+    "CPUs module threads may run on, as <module>=<cpus> separated by ';' with "
+    "module name like DECISION and cpus like 1,3-4. Unlisted modules may run "
+    "on any CPU");
+DEFINE_string(
+    module_sched_policy,
+    "",
+    "Scheduling policy of module threads, as <module>=<policy>[:<priority>] "
+    "separated by ';' with policy one of other, batch, idle, fifo or rr. "
+    "Unlisted modules inherit the policy of the openr process");
+DEFINE_int32(
+    shared_worker_threads,
+    0,
+    "Number of threads of a worker pool shared by KvStore and Decision, "
+    "replacing their own kvstore_worker_threads, decision_lfa_spf_threads, "
+    "decision_route_build_threads and decision_compute_thread pools. Work is "
+    "spread over idle threads of the pool while computations of Decision "
+    "stay serialized. Disabled if 0, must be at least 2 otherwise");
+DEFINE_string(
+    thread_name_prefix,
+    "",
+    "Prefix of module thread names, e.g. to tell openr threads apart from "
+    "forwarding agent threads. Names longer than 15 characters are truncated");
 DEFINE_bool(
     enable_segment_routing, false, "Flag to disable/enable segment routing");
 DEFINE_bool(set_leaf_node, false, "Flag to enable/disable node as a leaf node");
@@ -290,6 +446,66 @@ DEFINE_int32(
     kvstore_ttl_decrement_ms,
     openr::Constants::kTtlDecrement.count(),
     "Amount of time to decrement TTL when flooding updates");
+DEFINE_bool(
+    kvstore_range_sync,
+    false,
+    "Full-sync with peers by comparing digests of key ranges and descending "
+    "into differing ones, instead of sending hashes of all keys");
+DEFINE_bool(
+    kvstore_ttl_update_batching,
+    false,
+    "Coalesce TTL refreshes and flood them to peers as compact TTL updates. "
+    "All nodes in the network must support it");
+DEFINE_int32(
+    kvstore_worker_threads,
+    0,
+    "Number of KvStore worker threads merging large publications, e.g. "
+    "full-sync responses, and building large dumps in parallel key shards. "
+    "Done in the KvStore thread if 0");
+DEFINE_bool(
+    kvstore_value_deltas,
+    false,
+    "Flood updates of large values to peers as patches of their previous "
+    "version. All nodes in the network must support it");
+DEFINE_bool(
+    kvstore_dual_message_batching,
+    false,
+    "Batch DUAL messages of flood optimization sent to each peer, replacing "
+    "superseded updates of the same root");
+DEFINE_string(
+    kvstore_snapshot_file,
+    "",
+    "File to periodically write a snapshot of KvStore key-values to. It is "
+    "loaded on restart so that full-sync with peers only confirms unchanged "
+    "keys instead of fetching them. Disabled if empty");
+DEFINE_int32(
+    kvstore_max_parallel_syncs,
+    16,
+    "Max number of full-syncs with peers in flight, e.g. after restart. Peers "
+    "on the flood SPT are synced first. Unbounded if 0");
+DEFINE_int32(
+    kvstore_originator_update_rate,
+    0,
+    "Rate of flooded value updates accepted from each originating node, in "
+    "updates per second. Excess updates are dropped and caught up on by "
+    "periodic full-sync. Unlimited if 0");
+DEFINE_int32(
+    kvstore_originator_update_burst,
+    0,
+    "Burst size of flooded value updates accepted from each originating "
+    "node");
+DEFINE_bool(
+    kvstore_peer_streams,
+    false,
+    "Stream flood requests of KvStore peers from their OpenrCtrl thrift "
+    "server, batched and flow controlled, instead of receiving them over ZMQ. "
+    "Peers must run with the same openr_ctrl_port");
+DEFINE_bool(
+    kvstore_spt_full_sync,
+    false,
+    "With flood optimization, full-sync with added peers only if they are on "
+    "the flood SPT (parent or children) instead of with every peer. Falls back "
+    "to all peers if the SPT doesn't form");
 DEFINE_bool(
     enable_secure_thrift_server,
     false,
@@ -33,6 +33,7 @@ DECLARE_int32(system_agent_port);
 DECLARE_int32(fib_handler_port);
 DECLARE_int32(spark_mcast_port);
 DECLARE_string(platform_pub_url);
+DECLARE_int32(platform_event_batch_window_ms);
 DECLARE_string(domain);
 DECLARE_string(chdir);
 DECLARE_string(listen_addr);
@@ -48,6 +49,8 @@ DECLARE_bool(enable_prefix_alloc);
 DECLARE_int32(alloc_prefix_len);
 DECLARE_bool(static_prefix_alloc);
 DECLARE_bool(per_prefix_keys);
+DECLARE_int32(prefix_db_shards);
+DECLARE_bool(kvstore_compress_prefix_db);
 
 DECLARE_bool(set_loopback_address);
 DECLARE_bool(override_loopback_addr);
@@ -74,6 +77,9 @@ DECLARE_int32(decision_graceful_restart_window_s);
 DECLARE_int32(spark_hold_time_s);
 DECLARE_int32(spark_keepalive_time_s);
 DECLARE_int32(spark_fastinit_keepalive_time_ms);
+DECLARE_int32(spark_hold_time_ms);
+DECLARE_int32(spark_keepalive_time_ms);
+DECLARE_bool(spark_hardware_timestamps);
 
 DECLARE_string(spark_report_url);
 DECLARE_string(spark_cmd_url);
@@ -81,10 +87,14 @@ DECLARE_string(spark_cmd_url);
 DECLARE_int32(health_checker_ping_interval_s);
 DECLARE_bool(enable_health_checker);
 DECLARE_bool(enable_fib_sync);
+DECLARE_bool(enable_fib_warm_boot);
+DECLARE_string(fib_critical_prefixes);
+DECLARE_int32(fib_sync_chunk_size);
 DECLARE_int32(health_check_option);
 DECLARE_int32(health_check_pct);
 
 DECLARE_bool(enable_netlink_fib_handler);
+DECLARE_bool(enable_nexthop_objects);
 DECLARE_bool(enable_netlink_system_handler);
 
 DECLARE_int32(ip_tos);
@@ -92,15 +102,34 @@ DECLARE_int32(zmq_context_threads);
 
 DECLARE_int32(link_flap_initial_backoff_ms);
 DECLARE_int32(link_flap_max_backoff_ms);
+DECLARE_bool(enable_adj_dampening);
+DECLARE_int32(adj_dampening_half_life_ms);
+DECLARE_int32(adj_dampening_max_suppress_ms);
+DECLARE_int32(rtt_metric_bucket_size);
+DECLARE_int32(rtt_metric_hysteresis_pct);
+DECLARE_bool(link_monitor_event_driven_sync);
 
 DECLARE_bool(enable_perf_measurement);
 
 DECLARE_int32(decision_debounce_min_ms);
 DECLARE_int32(decision_debounce_max_ms);
+DECLARE_int32(decision_lfa_spf_threads);
+DECLARE_int32(decision_route_build_threads);
+DECLARE_bool(decision_adaptive_debounce);
+DECLARE_bool(decision_compute_thread);
+DECLARE_bool(decision_persist_routes);
+DECLARE_bool(decision_radix_heap_spf);
+DECLARE_bool(decision_specialized_spf);
+DECLARE_string(decision_record_file);
+DECLARE_string(decision_route_delta_protocol);
 
 DECLARE_bool(enable_watchdog);
 DECLARE_int32(watchdog_interval_s);
 DECLARE_int32(watchdog_threshold_s);
+DECLARE_string(module_cpu_affinity);
+DECLARE_string(module_sched_policy);
+DECLARE_int32(shared_worker_threads);
+DECLARE_string(thread_name_prefix);
 
 DECLARE_bool(enable_segment_routing);
 DECLARE_bool(set_leaf_node);
@@ -116,6 +145,17 @@ DECLARE_int32(kvstore_flood_msg_burst_size);
 DECLARE_int32(kvstore_key_ttl_ms);
 DECLARE_int32(kvstore_sync_interval_s);
 DECLARE_int32(kvstore_ttl_decrement_ms);
+DECLARE_bool(kvstore_range_sync);
+DECLARE_bool(kvstore_ttl_update_batching);
+DECLARE_bool(kvstore_value_deltas);
+DECLARE_bool(kvstore_dual_message_batching);
+DECLARE_string(kvstore_snapshot_file);
+DECLARE_int32(kvstore_max_parallel_syncs);
+DECLARE_int32(kvstore_originator_update_rate);
+DECLARE_int32(kvstore_originator_update_burst);
+DECLARE_bool(kvstore_peer_streams);
+DECLARE_bool(kvstore_spt_full_sync);
+DECLARE_int32(kvstore_worker_threads);
 
 DECLARE_bool(enable_secure_thrift_server);
 DECLARE_string(x509_cert_path);
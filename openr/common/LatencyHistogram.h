@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include <folly/stats/Histogram-defs.h>
+#include <folly/stats/Histogram.h> // Order of include is IMP
+
+namespace openr {
+
+/**
+ * Distribution of the durations of one operation, shared by all runs of it
+ * since startup. Exported as count, percentiles and max, in units of
+ * Duration.
+ *
+ * Not synchronized. Modules record from their own event loop thread, which
+ * keeps recording to a bucket increment; share across threads wrapped in
+ * folly::Synchronized.
+ */
+template <typename Duration>
+class BasicLatencyHistogram {
+ public:
+  BasicLatencyHistogram() = default;
+
+  // Percentiles are estimated within buckets of bucketSize, durations beyond
+  // max land in the overflow bucket though are still accounted in max
+  BasicLatencyHistogram(int64_t bucketSize, int64_t max)
+      : histogram_(bucketSize, 0, max) {}
+
+  void
+  addValue(Duration duration) {
+    histogram_.addValue(duration.count());
+    max_ = std::max(max_, static_cast<int64_t>(duration.count()));
+  }
+
+  template <typename Counters>
+  void
+  exportCounters(const std::string& name, Counters& counters) const {
+    int64_t count{0};
+    for (size_t i = 0; i < histogram_.getNumBuckets(); ++i) {
+      count += histogram_.getBucketByIndex(i).count;
+    }
+    counters[name + ".count"] = count;
+    if (count == 0) {
+      return;
+    }
+    counters[name + ".p50"] = histogram_.getPercentileEstimate(0.5);
+    counters[name + ".p90"] = histogram_.getPercentileEstimate(0.9);
+    counters[name + ".p99"] = histogram_.getPercentileEstimate(0.99);
+    counters[name + ".max"] = max_;
+  }
+
+ private:
+  // by default 10 unit buckets up to 10000 units, e.g. 10ms buckets up to 10s
+  folly::Histogram<int64_t> histogram_{10, 0, 10000};
+  int64_t max_{0};
+};
+
+using LatencyHistogram = BasicLatencyHistogram<std::chrono::milliseconds>;
+using MicrosecondsHistogram = BasicLatencyHistogram<std::chrono::microseconds>;
+
+} // namespace openr
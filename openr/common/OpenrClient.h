@@ -16,11 +16,10 @@
 
 namespace openr {
 
-std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>
+inline std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>
 getOpenrCtrlPlainTextClient(
     folly::EventBase& evb,
-    const folly::IPAddress& addr,
-    int32_t port = Constants::kOpenrCtrlPort,
+    const folly::SocketAddress& addr,
     std::chrono::milliseconds connectTimeout = Constants::kPlatformConnTimeout,
     std::chrono::milliseconds processingTimeout =
         std::chrono::milliseconds(10000)) {
@@ -31,7 +30,7 @@ getOpenrCtrlPlainTextClient(
     // we expect clients to be persistent.
     auto transport = apache::thrift::async::TAsyncSocket::UniquePtr(
         new apache::thrift::async::TAsyncSocket(
-            &evb, folly::SocketAddress(addr, port), connectTimeout.count()),
+            &evb, addr, connectTimeout.count()),
         folly::DelayedDestruction::Destructor());
 
     // Create channel and set timeout
@@ -52,6 +51,18 @@ getOpenrCtrlPlainTextClient(
   return client;
 }
 
+inline std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>
+getOpenrCtrlPlainTextClient(
+    folly::EventBase& evb,
+    const folly::IPAddress& addr,
+    int32_t port = Constants::kOpenrCtrlPort,
+    std::chrono::milliseconds connectTimeout = Constants::kPlatformConnTimeout,
+    std::chrono::milliseconds processingTimeout =
+        std::chrono::milliseconds(10000)) {
+  return getOpenrCtrlPlainTextClient(
+      evb, folly::SocketAddress(addr, port), connectTimeout, processingTimeout);
+}
+
 // TODO: Add support for creating TLSSocket
 //
 // std::unique_ptr<thrift::OpenrCtrlCppAsyncClient>
@@ -7,7 +7,10 @@
 
 #include "openr/common/OpenrEventLoop.h"
 
+#include <time.h>
+
 #include <folly/Format.h>
+#include <folly/String.h>
 
 namespace openr {
 
@@ -94,10 +97,23 @@ OpenrEventLoop::processCmdSocketRequest(
     return;
   }
 
-  auto req = maybeReq.value();
+  // Frames are moved along, request payload is deserialized in place by
+  // processRequestMsg and reply is sent without copying
+  auto req = std::move(maybeReq).value();
 
+  // profiled as plain request unless processRequestMsg names the command
+  const bool profiling = isProfilingEnabled();
+  const auto startTime =
+      profiling ? getThreadCpuTime() : std::chrono::nanoseconds(0);
+  profiledRequestName_.clear();
   auto maybeReply = processRequestMsg(std::move(req.back()));
   req.pop_back();
+  if (profiling) {
+    recordProfile(
+        profiledRequestName_.empty() ? "request"
+                                     : "request." + profiledRequestName_,
+        getThreadCpuTime() - startTime);
+  }
 
   // All messages of the multipart request except the last are sent back as they
   // are ids or empty delims. Add the response at the end of that list.
@@ -118,4 +134,53 @@ OpenrEventLoop::processCmdSocketRequest(
   return;
 }
 
+void
+OpenrEventLoop::setProfiledRequestName(const char* name) {
+  if (isProfilingEnabled() and name) {
+    profiledRequestName_ = name;
+  }
+}
+
+void
+OpenrEventLoop::exportEventLogs(fbzmq::ZmqMonitorClient& monitorClient) {
+  uint64_t lastSeqNum{0};
+  const auto entries =
+      eventLogs_.getEntries(exportedEventLogSeqNum_, &lastSeqNum);
+  exportedEventLogSeqNum_ = lastSeqNum;
+  if (not entries.empty()) {
+    monitorClient.addEventLog(toEventLog(entries));
+  }
+}
+
+void
+OpenrEventLoop::exportProfileCounters(
+    std::unordered_map<std::string, int64_t>& counters) const {
+  auto prefix = folly::sformat("{}.loop_profile.", moduleName);
+  folly::toLowerAscii(prefix);
+  for (auto const& kv : profiles_) {
+    counters[prefix + kv.first + ".cpu_us"] =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            kv.second.cpuTime)
+            .count();
+    counters[prefix + kv.first + ".calls"] = kv.second.calls;
+  }
+}
+
+std::chrono::nanoseconds
+OpenrEventLoop::getThreadCpuTime() {
+  struct timespec ts;
+  if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return std::chrono::nanoseconds(0);
+  }
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+void
+OpenrEventLoop::recordProfile(
+    const std::string& name, std::chrono::nanoseconds cpuTime) {
+  auto& profile = profiles_[name];
+  profile.cpuTime += cpuTime;
+  ++profile.calls;
+}
+
 } // namespace openr
@@ -7,10 +7,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
 #include <fbzmq/async/ZmqEventLoop.h>
+#include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Expected.h>
+#include <folly/Function.h>
+#include <folly/futures/Future.h>
+#include <folly/io/IOBufQueue.h>
 #include <openr/common/Constants.h>
+#include <openr/common/EventLog.h>
 #include <openr/if/gen-cpp2/OpenrCtrl_types.h>
 
 namespace openr {
@@ -25,6 +37,10 @@ namespace openr {
 //    ZMQ_ROUTER socket (and maybe other ZMQ sockets, like a globally
 //    reachable one)
 //
+// Modules may additionally expose typed getters returning folly::SemiFuture
+// for callers in the same process (e.g. ctrl-server), which skip the
+// serialization of request and reply over the inproc socket
+//
 
 class OpenrEventLoop : public fbzmq::ZmqEventLoop {
  public:
@@ -33,6 +49,26 @@ class OpenrEventLoop : public fbzmq::ZmqEventLoop {
   const std::string inprocCmdUrl;
   const folly::Optional<std::string> tcpCmdUrl;
 
+  // Opt-in profiling of loop time. While enabled, thread CPU time spent in
+  // command requests, by command, and in callbacks wrapped with profiled(),
+  // by handler name, is accumulated. Can be toggled from any thread
+  void
+  setProfilingEnabled(bool enabled) {
+    profilingEnabled_ = enabled;
+  }
+
+  bool
+  isProfilingEnabled() const {
+    return profilingEnabled_;
+  }
+
+  // Events logged by this module since its last exportEventLogs(), can be
+  // called from any thread
+  std::vector<EventLogEntry>
+  getPendingEventLogs() const {
+    return eventLogs_.getEntries(exportedEventLogSeqNum_);
+  }
+
  protected:
   OpenrEventLoop(
       const std::string& nodeName,
@@ -42,6 +78,70 @@ class OpenrEventLoop : public fbzmq::ZmqEventLoop {
       folly::Optional<int> maybeIpTos = folly::none,
       int socketHwm = Constants::kHighWaterMark);
 
+  // Run func in this event loop and fulfill returned future with its result,
+  // or with the exception it throws
+  template <typename T>
+  folly::SemiFuture<std::unique_ptr<T>>
+  runInEventLoopWithResult(folly::Function<T()> func) {
+    folly::Promise<std::unique_ptr<T>> p;
+    auto sf = p.getSemiFuture();
+    runInEventLoop(
+        [p = std::move(p), func = std::move(func)]() mutable noexcept {
+          p.setWith([&func] { return std::make_unique<T>(func()); });
+        });
+    return sf;
+  }
+
+  // Wrap socket or timeout callback so that its CPU time is accounted to
+  // handler name while profiling is enabled
+  template <typename Callback>
+  auto
+  profiled(std::string name, Callback callback) {
+    return [this, name = std::move(name), callback = std::move(callback)](
+               auto&&... args) mutable noexcept {
+      if (not isProfilingEnabled()) {
+        callback(std::forward<decltype(args)>(args)...);
+        return;
+      }
+      const auto startTime = getThreadCpuTime();
+      callback(std::forward<decltype(args)>(args)...);
+      recordProfile(name, getThreadCpuTime() - startTime);
+    };
+  }
+
+  // Name processed command request is profiled as, to be called by
+  // processRequestMsg once the command is known
+  void setProfiledRequestName(const char* name);
+
+  // Add cumulative profiled CPU time and calls of each handler as
+  // <module>.loop_profile.<handler>.cpu_us and .calls
+  void exportProfileCounters(
+      std::unordered_map<std::string, int64_t>& counters) const;
+
+  // Log event of this module. It is only rendered to JSON once exported
+  void
+  logEvent(EventLogEntry entry) {
+    eventLogs_.add(std::move(entry));
+  }
+
+  // Hand events logged since last export over to monitor, in one EventLog
+  void exportEventLogs(fbzmq::ZmqMonitorClient& monitorClient);
+
+  // Serialize reply of processRequestMsg into one buffer preallocated after
+  // the size of previous reply, so that ZMQ takes it over without coalescing
+  // (copying) a chain of buffers. Replies growing beyond it are still valid.
+  template <typename ThriftType, typename Serializer>
+  folly::Expected<fbzmq::Message, fbzmq::Error>
+  toReplyMsg(ThriftType const& obj, Serializer& serializer) {
+    folly::IOBufQueue queue(folly::IOBufQueue::cacheChainLength());
+    queue.preallocate(replyBufferSize_, replyBufferSize_);
+    serializer.serialize(obj, &queue);
+    replyBufferSize_ = std::min(
+        std::max(queue.chainLength(), Constants::kMinReplyBufferSize),
+        Constants::kMaxReplyBufferSize);
+    return fbzmq::Message::wrapBuffer(queue.move());
+  }
+
  private:
   // disable copying
   OpenrEventLoop(OpenrEventLoop const&) = delete;
@@ -58,6 +158,10 @@ class OpenrEventLoop : public fbzmq::ZmqEventLoop {
   virtual folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
       fbzmq::Message&& request) = 0;
 
+  static std::chrono::nanoseconds getThreadCpuTime();
+
+  void recordProfile(const std::string& name, std::chrono::nanoseconds cpuTime);
+
   // For backward compatibility, we are preserving the endpoints that the
   // modules previously had. All had inproc socket while some also had tcp
   // socket. going foraward, we will hopefully remove the tcp socket and
@@ -65,5 +169,26 @@ class OpenrEventLoop : public fbzmq::ZmqEventLoop {
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> inprocCmdSock_;
 
   folly::Optional<fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>> tcpCmdSock_;
+
+  // Size of buffer to preallocate for next reply
+  size_t replyBufferSize_{Constants::kMinReplyBufferSize};
+
+  struct HandlerProfile {
+    std::chrono::nanoseconds cpuTime{0};
+    int64_t calls{0};
+  };
+
+  std::atomic<bool> profilingEnabled_{false};
+
+  // profiles by handler name, only accessed in this event loop
+  std::unordered_map<std::string, HandlerProfile> profiles_;
+
+  // name of command request being processed, if set by processRequestMsg
+  std::string profiledRequestName_;
+
+  EventLogRing eventLogs_{Constants::kEventLogRingSize};
+
+  // number of latest exported event
+  std::atomic<uint64_t> exportedEventLogSeqNum_{0};
 }; // class OpenrEventLoop
 } // namespace openr
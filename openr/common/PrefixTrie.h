@@ -0,0 +1,304 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+/*
+ * Map of IP prefixes to values with longest prefix match lookups, for both
+ * address families. Prefixes are kept in a path-compressed binary trie per
+ * family, so that lookups visit at most one node per distinct prefix length
+ * on the path rather than scanning all prefixes. Nodes live in a pool and
+ * refer to each other by index, erased nodes are reused.
+ *
+ * Prefixes are stored masked, i.e. 10.1.1.1/8 and 10.0.0.0/8 are the same.
+ */
+template <typename T>
+class PrefixTrie {
+ public:
+  using Entry = std::pair<folly::CIDRNetwork, T>;
+
+  // Add or replace value of prefix. Returns true if prefix is new
+  bool
+  insert(const folly::CIDRNetwork& prefix, T value) {
+    const auto key = makeKey(prefix);
+    int32_t* link = &getRoot(prefix.first);
+    while (true) {
+      if (*link == kNone) {
+        *link = allocNode(key, prefix, std::move(value));
+        ++size_;
+        return true;
+      }
+      const int32_t index = *link;
+      auto& node = nodes_[index];
+      const auto common = getCommonLength(
+          node.key, key, std::min(node.key.length, key.length));
+      if (common == node.key.length and common == key.length) {
+        const bool isNew = not node.entry.hasValue();
+        node.entry = Entry(getMasked(prefix), std::move(value));
+        if (isNew) {
+          ++size_;
+        }
+        return isNew;
+      }
+      if (common == node.key.length) {
+        // node is a prefix of key, descend
+        link = &node.children[getBit(key, common)];
+        continue;
+      }
+
+      // split at common length, nodes_ is a deque so node and link stay valid
+      int32_t split;
+      if (common == key.length) {
+        split = allocNode(key, prefix, std::move(value));
+      } else {
+        split = allocNode(truncate(key, common));
+        const auto leaf = allocNode(key, prefix, std::move(value));
+        nodes_[split].children[getBit(key, common)] = leaf;
+      }
+      nodes_[split].children[getBit(node.key, common)] = index;
+      *link = split;
+      ++size_;
+      return true;
+    }
+  }
+
+  // Remove prefix. Returns false if there was no such prefix
+  bool
+  erase(const folly::CIDRNetwork& prefix) {
+    const auto key = makeKey(prefix);
+    int32_t* parentLink = nullptr;
+    int32_t* link = &getRoot(prefix.first);
+    while (*link != kNone) {
+      auto& node = nodes_[*link];
+      if (node.key.length > key.length or
+          getCommonLength(node.key, key, node.key.length) < node.key.length) {
+        return false;
+      }
+      if (node.key.length == key.length) {
+        break;
+      }
+      parentLink = link;
+      link = &node.children[getBit(key, node.key.length)];
+    }
+    if (*link == kNone or not nodes_[*link].entry.hasValue()) {
+      return false;
+    }
+
+    const int32_t index = *link;
+    nodes_[index].entry.clear();
+    --size_;
+    const auto numChildren = getNumChildren(nodes_[index]);
+    if (numChildren == 2) {
+      return true;
+    }
+    *link = numChildren == 1 ? getOnlyChild(nodes_[index]) : kNone;
+    freeNode(index);
+
+    // parent may be left as a value-less node with a single child
+    if (numChildren == 0 and parentLink) {
+      const int32_t parent = *parentLink;
+      if (not nodes_[parent].entry.hasValue() and
+          getNumChildren(nodes_[parent]) == 1) {
+        *parentLink = getOnlyChild(nodes_[parent]);
+        freeNode(parent);
+      }
+    }
+    return true;
+  }
+
+  // Value of exact prefix, if any
+  const T*
+  find(const folly::CIDRNetwork& prefix) const {
+    const auto* entry = longestMatch(prefix);
+    if (entry and entry->first.second == prefix.second) {
+      return &entry->second;
+    }
+    return nullptr;
+  }
+
+  // Longest prefix containing address, if any
+  const Entry*
+  longestMatch(const folly::IPAddress& address) const {
+    return longestMatch(folly::CIDRNetwork(address, address.bitCount()));
+  }
+
+  // Longest prefix containing, or same as, network, if any
+  const Entry*
+  longestMatch(const folly::CIDRNetwork& network) const {
+    const auto key = makeKey(network);
+    const Entry* best = nullptr;
+    int32_t index = getRoot(network.first);
+    while (index != kNone) {
+      const auto& node = nodes_[index];
+      if (node.key.length > key.length or
+          getCommonLength(node.key, key, node.key.length) < node.key.length) {
+        break;
+      }
+      if (node.entry.hasValue()) {
+        best = node.entry.get_pointer();
+      }
+      if (node.key.length == key.length) {
+        break;
+      }
+      index = node.children[getBit(key, node.key.length)];
+    }
+    return best;
+  }
+
+  size_t
+  size() const {
+    return size_;
+  }
+
+  bool
+  empty() const {
+    return size_ == 0;
+  }
+
+  void
+  clear() {
+    nodes_.clear();
+    freeNodes_.clear();
+    rootV4_ = kNone;
+    rootV6_ = kNone;
+    size_ = 0;
+  }
+
+ private:
+  static constexpr int32_t kNone{-1};
+
+  struct Key {
+    std::array<uint8_t, 16> bytes{};
+    uint8_t length{0};
+  };
+
+  struct Node {
+    Key key;
+    std::array<int32_t, 2> children{{kNone, kNone}};
+    folly::Optional<Entry> entry;
+  };
+
+  static Key
+  makeKey(const folly::CIDRNetwork& prefix) {
+    CHECK_LE(prefix.second, prefix.first.bitCount());
+    Key key;
+    const auto bytes = prefix.first.bytes();
+    std::copy(bytes, bytes + prefix.first.byteCount(), key.bytes.begin());
+    key.length = prefix.second;
+    return key;
+  }
+
+  static folly::CIDRNetwork
+  getMasked(const folly::CIDRNetwork& prefix) {
+    return folly::CIDRNetwork(prefix.first.mask(prefix.second), prefix.second);
+  }
+
+  static Key
+  truncate(const Key& key, uint8_t length) {
+    Key truncated;
+    truncated.length = length;
+    for (uint8_t i = 0; i < (length + 7) / 8; ++i) {
+      truncated.bytes[i] = key.bytes[i];
+    }
+    if (length % 8) {
+      truncated.bytes[length / 8] &=
+          static_cast<uint8_t>(0xff << (8 - length % 8));
+    }
+    return truncated;
+  }
+
+  static int
+  getBit(const Key& key, uint8_t index) {
+    return (key.bytes[index / 8] >> (7 - index % 8)) & 1;
+  }
+
+  // Number of leading bits key a and b have in common, up to maxLength
+  static uint8_t
+  getCommonLength(const Key& a, const Key& b, uint8_t maxLength) {
+    uint8_t length = 0;
+    while (length + 8 <= maxLength and
+           a.bytes[length / 8] == b.bytes[length / 8]) {
+      length += 8;
+    }
+    while (length < maxLength and getBit(a, length) == getBit(b, length)) {
+      ++length;
+    }
+    return length;
+  }
+
+  static size_t
+  getNumChildren(const Node& node) {
+    return (node.children[0] != kNone) + (node.children[1] != kNone);
+  }
+
+  static int32_t
+  getOnlyChild(const Node& node) {
+    return node.children[0] != kNone ? node.children[0] : node.children[1];
+  }
+
+  int32_t&
+  getRoot(const folly::IPAddress& address) {
+    return address.isV4() ? rootV4_ : rootV6_;
+  }
+
+  int32_t
+  getRoot(const folly::IPAddress& address) const {
+    return address.isV4() ? rootV4_ : rootV6_;
+  }
+
+  int32_t
+  allocNode(const Key& key) {
+    int32_t index;
+    if (freeNodes_.empty()) {
+      index = static_cast<int32_t>(nodes_.size());
+      nodes_.emplace_back();
+    } else {
+      index = freeNodes_.back();
+      freeNodes_.pop_back();
+    }
+    nodes_[index].key = key;
+    return index;
+  }
+
+  int32_t
+  allocNode(const Key& key, const folly::CIDRNetwork& prefix, T value) {
+    const auto index = allocNode(truncate(key, key.length));
+    nodes_[index].entry = Entry(getMasked(prefix), std::move(value));
+    return index;
+  }
+
+  void
+  freeNode(int32_t index) {
+    nodes_[index] = Node();
+    freeNodes_.emplace_back(index);
+  }
+
+  // deque so that links into nodes stay valid while adding nodes
+  std::deque<Node> nodes_;
+  std::vector<int32_t> freeNodes_;
+  int32_t rootV4_{kNone};
+  int32_t rootV6_{kNone};
+  size_t size_{0};
+};
+
+template <typename T>
+constexpr int32_t PrefixTrie<T>::kNone;
+
+} // namespace openr
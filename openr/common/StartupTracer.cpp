@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "StartupTracer.h"
+
+#include <glog/logging.h>
+
+namespace openr {
+
+namespace {
+
+std::chrono::milliseconds
+getDurationMs(
+    StartupTracer::Clock::time_point start,
+    StartupTracer::Clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+}
+
+} // namespace
+
+StartupTracer::StartupTracer(
+    std::vector<std::string> milestones, Clock::time_point startTime)
+    : startTime_(startTime),
+      pendingMilestones_(milestones.begin(), milestones.end()),
+      lastSpanEnd_(startTime) {
+  CHECK(not pendingMilestones_.empty());
+}
+
+void
+StartupTracer::addSpan(const std::string& name, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto duration = getDurationMs(lastSpanEnd_, now);
+  spans_[name] += duration;
+  lastSpanEnd_ = now;
+  LOG(INFO) << "Startup: " << name << " took " << duration.count() << " ms";
+}
+
+bool
+StartupTracer::markReady(const std::string& milestone, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (milestones_.count(milestone)) {
+    return false;
+  }
+  const auto sinceStart = getDurationMs(startTime_, now);
+  milestones_.emplace(milestone, sinceStart);
+  LOG(INFO) << "Startup: " << milestone << " after " << sinceStart.count()
+            << " ms";
+
+  if (not pendingMilestones_.erase(milestone) or
+      not pendingMilestones_.empty()) {
+    return false;
+  }
+  totalDuration_ = sinceStart;
+  LOG(INFO) << "Startup: done after " << totalDuration_.count() << " ms";
+  return true;
+}
+
+bool
+StartupTracer::isDone() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pendingMilestones_.empty();
+}
+
+std::map<std::string, int64_t>
+StartupTracer::getCounters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, int64_t> counters;
+  for (const auto& kv : spans_) {
+    counters["startup.span_ms." + kv.first] = kv.second.count();
+  }
+  for (const auto& kv : milestones_) {
+    counters["startup.ready_ms." + kv.first] = kv.second.count();
+  }
+  if (pendingMilestones_.empty()) {
+    counters["startup.total_ms"] = totalDuration_.count();
+  }
+  return counters;
+}
+
+} // namespace openr
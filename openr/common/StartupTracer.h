@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace openr {
+
+/**
+ * Startup profile of the process, from start of the tracer until it is ready.
+ *
+ * Spans are consecutive phases of startup, e.g. init of a module, each lasting
+ * from end of the previous span until it is added. Milestones are points in
+ * time after start, e.g. Decision's initial sync, reported from any thread.
+ * Startup is done once all of the expected milestones are reached.
+ *
+ * Exported as counters, startup.span_ms.<span> for duration of spans and
+ * startup.ready_ms.<milestone> for time of milestones since start, along with
+ * startup.total_ms once done.
+ */
+class StartupTracer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit StartupTracer(
+      std::vector<std::string> milestones,
+      Clock::time_point startTime = Clock::now());
+
+  // End a span of startup, spans of same name add up
+  void addSpan(const std::string& name, Clock::time_point now = Clock::now());
+
+  /**
+   * Reach a milestone, later reports of it are ignored. Returns true if this
+   * completes startup, i.e. for exactly one call
+   */
+  bool markReady(
+      const std::string& milestone, Clock::time_point now = Clock::now());
+
+  bool isDone() const;
+
+  std::map<std::string, int64_t> getCounters() const;
+
+ private:
+  const Clock::time_point startTime_;
+
+  // expected milestones yet to be reached
+  std::set<std::string> pendingMilestones_;
+
+  mutable std::mutex mutex_;
+  Clock::time_point lastSpanEnd_;
+  std::map<std::string, std::chrono::milliseconds> spans_;
+  std::map<std::string, std::chrono::milliseconds> milestones_;
+  std::chrono::milliseconds totalDuration_{0};
+};
+
+} // namespace openr
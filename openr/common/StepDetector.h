@@ -7,15 +7,100 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cmath>
 #include <functional>
 #include <stdexcept>
 
-#include <folly/stats/BucketedTimeSeries-defs.h>
-#include <folly/stats/BucketedTimeSeries.h> // Order of include is IMP
+#include <glog/logging.h>
 
 namespace openr {
 
+/*
+ * Sliding window over the last NumBuckets sample periods of a time series,
+ * one bucket per period. Same as folly::BucketedTimeSeries for average but
+ * buckets are a fixed size ring and sum/count of the window are kept as
+ * running totals, so adding a value is O(1) and never allocates.
+ */
+template <typename ValueType, typename TimeType, size_t NumBuckets>
+class SlidingWindow {
+ public:
+  explicit SlidingWindow(TimeType samplePeriod) : samplePeriod_(samplePeriod) {
+    CHECK_GT(samplePeriod_.count(), 0);
+  }
+
+  // add the value 'val' at time 'now'. Returns false if it is older than the
+  // window
+  bool
+  addValue(TimeType now, const ValueType& val) {
+    const int64_t index = now.count() / samplePeriod_.count();
+    if (not hasLatest_) {
+      latestIndex_ = index;
+      hasLatest_ = true;
+    } else if (index > latestIndex_) {
+      // expire buckets which fall out of the window, at most all of them
+      const int64_t numExpired =
+          std::min<int64_t>(index - latestIndex_, NumBuckets);
+      for (int64_t i = 1; i <= numExpired; ++i) {
+        clearBucket(getBucket(index - numExpired + i));
+      }
+      latestIndex_ = index;
+    } else if (index <= latestIndex_ - static_cast<int64_t>(NumBuckets)) {
+      return false;
+    }
+
+    auto& bucket = getBucket(index);
+    if (bucket.index != index) {
+      clearBucket(bucket);
+      bucket.index = index;
+    }
+    bucket.sum += val;
+    ++bucket.count;
+    sum_ += val;
+    ++count_;
+    return true;
+  }
+
+  double
+  avg() const {
+    return count_ ? static_cast<double>(sum_) / count_ : 0.0;
+  }
+
+  uint64_t
+  count() const {
+    return count_;
+  }
+
+ private:
+  struct Bucket {
+    int64_t index{-1};
+    ValueType sum{0};
+    uint64_t count{0};
+  };
+
+  Bucket&
+  getBucket(int64_t index) {
+    // time, hence index, may be negative
+    const int64_t n = static_cast<int64_t>(NumBuckets);
+    return buckets_[((index % n) + n) % n];
+  }
+
+  void
+  clearBucket(Bucket& bucket) {
+    sum_ -= bucket.sum;
+    count_ -= bucket.count;
+    bucket = Bucket{};
+  }
+
+  const TimeType samplePeriod_;
+  std::array<Bucket, NumBuckets> buckets_{};
+  int64_t latestIndex_{0};
+  bool hasLatest_{false};
+  ValueType sum_{0};
+  uint64_t count_{0};
+};
+
 /*
  * This class detects abrupt changes, i.e., steps, in the mean level of a time
  * series or signal. Often, the step is small and the time series is corrupted
@@ -34,16 +119,20 @@ namespace openr {
  * Notes: we assume the underlying time series is stable for longer than slow
  * sliding window between steps.
  */
-template <typename ValueType, typename TimeType>
+template <
+    typename ValueType,
+    typename TimeType,
+    // fast sliding window size
+    size_t FastWndSize,
+    // slow sliding window size
+    size_t SlowWndSize>
 class StepDetector {
+  static_assert(FastWndSize < SlowWndSize, "Fast window must be smaller");
+
  public:
   StepDetector(
       // interval time series is sampled
       TimeType samplePeriod,
-      // fast sliding window size
-      size_t fastWndSize,
-      // slow sliding window size
-      size_t slowWndSize,
       // relative lower threshold, in percentage
       uint8_t loThreshold,
       // relative upper threshold, in percertage
@@ -52,15 +141,13 @@ class StepDetector {
       ValueType absThreshold,
       // callback when step is detected
       std::function<void(const ValueType&)> stepCb)
-      : slowWndSize_(slowWndSize),
-        fastSlideWindow_(fastWndSize, samplePeriod * fastWndSize),
-        slowSlideWindow_(slowWndSize, samplePeriod * slowWndSize),
+      : fastSlideWindow_(samplePeriod),
+        slowSlideWindow_(samplePeriod),
         loThreshold_(loThreshold),
         hiThreshold_(hiThreshold),
         absThreshold_(absThreshold),
         stepCb_(std::move(stepCb)) {
     CHECK_LT(loThreshold, hiThreshold);
-    CHECK_LT(fastWndSize, slowWndSize);
   }
 
   // add the value 'val' at time 'now' to both fast and slow sliding window
@@ -73,7 +160,7 @@ class StepDetector {
     auto slowAvg = slowSlideWindow_.avg();
 
     // init last average if not initialized and we gather enough samples
-    if (!lastAvgInit_ && slowSlideWindow_.count() >= slowWndSize_ / 2) {
+    if (!lastAvgInit_ && slowSlideWindow_.count() >= SlowWndSize / 2) {
       lastAvg_ = slowAvg;
       lastAvgInit_ = true;
     }
@@ -126,16 +213,11 @@ class StepDetector {
   StepDetector(StepDetector const&) = delete;
   StepDetector& operator=(StepDetector const&) = delete;
 
-  // slow sliding window size
-  size_t slowWndSize_{0};
-
   // fast sliding window
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      fastSlideWindow_;
+  SlidingWindow<ValueType, TimeType, FastWndSize> fastSlideWindow_;
 
-  // slow sliding window size
-  folly::BucketedTimeSeries<ValueType, folly::LegacyStatsClock<TimeType>>
-      slowSlideWindow_;
+  // slow sliding window
+  SlidingWindow<ValueType, TimeType, SlowWndSize> slowSlideWindow_;
 
   // lower threshold, in percentage
   const uint8_t loThreshold_{0};
@@ -10,17 +10,52 @@
 #include <ifaddrs.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+
+#include <folly/Conv.h>
+#include <folly/compression/Compression.h>
+#include <folly/hash/Hash.h>
+#include <folly/hash/SpookyHashV2.h>
+
 namespace openr {
 
-// create RE2 set for the list of key prefixes
+// create trie or RE2 set for the list of key prefixes
 KeyPrefix::KeyPrefix(std::vector<std::string> const& keyPrefixList) {
   if (keyPrefixList.empty()) {
     return;
   }
+
+  if (std::all_of(keyPrefixList.begin(), keyPrefixList.end(), isLiteral)) {
+    trie_.emplace_back();
+    for (auto const& keyPrefix : keyPrefixList) {
+      uint32_t node{0};
+      for (const char c : keyPrefix) {
+        auto& children = trie_[node].children;
+        auto it = std::find_if(
+            children.begin(), children.end(), [c](const auto& child) {
+              return child.first == c;
+            });
+        if (it != children.end()) {
+          node = it->second;
+          continue;
+        }
+        const uint32_t child = trie_.size();
+        children.emplace_back(c, child);
+        trie_.emplace_back();
+        node = child;
+      }
+      trie_[node].isPrefix = true;
+    }
+    return;
+  }
+
   re2::RE2::Options re2Options;
   re2Options.set_case_sensitive(true);
   keyPrefix_ =
@@ -43,11 +78,35 @@ KeyPrefix::KeyPrefix(std::vector<std::string> const& keyPrefixList) {
 // match the key with the list of prefixes
 bool
 KeyPrefix::keyMatch(std::string const& key) const {
-  if (!keyPrefix_) {
+  if (keyPrefix_) {
+    std::vector<int> matches;
+    return keyPrefix_->Match(key, &matches);
+  }
+  if (trie_.empty()) {
     return true;
   }
-  std::vector<int> matches;
-  return keyPrefix_->Match(key, &matches);
+
+  // walk down the trie until a prefix ends or key leaves it
+  const TrieNode* node = &trie_.front();
+  for (const char c : key) {
+    if (node->isPrefix) {
+      return true;
+    }
+    auto it = std::find_if(
+        node->children.begin(),
+        node->children.end(),
+        [c](const auto& child) { return child.first == c; });
+    if (it == node->children.end()) {
+      return false;
+    }
+    node = &trie_[it->second];
+  }
+  return node->isPrefix;
+}
+
+bool
+KeyPrefix::isLiteral(std::string const& keyPrefix) {
+  return keyPrefix.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
 }
 
 PrefixKey::PrefixKey(
@@ -109,6 +168,76 @@ PrefixKey::getIpPrefix() const {
   return toIpPrefix(prefix_);
 }
 
+PrefixShardKey::PrefixShardKey(std::string const& node, int32_t shard)
+    : node_(node),
+      shard_(shard),
+      prefixShardKeyString_(folly::sformat(
+          "{}{}:{}", Constants::kPrefixDbMarker.toString(), node_, shard_)) {}
+
+folly::Expected<PrefixShardKey, std::string>
+PrefixShardKey::fromStr(const std::string& key) {
+  int32_t shard{0};
+  std::string node{};
+  if (!RE2::FullMatch(key, getPrefixShardRE2(), &node, &shard)) {
+    return folly::makeUnexpected(std::string("Invalid key format"));
+  }
+  return PrefixShardKey(node, shard);
+}
+
+int32_t
+PrefixShardKey::getShardOfPrefix(
+    thrift::IpPrefix const& prefix, int32_t numShards) {
+  CHECK_GT(numShards, 0);
+  // std::hash may change with the binary, while prefixes must stay in the
+  // same shard across restarts
+  const auto& addr = prefix.prefixAddress.addr;
+  const auto hash = folly::hash::fnv32_buf(
+      &prefix.prefixLength,
+      sizeof(prefix.prefixLength),
+      folly::hash::fnv32_buf(addr.data(), addr.size()));
+  return hash % numShards;
+}
+
+std::string
+PrefixShardKey::getNodeName() const {
+  return node_;
+}
+
+int32_t
+PrefixShardKey::getShard() const {
+  return shard_;
+}
+
+std::string
+PrefixShardKey::getPrefixShardKey() const {
+  return prefixShardKeyString_;
+}
+
+bool
+KeyValueHashCache::update(std::string const& key, std::string const& value) {
+  auto entry = std::make_pair(value.size(), std::hash<std::string>{}(value));
+  auto it = hashes_.find(key);
+  if (it == hashes_.end()) {
+    hashes_.emplace(key, entry);
+    return true;
+  }
+  if (it->second == entry) {
+    return false;
+  }
+  it->second = entry;
+  return true;
+}
+
+void
+KeyValueHashCache::erase(std::string const& key) {
+  hashes_.erase(key);
+}
+
+size_t
+KeyValueHashCache::size() const {
+  return hashes_.size();
+}
+
 int
 executeShellCommand(const std::string& command) {
   int ret = system(command.c_str());
@@ -453,13 +582,64 @@ generateHash(
     const int64_t version,
     const std::string& originatorId,
     const folly::Optional<std::string>& value) {
-  size_t seed = 0;
-  boost::hash_combine(seed, version);
-  boost::hash_combine(seed, originatorId);
+  // 128-bit SpookyHash over all attributes folded into 64 bits. Lengths are
+  // hashed as well so that attribute boundaries can't be shifted
+  folly::hash::SpookyHashV2 hasher;
+  hasher.Init(0, 0);
+  hasher.Update(&version, sizeof(version));
+  const uint64_t originatorIdLen = originatorId.size();
+  hasher.Update(&originatorIdLen, sizeof(originatorIdLen));
+  hasher.Update(originatorId.data(), originatorIdLen);
   if (value.hasValue()) {
-    boost::hash_combine(seed, value.value());
+    const uint64_t valueLen = value->size();
+    hasher.Update(&valueLen, sizeof(valueLen));
+    hasher.Update(value->data(), valueLen);
+  }
+  uint64_t hash1{0};
+  uint64_t hash2{0};
+  hasher.Final(&hash1, &hash2);
+  return static_cast<int64_t>(folly::hash::hash_128_to_64(hash1, hash2));
+}
+
+namespace {
+
+// zstd frame magic number 0xFD2FB528, little-endian
+constexpr folly::StringPiece kZstdMagic{"\x28\xB5\x2F\xFD"};
+
+folly::io::Codec&
+getZstdCodec() {
+  // codecs hold compression context and are not thread safe
+  static thread_local auto codec =
+      folly::io::getCodec(folly::io::CodecType::ZSTD);
+  return *codec;
+}
+
+} // namespace
+
+folly::Optional<std::string>
+compressValue(folly::StringPiece value) {
+  if (value.size() < Constants::kKvStoreCompressMinValueSize) {
+    return folly::none;
+  }
+  auto compressed = getZstdCodec().compress(value);
+  if (compressed.size() >= value.size()) {
+    return folly::none;
+  }
+  DCHECK(isCompressedValue(compressed));
+  return compressed;
+}
+
+bool
+isCompressedValue(folly::StringPiece value) {
+  return value.startsWith(kZstdMagic);
+}
+
+std::string
+decompressValue(folly::StringPiece value) {
+  if (not isCompressedValue(value)) {
+    return value.str();
   }
-  return static_cast<int64_t>(seed);
+  return getZstdCodec().uncompress(value);
 }
 
 std::string
@@ -538,75 +718,181 @@ createDeprecatedNexthops(const std::vector<thrift::NextHopThrift>& nextHops) {
   return deprecatedNexthops;
 }
 
+namespace {
+
+/**
+ * Routes ordered by key. Route databases are usually built sorted, then this
+ * is a single check and no sort
+ */
+template <typename Route, typename GetKey>
+std::vector<const Route*>
+sortRoutesByKey(const std::vector<Route>& routes, GetKey getKey) {
+  std::vector<const Route*> sortedRoutes;
+  sortedRoutes.reserve(routes.size());
+  for (const auto& route : routes) {
+    sortedRoutes.emplace_back(&route);
+  }
+  auto keyLess = [&getKey](const Route* lhs, const Route* rhs) {
+    return getKey(*lhs) < getKey(*rhs);
+  };
+  if (not std::is_sorted(sortedRoutes.begin(), sortedRoutes.end(), keyLess)) {
+    std::sort(sortedRoutes.begin(), sortedRoutes.end(), keyLess);
+  }
+  return sortedRoutes;
+}
+
+/**
+ * Merge new and old routes in one pass over both, in key order. Routes of
+ * the same key are compared by next-hops first, as this is what changes in
+ * most of them
+ */
+template <typename Route, typename Key, typename GetKey>
+void
+mergeDeltaRoutes(
+    const std::vector<Route>& newRoutes,
+    const std::vector<Route>& oldRoutes,
+    GetKey getKey,
+    std::vector<Route>& routesToUpdate,
+    std::vector<Key>& routesToDelete) {
+  const auto sortedNewRoutes = sortRoutesByKey(newRoutes, getKey);
+  const auto sortedOldRoutes = sortRoutesByKey(oldRoutes, getKey);
+
+  auto newIt = sortedNewRoutes.begin();
+  auto oldIt = sortedOldRoutes.begin();
+  while (newIt != sortedNewRoutes.end() or oldIt != sortedOldRoutes.end()) {
+    if (oldIt == sortedOldRoutes.end() or
+        (newIt != sortedNewRoutes.end() and
+         getKey(**newIt) < getKey(**oldIt))) {
+      routesToUpdate.emplace_back(**newIt);
+      ++newIt;
+    } else if (
+        newIt == sortedNewRoutes.end() or getKey(**oldIt) < getKey(**newIt)) {
+      routesToDelete.emplace_back(getKey(**oldIt));
+      ++oldIt;
+    } else {
+      if ((*newIt)->nextHops != (*oldIt)->nextHops or **newIt != **oldIt) {
+        routesToUpdate.emplace_back(**newIt);
+      }
+      ++newIt;
+      ++oldIt;
+    }
+  }
+}
+
+} // namespace
+
 thrift::RouteDatabaseDelta
 findDeltaRoutes(
     const thrift::RouteDatabase& newRouteDb,
     const thrift::RouteDatabase& oldRouteDb) {
   DCHECK(newRouteDb.thisNodeName == oldRouteDb.thisNodeName);
 
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = newRouteDb.thisNodeName;
+
   // Find unicast routes to be added/updated or removed
-  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
-  std::set_difference(
-      newRouteDb.unicastRoutes.begin(),
-      newRouteDb.unicastRoutes.end(),
-      oldRouteDb.unicastRoutes.begin(),
-      oldRouteDb.unicastRoutes.end(),
-      std::inserter(unicastRoutesToUpdate, unicastRoutesToUpdate.begin()));
-  std::vector<thrift::UnicastRoute> unicastRoutesToDelete;
-  std::set_difference(
-      oldRouteDb.unicastRoutes.begin(),
-      oldRouteDb.unicastRoutes.end(),
-      newRouteDb.unicastRoutes.begin(),
-      newRouteDb.unicastRoutes.end(),
-      std::inserter(unicastRoutesToDelete, unicastRoutesToDelete.begin()));
+  mergeDeltaRoutes(
+      newRouteDb.unicastRoutes,
+      oldRouteDb.unicastRoutes,
+      [](const thrift::UnicastRoute& route) -> const thrift::IpPrefix& {
+        return route.dest;
+      },
+      routeDbDelta.unicastRoutesToUpdate,
+      routeDbDelta.unicastRoutesToDelete);
 
   // Find mpls routes to be added/updated or removed
-  std::vector<thrift::MplsRoute> mplsRoutesToUpdate;
-  std::set_difference(
-      newRouteDb.mplsRoutes.begin(),
-      newRouteDb.mplsRoutes.end(),
-      oldRouteDb.mplsRoutes.begin(),
-      oldRouteDb.mplsRoutes.end(),
-      std::inserter(mplsRoutesToUpdate, mplsRoutesToUpdate.begin()));
-  std::vector<thrift::MplsRoute> mplsRoutesToDelete;
-  std::set_difference(
-      oldRouteDb.mplsRoutes.begin(),
-      oldRouteDb.mplsRoutes.end(),
-      newRouteDb.mplsRoutes.begin(),
-      newRouteDb.mplsRoutes.end(),
-      std::inserter(mplsRoutesToDelete, mplsRoutesToDelete.begin()));
-
-  // Find entry of prefix to be removed
-  std::set<thrift::IpPrefix> prefixesToRemove;
-  for (const auto& route : unicastRoutesToDelete) {
-    prefixesToRemove.emplace(route.dest);
-  }
-  for (const auto& route : unicastRoutesToUpdate) {
-    prefixesToRemove.erase(route.dest);
-  }
-
-  // Find labels to be removed
-  std::set<int32_t> labelsToRemove;
-  for (const auto& route : mplsRoutesToDelete) {
-    labelsToRemove.emplace(route.topLabel);
-  }
-  for (const auto& route : mplsRoutesToUpdate) {
-    labelsToRemove.erase(route.topLabel);
-  }
-
-  // Build routes to be programmed.
+  mergeDeltaRoutes(
+      newRouteDb.mplsRoutes,
+      oldRouteDb.mplsRoutes,
+      [](const thrift::MplsRoute& route) { return route.topLabel; },
+      routeDbDelta.mplsRoutesToUpdate,
+      routeDbDelta.mplsRoutesToDelete);
+
+  return routeDbDelta;
+}
+
+thrift::RouteDatabaseDelta
+findDeltaRoutes(
+    const thrift::RouteDatabase& newRouteDb,
+    const RouteDatabaseMap& oldRouteDb) {
+  DCHECK(newRouteDb.thisNodeName == oldRouteDb.thisNodeName);
+
   thrift::RouteDatabaseDelta routeDbDelta;
   routeDbDelta.thisNodeName = newRouteDb.thisNodeName;
-  routeDbDelta.unicastRoutesToUpdate = std::move(unicastRoutesToUpdate);
-  routeDbDelta.unicastRoutesToDelete = {prefixesToRemove.begin(),
-                                        prefixesToRemove.end()};
-  routeDbDelta.mplsRoutesToUpdate = std::move(mplsRoutesToUpdate);
-  routeDbDelta.mplsRoutesToDelete = {labelsToRemove.begin(),
-                                     labelsToRemove.end()};
+
+  // Find unicast routes to be added/updated or removed
+  std::unordered_set<thrift::IpPrefix> newPrefixes;
+  for (const auto& route : newRouteDb.unicastRoutes) {
+    newPrefixes.emplace(route.dest);
+    auto it = oldRouteDb.unicastRoutes.find(route.dest);
+    if (it == oldRouteDb.unicastRoutes.end() or it->second != route) {
+      routeDbDelta.unicastRoutesToUpdate.emplace_back(route);
+    }
+  }
+  for (const auto& kv : oldRouteDb.unicastRoutes) {
+    if (not newPrefixes.count(kv.first)) {
+      routeDbDelta.unicastRoutesToDelete.emplace_back(kv.first);
+    }
+  }
+
+  // Find mpls routes to be added/updated or removed
+  std::unordered_set<uint32_t> newLabels;
+  for (const auto& route : newRouteDb.mplsRoutes) {
+    newLabels.emplace(route.topLabel);
+    auto it = oldRouteDb.mplsRoutes.find(route.topLabel);
+    if (it == oldRouteDb.mplsRoutes.end() or it->second != route) {
+      routeDbDelta.mplsRoutesToUpdate.emplace_back(route);
+    }
+  }
+  for (const auto& kv : oldRouteDb.mplsRoutes) {
+    if (not newLabels.count(kv.first)) {
+      routeDbDelta.mplsRoutesToDelete.emplace_back(kv.first);
+    }
+  }
 
   return routeDbDelta;
 }
 
+size_t
+compressNextHopGroups(thrift::RouteDatabaseDelta& routeDbDelta) {
+  std::map<std::vector<thrift::NextHopThrift>, int64_t> groupIds;
+  for (auto& route : routeDbDelta.unicastRoutesToUpdate) {
+    if (route.nextHops.empty() or route.nextHopGroupId.hasValue()) {
+      continue;
+    }
+    auto it = groupIds.find(route.nextHops);
+    if (it == groupIds.end()) {
+      const int64_t groupId = groupIds.size();
+      it = groupIds.emplace(route.nextHops, groupId).first;
+      routeDbDelta.nextHopGroups.emplace(groupId, std::move(route.nextHops));
+    }
+    route.nextHops.clear();
+    route.nextHopGroupId = it->second;
+  }
+  return groupIds.size();
+}
+
+bool
+expandNextHopGroups(thrift::RouteDatabaseDelta& routeDbDelta) {
+  bool success = true;
+  for (auto& route : routeDbDelta.unicastRoutesToUpdate) {
+    if (not route.nextHopGroupId.hasValue()) {
+      continue;
+    }
+    auto it = routeDbDelta.nextHopGroups.find(route.nextHopGroupId.value());
+    if (it == routeDbDelta.nextHopGroups.end()) {
+      LOG(ERROR) << "Unknown next-hop group " << route.nextHopGroupId.value()
+                 << " for route " << toString(route.dest);
+      success = false;
+      continue;
+    }
+    route.nextHops = it->second;
+    route.nextHopGroupId.clear();
+  }
+  routeDbDelta.nextHopGroups.clear();
+  return success;
+}
+
 thrift::BuildInfo
 getBuildInfoThrift() noexcept {
   return thrift::BuildInfo(
@@ -649,4 +935,112 @@ getPrefixForwardingType(
   return thrift::PrefixForwardingType::SR_MPLS;
 }
 
+std::unordered_map<std::string, ThreadSchedConfig>
+parseThreadSchedConfigs(
+    const std::string& cpuAffinity, const std::string& schedPolicy) {
+  std::unordered_map<std::string, ThreadSchedConfig> configs;
+  std::vector<std::string> entries;
+
+  folly::split(";", cpuAffinity, entries, true /* ignore empty */);
+  for (auto const& entry : entries) {
+    std::string name, cpuList;
+    if (not folly::split('=', entry, name, cpuList) or cpuList.empty()) {
+      throw std::invalid_argument(
+          folly::sformat("Invalid cpu affinity '{}'", entry));
+    }
+    std::vector<std::string> ranges;
+    folly::split(",", cpuList, ranges, true /* ignore empty */);
+    auto& cpus = configs[name].cpus;
+    for (auto const& range : ranges) {
+      std::string first, last;
+      const auto hasLast = folly::split('-', range, first, last);
+      const auto firstCpu = folly::tryTo<int>(hasLast ? first : range);
+      const auto lastCpu = hasLast ? folly::tryTo<int>(last) : firstCpu;
+      if (not firstCpu or not lastCpu or *firstCpu < 0 or
+          *firstCpu > *lastCpu or *lastCpu >= CPU_SETSIZE) {
+        throw std::invalid_argument(
+            folly::sformat("Invalid cpus '{}' of {}", range, name));
+      }
+      for (auto cpu = *firstCpu; cpu <= *lastCpu; ++cpu) {
+        cpus.emplace_back(cpu);
+      }
+    }
+  }
+
+  const std::unordered_map<std::string, int> policies{
+      {"other", SCHED_OTHER},
+      {"batch", SCHED_BATCH},
+      {"idle", SCHED_IDLE},
+      {"fifo", SCHED_FIFO},
+      {"rr", SCHED_RR},
+  };
+  entries.clear();
+  folly::split(";", schedPolicy, entries, true /* ignore empty */);
+  for (auto const& entry : entries) {
+    std::string name, policy;
+    if (not folly::split('=', entry, name, policy)) {
+      throw std::invalid_argument(
+          folly::sformat("Invalid scheduling policy '{}'", entry));
+    }
+    std::string policyName, priority;
+    if (not folly::split(':', policy, policyName, priority)) {
+      policyName = policy;
+    }
+    auto it = policies.find(policyName);
+    const auto maybePriority =
+        priority.empty() ? folly::makeExpected<folly::ConversionCode>(0)
+                         : folly::tryTo<int>(priority);
+    if (it == policies.end() or not maybePriority or
+        *maybePriority < sched_get_priority_min(it->second) or
+        *maybePriority > sched_get_priority_max(it->second)) {
+      throw std::invalid_argument(
+          folly::sformat("Invalid scheduling policy '{}' of {}", policy, name));
+    }
+    auto& config = configs[name];
+    config.policy = it->second;
+    config.priority = *maybePriority;
+  }
+  return configs;
+}
+
+bool
+applyThreadSchedConfig(const ThreadSchedConfig& config) noexcept {
+  bool success = true;
+  if (not config.cpus.empty()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto const cpu : config.cpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    const auto ret =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0) {
+      LOG(ERROR) << "Failed to set cpu affinity: " << folly::errnoStr(ret);
+      success = false;
+    }
+  }
+  if (config.policy) {
+    struct sched_param param {};
+    param.sched_priority = config.priority;
+    const auto ret =
+        pthread_setschedparam(pthread_self(), *config.policy, &param);
+    if (ret != 0) {
+      LOG(ERROR) << "Failed to set scheduling policy " << *config.policy
+                 << ": " << folly::errnoStr(ret);
+      success = false;
+    }
+  }
+  return success;
+}
+
+std::chrono::milliseconds
+getThreadCpuTime() noexcept {
+  struct timespec ts {};
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec));
+}
+
 } // namespace openr
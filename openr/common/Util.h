@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/functional/hash.hpp>
@@ -42,15 +44,30 @@ struct RouteDatabaseMap {
 };
 
 /**
- * Class to store re2 objects, provides API to match string with regex
+ * Class to store re2 objects, provides API to match string with regex.
+ * Literal prefixes, the common case, are matched with a trie instead
  */
 class KeyPrefix {
  public:
   explicit KeyPrefix(std::vector<std::string> const& keyPrefixList);
   bool keyMatch(std::string const& key) const;
 
+  // true if keyPrefix has no regex metacharacters, i.e. matches literally
+  static bool isLiteral(std::string const& keyPrefix);
+
  private:
+  struct TrieNode {
+    // next character of prefixes and index of its node
+    std::vector<std::pair<char, uint32_t>> children;
+    // a prefix ends at this node
+    bool isPrefix{false};
+  };
+
+  // set if any prefix is a regex
   std::unique_ptr<re2::RE2::Set> keyPrefix_;
+
+  // trie of literal prefixes, rooted at first node
+  std::vector<TrieNode> trie_;
 };
 
 /**
@@ -110,6 +127,73 @@ class PrefixKey {
   std::string prefixKeyString_;
 };
 
+/**
+ * PrefixShardKey class to form and parse key of a prefix shard, i.e.
+ * `prefix:<node>:<shard>`. Node advertising prefix shards hashes each of its
+ * prefixes into one of fixed number of shards, and advertises prefix database
+ * of each shard under its own key.
+ */
+class PrefixShardKey {
+ public:
+  PrefixShardKey(std::string const& node, int32_t shard);
+
+  // construct PrefixShardKey object from a give key string
+  static folly::Expected<PrefixShardKey, std::string> fromStr(
+      const std::string& key);
+
+  // shard of prefix out of numShards, stable across restarts
+  static int32_t getShardOfPrefix(
+      thrift::IpPrefix const& prefix, int32_t numShards);
+
+  // return node name
+  std::string getNodeName() const;
+
+  // return shard
+  int32_t getShard() const;
+
+  // return prefix shard key string to be used to flood to kvstore
+  std::string getPrefixShardKey() const;
+
+  static const RE2&
+  getPrefixShardRE2() {
+    static const RE2 prefixShardKeyPattern{folly::sformat(
+        "{}(?P<node>[a-zA-Z\\d\\.\\-\\_]+):"
+        "(?P<shard>[\\d]{{1,5}})",
+        Constants::kPrefixDbMarker.toString())};
+    return prefixShardKeyPattern;
+  }
+
+ private:
+  // node name
+  std::string node_{};
+
+  // shard
+  int32_t shard_{0};
+
+  // prefix shard key string
+  std::string prefixShardKeyString_;
+};
+
+/**
+ * Hashes of key-values last processed by a KvStore subscriber, to tell values
+ * re-advertised unchanged, e.g. under a new version, from changed ones before
+ * deserializing them
+ */
+class KeyValueHashCache {
+ public:
+  // Record value of key, returns false if it is the one recorded already
+  bool update(std::string const& key, std::string const& value);
+
+  // Forget key, e.g. once it expires
+  void erase(std::string const& key);
+
+  size_t size() const;
+
+ private:
+  // size and hash of values
+  std::unordered_map<std::string, std::pair<size_t, size_t>> hashes_;
+};
+
 /**
  * Utility function to execute shell command and return true/false as
  * indication of it's success
@@ -211,13 +295,41 @@ getDurationBetweenPerfEvents(
 
 /**
  * Generate hash for each keyval pair
- * as a abstract of version number, originator and values
+ * as a abstract of version number, originator and values.
+ * Uses 128-bit SpookyHash, folded into 64 bits
  */
 int64_t generateHash(
     const int64_t version,
     const std::string& originatorId,
     const folly::Optional<std::string>& value);
 
+/**
+ * Opt-in zstd compression of large KvStore values. Compressed values are
+ * recognized by the zstd frame magic number they start with, which neither
+ * serialized thrift objects nor plain values in KvStore start with.
+ * Returns none if value is too small or doesn't get any smaller
+ */
+folly::Optional<std::string> compressValue(folly::StringPiece value);
+
+bool isCompressedValue(folly::StringPiece value);
+
+// Returns value as is if it isn't compressed, throws on corrupt data
+std::string decompressValue(folly::StringPiece value);
+
+/**
+ * Deserialize thrift object from KvStore value, decompressing it first if
+ * it's compressed
+ */
+template <typename ThriftType, typename Serializer>
+ThriftType
+readThriftValue(std::string const& value, Serializer& serializer) {
+  if (isCompressedValue(value)) {
+    return fbzmq::util::readThriftObjStr<ThriftType>(
+        decompressValue(value), serializer);
+  }
+  return fbzmq::util::readThriftObjStr<ThriftType>(value, serializer);
+}
+
 /**
  * TO BE DEPRECATED SOON: Backward compatible with empty remoteIfName
  * Translate remote interface name from local interface name
@@ -248,17 +360,64 @@ std::vector<thrift::BinaryAddress> createDeprecatedNexthops(
     std::vector<thrift::NextHopThrift> const& nextHops);
 
 /**
- * Find delta between two route databases
+ * Find delta between two route databases, in one merge of routes ordered by
+ * key. Routes don't need to be sorted, sorted ones are merged without a sort.
+ * Routes to update and delete come out in key order
  */
 thrift::RouteDatabaseDelta findDeltaRoutes(
     const thrift::RouteDatabase& newRouteDb,
     const thrift::RouteDatabase& oldRouteDb);
 
+/**
+ * Find delta between new route database and a route database map
+ */
+thrift::RouteDatabaseDelta findDeltaRoutes(
+    const thrift::RouteDatabase& newRouteDb,
+    const RouteDatabaseMap& oldRouteDb);
+
+/**
+ * Replace nextHops of unicast routes to update with ids of unique next-hop
+ * groups, stored once in nextHopGroups of the delta. Routes sharing the same
+ * ECMP group are then encoded only once on the wire. Returns number of groups
+ */
+size_t compressNextHopGroups(thrift::RouteDatabaseDelta& routeDbDelta);
+
+/**
+ * Reverse of compressNextHopGroups. Fills nextHops of every unicast route
+ * from nextHopGroups and clears the group table. Returns false if a route
+ * refers to an unknown group
+ */
+bool expandNextHopGroups(thrift::RouteDatabaseDelta& routeDbDelta);
+
 thrift::BuildInfo getBuildInfoThrift() noexcept;
 
 folly::Optional<std::string> maybeGetTcpEndpoint(
     const std::string& addr, const int32_t port);
 
+// CPU placement and scheduling of a module thread
+struct ThreadSchedConfig {
+  // CPUs the thread may run on, any if empty
+  std::vector<int> cpus;
+  // scheduling policy (SCHED_*) and its priority, inherited if none
+  folly::Optional<int> policy;
+  int priority{0};
+};
+
+/**
+ * Parse thread configs keyed by module name from `cpuAffinity` formatted as
+ * "<module>=<cpus>;..." with cpus like "1,3-4", and from `schedPolicy`
+ * formatted as "<module>=<other|batch|idle|fifo|rr>[:<priority>];...".
+ * Throws std::invalid_argument on malformed input.
+ */
+std::unordered_map<std::string, ThreadSchedConfig> parseThreadSchedConfigs(
+    const std::string& cpuAffinity, const std::string& schedPolicy);
+
+// Apply config to the calling thread. Returns false on failure
+bool applyThreadSchedConfig(const ThreadSchedConfig& config) noexcept;
+
+// CPU time consumed so far by the calling thread
+std::chrono::milliseconds getThreadCpuTime() noexcept;
+
 /**
  * Get forwarding type from list of prefixes. We're taking map as input for
  * efficiency purpose.
@@ -416,10 +575,10 @@ createNextHop(
     folly::Optional<thrift::MplsAction> maybeMplsAction = folly::none,
     bool useNonShortestRoute = false) {
   thrift::NextHopThrift nextHop;
-  nextHop.address = addr;
+  nextHop.address = std::move(addr);
   nextHop.address.ifName = ifName;
   nextHop.metric = metric;
-  nextHop.mplsAction = maybeMplsAction;
+  nextHop.mplsAction = std::move(maybeMplsAction);
   nextHop.useNonShortestRoute = useNonShortestRoute;
   return nextHop;
 }
@@ -442,7 +601,10 @@ createUnicastRoute(
     thrift::IpPrefix dest, std::vector<thrift::NextHopThrift> nextHops) {
   thrift::UnicastRoute unicastRoute;
   unicastRoute.dest = std::move(dest);
-  std::sort(nextHops.begin(), nextHops.end());
+  // nexthops are usually sorted already, e.g. when re-created by Fib
+  if (not std::is_sorted(nextHops.begin(), nextHops.end())) {
+    std::sort(nextHops.begin(), nextHops.end());
+  }
   unicastRoute.nextHops = std::move(nextHops);
   return unicastRoute;
 }
@@ -457,7 +619,9 @@ createMplsRoute(int32_t topLabel, std::vector<thrift::NextHopThrift> nextHops) {
 
   thrift::MplsRoute mplsRoute;
   mplsRoute.topLabel = topLabel;
-  std::sort(nextHops.begin(), nextHops.end());
+  if (not std::is_sorted(nextHops.begin(), nextHops.end())) {
+    std::sort(nextHops.begin(), nextHops.end());
+  }
   mplsRoute.nextHops = std::move(nextHops);
   return mplsRoute;
 }
@@ -467,6 +631,7 @@ createUnicastRoutesWithBestNexthops(
     const std::vector<thrift::UnicastRoute>& routes) {
   // Build routes to be programmed
   std::vector<thrift::UnicastRoute> newRoutes;
+  newRoutes.reserve(routes.size());
 
   for (auto const& route : routes) {
     auto newRoute =
@@ -483,6 +648,7 @@ inline std::vector<thrift::MplsRoute>
 createMplsRoutesWithBestNextHops(const std::vector<thrift::MplsRoute>& routes) {
   // Build routes to be programmed
   std::vector<thrift::MplsRoute> newRoutes;
+  newRoutes.reserve(routes.size());
 
   for (auto const& route : routes) {
     newRoutes.emplace_back(
@@ -528,8 +694,11 @@ inline std::string
 getNodeNameFromKey(const std::string& key) {
   std::string prefix, nodeName;
   auto prefixKey = PrefixKey::fromStr(key);
+  auto prefixShardKey = PrefixShardKey::fromStr(key);
   if (prefixKey.hasValue()) {
     nodeName = prefixKey.value().getNodeName();
+  } else if (prefixShardKey.hasValue()) {
+    nodeName = prefixShardKey.value().getNodeName();
   } else {
     folly::split(
         Constants::kPrefixNameSeparator.toString(), key, prefix, nodeName);
@@ -638,8 +807,10 @@ maybeUpdate(CompareResult& target, CompareResult update) {
   }
 }
 
+// same as compareMetricVectors for metric vectors already sorted by
+// sortMetricVector, e.g. on ingest. Neither checks nor modifies the vectors
 inline CompareResult
-compareMetricVectors(
+compareSortedMetricVectors(
     thrift::MetricVector const& l, thrift::MetricVector const& r) {
   CompareResult result = CompareResult::TIE;
 
@@ -647,9 +818,6 @@ compareMetricVectors(
     return CompareResult::ERROR;
   }
 
-  sortMetricVector(l);
-  sortMetricVector(r);
-
   auto lIter = l.metrics.begin();
   auto rIter = r.metrics.begin();
   while (!isDecisive(result) &&
@@ -686,6 +854,18 @@ compareMetricVectors(
   }
   return result;
 }
+
+inline CompareResult
+compareMetricVectors(
+    thrift::MetricVector const& l, thrift::MetricVector const& r) {
+  if (l.version != r.version) {
+    return CompareResult::ERROR;
+  }
+
+  sortMetricVector(l);
+  sortMetricVector(r);
+  return compareSortedMetricVectors(l, r);
+}
 } // namespace MetricVectorUtils
 
 } // namespace openr
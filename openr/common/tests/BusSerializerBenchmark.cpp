@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/BusSerializer.h>
+#include <openr/common/Util.h>
+#include <openr/if/gen-cpp2/Fib_types.h>
+
+namespace {
+
+using Protocol = openr::BusSerializer::Protocol;
+
+/**
+ * Route delta as published by Decision on a full build, one v6 route per
+ * prefix with two next-hops carrying an MPLS push action
+ */
+openr::thrift::RouteDatabaseDelta
+createRouteDelta(uint32_t numRoutes) {
+  openr::thrift::RouteDatabaseDelta routeDelta;
+  routeDelta.thisNodeName = "node-1";
+  routeDelta.unicastRoutesToUpdate.reserve(numRoutes);
+  for (uint32_t i = 0; i < numRoutes; ++i) {
+    std::vector<openr::thrift::NextHopThrift> nextHops;
+    for (uint32_t j = 1; j <= 2; ++j) {
+      nextHops.emplace_back(openr::createNextHop(
+          openr::toBinaryAddress(
+              folly::IPAddress(folly::sformat("fe80::{}", j))),
+          folly::sformat("iface{}", j),
+          10 /* metric */,
+          openr::createMplsAction(
+              openr::thrift::MplsActionCode::PUSH,
+              folly::none,
+              std::vector<int32_t>{static_cast<int32_t>(100000 + i)})));
+    }
+    routeDelta.unicastRoutesToUpdate.emplace_back(openr::createUnicastRoute(
+        openr::toIpPrefix(folly::sformat("fc00:{:x}::/64", i)),
+        std::move(nextHops)));
+  }
+  return routeDelta;
+}
+
+} // namespace
+
+static void
+BM_BusSerializerEncode(uint32_t iters, Protocol protocol, uint32_t numRoutes) {
+  auto suspender = folly::BenchmarkSuspender();
+  openr::BusSerializer serializer(protocol);
+  const auto routeDelta = createRouteDelta(numRoutes);
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto msg = serializer.toMessage(routeDelta);
+    folly::doNotOptimizeAway(msg);
+  }
+}
+
+static void
+BM_BusSerializerDecode(uint32_t iters, Protocol protocol, uint32_t numRoutes) {
+  auto suspender = folly::BenchmarkSuspender();
+  openr::BusSerializer serializer(protocol);
+  const auto msg = serializer.toMessage(createRouteDelta(numRoutes)).value();
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto routeDelta =
+        serializer.fromMessage<openr::thrift::RouteDatabaseDelta>(msg);
+    folly::doNotOptimizeAway(routeDelta);
+  }
+}
+
+// Parameters are protocol and number of routes
+BENCHMARK_NAMED_PARAM(
+    BM_BusSerializerEncode, compact_1000, Protocol::COMPACT, 1000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_BusSerializerEncode, binary_1000, Protocol::BINARY, 1000);
+BENCHMARK_NAMED_PARAM(
+    BM_BusSerializerEncode, compact_100000, Protocol::COMPACT, 100000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_BusSerializerEncode, binary_100000, Protocol::BINARY, 100000);
+BENCHMARK_NAMED_PARAM(
+    BM_BusSerializerDecode, compact_1000, Protocol::COMPACT, 1000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_BusSerializerDecode, binary_1000, Protocol::BINARY, 1000);
+BENCHMARK_NAMED_PARAM(
+    BM_BusSerializerDecode, compact_100000, Protocol::COMPACT, 100000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_BusSerializerDecode, binary_100000, Protocol::BINARY, 100000);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/ConvergenceCollector.h>
+
+using namespace openr;
+
+namespace {
+
+thrift::PerfEvent
+createPerfEvent(std::string nodeName, std::string eventDescr, int64_t unixTs) {
+  thrift::PerfEvent event;
+  event.nodeName = std::move(nodeName);
+  event.eventDescr = std::move(eventDescr);
+  event.unixTs = unixTs;
+  return event;
+}
+
+// Timeline of event originated on node-1 at originTs, as reported by nodeName
+thrift::PerfEvents
+createTimeline(
+    const std::string& nodeName,
+    int64_t originTs,
+    int64_t decisionTs,
+    int64_t programmedTs) {
+  thrift::PerfEvents perfEvents;
+  perfEvents.events = {
+      createPerfEvent("node-1", "ADJ_DB_UPDATED", originTs),
+      createPerfEvent(nodeName, "DECISION_RECEIVED", decisionTs),
+      createPerfEvent(nodeName, "OPENR_FIB_ROUTES_PROGRAMMED", programmedTs)};
+  return perfEvents;
+}
+
+} // namespace
+
+TEST(ConvergenceCollectorTest, JoinTimelines) {
+  ConvergenceCollector collector;
+
+  EXPECT_TRUE(collector.addPerfEvents(createTimeline("node-1", 100, 110, 130)));
+  EXPECT_TRUE(collector.addPerfEvents(createTimeline("node-2", 100, 150, 160)));
+  // Same timeline again, e.g. from snapshot and stream
+  EXPECT_FALSE(
+      collector.addPerfEvents(createTimeline("node-2", 100, 150, 160)));
+  // Malformed timelines
+  EXPECT_FALSE(collector.addPerfEvents(thrift::PerfEvents{}));
+  EXPECT_FALSE(collector.addPerfEvents(createTimeline("node-3", 100, 90, 90)));
+
+  ASSERT_EQ(1, collector.getNumEvents());
+  const auto event = collector.getEvents().front();
+  EXPECT_EQ("node-1", event.origin.nodeName);
+  EXPECT_EQ("ADJ_DB_UPDATED", event.origin.eventDescr);
+  EXPECT_EQ(2, event.nodeDurations.size());
+  EXPECT_EQ(std::chrono::milliseconds(30), event.nodeDurations.at("node-1"));
+  EXPECT_EQ(std::chrono::milliseconds(60), event.duration);
+  EXPECT_EQ("node-2", event.slowestNode);
+  EXPECT_EQ("node-2", event.slowestHop.nodeName);
+  EXPECT_EQ("ADJ_DB_UPDATED", event.slowestHop.fromEvent);
+  EXPECT_EQ("DECISION_RECEIVED", event.slowestHop.toEvent);
+  EXPECT_EQ(std::chrono::milliseconds(50), event.slowestHop.duration);
+}
+
+TEST(ConvergenceCollectorTest, Counters) {
+  ConvergenceCollector collector(3);
+  EXPECT_EQ(0, collector.getCounters().at("convergence.network_ms.count"));
+
+  // Oldest event is dropped once more than 3 events are kept
+  thrift::PerfDatabase perfDb;
+  for (int64_t i = 1; i <= 4; ++i) {
+    perfDb.eventInfo.emplace_back(
+        createTimeline("node-2", i * 1000, i * 1000, i * 1000 + i * 10));
+  }
+  EXPECT_EQ(4, collector.addPerfDb(perfDb));
+  EXPECT_EQ(3, collector.getNumEvents());
+  EXPECT_FALSE(
+      collector.addPerfEvents(createTimeline("node-3", 1000, 1000, 1010)));
+  EXPECT_EQ(2000, collector.getEvents().front().origin.unixTs);
+
+  auto counters = collector.getCounters();
+  EXPECT_EQ(3, counters.at("convergence.network_ms.count"));
+  EXPECT_EQ(30, counters.at("convergence.network_ms.p50"));
+  EXPECT_EQ(40, counters.at("convergence.network_ms.p90"));
+  EXPECT_EQ(40, counters.at("convergence.network_ms.p99"));
+  EXPECT_EQ(40, counters.at("convergence.network_ms.max"));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
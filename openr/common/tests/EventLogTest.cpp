@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/EventLog.h>
+
+using namespace openr;
+
+namespace {
+
+EventLogEntry
+createEntry(int index) {
+  return EventLogEntry("KEY_EXPIRE", "node1")
+      .addString("key", std::to_string(index));
+}
+
+std::string
+getKey(const EventLogEntry& entry) {
+  for (auto const& kv : entry.strings) {
+    if (kv.first == "key") {
+      return kv.second;
+    }
+  }
+  return "";
+}
+
+} // namespace
+
+TEST(EventLogRingTest, GetEntries) {
+  EventLogRing ring(4);
+  uint64_t lastSeqNum{0};
+  EXPECT_TRUE(ring.getEntries(0, &lastSeqNum).empty());
+  EXPECT_EQ(0, lastSeqNum);
+
+  for (int i = 1; i <= 3; ++i) {
+    ring.add(createEntry(i));
+  }
+  auto entries = ring.getEntries(0, &lastSeqNum);
+  ASSERT_EQ(3, entries.size());
+  EXPECT_EQ("1", getKey(entries.at(0)));
+  EXPECT_EQ("3", getKey(entries.at(2)));
+  EXPECT_EQ(3, lastSeqNum);
+
+  // only events after the last seen one
+  entries = ring.getEntries(2);
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ("3", getKey(entries.at(0)));
+  EXPECT_TRUE(ring.getEntries(3).empty());
+
+  // oldest events are overwritten once full
+  for (int i = 4; i <= 10; ++i) {
+    ring.add(createEntry(i));
+  }
+  entries = ring.getEntries(0, &lastSeqNum);
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("7", getKey(entries.at(0)));
+  EXPECT_EQ("10", getKey(entries.at(3)));
+  EXPECT_EQ(10, lastSeqNum);
+  entries = ring.getEntries(3);
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("7", getKey(entries.at(0)));
+}
+
+TEST(EventLogRingTest, ConcurrentAdd) {
+  const int kNumThreads = 4;
+  const int kNumEntriesPerThread = 1000;
+  EventLogRing ring(64);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&ring, i]() {
+      for (int j = 0; j < kNumEntriesPerThread; ++j) {
+        ring.add(createEntry(i * kNumEntriesPerThread + j));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  uint64_t lastSeqNum{0};
+  EXPECT_EQ(64, ring.getEntries(0, &lastSeqNum).size());
+  EXPECT_EQ(kNumThreads * kNumEntriesPerThread, lastSeqNum);
+}
+
+TEST(EventLogTest, ToEventLog) {
+  EventLogEntry entry("ROUTE_CONVERGENCE", "node1");
+  entry.addInt("duration_ms", 1234).addStringVector("perf_events", {"a"});
+
+  const auto eventLog = toEventLog({entry, createEntry(5)});
+  EXPECT_EQ(Constants::kEventLogCategory.toString(), eventLog.category);
+  ASSERT_EQ(2, eventLog.samples.size());
+  const auto& json = eventLog.samples.at(0);
+  EXPECT_NE(std::string::npos, json.find("ROUTE_CONVERGENCE"));
+  EXPECT_NE(std::string::npos, json.find("node1"));
+  EXPECT_NE(std::string::npos, json.find("duration_ms"));
+  EXPECT_NE(std::string::npos, json.find("1234"));
+  EXPECT_NE(std::string::npos, json.find("perf_events"));
+  EXPECT_NE(std::string::npos, eventLog.samples.at(1).find("KEY_EXPIRE"));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/OpenrEventLoop.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace {
+
+/**
+ * Module replying with the thrift::Value it is sent
+ */
+class EchoModule final : public openr::OpenrEventLoop {
+ public:
+  EchoModule(fbzmq::Context& context, bool preallocateReply)
+      : OpenrEventLoop(
+            "node-1", openr::thrift::OpenrModuleType::DECISION, context),
+        preallocateReply_(preallocateReply) {}
+
+ private:
+  folly::Expected<fbzmq::Message, fbzmq::Error>
+  processRequestMsg(fbzmq::Message&& request) override {
+    auto maybeValue = request.readThriftObj<openr::thrift::Value>(serializer_);
+    if (maybeValue.hasError()) {
+      return folly::makeUnexpected(maybeValue.error());
+    }
+    if (preallocateReply_) {
+      return toReplyMsg(maybeValue.value(), serializer_);
+    }
+    return fbzmq::Message::fromThriftObj(maybeValue.value(), serializer_);
+  }
+
+  const bool preallocateReply_{false};
+
+  apache::thrift::CompactSerializer serializer_;
+};
+
+} // namespace
+
+/**
+ * Round trip of requests carrying payloadSize bytes, echoed by a module over
+ * its inproc cmd socket
+ */
+static void
+BM_ModuleRequest(uint32_t iters, bool preallocateReply, size_t payloadSize) {
+  auto suspender = folly::BenchmarkSuspender();
+  fbzmq::Context context;
+  EchoModule module(context, preallocateReply);
+  std::thread moduleThread([&module]() { module.run(); });
+  module.waitUntilRunning();
+
+  apache::thrift::CompactSerializer serializer;
+  fbzmq::Socket<ZMQ_REQ, fbzmq::ZMQ_CLIENT> reqSock(context);
+  CHECK(reqSock.connect(fbzmq::SocketUrl{module.inprocCmdUrl}));
+  openr::thrift::Value request;
+  request.version = 1;
+  request.originatorId = "node-1";
+  request.value = std::string(payloadSize, 'x');
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    CHECK(reqSock.sendThriftObj(request, serializer));
+    auto reply = reqSock.recvThriftObj<openr::thrift::Value>(serializer);
+    CHECK(reply);
+  }
+
+  suspender.rehire();
+  module.stop();
+  moduleThread.join();
+}
+
+// Parameters are whether reply is preallocated and payload size in bytes
+BENCHMARK_NAMED_PARAM(BM_ModuleRequest, 100B, false, 100);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_ModuleRequest, 100B_prealloc, true, 100);
+BENCHMARK_NAMED_PARAM(BM_ModuleRequest, 1MB, false, 1024 * 1024);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_ModuleRequest, 1MB_prealloc, true, 1024 * 1024);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/PrefixTrie.h>
+
+using namespace openr;
+
+namespace {
+
+folly::CIDRNetwork
+toNetwork(const std::string& prefix) {
+  return folly::IPAddress::createNetwork(prefix, -1, false /* applyMask */);
+}
+
+} // namespace
+
+TEST(PrefixTrieTest, LongestMatch) {
+  PrefixTrie<int> trie;
+  EXPECT_TRUE(trie.insert(toNetwork("10.0.0.0/8"), 1));
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.0.0/16"), 2));
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.2.0/24"), 3));
+  EXPECT_TRUE(trie.insert(toNetwork("fc00::/7"), 4));
+  EXPECT_TRUE(trie.insert(toNetwork("fc00:1::/32"), 5));
+  // same prefix once masked, value is replaced
+  EXPECT_FALSE(trie.insert(toNetwork("10.1.1.1/16"), 6));
+  EXPECT_EQ(5, trie.size());
+
+  auto entry = trie.longestMatch(folly::IPAddress("10.1.2.3"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(toNetwork("10.1.2.0/24"), entry->first);
+  EXPECT_EQ(3, entry->second);
+
+  entry = trie.longestMatch(folly::IPAddress("10.1.3.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(toNetwork("10.1.0.0/16"), entry->first);
+  EXPECT_EQ(6, entry->second);
+
+  entry = trie.longestMatch(folly::IPAddress("fc00:1::1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(5, entry->second);
+  entry = trie.longestMatch(folly::IPAddress("fd00::1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(4, entry->second);
+
+  // families don't match each other
+  EXPECT_EQ(nullptr, trie.longestMatch(folly::IPAddress("11.0.0.1")));
+  EXPECT_EQ(nullptr, trie.longestMatch(folly::IPAddress("::ffff:10.1.2.3")));
+
+  // networks match prefixes containing them
+  entry = trie.longestMatch(toNetwork("10.1.2.0/23"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(6, entry->second);
+  EXPECT_EQ(nullptr, trie.longestMatch(toNetwork("10.0.0.0/7")));
+
+  ASSERT_NE(nullptr, trie.find(toNetwork("10.0.0.0/8")));
+  EXPECT_EQ(1, *trie.find(toNetwork("10.0.0.0/8")));
+  EXPECT_EQ(nullptr, trie.find(toNetwork("10.1.2.0/23")));
+}
+
+TEST(PrefixTrieTest, Erase) {
+  PrefixTrie<int> trie;
+  EXPECT_TRUE(trie.insert(toNetwork("10.0.0.0/8"), 1));
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.0.0/16"), 2));
+  EXPECT_TRUE(trie.insert(toNetwork("10.2.0.0/16"), 3));
+  EXPECT_TRUE(trie.insert(toNetwork("0.0.0.0/0"), 4));
+
+  // prefixes not in trie, including split nodes without value
+  EXPECT_FALSE(trie.erase(toNetwork("10.1.0.0/24")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.0.0.0/14")));
+  EXPECT_FALSE(trie.erase(toNetwork("::/0")));
+  EXPECT_EQ(4, trie.size());
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.1.0.0/16")));
+  EXPECT_FALSE(trie.erase(toNetwork("10.1.0.0/16")));
+  auto entry = trie.longestMatch(folly::IPAddress("10.1.0.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(1, entry->second);
+
+  EXPECT_TRUE(trie.erase(toNetwork("10.0.0.0/8")));
+  entry = trie.longestMatch(folly::IPAddress("10.2.0.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(3, entry->second);
+  entry = trie.longestMatch(folly::IPAddress("10.3.0.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(4, entry->second);
+
+  // erased nodes are reused
+  EXPECT_TRUE(trie.insert(toNetwork("10.1.0.0/16"), 5));
+  entry = trie.longestMatch(folly::IPAddress("10.1.0.1"));
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(5, entry->second);
+  EXPECT_EQ(3, trie.size());
+
+  trie.clear();
+  EXPECT_TRUE(trie.empty());
+  EXPECT_EQ(nullptr, trie.longestMatch(folly::IPAddress("10.1.0.1")));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
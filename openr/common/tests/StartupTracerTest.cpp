@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/StartupTracer.h>
+
+using namespace openr;
+
+TEST(StartupTracerTest, SpansAndMilestones) {
+  const auto start = StartupTracer::Clock::now();
+  StartupTracer tracer({"decision", "fib"}, start);
+
+  tracer.addSpan("kvstore", start + std::chrono::milliseconds(10));
+  tracer.addSpan("decision", start + std::chrono::milliseconds(15));
+  tracer.addSpan("kvstore", start + std::chrono::milliseconds(25));
+
+  EXPECT_FALSE(tracer.markReady("decision", start + std::chrono::seconds(1)));
+  // later reports and unexpected milestones don't complete startup
+  EXPECT_FALSE(tracer.markReady("decision", start + std::chrono::seconds(2)));
+  EXPECT_FALSE(tracer.markReady("other", start + std::chrono::seconds(2)));
+  EXPECT_FALSE(tracer.isDone());
+
+  auto counters = tracer.getCounters();
+  EXPECT_EQ(0, counters.count("startup.total_ms"));
+  EXPECT_EQ(20, counters.at("startup.span_ms.kvstore"));
+  EXPECT_EQ(5, counters.at("startup.span_ms.decision"));
+  EXPECT_EQ(1000, counters.at("startup.ready_ms.decision"));
+  EXPECT_EQ(2000, counters.at("startup.ready_ms.other"));
+
+  EXPECT_TRUE(tracer.markReady("fib", start + std::chrono::seconds(3)));
+  EXPECT_FALSE(tracer.markReady("fib", start + std::chrono::seconds(4)));
+  EXPECT_TRUE(tracer.isDone());
+
+  counters = tracer.getCounters();
+  EXPECT_EQ(3000, counters.at("startup.ready_ms.fib"));
+  EXPECT_EQ(3000, counters.at("startup.total_ms"));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <malloc.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Random.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/StepDetector.h>
+
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to another one, with a custom name for
+ * each set of parameters
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FB_STRINGIZE(name) "(" FB_STRINGIZE(param_name) ")",             \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
+namespace {
+
+// Same parameters as RTT step detector of Spark neighbors
+using RttStepDetector =
+    openr::StepDetector<int64_t, std::chrono::milliseconds, 10, 60>;
+
+const std::chrono::milliseconds kSamplePeriod(2000);
+
+std::unique_ptr<RttStepDetector>
+makeStepDetector() {
+  return std::make_unique<RttStepDetector>(
+      kSamplePeriod,
+      2 /* lower threshold */,
+      10 /* upper threshold */,
+      500 /* absolute threshold */,
+      [](const int64_t&) {});
+}
+
+// Bytes currently allocated from heap
+size_t
+getAllocatedBytes() {
+  return mallinfo().uordblks;
+}
+
+} // namespace
+
+/**
+ * Add samples of one RTT per sample period, as Spark does on hellos
+ */
+static void
+BM_StepDetectorAddValue(uint32_t iters, uint32_t numSamples) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<int64_t> samples;
+  samples.reserve(numSamples);
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    samples.emplace_back(1000 + folly::Random::rand32(100));
+  }
+  auto stepDetector = makeStepDetector();
+  int64_t time{0};
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    for (auto const& sample : samples) {
+      stepDetector->addValue(std::chrono::milliseconds(time), sample);
+      time += kSamplePeriod.count();
+    }
+  }
+}
+
+/**
+ * Create step detectors of many neighbors, reporting heap used by them
+ */
+static void
+BM_StepDetectorCreate(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numDetectors) {
+  auto suspender = folly::BenchmarkSuspender();
+  std::vector<std::unique_ptr<RttStepDetector>> stepDetectors;
+  stepDetectors.reserve(numDetectors);
+  const auto allocatedBefore = getAllocatedBytes();
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    stepDetectors.clear();
+    for (uint32_t j = 0; j < numDetectors; ++j) {
+      stepDetectors.emplace_back(makeStepDetector());
+    }
+  }
+
+  suspender.rehire();
+  counters["heap_bytes_per_detector"] =
+      (getAllocatedBytes() - allocatedBefore) / numDetectors;
+}
+
+// The parameter is the number of samples, or of step detectors
+BENCHMARK_PARAM(BM_StepDetectorAddValue, 100);
+BENCHMARK_PARAM(BM_StepDetectorAddValue, 10000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_StepDetectorCreate, counters, 1000, 1000);
+BENCHMARK_COUNTERS_NAME_PARAM(BM_StepDetectorCreate, counters, 10000, 10000);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
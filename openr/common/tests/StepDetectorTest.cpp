@@ -45,14 +45,17 @@ TEST(StepDetectorTest, LargeStep) {
     EXPECT_LE(avg, expectedAvg + delta);
   };
 
-  openr::StepDetector<double, std::chrono::seconds> stepDetector(
-      std::chrono::seconds(1) /* sampling period */,
+  openr::StepDetector<
+      double,
+      std::chrono::seconds,
       10 /* small window size */,
-      30 /* large window size */,
-      2 /* lower threshold */,
-      10 /* upper threshold */,
-      5 /* absolute threshold */,
-      stepCb /* callback function */);
+      30 /* large window size */>
+      stepDetector(
+          std::chrono::seconds(1) /* sampling period */,
+          2 /* lower threshold */,
+          10 /* upper threshold */,
+          5 /* absolute threshold */,
+          stepCb /* callback function */);
 
   {
     // stable mean w/o step
@@ -111,14 +114,17 @@ TEST(StepDetectorTest, SlowBoiling) {
     EXPECT_LE(avg, expectedAvg + delta);
   };
 
-  openr::StepDetector<double, std::chrono::seconds> stepDetector(
-      std::chrono::seconds(1) /* sampling period */,
+  openr::StepDetector<
+      double,
+      std::chrono::seconds,
       10 /* small window size */,
-      30 /* large window size */,
-      2 /* lower threshold */,
-      10 /* upper threshold */,
-      5 /* absolute threshold */,
-      stepCb /* callback function */);
+      30 /* large window size */>
+      stepDetector(
+          std::chrono::seconds(1) /* sampling period */,
+          2 /* lower threshold */,
+          10 /* upper threshold */,
+          5 /* absolute threshold */,
+          stepCb /* callback function */);
 
   {
     // stable mean w/o step
@@ -161,6 +167,36 @@ TEST(StepDetectorTest, SlowBoiling) {
   }
 }
 
+// window keeps values of last periods, expires older ones as time advances
+TEST(StepDetectorTest, SlidingWindow) {
+  openr::SlidingWindow<int64_t, std::chrono::seconds, 3> window(
+      std::chrono::seconds(1));
+  EXPECT_EQ(0, window.count());
+  EXPECT_EQ(0, window.avg());
+
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(10), 10));
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(10), 20));
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(12), 60));
+  EXPECT_EQ(3, window.count());
+  EXPECT_EQ(30, window.avg());
+
+  // out of order, in the window
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(11), 30));
+  EXPECT_EQ(4, window.count());
+  EXPECT_EQ(30, window.avg());
+
+  // values of time 10 expire, and older are rejected
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(13), 90));
+  EXPECT_FALSE(window.addValue(std::chrono::seconds(10), 1000));
+  EXPECT_EQ(3, window.count());
+  EXPECT_EQ(60, window.avg());
+
+  // gap larger than window expires everything
+  EXPECT_TRUE(window.addValue(std::chrono::seconds(100), 5));
+  EXPECT_EQ(1, window.count());
+  EXPECT_EQ(5, window.avg());
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
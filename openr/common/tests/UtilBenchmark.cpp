@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+
+namespace {
+
+/**
+ * Route database as computed by Decision, sorted by prefix, one v6 route per
+ * prefix with two next-hops and one MPLS route per label
+ */
+openr::thrift::RouteDatabase
+createRouteDb(uint32_t numRoutes, int32_t metric) {
+  openr::thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = "node-1";
+  routeDb.unicastRoutes.reserve(numRoutes);
+  routeDb.mplsRoutes.reserve(numRoutes);
+  for (uint32_t i = 0; i < numRoutes; ++i) {
+    std::vector<openr::thrift::NextHopThrift> nextHops;
+    for (uint32_t j = 1; j <= 2; ++j) {
+      nextHops.emplace_back(openr::createNextHop(
+          openr::toBinaryAddress(
+              folly::IPAddress(folly::sformat("fe80::{}", j))),
+          folly::sformat("iface{}", j),
+          metric));
+    }
+    routeDb.unicastRoutes.emplace_back(openr::createUnicastRoute(
+        openr::toIpPrefix(
+            folly::sformat("fc00:{:x}:{:x}::/64", i >> 16, i & 0xffff)),
+        nextHops));
+    routeDb.mplsRoutes.emplace_back(
+        openr::createMplsRoute(100000 + i, std::move(nextHops)));
+  }
+  return routeDb;
+}
+
+/**
+ * Every churned route of oldRouteDb either gets new next-hop metrics or
+ * is withdrawn, alternately
+ */
+openr::thrift::RouteDatabase
+createChurnedRouteDb(
+    const openr::thrift::RouteDatabase& oldRouteDb, uint32_t churnPerMille) {
+  const auto numRoutes = oldRouteDb.unicastRoutes.size();
+  const auto changedRouteDb = createRouteDb(numRoutes, 20);
+  const size_t step = 1000 / churnPerMille;
+
+  openr::thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = oldRouteDb.thisNodeName;
+  for (size_t i = 0; i < numRoutes; ++i) {
+    if (i % step) {
+      routeDb.unicastRoutes.emplace_back(oldRouteDb.unicastRoutes.at(i));
+      routeDb.mplsRoutes.emplace_back(oldRouteDb.mplsRoutes.at(i));
+    } else if ((i / step) % 2 == 0) {
+      routeDb.unicastRoutes.emplace_back(changedRouteDb.unicastRoutes.at(i));
+      routeDb.mplsRoutes.emplace_back(changedRouteDb.mplsRoutes.at(i));
+    }
+  }
+  return routeDb;
+}
+
+} // namespace
+
+static void
+BM_FindDeltaRoutes(uint32_t iters, uint32_t numRoutes, uint32_t churnPerMille) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto oldRouteDb = createRouteDb(numRoutes, 10);
+  const auto newRouteDb = createChurnedRouteDb(oldRouteDb, churnPerMille);
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    auto routeDbDelta = openr::findDeltaRoutes(newRouteDb, oldRouteDb);
+    folly::doNotOptimizeAway(routeDbDelta);
+  }
+}
+
+// Parameters are number of routes and churned routes per mille
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 10000_0_1pct, 10000, 1);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 10000_1pct, 10000, 10);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 10000_100pct, 10000, 1000);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 100000_0_1pct, 100000, 1);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 100000_1pct, 100000, 10);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 100000_100pct, 100000, 1000);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 500000_0_1pct, 500000, 1);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 500000_1pct, 500000, 10);
+BENCHMARK_NAMED_PARAM(BM_FindDeltaRoutes, 500000_100pct, 500000, 1000);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -6,6 +6,7 @@
  */
 
 #include <stdlib.h>
+#include <set>
 
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Random.h>
@@ -15,6 +16,7 @@
 #include <sodium.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/BusSerializer.h>
 #include <openr/common/Util.h>
 
 using namespace std;
@@ -236,6 +238,47 @@ TEST(UtilTest, PrefixKeyTest) {
   }
 }
 
+TEST(UtilTest, PrefixShardKeyTest) {
+  const auto prefixShardKey = PrefixShardKey("node-1.0", 13);
+  EXPECT_EQ("prefix:node-1.0:13", prefixShardKey.getPrefixShardKey());
+
+  auto parsedKey = PrefixShardKey::fromStr("prefix:node-1.0:13");
+  ASSERT_TRUE(parsedKey.hasValue());
+  EXPECT_EQ("node-1.0", parsedKey->getNodeName());
+  EXPECT_EQ(13, parsedKey->getShard());
+  EXPECT_EQ("node-1.0", getNodeNameFromKey("prefix:node-1.0:13"));
+
+  // Prefix DB and per prefix keys are not prefix shard keys
+  EXPECT_FALSE(PrefixShardKey::fromStr("prefix:node-1").hasValue());
+  EXPECT_FALSE(
+      PrefixShardKey::fromStr("prefix:node-1:0:[fc00::/64]").hasValue());
+  EXPECT_FALSE(PrefixShardKey::fromStr("adj:node-1:1").hasValue());
+
+  // Prefixes are spread in all shards
+  std::set<int32_t> shards;
+  for (int i = 0; i < 100; ++i) {
+    const auto prefix = toIpPrefix(folly::sformat("fc00:{}::/64", i));
+    const auto shard = PrefixShardKey::getShardOfPrefix(prefix, 4);
+    EXPECT_EQ(shard, PrefixShardKey::getShardOfPrefix(prefix, 4));
+    shards.emplace(shard);
+  }
+  EXPECT_EQ(std::set<int32_t>({0, 1, 2, 3}), shards);
+}
+
+TEST(UtilTest, KeyValueHashCacheTest) {
+  KeyValueHashCache cache;
+  EXPECT_TRUE(cache.update("adj:node1", "value1"));
+  EXPECT_FALSE(cache.update("adj:node1", "value1"));
+  EXPECT_TRUE(cache.update("adj:node2", "value1"));
+  EXPECT_TRUE(cache.update("adj:node1", "value2"));
+  EXPECT_FALSE(cache.update("adj:node1", "value2"));
+  EXPECT_EQ(2, cache.size());
+
+  cache.erase("adj:node1");
+  EXPECT_EQ(1, cache.size());
+  EXPECT_TRUE(cache.update("adj:node1", "value2"));
+}
+
 TEST(UtilTest, GetNodeNameFromKeyTest) {
   const std::string s1{"prefix:node1"};
   EXPECT_EQ("node1", getNodeNameFromKey(s1));
@@ -244,6 +287,32 @@ TEST(UtilTest, GetNodeNameFromKeyTest) {
   EXPECT_EQ("nodename.0.0", getNodeNameFromKey(s2));
 }
 
+TEST(UtilTest, KeyPrefixTest) {
+  EXPECT_TRUE(KeyPrefix::isLiteral("adj:node-1"));
+  EXPECT_FALSE(KeyPrefix::isLiteral("adj:.*"));
+
+  // literal prefixes, matched with trie
+  KeyPrefix literal({"adj:", "prefix:node1", "prefix:node"});
+  EXPECT_TRUE(literal.keyMatch("adj:"));
+  EXPECT_TRUE(literal.keyMatch("adj:node1"));
+  EXPECT_TRUE(literal.keyMatch("prefix:node2"));
+  EXPECT_FALSE(literal.keyMatch("ad"));
+  EXPECT_FALSE(literal.keyMatch("prefix:nod"));
+  EXPECT_FALSE(literal.keyMatch("allocprefix:node1"));
+  EXPECT_FALSE(literal.keyMatch(""));
+
+  // regex prefixes, matched with RE2 set
+  KeyPrefix regex({"adj:", "prefix:node[12]"});
+  EXPECT_TRUE(regex.keyMatch("adj:node3"));
+  EXPECT_TRUE(regex.keyMatch("prefix:node2:[::/0]"));
+  EXPECT_FALSE(regex.keyMatch("prefix:node3"));
+
+  // empty prefix list and empty prefix match all keys
+  EXPECT_TRUE(KeyPrefix({}).keyMatch("adj:node1"));
+  EXPECT_TRUE(KeyPrefix({""}).keyMatch("adj:node1"));
+  EXPECT_TRUE(KeyPrefix({""}).keyMatch(""));
+}
+
 // test getNthPrefix()
 TEST(UtilTest, getNthPrefix) {
   // v6 allocation parameters
@@ -676,6 +745,133 @@ TEST(UtilTest, findDeltaRoutes) {
   EXPECT_EQ(res3.mplsRoutesToDelete.at(0), 2);
 }
 
+TEST(UtilTest, findDeltaRoutesUnsorted) {
+  thrift::RouteDatabase oldRouteDb;
+  oldRouteDb.thisNodeName = "node-1";
+  oldRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1}));
+  oldRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1}));
+  oldRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1}));
+  oldRouteDb.mplsRoutes.emplace_back(createMplsRoute(3, {path1_3_1_swap}));
+  oldRouteDb.mplsRoutes.emplace_back(createMplsRoute(2, {path1_2_1_swap}));
+
+  // prefix1 is unchanged, prefix2 changes next-hops, prefix3 is withdrawn
+  thrift::RouteDatabase newRouteDb;
+  newRouteDb.thisNodeName = "node-1";
+  newRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_2}));
+  newRouteDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1}));
+  newRouteDb.mplsRoutes.emplace_back(createMplsRoute(2, {path1_2_1_swap}));
+  newRouteDb.mplsRoutes.emplace_back(createMplsRoute(4, {path1_3_1_swap}));
+
+  const auto res = findDeltaRoutes(newRouteDb, oldRouteDb);
+  ASSERT_EQ(res.unicastRoutesToUpdate.size(), 1);
+  EXPECT_EQ(res.unicastRoutesToUpdate.at(0), newRouteDb.unicastRoutes.at(0));
+  EXPECT_EQ(res.unicastRoutesToDelete, std::vector<thrift::IpPrefix>{prefix3});
+  ASSERT_EQ(res.mplsRoutesToUpdate.size(), 1);
+  EXPECT_EQ(res.mplsRoutesToUpdate.at(0), newRouteDb.mplsRoutes.at(1));
+  EXPECT_EQ(res.mplsRoutesToDelete, std::vector<int32_t>{3});
+}
+
+TEST(UtilTest, NextHopGroups) {
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}));
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1, path1_2_2}));
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
+  routeDbDelta.mplsRoutesToUpdate.emplace_back(
+      createMplsRoute(2, {path1_2_1_swap, path1_2_2_swap}));
+  const auto origRouteDbDelta = routeDbDelta;
+
+  // routes with same nexthops share a group
+  EXPECT_EQ(2, compressNextHopGroups(routeDbDelta));
+  EXPECT_EQ(2, routeDbDelta.nextHopGroups.size());
+  for (auto const& route : routeDbDelta.unicastRoutesToUpdate) {
+    EXPECT_TRUE(route.nextHops.empty());
+    ASSERT_TRUE(route.nextHopGroupId.hasValue());
+  }
+  EXPECT_EQ(
+      routeDbDelta.unicastRoutesToUpdate.at(0).nextHopGroupId,
+      routeDbDelta.unicastRoutesToUpdate.at(1).nextHopGroupId);
+  EXPECT_NE(
+      routeDbDelta.unicastRoutesToUpdate.at(0).nextHopGroupId,
+      routeDbDelta.unicastRoutesToUpdate.at(2).nextHopGroupId);
+  EXPECT_EQ(
+      origRouteDbDelta.mplsRoutesToUpdate, routeDbDelta.mplsRoutesToUpdate);
+
+  // expanding restores the original delta
+  EXPECT_TRUE(expandNextHopGroups(routeDbDelta));
+  EXPECT_EQ(origRouteDbDelta, routeDbDelta);
+
+  // unknown group is reported
+  compressNextHopGroups(routeDbDelta);
+  routeDbDelta.nextHopGroups.erase(
+      routeDbDelta.unicastRoutesToUpdate.at(2).nextHopGroupId.value());
+  EXPECT_FALSE(expandNextHopGroups(routeDbDelta));
+}
+
+TEST(UtilTest, parseThreadSchedConfigs) {
+  auto configs = parseThreadSchedConfigs(
+      "DECISION=2-3,5;KVSTORE=1", "DECISION=fifo:10;FIB=batch");
+  EXPECT_EQ(3, configs.size());
+  EXPECT_EQ(std::vector<int>({2, 3, 5}), configs.at("DECISION").cpus);
+  EXPECT_EQ(SCHED_FIFO, configs.at("DECISION").policy);
+  EXPECT_EQ(10, configs.at("DECISION").priority);
+  EXPECT_EQ(std::vector<int>({1}), configs.at("KVSTORE").cpus);
+  EXPECT_FALSE(configs.at("KVSTORE").policy.hasValue());
+  EXPECT_TRUE(configs.at("FIB").cpus.empty());
+  EXPECT_EQ(SCHED_BATCH, configs.at("FIB").policy);
+
+  EXPECT_TRUE(parseThreadSchedConfigs("", "").empty());
+  EXPECT_THROW(parseThreadSchedConfigs("DECISION", ""), std::invalid_argument);
+  EXPECT_THROW(
+      parseThreadSchedConfigs("DECISION=3-2", ""), std::invalid_argument);
+  EXPECT_THROW(
+      parseThreadSchedConfigs("DECISION=a", ""), std::invalid_argument);
+  EXPECT_THROW(
+      parseThreadSchedConfigs("", "DECISION=deadline"), std::invalid_argument);
+  EXPECT_THROW(
+      parseThreadSchedConfigs("", "DECISION=fifo:1000"),
+      std::invalid_argument);
+
+  // applying no config to this thread is a no-op
+  EXPECT_TRUE(applyThreadSchedConfig(ThreadSchedConfig{}));
+  EXPECT_LE(0, getThreadCpuTime().count());
+}
+
+TEST(BusSerializerTest, RoundTrip) {
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}));
+  routeDbDelta.mplsRoutesToUpdate.emplace_back(
+      createMplsRoute(2, {path1_2_1_swap, path1_2_2_swap}));
+
+  for (auto const protocol :
+       {BusSerializer::Protocol::COMPACT, BusSerializer::Protocol::BINARY}) {
+    BusSerializer serializer(protocol);
+    auto msg = serializer.toMessage(routeDbDelta);
+    ASSERT_TRUE(msg.hasValue());
+    auto decoded =
+        serializer.fromMessage<thrift::RouteDatabaseDelta>(msg.value());
+    ASSERT_TRUE(decoded.hasValue());
+    EXPECT_EQ(routeDbDelta, decoded.value());
+  }
+
+  EXPECT_EQ(
+      BusSerializer::Protocol::BINARY, BusSerializer::parseProtocol("binary"));
+  EXPECT_EQ(
+      BusSerializer::Protocol::COMPACT,
+      BusSerializer::parseProtocol("compact"));
+  EXPECT_FALSE(BusSerializer::parseProtocol("frozen").hasValue());
+}
+
 TEST(UtilTest, MplsLabelValidate) {
   EXPECT_TRUE(isMplsLabelValid(0));
   EXPECT_TRUE(isMplsLabelValid(1132));
@@ -777,6 +973,58 @@ TEST(UtilTest, getPrefixForwardingType) {
       thrift::PrefixForwardingType::SR_MPLS, getPrefixForwardingType(prefixes));
 }
 
+TEST(UtilTest, generateHash) {
+  const std::string value{"value"};
+  const auto hash = generateHash(1, "node1", value);
+  EXPECT_EQ(hash, generateHash(1, "node1", value));
+
+  // every attribute is part of the hash
+  EXPECT_NE(hash, generateHash(2, "node1", value));
+  EXPECT_NE(hash, generateHash(1, "node2", value));
+  EXPECT_NE(hash, generateHash(1, "node1", std::string{"value2"}));
+
+  // attribute boundaries can't be shifted
+  EXPECT_NE(
+      generateHash(1, "node1", std::string{"value"}),
+      generateHash(1, "node1v", std::string{"alue"}));
+
+  // empty value differs from missing value
+  EXPECT_NE(
+      generateHash(1, "node1", std::string{}),
+      generateHash(1, "node1", folly::none));
+}
+
+TEST(UtilTest, compressValue) {
+  // small values are not compressed
+  EXPECT_FALSE(compressValue("value").hasValue());
+  EXPECT_FALSE(isCompressedValue("value"));
+  EXPECT_EQ("value", decompressValue("value"));
+
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = "node1";
+  for (int i = 0; i < 100; ++i) {
+    prefixDb.prefixEntries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{}::/64", i)),
+        thrift::PrefixType::LOOPBACK));
+  }
+  apache::thrift::CompactSerializer serializer;
+  const auto value = fbzmq::util::writeThriftObjStr(prefixDb, serializer);
+  EXPECT_FALSE(isCompressedValue(value));
+
+  const auto compressed = compressValue(value);
+  ASSERT_TRUE(compressed.hasValue());
+  EXPECT_TRUE(isCompressedValue(*compressed));
+  EXPECT_GT(value.size(), compressed->size());
+  EXPECT_EQ(value, decompressValue(*compressed));
+
+  // compressed and uncompressed values parse the same
+  EXPECT_EQ(
+      prefixDb,
+      readThriftValue<thrift::PrefixDatabase>(*compressed, serializer));
+  EXPECT_EQ(
+      prefixDb, readThriftValue<thrift::PrefixDatabase>(value, serializer));
+}
+
 using namespace openr::MetricVectorUtils;
 TEST(MetricVectorUtilsTest, CompareResultInverseOperator) {
   EXPECT_EQ(CompareResult::WINNER, !CompareResult::LOOSER);
@@ -927,6 +1175,38 @@ TEST(MetricVectorUtilsTest, compareMetricVectors) {
   EXPECT_EQ(CompareResult::TIE_LOOSER, compareMetricVectors(r, l));
 }
 
+TEST(MetricVectorUtilsTest, compareSortedMetricVectors) {
+  thrift::MetricVector l, r;
+  l.version = r.version = 1;
+
+  int64_t numMetrics = 3;
+  l.metrics.resize(numMetrics);
+  for (int64_t i = 0; i < numMetrics; ++i) {
+    l.metrics[i].type = i;
+    l.metrics[i].priority = i;
+    l.metrics[i].op = thrift::CompareType::WIN_IF_PRESENT;
+    l.metrics[i].isBestPathTieBreaker = false;
+    l.metrics[i].metric = {i};
+  }
+  r = l;
+  // highest priority entity decides
+  r.metrics[numMetrics - 1].metric.front()--;
+
+  // vectors are compared as they are, not sorted first
+  auto const unsortedL = l;
+  EXPECT_EQ(CompareResult::LOOSER, compareSortedMetricVectors(l, r));
+  EXPECT_EQ(unsortedL, l);
+
+  sortMetricVector(l);
+  sortMetricVector(r);
+  EXPECT_EQ(CompareResult::WINNER, compareSortedMetricVectors(l, r));
+  EXPECT_EQ(CompareResult::LOOSER, compareSortedMetricVectors(r, l));
+  EXPECT_EQ(compareMetricVectors(l, r), compareSortedMetricVectors(l, r));
+
+  r.version = 2;
+  EXPECT_EQ(CompareResult::ERROR, compareSortedMetricVectors(l, r));
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
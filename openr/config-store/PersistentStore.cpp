@@ -8,8 +8,12 @@
 #include "PersistentStore.h"
 
 #include <chrono>
+#include <map>
 
+#include <folly/Exception.h>
 #include <folly/FileUtil.h>
+#include <folly/MemoryMapping.h>
+#include <folly/ScopeGuard.h>
 #include <folly/io/IOBuf.h>
 
 #include <openr/common/Util.h>
@@ -18,7 +22,11 @@ using std::exception;
 
 namespace {
 
-static const long kDbFlushRatio = 10000;
+// Appended log is compacted into a fresh copy of the database once it grows
+// beyond kDbCompactionRatio times the size of live database. Small logs are
+// never compacted to avoid rewriting the file on every change of a tiny DB
+const uint64_t kDbCompactionRatio{4};
+const uint64_t kDbCompactionMinLogSize{64 * 1024};
 
 } // anonymous namespace
 
@@ -30,7 +38,8 @@ PersistentStore::PersistentStore(
     fbzmq::Context& context,
     std::chrono::milliseconds saveInitialBackoff,
     std::chrono::milliseconds saveMaxBackoff,
-    bool dryrun)
+    bool dryrun,
+    folly::Optional<MonitorSubmitUrl> monitorSubmitUrl)
     : OpenrEventLoop(
           nodeName, thrift::OpenrModuleType::PERSISTENT_STORE, context),
       storageFilePath_(storageFilePath),
@@ -51,6 +60,20 @@ PersistentStore::PersistentStore(
             saveDbTimerBackoff_->getTimeRemainingUntilRetry());
       }
     });
+
+    // Changes are written to disk on a thread of its own
+    ioExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+  }
+
+  if (monitorSubmitUrl.hasValue()) {
+    zmqMonitorClient_ = std::make_unique<fbzmq::ZmqMonitorClient>(
+        context, monitorSubmitUrl.value());
+    // Schedule periodic timer for submission to monitor
+    const bool isPeriodic = true;
+    monitorTimer_ =
+        fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+    monitorTimer_->scheduleTimeout(
+        Constants::kMonitorSubmitInterval, isPeriodic);
   }
 
   // Load initial database. On failure we will just report error and continue
@@ -62,6 +85,10 @@ PersistentStore::PersistentStore(
 }
 
 PersistentStore::~PersistentStore() {
+  // Complete queued writes first, so that none lands after the final one
+  if (ioExecutor_) {
+    ioExecutor_->join();
+  }
   saveDatabaseToDisk();
 }
 
@@ -72,7 +99,7 @@ PersistentStore::processRequestMsg(fbzmq::Message&& requestMsg) {
   if (request.hasError()) {
     LOG(ERROR) << "Error while reading request " << request.error();
     response.success = false;
-    return fbzmq::Message::fromThriftObj(response, serializer_);
+    return toReplyMsg(response, serializer_);
   }
 
   // Generate response
@@ -121,7 +148,7 @@ PersistentStore::processRequestMsg(fbzmq::Message&& requestMsg) {
   }
 
   // Send response
-  return fbzmq::Message::fromThriftObj(response, serializer_);
+  return toReplyMsg(response, serializer_);
 }
 
 bool
@@ -143,30 +170,30 @@ PersistentStore::savePersistentObjectToDisk() noexcept {
       queue.append(std::move(**buf));
     }
 
-    // Append IoBuf to disk
+    // Append IoBuf to disk, or write whole database instead if log grows
+    // mostly stale or a previous write failed
     auto ioBuf = queue.move();
-    auto success = writeIoBufToDisk(ioBuf, WriteType::APPEND);
-    if (success.hasError()) {
-      LOG(ERROR) << "Failed to write PersistentObject to file '"
-                 << storageFilePath_
-                 << "'. Error: " << folly::exceptionStr(success.error());
-      return false;
-    }
-
-    numOfNewWritesToDisk_++;
-
-    // Write the whole database to disk periodically
-    if (numOfNewWritesToDisk_ >= kDbFlushRatio) {
-      numOfNewWritesToDisk_ = 0;
-      const auto startTs = std::chrono::steady_clock::now();
-      if (not saveDatabaseToDisk()) {
+    auto writeType = WriteType::APPEND;
+    const auto logSize = logSizeOnDisk_ + ioBuf->computeChainDataLength();
+    const auto dbSize = getEncodedDatabaseSize();
+    if (writeFailed_ or
+        (logSize > kDbCompactionMinLogSize and
+         logSize > kDbCompactionRatio * dbSize)) {
+      VLOG(1) << "Compacting " << logSize << " bytes of log into " << dbSize
+              << " bytes of database";
+      auto dbBuf = encodeDatabase();
+      if (dbBuf.hasError()) {
+        LOG(ERROR) << "Failed to encode database. Error: " << dbBuf.error();
         return false;
       }
-      LOG(INFO) << "Updated database on disk. Took "
-                << std::chrono::duration_cast<std::chrono::milliseconds>(
-                       std::chrono::steady_clock::now() - startTs)
-                       .count()
-                << "ms";
+      ioBuf = std::move(*dbBuf);
+      writeType = WriteType::WRITE;
+      numOfNewWritesToDisk_ = 0;
+    } else {
+      numOfNewWritesToDisk_++;
+    }
+    if (not scheduleWriteToDisk(std::move(ioBuf), writeType)) {
+      return false;
     }
   } else {
     VLOG(1) << "Skipping writing to disk in dryrun mode";
@@ -178,6 +205,25 @@ PersistentStore::savePersistentObjectToDisk() noexcept {
 
 bool
 PersistentStore::saveDatabaseToDisk() noexcept {
+  auto ioBuf = encodeDatabase();
+  if (ioBuf.hasError()) {
+    LOG(ERROR) << "Failed to encode database. Error: " << ioBuf.error();
+    return false;
+  }
+  const auto size = (*ioBuf)->computeChainDataLength();
+  auto success = writeIoBufToDisk(*ioBuf, WriteType::WRITE);
+  if (success.hasError()) {
+    LOG(ERROR) << "Failed to write database to file '" << storageFilePath_
+               << "'. Error: " << folly::exceptionStr(success.error());
+    return false;
+  }
+  logSizeOnDisk_ = size;
+  writeFailed_ = false;
+  return true;
+}
+
+folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+PersistentStore::encodeDatabase() const noexcept {
   std::unique_ptr<folly::IOBuf> ioBuf;
   // If database is empty, write 'kTlvFormatMarker' to disk and return
   if (database_.keyVals.size() == 0) {
@@ -196,25 +242,114 @@ PersistentStore::saveDatabaseToDisk() noexcept {
 
       auto buf = encodePersistentObject(pObject);
       if (buf.hasError()) {
-        LOG(ERROR) << "Failed to encode PersistentObject to ioBuf. Error:  "
-                   << folly::exceptionStr(buf.error());
-        return false;
+        return folly::makeUnexpected(buf.error());
       }
       queue.append(std::move(*buf));
     }
     // Write queue to disk
     ioBuf = queue.move();
   }
+  return ioBuf;
+}
 
-  auto success = writeIoBufToDisk(ioBuf, WriteType::WRITE);
-  if (success.hasError()) {
-    LOG(ERROR) << "Failed to write database to file '" << storageFilePath_
-               << "'. Error: " << folly::exceptionStr(success.error());
-    return false;
+bool
+PersistentStore::scheduleWriteToDisk(
+    std::unique_ptr<folly::IOBuf> ioBuf, WriteType writeType) noexcept {
+  const auto size = ioBuf->computeChainDataLength();
+  // Expected size of the file once written, writes are applied in order
+  if (writeType == WriteType::WRITE) {
+    logSizeOnDisk_ = size;
+  } else {
+    logSizeOnDisk_ += size;
   }
+
+  if (not ioExecutor_) {
+    const auto startTs = std::chrono::steady_clock::now();
+    auto success = writeIoBufToDisk(ioBuf, writeType);
+    folly::Optional<std::string> error;
+    if (success.hasError()) {
+      error = std::move(success.error());
+    }
+    processWriteResult(
+        error,
+        writeType,
+        size,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTs));
+    return not error.hasValue();
+  }
+
+  ++numPendingWrites_;
+  ioExecutor_->add(
+      [this, ioBuf = std::move(ioBuf), writeType, size]() mutable noexcept {
+        const auto startTs = std::chrono::steady_clock::now();
+        auto success = writeIoBufToDisk(ioBuf, writeType);
+        folly::Optional<std::string> error;
+        if (success.hasError()) {
+          error = std::move(success.error());
+        }
+        const auto latency =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTs);
+        runInEventLoop(
+            [this, error = std::move(error), writeType, size, latency]() {
+              --numPendingWrites_;
+              processWriteResult(error, writeType, size, latency);
+              if (error.hasValue() and not saveDbTimer_->isScheduled()) {
+                // Write whole database after backoff
+                saveDbTimerBackoff_->reportError();
+                saveDbTimer_->scheduleTimeout(
+                    saveDbTimerBackoff_->getTimeRemainingUntilRetry());
+              }
+            });
+      });
   return true;
 }
 
+void
+PersistentStore::processWriteResult(
+    folly::Optional<std::string> const& error,
+    WriteType writeType,
+    uint64_t size,
+    std::chrono::milliseconds latency) noexcept {
+  if (error.hasValue()) {
+    LOG(ERROR) << "Failed to write to file '" << storageFilePath_
+               << "'. Error: " << error.value();
+    tData_.addStatValue("persistent_store.write_failures", 1, fbzmq::COUNT);
+    writeFailed_ = true;
+    return;
+  }
+  tData_.addStatValue(
+      "persistent_store.write_latency_ms", latency.count(), fbzmq::AVG);
+  tData_.addStatValue("persistent_store.bytes_written", size, fbzmq::SUM);
+  if (writeType == WriteType::WRITE) {
+    writeFailed_ = false;
+    LOG(INFO) << "Updated database on disk. Took " << latency.count() << "ms";
+  }
+}
+
+void
+PersistentStore::submitCounters() {
+  VLOG(3) << "Submitting counters...";
+  auto counters = tData_.getCounters();
+  counters["persistent_store.pending_writes"] = numPendingWrites_;
+  counters["persistent_store.db_size_on_disk"] = logSizeOnDisk_;
+  counters["persistent_store.zmq_event_queue_size"] = getEventQueueSize();
+  exportProfileCounters(counters);
+  zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
+}
+
+uint64_t
+PersistentStore::getEncodedDatabaseSize() const noexcept {
+  // Size of kTlvFormatMarker followed by an ADD record for every key
+  uint64_t size = kTlvFormatMarker.size();
+  for (auto const& keyPair : database_.keyVals) {
+    size += sizeof(uint8_t) + sizeof(uint32_t) + keyPair.first.size() +
+        sizeof(uint32_t) + keyPair.second.size();
+  }
+  return size;
+}
+
 bool
 PersistentStore::loadDatabaseFromDisk() noexcept {
   // Check if file exists
@@ -224,16 +359,21 @@ PersistentStore::loadDatabaseFromDisk() noexcept {
     return true;
   }
 
-  // Read data from file
-  std::string fileData{""};
-  if (not folly::readFile(storageFilePath_.c_str(), fileData)) {
-    LOG(ERROR) << "Failed to read file contents from '" << storageFilePath_
-               << "'. Error (" << errno << "): " << folly::errnoStr(errno);
+  // Map file into memory instead of reading it. Only live values are copied
+  // out of it while replaying the log
+  std::unique_ptr<folly::MemoryMapping> mapping;
+  try {
+    mapping = std::make_unique<folly::MemoryMapping>(storageFilePath_.c_str());
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to map file contents from '" << storageFilePath_
+               << "'. Error: " << folly::exceptionStr(e);
     return false;
   }
+  const auto fileData = mapping->range();
+  logSizeOnDisk_ = fileData.size();
 
   // Create IoBuf and cursor for loading data from disk
-  auto ioBuf = folly::IOBuf::wrapBuffer(fileData.c_str(), fileData.size());
+  auto ioBuf = folly::IOBuf::wrapBuffer(fileData);
   folly::io::Cursor cursor(ioBuf.get());
 
   // Read 'kTlvFormatMarker' from ioBuf
@@ -282,7 +422,9 @@ PersistentStore::loadDatabaseTlvFormat(
     const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept {
   // Parse ioBuf to persistentObject and then to `database_`
   folly::io::Cursor cursor(ioBuf.get());
-  thrift::StoreDatabase newDatabase;
+  // Live value of every key, pointing into `ioBuf`. Superseded values are
+  // never copied
+  std::map<folly::StringPiece, folly::StringPiece> keyVals;
   // Read 'kTlvFormatMarker'
   try {
     cursor.readFixedString(kTlvFormatMarker.size());
@@ -292,30 +434,45 @@ PersistentStore::loadDatabaseTlvFormat(
   }
   // Iteratively read persistentObject from disk
   while (true) {
-    // Read and decode into persistentObject
-    auto optionalObject = decodePersistentObject(cursor);
-    if (optionalObject.hasError()) {
-      return folly::makeUnexpected(optionalObject.error());
+    auto optionalRecord = decodePersistentRecord(cursor);
+    if (optionalRecord.hasError()) {
+      // Last append didn't make it to disk completely, e.g. on power loss.
+      // Keep everything replayed so far and rewrite the file, otherwise
+      // records appended after the torn one could never be read back
+      LOG(ERROR) << "Discarding truncated record at the end of '"
+                 << storageFilePath_ << "'. Error: " << optionalRecord.error();
+      database_ = toStoreDatabase(keyVals);
+      saveDatabaseToDisk();
+      return folly::Unit();
     }
 
     // Read finish
-    if (not optionalObject->hasValue()) {
+    if (not optionalRecord->hasValue()) {
       break;
     }
-    auto pObject = std::move(optionalObject->value());
-
-    // Add/Delete persistentObject to/from 'newDatabase'
-    if (pObject.type == ActionType::ADD) {
-      newDatabase.keyVals[pObject.key] =
-          pObject.data.has_value() ? pObject.data.value() : "";
-    } else if (pObject.type == ActionType::DEL) {
-      newDatabase.keyVals.erase(pObject.key);
+    auto const& record = optionalRecord->value();
+
+    // Add/Delete record to/from 'keyVals'
+    if (record.type == ActionType::ADD) {
+      keyVals[record.key] = record.data;
+    } else if (record.type == ActionType::DEL) {
+      keyVals.erase(record.key);
     }
   }
-  database_ = std::move(newDatabase);
+  database_ = toStoreDatabase(keyVals);
   return folly::Unit();
 }
 
+thrift::StoreDatabase
+PersistentStore::toStoreDatabase(
+    const std::map<folly::StringPiece, folly::StringPiece>& keyVals) {
+  thrift::StoreDatabase database;
+  for (auto const& kv : keyVals) {
+    database.keyVals.emplace(kv.first.str(), kv.second.str());
+  }
+  return database;
+}
+
 // Write over or append IoBuf to disk atomically
 folly::Expected<folly::Unit, std::string>
 PersistentStore::writeIoBufToDisk(
@@ -329,12 +486,21 @@ PersistentStore::writeIoBufToDisk(
       // Write over
       folly::writeFileAtomic(storageFilePath_, fileData, 0666);
     } else {
-      // Append to file
-      folly::writeFile(
-          fileData,
-          storageFilePath_.c_str(),
-          O_WRONLY | O_APPEND | O_CREAT,
-          0666);
+      // Append to file and sync it once for the whole batch of records
+      int fd = folly::openNoInt(
+          storageFilePath_.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0666);
+      if (fd == -1) {
+        folly::throwSystemError("open failed for ", storageFilePath_);
+      }
+      SCOPE_EXIT {
+        folly::closeNoInt(fd);
+      };
+      if (folly::writeFull(fd, fileData.data(), fileData.size()) == -1) {
+        folly::throwSystemError("write failed for ", storageFilePath_);
+      }
+      if (folly::fsyncNoInt(fd) == -1) {
+        folly::throwSystemError("fsync failed for ", storageFilePath_);
+      }
     }
   } catch (std::exception const& e) {
     return folly::makeUnexpected<std::string>(
@@ -405,6 +571,41 @@ PersistentStore::decodePersistentObject(folly::io::Cursor& cursor) noexcept {
   }
 }
 
+// Same decoding as decodePersistentObject but without copying key and
+// data. Cursor must be on a contiguous buffer, which outlives the record.
+folly::Expected<folly::Optional<PersistentStore::PersistentRecord>, std::string>
+PersistentStore::decodePersistentRecord(folly::io::Cursor& cursor) noexcept {
+  // If nothing can be read, return
+  if (not cursor.canAdvance(1)) {
+    return folly::none;
+  }
+
+  // Read `length` bytes in place
+  auto readStringPiece = [&cursor](uint32_t length) {
+    if (cursor.length() < length) {
+      throw std::out_of_range("underflow");
+    }
+    folly::StringPiece str(
+        reinterpret_cast<const char*>(cursor.data()), length);
+    cursor.skip(length);
+    return str;
+  };
+
+  PersistentRecord record;
+  try {
+    // Read 'type'
+    record.type = ActionType(cursor.readBE<uint8_t>());
+    // Read key length and key
+    record.key = readStringPiece(cursor.readBE<uint32_t>());
+    // Read data length and data
+    record.data = readStringPiece(cursor.readBE<uint32_t>());
+    return record;
+  } catch (std::out_of_range& e) {
+    return folly::makeUnexpected<std::string>(
+        folly::exceptionStr(e).toStdString());
+  }
+}
+
 // Create a PersistentObject and assign value to it.
 PersistentObject
 PersistentStore::toPersistentObject(
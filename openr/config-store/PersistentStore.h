@@ -8,11 +8,16 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <string>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
+#include <fbzmq/service/monitor/ZmqMonitorClient.h>
+#include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Optional.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
@@ -53,6 +58,10 @@ struct PersistentObject {
  * with PersistentStore use PersistentStoreClient which allows you to
  * load/save/erase entries with different value types like thrift-objects,
  * primitive types and strings.
+ *
+ * Changes are encoded on the event loop and written to disk on an I/O thread,
+ * in order, so that requests aren't held up by slow disks. With zero save
+ * backoffs they are written on the event loop before responding instead.
  */
 class PersistentStore : public OpenrEventLoop {
  public:
@@ -65,7 +74,9 @@ class PersistentStore : public OpenrEventLoop {
           Constants::kPersistentStoreInitialBackoff,
       std::chrono::milliseconds saveMaxBackoff =
           Constants::kPersistentStoreMaxBackoff,
-      bool dryrun = false);
+      bool dryrun = false,
+      // counters are submitted to monitor if set
+      folly::Optional<MonitorSubmitUrl> monitorSubmitUrl = folly::none);
 
   // Destructor will try to save DB to disk before destroying the object
   ~PersistentStore() override;
@@ -75,6 +86,13 @@ class PersistentStore : public OpenrEventLoop {
     return numOfWritesToDisk_;
   }
 
+  // Size of the file on disk, i.e. database plus log appended since last
+  // compaction, once writes in progress complete
+  uint64_t
+  getLogSizeOnDisk() const {
+    return logSizeOnDisk_;
+  }
+
   // Encode a PersistentObject, this can be private method, but for unit test,
   // we make it public
   static folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
@@ -94,6 +112,10 @@ class PersistentStore : public OpenrEventLoop {
   bool saveDatabaseToDisk() noexcept;
   bool loadDatabaseFromDisk() noexcept;
 
+  // Encode `database_` in TlvFormat, as written to disk
+  folly::Expected<std::unique_ptr<folly::IOBuf>, std::string>
+  encodeDatabase() const noexcept;
+
   // Load old format file from disk, this is for compatible with the old version
   folly::Expected<folly::Unit, std::string> loadDatabaseOldFormat(
       const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept;
@@ -102,13 +124,45 @@ class PersistentStore : public OpenrEventLoop {
   folly::Expected<folly::Unit, std::string> loadDatabaseTlvFormat(
       const std::unique_ptr<folly::IOBuf>& ioBuf) noexcept;
 
-  // Function to save Persistent Object to local disk.
+  // PersistentObject referring to key and data in place, used while replaying
+  // the log on load
+  struct PersistentRecord {
+    ActionType type;
+    folly::StringPiece key;
+    folly::StringPiece data;
+  };
+  folly::Expected<folly::Optional<PersistentRecord>, std::string>
+  decodePersistentRecord(folly::io::Cursor& cursor) noexcept;
+
+  static thrift::StoreDatabase toStoreDatabase(
+      const std::map<folly::StringPiece, folly::StringPiece>& keyVals);
+
+  // Function to append pending Persistent Objects to local disk. Compacts the
+  // file by saving whole database once appended log is mostly stale
   bool savePersistentObjectToDisk() noexcept;
 
+  // Size of `database_` when written to disk in TlvFormat
+  uint64_t getEncodedDatabaseSize() const noexcept;
+
   // Write IoBuf ro local disk
   folly::Expected<folly::Unit, std::string> writeIoBufToDisk(
       const std::unique_ptr<folly::IOBuf>& ioBuf, WriteType writeType) noexcept;
 
+  // Write IoBuf to local disk on ioExecutor_ if any, else right away. Returns
+  // false if written right away and failed
+  bool scheduleWriteToDisk(
+      std::unique_ptr<folly::IOBuf> ioBuf, WriteType writeType) noexcept;
+
+  // Account for a completed write of size bytes, error is set if it failed
+  void processWriteResult(
+      folly::Optional<std::string> const& error,
+      WriteType writeType,
+      uint64_t size,
+      std::chrono::milliseconds latency) noexcept;
+
+  // Submit counters to monitor
+  void submitCounters();
+
   // Function to create a PersistentObject.
   PersistentObject toPersistentObject(
       const ActionType type, const std::string& key, const std::string& data);
@@ -119,6 +173,10 @@ class PersistentStore : public OpenrEventLoop {
   // Keeps track of number of writes of PersistentObject to disk
   std::atomic<std::uint64_t> numOfNewWritesToDisk_{0};
 
+  // Size of the file on disk: last full write of database plus records
+  // appended since
+  std::atomic<std::uint64_t> logSizeOnDisk_{0};
+
   // Location on disk where data will be synced up. A file will be created
   // if doesn't exists.
   const std::string storageFilePath_;
@@ -131,6 +189,27 @@ class PersistentStore : public OpenrEventLoop {
   std::unique_ptr<ExponentialBackoff<std::chrono::milliseconds>>
       saveDbTimerBackoff_;
 
+  // Single I/O thread writing and syncing encoded changes to disk in order.
+  // Only used along with save backoffs. Results are handed back to the
+  // event loop
+  std::unique_ptr<folly::CPUThreadPoolExecutor> ioExecutor_;
+
+  // Number of writes queued on ioExecutor_ which haven't completed yet
+  size_t numPendingWrites_{0};
+
+  // A write failed, the whole database is written with the next one so that
+  // changes lost with it are written as well
+  bool writeFailed_{false};
+
+  // Timer for submitting to monitor periodically
+  std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_;
+
+  // client to interact with monitor
+  std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
+
+  // Stats of writes to disk
+  fbzmq::ThreadData tData_;
+
   // Database to store config data. It is synced up on a persistent storage
   // layer (disk) in a file.
   thrift::StoreDatabase database_;
@@ -245,6 +245,122 @@ TEST(PersistentStoreTest, LoadStoreEraseTest) {
   EXPECT_EQ(database, databaseStore);
 }
 
+TEST(PersistentStoreTest, LogCompactionTest) {
+  fbzmq::Context context;
+
+  auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::string filePath{
+      folly::sformat("/tmp/aq_persistent_store_compaction_test_{}", tid)};
+  ::unlink(filePath.c_str());
+
+  // Zero backoff to write every change to disk immediately
+  auto store = std::make_unique<PersistentStore>(
+      "1", filePath, context, std::chrono::milliseconds(0),
+      std::chrono::milliseconds(0));
+  auto storeThread = std::make_unique<std::thread>([&]() { store->run(); });
+  store->waitUntilRunning();
+  auto client = std::make_unique<PersistentStoreClient>(
+      PersistentStoreUrl{store->inprocCmdUrl}, context);
+
+  // Keep overwriting the same key. Log is compacted from time to time and
+  // file never grows much beyond the size of a single record
+  const std::string val(1000, 'x');
+  for (int i = 0; i < 500; i++) {
+    auto response = client->store("key", folly::sformat("{}-{}", i, val));
+    EXPECT_TRUE(response.hasValue());
+    EXPECT_TRUE(response.value());
+  }
+  EXPECT_EQ(500, store->getNumOfDbWritesToDisk());
+  EXPECT_GT(100 * val.size(), store->getLogSizeOnDisk());
+  std::string fileData;
+  EXPECT_TRUE(folly::readFile(filePath.c_str(), fileData));
+  EXPECT_EQ(fileData.size(), store->getLogSizeOnDisk());
+
+  store->stop();
+  storeThread->join();
+  store.reset();
+
+  // Simulate a torn append by cutting the last record in half. Everything
+  // before it is recovered and new records are readable after restart
+  EXPECT_TRUE(folly::readFile(filePath.c_str(), fileData));
+  PersistentObject pObject;
+  pObject.type = ActionType::ADD;
+  pObject.key = "torn";
+  pObject.data = val;
+  auto buf = PersistentStore::encodePersistentObject(pObject);
+  ASSERT_FALSE(buf.hasError());
+  (*buf)->coalesce();
+  fileData.append(
+      reinterpret_cast<const char*>((*buf)->data()), (*buf)->length() / 2);
+  EXPECT_TRUE(folly::writeFile(fileData, filePath.c_str()));
+
+  for (int i = 0; i < 2; i++) {
+    store = std::make_unique<PersistentStore>(
+        "1", filePath, context, std::chrono::milliseconds(0),
+        std::chrono::milliseconds(0));
+    storeThread = std::make_unique<std::thread>([&]() { store->run(); });
+    store->waitUntilRunning();
+    client = std::make_unique<PersistentStoreClient>(
+        PersistentStoreUrl{store->inprocCmdUrl}, context);
+
+    auto responseLoad = client->load<std::string>("key");
+    EXPECT_TRUE(responseLoad.hasValue());
+    EXPECT_EQ(folly::sformat("499-{}", val), responseLoad.value());
+    EXPECT_TRUE(client->load<std::string>("torn").hasError());
+    if (i == 0) {
+      EXPECT_TRUE(client->store("new-key", std::string("new-val")).value());
+    } else {
+      EXPECT_EQ("new-val", client->load<std::string>("new-key").value());
+    }
+
+    store->stop();
+    storeThread->join();
+    store.reset();
+  }
+}
+
+TEST(PersistentStoreTest, AsyncWriteTest) {
+  fbzmq::Context context;
+
+  auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::string filePath{
+      folly::sformat("/tmp/aq_persistent_store_async_test_{}", tid)};
+  ::unlink(filePath.c_str());
+
+  // Changes are written on the I/O thread after save backoff
+  auto store = std::make_unique<PersistentStore>(
+      "1", filePath, context, std::chrono::milliseconds(1),
+      std::chrono::milliseconds(10));
+  auto storeThread = std::make_unique<std::thread>([&]() { store->run(); });
+  store->waitUntilRunning();
+  auto client = std::make_unique<PersistentStoreClient>(
+      PersistentStoreUrl{store->inprocCmdUrl}, context);
+
+  for (int i = 0; i < 100; i++) {
+    auto response = client->store(
+        folly::sformat("key-{}", i), folly::sformat("val-{}", i));
+    EXPECT_TRUE(response.hasValue());
+    EXPECT_TRUE(response.value());
+  }
+  EXPECT_TRUE(client->erase("key-0").value());
+
+  // Written changes are on disk, everything is once store is destroyed
+  while (store->getNumOfDbWritesToDisk() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  store->stop();
+  storeThread->join();
+  store.reset();
+
+  store = std::make_unique<PersistentStore>("1", filePath, context);
+  auto const database = loadDatabaseFromDisk(filePath, store);
+  EXPECT_EQ(99, database.keyVals.size());
+  EXPECT_EQ(0, database.keyVals.count("key-0"));
+  EXPECT_EQ("val-99", database.keyVals.at("key-99"));
+  store.reset();
+  ::unlink(filePath.c_str());
+}
+
 } // namespace openr
 
 int
@@ -9,17 +9,170 @@
 
 #include <re2/re2.h>
 
+#include <fbzmq/service/resource-monitor/ResourceMonitor.h>
 #include <folly/ExceptionString.h>
+#include <folly/String.h>
 #include <folly/io/async/SSLContext.h>
 #include <folly/io/async/ssl/OpenSSLUtils.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
 #include <thrift/lib/cpp2/server/ThriftServer.h>
 
 #include <openr/common/Constants.h>
+#include <openr/decision/Decision.h>
+#include <openr/fib/Fib.h>
 #include <openr/if/gen-cpp2/PersistentStore_types.h>
 #include <openr/if/gen-cpp2/PrefixManager_types.h>
 
 namespace openr {
 
+namespace {
+
+// Failed future for request to module which is not running
+template <typename T>
+folly::SemiFuture<std::unique_ptr<T>>
+moduleNotAvailable(thrift::OpenrModuleType module) {
+  return folly::makeSemiFuture<std::unique_ptr<T>>(
+      folly::make_exception_wrapper<thrift::OpenrError>(folly::sformat(
+          "Module {} is not available",
+          apache::thrift::TEnumTraits<thrift::OpenrModuleType>::findName(
+              module))));
+}
+
+// Authorization decision of a connection, owned by the user data of its
+// connection context
+struct ConnectionAuthorization {
+  bool authorized{false};
+  std::string peerCommonName;
+};
+
+void
+deleteConnectionAuthorization(void* data) {
+  delete static_cast<ConnectionAuthorization*>(data);
+}
+
+// jemalloc statistic of type T, e.g. size_t for "stats.active"
+template <typename T>
+int64_t
+readMallctl(const std::string& name) {
+  T value{0};
+  folly::mallctlRead(name.c_str(), &value);
+  return static_cast<int64_t>(value);
+}
+
+// key-values of publication matching filters, without values in hash-only
+// mode
+thrift::Publication
+getFilteredPublication(
+    thrift::Publication const& publication,
+    folly::Optional<KvStoreFilters> const& filters,
+    bool doNotPublishValue) {
+  thrift::Publication filteredPub;
+  for (auto const& kv : publication.keyVals) {
+    if (filters.hasValue() and not filters->keyMatch(kv.first, kv.second)) {
+      continue;
+    }
+    if (not doNotPublishValue) {
+      filteredPub.keyVals.emplace(kv.first, kv.second);
+      continue;
+    }
+    auto& value = filteredPub.keyVals[kv.first];
+    value.version = kv.second.version;
+    value.originatorId = kv.second.originatorId;
+    value.hash = kv.second.hash;
+    value.ttl = kv.second.ttl;
+    value.ttlVersion = kv.second.ttlVersion;
+  }
+  for (auto const& key : publication.expiredKeys) {
+    if (filters.hasValue() and not filters->keyPrefixMatch(key)) {
+      continue;
+    }
+    filteredPub.expiredKeys.emplace_back(key);
+  }
+  return filteredPub;
+}
+
+// Max number of idle sockets kept per module. There are at most as many
+// sockets as concurrent requests to a module
+const size_t kMaxIdleModuleSockets{8};
+
+// True if network is within any of the given networks, or if there are none
+bool
+isWithinAnyNetwork(
+    folly::CIDRNetwork const& network,
+    std::vector<folly::CIDRNetwork> const& networks) {
+  if (networks.empty()) {
+    return true;
+  }
+  for (auto const& other : networks) {
+    if (network.first.family() == other.first.family() and
+        network.second >= other.second and
+        network.first.inSubnet(other.first, other.second)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<folly::CIDRNetwork>
+toIPNetworks(std::vector<thrift::IpPrefix> const& prefixes) {
+  std::vector<folly::CIDRNetwork> networks;
+  networks.reserve(prefixes.size());
+  for (auto const& prefix : prefixes) {
+    networks.emplace_back(toIPNetwork(prefix));
+  }
+  return networks;
+}
+
+// Sort entries and cut them down to `limit` ones unless it is 0. Returns
+// cursor of the last entry kept if any were cut
+template <typename Entry, typename Compare, typename ToCursor>
+folly::Optional<std::string>
+truncateToPage(
+    std::vector<Entry>& entries,
+    int32_t limit,
+    Compare&& compare,
+    ToCursor&& toCursor) {
+  if (limit <= 0 or entries.size() <= static_cast<size_t>(limit)) {
+    std::sort(entries.begin(), entries.end(), compare);
+    return folly::none;
+  }
+  std::partial_sort(
+      entries.begin(), entries.begin() + limit, entries.end(), compare);
+  entries.resize(limit);
+  return toCursor(entries.back());
+}
+
+// Page of databases of a node-name keyed map of the solver snapshot
+template <typename DbMap>
+std::vector<typename DbMap::const_pointer>
+getDbsPage(
+    DbMap const& dbs,
+    thrift::DecisionQuery const& query,
+    folly::Optional<std::string>& nextCursor) {
+  std::unordered_set<std::string> nodeNames(
+      query.nodeNames.begin(), query.nodeNames.end());
+  std::vector<typename DbMap::const_pointer> entries;
+  for (auto const& kv : dbs) {
+    if (query.cursor.hasValue() and kv.first <= query.cursor.value()) {
+      continue;
+    }
+    if (not nodeNames.empty() and not nodeNames.count(kv.first)) {
+      continue;
+    }
+    entries.emplace_back(&kv);
+  }
+  using Ptr = typename DbMap::const_pointer;
+  nextCursor = truncateToPage(
+      entries,
+      query.limit,
+      [](Ptr const& a, Ptr const& b) { return a->first < b->first; },
+      [](Ptr const& entry) { return entry->first; });
+  return entries;
+}
+
+} // namespace
+
 OpenrCtrlHandler::OpenrCtrlHandler(
     const std::string& nodeName,
     const std::unordered_set<std::string>& acceptablePeerCommonNames,
@@ -34,6 +187,7 @@ OpenrCtrlHandler::OpenrCtrlHandler(
       nodeName_(nodeName),
       acceptablePeerCommonNames_(acceptablePeerCommonNames),
       moduleTypeToEvl_(moduleTypeToEvl),
+      context_(context),
       evl_(evl),
       kvStoreSubSock_(context) {
   // Create monitor client
@@ -71,41 +225,72 @@ OpenrCtrlHandler::OpenrCtrlHandler(
             return;
           }
 
-          SYNCHRONIZED(kvStorePublishers_) {
-            for (auto& kv : kvStorePublishers_) {
-              kv.second.next(maybePublication.value());
-            }
-          }
+          publishKvStorePublication(maybePublication.value());
         });
   });
 
   for (const auto& kv : moduleTypeToEvl_) {
-    auto moduleType = kv.first;
-    auto& inprocUrl = kv.second->inprocCmdUrl;
-    auto result = moduleSockets_.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(moduleType),
-        std::forward_as_tuple(
-            context, folly::none, folly::none, fbzmq::NonblockingFlag{false}));
-    auto& sock = result.first->second;
-    int enabled = 1;
-    // if we do not get a reply within the timeout, we reset the state
-    sock.setSockOpt(ZMQ_REQ_RELAXED, &enabled, sizeof(int));
-    sock.setSockOpt(ZMQ_REQ_CORRELATE, &enabled, sizeof(int));
-
-    const auto rc = sock.connect(fbzmq::SocketUrl{inprocUrl});
-    if (rc.hasError()) {
-      LOG(FATAL) << "Error connecting to URL '" << kv.second << "' "
-                 << rc.error();
+    auto pool = std::make_unique<ModuleSocketPool>(kv.second->inprocCmdUrl);
+    // verify connectivity upfront and keep the socket for first request
+    releaseModuleSocket(*pool, acquireModuleSocket(*pool));
+    moduleSockets_.emplace(kv.first, std::move(pool));
+  }
+
+  // Feed fib route streams from route changes applied by Fib
+  if (auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB)) {
+    fib->setRouteDbDeltaCallback(
+        [fibPublishers = fibPublishers_](
+            thrift::RouteDatabaseDelta const& delta) {
+          publishRouteDbDelta(*fibPublishers, delta);
+        });
+    fib->setPerfEventsCallback(
+        [perfEventsPublishers = perfEventsPublishers_](
+            thrift::PerfEvents const& perfEvents) {
+          publishPerfEvents(*perfEventsPublishers, perfEvents);
+        });
+  }
+}
+
+std::unique_ptr<OpenrCtrlHandler::ModuleSocketPool::Socket>
+OpenrCtrlHandler::acquireModuleSocket(ModuleSocketPool& pool) {
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (not pool.idleSockets.empty()) {
+      auto sock = std::move(pool.idleSockets.back());
+      pool.idleSockets.pop_back();
+      return sock;
     }
   }
+
+  auto sock = std::make_unique<ModuleSocketPool::Socket>(
+      context_, folly::none, folly::none, fbzmq::NonblockingFlag{false});
+  int enabled = 1;
+  // if we do not get a reply within the timeout, we reset the state
+  sock->setSockOpt(ZMQ_REQ_RELAXED, &enabled, sizeof(int));
+  sock->setSockOpt(ZMQ_REQ_CORRELATE, &enabled, sizeof(int));
+
+  const auto rc = sock->connect(fbzmq::SocketUrl{pool.inprocUrl});
+  if (rc.hasError()) {
+    LOG(FATAL) << "Error connecting to URL '" << pool.inprocUrl << "' "
+               << rc.error();
+  }
+  return sock;
+}
+
+void
+OpenrCtrlHandler::releaseModuleSocket(
+    ModuleSocketPool& pool, std::unique_ptr<ModuleSocketPool::Socket> sock) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (pool.idleSockets.size() < kMaxIdleModuleSockets) {
+    pool.idleSockets.emplace_back(std::move(sock));
+  }
 }
 
 OpenrCtrlHandler::~OpenrCtrlHandler() {
   evl_.removeSocket(fbzmq::RawZmqSocketPtr{*kvStoreSubSock_});
   kvStoreSubSock_.close();
 
-  std::vector<apache::thrift::StreamPublisher<thrift::Publication>> publishers;
+  std::vector<std::shared_ptr<KvStorePublisher>> publishers;
   // NOTE: We're intentionally creating list of publishers to and then invoke
   // `complete()` on them.
   // Reason => `complete()` returns only when callback `onComplete` associated
@@ -114,25 +299,268 @@ OpenrCtrlHandler::~OpenrCtrlHandler() {
   // SYNCHRONIZED block
   SYNCHRONIZED(kvStorePublishers_) {
     for (auto& kv : kvStorePublishers_) {
-      publishers.emplace_back(std::move(kv.second));
+      publishers.emplace_back(kv.second);
     }
   }
   LOG(INFO) << "Terminating " << publishers.size()
             << " active KvStore snoop stream(s).";
   for (auto& publisher : publishers) {
+    publisher->complete();
+  }
+
+  std::vector<std::shared_ptr<KvStorePeerPublisher>> peerPublishers;
+  for (auto& kv : *kvStorePeerPublishers_.rlock()) {
+    peerPublishers.emplace_back(kv.second);
+  }
+  LOG(INFO) << "Terminating " << peerPublishers.size()
+            << " active KvStore peer stream(s).";
+  for (auto& publisher : peerPublishers) {
+    publisher->complete();
+  }
+
+  if (auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB)) {
+    fib->setRouteDbDeltaCallback(nullptr);
+    fib->setPerfEventsCallback(nullptr);
+  }
+  std::vector<std::shared_ptr<FibPublisher>> fibPublishers;
+  for (auto& kv : *fibPublishers_->rlock()) {
+    fibPublishers.emplace_back(kv.second);
+  }
+  LOG(INFO) << "Terminating " << fibPublishers.size()
+            << " active Fib route stream(s).";
+  for (auto& publisher : fibPublishers) {
+    publisher->complete();
+  }
+  std::vector<std::shared_ptr<PerfEventsPublisher>> perfEventsPublishers;
+  for (auto& kv : *perfEventsPublishers_->rlock()) {
+    perfEventsPublishers.emplace_back(kv.second);
+  }
+  LOG(INFO) << "Terminating " << perfEventsPublishers.size()
+            << " active Fib perf events stream(s).";
+  for (auto& publisher : perfEventsPublishers) {
+    publisher->complete();
+  }
+}
+
+void
+OpenrCtrlHandler::KvStorePublisher::complete() {
+  if (not completed.exchange(true)) {
     std::move(publisher).complete();
   }
 }
 
+bool
+OpenrCtrlHandler::KvStorePeerPublisher::push(
+    thrift::KeySetParams const& params) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (completed) {
+    // subscriber full-syncs once it notices the end of stream
+    return true;
+  }
+  if (pendingBatches >= Constants::kKvStorePeerStreamMaxPendingBatches) {
+    if (bufferedParams.size() >=
+        Constants::kKvStorePeerStreamMaxBufferedRequests) {
+      return false;
+    }
+    bufferedParams.emplace_back(params);
+    return true;
+  }
+  ++pendingBatches;
+  thrift::KeySetParamsBatch batch;
+  batch.keySetParams.emplace_back(params);
+  publisher.next(std::move(batch));
+  return true;
+}
+
+void
+OpenrCtrlHandler::KvStorePeerPublisher::pop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  --pendingBatches;
+  if (completed or bufferedParams.empty()) {
+    return;
+  }
+  ++pendingBatches;
+  thrift::KeySetParamsBatch batch;
+  batch.keySetParams = std::move(bufferedParams);
+  bufferedParams.clear();
+  publisher.next(std::move(batch));
+}
+
+void
+OpenrCtrlHandler::KvStorePeerPublisher::complete() {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (completed) {
+    return;
+  }
+  completed = true;
+  bufferedParams.clear();
+  // onComplete callback must not contend for the lock
+  auto completedPublisher = std::move(publisher);
+  lock.unlock();
+  std::move(completedPublisher).complete();
+}
+
+void
+OpenrCtrlHandler::FibPublisher::complete() {
+  if (not completed.exchange(true)) {
+    std::move(publisher).complete();
+  }
+}
+
+void
+OpenrCtrlHandler::PerfEventsPublisher::complete() {
+  if (not completed.exchange(true)) {
+    std::move(publisher).complete();
+  }
+}
+
+void
+OpenrCtrlHandler::publishRouteDbDelta(
+    FibPublishers& fibPublishers, thrift::RouteDatabaseDelta delta) {
+  std::vector<std::shared_ptr<FibPublisher>> publishers;
+  SYNCHRONIZED(fibPublishers) {
+    publishers.reserve(fibPublishers.size());
+    for (auto const& kv : fibPublishers) {
+      publishers.emplace_back(kv.second);
+    }
+  }
+  if (publishers.empty()) {
+    return;
+  }
+
+  // send each unique ECMP group only once
+  compressNextHopGroups(delta);
+  for (auto& fibPublisher : publishers) {
+    if (fibPublisher->completed) {
+      continue;
+    }
+
+    // Drop subscriber which isn't keeping up, it will get a fresh snapshot
+    // on re-subscribing
+    if (*fibPublisher->pendingDeltas >=
+        Constants::kMaxFibSubscriberPendingDeltas) {
+      LOG(WARNING) << "Dropping lagging Fib route stream with "
+                   << *fibPublisher->pendingDeltas << " pending deltas.";
+      fibPublisher->complete();
+      continue;
+    }
+    (*fibPublisher->pendingDeltas)++;
+    fibPublisher->publisher.next(delta);
+  }
+}
+
+void
+OpenrCtrlHandler::publishPerfEvents(
+    PerfEventsPublishers& perfEventsPublishers,
+    thrift::PerfEvents const& perfEvents) {
+  std::vector<std::shared_ptr<PerfEventsPublisher>> publishers;
+  SYNCHRONIZED(perfEventsPublishers) {
+    publishers.reserve(perfEventsPublishers.size());
+    for (auto const& kv : perfEventsPublishers) {
+      publishers.emplace_back(kv.second);
+    }
+  }
+
+  for (auto& publisher : publishers) {
+    if (publisher->completed) {
+      continue;
+    }
+
+    // Drop subscriber lagging behind by more than Fib's perf buffer, it will
+    // get timelines still buffered on re-subscribing
+    if (*publisher->pendingPerfEvents >= Constants::kPerfBufferSize) {
+      LOG(WARNING) << "Dropping lagging Fib perf events stream with "
+                   << *publisher->pendingPerfEvents << " pending timelines.";
+      publisher->complete();
+      continue;
+    }
+    (*publisher->pendingPerfEvents)++;
+    publisher->publisher.next(perfEvents);
+  }
+}
+
+void
+OpenrCtrlHandler::publishKvStorePublication(
+    thrift::Publication const& publication) {
+  std::vector<std::shared_ptr<KvStorePublisher>> publishers;
+  SYNCHRONIZED(kvStorePublishers_) {
+    publishers.reserve(kvStorePublishers_.size());
+    for (auto const& kv : kvStorePublishers_) {
+      publishers.emplace_back(kv.second);
+    }
+  }
+
+  for (auto& kvStorePublisher : publishers) {
+    if (kvStorePublisher->completed) {
+      continue;
+    }
+
+    // Drop subscriber which isn't keeping up instead of buffering unbounded
+    // publications for it. It will get a fresh snapshot on re-subscribing.
+    if (*kvStorePublisher->pendingPubs >=
+        Constants::kMaxKvStoreSubscriberPendingPubs) {
+      LOG(WARNING) << "Dropping lagging KvStore snoop stream with "
+                   << *kvStorePublisher->pendingPubs
+                   << " pending publications.";
+      numDroppedKvStorePublishers_++;
+      kvStorePublisher->complete();
+      continue;
+    }
+
+    if (not kvStorePublisher->filters.hasValue() and
+        not kvStorePublisher->doNotPublishValue) {
+      (*kvStorePublisher->pendingPubs)++;
+      kvStorePublisher->publisher.next(publication);
+      continue;
+    }
+    auto filteredPub = getFilteredPublication(
+        publication,
+        kvStorePublisher->filters,
+        kvStorePublisher->doNotPublishValue);
+    if (filteredPub.keyVals.empty() and filteredPub.expiredKeys.empty()) {
+      continue;
+    }
+    (*kvStorePublisher->pendingPubs)++;
+    kvStorePublisher->publisher.next(std::move(filteredPub));
+  }
+}
+
 void
 OpenrCtrlHandler::authorizeConnection() {
   auto connContext = getConnectionContext()->getConnectionContext();
-  auto peerCommonName = connContext->getPeerCommonName();
-  auto peerAddr = connContext->getPeerAddress();
+  ConnectionAuthorization const* authorization{nullptr};
+  {
+    std::lock_guard<std::mutex> lock(authorizationCacheMutex_);
+    authorization =
+        static_cast<ConnectionAuthorization const*>(connContext->getUserData());
+    if (authorization) {
+      ++numAuthorizationCacheHits_;
+    } else {
+      ++numAuthorizationCacheMisses_;
+      auto newAuthorization = std::make_unique<ConnectionAuthorization>();
+      newAuthorization->peerCommonName = connContext->getPeerCommonName();
+      newAuthorization->authorized = isConnectionAuthorized(*connContext);
+      authorization = newAuthorization.get();
+      connContext->setUserData(
+          newAuthorization.release(), deleteConnectionAuthorization);
+    }
+  }
+
+  if (not authorization->authorized) {
+    throw thrift::OpenrError(folly::sformat(
+        "Peer name {} is unacceptable", authorization->peerCommonName));
+  }
+}
+
+bool
+OpenrCtrlHandler::isConnectionAuthorized(
+    apache::thrift::Cpp2ConnContext const& connContext) {
+  auto peerCommonName = connContext.getPeerCommonName();
+  auto peerAddr = connContext.getPeerAddress();
 
   // We legitely accepts all connections (secure/non-secure) from localhost
   if (peerAddr->isLoopbackAddress()) {
-    return;
+    return true;
   }
 
   if (peerCommonName.empty() || acceptablePeerCommonNames_.empty()) {
@@ -145,8 +573,7 @@ OpenrCtrlHandler::authorizeConnection() {
         peerCommonName.empty() ? "UNENCRYPTED_CTRL_CONNECTION"
                                : "UNRESTRICTED_AUTHORIZATION");
     sample.addString("node_name", nodeName_);
-    sample.addString(
-        "peer_address", connContext->getPeerAddress()->getAddressStr());
+    sample.addString("peer_address", peerAddr->getAddressStr());
     sample.addString("peer_common_name", peerCommonName);
 
     zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
@@ -154,14 +581,11 @@ OpenrCtrlHandler::authorizeConnection() {
         Constants::kEventLogCategory.toString(),
         {sample.toJson()}));
 
-    LOG(INFO) << "Authorizing request with issues: " << sample.toJson();
-    return;
+    LOG(INFO) << "Authorizing connection with issues: " << sample.toJson();
+    return true;
   }
 
-  if (!acceptablePeerCommonNames_.count(peerCommonName)) {
-    throw thrift::OpenrError(
-        folly::sformat("Peer name {} is unacceptable", peerCommonName));
-  }
+  return acceptablePeerCommonNames_.count(peerCommonName) != 0;
 }
 
 folly::Expected<fbzmq::Message, fbzmq::Error>
@@ -174,19 +598,40 @@ OpenrCtrlHandler::requestReplyMessage(
         0, folly::sformat("Unknown module {}", static_cast<int>(module))));
   }
 
-  // Send request
-  auto& sock = moduleIt->second;
-  auto sendRet = sock.sendOne(std::move(request));
+  // Send request on a socket of our own
+  auto& pool = *moduleIt->second;
+  const auto startTime = std::chrono::steady_clock::now();
+  auto sock = acquireModuleSocket(pool);
+  auto sendRet = sock->sendOne(std::move(request));
   if (sendRet.hasError()) {
     return folly::makeUnexpected(sendRet.error());
   }
 
   // Recv response if not oneway
   if (oneway) {
+    releaseModuleSocket(pool, std::move(sock));
     return fbzmq::Message();
-  } else {
-    return sock.recvOne(Constants::kReadTimeout);
   }
+  pool.numInFlight++;
+  auto reply = sock->recvOne(Constants::kReadTimeout);
+  pool.numInFlight--;
+  pool.latency.wlock()->addValue(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime));
+  if (reply.hasValue()) {
+    releaseModuleSocket(pool, std::move(sock));
+  }
+  return reply;
+}
+
+template <typename ModuleType>
+std::shared_ptr<ModuleType>
+OpenrCtrlHandler::getModule(thrift::OpenrModuleType module) {
+  auto it = moduleTypeToEvl_.find(module);
+  if (it == moduleTypeToEvl_.end()) {
+    return nullptr;
+  }
+  return std::dynamic_pointer_cast<ModuleType>(it->second);
 }
 
 template <typename ReturnType, typename InputType>
@@ -265,8 +710,16 @@ OpenrCtrlHandler::semifuture_getEventLogs() {
 
   auto eventLogs = zmqMonitorClient_->getLastEventLogs();
   if (eventLogs.hasValue()) {
+    // events of modules which were not exported to monitor yet, rendered
+    // only now
+    for (auto const& kv : moduleTypeToEvl_) {
+      const auto entries = kv.second->getPendingEventLogs();
+      if (not entries.empty()) {
+        eventLogs->emplace_back(toEventLog(entries));
+      }
+    }
     p.setValue(std::make_unique<std::vector<fbzmq::thrift::EventLog>>(
-        eventLogs.value()));
+        std::move(eventLogs).value()));
   } else {
     p.setException(
         thrift::OpenrError(std::string("Fail to retrieve eventlogs")));
@@ -281,42 +734,110 @@ OpenrCtrlHandler::getCounters(std::map<std::string, int64_t>& _return) {
   for (auto const& kv : zmqMonitorClient_->dumpCounters()) {
     _return.emplace(kv.first, static_cast<int64_t>(kv.second.value));
   }
+
+  // KvStore snoop stream counters
+  int64_t numLaggingPublishers{0};
+  SYNCHRONIZED(kvStorePublishers_) {
+    _return["ctrl.kvstore_publishers"] = kvStorePublishers_.size();
+    for (auto const& kv : kvStorePublishers_) {
+      if (*kv.second->pendingPubs * 2 >=
+          Constants::kMaxKvStoreSubscriberPendingPubs) {
+        numLaggingPublishers++;
+      }
+    }
+  }
+  _return["ctrl.kvstore_publishers_lagging"] = numLaggingPublishers;
+  _return["ctrl.kvstore_publishers_dropped"] = numDroppedKvStorePublishers_;
+  _return["ctrl.authorization_cache_hits"] = numAuthorizationCacheHits_;
+  _return["ctrl.authorization_cache_misses"] = numAuthorizationCacheMisses_;
+  _return["ctrl.kvstore_peer_publishers"] =
+      kvStorePeerPublishers_.rlock()->size();
+  _return["ctrl.fib_publishers"] = fibPublishers_->rlock()->size();
+  _return["ctrl.perf_events_publishers"] =
+      perfEventsPublishers_->rlock()->size();
+
+  // Module request counters
+  for (auto const& kv : moduleSockets_) {
+    const auto moduleName =
+        apache::thrift::TEnumTraits<thrift::OpenrModuleType>::findName(
+            kv.first);
+    _return[folly::sformat("ctrl.module_requests_in_flight.{}", moduleName)] =
+        kv.second->numInFlight;
+    kv.second->latency.rlock()->exportCounters(
+        folly::sformat("ctrl.module_latency_ms.{}", moduleName), _return);
+  }
+}
+
+std::shared_ptr<const std::map<std::string, int64_t>>
+OpenrCtrlHandler::getCachedCounters() {
+  const auto now = std::chrono::steady_clock::now();
+  auto cache = counterCache_.wlock();
+  if (cache->counters and
+      now - cache->updateTime < Constants::kCounterCacheTtl) {
+    return cache->counters;
+  }
+
+  // Concurrent queries wait for this one instead of all dumping counters
+  auto counters = std::make_shared<std::map<std::string, int64_t>>();
+  getCounters(*counters);
+  cache->counters = std::move(counters);
+  cache->updateTime = now;
+  for (auto& kv : cache->regexes) {
+    kv.second.matches = nullptr;
+  }
+  return cache->counters;
 }
 
 void
 OpenrCtrlHandler::getRegexCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::string> regex) {
-  // Compile regex
-  re2::RE2 compiledRegex(*regex);
-  if (not compiledRegex.ok()) {
-    return;
-  }
-
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
+  // Refresh snapshot if needed, its regex results are reset then
+  getCachedCounters();
+
+  std::shared_ptr<const std::map<std::string, int64_t>> matches;
+  SYNCHRONIZED(counterCache_) {
+    auto it = counterCache_.regexes.find(*regex);
+    if (it == counterCache_.regexes.end()) {
+      // Compile regex
+      auto compiledRegex = std::make_unique<re2::RE2>(*regex);
+      if (not compiledRegex->ok()) {
+        return;
+      }
+      if (counterCache_.regexes.size() >= Constants::kMaxCachedCounterRegexes) {
+        counterCache_.regexes.clear();
+      }
+      it = counterCache_.regexes.emplace(*regex, CounterCache::RegexEntry{})
+               .first;
+      it->second.regex = std::move(compiledRegex);
+    }
 
-  // Filter counters
-  for (auto const& kv : counters) {
-    if (RE2::PartialMatch(kv.first, compiledRegex)) {
-      _return.emplace(kv);
+    // Filter counters, unless done already for this snapshot
+    if (not it->second.matches) {
+      auto newMatches = std::make_shared<std::map<std::string, int64_t>>();
+      for (auto const& kv : *counterCache_.counters) {
+        if (RE2::PartialMatch(kv.first, *it->second.regex)) {
+          newMatches->emplace_hint(newMatches->end(), kv);
+        }
+      }
+      it->second.matches = std::move(newMatches);
     }
+    matches = it->second.matches;
   }
+
+  _return = *matches;
 }
 
 void
 OpenrCtrlHandler::getSelectedCounters(
     std::map<std::string, int64_t>& _return,
     std::unique_ptr<std::vector<std::string>> keys) {
-  // Get all counters
-  std::map<std::string, int64_t> counters;
-  getCounters(counters);
+  auto counters = getCachedCounters();
 
-  // Filter counters
+  // Point lookups in snapshot
   for (auto const& key : *keys) {
-    auto it = counters.find(key);
-    if (it != counters.end()) {
+    auto it = counters->find(key);
+    if (it != counters->end()) {
       _return.emplace(*it);
     }
   }
@@ -336,6 +857,77 @@ OpenrCtrlHandler::getMyNodeName(std::string& _return) {
   _return = std::string(nodeName_);
 }
 
+void
+OpenrCtrlHandler::getMemoryStats(thrift::MemoryStats& _return) {
+  fbzmq::ResourceMonitor resourceMonitor;
+  _return.rssBytes = resourceMonitor.getRSSMemBytes().value_or(0);
+  _return.usingJemalloc = folly::usingJEMalloc();
+  if (not _return.usingJemalloc) {
+    return;
+  }
+
+  try {
+    // statistics are snapshots, refreshed on epoch update
+    folly::mallctlWrite<uint64_t>("epoch", 1);
+    _return.allocatedBytes = readMallctl<size_t>("stats.allocated");
+    _return.activeBytes = readMallctl<size_t>("stats.active");
+    _return.residentBytes = readMallctl<size_t>("stats.resident");
+    _return.mappedBytes = readMallctl<size_t>("stats.mapped");
+    _return.retainedBytes = readMallctl<size_t>("stats.retained");
+    _return.metadataBytes = readMallctl<size_t>("stats.metadata");
+
+    const auto pageSize = readMallctl<size_t>("arenas.page");
+    const auto numArenas = readMallctl<unsigned>("arenas.narenas");
+    for (int32_t i = 0; i < numArenas; ++i) {
+      const auto prefix = folly::sformat("stats.arenas.{}.", i);
+      thrift::ArenaMemoryStats arena;
+      arena.index = i;
+      arena.numThreads = readMallctl<unsigned>(prefix + "nthreads");
+      // uninitialized arenas are not assigned to any thread
+      if (arena.numThreads == 0) {
+        continue;
+      }
+      arena.activeBytes = readMallctl<size_t>(prefix + "pactive") * pageSize;
+      arena.dirtyBytes = readMallctl<size_t>(prefix + "pdirty") * pageSize;
+      arena.tcacheBytes = readMallctl<size_t>(prefix + "tcache_bytes");
+      _return.arenas.emplace_back(std::move(arena));
+    }
+  } catch (std::exception const& ex) {
+    throw thrift::OpenrError(folly::sformat(
+        "Failed reading allocator statistics: {}", folly::exceptionStr(ex)));
+  }
+}
+
+void
+OpenrCtrlHandler::dumpHeapProfile(std::unique_ptr<std::string> path) {
+  if (path->empty()) {
+    throw thrift::OpenrError(std::string("Heap profile path is empty"));
+  }
+  if (not folly::usingJEMalloc()) {
+    throw thrift::OpenrError(
+        std::string("Heap profiles require running with jemalloc"));
+  }
+
+  try {
+    folly::mallctlWrite<const char*>("prof.dump", path->c_str());
+  } catch (std::exception const& ex) {
+    throw thrift::OpenrError(folly::sformat(
+        "Failed dumping heap profile to {}, is heap profiling enabled? {}",
+        *path,
+        folly::exceptionStr(ex)));
+  }
+  LOG(INFO) << "Dumped heap profile to " << *path;
+}
+
+void
+OpenrCtrlHandler::setEventLoopProfiling(bool enabled) {
+  LOG(INFO) << (enabled ? "Enabling" : "Disabling")
+            << " event loop profiling of all modules";
+  for (auto const& kv : moduleTypeToEvl_) {
+    kv.second->setProfilingEnabled(enabled);
+  }
+}
+
 folly::SemiFuture<folly::Unit>
 OpenrCtrlHandler::semifuture_advertisePrefixes(
     std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) {
@@ -362,6 +954,21 @@ OpenrCtrlHandler::semifuture_withdrawPrefixes(
       false /* oneway */);
 }
 
+folly::SemiFuture<folly::Unit>
+OpenrCtrlHandler::semifuture_updatePrefixes(
+    std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixesToAdvertise,
+    std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixesToWithdraw) {
+  thrift::PrefixManagerRequest request;
+  request.cmd = thrift::PrefixManagerCommand::UPDATE_PREFIXES;
+  request.prefixes = std::move(*prefixesToAdvertise);
+  request.withdrawPrefixes = std::move(*prefixesToWithdraw);
+
+  return processThriftRequest(
+      thrift::OpenrModuleType::PREFIX_MANAGER,
+      std::move(request),
+      false /* oneway */);
+}
+
 folly::SemiFuture<folly::Unit>
 OpenrCtrlHandler::semifuture_withdrawPrefixesByType(
     thrift::PrefixType prefixType) {
@@ -435,117 +1042,183 @@ OpenrCtrlHandler::semifuture_getPrefixesByType(thrift::PrefixType prefixType) {
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDb() {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
-
-  thrift::FibRequest request;
-  request.cmd = thrift::FibCommand::ROUTE_DB_GET;
-
-  auto reply = requestReplyThrift<thrift::RouteDatabase>(
-      thrift::OpenrModuleType::FIB, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(
-        std::make_unique<thrift::RouteDatabase>(std::move(reply.value())));
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return moduleNotAvailable<thrift::RouteDatabase>(
+        thrift::OpenrModuleType::FIB);
   }
+  return fib->getRouteDb();
+}
 
-  return p.getSemiFuture();
+folly::SemiFuture<std::unique_ptr<thrift::UnicastRoute>>
+OpenrCtrlHandler::semifuture_getRouteForAddress(
+    std::unique_ptr<thrift::BinaryAddress> address) {
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return moduleNotAvailable<thrift::UnicastRoute>(
+        thrift::OpenrModuleType::FIB);
+  }
+  return fib->getRouteForAddress(std::move(*address));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDbUnInstallable() {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
-
-  thrift::FibRequest request;
-  request.cmd = thrift::FibCommand::ROUTE_DB_UNINSTALLABLE_GET;
-
-  auto reply = requestReplyThrift<thrift::RouteDatabase>(
-      thrift::OpenrModuleType::FIB, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(
-        std::make_unique<thrift::RouteDatabase>(std::move(reply.value())));
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return moduleNotAvailable<thrift::RouteDatabase>(
+        thrift::OpenrModuleType::FIB);
   }
-
-  return p.getSemiFuture();
+  return fib->getRouteDbUnInstallable();
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
 OpenrCtrlHandler::semifuture_getRouteDbComputed(
     std::unique_ptr<std::string> nodeName) {
-  folly::Promise<std::unique_ptr<thrift::RouteDatabase>> p;
-
-  thrift::DecisionRequest request;
-  request.cmd = thrift::DecisionCommand::ROUTE_DB_GET;
-  request.nodeName = std::move(*nodeName);
-
-  auto reply = requestReplyThrift<thrift::DecisionReply>(
-      thrift::OpenrModuleType::DECISION, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(
-        std::make_unique<thrift::RouteDatabase>(std::move(reply->routeDb)));
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::RouteDatabase>(
+        thrift::OpenrModuleType::DECISION);
   }
-
-  return p.getSemiFuture();
+  return decision->getDecisionRouteDb(std::move(*nodeName));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>>
 OpenrCtrlHandler::semifuture_getPerfDb() {
-  folly::Promise<std::unique_ptr<thrift::PerfDatabase>> p;
-
-  thrift::FibRequest request;
-  request.cmd = thrift::FibCommand::PERF_DB_GET;
-
-  auto reply = requestReplyThrift<thrift::PerfDatabase>(
-      thrift::OpenrModuleType::FIB, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(
-        std::make_unique<thrift::PerfDatabase>(std::move(reply.value())));
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return moduleNotAvailable<thrift::PerfDatabase>(
+        thrift::OpenrModuleType::FIB);
   }
-
-  return p.getSemiFuture();
+  return fib->getPerfDb();
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
 OpenrCtrlHandler::semifuture_getDecisionAdjacencyDbs() {
-  folly::Promise<std::unique_ptr<thrift::AdjDbs>> p;
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::AdjDbs>(
+        thrift::OpenrModuleType::DECISION);
+  }
+  return decision->getDecisionAdjacencyDbs();
+}
 
-  thrift::DecisionRequest request;
-  request.cmd = thrift::DecisionCommand::ADJ_DB_GET;
+folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
+OpenrCtrlHandler::semifuture_getDecisionPrefixDbs() {
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::PrefixDbs>(
+        thrift::OpenrModuleType::DECISION);
+  }
+  return decision->getDecisionPrefixDbs();
+}
 
-  auto reply = requestReplyThrift<thrift::DecisionReply>(
-      thrift::OpenrModuleType::DECISION, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(std::make_unique<thrift::AdjDbs>(std::move(reply->adjDbs)));
+folly::SemiFuture<std::unique_ptr<thrift::RouteDbPage>>
+OpenrCtrlHandler::semifuture_getRouteDbComputedPage(
+    std::unique_ptr<thrift::DecisionQuery> query) {
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::RouteDbPage>(
+        thrift::OpenrModuleType::DECISION);
   }
 
-  return p.getSemiFuture();
+  folly::Optional<folly::CIDRNetwork> cursor;
+  if (query->cursor.hasValue()) {
+    try {
+      cursor = folly::IPAddress::createNetwork(
+          query->cursor.value(), -1 /* defaultCidr */, false /* mask */);
+    } catch (const folly::IPAddressFormatException& ex) {
+      return folly::makeSemiFuture<std::unique_ptr<thrift::RouteDbPage>>(
+          folly::make_exception_wrapper<thrift::OpenrError>(
+              folly::sformat("Invalid cursor {}", query->cursor.value())));
+    }
+  }
+
+  // Routes are filtered and paged on the calling thread, not in Decision
+  auto routeDbFuture = decision->getDecisionRouteDb(query->nodeName);
+  return std::move(routeDbFuture)
+      .deferValue([query = std::move(query), cursor = std::move(cursor)](
+                      std::unique_ptr<thrift::RouteDatabase> routeDb) {
+        const auto networks = toIPNetworks(query->prefixes);
+        using Entry = std::pair<folly::CIDRNetwork, thrift::UnicastRoute*>;
+        std::vector<Entry> entries;
+        for (auto& route : routeDb->unicastRoutes) {
+          auto network = toIPNetwork(route.dest, false);
+          if (cursor.hasValue() and not(cursor.value() < network)) {
+            continue;
+          }
+          if (not isWithinAnyNetwork(network, networks)) {
+            continue;
+          }
+          entries.emplace_back(std::move(network), &route);
+        }
+
+        auto page = std::make_unique<thrift::RouteDbPage>();
+        page->nextCursor = truncateToPage(
+            entries,
+            query->limit,
+            [](Entry const& a, Entry const& b) { return a.first < b.first; },
+            [](Entry const& entry) {
+              return folly::IPAddress::networkToString(entry.first);
+            });
+        page->routeDb.thisNodeName = std::move(routeDb->thisNodeName);
+        page->routeDb.unicastRoutes.reserve(entries.size());
+        for (auto& entry : entries) {
+          page->routeDb.unicastRoutes.emplace_back(std::move(*entry.second));
+        }
+        if (not cursor.hasValue() and networks.empty()) {
+          page->routeDb.mplsRoutes = std::move(routeDb->mplsRoutes);
+        }
+        return page;
+      });
 }
 
-folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
-OpenrCtrlHandler::semifuture_getDecisionPrefixDbs() {
-  folly::Promise<std::unique_ptr<thrift::PrefixDbs>> p;
+folly::SemiFuture<std::unique_ptr<thrift::AdjDbsPage>>
+OpenrCtrlHandler::semifuture_getDecisionAdjacencyDbsPage(
+    std::unique_ptr<thrift::DecisionQuery> query) {
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::AdjDbsPage>(
+        thrift::OpenrModuleType::DECISION);
+  }
 
-  thrift::DecisionRequest request;
-  request.cmd = thrift::DecisionCommand::PREFIX_DB_GET;
+  auto page = std::make_unique<thrift::AdjDbsPage>();
+  auto const snapshot = decision->getSolverSnapshot();
+  for (auto const entry :
+       getDbsPage(snapshot->adjacencyDatabases, *query, page->nextCursor)) {
+    page->adjDbs.emplace(entry->first, *entry->second);
+  }
+  return folly::makeSemiFuture(std::move(page));
+}
 
-  auto reply = requestReplyThrift<thrift::DecisionReply>(
-      thrift::OpenrModuleType::DECISION, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(
-        std::make_unique<thrift::PrefixDbs>(std::move(reply->prefixDbs)));
+folly::SemiFuture<std::unique_ptr<thrift::PrefixDbsPage>>
+OpenrCtrlHandler::semifuture_getDecisionPrefixDbsPage(
+    std::unique_ptr<thrift::DecisionQuery> query) {
+  auto decision = getModule<Decision>(thrift::OpenrModuleType::DECISION);
+  if (not decision) {
+    return moduleNotAvailable<thrift::PrefixDbsPage>(
+        thrift::OpenrModuleType::DECISION);
   }
 
-  return p.getSemiFuture();
+  auto page = std::make_unique<thrift::PrefixDbsPage>();
+  auto const snapshot = decision->getSolverSnapshot();
+  const auto networks = toIPNetworks(query->prefixes);
+  for (auto const entry :
+       getDbsPage(snapshot->prefixDatabases, *query, page->nextCursor)) {
+    if (networks.empty()) {
+      page->prefixDbs.emplace(entry->first, *entry->second);
+      continue;
+    }
+    // Copy prefix entries within the given prefixes only
+    thrift::PrefixDatabase prefixDb;
+    prefixDb.thisNodeName = entry->second->thisNodeName;
+    for (auto const& prefixEntry : entry->second->prefixEntries) {
+      if (isWithinAnyNetwork(toIPNetwork(prefixEntry.prefix), networks)) {
+        prefixDb.prefixEntries.emplace_back(prefixEntry);
+      }
+    }
+    page->prefixDbs.emplace(entry->first, std::move(prefixDb));
+  }
+  return folly::makeSemiFuture(std::move(page));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::HealthCheckerInfo>>
@@ -570,64 +1243,37 @@ OpenrCtrlHandler::semifuture_getHealthCheckerInfo() {
 folly::SemiFuture<std::unique_ptr<thrift::Publication>>
 OpenrCtrlHandler::semifuture_getKvStoreKeyVals(
     std::unique_ptr<std::vector<std::string>> filterKeys) {
-  folly::Promise<std::unique_ptr<thrift::Publication>> p;
+  auto kvStore = getModule<KvStore>(thrift::OpenrModuleType::KVSTORE);
+  if (not kvStore) {
+    return moduleNotAvailable<thrift::Publication>(
+        thrift::OpenrModuleType::KVSTORE);
+  }
 
-  thrift::KvStoreRequest request;
   thrift::KeyGetParams params;
-
   params.keys = std::move(*filterKeys);
-  request.cmd = thrift::Command::KEY_GET;
-  request.keyGetParams = params;
-
-  auto reply = requestReplyThrift<thrift::Publication>(
-      thrift::OpenrModuleType::KVSTORE, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(std::make_unique<thrift::Publication>(std::move(reply.value())));
-  }
-
-  return p.getSemiFuture();
+  return kvStore->getKvStoreKeyVals(std::move(params));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::Publication>>
 OpenrCtrlHandler::semifuture_getKvStoreKeyValsFiltered(
     std::unique_ptr<thrift::KeyDumpParams> filter) {
-  folly::Promise<std::unique_ptr<thrift::Publication>> p;
-
-  thrift::KvStoreRequest request;
-  request.cmd = thrift::Command::KEY_DUMP;
-  request.keyDumpParams = std::move(*filter);
-
-  auto reply = requestReplyThrift<thrift::Publication>(
-      thrift::OpenrModuleType::KVSTORE, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(std::make_unique<thrift::Publication>(std::move(reply.value())));
+  auto kvStore = getModule<KvStore>(thrift::OpenrModuleType::KVSTORE);
+  if (not kvStore) {
+    return moduleNotAvailable<thrift::Publication>(
+        thrift::OpenrModuleType::KVSTORE);
   }
-
-  return p.getSemiFuture();
+  return kvStore->dumpKvStoreKeys(std::move(*filter));
 }
 
 folly::SemiFuture<std::unique_ptr<thrift::Publication>>
 OpenrCtrlHandler::semifuture_getKvStoreHashFiltered(
     std::unique_ptr<thrift::KeyDumpParams> filter) {
-  folly::Promise<std::unique_ptr<thrift::Publication>> p;
-
-  thrift::KvStoreRequest request;
-  request.cmd = thrift::Command::HASH_DUMP;
-  request.keyDumpParams = std::move(*filter);
-
-  auto reply = requestReplyThrift<thrift::Publication>(
-      thrift::OpenrModuleType::KVSTORE, std::move(request));
-  if (reply.hasError()) {
-    p.setException(thrift::OpenrError(reply.error().errString));
-  } else {
-    p.setValue(std::make_unique<thrift::Publication>(std::move(reply.value())));
+  auto kvStore = getModule<KvStore>(thrift::OpenrModuleType::KVSTORE);
+  if (not kvStore) {
+    return moduleNotAvailable<thrift::Publication>(
+        thrift::OpenrModuleType::KVSTORE);
   }
-
-  return p.getSemiFuture();
+  return kvStore->dumpKvStoreHashes(std::move(*filter));
 }
 
 folly::SemiFuture<folly::Unit>
@@ -739,9 +1385,26 @@ OpenrCtrlHandler::semifuture_getKvStorePeers() {
 
 apache::thrift::Stream<thrift::Publication>
 OpenrCtrlHandler::subscribeKvStore() {
+  return subscribeKvStoreFilter(std::make_unique<thrift::KeyDumpParams>());
+}
+
+apache::thrift::Stream<thrift::Publication>
+OpenrCtrlHandler::subscribeKvStoreFilter(
+    std::unique_ptr<thrift::KeyDumpParams> filter) {
+  // Match keys on the server, same as KEY_DUMP does
+  folly::Optional<KvStoreFilters> kvFilters;
+  std::vector<std::string> keyPrefixList;
+  folly::split(",", filter->prefix, keyPrefixList, true);
+  if (not keyPrefixList.empty() or not filter->originatorIds.empty()) {
+    kvFilters = KvStoreFilters(keyPrefixList, filter->originatorIds);
+  }
+
   // Get new client-ID (monotonically increasing)
   auto clientToken = publisherToken_++;
 
+  // Track publications not yet consumed by the subscriber
+  auto pendingPubs = std::make_shared<std::atomic<size_t>>(0);
+
   auto streamAndPublisher =
       createStreamPublisher<thrift::Publication>([this, clientToken]() {
         SYNCHRONIZED(kvStorePublishers_) {
@@ -758,9 +1421,18 @@ OpenrCtrlHandler::subscribeKvStore() {
     assert(kvStorePublishers_.count(clientToken) == 0);
     LOG(INFO) << "KvStore snoop stream-" << clientToken << " started.";
     kvStorePublishers_.emplace(
-        clientToken, std::move(streamAndPublisher.second));
+        clientToken,
+        std::make_shared<KvStorePublisher>(
+            std::move(kvFilters),
+            filter->doNotPublishValue,
+            pendingPubs,
+            std::move(streamAndPublisher.second)));
   }
-  return std::move(streamAndPublisher.first);
+  return std::move(streamAndPublisher.first)
+      .map([pendingPubs](thrift::Publication&& publication) {
+        (*pendingPubs)--;
+        return std::move(publication);
+      });
 }
 
 folly::SemiFuture<
@@ -778,6 +1450,168 @@ OpenrCtrlHandler::semifuture_subscribeAndGetKvStore() {
           });
 }
 
+folly::SemiFuture<
+    apache::thrift::ResponseAndStream<thrift::Publication, thrift::Publication>>
+OpenrCtrlHandler::semifuture_subscribeAndGetKvStoreFiltered(
+    std::unique_ptr<thrift::KeyDumpParams> filter) {
+  auto stream =
+      subscribeKvStoreFilter(std::make_unique<thrift::KeyDumpParams>(*filter));
+  return semifuture_getKvStoreKeyValsFiltered(std::move(filter))
+      .defer(
+          [stream = std::move(stream)](
+              folly::Try<std::unique_ptr<thrift::Publication>>&& pub) mutable {
+            pub.throwIfFailed();
+            return apache::thrift::
+                ResponseAndStream<thrift::Publication, thrift::Publication>{
+                    std::move(*pub.value()), std::move(stream)};
+          });
+}
+
+apache::thrift::Stream<thrift::KeySetParamsBatch>
+OpenrCtrlHandler::subscribeKvStorePeer(std::unique_ptr<std::string> peerName) {
+  auto kvStore = getModule<KvStore>(thrift::OpenrModuleType::KVSTORE);
+  if (not kvStore) {
+    throw thrift::OpenrError("Module KVSTORE is not available");
+  }
+
+  // Get new client-ID (monotonically increasing)
+  auto clientToken = publisherToken_++;
+
+  auto streamAndPublisher = createStreamPublisher<thrift::KeySetParamsBatch>(
+      [this, clientToken, peerName = *peerName]() {
+        if (auto kvStore =
+                getModule<KvStore>(thrift::OpenrModuleType::KVSTORE)) {
+          kvStore->removePeerStream(peerName, clientToken);
+        }
+        if (kvStorePeerPublishers_.wlock()->erase(clientToken)) {
+          LOG(INFO) << "KvStore peer stream-" << clientToken << " of "
+                    << peerName << " ended.";
+        } else {
+          LOG(ERROR) << "Can't remove unknown KvStore peer stream-"
+                     << clientToken;
+        }
+      });
+
+  auto publisher = std::make_shared<KvStorePeerPublisher>(
+      std::move(streamAndPublisher.second));
+  LOG(INFO) << "KvStore peer stream-" << clientToken << " of " << *peerName
+            << " started.";
+  kvStorePeerPublishers_.wlock()->emplace(clientToken, publisher);
+  kvStore->addPeerStream(
+      *peerName, clientToken, [publisher](thrift::KeySetParams const& params) {
+        return publisher->push(params);
+      });
+
+  return std::move(streamAndPublisher.first)
+      .map([weakPublisher = std::weak_ptr<KvStorePeerPublisher>(publisher)](
+               thrift::KeySetParamsBatch&& batch) {
+        if (auto publisher = weakPublisher.lock()) {
+          publisher->pop();
+        }
+        return std::move(batch);
+      });
+}
+
+folly::SemiFuture<apache::thrift::ResponseAndStream<
+    thrift::RouteDatabase,
+    thrift::RouteDatabaseDelta>>
+OpenrCtrlHandler::semifuture_subscribeAndGetFib() {
+  using RouteDbAndStream = apache::thrift::
+      ResponseAndStream<thrift::RouteDatabase, thrift::RouteDatabaseDelta>;
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return folly::makeSemiFuture<RouteDbAndStream>(
+        folly::make_exception_wrapper<thrift::OpenrError>(
+            "Module FIB is not available"));
+  }
+
+  // Get new client-ID (monotonically increasing)
+  auto clientToken = publisherToken_++;
+
+  // Track deltas not yet consumed by the subscriber
+  auto pendingDeltas = std::make_shared<std::atomic<size_t>>(0);
+
+  auto streamAndPublisher = createStreamPublisher<thrift::RouteDatabaseDelta>(
+      [fibPublishers = fibPublishers_, clientToken]() {
+        if (fibPublishers->wlock()->erase(clientToken)) {
+          LOG(INFO) << "Fib route stream-" << clientToken << " ended.";
+        } else {
+          LOG(ERROR) << "Can't remove unknown Fib route stream-"
+                     << clientToken;
+        }
+      });
+
+  // Subscribe before requesting the snapshot so no change is lost in between
+  LOG(INFO) << "Fib route stream-" << clientToken << " started.";
+  fibPublishers_->wlock()->emplace(
+      clientToken,
+      std::make_shared<FibPublisher>(
+          pendingDeltas, std::move(streamAndPublisher.second)));
+  auto stream =
+      std::move(streamAndPublisher.first)
+          .map([pendingDeltas](thrift::RouteDatabaseDelta&& delta) {
+            (*pendingDeltas)--;
+            return std::move(delta);
+          });
+
+  return fib->getRouteDb().defer(
+      [stream = std::move(stream)](
+          folly::Try<std::unique_ptr<thrift::RouteDatabase>>&&
+              routeDb) mutable {
+        routeDb.throwIfFailed();
+        return RouteDbAndStream{std::move(*routeDb.value()), std::move(stream)};
+      });
+}
+
+folly::SemiFuture<
+    apache::thrift::ResponseAndStream<thrift::PerfDatabase, thrift::PerfEvents>>
+OpenrCtrlHandler::semifuture_subscribeAndGetPerfDb() {
+  using PerfDbAndStream = apache::thrift::
+      ResponseAndStream<thrift::PerfDatabase, thrift::PerfEvents>;
+  auto fib = getModule<Fib>(thrift::OpenrModuleType::FIB);
+  if (not fib) {
+    return folly::makeSemiFuture<PerfDbAndStream>(
+        folly::make_exception_wrapper<thrift::OpenrError>(
+            "Module FIB is not available"));
+  }
+
+  // Get new client-ID (monotonically increasing)
+  auto clientToken = publisherToken_++;
+
+  // Track timelines not yet consumed by the subscriber
+  auto pendingPerfEvents = std::make_shared<std::atomic<size_t>>(0);
+
+  auto streamAndPublisher = createStreamPublisher<thrift::PerfEvents>(
+      [perfEventsPublishers = perfEventsPublishers_, clientToken]() {
+        if (perfEventsPublishers->wlock()->erase(clientToken)) {
+          LOG(INFO) << "Fib perf events stream-" << clientToken << " ended.";
+        } else {
+          LOG(ERROR) << "Can't remove unknown Fib perf events stream-"
+                     << clientToken;
+        }
+      });
+
+  // Subscribe before requesting the snapshot so no timeline is lost
+  LOG(INFO) << "Fib perf events stream-" << clientToken << " started.";
+  perfEventsPublishers_->wlock()->emplace(
+      clientToken,
+      std::make_shared<PerfEventsPublisher>(
+          pendingPerfEvents, std::move(streamAndPublisher.second)));
+  auto stream =
+      std::move(streamAndPublisher.first)
+          .map([pendingPerfEvents](thrift::PerfEvents&& perfEvents) {
+            (*pendingPerfEvents)--;
+            return std::move(perfEvents);
+          });
+
+  return fib->getPerfDb().defer(
+      [stream = std::move(stream)](
+          folly::Try<std::unique_ptr<thrift::PerfDatabase>>&& perfDb) mutable {
+        perfDb.throwIfFailed();
+        return PerfDbAndStream{std::move(*perfDb.value()), std::move(stream)};
+      });
+}
+
 folly::SemiFuture<folly::Unit>
 OpenrCtrlHandler::semifuture_setNodeOverload() {
   thrift::LinkMonitorRequest request;
@@ -7,12 +7,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
+
 #include <common/fb303/cpp/FacebookBase2.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Synchronized.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/OpenrEventLoop.h>
 #include <openr/common/Types.h>
 #include <openr/if/gen-cpp2/OpenrCtrlCpp.h>
+#include <openr/kvstore/KvStore.h>
+#include <re2/re2.h>
 
 namespace openr {
 class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
@@ -65,6 +72,20 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // Openr Node Name
   void getMyNodeName(std::string& _return) override;
 
+  //
+  // Memory APIs
+  //
+
+  void getMemoryStats(thrift::MemoryStats& _return) override;
+
+  void dumpHeapProfile(std::unique_ptr<std::string> path) override;
+
+  //
+  // Event loop APIs
+  //
+
+  void setEventLoopProfiling(bool enabled) override;
+
   //
   // ZMQ Monitor APIs
   //
@@ -82,6 +103,11 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<folly::Unit> semifuture_withdrawPrefixes(
       std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixes) override;
 
+  folly::SemiFuture<folly::Unit> semifuture_updatePrefixes(
+      std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixesToAdvertise,
+      std::unique_ptr<std::vector<thrift::PrefixEntry>> prefixesToWithdraw)
+      override;
+
   folly::SemiFuture<folly::Unit> semifuture_withdrawPrefixesByType(
       thrift::PrefixType prefixType) override;
 
@@ -102,9 +128,17 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
   semifuture_getRouteDb() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::UnicastRoute>>
+  semifuture_getRouteForAddress(
+      std::unique_ptr<thrift::BinaryAddress> address) override;
+
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
   semifuture_getRouteDbComputed(std::unique_ptr<std::string> nodeName) override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDbPage>>
+  semifuture_getRouteDbComputedPage(
+      std::unique_ptr<thrift::DecisionQuery> query) override;
+
   folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
   semifuture_getRouteDbUnInstallable() override;
 
@@ -125,6 +159,14 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
   semifuture_getDecisionPrefixDbs() override;
 
+  folly::SemiFuture<std::unique_ptr<thrift::AdjDbsPage>>
+  semifuture_getDecisionAdjacencyDbsPage(
+      std::unique_ptr<thrift::DecisionQuery> query) override;
+
+  folly::SemiFuture<std::unique_ptr<thrift::PrefixDbsPage>>
+  semifuture_getDecisionPrefixDbsPage(
+      std::unique_ptr<thrift::DecisionQuery> query) override;
+
   //
   // HealthChecker APIs
   //
@@ -180,6 +222,28 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
       thrift::Publication>>
   semifuture_subscribeAndGetKvStore() override;
 
+  apache::thrift::Stream<thrift::Publication> subscribeKvStoreFilter(
+      std::unique_ptr<thrift::KeyDumpParams> filter) override;
+
+  folly::SemiFuture<apache::thrift::ResponseAndStream<
+      thrift::Publication,
+      thrift::Publication>>
+  semifuture_subscribeAndGetKvStoreFiltered(
+      std::unique_ptr<thrift::KeyDumpParams> filter) override;
+
+  apache::thrift::Stream<thrift::KeySetParamsBatch> subscribeKvStorePeer(
+      std::unique_ptr<std::string> peerName) override;
+
+  folly::SemiFuture<apache::thrift::ResponseAndStream<
+      thrift::RouteDatabase,
+      thrift::RouteDatabaseDelta>>
+  semifuture_subscribeAndGetFib() override;
+
+  folly::SemiFuture<apache::thrift::ResponseAndStream<
+      thrift::PerfDatabase,
+      thrift::PerfEvents>>
+  semifuture_subscribeAndGetPerfDb() override;
+
   //
   // LinkMonitor APIs
   //
@@ -237,11 +301,26 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
     return kvStorePublishers_->size();
   }
 
+  size_t
+  getNumFibPublishers() {
+    return fibPublishers_->rlock()->size();
+  }
+
+  size_t
+  getNumPerfEventsPublishers() {
+    return perfEventsPublishers_->rlock()->size();
+  }
+
  private:
   // For oneway requests, empty message will be returned immediately
   folly::Expected<fbzmq::Message, fbzmq::Error> requestReplyMessage(
       thrift::OpenrModuleType module, fbzmq::Message&& request, bool oneway);
 
+  // Module of given type for typed in-process requests, nullptr if it is not
+  // running
+  template <typename ModuleType>
+  std::shared_ptr<ModuleType> getModule(thrift::OpenrModuleType module);
+
   template <typename ReturnType, typename InputType>
   folly::Expected<ReturnType, fbzmq::Error> requestReplyThrift(
       thrift::OpenrModuleType module, InputType&& input);
@@ -250,16 +329,60 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   folly::SemiFuture<folly::Unit> processThriftRequest(
       thrift::OpenrModuleType module, InputType&& request, bool oneway);
 
+  // Authorize peer of the connection of the request being processed. The
+  // decision is cached in the connection context, i.e. made once per
+  // connection (TLS session). Throws if unauthorized
   void authorizeConnection();
+
+  // Authorization decision, made without caching
+  bool isConnectionAuthorized(
+      apache::thrift::Cpp2ConnContext const& connContext);
+
+  // Guards user data of connection contexts, which holds the cached
+  // authorization decision. Requests of a connection may be processed
+  // concurrently
+  std::mutex authorizationCacheMutex_;
+  std::atomic<int64_t> numAuthorizationCacheHits_{0};
+  std::atomic<int64_t> numAuthorizationCacheMisses_{0};
+
   const std::string nodeName_;
   const std::unordered_set<std::string> acceptablePeerCommonNames_;
   std::unordered_map<thrift::OpenrModuleType, std::shared_ptr<OpenrEventLoop>>
       moduleTypeToEvl_;
-  std::unordered_map<
-      thrift::OpenrModuleType,
-      fbzmq::Socket<ZMQ_REQ, fbzmq::ZMQ_CLIENT>>
+
+  // Pool of REQ sockets to a module. Every request takes a socket of its own
+  // out of the pool, so that concurrent requests to the same module are in
+  // flight together instead of interleaving on one socket
+  struct ModuleSocketPool {
+    using Socket = fbzmq::Socket<ZMQ_REQ, fbzmq::ZMQ_CLIENT>;
+
+    explicit ModuleSocketPool(std::string url) : inprocUrl(std::move(url)) {}
+
+    const std::string inprocUrl;
+    // idle sockets, guarded by mutex
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Socket>> idleSockets;
+    // number of requests waiting for reply
+    std::atomic<int64_t> numInFlight{0};
+    // duration of requests
+    folly::Synchronized<LatencyHistogram> latency;
+  };
+
+  // Take idle socket out of pool or create a new one
+  std::unique_ptr<ModuleSocketPool::Socket> acquireModuleSocket(
+      ModuleSocketPool& pool);
+
+  // Return socket to pool after a successful request, sockets which hit an
+  // error are dropped instead
+  void releaseModuleSocket(
+      ModuleSocketPool& pool, std::unique_ptr<ModuleSocketPool::Socket> sock);
+
+  std::unordered_map<thrift::OpenrModuleType, std::unique_ptr<ModuleSocketPool>>
       moduleSockets_;
 
+  // ZMQ context for creating module sockets
+  fbzmq::Context& context_;
+
   // Reference to event-loop
   fbzmq::ZmqEventLoop& evl_;
 
@@ -269,12 +392,157 @@ class OpenrCtrlHandler final : public thrift::OpenrCtrlCppSvIf,
   // KvStore sub socket
   fbzmq::Socket<ZMQ_SUB, fbzmq::ZMQ_CLIENT> kvStoreSubSock_;
 
+  // KvStore snoop stream publisher along with the filters applied to the
+  // publications before they are sent
+  struct KvStorePublisher {
+    KvStorePublisher(
+        folly::Optional<KvStoreFilters> filters,
+        bool doNotPublishValue,
+        std::shared_ptr<std::atomic<size_t>> pendingPubs,
+        apache::thrift::StreamPublisher<thrift::Publication> publisher)
+        : filters(std::move(filters)),
+          doNotPublishValue(doNotPublishValue),
+          pendingPubs(std::move(pendingPubs)),
+          publisher(std::move(publisher)) {}
+
+    // Complete the stream once, either on shutdown or on dropping a lagging
+    // subscriber. Must not be invoked with `kvStorePublishers_` locked.
+    void complete();
+
+    // none if all keys match
+    folly::Optional<KvStoreFilters> filters;
+    // publish hashes instead of values
+    bool doNotPublishValue{false};
+    // publications sent but not yet consumed by the stream subscriber
+    std::shared_ptr<std::atomic<size_t>> pendingPubs;
+    std::atomic<bool> completed{false};
+    apache::thrift::StreamPublisher<thrift::Publication> publisher;
+  };
+
+  // Publish publication to all active kvstore snoop publishers. Publishers
+  // are snapshot under the lock and published to outside of it, so a slow
+  // subscriber can't hold up others or new subscriptions.
+  void publishKvStorePublication(thrift::Publication const& publication);
+
   // Active kvstore snoop publishers
   std::atomic<int64_t> publisherToken_{0};
-  folly::Synchronized<std::unordered_map<
-      int64_t,
-      apache::thrift::StreamPublisher<thrift::Publication>>>
+  folly::Synchronized<
+      std::unordered_map<int64_t, std::shared_ptr<KvStorePublisher>>>
       kvStorePublishers_;
 
+  // Number of lagging kvstore snoop subscribers dropped
+  std::atomic<int64_t> numDroppedKvStorePublishers_{0};
+
+  // Stream publisher of our flood requests to a KvStore peer. Requests are
+  // published one per batch while the subscriber keeps up, and batched while
+  // it is behind by Constants::kKvStorePeerStreamMaxPendingBatches
+  struct KvStorePeerPublisher {
+    explicit KvStorePeerPublisher(
+        apache::thrift::StreamPublisher<thrift::KeySetParamsBatch> publisher)
+        : publisher(std::move(publisher)) {}
+
+    // Publish or buffer flood request. Returns false if the subscriber is too
+    // far behind to buffer more, KvStore holds back the request then
+    bool push(thrift::KeySetParams const& params);
+
+    // Batch consumed by the subscriber, publish the buffered requests
+    void pop();
+
+    // Complete the stream once. Must not be invoked with
+    // `kvStorePeerPublishers_` locked.
+    void complete();
+
+    std::mutex mutex;
+    // batches sent but not yet consumed by the subscriber
+    size_t pendingBatches{0};
+    std::vector<thrift::KeySetParams> bufferedParams;
+    bool completed{false};
+    apache::thrift::StreamPublisher<thrift::KeySetParamsBatch> publisher;
+  };
+
+  // Active KvStore peer stream publishers
+  folly::Synchronized<
+      std::unordered_map<int64_t, std::shared_ptr<KvStorePeerPublisher>>>
+      kvStorePeerPublishers_;
+
+  // Fib route stream publisher
+  struct FibPublisher {
+    FibPublisher(
+        std::shared_ptr<std::atomic<size_t>> pendingDeltas,
+        apache::thrift::StreamPublisher<thrift::RouteDatabaseDelta> publisher)
+        : pendingDeltas(std::move(pendingDeltas)),
+          publisher(std::move(publisher)) {}
+
+    // Complete the stream once. Must not be invoked with `fibPublishers_`
+    // locked.
+    void complete();
+
+    // route deltas sent but not yet consumed by the stream subscriber
+    std::shared_ptr<std::atomic<size_t>> pendingDeltas;
+    std::atomic<bool> completed{false};
+    apache::thrift::StreamPublisher<thrift::RouteDatabaseDelta> publisher;
+  };
+  using FibPublishers = folly::Synchronized<
+      std::unordered_map<int64_t, std::shared_ptr<FibPublisher>>>;
+
+  // Publish route delta to all active fib route publishers. Invoked in Fib's
+  // event loop
+  static void publishRouteDbDelta(
+      FibPublishers& fibPublishers, thrift::RouteDatabaseDelta delta);
+
+  // Active fib route publishers. Shared with the route delta callback set in
+  // Fib, which may run after this handler is gone
+  std::shared_ptr<FibPublishers> fibPublishers_{
+      std::make_shared<FibPublishers>()};
+
+  // Fib convergence timeline stream publisher
+  struct PerfEventsPublisher {
+    PerfEventsPublisher(
+        std::shared_ptr<std::atomic<size_t>> pendingPerfEvents,
+        apache::thrift::StreamPublisher<thrift::PerfEvents> publisher)
+        : pendingPerfEvents(std::move(pendingPerfEvents)),
+          publisher(std::move(publisher)) {}
+
+    // Complete the stream once. Must not be invoked with
+    // `perfEventsPublishers_` locked.
+    void complete();
+
+    // timelines sent but not yet consumed by the stream subscriber
+    std::shared_ptr<std::atomic<size_t>> pendingPerfEvents;
+    std::atomic<bool> completed{false};
+    apache::thrift::StreamPublisher<thrift::PerfEvents> publisher;
+  };
+  using PerfEventsPublishers = folly::Synchronized<
+      std::unordered_map<int64_t, std::shared_ptr<PerfEventsPublisher>>>;
+
+  // Publish timeline to all active perf events publishers. Invoked in Fib's
+  // event loop
+  static void publishPerfEvents(
+      PerfEventsPublishers& perfEventsPublishers,
+      thrift::PerfEvents const& perfEvents);
+
+  // Active perf events publishers. Shared with the callback set in Fib
+  std::shared_ptr<PerfEventsPublishers> perfEventsPublishers_{
+      std::make_shared<PerfEventsPublishers>()};
+
+  // Snapshot of all counters for regex and selected counter queries, which
+  // scrapers issue every few seconds. Rebuilt on first query after it is
+  // older than Constants::kCounterCacheTtl
+  std::shared_ptr<const std::map<std::string, int64_t>> getCachedCounters();
+
+  struct CounterCache {
+    struct RegexEntry {
+      std::unique_ptr<re2::RE2> regex;
+      // counters of current snapshot matching regex, null if not computed yet
+      std::shared_ptr<const std::map<std::string, int64_t>> matches;
+    };
+
+    std::shared_ptr<const std::map<std::string, int64_t>> counters;
+    std::chrono::steady_clock::time_point updateTime;
+    // compiled regexes and their results, keyed by regex string
+    std::unordered_map<std::string, RegexEntry> regexes;
+  };
+  folly::Synchronized<CounterCache> counterCache_;
+
 }; // class OpenrCtrlHandler
 } // namespace openr
@@ -286,6 +286,34 @@ class OpenrCtrlFixture : public ::testing::Test {
     return prefixEntry;
   }
 
+  // Advertise adjacency and prefix databases of node in KvStore
+  void
+  setLinkStateDbs(
+      const std::string& node,
+      const std::vector<thrift::Adjacency>& adjs,
+      const std::vector<std::string>& prefixes) {
+    apache::thrift::CompactSerializer serializer;
+    std::vector<thrift::PrefixEntry> prefixEntries;
+    for (auto const& prefix : prefixes) {
+      prefixEntries.emplace_back(
+          createPrefixEntry(prefix, thrift::PrefixType::LOOPBACK));
+    }
+    kvStoreWrapper->setKey(
+        "adj:" + node,
+        createThriftValue(
+            1,
+            node,
+            fbzmq::util::writeThriftObjStr(
+                createAdjDb(node, adjs, 0), serializer)));
+    kvStoreWrapper->setKey(
+        "prefix:" + node,
+        createThriftValue(
+            1,
+            node,
+            fbzmq::util::writeThriftObjStr(
+                createPrefixDb(node, prefixEntries), serializer)));
+  }
+
  private:
   const MonitorSubmitUrl monitorSubmitUrl_{"inproc://monitor-submit-url"};
   const DecisionPubUrl decisionPubUrl_{"inproc://decision-pub"};
@@ -332,6 +360,40 @@ TEST_F(OpenrCtrlFixture, getMyNodeName) {
   EXPECT_EQ(nodeName, *ret);
 }
 
+TEST_F(OpenrCtrlFixture, MemoryApis) {
+  {
+    auto ret = handler->semifuture_getMemoryStats().get();
+    ASSERT_NE(nullptr, ret);
+    EXPECT_LT(0, ret->rssBytes);
+    if (ret->usingJemalloc) {
+      EXPECT_LT(0, ret->allocatedBytes);
+      EXPECT_LE(ret->allocatedBytes, ret->activeBytes);
+      EXPECT_FALSE(ret->arenas.empty());
+    } else {
+      EXPECT_TRUE(ret->arenas.empty());
+    }
+  }
+
+  {
+    EXPECT_THROW(
+        handler->semifuture_dumpHeapProfile(std::make_unique<std::string>(""))
+            .get(),
+        thrift::OpenrError);
+  }
+}
+
+TEST_F(OpenrCtrlFixture, EventLoopProfiling) {
+  handler->semifuture_setEventLoopProfiling(true).get();
+  for (auto const& kv : moduleTypeToEvl_) {
+    EXPECT_TRUE(kv.second->isProfilingEnabled());
+  }
+
+  handler->semifuture_setEventLoopProfiling(false).get();
+  for (auto const& kv : moduleTypeToEvl_) {
+    EXPECT_FALSE(kv.second->isProfilingEnabled());
+  }
+}
+
 TEST_F(OpenrCtrlFixture, PrefixManagerApis) {
   {
     std::vector<thrift::PrefixEntry> prefixes{
@@ -431,6 +493,167 @@ TEST_F(OpenrCtrlFixture, RouteApis) {
   }
 }
 
+TEST_F(OpenrCtrlFixture, FibStreamApis) {
+  auto responseAndStream = handler->semifuture_subscribeAndGetFib().get();
+  EXPECT_EQ(nodeName, responseAndStream.response.thisNodeName);
+  EXPECT_EQ(0, responseAndStream.response.unicastRoutes.size());
+  EXPECT_EQ(1, handler->getNumFibPublishers());
+
+  const auto prefix = toIpPrefix("10.1.0.0/16");
+  std::atomic<bool> received{false};
+  auto subscription =
+      std::move(responseAndStream.stream)
+          .subscribe([&received, prefix](thrift::RouteDatabaseDelta&& delta) {
+            EXPECT_TRUE(expandNextHopGroups(delta));
+            for (auto const& route : delta.unicastRoutesToUpdate) {
+              if (route.dest == prefix) {
+                EXPECT_FALSE(route.nextHops.empty());
+                received = true;
+              }
+            }
+          });
+
+  // Advertise prefix from a neighbor to get a route computed by Decision
+  // and applied by Fib
+  const std::string neighbor{"avengers@universe"};
+  setLinkStateDbs(
+      nodeName,
+      {createAdjacency(
+          neighbor, "if12", "if21", "fe80::2", "192.168.0.2", 10, 100002)},
+      {});
+  setLinkStateDbs(
+      neighbor,
+      {createAdjacency(
+          nodeName, "if21", "if12", "fe80::1", "192.168.0.1", 10, 100001)},
+      {"10.1.0.0/16"});
+
+  while (not received) {
+    std::this_thread::yield();
+  }
+
+  // Cancel subscription
+  subscription.cancel();
+  std::move(subscription).detach();
+
+  // Wait until publisher is destroyed
+  while (handler->getNumFibPublishers() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+TEST_F(OpenrCtrlFixture, PerfDbStreamApis) {
+  auto responseAndStream = handler->semifuture_subscribeAndGetPerfDb().get();
+  EXPECT_EQ(nodeName, responseAndStream.response.thisNodeName);
+  EXPECT_EQ(1, handler->getNumPerfEventsPublishers());
+
+  auto subscription =
+      std::move(responseAndStream.stream)
+          .subscribe([](thrift::PerfEvents&& perfEvents) {
+            EXPECT_LE(2, perfEvents.events.size());
+          });
+
+  // Cancel subscription
+  subscription.cancel();
+  std::move(subscription).detach();
+
+  // Wait until publisher is destroyed
+  while (handler->getNumPerfEventsPublishers() != 0) {
+    std::this_thread::yield();
+  }
+}
+
+TEST_F(OpenrCtrlFixture, DecisionPageApis) {
+  const std::string neighbor{"avengers@universe"};
+  setLinkStateDbs(
+      nodeName,
+      {createAdjacency(
+          neighbor, "if12", "if21", "fe80::2", "192.168.0.2", 10, 100002)},
+      {"10.2.0.0/16"});
+  setLinkStateDbs(
+      neighbor,
+      {createAdjacency(
+          nodeName, "if21", "if12", "fe80::1", "192.168.0.1", 10, 100001)},
+      {"10.1.0.0/16", "10.3.0.0/16", "fd00::/64"});
+  while (handler->semifuture_getDecisionPrefixDbs().get()->size() != 2) {
+    std::this_thread::yield();
+  }
+
+  // Databases ordered by node name, one per page
+  {
+    thrift::DecisionQuery query;
+    query.limit = 1;
+    auto page = handler
+                    ->semifuture_getDecisionAdjacencyDbsPage(
+                        std::make_unique<thrift::DecisionQuery>(query))
+                    .get();
+    ASSERT_EQ(1, page->adjDbs.size());
+    EXPECT_EQ(1, page->adjDbs.count(neighbor));
+    ASSERT_TRUE(page->nextCursor.hasValue());
+
+    query.cursor = page->nextCursor;
+    page = handler
+               ->semifuture_getDecisionAdjacencyDbsPage(
+                   std::make_unique<thrift::DecisionQuery>(query))
+               .get();
+    ASSERT_EQ(1, page->adjDbs.size());
+    EXPECT_EQ(1, page->adjDbs.count(nodeName));
+    EXPECT_FALSE(page->nextCursor.hasValue());
+  }
+
+  // Prefix entries filtered by node and prefix
+  {
+    thrift::DecisionQuery query;
+    query.nodeNames = {neighbor};
+    query.prefixes = {toIpPrefix("10.0.0.0/8")};
+    auto page = handler
+                    ->semifuture_getDecisionPrefixDbsPage(
+                        std::make_unique<thrift::DecisionQuery>(query))
+                    .get();
+    ASSERT_EQ(1, page->prefixDbs.size());
+    EXPECT_EQ(2, page->prefixDbs.at(neighbor).prefixEntries.size());
+    EXPECT_FALSE(page->nextCursor.hasValue());
+  }
+
+  // Routes of my node ordered by prefix, filtered by prefix
+  {
+    thrift::DecisionQuery query;
+    query.prefixes = {toIpPrefix("10.0.0.0/8")};
+    query.limit = 1;
+    auto page = handler
+                    ->semifuture_getRouteDbComputedPage(
+                        std::make_unique<thrift::DecisionQuery>(query))
+                    .get();
+    EXPECT_EQ(nodeName, page->routeDb.thisNodeName);
+    ASSERT_EQ(1, page->routeDb.unicastRoutes.size());
+    EXPECT_EQ(
+        toIpPrefix("10.1.0.0/16"), page->routeDb.unicastRoutes.at(0).dest);
+    EXPECT_EQ(0, page->routeDb.mplsRoutes.size());
+    ASSERT_TRUE(page->nextCursor.hasValue());
+
+    query.cursor = page->nextCursor;
+    page = handler
+               ->semifuture_getRouteDbComputedPage(
+                   std::make_unique<thrift::DecisionQuery>(query))
+               .get();
+    ASSERT_EQ(1, page->routeDb.unicastRoutes.size());
+    EXPECT_EQ(
+        toIpPrefix("10.3.0.0/16"), page->routeDb.unicastRoutes.at(0).dest);
+    EXPECT_FALSE(page->nextCursor.hasValue());
+  }
+
+  // Invalid cursor
+  {
+    thrift::DecisionQuery query;
+    query.cursor = "not-a-prefix";
+    EXPECT_THROW(
+        handler
+            ->semifuture_getRouteDbComputedPage(
+                std::make_unique<thrift::DecisionQuery>(query))
+            .get(),
+        thrift::OpenrError);
+  }
+}
+
 TEST_F(OpenrCtrlFixture, PerfApis) {
   {
     auto ret = handler->semifuture_getPerfDb().get();
@@ -650,6 +873,13 @@ TEST_F(OpenrCtrlFixture, KvStoreApis) {
           received++;
         });
     EXPECT_EQ(1, handler->getNumKvStorePublishers());
+    {
+      std::map<std::string, int64_t> counters;
+      handler->getCounters(counters);
+      EXPECT_EQ(1, counters.at("ctrl.kvstore_publishers"));
+      EXPECT_EQ(0, counters.at("ctrl.kvstore_publishers_lagging"));
+      EXPECT_EQ(0, counters.at("ctrl.kvstore_publishers_dropped"));
+    }
     kvStoreWrapper->setKey(key, createThriftValue(1, "node1", "value1"));
     kvStoreWrapper->setKey(key, createThriftValue(1, "node1", "value1"));
     kvStoreWrapper->setKey(key, createThriftValue(2, "node1", "value1"));
@@ -712,6 +942,53 @@ TEST_F(OpenrCtrlFixture, KvStoreApis) {
       std::this_thread::yield();
     }
   }
+
+  //
+  // Subscribe API with filters
+  //
+
+  {
+    std::atomic<int> received{0};
+    const std::string key{"snoop-key"};
+    const std::string filteredKey{"snoop-filtered-key"};
+    thrift::KeyDumpParams filter;
+    filter.prefix = filteredKey;
+    filter.doNotPublishValue = true;
+    auto subscription =
+        handler
+            ->subscribeKvStoreFilter(
+                std::make_unique<thrift::KeyDumpParams>(filter))
+            .subscribe([&received, filteredKey](thrift::Publication&& pub) {
+              // Only filtered key is published and without value
+              EXPECT_EQ(1, pub.keyVals.size());
+              ASSERT_EQ(1, pub.keyVals.count(filteredKey));
+              EXPECT_FALSE(pub.keyVals.at(filteredKey).value.hasValue());
+              EXPECT_TRUE(pub.keyVals.at(filteredKey).hash.hasValue());
+              EXPECT_EQ(received + 1, pub.keyVals.at(filteredKey).version);
+              received++;
+            });
+    EXPECT_EQ(1, handler->getNumKvStorePublishers());
+    kvStoreWrapper->setKey(key, createThriftValue(7, "node1", "value1"));
+    kvStoreWrapper->setKey(
+        filteredKey, createThriftValue(1, "node1", "value1"));
+    kvStoreWrapper->setKey(key, createThriftValue(8, "node1", "value1"));
+    kvStoreWrapper->setKey(
+        filteredKey, createThriftValue(2, "node1", "value1"));
+
+    // Check we should receive-2 updates
+    while (received < 2) {
+      std::this_thread::yield();
+    }
+
+    // Cancel subscription
+    subscription.cancel();
+    std::move(subscription).detach();
+
+    // Wait until publisher is destroyed
+    while (handler->getNumKvStorePublishers() != 0) {
+      std::this_thread::yield();
+    }
+  }
 }
 
 TEST_F(OpenrCtrlFixture, LinkMonitorApis) {
@@ -7,19 +7,35 @@
 
 #include "Decision.h"
 
+#include <sched.h>
+
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <queue>
 #include <set>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 
 #include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Bits.h>
 #include <folly/Format.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
 #include <folly/Optional.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
+#include <folly/synchronization/Baton.h>
 #if FOLLY_USE_SYMBOLIZER
 #include <folly/experimental/exception_tracer/ExceptionTracer.h>
 #endif
@@ -52,77 +68,531 @@ namespace {
 // Default HWM is 1k. We set it to 0 to buffer all received messages.
 const int kStoreSubReceiveHwm{0};
 
-// Classes needed for running Dijkstra
-class DijkstraQNode {
- public:
-  DijkstraQNode(const std::string& n, Metric d) : nodeName(n), distance(d) {}
-  const std::string nodeName;
-  Metric distance{0};
-  std::unordered_set<std::string> nextHops;
-};
+// config store key of the routes published by Decision
+const std::string kRouteDbConfigKey{"decision-route-db"};
+
+using NodeId = openr::LinkState::NodeId;
 
+// Indexed binary min-heap over dense node ids needed for running Dijkstra.
+// Distances and next-hops are stored in flat vectors indexed by node id.
+//
+// With useRadixHeap a monotone radix heap is used instead. Link metrics are
+// small integers and Dijkstra never inserts below the last extracted
+// distance, so nodes are moved between 65 buckets at most once per bit of
+// their distance and decreaseKey is a push. Both extract nodes in order of
+// distance and then node id.
+//
+// Next-hops are always neighbors of the source node, so the next-hops of a
+// node are a fixed width bitset over neighbor indices. Inheriting next-hops
+// is an OR of a few words
+//
+// All of its storage dies with the run, so a queue is reset for every run
+// rather than constructed, and keeps the capacity of its vectors. See
+// getThreadDijkstraQ()
 class DijkstraQ {
- private:
-  std::vector<std::shared_ptr<DijkstraQNode>> heap_;
-  std::unordered_map<std::string, std::shared_ptr<DijkstraQNode>> nameToNode_;
+ public:
+  using NextHopWord = uint64_t;
 
-  struct {
-    bool
-    operator()(
-        std::shared_ptr<DijkstraQNode> a,
-        std::shared_ptr<DijkstraQNode> b) const {
-      if (a->distance != b->distance) {
-        return a->distance > b->distance;
+  // Clear the queue for a run over numNodes from srcNodeId
+  void
+  reset(
+      size_t numNodes,
+      const openr::LinkState::CsrGraph& graph,
+      NodeId srcNodeId,
+      bool useRadixHeap) {
+    ++numResets_;
+    snapshotCapacities();
+    useRadixHeap_ = useRadixHeap;
+    heap_.clear();
+    for (auto& bucket : radixBuckets_) {
+      bucket.clear();
+    }
+    lastDistance_ = 0;
+    distances_.assign(numNodes, std::numeric_limits<Metric>::max());
+    heapPos_.assign(numNodes, kNotInserted);
+    neighborIndices_.assign(numNodes, kNotNeighbor);
+    neighbors_.clear();
+    for (auto i = graph.offsets[srcNodeId]; i < graph.offsets[srcNodeId + 1];
+         ++i) {
+      auto const nodeId = graph.edges[i].otherNodeId;
+      if (neighborIndices_[nodeId] == kNotNeighbor) {
+        neighborIndices_[nodeId] = neighbors_.size();
+        neighbors_.emplace_back(nodeId);
       }
-      return a->nodeName > b->nodeName;
     }
-  } DijkstraQNodeGreater;
+    numWords_ =
+        std::max<size_t>(1, (neighbors_.size() + kWordBits - 1) / kWordBits);
+    nextHops_.assign(numNodes * numWords_, 0);
+  }
+
+  // Number of vectors which had to allocate since the last reset, i.e. heap
+  // allocations of the run. Zero once the queue is warmed up for the graph
+  size_t
+  getNumAllocations() const {
+    size_t numAllocations{0};
+    size_t i{0};
+    forEachCapacity([&](size_t capacity) {
+      numAllocations += capacity != capacities_.at(i++);
+    });
+    // first run allocates capacities_ too
+    return numAllocations + (numResets_ == 1);
+  }
+
+  // true if node has ever been inserted (it may be extracted by now)
+  bool
+  wasInserted(NodeId nodeId) const {
+    return heapPos_[nodeId] != kNotInserted;
+  }
+
+  bool
+  wasExtracted(NodeId nodeId) const {
+    return heapPos_[nodeId] == kExtracted;
+  }
 
- public:
   void
-  insertNode(const std::string& nodeName, Metric d) {
-    heap_.push_back(std::make_shared<DijkstraQNode>(nodeName, d));
-    nameToNode_[nodeName] = heap_.back();
-    std::push_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+  insertNode(NodeId nodeId, Metric d) {
+    CHECK(not wasInserted(nodeId));
+    distances_[nodeId] = d;
+    if (useRadixHeap_) {
+      heapPos_[nodeId] = kInRadixHeap;
+      pushRadixHeap(nodeId, d);
+      return;
+    }
+    heapPos_[nodeId] = heap_.size();
+    heap_.push_back(nodeId);
+    siftUp(heap_.size() - 1);
   }
 
-  std::shared_ptr<DijkstraQNode>
-  get(const std::string& nodeName) {
-    if (nameToNode_.count(nodeName)) {
-      return nameToNode_.at(nodeName);
+  Metric
+  getDistance(NodeId nodeId) const {
+    return distances_[nodeId];
+  }
+
+  // next-hop bitset of node, getNumWords() long
+  const NextHopWord*
+  getNextHops(NodeId nodeId) const {
+    return &nextHops_[nodeId * numWords_];
+  }
+
+  size_t
+  getNumWords() const {
+    return numWords_;
+  }
+
+  void
+  clearNextHops(NodeId nodeId) {
+    std::fill_n(&nextHops_[nodeId * numWords_], numWords_, 0);
+  }
+
+  void
+  mergeNextHops(NodeId nodeId, const NextHopWord* nextHops) {
+    auto* words = &nextHops_[nodeId * numWords_];
+    for (size_t i = 0; i < numWords_; ++i) {
+      words[i] |= nextHops[i];
+    }
+  }
+
+  // set neighbor of source as next-hop in bitset. Returns false if it isn't
+  // a neighbor
+  bool
+  setNextHop(NextHopWord* nextHops, NodeId neighborId) const {
+    auto const index = neighborIndices_[neighborId];
+    if (index == kNotNeighbor) {
+      return false;
     }
-    return nullptr;
+    nextHops[index / kWordBits] |= NextHopWord{1} << (index % kWordBits);
+    return true;
+  }
+
+  bool
+  addNextHop(NodeId nodeId, NodeId neighborId) {
+    return setNextHop(&nextHops_[nodeId * numWords_], neighborId);
   }
 
-  std::shared_ptr<DijkstraQNode>
-  extractMin() {
+  // call f with node id of every next-hop of node
+  template <typename F>
+  void
+  forEachNextHop(NodeId nodeId, F&& f) const {
+    auto const* words = getNextHops(nodeId);
+    for (size_t i = 0; i < numWords_; ++i) {
+      for (auto word = words[i]; word; word &= word - 1) {
+        f(neighbors_[i * kWordBits + folly::findFirstSet(word) - 1]);
+      }
+    }
+  }
+
+  // returns false if the queue is empty
+  bool
+  extractMin(NodeId& nodeId) {
+    if (useRadixHeap_) {
+      return popRadixHeap(nodeId);
+    }
     if (heap_.empty()) {
-      return nullptr;
+      return false;
     }
-    auto min = heap_.at(0);
-    CHECK(nameToNode_.erase(min->nodeName));
-    std::pop_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
-    heap_.pop_back();
-    return min;
+    nodeId = heap_.front();
+    heapPos_[nodeId] = kExtracted;
+    if (heap_.size() > 1) {
+      heap_.front() = heap_.back();
+      heapPos_[heap_.front()] = 0;
+      heap_.pop_back();
+      siftDown(0);
+    } else {
+      heap_.pop_back();
+    }
+    return true;
+  }
+
+  void
+  decreaseKey(NodeId nodeId, Metric d) {
+    if (not wasInserted(nodeId) or wasExtracted(nodeId)) {
+      throw std::invalid_argument(std::to_string(nodeId));
+    }
+    if (distances_[nodeId] < d) {
+      throw std::invalid_argument(std::to_string(d));
+    }
+    distances_[nodeId] = d;
+    if (useRadixHeap_) {
+      // entry with the old distance is skipped once popped
+      pushRadixHeap(nodeId, d);
+      return;
+    }
+    siftUp(heapPos_[nodeId]);
+  }
+
+ private:
+  static constexpr size_t kNotInserted = std::numeric_limits<size_t>::max();
+  static constexpr size_t kExtracted = kNotInserted - 1;
+  static constexpr size_t kInRadixHeap = 0;
+  static constexpr size_t kNotNeighbor = std::numeric_limits<size_t>::max();
+  static constexpr size_t kWordBits = 8 * sizeof(NextHopWord);
+
+  struct RadixEntry {
+    Metric distance;
+    NodeId nodeId;
+  };
+
+  // bucket i > 0 holds distances whose highest bit differing from
+  // lastDistance_ is bit i - 1. Bucket 0 holds lastDistance_, sorted by
+  // descending node id
+  static size_t
+  getRadixBucket(Metric d, Metric lastDistance) {
+    return folly::findLastSet(d ^ lastDistance);
   }
 
   void
-  decreaseKey(const std::string& nodeName, Metric d) {
-    if (nameToNode_.count(nodeName)) {
-      if (nameToNode_.at(nodeName)->distance < d) {
-        throw std::invalid_argument(std::to_string(d));
+  pushRadixHeap(NodeId nodeId, Metric d) {
+    CHECK_GE(d, lastDistance_);
+    const auto index = getRadixBucket(d, lastDistance_);
+    auto& bucket = radixBuckets_[index];
+    if (index > 0) {
+      bucket.push_back(RadixEntry{d, nodeId});
+      return;
+    }
+    // only zero metric links relax a node at the last extracted distance
+    auto it = std::lower_bound(
+        bucket.begin(),
+        bucket.end(),
+        nodeId,
+        [](const RadixEntry& entry, NodeId id) { return entry.nodeId > id; });
+    bucket.insert(it, RadixEntry{d, nodeId});
+  }
+
+  bool
+  popRadixHeap(NodeId& nodeId) {
+    auto& minBucket = radixBuckets_[0];
+    while (true) {
+      if (minBucket.empty()) {
+        auto it = std::find_if(
+            radixBuckets_.begin() + 1,
+            radixBuckets_.end(),
+            [](const std::vector<RadixEntry>& bucket) {
+              return not bucket.empty();
+            });
+        if (it == radixBuckets_.end()) {
+          return false;
+        }
+        // all entries of lowest non-empty bucket move to lower buckets
+        auto entries = std::move(*it);
+        it->clear();
+        lastDistance_ = std::min_element(
+                            entries.begin(),
+                            entries.end(),
+                            [](const RadixEntry& a, const RadixEntry& b) {
+                              return a.distance < b.distance;
+                            })
+                            ->distance;
+        for (auto const& entry : entries) {
+          radixBuckets_[getRadixBucket(entry.distance, lastDistance_)]
+              .push_back(entry);
+        }
+        std::sort(
+            minBucket.begin(),
+            minBucket.end(),
+            [](const RadixEntry& a, const RadixEntry& b) {
+              return a.nodeId > b.nodeId;
+            });
+      }
+      const auto entry = minBucket.back();
+      minBucket.pop_back();
+      if (wasExtracted(entry.nodeId) or
+          distances_[entry.nodeId] != entry.distance) {
+        continue; // stale entry
+      }
+      nodeId = entry.nodeId;
+      heapPos_[nodeId] = kExtracted;
+      return true;
+    }
+  }
+
+  bool
+  isLess(NodeId a, NodeId b) const {
+    if (distances_[a] != distances_[b]) {
+      return distances_[a] < distances_[b];
+    }
+    return a < b;
+  }
+
+  void
+  swapAt(size_t i, size_t j) {
+    std::swap(heap_[i], heap_[j]);
+    heapPos_[heap_[i]] = i;
+    heapPos_[heap_[j]] = j;
+  }
+
+  void
+  siftUp(size_t pos) {
+    while (pos > 0) {
+      const size_t parent = (pos - 1) / 2;
+      if (not isLess(heap_[pos], heap_[parent])) {
+        break;
       }
-      nameToNode_.at(nodeName)->distance = d;
-      // this is a bit slow but is rarely called in our application. In fact,
-      // in networks where the metric is hop count, this will never be called
-      // and the Dijkstra run is no different than BFS
-      std::make_heap(heap_.begin(), heap_.end(), DijkstraQNodeGreater);
+      swapAt(pos, parent);
+      pos = parent;
+    }
+  }
+
+  void
+  siftDown(size_t pos) {
+    while (true) {
+      const size_t left = 2 * pos + 1;
+      const size_t right = left + 1;
+      size_t smallest = pos;
+      if (left < heap_.size() and isLess(heap_[left], heap_[smallest])) {
+        smallest = left;
+      }
+      if (right < heap_.size() and isLess(heap_[right], heap_[smallest])) {
+        smallest = right;
+      }
+      if (smallest == pos) {
+        break;
+      }
+      swapAt(pos, smallest);
+      pos = smallest;
+    }
+  }
+
+  template <typename F>
+  void
+  forEachCapacity(F&& f) const {
+    f(heap_.capacity());
+    for (auto const& bucket : radixBuckets_) {
+      f(bucket.capacity());
+    }
+    f(distances_.capacity());
+    f(heapPos_.capacity());
+    f(neighborIndices_.capacity());
+    f(neighbors_.capacity());
+    f(nextHops_.capacity());
+  }
+
+  void
+  snapshotCapacities() {
+    capacities_.clear();
+    forEachCapacity(
+        [this](size_t capacity) { capacities_.emplace_back(capacity); });
+  }
+
+  bool useRadixHeap_{false};
+  std::vector<NodeId> heap_;
+  std::array<std::vector<RadixEntry>, 8 * sizeof(Metric) + 1> radixBuckets_;
+  Metric lastDistance_{0};
+  std::vector<Metric> distances_;
+  std::vector<size_t> heapPos_;
+  // neighbor index of node id, or kNotNeighbor
+  std::vector<size_t> neighborIndices_;
+  // node id of neighbor index
+  std::vector<NodeId> neighbors_;
+  size_t numWords_{1};
+  // next-hop bitsets of all nodes, numWords_ per node
+  std::vector<NextHopWord> nextHops_;
+  // capacities of above vectors at last reset
+  std::vector<size_t> capacities_;
+  uint64_t numResets_{0};
+};
+
+constexpr size_t DijkstraQ::kNotInserted;
+constexpr size_t DijkstraQ::kExtracted;
+constexpr size_t DijkstraQ::kInRadixHeap;
+constexpr size_t DijkstraQ::kNotNeighbor;
+constexpr size_t DijkstraQ::kWordBits;
+
+// DijkstraQ of the calling thread. SPF runs happen on the Decision thread
+// and the LFA executor threads, one at a time per thread, so each thread can
+// reset and reuse one queue instead of allocating a new one per run
+DijkstraQ&
+getThreadDijkstraQ() {
+  static thread_local DijkstraQ q;
+  return q;
+}
+
+// Relax otherNodeId over a path of given distance from nodeId. Next-hops of
+// nodeId are inherited, or if nodeId is the source itself then otherNodeId
+// is the next-hop
+void
+relaxDijkstraQNode(
+    DijkstraQ& q,
+    NodeId srcNodeId,
+    NodeId nodeId,
+    const DijkstraQ::NextHopWord* nodeNextHops,
+    NodeId otherNodeId,
+    Metric distance) {
+  if (not q.wasInserted(otherNodeId)) {
+    q.insertNode(otherNodeId, distance);
+  }
+  if (q.getDistance(otherNodeId) >= distance) {
+    // nodeId is either along an alternate shortest path towards otherNodeId
+    // or is along a new shorter path. In either case, otherNodeId should use
+    // nodeId's nextHops until it finds some shorter path
+    if (q.getDistance(otherNodeId) > distance) {
+      // if this is strictly better, forget about any other nexthops
+      q.clearNextHops(otherNodeId);
+      q.decreaseKey(otherNodeId, distance);
+    }
+    if (nodeId == srcNodeId) {
+      // this node is directly connected to the source
+      CHECK(q.addNextHop(otherNodeId, otherNodeId));
     } else {
-      throw std::invalid_argument(nodeName);
+      q.mergeNextHops(otherNodeId, nodeNextHops);
     }
   }
+}
+
+// Record settled node of the queue in the SPF result
+void
+recordDijkstraQNode(
+    SpfResult& result,
+    const DijkstraQ& q,
+    const openr::LinkState& linkState,
+    NodeId nodeId) {
+  unordered_set<string> nextHopNames;
+  q.forEachNextHop(nodeId, [&](NodeId nextHopId) {
+    nextHopNames.emplace(linkState.getNodeName(nextHopId));
+  });
+  auto emplaceRc = result.emplace(
+      std::piecewise_construct,
+      std::forward_as_tuple(linkState.getNodeName(nodeId)),
+      std::forward_as_tuple(q.getDistance(nodeId), std::move(nextHopNames)));
+  CHECK(emplaceRc.second);
+}
+
+// Dijkstra loop of a full SPF run from srcNodeId, which must be the only node
+// in the queue. Specialized at compile time on the kind of run so that the
+// relax loop has no checks that the run doesn't need: kUseLinkMetric relaxes
+// over link metrics instead of hop count, kHasLinksToIgnore skips links in
+// linksToIgnore and kHasOverloadedNodes doesn't transit overloaded nodes.
+// Returns the number of extracted nodes
+template <bool kUseLinkMetric, bool kHasLinksToIgnore, bool kHasOverloadedNodes>
+uint64_t
+runSpecializedDijkstra(
+    DijkstraQ& q,
+    const openr::LinkState& linkState,
+    NodeId srcNodeId,
+    const openr::LinkState::LinkSet& linksToIgnore,
+    SpfResult& result) {
+  auto const& graph = linkState.getCsrGraph();
+  uint64_t loop = 0;
+  for (NodeId nodeId; q.extractMin(nodeId);) {
+    ++loop;
+    recordDijkstraQNode(result, q, linkState, nodeId);
+    if (kHasOverloadedNodes and nodeId != srcNodeId and
+        linkState.isNodeOverloaded(linkState.getNodeName(nodeId))) {
+      continue;
+    }
+    const auto nodeMetric = q.getDistance(nodeId);
+    auto const* nodeNextHops = q.getNextHops(nodeId);
+    for (auto i = graph.offsets[nodeId]; i < graph.offsets[nodeId + 1]; ++i) {
+      auto const& edge = graph.edges[i];
+      if (not edge.link->isUp() or q.wasExtracted(edge.otherNodeId) or
+          (kHasLinksToIgnore and linksToIgnore.count(edge.link))) {
+        continue;
+      }
+      const Metric metric = kUseLinkMetric ? edge.getMetric() : 1;
+      relaxDijkstraQNode(
+          q,
+          srcNodeId,
+          nodeId,
+          nodeNextHops,
+          edge.otherNodeId,
+          nodeMetric + metric);
+    }
+  }
+  return loop;
+}
+
+using SpecializedDijkstra = uint64_t (*)(
+    DijkstraQ&,
+    const openr::LinkState&,
+    NodeId,
+    const openr::LinkState::LinkSet&,
+    SpfResult&);
+
+// runSpecializedDijkstra instances, indexed by getSpecializedDijkstra()
+const std::array<SpecializedDijkstra, 8> kSpecializedDijkstras{{
+    &runSpecializedDijkstra<false, false, false>,
+    &runSpecializedDijkstra<false, false, true>,
+    &runSpecializedDijkstra<false, true, false>,
+    &runSpecializedDijkstra<false, true, true>,
+    &runSpecializedDijkstra<true, false, false>,
+    &runSpecializedDijkstra<true, false, true>,
+    &runSpecializedDijkstra<true, true, false>,
+    &runSpecializedDijkstra<true, true, true>,
+}};
+
+SpecializedDijkstra
+getSpecializedDijkstra(
+    bool useLinkMetric, bool hasLinksToIgnore, bool hasOverloadedNodes) {
+  return kSpecializedDijkstras
+      [(useLinkMetric << 2) | (hasLinksToIgnore << 1) | hasOverloadedNodes];
+}
+
+// Histogram counters for the duration of the phase ending with a perf event
+const std::unordered_map<std::string, std::string> kPhaseCounterNames{
+    {"DECISION_DEBOUNCE", "decision.phase.debounce_ms"},
+    {"DECISION_COMPUTE_START", "decision.phase.compute_wait_ms"},
+    {"DECISION_SPF_RUN", "decision.phase.spf_ms"},
+    {"DECISION_LFA_SPF_RUN", "decision.phase.lfa_spf_ms"},
+    {"DECISION_ROUTE_BUILD", "decision.phase.route_build_ms"},
+    {"DECISION_ROUTE_DELTA", "decision.phase.route_delta_ms"},
 };
 
+// Append the phase events recorded by the solver to the perf events which
+// led to the route computation. Phase events alone are dropped, as without
+// the preceding events they do not describe a convergence
+void
+mergePhaseEvents(
+    folly::Optional<openr::thrift::PerfEvents> perfEvents,
+    openr::thrift::RouteDatabaseDelta& routeDelta) {
+  if (perfEvents.hasValue() and routeDelta.perfEvents.hasValue()) {
+    auto& phaseEvents = routeDelta.perfEvents.value().events;
+    perfEvents->events.insert(
+        perfEvents->events.end(),
+        std::make_move_iterator(phaseEvents.begin()),
+        std::make_move_iterator(phaseEvents.end()));
+  }
+  routeDelta.perfEvents = std::move(perfEvents);
+}
+
 } // anonymous namespace
 
 namespace openr {
@@ -137,12 +607,36 @@ class SpfSolver::SpfSolverImpl {
       bool enableV4,
       bool computeLfaPaths,
       bool enableOrderedFib,
-      bool bgpDryRun)
+      bool bgpDryRun,
+      size_t lfaSpfThreads,
+      size_t routeBuildThreads,
+      std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor,
+      bool useRadixHeapSpf,
+      bool useSpecializedSpf)
       : myNodeName_(myNodeName),
         enableV4_(enableV4),
         computeLfaPaths_(computeLfaPaths),
         enableOrderedFib_(enableOrderedFib),
-        bgpDryRun_(bgpDryRun) {}
+        bgpDryRun_(bgpDryRun),
+        useRadixHeapSpf_(useRadixHeapSpf),
+        useSpecializedSpf_(useSpecializedSpf) {
+    routeDbCache_.thisNodeName = myNodeName_;
+    if (sharedExecutor) {
+      if (computeLfaPaths_) {
+        lfaSpfExecutor_ = sharedExecutor;
+      }
+      routeBuildExecutor_ = std::move(sharedExecutor);
+      return;
+    }
+    if (computeLfaPaths_ and lfaSpfThreads > 0) {
+      lfaSpfExecutor_ =
+          std::make_unique<folly::CPUThreadPoolExecutor>(lfaSpfThreads);
+    }
+    if (routeBuildThreads > 0) {
+      routeBuildExecutor_ =
+          std::make_unique<folly::CPUThreadPoolExecutor>(routeBuildThreads);
+    }
+  }
 
   ~SpfSolverImpl() = default;
 
@@ -153,6 +647,8 @@ class SpfSolver::SpfSolverImpl {
 
   bool hasHolds() const;
 
+  uint64_t getHoldTtl() const;
+
   // returns true if the AdjacencyDatabase existed
   bool deleteAdjacencyDatabase(const std::string& nodeName);
 
@@ -161,18 +657,31 @@ class SpfSolver::SpfSolverImpl {
   // returns true if the prefixDb changed
   bool updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb);
 
+  // returns true if any of the prefixDbs changed
+  bool updatePrefixDatabases(
+      const std::vector<thrift::PrefixDatabase>& prefixDbs);
+
   // returns true if the PrefixDatabase existed
   bool deletePrefixDatabase(const std::string& nodeName);
 
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
   getPrefixDatabases();
 
+  std::shared_ptr<const SpfSolverSnapshot> getSnapshot();
+
   folly::Optional<thrift::RouteDatabase> buildPaths(
       const std::string& myNodeName);
   folly::Optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
+  folly::Optional<thrift::RouteDatabaseDelta> buildPathsDelta(
+      const std::string& myNodeName);
+  folly::Optional<thrift::RouteDatabaseDelta> buildRouteDbDelta(
+      const std::string& myNodeName, bool fullBuild = false);
+  folly::Optional<thrift::RouteDatabaseDelta> checkRouteDbCache(
+      const std::string& myNodeName);
+  void setRouteDbCache(const thrift::RouteDatabase& routeDb);
 
-  bool decrementHolds();
+  bool decrementHolds(uint64_t ticks);
 
   std::unordered_map<std::string, int64_t> getCounters();
 
@@ -195,6 +704,10 @@ class SpfSolver::SpfSolverImpl {
   SpfSolverImpl(SpfSolverImpl const&) = delete;
   SpfSolverImpl& operator=(SpfSolverImpl const&) = delete;
 
+  // prefix entries of a prefix by advertising node. Entries are owned by
+  // prefix databases of snapshot_, which are immutable
+  using PrefixEntries = std::map<std::string, thrift::PrefixEntry const*>;
+
   // run SPF and produce map from node name to next-hops that have shortest
   // paths to it
   SpfResult runSpf(
@@ -202,6 +715,54 @@ class SpfSolver::SpfSolverImpl {
       bool useLinkMetric,
       const LinkState::LinkSet& linksToIgnore = {});
 
+  // Dijkstra part of runSpf without any bookkeeping. Only reads linkState_
+  // and hence is safe to be called concurrently as long as linkState_ is not
+  // modified and its CSR graph is already built. numAllocations, if given,
+  // is set to the number of allocations of the queue during the run
+  SpfResult computeSpf(
+      const std::string& nodeName,
+      bool useLinkMetric,
+      const LinkState::LinkSet& linksToIgnore,
+      size_t* numAllocations = nullptr) const;
+
+  // Compute SPF results of the given neighbors (for LFA) into spfResults_.
+  // Cached results are updated incrementally in place, rest of the neighbors
+  // are fanned out over lfaSpfExecutor_ if configured
+  void buildNeighborSpfResults(
+      const std::vector<std::string>& neighbors,
+      std::unordered_map<std::string, SpfResult>& prevSpfResults);
+
+  // Return SPF result for nodeName. Cached result from previous run (if any)
+  // is brought up to date with the recorded link changes, else full SPF is run
+  SpfResult getSpfResult(
+      const std::string& nodeName,
+      std::unordered_map<std::string, SpfResult>& prevSpfResults);
+
+  // Apply recorded link/node changes on the SPF result of nodeName computed
+  // before those changes. Only the nodes whose shortest paths could be
+  // affected are re-computed. Returns false if incremental computation is not
+  // worthwhile, in which case spfResult must be discarded
+  bool runIncrementalSpf(const std::string& nodeName, SpfResult& spfResult);
+
+  // Record state of a link (before it is modified) for incremental SPF. For
+  // newly added link isNewLink must be set
+  void recordLinkChange(const std::shared_ptr<Link>& link, bool isNewLink);
+
+  // Record overload state of a node (before it is modified) for incremental
+  // SPF
+  void recordNodeOverloadChange(const std::string& nodeName);
+
+  // Forget all recorded changes. Cached SPF results will not be re-used
+  void invalidateSpfCache();
+
+  // Returns false only if none of the recorded link and node overload changes
+  // can alter any of spfResults_, i.e. none of them is or becomes part of a
+  // shortest path. Changes of the spfResults_ node's own links always count
+  bool recordedChangesAffectSpf() const;
+
+  // Track prefix entry added to or removed from prefixes_
+  void countPrefixEntry(thrift::PrefixEntry const& prefixEntry, bool added);
+
   // Trace all edge disjoint paths from source to destination node.
   // srcNodeDistances => map indicating distances of each node from source
   // Returns list of paths.
@@ -216,23 +777,107 @@ class SpfSolver::SpfSolverImpl {
   std::vector<std::shared_ptr<Link>> getOrderedLinkSet(
       const thrift::AdjacencyDatabase& adjDb);
 
+  // Run SPF for myNodeName (and its neighbors for LFA) into spfResults_
+  void computeSpfResults(const std::string& myNodeName);
+
+  // Compute MPLS routes (node and adjacency labels) based on spfResults_. A
+  // label claimed by several nodes is routed to the lowest node name, our
+  // adjacency labels take precedence over node labels
+  std::vector<thrift::MplsRoute> createMplsRoutes(
+      const std::string& myNodeName);
+
+  // MPLS route of node label of adjDb, folly::none if it has none
+  folly::Optional<thrift::MplsRoute> createNodeLabelRoute(
+      const std::string& myNodeName, const thrift::AdjacencyDatabase& adjDb);
+
+  // MPLS routes of our adjacency labels, by label
+  std::unordered_map<int32_t, thrift::MplsRoute> createAdjLabelRoutes(
+      const std::string& myNodeName);
+
+  // Bring MPLS routes of routeDbCache_ up to date with spfResults_, only
+  // re-computing node label routes of dirtyLabelNodes_ if label routes are
+  // valid. Changes are recorded in routeDbDelta
+  void updateMplsRoutes(
+      const std::string& myNodeName, thrift::RouteDatabaseDelta& routeDbDelta);
+
+  // Mark node label routes affected by a new SPF result of nodeName dirty.
+  // prevResult is the result it replaces, nullptr if there was none
+  void recordLabelRouteChanges(
+      const std::string& nodeName,
+      const SpfResult* prevResult,
+      const SpfResult& result);
+
+  void markLabelNodeDirty(const std::string& nodeName);
+
+  // Next updateMplsRoutes re-computes all node label routes
+  void invalidateLabelRoutes();
+
+  // Merge route (or its absence) of prefix into routeDbCache_. Recorded in
+  // routeDbDelta only if it differs from the cached route
+  void recordUnicastRoute(
+      thrift::IpPrefix const& prefix,
+      folly::Optional<thrift::UnicastRoute>&& route,
+      thrift::RouteDatabaseDelta& routeDbDelta);
+
+  // Compute unicast route for a single prefix based on current spfResults_.
+  // Returns folly::none if no route is to be programmed for it
+  folly::Optional<thrift::UnicastRoute> createUnicastRouteForPrefix(
+      std::string const& myNodeName,
+      thrift::IpPrefix const& prefix,
+      PrefixEntries const& nodePrefixes);
+
+  // Compute unicast route (or none) for each of prefixes_, in prefixes_
+  // iteration order. Built in prefix shards over routeBuildExecutor_ if
+  // configured, with the same results as building them inline
+  std::vector<folly::Optional<thrift::UnicastRoute>>
+  createUnicastRoutesForPrefixes(std::string const& myNodeName);
+
+  // Record a prefix whose route needs to be re-computed by buildRouteDbDelta
+  void markPrefixDirty(thrift::IpPrefix const& prefix);
+
+  // Routes can no longer be updated per prefix, next route computation must
+  // be a full buildRouteDb
+  void invalidateRouteDbDelta();
+
   folly::Optional<thrift::UnicastRoute> createOpenRRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
-      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      PrefixEntries const& nodePrefixes,
       bool const isV4);
   folly::Optional<thrift::UnicastRoute> createBGPRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
-      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      PrefixEntries const& nodePrefixes,
       bool const isV4);
 
   folly::Optional<thrift::UnicastRoute> createOpenRKsp2EdRoute(
       std::string const& myNodeName,
       thrift::IpPrefix const& prefix,
-      std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+      PrefixEntries const& nodePrefixes,
       bool const isV4);
 
+  // Shortest and second shortest edge disjoint paths with their cost towards
+  // the closest of dstNodeNames, based on current spfResults_. Returned paths
+  // are owned by the KSP2 cache and memoized per SPF generation
+  std::vector<std::pair<Path const*, Metric>> getKsp2Paths(
+      const std::string& myNodeName,
+      const std::set<std::string>& dstNodeNames);
+
+  // Memoized traceEdgeDisjointPaths on spfResults_ of myNodeName
+  std::vector<Path> const& getKsp2ShortestPaths(
+      const std::string& myNodeName, const std::string& dstNodeName);
+
+  // Report time spent on KSP2 routes since last call as decision.ksp2_ms
+  void reportKsp2Duration();
+
+  // Next-hops towards the set of advertising nodes of a prefix, memoized per
+  // SPF generation. Returns folly::none if none of the nodes is reachable
+  folly::Optional<std::vector<thrift::NextHopThrift>> const& getPrefixNextHops(
+      const std::string& myNodeName,
+      const std::set<std::string>& prefixNodes,
+      bool isV4,
+      bool perDestination);
+
   // return a loopback address for each node in the the set
   std::vector<thrift::NextHopThrift> getLoopbackVias(
       std::unordered_set<std::string> const& nodes, bool const isV4);
@@ -277,9 +922,25 @@ class SpfSolver::SpfSolverImpl {
   // returns the hop count of the furthest node connected to nodeName
   Metric getMaxHopsToNode(const std::string& nodeName);
 
-  std::unordered_map<std::string, thrift::AdjacencyDatabase>
+  // databases are immutable once stored and shared with snapshot_
+  std::unordered_map<
+      std::string,
+      std::shared_ptr<const thrift::AdjacencyDatabase>>
       adjacencyDatabases_;
 
+  // returns snapshot_ for modification, copied first if it is referenced by
+  // any reader. Bumps the version
+  SpfSolverSnapshot& mutableSnapshot();
+
+  // point entries of prefixDb's node in prefixes_ to the ones of prefixDb,
+  // and make it the node's prefix database of snapshot_
+  void setPrefixDbSnapshot(
+      std::shared_ptr<const thrift::PrefixDatabase> prefixDb);
+
+  // adjacency and prefix databases as handed out to readers
+  std::shared_ptr<SpfSolverSnapshot> snapshot_{
+      std::make_shared<SpfSolverSnapshot>()};
+
   LinkState linkState_;
 
   // Save all direct next-hop distance from a given source node to a destination
@@ -291,18 +952,151 @@ class SpfSolver::SpfSolverImpl {
           pair<Metric, unordered_set<string /* nextHopNodeName */>>>>
       spfResults_;
 
-  // For each prefix in the network, stores a set of nodes that advertise it
+  // State of a link before changes, as recorded for incremental SPF
+  struct LinkSnapshot {
+    std::string node1;
+    std::string node2;
+    Metric metric1{0}; // node1 -> node2
+    Metric metric2{0}; // node2 -> node1
+    bool wasUp{false};
+  };
+
+  // Link and node changes since last buildPaths. Only the first snapshot of a
+  // link (and overload state of a node) is kept
+  std::unordered_map<
+      std::shared_ptr<Link>,
+      LinkSnapshot,
+      LinkState::LinkPtrHash,
+      LinkState::LinkPtrEqual>
+      linkChanges_;
+  std::unordered_map<std::string /* nodeName */, bool /* wasOverloaded */>
+      nodeOverloadChanges_;
+
+  // Set to false if we lost track of the changes since last buildPaths
+  bool spfCacheValid_{false};
+
+  // Set if ordered FIB holds expired since last buildPaths
+  bool holdsExpired_{false};
+
+  // number of entries in prefixes_ using KSP2_ED_ECMP. Their routes depend on
+  // second shortest paths, hence any link change can affect them
+  size_t numKsp2PrefixEntries_{0};
+
+  // Routes of myNodeName_ as reported by the route deltas so far
+  RouteDatabaseMap routeDbCache_;
+
+  // Prefixes changed since routeDbCache_ was last brought up to date. Only
+  // valid if routeDbDeltaValid_ is set, i.e. nothing but these prefixes has
+  // changed since then
+  std::unordered_set<thrift::IpPrefix> dirtyPrefixes_;
+  bool routeDbDeltaValid_{false};
+
+  // Node label routes of routeDbCache_ by node. Next-hops of a node label
+  // route only change with the node's label, its shortest paths (and
+  // distances of neighbors to it and to us for LFA) and our links
+  std::unordered_map<std::string /* nodeName */, thrift::MplsRoute>
+      nodeLabelRoutes_;
+  // nodes of nodeLabelRoutes_ by label
+  std::unordered_map<int32_t, std::set<std::string>> labelNodes_;
+  // routes of our adjacency labels by label
+  std::unordered_map<int32_t, thrift::MplsRoute> adjLabelRoutes_;
+  // nodes whose node label route may have changed. Only tracked while
+  // labelRoutesValid_ is set, else all node label routes are re-computed
+  std::unordered_set<std::string> dirtyLabelNodes_;
+  bool labelRoutesValid_{false};
+
+  // our up links, as label routes were last computed with
+  using LocalLinkKey = std::tuple<
+      std::string /* otherNodeName */,
+      std::string /* ifName */,
+      Metric,
+      thrift::BinaryAddress /* nhV4 */,
+      thrift::BinaryAddress /* nhV6 */>;
+  std::vector<LocalLinkKey> labelRoutesLinks_;
+
+  // Perf events marking the end of each phase of the ongoing *Delta route
+  // computation, starting with DECISION_COMPUTE_START. Empty otherwise.
+  // Handed out as perfEvents of the computed route delta
+  thrift::PerfEvents phaseEvents_;
+
+  // Mark end of a phase of the ongoing *Delta route computation, if any
+  void addPhaseEvent(const std::string& eventDescr);
+
+  // node from whose perspective spfResults_ were last built
+  std::string spfResultsNodeName_;
+
+  // Bumped whenever spfResults_ or the link state next-hops are derived from
+  // change. Memoized next-hops are only valid within a generation
+  uint64_t spfGeneration_{0};
+
+  // Key for memoized prefix next-hops. Many prefixes share the same set of
+  // advertising nodes and hence the same next-hops
+  struct NextHopsKey {
+    std::string myNodeName;
+    std::set<std::string> prefixNodes;
+    bool isV4{false};
+    bool perDestination{false};
+
+    bool
+    operator==(const NextHopsKey& other) const {
+      return isV4 == other.isV4 and perDestination == other.perDestination and
+          myNodeName == other.myNodeName and prefixNodes == other.prefixNodes;
+    }
+  };
+
+  struct NextHopsKeyHash {
+    size_t
+    operator()(const NextHopsKey& key) const {
+      return folly::hash::hash_combine(
+          folly::hash::hash_range(
+              key.prefixNodes.begin(), key.prefixNodes.end()),
+          key.myNodeName,
+          key.isV4,
+          key.perDestination);
+    }
+  };
+
+  // Next-hops memoized in generation nextHopsCacheGeneration_
   std::unordered_map<
-      thrift::IpPrefix,
-      std::unordered_map<std::string, thrift::PrefixEntry>>
-      prefixes_;
-  std::unordered_map<std::string, std::set<thrift::IpPrefix>> nodeToPrefixes_;
+      NextHopsKey,
+      folly::Optional<std::vector<thrift::NextHopThrift>>,
+      NextHopsKeyHash>
+      nextHopsCache_;
+  uint64_t nextHopsCacheGeneration_{0};
+
+  // Second SPF run of KSP2_ED_ECMP, excluding the links of all shortest paths
+  // towards a set of min-cost destination nodes, along with the second
+  // shortest paths traced on it per destination node
+  struct Ksp2SecondSpf {
+    LinkState::LinkSet linksToIgnore;
+    SpfResult spfResult;
+    std::unordered_map<std::string /* dstNode */, std::vector<Path>> paths;
+  };
+
+  // KSP2_ED_ECMP state memoized in generation ksp2CacheGeneration_ for
+  // ksp2CacheNodeName_. Shared by all prefixes of the same destination nodes
+  std::unordered_map<std::string /* dstNode */, std::vector<Path>>
+      ksp2ShortestPaths_;
+  std::map<std::set<std::string> /* minCostNodes */, Ksp2SecondSpf>
+      ksp2SecondSpfs_;
+  uint64_t ksp2CacheGeneration_{0};
+  std::string ksp2CacheNodeName_;
+
+  // time spent on KSP2_ED_ECMP routes in the current route build
+  std::chrono::microseconds ksp2Duration_{0};
+
+  // For each prefix in the network, ordered by prefix as routes are, the
+  // nodes that advertise it. Entries refer to prefix databases of snapshot_
+  std::map<thrift::IpPrefix, PrefixEntries> prefixes_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV4_;
   std::unordered_map<std::string, thrift::BinaryAddress> nodeHostLoopbacksV6_;
 
   // track some stats
   fbzmq::ThreadData tData_;
 
+  // durations of SPF runs, 1ms buckets up to 1s
+  LatencyHistogram spfHistogram_{1, 1000};
+
   const std::string myNodeName_;
 
   // is v4 enabled. If yes then Decision will forward v4 prefixes with v4
@@ -314,6 +1108,21 @@ class SpfSolver::SpfSolverImpl {
   const bool enableOrderedFib_{false};
 
   const bool bgpDryRun_{false};
+
+  // run Dijkstra over a radix heap instead of a binary heap
+  const bool useRadixHeapSpf_{false};
+
+  // run full SPF with runSpecializedDijkstra()
+  const bool useSpecializedSpf_{false};
+
+  // optional worker pool for running LFA SPF computations in parallel
+  std::shared_ptr<folly::CPUThreadPoolExecutor> lfaSpfExecutor_;
+
+  // optional worker pool for building unicast routes in prefix shards
+  std::shared_ptr<folly::CPUThreadPoolExecutor> routeBuildExecutor_;
+
+  // guards nextHopsCache_ and tData_ while routes are built in prefix shards
+  std::mutex routeBuildMutex_;
 };
 
 std::pair<
@@ -325,6 +1134,10 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
   VLOG(1) << "Updating adjacency database for node " << nodeName;
   tData_.addStatValue("decision.adj_db_update", 1, fbzmq::COUNT);
 
+  // spfResults_ are in sync with the link state before this update
+  const bool spfResultsInSync = spfCacheValid_ and linkChanges_.empty() and
+      nodeOverloadChanges_.empty();
+
   for (auto const& adj : newAdjacencyDb.adjacencies) {
     VLOG(3) << "  neighbor: " << adj.otherNodeName
             << ", remoteIfName: " << getRemoteIfName(adj)
@@ -332,11 +1145,15 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
             << ", overloaded: " << adj.isOverloaded << ", rtt: " << adj.rtt;
   }
 
-  // Default construct if it did not exist
-  thrift::AdjacencyDatabase priorAdjacencyDb(
-      std::move(adjacencyDatabases_[nodeName]));
+  // nullptr if it did not exist
+  auto& adjacencyDb = adjacencyDatabases_[nodeName];
+  const auto priorAdjacencyDb = adjacencyDb;
   // replace
-  adjacencyDatabases_[nodeName] = newAdjacencyDb;
+  if (not priorAdjacencyDb or *priorAdjacencyDb != newAdjacencyDb) {
+    adjacencyDb =
+        std::make_shared<const thrift::AdjacencyDatabase>(newAdjacencyDb);
+    mutableSnapshot().adjacencyDatabases[nodeName] = adjacencyDb;
+  }
 
   // for comparing old and new state, we order the links based on the tuple
   // <nodeName1, iface1, nodeName2, iface2>, this allows us to easily discern
@@ -354,15 +1171,21 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
     holdDownTtl = getMaxHopsToNode(nodeName) - holdUpTtl;
   }
 
+  if (linkState_.isNodeOverloaded(nodeName) != newAdjacencyDb.isOverloaded) {
+    recordNodeOverloadChange(nodeName);
+  }
   bool topoChanged = linkState_.updateNodeOverloaded(
       nodeName, newAdjacencyDb.isOverloaded, holdUpTtl, holdDownTtl);
 
   bool routeAttrChanged = false;
 
-  // Check for nodeLabel change for myself. If changed we will need to update
+  // Check for nodeLabel change. If changed for myself we will need to update
   // POP route for local node
-  if (myNodeName_ == nodeName) {
-    routeAttrChanged |= priorAdjacencyDb.nodeLabel != newAdjacencyDb.nodeLabel;
+  const auto priorNodeLabel =
+      priorAdjacencyDb ? priorAdjacencyDb->nodeLabel : 0;
+  if (priorNodeLabel != newAdjacencyDb.nodeLabel) {
+    markLabelNodeDirty(nodeName);
+    routeAttrChanged |= myNodeName_ == nodeName;
   }
 
   auto newIter = newLinks.begin();
@@ -374,6 +1197,7 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
       // link to add and advance newIter
       (*newIter)->setHoldUpTtl(holdUpTtl);
       topoChanged |= (*newIter)->isUp();
+      recordLinkChange(*newIter, true /* isNewLink */);
       // even if we are holding a change, we apply the change to our link state
       // and check for holds when running spf. this ensures we don't add the
       // same hold twice
@@ -389,6 +1213,7 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
       // If this link was previously overloaded or had a hold up, this does not
       // change the topology.
       topoChanged |= (*oldIter)->isUp();
+      recordLinkChange(*oldIter, false /* isNewLink */);
       linkState_.removeLink(*oldIter);
       VLOG(1) << "removeLink " << (*oldIter)->toString();
       ++oldIter;
@@ -400,6 +1225,14 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
     auto& newLink = **newIter;
     auto& oldLink = **oldIter;
 
+    // record link state before applying metric or overload changes
+    if (oldLink.getMetricFromNode(nodeName) !=
+            newLink.getMetricFromNode(nodeName) or
+        oldLink.getOverloadFromNode(nodeName) !=
+            newLink.getOverloadFromNode(nodeName)) {
+      recordLinkChange(*oldIter, false /* isNewLink */);
+    }
+
     // change the metric on the link object we already have
     bool metricChanged = oldLink.setMetricFromNode(
         nodeName, newLink.getMetricFromNode(nodeName), holdUpTtl, holdDownTtl);
@@ -467,6 +1300,22 @@ SpfSolver::SpfSolverImpl::updateAdjacencyDatabase(
     ++oldIter;
   }
 
+  // Skip route computation if the changes provably leave all shortest paths
+  // as they are, e.g. metric increase of a link not on any shortest path or
+  // overload of a node nobody transits. spfResults_ stay valid as they are
+  if (topoChanged and not routeAttrChanged and spfResultsInSync and
+      numKsp2PrefixEntries_ == 0 and not recordedChangesAffectSpf()) {
+    VLOG(1) << "Topology change of node " << nodeName
+            << " does not affect shortest paths, skipping SPF";
+    tData_.addStatValue("decision.spf_skipped", 1, fbzmq::COUNT);
+    linkChanges_.clear();
+    nodeOverloadChanges_.clear();
+    topoChanged = false;
+  }
+
+  if (topoChanged or routeAttrChanged) {
+    invalidateRouteDbDelta();
+  }
   return std::make_pair(topoChanged, routeAttrChanged);
 }
 
@@ -475,6 +1324,11 @@ SpfSolver::SpfSolverImpl::hasHolds() const {
   return linkState_.hasHolds();
 }
 
+uint64_t
+SpfSolver::SpfSolverImpl::getHoldTtl() const {
+  return linkState_.getHoldTtl();
+}
+
 Metric
 SpfSolver::SpfSolverImpl::getMyHopsToNode(const std::string& nodeName) {
   if (myNodeName_ == nodeName) {
@@ -497,8 +1351,179 @@ SpfSolver::SpfSolverImpl::getMaxHopsToNode(const std::string& nodeName) {
 }
 
 bool
-SpfSolver::SpfSolverImpl::decrementHolds() {
-  return linkState_.decrementHolds();
+SpfSolver::SpfSolverImpl::decrementHolds(uint64_t ticks) {
+  // record links and nodes as they are before their holds expire, all holds
+  // expiring together are then covered by one incremental SPF
+  for (auto const& link : linkState_.getLinksWithExpiringHolds(ticks)) {
+    recordLinkChange(link, false /* isNewLink */);
+  }
+  for (auto const& nodeName : linkState_.getNodesWithExpiringHolds(ticks)) {
+    recordNodeOverloadChange(nodeName);
+  }
+  if (linkState_.decrementHolds(ticks)) {
+    holdsExpired_ = true;
+    invalidateRouteDbDelta();
+    return true;
+  }
+  return false;
+}
+
+void
+SpfSolver::SpfSolverImpl::recordLinkChange(
+    const std::shared_ptr<Link>& link, bool isNewLink) {
+  if (not spfCacheValid_ or linkChanges_.count(link)) {
+    return;
+  }
+  if (linkChanges_.size() + nodeOverloadChanges_.size() >=
+      Constants::kMaxIncrementalSpfChanges) {
+    invalidateSpfCache();
+    return;
+  }
+  LinkSnapshot snapshot;
+  snapshot.node1 = link->firstNodeName();
+  snapshot.node2 = link->secondNodeName();
+  if (not isNewLink) {
+    snapshot.metric1 = link->getMetricFromNode(snapshot.node1);
+    snapshot.metric2 = link->getMetricFromNode(snapshot.node2);
+    snapshot.wasUp = link->isUp();
+  }
+  linkChanges_.emplace(link, std::move(snapshot));
+}
+
+void
+SpfSolver::SpfSolverImpl::recordNodeOverloadChange(
+    const std::string& nodeName) {
+  if (not spfCacheValid_ or nodeOverloadChanges_.count(nodeName)) {
+    return;
+  }
+  if (linkChanges_.size() + nodeOverloadChanges_.size() >=
+      Constants::kMaxIncrementalSpfChanges) {
+    invalidateSpfCache();
+    return;
+  }
+  nodeOverloadChanges_.emplace(
+      nodeName, linkState_.isNodeOverloaded(nodeName));
+}
+
+bool
+SpfSolver::SpfSolverImpl::recordedChangesAffectSpf() const {
+  if (not spfCacheValid_ or spfResults_.empty() or
+      spfResultsNodeName_ != myNodeName_) {
+    return true;
+  }
+
+  for (auto const& kv : spfResults_) {
+    auto const& srcNodeName = kv.first;
+    auto const& result = kv.second;
+
+    // true if link from -> to with metric is, or would be, part of a shortest
+    // path in result. Nodes whose overload state changed count as transit
+    auto const isOnShortestPath =
+        [&](const std::string& from, const std::string& to, Metric metric) {
+          auto fromIt = result.find(from);
+          if (fromIt == result.end()) {
+            return false;
+          }
+          if (from != srcNodeName and linkState_.isNodeOverloaded(from) and
+              not nodeOverloadChanges_.count(from)) {
+            return false;
+          }
+          auto toIt = result.find(to);
+          return toIt == result.end() or
+              fromIt->second.first + metric <= toIt->second.first;
+        };
+
+    for (auto const& change : linkChanges_) {
+      auto const& snapshot = change.second;
+      if (snapshot.node1 == spfResultsNodeName_ or
+          snapshot.node2 == spfResultsNodeName_) {
+        return true;
+      }
+      // link as it was
+      if (snapshot.wasUp and
+          (isOnShortestPath(snapshot.node1, snapshot.node2, snapshot.metric1) or
+           isOnShortestPath(
+               snapshot.node2, snapshot.node1, snapshot.metric2))) {
+        return true;
+      }
+      // link as it is now
+      auto const& links = linkState_.linksFromNode(snapshot.node1);
+      auto it = links.find(change.first);
+      if (it == links.end() or not(*it)->isUp()) {
+        continue;
+      }
+      auto const& link = *it;
+      if (isOnShortestPath(
+              snapshot.node1,
+              snapshot.node2,
+              link->getMetricFromNode(snapshot.node1)) or
+          isOnShortestPath(
+              snapshot.node2,
+              snapshot.node1,
+              link->getMetricFromNode(snapshot.node2))) {
+        return true;
+      }
+    }
+
+    // node transiting shortest paths got overloaded, or a node which could
+    // shorten paths is no longer overloaded. Changed links are covered above
+    for (auto const& change : nodeOverloadChanges_) {
+      auto const& nodeName = change.first;
+      if (nodeName == spfResultsNodeName_) {
+        return true;
+      }
+      if (change.second == linkState_.isNodeOverloaded(nodeName)) {
+        continue;
+      }
+      for (auto const& link : linkState_.linksFromNode(nodeName)) {
+        if (link->isUp() and
+            isOnShortestPath(
+                nodeName,
+                link->getOtherNodeName(nodeName),
+                link->getMetricFromNode(nodeName))) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+void
+SpfSolver::SpfSolverImpl::countPrefixEntry(
+    thrift::PrefixEntry const& prefixEntry, bool added) {
+  if (prefixEntry.forwardingAlgorithm !=
+      thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP) {
+    return;
+  }
+  if (added) {
+    ++numKsp2PrefixEntries_;
+  } else {
+    CHECK_GT(numKsp2PrefixEntries_, 0);
+    --numKsp2PrefixEntries_;
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::invalidateSpfCache() {
+  spfCacheValid_ = false;
+  linkChanges_.clear();
+  nodeOverloadChanges_.clear();
+}
+
+void
+SpfSolver::SpfSolverImpl::markPrefixDirty(thrift::IpPrefix const& prefix) {
+  if (routeDbDeltaValid_) {
+    dirtyPrefixes_.emplace(prefix);
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::invalidateRouteDbDelta() {
+  routeDbDeltaValid_ = false;
+  dirtyPrefixes_.clear();
+  // link state changed, next-hops derived from it are stale
+  ++spfGeneration_;
 }
 
 bool
@@ -511,14 +1536,53 @@ SpfSolver::SpfSolverImpl::deleteAdjacencyDatabase(const std::string& nodeName) {
                  << nodeName;
     return false;
   }
+  if (linkState_.isNodeOverloaded(nodeName)) {
+    recordNodeOverloadChange(nodeName);
+  }
+  for (auto const& link : linkState_.linksFromNode(nodeName)) {
+    recordLinkChange(link, false /* isNewLink */);
+  }
   linkState_.removeNode(nodeName);
   adjacencyDatabases_.erase(search);
+  markLabelNodeDirty(nodeName);
+  mutableSnapshot().adjacencyDatabases.erase(nodeName);
+  invalidateRouteDbDelta();
   return true;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::AdjacencyDatabase>
 SpfSolver::SpfSolverImpl::getAdjacencyDatabases() {
-  return adjacencyDatabases_;
+  std::unordered_map<std::string, thrift::AdjacencyDatabase> adjDatabases;
+  for (auto const& kv : adjacencyDatabases_) {
+    adjDatabases.emplace(kv.first, *kv.second);
+  }
+  return adjDatabases;
+}
+
+SpfSolverSnapshot&
+SpfSolver::SpfSolverImpl::mutableSnapshot() {
+  if (snapshot_.use_count() > 1) {
+    // a reader holds on to the current snapshot. Copy pointers only, the
+    // databases themselves are immutable and shared
+    snapshot_ = std::make_shared<SpfSolverSnapshot>(*snapshot_);
+  }
+  ++snapshot_->version;
+  return *snapshot_;
+}
+
+void
+SpfSolver::SpfSolverImpl::setPrefixDbSnapshot(
+    std::shared_ptr<const thrift::PrefixDatabase> prefixDb) {
+  auto const& nodeName = prefixDb->thisNodeName;
+  for (auto const& prefixEntry : prefixDb->prefixEntries) {
+    prefixes_.at(prefixEntry.prefix).at(nodeName) = &prefixEntry;
+  }
+  mutableSnapshot().prefixDatabases[nodeName] = std::move(prefixDb);
+}
+
+std::shared_ptr<const SpfSolverSnapshot>
+SpfSolver::SpfSolverImpl::getSnapshot() {
+  return snapshot_;
 }
 
 bool
@@ -528,79 +1592,130 @@ SpfSolver::SpfSolverImpl::updatePrefixDatabase(
   VLOG(1) << "Updating prefix database for node " << nodeName;
   tData_.addStatValue("decision.prefix_db_update", 1, fbzmq::COUNT);
 
-  // Get old and new set of prefixes - NOTE explicit copy
-  const std::set<thrift::IpPrefix> oldPrefixSet = nodeToPrefixes_[nodeName];
-
-  // update the entry
-  auto& newPrefixSet = nodeToPrefixes_[nodeName];
-  newPrefixSet.clear();
-  for (const auto& prefixEntry : prefixDb.prefixEntries) {
-    newPrefixSet.emplace(prefixEntry.prefix);
+  // New prefix database of the node, with the last entry of every prefix,
+  // sorted by prefix. Metric vectors are stored sorted, best path selection
+  // compares them as they are
+  std::map<thrift::IpPrefix, thrift::PrefixEntry const*> advertisedEntries;
+  for (auto const& prefixEntry : prefixDb.prefixEntries) {
+    advertisedEntries[prefixEntry.prefix] = &prefixEntry;
+  }
+  auto newPrefixDb = std::make_shared<thrift::PrefixDatabase>();
+  newPrefixDb->thisNodeName = nodeName;
+  newPrefixDb->prefixEntries.reserve(advertisedEntries.size());
+  for (auto const& kv : advertisedEntries) {
+    newPrefixDb->prefixEntries.emplace_back(*kv.second);
+    auto& mv = newPrefixDb->prefixEntries.back().mv;
+    if (mv.hasValue() and not MetricVectorUtils::isSorted(mv.value())) {
+      MetricVectorUtils::sortMetricVector(mv.value());
+    }
   }
 
   // Boolean to indicate update in prefix entry
   bool isUpdated{false};
 
-  // Remove old prefixes first
-  for (const auto& prefix : oldPrefixSet) {
-    if (newPrefixSet.count(prefix)) {
-      continue;
-    }
-    VLOG(1) << "Prefix " << toString(prefix) << " has been withdrawn by "
-            << nodeName;
-    auto& nodeList = prefixes_.at(prefix);
-    nodeList.erase(nodeName);
-    isUpdated = true;
-    if (nodeList.empty()) {
-      prefixes_.erase(prefix);
+  // Remove old prefixes first. Old entries stay valid until the new database
+  // replaces the old one in snapshot_
+  auto oldPrefixDbIt = snapshot_->prefixDatabases.find(nodeName);
+  const bool hadPrefixDb = oldPrefixDbIt != snapshot_->prefixDatabases.end();
+  if (hadPrefixDb) {
+    for (const auto& oldEntry : oldPrefixDbIt->second->prefixEntries) {
+      auto const& prefix = oldEntry.prefix;
+      if (advertisedEntries.count(prefix)) {
+        continue;
+      }
+      VLOG(1) << "Prefix " << toString(prefix) << " has been withdrawn by "
+              << nodeName;
+      auto& nodeList = prefixes_.at(prefix);
+      countPrefixEntry(oldEntry, false /* added */);
+      nodeList.erase(nodeName);
+      isUpdated = true;
+      markPrefixDirty(prefix);
+      if (nodeList.empty()) {
+        prefixes_.erase(prefix);
+      }
     }
   }
-  for (const auto& prefixEntry : prefixDb.prefixEntries) {
+  for (const auto& prefixEntry : newPrefixDb->prefixEntries) {
     auto& nodeList = prefixes_[prefixEntry.prefix];
     auto nodePrefixIt = nodeList.find(nodeName);
     if (nodePrefixIt == nodeList.end()) {
       VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
               << " has been advertised by node " << nodeName;
-      nodeList.emplace(nodeName, prefixEntry);
+      nodeList.emplace(nodeName, &prefixEntry);
+      countPrefixEntry(prefixEntry, true /* added */);
       isUpdated = true;
-    } else if (nodePrefixIt->second != prefixEntry) {
+      markPrefixDirty(prefixEntry.prefix);
+    } else if (*nodePrefixIt->second != prefixEntry) {
       VLOG(1) << "Prefix " << toString(prefixEntry.prefix)
               << " has been updated by node " << nodeName;
-      nodeList[nodeName] = prefixEntry;
+      countPrefixEntry(*nodePrefixIt->second, false /* added */);
+      countPrefixEntry(prefixEntry, true /* added */);
+      nodePrefixIt->second = &prefixEntry;
       isUpdated = true;
+      markPrefixDirty(prefixEntry.prefix);
     }
     if (thrift::PrefixType::LOOPBACK == prefixEntry.type) {
+      // loopbacks are used as nexthops of BGP routes of the node. A change
+      // affects routes of other prefixes too
       auto addrSize = prefixEntry.prefix.prefixAddress.addr.size();
       if (addrSize == folly::IPAddressV4::byteCount() &&
           folly::IPAddressV4::bitCount() == prefixEntry.prefix.prefixLength) {
-        nodeHostLoopbacksV4_[nodeName] = prefixEntry.prefix.prefixAddress;
+        auto& loopback = nodeHostLoopbacksV4_[nodeName];
+        if (loopback != prefixEntry.prefix.prefixAddress) {
+          loopback = prefixEntry.prefix.prefixAddress;
+          invalidateRouteDbDelta();
+        }
       }
       if (addrSize == folly::IPAddressV6::byteCount() &&
           folly::IPAddressV6::bitCount() == prefixEntry.prefix.prefixLength) {
-        nodeHostLoopbacksV6_[nodeName] = prefixEntry.prefix.prefixAddress;
+        auto& loopback = nodeHostLoopbacksV6_[nodeName];
+        if (loopback != prefixEntry.prefix.prefixAddress) {
+          loopback = prefixEntry.prefix.prefixAddress;
+          invalidateRouteDbDelta();
+        }
       }
     }
   }
 
+  // unchanged entries still refer to the old database, which is kept then
+  if (isUpdated or not hadPrefixDb) {
+    setPrefixDbSnapshot(std::move(newPrefixDb));
+  }
+  return isUpdated;
+}
+
+bool
+SpfSolver::SpfSolverImpl::updatePrefixDatabases(
+    const std::vector<thrift::PrefixDatabase>& prefixDbs) {
+  tData_.addStatValue("decision.prefix_db_batch_update", 1, fbzmq::COUNT);
+  tData_.addStatValue(
+      "decision.prefix_db_batch_size", prefixDbs.size(), fbzmq::AVG);
+  bool isUpdated{false};
+  for (auto const& prefixDb : prefixDbs) {
+    isUpdated |= updatePrefixDatabase(prefixDb);
+  }
   return isUpdated;
 }
 
 bool
 SpfSolver::SpfSolverImpl::deletePrefixDatabase(const std::string& nodeName) {
   VLOG(1) << "Deleting prefix database for node " << nodeName;
-  auto search = nodeToPrefixes_.find(nodeName);
-  if (search == nodeToPrefixes_.end()) {
+  auto search = snapshot_->prefixDatabases.find(nodeName);
+  if (search == snapshot_->prefixDatabases.end()) {
     LOG(INFO) << "Trying to delete non-existent prefix db for node "
               << nodeName;
     return false;
   }
 
   bool isUpdated = false;
-  for (const auto& prefix : search->second) {
+  for (const auto& prefixEntry : search->second->prefixEntries) {
+    auto const& prefix = prefixEntry.prefix;
     try {
       auto& nodeList = prefixes_.at(prefix);
+      countPrefixEntry(*nodeList.at(nodeName), false /* added */);
       nodeList.erase(nodeName);
       isUpdated = true;
+      markPrefixDirty(prefix);
       VLOG(1) << "Prefix " << toString(prefix) << " has been withdrawn by "
               << nodeName;
       if (nodeList.empty()) {
@@ -611,22 +1726,20 @@ SpfSolver::SpfSolverImpl::deletePrefixDatabase(const std::string& nodeName) {
     }
   }
 
-  nodeToPrefixes_.erase(search);
-  nodeHostLoopbacksV4_.erase(nodeName);
-  nodeHostLoopbacksV6_.erase(nodeName);
+  mutableSnapshot().prefixDatabases.erase(nodeName);
+  const bool hadLoopbackV4 = nodeHostLoopbacksV4_.erase(nodeName) > 0;
+  const bool hadLoopbackV6 = nodeHostLoopbacksV6_.erase(nodeName) > 0;
+  if (hadLoopbackV4 or hadLoopbackV6) {
+    invalidateRouteDbDelta();
+  }
   return isUpdated;
 }
 
 std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
 SpfSolver::SpfSolverImpl::getPrefixDatabases() {
   std::unordered_map<std::string, thrift::PrefixDatabase> prefixDatabases;
-  for (auto const& kv : nodeToPrefixes_) {
-    thrift::PrefixDatabase prefixDb;
-    prefixDb.thisNodeName = kv.first;
-    for (auto const& prefix : kv.second) {
-      prefixDb.prefixEntries.emplace_back(prefixes_.at(prefix).at(kv.first));
-    }
-    prefixDatabases.emplace(kv.first, std::move(prefixDb));
+  for (auto const& kv : snapshot_->prefixDatabases) {
+    prefixDatabases.emplace(kv.first, *kv.second);
   }
   return prefixDatabases;
 }
@@ -651,78 +1764,395 @@ SpfSolver::SpfSolverImpl::runSpf(
     const std::string& thisNodeName,
     bool useLinkMetric,
     const LinkState::LinkSet& linksToIgnore) {
-  unordered_map<string, pair<Metric, unordered_set<string>>> result;
-
   tData_.addStatValue("decision.spf_runs", 1, fbzmq::COUNT);
   const auto startTime = std::chrono::steady_clock::now();
 
-  DijkstraQ q;
-  q.insertNode(thisNodeName, 0);
+  size_t numAllocations{0};
+  auto result =
+      computeSpf(thisNodeName, useLinkMetric, linksToIgnore, &numAllocations);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
+  tData_.addStatValue("decision.spf_ms", deltaTime.count(), fbzmq::AVG);
+  tData_.addStatValue(
+      "decision.spf_allocations", numAllocations, fbzmq::AVG);
+  spfHistogram_.addValue(deltaTime);
+  return result;
+}
+
+SpfResult
+SpfSolver::SpfSolverImpl::computeSpf(
+    const std::string& thisNodeName,
+    bool useLinkMetric,
+    const LinkState::LinkSet& linksToIgnore,
+    size_t* numAllocations) const {
+  SpfResult result;
+
+  auto const& graph = linkState_.getCsrGraph();
+  auto const maybeSrcNodeId = linkState_.getNodeId(thisNodeName);
+  if (not maybeSrcNodeId.hasValue()) {
+    // node has never had any link. Only reachable node is itself
+    result[thisNodeName].first = 0;
+    return result;
+  }
+  const NodeId srcNodeId = maybeSrcNodeId.value();
+
+  auto& q = getThreadDijkstraQ();
+  q.reset(linkState_.getNumNodeIds(), graph, srcNodeId, useRadixHeapSpf_);
+  q.insertNode(srcNodeId, 0);
+  result.reserve(linkState_.getNumNodeIds());
   uint64_t loop = 0;
-  for (auto node = q.extractMin(); node; node = q.extractMin()) {
-    ++loop;
-    // we've found this node's shortest paths. record it
-    auto emplaceRc = result.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(node->nodeName),
-        std::forward_as_tuple(node->distance, std::move(node->nextHops)));
-    CHECK(emplaceRc.second);
-
-    auto& recordedNodeName = emplaceRc.first->first;
-    auto& recordedNodeMetric = emplaceRc.first->second.first;
-    auto& recordedNodeNextHops = emplaceRc.first->second.second;
-
-    if (linkState_.isNodeOverloaded(recordedNodeName) &&
-        recordedNodeName != thisNodeName) {
-      // no transit traffic through this node. we've recorded the nexthops to
-      // this node, but will not consider any of it's adjancecies as offering
-      // lower cost paths towards further away nodes. This effectively drains
-      // traffic away from this node
+  if (useSpecializedSpf_) {
+    loop = getSpecializedDijkstra(
+        useLinkMetric,
+        not linksToIgnore.empty(),
+        linkState_.hasOverloadedNodes())(
+        q, linkState_, srcNodeId, linksToIgnore, result);
+  } else {
+    for (NodeId nodeId; q.extractMin(nodeId);) {
+      ++loop;
+      // we've found this node's shortest paths. record it
+      recordDijkstraQNode(result, q, linkState_, nodeId);
+
+      if (nodeId != srcNodeId &&
+          linkState_.isNodeOverloaded(linkState_.getNodeName(nodeId))) {
+        // no transit traffic through this node. we've recorded the nexthops to
+        // this node, but will not consider any of it's adjancecies as offering
+        // lower cost paths towards further away nodes. This effectively drains
+        // traffic away from this node
+        continue;
+      }
+      // we have the shortest path nexthops for nodeId. Use these nextHops for
+      // any node that is connected to nodeId that doesn't already have a lower
+      // cost path from thisNodeName
+      //
+      // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
+      const auto nodeMetric = q.getDistance(nodeId);
+      auto const* nodeNextHops = q.getNextHops(nodeId);
+      for (auto i = graph.offsets[nodeId]; i < graph.offsets[nodeId + 1]; ++i) {
+        auto const& edge = graph.edges[i];
+        if (!edge.link->isUp() or q.wasExtracted(edge.otherNodeId) or
+            (!linksToIgnore.empty() and linksToIgnore.count(edge.link))) {
+          continue;
+        }
+        auto metric = useLinkMetric ? edge.getMetric() : 1;
+        relaxDijkstraQNode(
+            q,
+            srcNodeId,
+            nodeId,
+            nodeNextHops,
+            edge.otherNodeId,
+            nodeMetric + metric);
+      }
+    }
+  }
+  VLOG(3) << "Dijkstra loop count: " << loop;
+  if (numAllocations) {
+    *numAllocations = q.getNumAllocations();
+  }
+  return result;
+}
+
+SpfResult
+SpfSolver::SpfSolverImpl::getSpfResult(
+    const std::string& nodeName,
+    std::unordered_map<std::string, SpfResult>& prevSpfResults) {
+  auto it = prevSpfResults.find(nodeName);
+  if (spfCacheValid_ and it != prevSpfResults.end() and
+      runIncrementalSpf(nodeName, it->second)) {
+    return std::move(it->second);
+  }
+  auto result = runSpf(nodeName, true);
+  recordLabelRouteChanges(
+      nodeName, it != prevSpfResults.end() ? &it->second : nullptr, result);
+  return result;
+}
+
+bool
+SpfSolver::SpfSolverImpl::runIncrementalSpf(
+    const std::string& thisNodeName, SpfResult& result) {
+  const auto startTime = std::chrono::steady_clock::now();
+
+  // overload state of node before and after the recorded changes. Source node
+  // can always be used for transit
+  auto const wasTransitNode = [&](const std::string& nodeName) {
+    if (nodeName == thisNodeName) {
+      return true;
+    }
+    auto it = nodeOverloadChanges_.find(nodeName);
+    if (it != nodeOverloadChanges_.end()) {
+      return not it->second;
+    }
+    return not linkState_.isNodeOverloaded(nodeName);
+  };
+  auto const isTransitNode = [&](const std::string& nodeName) {
+    return nodeName == thisNodeName or
+        not linkState_.isNodeOverloaded(nodeName);
+  };
+
+  //
+  // Step-1 Find all nodes whose shortest paths traversed a link which has
+  // gone down, got more expensive or whose transit node got overloaded. These
+  // are the descendants of such links in the shortest path DAG of old result
+  //
+  std::unordered_set<std::string> affectedNodes;
+  std::vector<std::string> toVisit;
+  auto const visitIfOnShortestPath =
+      [&](const std::string& from, const std::string& to, Metric metric) {
+        auto fromIt = result.find(from);
+        auto toIt = result.find(to);
+        if (fromIt == result.end() or toIt == result.end() or
+            not wasTransitNode(from)) {
+          return;
+        }
+        if (fromIt->second.first + metric == toIt->second.first and
+            affectedNodes.insert(to).second) {
+          toVisit.emplace_back(to);
+        }
+      };
+
+  // current state of a recorded link, nullptr if it is gone or not up
+  auto const getUpLink = [&](const std::shared_ptr<Link>& link,
+                             const LinkSnapshot& snapshot) {
+    auto const& links = linkState_.linksFromNode(snapshot.node1);
+    auto it = links.find(link);
+    return it != links.end() and (*it)->isUp() ? *it : nullptr;
+  };
+
+  for (auto const& kv : linkChanges_) {
+    auto const& snapshot = kv.second;
+    if (not snapshot.wasUp) {
       continue;
     }
-    // we have the shortest path nexthops for recordedNodeName. Use these
-    // nextHops for any node that is connected to recordedNodeName that doesn't
-    // already have a lower cost path from thisNodeName
-    //
-    // this is the "relax" step in the Dijkstra Algorithm pseudocode in CLRS
-    for (const auto& link : linkState_.linksFromNode(recordedNodeName)) {
-      auto otherNodeName = link->getOtherNodeName(recordedNodeName);
-      if (!link->isUp() or result.count(otherNodeName) or
-          linksToIgnore.count(link)) {
+    auto const newLink = getUpLink(kv.first, snapshot);
+    if (not newLink or
+        newLink->getMetricFromNode(snapshot.node1) > snapshot.metric1) {
+      visitIfOnShortestPath(snapshot.node1, snapshot.node2, snapshot.metric1);
+    }
+    if (not newLink or
+        newLink->getMetricFromNode(snapshot.node2) > snapshot.metric2) {
+      visitIfOnShortestPath(snapshot.node2, snapshot.node1, snapshot.metric2);
+    }
+  }
+
+  // walk the old shortest path DAG. Links which have changed are followed as
+  // per their recorded state
+  auto const walkOldLinks = [&](const std::string& nodeName) {
+    for (auto const& link : linkState_.linksFromNode(nodeName)) {
+      auto const& otherNodeName = link->getOtherNodeName(nodeName);
+      auto it = linkChanges_.find(link);
+      if (it == linkChanges_.end()) {
+        if (link->isUp()) {
+          visitIfOnShortestPath(
+              nodeName, otherNodeName, link->getMetricFromNode(nodeName));
+        }
         continue;
       }
-      auto metric =
-          useLinkMetric ? link->getMetricFromNode(recordedNodeName) : 1;
-      auto otherNode = q.get(otherNodeName);
-      if (!otherNode) {
-        q.insertNode(otherNodeName, recordedNodeMetric + metric);
-        otherNode = q.get(otherNodeName);
+      auto const& snapshot = it->second;
+      if (snapshot.wasUp) {
+        visitIfOnShortestPath(
+            nodeName,
+            otherNodeName,
+            snapshot.node1 == nodeName ? snapshot.metric1 : snapshot.metric2);
       }
-      if (otherNode->distance >= recordedNodeMetric + metric) {
-        // recordedNodeName is either along an alternate shortest path towards
-        // otherNodeName or is along a new shorter path. In either case,
-        // otherNodeName should use recordedNodeName's nextHops until it finds
-        // some shorter path
-        if (otherNode->distance > recordedNodeMetric + metric) {
-          // if this is strictly better, forget about any other nexthops
-          otherNode->nextHops.clear();
-          q.decreaseKey(otherNode->nodeName, recordedNodeMetric + metric);
+    }
+  };
+
+  for (auto const& kv : nodeOverloadChanges_) {
+    if (not kv.second and not isTransitNode(kv.first)) {
+      walkOldLinks(kv.first);
+    }
+  }
+
+  while (not toVisit.empty()) {
+    auto nodeName = std::move(toVisit.back());
+    toVisit.pop_back();
+    walkOldLinks(nodeName);
+  }
+
+  //
+  // Step-2 Find all nodes which can get a shorter or an equal cost path via a
+  // link which has come up, got cheaper or whose transit node got
+  // un-overloaded. This is a bounded Dijkstra over new link state which stops
+  // expanding at nodes whose old distance is strictly better
+  //
+  using QueueEntry = std::pair<Metric, std::string>;
+  std::priority_queue<
+      QueueEntry,
+      std::vector<QueueEntry>,
+      std::greater<QueueEntry>>
+      queue;
+  std::unordered_map<std::string, Metric> tentativeDistances;
+  auto const relax = [&](const std::string& nodeName, Metric distance) {
+    auto it = result.find(nodeName);
+    if (it != result.end() and not affectedNodes.count(nodeName) and
+        it->second.first < distance) {
+      return;
+    }
+    auto tentativeIt = tentativeDistances.find(nodeName);
+    if (tentativeIt != tentativeDistances.end() and
+        tentativeIt->second <= distance) {
+      return;
+    }
+    tentativeDistances[nodeName] = distance;
+    queue.emplace(distance, nodeName);
+  };
+  auto const relaxFrom =
+      [&](const std::string& from, const std::string& to, Metric metric) {
+        auto fromIt = result.find(from);
+        if (fromIt != result.end() and isTransitNode(from)) {
+          relax(to, fromIt->second.first + metric);
+        }
+      };
+
+  for (auto const& kv : linkChanges_) {
+    auto const& snapshot = kv.second;
+    auto const newLink = getUpLink(kv.first, snapshot);
+    if (not newLink) {
+      continue;
+    }
+    auto const newMetric1 = newLink->getMetricFromNode(snapshot.node1);
+    auto const newMetric2 = newLink->getMetricFromNode(snapshot.node2);
+    if (not snapshot.wasUp or newMetric1 < snapshot.metric1) {
+      relaxFrom(snapshot.node1, snapshot.node2, newMetric1);
+    }
+    if (not snapshot.wasUp or newMetric2 < snapshot.metric2) {
+      relaxFrom(snapshot.node2, snapshot.node1, newMetric2);
+    }
+  }
+
+  for (auto const& kv : nodeOverloadChanges_) {
+    if (kv.second and isTransitNode(kv.first)) {
+      for (auto const& link : linkState_.linksFromNode(kv.first)) {
+        if (link->isUp()) {
+          relaxFrom(
+              kv.first,
+              link->getOtherNodeName(kv.first),
+              link->getMetricFromNode(kv.first));
         }
-        otherNode->nextHops.insert(
-            recordedNodeNextHops.begin(), recordedNodeNextHops.end());
       }
-      if (otherNode->nextHops.empty()) {
-        // this node is directly connected to the source
-        otherNode->nextHops.emplace(otherNode->nodeName);
+    }
+  }
+
+  while (not queue.empty()) {
+    auto entry = queue.top();
+    queue.pop();
+    auto const& nodeName = entry.second;
+    if (tentativeDistances.at(nodeName) != entry.first) {
+      continue; // stale entry
+    }
+    affectedNodes.insert(nodeName);
+    if (not isTransitNode(nodeName)) {
+      continue;
+    }
+    for (auto const& link : linkState_.linksFromNode(nodeName)) {
+      if (link->isUp()) {
+        relax(
+            link->getOtherNodeName(nodeName),
+            entry.first + link->getMetricFromNode(nodeName));
       }
     }
   }
-  VLOG(3) << "Dijkstra loop count: " << loop;
+
+  // distance of source never changes
+  affectedNodes.erase(thisNodeName);
+
+  // recomputing more than half of the graph is no better than a full run
+  if (affectedNodes.size() * 2 > result.size()) {
+    VLOG(2) << "Incremental SPF for " << thisNodeName << " affects "
+            << affectedNodes.size() << " of " << result.size()
+            << " nodes. Falling back to full SPF.";
+    return false;
+  }
+
+  tData_.addStatValue("decision.incremental_spf_runs", 1, fbzmq::COUNT);
+
+  // shortest paths of all other nodes are retained. Distance of a neighbor
+  // to us is part of every LFA
+  if (thisNodeName != myNodeName_ and affectedNodes.count(myNodeName_)) {
+    invalidateLabelRoutes();
+  }
+  for (auto const& nodeName : affectedNodes) {
+    markLabelNodeDirty(nodeName);
+  }
+
+  //
+  // Step-3 Re-compute affected nodes. All other nodes have retained their
+  // shortest paths. Seed affected nodes with paths from their unaffected
+  // neighbors and then run Dijkstra confined to affected nodes
+  //
+  auto const& graph = linkState_.getCsrGraph();
+  const NodeId srcNodeId = linkState_.getNodeId(thisNodeName).value();
+  std::vector<bool> isAffected(linkState_.getNumNodeIds(), false);
+  for (auto const& nodeName : affectedNodes) {
+    isAffected[linkState_.getNodeId(nodeName).value()] = true;
+    result.erase(nodeName);
+  }
+
+  auto& q = getThreadDijkstraQ();
+  q.reset(linkState_.getNumNodeIds(), graph, srcNodeId, useRadixHeapSpf_);
+  std::vector<DijkstraQ::NextHopWord> otherNextHops(q.getNumWords());
+  for (auto const& nodeName : affectedNodes) {
+    const NodeId nodeId = linkState_.getNodeId(nodeName).value();
+    for (auto i = graph.offsets[nodeId]; i < graph.offsets[nodeId + 1]; ++i) {
+      auto const& edge = graph.edges[i];
+      if (not edge.link->isUp() or isAffected[edge.otherNodeId]) {
+        continue;
+      }
+      auto const& otherNodeName = linkState_.getNodeName(edge.otherNodeId);
+      auto otherIt = result.find(otherNodeName);
+      if (otherIt == result.end() or not isTransitNode(otherNodeName)) {
+        continue;
+      }
+      // unaffected nodes reach their next-hops over links which are still up
+      std::fill(otherNextHops.begin(), otherNextHops.end(), 0);
+      for (auto const& nextHopName : otherIt->second.second) {
+        CHECK(q.setNextHop(
+            otherNextHops.data(), linkState_.getNodeId(nextHopName).value()));
+      }
+      relaxDijkstraQNode(
+          q,
+          srcNodeId,
+          edge.otherNodeId,
+          otherNextHops.data(),
+          nodeId,
+          otherIt->second.first + edge.getReverseMetric());
+    }
+  }
+
+  for (NodeId nodeId; q.extractMin(nodeId);) {
+    recordDijkstraQNode(result, q, linkState_, nodeId);
+    if (not isTransitNode(linkState_.getNodeName(nodeId))) {
+      continue;
+    }
+    const auto nodeMetric = q.getDistance(nodeId);
+    auto const* nodeNextHops = q.getNextHops(nodeId);
+    for (auto i = graph.offsets[nodeId]; i < graph.offsets[nodeId + 1]; ++i) {
+      auto const& edge = graph.edges[i];
+      if (edge.link->isUp() and isAffected[edge.otherNodeId] and
+          not q.wasExtracted(edge.otherNodeId)) {
+        relaxDijkstraQNode(
+            q,
+            srcNodeId,
+            nodeId,
+            nodeNextHops,
+            edge.otherNodeId,
+            nodeMetric + edge.getMetric());
+      }
+    }
+  }
+
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "SPF elapsed time: " << deltaTime.count() << "ms.";
-  tData_.addStatValue("decision.spf_ms", deltaTime.count(), fbzmq::AVG);
-  return result;
+  VLOG(1) << "Incremental SPF for " << thisNodeName << " re-computed "
+          << affectedNodes.size() << " nodes in " << deltaTime.count()
+          << "ms.";
+  tData_.addStatValue(
+      "decision.incremental_spf_ms", deltaTime.count(), fbzmq::AVG);
+  tData_.addStatValue(
+      "decision.spf_allocations", q.getNumAllocations(), fbzmq::AVG);
+  return true;
 }
 
 std::vector<Path>
@@ -742,7 +2172,9 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
   // Here we're tracing paths in reverse from destination node. We first pick
   // neighbors of destination node which are on the shortest paths
   //
-  std::unordered_set<std::pair<std::string, std::string>> visitedLinks;
+  // visited link ends as <link, is first node of the link>. Each end, i.e.
+  // <nodeName, ifName>, belongs to exactly one link
+  std::unordered_set<std::pair<Link const*, bool>> visitedLinks;
   // Starting with dummy entry for expanding paths
   std::vector<Path> partialPaths = {{{dstNodeName, nullptr}}};
 
@@ -775,12 +2207,13 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
       }
 
       auto& nbrName = link->getOtherNodeName(spurNode);
-      auto& nbrIface = link->getIfaceFromNode(nbrName);
+      const std::pair<Link const*, bool> nbrEnd{
+          link.get(), nbrName == link->firstNodeName()};
       auto nbrMetric = spfResult.at(nbrName).first;
       auto spurMetric = spfResult.at(spurNode).first;
 
       // Ignore already seen neighbor (except source-node)
-      if (visitedLinks.count({nbrName, nbrIface})) {
+      if (visitedLinks.count(nbrEnd)) {
         continue;
       }
 
@@ -793,7 +2226,7 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
       CHECK_EQ(nbrMetric + link->getMetricFromNode(nbrName), spurMetric);
       spurPath.emplace_back(std::make_pair(nbrName, link));
       partialPaths.emplace_back(std::move(spurPath));
-      visitedLinks.emplace(nbrName, nbrIface);
+      visitedLinks.emplace(nbrEnd);
 
       // Allow fan-out from dstNodeName else continue tracing only one path
       if (spurNode != dstNodeName) {
@@ -805,39 +2238,152 @@ SpfSolver::SpfSolverImpl::traceEdgeDisjointPaths(
   return paths;
 }
 
-folly::Optional<thrift::RouteDatabase>
-SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
-  if (adjacencyDatabases_.count(myNodeName) == 0) {
-    return folly::none;
+void
+SpfSolver::SpfSolverImpl::buildNeighborSpfResults(
+    const std::vector<std::string>& neighbors,
+    std::unordered_map<std::string, SpfResult>& prevSpfResults) {
+  if (not lfaSpfExecutor_) {
+    for (auto const& neighbor : neighbors) {
+      spfResults_[neighbor] = getSpfResult(neighbor, prevSpfResults);
+    }
+    return;
+  }
+
+  // incremental updates are cheap, do them inline. Collect the rest for full
+  // SPF runs
+  std::vector<std::string> fullSpfNodes;
+  for (auto const& neighbor : neighbors) {
+    auto it = prevSpfResults.find(neighbor);
+    if (spfCacheValid_ and it != prevSpfResults.end() and
+        runIncrementalSpf(neighbor, it->second)) {
+      spfResults_[neighbor] = std::move(it->second);
+    } else {
+      fullSpfNodes.emplace_back(neighbor);
+    }
+  }
+  if (fullSpfNodes.empty()) {
+    return;
+  }
+
+  // make sure lazily built CSR graph is there before sharing linkState_
+  // across threads. Nothing modifies linkState_ until all runs are finished
+  linkState_.getCsrGraph();
+
+  const auto startTime = std::chrono::steady_clock::now();
+  std::vector<folly::Future<std::pair<SpfResult, std::chrono::microseconds>>>
+      futures;
+  futures.reserve(fullSpfNodes.size());
+  // each run writes its own entry
+  std::vector<size_t> numAllocations(fullSpfNodes.size(), 0);
+  for (size_t i = 0; i < fullSpfNodes.size(); ++i) {
+    auto const& nodeName = fullSpfNodes.at(i);
+    auto* runNumAllocations = &numAllocations.at(i);
+    futures.emplace_back(folly::via(
+        lfaSpfExecutor_.get(), [this, &nodeName, runNumAllocations]() {
+          const auto runStartTime = std::chrono::steady_clock::now();
+          auto result = computeSpf(nodeName, true, {}, runNumAllocations);
+          return std::make_pair(
+              std::move(result),
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - runStartTime));
+        }));
+  }
+  auto results = folly::collectAll(futures).get();
+
+  // merge in the order of neighbors, independent of completion order
+  for (size_t i = 0; i < fullSpfNodes.size(); ++i) {
+    auto& res = results.at(i).value();
+    tData_.addStatValue("decision.spf_runs", 1, fbzmq::COUNT);
+    tData_.addStatValue(
+        "decision.spf_ms", res.second.count() / 1000, fbzmq::AVG);
+    spfHistogram_.addValue(
+        std::chrono::duration_cast<std::chrono::milliseconds>(res.second));
+    tData_.addStatValue(
+        "decision.lfa_spf_us", res.second.count(), fbzmq::AVG);
+    tData_.addStatValue(
+        "decision.spf_allocations", numAllocations.at(i), fbzmq::AVG);
+    auto const& nodeName = fullSpfNodes.at(i);
+    auto prevIt = prevSpfResults.find(nodeName);
+    recordLabelRouteChanges(
+        nodeName,
+        prevIt != prevSpfResults.end() ? &prevIt->second : nullptr,
+        res.first);
+    spfResults_[nodeName] = std::move(res.first);
   }
 
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  VLOG(2) << "Parallel SPF for " << fullSpfNodes.size()
+          << " neighbor(s) took " << deltaTime.count() << "ms.";
+  tData_.addStatValue(
+      "decision.lfa_parallel_spf_ms", deltaTime.count(), fbzmq::AVG);
+}
+
+void
+SpfSolver::SpfSolverImpl::computeSpfResults(const std::string& myNodeName) {
   auto const& startTime = std::chrono::steady_clock::now();
   tData_.addStatValue("decision.path_build_runs", 1, fbzmq::COUNT);
+  if (holdsExpired_) {
+    tData_.addStatValue(
+        "decision.ordered_fib.hold_expiry_spf_runs", 1, fbzmq::COUNT);
+    holdsExpired_ = false;
+  }
 
+  // keep previous results around for incremental computation
+  auto prevSpfResults = std::move(spfResults_);
   spfResults_.clear();
-  spfResults_[myNodeName] = runSpf(myNodeName, true);
+  spfResultsNodeName_ = myNodeName;
+  ++spfGeneration_;
+  spfResults_[myNodeName] = getSpfResult(myNodeName, prevSpfResults);
+  addPhaseEvent("DECISION_SPF_RUN");
   if (computeLfaPaths_) {
     // avoid duplicate iterations over a neighbor which can happen due to
     // multiple adjacencies to it
-    std::unordered_set<std::string /* adjacent node name */> visitedAdjNodes;
+    std::set<std::string /* adjacent node name */> adjNodes;
     for (auto const& link : linkState_.linksFromNode(myNodeName)) {
-      auto const& otherNodeName = link->getOtherNodeName(myNodeName);
-      // Skip if already visited
-      if (!visitedAdjNodes.insert(otherNodeName).second || !link->isUp()) {
-        continue;
+      if (link->isUp()) {
+        adjNodes.emplace(link->getOtherNodeName(myNodeName));
       }
-      spfResults_[otherNodeName] = runSpf(otherNodeName, true);
     }
+    buildNeighborSpfResults(
+        std::vector<std::string>(adjNodes.begin(), adjNodes.end()),
+        prevSpfResults);
+    addPhaseEvent("DECISION_LFA_SPF_RUN");
   }
 
+  // spfResults_ are now up to date with the link state. Start recording
+  // changes afresh
+  invalidateSpfCache();
+  spfCacheValid_ = true;
+
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
   LOG(INFO) << "Decision::buildPaths took " << deltaTime.count() << "ms.";
   tData_.addStatValue("decision.path_build_ms", deltaTime.count(), fbzmq::AVG);
+}
 
+folly::Optional<thrift::RouteDatabase>
+SpfSolver::SpfSolverImpl::buildPaths(const std::string& myNodeName) {
+  if (adjacencyDatabases_.count(myNodeName) == 0) {
+    return folly::none;
+  }
+
+  computeSpfResults(myNodeName);
   return buildRouteDb(myNodeName);
 } // buildPaths
 
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::SpfSolverImpl::buildPathsDelta(const std::string& myNodeName) {
+  if (myNodeName != myNodeName_ or adjacencyDatabases_.count(myNodeName) == 0) {
+    return folly::none;
+  }
+
+  phaseEvents_ = thrift::PerfEvents{};
+  addPerfEvent(phaseEvents_, myNodeName_, "DECISION_COMPUTE_START");
+  computeSpfResults(myNodeName);
+  return buildRouteDbDelta(myNodeName, true /* fullBuild */);
+} // buildPathsDelta
+
 folly::Optional<thrift::RouteDatabase>
 SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
   if (adjacencyDatabases_.count(myNodeName) == 0 ||
@@ -845,145 +2391,262 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
     return folly::none;
   }
 
-  const auto startTime = std::chrono::steady_clock::now();
-  tData_.addStatValue("decision.route_build_runs", 1, fbzmq::COUNT);
+  const auto startTime = std::chrono::steady_clock::now();
+  tData_.addStatValue("decision.route_build_runs", 1, fbzmq::COUNT);
+
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = myNodeName;
+
+  //
+  // Create unicastRoutes - IP and IP2MPLS routes
+  //
+  for (auto& route : createUnicastRoutesForPrefixes(myNodeName)) {
+    if (route.hasValue()) {
+      routeDb.unicastRoutes.emplace_back(std::move(route.value()));
+    }
+  }
+  // routes come sorted by prefix, as prefixes_ is
+
+  routeDb.mplsRoutes = createMplsRoutes(myNodeName);
+
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  tData_.addStatValue("decision.route_build_ms", deltaTime.count(), fbzmq::AVG);
+  reportKsp2Duration();
+  return routeDb;
+} // buildRouteDb
+
+folly::Optional<thrift::UnicastRoute>
+SpfSolver::SpfSolverImpl::createUnicastRouteForPrefix(
+    std::string const& myNodeName,
+    thrift::IpPrefix const& prefix,
+    PrefixEntries const& nodePrefixes) {
+  bool hasBGP = false, hasNonBGP = false, missingMv = false;
+  bool hasSpEcmp = false, hasKsp2EdEcmp = false;
+  for (auto const& npKv : nodePrefixes) {
+    bool isBGP = npKv.second->type == thrift::PrefixType::BGP;
+    hasBGP |= isBGP;
+    hasNonBGP |= !isBGP;
+    if (isBGP and not npKv.second->mv.hasValue()) {
+      missingMv = true;
+      LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second->prefix)
+                 << " advertised by " << npKv.first
+                 << " is of type BGP but does not contain a metric vector.";
+    }
+    hasSpEcmp |= npKv.second->forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::SP_ECMP;
+    hasKsp2EdEcmp |= npKv.second->forwardingAlgorithm ==
+        thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
+  }
+
+  // skip adding route for BGP prefixes that have issues
+  if (hasBGP) {
+    if (hasNonBGP) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " which is advertised with BGP and non-BGP type.";
+      return folly::none;
+    }
+    if (missingMv) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " at least one advertiser is missing its metric vector.";
+      return folly::none;
+    }
+    if (hasKsp2EdEcmp) {
+      LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
+                 << " which is advertised with KSP2_ED_ECMP algorithm.";
+      return folly::none;
+    }
+  }
+
+  // skip adding route for prefixes advertised by this node
+  if (nodePrefixes.count(myNodeName) and not hasBGP) {
+    return folly::none;
+  }
+
+  // Check for enabledV4_
+  auto prefixStr = prefix.prefixAddress.addr;
+  bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
+  if (isV4Prefix && !enableV4_) {
+    LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
+    return folly::none;
+  }
 
-  thrift::RouteDatabase routeDb;
-  routeDb.thisNodeName = myNodeName;
+  const auto forwardingAlgorithm = hasKsp2EdEcmp and not hasSpEcmp
+      ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
+      : thrift::PrefixForwardingAlgorithm::SP_ECMP;
 
-  //
-  // Create unicastRoutes - IP and IP2MPLS routes
-  //
-  for (const auto& kv : prefixes_) {
-    const auto& prefix = kv.first;
-    const auto& nodePrefixes = kv.second;
-
-    bool hasBGP = false, hasNonBGP = false, missingMv = false;
-    bool hasSpEcmp = false, hasKsp2EdEcmp = false;
-    for (auto const& npKv : nodePrefixes) {
-      bool isBGP = npKv.second.type == thrift::PrefixType::BGP;
-      hasBGP |= isBGP;
-      hasNonBGP |= !isBGP;
-      if (isBGP and not npKv.second.mv.hasValue()) {
-        missingMv = true;
-        LOG(ERROR) << "Prefix entry for prefix " << toString(npKv.second.prefix)
-                   << " advertised by " << npKv.first
-                   << " is of type BGP but does not contain a metric vector.";
-      }
-      hasSpEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      hasKsp2EdEcmp |= npKv.second.forwardingAlgorithm ==
-          thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP;
-    }
+  if (forwardingAlgorithm == thrift::PrefixForwardingAlgorithm::SP_ECMP) {
+    return hasBGP
+        ? createBGPRoute(myNodeName, prefix, nodePrefixes, isV4Prefix)
+        : createOpenRRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
+  }
+  return createOpenRKsp2EdRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
+}
 
-    // skip adding route for BGP prefixes that have issues
-    if (hasBGP) {
-      if (hasNonBGP) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " which is advertised with BGP and non-BGP type.";
-        continue;
-      }
-      if (missingMv) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " at least one advertiser is missing its metric vector.";
-        continue;
-      }
-      if (hasKsp2EdEcmp) {
-        LOG(ERROR) << "Skipping route for prefix " << toString(prefix)
-                   << " which is advertised with KSP2_ED_ECMP algorithm.";
-        continue;
-      }
+std::vector<folly::Optional<thrift::UnicastRoute>>
+SpfSolver::SpfSolverImpl::createUnicastRoutesForPrefixes(
+    std::string const& myNodeName) {
+  std::vector<folly::Optional<thrift::UnicastRoute>> routes;
+  if (not routeBuildExecutor_ or
+      prefixes_.size() < Constants::kParallelRouteBuildMinPrefixes) {
+    routes.reserve(prefixes_.size());
+    for (const auto& kv : prefixes_) {
+      routes.emplace_back(
+          createUnicastRouteForPrefix(myNodeName, kv.first, kv.second));
     }
+    return routes;
+  }
 
-    // skip adding route for prefixes advertised by this node
-    if (nodePrefixes.count(myNodeName) and not hasBGP) {
-      continue;
-    }
+  // KSP2_ED_ECMP routes fill the shared second SPF caches. They are built
+  // inline once all shards are done
+  auto const isKsp2 =
+      [](PrefixEntries const& nodePrefixes) {
+        for (auto const& kv : nodePrefixes) {
+          if (kv.second->forwardingAlgorithm ==
+              thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP) {
+            return true;
+          }
+        }
+        return false;
+      };
 
-    // Check for enabledV4_
-    auto prefixStr = prefix.prefixAddress.addr;
-    bool isV4Prefix = prefixStr.size() == folly::IPAddressV4::byteCount();
-    if (isV4Prefix && !enableV4_) {
-      LOG(WARNING) << "Received v4 prefix while v4 is not enabled.";
-      continue;
-    }
+  std::vector<decltype(prefixes_)::value_type const*> entries;
+  entries.reserve(prefixes_.size());
+  for (auto const& kv : prefixes_) {
+    entries.emplace_back(&kv);
+  }
+  routes.resize(entries.size());
 
-    const auto forwardingAlgorithm = hasKsp2EdEcmp and not hasSpEcmp
-        ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
-        : thrift::PrefixForwardingAlgorithm::SP_ECMP;
+  // spfResults_, linkState_ and prefixes_ are only read from here on. Each
+  // shard writes its own contiguous range of routes
+  const auto startTime = std::chrono::steady_clock::now();
+  const size_t numShards = std::min(
+      entries.size(),
+      routeBuildExecutor_->numThreads() *
+          Constants::kRouteBuildShardsPerThread);
+  const bool hasKsp2 = numKsp2PrefixEntries_ > 0;
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t shard = 0; shard < numShards; ++shard) {
+    const size_t begin = entries.size() * shard / numShards;
+    const size_t end = entries.size() * (shard + 1) / numShards;
+    futures.emplace_back(folly::via(
+        routeBuildExecutor_.get(),
+        [this, &myNodeName, &entries, &routes, &isKsp2, hasKsp2, begin, end]() {
+          for (size_t i = begin; i < end; ++i) {
+            auto const& kv = *entries[i];
+            if (hasKsp2 and isKsp2(kv.second)) {
+              continue;
+            }
+            routes[i] =
+                createUnicastRouteForPrefix(myNodeName, kv.first, kv.second);
+          }
+        }));
+  }
+  for (auto& res : folly::collectAll(futures).get()) {
+    res.throwIfFailed();
+  }
 
-    if (forwardingAlgorithm == thrift::PrefixForwardingAlgorithm::SP_ECMP) {
-      auto route = hasBGP
-          ? createBGPRoute(myNodeName, prefix, nodePrefixes, isV4Prefix)
-          : createOpenRRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
-      if (route.hasValue()) {
-        routeDb.unicastRoutes.emplace_back(std::move(route.value()));
-      }
-    } else {
-      auto route =
-          createOpenRKsp2EdRoute(myNodeName, prefix, nodePrefixes, isV4Prefix);
-      if (route.hasValue()) {
-        routeDb.unicastRoutes.emplace_back(std::move(route.value()));
+  if (hasKsp2) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      auto const& kv = *entries[i];
+      if (isKsp2(kv.second)) {
+        routes[i] =
+            createUnicastRouteForPrefix(myNodeName, kv.first, kv.second);
       }
     }
-  } // for prefixes_
+  }
 
-  //
-  // Create MPLS routes for all nodeLabel
-  //
+  auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  VLOG(2) << "Parallel route build for " << entries.size() << " prefixes in "
+          << numShards << " shards took " << deltaTime.count() << "ms.";
+  tData_.addStatValue(
+      "decision.parallel_route_build_ms", deltaTime.count(), fbzmq::AVG);
+  return routes;
+}
+
+std::vector<thrift::MplsRoute>
+SpfSolver::SpfSolverImpl::createMplsRoutes(const std::string& myNodeName) {
+  std::map<int32_t, std::pair<std::string, thrift::MplsRoute>> nodeRoutes;
   for (const auto& kv : adjacencyDatabases_) {
-    const auto& adjDb = kv.second;
-    const auto topLabel = adjDb.nodeLabel;
-    // Top label is not set => Non-SR mode
-    if (topLabel == 0) {
+    auto route = createNodeLabelRoute(myNodeName, *kv.second);
+    if (not route.hasValue()) {
       continue;
     }
-    // If mpls label is not valid then ignore it
-    if (not isMplsLabelValid(topLabel)) {
-      LOG(ERROR) << "Ignoring invalid node label " << topLabel << " of node "
-                 << adjDb.thisNodeName;
-      continue;
+    auto it = nodeRoutes.find(route->topLabel);
+    if (it == nodeRoutes.end() or kv.first < it->second.first) {
+      nodeRoutes[route->topLabel] =
+          std::make_pair(kv.first, std::move(route.value()));
     }
+  }
 
-    // Install POP_AND_LOOKUP for next layer
-    if (adjDb.thisNodeName == myNodeName) {
-      thrift::NextHopThrift nh;
-      nh.address = toBinaryAddress(folly::IPAddressV6("::"));
-      nh.mplsAction = createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
-      routeDb.mplsRoutes.emplace_back(
-          createMplsRoute(topLabel, {std::move(nh)}));
-      continue;
+  auto adjLabelRoutes = createAdjLabelRoutes(myNodeName);
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mplsRoutes.reserve(nodeRoutes.size() + adjLabelRoutes.size());
+  for (auto& kv : nodeRoutes) {
+    if (not adjLabelRoutes.count(kv.first)) {
+      mplsRoutes.emplace_back(std::move(kv.second.second));
     }
+  }
+  for (auto& kv : adjLabelRoutes) {
+    mplsRoutes.emplace_back(std::move(kv.second));
+  }
+  return mplsRoutes;
+}
 
-    // Get best nexthop towards the node
-    auto metricNhs =
-        getNextHopsWithMetric(myNodeName, {adjDb.thisNodeName}, false);
-    if (metricNhs.second.empty()) {
-      LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
-                   << " of node " << adjDb.thisNodeName;
-      tData_.addStatValue("decision.no_route_to_label", 1, fbzmq::COUNT);
-      continue;
-    }
+folly::Optional<thrift::MplsRoute>
+SpfSolver::SpfSolverImpl::createNodeLabelRoute(
+    const std::string& myNodeName, const thrift::AdjacencyDatabase& adjDb) {
+  const auto topLabel = adjDb.nodeLabel;
+  // Top label is not set => Non-SR mode
+  if (topLabel == 0) {
+    return folly::none;
+  }
+  // If mpls label is not valid then ignore it
+  if (not isMplsLabelValid(topLabel)) {
+    LOG(ERROR) << "Ignoring invalid node label " << topLabel << " of node "
+               << adjDb.thisNodeName;
+    return folly::none;
+  }
 
-    // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that all
-    // nexthops are valid for routing without loops. Fib is responsible for
-    // installing these routes by making sure it programs least cost nexthops
-    // first and of same action type (based on HW limitations)
-    auto nextHopsThrift = getNextHopsThrift(
-        myNodeName,
-        {adjDb.thisNodeName},
-        false,
-        false,
-        metricNhs.first,
-        metricNhs.second,
-        topLabel);
-    routeDb.mplsRoutes.emplace_back(
-        createMplsRoute(topLabel, std::move(nextHopsThrift)));
+  // Install POP_AND_LOOKUP for next layer
+  if (adjDb.thisNodeName == myNodeName) {
+    thrift::NextHopThrift nh;
+    nh.address = toBinaryAddress(folly::IPAddressV6("::"));
+    nh.mplsAction = createMplsAction(thrift::MplsActionCode::POP_AND_LOOKUP);
+    return createMplsRoute(topLabel, {std::move(nh)});
   }
 
-  //
-  // Create MPLS routes for all of our adjacencies
-  //
+  // Get best nexthop towards the node
+  auto metricNhs =
+      getNextHopsWithMetric(myNodeName, {adjDb.thisNodeName}, false);
+  if (metricNhs.second.empty()) {
+    LOG(WARNING) << "No route to nodeLabel " << std::to_string(topLabel)
+                 << " of node " << adjDb.thisNodeName;
+    tData_.addStatValue("decision.no_route_to_label", 1, fbzmq::COUNT);
+    return folly::none;
+  }
+
+  // Create nexthops with appropriate MplsAction (PHP and SWAP). Note that all
+  // nexthops are valid for routing without loops. Fib is responsible for
+  // installing these routes by making sure it programs least cost nexthops
+  // first and of same action type (based on HW limitations)
+  auto nextHopsThrift = getNextHopsThrift(
+      myNodeName,
+      {adjDb.thisNodeName},
+      false,
+      false,
+      metricNhs.first,
+      metricNhs.second,
+      topLabel);
+  return createMplsRoute(topLabel, std::move(nextHopsThrift));
+}
+
+std::unordered_map<int32_t, thrift::MplsRoute>
+SpfSolver::SpfSolverImpl::createAdjLabelRoutes(const std::string& myNodeName) {
+  std::unordered_map<int32_t, thrift::MplsRoute> mplsRoutes;
   for (const auto& link : linkState_.linksFromNode(myNodeName)) {
     const auto topLabel = link->getAdjLabelFromNode(myNodeName);
     // Top label is not set => Non-SR mode
@@ -1002,82 +2665,425 @@ SpfSolver::SpfSolverImpl::buildRouteDb(const std::string& myNodeName) {
         link->getIfaceFromNode(myNodeName),
         link->getMetricFromNode(myNodeName),
         createMplsAction(thrift::MplsActionCode::PHP));
-    routeDb.mplsRoutes.emplace_back(createMplsRoute(topLabel, {std::move(nh)}));
+    mplsRoutes[topLabel] = createMplsRoute(topLabel, {std::move(nh)});
+  }
+  return mplsRoutes;
+}
+
+void
+SpfSolver::SpfSolverImpl::updateMplsRoutes(
+    const std::string& myNodeName, thrift::RouteDatabaseDelta& routeDbDelta) {
+  // labels whose route may have changed
+  std::unordered_set<int32_t> labels;
+
+  std::vector<LocalLinkKey> localLinks;
+  for (auto const& link : linkState_.orderedLinksFromNode(myNodeName)) {
+    if (link->isUp()) {
+      localLinks.emplace_back(
+          link->getOtherNodeName(myNodeName),
+          link->getIfaceFromNode(myNodeName),
+          link->getMetricFromNode(myNodeName),
+          link->getNhV4FromNode(myNodeName),
+          link->getNhV6FromNode(myNodeName));
+    }
+  }
+  if (localLinks != labelRoutesLinks_) {
+    labelRoutesLinks_ = std::move(localLinks);
+    invalidateLabelRoutes();
+  }
+
+  if (not labelRoutesValid_) {
+    for (auto const& kv : routeDbCache_.mplsRoutes) {
+      labels.emplace(kv.first);
+    }
+    nodeLabelRoutes_.clear();
+    labelNodes_.clear();
+    for (auto const& kv : adjacencyDatabases_) {
+      dirtyLabelNodes_.emplace(kv.first);
+    }
+    labelRoutesValid_ = true;
+  }
+  tData_.addStatValue(
+      "decision.label_route_updates", dirtyLabelNodes_.size(), fbzmq::SUM);
+
+  for (auto const& nodeName : dirtyLabelNodes_) {
+    auto it = nodeLabelRoutes_.find(nodeName);
+    if (it != nodeLabelRoutes_.end()) {
+      const auto topLabel = it->second.topLabel;
+      labels.emplace(topLabel);
+      auto& nodes = labelNodes_.at(topLabel);
+      nodes.erase(nodeName);
+      if (nodes.empty()) {
+        labelNodes_.erase(topLabel);
+      }
+      nodeLabelRoutes_.erase(it);
+    }
+    auto adjIt = adjacencyDatabases_.find(nodeName);
+    if (adjIt == adjacencyDatabases_.end()) {
+      continue;
+    }
+    auto route = createNodeLabelRoute(myNodeName, *adjIt->second);
+    if (not route.hasValue()) {
+      continue;
+    }
+    labels.emplace(route->topLabel);
+    labelNodes_[route->topLabel].emplace(nodeName);
+    nodeLabelRoutes_.emplace(nodeName, std::move(route.value()));
+  }
+  dirtyLabelNodes_.clear();
+
+  // adjacency label routes are only a few, re-compute them every time
+  for (auto const& kv : adjLabelRoutes_) {
+    labels.emplace(kv.first);
+  }
+  adjLabelRoutes_ = createAdjLabelRoutes(myNodeName);
+  for (auto const& kv : adjLabelRoutes_) {
+    labels.emplace(kv.first);
+  }
+
+  // same precedence as createMplsRoutes
+  for (auto const topLabel : labels) {
+    const thrift::MplsRoute* route{nullptr};
+    auto adjIt = adjLabelRoutes_.find(topLabel);
+    auto nodesIt = labelNodes_.find(topLabel);
+    if (adjIt != adjLabelRoutes_.end()) {
+      route = &adjIt->second;
+    } else if (nodesIt != labelNodes_.end()) {
+      route = &nodeLabelRoutes_.at(*nodesIt->second.begin());
+    }
+
+    auto it = routeDbCache_.mplsRoutes.find(topLabel);
+    if (route == nullptr) {
+      if (it != routeDbCache_.mplsRoutes.end()) {
+        routeDbDelta.mplsRoutesToDelete.emplace_back(topLabel);
+        routeDbCache_.mplsRoutes.erase(it);
+      }
+      continue;
+    }
+    if (it != routeDbCache_.mplsRoutes.end() and it->second == *route) {
+      continue;
+    }
+    routeDbDelta.mplsRoutesToUpdate.emplace_back(*route);
+    routeDbCache_.mplsRoutes[topLabel] = *route;
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::recordLabelRouteChanges(
+    const std::string& nodeName,
+    const SpfResult* prevResult,
+    const SpfResult& result) {
+  if (not labelRoutesValid_) {
+    return;
+  }
+  if (prevResult == nullptr) {
+    invalidateLabelRoutes();
+    return;
+  }
+
+  // only distances matter in SPF results of neighbors, including the one to
+  // us which is part of every LFA
+  const bool isMyResult = nodeName == myNodeName_;
+  if (not isMyResult) {
+    auto prevIt = prevResult->find(myNodeName_);
+    auto it = result.find(myNodeName_);
+    if ((prevIt == prevResult->end()) != (it == result.end()) or
+        (it != result.end() and prevIt->second.first != it->second.first)) {
+      invalidateLabelRoutes();
+      return;
+    }
+  }
+  for (auto const& kv : result) {
+    auto prevIt = prevResult->find(kv.first);
+    if (prevIt == prevResult->end() or
+        prevIt->second.first != kv.second.first or
+        (isMyResult and prevIt->second.second != kv.second.second)) {
+      dirtyLabelNodes_.emplace(kv.first);
+    }
+  }
+  for (auto const& kv : *prevResult) {
+    if (not result.count(kv.first)) {
+      dirtyLabelNodes_.emplace(kv.first);
+    }
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::markLabelNodeDirty(const std::string& nodeName) {
+  if (labelRoutesValid_) {
+    dirtyLabelNodes_.emplace(nodeName);
+  }
+}
+
+void
+SpfSolver::SpfSolverImpl::invalidateLabelRoutes() {
+  labelRoutesValid_ = false;
+  dirtyLabelNodes_.clear();
+}
+
+void
+SpfSolver::SpfSolverImpl::recordUnicastRoute(
+    thrift::IpPrefix const& prefix,
+    folly::Optional<thrift::UnicastRoute>&& route,
+    thrift::RouteDatabaseDelta& routeDbDelta) {
+  if (not route.hasValue()) {
+    if (routeDbCache_.unicastRoutes.erase(prefix)) {
+      routeDbDelta.unicastRoutesToDelete.emplace_back(prefix);
+    }
+    return;
   }
+  auto it = routeDbCache_.unicastRoutes.find(prefix);
+  if (it != routeDbCache_.unicastRoutes.end() and it->second == *route) {
+    return;
+  }
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(*route);
+  routeDbCache_.unicastRoutes[prefix] = std::move(route.value());
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::SpfSolverImpl::buildRouteDbDelta(
+    const std::string& myNodeName, bool fullBuild) {
+  if (myNodeName != myNodeName_ or adjacencyDatabases_.count(myNodeName) == 0) {
+    phaseEvents_.events.clear();
+    return folly::none;
+  }
+  if (phaseEvents_.events.empty()) {
+    addPerfEvent(phaseEvents_, myNodeName_, "DECISION_COMPUTE_START");
+  }
+  if (spfResultsNodeName_ != myNodeName) {
+    // spfResults_ were built for some other node (ROUTE_DB_GET)
+    computeSpfResults(myNodeName);
+    fullBuild = true;
+  }
+  fullBuild |= not routeDbDeltaValid_;
+
+  const auto startTime = std::chrono::steady_clock::now();
+  tData_.addStatValue("decision.route_build_runs", 1, fbzmq::COUNT);
+  if (not fullBuild) {
+    tData_.addStatValue("decision.route_delta_build_runs", 1, fbzmq::COUNT);
+  }
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = myNodeName;
+  if (fullBuild) {
+    // compare every route with the cached one
+    auto routes = createUnicastRoutesForPrefixes(myNodeName);
+    auto routeIt = routes.begin();
+    for (const auto& kv : prefixes_) {
+      recordUnicastRoute(kv.first, std::move(*routeIt++), routeDbDelta);
+    }
+    for (auto it = routeDbCache_.unicastRoutes.begin();
+         it != routeDbCache_.unicastRoutes.end();) {
+      if (prefixes_.count(it->first)) {
+        ++it;
+        continue;
+      }
+      routeDbDelta.unicastRoutesToDelete.emplace_back(it->first);
+      it = routeDbCache_.unicastRoutes.erase(it);
+    }
+  } else {
+    tData_.addStatValue(
+        "decision.route_delta_prefixes", dirtyPrefixes_.size(), fbzmq::AVG);
+    for (auto const& prefix : dirtyPrefixes_) {
+      folly::Optional<thrift::UnicastRoute> route;
+      auto search = prefixes_.find(prefix);
+      if (search != prefixes_.end()) {
+        route = createUnicastRouteForPrefix(myNodeName, prefix, search->second);
+      }
+      recordUnicastRoute(prefix, std::move(route), routeDbDelta);
+    }
+  }
+  updateMplsRoutes(myNodeName, routeDbDelta);
+
+  // routeDbCache_ is now in sync. Track prefix changes from here on
+  dirtyPrefixes_.clear();
+  routeDbDeltaValid_ = true;
 
   auto deltaTime = std::chrono::duration_cast<std::chrono::milliseconds>(
       std::chrono::steady_clock::now() - startTime);
-  LOG(INFO) << "Decision::buildRouteDb took " << deltaTime.count() << "ms.";
+  LOG(INFO) << "Decision::buildRouteDbDelta took " << deltaTime.count()
+            << "ms (full build: " << fullBuild << ").";
   tData_.addStatValue("decision.route_build_ms", deltaTime.count(), fbzmq::AVG);
-  return routeDb;
-} // buildRouteDb
+  reportKsp2Duration();
+
+  addPhaseEvent(fullBuild ? "DECISION_ROUTE_BUILD" : "DECISION_ROUTE_DELTA");
+  routeDbDelta.perfEvents = std::move(phaseEvents_);
+  phaseEvents_ = thrift::PerfEvents{};
+  return routeDbDelta;
+} // buildRouteDbDelta
+
+void
+SpfSolver::SpfSolverImpl::addPhaseEvent(const std::string& eventDescr) {
+  if (not phaseEvents_.events.empty()) {
+    addPerfEvent(phaseEvents_, myNodeName_, eventDescr);
+  }
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::SpfSolverImpl::checkRouteDbCache(const std::string& myNodeName) {
+  // only meaningful if there are no pending changes which are yet to be
+  // reflected in routeDbCache_
+  if (myNodeName != myNodeName_ or not routeDbDeltaValid_ or
+      not dirtyPrefixes_.empty() or spfResultsNodeName_ != myNodeName) {
+    return folly::none;
+  }
+
+  auto maybeRouteDb = buildRouteDb(myNodeName);
+  if (not maybeRouteDb.hasValue()) {
+    return folly::none;
+  }
+  tData_.addStatValue("decision.route_db_checks", 1, fbzmq::COUNT);
+
+  auto routeDbDelta = findDeltaRoutes(maybeRouteDb.value(), routeDbCache_);
+  if (routeDbDelta.unicastRoutesToUpdate.empty() and
+      routeDbDelta.unicastRoutesToDelete.empty() and
+      routeDbDelta.mplsRoutesToUpdate.empty() and
+      routeDbDelta.mplsRoutesToDelete.empty()) {
+    return routeDbDelta;
+  }
+
+  LOG(ERROR) << "Route cache is inconsistent with the full route build. "
+             << routeDbDelta.unicastRoutesToUpdate.size() << " unicast and "
+             << routeDbDelta.mplsRoutesToUpdate.size() << " mpls routes to "
+             << "update, " << routeDbDelta.unicastRoutesToDelete.size()
+             << " unicast and " << routeDbDelta.mplsRoutesToDelete.size()
+             << " mpls routes to delete.";
+  tData_.addStatValue("decision.route_db_inconsistencies", 1, fbzmq::COUNT);
+
+  // full build is the source of truth
+  routeDbCache_.unicastRoutes.clear();
+  for (auto& route : maybeRouteDb->unicastRoutes) {
+    auto dest = route.dest;
+    routeDbCache_.unicastRoutes.emplace(std::move(dest), std::move(route));
+  }
+  routeDbCache_.mplsRoutes.clear();
+  for (auto& route : maybeRouteDb->mplsRoutes) {
+    auto topLabel = route.topLabel;
+    routeDbCache_.mplsRoutes.emplace(topLabel, std::move(route));
+  }
+  invalidateLabelRoutes();
+  return routeDbDelta;
+}
+
+void
+SpfSolver::SpfSolverImpl::setRouteDbCache(
+    const thrift::RouteDatabase& routeDb) {
+  routeDbCache_.unicastRoutes.clear();
+  for (auto const& route : routeDb.unicastRoutes) {
+    routeDbCache_.unicastRoutes.emplace(route.dest, route);
+  }
+  routeDbCache_.mplsRoutes.clear();
+  for (auto const& route : routeDb.mplsRoutes) {
+    routeDbCache_.mplsRoutes.emplace(route.topLabel, route);
+  }
+  invalidateRouteDbDelta();
+  invalidateLabelRoutes();
+}
 
 folly::Optional<thrift::UnicastRoute>
 SpfSolver::SpfSolverImpl::createOpenRRoute(
     std::string const& myNodeName,
     thrift::IpPrefix const& prefix,
-    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    PrefixEntries const& nodePrefixes,
     bool const isV4) {
-  // Prepare list of nodes announcing the prefix
+  // Prepare list of nodes announcing the prefix. MPLS is used if and only if
+  // all of them ask for it
   std::set<std::string> prefixNodes;
+  bool perDestination{true};
   for (auto const& nodePrefix : nodePrefixes) {
     prefixNodes.emplace(nodePrefix.first);
+    perDestination &= nodePrefix.second->forwardingType ==
+        thrift::PrefixForwardingType::SR_MPLS;
   }
 
-  const bool perDestination = getPrefixForwardingType(nodePrefixes) ==
-      thrift::PrefixForwardingType::SR_MPLS;
-
-  const auto metricNhs =
-      getNextHopsWithMetric(myNodeName, prefixNodes, perDestination);
-  if (metricNhs.second.empty()) {
+  auto const& nextHops =
+      getPrefixNextHops(myNodeName, prefixNodes, isV4, perDestination);
+  if (not nextHops.hasValue()) {
     LOG(WARNING) << "No route to prefix " << toString(prefix)
                  << ", advertised by: " << folly::join(", ", prefixNodes);
+    std::lock_guard<std::mutex> lock(routeBuildMutex_);
     tData_.addStatValue("decision.no_route_to_prefix", 1, fbzmq::COUNT);
     return folly::none;
   }
 
-  // Convert list of neighbor nodes to nexthops (considering adjacencies)
-  return createUnicastRoute(
-      prefix,
-      getNextHopsThrift(
-          myNodeName,
-          prefixNodes,
-          isV4,
-          perDestination,
-          metricNhs.first,
-          metricNhs.second,
-          folly::none));
+  return createUnicastRoute(prefix, nextHops.value());
+}
+
+folly::Optional<std::vector<thrift::NextHopThrift>> const&
+SpfSolver::SpfSolverImpl::getPrefixNextHops(
+    const std::string& myNodeName,
+    const std::set<std::string>& prefixNodes,
+    bool isV4,
+    bool perDestination) {
+  NextHopsKey key{myNodeName, prefixNodes, isV4, perDestination};
+  {
+    std::lock_guard<std::mutex> lock(routeBuildMutex_);
+    if (nextHopsCacheGeneration_ != spfGeneration_) {
+      nextHopsCache_.clear();
+      nextHopsCacheGeneration_ = spfGeneration_;
+    }
+    auto it = nextHopsCache_.find(key);
+    if (it != nextHopsCache_.end()) {
+      tData_.addStatValue("decision.nexthops_cache_hits", 1, fbzmq::COUNT);
+      return it->second;
+    }
+    tData_.addStatValue("decision.nexthops_cache_misses", 1, fbzmq::COUNT);
+  }
+
+  folly::Optional<std::vector<thrift::NextHopThrift>> nextHops;
+  const auto metricNhs =
+      getNextHopsWithMetric(myNodeName, prefixNodes, perDestination);
+  if (not metricNhs.second.empty()) {
+    // Convert list of neighbor nodes to nexthops (considering adjacencies)
+    nextHops = getNextHopsThrift(
+        myNodeName,
+        prefixNodes,
+        isV4,
+        perDestination,
+        metricNhs.first,
+        metricNhs.second,
+        folly::none);
+  }
+  // computed outside of the lock. Another shard may have memoized the same
+  // next-hops meanwhile, in which case its entry is kept. References to
+  // entries stay valid across insertions
+  std::lock_guard<std::mutex> lock(routeBuildMutex_);
+  return nextHopsCache_.emplace(std::move(key), std::move(nextHops))
+      .first->second;
 }
 
 folly::Optional<thrift::UnicastRoute>
 SpfSolver::SpfSolverImpl::createBGPRoute(
     std::string const& myNodeName,
     thrift::IpPrefix const& prefix,
-    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    PrefixEntries const& nodePrefixes,
     bool const isV4) {
-  std::string bestNode;
+  std::string const* bestNode = nullptr;
   std::unordered_set<std::string> nodes;
   thrift::MetricVector const* bestVector = nullptr;
   std::string const* bestData = nullptr;
+  auto const& mySpfResult = spfResults_.at(myNodeName);
   for (auto const& kv : nodePrefixes) {
     auto const& name = kv.first;
-    auto const& prefixEntry = kv.second;
-    if (!spfResults_.at(myNodeName).count(name)) {
+    auto const& prefixEntry = *kv.second;
+    if (!mySpfResult.count(name)) {
       LOG(ERROR) << "No path to " << name << ". Skipping considering this.";
       // skip if no path to node
       continue;
     }
+    // sorted by updatePrefixDatabase
     auto const& metricVector = prefixEntry.mv.value();
-    switch ((nullptr == bestVector) ? MetricVectorUtils::CompareResult::WINNER
-                                    : MetricVectorUtils::compareMetricVectors(
-                                          metricVector, *bestVector)) {
+    switch ((nullptr == bestVector)
+                ? MetricVectorUtils::CompareResult::WINNER
+                : MetricVectorUtils::compareSortedMetricVectors(
+                      metricVector, *bestVector)) {
     case MetricVectorUtils::CompareResult::WINNER:
       nodes.clear();
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_WINNER:
       bestVector = &(metricVector);
       bestData = &(prefixEntry.data);
-      bestNode = name;
+      bestNode = &name;
       FOLLY_FALLTHROUGH;
     case MetricVectorUtils::CompareResult::TIE_LOOSER:
       nodes.emplace(name);
@@ -1100,7 +3106,7 @@ SpfSolver::SpfSolverImpl::createBGPRoute(
     return folly::none;
   }
   CHECK_NOTNULL(bestData);
-  auto bestNexthop = getLoopbackVias({bestNode}, isV4);
+  auto bestNexthop = getLoopbackVias({*bestNode}, isV4);
   if (bestNexthop.size() != 1) {
     LOG(ERROR)
         << "Cannot find the best paths loopback address. Skipping route for prefix: "
@@ -1123,22 +3129,25 @@ folly::Optional<thrift::UnicastRoute>
 SpfSolver::SpfSolverImpl::createOpenRKsp2EdRoute(
     std::string const& myNodeName,
     thrift::IpPrefix const& prefix,
-    std::unordered_map<std::string, thrift::PrefixEntry> const& nodePrefixes,
+    PrefixEntries const& nodePrefixes,
     bool const isV4) {
   // Sanity checks - forwarding-type must be SR_MPLS
   for (auto const& np : nodePrefixes) {
-    if (np.second.forwardingType != thrift::PrefixForwardingType::SR_MPLS) {
+    if (np.second->forwardingType != thrift::PrefixForwardingType::SR_MPLS) {
       LOG(ERROR) << "Prefix " << toString(prefix) << " announced by "
                  << np.first << " has incompatible forwarding type "
                  << TEnumTraits<thrift::PrefixForwardingType>::findName(
-                        np.second.forwardingType)
+                        np.second->forwardingType)
                  << " for algorithm KSP2_ED_ECMP;";
       return folly::none;
     }
   }
 
-  // Sequence of unique paths (nodes starting from neighbor to destination)
-  std::vector<std::pair<Path, Metric>> dstPaths;
+  const auto startTime = std::chrono::steady_clock::now();
+  SCOPE_EXIT {
+    ksp2Duration_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - startTime);
+  };
 
   // Prepare list of possible destination nodes
   std::set<std::string> dstNodeNames;
@@ -1146,41 +3155,8 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRoute(
     dstNodeNames.emplace(np.first);
   }
 
-  // Step-1 Get all shortest paths and min-cost nodes to whom we will be
-  // forwarding
-  auto const& spf1 = spfResults_.at(myNodeName);
-  auto const& minMetricNodes1 = getMinCostNodes(spf1, dstNodeNames);
-  auto const& minCost1 = minMetricNodes1.first;
-  auto const& minCostNodes1 = minMetricNodes1.second;
-
-  // Step-2 Prepare set of links to ignore from subsequent SPF for finding
-  //        second shortest paths. Collect all shortest paths
-  LinkState::LinkSet linksToIgnore;
-  for (auto const& minCostDst : minCostNodes1) {
-    auto minPaths = traceEdgeDisjointPaths(myNodeName, minCostDst, spf1);
-    for (auto& minPath : minPaths) {
-      for (auto& nodeLink : minPath) {
-        linksToIgnore.insert(nodeLink.second);
-      }
-      dstPaths.emplace_back(std::make_pair(std::move(minPath), minCost1));
-    }
-  }
-
-  // Step-3 Collect all second shortest paths
-  if (linksToIgnore.size()) {
-    auto const spf2 = runSpf(myNodeName, true, linksToIgnore);
-    auto const& minMetricNodes2 = getMinCostNodes(spf2, dstNodeNames);
-    auto const& minCost2 = minMetricNodes2.first;
-    auto const& minCostNodes2 = minMetricNodes2.second;
-
-    for (auto const& minCostDst : minCostNodes2) {
-      auto minPaths =
-          traceEdgeDisjointPaths(myNodeName, minCostDst, spf2, linksToIgnore);
-      for (auto& minPath : minPaths) {
-        dstPaths.emplace_back(std::make_pair(std::move(minPath), minCost2));
-      }
-    }
-  }
+  // Sequence of unique paths (nodes starting from neighbor to destination)
+  auto const dstPaths = getKsp2Paths(myNodeName, dstNodeNames);
 
   // Step-4 Convert all paths
   if (not dstPaths.size()) {
@@ -1189,22 +3165,23 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRoute(
 
   thrift::UnicastRoute route;
   route.dest = prefix;
-  for (auto& pathAndCost : dstPaths) {
+  for (auto const& pathAndCost : dstPaths) {
+    auto const& path = *pathAndCost.first;
     // NOTE: Here we're forwarding according to the node-labels instead of
     // explicit link labels. This gives unique nexthops when there are no
     // parallel links in network between two nodes.
     std::vector<int32_t> labels;
-    for (auto& nodeLink : pathAndCost.first) {
+    for (auto& nodeLink : path) {
       auto& otherNodeName = nodeLink.second->getOtherNodeName(nodeLink.first);
-      labels.emplace_back(adjacencyDatabases_.at(otherNodeName).nodeLabel);
+      labels.emplace_back(adjacencyDatabases_.at(otherNodeName)->nodeLabel);
     }
     CHECK(labels.size());
     labels.pop_back(); // Remove first node's label to respect PHP
 
     // Create nexthop
-    CHECK(pathAndCost.first.size());
-    auto firstLink = pathAndCost.first.back().second;
-    auto& pathCost = pathAndCost.second;
+    CHECK(path.size());
+    auto firstLink = path.back().second;
+    auto const pathCost = pathAndCost.second;
     folly::Optional<thrift::MplsAction> mplsAction;
     if (labels.size()) {
       mplsAction = createMplsAction(
@@ -1222,6 +3199,114 @@ SpfSolver::SpfSolverImpl::createOpenRKsp2EdRoute(
   return std::move(route);
 }
 
+std::vector<std::pair<Path const*, Metric>>
+SpfSolver::SpfSolverImpl::getKsp2Paths(
+    const std::string& myNodeName, const std::set<std::string>& dstNodeNames) {
+  if (ksp2CacheGeneration_ != spfGeneration_ or
+      ksp2CacheNodeName_ != myNodeName) {
+    ksp2ShortestPaths_.clear();
+    ksp2SecondSpfs_.clear();
+    ksp2CacheGeneration_ = spfGeneration_;
+    ksp2CacheNodeName_ = myNodeName;
+  }
+
+  std::vector<std::pair<Path const*, Metric>> dstPaths;
+
+  // Step-1 Get all shortest paths and min-cost nodes to whom we will be
+  // forwarding
+  auto const& spf1 = spfResults_.at(myNodeName);
+  auto const minMetricNodes1 = getMinCostNodes(spf1, dstNodeNames);
+  auto const& minCost1 = minMetricNodes1.first;
+  auto const& minCostNodes1 = minMetricNodes1.second;
+  for (auto const& minCostDst : minCostNodes1) {
+    for (auto const& minPath : getKsp2ShortestPaths(myNodeName, minCostDst)) {
+      dstPaths.emplace_back(&minPath, minCost1);
+    }
+  }
+
+  // Step-2 Prepare set of links to ignore from subsequent SPF for finding
+  //        second shortest paths, i.e. links of all shortest paths. The SPF
+  //        run is shared by all prefixes with the same min-cost nodes
+  std::set<std::string> minCostNodesKey(
+      minCostNodes1.begin(), minCostNodes1.end());
+  auto secondSpfIt = ksp2SecondSpfs_.find(minCostNodesKey);
+  if (secondSpfIt == ksp2SecondSpfs_.end()) {
+    Ksp2SecondSpf secondSpf;
+    for (auto const& minCostDst : minCostNodes1) {
+      for (auto const& minPath : getKsp2ShortestPaths(myNodeName, minCostDst)) {
+        for (auto const& nodeLink : minPath) {
+          secondSpf.linksToIgnore.insert(nodeLink.second);
+        }
+      }
+    }
+    if (secondSpf.linksToIgnore.size()) {
+      // accounted in decision.ksp2_ms instead of decision.spf_ms
+      tData_.addStatValue("decision.ksp2_spf_runs", 1, fbzmq::COUNT);
+      secondSpf.spfResult =
+          computeSpf(myNodeName, true, secondSpf.linksToIgnore);
+    }
+    secondSpfIt =
+        ksp2SecondSpfs_
+            .emplace(std::move(minCostNodesKey), std::move(secondSpf))
+            .first;
+  }
+
+  // Step-3 Collect all second shortest paths
+  auto& secondSpf = secondSpfIt->second;
+  if (secondSpf.linksToIgnore.empty()) {
+    return dstPaths;
+  }
+  auto const minMetricNodes2 =
+      getMinCostNodes(secondSpf.spfResult, dstNodeNames);
+  auto const& minCost2 = minMetricNodes2.first;
+  for (auto const& minCostDst : minMetricNodes2.second) {
+    auto pathsIt = secondSpf.paths.find(minCostDst);
+    if (pathsIt == secondSpf.paths.end()) {
+      pathsIt = secondSpf.paths
+                    .emplace(
+                        minCostDst,
+                        traceEdgeDisjointPaths(
+                            myNodeName,
+                            minCostDst,
+                            secondSpf.spfResult,
+                            secondSpf.linksToIgnore))
+                    .first;
+    }
+    for (auto const& minPath : pathsIt->second) {
+      dstPaths.emplace_back(&minPath, minCost2);
+    }
+  }
+  return dstPaths;
+}
+
+std::vector<Path> const&
+SpfSolver::SpfSolverImpl::getKsp2ShortestPaths(
+    const std::string& myNodeName, const std::string& dstNodeName) {
+  auto it = ksp2ShortestPaths_.find(dstNodeName);
+  if (it == ksp2ShortestPaths_.end()) {
+    it = ksp2ShortestPaths_
+             .emplace(
+                 dstNodeName,
+                 traceEdgeDisjointPaths(
+                     myNodeName, dstNodeName, spfResults_.at(myNodeName)))
+             .first;
+  }
+  return it->second;
+}
+
+void
+SpfSolver::SpfSolverImpl::reportKsp2Duration() {
+  if (ksp2Duration_.count() == 0) {
+    return;
+  }
+  tData_.addStatValue(
+      "decision.ksp2_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(ksp2Duration_)
+          .count(),
+      fbzmq::AVG);
+  ksp2Duration_ = std::chrono::microseconds(0);
+}
+
 std::vector<thrift::NextHopThrift>
 SpfSolver::SpfSolverImpl::getLoopbackVias(
     std::unordered_set<std::string> const& nodes, bool const isV4) {
@@ -1347,12 +3432,13 @@ SpfSolver::SpfSolverImpl::getNextHopsThrift(
         nextHopNodes,
     folly::Optional<int32_t> swapLabel) const {
   CHECK(not nextHopNodes.empty());
+  // single wildcard destination unless nexthops are per destination
+  static const std::set<std::string> kAnyDstNode{""};
 
   std::vector<thrift::NextHopThrift> nextHops;
   for (const auto& link : linkState_.linksFromNode(myNodeName)) {
-    for (const auto& dstNode :
-         perDestination ? dstNodeNames : std::set<std::string>{""}) {
-      const auto neighborNode = link->getOtherNodeName(myNodeName);
+    const auto& neighborNode = link->getOtherNodeName(myNodeName);
+    for (const auto& dstNode : perDestination ? dstNodeNames : kAnyDstNode) {
       const auto search =
           nextHopNodes.find(std::make_pair(neighborNode, dstNode));
 
@@ -1392,7 +3478,7 @@ SpfSolver::SpfSolverImpl::getNextHopsThrift(
       // is not our neighbor
       if (not dstNode.empty() and dstNode != neighborNode) {
         // Validate mpls label before adding mplsAction
-        auto const dstNodeLabel = adjacencyDatabases_.at(dstNode).nodeLabel;
+        auto const dstNodeLabel = adjacencyDatabases_.at(dstNode)->nodeLabel;
         if (not isMplsLabelValid(dstNodeLabel)) {
           continue;
         }
@@ -1410,7 +3496,7 @@ SpfSolver::SpfSolverImpl::getNextHopsThrift(
                : link->getNhV6FromNode(myNodeName),
           link->getIfaceFromNode(myNodeName),
           distOverLink,
-          mplsAction));
+          std::move(mplsAction)));
     } // end for perDestination ...
   } // end for linkState_ ...
 
@@ -1435,7 +3521,7 @@ SpfSolver::SpfSolverImpl::maybeMakeLink(
   // only return Link if it is bidirectional.
   auto search = adjacencyDatabases_.find(adj.otherNodeName);
   if (search != adjacencyDatabases_.end()) {
-    for (const auto& otherAdj : search->second.adjacencies) {
+    for (const auto& otherAdj : search->second->adjacencies) {
       if (nodeName == otherAdj.otherNodeName &&
           adj.otherIfName == otherAdj.ifName &&
           adj.ifName == otherAdj.otherIfName) {
@@ -1465,7 +3551,10 @@ SpfSolver::SpfSolverImpl::getOrderedLinkSet(
 
 std::unordered_map<std::string, int64_t>
 SpfSolver::SpfSolverImpl::getCounters() {
-  return tData_.getCounters();
+  auto counters = tData_.getCounters();
+  counters["decision.ordered_fib.holds_pending"] = linkState_.getNumHolds();
+  spfHistogram_.exportCounters("decision.spf_ms", counters);
+  return counters;
 }
 
 //
@@ -1477,10 +3566,23 @@ SpfSolver::SpfSolver(
     bool enableV4,
     bool computeLfaPaths,
     bool enableOrderedFib,
-    bool bgpDryRun)
+    bool bgpDryRun,
+    size_t lfaSpfThreads,
+    size_t routeBuildThreads,
+    std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor,
+    bool useRadixHeapSpf,
+    bool useSpecializedSpf)
     : impl_(new SpfSolver::SpfSolverImpl(
-          myNodeName, enableV4, computeLfaPaths, enableOrderedFib, bgpDryRun)) {
-}
+          myNodeName,
+          enableV4,
+          computeLfaPaths,
+          enableOrderedFib,
+          bgpDryRun,
+          lfaSpfThreads,
+          routeBuildThreads,
+          std::move(sharedExecutor),
+          useRadixHeapSpf,
+          useSpecializedSpf)) {}
 
 SpfSolver::~SpfSolver() {}
 
@@ -1498,6 +3600,11 @@ SpfSolver::hasHolds() const {
   return impl_->hasHolds();
 }
 
+uint64_t
+SpfSolver::getHoldTtl() const {
+  return impl_->getHoldTtl();
+}
+
 bool
 SpfSolver::deleteAdjacencyDatabase(const std::string& nodeName) {
   return impl_->deleteAdjacencyDatabase(nodeName);
@@ -1510,8 +3617,14 @@ SpfSolver::getAdjacencyDatabases() {
 
 // update prefixes for a given router
 bool
-SpfSolver::updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb) {
-  return impl_->updatePrefixDatabase(prefixDb);
+SpfSolver::updatePrefixDatabase(const thrift::PrefixDatabase& prefixDb) {
+  return impl_->updatePrefixDatabase(prefixDb);
+}
+
+bool
+SpfSolver::updatePrefixDatabases(
+    const std::vector<thrift::PrefixDatabase>& prefixDbs) {
+  return impl_->updatePrefixDatabases(prefixDbs);
 }
 
 bool
@@ -1524,6 +3637,11 @@ SpfSolver::getPrefixDatabases() {
   return impl_->getPrefixDatabases();
 }
 
+std::shared_ptr<const SpfSolverSnapshot>
+SpfSolver::getSnapshot() {
+  return impl_->getSnapshot();
+}
+
 folly::Optional<thrift::RouteDatabase>
 SpfSolver::buildPaths(const std::string& myNodeName) {
   return impl_->buildPaths(myNodeName);
@@ -1534,9 +3652,29 @@ SpfSolver::buildRouteDb(const std::string& myNodeName) {
   return impl_->buildRouteDb(myNodeName);
 }
 
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::buildRouteDbDelta(const std::string& myNodeName) {
+  return impl_->buildRouteDbDelta(myNodeName);
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::buildPathsDelta(const std::string& myNodeName) {
+  return impl_->buildPathsDelta(myNodeName);
+}
+
+folly::Optional<thrift::RouteDatabaseDelta>
+SpfSolver::checkRouteDbCache(const std::string& myNodeName) {
+  return impl_->checkRouteDbCache(myNodeName);
+}
+
+void
+SpfSolver::setRouteDbCache(const thrift::RouteDatabase& routeDb) {
+  impl_->setRouteDbCache(routeDb);
+}
+
 bool
-SpfSolver::decrementHolds() {
-  return impl_->decrementHolds();
+SpfSolver::decrementHolds(uint64_t ticks) {
+  return impl_->decrementHolds(ticks);
 }
 
 std::unordered_map<std::string, int64_t>
@@ -1573,7 +3711,17 @@ Decision::Decision(
     const KvStoreLocalPubUrl& storePubUrl,
     const DecisionPubUrl& decisionPubUrl,
     const MonitorSubmitUrl& monitorSubmitUrl,
-    fbzmq::Context& zmqContext)
+    fbzmq::Context& zmqContext,
+    size_t lfaSpfThreads,
+    bool enableAdaptiveDebounce,
+    bool enableComputeThread,
+    folly::Optional<PersistentStoreUrl> configStoreUrl,
+    size_t routeBuildThreads,
+    BusSerializer::Protocol routeDeltaProtocol,
+    std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor,
+    folly::Optional<std::string> publicationRecordFile,
+    bool useRadixHeapSpf,
+    bool useSpecializedSpf)
     : OpenrEventLoop(myNodeName, thrift::OpenrModuleType::DECISION, zmqContext),
       processUpdatesBackoff_(debounceMinDur, debounceMaxDur),
       myNodeName_(myNodeName),
@@ -1585,25 +3733,108 @@ Decision::Decision(
       storeSub_(
           zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true}),
       decisionPub_(
-          zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true}) {
-  routeDb_.thisNodeName = myNodeName_;
+          zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true}),
+      routeDeltaSerializer_(routeDeltaProtocol) {
   processUpdatesTimer_ = fbzmq::ZmqTimeout::make(
-      this, [this]() noexcept { processPendingUpdates(); });
+      this, profiled("timer.process_updates", [this]() noexcept {
+        processPendingUpdates();
+      }));
+  if (enableAdaptiveDebounce) {
+    adaptiveDebounce_ =
+        detail::DecisionDebounce(debounceMinDur, debounceMaxDur);
+  }
   spfSolver_ = std::make_unique<SpfSolver>(
-      myNodeName, enableV4, computeLfaPaths, enableOrderedFib, bgpDryRun);
+      myNodeName,
+      enableV4,
+      computeLfaPaths,
+      enableOrderedFib,
+      bgpDryRun,
+      lfaSpfThreads,
+      routeBuildThreads,
+      sharedExecutor,
+      useRadixHeapSpf,
+      useSpecializedSpf);
+  if (enableComputeThread) {
+    computeSolver_ = std::make_unique<SpfSolver>(
+        myNodeName,
+        enableV4,
+        computeLfaPaths,
+        enableOrderedFib,
+        bgpDryRun,
+        lfaSpfThreads,
+        routeBuildThreads,
+        sharedExecutor,
+        useRadixHeapSpf,
+        useSpecializedSpf);
+    if (sharedExecutor) {
+      sharedComputeExecutor_ =
+          folly::SerialExecutor::create(folly::getKeepAliveToken(
+              static_cast<folly::Executor*>(sharedExecutor.get())));
+    } else {
+      computeExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+    }
+  }
+  *solverSnapshot_.wlock() = spfSolver_->getSnapshot();
+
+  // without ordered fib holds, routes of other nodes are those of settled
+  // link state. Nor does it compete with spfSolver_ for worker threads
+  routeDbQuerySolver_ = std::make_unique<SpfSolver>(
+      myNodeName,
+      enableV4,
+      computeLfaPaths,
+      false /* enableOrderedFib */,
+      bgpDryRun,
+      0 /* lfaSpfThreads */,
+      0 /* routeBuildThreads */,
+      nullptr /* sharedExecutor */,
+      useRadixHeapSpf,
+      useSpecializedSpf);
+  routeDbQueryExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(1);
+
+  if (publicationRecordFile.hasValue()) {
+    publicationRecorder_ =
+        std::make_unique<PublicationRecorder>(publicationRecordFile.value());
+  }
 
   zmqMonitorClient_ =
       std::make_unique<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
 
-  coldStartTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { coldStartUpdate(); });
+  coldStartTimer_ = fbzmq::ZmqTimeout::make(
+      this,
+      profiled("timer.cold_start", [this]() noexcept { coldStartUpdate(); }));
   if (gracefulRestartDuration.hasValue()) {
     coldStartTimer_->scheduleTimeout(gracefulRestartDuration.value());
   }
 
+  if (configStoreUrl.hasValue()) {
+    configStoreClient_ = std::make_unique<PersistentStoreClient>(
+        configStoreUrl.value(), zmqContext);
+    publishedRouteDb_ = RouteDatabaseMap();
+    publishedRouteDb_->thisNodeName = myNodeName_;
+    persistRouteDbThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
+        this, Constants::kPersistedRouteDbThrottleTimeout, [this]() noexcept {
+          persistRouteDb();
+        });
+    if (gracefulRestartDuration.hasValue()) {
+      scheduleTimeout(
+          Constants::kPersistedRouteDbPublishDelay,
+          [this]() noexcept { publishPersistedRouteDb(); });
+    }
+  }
+
   prepare(zmqContext, enableOrderedFib);
 }
 
+Decision::~Decision() {
+  // Serial queue on shared executor doesn't join pending computations when
+  // destroyed, unlike computeExecutor_. Wait for them to run
+  if (sharedComputeExecutor_) {
+    folly::Baton<> drained;
+    sharedComputeExecutor_->add([&drained]() { drained.post(); });
+    drained.wait();
+  }
+}
+
 void
 Decision::prepare(fbzmq::Context& zmqContext, bool enableOrderedFib) noexcept {
   const auto pubBind = decisionPub_.bind(fbzmq::SocketUrl{decisionPubUrl_});
@@ -1635,13 +3866,23 @@ Decision::prepare(fbzmq::Context& zmqContext, bool enableOrderedFib) noexcept {
 
   // Schedule periodic timer for submission to monitor
   const bool isPeriodic = true;
-  monitorTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+  monitorTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.monitor", [this]() noexcept { submitCounters(); }));
   monitorTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval, isPeriodic);
 
+  // Schedule periodic full route build to verify incrementally built routes
+  routeDbCheckTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.route_db_check", [this]() noexcept {
+        checkRouteDbConsistency();
+      }));
+  routeDbCheckTimer_->scheduleTimeout(
+      Constants::kRouteDbConsistencyCheckInterval, isPeriodic);
+
   // Attach callback for processing publications on storeSub_ socket
   addSocket(
-      fbzmq::RawZmqSocketPtr{*storeSub_}, ZMQ_POLLIN, [this](int) noexcept {
+      fbzmq::RawZmqSocketPtr{*storeSub_},
+      ZMQ_POLLIN,
+      profiled("socket.kvstore_sub", [this](int) noexcept {
         VLOG(3) << "Decision: publication received...";
 
         auto maybeThriftPub =
@@ -1679,20 +3920,18 @@ Decision::prepare(fbzmq::Context& zmqContext, bool enableOrderedFib) noexcept {
             CHECK(processUpdatesTimer_->isScheduled());
           }
         }
-      });
+      }));
 
-  // Schedule periodic timer to decremtOrderedFibHolds
+  // Schedule timer to decrementOrderedFibHolds at next hold expiry
   if (enableOrderedFib) {
-    orderedFibTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-      LOG(INFO) << "Decrementing Holds";
-      decrementOrderedFibHolds();
-      if (spfSolver_->hasHolds()) {
-        auto timeout = getMaxFib();
-        LOG(INFO) << "Scheduling next hold decrement in " << timeout.count()
-                  << "ms";
-        orderedFibTimer_->scheduleTimeout(getMaxFib());
-      }
-    });
+    orderedFibTimer_ = fbzmq::ZmqTimeout::make(
+        this, profiled("timer.ordered_fib", [this]() noexcept {
+          LOG(INFO) << "Decrementing Holds by " << orderedFibTimerTicks_
+                    << " ticks";
+          decrementOrderedFibHolds(orderedFibTimerTicks_);
+          orderedFibTickTime_ = std::chrono::steady_clock::now();
+          scheduleOrderedFibTimer();
+        }));
   }
 
   auto zmqContextPtr = &zmqContext;
@@ -1712,32 +3951,23 @@ Decision::processRequestMsg(fbzmq::Message&& request) {
   }
 
   auto thriftReq = maybeThriftReq.value();
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::DecisionCommand>::findName(
+          thriftReq.cmd));
   thrift::DecisionReply reply;
   switch (thriftReq.cmd) {
   case thrift::DecisionCommand::ROUTE_DB_GET: {
-    auto nodeName = thriftReq.nodeName;
-    if (nodeName.empty()) {
-      VLOG(1) << "Decision: Routes requested with no specific node name. "
-              << "Returning " << myNodeName_ << " routes.";
-      nodeName = myNodeName_;
-    }
-
-    auto maybeRouteDb = spfSolver_->buildPaths(nodeName);
-    if (maybeRouteDb.hasValue()) {
-      reply.routeDb = std::move(maybeRouteDb.value());
-    } else {
-      reply.routeDb.thisNodeName = nodeName;
-    }
+    reply.routeDb = buildRouteDb(std::move(thriftReq.nodeName));
     break;
   }
 
   case thrift::DecisionCommand::ADJ_DB_GET: {
-    reply.adjDbs = spfSolver_->getAdjacencyDatabases();
+    reply.adjDbs = dumpAdjacencyDbs();
     break;
   }
 
   case thrift::DecisionCommand::PREFIX_DB_GET: {
-    reply.prefixDbs = spfSolver_->getPrefixDatabases();
+    reply.prefixDbs = dumpPrefixDbs();
     break;
   }
 
@@ -1751,12 +3981,210 @@ Decision::processRequestMsg(fbzmq::Message&& request) {
   }
   }
 
-  return fbzmq::Message::fromThriftObj(reply, serializer_);
+  return toReplyMsg(reply, serializer_);
+}
+
+std::shared_ptr<const SpfSolverSnapshot>
+Decision::getSolverSnapshot() {
+  return *solverSnapshot_.rlock();
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+Decision::getDecisionRouteDb(std::string nodeName) {
+  if (nodeName.empty() or nodeName == myNodeName_) {
+    return runInEventLoopWithResult<thrift::RouteDatabase>(
+        [this, nodeName = std::move(nodeName)]() mutable {
+          return buildRouteDb(std::move(nodeName));
+        });
+  }
+
+  // served right away if cached for the latest snapshot
+  {
+    const auto version = getSolverSnapshot()->version;
+    auto cache = routeDbQueryCache_.wlock();
+    auto search = cache->routeDbs.find(nodeName);
+    if (cache->version == version and search != cache->routeDbs.end()) {
+      ++cache->numHits;
+      return folly::makeSemiFuture(
+          std::make_unique<thrift::RouteDatabase>(search->second));
+    }
+  }
+  return folly::via(
+             routeDbQueryExecutor_.get(),
+             [this, nodeName = std::move(nodeName)]() {
+               return std::make_unique<thrift::RouteDatabase>(
+                   buildRouteDbQuery(nodeName));
+             })
+      .semi();
+}
+
+thrift::RouteDatabase
+Decision::buildRouteDbQuery(std::string const& nodeName) {
+  // yield to route computation of this node and everything else
+  static thread_local bool isSchedConfigApplied{false};
+  if (not isSchedConfigApplied) {
+    ThreadSchedConfig config;
+    config.policy = SCHED_IDLE;
+    applyThreadSchedConfig(config);
+    isSchedConfigApplied = true;
+  }
+
+  // take latest snapshot, cache may have been filled by a query queued
+  // before this one
+  auto snapshot = getSolverSnapshot();
+  {
+    auto cache = routeDbQueryCache_.wlock();
+    if (cache->version == snapshot->version) {
+      auto search = cache->routeDbs.find(nodeName);
+      if (search != cache->routeDbs.end()) {
+        ++cache->numHits;
+        return search->second;
+      }
+    }
+    ++cache->numMisses;
+  }
+
+  const auto version = snapshot->version;
+  syncRouteDbQuerySolver(std::move(snapshot));
+  auto maybeRouteDb = routeDbQuerySolver_->buildPaths(nodeName);
+  thrift::RouteDatabase routeDb;
+  if (maybeRouteDb.hasValue()) {
+    routeDb = std::move(maybeRouteDb.value());
+  } else {
+    routeDb.thisNodeName = nodeName;
+  }
+
+  auto cache = routeDbQueryCache_.wlock();
+  if (cache->version != version) {
+    cache->version = version;
+    cache->routeDbs.clear();
+  }
+  cache->routeDbs[nodeName] = routeDb;
+  return routeDb;
+}
+
+void
+Decision::syncRouteDbQuerySolver(
+    std::shared_ptr<const SpfSolverSnapshot> snapshot) {
+  auto const& prev = *routeDbQuerySnapshot_;
+  for (auto const& kv : prev.adjacencyDatabases) {
+    if (not snapshot->adjacencyDatabases.count(kv.first)) {
+      routeDbQuerySolver_->deleteAdjacencyDatabase(kv.first);
+    }
+  }
+  for (auto const& kv : snapshot->adjacencyDatabases) {
+    auto search = prev.adjacencyDatabases.find(kv.first);
+    if (search == prev.adjacencyDatabases.end() or
+        search->second != kv.second) {
+      routeDbQuerySolver_->updateAdjacencyDatabase(*kv.second);
+    }
+  }
+  for (auto const& kv : prev.prefixDatabases) {
+    if (not snapshot->prefixDatabases.count(kv.first)) {
+      routeDbQuerySolver_->deletePrefixDatabase(kv.first);
+    }
+  }
+  for (auto const& kv : snapshot->prefixDatabases) {
+    auto search = prev.prefixDatabases.find(kv.first);
+    if (search == prev.prefixDatabases.end() or
+        search->second != kv.second) {
+      routeDbQuerySolver_->updatePrefixDatabase(*kv.second);
+    }
+  }
+  routeDbQuerySnapshot_ = std::move(snapshot);
+}
+
+void
+Decision::setRouteDeltaCallback(
+    std::function<void(thrift::RouteDatabaseDelta const&)> callback) {
+  runInEventLoop([this, callback = std::move(callback)]() mutable noexcept {
+    routeDeltaCallback_ = std::move(callback);
+  });
+}
+
+void
+Decision::setInitialSyncCallback(std::function<void()> callback) {
+  runInEventLoop([this, callback = std::move(callback)]() mutable noexcept {
+    if (not initialSyncDone_) {
+      initialSyncCallback_ = std::move(callback);
+    } else if (callback) {
+      callback();
+    }
+  });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>>
+Decision::getDecisionAdjacencyDbs() {
+  return folly::makeSemiFuture(
+      std::make_unique<thrift::AdjDbs>(dumpAdjacencyDbs()));
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>>
+Decision::getDecisionPrefixDbs() {
+  return folly::makeSemiFuture(
+      std::make_unique<thrift::PrefixDbs>(dumpPrefixDbs()));
+}
+
+thrift::RouteDatabase
+Decision::buildRouteDb(std::string nodeName) {
+  if (nodeName.empty()) {
+    VLOG(1) << "Decision: Routes requested with no specific node name. "
+            << "Returning " << myNodeName_ << " routes.";
+    nodeName = myNodeName_;
+  }
+
+  auto maybeRouteDb = spfSolver_->buildPaths(nodeName);
+  if (maybeRouteDb.hasValue()) {
+    return std::move(maybeRouteDb.value());
+  }
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = nodeName;
+  return routeDb;
+}
+
+thrift::AdjDbs
+Decision::dumpAdjacencyDbs() {
+  thrift::AdjDbs adjDbs;
+  auto const snapshot = getSolverSnapshot();
+  for (auto const& kv : snapshot->adjacencyDatabases) {
+    adjDbs.emplace(kv.first, *kv.second);
+  }
+  return adjDbs;
+}
+
+thrift::PrefixDbs
+Decision::dumpPrefixDbs() {
+  thrift::PrefixDbs prefixDbs;
+  auto const snapshot = getSolverSnapshot();
+  for (auto const& kv : snapshot->prefixDatabases) {
+    prefixDbs.emplace(kv.first, *kv.second);
+  }
+  return prefixDbs;
 }
 
 std::unordered_map<std::string, int64_t>
 Decision::getCounters() {
-  return spfSolver_->getCounters();
+  auto counters = spfSolver_->getCounters();
+  if (computeSolver_) {
+    // route computation stats as of the last finished computation
+    for (auto const& kv : *computeCounters_.rlock()) {
+      counters[kv.first] = kv.second;
+    }
+  }
+  {
+    auto cache = routeDbQueryCache_.rlock();
+    counters["decision.route_db_query_cache_hits"] = cache->numHits;
+    counters["decision.route_db_query_cache_misses"] = cache->numMisses;
+  }
+  counters["decision.debounce_window_ms"] =
+      processUpdatesBackoff_.getInitialBackoff().count();
+  counters["decision.debounce_max_window_ms"] =
+      processUpdatesBackoff_.getMaxBackoff().count();
+  counters["decision.unchanged_values_skipped"] = numUnchangedValuesSkipped_;
+  for (auto const& kv : phaseHistograms_) {
+    kv.second.exportCounters(kv.first, counters);
+  }
+  return counters;
 }
 
 thrift::PrefixDatabase
@@ -1764,10 +4192,28 @@ Decision::updateNodePrefixDatabase(
     const std::string& key, const thrift::PrefixDatabase& prefixDb) {
   auto const& nodeName = prefixDb.thisNodeName;
 
+  // prefix entries of the node are filled in by applyPrefixDatabases
+  thrift::PrefixDatabase nodePrefixDb;
+  nodePrefixDb.thisNodeName = nodeName;
+  nodePrefixDb.perfEvents = prefixDb.perfEvents;
+
+  auto prefixShardKey = PrefixShardKey::fromStr(key);
+  if (prefixShardKey.hasValue()) {
+    nodePrefixDatabase_.erase(nodeName);
+    auto& nodePrefixShards = nodePrefixShards_[nodeName];
+    if (prefixDb.deletePrefix) {
+      nodePrefixShards.erase(prefixShardKey->getShard());
+    } else {
+      nodePrefixShards[prefixShardKey->getShard()] = prefixDb.prefixEntries;
+    }
+    return nodePrefixDb;
+  }
+
+  // either node will advertise per prefix, prefix shards or entire prefix DB,
+  // not a combination. Erase other formats if node switches format
+  nodePrefixShards_.erase(nodeName);
   auto prefixKey = PrefixKey::fromStr(key);
   if (!prefixKey.hasValue()) {
-    // either node will advertise per prefix or entire prefix DB,
-    // not a combination. Erase from nodePrefixDatabase_ if node switches format
     nodePrefixDatabase_.erase(nodeName);
     return prefixDb;
   }
@@ -1783,15 +4229,58 @@ Decision::updateNodePrefixDatabase(
           prefixDb.prefixEntries[0];
     }
   }
+  return nodePrefixDb;
+}
 
-  thrift::PrefixDatabase nodePrefixDb;
-  nodePrefixDb.thisNodeName = nodeName;
-  nodePrefixDb.perfEvents = prefixDb.perfEvents;
-  // create and return prefixDB for the node
-  for (const auto& prefix : nodePrefixEntries) {
-    nodePrefixDb.prefixEntries.emplace_back(prefix.second);
+bool
+Decision::applyPrefixDatabases(
+    std::unordered_map<std::string, thrift::PrefixDatabase>& prefixDbs) {
+  if (prefixDbs.empty()) {
+    return false;
   }
-  return nodePrefixDb;
+
+  std::vector<thrift::PrefixDatabase> nodePrefixDbs;
+  nodePrefixDbs.reserve(prefixDbs.size());
+  for (auto& kv : prefixDbs) {
+    auto& nodePrefixDb = kv.second;
+    auto search = nodePrefixDatabase_.find(kv.first);
+    if (search != nodePrefixDatabase_.end()) {
+      // create prefixDB for the node advertising per prefix keys
+      nodePrefixDb.prefixEntries.clear();
+      nodePrefixDb.prefixEntries.reserve(search->second.size());
+      for (const auto& prefix : search->second) {
+        nodePrefixDb.prefixEntries.emplace_back(prefix.second);
+      }
+    }
+    auto shardsSearch = nodePrefixShards_.find(kv.first);
+    if (shardsSearch != nodePrefixShards_.end()) {
+      // merge prefix shards of the node
+      nodePrefixDb.prefixEntries.clear();
+      for (const auto& shard : shardsSearch->second) {
+        nodePrefixDb.prefixEntries.insert(
+            nodePrefixDb.prefixEntries.end(),
+            shard.second.begin(),
+            shard.second.end());
+      }
+    }
+    nodePrefixDbs.emplace_back(std::move(nodePrefixDb));
+  }
+  prefixDbs.clear();
+
+  auto changed = spfSolver_->updatePrefixDatabases(nodePrefixDbs);
+  if (changed) {
+    // only the first perf events are kept for pending updates anyway
+    for (auto const& nodePrefixDb : nodePrefixDbs) {
+      pendingPrefixUpdates_.addUpdate(myNodeName_, nodePrefixDb.perfEvents);
+    }
+  }
+  if (computeSolver_) {
+    recordSolverUpdate(
+        [nodePrefixDbs = std::move(nodePrefixDbs)](SpfSolver& solver) {
+          solver.updatePrefixDatabases(nodePrefixDbs);
+        });
+  }
+  return changed;
 }
 
 ProcessPublicationResult
@@ -1806,6 +4295,17 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
     return res;
   }
 
+  if (publicationRecorder_) {
+    auto recorded = publicationRecorder_->record(thriftPub);
+    if (recorded.hasError()) {
+      LOG(ERROR) << "Stopped recording publications: " << recorded.error();
+      publicationRecorder_.reset();
+    }
+  }
+
+  // prefix databases of nodes updated by this publication, applied at once
+  std::unordered_map<std::string, thrift::PrefixDatabase> nodePrefixDbs;
+
   for (const auto& kv : thriftPub.keyVals) {
     const auto& key = kv.first;
     const auto& rawVal = kv.second;
@@ -1817,14 +4317,28 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
       continue;
     }
 
+    if ((key.find(adjacencyDbMarker_) == 0 or
+         key.find(prefixDbMarker_) == 0) and
+        not valueHashes_.update(key, rawVal.value.value())) {
+      // same database under new version
+      ++numUnchangedValuesSkipped_;
+      continue;
+    }
+
     try {
       if (key.find(adjacencyDbMarker_) == 0) {
         // update adjacencyDb
-        auto adjacencyDb =
-            fbzmq::util::readThriftObjStr<thrift::AdjacencyDatabase>(
-                rawVal.value.value(), serializer_);
+        auto adjacencyDb = readThriftValue<thrift::AdjacencyDatabase>(
+            rawVal.value.value(), serializer_);
         CHECK_EQ(nodeName, adjacencyDb.thisNodeName);
+        // holds present so far must not count ticks to come for new holds
+        catchUpOrderedFibHolds();
         auto rc = spfSolver_->updateAdjacencyDatabase(adjacencyDb);
+        if (computeSolver_) {
+          recordSolverUpdate([adjacencyDb](SpfSolver& solver) {
+            solver.updateAdjacencyDatabase(adjacencyDb);
+          });
+        }
         if (rc.first) {
           res.adjChanged = true;
           pendingAdjUpdates_.addUpdate(myNodeName_, adjacencyDb.perfEvents);
@@ -1833,23 +4347,22 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
           res.prefixesChanged = true;
           pendingPrefixUpdates_.addUpdate(myNodeName_, adjacencyDb.perfEvents);
         }
-        if (spfSolver_->hasHolds() && orderedFibTimer_ != nullptr &&
-            !orderedFibTimer_->isScheduled()) {
-          orderedFibTimer_->scheduleTimeout(getMaxFib());
+        if (orderedFibTimer_ != nullptr && spfSolver_->hasHolds()) {
+          // new holds may expire before the ones timer is scheduled for
+          if (!orderedFibTimer_->isScheduled()) {
+            orderedFibTickTime_ = std::chrono::steady_clock::now();
+          }
+          scheduleOrderedFibTimer();
         }
         continue;
       }
 
       if (key.find(prefixDbMarker_) == 0) {
         // update prefixDb
-        auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+        auto prefixDb = readThriftValue<thrift::PrefixDatabase>(
             rawVal.value.value(), serializer_);
         CHECK_EQ(nodeName, prefixDb.thisNodeName);
-        auto nodePrefixDb = updateNodePrefixDatabase(key, prefixDb);
-        if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
-          res.prefixesChanged = true;
-          pendingPrefixUpdates_.addUpdate(myNodeName_, nodePrefixDb.perfEvents);
-        }
+        nodePrefixDbs[nodeName] = updateNodePrefixDatabase(key, prefixDb);
         continue;
       }
 
@@ -1872,11 +4385,17 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
 
   // LSDB deletion
   for (const auto& key : thriftPub.expiredKeys) {
+    valueHashes_.erase(key);
     std::string prefix, nodeName;
     folly::split(
         Constants::kPrefixNameSeparator.toString(), key, prefix, nodeName);
 
     if (key.find(adjacencyDbMarker_) == 0) {
+      if (computeSolver_) {
+        recordSolverUpdate([nodeName](SpfSolver& solver) {
+          solver.deleteAdjacencyDatabase(nodeName);
+        });
+      }
       if (spfSolver_->deleteAdjacencyDatabase(nodeName)) {
         res.adjChanged = true;
         pendingAdjUpdates_.addUpdate(myNodeName_, folly::none);
@@ -1885,6 +4404,22 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
     }
 
     if (key.find(prefixDbMarker_) == 0) {
+      auto prefixShardKey = PrefixShardKey::fromStr(key);
+      if (prefixShardKey.hasValue()) {
+        nodeName = prefixShardKey->getNodeName();
+        auto shardsSearch = nodePrefixShards_.find(nodeName);
+        if (shardsSearch == nodePrefixShards_.end()) {
+          // node doesn't advertise prefix shards anymore
+          continue;
+        }
+        // delete single shard from the prefix DB for a given node, or entire
+        // prefix DB below with the last shard
+        shardsSearch->second.erase(prefixShardKey->getShard());
+        if (not shardsSearch->second.empty()) {
+          nodePrefixDbs[nodeName].thisNodeName = nodeName;
+          continue;
+        }
+      }
       auto prefixStr = PrefixKey::fromStr(key);
       if (prefixStr.hasValue()) {
         // delete single prefix from the prefix DB for a given node
@@ -1893,11 +4428,20 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
             createPrefixEntry(prefixStr.value().getIpPrefix()));
         deletePrefixDb.thisNodeName = prefixStr.value().getNodeName();
         deletePrefixDb.deletePrefix = true;
-        auto nodePrefixDb = updateNodePrefixDatabase(key, deletePrefixDb);
-        if (spfSolver_->updatePrefixDatabase(nodePrefixDb)) {
-          res.prefixesChanged = true;
-        }
+        updateNodePrefixDatabase(key, deletePrefixDb);
+        // keep perf events of updates received before
+        nodePrefixDbs[deletePrefixDb.thisNodeName].thisNodeName =
+            deletePrefixDb.thisNodeName;
       } else {
+        // last prefix shard, or entire prefix DB of the node expired
+        nodePrefixShards_.erase(nodeName);
+        // prefix updates received before must not override the deletion
+        res.prefixesChanged |= applyPrefixDatabases(nodePrefixDbs);
+        if (computeSolver_) {
+          recordSolverUpdate([nodeName](SpfSolver& solver) {
+            solver.deletePrefixDatabase(nodeName);
+          });
+        }
         if (spfSolver_->deletePrefixDatabase(nodeName)) {
           res.prefixesChanged = true;
           pendingPrefixUpdates_.addUpdate(myNodeName_, folly::none);
@@ -1907,6 +4451,9 @@ Decision::processPublication(thrift::Publication const& thriftPub) {
     }
   }
 
+  res.prefixesChanged |= applyPrefixDatabases(nodePrefixDbs);
+
+  *solverSnapshot_.wlock() = spfSolver_->getSnapshot();
   return res;
 }
 
@@ -1922,27 +4469,59 @@ Decision::initialSync(fbzmq::Context& zmqContext) {
                << reqConnect.error();
   }
 
-  thrift::KvStoreRequest thriftReq;
-  thrift::KeyDumpParams params;
-
-  thriftReq.cmd = thrift::Command::KEY_DUMP;
-  thriftReq.keyDumpParams = params;
-
-  storeReq.sendThriftObj(thriftReq, serializer_);
+  // Dump keys under keyPrefixes, in leafRanges only if any, and process them
+  ProcessPublicationResult ret;
+  auto const dumpAndProcess =
+      [this, &storeReq, &ret](
+          std::string keyPrefixes,
+          folly::Optional<std::set<int64_t>> leafRanges) {
+        thrift::KvStoreRequest thriftReq;
+        thriftReq.cmd = thrift::Command::KEY_DUMP;
+        thrift::KeyDumpParams params;
+        params.prefix = std::move(keyPrefixes);
+        params.keyRanges = std::move(leafRanges);
+        thriftReq.keyDumpParams = std::move(params);
+        storeReq.sendThriftObj(thriftReq, serializer_);
+
+        auto maybeThriftPub = storeReq.recvThriftObj<thrift::Publication>(
+            serializer_, Constants::kReadTimeout);
+        if (maybeThriftPub.hasError()) {
+          LOG(ERROR) << "Error processing KvStore publication: "
+                     << maybeThriftPub.error();
+          return false;
+        }
+        auto const res = processPublication(maybeThriftPub.value());
+        ret.adjChanged |= res.adjChanged;
+        ret.prefixesChanged |= res.prefixesChanged;
+        return true;
+      };
 
   VLOG(2) << "Decision process requesting initial state...";
 
-  // receive the full dump of the database
-  auto maybeThriftPub = storeReq.recvThriftObj<thrift::Publication>(
-      serializer_, Constants::kReadTimeout);
-  if (maybeThriftPub.hasError()) {
-    LOG(ERROR) << "Error processing KvStore publication: "
-               << maybeThriftPub.error();
+  // Link state first, then prefix databases in batches of top level key
+  // ranges, so that only a batch of them is held in serialized and parsed
+  // form at a time
+  if (not dumpAndProcess(
+          folly::sformat(
+              "{},{}", adjacencyDbMarker_, Constants::kFibTimeMarker),
+          folly::none)) {
     return;
   }
+  const int64_t numBatches = int64_t{1} << Constants::kKvStoreSyncRangeBits;
+  const int64_t leafRangesPerBatch = int64_t{1}
+      << (Constants::kKvStoreSyncRangeBits *
+          (Constants::kKvStoreSyncRangeLevels - 1));
+  for (int64_t batch = 0; batch < numBatches; ++batch) {
+    std::set<int64_t> leafRanges;
+    for (int64_t i = 0; i < leafRangesPerBatch; ++i) {
+      leafRanges.emplace_hint(leafRanges.end(), batch * leafRangesPerBatch + i);
+    }
+    if (not dumpAndProcess(prefixDbMarker_, std::move(leafRanges))) {
+      return;
+    }
+  }
 
-  // Process publication and immediately apply updates
-  auto const& ret = processPublication(maybeThriftPub.value());
+  // Apply updates right away
   if (ret.adjChanged) {
     // Graph changes
     processPendingAdjUpdates();
@@ -1950,6 +4529,12 @@ Decision::initialSync(fbzmq::Context& zmqContext) {
     // Only Prefix changes, no graph changes
     processPendingPrefixUpdates();
   }
+
+  initialSyncDone_ = true;
+  if (initialSyncCallback_) {
+    initialSyncCallback_();
+    initialSyncCallback_ = nullptr;
+  }
 }
 
 // periodically submit counters to Counters thread
@@ -1958,14 +4543,18 @@ Decision::submitCounters() {
   VLOG(3) << "Submitting counters...";
 
   // Prepare for submitting counters
-  auto counters = spfSolver_->getCounters();
+  auto counters = getCounters();
   counters["decision.zmq_event_queue_size"] = getEventQueueSize();
+  exportProfileCounters(counters);
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
 
 void
 Decision::processPendingUpdates() {
+  const auto numUpdates =
+      pendingAdjUpdates_.getCount() + pendingPrefixUpdates_.getCount();
+
   if (processUpdatesStatus_.adjChanged) {
     processPendingAdjUpdates();
   } else if (processUpdatesStatus_.prefixesChanged) {
@@ -1978,6 +4567,15 @@ Decision::processPendingUpdates() {
 
   // update decision debounce flag
   processUpdatesBackoff_.reportSuccess();
+
+  // pick batching window for next updates based on cost of the last finished
+  // computation (this one unless it runs on compute thread)
+  if (adaptiveDebounce_.hasValue()) {
+    adaptiveDebounce_->reportRun(lastComputationCost_, numUpdates);
+    processUpdatesBackoff_ = ExponentialBackoff<std::chrono::milliseconds>(
+        adaptiveDebounce_->getInitialWindow(),
+        adaptiveDebounce_->getMaxWindow());
+  }
 }
 
 void
@@ -2011,88 +4609,360 @@ Decision::processPendingAdjUpdates() {
 
   // run SPF once for all updates received
   LOG(INFO) << "Decision: computing new paths.";
-  auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
-  if (not maybeRouteDb.hasValue()) {
-    LOG(WARNING) << "AdjacencyDb updates incurred no route updates";
-    return;
-  }
+  runRouteComputation(
+      [this](SpfSolver& solver) { return solver.buildPathsDelta(myNodeName_); },
+      [this, maybePerfEvents](
+          folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDelta) {
+        if (not maybeRouteDelta.hasValue()) {
+          LOG(WARNING) << "AdjacencyDb updates incurred no route updates";
+          return;
+        }
 
-  maybeRouteDb.value().perfEvents = maybePerfEvents;
-  sendRouteUpdate(maybeRouteDb.value(), "DECISION_SPF");
+        mergePhaseEvents(maybePerfEvents, maybeRouteDelta.value());
+        sendRouteUpdate(maybeRouteDelta.value(), "DECISION_SPF");
+      });
 }
 
 void
 Decision::processPendingPrefixUpdates() {
   auto maybePerfEvents = pendingPrefixUpdates_.getPerfEvents();
+  if (maybePerfEvents) {
+    addPerfEvent(*maybePerfEvents, myNodeName_, "DECISION_DEBOUNCE");
+  }
   pendingPrefixUpdates_.clear();
   if (coldStartTimer_->isScheduled()) {
     return;
   }
 
-  // update routeDb once for all updates received
+  // update routeDb once for all updates received. Only routes of changed
+  // prefixes are re-computed if possible
   LOG(INFO) << "Decision: updating new routeDb.";
-  auto maybeRouteDb = spfSolver_->buildRouteDb(myNodeName_);
-  if (not maybeRouteDb.hasValue()) {
-    LOG(WARNING) << "PrefixDb updates incurred no route updates";
+  runRouteComputation(
+      [this](SpfSolver& solver) {
+        return solver.buildRouteDbDelta(myNodeName_);
+      },
+      [this, maybePerfEvents](
+          folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDelta) {
+        if (not maybeRouteDelta.hasValue()) {
+          LOG(WARNING) << "PrefixDb updates incurred no route updates";
+          return;
+        }
+
+        mergePhaseEvents(maybePerfEvents, maybeRouteDelta.value());
+        sendRouteUpdate(maybeRouteDelta.value(), "ROUTE_UPDATE");
+      });
+}
+
+void
+Decision::scheduleOrderedFibTimer() {
+  const auto ticks = spfSolver_->getHoldTtl();
+  if (ticks == 0) {
+    orderedFibTimer_->cancelTimeout();
     return;
   }
 
-  maybeRouteDb.value().perfEvents = maybePerfEvents;
-  sendRouteUpdate(maybeRouteDb.value(), "ROUTE_UPDATE");
+  // Ticks stay aligned to orderedFibTickTime_ while no hold expires, as if
+  // timer fired every getMaxFib()
+  orderedFibTimerTicks_ = ticks;
+  const auto elapsed = std::chrono::steady_clock::now() - orderedFibTickTime_;
+  const auto timeout = std::max(
+      std::chrono::milliseconds(0),
+      getMaxFib() * static_cast<int64_t>(ticks) -
+          std::chrono::duration_cast<std::chrono::milliseconds>(elapsed));
+  LOG(INFO) << "Scheduling next hold decrement in " << timeout.count()
+            << "ms, " << ticks << " ticks";
+  orderedFibTimer_->cancelTimeout();
+  orderedFibTimer_->scheduleTimeout(timeout);
+}
+
+void
+Decision::catchUpOrderedFibHolds() {
+  if (orderedFibTimer_ == nullptr or not orderedFibTimer_->isScheduled()) {
+    return;
+  }
+  // Ticks that passed without any hold expiring, the next expiry is left to
+  // the timer
+  const auto maxFib = getMaxFib();
+  const uint64_t ticks = std::min<uint64_t>(
+      (std::chrono::steady_clock::now() - orderedFibTickTime_) / maxFib,
+      orderedFibTimerTicks_ - 1);
+  if (ticks == 0) {
+    return;
+  }
+  decrementOrderedFibHolds(ticks);
+  orderedFibTickTime_ += maxFib * static_cast<int64_t>(ticks);
+  orderedFibTimerTicks_ -= ticks;
 }
 
 void
-Decision::decrementOrderedFibHolds() {
-  if (spfSolver_->decrementHolds()) {
+Decision::decrementOrderedFibHolds(uint64_t ticks) {
+  if (computeSolver_) {
+    recordSolverUpdate(
+        [ticks](SpfSolver& solver) { solver.decrementHolds(ticks); });
+  }
+  if (spfSolver_->decrementHolds(ticks)) {
     if (coldStartTimer_->isScheduled()) {
       return;
     }
-    auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
-    if (not maybeRouteDb.hasValue()) {
-      LOG(INFO) << "decrementOrderedFibHolds incurred no route updates";
-      return;
-    }
+    runRouteComputation(
+        [this](SpfSolver& solver) {
+          return solver.buildPathsDelta(myNodeName_);
+        },
+        [this](folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDelta) {
+          if (not maybeRouteDelta.hasValue()) {
+            LOG(INFO) << "decrementOrderedFibHolds incurred no route updates";
+            return;
+          }
 
-    // Create empty perfEvents list. In this case we don't this route update to
-    // be inculded in the Fib time
-    maybeRouteDb.value().perfEvents = thrift::PerfEvents{};
-    sendRouteUpdate(maybeRouteDb.value(), "ORDERED_FIB_HOLDS_EXPIRED");
+          // Create empty perfEvents list. In this case we don't this route
+          // update to be inculded in the Fib time
+          maybeRouteDelta.value().perfEvents = thrift::PerfEvents{};
+          sendRouteUpdate(maybeRouteDelta.value(), "ORDERED_FIB_HOLDS_EXPIRED");
+        });
   }
 }
 
 void
 Decision::coldStartUpdate() {
-  auto maybeRouteDb = spfSolver_->buildPaths(myNodeName_);
-  if (not maybeRouteDb.hasValue()) {
-    LOG(ERROR) << "SEVERE: No routes to program after cold start duration. "
-               << "Sending empty route db to FIB";
-    thrift::RouteDatabase db;
-    sendRouteUpdate(db, "COLD_START_UPDATE");
+  runRouteComputation(
+      [this](SpfSolver& solver) { return solver.buildPathsDelta(myNodeName_); },
+      [this](folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDelta) {
+        if (not maybeRouteDelta.hasValue()) {
+          LOG(ERROR) << "SEVERE: No routes to program after cold start "
+                     << "duration. Sending empty route db to FIB";
+          thrift::RouteDatabaseDelta routeDelta;
+          routeDelta.thisNodeName = myNodeName_;
+          if (publishedRouteDb_.hasValue()) {
+            // withdraw routes restored from config store
+            for (auto const& kv : publishedRouteDb_->unicastRoutes) {
+              routeDelta.unicastRoutesToDelete.emplace_back(kv.first);
+            }
+            for (auto const& kv : publishedRouteDb_->mplsRoutes) {
+              routeDelta.mplsRoutesToDelete.emplace_back(kv.first);
+            }
+            setSolverRouteDbCache(thrift::RouteDatabase());
+          }
+          sendRouteUpdate(routeDelta, "COLD_START_UPDATE");
+          return;
+        }
+        // Create empty perfEvents list. In this case we don't this route
+        // update to be inculded in the Fib time
+        maybeRouteDelta.value().perfEvents = thrift::PerfEvents{};
+        sendRouteUpdate(maybeRouteDelta.value(), "COLD_START_UPDATE");
+      });
+}
+
+void
+Decision::publishPersistedRouteDb() {
+  if (not coldStartTimer_->isScheduled()) {
+    return;
+  }
+
+  auto maybeRouteDb =
+      configStoreClient_->loadThriftObj<thrift::RouteDatabase>(
+          kRouteDbConfigKey);
+  if (maybeRouteDb.hasError()) {
+    LOG(INFO) << "No persisted routes to publish: " << maybeRouteDb.error();
+    return;
+  }
+  auto& routeDb = maybeRouteDb.value();
+  if (routeDb.thisNodeName != myNodeName_) {
+    LOG(WARNING) << "Ignoring persisted routes of node "
+                 << routeDb.thisNodeName;
+    return;
+  }
+  LOG(INFO) << "Publishing " << routeDb.unicastRoutes.size() << " unicast and "
+            << routeDb.mplsRoutes.size() << " mpls routes persisted before "
+            << "restart.";
+
+  // routes computed after graceful restart are published as the difference
+  // to the persisted ones
+  setSolverRouteDbCache(routeDb);
+
+  thrift::RouteDatabaseDelta routeDelta;
+  routeDelta.thisNodeName = myNodeName_;
+  routeDelta.unicastRoutesToUpdate = std::move(routeDb.unicastRoutes);
+  routeDelta.mplsRoutesToUpdate = std::move(routeDb.mplsRoutes);
+  sendRouteUpdate(routeDelta, "PERSISTED_ROUTE_DB");
+}
+
+void
+Decision::setSolverRouteDbCache(thrift::RouteDatabase const& routeDb) {
+  spfSolver_->setRouteDbCache(routeDb);
+  if (computeSolver_) {
+    recordSolverUpdate(
+        [routeDb](SpfSolver& solver) { solver.setRouteDbCache(routeDb); });
+  }
+}
+
+void
+Decision::persistRouteDb() {
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = myNodeName_;
+  routeDb.unicastRoutes.reserve(publishedRouteDb_->unicastRoutes.size());
+  for (auto const& kv : publishedRouteDb_->unicastRoutes) {
+    routeDb.unicastRoutes.emplace_back(kv.second);
+  }
+  routeDb.mplsRoutes.reserve(publishedRouteDb_->mplsRoutes.size());
+  for (auto const& kv : publishedRouteDb_->mplsRoutes) {
+    routeDb.mplsRoutes.emplace_back(kv.second);
+  }
+  auto ret = configStoreClient_->storeThriftObj(kRouteDbConfigKey, routeDb);
+  if (ret.hasError()) {
+    LOG(ERROR) << "Failed to persist routes: " << ret.error();
+  }
+}
+
+void
+Decision::checkRouteDbConsistency() {
+  if (coldStartTimer_->isScheduled()) {
+    return;
+  }
+  runRouteComputation(
+      [this](SpfSolver& solver) {
+        return solver.checkRouteDbCache(myNodeName_);
+      },
+      [this](folly::Optional<thrift::RouteDatabaseDelta> maybeRouteDelta) {
+        if (not maybeRouteDelta.hasValue()) {
+          VLOG(2) << "Skipping route db consistency check on pending updates";
+          return;
+        }
+        auto const& routeDelta = maybeRouteDelta.value();
+        if (routeDelta.unicastRoutesToUpdate.empty() and
+            routeDelta.unicastRoutesToDelete.empty() and
+            routeDelta.mplsRoutesToUpdate.empty() and
+            routeDelta.mplsRoutesToDelete.empty()) {
+          return;
+        }
+        sendRouteUpdate(maybeRouteDelta.value(), "ROUTE_DB_CONSISTENCY_CHECK");
+      });
+}
+
+void
+Decision::recordSolverUpdate(SolverUpdate update) {
+  CHECK(computeSolver_);
+  pendingSolverUpdates_.emplace_back(std::move(update));
+}
+
+void
+Decision::runRouteComputation(
+    RouteComputation computation, RouteComputationCallback callback) {
+  if (not computeSolver_) {
+    auto const& startTime = std::chrono::steady_clock::now();
+    auto maybeRouteDelta = computation(*spfSolver_);
+    lastComputationCost_ =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime);
+    callback(std::move(maybeRouteDelta));
     return;
   }
-  // Create empty perfEvents list. In this case we don't this route update to
-  // be inculded in the Fib time
-  maybeRouteDb.value().perfEvents = thrift::PerfEvents{};
-  sendRouteUpdate(maybeRouteDb.value(), "COLD_START_UPDATE");
+
+  // Hand over updates received so far. They are applied in order on the
+  // compute thread, followed by the computation itself. Decision thread keeps
+  // ingesting updates and serving queries in the meantime
+  folly::Executor* executor = sharedComputeExecutor_
+      ? static_cast<folly::Executor*>(sharedComputeExecutor_.get())
+      : computeExecutor_.get();
+  executor->add([this,
+                 updates = std::move(pendingSolverUpdates_),
+                 computation = std::move(computation),
+                 callback = std::move(callback)]() mutable {
+    auto const& startTime = std::chrono::steady_clock::now();
+    for (auto& update : updates) {
+      update(*computeSolver_);
+    }
+    auto maybeRouteDelta = computation(*computeSolver_);
+    const auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime);
+    *computeCounters_.wlock() = computeSolver_->getCounters();
+
+    runInEventLoop([this,
+                    cost,
+                    maybeRouteDelta = std::move(maybeRouteDelta),
+                    callback = std::move(callback)]() mutable noexcept {
+      lastComputationCost_ = cost;
+      callback(std::move(maybeRouteDelta));
+    });
+  });
+  pendingSolverUpdates_.clear();
 }
 
 void
 Decision::sendRouteUpdate(
-    thrift::RouteDatabase& db, std::string const& eventDescription) {
-  if (db.perfEvents.hasValue()) {
-    addPerfEvent(db.perfEvents.value(), myNodeName_, eventDescription);
+    thrift::RouteDatabaseDelta& routeDelta,
+    std::string const& eventDescription) {
+  if (routeDelta.perfEvents.hasValue()) {
+    addPerfEvent(routeDelta.perfEvents.value(), myNodeName_, eventDescription);
+    recordPhaseDurations(routeDelta.perfEvents.value());
+  }
+
+  if (publishedRouteDb_.hasValue()) {
+    for (auto const& route : routeDelta.unicastRoutesToUpdate) {
+      publishedRouteDb_->unicastRoutes[route.dest] = route;
+    }
+    for (auto const& prefix : routeDelta.unicastRoutesToDelete) {
+      publishedRouteDb_->unicastRoutes.erase(prefix);
+    }
+    for (auto const& route : routeDelta.mplsRoutesToUpdate) {
+      publishedRouteDb_->mplsRoutes[route.topLabel] = route;
+    }
+    for (auto const& topLabel : routeDelta.mplsRoutesToDelete) {
+      publishedRouteDb_->mplsRoutes.erase(topLabel);
+    }
+    persistRouteDbThrottled_->operator()();
   }
 
-  // Find out delta to be sent to Fib
-  auto routeDelta = findDeltaRoutes(db, routeDb_);
-  routeDelta.perfEvents = db.perfEvents;
-  routeDb_ = std::move(db);
+  if (routeDeltaCallback_) {
+    routeDeltaCallback_(routeDelta);
+  }
 
-  // publish the new route state
-  auto sendRc = decisionPub_.sendThriftObj(routeDelta, serializer_);
+  // send each unique ECMP group only once
+  const auto numNextHopGroups = compressNextHopGroups(routeDelta);
+  VLOG(2) << "Publishing " << routeDelta.unicastRoutesToUpdate.size()
+          << " unicast routes with " << numNextHopGroups << " next-hop groups";
+
+  // publish the new route state. Serialization and publishing happen after
+  // the last perf event and are timed here instead
+  auto startTime = std::chrono::steady_clock::now();
+  auto msg = routeDeltaSerializer_.toMessage(routeDelta);
+  if (msg.hasError()) {
+    LOG(ERROR) << "Error serializing new routing table: " << msg.error();
+    return;
+  }
+  auto serializedTime = std::chrono::steady_clock::now();
+  auto sendRc = decisionPub_.sendOne(std::move(msg).value());
   if (sendRc.hasError()) {
     LOG(ERROR) << "Error publishing new routing table: " << sendRc.error();
   }
+  recordPhaseDuration(
+      "decision.phase.serialization_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          serializedTime - startTime));
+  recordPhaseDuration(
+      "decision.phase.publish_ms",
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - serializedTime));
+}
+
+void
+Decision::recordPhaseDuration(
+    std::string const& name, std::chrono::milliseconds duration) {
+  phaseHistograms_[name].addValue(duration);
+}
+
+void
+Decision::recordPhaseDurations(thrift::PerfEvents const& perfEvents) {
+  auto const& events = perfEvents.events;
+  for (size_t i = 1; i < events.size(); ++i) {
+    auto search = kPhaseCounterNames.find(events[i].eventDescr);
+    if (search == kPhaseCounterNames.end()) {
+      continue;
+    }
+    recordPhaseDuration(
+        search->second,
+        std::chrono::milliseconds(
+            std::max<int64_t>(0, events[i].unixTs - events[i - 1].unixTs)));
+  }
 }
 
 std::chrono::milliseconds
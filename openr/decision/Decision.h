@@ -7,9 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <functional>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqEventLoop.h>
@@ -21,11 +25,18 @@
 #include <folly/IPAddress.h>
 #include <folly/Memory.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/SerialExecutor.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/BusSerializer.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/Util.h>
+#include <openr/config-store/PersistentStoreClient.h>
+#include <openr/decision/PublicationRecorder.h>
 #include <openr/if/gen-cpp2/Decision_types.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
@@ -95,8 +106,91 @@ struct DecisionPendingUpdates {
   folly::Optional<int64_t> minTs_;
   folly::Optional<thrift::PerfEvents> perfEvents_;
 };
+
+/**
+ * Pick the batching window for pending updates based on the measured cost of
+ * processing them and the number of updates batched together so far.
+ * The initial window is as long as an average computation, so that at most
+ * half of the time is spent computing routes under sustained churn. The
+ * window is allowed to grow while updates keep arriving only as much as the
+ * observed batch sizes justify. Both are bounded by [minWindow, maxWindow] and
+ * the maximum window is always longer than the initial one.
+ */
+class DecisionDebounce {
+ public:
+  DecisionDebounce(
+      std::chrono::milliseconds minWindow, std::chrono::milliseconds maxWindow)
+      : minWindow_(minWindow), maxWindow_(maxWindow) {
+    CHECK_LT(minWindow_.count(), maxWindow_.count());
+  }
+
+  void
+  reportRun(std::chrono::milliseconds cost, uint32_t numUpdates) {
+    avgCostMs_ =
+        avgCostMs_ < 0 ? cost.count() : (3 * avgCostMs_ + cost.count()) / 4;
+    avgUpdates_ =
+        avgUpdates_ < 0 ? numUpdates : (3 * avgUpdates_ + numUpdates) / 4;
+  }
+
+  std::chrono::milliseconds
+  getInitialWindow() const {
+    if (avgCostMs_ < 0) {
+      return minWindow_;
+    }
+    return clamp(
+        avgCostMs_, minWindow_, maxWindow_ - std::chrono::milliseconds(1));
+  }
+
+  std::chrono::milliseconds
+  getMaxWindow() const {
+    if (avgCostMs_ < 0) {
+      return maxWindow_;
+    }
+    return clamp(
+        avgCostMs_ * std::max(1.0, avgUpdates_),
+        getInitialWindow() + std::chrono::milliseconds(1),
+        maxWindow_);
+  }
+
+ private:
+  static std::chrono::milliseconds
+  clamp(
+      double windowMs,
+      std::chrono::milliseconds lower,
+      std::chrono::milliseconds upper) {
+    const auto window = std::chrono::milliseconds(
+        static_cast<int64_t>(std::min<double>(windowMs, upper.count())));
+    return std::max(lower, window);
+  }
+
+  std::chrono::milliseconds minWindow_;
+  std::chrono::milliseconds maxWindow_;
+
+  // moving averages, negative until first run is reported
+  double avgCostMs_{-1};
+  double avgUpdates_{-1};
+};
+
+// Durations of each phase of route computation
+using DecisionPhaseHistogram = LatencyHistogram;
 } // namespace detail
 
+// Immutable view of the link state databases ingested by SpfSolver. Databases
+// of nodes which did not change are shared between consecutive snapshots, so
+// readers can hold on to one without blocking or copying on updates
+struct SpfSolverSnapshot {
+  // bumped on every change of any database
+  uint64_t version{0};
+  std::unordered_map<
+      std::string /* nodeName */,
+      std::shared_ptr<const thrift::AdjacencyDatabase>>
+      adjacencyDatabases;
+  std::unordered_map<
+      std::string /* nodeName */,
+      std::shared_ptr<const thrift::PrefixDatabase>>
+      prefixDatabases;
+};
+
 // The class to compute shortest-paths using Dijkstra algorithm
 class SpfSolver {
  public:
@@ -107,7 +201,22 @@ class SpfSolver {
       bool enableV4,
       bool computeLfaPaths,
       bool enableOrderedFib = false,
-      bool bgpDryRun = false);
+      bool bgpDryRun = false,
+      // number of worker threads for LFA SPF runs. 0 runs them inline
+      size_t lfaSpfThreads = 0,
+      // number of worker threads building unicast routes in prefix shards.
+      // 0 builds them inline
+      size_t routeBuildThreads = 0,
+      // pool shared with other modules to run LFA SPF runs and route builds
+      // on, instead of pools of above sizes
+      std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor = nullptr,
+      // run Dijkstra over a radix heap of integer metrics instead of a binary
+      // heap. Same results, faster on large topologies with small metrics
+      bool useRadixHeapSpf = false,
+      // run full SPF with a Dijkstra loop specialized at compile time on the
+      // kind of run (metric or hop count, ignored links, overloaded nodes)
+      // instead of checking for all of them per relaxed link. Same results
+      bool useSpecializedSpf = false);
   ~SpfSolver();
 
   //
@@ -123,6 +232,9 @@ class SpfSolver {
 
   bool hasHolds() const;
 
+  // ordered FIB timer ticks until first hold expires, 0 if there is no hold
+  uint64_t getHoldTtl() const;
+
   // delete a node's adjacency database
   // return true if this has caused any change in graph
   bool deleteAdjacencyDatabase(const std::string& nodeName);
@@ -135,6 +247,11 @@ class SpfSolver {
   // routeDb change
   bool updatePrefixDatabase(thrift::PrefixDatabase const& prefixDb);
 
+  // update prefixes of many routers at once, e.g. all prefix keys of a
+  // publication. Returns true if any of them has caused routeDb change
+  bool updatePrefixDatabases(
+      std::vector<thrift::PrefixDatabase> const& prefixDbs);
+
   // delete a node's prefix database
   // return true if this has caused any change in routeDb
   bool deletePrefixDatabase(const std::string& nodeName);
@@ -143,6 +260,10 @@ class SpfSolver {
   std::unordered_map<std::string /* nodeName */, thrift::PrefixDatabase>
   getPrefixDatabases();
 
+  // get current snapshot of adjacency and prefix databases. Cheap, the
+  // snapshot is only copied on the next update while it is still referenced
+  std::shared_ptr<const SpfSolverSnapshot> getSnapshot();
+
   // Compute all routes from perspective of a given router.
   // Returns folly::none if myNodeName doesn't have any prefix database
   folly::Optional<thrift::RouteDatabase> buildPaths(
@@ -154,7 +275,31 @@ class SpfSolver {
   folly::Optional<thrift::RouteDatabase> buildRouteDb(
       const std::string& myNodeName);
 
-  bool decrementHolds();
+  // Same as buildPaths and buildRouteDb, but only the routes which changed
+  // since the previous call of any of the *Delta methods are returned. The
+  // routes returned so far are cached and each route is compared with the
+  // cached one as it is created. If only prefix advertisements changed in
+  // between, only routes of those prefixes are re-computed.
+  // Every returned delta must be published, only valid for this node.
+  // Returns folly::none if myNodeName doesn't have any adjacency database
+  folly::Optional<thrift::RouteDatabaseDelta> buildPathsDelta(
+      const std::string& myNodeName);
+  folly::Optional<thrift::RouteDatabaseDelta> buildRouteDbDelta(
+      const std::string& myNodeName);
+
+  // Replace the routes cached by the *Delta methods with the given ones, e.g.
+  // routes published before restart. The next delta is a full build which
+  // only returns the difference to them
+  void setRouteDbCache(thrift::RouteDatabase const& routeDb);
+
+  // Consistency check of the route cache behind the *Delta methods against a
+  // full route build. Returns the delta to bring routes in sync (empty if
+  // consistent), or folly::none if there are pending changes
+  folly::Optional<thrift::RouteDatabaseDelta> checkRouteDbCache(
+      const std::string& myNodeName);
+
+  // returns true if a hold expired, and link state changed
+  bool decrementHolds(uint64_t ticks = 1);
 
   std::unordered_map<std::string, int64_t> getCounters();
 
@@ -208,12 +353,58 @@ class Decision : public OpenrEventLoop {
       const KvStoreLocalPubUrl& storePubUrl,
       const DecisionPubUrl& decisionPubUrl,
       const MonitorSubmitUrl& monitorSubmitUrl,
-      fbzmq::Context& zmqContext);
-
-  virtual ~Decision() = default;
+      fbzmq::Context& zmqContext,
+      size_t lfaSpfThreads = 0,
+      bool enableAdaptiveDebounce = false,
+      bool enableComputeThread = false,
+      // persist published routes and restore them on graceful restart
+      folly::Optional<PersistentStoreUrl> configStoreUrl = folly::none,
+      size_t routeBuildThreads = 0,
+      // protocol of route deltas published to Fib on decisionPubUrl
+      BusSerializer::Protocol routeDeltaProtocol =
+          BusSerializer::Protocol::COMPACT,
+      // pool shared with other modules to run solver workers and compute
+      // thread on, see SpfSolver
+      std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor = nullptr,
+      // record processed publications to this file for offline replay
+      folly::Optional<std::string> publicationRecordFile = folly::none,
+      // see SpfSolver
+      bool useRadixHeapSpf = false,
+      bool useSpecializedSpf = false);
+
+  virtual ~Decision();
 
   std::unordered_map<std::string, int64_t> getCounters();
 
+  // snapshot of link state databases as of the last processed publication.
+  // Safe to call from any thread
+  std::shared_ptr<const SpfSolverSnapshot> getSolverSnapshot();
+
+  // Typed in-process access for ctrl-server, replies are handed over without
+  // serialization. Routes of this node are computed in Decision's event loop.
+  // Routes of other nodes are computed against the solver snapshot on a
+  // worker thread of idle scheduling priority, and cached per node until the
+  // next snapshot. Databases are copied from the solver snapshot on the
+  // calling thread
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getDecisionRouteDb(
+      std::string nodeName);
+  folly::SemiFuture<std::unique_ptr<thrift::AdjDbs>> getDecisionAdjacencyDbs();
+  folly::SemiFuture<std::unique_ptr<thrift::PrefixDbs>> getDecisionPrefixDbs();
+
+  /**
+   * Set callback invoked in Decision's event loop with every route delta
+   * published on decisionPubUrl, before it is serialized. It must not block.
+   * Unset with nullptr.
+   */
+  void setRouteDeltaCallback(
+      std::function<void(thrift::RouteDatabaseDelta const&)> callback);
+
+  /**
+   * Set callback invoked once in Decision's event loop when initial sync of
+   * link state with KvStore is done, right away if it is done already
+   */
+  void setInitialSyncCallback(std::function<void()> callback);
+
  private:
   Decision(Decision const&) = delete;
   Decision& operator=(Decision const&) = delete;
@@ -223,6 +414,23 @@ class Decision : public OpenrEventLoop {
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
       fbzmq::Message&& request) override;
 
+  // routes of given node, my own if nodeName is empty
+  thrift::RouteDatabase buildRouteDb(std::string nodeName);
+
+  // routes of another node as of the latest solver snapshot, served from
+  // routeDbQueryCache_ or computed by routeDbQuerySolver_. Only called on
+  // routeDbQueryExecutor_
+  thrift::RouteDatabase buildRouteDbQuery(std::string const& nodeName);
+
+  // bring routeDbQuerySolver_ from routeDbQuerySnapshot_ to snapshot. Only
+  // databases which aren't shared between the two snapshots are applied
+  void syncRouteDbQuerySolver(
+      std::shared_ptr<const SpfSolverSnapshot> snapshot);
+
+  // copy of link state databases from latest solver snapshot
+  thrift::AdjDbs dumpAdjacencyDbs();
+  thrift::PrefixDbs dumpPrefixDbs();
+
   // process publication from KvStore
   ProcessPublicationResult processPublication(
       thrift::Publication const& thriftPub);
@@ -252,6 +460,10 @@ class Decision : public OpenrEventLoop {
   std::unique_ptr<fbzmq::ZmqTimeout> processUpdatesTimer_;
   ExponentialBackoff<std::chrono::milliseconds> processUpdatesBackoff_;
 
+  // If set, bounds of processUpdatesBackoff_ are adjusted after every run
+  // based on the measured cost of processing updates
+  folly::Optional<detail::DecisionDebounce> adaptiveDebounce_;
+
   // store update to-do status
   ProcessPublicationResult processUpdatesStatus_;
 
@@ -273,12 +485,58 @@ class Decision : public OpenrEventLoop {
    */
   void processPendingPrefixUpdates();
 
-  void decrementOrderedFibHolds();
+  // Decrement ordered FIB holds by ticks of getMaxFib() each, and build
+  // routes once if any hold expired
+  void decrementOrderedFibHolds(uint64_t ticks = 1);
+
+  // Schedule orderedFibTimer_ to the tick at which the first hold expires.
+  // Ticks without expiry are skipped rather than decremented one by one
+  void scheduleOrderedFibTimer();
+
+  // Decrement holds by the ticks passed since orderedFibTickTime_, before
+  // holds are added
+  void catchUpOrderedFibHolds();
 
   void coldStartUpdate();
 
+  // Publish the routes persisted before restart, if still in graceful restart
+  void publishPersistedRouteDb();
+
+  // Write publishedRouteDb_ to the config store
+  void persistRouteDb();
+
+  // Seed spfSolver_ and computeSolver_ with routes published so far
+  void setSolverRouteDbCache(thrift::RouteDatabase const& routeDb);
+
+  // Full route build compared with the incrementally maintained routes.
+  // Publishes a correcting delta on mismatch
+  void checkRouteDbConsistency();
+
   void sendRouteUpdate(
-      thrift::RouteDatabase& db, std::string const& eventDescription);
+      thrift::RouteDatabaseDelta& routeDelta,
+      std::string const& eventDescription);
+
+  // Record durations between consecutive perf events of a route update and
+  // the time taken to serialize and publish it in phaseHistograms_
+  void recordPhaseDuration(
+      std::string const& name, std::chrono::milliseconds duration);
+  void recordPhaseDurations(thrift::PerfEvents const& perfEvents);
+
+  using SolverUpdate = std::function<void(SpfSolver&)>;
+  using RouteComputation =
+      std::function<folly::Optional<thrift::RouteDatabaseDelta>(SpfSolver&)>;
+  using RouteComputationCallback =
+      std::function<void(folly::Optional<thrift::RouteDatabaseDelta>)>;
+
+  // Record an update applied to spfSolver_ which must also be applied to
+  // computeSolver_ before its next computation. Only with compute thread
+  void recordSolverUpdate(SolverUpdate update);
+
+  // Run route computation on spfSolver_ inline or, with compute thread, on
+  // computeSolver_ after applying all recorded updates. Callback is always
+  // invoked in the Decision thread
+  void runRouteComputation(
+      RouteComputation computation, RouteComputationCallback callback);
 
   std::chrono::milliseconds getMaxFib();
 
@@ -292,6 +550,12 @@ class Decision : public OpenrEventLoop {
   thrift::PrefixDatabase updateNodePrefixDatabase(
       const std::string& key, const thrift::PrefixDatabase& prefixDb);
 
+  // Hand prefix databases modified by a publication to the solvers in one
+  // batch, instead of rebuilding a node's database for every prefix key.
+  // Returns true if routeDb has changed
+  bool applyPrefixDatabases(
+      std::unordered_map<std::string, thrift::PrefixDatabase>& prefixDbs);
+
   // this node's name and the key markers
   const std::string myNodeName_;
   // the prefix we use to find the adjacency database announcements
@@ -299,8 +563,6 @@ class Decision : public OpenrEventLoop {
   // the prefix we use to find the prefix db key announcements
   const std::string prefixDbMarker_;
 
-  thrift::RouteDatabase routeDb_;
-
   // URLs for the sockets
   const std::string storeCmdUrl_;
   const std::string storePubUrl_;
@@ -312,21 +574,49 @@ class Decision : public OpenrEventLoop {
   // the pointer to the SPF path calculator
   std::unique_ptr<SpfSolver> spfSolver_;
 
+  // latest snapshot of spfSolver_, published after every publication
+  folly::Synchronized<std::shared_ptr<const SpfSolverSnapshot>>
+      solverSnapshot_;
+
   // For orderedFib prgramming, we keep track of the fib programming times
   // across the network
   std::unordered_map<std::string, std::chrono::milliseconds> fibTimes_;
 
+  // Adjacency and prefix databases last processed, values re-advertised
+  // unchanged are neither deserialized nor processed again
+  KeyValueHashCache valueHashes_;
+  int64_t numUnchangedValuesSkipped_{0};
+
   apache::thrift::CompactSerializer serializer_;
 
+  // serializer of route deltas published on decisionPub_
+  BusSerializer routeDeltaSerializer_;
+
+  // in-process subscriber of published route deltas, e.g. a plugin
+  std::function<void(thrift::RouteDatabaseDelta const&)>
+      routeDeltaCallback_{nullptr};
+
+  // subscriber of initial sync, e.g. startup tracer in main
+  std::function<void()> initialSyncCallback_{nullptr};
+  bool initialSyncDone_{false};
+
   // base interval to submit to monitor with (jitter will be added)
   std::chrono::seconds monitorSyncInterval_{0};
 
   // Timer for submitting to monitor periodically
   std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_{nullptr};
 
+  // Timer for periodic route db consistency check
+  std::unique_ptr<fbzmq::ZmqTimeout> routeDbCheckTimer_{nullptr};
+
   // Timer for decrementing link holds for ordered fib programming
   std::unique_ptr<fbzmq::ZmqTimeout> orderedFibTimer_{nullptr};
 
+  // Start of the tick orderedFibTimer_ counts from, and number of ticks it
+  // is scheduled for
+  std::chrono::steady_clock::time_point orderedFibTickTime_;
+  uint64_t orderedFibTimerTicks_{1};
+
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
@@ -335,6 +625,62 @@ class Decision : public OpenrEventLoop {
       std::string,
       std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
       nodePrefixDatabase_{};
+
+  // node to prefix entries of each shard for nodes advertising prefix shards
+  std::unordered_map<
+      std::string,
+      std::unordered_map<int32_t, std::vector<thrift::PrefixEntry>>>
+      nodePrefixShards_{};
+
+  // Duration of the last finished route computation
+  std::chrono::milliseconds lastComputationCost_{0};
+
+  // With route persistence, all routes published so far and the throttled
+  // writer of them into the config store
+  std::unique_ptr<PersistentStoreClient> configStoreClient_;
+  folly::Optional<RouteDatabaseMap> publishedRouteDb_;
+  std::unique_ptr<fbzmq::ZmqThrottle> persistRouteDbThrottled_;
+
+  // Durations of route computation phases as traced by perf events, keyed
+  // by counter name
+  std::unordered_map<std::string, detail::DecisionPhaseHistogram>
+      phaseHistograms_;
+
+  // Recorder of processed publications, reset on first failure
+  std::unique_ptr<PublicationRecorder> publicationRecorder_;
+
+  // With compute thread, spfSolver_ only ingests updates and serves queries
+  // while routes are computed by computeSolver_ on computeExecutor_. It is
+  // brought up to date by replaying pendingSolverUpdates_ before every
+  // computation. Its counters are snapshotted after every computation
+  std::unique_ptr<SpfSolver> computeSolver_;
+  std::vector<SolverUpdate> pendingSolverUpdates_;
+  folly::Synchronized<std::unordered_map<std::string, int64_t>>
+      computeCounters_;
+
+  // serial queue of computations on shared executor, replacing
+  // computeExecutor_. Drained by destructor
+  folly::Executor::KeepAlive<folly::SerialExecutor> sharedComputeExecutor_;
+
+  // Routes of other nodes requested through getDecisionRouteDb, computed by
+  // routeDbQuerySolver_ as of routeDbQuerySnapshot_, which are only accessed
+  // on routeDbQueryExecutor_. Computed routes are cached for the snapshot
+  // version they were computed from
+  struct RouteDbQueryCache {
+    uint64_t version{0};
+    std::unordered_map<std::string /* nodeName */, thrift::RouteDatabase>
+        routeDbs;
+    int64_t numHits{0};
+    int64_t numMisses{0};
+  };
+  folly::Synchronized<RouteDbQueryCache> routeDbQueryCache_;
+  std::unique_ptr<SpfSolver> routeDbQuerySolver_;
+  std::shared_ptr<const SpfSolverSnapshot> routeDbQuerySnapshot_{
+      std::make_shared<SpfSolverSnapshot>()};
+  std::unique_ptr<folly::CPUThreadPoolExecutor> routeDbQueryExecutor_;
+
+  // must be last, joins pending computations before anything else is destroyed
+  std::unique_ptr<folly::CPUThreadPoolExecutor> computeExecutor_;
 };
 
 } // namespace openr
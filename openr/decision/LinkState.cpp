@@ -35,13 +35,24 @@ HoldableValue<T>::hasHold() const {
   return heldVal_.hasValue();
 }
 
+template <class T>
+LinkStateMetric
+HoldableValue<T>::getHoldTtl() const {
+  return heldVal_.hasValue() ? holdTtl_ : 0;
+}
+
 template <class T>
 bool
-HoldableValue<T>::decrementTtl() {
-  if (heldVal_ && 0 == --holdTtl_) {
+HoldableValue<T>::decrementTtl(LinkStateMetric ticks) {
+  if (not heldVal_) {
+    return false;
+  }
+  if (holdTtl_ <= ticks) {
+    holdTtl_ = 0;
     heldVal_.clear();
     return true;
   }
+  holdTtl_ -= ticks;
   return false;
 }
 
@@ -100,15 +111,52 @@ Link::Link(
       overload2_(adj2.isOverloaded),
       adjLabel1_(adj1.adjLabel),
       adjLabel2_(adj2.adjLabel),
-      nhV41_(adj1.nextHopV4),
-      nhV42_(adj2.nextHopV4),
-      nhV61_(adj1.nextHopV6),
-      nhV62_(adj2.nextHopV6),
-      orderedNames(
-          std::minmax(std::make_pair(n1_, if1_), std::make_pair(n2_, if2_))),
+      nhV41_(packAddress(adj1.nextHopV4)),
+      nhV42_(packAddress(adj2.nextHopV4)),
+      nhV61_(packAddress(adj1.nextHopV6)),
+      nhV62_(packAddress(adj2.nextHopV6)),
+      n1IsFirst_(std::tie(n1_, if1_) <= std::tie(n2_, if2_)),
       hash(std::hash<std::pair<
                std::pair<std::string, std::string>,
-               std::pair<std::string, std::string>>>()(orderedNames)) {}
+               std::pair<std::string, std::string>>>()(std::minmax(
+          std::make_pair(n1_, if1_), std::make_pair(n2_, if2_)))) {}
+
+bool
+Link::PackedAddress::operator==(const PackedAddress& other) const {
+  return size == other.size and bytes == other.bytes;
+}
+
+Link::PackedAddress
+Link::packAddress(const thrift::BinaryAddress& addr) {
+  PackedAddress packed;
+  if (addr.addr.size() > packed.bytes.size()) {
+    throw std::invalid_argument(folly::sformat(
+        "Next-hop address of {} bytes, at most {} supported",
+        addr.addr.size(),
+        packed.bytes.size()));
+  }
+  std::copy(addr.addr.begin(), addr.addr.end(), packed.bytes.begin());
+  packed.size = addr.addr.size();
+  return packed;
+}
+
+thrift::BinaryAddress
+Link::unpackAddress(const PackedAddress& addr) {
+  thrift::BinaryAddress result;
+  result.addr.append(
+      reinterpret_cast<const char*>(addr.bytes.data()), addr.size);
+  return result;
+}
+
+std::tuple<
+    const std::string&,
+    const std::string&,
+    const std::string&,
+    const std::string&>
+Link::orderedNames() const {
+  return n1IsFirst_ ? std::tie(n1_, if1_, n2_, if2_)
+                    : std::tie(n2_, if2_, n1_, if1_);
+}
 
 const std::string&
 Link::getOtherNodeName(const std::string& nodeName) const {
@@ -123,12 +171,12 @@ Link::getOtherNodeName(const std::string& nodeName) const {
 
 const std::string&
 Link::firstNodeName() const {
-  return orderedNames.first.first;
+  return n1IsFirst_ ? n1_ : n2_;
 }
 
 const std::string&
 Link::secondNodeName() const {
-  return orderedNames.second.first;
+  return n1IsFirst_ ? n2_ : n1_;
 }
 
 const std::string&
@@ -153,6 +201,16 @@ Link::getMetricFromNode(const std::string& nodeName) const {
   throw std::invalid_argument(nodeName);
 }
 
+LinkStateMetric
+Link::getMetricFromFirstNode() const {
+  return n1IsFirst_ ? metric1_.value() : metric2_.value();
+}
+
+LinkStateMetric
+Link::getMetricFromSecondNode() const {
+  return n1IsFirst_ ? metric2_.value() : metric1_.value();
+}
+
 int32_t
 Link::getAdjLabelFromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
@@ -186,15 +244,16 @@ Link::isUp() const {
 }
 
 bool
-Link::decrementHolds() {
+Link::decrementHolds(LinkStateMetric ticks) {
   bool holdExpired = false;
   if (0 != holdUpTtl_) {
-    holdExpired |= (0 == --holdUpTtl_);
+    holdExpired |= holdUpTtl_ <= ticks;
+    holdUpTtl_ -= std::min(holdUpTtl_, ticks);
   }
-  holdExpired |= metric1_.decrementTtl();
-  holdExpired |= metric2_.decrementTtl();
-  holdExpired |= overload1_.decrementTtl();
-  holdExpired |= overload2_.decrementTtl();
+  holdExpired |= metric1_.decrementTtl(ticks);
+  holdExpired |= metric2_.decrementTtl(ticks);
+  holdExpired |= overload1_.decrementTtl(ticks);
+  holdExpired |= overload2_.decrementTtl(ticks);
   return holdExpired;
 }
 
@@ -204,24 +263,40 @@ Link::hasHolds() const {
       overload1_.hasHold() || overload2_.hasHold();
 }
 
-const thrift::BinaryAddress&
+LinkStateMetric
+Link::getHoldTtl() const {
+  LinkStateMetric ttl = 0;
+  for (auto holdTtl :
+       {holdUpTtl_,
+        metric1_.getHoldTtl(),
+        metric2_.getHoldTtl(),
+        overload1_.getHoldTtl(),
+        overload2_.getHoldTtl()}) {
+    if (holdTtl != 0 and (ttl == 0 or holdTtl < ttl)) {
+      ttl = holdTtl;
+    }
+  }
+  return ttl;
+}
+
+thrift::BinaryAddress
 Link::getNhV4FromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
-    return nhV41_;
+    return unpackAddress(nhV41_);
   }
   if (n2_ == nodeName) {
-    return nhV42_;
+    return unpackAddress(nhV42_);
   }
   throw std::invalid_argument(nodeName);
 }
 
-const thrift::BinaryAddress&
+thrift::BinaryAddress
 Link::getNhV6FromNode(const std::string& nodeName) const {
   if (n1_ == nodeName) {
-    return nhV61_;
+    return unpackAddress(nhV61_);
   }
   if (n2_ == nodeName) {
-    return nhV62_;
+    return unpackAddress(nhV62_);
   }
   throw std::invalid_argument(nodeName);
 }
@@ -230,9 +305,9 @@ void
 Link::setNhV4FromNode(
     const std::string& nodeName, const thrift::BinaryAddress& nhV4) {
   if (n1_ == nodeName) {
-    nhV41_ = nhV4;
+    nhV41_ = packAddress(nhV4);
   } else if (n2_ == nodeName) {
-    nhV42_ = nhV4;
+    nhV42_ = packAddress(nhV4);
   } else {
     throw std::invalid_argument(nodeName);
   }
@@ -242,9 +317,9 @@ void
 Link::setNhV6FromNode(
     const std::string& nodeName, const thrift::BinaryAddress& nhV6) {
   if (n1_ == nodeName) {
-    nhV61_ = nhV6;
+    nhV61_ = packAddress(nhV6);
   } else if (n2_ == nodeName) {
-    nhV62_ = nhV6;
+    nhV62_ = packAddress(nhV6);
   } else {
     throw std::invalid_argument(nodeName);
   }
@@ -299,7 +374,7 @@ Link::operator<(const Link& other) const {
   if (this->hash != other.hash) {
     return this->hash < other.hash;
   }
-  return this->orderedNames < other.orderedNames;
+  return this->orderedNames() < other.orderedNames();
 }
 
 bool
@@ -307,7 +382,7 @@ Link::operator==(const Link& other) const {
   if (this->hash != other.hash) {
     return false;
   }
-  return this->orderedNames == other.orderedNames;
+  return this->orderedNames() == other.orderedNames();
 }
 
 std::string
@@ -325,7 +400,7 @@ Link::directionalToString(const std::string& fromNode) const {
       getIfaceFromNode(getOtherNodeName(fromNode)));
 }
 
-bool
+size_t
 LinkState::LinkPtrHash::operator()(const std::shared_ptr<Link>& l) const {
   return l->hash;
 }
@@ -344,9 +419,12 @@ LinkState::LinkPtrEqual::operator()(
 
 void
 LinkState::addLink(std::shared_ptr<Link> link) {
+  internNodeName(link->firstNodeName());
+  internNodeName(link->secondNodeName());
   CHECK(linkMap_[link->firstNodeName()].insert(link).second);
   CHECK(linkMap_[link->secondNodeName()].insert(link).second);
   CHECK(allLinks_.insert(link).second);
+  csrGraphValid_ = false;
 }
 
 // throws std::out_of_range if links are not present
@@ -355,6 +433,7 @@ LinkState::removeLink(std::shared_ptr<Link> link) {
   CHECK(linkMap_.at(link->firstNodeName()).erase(link));
   CHECK(linkMap_.at(link->secondNodeName()).erase(link));
   CHECK(allLinks_.erase(link));
+  csrGraphValid_ = false;
 }
 
 void
@@ -376,6 +455,7 @@ LinkState::removeNode(const std::string& nodeName) {
   }
   linkMap_.erase(search);
   nodeOverloads_.erase(nodeName);
+  csrGraphValid_ = false;
 }
 
 const LinkState::LinkSet&
@@ -422,17 +502,131 @@ LinkState::isNodeOverloaded(const std::string& nodeName) const {
 }
 
 bool
-LinkState::decrementHolds() {
+LinkState::hasOverloadedNodes() const {
+  return std::any_of(
+      nodeOverloads_.begin(), nodeOverloads_.end(), [](const auto& kv) {
+        return kv.second.value();
+      });
+}
+
+bool
+LinkState::decrementHolds(LinkStateMetric ticks) {
   bool holdChange = false;
   for (auto& link : allLinks_) {
-    holdChange |= link->decrementHolds();
+    holdChange |= link->decrementHolds(ticks);
   }
   for (auto& kv : nodeOverloads_) {
-    holdChange |= kv.second.decrementTtl();
+    holdChange |= kv.second.decrementTtl(ticks);
   }
   return holdChange;
 }
 
+LinkStateMetric
+LinkState::getHoldTtl() const {
+  LinkStateMetric ttl = 0;
+  auto const addHoldTtl = [&ttl](LinkStateMetric holdTtl) {
+    if (holdTtl != 0 and (ttl == 0 or holdTtl < ttl)) {
+      ttl = holdTtl;
+    }
+  };
+  for (auto const& link : allLinks_) {
+    addHoldTtl(link->getHoldTtl());
+  }
+  for (auto const& kv : nodeOverloads_) {
+    addHoldTtl(kv.second.getHoldTtl());
+  }
+  return ttl;
+}
+
+size_t
+LinkState::getNumHolds() const {
+  size_t numHolds = 0;
+  for (auto const& link : allLinks_) {
+    numHolds += link->hasHolds();
+  }
+  for (auto const& kv : nodeOverloads_) {
+    numHolds += kv.second.hasHold();
+  }
+  return numHolds;
+}
+
+std::vector<std::shared_ptr<Link>>
+LinkState::getLinksWithExpiringHolds(LinkStateMetric ticks) const {
+  std::vector<std::shared_ptr<Link>> links;
+  for (auto const& link : allLinks_) {
+    auto const holdTtl = link->getHoldTtl();
+    if (holdTtl != 0 and holdTtl <= ticks) {
+      links.emplace_back(link);
+    }
+  }
+  return links;
+}
+
+std::vector<std::string>
+LinkState::getNodesWithExpiringHolds(LinkStateMetric ticks) const {
+  std::vector<std::string> nodeNames;
+  for (auto const& kv : nodeOverloads_) {
+    auto const holdTtl = kv.second.getHoldTtl();
+    if (holdTtl != 0 and holdTtl <= ticks) {
+      nodeNames.emplace_back(kv.first);
+    }
+  }
+  return nodeNames;
+}
+
+LinkState::NodeId
+LinkState::internNodeName(const std::string& nodeName) {
+  auto res = nodeIds_.emplace(nodeName, nodeNames_.size());
+  if (res.second) {
+    nodeNames_.emplace_back(nodeName);
+  }
+  return res.first->second;
+}
+
+folly::Optional<LinkState::NodeId>
+LinkState::getNodeId(const std::string& nodeName) const {
+  auto search = nodeIds_.find(nodeName);
+  if (search == nodeIds_.end()) {
+    return folly::none;
+  }
+  return search->second;
+}
+
+const std::string&
+LinkState::getNodeName(NodeId nodeId) const {
+  return nodeNames_.at(nodeId);
+}
+
+const LinkState::CsrGraph&
+LinkState::getCsrGraph() const {
+  if (csrGraphValid_) {
+    return csrGraph_;
+  }
+
+  csrGraph_.offsets.assign(nodeNames_.size() + 1, 0);
+  csrGraph_.edges.clear();
+  csrGraph_.edges.reserve(allLinks_.size() * 2);
+  for (NodeId nodeId = 0; nodeId < nodeNames_.size(); ++nodeId) {
+    csrGraph_.offsets[nodeId] = csrGraph_.edges.size();
+    auto const& nodeName = nodeNames_[nodeId];
+    auto search = linkMap_.find(nodeName);
+    if (search == linkMap_.end()) {
+      continue;
+    }
+    for (auto const& link : search->second) {
+      CsrEdge edge;
+      edge.fromFirstNode = link->firstNodeName() == nodeName;
+      edge.otherNodeId = nodeIds_.at(
+          edge.fromFirstNode ? link->secondNodeName() : link->firstNodeName());
+      edge.link = link;
+      csrGraph_.edges.emplace_back(std::move(edge));
+    }
+  }
+  csrGraph_.offsets[nodeNames_.size()] = csrGraph_.edges.size();
+  csrGraphValid_ = true;
+  return csrGraph_;
+}
+
 bool
 LinkState::hasHolds() const {
   for (auto& link : allLinks_) {
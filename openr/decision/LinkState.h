@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <folly/Optional.h>
+
 #include <openr/if/gen-cpp2/Lsdb_types.h>
 #include <openr/if/gen-cpp2/Network_types.h>
 
@@ -30,7 +34,8 @@ using LinkStateMetric = uint64_t;
 // being clearted, thus changeing value().
 //
 // value() will return the held value until decrementTtl() returns true and the
-// held value is cleared.
+// held value is cleared. Ttls count ticks of the ordered FIB timer, which
+// may decrement several ticks at once when no hold expires in between.
 
 template <class T>
 class HoldableValue {
@@ -41,8 +46,11 @@ class HoldableValue {
 
   bool hasHold() const;
 
+  // ticks until hold expires, 0 if there is no hold
+  LinkStateMetric getHoldTtl() const;
+
   // these methods return true if the call results in the value changing
-  bool decrementTtl();
+  bool decrementTtl(LinkStateMetric ticks = 1);
   bool updateValue(
       T val, LinkStateMetric holdUpTtl, LinkStateMetric holdDownTtl);
 
@@ -82,17 +90,37 @@ class Link {
       const openr::thrift::Adjacency& adj2);
 
  private:
+  // Raw bytes of a thrift::BinaryAddress stored inline. ifName of next-hop
+  // addresses is not kept, next-hops are always created with the link's
+  // interface name
+  struct PackedAddress {
+    std::array<uint8_t, 16> bytes{};
+    uint8_t size{0};
+
+    bool operator==(const PackedAddress& other) const;
+  };
+
+  static PackedAddress packAddress(const thrift::BinaryAddress& addr);
+  static thrift::BinaryAddress unpackAddress(const PackedAddress& addr);
+
+  // <nodeName, ifName> of first and second end, the essential property of the
+  // link used for ordering and equality. Refers to n1_, if1_, n2_, if2_
+  std::tuple<
+      const std::string&,
+      const std::string&,
+      const std::string&,
+      const std::string&>
+  orderedNames() const;
+
   const std::string n1_, n2_, if1_, if2_;
   HoldableValue<LinkStateMetric> metric1_{1}, metric2_{1};
   HoldableValue<bool> overload1_{false}, overload2_{false};
   int32_t adjLabel1_{0}, adjLabel2_{0};
-  thrift::BinaryAddress nhV41_, nhV42_, nhV61_, nhV62_;
+  PackedAddress nhV41_, nhV42_, nhV61_, nhV62_;
   LinkStateMetric holdUpTtl_{0};
 
-  const std::pair<
-      std::pair<std::string, std::string>,
-      std::pair<std::string, std::string>>
-      orderedNames;
+  // true if nodeName1 (n1_) is the firstNodeName() of this link
+  const bool n1IsFirst_{true};
 
  public:
   const size_t hash{0};
@@ -101,10 +129,13 @@ class Link {
 
   bool isUp() const;
 
-  bool decrementHolds();
+  bool decrementHolds(LinkStateMetric ticks = 1);
 
   bool hasHolds() const;
 
+  // ticks until first hold of link expires, 0 if there is no hold
+  LinkStateMetric getHoldTtl() const;
+
   const std::string& getOtherNodeName(const std::string& nodeName) const;
 
   const std::string& firstNodeName() const;
@@ -115,15 +146,19 @@ class Link {
 
   LinkStateMetric getMetricFromNode(const std::string& nodeName) const;
 
+  // same as getMetricFromNode(firstNodeName()) and
+  // getMetricFromNode(secondNodeName()) without any string comparisons
+  LinkStateMetric getMetricFromFirstNode() const;
+
+  LinkStateMetric getMetricFromSecondNode() const;
+
   int32_t getAdjLabelFromNode(const std::string& nodeName) const;
 
   bool getOverloadFromNode(const std::string& nodeName) const;
 
-  const thrift::BinaryAddress& getNhV4FromNode(
-      const std::string& nodeName) const;
+  thrift::BinaryAddress getNhV4FromNode(const std::string& nodeName) const;
 
-  const thrift::BinaryAddress& getNhV6FromNode(
-      const std::string& nodeName) const;
+  thrift::BinaryAddress getNhV6FromNode(const std::string& nodeName) const;
 
   void setNhV4FromNode(
       const std::string& nodeName, const thrift::BinaryAddress& nhV4);
@@ -157,7 +192,7 @@ class Link {
 class LinkState {
  public:
   struct LinkPtrHash {
-    bool operator()(const std::shared_ptr<Link>& l) const;
+    size_t operator()(const std::shared_ptr<Link>& l) const;
   };
 
   struct LinkPtrLess {
@@ -175,6 +210,39 @@ class LinkState {
   using LinkSet =
       std::unordered_set<std::shared_ptr<Link>, LinkPtrHash, LinkPtrEqual>;
 
+  // Dense integer id of a node, see getNodeId()
+  using NodeId = uint32_t;
+
+  // Link as seen from one of its ends in CsrGraph
+  struct CsrEdge {
+    NodeId otherNodeId{0};
+    // true if the link is traversed from its firstNodeName()
+    bool fromFirstNode{true};
+    std::shared_ptr<Link> link;
+
+    LinkStateMetric
+    getMetric() const {
+      return fromFirstNode ? link->getMetricFromFirstNode()
+                           : link->getMetricFromSecondNode();
+    }
+
+    // metric in the reverse direction, i.e. from otherNodeId
+    LinkStateMetric
+    getReverseMetric() const {
+      return fromFirstNode ? link->getMetricFromSecondNode()
+                           : link->getMetricFromFirstNode();
+    }
+  };
+
+  // Compressed sparse row representation of the topology over node ids.
+  // Links of node `id` are edges[offsets[id], offsets[id + 1]). Only the set
+  // of links is captured, link attributes (metric, overload) are read live
+  // from the Link objects
+  struct CsrGraph {
+    std::vector<size_t> offsets;
+    std::vector<CsrEdge> edges;
+  };
+
   void addLink(std::shared_ptr<Link> link);
 
   void removeLink(std::shared_ptr<Link> link);
@@ -194,11 +262,44 @@ class LinkState {
 
   bool isNodeOverloaded(const std::string& nodeName) const;
 
-  bool decrementHolds();
+  // true if isNodeOverloaded() of any node
+  bool hasOverloadedNodes() const;
+
+  bool decrementHolds(LinkStateMetric ticks = 1);
 
   bool hasHolds() const;
 
+  // ticks until first hold expires, 0 if there is no hold. Holds expiring at
+  // the same tick are expired by the same decrementHolds()
+  LinkStateMetric getHoldTtl() const;
+
+  // number of links and nodes with holds
+  size_t getNumHolds() const;
+
+  // links and nodes whose holds expire within ticks, before they do
+  std::vector<std::shared_ptr<Link>> getLinksWithExpiringHolds(
+      LinkStateMetric ticks) const;
+  std::vector<std::string> getNodesWithExpiringHolds(
+      LinkStateMetric ticks) const;
+
+  // Node names are interned into dense ids when their first link is added.
+  // Ids are stable and never re-used during the lifetime of LinkState
+  folly::Optional<NodeId> getNodeId(const std::string& nodeName) const;
+
+  const std::string& getNodeName(NodeId nodeId) const;
+
+  // number of node ids handed out so far, an upper bound to all ids
+  size_t
+  getNumNodeIds() const {
+    return nodeNames_.size();
+  }
+
+  // Rebuilt lazily on first access after a link is added or removed
+  const CsrGraph& getCsrGraph() const;
+
  private:
+  NodeId internNodeName(const std::string& nodeName);
+
   // this stores the same link object accessible from either nodeName
   std::unordered_map<std::string /* nodeName */, LinkSet> linkMap_;
 
@@ -208,6 +309,14 @@ class LinkState {
   std::unordered_map<std::string /* nodeName */, HoldableValue<bool>>
       nodeOverloads_;
 
+  // node name interning
+  std::unordered_map<std::string /* nodeName */, NodeId> nodeIds_;
+  std::vector<std::string> nodeNames_;
+
+  // cached CSR view of linkMap_
+  mutable CsrGraph csrGraph_;
+  mutable bool csrGraphValid_{false};
+
 }; // class LinkState
 } // namespace openr
 
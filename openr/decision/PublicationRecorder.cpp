@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PublicationRecorder.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+
+#include <chrono>
+#include <cstring>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/String.h>
+#include <glog/logging.h>
+
+namespace openr {
+
+PublicationRecorder::PublicationRecorder(std::string filePath)
+    : filePath_(std::move(filePath)) {
+  fd_ = folly::openNoInt(
+      filePath_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (fd_ == -1) {
+    LOG(ERROR) << "Failed to open publication record file '" << filePath_
+               << "'. Error (" << errno << "): " << folly::errnoStr(errno);
+    return;
+  }
+  LOG(INFO) << "Recording publications to '" << filePath_ << "'";
+}
+
+PublicationRecorder::~PublicationRecorder() {
+  if (fd_ != -1) {
+    folly::closeNoInt(fd_);
+  }
+}
+
+folly::Expected<folly::Unit, std::string>
+PublicationRecorder::record(const thrift::Publication& publication) noexcept {
+  if (fd_ == -1) {
+    return folly::makeUnexpected<std::string>(
+        "Record file '" + filePath_ + "' is not open");
+  }
+
+  thrift::PublicationRecord record;
+  record.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+  record.publication = publication;
+
+  std::string data;
+  try {
+    data = fbzmq::util::writeThriftObjStr(record, serializer_);
+  } catch (std::exception const& e) {
+    return folly::makeUnexpected<std::string>(
+        folly::exceptionStr(e).toStdString());
+  }
+  const uint32_t size = htonl(static_cast<uint32_t>(data.size()));
+  data.insert(0, reinterpret_cast<const char*>(&size), sizeof(size));
+
+  // Single write keeps records whole, unless disk is full
+  if (folly::writeFull(fd_, data.data(), data.size()) == -1) {
+    return folly::makeUnexpected<std::string>(folly::sformat(
+        "Failed to write to '{}'. Error ({}): {}",
+        filePath_,
+        errno,
+        folly::errnoStr(errno)));
+  }
+  return folly::Unit();
+}
+
+folly::Expected<std::vector<thrift::PublicationRecord>, std::string>
+PublicationRecorder::readRecords(const std::string& filePath) noexcept {
+  std::string fileData;
+  if (not folly::readFile(filePath.c_str(), fileData)) {
+    return folly::makeUnexpected<std::string>(folly::sformat(
+        "Failed to read '{}'. Error ({}): {}",
+        filePath,
+        errno,
+        folly::errnoStr(errno)));
+  }
+
+  apache::thrift::CompactSerializer serializer;
+  std::vector<thrift::PublicationRecord> records;
+  size_t offset{0};
+  while (offset + sizeof(uint32_t) <= fileData.size()) {
+    uint32_t size{0};
+    std::memcpy(&size, fileData.data() + offset, sizeof(size));
+    size = ntohl(size);
+    offset += sizeof(size);
+    if (offset + size > fileData.size()) {
+      LOG(WARNING) << "Ignoring truncated last record of '" << filePath << "'";
+      break;
+    }
+    try {
+      records.emplace_back(
+          fbzmq::util::readThriftObjStr<thrift::PublicationRecord>(
+              fileData.substr(offset, size), serializer));
+    } catch (std::exception const& e) {
+      return folly::makeUnexpected<std::string>(folly::sformat(
+          "Failed to parse record {} of '{}': {}",
+          records.size(),
+          filePath,
+          folly::exceptionStr(e)));
+    }
+    offset += size;
+  }
+  return records;
+}
+
+} // namespace openr
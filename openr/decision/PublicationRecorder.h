@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <folly/Expected.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/if/gen-cpp2/Decision_types.h>
+#include <openr/if/gen-cpp2/KvStore_types.h>
+
+namespace openr {
+
+/**
+ * Records KvStore publications as processed by Decision to a file, for
+ * offline replay into SpfSolver (see decision/tools/DecisionReplay.cpp).
+ *
+ * Each record is a compact serialized thrift::PublicationRecord prefixed with
+ * its size as 32 bit integer in network byte order. Records are appended
+ * without fsync, last ones may be lost on crash of the process.
+ */
+class PublicationRecorder {
+ public:
+  // File is truncated. Recording fails if it can't be opened
+  explicit PublicationRecorder(std::string filePath);
+  ~PublicationRecorder();
+
+  // Append publication with current time
+  folly::Expected<folly::Unit, std::string> record(
+      const thrift::Publication& publication) noexcept;
+
+  // All complete records of file, in order of recording
+  static folly::Expected<std::vector<thrift::PublicationRecord>, std::string>
+  readRecords(const std::string& filePath) noexcept;
+
+ private:
+  // No-copy
+  PublicationRecorder(const PublicationRecorder&) = delete;
+  PublicationRecorder& operator=(const PublicationRecorder&) = delete;
+
+  const std::string filePath_;
+  int fd_{-1};
+  apache::thrift::CompactSerializer serializer_;
+};
+
+} // namespace openr
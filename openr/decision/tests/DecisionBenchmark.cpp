@@ -12,6 +12,10 @@
 #include <folly/Random.h>
 #include <folly/futures/Promise.h>
 #include <folly/init/Init.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include <sys/resource.h>
+#include <functional>
 #include <memory>
 
 #include <openr/common/Constants.h>
@@ -86,7 +90,10 @@ createAdjDb(
 //
 class DecisionWrapper : public OpenrModuleTestBase {
  public:
-  explicit DecisionWrapper(const std::string& nodeName) {
+  explicit DecisionWrapper(
+      const std::string& nodeName,
+      bool useRadixHeapSpf = false,
+      bool useSpecializedSpf = false) {
     kvStorePub.bind(fbzmq::SocketUrl{"inproc://kvStore-pub"});
     kvStoreRep.bind(fbzmq::SocketUrl{"inproc://kvStore-rep"});
 
@@ -105,7 +112,17 @@ class DecisionWrapper : public OpenrModuleTestBase {
         KvStoreLocalPubUrl{"inproc://kvStore-pub"},
         DecisionPubUrl{"inproc://decision-pub"},
         MonitorSubmitUrl{"inproc://monitor-rep"},
-        zeromqContext);
+        zeromqContext,
+        0, /* lfaSpfThreads */
+        false, /* enableAdaptiveDebounce */
+        false, /* enableComputeThread */
+        folly::none, /* configStoreUrl */
+        0, /* routeBuildThreads */
+        BusSerializer::Protocol::COMPACT,
+        nullptr, /* sharedExecutor */
+        folly::none, /* publicationRecordFile */
+        useRadixHeapSpf,
+        useSpecializedSpf);
 
     decisionThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Decision thread starting";
@@ -158,6 +175,7 @@ class DecisionWrapper : public OpenrModuleTestBase {
     auto maybeRouteDb =
         decisionPub.recvThriftObj<thrift::RouteDatabaseDelta>(serializer);
     auto routeDb = maybeRouteDb.value();
+    expandNextHopGroups(routeDb);
     return routeDb;
   }
 
@@ -724,6 +742,24 @@ updateRandomGridAdjs(
       decisionWrapper, newPub, nodeName, adjs, processTimes, overloadBit);
 }
 
+// Peak resident set size of the process so far, in KB
+int64_t
+getPeakRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// Bytes allocated by this thread so far. Only tracked with jemalloc
+uint64_t
+getThreadAllocatedBytes() {
+  uint64_t allocated = 0;
+  if (folly::usingJEMalloc()) {
+    folly::mallctlRead("thread.allocated", &allocated);
+  }
+  return allocated;
+}
+
 //
 // Get average processTimes and insert as user counters.
 //
@@ -740,6 +776,130 @@ insertUserCounters(
   // Add customized counters to state.
   counters["adj_receive"] = processTimes[0];
   counters["spf"] = processTimes[2];
+  counters["peak_rss_kb"] = getPeakRssKb();
+}
+
+//
+// Following build SpfSolver state directly and measure route computation on
+// the benchmark thread, without ZMQ and Decision event loop overheads
+//
+
+// Create prefix database of a node with numOfPrefixes unique prefixes
+thrift::PrefixDatabase
+createNodePrefixDb(
+    const std::string& nodeName, uint32_t nodeId, uint32_t numOfPrefixes) {
+  std::vector<thrift::PrefixEntry> prefixEntries;
+  for (uint32_t i = 0; i < numOfPrefixes; ++i) {
+    prefixEntries.emplace_back(createPrefixEntry(toIpPrefix(folly::sformat(
+        "fc00:{}:{}::{}/128",
+        toHex(nodeId >> 16),
+        toHex(nodeId & 0xffff),
+        toHex(i)))));
+  }
+  return createPrefixDb(nodeName, prefixEntries);
+}
+
+// Load grid topology of n by n nodes, each advertising numOfPrefixes
+void
+loadGrid(SpfSolver& spfSolver, const int n, uint32_t numOfPrefixes) {
+  for (auto row = 0; row < n; ++row) {
+    for (auto col = 0; col < n; ++col) {
+      auto nodeId = row * n + col;
+      auto nodeName = folly::sformat("{}", nodeId);
+      spfSolver.updateAdjacencyDatabase(
+          createAdjDb(nodeName, createGridAdjacencys(row, col, n), nodeId + 1));
+      spfSolver.updatePrefixDatabase(
+          createNodePrefixDb(nodeName, nodeId, numOfPrefixes));
+    }
+  }
+}
+
+// Adjacencies of rsw towards all fsws of its pod
+std::vector<thrift::Adjacency>
+createRswAdjacencies(const std::string& nodeName, const int podId) {
+  std::vector<thrift::Adjacency> adjs;
+  for (auto fswId = 0; fswId < kNumOfFswsPerPod; fswId++) {
+    createFabricAdjacency(nodeName, kFswMarker, podId, fswId, adjs);
+  }
+  return adjs;
+}
+
+// Load fabric topology, each rsw advertising numOfPrefixesPerRsw
+void
+loadFabric(
+    SpfSolver& spfSolver,
+    const int numOfPods,
+    const int numOfPlanes,
+    uint32_t numOfPrefixesPerRsw) {
+  uint32_t nodeLabel = 1;
+  // ssw: each ssw connects to one fsw of each pod
+  for (auto planeId = 0; planeId < numOfPlanes; planeId++) {
+    for (auto sswId = 0; sswId < kNumOfSswsPerPlane; sswId++) {
+      auto nodeName = getNodeName(kSswMarker, planeId, sswId);
+      std::vector<thrift::Adjacency> adjs;
+      for (auto podId = 0; podId < numOfPods; podId++) {
+        createFabricAdjacency(nodeName, kFswMarker, podId, planeId, adjs);
+      }
+      spfSolver.updateAdjacencyDatabase(
+          createAdjDb(nodeName, adjs, nodeLabel++));
+    }
+  }
+
+  for (auto podId = 0; podId < numOfPods; podId++) {
+    // fsw: connects to all ssws within its plane and all rsws within its pod
+    for (auto fswId = 0; fswId < kNumOfFswsPerPod; fswId++) {
+      auto nodeName = getNodeName(kFswMarker, podId, fswId);
+      std::vector<thrift::Adjacency> adjs;
+      for (auto sswId = 0; sswId < kNumOfSswsPerPlane; sswId++) {
+        createFabricAdjacency(nodeName, kSswMarker, fswId, sswId, adjs);
+      }
+      for (auto rswId = 0; rswId < kNumOfRswsPerPod; rswId++) {
+        createFabricAdjacency(nodeName, kRswMarker, podId, rswId, adjs);
+      }
+      spfSolver.updateAdjacencyDatabase(
+          createAdjDb(nodeName, adjs, nodeLabel++));
+    }
+
+    // rsw: connects to all fsws within its pod
+    for (auto rswId = 0; rswId < kNumOfRswsPerPod; rswId++) {
+      auto nodeName = getNodeName(kRswMarker, podId, rswId);
+      spfSolver.updateAdjacencyDatabase(createAdjDb(
+          nodeName, createRswAdjacencies(nodeName, podId), nodeLabel++));
+      spfSolver.updatePrefixDatabase(createNodePrefixDb(
+          nodeName, getId(kRswMarker, podId, rswId), numOfPrefixesPerRsw));
+    }
+  }
+}
+
+//
+// Apply the updates alternately (e.g. fail and restore) and compute routes
+// after every update. Records average allocations per iteration and peak RSS
+//
+void
+runSolverIterations(
+    folly::UserCounters& counters,
+    folly::BenchmarkSuspender& suspender,
+    uint32_t iters,
+    SpfSolver& spfSolver,
+    const std::string& myNodeName,
+    const std::vector<std::function<void(SpfSolver&)>>& updates,
+    bool prefixOnly) {
+  // initial full computation is not measured
+  CHECK(spfSolver.buildPathsDelta(myNodeName).hasValue());
+
+  const auto allocatedBefore = getThreadAllocatedBytes();
+  suspender.dismiss(); // Start measuring benchmark time
+  for (uint32_t i = 0; i < iters; i++) {
+    updates.at(i % updates.size())(spfSolver);
+    auto routeDelta = prefixOnly ? spfSolver.buildRouteDbDelta(myNodeName)
+                                 : spfSolver.buildPathsDelta(myNodeName);
+    folly::doNotOptimizeAway(routeDelta);
+  }
+  suspender.rehire(); // Stop measuring time again
+
+  const auto allocated = getThreadAllocatedBytes() - allocatedBefore;
+  counters["alloc_kb"] = allocated / (iters == 0 ? 1 : iters) / 1024;
+  counters["peak_rss_kb"] = getPeakRssKb();
 }
 
 //
@@ -789,10 +949,15 @@ BM_DecisionGrid(
 //
 static void
 BM_DecisionFabric(
-    folly::UserCounters& counters, uint32_t iters, uint32_t numOfSws) {
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    bool useRadixHeapSpf = false,
+    bool useSpecializedSpf = false) {
   auto suspender = folly::BenchmarkSuspender();
   const std::string nodeName = folly::sformat("{}-{}", kFswMarker, "0-0");
-  auto decisionWrapper = std::make_shared<DecisionWrapper>(nodeName);
+  auto decisionWrapper = std::make_shared<DecisionWrapper>(
+      nodeName, useRadixHeapSpf, useSpecializedSpf);
   const int numOfFswsPerPod = kNumOfFswsPerPod;
   const int numOfRswsPerPod = kNumOfRswsPerPod;
   const int numOfSswsPerPlane = kNumOfSswsPerPlane;
@@ -852,6 +1017,230 @@ BM_DecisionFabric(
   insertUserCounters(counters, iters, processTimes);
 }
 
+//
+// Benchmark single link flap in the middle of grid topology
+//
+static void
+BM_SpfSolverGridLinkFlap(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    bool computeLfaPaths) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string myNodeName{"0"};
+  SpfSolver spfSolver(myNodeName, false, computeLfaPaths);
+  const int n = std::sqrt(numOfSws);
+  loadGrid(spfSolver, n, 1);
+
+  const int row = n / 2, col = n / 2;
+  const auto nodeName = folly::sformat("{}", row * n + col);
+  const auto adjs = createGridAdjacencys(row, col, n);
+  auto flappedAdjs = adjs;
+  flappedAdjs.pop_back();
+  const auto nodeLabel = row * n + col + 1;
+  runSolverIterations(
+      counters,
+      suspender,
+      iters,
+      spfSolver,
+      myNodeName,
+      {[&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(
+             createAdjDb(nodeName, flappedAdjs, nodeLabel));
+       },
+       [&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(createAdjDb(nodeName, adjs, nodeLabel));
+       }},
+      false /* prefixOnly */);
+}
+
+//
+// Benchmark overload toggle of a node in the middle of grid topology
+//
+static void
+BM_SpfSolverGridOverload(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    bool computeLfaPaths) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string myNodeName{"0"};
+  SpfSolver spfSolver(myNodeName, false, computeLfaPaths);
+  const int n = std::sqrt(numOfSws);
+  loadGrid(spfSolver, n, 1);
+
+  const int row = n / 2, col = n / 2;
+  const auto nodeName = folly::sformat("{}", row * n + col);
+  const auto adjs = createGridAdjacencys(row, col, n);
+  const auto nodeLabel = row * n + col + 1;
+  runSolverIterations(
+      counters,
+      suspender,
+      iters,
+      spfSolver,
+      myNodeName,
+      {[&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(
+             createAdjDb(nodeName, adjs, nodeLabel, true /* overload */));
+       },
+       [&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(createAdjDb(nodeName, adjs, nodeLabel));
+       }},
+      false /* prefixOnly */);
+}
+
+//
+// Benchmark single prefix advertisement and withdrawal in grid topology
+//
+static void
+BM_SpfSolverGridPrefixChange(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfSws,
+    bool computeLfaPaths) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string myNodeName{"0"};
+  SpfSolver spfSolver(myNodeName, false, computeLfaPaths);
+  const int n = std::sqrt(numOfSws);
+  loadGrid(spfSolver, n, 1);
+
+  const uint32_t nodeId = (n / 2) * n + n / 2;
+  const auto nodeName = folly::sformat("{}", nodeId);
+  const auto prefixDb = createNodePrefixDb(nodeName, nodeId, 1);
+  const auto updatedPrefixDb = createNodePrefixDb(nodeName, nodeId, 2);
+  runSolverIterations(
+      counters,
+      suspender,
+      iters,
+      spfSolver,
+      myNodeName,
+      {[&](SpfSolver& solver) { solver.updatePrefixDatabase(updatedPrefixDb); },
+       [&](SpfSolver& solver) { solver.updatePrefixDatabase(prefixDb); }},
+      true /* prefixOnly */);
+}
+
+//
+// Benchmark rsw overload toggle and single prefix change in fabric topology
+// with numOfPrefixes advertised by all rsws in total
+//
+static void
+BM_SpfSolverFabricPrefixes(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfPrefixes,
+    bool prefixOnly) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string myNodeName = getNodeName(kFswMarker, 0, 0);
+  SpfSolver spfSolver(myNodeName, false, false /* computeLfaPaths */);
+  const int numOfPods = 8;
+  const int numOfRsws = numOfPods * kNumOfRswsPerPod;
+  const int numOfPrefixesPerRsw =
+      std::max(1, static_cast<int>(numOfPrefixes) / numOfRsws);
+  loadFabric(
+      spfSolver,
+      numOfPods,
+      kNumOfFswsPerPod /* numOfPlanes */,
+      numOfPrefixesPerRsw);
+
+  // last rsw of the last pod
+  const int podId = numOfPods - 1, rswId = kNumOfRswsPerPod - 1;
+  const auto nodeName = getNodeName(kRswMarker, podId, rswId);
+  const auto adjs = createRswAdjacencies(nodeName, podId);
+  const auto nodeId = getId(kRswMarker, podId, rswId);
+  const auto prefixDb =
+      createNodePrefixDb(nodeName, nodeId, numOfPrefixesPerRsw);
+  auto updatedPrefixDb = prefixDb;
+  updatedPrefixDb.prefixEntries.pop_back();
+  // node labels are assigned sequentially, last rsw has the highest one
+  const int32_t nodeLabel = numOfRsws + kNumOfFswsPerPod * numOfPods +
+      kNumOfFswsPerPod * kNumOfSswsPerPlane;
+
+  std::vector<std::function<void(SpfSolver&)>> updates;
+  if (prefixOnly) {
+    updates = {[&](SpfSolver& solver) {
+                 solver.updatePrefixDatabase(updatedPrefixDb);
+               },
+               [&](SpfSolver& solver) {
+                 solver.updatePrefixDatabase(prefixDb);
+               }};
+  } else {
+    updates = {
+        [&](SpfSolver& solver) {
+          solver.updateAdjacencyDatabase(
+              createAdjDb(nodeName, adjs, nodeLabel, true /* overload */));
+        },
+        [&](SpfSolver& solver) {
+          solver.updateAdjacencyDatabase(
+              createAdjDb(nodeName, adjs, nodeLabel));
+        }};
+  }
+  runSolverIterations(
+      counters, suspender, iters, spfSolver, myNodeName, updates, prefixOnly);
+}
+
+//
+// Benchmark full route builds in grid topology of 100 nodes with numOfPrefixes
+// BGP prefixes, each advertised by the same few nodes with metric vectors
+// unsorted on the wire. Best path selection dominates the route build
+//
+static void
+BM_SpfSolverGridBgpPrefixes(
+    folly::UserCounters& counters, uint32_t iters, uint32_t numOfPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string myNodeName{"0"};
+  SpfSolver spfSolver(myNodeName, false, false /* computeLfaPaths */);
+  const int n = 10;
+  loadGrid(spfSolver, n, 1);
+
+  const int64_t numOfMetrics = 5;
+  const std::vector<uint32_t> advertiserIds{99, 98, 89, 88};
+  for (auto const advertiserId : advertiserIds) {
+    thrift::MetricVector mv;
+    mv.metrics.resize(numOfMetrics);
+    for (int64_t i = 0; i < numOfMetrics; ++i) {
+      mv.metrics[i].type = i;
+      mv.metrics[i].priority = i;
+      mv.metrics[i].op = thrift::CompareType::WIN_IF_PRESENT;
+      mv.metrics[i].isBestPathTieBreaker = false;
+      // only the highest priority metric differs between advertisers
+      mv.metrics[i].metric = {i == numOfMetrics - 1 ? advertiserId : i};
+    }
+    const auto nodeName = folly::sformat("{}", advertiserId);
+    auto prefixDb = createNodePrefixDb(nodeName, advertiserId, 1);
+    for (uint32_t i = 0; i < numOfPrefixes; ++i) {
+      prefixDb.prefixEntries.emplace_back(createPrefixEntry(
+          toIpPrefix(folly::sformat(
+              "fd00:{}:{}::/64", toHex(i >> 16), toHex(i & 0xffff))),
+          thrift::PrefixType::BGP,
+          "data" /* data */,
+          thrift::PrefixForwardingType::IP,
+          thrift::PrefixForwardingAlgorithm::SP_ECMP,
+          folly::none /* ephemeral */,
+          mv));
+    }
+    spfSolver.updatePrefixDatabase(prefixDb);
+  }
+
+  const int row = n / 2, col = n / 2;
+  const auto nodeName = folly::sformat("{}", row * n + col);
+  const auto adjs = createGridAdjacencys(row, col, n);
+  const auto nodeLabel = row * n + col + 1;
+  runSolverIterations(
+      counters,
+      suspender,
+      iters,
+      spfSolver,
+      myNodeName,
+      {[&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(
+             createAdjDb(nodeName, adjs, nodeLabel, true /* overload */));
+       },
+       [&](SpfSolver& solver) {
+         solver.updateAdjacencyDatabase(createAdjDb(nodeName, adjs, nodeLabel));
+       }},
+      false /* prefixOnly */);
+}
+
 // The integer parameter is the number of nodes in grid topology
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 100);
@@ -867,6 +1256,45 @@ BENCHMARK_COUNTERS_PARAM(BM_DecisionGrid, counters, 10000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 344);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 1000);
 BENCHMARK_COUNTERS_PARAM(BM_DecisionFabric, counters, 5000);
+// Same with SPF over radix heap
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionFabric, counters, 1000_radix, 1000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionFabric, counters, 5000_radix, 5000, true);
+// Same with specialized Dijkstra loops, over binary and radix heap
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionFabric, counters, 1000_specialized, 1000, false, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionFabric, counters, 5000_specialized, 5000, false, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_DecisionFabric, counters, 5000_radix_specialized, 5000, true, true);
+
+// Incremental change scenarios on SpfSolver, with and without LFA. The integer
+// parameter is the number of nodes in grid topology
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridLinkFlap, counters, 1000, 1000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridLinkFlap, counters, 1000_lfa, 1000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridLinkFlap, counters, 10000, 10000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridOverload, counters, 1000, 1000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridOverload, counters, 1000_lfa, 1000, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridPrefixChange, counters, 1000, 1000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverGridPrefixChange, counters, 1000_lfa, 1000, true);
+
+// The integer parameter is the total number of prefixes in fabric topology
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverFabricPrefixes, counters, 100000_overload, 100000, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SpfSolverFabricPrefixes, counters, 100000_prefix, 100000, true);
+
+// The integer parameter is the number of BGP prefixes in grid topology
+BENCHMARK_COUNTERS_PARAM(BM_SpfSolverGridBgpPrefixes, counters, 1000);
+BENCHMARK_COUNTERS_PARAM(BM_SpfSolverGridBgpPrefixes, counters, 10000);
 
 } // namespace openr
 
@@ -5,12 +5,17 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 
+#include <folly/FileUtil.h>
 #include <folly/IPAddress.h>
 #include <folly/IPAddressV4.h>
 #include <folly/IPAddressV6.h>
 #include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/futures/Promise.h>
 #include <gflags/gflags.h>
 #include <gmock/gmock.h>
@@ -20,7 +25,9 @@
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
+#include <openr/config-store/PersistentStore.h>
 #include <openr/decision/Decision.h>
+#include <openr/decision/PublicationRecorder.h>
 #include <openr/tests/OpenrModuleTestBase.h>
 
 DEFINE_bool(stress_test, false, "pass this to run the stress test");
@@ -358,6 +365,312 @@ TEST(SpfSolver, PrefixUpdate) {
   EXPECT_EQ(prefixDb1Updated, spfSolver.getPrefixDatabases().at(nodeName));
 }
 
+/**
+ * Test to verify routes produced as deltas against the previous ones
+ */
+TEST(SpfSolver, RouteDbDelta) {
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName, false /* disable v4 */, false /* disable LFA */);
+
+  EXPECT_FALSE(spfSolver.buildPathsDelta(nodeName).hasValue());
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31}, 3));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb1));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb2));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb3));
+
+  // first delta has all the routes
+  auto routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  auto routeDb = spfSolver.buildRouteDb(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ(2, routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(
+      routeDb->unicastRoutes.size(), routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(routeDb->mplsRoutes.size(), routeDelta->mplsRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDelta->unicastRoutesToDelete.size());
+
+  // nothing changed
+  routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_EQ(0, routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDelta->mplsRoutesToUpdate.size());
+
+  // new prefix from node 2
+  auto prefixDb2Updated = prefixDb2;
+  prefixDb2Updated.prefixEntries.emplace_back(createPrefixEntry(addr4));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb2Updated));
+  routeDelta = spfSolver.buildRouteDbDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  ASSERT_EQ(1, routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr4, routeDelta->unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(0, routeDelta->unicastRoutesToDelete.size());
+  EXPECT_EQ(0, routeDelta->mplsRoutesToUpdate.size());
+
+  // withdrawal of all prefixes of node 3
+  EXPECT_TRUE(spfSolver.deletePrefixDatabase("3"));
+  routeDelta = spfSolver.buildRouteDbDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_EQ(0, routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_THAT(
+      routeDelta->unicastRoutesToDelete, testing::UnorderedElementsAre(addr3));
+
+  // route cache is consistent with a full build
+  auto checkDelta = spfSolver.checkRouteDbCache(nodeName);
+  ASSERT_TRUE(checkDelta.hasValue());
+  EXPECT_EQ(0, checkDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, checkDelta->unicastRoutesToDelete.size());
+  EXPECT_EQ(0, checkDelta->mplsRoutesToUpdate.size());
+  EXPECT_EQ(0, checkDelta->mplsRoutesToDelete.size());
+
+  // SPF results built for another node do not leak into the deltas
+  EXPECT_TRUE(spfSolver.buildPaths("2").hasValue());
+  EXPECT_FALSE(spfSolver.checkRouteDbCache(nodeName).hasValue());
+  routeDelta = spfSolver.buildRouteDbDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_EQ(0, routeDelta->unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDelta->unicastRoutesToDelete.size());
+  EXPECT_EQ(0, routeDelta->mplsRoutesToUpdate.size());
+
+  // adjacency change is not checked before it is applied
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12}, 1));
+  EXPECT_FALSE(spfSolver.checkRouteDbCache(nodeName).hasValue());
+  routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_LT(0, routeDelta->mplsRoutesToDelete.size());
+  EXPECT_TRUE(spfSolver.checkRouteDbCache(nodeName).hasValue());
+}
+
+/**
+ * Test to verify that next-hops are computed once per set of advertising
+ * nodes and SPF generation
+ */
+TEST(SpfSolver, NextHopsCache) {
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName, false /* disable v4 */, false /* disable LFA */);
+
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31}, 3));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb1));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(createPrefixDb(
+      "2", {createPrefixEntry(addr2), createPrefixEntry(addr4)})));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(createPrefixDb(
+      "3", {createPrefixEntry(addr3), createPrefixEntry(addr5)})));
+
+  auto routeDb = spfSolver.buildPaths(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ(4, routeDb->unicastRoutes.size());
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters["decision.nexthops_cache_misses.count.0"]);
+  EXPECT_EQ(2, counters["decision.nexthops_cache_hits.count.0"]);
+
+  // same SPF generation, all next-hops are re-used
+  auto routeDb2 = spfSolver.buildRouteDb(nodeName);
+  ASSERT_TRUE(routeDb2.hasValue());
+  EXPECT_EQ(*routeDb, *routeDb2);
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(2, counters["decision.nexthops_cache_misses.count.0"]);
+  EXPECT_EQ(6, counters["decision.nexthops_cache_hits.count.0"]);
+
+  // topology change invalidates memoized next-hops
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12}, 1));
+  routeDb = spfSolver.buildPaths(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_EQ(2, routeDb->unicastRoutes.size());
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(4, counters["decision.nexthops_cache_misses.count.0"]);
+  EXPECT_EQ(8, counters["decision.nexthops_cache_hits.count.0"]);
+}
+
+TEST(SpfSolver, SkipIrrelevantSpf) {
+  //
+  // 1 - 2 - 4
+  //  \  |  /
+  //    3
+  //
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName, false /* disable v4 */, false /* disable LFA */);
+
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21, adj23, adj24}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31, adj32, adj34}, 3));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("4", {adj42, adj43}, 4));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb1));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb4));
+
+  auto routeDb = spfSolver.buildPaths(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+
+  // metric increase of link 2 - 3, which is on none of the shortest paths
+  auto adj23Expensive = adj23;
+  adj23Expensive.metric = 30;
+  auto adj32Expensive = adj32;
+  adj32Expensive.metric = 30;
+  EXPECT_FALSE(spfSolver
+                   .updateAdjacencyDatabase(
+                       createAdjDb("2", {adj21, adj23Expensive, adj24}, 2))
+                   .first);
+  EXPECT_FALSE(spfSolver
+                   .updateAdjacencyDatabase(
+                       createAdjDb("3", {adj31, adj32Expensive, adj34}, 3))
+                   .first);
+
+  // overload of node 4 which is not transited by any shortest path
+  auto adjDb4 = createAdjDb("4", {adj42, adj43}, 4);
+  adjDb4.isOverloaded = true;
+  EXPECT_FALSE(spfSolver.updateAdjacencyDatabase(adjDb4).first);
+
+  auto counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters["decision.spf_skipped.count.0"]);
+
+  // skipped changes leave routes as they are
+  auto routeDb2 = spfSolver.buildRouteDb(nodeName);
+  ASSERT_TRUE(routeDb2.hasValue());
+  EXPECT_EQ(*routeDb, *routeDb2);
+
+  // metric increase of link 2 - 4 changes shortest paths to node 4
+  auto adj24Expensive = adj24;
+  adj24Expensive.metric = 30;
+  EXPECT_TRUE(spfSolver
+                  .updateAdjacencyDatabase(createAdjDb(
+                      "2", {adj21, adj23Expensive, adj24Expensive}, 2))
+                  .first);
+  counters = spfSolver.getCounters();
+  EXPECT_EQ(3, counters["decision.spf_skipped.count.0"]);
+
+  routeDb = spfSolver.buildPaths(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+  EXPECT_NE(*routeDb, *routeDb2);
+}
+
+/**
+ * Test to verify route deltas carry perf events of the computation phases
+ */
+TEST(SpfSolver, PhaseEvents) {
+  std::string nodeName("1");
+  SpfSolver spfSolver(nodeName, false /* disable v4 */, true /* enable LFA */);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21}, 2));
+  spfSolver.updateAdjacencyDatabase(createAdjDb("3", {adj31}, 3));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb2));
+
+  auto getEventNames = [](const thrift::RouteDatabaseDelta& routeDelta) {
+    std::vector<std::string> names;
+    for (auto const& event : routeDelta.perfEvents.value().events) {
+      names.emplace_back(event.eventDescr);
+    }
+    return names;
+  };
+
+  // full build after SPF and LFA SPF runs
+  auto routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  ASSERT_TRUE(routeDelta->perfEvents.hasValue());
+  EXPECT_THAT(
+      getEventNames(*routeDelta),
+      testing::ElementsAre(
+          "DECISION_COMPUTE_START",
+          "DECISION_SPF_RUN",
+          "DECISION_LFA_SPF_RUN",
+          "DECISION_ROUTE_BUILD"));
+
+  // incremental build of changed prefixes only
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb3));
+  routeDelta = spfSolver.buildRouteDbDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  ASSERT_TRUE(routeDelta->perfEvents.hasValue());
+  EXPECT_THAT(
+      getEventNames(*routeDelta),
+      testing::ElementsAre("DECISION_COMPUTE_START", "DECISION_ROUTE_DELTA"));
+
+  // queries do not leak phase events into the next delta
+  EXPECT_TRUE(spfSolver.buildPaths("2").hasValue());
+  routeDelta = spfSolver.buildRouteDbDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_THAT(
+      getEventNames(*routeDelta),
+      testing::ElementsAre(
+          "DECISION_COMPUTE_START",
+          "DECISION_SPF_RUN",
+          "DECISION_LFA_SPF_RUN",
+          "DECISION_ROUTE_BUILD"));
+}
+
+TEST(SpfSolver, Snapshot) {
+  std::string nodeName("1");
+  SpfSolver spfSolver(
+      nodeName, false /* disable v4 */, false /* disable LFA */);
+
+  const auto adjDb1 = createAdjDb("1", {adj12}, 1);
+  spfSolver.updateAdjacencyDatabase(adjDb1);
+  spfSolver.updateAdjacencyDatabase(createAdjDb("2", {adj21}, 2));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb1));
+  EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb2));
+
+  auto snapshot = spfSolver.getSnapshot();
+  ASSERT_EQ(2, snapshot->adjacencyDatabases.size());
+  ASSERT_EQ(2, snapshot->prefixDatabases.size());
+  EXPECT_EQ(adjDb1, *snapshot->adjacencyDatabases.at("1"));
+  EXPECT_EQ(prefixDb2, *snapshot->prefixDatabases.at("2"));
+
+  // no change, same snapshot
+  spfSolver.updateAdjacencyDatabase(adjDb1);
+  EXPECT_FALSE(spfSolver.updatePrefixDatabase(prefixDb2));
+  EXPECT_EQ(snapshot, spfSolver.getSnapshot());
+
+  // changes leave the held snapshot untouched and share unchanged databases
+  spfSolver.updateAdjacencyDatabase(createAdjDb("1", {adj12, adj13}, 1));
+  EXPECT_TRUE(spfSolver.deletePrefixDatabase("2"));
+  auto snapshot2 = spfSolver.getSnapshot();
+  EXPECT_NE(snapshot, snapshot2);
+  EXPECT_LT(snapshot->version, snapshot2->version);
+  EXPECT_EQ(adjDb1, *snapshot->adjacencyDatabases.at("1"));
+  EXPECT_EQ(2, snapshot->prefixDatabases.size());
+  EXPECT_EQ(1, snapshot2->prefixDatabases.size());
+  EXPECT_EQ(
+      snapshot->adjacencyDatabases.at("2"),
+      snapshot2->adjacencyDatabases.at("2"));
+  EXPECT_EQ(
+      snapshot->prefixDatabases.at("1"), snapshot2->prefixDatabases.at("1"));
+  EXPECT_EQ(spfSolver.getPrefixDatabases().size(), 1);
+}
+
+TEST(PublicationRecorder, RecordAndRead) {
+  const std::string filePath{"/tmp/decision_ut_publications.bin"};
+  thrift::Publication pub1;
+  pub1.keyVals["adj:1"] = thrift::Value(
+      FRAGILE, 1, "1", std::string("adjDb"), Constants::kTtlInfinity, 0, 0);
+  thrift::Publication pub2;
+  pub2.expiredKeys = {"adj:1"};
+  {
+    PublicationRecorder recorder(filePath);
+    EXPECT_TRUE(recorder.record(pub1).hasValue());
+    EXPECT_TRUE(recorder.record(pub2).hasValue());
+  }
+
+  // partially written last record is ignored
+  std::string fileData;
+  ASSERT_TRUE(folly::readFile(filePath.c_str(), fileData));
+  fileData.append(std::string("\0\0\0\x10ab", 6));
+  ASSERT_TRUE(folly::writeFile(fileData, filePath.c_str()));
+
+  auto records = PublicationRecorder::readRecords(filePath);
+  ASSERT_TRUE(records.hasValue());
+  ASSERT_EQ(2, records->size());
+  EXPECT_EQ(pub1, records->at(0).publication);
+  EXPECT_EQ(pub2, records->at(1).publication);
+  EXPECT_LE(records->at(0).timestampUs, records->at(1).timestampUs);
+
+  EXPECT_TRUE(
+      PublicationRecorder::readRecords("/tmp/decision_ut_missing.bin")
+          .hasError());
+}
+
 TEST(SpfSolver, getNodeHostLoopbacksV4) {
   std::string nodeName("1");
   SpfSolver spfSolver(
@@ -627,6 +940,8 @@ TEST(BGPRedistribution, BasicOperation) {
 
   EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb1WithBGP));
   EXPECT_TRUE(spfSolver.updatePrefixDatabase(prefixDb2WithBGP));
+  // metric vector is stored sorted, the same unsorted one is no change
+  EXPECT_FALSE(spfSolver.updatePrefixDatabase(prefixDb1WithBGP));
 
   auto routeDb = spfSolver.buildPaths("2");
   thrift::UnicastRoute route1(
@@ -2306,6 +2621,45 @@ TEST_F(ParallelAdjRingTopologyFixture, Ksp2EdEcmp) {
                 createNextHopFromAdj(adj43_1, false, 22, push1, true)}));
 }
 
+//
+// KSP2_ED_ECMP paths are computed once per destination node and shared by
+// all prefixes it advertises
+//
+TEST_F(ParallelAdjRingTopologyFixture, Ksp2EdEcmpCache) {
+  CustomSetUp(true /* multipath, ignored */, true /* useKsp2Ed */);
+  const auto multiPrefixDb4 = createPrefixDb(
+      "4", {createPrefixEntry(addr4), createPrefixEntry(addr5)});
+  EXPECT_TRUE(
+      spfSolver->updatePrefixDatabase(getPrefixDbWithKspfAlgo(multiPrefixDb4)));
+
+  auto routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_FALSE(routeMap[make_pair("1", toString(addr4))].empty());
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr4))],
+      routeMap[make_pair("1", toString(addr5))]);
+
+  // one second SPF run per destination node, i.e. nodes 2, 3 and 4
+  auto counters = spfSolver->getCounters();
+  EXPECT_EQ(3, counters["decision.ksp2_spf_runs.count.0"]);
+
+  // route rebuild without changes re-uses all paths
+  auto routeDb = spfSolver->buildRouteDb("1");
+  ASSERT_TRUE(routeDb.hasValue());
+  counters = spfSolver->getCounters();
+  EXPECT_EQ(3, counters["decision.ksp2_spf_runs.count.0"]);
+
+  // topology change invalidates computed paths
+  adjacencyDb1.adjacencies.at(1).isOverloaded = true;
+  EXPECT_TRUE(spfSolver->updateAdjacencyDatabase(adjacencyDb1).first);
+  routeMap = getRouteMap(*spfSolver, {"1"});
+  EXPECT_EQ(
+      routeMap[make_pair("1", toString(addr2))],
+      NextHops({createNextHopFromAdj(adj12_1, false, 11, folly::none, true),
+                createNextHopFromAdj(adj12_3, false, 20, folly::none, true)}));
+  counters = spfSolver->getCounters();
+  EXPECT_EQ(6, counters["decision.ksp2_spf_runs.count.0"]);
+}
+
 /**
  * Topology
  *        R2 - - - - - - R4
@@ -2778,6 +3132,71 @@ TEST_P(GridTopologyFixture, ShortestPathTest) {
 }
 
 // measure SPF execution time for large networks
+TEST(DecisionDebounce, AdaptiveWindow) {
+  using std::chrono::milliseconds;
+  detail::DecisionDebounce debounce(milliseconds(10), milliseconds(250));
+
+  // configured bounds until first run
+  EXPECT_EQ(milliseconds(10), debounce.getInitialWindow());
+  EXPECT_EQ(milliseconds(250), debounce.getMaxWindow());
+
+  // cheap run of single update, react as fast as allowed
+  debounce.reportRun(milliseconds(1), 1);
+  EXPECT_EQ(milliseconds(10), debounce.getInitialWindow());
+  EXPECT_EQ(milliseconds(11), debounce.getMaxWindow());
+
+  // expensive runs of large batches, wait for as long as computation takes
+  for (int i = 0; i < 20; ++i) {
+    debounce.reportRun(milliseconds(100), 4);
+  }
+  EXPECT_NEAR(100, debounce.getInitialWindow().count(), 1);
+  EXPECT_EQ(milliseconds(250), debounce.getMaxWindow());
+
+  // never beyond configured max window
+  for (int i = 0; i < 20; ++i) {
+    debounce.reportRun(milliseconds(1000), 1);
+  }
+  EXPECT_EQ(milliseconds(249), debounce.getInitialWindow());
+  EXPECT_EQ(milliseconds(250), debounce.getMaxWindow());
+}
+
+TEST(DecisionPhaseHistogram, Counters) {
+  using std::chrono::milliseconds;
+  detail::DecisionPhaseHistogram histogram;
+  std::unordered_map<std::string, int64_t> counters;
+
+  // only count exported until first value
+  histogram.exportCounters("decision.phase.spf_ms", counters);
+  EXPECT_EQ(1, counters.size());
+  EXPECT_EQ(0, counters["decision.phase.spf_ms.count"]);
+
+  for (int i = 0; i < 100; ++i) {
+    histogram.addValue(milliseconds(i < 90 ? 5 : 500));
+  }
+  histogram.exportCounters("decision.phase.spf_ms", counters);
+  EXPECT_EQ(100, counters["decision.phase.spf_ms.count"]);
+  EXPECT_GT(10, counters["decision.phase.spf_ms.p50"]);
+  EXPECT_LE(490, counters["decision.phase.spf_ms.p99"]);
+  EXPECT_GT(510, counters["decision.phase.spf_ms.p99"]);
+  EXPECT_EQ(500, counters["decision.phase.spf_ms.max"]);
+
+  // slower than the histogram range still counts, and is the exact max
+  histogram.addValue(milliseconds(20000));
+  histogram.exportCounters("decision.phase.spf_ms", counters);
+  EXPECT_EQ(101, counters["decision.phase.spf_ms.count"]);
+  EXPECT_EQ(20000, counters["decision.phase.spf_ms.max"]);
+
+  // finer buckets estimate sub-bucket durations of the default range
+  detail::DecisionPhaseHistogram fineHistogram(1, 1000);
+  for (int i = 0; i < 100; ++i) {
+    fineHistogram.addValue(milliseconds(i < 90 ? 2 : 7));
+  }
+  fineHistogram.exportCounters("decision.spf_ms", counters);
+  EXPECT_GE(3, counters["decision.spf_ms.p50"]);
+  EXPECT_LE(6, counters["decision.spf_ms.p99"]);
+  EXPECT_EQ(7, counters["decision.spf_ms.max"]);
+}
+
 TEST(GridTopology, StressTest) {
   if (!FLAGS_stress_test) {
     return;
@@ -2788,6 +3207,360 @@ TEST(GridTopology, StressTest) {
   spfSolver.buildPaths("523");
 }
 
+//
+// Apply a series of link and node changes on the grid and verify that the
+// routes computed incrementally from cached SPF results are the same as the
+// ones computed from scratch
+//
+TEST(GridTopology, IncrementalSpfTest) {
+  const int n = 8;
+  const std::string nodeName("0");
+  SpfSolver spfSolver(nodeName, false /* disable v4 */, true /* enable LFA */);
+  createGrid(spfSolver, n);
+
+  auto verifyRoutes = [&]() {
+    SpfSolver fullSpfSolver(nodeName, false, true);
+    for (auto const& kv : spfSolver.getAdjacencyDatabases()) {
+      fullSpfSolver.updateAdjacencyDatabase(kv.second);
+    }
+    for (auto const& kv : spfSolver.getPrefixDatabases()) {
+      fullSpfSolver.updatePrefixDatabase(kv.second);
+    }
+    EXPECT_EQ(
+        getRouteMap(fullSpfSolver, {nodeName}),
+        getRouteMap(spfSolver, {nodeName}));
+  };
+
+  auto updateAdjDb = [&](const std::string& node,
+                         std::function<void(thrift::AdjacencyDatabase&)> fn) {
+    auto adjDb = spfSolver.getAdjacencyDatabases().at(node);
+    fn(adjDb);
+    spfSolver.updateAdjacencyDatabase(adjDb);
+  };
+
+  // initial full computation
+  verifyRoutes();
+
+  // metric increase on far corner of the grid
+  const auto farNode = folly::sformat("{}", n * n - 1);
+  updateAdjDb(farNode, [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.adjacencies.at(0).metric = 10;
+  });
+  verifyRoutes();
+
+  // metric decrease on the same link
+  updateAdjDb(farNode, [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.adjacencies.at(0).metric = 1;
+  });
+  verifyRoutes();
+
+  // link down and up in the middle of the grid
+  const auto midNode = folly::sformat("{}", n * n / 2 + n / 2);
+  const auto midAdjDb = spfSolver.getAdjacencyDatabases().at(midNode);
+  updateAdjDb(midNode, [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.adjacencies.pop_back();
+  });
+  verifyRoutes();
+  spfSolver.updateAdjacencyDatabase(midAdjDb);
+  verifyRoutes();
+
+  // overload and un-overload a node next to the source
+  updateAdjDb("1", [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.isOverloaded = true;
+  });
+  verifyRoutes();
+  updateAdjDb("1", [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.isOverloaded = false;
+  });
+  verifyRoutes();
+
+  // multiple changes at once
+  updateAdjDb(farNode, [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.adjacencies.at(0).metric = 5;
+  });
+  updateAdjDb(midNode, [](thrift::AdjacencyDatabase& adjDb) {
+    adjDb.adjacencies.at(0).metric = 3;
+  });
+  EXPECT_TRUE(spfSolver.deleteAdjacencyDatabase(folly::sformat("{}", n)));
+  verifyRoutes();
+
+  // at least the far corner changes must have been applied incrementally
+  auto counters = spfSolver.getCounters();
+  EXPECT_LT(0, counters["decision.incremental_spf_runs.count.0"]);
+}
+
+//
+// Node label routes are only re-computed for nodes whose shortest paths or
+// labels changed, and stay consistent with a full route build
+//
+TEST(GridTopology, IncrementalLabelRoutesTest) {
+  const int n = 6;
+  const std::string nodeName("0");
+  SpfSolver spfSolver(nodeName, false /* disable v4 */, true /* enable LFA */);
+  createGrid(spfSolver, n);
+
+  auto getNumLabelRouteUpdates = [&]() {
+    return spfSolver.getCounters()["decision.label_route_updates.sum.0"];
+  };
+  auto verifyRouteDbCache = [&]() {
+    auto checkDelta = spfSolver.checkRouteDbCache(nodeName);
+    ASSERT_TRUE(checkDelta.hasValue());
+    EXPECT_EQ(0, checkDelta->mplsRoutesToUpdate.size());
+    EXPECT_EQ(0, checkDelta->mplsRoutesToDelete.size());
+  };
+
+  // all node labels on first build
+  auto routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_EQ(n * n, getNumLabelRouteUpdates());
+  verifyRouteDbCache();
+
+  // one of the equal cost paths towards far corner goes away. Only its label
+  // route is re-computed, and stays the same as next-hops do
+  auto adjDb = spfSolver.getAdjacencyDatabases().at(
+      folly::sformat("{}", n * n - 2));
+  adjDb.adjacencies.at(0).metric = 10;
+  spfSolver.updateAdjacencyDatabase(adjDb);
+  routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  EXPECT_EQ(0, routeDelta->mplsRoutesToUpdate.size());
+  EXPECT_EQ(n * n + 1, getNumLabelRouteUpdates());
+  verifyRouteDbCache();
+
+  // node label change of a remote node
+  const auto labelUpdates = getNumLabelRouteUpdates();
+  adjDb = spfSolver.getAdjacencyDatabases().at("20");
+  const auto oldLabel = adjDb.nodeLabel;
+  adjDb.nodeLabel = 1000;
+  spfSolver.updateAdjacencyDatabase(adjDb);
+  routeDelta = spfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  ASSERT_EQ(1, routeDelta->mplsRoutesToUpdate.size());
+  EXPECT_EQ(1000, routeDelta->mplsRoutesToUpdate.at(0).topLabel);
+  EXPECT_THAT(
+      routeDelta->mplsRoutesToDelete, testing::UnorderedElementsAre(oldLabel));
+  EXPECT_EQ(labelUpdates + 1, getNumLabelRouteUpdates());
+  verifyRouteDbCache();
+}
+
+//
+// SPF over radix heap must yield exactly the same routes as over binary heap,
+// including equal cost paths over zero metric links
+//
+TEST(GridTopology, RadixHeapSpfTest) {
+  const int n = 8;
+  const std::string nodeName("0");
+  SpfSolver spfSolver(nodeName, false /* disable v4 */, true /* enable LFA */);
+  SpfSolver radixSpfSolver(
+      nodeName,
+      false /* disable v4 */,
+      true /* enable LFA */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      0 /* lfaSpfThreads */,
+      0 /* routeBuildThreads */,
+      nullptr /* sharedExecutor */,
+      true /* useRadixHeapSpf */);
+  createGrid(spfSolver, n);
+
+  for (auto kv : spfSolver.getAdjacencyDatabases()) {
+    auto& adjDb = kv.second;
+    for (size_t i = 0; i < adjDb.adjacencies.size(); ++i) {
+      adjDb.adjacencies[i].metric = (adjDb.nodeLabel + i) % 4;
+    }
+    spfSolver.updateAdjacencyDatabase(adjDb);
+    radixSpfSolver.updateAdjacencyDatabase(adjDb);
+  }
+  for (auto const& kv : spfSolver.getPrefixDatabases()) {
+    radixSpfSolver.updatePrefixDatabase(kv.second);
+  }
+
+  const vector<string> nodes{nodeName, "9", "27", "63"};
+  EXPECT_EQ(getRouteMap(spfSolver, nodes), getRouteMap(radixSpfSolver, nodes));
+}
+
+//
+// Specialized Dijkstra loops must yield exactly the same routes as the
+// generic one, with and without overloaded nodes
+//
+TEST(GridTopology, SpecializedSpfTest) {
+  const int n = 8;
+  const std::string nodeName("0");
+  SpfSolver spfSolver(nodeName, false /* disable v4 */, true /* enable LFA */);
+  SpfSolver specializedSpfSolver(
+      nodeName,
+      false /* disable v4 */,
+      true /* enable LFA */,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      0 /* lfaSpfThreads */,
+      0 /* routeBuildThreads */,
+      nullptr /* sharedExecutor */,
+      false /* useRadixHeapSpf */,
+      true /* useSpecializedSpf */);
+  createGrid(spfSolver, n);
+
+  for (auto kv : spfSolver.getAdjacencyDatabases()) {
+    auto& adjDb = kv.second;
+    for (size_t i = 0; i < adjDb.adjacencies.size(); ++i) {
+      adjDb.adjacencies[i].metric = (adjDb.nodeLabel + i) % 4 + 1;
+    }
+    spfSolver.updateAdjacencyDatabase(adjDb);
+    specializedSpfSolver.updateAdjacencyDatabase(adjDb);
+  }
+  for (auto const& kv : spfSolver.getPrefixDatabases()) {
+    specializedSpfSolver.updatePrefixDatabase(kv.second);
+  }
+
+  const vector<string> nodes{nodeName, "9", "27", "63"};
+  EXPECT_EQ(
+      getRouteMap(spfSolver, nodes), getRouteMap(specializedSpfSolver, nodes));
+
+  for (auto solver : {&spfSolver, &specializedSpfSolver}) {
+    auto adjDb = solver->getAdjacencyDatabases().at("10");
+    adjDb.isOverloaded = true;
+    solver->updateAdjacencyDatabase(adjDb);
+  }
+  EXPECT_EQ(
+      getRouteMap(spfSolver, nodes), getRouteMap(specializedSpfSolver, nodes));
+}
+
+//
+// SPF runs reuse the storage of their queue, so that once warmed up for a
+// graph further runs over it do not allocate it again
+//
+TEST(GridTopology, SpfAllocationsTest) {
+  const int n = 8;
+  const std::string nodeName("0");
+  SpfSolver warmSpfSolver(nodeName, false, true /* enable LFA */);
+  createGrid(warmSpfSolver, n);
+  EXPECT_TRUE(warmSpfSolver.buildPaths(nodeName).hasValue());
+
+  SpfSolver spfSolver(nodeName, false, true /* enable LFA */);
+  createGrid(spfSolver, n);
+  EXPECT_TRUE(spfSolver.buildPaths(nodeName).hasValue());
+  auto counters = spfSolver.getCounters();
+  EXPECT_LT(0, counters["decision.spf_runs.count.0"]);
+  EXPECT_EQ(0, counters["decision.spf_allocations.avg.0"]);
+}
+
+//
+// LFA SPF runs fanned out over a worker pool must yield exactly the same
+// routes as the sequential computation
+//
+TEST(GridTopology, ParallelLfaSpfTest) {
+  const int n = 6;
+  const std::string nodeName(folly::sformat("{}", n + 1));
+  SpfSolver spfSolver(nodeName, false, true /* enable LFA */);
+  SpfSolver parallelSpfSolver(
+      nodeName, false, true /* enable LFA */, false, false, 4 /* threads */);
+  createGrid(spfSolver, n);
+  createGrid(parallelSpfSolver, n);
+
+  EXPECT_EQ(
+      getRouteMap(spfSolver, {nodeName}),
+      getRouteMap(parallelSpfSolver, {nodeName}));
+
+  // change one of the links and verify again
+  for (auto* solver : {&spfSolver, &parallelSpfSolver}) {
+    auto adjDb = solver->getAdjacencyDatabases().at(nodeName);
+    adjDb.adjacencies.at(0).metric = 10;
+    solver->updateAdjacencyDatabase(adjDb);
+  }
+  EXPECT_EQ(
+      getRouteMap(spfSolver, {nodeName}),
+      getRouteMap(parallelSpfSolver, {nodeName}));
+
+  // four neighbors of an inner grid node are computed in parallel
+  auto counters = parallelSpfSolver.getCounters();
+  EXPECT_LE(4, counters["decision.lfa_spf_us.count.0"]);
+  EXPECT_EQ(0, spfSolver.getCounters().count("decision.lfa_spf_us.count.0"));
+}
+
+TEST(GridTopology, ParallelRouteBuildTest) {
+  const int n = 6;
+  const std::string nodeName(folly::sformat("{}", n + 1));
+  SpfSolver spfSolver(nodeName, false, true /* enable LFA */);
+  SpfSolver parallelSpfSolver(
+      nodeName, false, true, false, false, 0, 4 /* route build threads */);
+  createGrid(spfSolver, n);
+  createGrid(parallelSpfSolver, n);
+
+  // enough prefixes for the build to be sharded, some of them KSP2_ED_ECMP
+  for (int node = 0; node < n * n; ++node) {
+    auto advertiser = folly::sformat("{}", node);
+    std::vector<thrift::PrefixEntry> entries{
+        createPrefixEntry(toIpPrefix(nodeToPrefixV6(node)))};
+    for (int i = 0; i < 40; ++i) {
+      entries.emplace_back(createPrefixEntry(
+          toIpPrefix(folly::sformat("fc00:{}::{}/128", node, i)),
+          thrift::PrefixType::LOOPBACK,
+          "",
+          i % 10 ? thrift::PrefixForwardingType::IP
+                 : thrift::PrefixForwardingType::SR_MPLS,
+          i % 10 ? thrift::PrefixForwardingAlgorithm::SP_ECMP
+                 : thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP));
+    }
+    for (auto* solver : {&spfSolver, &parallelSpfSolver}) {
+      EXPECT_TRUE(
+          solver->updatePrefixDatabase(createPrefixDb(advertiser, entries)));
+    }
+  }
+
+  auto routeDb = spfSolver.buildPaths(nodeName);
+  auto parallelRouteDb = parallelSpfSolver.buildPaths(nodeName);
+  ASSERT_TRUE(routeDb.hasValue());
+  ASSERT_TRUE(parallelRouteDb.hasValue());
+  EXPECT_LT(
+      Constants::kParallelRouteBuildMinPrefixes, routeDb->unicastRoutes.size());
+  EXPECT_EQ(*routeDb, *parallelRouteDb);
+  EXPECT_TRUE(std::is_sorted(
+      parallelRouteDb->unicastRoutes.begin(),
+      parallelRouteDb->unicastRoutes.end(),
+      [](thrift::UnicastRoute const& lhs, thrift::UnicastRoute const& rhs) {
+        return lhs.dest < rhs.dest;
+      }));
+
+  // full delta builds merge shards in prefix order
+  auto routeDelta = spfSolver.buildPathsDelta(nodeName);
+  auto parallelRouteDelta = parallelSpfSolver.buildPathsDelta(nodeName);
+  ASSERT_TRUE(routeDelta.hasValue());
+  ASSERT_TRUE(parallelRouteDelta.hasValue());
+  EXPECT_EQ(
+      routeDelta->unicastRoutesToUpdate,
+      parallelRouteDelta->unicastRoutesToUpdate);
+
+  auto counters = parallelSpfSolver.getCounters();
+  EXPECT_LE(2, counters["decision.parallel_route_build_ms.count.0"]);
+  EXPECT_EQ(
+      0,
+      spfSolver.getCounters().count(
+          "decision.parallel_route_build_ms.count.0"));
+}
+
+//
+// Solvers sharing one pool for LFA SPF runs and route builds yield the same
+// routes as the sequential computation
+//
+TEST(GridTopology, SharedExecutorTest) {
+  const int n = 6;
+  const std::string nodeName(folly::sformat("{}", n + 1));
+  auto sharedExecutor = std::make_shared<folly::CPUThreadPoolExecutor>(4);
+  SpfSolver spfSolver(nodeName, false, true /* enable LFA */);
+  SpfSolver sharedSpfSolver1(
+      nodeName, false, true, false, false, 0, 0, sharedExecutor);
+  SpfSolver sharedSpfSolver2(
+      nodeName, false, true, false, false, 0, 0, sharedExecutor);
+  for (auto* solver : {&spfSolver, &sharedSpfSolver1, &sharedSpfSolver2}) {
+    createGrid(*solver, n);
+  }
+
+  const auto routeMap = getRouteMap(spfSolver, {nodeName});
+  EXPECT_EQ(routeMap, getRouteMap(sharedSpfSolver1, {nodeName}));
+  EXPECT_EQ(routeMap, getRouteMap(sharedSpfSolver2, {nodeName}));
+  EXPECT_LE(4, sharedSpfSolver1.getCounters()["decision.lfa_spf_us.count.0"]);
+}
+
 //
 // Start the decision thread and simulate KvStore communications
 // Expect proper RouteDatabase publications to appear
@@ -2809,12 +3582,16 @@ class DecisionTestFixture : public ::testing::Test, public OpenrModuleTestBase {
         PrefixDbMarker{"prefix:"},
         std::chrono::milliseconds(10),
         std::chrono::milliseconds(500),
-        folly::none,
+        gracefulRestartDuration(),
         KvStoreLocalCmdUrl{"inproc://kvStore-rep"},
         KvStoreLocalPubUrl{"inproc://kvStore-pub"},
         DecisionPubUrl{"inproc://decision-pub"},
         MonitorSubmitUrl{"inproc://monitor-rep"},
-        zeromqContext);
+        zeromqContext,
+        0, /* lfaSpfThreads */
+        false, /* enableAdaptiveDebounce */
+        enableComputeThread(),
+        configStoreUrl());
 
     decisionThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Decision thread starting";
@@ -2887,20 +3664,42 @@ class DecisionTestFixture : public ::testing::Test, public OpenrModuleTestBase {
         decisionPub.recvThriftObj<thrift::RouteDatabaseDelta>(serializer);
     EXPECT_FALSE(maybeRouteDb.hasError());
     auto routeDbDelta = maybeRouteDb.value();
+    EXPECT_TRUE(expandNextHopGroups(routeDbDelta));
     return routeDbDelta;
   }
 
   void
   replyInitialSyncReq(const thrift::Publication& publication) {
-    // receive the request for initial routeDb sync
-    auto maybeDumpReq =
-        kvStoreRep.recvThriftObj<thrift::KvStoreRequest>(serializer);
-    EXPECT_FALSE(maybeDumpReq.hasError());
-    auto dumpReq = maybeDumpReq.value();
-    EXPECT_EQ(thrift::Command::KEY_DUMP, dumpReq.cmd);
-
-    // send back routeDb reply
-    kvStoreRep.sendThriftObj(publication, serializer);
+    // initial sync dumps adjacencies first, then prefixes in batches of
+    // key ranges
+    const int numRequests = 1 + (1 << Constants::kKvStoreSyncRangeBits);
+    for (int i = 0; i < numRequests; ++i) {
+      auto maybeDumpReq =
+          kvStoreRep.recvThriftObj<thrift::KvStoreRequest>(serializer);
+      EXPECT_FALSE(maybeDumpReq.hasError());
+      auto dumpReq = maybeDumpReq.value();
+      EXPECT_EQ(thrift::Command::KEY_DUMP, dumpReq.cmd);
+      ASSERT_TRUE(dumpReq.keyDumpParams.hasValue());
+
+      // send back the requested part of publication
+      std::vector<std::string> keyPrefixes;
+      folly::split(",", dumpReq.keyDumpParams->prefix, keyPrefixes, true);
+      const auto& keyRanges = dumpReq.keyDumpParams->keyRanges;
+      thrift::Publication reply;
+      for (const auto& kv : publication.keyVals) {
+        const bool matchesPrefix = std::any_of(
+            keyPrefixes.begin(), keyPrefixes.end(), [&kv](const auto& prefix) {
+              return kv.first.compare(0, prefix.size(), prefix) == 0;
+            });
+        const bool matchesRange = not keyRanges.hasValue() or
+            keyRanges->count(KvStore::getKeyRange(
+                kv.first, Constants::kKvStoreSyncRangeLevels));
+        if (matchesPrefix and matchesRange) {
+          reply.keyVals.emplace(kv);
+        }
+      }
+      kvStoreRep.sendThriftObj(reply, serializer);
+    }
   }
 
   // publish routeDb
@@ -2945,6 +3744,21 @@ class DecisionTestFixture : public ::testing::Test, public OpenrModuleTestBase {
         0 /* hash */);
   }
 
+  virtual bool
+  enableComputeThread() const {
+    return false;
+  }
+
+  virtual folly::Optional<std::chrono::seconds>
+  gracefulRestartDuration() const {
+    return folly::none;
+  }
+
+  virtual folly::Optional<PersistentStoreUrl>
+  configStoreUrl() const {
+    return folly::none;
+  }
+
   std::unordered_map<std::string, int64_t>
   getCountersMap() {
     folly::Promise<std::unordered_map<std::string, int64_t>> promise;
@@ -3125,6 +3939,443 @@ TEST_F(DecisionTestFixture, BasicOperations) {
       NextHops({createNextHopFromAdj(adj12, false, 10)}));
 }
 
+//
+// Prefix only changes must be published as a delta of just the changed
+// prefixes without running SPF
+//
+class DecisionComputeThreadFixture : public DecisionTestFixture {
+ protected:
+  bool
+  enableComputeThread() const override {
+    return true;
+  }
+};
+
+//
+// Routes computed on the compute thread are published as they would be when
+// computed on the Decision thread, and queries are served meanwhile
+//
+TEST_F(DecisionComputeThreadFixture, BasicOperations) {
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(
+      NextHops({createNextHopFromAdj(adj12, false, 10)}),
+      NextHops(
+          routeDbDelta.unicastRoutesToUpdate.at(0).nextHops.begin(),
+          routeDbDelta.unicastRoutesToUpdate.at(0).nextHops.end()));
+
+  // prefix update is applied on top of the previous computation
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"prefix:2", createPrefixValue("2", 2, {addr2, addr4})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr4, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+
+  // withdrawal of the adjacency removes the routes
+  publication = thrift::Publication(FRAGILE, {}, {"adj:2"}, {}, {}, "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete,
+      testing::UnorderedElementsAre(addr2, addr4));
+
+  // computation counters come from the compute thread
+  auto counters = getCountersMap();
+  EXPECT_EQ(2, counters["decision.path_build_runs.count.0"]);
+  EXPECT_EQ(1, counters["decision.route_delta_build_runs.count.0"]);
+}
+
+//
+// Routes persisted before restart are published right away, and corrected by
+// the difference to the routes computed once graceful restart is over
+//
+class DecisionPersistedRouteDbFixture : public DecisionTestFixture {
+ protected:
+  void
+  SetUp() override {
+    configStore = std::make_unique<PersistentStore>(
+        "1",
+        folly::sformat(
+            "/tmp/decision_ut_config_store.bin.{}",
+            std::hash<std::thread::id>{}(std::this_thread::get_id())),
+        zeromqContext,
+        std::chrono::milliseconds(0),
+        std::chrono::milliseconds(0),
+        true /* dryrun */);
+    configStoreThread = std::make_unique<std::thread>([this]() noexcept {
+      configStore->run();
+    });
+    configStore->waitUntilRunning();
+
+    // routes of previous incarnation, route to addr3 is stale
+    thrift::RouteDatabase routeDb;
+    routeDb.thisNodeName = "1";
+    routeDb.unicastRoutes.emplace_back(createUnicastRoute(addr2, {}));
+    routeDb.unicastRoutes.emplace_back(createUnicastRoute(addr3, {}));
+    PersistentStoreClient configStoreClient{
+        PersistentStoreUrl{configStore->inprocCmdUrl}, zeromqContext};
+    EXPECT_TRUE(
+        configStoreClient.storeThriftObj("decision-route-db", routeDb).value());
+
+    DecisionTestFixture::SetUp();
+  }
+
+  void
+  TearDown() override {
+    DecisionTestFixture::TearDown();
+    configStore->stop();
+    configStoreThread->join();
+  }
+
+  folly::Optional<std::chrono::seconds>
+  gracefulRestartDuration() const override {
+    return std::chrono::seconds(2);
+  }
+
+  folly::Optional<PersistentStoreUrl>
+  configStoreUrl() const override {
+    return PersistentStoreUrl{configStore->inprocCmdUrl};
+  }
+
+  std::unique_ptr<PersistentStore> configStore;
+  std::unique_ptr<std::thread> configStoreThread;
+};
+
+TEST_F(DecisionPersistedRouteDbFixture, ColdStart) {
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+
+  // persisted routes as they were
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToDelete.size());
+
+  // after graceful restart only the difference to computed routes
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr2, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_LT(0, routeDbDelta.unicastRoutesToUpdate.at(0).nextHops.size());
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete, testing::UnorderedElementsAre(addr3));
+
+  // computed routes are persisted in turn
+  std::this_thread::sleep_for(
+      Constants::kPersistedRouteDbThrottleTimeout * 2);
+  PersistentStoreClient configStoreClient{
+      PersistentStoreUrl{configStore->inprocCmdUrl}, zeromqContext};
+  auto routeDb = configStoreClient.loadThriftObj<thrift::RouteDatabase>(
+      "decision-route-db");
+  ASSERT_TRUE(routeDb.hasValue());
+  ASSERT_EQ(1, routeDb->unicastRoutes.size());
+  EXPECT_EQ(dumpRouteDb({"1"})["1"].unicastRoutes, routeDb->unicastRoutes);
+}
+
+//
+// Routes of other nodes are cached until the next change of link state
+//
+TEST_F(DecisionTestFixture, RouteDbQueryCache) {
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  recvMyRouteDb(decisionPub, "1", serializer);
+
+  auto routeDb = dumpRouteDb({"2"})["2"];
+  ASSERT_EQ(1, routeDb.unicastRoutes.size());
+  EXPECT_EQ(addr1, routeDb.unicastRoutes.at(0).dest);
+  EXPECT_EQ(routeDb, dumpRouteDb({"2"})["2"]);
+  auto counters = getCountersMap();
+  // first miss is the dump of SetUp
+  EXPECT_EQ(1, counters["decision.route_db_query_cache_hits"]);
+  EXPECT_EQ(2, counters["decision.route_db_query_cache_misses"]);
+
+  // new prefix of node 1 shows up in routes of node 2
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"prefix:1", createPrefixValue("1", 2, {addr1, addr3})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  recvMyRouteDb(decisionPub, "1", serializer);
+  routeDb = dumpRouteDb({"2"})["2"];
+  EXPECT_EQ(2, routeDb.unicastRoutes.size());
+  counters = getCountersMap();
+  EXPECT_EQ(1, counters["decision.route_db_query_cache_hits"]);
+  EXPECT_EQ(3, counters["decision.route_db_query_cache_misses"]);
+}
+
+TEST_F(DecisionTestFixture, PrefixOnlyUpdateDelta) {
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2, addr3})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(2, routeDbDelta.unicastRoutesToUpdate.size());
+  auto counters = getCountersMap();
+  EXPECT_EQ(1, counters["decision.path_build_runs.count.0"]);
+
+  // withdraw addr3 and advertise addr4
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"prefix:2", createPrefixValue("2", 2, {addr2, addr4})}},
+      {},
+      {},
+      {},
+      "");
+  auto routeDbBefore = dumpRouteDb({"1"})["1"];
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr4, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToDelete.at(0));
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  auto routeDelta = findDeltaRoutes(routeDb, routeDbBefore);
+  EXPECT_TRUE(checkEqualRoutesDelta(routeDbDelta, routeDelta));
+
+  // no SPF run for the prefix update, only the dumps ran one each
+  counters = getCountersMap();
+  EXPECT_EQ(1, counters["decision.route_delta_build_runs.count.0"]);
+  EXPECT_EQ(3, counters["decision.path_build_runs.count.0"]);
+}
+
+//
+// Databases re-advertised unchanged under a new version are skipped, changed
+// ones are processed as usual
+//
+TEST_F(DecisionTestFixture, UnchangedValuesSkipped) {
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+
+  // same databases under new versions
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 2, {adj12})},
+       {"adj:2", createAdjValue("2", 2, {adj21})},
+       {"prefix:1", createPrefixValue("1", 2, {addr1})},
+       {"prefix:2", createPrefixValue("2", 2, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+
+  // changed database is processed
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"prefix:2", createPrefixValue("2", 3, {addr2, addr3})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr3, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+
+  auto counters = getCountersMap();
+  EXPECT_EQ(4, counters["decision.unchanged_values_skipped"]);
+  EXPECT_EQ(1, counters["decision.route_delta_build_runs.count.0"]);
+}
+
+//
+// In-process subscriber receives every published route delta
+//
+TEST_F(DecisionTestFixture, RouteDeltaCallback) {
+  folly::Synchronized<std::vector<thrift::RouteDatabaseDelta>> routeDeltas;
+  decision->setRouteDeltaCallback(
+      [&routeDeltas](thrift::RouteDatabaseDelta const& routeDelta) {
+        routeDeltas.wlock()->emplace_back(routeDelta);
+      });
+
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {"prefix:2", createPrefixValue("2", 1, {addr2, addr3})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  {
+    auto lockedRouteDeltas = routeDeltas.rlock();
+    ASSERT_EQ(1, lockedRouteDeltas->size());
+    EXPECT_EQ(
+        routeDbDelta.unicastRoutesToUpdate,
+        lockedRouteDeltas->at(0).unicastRoutesToUpdate);
+    EXPECT_TRUE(lockedRouteDeltas->at(0).nextHopGroups.empty());
+  }
+
+  // no more deltas once unset
+  decision->setRouteDeltaCallback(nullptr);
+  publication = thrift::Publication(
+      FRAGILE,
+      {{"prefix:2", createPrefixValue("2", 2, {addr2})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(1, routeDbDelta.unicastRoutesToDelete.size());
+  EXPECT_EQ(1, routeDeltas.rlock()->size());
+}
+
+//
+// Per prefix keys of a publication are ingested in a single batch
+//
+TEST_F(DecisionTestFixture, PerPrefixKeys) {
+  auto getPrefixKey = [](const thrift::IpPrefix& prefix) {
+    return PrefixKey("2", toIPNetwork(prefix), 0).getPrefixKey();
+  };
+
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {getPrefixKey(addr2), createPrefixValue("2", 1, {addr2})},
+       {getPrefixKey(addr3), createPrefixValue("2", 1, {addr3})},
+       {getPrefixKey(addr4), createPrefixValue("2", 1, {addr4})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(3, routeDbDelta.unicastRoutesToUpdate.size());
+  auto counters = getCountersMap();
+  EXPECT_EQ(1, counters["decision.prefix_db_batch_update.count.0"]);
+
+  // withdraw addr3 and advertise addr5 within the same publication
+  publication = thrift::Publication(
+      FRAGILE,
+      {{getPrefixKey(addr5), createPrefixValue("2", 1, {addr5})}},
+      {getPrefixKey(addr3)},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete, testing::UnorderedElementsAre(addr3));
+  counters = getCountersMap();
+  EXPECT_EQ(2, counters["decision.prefix_db_batch_update.count.0"]);
+
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  EXPECT_EQ(3, routeDb.unicastRoutes.size());
+}
+
+//
+// Prefix shards of a node are merged into its prefix database
+//
+TEST_F(DecisionTestFixture, PrefixShards) {
+  auto getShardKey = [](int32_t shard) {
+    return PrefixShardKey("2", shard).getPrefixShardKey();
+  };
+
+  auto publication = thrift::Publication(
+      FRAGILE,
+      {{"adj:1", createAdjValue("1", 1, {adj12})},
+       {"adj:2", createAdjValue("2", 1, {adj21})},
+       {"prefix:1", createPrefixValue("1", 1, {addr1})},
+       {getShardKey(0), createPrefixValue("2", 1, {addr2, addr3})},
+       {getShardKey(1), createPrefixValue("2", 1, {addr4})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  auto routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(3, routeDbDelta.unicastRoutesToUpdate.size());
+
+  // update of one shard leaves prefixes of other shards in place
+  publication = thrift::Publication(
+      FRAGILE,
+      {{getShardKey(0), createPrefixValue("2", 2, {addr2, addr5})}},
+      {},
+      {},
+      {},
+      "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  ASSERT_EQ(1, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(addr5, routeDbDelta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete, testing::UnorderedElementsAre(addr3));
+
+  // expiry of a shard withdraws its prefixes only
+  publication = thrift::Publication(FRAGILE, {}, {getShardKey(1)}, {}, {}, "");
+  sendKvPublication(publication);
+  routeDbDelta = recvMyRouteDb(decisionPub, "1", serializer);
+  EXPECT_EQ(0, routeDbDelta.unicastRoutesToUpdate.size());
+  EXPECT_THAT(
+      routeDbDelta.unicastRoutesToDelete, testing::UnorderedElementsAre(addr4));
+
+  auto routeDb = dumpRouteDb({"1"})["1"];
+  EXPECT_EQ(2, routeDb.unicastRoutes.size());
+}
+
 // The following topology is used:
 //
 //         100
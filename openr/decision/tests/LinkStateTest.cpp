@@ -100,6 +100,17 @@ TEST(LinkTest, BasicOperation) {
   EXPECT_EQ(adj2.adjLabel, l1.getAdjLabelFromNode(n2));
   EXPECT_THROW(l1.getAdjLabelFromNode("node3"), std::invalid_argument);
 
+  EXPECT_EQ(adj1.nextHopV4, l1.getNhV4FromNode(n1));
+  EXPECT_EQ(adj2.nextHopV6, l1.getNhV6FromNode(n2));
+  EXPECT_THROW(l1.getNhV4FromNode("node3"), std::invalid_argument);
+  l1.setNhV6FromNode(n1, openr::toBinaryAddress("fe80::3"));
+  EXPECT_EQ(openr::toBinaryAddress("fe80::3"), l1.getNhV6FromNode(n1));
+  l1.setNhV4FromNode(n2, openr::thrift::BinaryAddress());
+  EXPECT_EQ(openr::thrift::BinaryAddress(), l1.getNhV4FromNode(n2));
+
+  EXPECT_EQ(n1, l1.firstNodeName());
+  EXPECT_EQ(n2, l1.secondNodeName());
+
   EXPECT_FALSE(l1.getOverloadFromNode(n1));
   EXPECT_FALSE(l1.getOverloadFromNode(n2));
   EXPECT_TRUE(l1.isUp());
@@ -115,6 +126,8 @@ TEST(LinkTest, BasicOperation) {
 
   // compare equivalent links
   openr::Link l2(n2, adj2, n1, adj1);
+  EXPECT_EQ(n1, l2.firstNodeName());
+  EXPECT_EQ(l1.hash, l2.hash);
   EXPECT_TRUE(l1 == l2);
   EXPECT_FALSE(l1 < l2);
   EXPECT_FALSE(l2 < l1);
@@ -182,6 +195,129 @@ TEST(LinkStateTest, BasicOperation) {
   EXPECT_THROW(state.removeLink(l1), std::out_of_range);
 }
 
+TEST(LinkStateTest, HoldDeadlines) {
+  std::string n1 = "node1";
+  auto adj12 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  auto adj13 =
+      openr::createAdjacency(n1, "if3", "if1", "fe80::3", "10.0.0.3", 1, 1, 1);
+  std::string n2 = "node2";
+  auto adj21 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::1", "10.0.0.1", 1, 1, 1);
+  std::string n3 = "node3";
+  auto adj31 =
+      openr::createAdjacency(n3, "if1", "if3", "fe80::1", "10.0.0.1", 1, 1, 1);
+
+  auto l1 = std::make_shared<openr::Link>(n1, adj12, n2, adj21);
+  auto l2 = std::make_shared<openr::Link>(n3, adj31, n1, adj13);
+
+  openr::LinkState state;
+  state.addLink(l1);
+  state.addLink(l2);
+  EXPECT_EQ(0, state.getHoldTtl());
+  EXPECT_EQ(0, state.getNumHolds());
+
+  // l1 comes up in 3 ticks, metric of l2 changes in 5 ticks
+  l1->setHoldUpTtl(3);
+  EXPECT_FALSE(l2->setMetricFromNode(n3, 5, 5, 5));
+  EXPECT_EQ(3, state.getHoldTtl());
+  EXPECT_EQ(2, state.getNumHolds());
+  EXPECT_THAT(state.getLinksWithExpiringHolds(2), testing::IsEmpty());
+  EXPECT_THAT(
+      state.getLinksWithExpiringHolds(3), testing::UnorderedElementsAre(l1));
+
+  // ticks without expiry are decremented at once
+  EXPECT_FALSE(state.decrementHolds(2));
+  EXPECT_FALSE(l1->isUp());
+  EXPECT_EQ(1, state.getHoldTtl());
+  EXPECT_TRUE(state.decrementHolds(1));
+  EXPECT_TRUE(l1->isUp());
+  EXPECT_EQ(2, state.getHoldTtl());
+  EXPECT_EQ(1, state.getNumHolds());
+  EXPECT_EQ(1, l2->getMetricFromNode(n3));
+  EXPECT_TRUE(state.decrementHolds(2));
+  EXPECT_EQ(5, l2->getMetricFromNode(n3));
+  EXPECT_FALSE(state.hasHolds());
+  EXPECT_EQ(0, state.getHoldTtl());
+
+  // node overload holds
+  EXPECT_FALSE(state.updateNodeOverloaded(n2, false, 4, 4));
+  EXPECT_FALSE(state.updateNodeOverloaded(n2, true, 4, 4));
+  EXPECT_EQ(4, state.getHoldTtl());
+  EXPECT_THAT(state.getNodesWithExpiringHolds(3), testing::IsEmpty());
+  EXPECT_THAT(
+      state.getNodesWithExpiringHolds(4), testing::UnorderedElementsAre(n2));
+  EXPECT_FALSE(state.isNodeOverloaded(n2));
+  EXPECT_TRUE(state.decrementHolds(4));
+  EXPECT_TRUE(state.isNodeOverloaded(n2));
+}
+
+TEST(LinkStateTest, NodeIdsAndCsrGraph) {
+  std::string n1 = "node1";
+  auto adj12 =
+      openr::createAdjacency(n1, "if2", "if1", "fe80::2", "10.0.0.2", 1, 1, 1);
+  std::string n2 = "node2";
+  auto adj21 =
+      openr::createAdjacency(n2, "if1", "if2", "fe80::1", "10.0.0.1", 2, 1, 1);
+  auto adj23 =
+      openr::createAdjacency(n2, "if3", "if2", "fe80::3", "10.0.0.3", 3, 1, 1);
+  std::string n3 = "node3";
+  auto adj32 =
+      openr::createAdjacency(n3, "if2", "if3", "fe80::2", "10.0.0.2", 4, 1, 1);
+
+  auto l1 = std::make_shared<openr::Link>(n1, adj12, n2, adj21);
+  auto l2 = std::make_shared<openr::Link>(n2, adj23, n3, adj32);
+
+  openr::LinkState state;
+  EXPECT_FALSE(state.getNodeId(n1).hasValue());
+  EXPECT_EQ(0, state.getNumNodeIds());
+
+  state.addLink(l1);
+  state.addLink(l2);
+  EXPECT_EQ(3, state.getNumNodeIds());
+  ASSERT_TRUE(state.getNodeId(n1).hasValue());
+  ASSERT_TRUE(state.getNodeId(n2).hasValue());
+  ASSERT_TRUE(state.getNodeId(n3).hasValue());
+  auto id1 = state.getNodeId(n1).value();
+  auto id2 = state.getNodeId(n2).value();
+  auto id3 = state.getNodeId(n3).value();
+  EXPECT_EQ(n1, state.getNodeName(id1));
+  EXPECT_EQ(n2, state.getNodeName(id2));
+  EXPECT_EQ(n3, state.getNodeName(id3));
+  EXPECT_FALSE(state.getNodeId("node4").hasValue());
+
+  auto const& csr = state.getCsrGraph();
+  ASSERT_EQ(4, csr.offsets.size());
+  EXPECT_EQ(4, csr.edges.size());
+  EXPECT_EQ(1, csr.offsets[id1 + 1] - csr.offsets[id1]);
+  EXPECT_EQ(2, csr.offsets[id2 + 1] - csr.offsets[id2]);
+  EXPECT_EQ(1, csr.offsets[id3 + 1] - csr.offsets[id3]);
+
+  // edge metrics are directional
+  auto const& edge12 = csr.edges[csr.offsets[id1]];
+  EXPECT_EQ(id2, edge12.otherNodeId);
+  EXPECT_EQ(l1, edge12.link);
+  EXPECT_EQ(1, edge12.getMetric());
+  EXPECT_EQ(2, edge12.getReverseMetric());
+  auto const& edge32 = csr.edges[csr.offsets[id3]];
+  EXPECT_EQ(id2, edge32.otherNodeId);
+  EXPECT_EQ(4, edge32.getMetric());
+  EXPECT_EQ(3, edge32.getReverseMetric());
+
+  // metric changes are visible without a rebuild
+  EXPECT_TRUE(l1->setMetricFromNode(n1, 10, 0, 0));
+  EXPECT_EQ(10, state.getCsrGraph().edges[csr.offsets[id1]].getMetric());
+
+  // ids are stable across removal, edges are dropped
+  state.removeNode(n1);
+  EXPECT_EQ(3, state.getNumNodeIds());
+  EXPECT_EQ(id1, state.getNodeId(n1).value());
+  auto const& csr2 = state.getCsrGraph();
+  EXPECT_EQ(2, csr2.edges.size());
+  EXPECT_EQ(0, csr2.offsets[id1 + 1] - csr2.offsets[id1]);
+  EXPECT_EQ(1, csr2.offsets[id2 + 1] - csr2.offsets[id2]);
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
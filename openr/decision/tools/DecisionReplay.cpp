@@ -0,0 +1,280 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Replays publications recorded by Decision (--decision_record_file) into
+ * SpfSolver and reports the time taken to apply each batch of publications
+ * and to build routes for it, one line per route build, followed by
+ * percentiles of build times and SPF counters of the solver.
+ *
+ * Prefix databases of a node are merged from all of its prefix keys, whatever
+ * format the node advertises them in.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/Util.h>
+#include <openr/decision/Decision.h>
+#include <openr/decision/PublicationRecorder.h>
+
+DEFINE_string(record_file, "", "Publications recorded by Decision");
+DEFINE_string(node_name, "", "Node to build routes for, e.g. recording node");
+DEFINE_double(
+    speed,
+    0,
+    "Replay speed relative to time of recording, e.g. 1 for original and 10 "
+    "for 10x accelerated. 0 replays as fast as possible");
+DEFINE_int32(
+    debounce_ms,
+    0,
+    "Build routes once for publications recorded within this window of the "
+    "first one, as Decision debounces. 0 builds after every publication");
+DEFINE_bool(enable_v4, false, "Build IPv4 routes");
+DEFINE_bool(enable_lfa, false, "Compute loop free alternate paths");
+DEFINE_int32(lfa_spf_threads, 0, "Worker threads for LFA SPF runs");
+DEFINE_int32(route_build_threads, 0, "Worker threads for route builds");
+
+using namespace openr;
+
+namespace {
+
+// Applies publications to solver the way Decision does
+class LsdbReplayer {
+ public:
+  explicit LsdbReplayer(SpfSolver& solver) : solver_(solver) {}
+
+  // Returns true if routes may have changed
+  bool
+  apply(const thrift::Publication& publication) {
+    bool changed{false};
+    std::unordered_set<std::string> prefixNodes;
+
+    for (const auto& kv : publication.keyVals) {
+      const auto& key = kv.first;
+      if (not kv.second.value.hasValue()) {
+        continue;
+      }
+      const auto nodeName = getNodeNameFromKey(key);
+      try {
+        if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+          auto rc = solver_.updateAdjacencyDatabase(
+              readThriftValue<thrift::AdjacencyDatabase>(
+                  kv.second.value.value(), serializer_));
+          changed |= rc.first or rc.second;
+        } else if (key.find(Constants::kPrefixDbMarker.toString()) == 0) {
+          auto prefixDb = readThriftValue<thrift::PrefixDatabase>(
+              kv.second.value.value(), serializer_);
+          if (prefixDb.deletePrefix) {
+            nodePrefixKeys_[nodeName].erase(key);
+          } else {
+            nodePrefixKeys_[nodeName][key] = std::move(prefixDb);
+          }
+          prefixNodes.emplace(nodeName);
+        }
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to deserialize info for key " << key
+                   << ". Exception: " << folly::exceptionStr(e);
+      }
+    }
+
+    for (const auto& key : publication.expiredKeys) {
+      const auto nodeName = getNodeNameFromKey(key);
+      if (key.find(Constants::kAdjDbMarker.toString()) == 0) {
+        changed |= solver_.deleteAdjacencyDatabase(nodeName);
+      } else if (key.find(Constants::kPrefixDbMarker.toString()) == 0) {
+        nodePrefixKeys_[nodeName].erase(key);
+        prefixNodes.emplace(nodeName);
+      }
+    }
+
+    std::vector<thrift::PrefixDatabase> prefixDbs;
+    for (const auto& nodeName : prefixNodes) {
+      auto& prefixKeys = nodePrefixKeys_[nodeName];
+      if (prefixKeys.empty()) {
+        nodePrefixKeys_.erase(nodeName);
+        changed |= solver_.deletePrefixDatabase(nodeName);
+        continue;
+      }
+      std::map<thrift::IpPrefix, thrift::PrefixEntry> prefixEntries;
+      for (const auto& kv : prefixKeys) {
+        for (const auto& entry : kv.second.prefixEntries) {
+          prefixEntries[entry.prefix] = entry;
+        }
+      }
+      thrift::PrefixDatabase prefixDb;
+      prefixDb.thisNodeName = nodeName;
+      for (auto& kv : prefixEntries) {
+        prefixDb.prefixEntries.emplace_back(std::move(kv.second));
+      }
+      prefixDbs.emplace_back(std::move(prefixDb));
+    }
+    if (not prefixDbs.empty()) {
+      changed |= solver_.updatePrefixDatabases(prefixDbs);
+    }
+    return changed;
+  }
+
+ private:
+  SpfSolver& solver_;
+  apache::thrift::CompactSerializer serializer_;
+
+  // live prefix keys of every node, merged into its prefix database
+  std::unordered_map<
+      std::string /* nodeName */,
+      std::map<std::string /* key */, thrift::PrefixDatabase>>
+      nodePrefixKeys_;
+};
+
+int64_t
+getPercentile(const std::vector<int64_t>& sortedValues, double percentile) {
+  const auto rank = static_cast<size_t>(percentile * sortedValues.size());
+  return sortedValues.at(std::min(rank, sortedValues.size() - 1));
+}
+
+int64_t
+getDurationUs(
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+      .count();
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  CHECK(not FLAGS_record_file.empty()) << "--record_file is required";
+  CHECK(not FLAGS_node_name.empty()) << "--node_name is required";
+  CHECK_LE(0, FLAGS_speed);
+
+  auto records = PublicationRecorder::readRecords(FLAGS_record_file);
+  if (records.hasError()) {
+    LOG(ERROR) << records.error();
+    return 1;
+  }
+  if (records->empty()) {
+    LOG(ERROR) << "No publications recorded in " << FLAGS_record_file;
+    return 1;
+  }
+  LOG(INFO) << "Replaying " << records->size() << " publications";
+
+  SpfSolver solver(
+      FLAGS_node_name,
+      FLAGS_enable_v4,
+      FLAGS_enable_lfa,
+      false /* enableOrderedFib */,
+      false /* bgpDryRun */,
+      std::max(0, FLAGS_lfa_spf_threads),
+      std::max(0, FLAGS_route_build_threads));
+  LsdbReplayer replayer(solver);
+
+  const auto replayStart = std::chrono::steady_clock::now();
+  const auto firstTimestampUs = records->front().timestampUs;
+  std::vector<int64_t> buildDurationsUs;
+
+  // publications applied since last route build
+  size_t numPending{0};
+  size_t numKeys{0};
+  int64_t applyDurationUs{0};
+  bool changed{false};
+
+  std::cout << "offset_ms\tpublications\tkeys\tapply_us\tbuild_us\t"
+            << "routes_changed" << std::endl;
+  for (size_t i = 0; i < records->size(); ++i) {
+    const auto& record = records->at(i);
+    const auto offset =
+        std::chrono::microseconds(record.timestampUs - firstTimestampUs);
+    if (FLAGS_speed > 0) {
+      std::this_thread::sleep_until(
+          replayStart +
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              offset / FLAGS_speed));
+    }
+
+    const auto applyStart = std::chrono::steady_clock::now();
+    changed |= replayer.apply(record.publication);
+    applyDurationUs +=
+        getDurationUs(applyStart, std::chrono::steady_clock::now());
+    numKeys += record.publication.keyVals.size() +
+        record.publication.expiredKeys.size();
+    ++numPending;
+
+    // Build once the next publication is out of the debounce window
+    const auto pendingSinceUs =
+        records->at(i + 1 - numPending).timestampUs;
+    if (i + 1 < records->size() and
+        records->at(i + 1).timestampUs - pendingSinceUs <
+            FLAGS_debounce_ms * 1000) {
+      continue;
+    }
+
+    int64_t buildDurationUs{0};
+    size_t numRoutesChanged{0};
+    if (changed) {
+      const auto buildStart = std::chrono::steady_clock::now();
+      auto routeDbDelta = solver.buildRouteDbDelta(FLAGS_node_name);
+      buildDurationUs =
+          getDurationUs(buildStart, std::chrono::steady_clock::now());
+      buildDurationsUs.emplace_back(buildDurationUs);
+      if (routeDbDelta.hasValue()) {
+        numRoutesChanged = routeDbDelta->unicastRoutesToUpdate.size() +
+            routeDbDelta->unicastRoutesToDelete.size() +
+            routeDbDelta->mplsRoutesToUpdate.size() +
+            routeDbDelta->mplsRoutesToDelete.size();
+      }
+    }
+    std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(offset)
+                     .count()
+              << "\t" << numPending << "\t" << numKeys << "\t"
+              << applyDurationUs << "\t" << buildDurationUs << "\t"
+              << numRoutesChanged << std::endl;
+
+    numPending = 0;
+    numKeys = 0;
+    applyDurationUs = 0;
+    changed = false;
+  }
+
+  std::cout << std::endl;
+  std::cout << "route_builds: " << buildDurationsUs.size() << std::endl;
+  if (not buildDurationsUs.empty()) {
+    std::sort(buildDurationsUs.begin(), buildDurationsUs.end());
+    std::cout << folly::sformat(
+                     "build_us: p50 {} p90 {} p99 {} max {}",
+                     getPercentile(buildDurationsUs, 0.5),
+                     getPercentile(buildDurationsUs, 0.9),
+                     getPercentile(buildDurationsUs, 0.99),
+                     buildDurationsUs.back())
+              << std::endl;
+  }
+
+  // SPF and route build counters of the solver, e.g. number of SPF runs
+  const auto solverCounters = solver.getCounters();
+  const std::map<std::string, int64_t> counters(
+      solverCounters.begin(), solverCounters.end());
+  for (const auto& kv : counters) {
+    if (kv.first.find("decision.spf") == 0 or
+        kv.first.find("decision.incremental_spf") == 0 or
+        kv.first.find("decision.route_build") == 0) {
+      std::cout << kv.first << ": " << kv.second << std::endl;
+    }
+  }
+  return 0;
+}
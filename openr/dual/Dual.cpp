@@ -64,14 +64,12 @@ DualStateMachine::processEvent(DualEvent event, bool fc) {
 Dual::Dual(
     const std::string& nodeId,
     const std::string& rootId,
-    const std::unordered_map<std::string, int64_t>& localDistance,
-    std::function<void(
-        const folly::Optional<std::string>& oldNh,
-        const folly::Optional<std::string>& newNh)> nexthopChangeCb)
+    const std::vector<DualNeighbor>& neighbors,
+    const DualNexthopChangeCb& nexthopChangeCb)
     : nodeId(nodeId),
       rootId(rootId),
-      localDistances_(localDistance),
-      nexthopCb_(std::move(nexthopChangeCb)) {
+      neighbors_(neighbors),
+      nexthopCb_(nexthopChangeCb) {
   // set distance to 0 if I'm the root, otherwise default to inf
   if (rootId == nodeId) {
     info_.distance = 0;
@@ -79,6 +77,38 @@ Dual::Dual(
     info_.feasibleDistance = 0;
     info_.nexthop = nodeId;
   }
+  addNeighbors();
+}
+
+void
+Dual::addNeighbors() {
+  if (info_.neighborInfos.size() < neighbors_.size()) {
+    info_.neighborInfos.resize(neighbors_.size());
+    counters_.resize(neighbors_.size());
+  }
+}
+
+const std::string&
+Dual::neighborName(DualNeighborId neighbor) const {
+  return neighbors_.at(neighbor).name;
+}
+
+bool
+Dual::isNexthop(DualNeighborId neighbor) const {
+  return nexthopId_.hasValue() and *nexthopId_ == neighbor;
+}
+
+void
+Dual::setNexthop(const folly::Optional<DualNeighborId>& nexthop) {
+  folly::Optional<std::string> newNh = folly::none;
+  if (nexthop.hasValue()) {
+    newNh = neighborName(*nexthop);
+  }
+  if (nexthopCb_) {
+    nexthopCb_(rootId, info_.nexthop, newNh);
+  }
+  info_.nexthop = std::move(newNh);
+  nexthopId_ = nexthop;
 }
 
 int64_t
@@ -88,9 +118,9 @@ Dual::getMinDistance() {
     return 0;
   }
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  for (const auto& kv : localDistances_) {
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[kv.first].reportDistance;
+  for (DualNeighborId nb = 0; nb < neighbors_.size(); ++nb) {
+    const auto& ld = neighbors_[nb].distance;
+    const auto& rd = info_.neighborInfos[nb].reportDistance;
     dmin = std::min(dmin, addDistances(ld, rd));
   }
   return dmin;
@@ -98,7 +128,10 @@ Dual::getMinDistance() {
 
 bool
 Dual::routeAffected() {
-  if (localDistances_.size() == 0) {
+  if (std::none_of(
+          neighbors_.begin(), neighbors_.end(), [](const auto& neighbor) {
+            return neighbor.hasLinkEvent;
+          })) {
     // no neighbor
     return false;
   }
@@ -121,46 +154,36 @@ Dual::routeAffected() {
     return false;
   }
 
-  std::unordered_set<std::string> nexthops;
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
-    int64_t d = addDistances(ld, rd);
-    if (d == dmin) {
-      nexthops.emplace(neighbor);
-    }
-  }
-
   // nexthop MUST has value, if it's none, it will be handled in
   // above "distance changed" or "no valid route found" cases
-  CHECK(info_.nexthop.hasValue());
-  if (nexthops.count(*info_.nexthop) == 0) {
+  CHECK(nexthopId_.hasValue());
+  const auto& nh = *nexthopId_;
+  if (addDistances(
+          neighbors_[nh].distance, info_.neighborInfos[nh].reportDistance) !=
+      dmin) {
     // nextHop changed
-    auto oldnh = info_.nexthop.hasValue() ? *info_.nexthop : "none";
-    VLOG(2) << rootId << "::" << nodeId << ": nexthop changed " << oldnh
-            << " -> " << folly::join(",", nexthops);
+    VLOG(2) << rootId << "::" << nodeId << ": nexthop " << neighborName(nh)
+            << " no longer on shortest path";
     return true;
   }
   return false;
 }
 
 bool
-Dual::meetFeasibleCondition(std::string& nexthop, int64_t& distance) {
+Dual::meetFeasibleCondition(DualNeighborId& nexthop, int64_t& distance) {
   int64_t dmin = getMinDistance();
   // find feasible nexthop according to SNC(source node condition)
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    const auto& ld = kv.second;
+  for (DualNeighborId nb = 0; nb < neighbors_.size(); ++nb) {
+    const auto& ld = neighbors_[nb].distance;
     if (ld == std::numeric_limits<int64_t>::max()) {
       // skip down neighbor
       continue;
     }
-    const auto& rd = info_.neighborInfos[neighbor].reportDistance;
+    const auto& rd = info_.neighborInfos[nb].reportDistance;
     if (rd < info_.feasibleDistance and addDistances(ld, rd) == dmin) {
-      VLOG(2) << rootId << "::" << nodeId << ": meet FC: " << neighbor << ", "
-              << rd << ", " << dmin;
-      nexthop = neighbor;
+      VLOG(2) << rootId << "::" << nodeId << ": meet FC: " << neighborName(nb)
+              << ", " << rd << ", " << dmin;
+      nexthop = nb;
       distance = dmin;
       return true;
     }
@@ -176,30 +199,26 @@ Dual::floodUpdates(
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::UPDATE;
 
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+  for (DualNeighborId nb = 0; nb < neighbors_.size(); ++nb) {
+    if (not neighborUp(nb)) {
       // skip down neighbor
       continue;
     }
-    msgsToSend[neighbor].messages.emplace_back(msg);
-    counters_[neighbor].updateSent++;
-    counters_[neighbor].totalSent++;
+    msgsToSend[neighborName(nb)].messages.emplace_back(msg);
+    counters_[nb].updateSent++;
+    counters_[nb].totalSent++;
   }
 }
 
 void
 Dual::localComputation(
-    const std::string& newNexthop,
+    DualNeighborId newNexthop,
     int64_t newDistance,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   bool sameRd = newDistance == info_.reportDistance;
   // perform local update
-  if (info_.nexthop != newNexthop) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, newNexthop);
-    }
-    info_.nexthop = newNexthop;
+  if (not isNexthop(newNexthop)) {
+    setNexthop(newNexthop);
   }
   info_.distance = newDistance;
   info_.reportDistance = newDistance;
@@ -214,8 +233,8 @@ bool
 Dual::diffusingComputation(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   // maintain current nexthop, update other fields
-  auto ld = localDistances_[*info_.nexthop];
-  auto rd = info_.neighborInfos[*info_.nexthop].reportDistance;
+  auto ld = neighbors_[*nexthopId_].distance;
+  auto rd = info_.neighborInfos[*nexthopId_].reportDistance;
   int64_t newDistance = addDistances(ld, rd);
   info_.distance = newDistance;
   info_.reportDistance = newDistance;
@@ -229,17 +248,16 @@ Dual::diffusingComputation(
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::QUERY;
 
-  for (const auto& kv : localDistances_) {
-    const auto& neighbor = kv.first;
-    if (kv.second == std::numeric_limits<int64_t>::max()) {
+  for (DualNeighborId nb = 0; nb < neighbors_.size(); ++nb) {
+    if (not neighborUp(nb)) {
       // skip down neighbor
       continue;
     }
 
-    msgsToSend[neighbor].messages.emplace_back(msg);
-    counters_[neighbor].querySent++;
-    counters_[neighbor].totalSent++;
-    info_.neighborInfos[neighbor].expectReply = true;
+    msgsToSend[neighborName(nb)].messages.emplace_back(msg);
+    counters_[nb].querySent++;
+    counters_[nb].totalSent++;
+    info_.neighborInfos[nb].expectReply = true;
     success = true;
   }
   return success;
@@ -258,7 +276,7 @@ Dual::tryLocalOrDiffusing(
     return;
   }
 
-  std::string newNexthop;
+  DualNeighborId newNexthop;
   int64_t newDistance;
   bool fc = meetFeasibleCondition(newNexthop, newDistance);
   if (not info_.nexthop.hasValue()) {
@@ -282,12 +300,9 @@ Dual::tryLocalOrDiffusing(
     if (success) {
       info_.sm.processEvent(event, false);
     }
-    if (info_.nexthop.hasValue() and not neighborUp(*info_.nexthop)) {
+    if (nexthopId_.hasValue() and not neighborUp(*nexthopId_)) {
       // current successor is down
-      if (nexthopCb_) {
-        nexthopCb_(info_.nexthop, folly::none);
-      }
-      info_.nexthop = folly::none;
+      setNexthop(folly::none);
     }
   }
 }
@@ -295,12 +310,11 @@ Dual::tryLocalOrDiffusing(
 std::string
 Dual::getStatusString() const noexcept {
   std::vector<std::string> counterStrs;
-  for (const auto& kv : counters_) {
-    const auto& neighbor = kv.first;
-    const auto& counters = kv.second;
+  for (DualNeighborId nb = 0; nb < counters_.size(); ++nb) {
+    const auto& counters = counters_[nb];
     counterStrs.emplace_back(folly::sformat(
         "{}: Q ({}, {}), R ({}, {}), U ({}, {}), total ({}, {})",
-        neighbor,
+        neighborName(nb),
         counters.querySent,
         counters.queryRecv,
         counters.replySent,
@@ -320,12 +334,16 @@ Dual::getStatusString() const noexcept {
 
 std::map<std::string, thrift::DualPerRootCounters>
 Dual::getCounters() const noexcept {
-  return counters_;
+  std::map<std::string, thrift::DualPerRootCounters> counters;
+  for (DualNeighborId nb = 0; nb < counters_.size(); ++nb) {
+    counters.emplace(neighborName(nb), counters_[nb]);
+  }
+  return counters;
 }
 
 void
-Dual::clearCounters(const std::string& neighbor) noexcept {
-  if (counters_.count(neighbor) == 0) {
+Dual::clearCounters(DualNeighborId neighbor) noexcept {
+  if (neighbor >= counters_.size()) {
     LOG(WARNING) << "clearCounters called on non-existing neighbor "
                  << neighbor;
     return;
@@ -351,17 +369,15 @@ Dual::removeChild(const std::string& child) noexcept {
   children_.erase(child);
 }
 
-std::unordered_set<std::string>
+const std::unordered_set<std::string>&
 Dual::children() const noexcept {
   return children_;
 }
 
 bool
-Dual::neighborUp(const std::string& neighbor) {
-  if (localDistances_.count(neighbor) == 0) {
-    return false;
-  }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+Dual::neighborUp(DualNeighborId neighbor) const {
+  return neighbors_.at(neighbor).distance !=
+      std::numeric_limits<int64_t>::max();
 }
 
 const Dual::RouteInfo&
@@ -400,27 +416,21 @@ Dual::addDistances(int64_t d1, int64_t d2) {
 
 void
 Dual::peerUp(
-    const std::string& neighbor,
-    int64_t cost,
+    DualNeighborId neighbor,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
-  LOG(INFO) << rootId << "::" << nodeId << ": LINK UP event from (" << neighbor
-            << ", " << cost << ")";
+  addNeighbors();
+  const auto& name = neighborName(neighbor);
+  LOG(INFO) << rootId << "::" << nodeId << ": LINK UP event from (" << name
+            << ", " << neighbors_[neighbor].distance << ")";
 
   // reset parent, if I chose this neighbor as parent before, but I didn't
   // receive peer-down event(non-graceful shutdown), reset nexthop and distance
   // as-if we received peer-down event before.
-  if (info_.nexthop.hasValue() and *info_.nexthop == neighbor) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, folly::none);
-    }
-    info_.nexthop = folly::none;
+  if (isNexthop(neighbor)) {
+    setNexthop(folly::none);
     info_.distance = std::numeric_limits<int64_t>::max();
   }
 
-  // update local-distance
-  localDistances_[neighbor] = cost;
-  info_.neighborInfos.emplace(neighbor, NeighborInfo());
-
   if (info_.sm.state == DualState::PASSIVE) {
     // passive
     tryLocalOrDiffusing(DualEvent::OTHERS, false, msgsToSend);
@@ -446,18 +456,18 @@ Dual::peerUp(
   msg.dstId = rootId;
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::UPDATE;
-  msgsToSend[neighbor].messages.emplace_back(std::move(msg));
+  msgsToSend[name].messages.emplace_back(std::move(msg));
   counters_[neighbor].updateSent++;
   counters_[neighbor].totalSent++;
 
   if (info_.neighborInfos[neighbor].needToReply) {
-    info_.neighborInfos.at(neighbor).needToReply = false;
+    info_.neighborInfos[neighbor].needToReply = false;
 
     thrift::DualMessage reply;
     reply.dstId = rootId;
     reply.distance = info_.reportDistance;
     reply.type = thrift::DualMessageType::REPLY;
-    msgsToSend[neighbor].messages.emplace_back(std::move(reply));
+    msgsToSend[name].messages.emplace_back(std::move(reply));
     counters_[neighbor].replySent++;
     counters_[neighbor].totalSent++;
   }
@@ -465,18 +475,18 @@ Dual::peerUp(
 
 void
 Dual::peerDown(
-    const std::string& neighbor,
+    DualNeighborId neighbor,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  addNeighbors();
   LOG(INFO) << rootId << "::" << nodeId << ": LINK DOWN event from "
-            << neighbor;
+            << neighborName(neighbor);
   // clear counters
   clearCounters(neighbor);
 
   // remove child
-  removeChild(neighbor);
+  removeChild(neighborName(neighbor));
 
-  // update local-distance and report-distance
-  localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
+  // update report-distance
   info_.neighborInfos[neighbor].reportDistance =
       std::numeric_limits<int64_t>::max();
   DualEvent event = DualEvent::INCREASE_D;
@@ -502,15 +512,14 @@ Dual::peerDown(
 
 void
 Dual::peerCostChange(
-    const std::string& neighbor,
-    int64_t cost,
+    DualNeighborId neighbor,
+    int64_t oldCost,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  addNeighbors();
+  const auto& cost = neighbors_[neighbor].distance;
   LOG(INFO) << rootId << "::" << nodeId << ": LINK COST event from ("
-            << neighbor << ", " << cost << ")";
-  DualEvent event = cost > localDistances_[neighbor] ? DualEvent::INCREASE_D
-                                                     : DualEvent::OTHERS;
-  // update local-distance
-  localDistances_[neighbor] = cost;
+            << neighborName(neighbor) << ", " << cost << ")";
+  DualEvent event = cost > oldCost ? DualEvent::INCREASE_D : DualEvent::OTHERS;
 
   if (info_.sm.state == DualState::PASSIVE) {
     // passive
@@ -518,9 +527,9 @@ Dual::peerCostChange(
   } else {
     // active
     // only update d while leaving rd, fd as-is
-    if (info_.nexthop.hasValue() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(
-          cost, info_.neighborInfos[*info_.nexthop].reportDistance);
+    if (isNexthop(neighbor)) {
+      info_.distance =
+          addDistances(cost, info_.neighborInfos[neighbor].reportDistance);
     }
     info_.sm.processEvent(event);
   }
@@ -528,23 +537,24 @@ Dual::peerCostChange(
 
 void
 Dual::processUpdate(
-    const std::string& neighbor,
+    DualNeighborId neighbor,
     const thrift::DualMessage& update,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   CHECK(update.type == thrift::DualMessageType::UPDATE);
   CHECK_EQ(update.dstId, rootId) << "received update dst-id: " << update.dstId
                                  << " != my-root-id: " << rootId;
+  addNeighbors();
 
   const auto& rd = update.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received UPDATE from (" << neighbor
-          << ", " << rd << ")";
+  VLOG(2) << rootId << "::" << nodeId << ": received UPDATE from ("
+          << neighborName(neighbor) << ", " << rd << ")";
   counters_[neighbor].updateRecv++;
   counters_[neighbor].totalRecv++;
 
   // update report-distance
   info_.neighborInfos[neighbor].reportDistance = rd;
 
-  if (localDistances_.count(neighbor) == 0) {
+  if (not neighbors_[neighbor].hasLinkEvent) {
     // received UPDATE before having local info_ (LINK-UP), done here
     return;
   }
@@ -555,8 +565,8 @@ Dual::processUpdate(
   } else {
     // active
     // only update d while leaving rd, fd as-is
-    if (info_.nexthop.hasValue() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(localDistances_[*info_.nexthop], rd);
+    if (isNexthop(neighbor)) {
+      info_.distance = addDistances(neighbors_[neighbor].distance, rd);
     }
     info_.sm.processEvent(DualEvent::OTHERS);
   }
@@ -567,7 +577,7 @@ Dual::sendReply(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   CHECK_GT(info_.cornet.size(), 0) << "send reply called on empty cornet";
 
-  std::string dstNode = info_.cornet.top();
+  const auto dstNode = info_.cornet.top();
   info_.cornet.pop();
 
   if (not neighborUp(dstNode)) {
@@ -587,23 +597,24 @@ Dual::sendReply(
   msg.distance = info_.reportDistance;
   msg.type = thrift::DualMessageType::REPLY;
 
-  msgsToSend[dstNode].messages.emplace_back(std::move(msg));
+  msgsToSend[neighborName(dstNode)].messages.emplace_back(std::move(msg));
   counters_[dstNode].replySent++;
   counters_[dstNode].totalSent++;
 }
 
 void
 Dual::processQuery(
-    const std::string& neighbor,
+    DualNeighborId neighbor,
     const thrift::DualMessage& query,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   CHECK(query.type == thrift::DualMessageType::QUERY);
   CHECK_EQ(query.dstId, rootId) << "received query dst-id: " << query.dstId
                                 << " != my-root-id: " << rootId;
+  addNeighbors();
 
   const auto& rd = query.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received QUERY from (" << neighbor
-          << ", " << rd << ")";
+  VLOG(2) << rootId << "::" << nodeId << ": received QUERY from ("
+          << neighborName(neighbor) << ", " << rd << ")";
   counters_[neighbor].queryRecv++;
   counters_[neighbor].totalRecv++;
 
@@ -611,7 +622,7 @@ Dual::processQuery(
   info_.neighborInfos[neighbor].reportDistance = rd;
   info_.cornet.emplace(neighbor);
   DualEvent event = DualEvent::OTHERS;
-  if (info_.nexthop.hasValue() and *info_.nexthop == neighbor) {
+  if (isNexthop(neighbor)) {
     event = DualEvent::QUERY_FROM_SUCCESSOR;
   }
 
@@ -620,10 +631,8 @@ Dual::processQuery(
     tryLocalOrDiffusing(event, true /* need reply */, msgsToSend);
   } else {
     // active
-    if (info_.nexthop.hasValue() and *info_.nexthop == neighbor) {
-      info_.distance = addDistances(
-          localDistances_[*info_.nexthop],
-          info_.neighborInfos[*info_.nexthop].reportDistance);
+    if (isNexthop(neighbor)) {
+      info_.distance = addDistances(neighbors_[neighbor].distance, rd);
     }
     info_.sm.processEvent(event);
     sendReply(msgsToSend);
@@ -632,16 +641,17 @@ Dual::processQuery(
 
 void
 Dual::processReply(
-    const std::string& neighbor,
+    DualNeighborId neighbor,
     const thrift::DualMessage& reply,
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   CHECK(reply.type == thrift::DualMessageType::REPLY);
   CHECK_EQ(reply.dstId, rootId) << "received reply dst-id: " << reply.dstId
                                 << " != my-root-id: " << rootId;
+  addNeighbors();
 
   const auto& reportDistance = reply.distance;
-  VLOG(2) << rootId << "::" << nodeId << ": received REPLY from (" << neighbor
-          << ", " << reportDistance << ")";
+  VLOG(2) << rootId << "::" << nodeId << ": received REPLY from ("
+          << neighborName(neighbor) << ", " << reportDistance << ")";
   counters_[neighbor].replyRecv++;
   counters_[neighbor].totalRecv++;
 
@@ -649,8 +659,8 @@ Dual::processReply(
     // received a reply when I don't expect to receive a reply from it
     // this is OK, this can happen when I detect link-down event before I
     // receive the reply, just ignore it.
-    VLOG(2) << rootId << "::" << nodeId << " recv REPLY from " << neighbor
-            << " while I dont expect a reply, ignore it";
+    VLOG(2) << rootId << "::" << nodeId << " recv REPLY from "
+            << neighborName(neighbor) << " while I dont expect a reply, ignore";
     return;
   }
 
@@ -660,8 +670,8 @@ Dual::processReply(
   info_.neighborInfos[neighbor].expectReply = false;
 
   bool lastReply = true;
-  for (const auto& kv : info_.neighborInfos) {
-    if (kv.second.expectReply) {
+  for (const auto& neighborInfo : info_.neighborInfos) {
+    if (neighborInfo.expectReply) {
       lastReply = false;
       break;
     }
@@ -677,10 +687,9 @@ Dual::processReply(
 
   int64_t d;
   int64_t dmin = std::numeric_limits<int64_t>::max();
-  folly::Optional<std::string> newNh = folly::none;
-  for (const auto& kv : localDistances_) {
-    const auto& nb = kv.first;
-    const auto& ld = kv.second;
+  folly::Optional<DualNeighborId> newNh = folly::none;
+  for (DualNeighborId nb = 0; nb < neighbors_.size(); ++nb) {
+    const auto& ld = neighbors_[nb].distance;
     const auto& rd = info_.neighborInfos[nb].reportDistance;
     d = addDistances(ld, rd);
     if (d < dmin) {
@@ -692,11 +701,8 @@ Dual::processReply(
   info_.distance = dmin;
   info_.reportDistance = dmin;
   info_.feasibleDistance = dmin;
-  if (info_.nexthop != newNh) {
-    if (nexthopCb_) {
-      nexthopCb_(info_.nexthop, newNh);
-    }
-    info_.nexthop = newNh;
+  if (nexthopId_ != newNh) {
+    setNexthop(newNh);
   }
   if (not sameRd) {
     floodUpdates(msgsToSend);
@@ -713,8 +719,17 @@ Dual::processReply(
 
 // class DualNode methods
 
-DualNode::DualNode(const std::string& nodeId, bool isRoot)
-    : nodeId(nodeId), isRoot(isRoot) {
+DualNode::DualNode(
+    const std::string& nodeId, bool isRoot, bool batchMessages)
+    : nodeId(nodeId),
+      isRoot(isRoot),
+      nexthopCb_([this](
+                     const std::string& rootId,
+                     const folly::Optional<std::string>& oldNh,
+                     const folly::Optional<std::string>& newNh) {
+        processNexthopChange(rootId, oldNh, newNh);
+      }),
+      batchMessages_(batchMessages) {
   if (isRoot) {
     addDual(nodeId);
   }
@@ -723,12 +738,14 @@ DualNode::DualNode(const std::string& nodeId, bool isRoot)
 void
 DualNode::peerUp(const std::string& neighbor, int64_t cost) {
   // update local-distance
-  localDistances_[neighbor] = cost;
+  const auto neighborId = getNeighborId(neighbor);
+  neighbors_[neighborId].distance = cost;
+  neighbors_[neighborId].hasLinkEvent = true;
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
   for (auto& kv : duals_) {
-    kv.second.peerUp(neighbor, cost, msgsToSend);
+    kv.second.peerUp(neighborId, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -737,14 +754,18 @@ DualNode::peerUp(const std::string& neighbor, int64_t cost) {
 void
 DualNode::peerDown(const std::string& neighbor) {
   // update local-distance
-  localDistances_[neighbor] = std::numeric_limits<int64_t>::max();
+  const auto neighborId = getNeighborId(neighbor);
+  neighbors_[neighborId].distance = std::numeric_limits<int64_t>::max();
+  neighbors_[neighborId].hasLinkEvent = true;
   // clear counters
   clearCounters(neighbor);
+  // drop messages queued for neighbor
+  pendingMsgs_.erase(neighbor);
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
   for (auto& kv : duals_) {
-    kv.second.peerDown(neighbor, msgsToSend);
+    kv.second.peerDown(neighborId, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -753,12 +774,15 @@ DualNode::peerDown(const std::string& neighbor) {
 void
 DualNode::peerCostChange(const std::string& neighbor, int64_t cost) {
   // update local-distance
-  localDistances_[neighbor] = cost;
+  const auto neighborId = getNeighborId(neighbor);
+  const auto oldCost = neighbors_[neighborId].distance;
+  neighbors_[neighborId].distance = cost;
+  neighbors_[neighborId].hasLinkEvent = true;
 
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
 
   for (auto& kv : duals_) {
-    kv.second.peerCostChange(neighbor, cost, msgsToSend);
+    kv.second.peerCostChange(neighborId, oldCost, msgsToSend);
   }
 
   sendAllDualMessages(msgsToSend);
@@ -820,6 +844,7 @@ void
 DualNode::processDualMessages(const thrift::DualMessages& messages) {
   std::unordered_map<std::string, thrift::DualMessages> msgsToSend;
   const auto& neighbor = messages.srcId;
+  const auto neighborId = getNeighborId(neighbor);
 
   counters_[neighbor].pktRecv++;
   counters_[neighbor].msgRecv += messages.messages.size();
@@ -830,15 +855,15 @@ DualNode::processDualMessages(const thrift::DualMessages& messages) {
     auto& dual = duals_.at(rootId);
     switch (msg.type) {
     case thrift::DualMessageType::UPDATE: {
-      dual.processUpdate(neighbor, msg, msgsToSend);
+      dual.processUpdate(neighborId, msg, msgsToSend);
       break;
     }
     case thrift::DualMessageType::QUERY: {
-      dual.processQuery(neighbor, msg, msgsToSend);
+      dual.processQuery(neighborId, msg, msgsToSend);
       break;
     }
     case thrift::DualMessageType::REPLY: {
-      dual.processReply(neighbor, msg, msgsToSend);
+      dual.processReply(neighborId, msg, msgsToSend);
       break;
     }
     default: {
@@ -903,10 +928,12 @@ DualNode::getStatusStrings() const noexcept {
 
 bool
 DualNode::neighborUp(const std::string& neighbor) const noexcept {
-  if (localDistances_.count(neighbor) == 0) {
+  const auto it = neighborIds_.find(neighbor);
+  if (it == neighborIds_.end()) {
     return false;
   }
-  return localDistances_.at(neighbor) != std::numeric_limits<int64_t>::max();
+  return neighbors_.at(it->second).distance !=
+      std::numeric_limits<int64_t>::max();
 }
 
 thrift::DualCounters
@@ -929,9 +956,59 @@ DualNode::clearCounters(const std::string& neighbor) noexcept {
   counters_[neighbor] = thrift::DualPerNeighborCounters();
 }
 
+void
+DualNode::flushDualMessages() {
+  auto msgsToSend = std::move(pendingMsgs_);
+  pendingMsgs_.clear();
+  sendDualMessagesToNeighbors(msgsToSend);
+}
+
 void
 DualNode::sendAllDualMessages(
     std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  if (batchMessages_) {
+    queueDualMessages(msgsToSend);
+    return;
+  }
+  sendDualMessagesToNeighbors(msgsToSend);
+}
+
+void
+DualNode::queueDualMessages(
+    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
+  const bool hadPendingMsgs = not pendingMsgs_.empty();
+  for (auto& kv : msgsToSend) {
+    const auto& neighbor = kv.first;
+    if (kv.second.messages.empty()) {
+      continue;
+    }
+    auto& pending = pendingMsgs_[neighbor].messages;
+    for (auto& msg : kv.second.messages) {
+      if (msg.type == thrift::DualMessageType::UPDATE) {
+        // latest queued message of the same root
+        auto it = std::find_if(
+            pending.rbegin(), pending.rend(), [&msg](const auto& pendingMsg) {
+              return pendingMsg.dstId == msg.dstId;
+            });
+        if (it != pending.rend() and
+            it->type == thrift::DualMessageType::UPDATE) {
+          it->distance = msg.distance;
+          counters_[neighbor].msgCoalesced++;
+          continue;
+        }
+      }
+      pending.emplace_back(std::move(msg));
+    }
+  }
+
+  if (not hadPendingMsgs and not pendingMsgs_.empty()) {
+    scheduleDualMessagesFlush();
+  }
+}
+
+void
+DualNode::sendDualMessagesToNeighbors(
+    std::unordered_map<std::string, thrift::DualMessages>& msgsToSend) {
   for (auto& kv : msgsToSend) {
     const auto& neighbor = kv.first;
     auto& msgs = kv.second;
@@ -939,6 +1016,10 @@ DualNode::sendAllDualMessages(
       // ignore empty messages
       continue;
     }
+    if (batchMessages_ and not neighborUp(neighbor)) {
+      // neighbor went down after messages were queued
+      continue;
+    }
 
     // set srcId = myNodeId
     msgs.srcId = nodeId;
@@ -956,13 +1037,19 @@ DualNode::addDual(const std::string& rootId) {
   if (duals_.count(rootId) != 0) {
     return;
   }
+  duals_.emplace(rootId, Dual(nodeId, rootId, neighbors_, nexthopCb_));
+}
 
-  auto nexthopCb = [this, rootId](
-                       const folly::Optional<std::string>& oldNh,
-                       const folly::Optional<std::string>& newNh) {
-    processNexthopChange(rootId, oldNh, newNh);
-  };
-  duals_.emplace(rootId, Dual(nodeId, rootId, localDistances_, nexthopCb));
+DualNeighborId
+DualNode::getNeighborId(const std::string& neighbor) {
+  const auto it = neighborIds_.find(neighbor);
+  if (it != neighborIds_.end()) {
+    return it->second;
+  }
+  const DualNeighborId neighborId = neighbors_.size();
+  neighbors_.emplace_back(DualNeighbor{neighbor});
+  neighborIds_.emplace(neighbor, neighborId);
+  return neighborId;
 }
 
 } // namespace openr
@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
 #include <limits>
 #include <stack>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <folly/Format.h>
 
@@ -57,6 +60,34 @@ struct DualStateMachine {
   void processEvent(DualEvent event, bool fc = true);
 };
 
+/**
+ * Id of a DualNode neighbor, index of the neighbor in DualNode neighbor table.
+ * Neighbors are numbered in order of their first event and never removed.
+ */
+using DualNeighborId = uint32_t;
+
+/**
+ * DualNode neighbor table entry, shared by Dual of all roots
+ */
+struct DualNeighbor {
+  // neighbor node-id
+  std::string name;
+  // local distance towards neighbor, max if neighbor is down
+  int64_t distance{std::numeric_limits<int64_t>::max()};
+  // received a link event (up, down or cost-change) of neighbor or not,
+  // messages of neighbor can arrive before its first link event
+  bool hasLinkEvent{false};
+};
+
+/**
+ * callback when nexthop towards a root changed, dispatched by DualNode for all
+ * roots
+ */
+using DualNexthopChangeCb = std::function<void(
+    const std::string& rootId,
+    const folly::Optional<std::string>& oldNh,
+    const folly::Optional<std::string>& newNh)>;
+
 /**
  * DUAL (Diffusing Update Algorithm) Node
  * details refer to: https://www.cs.cornell.edu/people/egs/615/lunes93.pdf
@@ -67,43 +98,41 @@ struct DualStateMachine {
 class Dual {
  public:
   // constructor
-  // takes nodeId, rootId, current local-distances
+  // takes nodeId, rootId, neighbor table and nexthop change callback of
+  // DualNode. Both are referenced, not copied, and must outlive Dual
   Dual(
       const std::string& nodeId,
       const std::string& rootId,
-      const std::unordered_map<std::string, int64_t>& localDistance,
-      std::function<void(
-          const folly::Optional<std::string>& oldNh,
-          const folly::Optional<std::string>& newNh)> nexthopChangeCb);
+      const std::vector<DualNeighbor>& neighbors,
+      const DualNexthopChangeCb& nexthopChangeCb);
 
-  // peer up event
-  // input: (neighbor-id, link-metric)
+  // peer up event, neighbor table holds the link-metric already
+  // input: (neighbor-id)
   // output: map<neighbor-id: dual-messages-to-send>
   void peerUp(
-      const std::string& neighbor,
-      int64_t cost,
+      DualNeighborId neighbor,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
   // peer down event
   // input: (neighbor-id)
   // output: map<neighbor-id: dual-messages-to-send>
   void peerDown(
-      const std::string& neighbor,
+      DualNeighborId neighbor,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
-  // peer cost change event
-  // input: (neighbor-id, new-link-metric)
+  // peer cost change event, neighbor table holds the new link-metric already
+  // input: (neighbor-id, old-link-metric)
   // output: map<neighbor-id: dual-messages-to-send>
   void peerCostChange(
-      const std::string& neighbor,
-      int64_t cost,
+      DualNeighborId neighbor,
+      int64_t oldCost,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
   // process a DUAL update message
   // input: (neighbor-id, a update dual-message)
   // output: map<neighbor-id: dual-messages-to-send>
   void processUpdate(
-      const std::string& neighbor,
+      DualNeighborId neighbor,
       const thrift::DualMessage& update,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -111,7 +140,7 @@ class Dual {
   // input: (neighbor-id, a query dual-message)
   // output: map<neighbor-id: dual-messages-to-send>
   void processQuery(
-      const std::string& neighbor,
+      DualNeighborId neighbor,
       const thrift::DualMessage& query,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -119,7 +148,7 @@ class Dual {
   // input: (neighbor-id, a reply dual-message)
   // output: map<neighbor-id: dual-messages-to-send>
   void processReply(
-      const std::string& neighbor,
+      DualNeighborId neighbor,
       const thrift::DualMessage& reply,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -149,9 +178,10 @@ class Dual {
     // state machine
     DualStateMachine sm;
     // neighbor exchanged information <report-distance, expect-reply-flag>
-    std::unordered_map<std::string, NeighborInfo> neighborInfos;
+    // indexed by neighbor-id
+    std::vector<NeighborInfo> neighborInfos;
     // diffusing: track received query
-    std::stack<std::string> cornet{};
+    std::stack<DualNeighborId> cornet{};
 
     // dump route info into human-friendly string mainly for logging or
     // debugging
@@ -214,7 +244,7 @@ class Dual {
   void removeChild(const std::string& child) noexcept;
 
   // get current spt children
-  std::unordered_set<std::string> children() const noexcept;
+  const std::unordered_set<std::string>& children() const noexcept;
 
   // get current spt peers (nexthop + children)
   // return empty-set if dual has no valid route
@@ -227,6 +257,18 @@ class Dual {
   const std::string rootId;
 
  private:
+  // grow per-neighbor tables to size of neighbor table
+  void addNeighbors();
+
+  // neighbor name for a given neighbor-id
+  const std::string& neighborName(DualNeighborId neighbor) const;
+
+  // check if a neighbor is my current nexthop or not
+  bool isNexthop(DualNeighborId neighbor) const;
+
+  // set nexthop and notify nexthop change
+  void setNexthop(const folly::Optional<DualNeighborId>& nexthop);
+
   // get minimum distance towards root
   int64_t getMinDistance();
 
@@ -238,7 +280,7 @@ class Dual {
   // if we can find a neighbor whose report-distance < my-feasible-distance
   // AND local-distance + report-distance == current minimum-distance
   // return true, otherwise return false
-  bool meetFeasibleCondition(std::string& nexthop, int64_t& distance);
+  bool meetFeasibleCondition(DualNeighborId& nexthop, int64_t& distance);
 
   // flood updates to all my neighbor
   void floodUpdates(
@@ -246,7 +288,7 @@ class Dual {
 
   // perform a local computation
   void localComputation(
-      const std::string& newNexthop,
+      DualNeighborId newNexthop,
       int64_t newDistance,
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
@@ -269,25 +311,25 @@ class Dual {
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
   // check if a neighbor is up or not
-  bool neighborUp(const std::string& neighbor);
+  bool neighborUp(DualNeighborId neighbor) const;
 
   // clear counters to zero for a given neighbor
-  void clearCounters(const std::string& neighbor) noexcept;
+  void clearCounters(DualNeighborId neighbor) noexcept;
 
   // route-info towards root
   RouteInfo info_;
 
-  // local neighbor distances
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // neighbor-id of info_.nexthop, none if invalid or I'm the root
+  folly::Optional<DualNeighborId> nexthopId_{folly::none};
 
-  // dual messages counters map<neighbor: dual-counters>
-  std::map<std::string, thrift::DualPerRootCounters> counters_;
+  // neighbor table of DualNode, local neighbor distances
+  const std::vector<DualNeighbor>& neighbors_;
+
+  // dual messages counters indexed by neighbor-id
+  std::vector<thrift::DualPerRootCounters> counters_;
 
   // callback when nexthop changed
-  const std::function<void(
-      const folly::Optional<std::string>& oldNh,
-      const folly::Optional<std::string>& newNh)>
-      nexthopCb_{nullptr};
+  const DualNexthopChangeCb& nexthopCb_;
 
   // spt children
   std::unordered_set<std::string> children_;
@@ -311,14 +353,26 @@ class Dual {
  * node1.peerUp("node2", 12);
  * node2.peerUp("node1", 12);
  * auto infos = node1.getInfos();
+ *
+ * With batchMessages, messages are queued per neighbor instead of being sent
+ * right away, and sent out together on flushDualMessages(). An update queued
+ * for a root replaces the previous update of the same root to the neighbor,
+ * unless a query or reply of the root has been queued in between.
  */
 class DualNode {
  public:
   // constructor takes nodeId, and a indicator if I'm the root or not
-  explicit DualNode(const std::string& nodeId, bool isRoot = false);
+  explicit DualNode(
+      const std::string& nodeId,
+      bool isRoot = false,
+      bool batchMessages = false);
 
   virtual ~DualNode() = default;
 
+  // Dual of all roots reference the neighbor table, disable copying
+  DualNode(DualNode const&) = delete;
+  DualNode& operator=(DualNode const&) = delete;
+
   // subclass needs to implement this method to perform actual I/O operation
   // return true on success, otherwise false
   virtual bool sendDualMessages(
@@ -344,6 +398,17 @@ class DualNode {
   // process dual messages
   void processDualMessages(const thrift::DualMessages& messages);
 
+  // send out messages queued since last flush (only with batchMessages)
+  void flushDualMessages();
+
+  // invoked when the first message of a batch is queued. Subclass should
+  // override it to call flushDualMessages() later, e.g. on a timer, otherwise
+  // messages are flushed right away
+  virtual void
+  scheduleDualMessagesFlush() noexcept {
+    flushDualMessages();
+  }
+
   // check if a given root-id is discovered or not
   bool hasDual(const std::string& rootId);
 
@@ -391,24 +456,48 @@ class DualNode {
   const bool isRoot{false};
 
  private:
-  // send out dual messages for a given <neighbor: dual-messages>
+  // send out dual messages for a given <neighbor: dual-messages>, or queue
+  // them with batchMessages
   void sendAllDualMessages(
       std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
 
+  // queue dual messages until next flush, coalescing updates
+  void queueDualMessages(
+      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+
+  // send dual messages to neighbors which are up
+  void sendDualMessagesToNeighbors(
+      std::unordered_map<std::string, thrift::DualMessages>& msgsToSend);
+
   // add Dual for a given root-id if not exist yet
   void addDual(const std::string& rootId);
 
+  // get neighbor-id of a given neighbor, add it to neighbor table if not exist
+  DualNeighborId getNeighborId(const std::string& neighbor);
+
   // clear counters to zero for a given neighbor
   void clearCounters(const std::string& neighbor) noexcept;
 
-  // local distances map<neighbor: distance>
-  std::unordered_map<std::string, int64_t> localDistances_;
+  // neighbor table with local distances, indexed by neighbor-id
+  std::vector<DualNeighbor> neighbors_;
+
+  // map<neighbor: neighbor-id>
+  std::unordered_map<std::string, DualNeighborId> neighborIds_;
+
+  // nexthop change callback of all roots, calls processNexthopChange()
+  const DualNexthopChangeCb nexthopCb_;
 
   // map<root-id: Dual-object>
   std::map<std::string, Dual> duals_;
 
   // map<neighbor-id: counters>
   std::unordered_map<std::string, thrift::DualPerNeighborCounters> counters_;
+
+  // queue messages until flushDualMessages() instead of sending them
+  const bool batchMessages_{false};
+
+  // messages queued for next flush map<neighbor: dual-messages>
+  std::unordered_map<std::string, thrift::DualMessages> pendingMsgs_;
 };
 
 } // namespace openr
@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+
+#include <openr/dual/Dual.h>
+
+namespace {
+// number of flood roots, e.g. one per spine
+const uint32_t kNumRoots = 32;
+} // namespace
+
+namespace openr {
+
+/**
+ * DualNode whose neighbors answer its queries with their reported distance,
+ * other messages are dropped
+ */
+class DualBenchmarkNode final : public DualNode {
+ public:
+  explicit DualBenchmarkNode(const std::string& nodeId) : DualNode(nodeId) {}
+
+  bool
+  sendDualMessages(
+      const std::string& neighbor,
+      const thrift::DualMessages& msgs) noexcept override {
+    thrift::DualMessages replies;
+    replies.srcId = neighbor;
+    for (const auto& msg : msgs.messages) {
+      if (msg.type != thrift::DualMessageType::QUERY) {
+        continue;
+      }
+      thrift::DualMessage reply;
+      reply.dstId = msg.dstId;
+      reply.distance = reportDistances.at(neighbor);
+      reply.type = thrift::DualMessageType::REPLY;
+      replies.messages.emplace_back(std::move(reply));
+    }
+    if (not replies.messages.empty()) {
+      pendingReplies.emplace_back(std::move(replies));
+    }
+    return true;
+  }
+
+  // process replies of neighbors until no query is pending
+  void
+  processReplies() {
+    while (not pendingReplies.empty()) {
+      auto replies = std::move(pendingReplies);
+      pendingReplies.clear();
+      for (const auto& msgs : replies) {
+        processDualMessages(msgs);
+      }
+    }
+  }
+
+  void
+  processNexthopChange(
+      const std::string& /* rootId */,
+      const folly::Optional<std::string>& /* oldNh */,
+      const folly::Optional<std::string>& /* newNh */) noexcept override {}
+
+  // distance reported by each neighbor towards all roots
+  std::unordered_map<std::string, int64_t> reportDistances;
+  // replies not processed yet
+  std::vector<thrift::DualMessages> pendingReplies;
+};
+
+/**
+ * Bring up numNeighbors neighbors and learn kNumRoots roots from each of them,
+ * neighbor i reports distance i to every root
+ */
+static void
+learnRoots(
+    DualBenchmarkNode& node,
+    const std::vector<std::string>& neighbors,
+    const std::vector<std::string>& roots) {
+  for (size_t i = 0; i < neighbors.size(); ++i) {
+    node.reportDistances[neighbors[i]] = i;
+    node.peerUp(neighbors[i], 1);
+  }
+  for (size_t i = 0; i < neighbors.size(); ++i) {
+    thrift::DualMessages msgs;
+    msgs.srcId = neighbors[i];
+    for (const auto& root : roots) {
+      thrift::DualMessage msg;
+      msg.dstId = root;
+      msg.distance = i;
+      msg.type = thrift::DualMessageType::UPDATE;
+      msgs.messages.emplace_back(std::move(msg));
+    }
+    node.processDualMessages(msgs);
+  }
+  node.processReplies();
+}
+
+static std::vector<std::string>
+makeNames(const std::string& prefix, uint32_t count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    names.emplace_back(folly::sformat("{}-{}", prefix, i));
+  }
+  return names;
+}
+
+/**
+ * Benchmark learning kNumRoots roots over numNeighbors neighbors
+ */
+static void
+BM_DualLearnRoots(uint32_t iters, uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto neighbors = makeNames("neighbor", numNeighbors);
+  const auto roots = makeNames("root", kNumRoots);
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    DualBenchmarkNode node("node");
+    suspender.dismiss(); // Start measuring benchmark time
+    learnRoots(node, neighbors, roots);
+    suspender.rehire(); // Stop measuring time again
+  }
+}
+
+/**
+ * Benchmark flapping cost of link towards best neighbor of all kNumRoots
+ * roots. Increasing it starts a diffusing computation for every root, which
+ * moves to the second best neighbor, restoring it moves every root back
+ */
+static void
+BM_DualNexthopFlap(uint32_t iters, uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto neighbors = makeNames("neighbor", numNeighbors);
+  const auto roots = makeNames("root", kNumRoots);
+  DualBenchmarkNode node("node");
+  learnRoots(node, neighbors, roots);
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    node.peerCostChange(neighbors.front(), numNeighbors);
+    node.processReplies();
+    node.peerCostChange(neighbors.front(), 1);
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+/**
+ * Benchmark reading state of all kNumRoots roots, as done on flood-topo get
+ */
+static void
+BM_DualGetInfos(uint32_t iters, uint32_t numNeighbors) {
+  auto suspender = folly::BenchmarkSuspender();
+  const auto neighbors = makeNames("neighbor", numNeighbors);
+  const auto roots = makeNames("root", kNumRoots);
+  DualBenchmarkNode node("node");
+  learnRoots(node, neighbors, roots);
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    size_t numChildren{0};
+    for (const auto& kv : node.getDuals()) {
+      const auto& info = kv.second.getInfo();
+      folly::doNotOptimizeAway(info.distance);
+      numChildren += kv.second.children().size();
+    }
+    auto counters = node.getCounters();
+    folly::doNotOptimizeAway(numChildren);
+    folly::doNotOptimizeAway(counters);
+  }
+  suspender.rehire(); // Stop measuring time again
+}
+
+// The parameter is the number of neighbors, with kNumRoots roots
+BENCHMARK_PARAM(BM_DualLearnRoots, 16);
+BENCHMARK_PARAM(BM_DualLearnRoots, 128);
+
+BENCHMARK_PARAM(BM_DualNexthopFlap, 16);
+BENCHMARK_PARAM(BM_DualNexthopFlap, 128);
+
+BENCHMARK_PARAM(BM_DualGetInfos, 16);
+BENCHMARK_PARAM(BM_DualGetInfos, 128);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
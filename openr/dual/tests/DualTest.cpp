@@ -231,8 +231,11 @@ class DualTestNode final : public DualNode {
       const std::string& nodeId,
       bool isRoot,
       std::shared_ptr<folly::EventBase> evb,
-      std::map<std::string, std::shared_ptr<DualTestNode>>& nodes)
-      : DualNode(nodeId, isRoot), evb_(std::move(evb)), nodes_(nodes) {}
+      std::map<std::string, std::shared_ptr<DualTestNode>>& nodes,
+      bool batchMessages = false)
+      : DualNode(nodeId, isRoot, batchMessages),
+        evb_(std::move(evb)),
+        nodes_(nodes) {}
 
   bool
   sendDualMessages(
@@ -249,6 +252,11 @@ class DualTestNode final : public DualNode {
     return true;
   }
 
+  void
+  scheduleDualMessagesFlush() noexcept override {
+    evb_->runAfterDelay([this]() { flushDualMessages(); }, kIoDelayBaseMs);
+  }
+
   void
   processNexthopChange(
       const std::string& rootId,
@@ -289,7 +297,8 @@ class DualBaseFixture : public ::testing::Test {
 
   void
   addNode(const std::string& nodeId, bool isRoot) {
-    auto node = std::make_shared<DualTestNode>(nodeId, isRoot, evb, nodes);
+    auto node = std::make_shared<DualTestNode>(
+        nodeId, isRoot, evb, nodes, batchMessages);
     nodes.emplace(nodeId, node);
     vertices.emplace_back(Vertex{nodeId, true});
     if (isRoot) {
@@ -850,17 +859,28 @@ class DualBaseFixture : public ::testing::Test {
 
   std::vector<Vertex> vertices;
   std::vector<Edge> edges;
+  // batch dual messages of added nodes
+  bool batchMessages{false};
 };
 
 // Test Parameters
 struct TestParam {
   int totalRoots; // number of roots
   bool flap; // flap link/node or not
-  TestParam(int totalRoots, bool flap) : totalRoots(totalRoots), flap(flap) {}
+  bool batchMessages; // batch dual messages or not
+  TestParam(int totalRoots, bool flap, bool batchMessages = false)
+      : totalRoots(totalRoots), flap(flap), batchMessages(batchMessages) {}
 };
 
 class DualFixture : public DualBaseFixture,
-                    public ::testing::WithParamInterface<TestParam> {};
+                    public ::testing::WithParamInterface<TestParam> {
+ protected:
+  void
+  SetUp() override {
+    DualBaseFixture::SetUp();
+    batchMessages = GetParam().batchMessages;
+  }
+};
 
 // Test all following different cases for each topology
 INSTANTIATE_TEST_CASE_P(
@@ -872,7 +892,9 @@ INSTANTIATE_TEST_CASE_P(
         TestParam(1, false),
         TestParam(1, true),
         TestParam(2, false),
-        TestParam(2, true)));
+        TestParam(2, true),
+        TestParam(1, true, true),
+        TestParam(2, true, true)));
 
 /**
  *  Circular Topology
@@ -1026,6 +1048,90 @@ TEST_P(DualFixture, GridTest) {
   EXPECT_TRUE(multiFailureTest(flap));
 }
 
+// DualNode recording messages it sends, flushed by test only
+class DualRecordingNode final : public DualNode {
+ public:
+  explicit DualRecordingNode(const std::string& nodeId)
+      : DualNode(nodeId, false /* isRoot */, true /* batchMessages */) {}
+
+  bool
+  sendDualMessages(
+      const std::string& neighbor,
+      const thrift::DualMessages& msgs) noexcept override {
+    sentMsgs[neighbor].emplace_back(msgs);
+    return true;
+  }
+
+  void
+  scheduleDualMessagesFlush() noexcept override {
+    ++numFlushesScheduled;
+  }
+
+  void
+  processNexthopChange(
+      const std::string& /* rootId */,
+      const folly::Optional<std::string>& /* oldNh */,
+      const folly::Optional<std::string>& /* newNh */) noexcept override {}
+
+  // map<neighbor: sent packets>
+  std::map<std::string, std::vector<thrift::DualMessages>> sentMsgs;
+  int numFlushesScheduled{0};
+};
+
+/**
+ * n learns root r from r, then cost of link to r changes before messages are
+ * flushed. Updates of r sent to each neighbor are coalesced into the latest.
+ *  r --- n --- m
+ */
+TEST(Dual, MessageBatching) {
+  DualRecordingNode node("n");
+  node.peerUp("r", 1);
+  node.peerUp("m", 1);
+
+  thrift::DualMessage update;
+  update.dstId = "r";
+  update.distance = 0;
+  update.type = thrift::DualMessageType::UPDATE;
+  thrift::DualMessages msgs;
+  msgs.srcId = "r";
+  msgs.messages.emplace_back(update);
+  node.processDualMessages(msgs);
+  node.peerCostChange("r", 2);
+
+  // nothing sent before flush, flush scheduled once
+  EXPECT_EQ(0, node.sentMsgs.size());
+  EXPECT_EQ(1, node.numFlushesScheduled);
+  auto info = node.getInfo("r");
+  ASSERT_TRUE(info.hasValue());
+  EXPECT_EQ(2, info->distance);
+
+  node.flushDualMessages();
+  const auto counters = node.getCounters();
+  for (const auto& neighbor : {"r", "m"}) {
+    ASSERT_EQ(1, node.sentMsgs[neighbor].size());
+    const auto& sent = node.sentMsgs[neighbor].front();
+    EXPECT_EQ("n", sent.srcId);
+    ASSERT_EQ(1, sent.messages.size());
+    EXPECT_EQ(thrift::DualMessageType::UPDATE, sent.messages.front().type);
+    EXPECT_EQ("r", sent.messages.front().dstId);
+    EXPECT_EQ(2, sent.messages.front().distance);
+
+    const auto& neighborCounters = counters.neighborCounters.at(neighbor);
+    EXPECT_EQ(1, neighborCounters.pktSent);
+    EXPECT_EQ(1, neighborCounters.msgSent);
+    EXPECT_EQ(1, neighborCounters.msgCoalesced);
+  }
+
+  // queued messages of a down peer are dropped
+  node.sentMsgs.clear();
+  node.peerCostChange("r", 3);
+  node.peerDown("m");
+  node.flushDualMessages();
+  EXPECT_EQ(0, node.sentMsgs.count("m"));
+  ASSERT_EQ(1, node.sentMsgs["r"].size());
+  EXPECT_EQ(3, node.sentMsgs["r"].front().messages.back().distance);
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
@@ -77,6 +77,11 @@ DEFINE_string(
     "",
     "If set, use this MAC address for the mesh interface");
 DEFINE_uint32(mesh_ttl, 31, "TTL for mesh frames");
+DEFINE_uint32(
+    mesh_station_info_cache_ms,
+    1000,
+    "How long the result of a station dump is shared by all readers of "
+    "station info (ms), 0 dumps stations on every read");
 DEFINE_uint32(mesh_ttl_element, 31, "Element TTL for mesh frames");
 DEFINE_uint32(
     mesh_max_peer_links, 32, "Maximum number of allowed 11s peer links");
@@ -162,15 +167,25 @@ const auto mpath_policy_{[]() {
   return mpath_policy_;
 }()};
 
+// authsae work items processed per loop wakeup, see processAuthWork()
+const size_t kMaxAuthWorkPerWakeup{4};
+
+// Work queued beyond this is dropped, peers retransmit their frames
+const size_t kMaxPendingAuthWork{512};
+
 } // namespace
 
 Nl80211Handler::Nl80211Handler(
     fbzmq::ZmqEventLoop& zmqLoop,
     const std::string& interfaceName,
-    bool userspace_mesh_peering)
+    bool userspace_mesh_peering,
+    StatsClient* statsClient)
     : interfaceName_{interfaceName},
       zmqLoop_{zmqLoop},
-      userspace_mesh_peering_{userspace_mesh_peering} {
+      userspace_mesh_peering_{userspace_mesh_peering},
+      authWorkTimer_{fbzmq::ZmqTimeout::make(
+          &zmqLoop, [this]() noexcept { processAuthWork(); })},
+      statsClient_{statsClient} {
   VLOG(8) << folly::sformat("Nl80211Handler::{}()", __func__);
 
   // We expect Nl80211Handler to be treated as a singleton, and there should not
@@ -367,7 +382,7 @@ Nl80211Handler::populateNetifs() {
 
   std::vector<NetInterface> netInterfaces;
 
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       GenericNetlinkMessage{
           GenericNetlinkFamily::NL80211(), NL80211_CMD_GET_WIPHY, NLM_F_DUMP},
       [&netInterfaces](const GenericNetlinkMessage& msg) {
@@ -560,7 +575,7 @@ Nl80211Handler::createInterface(int phyIndex) {
   if (netif.maybeMacAddress) {
     nla_put(msg, NL80211_ATTR_MAC, ETH_ALEN, netif.maybeMacAddress->bytes());
   }
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg, [&address](const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<NL80211_ATTR_MAX>();
 
@@ -605,7 +620,7 @@ Nl80211Handler::leaveMesh(int phyIndex) {
       "ifindex: {} ",
       phyIndex,
       ifIndex);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 void
@@ -627,7 +642,7 @@ Nl80211Handler::deleteInterface(const std::string& ifName) {
   GenericNetlinkMessage msg{GenericNetlinkFamily::NL80211(),
                             NL80211_CMD_DEL_INTERFACE};
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 status_t
@@ -818,7 +833,7 @@ Nl80211Handler::joinMesh(int phyIndex) {
       nla_put_u32(msg, NL80211_ATTR_MCAST_RATE, multicastRate);
     }
   }
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 status_t
@@ -971,7 +986,7 @@ Nl80211Handler::installKey(
 
     VLOG(8) << folly::sformat(
         "Nl80211Handler::{}(): creating key id {}", __func__, keyIdx);
-    GenericNetlinkSocket{}.sendAndReceive(msg);
+    GenericNetlinkSocket::request(msg);
   }
 
   // Set that as the key to use
@@ -991,7 +1006,7 @@ Nl80211Handler::installKey(
 
     VLOG(8) << folly::sformat(
         "Nl80211Handler::{}(): setting key id {}", __func__, keyIdx);
-    GenericNetlinkSocket{}.sendAndReceive(msg);
+    GenericNetlinkSocket::request(msg);
   }
 }
 
@@ -1030,7 +1045,7 @@ Nl80211Handler::txFrame(const NetInterface& netif, folly::ByteRange frame) {
           .toString(),
       ifIndex,
       netif.frequency);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
   return R_SUCCESS;
 }
 
@@ -1041,7 +1056,7 @@ Nl80211Handler::getNl80211MulticastGroups() {
 
   GenericNetlinkMessage msg{GenericNetlinkFamily::NLCTRL(), CTRL_CMD_GETFAMILY};
   nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, "nl80211");
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg, [this](const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<CTRL_ATTR_MAX>();
 
@@ -1121,7 +1136,8 @@ Nl80211Handler::setPlinkState(
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
   nla_put(msg, NL80211_ATTR_MAC, ETH_ALEN, peer.bytes());
   nla_put_u8(msg, NL80211_ATTR_STA_PLINK_STATE, state);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
+  invalidateStationsInfo();
 
   if (peerSelector_ && state == PLINK_ESTAB) {
     peerSelector_->onPeerAddedOrRemoved();
@@ -1143,7 +1159,8 @@ Nl80211Handler::deleteStation(folly::MacAddress peer) {
   uint32_t ifIndex = (uint32_t)netif.maybeIfIndex.value();
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
   nla_put(msg, NL80211_ATTR_MAC, ETH_ALEN, peer.bytes());
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
+  invalidateStationsInfo();
 }
 
 void
@@ -1173,7 +1190,7 @@ Nl80211Handler::setStationAuthenticated(
   }
 
   nla_put(msg, NL80211_ATTR_STA_FLAGS2, sizeof(flags), &flags);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 status_t
@@ -1198,7 +1215,7 @@ Nl80211Handler::setMeshConfig(
     nla_put_u16(msg, NL80211_MESHCONF_HT_OPMODE, mesh.conf->ht_prot_mode);
   }
   nla_nest_end(msg, container);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
   return R_SUCCESS;
 }
 
@@ -1308,6 +1325,10 @@ void
 Nl80211Handler::tearDown() {
   VLOG(8) << folly::sformat("Nl80211Handler::{}()", __func__);
 
+  // authsae state goes away with mesh configs
+  authWorkTimer_->cancelTimeout();
+  pendingAuthWork_.clear();
+
   for (auto& phy : netInterfaces_) {
     for (int idx = 0; idx < IEEE80211_NUM_BANDS; idx++) {
       std::free(phy.second.getMeshConfig()->bands[idx].rates);
@@ -1400,28 +1421,38 @@ Nl80211Handler::handleNewCandidate(const GenericNetlinkMessage& msg) {
       htole16(IEEE802_11_FC_TYPE_MGMT << 2 | IEEE802_11_FC_STYPE_BEACON << 4);
   memcpy(bcn.sa, nla_data(tb[NL80211_ATTR_MAC]), ETH_ALEN);
 
-  if (process_mgmt_frame(
-          &bcn,
-          sizeof(bcn),
-          (unsigned char*)netif.maybeMacAddress->bytes(),
-          /*cookie*/ nullptr,
-          !netif.isEncrypted) != 0) {
-    VLOG(8) << "libsae: process_mgmt_frame failed";
-    return ERR_AUTHSAE;
-  }
-
-  // If peer now exists, we know it was created by process_mgmt_frame, or if
-  // we received two NEW_PEER_CANDIDATE events for the same peer, this will
-  // fail
-  if (candidate* created_peer = find_peer(bcn.sa, 0)) {
-    ampe_set_peer_ies(created_peer, &elems);
+  // IEs are parsed again from a copy, msg is gone once work gets processed
+  std::vector<unsigned char> ies(ie, ie + ie_len);
+  queueAuthWork([this, phyIndex, bcn, ies = std::move(ies)]() mutable {
+    const NetInterface& candidateNetif = lookupNetifFromPhy(phyIndex);
+    info_elems candidateElems;
+    parse_ies(ies.data(), ies.size(), &candidateElems);
+
+    if (process_mgmt_frame(
+            &bcn,
+            sizeof(bcn),
+            (unsigned char*)candidateNetif.maybeMacAddress->bytes(),
+            /*cookie*/ nullptr,
+            !candidateNetif.isEncrypted) != 0) {
+      VLOG(8) << "libsae: process_mgmt_frame failed";
+      return;
+    }
 
-    if (!created_peer->in_kernel) {
-      Nl80211Handler::globalNlHandler->createUnauthenticatedStation(
-          netif, folly::MacAddress::fromBinary({bcn.sa, ETH_ALEN}), elems);
-      created_peer->in_kernel = true;
+    // If peer now exists, we know it was created by process_mgmt_frame, or if
+    // we received two NEW_PEER_CANDIDATE events for the same peer, this will
+    // fail
+    if (candidate* created_peer = find_peer(bcn.sa, 0)) {
+      ampe_set_peer_ies(created_peer, &candidateElems);
+
+      if (!created_peer->in_kernel) {
+        createUnauthenticatedStation(
+            candidateNetif,
+            folly::MacAddress::fromBinary({bcn.sa, ETH_ALEN}),
+            candidateElems);
+        created_peer->in_kernel = true;
+      }
     }
-  }
+  });
 
   return R_SUCCESS;
 }
@@ -1442,15 +1473,76 @@ Nl80211Handler::handleDeletedPeer(const GenericNetlinkMessage& msg) {
     return ERR_NETLINK_OTHER;
   }
 
-  if (candidate* peer = find_peer(
-          static_cast<unsigned char*>(nla_data(tb[NL80211_ATTR_MAC])), false)) {
-    ampe_close_peer_link(peer->peer_mac);
-    delete_peer(&peer);
-  }
+  // After work queued for peer so far, so that it doesn't bring peer back
+  const auto peerMac = folly::MacAddress::fromBinary(
+      {static_cast<unsigned char*>(nla_data(tb[NL80211_ATTR_MAC])), ETH_ALEN});
+  queueAuthWork([peerMac]() {
+    if (candidate* peer =
+            find_peer(const_cast<unsigned char*>(peerMac.bytes()), false)) {
+      ampe_close_peer_link(peer->peer_mac);
+      delete_peer(&peer);
+    }
+  });
 
   return R_SUCCESS;
 }
 
+void
+Nl80211Handler::queueAuthWork(folly::Function<void()> work) {
+  if (pendingAuthWork_.size() >= kMaxPendingAuthWork) {
+    LOG(WARNING) << "Too much authsae work pending, dropping";
+    if (statsClient_) {
+      statsClient_->incrementSumStat("fbmeshd.nl80211.auth_work_dropped");
+    }
+    return;
+  }
+  pendingAuthWork_.emplace_back(
+      std::chrono::steady_clock::now(), std::move(work));
+  if (statsClient_) {
+    statsClient_->setAvgStat(
+        "fbmeshd.nl80211.auth_work_queue_depth", pendingAuthWork_.size());
+  }
+  if (!authWorkTimer_->isScheduled()) {
+    authWorkTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
+void
+Nl80211Handler::processAuthWork() {
+  VLOG(8) << folly::sformat(
+      "Nl80211Handler::{}(pending: {})", __func__, pendingAuthWork_.size());
+
+  for (size_t i = 0; i < kMaxAuthWorkPerWakeup && !pendingAuthWork_.empty();
+       ++i) {
+    auto item = std::move(pendingAuthWork_.front());
+    pendingAuthWork_.pop_front();
+
+    const auto startTime = std::chrono::steady_clock::now();
+    try {
+      item.second();
+    } catch (std::exception const& e) {
+      LOG(ERROR) << "Error processing authsae work: " << e.what();
+    }
+    if (statsClient_) {
+      const auto endTime = std::chrono::steady_clock::now();
+      // time spent in authsae, and since the work was queued
+      statsClient_->addLatencyStat(
+          "fbmeshd.nl80211.auth_processing_ms",
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              endTime - startTime));
+      statsClient_->addLatencyStat(
+          "fbmeshd.nl80211.auth_latency_ms",
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              endTime - item.first));
+    }
+  }
+
+  // Rest on next wakeup, after other events pending on the loop
+  if (!pendingAuthWork_.empty()) {
+    authWorkTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
 int
 Nl80211Handler::processEvent(const GenericNetlinkMessage& msg) {
   VLOG(8) << folly::sformat("Nl80211Handler::{}()", __func__);
@@ -1513,15 +1605,23 @@ Nl80211Handler::processEvent(const GenericNetlinkMessage& msg) {
               FLAGS_mesh_rssi_threshold);
           break;
         }
-        const NetInterface& netif = lookupMeshNetif();
-        if (process_mgmt_frame(
-                frame,
-                frame_len,
-                frame->da,
-                /*cookie*/ nullptr,
-                !netif.getMeshConfig()->conf->is_secure)) {
-          LOG(ERROR) << "process_mgmt_frame failed";
-        }
+        // Frame is copied, msg is gone once work gets processed
+        const auto frameBytes = reinterpret_cast<unsigned char*>(frame);
+        std::vector<unsigned char> frameData(
+            frameBytes, frameBytes + frame_len);
+        queueAuthWork([this, frameData = std::move(frameData)]() mutable {
+          const NetInterface& netif = lookupMeshNetif();
+          auto queuedFrame =
+              reinterpret_cast<ieee80211_mgmt_frame*>(frameData.data());
+          if (process_mgmt_frame(
+                  queuedFrame,
+                  frameData.size(),
+                  queuedFrame->da,
+                  /*cookie*/ nullptr,
+                  !netif.getMeshConfig()->conf->is_secure)) {
+            LOG(ERROR) << "process_mgmt_frame failed";
+          }
+        });
       } else
         VLOG(8) << "Got unexpected frame, ignoring";
     }
@@ -1540,6 +1640,7 @@ Nl80211Handler::processEvent(const GenericNetlinkMessage& msg) {
   case NL80211_CMD_DEL_STATION:
     VLOG(5) << "Processing NL80211_CMD_DEL_STATION event";
     handleDeletedPeer(msg);
+    invalidateStationsInfo();
     if (peerSelector_) {
       peerSelector_->onPeerAddedOrRemoved();
     }
@@ -1609,7 +1710,7 @@ Nl80211Handler::createUnauthenticatedStation(
   if (elems.vht_cap) {
     nla_put(msg, NL80211_ATTR_VHT_CAPABILITY, elems.vht_cap_len, elems.vht_cap);
   }
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 std::ostream&
@@ -1635,7 +1736,7 @@ Nl80211Handler::getMesh() {
                             NLM_F_DUMP | NLM_F_ACK};
   uint32_t ifIndex = (uint32_t)netif.maybeIfIndex.value();
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg, [&mesh](const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<NL80211_ATTR_MAX>();
 
@@ -1683,6 +1784,32 @@ std::vector<StationInfo>
 Nl80211Handler::getStationsInfo() {
   VLOG(8) << folly::sformat("Nl80211Handler::{}()", __func__);
 
+  const std::chrono::milliseconds maxAge{FLAGS_mesh_station_info_cache_ms};
+  const auto generation = stationsInfoGeneration_.load();
+
+  // Readers arriving during a dump wait for it and share its result
+  auto cache = stationsInfoCache_.wlock();
+  const auto now = std::chrono::steady_clock::now();
+  if (cache->generation == generation && cache->dumpTime &&
+      now - *cache->dumpTime < maxAge) {
+    return cache->stationsInfo;
+  }
+
+  cache->stationsInfo = dumpStationsInfo();
+  cache->dumpTime = now;
+  cache->generation = generation;
+  return cache->stationsInfo;
+}
+
+void
+Nl80211Handler::invalidateStationsInfo() {
+  ++stationsInfoGeneration_;
+}
+
+std::vector<StationInfo>
+Nl80211Handler::dumpStationsInfo() {
+  VLOG(8) << folly::sformat("Nl80211Handler::{}()", __func__);
+
   const NetInterface& netif = lookupMeshNetif();
 
   std::vector<StationInfo> stationsInfo;
@@ -1692,7 +1819,7 @@ Nl80211Handler::getStationsInfo() {
                             NLM_F_DUMP | NLM_F_ACK};
   uint32_t ifIndex = (uint32_t)netif.maybeIfIndex.value();
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg, [&stationsInfo](const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<NL80211_ATTR_MAX>();
 
@@ -1776,7 +1903,7 @@ Nl80211Handler::getMetrics() {
                             NLM_F_DUMP | NLM_F_ACK};
   uint32_t ifIndex = (uint32_t)netif.maybeIfIndex.value();
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg, [&metrics](const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<NL80211_ATTR_MAX>();
 
@@ -1829,7 +1956,7 @@ Nl80211Handler::setMeshConnectedToGate(bool isConnected) {
       ifIndex,
       isConnected);
   nla_nest_end(msg, container);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 void
@@ -1856,7 +1983,7 @@ Nl80211Handler::setRootMode(uint8_t mode) {
       ifIndex,
       mode);
   nla_nest_end(msg, container);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 void
@@ -1884,7 +2011,7 @@ Nl80211Handler::setRssiThreshold(int32_t rssiThreshold) {
       ifIndex,
       rssiThreshold);
   nla_nest_end(msg, container);
-  GenericNetlinkSocket{}.sendAndReceive(msg);
+  GenericNetlinkSocket::request(msg);
 }
 
 void
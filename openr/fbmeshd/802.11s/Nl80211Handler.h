@@ -11,17 +11,24 @@
 
 #include <netlink/netlink.h> // @manual
 
+#include <atomic>
 #include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include <fbzmq/async/ZmqEventLoop.h>
+#include <fbzmq/async/ZmqTimeout.h>
+#include <folly/Function.h>
 #include <folly/Optional.h>
 #include <folly/Portability.h>
+#include <folly/Synchronized.h>
 
 #include <openr/fbmeshd/802.11s/NetInterface.h>
 #include <openr/fbmeshd/common/ErrorCodes.h>
+#include <openr/fbmeshd/gateway-connectivity-monitor/StatsClient.h>
 #include <openr/fbmeshd/if/gen-cpp2/fbmeshd_types.h>
 #include <openr/fbmeshd/nl/GenericNetlinkMessage.h>
 #include <openr/fbmeshd/nl/GenericNetlinkSocket.h>
@@ -40,6 +47,7 @@ DECLARE_uint32(mesh_max_peer_links);
 DECLARE_int32(mesh_rssi_threshold);
 DECLARE_uint32(mesh_ttl);
 DECLARE_uint32(mesh_ttl_element);
+DECLARE_uint32(mesh_station_info_cache_ms);
 DECLARE_uint32(mesh_hwmp_active_path_timeout);
 DECLARE_uint32(mesh_hwmp_rann_interval);
 
@@ -79,7 +87,8 @@ class Nl80211Handler final : public Nl80211HandlerInterface {
   Nl80211Handler(
       fbzmq::ZmqEventLoop& zmqLoop,
       const std::string& interface,
-      bool userspace_mesh_peering);
+      bool userspace_mesh_peering,
+      StatsClient* statsClient = nullptr);
 
   ~Nl80211Handler();
 
@@ -122,6 +131,9 @@ class Nl80211Handler final : public Nl80211HandlerInterface {
 
   FOLLY_NODISCARD std::vector<folly::MacAddress> getPeers() override;
 
+  // Station info of established peers. Result of a station dump is shared by
+  // all callers for up to mesh_station_info_cache_ms, or until stations
+  // change. Thread safe
   FOLLY_NODISCARD std::vector<StationInfo> getStationsInfo() override;
 
   FOLLY_NODISCARD thrift::Mesh getMesh();
@@ -187,6 +199,12 @@ class Nl80211Handler final : public Nl80211HandlerInterface {
 
   void eventDataReady();
 
+  // Station dump from nl80211, see getStationsInfo()
+  std::vector<StationInfo> dumpStationsInfo();
+
+  // Make next getStationsInfo() dump stations again, on station add/removal
+  void invalidateStationsInfo();
+
   // Network interface control methods
   folly::MacAddress createInterface(int phyIndex);
   void deleteInterface(const std::string& ifName);
@@ -195,6 +213,12 @@ class Nl80211Handler final : public Nl80211HandlerInterface {
   void applyConfiguration();
   status_t processEvent(const GenericNetlinkMessage& msg);
 
+  // SAE and AMPE processing by authsae is elliptic curve heavy. Auth frames
+  // and candidates are queued and processed in order, a few per loop wakeup,
+  // so that a burst of them doesn't hold up other events of the loop
+  void queueAuthWork(folly::Function<void()> work);
+  void processAuthWork();
+
   // Methods for interacting with meshes
   status_t initMesh(int phyIndex);
   void joinMesh(int phyIndex);
@@ -215,9 +239,28 @@ class Nl80211Handler final : public Nl80211HandlerInterface {
   std::map<std::string, uint32_t> multicastGroups_;
   fbzmq::ZmqEventLoop& zmqLoop_;
   std::unordered_map<folly::MacAddress, int32_t> metrics_;
+
+  // Last station dump, valid while generation matches
+  // stationsInfoGeneration_ and not older than mesh_station_info_cache_ms
+  struct StationsInfoCache {
+    folly::Optional<std::chrono::steady_clock::time_point> dumpTime;
+    uint64_t generation{0};
+    std::vector<StationInfo> stationsInfo;
+  };
+  folly::Synchronized<StationsInfoCache> stationsInfoCache_;
+  std::atomic<uint64_t> stationsInfoGeneration_{0};
   // peer selector that is notified if peer membership changes
   PeerSelector* peerSelector_{nullptr};
   bool userspace_mesh_peering_;
+
+  // authsae work to process, with the time it was queued
+  std::deque<
+      std::pair<std::chrono::steady_clock::time_point, folly::Function<void()>>>
+      pendingAuthWork_;
+  std::unique_ptr<fbzmq::ZmqTimeout> authWorkTimer_;
+
+  // For auth latency and queue depth stats, if set
+  StatsClient* statsClient_{nullptr};
 };
 
 std::ostream& operator<<(std::ostream& out, const Nl80211Handler& nl);
@@ -73,23 +73,55 @@ PeerSelector::shouldAddCandidate(StationInfo& cand) {
     return true;
   }
 
-  std::vector<StationInfo> peers;
-  peers.push_back(cand);
-  for (auto const& it : currentPeers_) {
-    peers.push_back(it.second);
+  // Same outcome as ranking candidate along with current peers with
+  // rankPeers(): walk peers ranked ahead of candidate only, candidate is in if
+  // less than threshold of them, or if it is one of the first
+  // min_gate_connections gate connected peers
+  const size_t minGates = FLAGS_peer_selector_min_gate_connections;
+  size_t ahead{0};
+  size_t gatesAhead{0};
+  for (const auto& ranked : rankedPeers_) {
+    if (ranked.first < cand.signalAvgDbm) {
+      break;
+    }
+    if (ranked.second == cand.macAddress) {
+      continue;
+    }
+    ++ahead;
+    if (currentPeers_.at(ranked.second).isConnectedToGate) {
+      ++gatesAhead;
+    }
+    if (ahead >= threshold &&
+        (!cand.isConnectedToGate || gatesAhead >= minGates)) {
+      VLOG(7) << "rejecting due to threshold";
+      return false;
+    }
   }
-  rankPeers(peers, &threshold);
 
-  size_t i{};
-  for (auto it = peers.begin(); it != peers.end() && i < threshold; ++it, ++i) {
-    if (it->macAddress == cand.macAddress) {
-      VLOG(7) << "accepting: peer ranked " << i << " / " << threshold;
-      return true;
-    }
+  VLOG(7) << "accepting: peer ranked " << ahead << " / " << threshold;
+  return true;
+}
+
+void
+PeerSelector::setPeer(const StationInfo& peer) {
+  auto it = currentPeers_.find(peer.macAddress);
+  if (it != currentPeers_.end()) {
+    rankedPeers_.erase(
+        std::make_pair(it->second.signalAvgDbm, it->second.macAddress));
+    it->second = peer;
+  } else {
+    currentPeers_.emplace(peer.macAddress, peer);
   }
+  rankedPeers_.emplace(peer.signalAvgDbm, peer.macAddress);
+}
 
-  VLOG(7) << "rejecting due to threshold";
-  return false;
+void
+PeerSelector::setPeers(const std::vector<StationInfo>& peers) {
+  currentPeers_.clear();
+  rankedPeers_.clear();
+  for (const auto& peer : peers) {
+    setPeer(peer);
+  }
 }
 
 void
@@ -119,7 +151,19 @@ PeerSelector::poll() {
   std::vector<StationInfo> peers = nlHandler_.getStationsInfo();
   if (membershipChanged(peers)) {
     processMembershipChange(peers);
-  } else if (peers.size() < FLAGS_peer_selector_max_allowed) {
+    return;
+  }
+
+  // Same peers, only re-rank those whose signal or gate connection changed
+  for (const auto& peer : peers) {
+    const auto& current = currentPeers_.at(peer.macAddress);
+    if (current.signalAvgDbm != peer.signalAvgDbm ||
+        current.isConnectedToGate != peer.isConnectedToGate) {
+      setPeer(peer);
+    }
+  }
+
+  if (peers.size() < FLAGS_peer_selector_max_allowed) {
     auto timeSinceThresholdUpdate =
         std::chrono::steady_clock::now() - lastThresholdReduction_;
     // reduce threshold again if it's been a while with no new peers
@@ -175,10 +219,7 @@ PeerSelector::processMembershipChange(std::vector<StationInfo>& newPeers) {
     size_t threshold = FLAGS_peer_selector_max_allowed;
     rankPeers(newPeers, &threshold);
     if (threshold >= newPeers.size()) {
-      currentPeers_.clear();
-      for (const auto& it : newPeers) {
-        currentPeers_[it.macAddress] = it;
-      }
+      setPeers(newPeers);
       return;
     }
 
@@ -215,8 +256,5 @@ PeerSelector::processMembershipChange(std::vector<StationInfo>& newPeers) {
     nlHandler_.setRssiThreshold(rssiThreshold_);
   }
 
-  currentPeers_.clear();
-  for (const auto& it : newPeers) {
-    currentPeers_[it.macAddress] = it;
-  }
+  setPeers(newPeers);
 }
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <functional>
+#include <set>
+
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Portability.h>
@@ -66,9 +69,20 @@ class PeerSelector final {
    */
   void processMembershipChange(std::vector<StationInfo>& newPeers);
 
+  // Add or update peer in currentPeers_ and rankedPeers_
+  void setPeer(const StationInfo& peer);
+
+  // Replace current peers
+  void setPeers(const std::vector<StationInfo>& peers);
+
   // internal copy of peer list, for change detection
   std::map<folly::MacAddress, StationInfo> currentPeers_;
 
+  // current peers ranked best first by signal, as in rankPeers(), kept in
+  // sync with currentPeers_ so that candidates are ranked without sorting
+  std::set<std::pair<int32_t, folly::MacAddress>, std::greater<>>
+      rankedPeers_;
+
   // netlink handler used to request metrics from the kernel
   Nl80211HandlerInterface& nlHandler_;
 
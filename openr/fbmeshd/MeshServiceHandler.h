@@ -130,6 +130,11 @@ class MeshServiceHandler final : public thrift::MeshServiceSvIf {
   void
   dumpStats(std::vector<thrift::StatCounter>& ret) override {
     auto stats = statsClient_.getStats();
+    if (routing_) {
+      for (auto& kv : routing_->getCounters()) {
+        stats.emplace(kv.first, kv.second);
+      }
+    }
     for (const auto& it : stats) {
       ret.push_back(thrift::StatCounter{
           apache::thrift::FragileConstructor::FRAGILE,
@@ -9,9 +9,19 @@
 
 #include <folly/Subprocess.h>
 
+using namespace std::chrono_literals;
 using namespace openr::fbmeshd;
 
 namespace {
+
+// Delay of determining best root after mesh path changes, to coalesce a
+// burst of changes into a single mesh path dump
+const auto kDetermineBestRootDebounce{100ms};
+
+// Program routes even if unchanged, to restore addresses and routes removed
+// behind our back
+const auto kForcedProgramInterval{60s};
+
 folly::IPAddressV6
 getIPV6FromMacAddress(const char* prefix, folly::MacAddress macAddress) {
   folly::ByteArray16 bytes;
@@ -63,16 +73,36 @@ Gateway11sRootRouteProgrammer::Gateway11sRootRouteProgrammer(
           interface}}
       .wait();
 
-  timer_ = fbzmq::ZmqTimeout::make(
-      this, [this]() mutable noexcept { determineBestRoot(); });
+  timer_ = fbzmq::ZmqTimeout::make(this, [this]() mutable noexcept {
+    determineBestRoot(false /* force */);
+  });
   timer_->scheduleTimeout(interval, true);
+
+  determineBestRootTimer_ =
+      fbzmq::ZmqTimeout::make(this, [this]() mutable noexcept {
+        determineBestRoot(false /* force */);
+      });
+
+  forcedProgramTimer_ = fbzmq::ZmqTimeout::make(
+      this, [this]() mutable noexcept { determineBestRoot(true /* force */); });
+  forcedProgramTimer_->scheduleTimeout(kForcedProgramInterval, true);
+}
+
+void
+Gateway11sRootRouteProgrammer::scheduleDetermineBestRoot() {
+  runInEventLoop([this]() {
+    if (!determineBestRootTimer_->isScheduled()) {
+      determineBestRootTimer_->scheduleTimeout(kDetermineBestRootDebounce);
+    }
+  });
 }
 
 void
-Gateway11sRootRouteProgrammer::determineBestRoot() {
+Gateway11sRootRouteProgrammer::determineBestRoot(bool force) {
   const NetInterface& netif = nlHandler_.lookupMeshNetif();
 
   folly::Optional<std::pair<folly::MacAddress, uint32_t>> bestRoot;
+  folly::Optional<uint32_t> currentRootMetric;
 
   GenericNetlinkMessage msg{GenericNetlinkFamily::NL80211(),
                             NL80211_CMD_GET_MPATH,
@@ -80,9 +110,9 @@ Gateway11sRootRouteProgrammer::determineBestRoot() {
   uint32_t ifIndex = (uint32_t)netif.maybeIfIndex.value();
   nla_put_u32(msg, NL80211_ATTR_IFINDEX, ifIndex);
   bool isCurrentRootStillAlive = false;
-  GenericNetlinkSocket{}.sendAndReceive(
+  GenericNetlinkSocket::request(
       msg,
-      [&bestRoot, &isCurrentRootStillAlive, this](
+      [&bestRoot, &currentRootMetric, &isCurrentRootStillAlive, this](
           const GenericNetlinkMessage& msg) {
         const auto tb = msg.getAttributes<NL80211_ATTR_MAX>();
 
@@ -102,6 +132,7 @@ Gateway11sRootRouteProgrammer::determineBestRoot() {
             nla_get_u8(pinfo[NL80211_MPATH_INFO_IS_ROOT])) {
           if (currentRoot_ && currentRoot_->first == myMacAddress) {
             isCurrentRootStillAlive = true;
+            currentRootMetric = myMetric;
           }
           if (!bestRoot || bestRoot->second > myMetric) {
             bestRoot = std::make_pair(myMacAddress, myMetric);
@@ -112,12 +143,15 @@ Gateway11sRootRouteProgrammer::determineBestRoot() {
       });
 
   if (bestRoot) {
-    LOG(INFO) << "Best root: " << bestRoot->first
-              << " with metric: " << bestRoot->second;
+    VLOG(10) << "Best root: " << bestRoot->first
+             << " with metric: " << bestRoot->second;
   } else {
-    LOG(INFO) << "No root found";
+    VLOG(10) << "No root found";
   }
   if (currentRoot_ && isCurrentRootStillAlive) {
+    // Compare against current metric of the root, not the one it was picked
+    // with
+    currentRoot_->second = *currentRootMetric;
     if (bestRoot->second * gatewayChangeThresholdFactor_ <
         currentRoot_->second) {
       currentRoot_ = bestRoot;
@@ -126,15 +160,36 @@ Gateway11sRootRouteProgrammer::determineBestRoot() {
     currentRoot_ = bestRoot;
   }
   if (currentRoot_) {
-    LOG(INFO) << "Current root: " << currentRoot_->first
-              << " with metric: " << currentRoot_->second;
+    VLOG(10) << "Current root: " << currentRoot_->first
+             << " with metric: " << currentRoot_->second;
   } else {
-    LOG(INFO) << "No current root found";
+    VLOG(10) << "No current root found";
+  }
+
+  ProgramState state;
+  state.meshIfIndex = netif.maybeIfIndex.value();
+  state.taygaIfIndex = netlinkSocket_.getIfIndex("tayga").get();
+  state.isGate = isGate_;
+  if (currentRoot_) {
+    state.currentRoot = currentRoot_->first;
+  }
+
+  // Routes only depend on the state above, nothing to program if it is the
+  // same as when last programmed
+  if (!force && lastProgramState_ && *lastProgramState_ == state) {
+    VLOG(10) << "Root routes unchanged, skipping programming";
+    return;
+  }
+  if (currentRoot_ &&
+      (!lastProgramState_ ||
+       lastProgramState_->currentRoot != state.currentRoot)) {
+    LOG(INFO) << "Programming routes toward root: " << currentRoot_->first
+              << " with metric: " << currentRoot_->second;
   }
 
   openr::fbnl::NlUnicastRoutes routeDb;
   std::vector<fbnl::IfAddress> meshAddrs;
-  ifIndex = netlinkSocket_.getIfIndex("tayga").get();
+  ifIndex = state.taygaIfIndex;
   auto destination = std::make_pair<folly::IPAddress, uint8_t>(
       folly::IPAddressV6{"fd00:ffff::"}, 96);
 
@@ -216,9 +271,15 @@ Gateway11sRootRouteProgrammer::determineBestRoot() {
   netlinkSocket_.syncIfAddress(
       netif.maybeIfIndex.value(), meshAddrs, AF_INET6, RT_SCOPE_UNIVERSE);
   netlinkSocket_.syncUnicastRoutes(98, std::move(routeDb)).get();
+  lastProgramState_ = std::move(state);
 }
 
 void
 Gateway11sRootRouteProgrammer::setGatewayStatus(bool isGate) {
-  runImmediatelyOrInEventLoop([isGate, this]() { isGate_ = isGate; });
+  runImmediatelyOrInEventLoop([isGate, this]() {
+    if (isGate_ != isGate) {
+      isGate_ = isGate;
+      determineBestRootTimer_->scheduleTimeout(kDetermineBestRootDebounce);
+    }
+  });
 }
@@ -38,13 +38,38 @@ class Gateway11sRootRouteProgrammer : public fbzmq::ZmqEventLoop {
 
   void setGatewayStatus(bool isGate);
 
+  // Determine best root shortly, changes until then are coalesced. Can be
+  // called from any thread, e.g. on mesh path change notifications
+  void scheduleDetermineBestRoot();
+
  private:
-  void determineBestRoot();
+  // Inputs routes are built from, programming is skipped if they didn't
+  // change. Metric of the root is left out, a root is only replaced once a
+  // better one is beyond gatewayChangeThresholdFactor_
+  struct ProgramState {
+    int meshIfIndex{0};
+    int taygaIfIndex{0};
+    bool isGate{false};
+    folly::Optional<folly::MacAddress> currentRoot;
+
+    bool
+    operator==(const ProgramState& other) const {
+      return meshIfIndex == other.meshIfIndex &&
+          taygaIfIndex == other.taygaIfIndex && isGate == other.isGate &&
+          currentRoot == other.currentRoot;
+    }
+  };
+
+  // Pick root from mesh paths and program routes toward it, unless inputs
+  // are unchanged and not forced
+  void determineBestRoot(bool force);
 
   // netlink handler used to request mpath from the kernel
   Nl80211Handler& nlHandler_;
 
   std::unique_ptr<fbzmq::ZmqTimeout> timer_;
+  std::unique_ptr<fbzmq::ZmqTimeout> determineBestRootTimer_;
+  std::unique_ptr<fbzmq::ZmqTimeout> forcedProgramTimer_;
 
   openr::fbnl::NetlinkSocket netlinkSocket_;
 
@@ -53,6 +78,8 @@ class Gateway11sRootRouteProgrammer : public fbzmq::ZmqEventLoop {
   double const gatewayChangeThresholdFactor_;
 
   bool isGate_{false};
+
+  folly::Optional<ProgramState> lastProgramState_;
 };
 
 } // namespace fbmeshd
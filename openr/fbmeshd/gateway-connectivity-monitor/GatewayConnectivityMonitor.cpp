@@ -85,22 +85,29 @@ GatewayConnectivityMonitor::probeWanConnectivityRobustly() {
 
 bool
 GatewayConnectivityMonitor::probeWanConnectivity() {
-  Socket::Result result;
-
   VLOG(8) << "Probing WAN connectivity...";
-  bool connectionSucceeded = false;
-  for (const auto& monitoredAddress : monitoredAddresses_) {
-    Socket socket;
-    if ((result = socket.connect(
-             monitoredInterface_, monitoredAddress, monitorSocketTimeout_))
-            .success) {
-      VLOG(8) << "Successfully connected to " << monitoredAddress;
-      connectionSucceeded = true;
-      break;
-    } else {
-      VLOG(8) << "Failed to connect to " << monitoredAddress;
-    }
-  }
+  // All addresses are probed at once, first success ends the probe
+  const auto result = Socket::connectAny(
+      monitoredInterface_,
+      monitoredAddresses_,
+      monitorSocketTimeout_,
+      [this](
+          size_t index,
+          const Socket::Result& attempt,
+          std::chrono::milliseconds latency) {
+        const auto& monitoredAddress = monitoredAddresses_.at(index);
+        if (attempt.success) {
+          VLOG(8) << "Successfully connected to " << monitoredAddress << " in "
+                  << latency.count() << "ms";
+          statsClient_.addLatencyStat(
+              folly::sformat(
+                  statPathPrefixTemplate, "probe_wan_connectivity.latency_ms"),
+              latency);
+        } else {
+          VLOG(8) << "Failed to connect to " << monitoredAddress;
+        }
+      });
+  const bool connectionSucceeded = result.success;
 
   if (connectionSucceeded) {
     VLOG(8) << "Probing WAN connectivity succeeded";
@@ -108,7 +115,8 @@ GatewayConnectivityMonitor::probeWanConnectivity() {
         "fbmeshd.gateway_connectivity_monitor.probe_wan_connectivity.success");
   } else {
     VLOG(8) << "Probing WAN connectivity failed";
-    // If all connection attempts failed, report failure mode of the last one
+    // If all connection attempts failed, report failure mode of the last one,
+    // "timeout" if some were still in progress at the deadline
     statsClient_.incrementSumStat(folly::sformat(
         "fbmeshd.gateway_connectivity_monitor.probe_wan_connectivity.failed.{}",
         result.errorMsg));
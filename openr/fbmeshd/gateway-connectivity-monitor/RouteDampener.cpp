@@ -7,6 +7,7 @@
 
 #include "RouteDampener.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 using namespace openr::fbmeshd;
@@ -19,11 +20,8 @@ RouteDampener::RouteDampener(
     std::chrono::seconds halfLife,
     std::chrono::seconds maxSuppressLimit)
     : eventLoop_{eventLoop},
-      halfLifeTimer_{fbzmq::ZmqTimeout::make(
-          eventLoop_, [this]() mutable noexcept { halfLifeTimerExpired(); })},
-      maxSuppressLimitTimer_{fbzmq::ZmqTimeout::make(
-          eventLoop_,
-          [this]() mutable noexcept { maxSuppressLimitTimerExpired(); })},
+      undampenTimer_{fbzmq::ZmqTimeout::make(
+          eventLoop_, [this]() mutable noexcept { undampenTimerExpired(); })},
       penalty_{penalty},
       suppressLimit_{suppressLimit},
       reuseLimit_{reuseLimit},
@@ -44,12 +42,25 @@ RouteDampener::isValid() const {
 
 unsigned int
 RouteDampener::getHistory() const {
-  return history_;
+  return getHistory(std::chrono::steady_clock::now());
+}
+
+unsigned int
+RouteDampener::getHistory(std::chrono::steady_clock::time_point now) const {
+  const std::chrono::duration<double> elapsed = now - historyTime_;
+  const auto history = static_cast<unsigned int>(std::round(
+      history_ * std::exp2(-elapsed.count() / halfLife_.count())));
+  // forget history once it decayed to half of reuse limit
+  if (history < history_ && history <= reuseLimit_ / 2) {
+    return 0;
+  }
+  return history;
 }
 
 void
 RouteDampener::setHistory(unsigned int newHistory) {
   history_ = newHistory;
+  historyTime_ = std::chrono::steady_clock::now();
   setRdStat("default_route_history", history_);
   LOG(INFO) << "route dampener history set to " << history_;
 }
@@ -57,18 +68,20 @@ RouteDampener::setHistory(unsigned int newHistory) {
 void
 RouteDampener::flap() {
   eventLoop_->runImmediatelyOrInEventLoop([this]() {
-    setHistory(history_ + penalty_);
+    setHistory(getHistory() + penalty_);
 
     LOG(INFO) << "route dampener received flap";
 
     if (!dampened_ && history_ >= suppressLimit_) {
       LOG(INFO) << "route dampener dampening route ";
       dampened_ = true;
+      dampenedTime_ = historyTime_;
       setRdStat("default_route_dampened", 1);
-      startHalfLifeTimer();
-      startMaxSuppressLimitTimer();
       dampen();
     }
+    if (dampened_) {
+      scheduleUndampenTimer();
+    }
   });
 }
 
@@ -84,64 +97,58 @@ RouteDampener::undampenImpl() {
   LOG(INFO) << "route dampener undampening route ";
 
   dampened_ = false;
-  stopMaxSuppressLimitTimer();
+  if (undampenTimer_->isScheduled()) {
+    undampenTimer_->cancelTimeout();
+  }
   undampen();
   setRdStat("default_route_dampened", 0);
 }
 
 void
-RouteDampener::halfLifeTimerExpired() {
-  setHistory(history_ / 2);
-
-  LOG(INFO) << "route dampener half life timer expired";
+RouteDampener::scheduleUndampenTimer() {
+  CHECK(dampened_);
 
-  if (history_ <= (reuseLimit_ / 2)) {
-    LOG(INFO) << "route dampener reseting history";
-    setHistory(0);
-    stopHalfLifeTimer();
+  // history_ * 2^(-t / halfLife) = reuseLimit_
+  std::chrono::duration<double> untilReuse{0};
+  if (history_ > reuseLimit_) {
+    untilReuse = halfLife_ * std::log2(double(history_) / reuseLimit_);
   }
-
-  if (dampened_ && history_ <= reuseLimit_) {
-    undampenImpl();
-  }
-  userHalfLifeTimerExpired();
+  const auto undampenTime = std::min(
+      historyTime_ +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              untilReuse),
+      dampenedTime_ + maxSuppressLimit_);
+
+  // round up so that history has crossed reuse limit once timer expires
+  const auto timeout = std::max(
+      std::chrono::milliseconds{1},
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          undampenTime - std::chrono::steady_clock::now()) +
+          std::chrono::milliseconds{1});
+  undampenTimer_->scheduleTimeout(timeout);
 }
 
 void
-RouteDampener::maxSuppressLimitTimerExpired() {
-  LOG(INFO) << "route dampener max suppress limit timer expired";
-  if (dampened_) {
-    setHistory(0);
-    stopHalfLifeTimer();
-    undampenImpl();
+RouteDampener::undampenTimerExpired() {
+  if (!dampened_) {
+    return;
   }
-  userSuppressLimitTimerExpired();
-}
-
-void
-RouteDampener::startHalfLifeTimer() {
-  DCHECK_NOTNULL(halfLifeTimer_.get());
-  halfLifeTimer_->scheduleTimeout(halfLife_, true);
-}
-
-void
-RouteDampener::startMaxSuppressLimitTimer() {
-  DCHECK_NOTNULL(maxSuppressLimitTimer_.get());
-  maxSuppressLimitTimer_->scheduleTimeout(maxSuppressLimit_, false);
-}
 
-void
-RouteDampener::stopMaxSuppressLimitTimer() {
-  DCHECK_NOTNULL(maxSuppressLimitTimer_.get());
-  if (maxSuppressLimitTimer_->isScheduled()) {
-    maxSuppressLimitTimer_->cancelTimeout();
+  const auto now = std::chrono::steady_clock::now();
+  if (now >= dampenedTime_ + maxSuppressLimit_) {
+    LOG(INFO) << "route dampener max suppress limit timer expired";
+    setHistory(0);
+    undampenImpl();
+    userSuppressLimitTimerExpired();
+    return;
   }
-}
 
-void
-RouteDampener::stopHalfLifeTimer() {
-  DCHECK_NOTNULL(halfLifeTimer_.get());
-  if (halfLifeTimer_->isScheduled()) {
-    halfLifeTimer_->cancelTimeout();
+  LOG(INFO) << "route dampener reuse timer expired";
+  setHistory(getHistory(now));
+  if (history_ <= reuseLimit_) {
+    undampenImpl();
+  } else {
+    scheduleUndampenTimer();
   }
+  userReuseTimerExpired();
 }
@@ -25,6 +25,11 @@ namespace fbmeshd {
 // is not advisable to deploy bgp route dampening but that mostly has to do with
 // the network effects of route propagation. This should be better as its only
 // done on the edge.
+//
+// History decays exponentially with halfLife, computed from the time of its
+// last update when read rather than on timers. The only timer is the one for
+// undampening, scheduled while dampened for when history crosses reuseLimit
+// or maxSuppressLimit is hit, whichever comes first.
 class RouteDampener {
  public:
   explicit RouteDampener(
@@ -54,12 +59,13 @@ class RouteDampener {
   virtual void setStat(const std::string& path, int value) = 0;
 
   virtual void
-  userHalfLifeTimerExpired() {}
+  userReuseTimerExpired() {}
   virtual void
   userSuppressLimitTimerExpired() {}
 
   void setHistory(unsigned int newHistory);
 
+  // History decayed up to now
   unsigned int getHistory() const;
 
   template <typename... Params>
@@ -74,22 +80,25 @@ class RouteDampener {
   }
 
  private:
-  void halfLifeTimerExpired();
-  void maxSuppressLimitTimerExpired();
+  unsigned int getHistory(std::chrono::steady_clock::time_point now) const;
+
+  void undampenTimerExpired();
 
   void undampenImpl();
 
-  void startHalfLifeTimer();
-  void startMaxSuppressLimitTimer();
-  void stopMaxSuppressLimitTimer();
-  void stopHalfLifeTimer();
+  // Schedule undampen timer for when history decays to reuseLimit_, or
+  // maxSuppressLimit_ after dampening, whichever is first
+  void scheduleUndampenTimer();
 
  private:
   fbzmq::ZmqEventLoop* eventLoop_{nullptr};
+  // history as of historyTime_, decayed since
   unsigned int history_{0};
+  std::chrono::steady_clock::time_point historyTime_{
+      std::chrono::steady_clock::now()};
   bool dampened_{false};
-  std::unique_ptr<fbzmq::ZmqTimeout> halfLifeTimer_{nullptr};
-  std::unique_ptr<fbzmq::ZmqTimeout> maxSuppressLimitTimer_{nullptr};
+  std::chrono::steady_clock::time_point dampenedTime_;
+  std::unique_ptr<fbzmq::ZmqTimeout> undampenTimer_{nullptr};
   const unsigned int penalty_;
   const unsigned int suppressLimit_;
   const unsigned int reuseLimit_;
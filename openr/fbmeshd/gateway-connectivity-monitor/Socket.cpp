@@ -7,9 +7,12 @@
 
 #include "Socket.h"
 
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <memory>
+
 #include <folly/FileUtil.h>
 
 namespace openr {
@@ -28,6 +31,102 @@ Socket::connect(
     const std::string& interface,
     const folly::SocketAddress& address,
     const std::chrono::seconds& socketTimeout) {
+  auto result = startConnect(interface, address);
+  if (result.errorMsg != "in_progress") {
+    return result;
+  }
+
+  // Connection is in progress, wait for timeout
+  fd_set writefds;
+  FD_ZERO(&writefds);
+  FD_SET(fd, &writefds);
+
+  timeval timeout;
+  timeout.tv_sec = socketTimeout.count();
+  timeout.tv_usec = 0;
+
+  if (::select(fd + 1, nullptr, &writefds, nullptr, &timeout) == 0) {
+    return {false, "timeout"};
+  }
+
+  return finishConnect();
+}
+
+Socket::Result
+Socket::connectAny(
+    const std::string& interface,
+    const std::vector<folly::SocketAddress>& addresses,
+    const std::chrono::seconds& socketTimeout,
+    const std::function<void(size_t, const Result&, std::chrono::milliseconds)>&
+        onAttempt) {
+  const auto start = std::chrono::steady_clock::now();
+  const auto deadline = start + socketTimeout;
+  const auto elapsed = [start]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+  };
+
+  Result lastResult{false, "timeout"};
+  std::vector<std::unique_ptr<Socket>> sockets;
+  std::vector<pollfd> pollFds;
+  // index of address of each entry of pollFds
+  std::vector<size_t> pollIndices;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    sockets.emplace_back(std::make_unique<Socket>());
+    auto result = sockets.back()->startConnect(interface, addresses[i]);
+    if (result.errorMsg == "in_progress") {
+      pollFds.push_back(pollfd{sockets.back()->fd, POLLOUT, 0});
+      pollIndices.push_back(i);
+      continue;
+    }
+    onAttempt(i, result, elapsed());
+    if (result.success) {
+      return result;
+    }
+    lastResult = std::move(result);
+  }
+
+  while (!pollFds.empty()) {
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      return {false, "timeout"};
+    }
+    const int ret = ::poll(pollFds.data(), pollFds.size(), remaining.count());
+    if (ret == 0) {
+      return {false, "timeout"};
+    }
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return {false, "poll"};
+    }
+
+    for (size_t j = 0; j < pollFds.size();) {
+      if (pollFds[j].revents == 0) {
+        ++j;
+        continue;
+      }
+      const auto i = pollIndices[j];
+      auto result = sockets[i]->finishConnect();
+      onAttempt(i, result, elapsed());
+      // Early exit on first success, other attempts are closed with sockets
+      if (result.success) {
+        return result;
+      }
+      lastResult = std::move(result);
+      pollFds.erase(pollFds.begin() + j);
+      pollIndices.erase(pollIndices.begin() + j);
+    }
+  }
+  return lastResult;
+}
+
+Socket::Result
+Socket::startConnect(
+    const std::string& interface, const folly::SocketAddress& address) {
   if (fd != -1) {
     return {false, "in_use"};
   }
@@ -76,19 +175,11 @@ Socket::connect(
     return {false, "not_einprogress"};
   }
 
-  // Connection is in progress, wait for timeout
-  fd_set writefds;
-  FD_ZERO(&writefds);
-  FD_SET(fd, &writefds);
-
-  timeval timeout;
-  timeout.tv_sec = socketTimeout.count();
-  timeout.tv_usec = 0;
-
-  if (::select(fd + 1, nullptr, &writefds, nullptr, &timeout) == 0) {
-    return {false, "timeout"};
-  }
+  return {false, "in_progress"};
+}
 
+Socket::Result
+Socket::finishConnect() {
   int err;
   socklen_t err_len{sizeof(err)};
   if (::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) != 0) {
@@ -8,7 +8,9 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <folly/SocketAddress.h>
 
@@ -36,7 +38,27 @@ class Socket final {
       const folly::SocketAddress& address,
       const std::chrono::seconds& socketTimeout);
 
+  // Connect to all addresses at once, without blocking on any of them, until
+  // the first connection succeeds or socketTimeout expires. onAttempt is
+  // called with index of the address, result and latency of each attempt
+  // which completes. Returns result of the first success, else of the last
+  // failure
+  static Result connectAny(
+      const std::string& interface,
+      const std::vector<folly::SocketAddress>& addresses,
+      const std::chrono::seconds& socketTimeout,
+      const std::function<void(
+          size_t, const Result&, std::chrono::milliseconds)>& onAttempt);
+
  private:
+  // Start a non blocking connect, errorMsg is "in_progress" if it completes
+  // later, see finishConnect()
+  Result startConnect(
+      const std::string& interface, const folly::SocketAddress& address);
+
+  // Result of a connect whose socket is writable
+  Result finishConnect();
+
   int fd{-1};
 };
 
@@ -23,9 +23,19 @@ StatsClient::setAvgStat(const std::string& stat, int value) {
   tData_.addStatValue(stat, value, fbzmq::AVG);
 }
 
+void
+StatsClient::addLatencyStat(
+    const std::string& stat, std::chrono::milliseconds latency) {
+  (*latencyHistograms_.wlock())[stat].addValue(latency);
+}
+
 const std::unordered_map<std::string, int64_t>
 StatsClient::getStats() {
-  return tData_.getCounters();
+  auto stats = tData_.getCounters();
+  for (const auto& kv : *latencyHistograms_.rlock()) {
+    kv.second.exportCounters(kv.first, stats);
+  }
+  return stats;
 }
 
 } // namespace fbmeshd
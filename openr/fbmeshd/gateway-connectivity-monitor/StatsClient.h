@@ -12,6 +12,8 @@
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Context.h>
+#include <folly/Synchronized.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/Types.h>
 
 namespace openr {
@@ -31,11 +33,19 @@ class StatsClient final {
   void incrementSumStat(const std::string& stat);
   void setAvgStat(const std::string& stat, int value);
 
+  // Add sample to latency histogram of stat, exported as count and
+  // percentiles
+  void addLatencyStat(
+      const std::string& stat, std::chrono::milliseconds latency);
+
   const std::unordered_map<std::string, int64_t> getStats();
 
  private:
   // DS to keep track of stats
   fbzmq::ThreadData tData_;
+
+  folly::Synchronized<std::unordered_map<std::string, LatencyHistogram>>
+      latencyHistograms_;
 };
 
 } // namespace fbmeshd
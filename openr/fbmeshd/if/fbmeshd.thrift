@@ -72,3 +72,9 @@ struct MeshPathFramePANN {
   8: bool isGate
   9: bool replyRequested
 }
+
+// PANN elements aggregated into one frame, see routing_pann_aggregation_*
+// flags. Only sent when aggregation is enabled on all nodes of the mesh
+struct MeshPathFramePANNs {
+  1: list<MeshPathFramePANN> panns
+}
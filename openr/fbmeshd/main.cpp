@@ -145,6 +145,11 @@ DEFINE_uint32(
     routing_active_path_timeout_ms, 30000, "Routing active path timeout (ms)");
 DEFINE_uint32(
     routing_root_pann_interval_ms, 5000, "Routing PANN interval (ms)");
+DEFINE_uint32(
+    routing_pann_aggregation_interval_ms,
+    0,
+    "Aggregate PANNs sent to a neighbor over this interval (ms), raised up to "
+    "8x during PANN floods. 0 disables it, must be enabled on all nodes");
 DEFINE_uint32(
     routing_metric_manager_ewma_factor_log2,
     7,
@@ -277,8 +282,13 @@ main(int argc, char* argv[]) {
       &evl, "fbmeshd_shared_event_loop", watchdog.get());
   AuthsaeCallbackHelpers::init(evl);
 
+  StatsClient statsClient{};
+
   Nl80211Handler nlHandler{
-      evl, FLAGS_mesh_ifname, FLAGS_enable_userspace_mesh_peering};
+      evl,
+      FLAGS_mesh_ifname,
+      FLAGS_enable_userspace_mesh_peering,
+      &statsClient};
   auto returnValue = nlHandler.joinMeshes();
   if (returnValue != R_SUCCESS) {
     return returnValue;
@@ -328,7 +338,8 @@ main(int argc, char* argv[]) {
       nlHandler.lookupMeshNetif().maybeMacAddress.value(),
       FLAGS_routing_ttl,
       std::chrono::milliseconds{FLAGS_routing_active_path_timeout_ms},
-      std::chrono::milliseconds{FLAGS_routing_root_pann_interval_ms});
+      std::chrono::milliseconds{FLAGS_routing_root_pann_interval_ms},
+      std::chrono::milliseconds{FLAGS_routing_pann_aggregation_interval_ms});
   std::unique_ptr<UDPRoutingPacketTransport> routingPacketTransport =
       std::make_unique<UDPRoutingPacketTransport>(
           routingEventLoop.get(), FLAGS_mesh_ifname, 6668, FLAGS_routing_tos);
@@ -365,9 +376,17 @@ main(int argc, char* argv[]) {
         routingPacketTransport->sendPacket(da, std::move(buf));
       });
 
-  routingPacketTransport->setReceivePacketCallback(
-      [&routing](folly::MacAddress sa, std::unique_ptr<folly::IOBuf> buf) {
-        routing->receivePacket(sa, std::move(buf));
+  routing->setMeshPathsChangedCallback(
+      [&syncRoutes80211s, &gateway11sRootRouteProgrammer]() {
+        syncRoutes80211s->scheduleSyncRoutes();
+        if (gateway11sRootRouteProgrammer) {
+          gateway11sRootRouteProgrammer->scheduleDetermineBestRoot();
+        }
+      });
+
+  routingPacketTransport->setReceivePacketsCallback(
+      [&routing](const RoutingPackets& packets) {
+        routing->receivePackets(packets);
       });
 
   static constexpr auto routingId{"Routing"};
@@ -385,8 +404,6 @@ main(int argc, char* argv[]) {
         return address;
       })};
 
-  StatsClient statsClient{};
-
   GatewayConnectivityMonitor gatewayConnectivityMonitor{
       nlHandler,
       FLAGS_gateway_connectivity_monitor_interface,
@@ -453,6 +470,7 @@ main(int argc, char* argv[]) {
 
   if (routingEventLoop) {
     routing->resetSendPacketCallback();
+    routing->resetMeshPathsChangedCallback();
     routingEventLoop->terminateLoopSoon();
   }
 
@@ -11,6 +11,11 @@
 #include <netlink/genl/ctrl.h> // @manual
 #include <netlink/genl/genl.h> // @manual
 
+#include <functional>
+#include <memory>
+
+#include <folly/ScopeGuard.h>
+
 #include <openr/fbmeshd/nl/GenericNetlinkFamily.h>
 #include <openr/fbmeshd/nl/GenericNetlinkMessage.h>
 #include <openr/fbmeshd/nl/NetlinkSocket.h>
@@ -30,7 +35,54 @@ class GenericNetlinkSocket : public NetlinkSocket<GenericNetlinkMessage> {
     setBufferSize(8192, 8192);
   }
 
+  /**
+   * Send request and receive its replies on a socket kept per thread, instead
+   * of connecting a new one per request. Socket is replaced after a failed
+   * request, as it may still hold replies not read. Nested requests, made
+   * from reply callbacks, use a socket of their own
+   */
+  static void
+  request(
+      const GenericNetlinkMessage& msg,
+      const std::function<int(const GenericNetlinkMessage&)>& cbValid) {
+    auto& state = getThreadState();
+    if (state.inUse) {
+      GenericNetlinkSocket{}.sendAndReceive(msg, cbValid);
+      return;
+    }
+    if (!state.socket) {
+      state.socket = std::make_unique<GenericNetlinkSocket>();
+    }
+
+    state.inUse = true;
+    SCOPE_EXIT {
+      state.inUse = false;
+    };
+    try {
+      state.socket->sendAndReceive(msg, cbValid);
+    } catch (...) {
+      state.socket.reset();
+      throw;
+    }
+  }
+
+  static void
+  request(const GenericNetlinkMessage& msg) {
+    request(msg, [](const auto&) { return NL_OK; });
+  }
+
  private:
+  struct ThreadState {
+    std::unique_ptr<GenericNetlinkSocket> socket;
+    bool inUse{false};
+  };
+
+  static ThreadState&
+  getThreadState() {
+    static thread_local ThreadState state;
+    return state;
+  }
+
   int
   resolveGenericNetlinkFamily(const std::string& name) {
     int id = genl_ctrl_resolve(sock_, name.c_str());
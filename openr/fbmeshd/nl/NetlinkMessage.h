@@ -7,22 +7,78 @@
 
 #pragma once
 
+#include <netlink/msg.h> // @manual
 #include <netlink/netlink.h> // @manual
 
+#include <vector>
+
 #include <glog/logging.h>
 
 namespace openr {
 namespace fbmeshd {
 
+/*
+ * Per thread pool of nl_msg buffers for messages built by fbmeshd, so that
+ * each request doesn't allocate and free a page sized buffer. Buffers are
+ * handed out empty, with just room for the netlink header.
+ */
+class NetlinkMessagePool {
+ public:
+  // Most buffers kept per thread, beyond that they are freed
+  static constexpr size_t kMaxPooledMessages{16};
+
+  static nl_msg*
+  acquire() {
+    auto& pool = get();
+    if (pool.messages.empty()) {
+      auto msg = nlmsg_alloc();
+      CHECK_NOTNULL(msg);
+      return msg;
+    }
+    auto msg = pool.messages.back();
+    pool.messages.pop_back();
+    return msg;
+  }
+
+  static void
+  release(nl_msg* msg) {
+    auto& pool = get();
+    if (pool.messages.size() >= kMaxPooledMessages) {
+      nlmsg_free(msg);
+      return;
+    }
+    // Back to state of a new message, later attributes are appended after
+    // nlmsg_len. Header fields are all set again by nlmsg_put()
+    nlmsg_hdr(msg)->nlmsg_len = NLMSG_HDRLEN;
+    pool.messages.push_back(msg);
+  }
+
+ private:
+  struct Pool {
+    ~Pool() {
+      for (auto msg : messages) {
+        nlmsg_free(msg);
+      }
+    }
+    std::vector<nl_msg*> messages;
+  };
+
+  static Pool&
+  get() {
+    static thread_local Pool pool;
+    return pool;
+  }
+};
+
 /*
  * Netlink message class which is a wrapper for a nl_msg*.
  */
 class NetlinkMessage {
  public:
-  NetlinkMessage() : msg_{nlmsg_alloc()} {
-    CHECK_NOTNULL(msg_);
-  }
+  // New message to build, buffer comes from NetlinkMessagePool
+  NetlinkMessage() : msg_{NetlinkMessagePool::acquire()}, pooled_{true} {}
 
+  // Wrapper of a received message, no copy of it is made
   explicit NetlinkMessage(nl_msg* msg) : msg_{msg} {
     nlmsg_get(msg_);
   }
@@ -31,7 +87,11 @@ class NetlinkMessage {
   NetlinkMessage& operator=(const NetlinkMessage&) = delete;
 
   ~NetlinkMessage() {
-    nlmsg_free(msg_);
+    if (pooled_) {
+      NetlinkMessagePool::release(msg_);
+    } else {
+      nlmsg_free(msg_);
+    }
   }
 
   operator nl_msg*() const {
@@ -45,6 +105,10 @@ class NetlinkMessage {
 
  protected:
   nl_msg* msg_;
+
+ private:
+  // msg_ is owned by this message only and goes back to pool
+  const bool pooled_{false};
 };
 
 } // namespace fbmeshd
@@ -7,6 +7,7 @@
 
 #include "openr/fbmeshd/routing/MetricManager80211s.h"
 
+#include <algorithm>
 #include <cstddef>
 
 using namespace openr::fbmeshd;
@@ -27,8 +28,8 @@ MetricManager80211s::MetricManager80211s(
       hysteresisFactor_{hysteresisFactor},
       baseBitrate_{baseBitrate},
       rssiWeight_{rssiWeight} {
-  evb->runInEventBaseThread(
-      [this, interval] { evb_->scheduleTimeout(this, interval); });
+  // First update right away, link metrics are empty until then
+  evb->runInEventBaseThread([this] { timeoutExpired(); });
 }
 
 uint32_t
@@ -89,11 +90,15 @@ void
 MetricManager80211s::timeoutExpired() noexcept {
   VLOG(8) << "MetricManager80211s: updating metrics...";
   const auto stas = nlHandler_.getStationsInfo();
+
+  // Stations no longer reported are dropped from metrics_
+  std::vector<bool> seen(metrics_.size(), false);
   for (const auto& it : stas) {
     auto mac = it.macAddress;
-    uint32_t newMetricBitrate{bitrateToAirtime(it.expectedThroughput)};
-    uint32_t newMetricRssi{rssiToAirtime(it.signalAvgDbm)};
-    uint32_t newMetric;
+    const auto indexIt = metricIndex_.find(mac);
+    if (indexIt != metricIndex_.end()) {
+      seen[indexIt->second] = true;
+    }
 
     /* Filter bitrates of 0 so it doesn't polute the average */
     if (it.expectedThroughput == 0) {
@@ -107,6 +112,10 @@ MetricManager80211s::timeoutExpired() noexcept {
       continue;
     }
 
+    uint32_t newMetricBitrate{bitrateToAirtime(it.expectedThroughput)};
+    uint32_t newMetricRssi{rssiToAirtime(it.signalAvgDbm)};
+    uint32_t newMetric;
+
     // if the RSSI based metric seems broken, ignore it
     if (newMetricRssi == 0 || newMetricRssi > 1000) {
       VLOG(1) << "MetricManager80211s: rssi based metric seems broken: "
@@ -118,67 +127,85 @@ MetricManager80211s::timeoutExpired() noexcept {
         (1.0 - rssiWeight_) * newMetricBitrate + rssiWeight_ * newMetricRssi);
 
     /* Initialize to newMetric to speed up convergence  */
-    if (metrics_.count(mac) == 0) {
+    if (indexIt == metricIndex_.end()) {
       VLOG(10) << "MetricManager80211s: first metric entry for " << mac;
-      metrics_[mac].ewmaMetric = newMetric << ewmaFactor_;
+      metricIndex_.emplace(mac, metrics_.size());
+      metrics_.push_back(Metric{mac, newMetric << ewmaFactor_, 0, 0});
+      seen.push_back(true);
     }
+    auto& metric = metrics_[metricIndex_.at(mac)];
 
-    uint32_t oldMetric{metrics_[mac].ewmaMetric >> ewmaFactor_};
-    metrics_[mac].ewmaMetric += newMetric - oldMetric;
+    uint32_t oldMetric{metric.ewmaMetric >> ewmaFactor_};
+    metric.ewmaMetric += newMetric - oldMetric;
 
     /* We generally see very high metrics initially after links are established,
     which can cause long convergence times because the inital value is far off.
     This hack speeds up convergence for the first 10 samples, by pretending we
     received multiple samples. */
-    if (metrics_[mac].count < 10) {
-      for (uint32_t i = 10; i > metrics_[mac].count; i--) {
-        oldMetric = metrics_[mac].ewmaMetric >> ewmaFactor_;
-        metrics_[mac].ewmaMetric += newMetric - oldMetric;
+    if (metric.count < 10) {
+      for (uint32_t i = 10; i > metric.count; i--) {
+        oldMetric = metric.ewmaMetric >> ewmaFactor_;
+        metric.ewmaMetric += newMetric - oldMetric;
       }
-      metrics_[mac].count++;
+      metric.count++;
     }
 
     VLOG(10) << "MetricManager80211s: " << mac << " adding metric " << newMetric
-             << " new metric " << (metrics_[mac].ewmaMetric >> ewmaFactor_);
+             << " new metric " << (metric.ewmaMetric >> ewmaFactor_);
+  }
+
+  // Compact metrics_ if stations went away, and reindex
+  if (std::find(seen.begin(), seen.end(), false) != seen.end()) {
+    size_t next{0};
+    for (size_t i = 0; i < metrics_.size(); ++i) {
+      if (seen[i]) {
+        metrics_[next++] = metrics_[i];
+      }
+    }
+    metrics_.resize(next);
+    metricIndex_.clear();
+    for (size_t i = 0; i < metrics_.size(); ++i) {
+      metricIndex_.emplace(metrics_[i].macAddress, i);
+    }
+  }
+
+  linkMetrics_.clear();
+  for (const auto& sta : stas) {
+    if (sta.expectedThroughput == 0) {
+      continue;
+    }
+    /* If we don't have a metric for this station yet, use expected throughput*/
+    const auto indexIt = metricIndex_.find(sta.macAddress);
+    linkMetrics_.emplace(
+        sta.macAddress,
+        indexIt == metricIndex_.end()
+            ? bitrateToAirtime(sta.expectedThroughput)
+            : reportMetric(metrics_[indexIt->second]));
   }
 
   evb_->scheduleTimeout(this, interval_);
 }
 
 uint32_t
-MetricManager80211s::getLinkMetric(const StationInfo& sta) {
-  auto mac = sta.macAddress;
-
-  /* If we don't have a metric for this station yet, use expected throughput*/
-  if (metrics_.count(mac) == 0) {
-    VLOG(10) << "MetricManager80211s: request for unknown: " << mac;
-    return bitrateToAirtime(sta.expectedThroughput);
+MetricManager80211s::reportMetric(Metric& metric) {
+  if (metric.reportedMetric == 0) {
+    metric.reportedMetric = metric.ewmaMetric;
   }
 
-  if (metrics_[mac].reportedMetric == 0) {
-    metrics_[mac].reportedMetric = metrics_[mac].ewmaMetric;
+  uint32_t hysteresis{metric.reportedMetric >> hysteresisFactor_};
+  if (metric.ewmaMetric > metric.reportedMetric + hysteresis ||
+      metric.ewmaMetric < metric.reportedMetric - hysteresis) {
+    VLOG(10) << "MetricManager80211s: reported metric of "
+             << metric.macAddress << " changes from "
+             << (metric.reportedMetric >> ewmaFactor_) << " to "
+             << (metric.ewmaMetric >> ewmaFactor_);
+    metric.reportedMetric = metric.ewmaMetric;
   }
 
-  uint32_t hysteresis{metrics_[mac].reportedMetric >> hysteresisFactor_};
-  if (metrics_[mac].ewmaMetric > metrics_[mac].reportedMetric + hysteresis ||
-      metrics_[mac].ewmaMetric < metrics_[mac].reportedMetric - hysteresis) {
-    metrics_[mac].reportedMetric = metrics_[mac].ewmaMetric;
-  }
-
-  VLOG(10) << "MetricManager80211s: request for " << mac
-           << " reply: " << (metrics_[mac].reportedMetric >> ewmaFactor_);
-
-  return metrics_[mac].reportedMetric >> ewmaFactor_;
+  return metric.reportedMetric >> ewmaFactor_;
 }
 
 std::unordered_map<folly::MacAddress, uint32_t>
 MetricManager80211s::getLinkMetrics() {
-  std::unordered_map<folly::MacAddress, uint32_t> metrics;
-  for (const auto& sta : nlHandler_.getStationsInfo()) {
-    if (sta.expectedThroughput == 0) {
-      continue;
-    }
-    metrics.emplace(sta.macAddress, getLinkMetric(sta));
-  }
-  return metrics;
+  return linkMetrics_;
 }
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <chrono>
+#include <unordered_map>
+#include <vector>
 
 #include <folly/io/async/AsyncTimeout.h>
 #include <folly/io/async/EventBase.h>
@@ -21,6 +23,7 @@ namespace fbmeshd {
 class MetricManager80211s : public MetricManager, public folly::AsyncTimeout {
  public:
   struct Metric {
+    folly::MacAddress macAddress;
     uint32_t ewmaMetric{0};
     uint32_t reportedMetric{0};
     uint32_t count{0};
@@ -43,20 +46,30 @@ class MetricManager80211s : public MetricManager, public folly::AsyncTimeout {
   MetricManager80211s& operator=(const MetricManager80211s&) = delete;
   MetricManager80211s& operator=(MetricManager80211s&&) = delete;
 
-  uint32_t getLinkMetric(const StationInfo& sta);
-
+  // Link metrics of stations as of last update. They only change when the
+  // EWMA of a station moves out of hysteresis range of its reported metric
   virtual std::unordered_map<folly::MacAddress, uint32_t> getLinkMetrics()
       override;
 
  private:
+  // Update EWMA of all stations in one pass over metrics_, then refresh
+  // linkMetrics_
   virtual void timeoutExpired() noexcept override;
+
+  // Apply hysteresis to EWMA of metric, returns reported link metric
+  uint32_t reportMetric(Metric& metric);
+
   uint32_t bitrateToAirtime(uint32_t rate);
   uint32_t rssiToAirtime(int32_t rssi);
 
   folly::EventBase* evb_;
   std::chrono::milliseconds interval_;
   Nl80211Handler& nlHandler_;
-  std::unordered_map<folly::MacAddress, Metric> metrics_;
+  // EWMA state of stations, contiguous for the per interval update, and
+  // index of each station in it
+  std::vector<Metric> metrics_;
+  std::unordered_map<folly::MacAddress, size_t> metricIndex_;
+  std::unordered_map<folly::MacAddress, uint32_t> linkMetrics_;
   uint32_t ewmaFactor_;
   uint32_t hysteresisFactor_;
   uint32_t baseBitrate_;
@@ -7,11 +7,13 @@
 
 #include "Routing.h"
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
 
 #include <glog/logging.h>
 
+#include <folly/ExceptionString.h>
 #include <folly/MacAddress.h>
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <folly/system/ThreadName.h>
@@ -27,18 +29,13 @@ const auto kMeshHousekeepingInterval{60s};
 const auto kMeshPathExpire{60s};
 const auto kMinGatewayRedundancy{2};
 
-void
-meshPathExpire(
-    std::unordered_map<folly::MacAddress, Routing::MeshPath>& paths) {
-  for (auto it = paths.begin(); it != paths.end();) {
-    const auto& mpath = it->second;
-    if (std::chrono::steady_clock::now() > mpath.expTime + kMeshPathExpire) {
-      it = paths.erase(it);
-    } else {
-      ++it;
-    }
-  }
-}
+// With aggregation, most PANN elements sent in one frame, so that frames stay
+// well below mesh MTU (a compact encoded element takes less than 40 bytes)
+const size_t kMaxPannsPerFrame{32};
+
+// Aggregation interval is raised up to this factor of the configured one
+// while PANN floods fill whole frames
+const auto kMaxPannAggregationFactor{8};
 
 } // namespace
 
@@ -48,7 +45,8 @@ Routing::Routing(
     folly::MacAddress nodeAddr,
     uint32_t elementTtl,
     std::chrono::milliseconds activePathTimeout,
-    std::chrono::milliseconds rootPannInterval)
+    std::chrono::milliseconds rootPannInterval,
+    std::chrono::milliseconds pannAggregationInterval)
     : evb_{evb},
       nodeAddr_{nodeAddr},
       elementTtl_{elementTtl},
@@ -59,8 +57,12 @@ Routing::Routing(
           *evb_, [this]() noexcept { doMeshHousekeeping(); })},
       meshPathRootTimer_{folly::AsyncTimeout::make(
           *evb_, [this]() noexcept { doMeshPathRoot(); })},
+      pannFlushTimer_{folly::AsyncTimeout::make(
+          *evb_, [this]() noexcept { flushPannFrames(); })},
       activePathTimeout_{activePathTimeout},
-      rootPannInterval_{rootPannInterval} {
+      rootPannInterval_{rootPannInterval},
+      pannAggregationInterval_{pannAggregationInterval},
+      currentPannAggregationInterval_{pannAggregationInterval} {
   evb_->runInEventBaseThread([this]() { prepare(); });
 }
 
@@ -84,12 +86,62 @@ Routing::getMeshPaths() {
 
 Routing::MeshPath&
 Routing::getMeshPath(folly::MacAddress addr) {
-  return meshPaths_
-      .emplace(
-          std::piecewise_construct,
-          std::forward_as_tuple(addr),
-          std::forward_as_tuple(addr))
-      .first->second;
+  auto ret = meshPaths_.emplace(
+      std::piecewise_construct,
+      std::forward_as_tuple(addr),
+      std::forward_as_tuple(addr));
+  if (ret.second) {
+    expiryIndex_.emplace(ret.first->second.expTime, addr);
+  }
+  return ret.first->second;
+}
+
+void
+Routing::setMeshPathExpTime(
+    MeshPath& mpath, std::chrono::steady_clock::time_point expTime) {
+  expiryIndex_.erase(std::make_pair(mpath.expTime, mpath.dst));
+  mpath.expTime = expTime;
+  expiryIndex_.emplace(expTime, mpath.dst);
+}
+
+bool
+Routing::expireMeshPaths() {
+  const auto now = std::chrono::steady_clock::now();
+  bool changed{false};
+
+  // Paths are removed kMeshPathExpire after they expired, oldest first
+  while (!expiryIndex_.empty() &&
+         now > expiryIndex_.begin()->first + kMeshPathExpire) {
+    auto mpathIt = meshPaths_.find(expiryIndex_.begin()->second);
+    if (mpathIt->second.isGate) {
+      gateIndex_.erase(
+          std::make_pair(mpathIt->second.metric, mpathIt->second.dst));
+    }
+    meshPaths_.erase(mpathIt);
+    expiryIndex_.erase(expiryIndex_.begin());
+    changed = true;
+  }
+
+  // Gate paths which expired since previous housekeeping run change gate
+  // selection, though they are not removed yet
+  const auto lastRun =
+      std::make_pair(now - kMeshHousekeepingInterval, folly::MacAddress{});
+  for (auto it = expiryIndex_.lower_bound(lastRun);
+       it != expiryIndex_.end() && it->first < now;
+       ++it) {
+    if (meshPaths_.at(it->second).isGate) {
+      changed = true;
+      break;
+    }
+  }
+  return changed;
+}
+
+void
+Routing::notifyMeshPathsChanged() {
+  if (meshPathsChangedCallback_) {
+    (*meshPathsChangedCallback_)();
+  }
 }
 
 /*
@@ -99,7 +151,9 @@ Routing::getMeshPath(folly::MacAddress addr) {
 void
 Routing::doMeshHousekeeping() {
   VLOG(8) << folly::sformat("Routing::{}()", __func__);
-  meshPathExpire(meshPaths_);
+  if (expireMeshPaths()) {
+    notifyMeshPathsChanged();
+  }
   housekeepingTimer_->scheduleTimeout(kMeshHousekeepingInterval);
 }
 
@@ -139,26 +193,108 @@ Routing::txPannFrame(
     bool replyRequested) {
   VLOG(8) << folly::sformat("Routing::{}()", __func__);
 
-  std::string skb;
   VLOG(10) << "sending PANN orig:" << origAddr << " target:" << targetAddr
            << " dst:" << da.toString();
-  serializer_.serialize(
-      thrift::MeshPathFramePANN{
-          apache::thrift::FRAGILE,
-          origAddr.u64NBO(),
-          origSn,
-          hopCount,
-          ttl,
-          targetAddr.u64NBO(),
-          metric,
-          isGate,
-          replyRequested,
-      },
-      &skb);
+  thrift::MeshPathFramePANN pann{
+      apache::thrift::FRAGILE,
+      origAddr.u64NBO(),
+      origSn,
+      hopCount,
+      ttl,
+      targetAddr.u64NBO(),
+      metric,
+      isGate,
+      replyRequested,
+  };
+
+  if (pannAggregationInterval_.count() == 0) {
+    txFrame(da, MeshPathFrameType::PANN, pann);
+    return;
+  }
+
+  // A newer PANN of same originator and target replaces the pending one, it
+  // would only be overridden by it on receivers
+  auto& pending = pendingPanns_[da];
+  auto it = std::find_if(
+      pending.begin(), pending.end(), [&pann](const auto& pendingPann) {
+        return pendingPann.origAddr == pann.origAddr &&
+            pendingPann.targetAddr == pann.targetAddr;
+      });
+  if (it != pending.end()) {
+    if (it->origSn <= pann.origSn) {
+      *it = std::move(pann);
+    }
+    tData_.addStatValue(
+        "fbmeshd.routing.pann_elements_suppressed", 1, fbzmq::SUM);
+  } else {
+    pending.emplace_back(std::move(pann));
+  }
+
+  if (!pannFlushTimer_->isScheduled()) {
+    pannFlushTimer_->scheduleTimeout(currentPannAggregationInterval_);
+  }
+}
+
+void
+Routing::flushPannFrames() {
+  VLOG(8) << folly::sformat("Routing::{}()", __func__);
+
+  size_t numPanns{0};
+  size_t numFrames{0};
+  for (auto& kv : pendingPanns_) {
+    auto& panns = kv.second;
+    numPanns += panns.size();
+    // Single element goes out as a plain PANN frame
+    if (panns.size() == 1) {
+      txFrame(kv.first, MeshPathFrameType::PANN, panns.front());
+      ++numFrames;
+      continue;
+    }
+    for (size_t i = 0; i < panns.size(); i += kMaxPannsPerFrame) {
+      thrift::MeshPathFramePANNs frame;
+      frame.panns.assign(
+          std::make_move_iterator(panns.begin() + i),
+          std::make_move_iterator(
+              panns.begin() + std::min(panns.size(), i + kMaxPannsPerFrame)));
+      txFrame(kv.first, MeshPathFrameType::PANNS, frame);
+      ++numFrames;
+    }
+  }
+  pendingPanns_.clear();
+
+  tData_.addStatValue(
+      "fbmeshd.routing.pann_elements_sent", numPanns, fbzmq::SUM);
+  tData_.addStatValue(
+      "fbmeshd.routing.pann_frames_sent", numFrames, fbzmq::SUM);
+  tData_.addStatValue(
+      "fbmeshd.routing.pann_frames_saved", numPanns - numFrames, fbzmq::SUM);
+
+  // Adapt to flood rate: aggregate over longer intervals while floods fill
+  // whole frames, back to configured interval once they calm down
+  if (numPanns > kMaxPannsPerFrame) {
+    currentPannAggregationInterval_ = std::min(
+        currentPannAggregationInterval_ * 2,
+        pannAggregationInterval_ * kMaxPannAggregationFactor);
+  } else if (numPanns <= 1) {
+    currentPannAggregationInterval_ = std::max(
+        currentPannAggregationInterval_ / 2, pannAggregationInterval_);
+  }
+  tData_.addStatValue(
+      "fbmeshd.routing.pann_aggregation_interval_ms",
+      currentPannAggregationInterval_.count(),
+      fbzmq::AVG);
+}
+
+template <typename ThriftType>
+void
+Routing::txFrame(
+    folly::MacAddress da, MeshPathFrameType type, const ThriftType& frame) {
+  std::string skb;
+  serializer_.serialize(frame, &skb);
 
   auto buf = folly::IOBuf::copyBuffer(skb, 1, 0);
   buf->prepend(1);
-  *buf->writableData() = static_cast<uint8_t>(MeshPathFrameType::PANN);
+  *buf->writableData() = static_cast<uint8_t>(type);
 
   if (sendPacketCallback_) {
     (*sendPacketCallback_)(da, std::move(buf));
@@ -173,47 +309,111 @@ void
 Routing::receivePacket(
     folly::MacAddress sa, std::unique_ptr<folly::IOBuf> data) {
   VLOG(8) << folly::sformat("Routing::{}()", __func__);
-  auto action = static_cast<MeshPathFrameType>(*data->data());
-  data->trimStart(1);
+  processPacket(sa, data->coalesce(), metricManager_->getLinkMetrics());
+}
 
-  thrift::MeshPathFramePANN pann;
-  switch (action) {
-  case MeshPathFrameType::PANN:
-    serializer_.deserialize(data.get(), pann);
-    hwmpPannFrameProcess(sa, pann);
-    break;
-  default:
-    return;
+void
+Routing::receivePackets(
+    const std::vector<std::pair<folly::MacAddress, folly::ByteRange>>&
+        packets) {
+  VLOG(8) << folly::sformat("Routing::{}({})", __func__, packets.size());
+  tData_.addStatValue(
+      "fbmeshd.routing.rx_frames_per_wakeup", packets.size(), fbzmq::AVG);
+
+  const auto linkMetrics = metricManager_->getLinkMetrics();
+  for (const auto& packet : packets) {
+    processPacket(packet.first, packet.second, linkMetrics);
   }
 }
 
-bool
-Routing::isStationInTopKGates(folly::MacAddress mac) {
-  std::vector<std::pair<uint32_t, folly::MacAddress>> ret;
+void
+Routing::processPacket(
+    folly::MacAddress sa,
+    folly::ByteRange data,
+    const std::unordered_map<folly::MacAddress, uint32_t>& linkMetrics) {
+  if (data.empty()) {
+    return;
+  }
+  auto action = static_cast<MeshPathFrameType>(data.front());
+  data.advance(1);
 
-  for (const auto& mpath : meshPaths_) {
-    if (!mpath.second.expired() && mpath.second.isGate) {
-      ret.emplace_back(mpath.second.metric, mpath.first);
+  thrift::MeshPathFramePANN pann;
+  thrift::MeshPathFramePANNs panns;
+  try {
+    switch (action) {
+    case MeshPathFrameType::PANN:
+      serializer_.deserialize(data, pann);
+      hwmpPannFrameProcess(sa, pann, linkMetrics);
+      break;
+    case MeshPathFrameType::PANNS:
+      serializer_.deserialize(data, panns);
+      for (auto& element : panns.panns) {
+        hwmpPannFrameProcess(sa, std::move(element), linkMetrics);
+      }
+      break;
+    default:
+      return;
     }
+  } catch (const std::exception& e) {
+    // a malformed frame must not drop the rest of the batch
+    LOG(ERROR) << "Failed processing frame from " << sa << ": "
+               << folly::exceptionStr(e);
   }
+}
 
-  std::sort(ret.begin(), ret.end());
-
+bool
+Routing::isStationInTopKGates(folly::MacAddress mac) {
   const size_t maxNoGates =
       isGate_ ? kMinGatewayRedundancy - 1 : kMinGatewayRedundancy;
 
-  for (size_t i = 0; i < maxNoGates && i < ret.size(); i++) {
-    if (ret[i].second == mac) {
+  // Gates in gateIndex_ are ranked by metric, expired ones are skipped until
+  // they are removed from mesh paths
+  size_t i{0};
+  for (auto it = gateIndex_.begin(); it != gateIndex_.end() && i < maxNoGates;
+       ++it) {
+    if (meshPaths_.at(it->second).expired()) {
+      continue;
+    }
+    if (it->second == mac) {
       return true;
     }
+    ++i;
   }
 
   return false;
 }
 
+size_t
+Routing::countGatesWithMetricAtMost(
+    uint32_t metric, folly::MacAddress exclude, size_t limit) {
+  size_t count{0};
+  for (auto it = gateIndex_.begin();
+       it != gateIndex_.end() && it->first <= metric && count < limit;
+       ++it) {
+    if (it->second != exclude && !meshPaths_.at(it->second).expired()) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void
+Routing::setMeshPathGate(MeshPath& mpath, bool isGate, uint32_t metric) {
+  if (mpath.isGate) {
+    gateIndex_.erase(std::make_pair(mpath.metric, mpath.dst));
+  }
+  mpath.isGate = isGate;
+  mpath.metric = metric;
+  if (isGate) {
+    gateIndex_.emplace(metric, mpath.dst);
+  }
+}
+
 void
 Routing::hwmpPannFrameProcess(
-    folly::MacAddress sa, thrift::MeshPathFramePANN pann) {
+    folly::MacAddress sa,
+    thrift::MeshPathFramePANN pann,
+    const std::unordered_map<folly::MacAddress, uint32_t>& linkMetrics) {
   VLOG(8) << folly::sformat("Routing::{}({}, ...)", __func__, sa.toString());
 
   folly::MacAddress origAddr{folly::MacAddress::fromNBO(pann.origAddr)};
@@ -224,6 +424,8 @@ Routing::hwmpPannFrameProcess(
   uint8_t ttl{pann.ttl};
   folly::MacAddress targetAddr{folly::MacAddress::fromNBO(pann.targetAddr)};
 
+  tData_.addStatValue("fbmeshd.routing.pann_frames_processed", 1, fbzmq::RATE);
+
   /*  Ignore our own PANNs */
   if (origAddr == nodeAddr_) {
     return;
@@ -232,10 +434,8 @@ Routing::hwmpPannFrameProcess(
   VLOG(10) << "received PANN from " << origAddr << " via neighbour " << sa
            << " target " << targetAddr << " (is_gate=" << pann.isGate << ")";
 
-  const auto stas = metricManager_->getLinkMetrics();
-
-  const auto sta = stas.find(sa);
-  if (sta == stas.end()) {
+  const auto sta = linkMetrics.find(sa);
+  if (sta == linkMetrics.end()) {
     VLOG(10) << "discarding PANN - sta not found";
     return;
   }
@@ -283,25 +483,33 @@ Routing::hwmpPannFrameProcess(
 
   const auto topKGatesOldHasOrig = isStationInTopKGates(origAddr);
 
+  const size_t minGateRedundancy =
+      isGate_ ? kMinGatewayRedundancy - 1 : kMinGatewayRedundancy;
   if (pann.isGate &&
-      std::count_if(
-          meshPaths_.begin(),
-          meshPaths_.end(),
-          [origAddr, newMetric](const auto& mpathPair) {
-            const auto& mpath = mpathPair.second;
-            return mpath.dst != origAddr && !mpath.expired() && mpath.isGate &&
-                mpath.metric <= newMetric;
-          }) >= (isGate_ ? kMinGatewayRedundancy - 1 : kMinGatewayRedundancy)) {
+      countGatesWithMetricAtMost(newMetric, origAddr, minGateRedundancy) >=
+          minGateRedundancy) {
     return;
   }
 
+  // Routes are programmed per next hop and the gate is picked by metric, so
+  // only these changes are worth a route sync
+  const bool routeChanged = mpath.nextHop != sa ||
+      mpath.isGate != pann.isGate ||
+      (pann.isGate && (mpath.expired() || mpath.metric != newMetric));
+
+  tData_.addStatValue("fbmeshd.routing.pann_frames_accepted", 1, fbzmq::RATE);
+
   mpath.sn = origSn;
-  mpath.metric = newMetric;
+  setMeshPathGate(mpath, pann.isGate, newMetric);
   mpath.nextHop = sa;
   mpath.nextHopMetric = lastHopMetric;
   mpath.hopCount = hopCount;
-  mpath.isGate = pann.isGate;
-  mpath.expTime = std::chrono::steady_clock::now() + activePathTimeout_;
+  setMeshPathExpTime(
+      mpath, std::chrono::steady_clock::now() + activePathTimeout_);
+
+  if (routeChanged) {
+    notifyMeshPathsChanged();
+  }
 
   if (pann.replyRequested) {
     txPannFrame(
@@ -357,6 +565,7 @@ Routing::setGatewayStatus(bool isGate) {
       return;
     }
     isGate_ = isGate;
+    notifyMeshPathsChanged();
 
     if (isGate) {
       noLongerAGateRANNTimer_->cancelTimeout();
@@ -370,6 +579,23 @@ Routing::setGatewayStatus(bool isGate) {
   });
 }
 
+void
+Routing::forEachMeshPath(folly::FunctionRef<void(const MeshPath&)> func) {
+  evb_->runImmediatelyOrRunInEventBaseThreadAndWait([this, func]() {
+    for (const auto& mpath : meshPaths_) {
+      func(mpath.second);
+    }
+  });
+}
+
+std::unordered_map<std::string, int64_t>
+Routing::getCounters() {
+  std::unordered_map<std::string, int64_t> counters;
+  evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
+      [this, &counters]() { counters = tData_.getCounters(); });
+  return counters;
+}
+
 std::unordered_map<folly::MacAddress, Routing::MeshPath>
 Routing::dumpMpaths() {
   VLOG(8) << folly::sformat("Routing::{}()", __func__);
@@ -399,3 +625,23 @@ Routing::resetSendPacketCallback() {
     sendPacketCallback_.reset();
   }
 }
+
+void
+Routing::setMeshPathsChangedCallback(std::function<void()> cb) {
+  if (evb_->isRunning()) {
+    evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
+        [this, cb = std::move(cb)]() { meshPathsChangedCallback_ = cb; });
+  } else {
+    meshPathsChangedCallback_ = cb;
+  }
+}
+
+void
+Routing::resetMeshPathsChangedCallback() {
+  if (evb_->isRunning()) {
+    evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
+        [this]() { meshPathsChangedCallback_.reset(); });
+  } else {
+    meshPathsChangedCallback_.reset();
+  }
+}
@@ -9,10 +9,16 @@
 
 #include <chrono>
 #include <queue>
+#include <set>
+#include <utility>
+#include <vector>
 
+#include <fbzmq/service/stats/ThreadData.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <folly/Function.h>
 #include <folly/IPAddressV6.h>
+#include <folly/Range.h>
 #include <folly/SocketAddress.h>
 #include <folly/io/IOBuf.h>
 #include <folly/io/async/AsyncUDPServerSocket.h>
@@ -30,7 +36,7 @@ class Routing {
   /*
    * mesh path frame type
    */
-  enum class MeshPathFrameType { PANN = 0 };
+  enum class MeshPathFrameType { PANN = 0, PANNS = 1 };
 
   /**
    * mesh path structure
@@ -86,7 +92,8 @@ class Routing {
       folly::MacAddress nodeAddr,
       uint32_t elementTtl,
       std::chrono::milliseconds activePathTimeout,
-      std::chrono::milliseconds rootPannInterval);
+      std::chrono::milliseconds rootPannInterval,
+      std::chrono::milliseconds pannAggregationInterval);
 
   Routing() = delete;
   ~Routing() = default;
@@ -100,14 +107,39 @@ class Routing {
 
   std::unordered_map<folly::MacAddress, MeshPath> dumpMpaths();
 
+  // PANN processing and transmission counters
+  std::unordered_map<std::string, int64_t> getCounters();
+
   void setSendPacketCallback(
       std::function<void(folly::MacAddress, std::unique_ptr<folly::IOBuf>)> cb);
   void resetSendPacketCallback();
 
+  /*
+   * Callback invoked from the routing event base whenever the forwarding
+   * state derived from mesh paths may have changed: a path was added,
+   * removed or got a new next hop, a gate path changed metric or expired, or
+   * the local gateway status changed
+   */
+  void setMeshPathsChangedCallback(std::function<void()> cb);
+  void resetMeshPathsChangedCallback();
+
   void receivePacket(folly::MacAddress sa, std::unique_ptr<folly::IOBuf> data);
 
+  // Process frames received in one transport wakeup, by source station. Link
+  // metrics are looked up once for the whole batch
+  void receivePackets(
+      const std::vector<std::pair<folly::MacAddress, folly::ByteRange>>&
+          packets);
+
   std::unordered_map<folly::MacAddress, MeshPath> getMeshPaths();
 
+  /*
+   * Call func on each mesh path from the routing event base, without copying
+   * the mesh path table, and wait for it to complete. func must not call back
+   * into Routing
+   */
+  void forEachMeshPath(folly::FunctionRef<void(const MeshPath&)> func);
+
  private:
   void prepare();
 
@@ -115,6 +147,16 @@ class Routing {
 
   MeshPath& getMeshPath(folly::MacAddress addr);
 
+  // Update expiry time of mesh path, always through here for expiryIndex_
+  void setMeshPathExpTime(
+      MeshPath& mpath, std::chrono::steady_clock::time_point expTime);
+
+  // Remove long expired paths. Returns true if a path was removed, or a gate
+  // path expired since the previous housekeeping run
+  bool expireMeshPaths();
+
+  void notifyMeshPathsChanged();
+
   /*
    * HWMP Timer callbacks
    */
@@ -136,10 +178,34 @@ class Routing {
       bool isGate,
       bool replyRequested);
 
+  // Send PANN elements queued by txPannFrame() with aggregation enabled, and
+  // adapt aggregation interval to the number of elements
+  void flushPannFrames();
+
+  template <typename ThriftType>
+  void txFrame(
+      folly::MacAddress da, MeshPathFrameType type, const ThriftType& frame);
+
   bool isStationInTopKGates(folly::MacAddress mac);
 
+  // Number of non expired gates other than exclude with metric at most
+  // metric, counting stops at limit
+  size_t countGatesWithMetricAtMost(
+      uint32_t metric, folly::MacAddress exclude, size_t limit);
+
+  // Update gate flag and metric of mesh path, always through here for
+  // gateIndex_
+  void setMeshPathGate(MeshPath& mpath, bool isGate, uint32_t metric);
+
+  void processPacket(
+      folly::MacAddress sa,
+      folly::ByteRange data,
+      const std::unordered_map<folly::MacAddress, uint32_t>& linkMetrics);
+
   void hwmpPannFrameProcess(
-      folly::MacAddress sa, thrift::MeshPathFramePANN rann);
+      folly::MacAddress sa,
+      thrift::MeshPathFramePANN rann,
+      const std::unordered_map<folly::MacAddress, uint32_t>& linkMetrics);
 
   folly::EventBase* evb_;
 
@@ -155,6 +221,8 @@ class Routing {
       std::function<void(folly::MacAddress, std::unique_ptr<folly::IOBuf>)>>
       sendPacketCallback_;
 
+  folly::Optional<std::function<void()>> meshPathsChangedCallback_;
+
   /*
    * L3 Routing state
    */
@@ -164,6 +232,7 @@ class Routing {
 
   std::unique_ptr<folly::AsyncTimeout> housekeepingTimer_;
   std::unique_ptr<folly::AsyncTimeout> meshPathRootTimer_;
+  std::unique_ptr<folly::AsyncTimeout> pannFlushTimer_;
 
   /* Local mesh Sequence Number */
   uint64_t sn_{0};
@@ -176,10 +245,30 @@ class Routing {
   std::chrono::milliseconds rootPannInterval_;
   bool isGate_{false};
 
+  /*
+   * PANN aggregation, disabled if interval is 0. PANNs pending per
+   * destination until next flush
+   */
+  const std::chrono::milliseconds pannAggregationInterval_;
+  std::chrono::milliseconds currentPannAggregationInterval_;
+  std::unordered_map<folly::MacAddress, std::vector<thrift::MeshPathFramePANN>>
+      pendingPanns_;
+
   /*
    * Path state
    */
   std::unordered_map<folly::MacAddress, MeshPath> meshPaths_;
+
+  // Mesh paths ordered by expiry time, to expire them without scanning
+  // meshPaths_
+  std::set<std::pair<std::chrono::steady_clock::time_point, folly::MacAddress>>
+      expiryIndex_;
+
+  // Gate mesh paths ordered by metric, for top-K gate lookups on each PANN.
+  // May hold expired gates until housekeeping removes their paths
+  std::set<std::pair<uint32_t, folly::MacAddress>> gateIndex_;
+
+  fbzmq::ThreadData tData_;
 };
 
 } // namespace fbmeshd
@@ -19,7 +19,42 @@ using namespace openr::fbmeshd;
 
 namespace {
 
-const auto kSyncRoutesInterval{1s};
+// Delay of a route sync after mesh path changes, to coalesce changes from a
+// burst of PANNs into a single sync
+const auto kSyncRoutesDebounce{10ms};
+
+// Full sync, to pick up tayga interface changes and to restore addresses and
+// routes no mesh path change would trigger
+const auto kPeriodicSyncInterval{10s};
+
+const auto kTaygaIfName{"tayga"};
+
+openr::fbnl::Route
+buildMeshRoute(
+    folly::CIDRNetwork destination,
+    folly::MacAddress nextHop,
+    int meshIfIndex) {
+  return openr::fbnl::RouteBuilder{}
+      .setDestination(destination)
+      .setProtocolId(98)
+      .addNextHop(openr::fbnl::NextHopBuilder{}
+                      .setGateway(folly::IPAddressV6{
+                          folly::IPAddressV6::LinkLocalTag::LINK_LOCAL,
+                          nextHop})
+                      .setIfIndex(meshIfIndex)
+                      .build())
+      .build();
+}
+
+openr::fbnl::Route
+buildTaygaLinkRoute(folly::CIDRNetwork destination, int taygaIfIndex) {
+  return openr::fbnl::RouteBuilder{}
+      .setDestination(destination)
+      .setProtocolId(98)
+      .setRouteIfIndex(taygaIfIndex)
+      .setRouteIfName(kTaygaIfName)
+      .buildLinkRoute();
+}
 
 folly::IPAddressV6
 getIPV6FromMacAddress(const char* prefix, folly::MacAddress macAddress) {
@@ -82,70 +117,47 @@ SyncRoutes80211s::SyncRoutes80211s(
       nodeAddr_{nodeAddr},
       interface_{interface},
       netlinkSocket_{this} {
-  // Set timer to sync routes
-  syncRoutesTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { doSyncRoutes(); });
-  syncRoutesTimer_->scheduleTimeout(kSyncRoutesInterval, true);
+  // Sync routes on mesh path changes, see scheduleSyncRoutes()
+  syncRoutesTimer_ = fbzmq::ZmqTimeout::make(
+      this, [this]() noexcept { doSyncRoutes(false /* force */); });
+
+  periodicSyncTimer_ = fbzmq::ZmqTimeout::make(
+      this, [this]() noexcept { doSyncRoutes(true /* force */); });
+  periodicSyncTimer_->scheduleTimeout(kPeriodicSyncInterval, true);
+
+  // Initial sync
+  syncRoutesTimer_->scheduleTimeout(kSyncRoutesDebounce);
 }
 
 void
-SyncRoutes80211s::doSyncRoutes() {
-  VLOG(8) << folly::sformat("SyncRoutes80211s::{}()", __func__);
-
-  auto meshIfIndex = netlinkSocket_.getIfIndex(interface_).get();
-  auto isGate = routing_->getGatewayStatus();
-  auto meshPaths = routing_->getMeshPaths();
+SyncRoutes80211s::scheduleSyncRoutes() {
+  runInEventLoop([this]() {
+    if (not syncRoutesTimer_->isScheduled()) {
+      syncRoutesTimer_->scheduleTimeout(kSyncRoutesDebounce);
+    }
+  });
+}
 
-  openr::fbnl::NlUnicastRoutes unicastRouteDb;
-  openr::fbnl::NlLinkRoutes linkRouteDb;
-  std::vector<fbnl::IfAddress> meshAddrs;
+void
+SyncRoutes80211s::doSyncRoutes(bool force) {
+  VLOG(8) << folly::sformat("SyncRoutes80211s::{}(force: {})", __func__, force);
 
-  const auto kTaygaIfName{"tayga"};
-  auto taygaIfIndex = netlinkSocket_.getIfIndex(kTaygaIfName).get();
-  bool taygaIfUp = isInterfaceUp(kTaygaIfName);
+  SyncState state;
+  state.meshIfIndex = netlinkSocket_.getIfIndex(interface_).get();
+  state.isGate = routing_->getGatewayStatus();
+  state.taygaIfIndex = netlinkSocket_.getIfIndex(kTaygaIfName).get();
+  state.taygaIfUp = isInterfaceUp(kTaygaIfName);
 
   folly::Optional<std::pair<folly::MacAddress, uint32_t>> bestGate;
   bool isCurrentGateStillAlive = false;
-  for (const auto& mpathIt : meshPaths) {
-    const auto& mpath = mpathIt.second;
-
+  const auto now = std::chrono::steady_clock::now();
+  routing_->forEachMeshPath([&](const Routing::MeshPath& mpath) {
     if (mpath.nextHop == folly::MacAddress::ZERO) {
-      continue;
+      return;
     }
+    state.nextHops.emplace(mpath.dst, mpath.nextHop);
 
-    auto destination = std::make_pair<folly::IPAddress, uint8_t>(
-        getTaygaIPV6FromMacAddress(mpath.dst), 128);
-    // Ensure tayga interface is present and up
-    if (taygaIfIndex != 0 && taygaIfUp) {
-      unicastRouteDb.emplace(
-          destination,
-          fbnl::RouteBuilder{}
-              .setDestination(destination)
-              .setProtocolId(98)
-              .addNextHop(fbnl::NextHopBuilder{}
-                              .setGateway(folly::IPAddressV6{
-                                  folly::IPAddressV6::LinkLocalTag::LINK_LOCAL,
-                                  mpath.nextHop})
-                              .setIfIndex(meshIfIndex)
-                              .build())
-              .build());
-    }
-    destination = std::make_pair<folly::IPAddress, uint8_t>(
-        getMeshIPV6FromMacAddress(mpath.dst), 128);
-    unicastRouteDb.emplace(
-        destination,
-        fbnl::RouteBuilder{}
-            .setDestination(destination)
-            .setProtocolId(98)
-            .addNextHop(fbnl::NextHopBuilder{}
-                            .setGateway(folly::IPAddressV6{
-                                folly::IPAddressV6::LinkLocalTag::LINK_LOCAL,
-                                mpath.nextHop})
-                            .setIfIndex(meshIfIndex)
-                            .build())
-            .build());
-
-    if (mpath.expTime > std::chrono::steady_clock::now() && mpath.isGate) {
+    if (mpath.expTime > now && mpath.isGate) {
       if (currentGate_ && currentGate_->first == mpath.dst) {
         isCurrentGateStillAlive = true;
       }
@@ -153,7 +165,7 @@ SyncRoutes80211s::doSyncRoutes() {
         bestGate = std::make_pair(mpath.dst, mpath.metric);
       }
     }
-  }
+  });
   if (bestGate) {
     VLOG(10) << "Best gate: " << bestGate->first
              << " with metric: " << bestGate->second;
@@ -170,33 +182,50 @@ SyncRoutes80211s::doSyncRoutes() {
   if (currentGate_) {
     VLOG(10) << "Current gate: " << currentGate_->first
              << " with metric: " << currentGate_->second;
+    state.currentGate = currentGate_->first;
   } else {
     VLOG(10) << "No current gate found";
   }
 
+  // Routes only depend on the state above, nothing to program if it is the
+  // same as on last sync
+  if (not force && lastSyncState_ && *lastSyncState_ == state) {
+    VLOG(10) << "Mesh routes unchanged, skipping sync";
+    return;
+  }
+
+  const auto meshIfIndex = state.meshIfIndex;
+  const auto taygaIfIndex = state.taygaIfIndex;
+  // Ensure tayga interface is present and up
+  const bool useTayga = taygaIfIndex != 0 && state.taygaIfUp;
+
+  openr::fbnl::NlUnicastRoutes unicastRouteDb;
+  openr::fbnl::NlLinkRoutes linkRouteDb;
+  std::vector<fbnl::IfAddress> meshAddrs;
+
+  for (const auto& kv : state.nextHops) {
+    folly::CIDRNetwork destination{getTaygaIPV6FromMacAddress(kv.first), 128};
+    if (useTayga) {
+      unicastRouteDb.emplace(
+          destination, buildMeshRoute(destination, kv.second, meshIfIndex));
+    }
+    destination = folly::CIDRNetwork{getMeshIPV6FromMacAddress(kv.first), 128};
+    unicastRouteDb.emplace(
+        destination, buildMeshRoute(destination, kv.second, meshIfIndex));
+  }
+
   auto destination =
       folly::CIDRNetwork{getTaygaIPV6FromMacAddress(nodeAddr_), 128};
 
-  // Ensure tayga interface is present and up
-  if (taygaIfIndex != 0 && taygaIfUp) {
+  if (useTayga) {
     linkRouteDb.emplace(
         std::make_pair(destination, kTaygaIfName),
-        fbnl::RouteBuilder{}
-            .setDestination(destination)
-            .setProtocolId(98)
-            .setRouteIfIndex(taygaIfIndex)
-            .setRouteIfName(kTaygaIfName)
-            .buildLinkRoute());
+        buildTaygaLinkRoute(destination, taygaIfIndex));
 
     destination = folly::CIDRNetwork{folly::IPAddressV4{"172.16.0.0"}, 16};
     linkRouteDb.emplace(
         std::make_pair(destination, kTaygaIfName),
-        fbnl::RouteBuilder{}
-            .setDestination(destination)
-            .setProtocolId(98)
-            .setRouteIfIndex(taygaIfIndex)
-            .setRouteIfName(kTaygaIfName)
-            .buildLinkRoute());
+        buildTaygaLinkRoute(destination, taygaIfIndex));
   }
 
   meshAddrs.push_back(fbnl::IfAddressBuilder{}
@@ -208,25 +237,21 @@ SyncRoutes80211s::doSyncRoutes() {
   netlinkSocket_.syncIfAddress(
       meshIfIndex, meshAddrs, AF_INET6, RT_SCOPE_UNIVERSE);
 
-  if (isGateBeforeRouteSync_ != isGate) {
-    netlinkSocket_.syncUnicastRoutes(98, std::move(unicastRouteDb)).get();
-    netlinkSocket_.syncLinkRoutes(98, std::move(linkRouteDb)).get();
+  // Remove default routes of previous gateway status before adding new ones.
+  // Route tables are copied as the mesh routes are part of the final sync too
+  if (isGateBeforeRouteSync_ != state.isGate) {
+    netlinkSocket_.syncUnicastRoutes(98, unicastRouteDb).get();
+    netlinkSocket_.syncLinkRoutes(98, linkRouteDb).get();
   }
 
   destination = std::make_pair<folly::IPAddress, uint8_t>(
       folly::IPAddressV6{"fd00:ffff::"}, 96);
 
-  // Ensure tayga interface is present and up
-  if (taygaIfIndex != 0 && taygaIfUp) {
-    if (isGate) {
+  if (useTayga) {
+    if (state.isGate) {
       linkRouteDb.emplace(
           std::make_pair(destination, kTaygaIfName),
-          fbnl::RouteBuilder{}
-              .setDestination(destination)
-              .setProtocolId(98)
-              .setRouteIfIndex(taygaIfIndex)
-              .setRouteIfName(kTaygaIfName)
-              .buildLinkRoute());
+          buildTaygaLinkRoute(destination, taygaIfIndex));
     } else if (currentGate_) {
       const auto defaultV4Prefix =
           std::make_pair<folly::IPAddress, uint8_t>(folly::IPAddressV4{}, 0);
@@ -245,20 +270,16 @@ SyncRoutes80211s::doSyncRoutes() {
 
       unicastRouteDb.emplace(
           destination,
-          fbnl::RouteBuilder{}
-              .setDestination(destination)
-              .setProtocolId(98)
-              .addNextHop(fbnl::NextHopBuilder{}
-                              .setGateway(folly::IPAddressV6{
-                                  folly::IPAddressV6::LinkLocalTag::LINK_LOCAL,
-                                  meshPaths.at(currentGate_->first).nextHop})
-                              .setIfIndex(meshIfIndex)
-                              .build())
-              .build());
+          buildMeshRoute(
+              destination,
+              state.nextHops.at(currentGate_->first),
+              meshIfIndex));
     }
   }
-  isGateBeforeRouteSync_ = isGate;
+  isGateBeforeRouteSync_ = state.isGate;
 
+  // Kernel is only updated for routes which differ from netlink cache
   netlinkSocket_.syncUnicastRoutes(98, std::move(unicastRouteDb)).get();
   netlinkSocket_.syncLinkRoutes(98, std::move(linkRouteDb)).get();
+  lastSyncState_ = std::move(state);
 }
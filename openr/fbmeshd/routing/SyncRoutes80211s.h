@@ -8,6 +8,7 @@
 #pragma once
 
 #include <chrono>
+#include <unordered_map>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 
@@ -32,18 +33,44 @@ class SyncRoutes80211s : public fbzmq::ZmqEventLoop {
   SyncRoutes80211s& operator=(const SyncRoutes80211s&) = delete;
   SyncRoutes80211s& operator=(SyncRoutes80211s&&) = delete;
 
+  // Sync routes shortly, changes until then are coalesced into the same sync.
+  // Can be called from any thread, e.g. on mesh path change notifications
+  void scheduleSyncRoutes();
+
  private:
-  void doSyncRoutes();
+  // Inputs routes are built from, route sync is skipped if they didn't change
+  struct SyncState {
+    int meshIfIndex{0};
+    int taygaIfIndex{0};
+    bool taygaIfUp{false};
+    bool isGate{false};
+    folly::Optional<folly::MacAddress> currentGate;
+    // next hop of each mesh path destination
+    std::unordered_map<folly::MacAddress, folly::MacAddress> nextHops;
+
+    bool
+    operator==(const SyncState& other) const {
+      return meshIfIndex == other.meshIfIndex &&
+          taygaIfIndex == other.taygaIfIndex &&
+          taygaIfUp == other.taygaIfUp && isGate == other.isGate &&
+          currentGate == other.currentGate && nextHops == other.nextHops;
+    }
+  };
+
+  // Build and sync routes, unless inputs are unchanged and not forced
+  void doSyncRoutes(bool force);
 
   Routing* routing_;
   folly::MacAddress nodeAddr_;
   const std::string& interface_;
 
   std::unique_ptr<fbzmq::ZmqTimeout> syncRoutesTimer_;
+  std::unique_ptr<fbzmq::ZmqTimeout> periodicSyncTimer_;
   openr::fbnl::NetlinkSocket netlinkSocket_;
 
   folly::Optional<std::pair<folly::MacAddress, uint32_t>> currentGate_;
   bool isGateBeforeRouteSync_{false};
+  folly::Optional<SyncState> lastSyncState_;
 };
 
 } // namespace fbmeshd
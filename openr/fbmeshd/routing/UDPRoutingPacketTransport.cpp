@@ -7,39 +7,122 @@
 
 #include "UDPRoutingPacketTransport.h"
 
+#include <netinet/in.h>
+#include <unistd.h>
+
 #include <folly/Format.h>
+#include <folly/SocketAddress.h>
+#include <folly/String.h>
+#include <glog/logging.h>
 
 using namespace openr::fbmeshd;
 
+constexpr size_t UDPRoutingPacketTransport::kMaxRecvBatchSize;
+constexpr size_t UDPRoutingPacketTransport::kMaxPacketSize;
+
 UDPRoutingPacketTransport::UDPRoutingPacketTransport(
     folly::EventBase* evb,
     const std::string& interface,
     uint16_t port,
     int32_t tos)
-    : evb_{evb},
+    : folly::EventHandler{evb},
+      evb_{evb},
       interface_{interface},
-      serverSocket_{evb_},
-      clientSocket_{evb_} {
+      clientSocket_{evb_},
+      recvBufs_(kMaxRecvBatchSize) {
+  for (size_t i = 0; i < kMaxRecvBatchSize; ++i) {
+    recvIovs_[i].iov_base = recvBufs_[i].data();
+    recvIovs_[i].iov_len = kMaxPacketSize;
+    recvMsgs_[i] = mmsghdr{};
+    recvMsgs_[i].msg_hdr.msg_name = &recvAddrs_[i];
+    recvMsgs_[i].msg_hdr.msg_iov = &recvIovs_[i];
+    recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+  recvPackets_.reserve(kMaxRecvBatchSize);
+
   evb_->runInEventBaseThread([this, port, tos]() {
-    serverSocket_.bind(folly::SocketAddress{"::", port});
-    serverSocket_.addListener(evb_, this);
-    serverSocket_.listen();
+    serverSocketFd_ =
+        ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+    CHECK_GE(serverSocketFd_, 0)
+        << "Failed creating UDP socket: " << folly::errnoStr(errno);
+    const int reuseAddr = 1;
+    ::setsockopt(
+        serverSocketFd_,
+        SOL_SOCKET,
+        SO_REUSEADDR,
+        &reuseAddr,
+        sizeof(reuseAddr));
+    sockaddr_storage addrStorage;
+    const folly::SocketAddress serverAddr{"::", port};
+    serverAddr.getAddress(&addrStorage);
+    CHECK_EQ(
+        0,
+        ::bind(
+            serverSocketFd_,
+            reinterpret_cast<sockaddr*>(&addrStorage),
+            serverAddr.getActualSize()))
+        << "Failed binding UDP socket: " << folly::errnoStr(errno);
+    changeHandlerFD(folly::NetworkSocket::fromFd(serverSocketFd_));
+    registerHandler(folly::EventHandler::READ | folly::EventHandler::PERSIST);
 
     clientSocket_.bind(folly::SocketAddress("::", 0));
     clientSocket_.setTrafficClass(tos);
   });
 }
 
+UDPRoutingPacketTransport::~UDPRoutingPacketTransport() {
+  unregisterHandler();
+  if (serverSocketFd_ >= 0) {
+    ::close(serverSocketFd_);
+  }
+}
+
 void
-UDPRoutingPacketTransport::onDataAvailable(
-    std::shared_ptr<folly::AsyncUDPSocket> /* socket */,
-    const folly::SocketAddress& client,
-    std::unique_ptr<folly::IOBuf> data,
-    bool /* truncated */) noexcept {
-  if (receivePacketCallback_) {
-    (*receivePacketCallback_)(
-        *client.getIPAddress().asV6().getMacAddressFromLinkLocal(),
-        std::move(data));
+UDPRoutingPacketTransport::handlerReady(uint16_t /* events */) noexcept {
+  for (size_t i = 0; i < kMaxRecvBatchSize; ++i) {
+    recvMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+  }
+  const auto numMsgs = ::recvmmsg(
+      serverSocketFd_,
+      recvMsgs_.data(),
+      kMaxRecvBatchSize,
+      MSG_DONTWAIT,
+      nullptr);
+  if (numMsgs < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG(ERROR) << "Failed receiving routing packets: "
+                 << folly::errnoStr(errno);
+    }
+    return;
+  }
+
+  recvPackets_.clear();
+  for (int i = 0; i < numMsgs; ++i) {
+    const auto& hdr = recvMsgs_[i].msg_hdr;
+    if (hdr.msg_flags & MSG_TRUNC) {
+      VLOG(8) << "Dropping truncated routing packet";
+      continue;
+    }
+    folly::SocketAddress client;
+    try {
+      client.setFromSockaddr(
+          reinterpret_cast<const sockaddr*>(hdr.msg_name), hdr.msg_namelen);
+    } catch (const std::exception&) {
+      continue;
+    }
+    if (!client.getIPAddress().isV6()) {
+      continue;
+    }
+    const auto sa = client.getIPAddress().asV6().getMacAddressFromLinkLocal();
+    if (!sa) {
+      continue;
+    }
+    recvPackets_.emplace_back(
+        *sa, folly::ByteRange{recvBufs_[i].data(), recvMsgs_[i].msg_len});
+  }
+
+  if (receivePacketsCallback_ && !recvPackets_.empty()) {
+    (*receivePacketsCallback_)(recvPackets_);
   }
 }
 
@@ -60,22 +143,22 @@ UDPRoutingPacketTransport::sendPacket(
 }
 
 void
-UDPRoutingPacketTransport::setReceivePacketCallback(
-    std::function<void(folly::MacAddress, std::unique_ptr<folly::IOBuf>)> cb) {
+UDPRoutingPacketTransport::setReceivePacketsCallback(
+    std::function<void(const RoutingPackets&)> cb) {
   if (evb_->isRunning()) {
     evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
-        [this, cb = std::move(cb)]() { receivePacketCallback_ = cb; });
+        [this, cb = std::move(cb)]() { receivePacketsCallback_ = cb; });
   } else {
-    receivePacketCallback_ = cb;
+    receivePacketsCallback_ = cb;
   }
 }
 
 void
-UDPRoutingPacketTransport::resetReceivePacketCallback() {
+UDPRoutingPacketTransport::resetReceivePacketsCallback() {
   if (evb_->isRunning()) {
     evb_->runImmediatelyOrRunInEventBaseThreadAndWait(
-        [this]() { receivePacketCallback_.reset(); });
+        [this]() { receivePacketsCallback_.reset(); });
   } else {
-    receivePacketCallback_.reset();
+    receivePacketsCallback_.reset();
   }
 }
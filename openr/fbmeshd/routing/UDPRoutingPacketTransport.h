@@ -7,53 +7,83 @@
 
 #pragma once
 
+#include <sys/socket.h>
+
+#include <array>
+#include <functional>
+#include <utility>
+#include <vector>
+
 #include <folly/MacAddress.h>
+#include <folly/Range.h>
 #include <folly/io/IOBuf.h>
-#include <folly/io/async/AsyncUDPServerSocket.h>
 #include <folly/io/async/AsyncUDPSocket.h>
 #include <folly/io/async/EventBase.h>
+#include <folly/io/async/EventHandler.h>
 
 namespace openr {
 namespace fbmeshd {
 
-class UDPRoutingPacketTransport : public folly::AsyncUDPServerSocket::Callback {
+/*
+ * Frames received in one wakeup, by source station. Data points into receive
+ * buffers of the transport and is only valid during the callback
+ */
+using RoutingPackets =
+    std::vector<std::pair<folly::MacAddress, folly::ByteRange>>;
+
+class UDPRoutingPacketTransport : public folly::EventHandler {
  public:
+  // Most frames read per wakeup with one recvmmsg call, rest is read on next
+  // one so that a PANN flood doesn't starve sends on the event base
+  static constexpr size_t kMaxRecvBatchSize{64};
+
+  // Receive buffer size per frame, longer frames are dropped as truncated
+  static constexpr size_t kMaxPacketSize{1500};
+
   UDPRoutingPacketTransport(
       folly::EventBase* evb,
       const std::string& interface,
       uint16_t port,
       int32_t tos);
 
+  UDPRoutingPacketTransport() = delete;
+  ~UDPRoutingPacketTransport() override;
+  UDPRoutingPacketTransport(const UDPRoutingPacketTransport&) = delete;
+  UDPRoutingPacketTransport(UDPRoutingPacketTransport&&) = delete;
+  UDPRoutingPacketTransport& operator=(const UDPRoutingPacketTransport&) =
+      delete;
+  UDPRoutingPacketTransport& operator=(UDPRoutingPacketTransport&&) = delete;
+
   void sendPacket(folly::MacAddress da, std::unique_ptr<folly::IOBuf> buf);
 
-  void setReceivePacketCallback(
-      std::function<void(folly::MacAddress, std::unique_ptr<folly::IOBuf>)> cb);
-  void resetReceivePacketCallback();
+  void setReceivePacketsCallback(
+      std::function<void(const RoutingPackets&)> cb);
+  void resetReceivePacketsCallback();
 
  private:
-  virtual void
-  onListenStarted() noexcept override {}
-
-  virtual void
-  onListenStopped() noexcept override {}
-
-  virtual void onDataAvailable(
-      std::shared_ptr<folly::AsyncUDPSocket> socket,
-      const folly::SocketAddress& client,
-      std::unique_ptr<folly::IOBuf> data,
-      bool truncated) noexcept override;
+  // Read a batch of frames with recvmmsg and hand it to receive callback
+  virtual void handlerReady(uint16_t events) noexcept override;
 
   folly::EventBase* evb_;
 
   const std::string& interface_;
 
-  folly::AsyncUDPServerSocket serverSocket_;
+  int serverSocketFd_{-1};
 
   folly::AsyncUDPSocket clientSocket_;
 
-  folly::Optional<
-      std::function<void(folly::MacAddress, std::unique_ptr<folly::IOBuf>)>>
-      receivePacketCallback_;
+  folly::Optional<std::function<void(const RoutingPackets&)>>
+      receivePacketsCallback_;
+
+  /*
+   * Receive buffers and message headers, set up once and reused for every
+   * batch so that receiving doesn't allocate per frame
+   */
+  std::vector<std::array<uint8_t, kMaxPacketSize>> recvBufs_;
+  std::array<sockaddr_storage, kMaxRecvBatchSize> recvAddrs_;
+  std::array<iovec, kMaxRecvBatchSize> recvIovs_;
+  std::array<mmsghdr, kMaxRecvBatchSize> recvMsgs_;
+  RoutingPackets recvPackets_;
 };
 
 } // namespace fbmeshd
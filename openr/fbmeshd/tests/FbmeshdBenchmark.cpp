@@ -0,0 +1,299 @@
+/**
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <malloc.h>
+
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <folly/Benchmark.h>
+#include <folly/MacAddress.h>
+#include <folly/init/Init.h>
+#include <folly/io/IOBuf.h>
+#include <folly/io/async/EventBase.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/fbmeshd/802.11s/Nl80211Handler.h>
+#include <openr/fbmeshd/802.11s/PeerSelector.h>
+#include <openr/fbmeshd/routing/MetricManager.h>
+#include <openr/fbmeshd/routing/Routing.h>
+
+DECLARE_uint32(peer_selector_max_allowed);
+DECLARE_uint32(peer_selector_min_gate_connections);
+
+using namespace openr::fbmeshd;
+
+namespace {
+
+const folly::MacAddress kNodeAddr{"02:00:00:00:00:01"};
+
+folly::MacAddress
+stationAddr(uint32_t i) {
+  return folly::MacAddress::fromHBO(0x020000010000 + i);
+}
+
+/**
+ * Link metrics of a mesh where every station is a neighbor of this node
+ */
+class FakeMetricManager final : public MetricManager {
+ public:
+  explicit FakeMetricManager(uint32_t numStations) {
+    for (uint32_t i = 0; i < numStations; ++i) {
+      metrics_.emplace(stationAddr(i), 100 + i % 50);
+    }
+  }
+
+  std::unordered_map<folly::MacAddress, uint32_t>
+  getLinkMetrics() override {
+    return metrics_;
+  }
+
+ private:
+  std::unordered_map<folly::MacAddress, uint32_t> metrics_;
+};
+
+/**
+ * Established peers with spread signal levels, one in ten connected to a gate
+ */
+class FakeNl80211Handler final : public Nl80211HandlerInterface {
+ public:
+  explicit FakeNl80211Handler(uint32_t numStations) {
+    for (uint32_t i = 0; i < numStations; ++i) {
+      stations_.push_back(StationInfo{stationAddr(i),
+                                      std::chrono::milliseconds{0},
+                                      -30 - static_cast<int32_t>(i % 60),
+                                      i % 10 == 0,
+                                      100000});
+    }
+  }
+
+  std::vector<folly::MacAddress>
+  getPeers() override {
+    std::vector<folly::MacAddress> peers;
+    for (const auto& sta : stations_) {
+      peers.push_back(sta.macAddress);
+    }
+    return peers;
+  }
+
+  std::vector<StationInfo>
+  getStationsInfo() override {
+    return stations_;
+  }
+
+  void
+  setRssiThreshold(int32_t) override {}
+
+  void
+  setPeerSelector(PeerSelector*) override {}
+
+  // Stations stay, so that every poll sees the same membership
+  void
+  deleteStation(folly::MacAddress) override {}
+
+ private:
+  std::vector<StationInfo> stations_;
+};
+
+/**
+ * PANN of station i as received from it, the first numGates stations are gates
+ */
+std::unique_ptr<folly::IOBuf>
+createPannFrame(uint32_t i, uint32_t numGates) {
+  apache::thrift::CompactSerializer serializer;
+  std::string skb;
+  serializer.serialize(
+      openr::fbmeshd::thrift::MeshPathFramePANN{
+          apache::thrift::FRAGILE,
+          stationAddr(i).u64NBO(),
+          1 /* origSn */,
+          0 /* hopCount */,
+          32 /* ttl */,
+          folly::MacAddress::BROADCAST.u64NBO(),
+          0 /* metric */,
+          i < numGates /* isGate */,
+          false /* replyRequested */,
+      },
+      &skb);
+  auto buf = folly::IOBuf::copyBuffer(skb, 1, 0);
+  buf->prepend(1);
+  *buf->writableData() =
+      static_cast<uint8_t>(Routing::MeshPathFrameType::PANN);
+  return buf;
+}
+
+std::unique_ptr<Routing>
+createRouting(folly::EventBase& evb, MetricManager& metricManager) {
+  auto routing = std::make_unique<Routing>(
+      &evb,
+      &metricManager,
+      kNodeAddr,
+      32 /* elementTtl */,
+      std::chrono::milliseconds{30000} /* activePathTimeout */,
+      std::chrono::milliseconds{5000} /* rootPannInterval */,
+      std::chrono::milliseconds{0} /* pannAggregationInterval */);
+  // Re-floods are serialized but go nowhere
+  routing->setSendPacketCallback(
+      [](folly::MacAddress, std::unique_ptr<folly::IOBuf>) {});
+  return routing;
+}
+
+// Mesh path of every station, through the station itself
+void
+addMeshPaths(Routing& routing, uint32_t numStations, uint32_t numGates) {
+  for (uint32_t i = 0; i < numStations; ++i) {
+    routing.receivePacket(stationAddr(i), createPannFrame(i, numGates));
+  }
+}
+
+// Heap used by mesh paths of numStations stations, glibc malloc only
+void
+logMemoryPerMeshPath(uint32_t numStations) {
+  folly::EventBase evb;
+  FakeMetricManager metricManager(numStations);
+  auto routing = createRouting(evb, metricManager);
+  const auto before = ::mallinfo().uordblks;
+  addMeshPaths(*routing, numStations, 0);
+  const auto after = ::mallinfo().uordblks;
+  LOG(INFO) << "Heap per mesh path with " << numStations
+            << " stations: " << (after - before) / numStations << " bytes";
+}
+
+} // namespace
+
+/**
+ * PANNs of known mesh paths received from their destination, each one
+ * refreshing the path, ranked against gates, and re-flooded
+ */
+static void
+BM_RoutingPannProcess(uint32_t iters, uint32_t numStations, uint32_t numGates) {
+  auto suspender = folly::BenchmarkSuspender();
+  folly::EventBase evb;
+  FakeMetricManager metricManager(numStations);
+  auto routing = createRouting(evb, metricManager);
+  std::vector<std::unique_ptr<folly::IOBuf>> frames;
+  for (uint32_t i = 0; i < numStations; ++i) {
+    frames.emplace_back(createPannFrame(i, numGates));
+  }
+  addMeshPaths(*routing, numStations, numGates);
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    const auto sta = i % numStations;
+    routing->receivePacket(stationAddr(sta), frames[sta]->clone());
+  }
+}
+
+/**
+ * Collecting mesh paths from routing thread, as SyncRoutes80211s does on each
+ * route sync, without and with a copy of the table
+ */
+static void
+BM_RoutingMeshPathsRead(uint32_t iters, bool copy, uint32_t numStations) {
+  auto suspender = folly::BenchmarkSuspender();
+  folly::EventBase evb;
+  FakeMetricManager metricManager(numStations);
+  auto routing = createRouting(evb, metricManager);
+  addMeshPaths(*routing, numStations, 0);
+  std::thread evbThread([&evb]() { evb.loopForever(); });
+  evb.waitUntilRunning();
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    if (copy) {
+      auto meshPaths = routing->getMeshPaths();
+      folly::doNotOptimizeAway(meshPaths);
+    } else {
+      size_t numNextHops{0};
+      routing->forEachMeshPath([&numNextHops](const Routing::MeshPath& mpath) {
+        numNextHops += mpath.nextHop != folly::MacAddress::ZERO;
+      });
+      folly::doNotOptimizeAway(numNextHops);
+    }
+  }
+
+  suspender.rehire();
+  evb.terminateLoopSoon();
+  evbThread.join();
+}
+
+/**
+ * Candidate decision with half of numStations peers allowed
+ */
+static void
+BM_PeerSelectorCandidate(uint32_t iters, uint32_t numStations) {
+  auto suspender = folly::BenchmarkSuspender();
+  FLAGS_peer_selector_max_allowed = numStations / 2;
+  FLAGS_peer_selector_min_gate_connections = 2;
+  fbzmq::ZmqEventLoop zmqLoop;
+  FakeNl80211Handler nlHandler(numStations);
+  PeerSelector peerSelector(zmqLoop, nlHandler, -80);
+  peerSelector.onPeerAddedOrRemoved();
+  StationInfo cand{stationAddr(numStations),
+                   std::chrono::milliseconds{0},
+                   -50,
+                   false,
+                   100000};
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    cand.isConnectedToGate = i % 2;
+    auto accepted = peerSelector.shouldAddCandidate(cand);
+    folly::doNotOptimizeAway(accepted);
+  }
+}
+
+/**
+ * Poll of peers with same membership, as on every peer selector interval
+ */
+static void
+BM_PeerSelectorPoll(uint32_t iters, uint32_t numStations) {
+  auto suspender = folly::BenchmarkSuspender();
+  FLAGS_peer_selector_max_allowed = numStations;
+  FLAGS_peer_selector_min_gate_connections = 2;
+  fbzmq::ZmqEventLoop zmqLoop;
+  FakeNl80211Handler nlHandler(numStations);
+  PeerSelector peerSelector(zmqLoop, nlHandler, -80);
+  peerSelector.onPeerAddedOrRemoved();
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    peerSelector.onPeerAddedOrRemoved();
+  }
+}
+
+// Parameters are number of stations and number of gates
+BENCHMARK_NAMED_PARAM(BM_RoutingPannProcess, 10_2, 10, 2);
+BENCHMARK_NAMED_PARAM(BM_RoutingPannProcess, 100_4, 100, 4);
+BENCHMARK_NAMED_PARAM(BM_RoutingPannProcess, 1000_4, 1000, 4);
+BENCHMARK_NAMED_PARAM(BM_RoutingPannProcess, 1000_32, 1000, 32);
+
+// Parameters are whether table is copied and number of stations
+BENCHMARK_NAMED_PARAM(BM_RoutingMeshPathsRead, copy_100, true, 100);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_RoutingMeshPathsRead, visit_100, false, 100);
+BENCHMARK_NAMED_PARAM(BM_RoutingMeshPathsRead, copy_1000, true, 1000);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_RoutingMeshPathsRead, visit_1000, false, 1000);
+
+// Parameter is number of stations
+BENCHMARK_PARAM(BM_PeerSelectorCandidate, 10);
+BENCHMARK_PARAM(BM_PeerSelectorCandidate, 100);
+BENCHMARK_PARAM(BM_PeerSelectorCandidate, 1000);
+BENCHMARK_PARAM(BM_PeerSelectorPoll, 10);
+BENCHMARK_PARAM(BM_PeerSelectorPoll, 100);
+BENCHMARK_PARAM(BM_PeerSelectorPoll, 1000);
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  logMemoryPerMeshPath(1000);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -81,3 +81,40 @@ TEST_F(PeerSelectorTest, PeerUpdateAdjustsThreshold) {
 
   peerSelector_.onPeerAddedOrRemoved();
 }
+
+TEST_F(PeerSelectorTest, CandidateRankedAgainstCurrentPeers) {
+  FLAGS_peer_selector_max_allowed = 1;
+  FLAGS_peer_selector_min_gate_connections = 1;
+
+  // a single peer at -30, no threshold change
+  std::vector<StationInfo> peers{testStations_.back()};
+  // same peer, later seen with lower signal
+  auto fadedPeers = peers;
+  fadedPeers.front().signalAvgDbm = -60;
+  EXPECT_CALL(nlHandler_, getStationsInfo())
+      .Times(2)
+      .WillOnce(Return(peers))
+      .WillOnce(Return(fadedPeers));
+  EXPECT_CALL(nlHandler_, setRssiThreshold(_)).Times(0);
+  peerSelector_.onPeerAddedOrRemoved();
+
+  StationInfo weaker{folly::MacAddress{"02:00:00:00:03:00"},
+                     std::chrono::milliseconds(0),
+                     -50,
+                     false};
+  StationInfo stronger{folly::MacAddress{"02:00:00:00:04:00"},
+                       std::chrono::milliseconds(0),
+                       -20,
+                       false};
+  EXPECT_FALSE(peerSelector_.shouldAddCandidate(weaker));
+  EXPECT_TRUE(peerSelector_.shouldAddCandidate(stronger));
+
+  // a gate connected candidate makes it while gate connections are missing
+  weaker.isConnectedToGate = true;
+  EXPECT_TRUE(peerSelector_.shouldAddCandidate(weaker));
+
+  // ranking follows signal changes of current peers found on poll
+  peerSelector_.onPeerAddedOrRemoved();
+  weaker.isConnectedToGate = false;
+  EXPECT_TRUE(peerSelector_.shouldAddCandidate(weaker));
+}
@@ -8,6 +8,7 @@
 #include <condition_variable>
 #include <future>
 #include <mutex>
+#include <thread>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -87,7 +88,7 @@ class TestRouteDampener : public fbzmq::ZmqEventLoop, public RouteDampener {
  public:
   MOCK_METHOD0(dampen, void());
   MOCK_METHOD0(undampen, void());
-  MOCK_METHOD0(userHalfLifeTimerExpired, void());
+  MOCK_METHOD0(userReuseTimerExpired, void());
   MOCK_METHOD0(userSuppressLimitTimerExpired, void());
   MOCK_METHOD2(setStat, void(const std::string& path, int value));
 };
@@ -172,8 +173,7 @@ TEST_F(RouteDampenerTest, ContinueFlapping) {
 }
 
 TEST_F(RouteDampenerTest, HalfLife) {
-  unsigned int history{testPenalty};
-  Notifier halfLifeNotifier;
+  Notifier reuseNotifier;
   ::testing::StrictMock<TestRouteDampener> rd;
   auto cleanup = runAsync(rd);
 
@@ -181,65 +181,47 @@ TEST_F(RouteDampenerTest, HalfLife) {
     cleanup();
   };
 
-  rd.runInEventLoop([&rd, &halfLifeNotifier, &history]() {
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+  std::chrono::steady_clock::time_point dampenedTime;
+  rd.runInEventLoop([&rd, &dampenedTime]() {
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", testPenalty));
     rd.flap();
-    EXPECT_EQ(history, rd.getHistory());
     EXPECT_FALSE(rd.isDampened());
     EXPECT_CALL(rd, dampen()).Times(1);
-    history += testPenalty;
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", testPenalty * 2));
     EXPECT_CALL(rd, setStat("route_dampener.default_route_dampened", 1));
     rd.flap();
-
-    history /= 2;
+    dampenedTime = std::chrono::steady_clock::now();
+    EXPECT_TRUE(rd.isDampened());
 
     ::testing::Mock::VerifyAndClear(&rd);
-    EXPECT_CALL(rd, userHalfLifeTimerExpired())
-        .Times(1)
-        .Notify(halfLifeNotifier);
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+    // history is only written back when the reuse timer expires
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", ::testing::_))
+        .Times(::testing::AnyNumber());
+    EXPECT_CALL(rd, setStat("route_dampener.default_route_dampened", 0));
+    EXPECT_CALL(rd, undampen()).Times(1);
   });
 
-  halfLifeNotifier.wait();
-
-  EXPECT_EQ(history, rd.getHistory());
+  // history decays without being touched, after one half life it is half
+  std::this_thread::sleep_for(testHalfLife);
+  EXPECT_NEAR(testPenalty, rd.getHistory(), testPenalty / 10);
 
-  EXPECT_TRUE(
-      (rd.getHistory() > testReuseLimit && rd.isDampened()) or
-      !rd.isDampened());
+  // 2000 decays to reuse limit of 750 after log2(2000 / 750) half lives
+  EXPECT_CALL(rd, userReuseTimerExpired()).Times(1).Notify(reuseNotifier);
+  reuseNotifier.wait();
+  EXPECT_FALSE(rd.isDampened());
+  EXPECT_NEAR(testReuseLimit, rd.getHistory(), testReuseLimit / 10);
+  EXPECT_LE(1400ms, std::chrono::steady_clock::now() - dampenedTime);
 
-  // next halflife goes below reuse so not longer dampened.
-  history /= 2;
-  EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
-  EXPECT_CALL(rd, setStat("route_dampener.default_route_dampened", 0));
-  EXPECT_CALL(rd, undampen()).Times(1);
-  EXPECT_CALL(rd, userHalfLifeTimerExpired()).Times(1).Notify(halfLifeNotifier);
-  halfLifeNotifier.wait();
-
-  EXPECT_EQ(history, rd.getHistory());
-
-  EXPECT_TRUE(
-      (rd.getHistory() > testReuseLimit && rd.isDampened()) or
-      !rd.isDampened());
-
-  // Drop below half reuse
-  history /= 2;
-  EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
-  history = 0;
-  EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
-  EXPECT_CALL(rd, userHalfLifeTimerExpired()).Times(1).Notify(halfLifeNotifier);
-  halfLifeNotifier.wait();
-
-  EXPECT_TRUE(
-      (rd.getHistory() > testReuseLimit && rd.isDampened()) or
-      !rd.isDampened());
-  EXPECT_EQ(history, rd.getHistory());
+  // Drop below half reuse limit resets history
+  std::this_thread::sleep_for(testHalfLife + 100ms);
+  EXPECT_EQ(0, rd.getHistory());
 }
 
 TEST_F(RouteDampenerTest, MaxSuppressLimit) {
-  unsigned int history{testPenalty};
-  Notifier halfLifeNotifier;
+  Notifier suppressLimitNotifier;
   ::testing::StrictMock<TestRouteDampener> rd;
   auto cleanup = runAsync(rd);
 
@@ -247,59 +229,49 @@ TEST_F(RouteDampenerTest, MaxSuppressLimit) {
     cleanup();
   };
 
-  rd.runInEventLoop([&rd, &history, &halfLifeNotifier]() {
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+  std::chrono::steady_clock::time_point dampenedTime;
+  rd.runInEventLoop([&rd, &dampenedTime]() {
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", testPenalty));
     rd.flap();
-    EXPECT_EQ(history, rd.getHistory());
     EXPECT_FALSE(rd.isDampened());
     EXPECT_CALL(rd, dampen()).Times(1);
-    history += testPenalty;
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", testPenalty * 2));
     EXPECT_CALL(rd, setStat("route_dampener.default_route_dampened", 1));
     rd.flap();
+    dampenedTime = std::chrono::steady_clock::now();
     EXPECT_TRUE(rd.isDampened());
-    history += testPenalty;
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
-    rd.flap();
-    halfLifeNotifier.notify();
-  });
 
-  halfLifeNotifier.wait();
+    ::testing::Mock::VerifyAndClear(&rd);
+    EXPECT_CALL(
+        rd, setStat("route_dampener.default_route_history", ::testing::_))
+        .Times(::testing::AnyNumber());
+    EXPECT_CALL(rd, userReuseTimerExpired()).Times(::testing::AnyNumber());
+  });
 
+  // Keep flapping so that history never decays to reuse limit
   for (int i{0}; i < testMaxSuppressLimit.count() - 1; ++i) {
-    history /= 2;
-    EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
-    EXPECT_CALL(rd, userHalfLifeTimerExpired())
-        .Times(1)
-        .Notify(halfLifeNotifier);
-    halfLifeNotifier.wait();
-    std::cerr << "waited " << i << std::endl;
+    std::this_thread::sleep_for(testHalfLife);
     EXPECT_TRUE(rd.isDampened());
-    rd.runInEventLoop([&rd, &history, &halfLifeNotifier]() {
-      history += testPenalty;
-      EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
+    rd.runInEventLoop([&rd]() {
       rd.flap();
-      history += testPenalty;
-      EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
       rd.flap();
-      halfLifeNotifier.notify();
     });
-    halfLifeNotifier.wait();
   }
 
-  EXPECT_EQ(history, rd.getHistory());
-
   // Hit the max suppression time.
-  history = 0;
   EXPECT_CALL(rd, setStat("route_dampener.default_route_dampened", 0));
-  EXPECT_CALL(rd, setStat("route_dampener.default_route_history", history));
   EXPECT_CALL(rd, undampen()).Times(1);
   EXPECT_CALL(rd, userSuppressLimitTimerExpired())
       .Times(1)
-      .Notify(halfLifeNotifier);
-  halfLifeNotifier.wait();
+      .Notify(suppressLimitNotifier);
+  suppressLimitNotifier.wait();
   EXPECT_FALSE(rd.isDampened());
   EXPECT_EQ(0, rd.getHistory());
+  EXPECT_LE(
+      testMaxSuppressLimit - 10ms,
+      std::chrono::steady_clock::now() - dampenedTime);
 }
 
 TEST_F(RouteDampenerTest, InvalidParameters) {
@@ -7,8 +7,9 @@
 
 #include "Fib.h"
 
+#include <algorithm>
+
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
-#include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/MapUtil.h>
 #include <thrift/lib/cpp/protocol/TProtocolTypes.h>
@@ -21,6 +22,54 @@
 
 namespace openr {
 
+namespace {
+
+// Next-hops as reported by agent, in order. Metrics are not programmed
+std::vector<thrift::NextHopThrift>
+toAgentNextHops(std::vector<thrift::NextHopThrift> nextHops) {
+  for (auto& nextHop : nextHops) {
+    nextHop.metric = 0;
+    nextHop.useNonShortestRoute = false;
+  }
+  std::sort(nextHops.begin(), nextHops.end());
+  return nextHops;
+}
+
+thrift::RouteDatabase
+toAgentRouteDb(
+    const std::string& nodeName,
+    const std::vector<thrift::UnicastRoute>& unicastRoutes,
+    const std::vector<thrift::MplsRoute>& mplsRoutes) {
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = nodeName;
+  for (const auto& route : unicastRoutes) {
+    thrift::UnicastRoute agentRoute;
+    agentRoute.dest = route.dest;
+    agentRoute.nextHops = toAgentNextHops(route.nextHops);
+    routeDb.unicastRoutes.emplace_back(std::move(agentRoute));
+  }
+  for (const auto& route : mplsRoutes) {
+    thrift::MplsRoute agentRoute;
+    agentRoute.topLabel = route.topLabel;
+    agentRoute.nextHops = toAgentNextHops(route.nextHops);
+    routeDb.mplsRoutes.emplace_back(std::move(agentRoute));
+  }
+  return routeDb;
+}
+
+// Completes once all calls complete, with first error if any
+folly::Future<folly::Unit>
+collectAgentCalls(std::vector<folly::Future<folly::Unit>>&& futures) {
+  return folly::collectAll(futures).thenValue(
+      [](std::vector<folly::Try<folly::Unit>>&& results) {
+        for (auto& result : results) {
+          result.throwIfFailed();
+        }
+      });
+}
+
+} // namespace
+
 Fib::Fib(
     std::string myNodeName,
     int32_t thriftPort,
@@ -36,7 +85,11 @@ Fib::Fib(
     const MonitorSubmitUrl& monitorSubmitUrl,
     const KvStoreLocalCmdUrl& storeCmdUrl,
     const KvStoreLocalPubUrl& storePubUrl,
-    fbzmq::Context& zmqContext)
+    fbzmq::Context& zmqContext,
+    size_t syncFibChunkSize,
+    std::vector<folly::CIDRNetwork> criticalPrefixes,
+    BusSerializer::Protocol routeDeltaProtocol,
+    bool enableWarmBoot)
     : OpenrEventLoop(
           myNodeName, thrift::OpenrModuleType::FIB, zmqContext, fibRepUrl),
       myNodeName_(std::move(myNodeName)),
@@ -45,6 +98,7 @@ Fib::Fib(
       enableFibSync_(enableFibSync),
       enableSegmentRouting_(enableSegmentRouting),
       enableOrderedFib_(enableOrderedFib),
+      syncFibChunkSize_(syncFibChunkSize),
       coldStartDuration_(coldStartDuration),
       decisionSub_(
           zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true}),
@@ -52,22 +106,28 @@ Fib::Fib(
           zmqContext, folly::none, folly::none, fbzmq::NonblockingFlag{true}),
       decisionPubUrl_(std::move(decisionPubUrl)),
       linkMonPubUrl_(std::move(linkMonPubUrl)),
+      routeDeltaSerializer_(routeDeltaProtocol),
       expBackoff_(
           std::chrono::milliseconds(8), std::chrono::milliseconds(4096)) {
-  routeDb_.thisNodeName = myNodeName_;
-
-  syncRoutesTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-    if (hasRoutesFromDecision_) {
-      if (syncRouteDb()) {
-        expBackoff_.reportSuccess();
-      } else {
-        // Apply exponential backoff and schedule next run
-        expBackoff_.reportError();
-        syncRoutesTimer_->scheduleTimeout(
-            expBackoff_.getTimeRemainingUntilRetry());
-      }
-    }
-  });
+  for (auto const& criticalPrefix : criticalPrefixes) {
+    criticalPrefixes_.insert(criticalPrefix, folly::unit);
+  }
+
+  syncRoutesTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.sync_routes", [this]() noexcept {
+        if (hasRoutesFromDecision_) {
+          syncRouteDb();
+        }
+      }));
+
+  // Responses of agent are only processed when evb_ loops
+  agentPollTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.agent_poll", [this]() noexcept {
+        evb_.loopOnce(EVLOOP_NONBLOCK);
+        if (numAgentCallsInFlight_ == 0) {
+          agentPollTimer_->cancelTimeout();
+        }
+      }));
 
   if (enableOrderedFib_) {
     kvStoreClient_ = std::make_unique<KvStoreClient>(
@@ -79,17 +139,18 @@ Fib::Fib(
     syncRoutesTimer_->scheduleTimeout(coldStartDuration_);
   }
 
-  healthChecker_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-    // Make thrift calls to do real programming
-    try {
-      keepAliveCheck();
-    } catch (const std::exception& e) {
-      tData_.addStatValue("fib.thrift.failure.keepalive", 1, fbzmq::COUNT);
-      client_.reset();
-      LOG(ERROR) << "Failed to make thrift call to Switch Agent. Error: "
-                 << folly::exceptionStr(e);
-    }
-  });
+  healthChecker_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.health_check", [this]() noexcept {
+        // Make thrift calls to do real programming
+        try {
+          keepAliveCheck();
+        } catch (const std::exception& e) {
+          tData_.addStatValue("fib.thrift.failure.keepalive", 1, fbzmq::COUNT);
+          resetFibClient();
+          LOG(ERROR) << "Failed to make thrift call to Switch Agent. Error: "
+                     << folly::exceptionStr(e);
+        }
+      }));
 
   // Only schedule health checker in non dry run mode
   if (not dryrun_) {
@@ -97,11 +158,17 @@ Fib::Fib(
         Constants::kHealthCheckInterval, true /* schedule periodically */);
   }
 
-  syncFibTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-    if (hasRoutesFromDecision_) {
-      syncRouteDbDebounced();
-    }
-  });
+  // Read routes of agent before any programming on warm boot
+  if (enableWarmBoot and not dryrun_) {
+    runInEventLoop([this]() noexcept { readAgentRouteDb(); });
+  }
+
+  syncFibTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.sync_fib", [this]() noexcept {
+        if (hasRoutesFromDecision_) {
+          syncRouteDbDebounced();
+        }
+      }));
 
   // Only schedule sync Fib in non dry run and enable sync mode
   if (not dryrun_ and enableFibSync_) {
@@ -115,6 +182,14 @@ Fib::Fib(
       std::make_unique<fbzmq::ZmqMonitorClient>(zmqContext, monitorSubmitUrl);
 }
 
+Fib::~Fib() {
+  // Fail calls in flight while rest of the members are still alive
+  client_.reset();
+  socket_.reset();
+  mplsClient_.reset();
+  mplsSocket_.reset();
+}
+
 void
 Fib::prepare() noexcept {
   VLOG(2) << "Fib: Subscribing to decision module '" << decisionPubUrl_ << "'";
@@ -150,23 +225,36 @@ Fib::prepare() noexcept {
 
   // Schedule periodic timer for submission to monitor
   const bool isPeriodic = true;
-  monitorTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+  monitorTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.monitor", [this]() noexcept { submitCounters(); }));
   monitorTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval, isPeriodic);
 
   // Received publication from Decision module
   addSocket(
-      fbzmq::RawZmqSocketPtr{*decisionSub_}, ZMQ_POLLIN, [this](int) noexcept {
+      fbzmq::RawZmqSocketPtr{*decisionSub_},
+      ZMQ_POLLIN,
+      profiled("socket.decision_sub", [this](int) noexcept {
         VLOG(1) << "Fib: publication received ...";
+        auto maybeMsg = decisionSub_.recvOne(Constants::kReadTimeout);
+        if (maybeMsg.hasError()) {
+          LOG(ERROR) << "Error receiving decision publication: "
+                     << maybeMsg.error();
+          return;
+        }
         auto maybeThriftObj =
-            decisionSub_.recvThriftObj<thrift::RouteDatabaseDelta>(
-                serializer_, Constants::kReadTimeout);
+            routeDeltaSerializer_.fromMessage<thrift::RouteDatabaseDelta>(
+                maybeMsg.value());
         if (maybeThriftObj.hasError()) {
           LOG(ERROR) << "Error processing decision publication: "
                      << maybeThriftObj.error();
           return;
         }
         auto& thriftDeltaRouteDb = maybeThriftObj.value();
+        if (not expandNextHopGroups(thriftDeltaRouteDb)) {
+          LOG(ERROR) << "Ignoring decision publication with unknown "
+                     << "next-hop groups";
+          return;
+        }
 
         if (thriftDeltaRouteDb.thisNodeName != myNodeName_) {
           LOG(ERROR) << "Received publication from unknown node "
@@ -174,11 +262,13 @@ Fib::prepare() noexcept {
         } else {
           processRouteDb(std::move(thriftDeltaRouteDb));
         }
-      });
+      }));
 
   // We have received Interface status publication from LinkMonitor
   addSocket(
-      fbzmq::RawZmqSocketPtr{*linkMonSub_}, ZMQ_POLLIN, [this](int) noexcept {
+      fbzmq::RawZmqSocketPtr{*linkMonSub_},
+      ZMQ_POLLIN,
+      profiled("socket.link_monitor_sub", [this](int) noexcept {
         VLOG(1) << "Fib: interface status publication received ...";
         auto maybeThriftObj =
             linkMonSub_.recvThriftObj<thrift::InterfaceDatabase>(
@@ -196,7 +286,7 @@ Fib::prepare() noexcept {
         } else {
           processInterfaceDb(std::move(thriftInterfaceDb));
         }
-      });
+      }));
 }
 
 // Received FibRequest
@@ -209,6 +299,8 @@ Fib::processRequestMsg(fbzmq::Message&& request) {
   }
 
   auto& thriftReq = maybeThriftObj.value();
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::FibCommand>::findName(thriftReq.cmd));
   VLOG(1) << "Fib: Request command: `"
           << apache::thrift::TEnumTraits<thrift::FibCommand>::findName(
                  thriftReq.cmd)
@@ -217,33 +309,18 @@ Fib::processRequestMsg(fbzmq::Message&& request) {
   case thrift::FibCommand::ROUTE_DB_GET: {
     VLOG(2) << "Fib: RouteDb requested";
     // send the thrift::RouteDatabase
-    thrift::RouteDatabase retRouteDb;
-    retRouteDb.thisNodeName = routeDb_.thisNodeName;
-    retRouteDb.perfEvents = routeDb_.perfEvents;
-    for (const auto& route : routeDb_.unicastRoutes) {
-      retRouteDb.unicastRoutes.emplace_back(route.second);
-    }
-    for (const auto& route : routeDb_.mplsRoutes) {
-      retRouteDb.mplsRoutes.emplace_back(route.second);
-    }
-    return fbzmq::Message::fromThriftObj(retRouteDb, serializer_);
+    return toReplyMsg(dumpRouteDb(), serializer_);
     break;
   }
   case thrift::FibCommand::PERF_DB_GET:
     VLOG(2) << "Fib: PerfDb requested";
     // send the thrift::PerfDatabase
-    return fbzmq::Message::fromThriftObj(dumpPerfDb(), serializer_);
+    return toReplyMsg(dumpPerfDb(), serializer_);
     break;
   case thrift::FibCommand::ROUTE_DB_UNINSTALLABLE_GET: {
     VLOG(2) << "Fib: Do not install RouteDb requested";
     // send the thrift::RouteDatabase
-    thrift::RouteDatabase retRouteDb;
-    retRouteDb.thisNodeName = doNotInstallRouteDb_.thisNodeName;
-    retRouteDb.perfEvents = doNotInstallRouteDb_.perfEvents;
-    for (const auto& route : doNotInstallRouteDb_.unicastRoutes) {
-      retRouteDb.unicastRoutes.emplace_back(route.second);
-    }
-    return fbzmq::Message::fromThriftObj(retRouteDb, serializer_);
+    return toReplyMsg(dumpUnInstallableRouteDb(), serializer_);
     break;
   }
   default:
@@ -252,8 +329,132 @@ Fib::processRequestMsg(fbzmq::Message&& request) {
   }
 }
 
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+Fib::getRouteDb() {
+  VLOG(2) << "Fib: RouteDb requested";
+  return runInEventLoopWithResult<thrift::RouteDatabase>(
+      [this] { return dumpRouteDb(); });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+Fib::getRouteDbUnInstallable() {
+  VLOG(2) << "Fib: Do not install RouteDb requested";
+  return runInEventLoopWithResult<thrift::RouteDatabase>(
+      [this] { return dumpUnInstallableRouteDb(); });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>>
+Fib::getPerfDb() {
+  VLOG(2) << "Fib: PerfDb requested";
+  return runInEventLoopWithResult<thrift::PerfDatabase>(
+      [this] { return dumpPerfDb(); });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::UnicastRoute>>
+Fib::getRouteForAddress(thrift::BinaryAddress address) {
+  VLOG(2) << "Fib: Route for address requested";
+  return runInEventLoopWithResult<thrift::UnicastRoute>(
+      [this, address = std::move(address)] {
+        auto route =
+            routeTable_.getUnicastRouteForAddress(toIPAddress(address));
+        if (not route) {
+          throw thrift::OpenrError(
+              folly::sformat("No route for {}", toString(address)));
+        }
+        return std::move(route).value();
+      });
+}
+
+void
+Fib::setRouteDbDeltaCallback(
+    std::function<void(thrift::RouteDatabaseDelta const&)> callback) {
+  runInEventLoop([this, callback = std::move(callback)]() mutable noexcept {
+    routeDbDeltaCallback_ = std::move(callback);
+  });
+}
+
+void
+Fib::setPerfEventsCallback(
+    std::function<void(thrift::PerfEvents const&)> callback) {
+  runInEventLoop([this, callback = std::move(callback)]() mutable noexcept {
+    perfEventsCallback_ = std::move(callback);
+  });
+}
+
+void
+Fib::setRouteDbSyncedCallback(std::function<void()> callback) {
+  runInEventLoop([this, callback = std::move(callback)]() mutable noexcept {
+    if (not routeDbSynced_) {
+      routeDbSyncedCallback_ = std::move(callback);
+    } else if (callback) {
+      callback();
+    }
+  });
+}
+
+void
+Fib::reportRouteDbSynced() {
+  if (routeDbSynced_) {
+    return;
+  }
+  routeDbSynced_ = true;
+  if (routeDbSyncedCallback_) {
+    routeDbSyncedCallback_();
+    routeDbSyncedCallback_ = nullptr;
+  }
+}
+
+void
+Fib::publishRouteDbDelta(thrift::RouteDatabaseDelta const& routeDelta) {
+  if (not routeDbDeltaCallback_) {
+    return;
+  }
+
+  thrift::RouteDatabaseDelta delta;
+  delta.thisNodeName = myNodeName_;
+  for (auto const& route : routeDelta.unicastRoutesToUpdate) {
+    if (route.doNotInstall) {
+      delta.unicastRoutesToDelete.emplace_back(route.dest);
+    } else {
+      delta.unicastRoutesToUpdate.emplace_back(route);
+    }
+  }
+  delta.unicastRoutesToDelete.insert(
+      delta.unicastRoutesToDelete.end(),
+      routeDelta.unicastRoutesToDelete.begin(),
+      routeDelta.unicastRoutesToDelete.end());
+  delta.mplsRoutesToUpdate = routeDelta.mplsRoutesToUpdate;
+  delta.mplsRoutesToDelete = routeDelta.mplsRoutesToDelete;
+  if (delta.unicastRoutesToUpdate.empty() and
+      delta.unicastRoutesToDelete.empty() and
+      delta.mplsRoutesToUpdate.empty() and delta.mplsRoutesToDelete.empty()) {
+    return;
+  }
+  routeDbDeltaCallback_(delta);
+}
+
+thrift::RouteDatabase
+Fib::dumpRouteDb() const {
+  thrift::RouteDatabase retRouteDb;
+  retRouteDb.thisNodeName = myNodeName_;
+  retRouteDb.unicastRoutes = routeTable_.getUnicastRoutes();
+  retRouteDb.mplsRoutes = routeTable_.getMplsRoutes();
+  return retRouteDb;
+}
+
+thrift::RouteDatabase
+Fib::dumpUnInstallableRouteDb() const {
+  thrift::RouteDatabase retRouteDb;
+  retRouteDb.thisNodeName = doNotInstallRouteDb_.thisNodeName;
+  retRouteDb.perfEvents = doNotInstallRouteDb_.perfEvents;
+  for (const auto& route : doNotInstallRouteDb_.unicastRoutes) {
+    retRouteDb.unicastRoutes.emplace_back(route.second);
+  }
+  return retRouteDb;
+}
+
 /**
- * Rebuild routeDb_ from routeDelta
+ * Apply routeDelta to routeTable_ in place
  */
 void
 Fib::mergeRouteDatabaseDelta(thrift::RouteDatabaseDelta& routeDelta) {
@@ -262,27 +463,27 @@ Fib::mergeRouteDatabaseDelta(thrift::RouteDatabaseDelta& routeDelta) {
     if (route.doNotInstall) {
       doNotInstallRouteDb_.unicastRoutes[route.dest] = route;
       // Remove routes that should not be programmed
-      routeDb_.unicastRoutes.erase(route.dest);
+      routeTable_.deleteUnicastRoute(route.dest);
     } else {
-      routeDb_.unicastRoutes[route.dest] = route;
+      routeTable_.updateUnicastRoute(route);
       doNotInstallRouteDb_.unicastRoutes.erase(route.dest);
     }
   }
 
   // Add mpls routes to update
   for (const auto& route : routeDelta.mplsRoutesToUpdate) {
-    routeDb_.mplsRoutes[route.topLabel] = route;
+    routeTable_.updateMplsRoute(route);
   }
 
   // Delete unicast routes
   for (auto& dest : routeDelta.unicastRoutesToDelete) {
     doNotInstallRouteDb_.unicastRoutes.erase(dest);
-    routeDb_.unicastRoutes.erase(dest);
+    routeTable_.deleteUnicastRoute(dest);
   }
 
   // Delete mpls routes
   for (const auto& topLabel : routeDelta.mplsRoutesToDelete) {
-    routeDb_.mplsRoutes.erase(topLabel);
+    routeTable_.deleteMplsRoute(topLabel);
   }
 }
 
@@ -296,8 +497,9 @@ Fib::processRouteDb(thrift::RouteDatabaseDelta&& routeDelta) {
     addPerfEvent(*maybePerfEvents_, myNodeName_, "FIB_ROUTE_DB_RECVD");
   }
 
-  // Update routeDb_
+  // Update routeTable_
   mergeRouteDatabaseDelta(routeDelta);
+  publishRouteDbDelta(routeDelta);
 
   // Add some counters
   tData_.addStatValue("fib.process_route_db", 1, fbzmq::COUNT);
@@ -329,93 +531,20 @@ Fib::processInterfaceDb(thrift::InterfaceDatabase&& interfaceDb) {
     }
   }
 
+  // Remove next-hops on affected interfaces from routes, and program routes
+  // whose best paths changed or which have no valid paths left
   thrift::RouteDatabaseDelta routeDbDelta;
-
-  for (auto it = routeDb_.unicastRoutes.begin();
-       it != routeDb_.unicastRoutes.end();) {
-    // Find valid paths
-    std::vector<thrift::NextHopThrift> validNextHops;
-    for (auto const& nextHop : it->second.nextHops) {
-      CHECK(nextHop.address.ifName.hasValue());
-      if (affectedInterfaces.count(nextHop.address.ifName.value()) == 0) {
-        validNextHops.emplace_back(nextHop);
-      }
-    } // end for ... kv.second
-
-    // Add to affected routes only if best path has changed and also reflect
-    // changes in routeDb_
-    auto prevBestNextHops = getBestNextHopsUnicast(it->second.nextHops);
-
-    // Find best paths
-    auto validBestNextHops = getBestNextHopsUnicast(validNextHops);
-
-    // Update valid nexthops
-    it->second.nextHops = std::move(validNextHops);
-
-    if (validBestNextHops.size() && validBestNextHops != prevBestNextHops) {
-      VLOG(1) << "bestPaths group resize for prefix: " << toString(it->first)
-              << ", old: " << prevBestNextHops.size()
-              << ", new: " << validBestNextHops.size();
-      thrift::UnicastRoute route;
-      route.dest = it->first;
-      route.nextHops = std::move(validBestNextHops);
-      routeDbDelta.unicastRoutesToUpdate.emplace_back(std::move(route));
-    }
-
-    // Remove route if no valid paths
-    if (it->second.nextHops.size() == 0) {
-      VLOG(1) << "Removing prefix " << toString(it->first)
-              << " because of no valid nextHops.";
-      routeDbDelta.unicastRoutesToDelete.emplace_back(it->first);
-      it = routeDb_.unicastRoutes.erase(it);
-    } else {
-      ++it;
-    }
-  } // end for ... routeDb_.unicastRoutes
-
-  for (auto it = routeDb_.mplsRoutes.begin();
-       it != routeDb_.mplsRoutes.end();) {
-    // Find valid paths
-    std::vector<thrift::NextHopThrift> validNextHops;
-    for (auto const& nextHop : it->second.nextHops) {
-      // We don't have ifName for `POP_AND_LOOKUP` mpls action
-      if (not nextHop.address.ifName.hasValue() or
-          affectedInterfaces.count(nextHop.address.ifName.value()) == 0) {
-        validNextHops.emplace_back(nextHop);
-      }
-    } // end for ... it->nextHops
-
-    // Add to affected routes only if best path has changed and also reflect
-    // changes in routeDb_
-    auto prevBestNextHops = getBestNextHopsMpls(it->second.nextHops);
-
-    // Find best paths
-    auto validBestNextHops = getBestNextHopsMpls(validNextHops);
-
-    // Update valid nexthops
-    it->second.nextHops = std::move(validNextHops);
-
-    if (validBestNextHops.size() && validBestNextHops != prevBestNextHops) {
-      VLOG(1)
-          << "bestPaths group resize for label: " << std::to_string(it->first)
-          << ", old: " << prevBestNextHops.size()
-          << ", new: " << validBestNextHops.size();
-      thrift::MplsRoute route;
-      route.topLabel = it->first;
-      route.nextHops = std::move(validBestNextHops);
-      routeDbDelta.mplsRoutesToUpdate.emplace_back(std::move(route));
-    }
-
-    // Remove route if no valid paths
-    if (it->second.nextHops.size() == 0) {
-      VLOG(1) << "Removing prefix " << std::to_string(it->first)
-              << " because of no valid nextHops.";
-      routeDbDelta.mplsRoutesToDelete.emplace_back(it->first);
-      it = routeDb_.mplsRoutes.erase(it);
-    } else {
-      ++it;
-    }
-  } // end for ... routeDb_.mplsRoutes
+  if (not affectedInterfaces.empty()) {
+    const auto startTime = std::chrono::steady_clock::now();
+    routeTable_.removeNextHopsOnInterfaces(affectedInterfaces, routeDbDelta);
+    tData_.addStatValue(
+        "fib.local_repair_ms",
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count(),
+        fbzmq::AVG);
+  }
+  publishRouteDbDelta(routeDbDelta);
 
   updateRoutes(routeDbDelta);
 }
@@ -427,6 +556,9 @@ Fib::dumpPerfDb() const {
   for (auto const& perf : perfDb_) {
     perfDb.eventInfo.emplace_back(perf);
   }
+  for (auto const& kv : latencyHistograms_) {
+    kv.second.exportCounters(kv.first, perfDb.latencyCounters);
+  }
   return perfDb;
 }
 
@@ -443,7 +575,7 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
   auto const& patchedUnicastRoutesToUpdate =
       createUnicastRoutesWithBestNexthops(routeDbDelta.unicastRoutesToUpdate);
 
-  auto const& mplsRoutesToUpdate =
+  auto mplsRoutesToUpdate =
       createMplsRoutesWithBestNextHops(routeDbDelta.mplsRoutesToUpdate);
 
   VLOG(2) << "Unicast routes to add/update";
@@ -483,11 +615,24 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
     return;
   }
 
+  if (agentRouteDb_) {
+    // Routes of agent are yet to be synced with routeTable_ on warm boot
+    syncRouteDbDebounced();
+    return;
+  }
+
   if (syncRoutesTimer_->isScheduled()) {
     // Check if there's any full sync scheduled,
     // if so, skip partial sync
     LOG(INFO) << "Pending full sync is scheduled, skip delta sync for now...";
     return;
+  } else if (programmingInFlight_) {
+    // Program it along with other updates once in-flight call completes. It
+    // gets dropped if the call fails as full sync is enforced then
+    VLOG(1) << "Route programming in flight, coalescing delta...";
+    mergePendingDelta(routeDbDelta);
+    tData_.addStatValue("fib.coalesced_deltas", 1, fbzmq::COUNT);
+    return;
   } else if (dirtyRouteDb_) {
     // If previous route programming attempt failed, enforce full sync
     LOG(INFO) << "Previous route programming failed, skip delta sync to enforce"
@@ -496,50 +641,273 @@ Fib::updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta) {
     return;
   }
 
-  // Make thrift calls to do real programming
+  // Split delta by priority. Critical routes are programmed first, rest of
+  // the routes once agent has acknowledged them
+  std::vector<thrift::IpPrefix> criticalUnicastRoutesToDelete;
+  std::vector<thrift::IpPrefix> unicastRoutesToDelete;
+  for (auto const& prefix : routeDbDelta.unicastRoutesToDelete) {
+    if (isCriticalRoute(prefix)) {
+      criticalUnicastRoutesToDelete.emplace_back(prefix);
+    } else {
+      unicastRoutesToDelete.emplace_back(prefix);
+    }
+  }
+  std::vector<thrift::UnicastRoute> criticalUnicastRoutesToUpdate;
+  std::vector<thrift::UnicastRoute> unicastRoutesToUpdate;
+  for (auto const& route : patchedUnicastRoutesToUpdate) {
+    if (isCriticalRoute(route.dest)) {
+      criticalUnicastRoutesToUpdate.emplace_back(route);
+    } else {
+      unicastRoutesToUpdate.emplace_back(route);
+    }
+  }
+  std::vector<int32_t> mplsRoutesToDelete;
+  if (enableSegmentRouting_) {
+    mplsRoutesToDelete = routeDbDelta.mplsRoutesToDelete;
+  } else {
+    mplsRoutesToUpdate.clear();
+  }
+
+  // Make thrift calls to do real programming. All calls of a stage are
+  // pipelined on the connection, order doesn't matter as a route is either
+  // updated or deleted
+  std::vector<folly::Future<folly::Unit>> futures;
   try {
     if (maybePerfEvents_) {
       addPerfEvent(*maybePerfEvents_, myNodeName_, "FIB_DEBOUNCE");
     }
-    createFibClient(evb_, socket_, client_, thriftPort_);
-    if (routeDbDelta.unicastRoutesToDelete.size()) {
-      client_->sync_deleteUnicastRoutes(
-          kFibId_, routeDbDelta.unicastRoutesToDelete);
-    }
-    if (patchedUnicastRoutesToUpdate.size()) {
-      client_->sync_addUnicastRoutes(kFibId_, patchedUnicastRoutesToUpdate);
-    }
-    if (enableSegmentRouting_ && routeDbDelta.mplsRoutesToDelete.size()) {
-      client_->sync_deleteMplsRoutes(kFibId_, routeDbDelta.mplsRoutesToDelete);
-    }
-    if (enableSegmentRouting_ && mplsRoutesToUpdate.size()) {
-      client_->sync_addMplsRoutes(kFibId_, mplsRoutesToUpdate);
+    createFibClients();
+    if (criticalUnicastRoutesToDelete.empty() and
+        criticalUnicastRoutesToUpdate.empty()) {
+      futures.emplace_back(programRoutes(
+          unicastRoutesToDelete,
+          unicastRoutesToUpdate,
+          mplsRoutesToDelete,
+          mplsRoutesToUpdate));
+    } else {
+      tData_.addStatValue(
+          "fib.num_critical_routes_programmed",
+          criticalUnicastRoutesToDelete.size() +
+              criticalUnicastRoutesToUpdate.size(),
+          fbzmq::SUM);
+      futures.emplace_back(
+          programRoutes(
+              criticalUnicastRoutesToDelete,
+              criticalUnicastRoutesToUpdate,
+              {},
+              {})
+              .thenValue([this,
+                          unicastRoutesToDelete =
+                              std::move(unicastRoutesToDelete),
+                          unicastRoutesToUpdate =
+                              std::move(unicastRoutesToUpdate),
+                          mplsRoutesToDelete = std::move(mplsRoutesToDelete),
+                          mplsRoutesToUpdate =
+                              std::move(mplsRoutesToUpdate)](folly::Unit) {
+                if (maybePerfEvents_) {
+                  addPerfEvent(
+                      *maybePerfEvents_,
+                      myNodeName_,
+                      "FIB_CRITICAL_ROUTES_PROGRAMMED");
+                }
+                return programRoutes(
+                    unicastRoutesToDelete,
+                    unicastRoutesToUpdate,
+                    mplsRoutesToDelete,
+                    mplsRoutesToUpdate);
+              }));
     }
-    dirtyRouteDb_ = false;
-    logPerfEvents();
-    LOG(INFO) << "Done processing route add/update";
   } catch (const std::exception& e) {
     tData_.addStatValue("fib.thrift.failure.add_del_route", 1, fbzmq::COUNT);
-    client_.reset();
+    resetFibClient();
     dirtyRouteDb_ = true;
     syncRouteDbDebounced(); // Schedule future full sync of route DB
     LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
                << folly::exceptionStr(e);
+    return;
+  }
+
+  tData_.addStatValue("fib.route_programming_calls", 1, fbzmq::COUNT);
+  programmingInFlight_ = true;
+  waitForAgent(std::move(futures), [this](folly::exception_wrapper&& ew) {
+    if (ew) {
+      tData_.addStatValue("fib.thrift.failure.add_del_route", 1, fbzmq::COUNT);
+      resetFibClient();
+      dirtyRouteDb_ = true;
+      syncRouteDbDebounced(); // Schedule future full sync of route DB
+      LOG(ERROR) << "Failed to make thrift call to FibAgent. Error: "
+                 << ew.what();
+    } else {
+      dirtyRouteDb_ = false;
+      logPerfEvents();
+      LOG(INFO) << "Done processing route add/update";
+    }
+    processProgrammingDone();
+  });
+}
+
+void
+Fib::mergePendingDelta(const thrift::RouteDatabaseDelta& routeDbDelta) {
+  for (const auto& route : routeDbDelta.unicastRoutesToUpdate) {
+    pendingUnicastRoutesToDelete_.erase(route.dest);
+    pendingRoutesToUpdate_.unicastRoutes[route.dest] = route;
+  }
+  for (const auto& prefix : routeDbDelta.unicastRoutesToDelete) {
+    pendingRoutesToUpdate_.unicastRoutes.erase(prefix);
+    pendingUnicastRoutesToDelete_.insert(prefix);
+  }
+  for (const auto& route : routeDbDelta.mplsRoutesToUpdate) {
+    pendingMplsRoutesToDelete_.erase(route.topLabel);
+    pendingRoutesToUpdate_.mplsRoutes[route.topLabel] = route;
+  }
+  for (const auto& topLabel : routeDbDelta.mplsRoutesToDelete) {
+    pendingRoutesToUpdate_.mplsRoutes.erase(topLabel);
+    pendingMplsRoutesToDelete_.insert(topLabel);
   }
 }
 
+folly::Future<folly::Unit>
+Fib::programRoutes(
+    const std::vector<thrift::IpPrefix>& unicastRoutesToDelete,
+    const std::vector<thrift::UnicastRoute>& unicastRoutesToUpdate,
+    const std::vector<int32_t>& mplsRoutesToDelete,
+    const std::vector<thrift::MplsRoute>& mplsRoutesToUpdate) {
+  if (not client_) {
+    return folly::makeFuture<folly::Unit>(
+        std::runtime_error("Connection to FibAgent reset during programming"));
+  }
+
+  // Latency of each call is recorded by route and call type on success, and
+  // of all calls of a table by table
+  const auto startTime = std::chrono::steady_clock::now();
+  auto latencyRecorder = [this, startTime](std::string name) {
+    return [this, startTime, name = std::move(name)](folly::Unit) {
+      recordLatency(name, startTime);
+    };
+  };
+  auto collectTableCalls = [&latencyRecorder](
+                               std::vector<folly::Future<folly::Unit>>&& calls,
+                               std::string name) {
+    if (calls.empty()) {
+      return folly::makeFuture();
+    }
+    return collectAgentCalls(std::move(calls))
+        .thenValue(latencyRecorder(std::move(name)));
+  };
+
+  std::vector<folly::Future<folly::Unit>> unicastFutures;
+  if (unicastRoutesToDelete.size()) {
+    unicastFutures.emplace_back(
+        client_->future_deleteUnicastRoutes(kFibId_, unicastRoutesToDelete)
+            .thenValue(latencyRecorder("fib.latency.agent_ms.unicast_delete")));
+  }
+  if (unicastRoutesToUpdate.size()) {
+    unicastFutures.emplace_back(
+        client_->future_addUnicastRoutes(kFibId_, unicastRoutesToUpdate)
+            .thenValue(latencyRecorder("fib.latency.agent_ms.unicast_add")));
+  }
+  if (mplsRoutesToDelete.empty() and mplsRoutesToUpdate.empty()) {
+    return collectTableCalls(
+        std::move(unicastFutures), "fib.latency.agent_ms.unicast");
+  }
+  if (not mplsClient_) {
+    return folly::makeFuture<folly::Unit>(
+        std::runtime_error("Connection to FibAgent reset during programming"));
+  }
+
+  std::vector<folly::Future<folly::Unit>> mplsFutures;
+  if (mplsRoutesToUpdate.size()) {
+    mplsFutures.emplace_back(
+        mplsClient_->future_addMplsRoutes(kFibId_, mplsRoutesToUpdate)
+            .thenValue(latencyRecorder("fib.latency.agent_ms.mpls_add")));
+  }
+
+  auto unicastFuture = collectTableCalls(
+      std::move(unicastFutures), "fib.latency.agent_ms.unicast");
+  std::vector<folly::Future<folly::Unit>> futures;
+  if (mplsRoutesToDelete.size()) {
+    // Label routes to delete may still be used by unicast routes replaced
+    // above, delete them once unicast routes are programmed
+    mplsFutures.emplace_back(
+        std::move(unicastFuture)
+            .thenValue([this, mplsRoutesToDelete, latencyRecorder](
+                           folly::Unit) {
+              if (not mplsClient_) {
+                return folly::makeFuture<folly::Unit>(std::runtime_error(
+                    "Connection to FibAgent reset during programming"));
+              }
+              return mplsClient_
+                  ->future_deleteMplsRoutes(kFibId_, mplsRoutesToDelete)
+                  .thenValue(
+                      latencyRecorder("fib.latency.agent_ms.mpls_delete"));
+            }));
+  } else {
+    futures.emplace_back(std::move(unicastFuture));
+  }
+  futures.emplace_back(
+      collectTableCalls(std::move(mplsFutures), "fib.latency.agent_ms.mpls"));
+  return collectAgentCalls(std::move(futures));
+}
+
 bool
+Fib::isCriticalRoute(const thrift::IpPrefix& prefix) const {
+  const auto network = toIPNetwork(prefix);
+  if (network.second == 0 or network.second == network.first.bitCount()) {
+    return true;
+  }
+  return criticalPrefixes_.longestMatch(network) != nullptr;
+}
+
+void
+Fib::processProgrammingDone() {
+  programmingInFlight_ = false;
+
+  // Build merged delta and clear pending state before programming it
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = myNodeName_;
+  for (auto& kv : pendingRoutesToUpdate_.unicastRoutes) {
+    routeDbDelta.unicastRoutesToUpdate.emplace_back(std::move(kv.second));
+  }
+  for (auto& kv : pendingRoutesToUpdate_.mplsRoutes) {
+    routeDbDelta.mplsRoutesToUpdate.emplace_back(std::move(kv.second));
+  }
+  routeDbDelta.unicastRoutesToDelete.assign(
+      pendingUnicastRoutesToDelete_.begin(),
+      pendingUnicastRoutesToDelete_.end());
+  routeDbDelta.mplsRoutesToDelete.assign(
+      pendingMplsRoutesToDelete_.begin(), pendingMplsRoutesToDelete_.end());
+  pendingRoutesToUpdate_.unicastRoutes.clear();
+  pendingRoutesToUpdate_.mplsRoutes.clear();
+  pendingUnicastRoutesToDelete_.clear();
+  pendingMplsRoutesToDelete_.clear();
+
+  // Full sync programs whole routeTable_ including pending delta
+  if (pendingFullSync_) {
+    pendingFullSync_ = false;
+    syncRouteDbDebounced();
+    return;
+  }
+
+  if (routeDbDelta.unicastRoutesToUpdate.empty() &&
+      routeDbDelta.unicastRoutesToDelete.empty() &&
+      routeDbDelta.mplsRoutesToUpdate.empty() &&
+      routeDbDelta.mplsRoutesToDelete.empty()) {
+    return;
+  }
+
+  // NOTE: on failure dirtyRouteDb_ is set and delta is skipped for full sync
+  updateRoutes(routeDbDelta);
+}
+
+void
 Fib::syncRouteDb() {
   LOG(INFO) << "Syncing latest routeDb with fib-agent with "
-            << routeDb_.unicastRoutes.size() << " routes";
-
-  const auto& unicastRoutes =
-      createUnicastRoutesWithBestNextHopsMap(routeDb_.unicastRoutes);
-  const auto& mplsRoutes =
-      createMplsRoutesWithBestNextHopsMap(routeDb_.mplsRoutes);
+            << routeTable_.getNumUnicastRoutes() << " routes";
 
   // In dry run we just print the routes. No real action
   if (dryrun_) {
+    const auto& unicastRoutes = routeTable_.getUnicastRoutesToProgram();
+    const auto& mplsRoutes = routeTable_.getMplsRoutesToProgram();
     LOG(INFO) << "Skipping programing of routes in dryrun ... ";
     VLOG(2) << "Unicast routes to add/update";
     for (auto const& route : unicastRoutes) {
@@ -560,35 +928,297 @@ Fib::syncRouteDb() {
     }
 
     logPerfEvents();
-    return true;
+    expBackoff_.reportSuccess();
+    reportRouteDbSynced();
+    return;
   }
 
+  if (programmingInFlight_) {
+    // Sync must not race with in-flight calls, retry once they complete
+    LOG(INFO) << "Route programming in flight, deferring full fib sync...";
+    pendingFullSync_ = true;
+    return;
+  }
+
+  if (agentRouteDb_) {
+    syncRouteDbWithAgentRoutes();
+    return;
+  }
+
+  std::vector<folly::Future<folly::Unit>> futures;
   try {
     if (maybePerfEvents_) {
       addPerfEvent(*maybePerfEvents_, myNodeName_, "FIB_DEBOUNCE");
     }
-    createFibClient(evb_, socket_, client_, thriftPort_);
+    createFibClients();
     tData_.addStatValue("fib.sync_fib_calls", 1, fbzmq::COUNT);
 
-    // Sync unicast routes
-    client_->sync_syncFib(kFibId_, unicastRoutes);
+    if (syncFibChunkSize_ > 0) {
+      futures.emplace_back(syncRouteDbChunked());
+    } else {
+      // Sync unicast routes, critical routes first
+      auto unicastRoutes = routeTable_.getUnicastRoutesToProgram();
+      std::stable_partition(
+          unicastRoutes.begin(),
+          unicastRoutes.end(),
+          [this](const thrift::UnicastRoute& route) {
+            return isCriticalRoute(route.dest);
+          });
+      futures.emplace_back(client_->future_syncFib(kFibId_, unicastRoutes));
+
+      // Sync mpls routes
+      if (enableSegmentRouting_) {
+        futures.emplace_back(mplsClient_->future_syncMplsFib(
+            kFibId_, routeTable_.getMplsRoutesToProgram()));
+      }
+    }
+  } catch (std::exception const& e) {
+    processSyncRouteDbFailure(
+        folly::exception_wrapper(std::current_exception(), e));
+    return;
+  }
 
-    // Sync mpls routes
-    if (enableSegmentRouting_) {
-      client_->sync_syncMplsFib(kFibId_, mplsRoutes);
+  programmingInFlight_ = true;
+  const auto startTime = std::chrono::steady_clock::now();
+  waitForAgent(
+      std::move(futures), [this, startTime](folly::exception_wrapper&& ew) {
+        if (ew) {
+          processSyncRouteDbFailure(ew);
+        } else {
+          recordLatency("fib.latency.agent_ms.sync", startTime);
+          dirtyRouteDb_ = false;
+          expBackoff_.reportSuccess();
+          logPerfEvents();
+          reportRouteDbSynced();
+          LOG(INFO) << "Done syncing latest routeDb with fib-agent";
+        }
+        processProgrammingDone();
+      });
+}
+
+folly::Future<folly::Unit>
+Fib::syncRouteDbChunked() {
+  // Only keys are snapshotted, routes are read when their chunk is sent
+  auto prefixes = std::make_shared<std::vector<thrift::IpPrefix>>(
+      routeTable_.getUnicastPrefixes());
+  // Critical routes are sent in first chunks
+  std::stable_partition(
+      prefixes->begin(),
+      prefixes->end(),
+      [this](const thrift::IpPrefix& prefix) {
+        return isCriticalRoute(prefix);
+      });
+  auto labels = std::make_shared<std::vector<int32_t>>();
+  if (enableSegmentRouting_) {
+    *labels = routeTable_.getMplsLabels();
+  }
+
+  return client_->future_beginSyncFib(kFibId_, enableSegmentRouting_)
+      .thenValue([this, prefixes, labels](int64_t syncId) {
+        return sendSyncFibChunks(syncId, prefixes, labels, 0);
+      });
+}
+
+folly::Future<folly::Unit>
+Fib::sendSyncFibChunks(
+    int64_t syncId,
+    std::shared_ptr<std::vector<thrift::IpPrefix>> prefixes,
+    std::shared_ptr<std::vector<int32_t>> labels,
+    size_t offset) {
+  if (not client_) {
+    return folly::makeFuture<folly::Unit>(
+        std::runtime_error("Connection to FibAgent reset during sync"));
+  }
+
+  const size_t total = prefixes->size() + labels->size();
+  if (offset >= total) {
+    return client_->future_commitSyncFib(kFibId_, syncId);
+  }
+
+  std::vector<thrift::UnicastRoute> unicastRoutes;
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  for (; offset < total and
+       unicastRoutes.size() + mplsRoutes.size() < syncFibChunkSize_;
+       ++offset) {
+    if (offset < prefixes->size()) {
+      auto route = routeTable_.getUnicastRouteToProgram(prefixes->at(offset));
+      if (route.hasValue()) {
+        unicastRoutes.emplace_back(std::move(route.value()));
+      }
+    } else {
+      auto route = routeTable_.getMplsRouteToProgram(
+          labels->at(offset - prefixes->size()));
+      if (route.hasValue()) {
+        mplsRoutes.emplace_back(std::move(route.value()));
+      }
     }
+  }
 
-    dirtyRouteDb_ = false;
-    logPerfEvents();
-    LOG(INFO) << "Done syncing latest routeDb with fib-agent";
-    return true;
-  } catch (std::exception const& e) {
-    tData_.addStatValue("fib.thrift.failure.sync_fib", 1, fbzmq::COUNT);
-    LOG(ERROR) << "Failed to sync routeDb with switch FIB agent. Error: "
-               << folly::exceptionStr(e);
+  // Remaining routes were deleted meanwhile
+  if (unicastRoutes.empty() and mplsRoutes.empty()) {
+    return client_->future_commitSyncFib(kFibId_, syncId);
+  }
+
+  tData_.addStatValue("fib.sync_fib_chunks", 1, fbzmq::COUNT);
+  return client_
+      ->future_syncFibChunk(kFibId_, syncId, unicastRoutes, mplsRoutes)
+      .thenValue([this, syncId, prefixes, labels, offset](folly::Unit) {
+        return sendSyncFibChunks(syncId, prefixes, labels, offset);
+      });
+}
+
+void
+Fib::readAgentRouteDb() {
+  auto routeDb = std::make_shared<thrift::RouteDatabase>();
+  std::vector<folly::Future<folly::Unit>> futures;
+  try {
+    createFibClient(evb_, socket_, client_, thriftPort_);
+    // Agent restarts detected from now on invalidate routes read
+    futures.emplace_back(
+        client_->future_aliveSince().thenValue([this](int64_t aliveSince) {
+          latestAliveSince_ = aliveSince;
+        }));
+    futures.emplace_back(
+        client_->future_getRouteTableByClient(kFibId_).thenValue(
+            [routeDb](std::vector<thrift::UnicastRoute>&& routes) {
+              routeDb->unicastRoutes = std::move(routes);
+            }));
+    if (enableSegmentRouting_) {
+      futures.emplace_back(
+          client_->future_getMplsRouteTableByClient(kFibId_).thenValue(
+              [routeDb](std::vector<thrift::MplsRoute>&& routes) {
+                routeDb->mplsRoutes = std::move(routes);
+              }));
+    }
+  } catch (const std::exception& e) {
+    tData_.addStatValue("fib.thrift.failure.warm_boot", 1, fbzmq::COUNT);
+    resetFibClient();
     dirtyRouteDb_ = true;
-    client_.reset();
-    return false;
+    LOG(ERROR) << "Failed to read routes of FibAgent, falling back to full "
+               << "sync. Error: " << folly::exceptionStr(e);
+    return;
+  }
+
+  programmingInFlight_ = true;
+  waitForAgent(
+      std::move(futures), [this, routeDb](folly::exception_wrapper&& ew) {
+        if (ew) {
+          tData_.addStatValue("fib.thrift.failure.warm_boot", 1, fbzmq::COUNT);
+          resetFibClient();
+          dirtyRouteDb_ = true;
+          LOG(ERROR) << "Failed to read routes of FibAgent, falling back to "
+                     << "full sync. Error: " << ew.what();
+        } else {
+          LOG(INFO) << "Read " << routeDb->unicastRoutes.size()
+                    << " unicast and " << routeDb->mplsRoutes.size()
+                    << " mpls routes of FibAgent for warm boot";
+          agentRouteDb_ = toAgentRouteDb(
+              myNodeName_, routeDb->unicastRoutes, routeDb->mplsRoutes);
+        }
+        processProgrammingDone();
+      });
+}
+
+void
+Fib::syncRouteDbWithAgentRoutes() {
+  auto routeDb = toAgentRouteDb(
+      myNodeName_,
+      routeTable_.getUnicastRoutesToProgram(),
+      enableSegmentRouting_ ? routeTable_.getMplsRoutesToProgram()
+                            : std::vector<thrift::MplsRoute>{});
+  auto routeDbDelta = findDeltaRoutes(routeDb, *agentRouteDb_);
+  agentRouteDb_ = folly::none;
+
+  // Program routes as in routeTable_, with all attributes of next-hops
+  for (auto& route : routeDbDelta.unicastRoutesToUpdate) {
+    route = routeTable_.getUnicastRouteToProgram(route.dest).value();
+  }
+  for (auto& route : routeDbDelta.mplsRoutesToUpdate) {
+    route = routeTable_.getMplsRouteToProgram(route.topLabel).value();
+  }
+
+  const auto numRoutes = routeDbDelta.unicastRoutesToUpdate.size() +
+      routeDbDelta.unicastRoutesToDelete.size() +
+      routeDbDelta.mplsRoutesToUpdate.size() +
+      routeDbDelta.mplsRoutesToDelete.size();
+  LOG(INFO) << "Warm boot, programming " << numRoutes << " of "
+            << routeDb.unicastRoutes.size() + routeDb.mplsRoutes.size()
+            << " routes changed since routes of FibAgent were read";
+  tData_.addStatValue(
+      "fib.warm_boot.routes_programmed", numRoutes, fbzmq::SUM);
+
+  // Routes of agent are known, previous failures don't matter anymore
+  dirtyRouteDb_ = false;
+  expBackoff_.reportSuccess();
+  updateRoutes(routeDbDelta);
+  // Agent kept forwarding with its routes, only changed ones are in flight
+  reportRouteDbSynced();
+}
+
+void
+Fib::processSyncRouteDbFailure(const folly::exception_wrapper& ew) {
+  tData_.addStatValue("fib.thrift.failure.sync_fib", 1, fbzmq::COUNT);
+  LOG(ERROR) << "Failed to sync routeDb with switch FIB agent. Error: "
+             << ew.what();
+  dirtyRouteDb_ = true;
+  resetFibClient();
+
+  // Apply exponential backoff and schedule next run
+  expBackoff_.reportError();
+  if (not syncRoutesTimer_->isScheduled()) {
+    syncRoutesTimer_->scheduleTimeout(expBackoff_.getTimeRemainingUntilRetry());
+  }
+}
+
+void
+Fib::waitForAgent(
+    std::vector<folly::Future<folly::Unit>>&& futures,
+    folly::Function<void(folly::exception_wrapper&&)> callback) {
+  ++numAgentCallsInFlight_;
+  if (not agentPollTimer_->isScheduled()) {
+    agentPollTimer_->scheduleTimeout(
+        Constants::kPlatformPollInterval, true /* schedule periodically */);
+  }
+
+  folly::collectAll(futures).thenValue(
+      [this, callback = std::move(callback)](
+          std::vector<folly::Try<folly::Unit>>&& results) mutable {
+        --numAgentCallsInFlight_;
+        // Calls failed from destructor, nothing to handle
+        if (not isRunning()) {
+          return;
+        }
+        folly::exception_wrapper ew;
+        for (auto& result : results) {
+          if (result.hasException()) {
+            ew = std::move(result.exception());
+            break;
+          }
+        }
+        callback(std::move(ew));
+      });
+}
+
+void
+Fib::resetFibClient() {
+  if (not client_ and not mplsClient_) {
+    return;
+  }
+  // Keep clients and sockets alive till next loop iteration, in-flight calls
+  // get failed when they get destroyed
+  std::shared_ptr<thrift::FibServiceAsyncClient> client = std::move(client_);
+  auto socket = std::move(socket_);
+  std::shared_ptr<thrift::FibServiceAsyncClient> mplsClient =
+      std::move(mplsClient_);
+  auto mplsSocket = std::move(mplsSocket_);
+  runInEventLoop([client, socket, mplsClient, mplsSocket]() noexcept {});
+}
+
+void
+Fib::createFibClients() {
+  createFibClient(evb_, socket_, client_, thriftPort_);
+  if (enableSegmentRouting_) {
+    createFibClient(evb_, mplsSocket_, mplsClient_, thriftPort_);
   }
 }
 
@@ -602,18 +1232,41 @@ Fib::syncRouteDbDebounced() {
 
 void
 Fib::keepAliveCheck() {
-  createFibClient(evb_, socket_, client_, thriftPort_);
-  int64_t aliveSince = client_->sync_aliveSince();
-  // Check if FIB has restarted or not
-  if (aliveSince != latestAliveSince_) {
-    LOG(WARNING) << "FibAgent seems to have restarted. "
-                 << "Performing full route DB sync ...";
-    // set dirty flag
-    dirtyRouteDb_ = true;
-    expBackoff_.reportSuccess();
-    syncRouteDbDebounced();
+  // Previous check is still waiting for response
+  if (keepAliveInFlight_) {
+    return;
   }
-  latestAliveSince_ = aliveSince;
+
+  createFibClient(evb_, socket_, client_, thriftPort_);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.emplace_back(
+      client_->future_aliveSince().thenValue([this](int64_t aliveSince) {
+        // Check if FIB has restarted or not
+        if (aliveSince != latestAliveSince_) {
+          LOG(WARNING) << "FibAgent seems to have restarted. "
+                       << "Performing full route DB sync ...";
+          // Routes read on warm boot are gone with restart of agent
+          if (latestAliveSince_ != 0) {
+            agentRouteDb_ = folly::none;
+          }
+          // set dirty flag
+          dirtyRouteDb_ = true;
+          expBackoff_.reportSuccess();
+          syncRouteDbDebounced();
+        }
+        latestAliveSince_ = aliveSince;
+      }));
+
+  keepAliveInFlight_ = true;
+  waitForAgent(std::move(futures), [this](folly::exception_wrapper&& ew) {
+    keepAliveInFlight_ = false;
+    if (ew) {
+      tData_.addStatValue("fib.thrift.failure.keepalive", 1, fbzmq::COUNT);
+      resetFibClient();
+      LOG(ERROR) << "Failed to make thrift call to Switch Agent. Error: "
+                 << ew.what();
+    }
+  });
 }
 
 void
@@ -660,9 +1313,20 @@ Fib::submitCounters() {
   auto counters = tData_.getCounters();
 
   // Add some more flat counters
-  counters["fib.num_routes"] = routeDb_.unicastRoutes.size();
+  counters["fib.num_routes"] = routeTable_.getNumUnicastRoutes();
+  counters["fib.num_mpls_routes"] = routeTable_.getNumMplsRoutes();
+  counters["fib.num_nexthop_groups"] = routeTable_.getNumNextHopGroups();
   counters["fib.require_routedb_sync"] = syncRoutesTimer_->isScheduled();
+  counters["fib.num_pending_routes"] =
+      pendingRoutesToUpdate_.unicastRoutes.size() +
+      pendingRoutesToUpdate_.mplsRoutes.size() +
+      pendingUnicastRoutesToDelete_.size() + pendingMplsRoutesToDelete_.size();
   counters["fib.zmq_event_queue_size"] = getEventQueueSize();
+  for (auto const& kv : latencyHistograms_) {
+    kv.second.exportCounters(kv.first, counters);
+  }
+  exportProfileCounters(counters);
+  exportEventLogs(*zmqMonitorClient_);
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
@@ -723,6 +1387,9 @@ Fib::logPerfEvents() {
   while (perfDb_.size() >= Constants::kPerfBufferSize) {
     perfDb_.pop_front();
   }
+  if (perfEventsCallback_) {
+    perfEventsCallback_(perfDb_.back());
+  }
 
   // Log event
   auto eventStrs = sprintPerfEvents(*maybePerfEvents_);
@@ -737,16 +1404,65 @@ Fib::logPerfEvents() {
   tData_.addStatValue(
       "fib.convergence_time_ms", totalDuration.count(), fbzmq::AVG);
 
+  // Export convergence duration of critical routes if they were programmed
+  // ahead of other routes
+  auto criticalDuration = getDurationBetweenPerfEvents(
+      perfDb_.back(),
+      perfDb_.back().events.front().eventDescr,
+      "FIB_CRITICAL_ROUTES_PROGRAMMED");
+  if (criticalDuration.hasValue()) {
+    tData_.addStatValue(
+        "fib.critical_convergence_time_ms",
+        criticalDuration->count(),
+        fbzmq::AVG);
+  }
+  recordPerfEventLatencies(perfDb_.back());
+
   // Log via zmq monitor
-  fbzmq::LogSample sample{};
-  sample.addString("event", "ROUTE_CONVERGENCE");
-  sample.addString("node_name", myNodeName_);
-  sample.addStringVector("perf_events", eventStrs);
-  sample.addInt("duration_ms", totalDuration.count());
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogEntry entry("ROUTE_CONVERGENCE", myNodeName_);
+  entry.addStringVector("perf_events", std::move(eventStrs))
+      .addInt("duration_ms", totalDuration.count());
+  logEvent(std::move(entry));
+}
+
+void
+Fib::recordPerfEventLatencies(const thrift::PerfEvents& perfEvents) {
+  auto const& events = perfEvents.events;
+
+  // From last event of Decision (or of previous node) to receipt in Fib
+  auto recvIt = std::find_if(
+      events.begin(), events.end(), [](const thrift::PerfEvent& event) {
+        return event.eventDescr == "FIB_ROUTE_DB_RECVD";
+      });
+  if (recvIt != events.begin() and recvIt != events.end() and
+      recvIt->unixTs >= std::prev(recvIt)->unixTs) {
+    latencyHistograms_["fib.latency.decision_to_fib_ms"].addValue(
+        std::chrono::milliseconds(recvIt->unixTs - std::prev(recvIt)->unixTs));
+  }
+
+  auto debounceDuration = getDurationBetweenPerfEvents(
+      perfEvents, "FIB_ROUTE_DB_RECVD", "FIB_DEBOUNCE");
+  if (debounceDuration.hasValue()) {
+    latencyHistograms_["fib.latency.debounce_ms"].addValue(*debounceDuration);
+  }
+
+  auto programDuration = getDurationBetweenPerfEvents(
+      perfEvents, "FIB_DEBOUNCE", "OPENR_FIB_ROUTES_PROGRAMMED");
+  if (programDuration.hasValue()) {
+    latencyHistograms_["fib.latency.programming_ms"].addValue(
+        *programDuration);
+  }
+
+  latencyHistograms_["fib.latency.convergence_ms"].addValue(
+      getTotalPerfEventsDuration(perfEvents));
+}
+
+void
+Fib::recordLatency(
+    const std::string& name, std::chrono::steady_clock::time_point startTime) {
+  latencyHistograms_[name].addValue(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime));
 }
 
 } // namespace openr
@@ -13,13 +13,21 @@
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Function.h>
+#include <folly/IPAddress.h>
+#include <folly/Unit.h>
+#include <folly/futures/Future.h>
 #include <folly/io/async/EventBase.h>
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/BusSerializer.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/OpenrEventLoop.h>
+#include <openr/common/PrefixTrie.h>
 #include <openr/common/Util.h>
+#include <openr/fib/FibRouteTable.h>
 #include <openr/if/gen-cpp2/FibService.h>
 #include <openr/if/gen-cpp2/Fib_types.h>
 #include <openr/if/gen-cpp2/LinkMonitor_types.h>
@@ -47,6 +55,18 @@ namespace openr {
  * we program all of them which simulates ECMP behaviours across programmed
  * nexthops.
  *
+ * Thrift calls to switch agent are asynchronous and never block the event
+ * loop. While a programming call is in flight, route updates are merged into
+ * one pending delta which is programmed once the call completes.
+ *
+ * Critical routes (default, host e.g. loopbacks, and configured critical
+ * prefixes) are programmed before all other routes of an update, so they
+ * reach hardware first after a failure or restart of agent.
+ *
+ * On warm boot, routes left in agent by previous instance are read at startup
+ * and kept in place. First sync only programs their difference to routes
+ * received from Decision, so unchanged routes are never withdrawn.
+ *
  */
 class Fib final : public OpenrEventLoop {
  public:
@@ -64,7 +84,15 @@ class Fib final : public OpenrEventLoop {
       const MonitorSubmitUrl& monitorSubmitUrl,
       const KvStoreLocalCmdUrl& storeCmdUrl,
       const KvStoreLocalPubUrl& storePubUrl,
-      fbzmq::Context& zmqContext);
+      fbzmq::Context& zmqContext,
+      size_t syncFibChunkSize = 0,
+      std::vector<folly::CIDRNetwork> criticalPrefixes = {},
+      // protocol of route deltas received from Decision, must match its own
+      BusSerializer::Protocol routeDeltaProtocol =
+          BusSerializer::Protocol::COMPACT,
+      bool enableWarmBoot = false);
+
+  ~Fib() override;
 
   /**
    * Utility function to create thrift client connection to SwitchAgent. Can
@@ -77,6 +105,40 @@ class Fib final : public OpenrEventLoop {
       std::unique_ptr<thrift::FibServiceAsyncClient>& client,
       int32_t port);
 
+  /**
+   * Typed in-process access for ctrl-server. Served in Fib's event loop and
+   * handed over without serialization.
+   */
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>> getRouteDb();
+  folly::SemiFuture<std::unique_ptr<thrift::RouteDatabase>>
+  getRouteDbUnInstallable();
+  folly::SemiFuture<std::unique_ptr<thrift::PerfDatabase>> getPerfDb();
+  // Longest matching route of address, fails if there is none
+  folly::SemiFuture<std::unique_ptr<thrift::UnicastRoute>> getRouteForAddress(
+      thrift::BinaryAddress address);
+
+  /**
+   * Set callback invoked in Fib's event loop with every change of the route
+   * database returned by getRouteDb(). Changes applied after the callback is
+   * set and before a later getRouteDb() request is served are part of both.
+   * Unset with nullptr.
+   */
+  void setRouteDbDeltaCallback(
+      std::function<void(thrift::RouteDatabaseDelta const&)> callback);
+
+  /**
+   * Set callback invoked in Fib's event loop with every convergence timeline
+   * added to the database returned by getPerfDb(). Unset with nullptr.
+   */
+  void setPerfEventsCallback(
+      std::function<void(thrift::PerfEvents const&)> callback);
+
+  /**
+   * Set callback invoked once in Fib's event loop when routes are first synced
+   * with FibAgent, right away if they are synced already
+   */
+  void setRouteDbSyncedCallback(std::function<void()> callback);
+
  private:
   // No-copy
   Fib(const Fib&) = delete;
@@ -110,18 +172,96 @@ class Fib final : public OpenrEventLoop {
   thrift::PerfDatabase dumpPerfDb() const;
 
   /**
-   * Trigger add/del routes thrift calls
-   * on success no action needed
+   * Current route database and database of routes which are not installed
+   */
+  thrift::RouteDatabase dumpRouteDb() const;
+  thrift::RouteDatabase dumpUnInstallableRouteDb() const;
+
+  /**
+   * Trigger add/del routes thrift calls, pipelined on agent connection. If
+   * a call is already in flight then delta is merged into pending delta
+   * on success programs pending delta if any
    * on failure invokes syncRouteDbDebounced
    */
   void updateRoutes(const thrift::RouteDatabaseDelta& routeDbDelta);
 
   /**
-   * Sync the current routeDb_ with the switch agent.
-   * on success no action needed
-   * on failure invokes syncRouteDbDebounced
+   * Merge routeDbDelta into pending delta. Later update of a prefix or label
+   * overrides earlier delete and vice versa
+   */
+  void mergePendingDelta(const thrift::RouteDatabaseDelta& routeDbDelta);
+
+  /**
+   * Issue pipelined add/del routes thrift calls. Unicast routes are programmed
+   * over client_ and MPLS routes concurrently over mplsClient_. MPLS deletes
+   * are issued once unicast routes are updated, as these may have used the
+   * labels. Returned future completes once all responses are received, with
+   * first error if any
+   */
+  folly::Future<folly::Unit> programRoutes(
+      const std::vector<thrift::IpPrefix>& unicastRoutesToDelete,
+      const std::vector<thrift::UnicastRoute>& unicastRoutesToUpdate,
+      const std::vector<int32_t>& mplsRoutesToDelete,
+      const std::vector<thrift::MplsRoute>& mplsRoutesToUpdate);
+
+  // Default, host and routes within criticalPrefixes_ are programmed first
+  bool isCriticalRoute(const thrift::IpPrefix& prefix) const;
+
+  /**
+   * Sync the current routeTable_ with the switch agent.
+   * on success programs pending delta if any
+   * on failure schedules syncRoutesTimer_ with exponential backoff
+   */
+  void syncRouteDb();
+
+  /**
+   * Sync routeTable_ in chunks of syncFibChunkSize_ routes with chunked sync
+   * APIs of agent. Chunks are built from latest routeTable_ when sent, one at
+   * a time, routes deleted meanwhile are skipped and deleted on commit
    */
-  bool syncRouteDb();
+  folly::Future<folly::Unit> syncRouteDbChunked();
+
+  folly::Future<folly::Unit> sendSyncFibChunks(
+      int64_t syncId,
+      std::shared_ptr<std::vector<thrift::IpPrefix>> prefixes,
+      std::shared_ptr<std::vector<int32_t>> labels,
+      size_t offset);
+
+  /**
+   * Read routes of agent into agentRouteDb_ on warm boot. Programming is
+   * deferred while reading, full sync is enforced if it fails
+   */
+  void readAgentRouteDb();
+
+  /**
+   * Program difference of routeTable_ to agentRouteDb_ instead of full sync,
+   * once. Regular full sync takes over on failure
+   */
+  void syncRouteDbWithAgentRoutes();
+
+  // Handle failure of syncRouteDb
+  void processSyncRouteDbFailure(const folly::exception_wrapper& ew);
+
+  /**
+   * Invoke callback once all responses of thrift calls to agent are received,
+   * with first error if any. evb_ is polled by agentPollTimer_ meanwhile
+   */
+  void waitForAgent(
+      std::vector<folly::Future<folly::Unit>>&& futures,
+      folly::Function<void(folly::exception_wrapper&&)> callback);
+
+  /**
+   * Completion of route programming call. Programs pending delta or
+   * enforces full sync if requested while call was in flight
+   */
+  void processProgrammingDone();
+
+  // Reset agent clients. Destruction is deferred as we may be in their
+  // callbacks
+  void resetFibClient();
+
+  // Create client_, and mplsClient_ with segment routing, if not connected
+  void createFibClients();
 
   /**
    * Asynchrounsly schedules the syncRouteDb call and returns immediately. All
@@ -141,24 +281,59 @@ class Fib final : public OpenrEventLoop {
   // log perf events
   void logPerfEvents();
 
+  // Record latencies between Fib perf events of a convergence
+  void recordPerfEventLatencies(const thrift::PerfEvents& perfEvents);
+
+  // Record latency of phase started at startTime, e.g. a thrift call
+  void recordLatency(
+      const std::string& name, std::chrono::steady_clock::time_point startTime);
+
+  // Invoke routeDbDeltaCallback_ with change of route database applied by
+  // routeDelta. Routes which are not installed are reported as deleted
+  void publishRouteDbDelta(thrift::RouteDatabaseDelta const& routeDelta);
+
+  // Invoke routeDbSyncedCallback_ once routes are synced with FibAgent
+  void reportRouteDbSynced();
+
   // Prefix to available nexthop information. Also store perf information of
   // received route-db if provided.
   folly::Optional<thrift::PerfEvents> maybePerfEvents_;
-  RouteDatabaseMap routeDb_;
+  FibRouteTable routeTable_;
   // Route DB containing only dry run or not installed routes
   RouteDatabaseMap doNotInstallRouteDb_;
   std::deque<thrift::PerfEvents> perfDb_;
 
+  // Latencies of route programming phases since startup, by counter name
+  std::unordered_map<std::string, LatencyHistogram> latencyHistograms_;
+
   // indicates we've received a decision route publication and therefore have
   // routes to sync. will not synce routes with system until this is set
   bool hasRoutesFromDecision_{false};
 
   // Flag to indicate the result of previous route programming attempt.
-  // If set, it means what currently cached in local routeDb_ has not been 100%
-  // successfully synced with agent, we have to trigger an enforced full fib
-  // sync with agent again
+  // If set, it means what currently cached in local routeTable_ has not been
+  // 100% successfully synced with agent, we have to trigger an enforced full
+  // fib sync with agent again
   bool dirtyRouteDb_{false};
 
+  // Route programming call (delta or full sync) in flight to agent. Full
+  // sync requested meanwhile is deferred until it completes
+  bool programmingInFlight_{false};
+  bool pendingFullSync_{false};
+
+  // Routes of agent read on warm boot, with next-hops as reported by agent.
+  // Reset once first sync is done or agent restarts
+  folly::Optional<thrift::RouteDatabase> agentRouteDb_;
+
+  // Merged route updates received while programming call is in flight
+  RouteDatabaseMap pendingRoutesToUpdate_;
+  std::unordered_set<thrift::IpPrefix> pendingUnicastRoutesToDelete_;
+  std::unordered_set<int32_t> pendingMplsRoutesToDelete_;
+
+  // Number of waitForAgent calls pending and keep-alive call in flight
+  size_t numAgentCallsInFlight_{0};
+  bool keepAliveInFlight_{false};
+
   // Create timestamp of recently logged perf event
   int64_t recentPerfEventCreateTs_{0};
 
@@ -184,6 +359,12 @@ class Fib final : public OpenrEventLoop {
   // indicates that we should publish fib programming time to kvstore
   bool enableOrderedFib_{false};
 
+  // Number of routes per chunk of full sync, chunked sync is used if non zero
+  const size_t syncFibChunkSize_{0};
+
+  // Routes within these prefixes are programmed before other routes
+  PrefixTrie<folly::Unit> criticalPrefixes_;
+
   // amount of time to wait before send routes to agent either when this module
   // starts or the agent we are talking with restarts
   const std::chrono::seconds coldStartDuration_;
@@ -196,14 +377,36 @@ class Fib final : public OpenrEventLoop {
   const std::string decisionPubUrl_;
   const std::string linkMonPubUrl_;
 
+  // Subscriber of route database changes, e.g. ctrl-server route streams
+  std::function<void(thrift::RouteDatabaseDelta const&)>
+      routeDbDeltaCallback_{nullptr};
+
+  // Subscriber of completed convergence timelines, e.g. ctrl-server streams
+  std::function<void(thrift::PerfEvents const&)> perfEventsCallback_{nullptr};
+
+  // Subscriber of first route sync, e.g. startup tracer in main
+  std::function<void()> routeDbSyncedCallback_{nullptr};
+  bool routeDbSynced_{false};
+
   apache::thrift::CompactSerializer serializer_;
 
+  // serializer of route deltas received on decisionSub_
+  BusSerializer routeDeltaSerializer_;
+
   // Thrift client connection to switch FIB Agent using which we actually
   // manipulate routes.
   folly::EventBase evb_;
   std::shared_ptr<apache::thrift::async::TAsyncSocket> socket_{nullptr};
   std::unique_ptr<thrift::FibServiceAsyncClient> client_{nullptr};
 
+  // Separate connection for MPLS routes, so that agent programs them
+  // concurrently with unicast routes
+  std::shared_ptr<apache::thrift::async::TAsyncSocket> mplsSocket_{nullptr};
+  std::unique_ptr<thrift::FibServiceAsyncClient> mplsClient_{nullptr};
+
+  // Periodically loops evb_ while thrift calls are in flight
+  std::unique_ptr<fbzmq::ZmqTimeout> agentPollTimer_{nullptr};
+
   // Callback timer to sync routes to switch agent and scheduled on route-sync
   // failure. ExponentialBackoff timer to ease up things if they go wrong
   std::unique_ptr<fbzmq::ZmqTimeout> syncRoutesTimer_{nullptr};
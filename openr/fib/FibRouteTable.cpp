@@ -0,0 +1,398 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "FibRouteTable.h"
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include <openr/common/Util.h>
+
+namespace openr {
+
+FibRouteTable::NextHopGroups::iterator
+FibRouteTable::acquireGroup(
+    NextHopGroups& groups,
+    GroupsOfInterface& groupsOfInterface,
+    std::vector<thrift::NextHopThrift> nextHops,
+    bool isMpls) {
+  auto it = groups.find(nextHops);
+  if (it == groups.end()) {
+    NextHopGroup group;
+    group.bestNextHops = isMpls ? getBestNextHopsMpls(nextHops)
+                                : getBestNextHopsUnicast(nextHops);
+    std::sort(group.bestNextHops.begin(), group.bestNextHops.end());
+    if (not isMpls) {
+      group.deprecatedNexthops = createDeprecatedNexthops(group.bestNextHops);
+    }
+    it = groups.emplace(std::move(nextHops), std::move(group)).first;
+    // We don't have ifName for `POP_AND_LOOKUP` mpls action
+    for (const auto& nextHop : it->first) {
+      if (nextHop.address.ifName.hasValue()) {
+        groupsOfInterface[nextHop.address.ifName.value()].emplace(&it->first);
+      }
+    }
+  }
+  return it;
+}
+
+void
+FibRouteTable::releaseGroup(
+    NextHopGroups& groups,
+    GroupsOfInterface& groupsOfInterface,
+    NextHopGroups::iterator it) {
+  if (not it->second.prefixes.empty() or not it->second.topLabels.empty()) {
+    return;
+  }
+  for (const auto& nextHop : it->first) {
+    if (not nextHop.address.ifName.hasValue()) {
+      continue;
+    }
+    auto indexIt = groupsOfInterface.find(nextHop.address.ifName.value());
+    if (indexIt == groupsOfInterface.end()) {
+      continue;
+    }
+    indexIt->second.erase(&it->first);
+    if (indexIt->second.empty()) {
+      groupsOfInterface.erase(indexIt);
+    }
+  }
+  groups.erase(it);
+}
+
+std::vector<FibRouteTable::NextHopGroups::iterator>
+FibRouteTable::getGroupsOfInterfaces(
+    NextHopGroups& groups,
+    const GroupsOfInterface& groupsOfInterface,
+    const std::unordered_set<std::string>& ifNames) {
+  std::unordered_set<const std::vector<thrift::NextHopThrift>*> seen;
+  std::vector<NextHopGroups::iterator> affectedGroups;
+  for (const auto& ifName : ifNames) {
+    auto indexIt = groupsOfInterface.find(ifName);
+    if (indexIt == groupsOfInterface.end()) {
+      continue;
+    }
+    for (const auto* nextHops : indexIt->second) {
+      if (seen.emplace(nextHops).second) {
+        affectedGroups.emplace_back(groups.find(*nextHops));
+      }
+    }
+  }
+  return affectedGroups;
+}
+
+bool
+FibRouteTable::updateUnicastRoute(thrift::UnicastRoute route) {
+  auto nextHops = std::move(route.nextHops);
+  route.nextHops.clear();
+  route.deprecatedNexthops.clear();
+  std::sort(nextHops.begin(), nextHops.end());
+
+  auto it = unicastRoutes_.find(route.dest);
+  if (it == unicastRoutes_.end()) {
+    auto group = acquireGroup(
+        unicastGroups_, unicastGroupsOfInterface_, std::move(nextHops), false);
+    group->second.prefixes.emplace(route.dest);
+    unicastPrefixes_.insert(toIPNetwork(route.dest), route.dest);
+    auto dest = route.dest;
+    unicastRoutes_.emplace(
+        std::move(dest), UnicastEntry{std::move(route), group});
+    return true;
+  }
+
+  auto& entry = it->second;
+  if (entry.group->first == nextHops and entry.route == route) {
+    return false;
+  }
+  // Move route to new group, old one is kept if it is the same
+  auto group = acquireGroup(
+      unicastGroups_, unicastGroupsOfInterface_, std::move(nextHops), false);
+  if (group != entry.group) {
+    group->second.prefixes.emplace(route.dest);
+    entry.group->second.prefixes.erase(route.dest);
+    releaseGroup(unicastGroups_, unicastGroupsOfInterface_, entry.group);
+  }
+  entry.route = std::move(route);
+  entry.group = group;
+  return true;
+}
+
+bool
+FibRouteTable::updateMplsRoute(thrift::MplsRoute route) {
+  auto nextHops = std::move(route.nextHops);
+  route.nextHops.clear();
+  std::sort(nextHops.begin(), nextHops.end());
+
+  auto it = mplsRoutes_.find(route.topLabel);
+  if (it == mplsRoutes_.end()) {
+    auto group = acquireGroup(
+        mplsGroups_, mplsGroupsOfInterface_, std::move(nextHops), true);
+    const auto topLabel = route.topLabel;
+    group->second.topLabels.emplace(topLabel);
+    mplsRoutes_.emplace(topLabel, MplsEntry{std::move(route), group});
+    return true;
+  }
+
+  auto& entry = it->second;
+  if (entry.group->first == nextHops and entry.route == route) {
+    return false;
+  }
+  auto group = acquireGroup(
+      mplsGroups_, mplsGroupsOfInterface_, std::move(nextHops), true);
+  if (group != entry.group) {
+    group->second.topLabels.emplace(route.topLabel);
+    entry.group->second.topLabels.erase(route.topLabel);
+    releaseGroup(mplsGroups_, mplsGroupsOfInterface_, entry.group);
+  }
+  entry.route = std::move(route);
+  entry.group = group;
+  return true;
+}
+
+bool
+FibRouteTable::deleteUnicastRoute(const thrift::IpPrefix& prefix) {
+  auto it = unicastRoutes_.find(prefix);
+  if (it == unicastRoutes_.end()) {
+    return false;
+  }
+  auto group = it->second.group;
+  group->second.prefixes.erase(prefix);
+  unicastPrefixes_.erase(toIPNetwork(prefix));
+  unicastRoutes_.erase(it);
+  releaseGroup(unicastGroups_, unicastGroupsOfInterface_, group);
+  return true;
+}
+
+bool
+FibRouteTable::deleteMplsRoute(int32_t topLabel) {
+  auto it = mplsRoutes_.find(topLabel);
+  if (it == mplsRoutes_.end()) {
+    return false;
+  }
+  auto group = it->second.group;
+  group->second.topLabels.erase(topLabel);
+  mplsRoutes_.erase(it);
+  releaseGroup(mplsGroups_, mplsGroupsOfInterface_, group);
+  return true;
+}
+
+void
+FibRouteTable::removeNextHopsOnInterfaces(
+    const std::unordered_set<std::string>& ifNames,
+    thrift::RouteDatabaseDelta& delta) {
+  if (ifNames.empty()) {
+    return;
+  }
+
+  // All routes of an affected group move to the same group of valid
+  // next-hops. Groups created here never contain removed next-hops, so none
+  // of them is affected
+  const auto unicastGroups = getGroupsOfInterfaces(
+      unicastGroups_, unicastGroupsOfInterface_, ifNames);
+  for (auto oldGroup : unicastGroups) {
+    std::vector<thrift::NextHopThrift> validNextHops;
+    for (const auto& nextHop : oldGroup->first) {
+      CHECK(nextHop.address.ifName.hasValue());
+      if (ifNames.count(nextHop.address.ifName.value()) == 0) {
+        validNextHops.emplace_back(nextHop);
+      }
+    }
+    auto prefixes = std::move(oldGroup->second.prefixes);
+    oldGroup->second.prefixes.clear();
+
+    // Remove routes if no valid paths
+    if (validNextHops.empty()) {
+      for (const auto& prefix : prefixes) {
+        VLOG(1) << "Removing prefix " << toString(prefix)
+                << " because of no valid nextHops.";
+        delta.unicastRoutesToDelete.emplace_back(prefix);
+        unicastRoutes_.erase(prefix);
+        unicastPrefixes_.erase(toIPNetwork(prefix));
+      }
+      releaseGroup(unicastGroups_, unicastGroupsOfInterface_, oldGroup);
+      continue;
+    }
+
+    // Add to affected routes only if best path has changed
+    auto group = acquireGroup(
+        unicastGroups_,
+        unicastGroupsOfInterface_,
+        std::move(validNextHops),
+        false);
+    const bool bestChanged =
+        group->second.bestNextHops != oldGroup->second.bestNextHops;
+    for (const auto& prefix : prefixes) {
+      if (bestChanged) {
+        VLOG(1) << "bestPaths group resize for prefix: " << toString(prefix)
+                << ", old: " << oldGroup->second.bestNextHops.size()
+                << ", new: " << group->second.bestNextHops.size();
+        thrift::UnicastRoute route;
+        route.dest = prefix;
+        route.nextHops = group->second.bestNextHops;
+        delta.unicastRoutesToUpdate.emplace_back(std::move(route));
+      }
+      unicastRoutes_.at(prefix).group = group;
+      group->second.prefixes.emplace(prefix);
+    }
+    releaseGroup(unicastGroups_, unicastGroupsOfInterface_, oldGroup);
+  }
+
+  const auto mplsGroups =
+      getGroupsOfInterfaces(mplsGroups_, mplsGroupsOfInterface_, ifNames);
+  for (auto oldGroup : mplsGroups) {
+    std::vector<thrift::NextHopThrift> validNextHops;
+    for (const auto& nextHop : oldGroup->first) {
+      // We don't have ifName for `POP_AND_LOOKUP` mpls action
+      if (not nextHop.address.ifName.hasValue() or
+          ifNames.count(nextHop.address.ifName.value()) == 0) {
+        validNextHops.emplace_back(nextHop);
+      }
+    }
+    auto topLabels = std::move(oldGroup->second.topLabels);
+    oldGroup->second.topLabels.clear();
+
+    if (validNextHops.empty()) {
+      for (const auto topLabel : topLabels) {
+        VLOG(1) << "Removing label " << topLabel
+                << " because of no valid nextHops.";
+        delta.mplsRoutesToDelete.emplace_back(topLabel);
+        mplsRoutes_.erase(topLabel);
+      }
+      releaseGroup(mplsGroups_, mplsGroupsOfInterface_, oldGroup);
+      continue;
+    }
+
+    auto group = acquireGroup(
+        mplsGroups_, mplsGroupsOfInterface_, std::move(validNextHops), true);
+    const bool bestChanged =
+        group->second.bestNextHops != oldGroup->second.bestNextHops;
+    for (const auto topLabel : topLabels) {
+      if (bestChanged) {
+        VLOG(1) << "bestPaths group resize for label: " << topLabel
+                << ", old: " << oldGroup->second.bestNextHops.size()
+                << ", new: " << group->second.bestNextHops.size();
+        thrift::MplsRoute route;
+        route.topLabel = topLabel;
+        route.nextHops = group->second.bestNextHops;
+        delta.mplsRoutesToUpdate.emplace_back(std::move(route));
+      }
+      mplsRoutes_.at(topLabel).group = group;
+      group->second.topLabels.emplace(topLabel);
+    }
+    releaseGroup(mplsGroups_, mplsGroupsOfInterface_, oldGroup);
+  }
+}
+
+std::vector<thrift::UnicastRoute>
+FibRouteTable::getUnicastRoutes() const {
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(unicastRoutes_.size());
+  for (const auto& kv : unicastRoutes_) {
+    routes.emplace_back(kv.second.route);
+    routes.back().nextHops = kv.second.group->first;
+  }
+  return routes;
+}
+
+std::vector<thrift::MplsRoute>
+FibRouteTable::getMplsRoutes() const {
+  std::vector<thrift::MplsRoute> routes;
+  routes.reserve(mplsRoutes_.size());
+  for (const auto& kv : mplsRoutes_) {
+    routes.emplace_back(kv.second.route);
+    routes.back().nextHops = kv.second.group->first;
+  }
+  return routes;
+}
+
+std::vector<thrift::UnicastRoute>
+FibRouteTable::getUnicastRoutesToProgram() const {
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(unicastRoutes_.size());
+  for (const auto& kv : unicastRoutes_) {
+    thrift::UnicastRoute route;
+    route.dest = kv.first;
+    route.nextHops = kv.second.group->second.bestNextHops;
+    route.deprecatedNexthops = kv.second.group->second.deprecatedNexthops;
+    routes.emplace_back(std::move(route));
+  }
+  return routes;
+}
+
+std::vector<thrift::MplsRoute>
+FibRouteTable::getMplsRoutesToProgram() const {
+  std::vector<thrift::MplsRoute> routes;
+  routes.reserve(mplsRoutes_.size());
+  for (const auto& kv : mplsRoutes_) {
+    thrift::MplsRoute route;
+    route.topLabel = kv.first;
+    route.nextHops = kv.second.group->second.bestNextHops;
+    routes.emplace_back(std::move(route));
+  }
+  return routes;
+}
+
+folly::Optional<thrift::UnicastRoute>
+FibRouteTable::getUnicastRouteToProgram(const thrift::IpPrefix& prefix) const {
+  auto it = unicastRoutes_.find(prefix);
+  if (it == unicastRoutes_.end()) {
+    return folly::none;
+  }
+  thrift::UnicastRoute route;
+  route.dest = prefix;
+  route.nextHops = it->second.group->second.bestNextHops;
+  route.deprecatedNexthops = it->second.group->second.deprecatedNexthops;
+  return route;
+}
+
+folly::Optional<thrift::UnicastRoute>
+FibRouteTable::getUnicastRouteForAddress(
+    const folly::IPAddress& address) const {
+  const auto* match = unicastPrefixes_.longestMatch(address);
+  if (not match) {
+    return folly::none;
+  }
+  const auto& entry = unicastRoutes_.at(match->second);
+  auto route = entry.route;
+  route.nextHops = entry.group->first;
+  return route;
+}
+
+folly::Optional<thrift::MplsRoute>
+FibRouteTable::getMplsRouteToProgram(int32_t topLabel) const {
+  auto it = mplsRoutes_.find(topLabel);
+  if (it == mplsRoutes_.end()) {
+    return folly::none;
+  }
+  thrift::MplsRoute route;
+  route.topLabel = topLabel;
+  route.nextHops = it->second.group->second.bestNextHops;
+  return route;
+}
+
+std::vector<thrift::IpPrefix>
+FibRouteTable::getUnicastPrefixes() const {
+  std::vector<thrift::IpPrefix> prefixes;
+  prefixes.reserve(unicastRoutes_.size());
+  for (const auto& kv : unicastRoutes_) {
+    prefixes.emplace_back(kv.first);
+  }
+  return prefixes;
+}
+
+std::vector<int32_t>
+FibRouteTable::getMplsLabels() const {
+  std::vector<int32_t> labels;
+  labels.reserve(mplsRoutes_.size());
+  for (const auto& kv : mplsRoutes_) {
+    labels.emplace_back(kv.first);
+  }
+  return labels;
+}
+
+} // namespace openr
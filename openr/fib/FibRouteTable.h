@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <folly/Optional.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/PrefixTrie.h>
+#include <openr/if/gen-cpp2/Fib_types.h>
+#include <openr/if/gen-cpp2/Network_types.h>
+
+namespace openr {
+
+/**
+ * Route state of Fib. Routes refer to interned next-hop groups instead of
+ * holding their own next-hops, so routes with the same next-hops (e.g. all
+ * prefixes behind the same set of neighbors) share a single copy of them.
+ * Best next-hops to program are computed once per group, when the group is
+ * created, not per route on every sync. Deltas are applied in place.
+ *
+ * Unicast and MPLS routes have separate groups as their best next-hops are
+ * selected differently. Groups know their routes and are indexed by the
+ * interfaces of their next-hops, so that removing next-hops of an interface
+ * only touches routes over it.
+ */
+class FibRouteTable {
+ public:
+  struct NextHopGroup {
+    // Best next-hops to program, sorted
+    std::vector<thrift::NextHopThrift> bestNextHops;
+    // NOTE: remove after UnicastRoute.deprecatedNexthops is removed
+    std::vector<thrift::BinaryAddress> deprecatedNexthops;
+    // Routes referring to this group, by prefix or by top label
+    std::unordered_set<thrift::IpPrefix> prefixes;
+    std::unordered_set<int32_t> topLabels;
+  };
+
+  // Interned groups, keyed by their sorted next-hops including LFAs
+  using NextHopGroups =
+      std::map<std::vector<thrift::NextHopThrift>, NextHopGroup>;
+
+  FibRouteTable() = default;
+
+  // No-copy, routes hold iterators into groups
+  FibRouteTable(const FibRouteTable&) = delete;
+  FibRouteTable& operator=(const FibRouteTable&) = delete;
+
+  /**
+   * Add or replace route. Returns false if route was already present with
+   * the same next-hops and attributes
+   */
+  bool updateUnicastRoute(thrift::UnicastRoute route);
+  bool updateMplsRoute(thrift::MplsRoute route);
+
+  // Delete route. Returns false if there was no such route
+  bool deleteUnicastRoute(const thrift::IpPrefix& prefix);
+  bool deleteMplsRoute(int32_t topLabel);
+
+  /**
+   * Remove next-hops over given interfaces from routes over them, once per
+   * group.
+   * Routes whose best next-hops change are added with their new best
+   * next-hops to unicastRoutesToUpdate/mplsRoutesToUpdate of delta, routes
+   * left without next-hops are deleted and added to the *ToDelete lists
+   */
+  void removeNextHopsOnInterfaces(
+      const std::unordered_set<std::string>& ifNames,
+      thrift::RouteDatabaseDelta& delta);
+
+  // Routes with all their next-hops, as received from Decision
+  std::vector<thrift::UnicastRoute> getUnicastRoutes() const;
+  std::vector<thrift::MplsRoute> getMplsRoutes() const;
+
+  // Routes with their best next-hops, as they are programmed
+  std::vector<thrift::UnicastRoute> getUnicastRoutesToProgram() const;
+  std::vector<thrift::MplsRoute> getMplsRoutesToProgram() const;
+  folly::Optional<thrift::UnicastRoute> getUnicastRouteToProgram(
+      const thrift::IpPrefix& prefix) const;
+  folly::Optional<thrift::MplsRoute> getMplsRouteToProgram(
+      int32_t topLabel) const;
+
+  // Longest matching route of address with all its next-hops, if any
+  folly::Optional<thrift::UnicastRoute> getUnicastRouteForAddress(
+      const folly::IPAddress& address) const;
+
+  std::vector<thrift::IpPrefix> getUnicastPrefixes() const;
+  std::vector<int32_t> getMplsLabels() const;
+
+  size_t
+  getNumUnicastRoutes() const {
+    return unicastRoutes_.size();
+  }
+
+  size_t
+  getNumMplsRoutes() const {
+    return mplsRoutes_.size();
+  }
+
+  size_t
+  getNumNextHopGroups() const {
+    return unicastGroups_.size() + mplsGroups_.size();
+  }
+
+ private:
+  struct UnicastEntry {
+    // Attributes of route, with nextHops and deprecatedNexthops left empty
+    thrift::UnicastRoute route;
+    NextHopGroups::iterator group;
+  };
+
+  struct MplsEntry {
+    // Attributes of route, with nextHops left empty
+    thrift::MplsRoute route;
+    NextHopGroups::iterator group;
+  };
+
+  // Groups with a next-hop over each interface, keyed by next-hops of group
+  using GroupsOfInterface = std::unordered_map<
+      std::string,
+      std::unordered_set<const std::vector<thrift::NextHopThrift>*>>;
+
+  // Find group of next-hops, creating and indexing it if needed
+  static NextHopGroups::iterator acquireGroup(
+      NextHopGroups& groups,
+      GroupsOfInterface& groupsOfInterface,
+      std::vector<thrift::NextHopThrift> nextHops,
+      bool isMpls);
+
+  // Delete group and its index entries if no route refers to it anymore
+  static void releaseGroup(
+      NextHopGroups& groups,
+      GroupsOfInterface& groupsOfInterface,
+      NextHopGroups::iterator it);
+
+  // Affected groups of interfaces, each one once
+  static std::vector<NextHopGroups::iterator> getGroupsOfInterfaces(
+      NextHopGroups& groups,
+      const GroupsOfInterface& groupsOfInterface,
+      const std::unordered_set<std::string>& ifNames);
+
+  std::unordered_map<thrift::IpPrefix, UnicastEntry> unicastRoutes_;
+  std::unordered_map<int32_t, MplsEntry> mplsRoutes_;
+
+  // Prefixes of unicastRoutes_ for longest prefix match of addresses
+  PrefixTrie<thrift::IpPrefix> unicastPrefixes_;
+
+  NextHopGroups unicastGroups_;
+  NextHopGroups mplsGroups_;
+
+  GroupsOfInterface unicastGroupsOfInterface_;
+  GroupsOfInterface mplsGroupsOfInterface_;
+};
+
+} // namespace openr
@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/IPAddress.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/fib/FibRouteTable.h>
+
+using namespace openr;
+
+namespace {
+
+const auto prefix1 = toIpPrefix("::ffff:10.1.1.1/128");
+const auto prefix2 = toIpPrefix("::ffff:10.2.2.2/128");
+const auto prefix3 = toIpPrefix("::ffff:10.3.3.3/128");
+
+const auto path1 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::2")), "iface_1", 1);
+const auto path2 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::3")), "iface_2", 1);
+const auto path3 = createNextHop(
+    toBinaryAddress(folly::IPAddress("fe80::4")), "iface_3", 2);
+
+} // namespace
+
+TEST(FibRouteTableTest, SharedNextHopGroups) {
+  FibRouteTable table;
+
+  // Routes with the same next-hops, in any order, share one group
+  EXPECT_TRUE(
+      table.updateUnicastRoute(createUnicastRoute(prefix1, {path1, path3})));
+  EXPECT_TRUE(
+      table.updateUnicastRoute(createUnicastRoute(prefix2, {path3, path1})));
+  EXPECT_EQ(2, table.getNumUnicastRoutes());
+  EXPECT_EQ(1, table.getNumNextHopGroups());
+
+  // Same route is a no-op
+  EXPECT_FALSE(
+      table.updateUnicastRoute(createUnicastRoute(prefix1, {path1, path3})));
+
+  // Best next-hops are programmed, all of them are kept
+  auto route = table.getUnicastRouteToProgram(prefix1);
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(std::vector<thrift::NextHopThrift>({path1}), route->nextHops);
+  EXPECT_EQ(1, route->deprecatedNexthops.size());
+  for (const auto& unicastRoute : table.getUnicastRoutes()) {
+    EXPECT_EQ(2, unicastRoute.nextHops.size());
+  }
+
+  // Moving route to new next-hops keeps old group while in use
+  EXPECT_TRUE(table.updateUnicastRoute(createUnicastRoute(prefix2, {path2})));
+  EXPECT_EQ(2, table.getNumNextHopGroups());
+  EXPECT_TRUE(table.deleteUnicastRoute(prefix1));
+  EXPECT_FALSE(table.deleteUnicastRoute(prefix1));
+  EXPECT_EQ(1, table.getNumNextHopGroups());
+  EXPECT_TRUE(table.deleteUnicastRoute(prefix2));
+  EXPECT_EQ(0, table.getNumNextHopGroups());
+  EXPECT_EQ(0, table.getNumUnicastRoutes());
+}
+
+TEST(FibRouteTableTest, RemoveNextHopsOnInterfaces) {
+  FibRouteTable table;
+  table.updateUnicastRoute(createUnicastRoute(prefix1, {path2, path3}));
+  table.updateUnicastRoute(createUnicastRoute(prefix2, {path1, path3}));
+  table.updateUnicastRoute(createUnicastRoute(prefix3, {path1}));
+
+  thrift::RouteDatabaseDelta delta;
+  table.removeNextHopsOnInterfaces({"iface_1"}, delta);
+
+  // prefix1 is not affected, prefix2 falls back to path3, prefix3 is gone
+  ASSERT_EQ(1, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(prefix2, delta.unicastRoutesToUpdate.at(0).dest);
+  EXPECT_EQ(
+      std::vector<thrift::NextHopThrift>({path3}),
+      delta.unicastRoutesToUpdate.at(0).nextHops);
+  ASSERT_EQ(1, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(prefix3, delta.unicastRoutesToDelete.at(0));
+
+  EXPECT_EQ(2, table.getNumUnicastRoutes());
+  EXPECT_EQ(2, table.getNumNextHopGroups());
+  auto route = table.getUnicastRouteToProgram(prefix1);
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(std::vector<thrift::NextHopThrift>({path2}), route->nextHops);
+
+  // Interface index follows groups, routes moved above are repaired again
+  delta = thrift::RouteDatabaseDelta{};
+  table.removeNextHopsOnInterfaces({"iface_3"}, delta);
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  ASSERT_EQ(1, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(prefix2, delta.unicastRoutesToDelete.at(0));
+  EXPECT_EQ(1, table.getNumUnicastRoutes());
+  EXPECT_EQ(1, table.getNumNextHopGroups());
+
+  // Interfaces without routes are a no-op
+  delta = thrift::RouteDatabaseDelta{};
+  table.removeNextHopsOnInterfaces({"iface_1", "iface_4"}, delta);
+  EXPECT_EQ(0, delta.unicastRoutesToUpdate.size());
+  EXPECT_EQ(0, delta.unicastRoutesToDelete.size());
+  EXPECT_EQ(1, table.getNumUnicastRoutes());
+}
+
+TEST(FibRouteTableTest, RouteForAddress) {
+  FibRouteTable table;
+  const auto coarse = toIpPrefix("fc00::/16");
+  const auto fine = toIpPrefix("fc00:cafe::/32");
+  table.updateUnicastRoute(createUnicastRoute(coarse, {path1}));
+  table.updateUnicastRoute(createUnicastRoute(fine, {path2, path3}));
+
+  // Longest match is returned with all its next-hops
+  auto route =
+      table.getUnicastRouteForAddress(folly::IPAddress("fc00:cafe::1"));
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(fine, route->dest);
+  EXPECT_EQ(2, route->nextHops.size());
+  route = table.getUnicastRouteForAddress(folly::IPAddress("fc00:babe::1"));
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(coarse, route->dest);
+  EXPECT_FALSE(table.getUnicastRouteForAddress(folly::IPAddress("fd00::1")));
+
+  // Deleted and next-hop-less routes don't match anymore
+  EXPECT_TRUE(table.deleteUnicastRoute(fine));
+  route = table.getUnicastRouteForAddress(folly::IPAddress("fc00:cafe::1"));
+  ASSERT_TRUE(route.hasValue());
+  EXPECT_EQ(coarse, route->dest);
+  thrift::RouteDatabaseDelta delta;
+  table.removeNextHopsOnInterfaces({"iface_1"}, delta);
+  EXPECT_FALSE(
+      table.getUnicastRouteForAddress(folly::IPAddress("fc00:cafe::1")));
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -122,6 +122,10 @@ class FibTestFixture : public ::testing::Test, public OpenrModuleTestBase {
   void
   SetUp() override {
     mockFibHandler = std::make_shared<MockNetlinkFibHandler>();
+    for (const auto& route : agentRoutes) {
+      mockFibHandler->addUnicastRoute(
+          kFibId, std::make_unique<thrift::UnicastRoute>(route));
+    }
 
     server = make_shared<ThriftServer>();
     server->setNumIOWorkerThreads(1);
@@ -143,7 +147,7 @@ class FibTestFixture : public ::testing::Test, public OpenrModuleTestBase {
         port, /* thrift port */
         false, /* dryrun */
         true, /* periodic syncFib */
-        false, /* segment route */
+        enableSegmentRouting,
         false, /* orderedFib */
         std::chrono::seconds(2),
         false, /* waitOnDecision */
@@ -153,7 +157,11 @@ class FibTestFixture : public ::testing::Test, public OpenrModuleTestBase {
         MonitorSubmitUrl{"inproc://monitor-sub"},
         KvStoreLocalCmdUrl{"inproc://kvstore-cmd"},
         KvStoreLocalPubUrl{"inproc://kvstore-pub"},
-        context);
+        context,
+        syncFibChunkSize,
+        {}, /* criticalPrefixes */
+        BusSerializer::Protocol::COMPACT,
+        enableWarmBoot);
 
     fibThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "Fib thread starting";
@@ -219,6 +227,18 @@ class FibTestFixture : public ::testing::Test, public OpenrModuleTestBase {
   // variables used to create Open/R ctrl thrift handler
   std::unordered_set<std::string> acceptablePeerNames;
 
+  // Full sync is chunked if set, by default a single syncFib call
+  size_t syncFibChunkSize{0};
+
+  // Routes of agent are read on startup and kept in place if set
+  bool enableWarmBoot{false};
+
+  // MPLS routes are programmed if set
+  bool enableSegmentRouting{false};
+
+  // Routes in agent before Fib starts
+  std::vector<thrift::UnicastRoute> agentRoutes;
+
   std::shared_ptr<Fib> fib;
   std::unique_ptr<std::thread> fibThread;
 
@@ -296,6 +316,44 @@ TEST_F(FibTestFixture, processRouteDb) {
   EXPECT_TRUE(checkEqualRoutes(routeDb, getRouteDb()));
 }
 
+/**
+ * Deltas received while route programming is in flight to a slow agent are
+ * coalesced and programmed with a single call once it completes
+ */
+TEST_F(FibTestFixture, coalescePendingDeltas) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->setAddRoutesDelay(std::chrono::milliseconds(500));
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // Let first delta reach agent, next ones arrive while it is in flight
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1, path1_2_2}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // first delta and then merged one
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 1);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 2);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 0);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+}
+
 TEST_F(FibTestFixture, processInterfaceDb) {
   // Make sure fib starts with clean route database
   std::vector<thrift::UnicastRoute> routes;
@@ -493,6 +551,178 @@ TEST_F(FibTestFixture, fibRestart) {
   EXPECT_EQ(routes.size(), 1);
 }
 
+/**
+ * Critical routes of a delta are programmed ahead of other routes, with
+ * separate calls
+ */
+TEST_F(FibTestFixture, criticalRoutesFirst) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->setAddRoutesDelay(std::chrono::milliseconds(200));
+
+  // host route is critical, subnet route is not
+  const auto subnetPrefix = toIpPrefix("fc00:cafe:1::/64");
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(subnetPrefix, {path1_2_1}));
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // critical route and then the rest
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  ASSERT_EQ(routes.size(), 1);
+  EXPECT_EQ(routes.at(0).dest, prefix1);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 2);
+
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+}
+
+class FibChunkedSyncTestFixture : public FibTestFixture {
+ public:
+  FibChunkedSyncTestFixture() {
+    syncFibChunkSize = 2;
+  }
+};
+
+TEST_F(FibChunkedSyncTestFixture, chunkedSyncFib) {
+  // Route of agent unknown to fib, deleted on commit of sync
+  auto staleRoutes = std::make_unique<std::vector<thrift::UnicastRoute>>();
+  staleRoutes->emplace_back(createUnicastRoute(prefix4, {path3_4_1}));
+  mockFibHandler->addUnicastRoutes(kFibId, std::move(staleRoutes));
+
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}));
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix2, {path1_2_1}));
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // initial syncFib debounce, 3 routes in chunks of 2
+  mockFibHandler->waitForSyncFib();
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 1);
+  EXPECT_EQ(mockFibHandler->getSyncFibChunkCount(), 2);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+  for (const auto& route : routes) {
+    EXPECT_NE(route.dest, prefix4);
+  }
+
+  // syncFib debounce after agent restart
+  mockFibHandler->restart();
+  mockFibHandler->waitForSyncFib();
+  EXPECT_EQ(mockFibHandler->getSyncFibChunkCount(), 4);
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 3);
+}
+
+class FibWarmBootTestFixture : public FibTestFixture {
+ public:
+  FibWarmBootTestFixture() {
+    enableWarmBoot = true;
+    // Routes left in agent by previous instance, prefix1 is unchanged
+    agentRoutes.emplace_back(createUnicastRoute(prefix1, {path1_2_1}));
+    agentRoutes.emplace_back(createUnicastRoute(prefix2, {path1_2_1}));
+  }
+};
+
+TEST_F(FibWarmBootTestFixture, programRouteDbDelta) {
+  thrift::RouteDatabase routeDb;
+  routeDb.thisNodeName = "node-1";
+  routeDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix1, {path1_2_1, path1_2_2}));
+  routeDb.unicastRoutes.emplace_back(
+      createUnicastRoute(prefix3, {path1_3_1, path1_3_2}));
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate = routeDb.unicastRoutes;
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // After cold start, prefix2 is deleted and prefix3 added without full sync.
+  // Calls are pipelined, wait until both are received
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  while (mockFibHandler->getAddRoutesCount() +
+             mockFibHandler->getDelRoutesCount() <
+         2) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 1);
+  EXPECT_EQ(mockFibHandler->getDelRoutesCount(), 1);
+  EXPECT_EQ(mockFibHandler->getFibSyncCount(), 0);
+
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 2);
+  for (const auto& route : routes) {
+    EXPECT_NE(route.dest, prefix2);
+  }
+  EXPECT_TRUE(checkEqualRoutes(routeDb, getRouteDb()));
+}
+
+class FibSegmentRoutingTestFixture : public FibTestFixture {
+ public:
+  FibSegmentRoutingTestFixture() {
+    enableSegmentRouting = true;
+  }
+};
+
+/**
+ * MPLS routes are programmed concurrently with unicast routes, except for
+ * deletes which wait for unicast routes to be programmed
+ */
+TEST_F(FibSegmentRoutingTestFixture, concurrentMplsRoutes) {
+  // initial syncFib debounce
+  mockFibHandler->waitForSyncFib();
+  mockFibHandler->setAddRoutesDelay(std::chrono::milliseconds(500));
+
+  const auto subnetPrefix = toIpPrefix("fc00:cafe:1::/64");
+  const auto mplsPath = createNextHop(
+      toBinaryAddress(folly::IPAddress("fe80::2")),
+      "iface_1_2_1",
+      1,
+      createMplsAction(thrift::MplsActionCode::PHP));
+  thrift::RouteDatabaseDelta routeDbDelta;
+  routeDbDelta.thisNodeName = "node-1";
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(subnetPrefix, {path1_2_1}));
+  routeDbDelta.mplsRoutesToUpdate.emplace_back(
+      createMplsRoute(100, {mplsPath}));
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+
+  // MPLS route is added while unicast one is still being added
+  mockFibHandler->waitForUpdateMplsRoutes();
+  std::vector<thrift::MplsRoute> mplsRoutes;
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 1);
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 0);
+  mockFibHandler->waitForUpdateUnicastRoutes();
+  std::vector<thrift::UnicastRoute> routes;
+  mockFibHandler->getRouteTableByClient(routes, kFibId);
+  EXPECT_EQ(routes.size(), 1);
+
+  // MPLS route is deleted only once unicast route is updated
+  routeDbDelta.unicastRoutesToUpdate.clear();
+  routeDbDelta.unicastRoutesToUpdate.emplace_back(
+      createUnicastRoute(subnetPrefix, {path1_2_2}));
+  routeDbDelta.mplsRoutesToUpdate.clear();
+  routeDbDelta.mplsRoutesToDelete.emplace_back(100);
+  decisionPub.sendThriftObj(routeDbDelta, serializer).value();
+  mockFibHandler->waitForUpdateMplsRoutes();
+  EXPECT_EQ(mockFibHandler->getAddRoutesCount(), 2);
+  mockFibHandler->getMplsRouteTableByClient(mplsRoutes, kFibId);
+  EXPECT_EQ(mplsRoutes.size(), 0);
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
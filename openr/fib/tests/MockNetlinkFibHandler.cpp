@@ -72,6 +72,7 @@ MockNetlinkFibHandler::deleteUnicastRoute(
 void
 MockNetlinkFibHandler::addUnicastRoutes(
     int16_t, std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes) {
+  std::this_thread::sleep_for(*addRoutesDelay_.rlock());
   SYNCHRONIZED(unicastRouteDb_) {
     for (auto const& route : *routes) {
       auto prefix = std::make_pair(
@@ -137,6 +138,101 @@ MockNetlinkFibHandler::syncFib(
   syncFibBaton_.post();
 }
 
+int64_t
+MockNetlinkFibHandler::beginSyncFib(int16_t, bool) {
+  syncPrefixes_.wlock()->clear();
+  return 1;
+}
+
+void
+MockNetlinkFibHandler::syncFibChunk(
+    int16_t,
+    int64_t,
+    std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> unicastRoutes,
+    std::unique_ptr<std::vector<openr::thrift::MplsRoute>>) {
+  SYNCHRONIZED(unicastRouteDb_) {
+    for (auto const& route : *unicastRoutes) {
+      auto prefix = std::make_pair(
+          toIPAddress(route.dest.prefixAddress), route.dest.prefixLength);
+
+      auto newNextHops =
+          from(route.nextHops) | mapped([](const thrift::NextHopThrift& nh) {
+            return std::make_pair(
+                nh.address.ifName.value(), toIPAddress(nh.address));
+          }) |
+          as<std::unordered_set<std::pair<std::string, folly::IPAddress>>>();
+
+      unicastRouteDb_[prefix] = std::move(newNextHops);
+      syncPrefixes_.wlock()->emplace(prefix);
+    }
+  }
+  SYNCHRONIZED(countSyncChunks_) {
+    countSyncChunks_++;
+  }
+}
+
+void
+MockNetlinkFibHandler::commitSyncFib(int16_t, int64_t) {
+  SYNCHRONIZED(unicastRouteDb_) {
+    auto syncPrefixes = syncPrefixes_.rlock();
+    for (auto it = unicastRouteDb_.begin(); it != unicastRouteDb_.end();) {
+      if (syncPrefixes->count(it->first)) {
+        ++it;
+      } else {
+        it = unicastRouteDb_.erase(it);
+      }
+    }
+  }
+  SYNCHRONIZED(countSync_) {
+    countSync_++;
+  }
+  syncFibBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::addMplsRoutes(
+    int16_t, std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) {
+  SYNCHRONIZED(mplsRouteDb_) {
+    for (auto const& route : *routes) {
+      mplsRouteDb_[route.topLabel] = route;
+    }
+  }
+  updateMplsRoutesBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::deleteMplsRoutes(
+    int16_t, std::unique_ptr<std::vector<int32_t>> topLabels) {
+  SYNCHRONIZED(mplsRouteDb_) {
+    for (auto const& topLabel : *topLabels) {
+      mplsRouteDb_.erase(topLabel);
+    }
+  }
+  updateMplsRoutesBaton_.post();
+}
+
+void
+MockNetlinkFibHandler::syncMplsFib(
+    int16_t, std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) {
+  SYNCHRONIZED(mplsRouteDb_) {
+    mplsRouteDb_.clear();
+    for (auto const& route : *routes) {
+      mplsRouteDb_[route.topLabel] = route;
+    }
+  }
+}
+
+void
+MockNetlinkFibHandler::getMplsRouteTableByClient(
+    std::vector<openr::thrift::MplsRoute>& routes, int16_t) {
+  SYNCHRONIZED(mplsRouteDb_) {
+    routes.clear();
+    for (auto const& kv : mplsRouteDb_) {
+      routes.emplace_back(kv.second);
+    }
+  }
+}
+
 int64_t
 MockNetlinkFibHandler::aliveSince() {
   int64_t res = 0;
@@ -186,6 +282,15 @@ MockNetlinkFibHandler::getFibSyncCount() {
   return res;
 }
 
+int64_t
+MockNetlinkFibHandler::getSyncFibChunkCount() {
+  int64_t res = 0;
+  SYNCHRONIZED(countSyncChunks_) {
+    res = countSyncChunks_;
+  }
+  return res;
+}
+
 int64_t
 MockNetlinkFibHandler::getAddRoutesCount() {
   int64_t res = 0;
@@ -210,17 +315,31 @@ MockNetlinkFibHandler::waitForUpdateUnicastRoutes() {
   updateUnicastRoutesBaton_.reset();
 };
 
+void
+MockNetlinkFibHandler::waitForUpdateMplsRoutes() {
+  updateMplsRoutesBaton_.wait();
+  updateMplsRoutesBaton_.reset();
+};
+
 void
 MockNetlinkFibHandler::waitForSyncFib() {
   syncFibBaton_.wait();
   syncFibBaton_.reset();
 };
 
+void
+MockNetlinkFibHandler::setAddRoutesDelay(std::chrono::milliseconds delay) {
+  *addRoutesDelay_.wlock() = delay;
+}
+
 void
 MockNetlinkFibHandler::stop() {
   SYNCHRONIZED(unicastRouteDb_) {
     unicastRouteDb_.clear();
   }
+  SYNCHRONIZED(mplsRouteDb_) {
+    mplsRouteDb_.clear();
+  }
   SYNCHRONIZED(countSync_) {
     countSync_ = 0;
   }
@@ -239,6 +358,9 @@ MockNetlinkFibHandler::restart() {
     LOG(INFO) << "Restarting fib agent";
     unicastRouteDb_.clear();
   }
+  SYNCHRONIZED(mplsRouteDb_) {
+    mplsRouteDb_.clear();
+  }
   SYNCHRONIZED(startTime_) {
     startTime_ = std::chrono::duration_cast<std::chrono::seconds>(
                      std::chrono::system_clock::now().time_since_epoch())
@@ -68,12 +68,44 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
       std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> routes)
       override;
 
+  int64_t beginSyncFib(int16_t clientId, bool syncMpls) override;
+
+  void syncFibChunk(
+      int16_t clientId,
+      int64_t syncId,
+      std::unique_ptr<std::vector<openr::thrift::UnicastRoute>> unicastRoutes,
+      std::unique_ptr<std::vector<openr::thrift::MplsRoute>> mplsRoutes)
+      override;
+
+  void commitSyncFib(int16_t clientId, int64_t syncId) override;
+
+  void addMplsRoutes(
+      int16_t clientId,
+      std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) override;
+
+  void deleteMplsRoutes(
+      int16_t clientId,
+      std::unique_ptr<std::vector<int32_t>> topLabels) override;
+
+  void syncMplsFib(
+      int16_t clientId,
+      std::unique_ptr<std::vector<openr::thrift::MplsRoute>> routes) override;
+
+  void getMplsRouteTableByClient(
+      std::vector<openr::thrift::MplsRoute>& routes, int16_t clientId) override;
+
   // Wait for adding/deleting routes to complete
   void waitForUpdateUnicastRoutes();
 
+  // Wait for adding/deleting MPLS routes to complete
+  void waitForUpdateMplsRoutes();
+
   // Wait for synchronizing Fib to complete
   void waitForSyncFib();
 
+  // Delay response of addUnicastRoutes to mimic a slow agent
+  void setAddRoutesDelay(std::chrono::milliseconds delay);
+
   int64_t aliveSince() override;
 
   void getRouteTableByClient(
@@ -81,6 +113,7 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
       int16_t clientId) override;
 
   int64_t getFibSyncCount();
+  int64_t getSyncFibChunkCount();
   int64_t getAddRoutesCount();
   int64_t getDelRoutesCount();
 
@@ -95,14 +128,26 @@ class MockNetlinkFibHandler final : public thrift::FibServiceSvIf {
   // Abstract route Db to hide kernel level routing details from Fib
   folly::Synchronized<UnicastRoutes> unicastRouteDb_{};
 
+  // MPLS routes by top label
+  folly::Synchronized<std::unordered_map<int32_t, thrift::MplsRoute>>
+      mplsRouteDb_{};
+
   // Number of times Fib syncs with this agent
   folly::Synchronized<int64_t> countSync_{0};
 
+  // Prefixes received in chunks of current chunked sync
+  folly::Synchronized<std::unordered_set<folly::CIDRNetwork>> syncPrefixes_;
+  folly::Synchronized<int64_t> countSyncChunks_{0};
+
   folly::Synchronized<int64_t> countAddRoutes_{0};
   folly::Synchronized<int64_t> countDelRoutes_{0};
 
+  folly::Synchronized<std::chrono::milliseconds> addRoutesDelay_{
+      std::chrono::milliseconds(0)};
+
   // A baton for synchronization
   folly::Baton<> updateUnicastRoutesBaton_;
+  folly::Baton<> updateMplsRoutesBaton_;
   folly::Baton<> syncFibBaton_;
 };
 
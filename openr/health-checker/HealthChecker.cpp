@@ -7,14 +7,24 @@
 
 #include "HealthChecker.h"
 
+#include <algorithm>
+#include <array>
+
+#include <folly/Bits.h>
 #include <folly/MapUtil.h>
-#include <folly/Random.h>
+#include <folly/hash/Hash.h>
 #include <openr/common/Util.h>
 
 using apache::thrift::FRAGILE;
 
 namespace {
 const int kMaxPingPacketSize = 1028;
+// max number of messages sent or received with one system call
+const size_t kMaxPingBatchSize = 64;
+// pings to all nodes are spread over this many rounds per ping interval
+const size_t kNumPingSlots = 10;
+// smallest bucket of RTT histogram
+const uint64_t kMinRttBucketUs = 128;
 } // namespace
 
 namespace openr {
@@ -82,10 +92,16 @@ HealthChecker::prepare() noexcept {
 
   // Schedule periodic timer for sending pings
   pingTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-    printInfo();
+    if (pingSlot_ == 0) {
+      printInfo();
+    }
     pingNodes();
+    pingSlot_ = (pingSlot_ + 1) % kNumPingSlots;
   });
-  pingTimer_->scheduleTimeout(pingInterval_, true /* isPeriodic */);
+  pingTimer_->scheduleTimeout(
+      std::chrono::duration_cast<std::chrono::milliseconds>(pingInterval_) /
+          kNumPingSlots,
+      true /* isPeriodic */);
   // Schedule periodic timer for monitor submission
   monitorTimer_ =
       fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
@@ -153,7 +169,7 @@ HealthChecker::createPingSocket() noexcept {
   // Listen for incoming messages on ping FD
   addSocketFd(socketFd, ZMQ_POLLIN, [this](int) noexcept {
     try {
-      processMessage();
+      processMessages();
     } catch (std::exception const& err) {
       LOG(ERROR) << "HealthChecker: error processing health check ping "
                  << folly::exceptionStr(err);
@@ -188,7 +204,13 @@ HealthChecker::pingNodes() {
     return;
   }
 
+  const auto now = std::chrono::steady_clock::now();
   for (const auto& node : nodesToPing_) {
+    // Spread pings evenly over the interval, differently on every node
+    if (std::hash<std::string>()(myNodeName_ + node) % kNumPingSlots !=
+        pingSlot_) {
+      continue;
+    }
     try {
       auto& info = nodeInfo_.at(node);
       if (info.ipAddress.addr.empty()) {
@@ -197,15 +219,17 @@ HealthChecker::pingNodes() {
       folly::SocketAddress socketAddr(
           toIPAddress(info.ipAddress), udpPingPort_);
       tData_.addStatValue("health_checker.ping_to_" + node, 1, fbzmq::COUNT);
-      sendDatagram(
+      queueDatagram(
           node,
           socketAddr,
           thrift::HealthCheckerMessageType::PING,
           ++info.lastValSent);
+      lastPingSent_[node] = std::make_pair(info.lastValSent, now);
     } catch (const std::exception& e) {
       continue;
     }
   }
+  flushDatagrams();
 }
 
 void
@@ -221,6 +245,7 @@ HealthChecker::processKeyVal(
     }
     if (key.find(adjacencyDbMarker_) == 0) {
       nodeInfo_[nodeName].neighbors.clear();
+      updateNodesToPing(nodeName);
     }
     if (key.find(prefixDbMarker_) == 0) {
       nodeInfo_[nodeName].ipAddress =
@@ -231,20 +256,20 @@ HealthChecker::processKeyVal(
       VLOG(2) << "HealthChecker: Erasing node:" << nodeName;
       nodeInfo_.erase(nodeName);
       nodesToPing_.erase(nodeName);
+      lastPingSent_.erase(nodeName);
     }
     return;
   }
 
   if (key.find(adjacencyDbMarker_) == 0) {
-    const auto adjacencyDb =
-        fbzmq::util::readThriftObjStr<thrift::AdjacencyDatabase>(
-            val.value().value.value(), serializer_);
+    const auto adjacencyDb = readThriftValue<thrift::AdjacencyDatabase>(
+        val.value().value.value(), serializer_);
     CHECK_EQ(nodeName, adjacencyDb.thisNodeName);
     processAdjDb(adjacencyDb);
   }
 
   if (key.find(prefixDbMarker_) == 0) {
-    auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+    auto prefixDb = readThriftValue<thrift::PrefixDatabase>(
         val.value().value.value(), serializer_);
     CHECK_EQ(nodeName, prefixDb.thisNodeName);
     processPrefixDb(prefixDb);
@@ -258,7 +283,7 @@ HealthChecker::processAdjDb(thrift::AdjacencyDatabase const& adjDb) {
   for (auto const& adj : adjDb.adjacencies) {
     neighbors.push_back(adj.otherNodeName);
   }
-  updateNodesToPing();
+  updateNodesToPing(adjDb.thisNodeName);
 }
 
 void
@@ -322,20 +347,61 @@ HealthChecker::processPrefixDb(thrift::PrefixDatabase const& prefixDb) {
 }
 
 void
-HealthChecker::updateNodesToPing() {
+HealthChecker::updateNodesToPing(std::string const& nodeName) {
   switch (healthCheckOption_) {
-  case thrift::HealthCheckOption::PingNeighborOfNeighbor:
-    for (auto const& neighbor : nodeInfo_[myNodeName_].neighbors) {
-      nodesToPing_.insert(
-          nodeInfo_[neighbor].neighbors.begin(),
-          nodeInfo_[neighbor].neighbors.end());
+  case thrift::HealthCheckOption::PingNeighborOfNeighbor: {
+    // only adjacencies of this node and its neighbors make up neighbors of
+    // neighbors
+    auto const& myNeighbors = nodeInfo_[myNodeName_].neighbors;
+    if (nodeName == myNodeName_ or
+        std::find(myNeighbors.begin(), myNeighbors.end(), nodeName) !=
+            myNeighbors.end()) {
+      recomputeNodesToPing();
+    }
+    break;
+  }
+
+  case thrift::HealthCheckOption::PingTopology:
+    if (nodeName != myNodeName_) {
+      nodesToPing_.insert(nodeName);
+    }
+    break;
+
+  case thrift::HealthCheckOption::PingRandom:
+    if (nodeName != myNodeName_ and isRandomlySelected(nodeName)) {
+      nodesToPing_.insert(nodeName);
+    }
+    break;
+
+  default:
+    LOG(ERROR) << "Invalid HealthCheckOption: " << (int32_t)healthCheckOption_
+               << ", no nodesToPing_ updated";
+    break;
+  }
+}
+
+void
+HealthChecker::recomputeNodesToPing() {
+  tData_.addStatValue(
+      "health_checker.nodes_to_ping_recomputations", 1, fbzmq::COUNT);
+  nodesToPing_.clear();
+  switch (healthCheckOption_) {
+  case thrift::HealthCheckOption::PingNeighborOfNeighbor: {
+    auto const& myNeighbors = nodeInfo_[myNodeName_].neighbors;
+    for (auto const& neighbor : myNeighbors) {
+      auto it = nodeInfo_.find(neighbor);
+      if (it != nodeInfo_.end()) {
+        nodesToPing_.insert(
+            it->second.neighbors.begin(), it->second.neighbors.end());
+      }
     }
     // remove this node and its adjacencies
     nodesToPing_.erase(myNodeName_);
-    for (auto const& neighbor : nodeInfo_[myNodeName_].neighbors) {
+    for (auto const& neighbor : myNeighbors) {
       nodesToPing_.erase(neighbor);
     }
     break;
+  }
 
   case thrift::HealthCheckOption::PingTopology:
     // ping all nodes in topology
@@ -349,7 +415,7 @@ HealthChecker::updateNodesToPing() {
   case thrift::HealthCheckOption::PingRandom:
     // randomly select nodes based on pct given
     for (auto const& node : nodeInfo_) {
-      if (folly::Random::rand32() % 100 < healthCheckPct_) {
+      if (isRandomlySelected(node.first)) {
         nodesToPing_.insert(node.first);
       }
     }
@@ -364,68 +430,134 @@ HealthChecker::updateNodesToPing() {
   }
 }
 
+bool
+HealthChecker::isRandomlySelected(std::string const& nodeName) const {
+  // differs from the hash spreading pings over slots, and across nodes
+  return folly::hash::fnv64(myNodeName_ + nodeName) % 100 < healthCheckPct_;
+}
+
 void
-HealthChecker::sendDatagram(
+HealthChecker::queueDatagram(
     const std::string& nodeName,
     folly::SocketAddress const& addr,
     thrift::HealthCheckerMessageType msgType,
     int64_t seqNum) {
   thrift::HealthCheckerMessage message(
       apache::thrift::FRAGILE, myNodeName_, msgType, seqNum);
-  const auto packet = fbzmq::util::writeThriftObjStr(message, serializer_);
 
-  sockaddr_storage addrStorage;
-  auto addrLen = addr.getAddress(&addrStorage);
+  Datagram datagram;
+  datagram.nodeName = nodeName;
+  datagram.addrLen = addr.getAddress(&datagram.addr);
+  datagram.packet = fbzmq::util::writeThriftObjStr(message, serializer_);
+  pendingDatagrams_.emplace_back(std::move(datagram));
+}
 
-  auto bytesSent = ::sendto(
-      pingSocketFd_.value(),
-      const_cast<char*>(packet.data()),
-      packet.size(),
-      0,
-      reinterpret_cast<struct sockaddr*>(&addrStorage),
-      addrLen);
+void
+HealthChecker::flushDatagrams() {
+  auto datagrams = std::move(pendingDatagrams_);
+  pendingDatagrams_.clear();
+
+  std::array<mmsghdr, kMaxPingBatchSize> msgs;
+  std::array<iovec, kMaxPingBatchSize> iovs;
+  for (size_t start = 0; start < datagrams.size();
+       start += kMaxPingBatchSize) {
+    const size_t count =
+        std::min(kMaxPingBatchSize, datagrams.size() - start);
+    for (size_t i = 0; i < count; ++i) {
+      auto& datagram = datagrams[start + i];
+      iovs[i].iov_base = const_cast<char*>(datagram.packet.data());
+      iovs[i].iov_len = datagram.packet.size();
+      msgs[i] = mmsghdr{};
+      msgs[i].msg_hdr.msg_name = &datagram.addr;
+      msgs[i].msg_hdr.msg_namelen = datagram.addrLen;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
-  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
-    LOG(ERROR) << "Failed sending datagram to node: " << nodeName
-               << " at IP address: " << addr.getAddressStr();
+    // sendmmsg may send less than requested, continue with the rest
+    size_t sent = 0;
+    while (sent < count) {
+      auto ret =
+          ::sendmmsg(pingSocketFd_.value(), &msgs[sent], count - sent, 0);
+      if (ret <= 0) {
+        // skip message which failed to send
+        auto const& datagram = datagrams[start + sent];
+        LOG(ERROR) << "Failed sending datagram to node: " << datagram.nodeName
+                   << ". Error: " << folly::errnoStr(errno);
+        tData_.addStatValue("health_checker.send_errors", 1, fbzmq::COUNT);
+        ++sent;
+        continue;
+      }
+      sent += ret;
+    }
   }
 }
 
 void
-HealthChecker::processMessage() {
+HealthChecker::processMessages() {
   CHECK(pingSocketFd_.hasValue());
 
-  std::array<char, kMaxPingPacketSize> buf;
+  std::vector<std::array<char, kMaxPingPacketSize>> bufs(kMaxPingBatchSize);
+  std::array<sockaddr_storage, kMaxPingBatchSize> addrs;
+  std::array<iovec, kMaxPingBatchSize> iovs;
+  std::array<mmsghdr, kMaxPingBatchSize> msgs;
+  for (size_t i = 0; i < kMaxPingBatchSize; ++i) {
+    iovs[i].iov_base = bufs[i].data();
+    iovs[i].iov_len = kMaxPingPacketSize;
+    msgs[i] = mmsghdr{};
+    msgs[i].msg_hdr.msg_name = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
 
-  sockaddr_storage addrStorage;
-  socklen_t addrlen = sizeof(addrStorage);
-  auto bytesRead = ::recvfrom(
+  // Read whatever is available without blocking
+  auto numMsgs = ::recvmmsg(
       pingSocketFd_.value(),
-      buf.data(),
-      kMaxPingPacketSize,
-      0,
-      reinterpret_cast<struct sockaddr*>(&addrStorage),
-      &addrlen);
+      msgs.data(),
+      kMaxPingBatchSize,
+      MSG_DONTWAIT,
+      nullptr);
+  if (numMsgs < 0) {
+    if (errno != EAGAIN and errno != EWOULDBLOCK) {
+      LOG(ERROR) << "Failed receiving datagrams: " << folly::errnoStr(errno);
+    }
+    return;
+  }
 
-  std::string readBuf(buf.data(), bytesRead);
+  for (int i = 0; i < numMsgs; ++i) {
+    try {
+      // build the source socket address from recvmmsg data
+      folly::SocketAddress srcAddr{};
+      // this will throw if sender address was not filled in
+      srcAddr.setFromSockaddr(
+          reinterpret_cast<struct sockaddr*>(&addrs[i]),
+          msgs[i].msg_hdr.msg_namelen);
+      processMessage(std::string(bufs[i].data(), msgs[i].msg_len), srcAddr);
+    } catch (std::exception const& err) {
+      LOG(ERROR) << "HealthChecker: error processing health check ping "
+                 << folly::exceptionStr(err);
+    }
+  }
 
-  // build the source socket address from recvfrom data
-  folly::SocketAddress srcAddr{};
-  // this will throw if sender address was not filled in
-  srcAddr.setFromSockaddr(
-      reinterpret_cast<struct sockaddr*>(&addrStorage), addrlen);
+  // Send acks of all pings at once
+  flushDatagrams();
+}
 
+void
+HealthChecker::processMessage(
+    const std::string& packet, folly::SocketAddress const& srcAddr) {
   const auto healthCheckerMessage =
       fbzmq::util::readThriftObjStr<thrift::HealthCheckerMessage>(
-          readBuf, serializer_);
+          packet, serializer_);
   const auto& fromNodeName = healthCheckerMessage.fromNodeName;
   auto& info = nodeInfo_[fromNodeName];
   switch (healthCheckerMessage.type) {
   case thrift::HealthCheckerMessageType::PING: {
     tData_.addStatValue(
         "health_checker.ping_from_" + fromNodeName, 1, fbzmq::COUNT);
-    // send an ack now
-    sendDatagram(
+    // send an ack along with the rest of the batch
+    queueDatagram(
         fromNodeName,
         srcAddr,
         thrift::HealthCheckerMessageType::ACK,
@@ -435,12 +567,28 @@ HealthChecker::processMessage() {
   }
   case thrift::HealthCheckerMessageType::ACK: {
     info.lastAckFromNode = healthCheckerMessage.seqNum;
+    ++info.numAcksFromNode;
     tData_.addStatValue(
         "health_checker.ack_from_" + fromNodeName, 1, fbzmq::COUNT);
     tData_.addStatValue(
         "health_checker.seq_num_diff_" + fromNodeName,
         info.lastValSent - info.lastAckFromNode,
         static_cast<fbzmq::ExportType>(fbzmq::SUM | fbzmq::AVG));
+
+    // Measure RTT if this is the ack of our last ping
+    auto it = lastPingSent_.find(fromNodeName);
+    if (it != lastPingSent_.end() and
+        it->second.first == healthCheckerMessage.seqNum) {
+      const uint64_t rttUs =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - it->second.second)
+              .count();
+      info.lastRttUs = rttUs;
+      const auto bucket = std::max(kMinRttBucketUs, folly::nextPowTwo(rttUs));
+      info.rttHistogramUs[bucket]++;
+      tData_.addStatValue("health_checker.ping_rtt_us", rttUs, fbzmq::AVG);
+      lastPingSent_.erase(it);
+    }
     break;
   }
   default: {
@@ -461,6 +609,9 @@ HealthChecker::processRequestMsg(fbzmq::Message&& msg) {
   }
 
   auto thriftReq = maybeThriftReq.value();
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::HealthCheckerCmd>::findName(
+          thriftReq.cmd));
   thrift::HealthCheckerInfo reply;
   switch (thriftReq.cmd) {
   case thrift::HealthCheckerCmd::PEEK: {
@@ -483,7 +634,7 @@ HealthChecker::processRequestMsg(fbzmq::Message&& msg) {
   }
   }
 
-  return fbzmq::Message::fromThriftObj(reply, serializer_);
+  return toReplyMsg(reply, serializer_);
 }
 
 void
@@ -506,6 +657,7 @@ HealthChecker::submitCounters() {
   counters["health_checker.nodes_to_ping_size"] = nodesToPing_.size();
   counters["health_checker.nodes_info_size"] = nodeInfo_.size();
   counters["health_checker.zmq_event_queue_size"] = getEventQueueSize();
+  exportProfileCounters(counters);
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
@@ -11,8 +11,10 @@
 #include <sys/types.h>
 
 #include <set>
+#include <chrono>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
@@ -67,7 +69,9 @@ class HealthChecker final : public OpenrEventLoop {
   void createPingSocket() noexcept;
   void closePingSocket() noexcept;
 
-  // called periodically to send pings to nodesToPing_
+  // called periodically to send pings to nodesToPing_. Nodes are spread over
+  // kNumPingSlots rounds per pingInterval_, only ones in current slot are
+  // pinged
   void pingNodes();
 
   // called by kvStoreClient_ whenever for each key whenever a publication
@@ -77,13 +81,29 @@ class HealthChecker final : public OpenrEventLoop {
 
   void processAdjDb(thrift::AdjacencyDatabase const& adjDb);
   void processPrefixDb(thrift::PrefixDatabase const& prefixDb);
-  void updateNodesToPing();
-  void sendDatagram(
+
+  // Update nodesToPing_ with a change of the databases of node. The whole
+  // set is recomputed only if the change affects other nodes, i.e. for
+  // adjacencies of this node and its neighbors with PingNeighborOfNeighbor
+  void updateNodesToPing(std::string const& nodeName);
+  void recomputeNodesToPing();
+
+  // Whether node is selected with PingRandom. Selection is random across
+  // nodes, yet stable for a node so that its updates don't roll it again
+  bool isRandomlySelected(std::string const& nodeName) const;
+
+  // Queue message to node, sent out by flushDatagrams()
+  void queueDatagram(
       const std::string& nodeName,
       folly::SocketAddress const& addr,
       thrift::HealthCheckerMessageType msgType,
       int64_t seqNum);
-  void processMessage();
+  // Send all queued messages in batches with sendmmsg
+  void flushDatagrams();
+  // Read batch of messages with recvmmsg and process them
+  void processMessages();
+  void processMessage(
+      const std::string& packet, folly::SocketAddress const& srcAddr);
   void processRequest();
 
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
@@ -127,6 +147,23 @@ class HealthChecker final : public OpenrEventLoop {
 
   std::unordered_map<std::string, thrift::NodeHealthInfo> nodeInfo_;
 
+  // Sequence number and send time of last ping to node, to measure RTT
+  std::unordered_map<
+      std::string /* NodeName */,
+      std::pair<int64_t, std::chrono::steady_clock::time_point>>
+      lastPingSent_;
+
+  // Slot of nodes to ping in next round, see pingNodes()
+  size_t pingSlot_{0};
+
+  struct Datagram {
+    std::string nodeName;
+    sockaddr_storage addr;
+    socklen_t addrLen;
+    std::string packet;
+  };
+  std::vector<Datagram> pendingDatagrams_;
+
   // DS to hold local stats/counters
   fbzmq::ThreadData tData_;
 };
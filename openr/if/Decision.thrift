@@ -11,7 +11,9 @@ namespace py openr.Decision
 namespace py3 openr.thrift
 
 include "Fib.thrift"
+include "KvStore.thrift"
 include "Lsdb.thrift"
+include "Network.thrift"
 
 typedef map<string, Lsdb.AdjacencyDatabase>
   (
@@ -46,3 +48,43 @@ struct DecisionReply {
   2: AdjDbs adjDbs
   3: PrefixDbs prefixDbs
 }
+
+// Filter and page of a route or link state database query. Entries are
+// returned ordered by unicast route prefix or by node name
+struct DecisionQuery {
+  // node to get routes for, current node if empty. Only applies to routes
+  1: string nodeName
+  // only routes and prefix entries within any of these prefixes, all if empty
+  2: list<Network.IpPrefix> prefixes
+  // only databases of these nodes, all if empty. Doesn't apply to routes
+  3: list<string> nodeNames
+  // nextCursor of previous page, the first page is returned if not set
+  4: optional string cursor
+  // max number of unicast routes or databases in page, unlimited if 0. MPLS
+  // routes are returned with the first page of routes only, and only if no
+  // prefixes are given
+  5: i32 limit = 0
+}
+
+struct RouteDbPage {
+  1: Fib.RouteDatabase routeDb
+  // set if there are more entries, query again with it as cursor
+  2: optional string nextCursor
+}
+
+struct AdjDbsPage {
+  1: AdjDbs adjDbs
+  2: optional string nextCursor
+}
+
+struct PrefixDbsPage {
+  1: PrefixDbs prefixDbs
+  2: optional string nextCursor
+}
+
+// Publication processed by Decision, recorded for offline replay
+struct PublicationRecord {
+  // time of receipt, microseconds since epoch
+  1: i64 timestampUs
+  2: KvStore.Publication publication
+}
@@ -42,6 +42,8 @@ struct DualPerNeighborCounters {
   2: i64 pktRecv = 0;
   3: i64 msgSent = 0;
   4: i64 msgRecv = 0;
+  // messages not sent as superseded by a later one of the same batch
+  5: i64 msgCoalesced = 0;
 }
 
 // dual exchange message counters for a given root per neighbor
@@ -28,12 +28,17 @@ struct RouteDatabaseDelta {
   4: list<Network.MplsRoute> mplsRoutesToUpdate
   5: list<i32> mplsRoutesToDelete
   6: optional Lsdb.PerfEvents perfEvents;
+  // Unique nextHops shared by unicastRoutesToUpdate, keyed by nextHopGroupId
+  7: map<i64, list<Network.NextHopThrift>> nextHopGroups
 }
 
 // Perf log buffer maintained by Fib
 struct PerfDatabase {
   1: string thisNodeName
   2: list<Lsdb.PerfEvents> eventInfo
+  // Count and percentiles of latencies of route programming since startup,
+  // same as fib.latency.* counters
+  3: map<string, i64> latencyCounters
 }
 
 enum FibCommand {
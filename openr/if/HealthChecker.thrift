@@ -48,6 +48,14 @@ struct NodeHealthInfo {
   3: i64 lastValSent
   4: i64 lastAckFromNode
   5: i64 lastAckToNode
+  // Number of acks received for our pings. Pings lost so far are
+  // lastValSent - numAcksFromNode
+  6: i64 numAcksFromNode
+  // Round trip time of last acked ping in microseconds
+  7: i64 lastRttUs
+  // Histogram of ping round trip times. Maps bucket upper bound (power of two)
+  // in microseconds to number of acks within it
+  8: map<i64, i64> rttHistogramUs
 }
 
 struct HealthCheckerInfo {
@@ -64,6 +64,33 @@ enum Command {
 //
 
 // parameters for the KEY_SET command
+// Compact TTL refresh of a key, carrying only what is needed to match and
+// refresh the value held by the receiver (see KeySetParams.ttlUpdates)
+struct TtlUpdate {
+  1: string key;
+  2: i64 version;
+  3: string originatorId;
+  4: i64 ttlVersion;
+  5: i64 ttl;
+}
+
+// Value of a key encoded as a patch of the value it replaces, a previous
+// version held by the receiver (see KeySetParams.valueDeltas). New value is
+// base[0, headSize) + patch + base[size - tailSize, size)
+struct ValueDelta {
+  1: string key;
+  2: i64 version;
+  3: string originatorId;
+  4: i64 ttl;
+  5: i64 ttlVersion;
+  // version and hash of the base value
+  6: i64 baseVersion;
+  7: i64 baseHash;
+  8: i32 headSize;
+  9: i32 tailSize;
+  10: binary patch;
+}
+
 struct KeySetParams {
   // NOTE: the struct is denormalized on purpose,
   // it may happen so we repeat originatorId
@@ -82,6 +109,21 @@ struct KeySetParams {
   // optional flood root-id, indicating which SPT this publication should be
   // flooded on; if none, flood to all peers
   6: optional string floodRootId;
+
+  // TTL refreshes batched over a flood interval. Applied as value-less
+  // keyVals by the receiver
+  7: optional list<TtlUpdate> ttlUpdates;
+
+  // Large values encoded against their previous version. Applied as full
+  // keyVals by the receiver if it holds the base value
+  8: optional list<ValueDelta> valueDeltas;
+}
+
+// Flood requests sent to a peer over its stream, see
+// OpenrCtrlCpp.subscribeKvStorePeer. Requests queued while the peer is
+// behind are sent together in one batch
+struct KeySetParamsBatch {
+  1: list<KeySetParams> keySetParams;
 }
 
 // parameters for the KEY_GET command
@@ -89,6 +131,15 @@ struct KeyGetParams {
   1: list<string> keys
 }
 
+// Digests of key ranges for range sync. The store is split into fanout^level
+// ranges at each level by the top bits of the key hash, down to the leaf
+// level. A range digest combines the key, version, originatorId, hash and
+// ttlVersion of all keys in it
+struct KeyRangeDigests {
+  1: i32 level
+  2: map<i64, i64> digests
+}
+
 // parameters for the KEY_DUMP command
 // if request includes keyValHashes information from peer, only respsond with
 // keyVals on which hash differs
@@ -98,6 +149,20 @@ struct KeyDumpParams {
   1: string prefix
   3: set<string> originatorIds
   2: optional KeyVals keyValHashes
+  // range sync: digests of key ranges to compare against. Peer responds with
+  // digests of the sub-ranges of differing ranges (see KeyRangeDigests)
+  4: optional KeyRangeDigests keyRangeDigests
+  // range sync: leaf ranges keyValHashes are for. Peer responds with the
+  // difference of its keys within these ranges only
+  5: optional set<i64> keyRanges
+  // hash-only mode: values are left out, hashes are set instead
+  6: bool doNotPublishValue = false
+  // paging: nextCursor of the previous page, keys after it only. Along with
+  // a cursor, keyValHashes are of the first limit keys after it only
+  7: optional string cursor
+  // paging: max number of keys per page, keys are dumped in key order.
+  // Unlimited if 0
+  8: i32 limit = 0
 }
 
 // Peer's publication and command socket URLs
@@ -210,6 +275,23 @@ struct Publication {
   // optional flood root-id, indicating which SPT this publication should be
   // flooded on; if none, flood to all peers
   6: optional string floodRootId;
+
+  // range sync: digests of the sub-ranges of the ranges which differ from
+  // the full-sync request. Only used in full-sync response
+  7: optional KeyRangeDigests keyRangeDigests;
+
+  // paging: last key covered by this page of a dump with limit, if keys
+  // after it are left for the next page
+  8: optional string nextCursor;
+}
+
+// Snapshot of the key-values of a KvStore, written to disk periodically and
+// loaded on restart as unconfirmed state, see KvStore.md
+struct KvStoreSnapshot {
+  // key-values with their ttl remaining at the time of the snapshot
+  1: KeyVals keyVals;
+  // wall clock time of the snapshot in ms since epoch
+  2: i64 timestampMs = 0;
 }
 
 // Dump of the current peers: sent in
@@ -102,4 +102,8 @@ struct UnicastRoute {
   7: bool doNotInstall = false
 
   41: optional NextHopThrift bestNexthop
+
+  // If set, nextHops are left empty and must be looked up in nextHopGroups of
+  // the enclosing RouteDatabaseDelta
+  42: optional i64 nextHopGroupId
 }
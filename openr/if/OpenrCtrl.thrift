@@ -38,6 +38,34 @@ exception OpenrError {
   1: string message
 } ( message = "message" )
 
+/**
+ * Allocator statistics of one jemalloc arena
+ */
+struct ArenaMemoryStats {
+  1: i32 index
+  2: i64 numThreads
+  3: i64 activeBytes
+  4: i64 dirtyBytes
+  // bytes cached in thread caches of threads assigned to this arena
+  5: i64 tcacheBytes
+}
+
+/**
+ * Memory usage of the process. Allocator statistics are only filled in when
+ * running with jemalloc
+ */
+struct MemoryStats {
+  1: i64 rssBytes
+  2: bool usingJemalloc
+  3: i64 allocatedBytes
+  4: i64 activeBytes
+  5: i64 residentBytes
+  6: i64 mappedBytes
+  7: i64 retainedBytes
+  8: i64 metadataBytes
+  9: list<ArenaMemoryStats> arenas
+}
+
 /**
  * Thrift service - exposes RPC APIs for interaction with all of Open/R's
  * modules.
@@ -72,6 +100,16 @@ service OpenrCtrl extends fb303.FacebookService {
   void withdrawPrefixes(1: list<Lsdb.PrefixEntry> prefixes)
     throws (1: OpenrError error)
 
+  /**
+   * Advertise and withdraw prefixes in bulk, as one transaction. Nothing is
+   * applied if any prefix to withdraw is not advertised. Prefix database is
+   * persisted and advertised to KvStore only once for the whole update, use it
+   * instead of many advertisePrefixes/withdrawPrefixes calls.
+   */
+  void updatePrefixes(
+    1: list<Lsdb.PrefixEntry> prefixesToAdvertise,
+    2: list<Lsdb.PrefixEntry> prefixesToWithdraw) throws (1: OpenrError error)
+
   /**
    * Withdraw prefixes in bulk by type (aka client-id)
    */
@@ -108,6 +146,13 @@ service OpenrCtrl extends fb303.FacebookService {
   Fib.RouteDatabase getRouteDb()
     throws (1: OpenrError error)
 
+  /**
+   * Get longest matching route of address from FIB module, with all its
+   * nexthops. Fails if there is no route covering address
+   */
+  Network.UnicastRoute getRouteForAddress(1: Network.BinaryAddress address)
+    throws (1: OpenrError error)
+
   /**
    * Get route database from decision module. Since Decision has global
    * topology information, any node can be retrieved
@@ -115,6 +160,12 @@ service OpenrCtrl extends fb303.FacebookService {
   Fib.RouteDatabase getRouteDbComputed(1: string nodeName)
     throws (1: OpenrError error)
 
+  /**
+   * Same as getRouteDbComputed, filtered and paged by query
+   */
+  Decision.RouteDbPage getRouteDbComputedPage(1: Decision.DecisionQuery query)
+    throws (1: OpenrError error)
+
   /**
    * Get route database of the current node which are not installable.
    */
@@ -151,6 +202,17 @@ service OpenrCtrl extends fb303.FacebookService {
    */
   Decision.PrefixDbs getDecisionPrefixDbs() throws (1: OpenrError error)
 
+  /**
+   * Same as getDecisionAdjacencyDbs and getDecisionPrefixDbs, filtered and
+   * paged by query
+   */
+  Decision.AdjDbsPage getDecisionAdjacencyDbsPage(
+    1: Decision.DecisionQuery query
+  ) throws (1: OpenrError error)
+  Decision.PrefixDbsPage getDecisionPrefixDbsPage(
+    1: Decision.DecisionQuery query
+  ) throws (1: OpenrError error)
+
   //
   // HealthChecker APIs
   //
@@ -320,4 +382,31 @@ service OpenrCtrl extends fb303.FacebookService {
 
   // Get Openr Node Name
   string getMyNodeName()
+
+  //
+  // Memory APIs
+  //
+
+  /**
+   * Get resident memory of the process and allocator statistics
+   */
+  MemoryStats getMemoryStats() throws (1: OpenrError error)
+
+  /**
+   * Dump jemalloc heap profile to file at path. Requires the daemon to run
+   * with heap profiling enabled, e.g. MALLOC_CONF=prof:true
+   */
+  void dumpHeapProfile(1: string path) throws (1: OpenrError error)
+
+  //
+  // Event loop APIs
+  //
+
+  /**
+   * Enable or disable profiling of the event loops of all modules. While
+   * enabled, thread CPU time of each command, socket and timer handler is
+   * accumulated and exported as <module>.loop_profile.<handler>.cpu_us and
+   * .calls counters
+   */
+  void setEventLoopProfiling(1: bool enabled)
 }
@@ -7,7 +7,9 @@
 
 namespace cpp2 openr.thrift
 
+include "Fib.thrift"
 include "KvStore.thrift"
+include "Lsdb.thrift"
 include "OpenrCtrl.thrift"
 
 /**
@@ -28,4 +30,44 @@ service OpenrCtrlCpp extends OpenrCtrl.OpenrCtrl {
    * There may be some replicated entries in stream that are also in snapshot.
    */
   KvStore.Publication, stream<KvStore.Publication> subscribeAndGetKvStore()
+
+  /**
+   * Subscribe KvStore updates matching the filter. Keys are matched on the
+   * server, and values are left out in hash-only mode (doNotPublishValue),
+   * before updates are sent. Only key prefixes are matched for expired keys
+   */
+  stream<KvStore.Publication> subscribeKvStoreFilter(
+    1: KvStore.KeyDumpParams filter
+  )
+
+  /**
+   * Same as subscribeAndGetKvStore with server side filtering of both the
+   * snapshot and the stream, see subscribeKvStoreFilter
+   */
+  KvStore.Publication, stream<KvStore.Publication>
+  subscribeAndGetKvStoreFiltered(1: KvStore.KeyDumpParams filter)
+
+  /**
+   * Retrieve Fib's route database (same as getRouteDb) and subscribe changes
+   * of it. No change between snapshot and stream is lost, some may be part of
+   * both. Unicast routes of deltas refer to nextHopGroups of the delta, routes
+   * which are not installed are sent as deleted.
+   */
+  Fib.RouteDatabase, stream<Fib.RouteDatabaseDelta> subscribeAndGetFib()
+
+  /**
+   * Retrieve Fib's perf database (same as getPerfDb) and subscribe
+   * convergence timelines completed by Fib afterwards, one per event which
+   * led to route programming. Some timelines may be part of both.
+   */
+  Fib.PerfDatabase, stream<Lsdb.PerfEvents> subscribeAndGetPerfDb()
+
+  /**
+   * Peer transport of KvStore. Flood requests KvStore would send to peer
+   * `peerName` over ZMQ are sent over this stream instead, for as long as it
+   * is subscribed. Full-syncs keep using ZMQ. Requests are batched while the
+   * subscriber is behind, and if it falls too far behind the requests are
+   * queued in KvStore and coalesced as for a congested ZMQ peer
+   */
+  stream<KvStore.KeySetParamsBatch> subscribeKvStorePeer(1: string peerName)
 }
@@ -87,11 +87,29 @@ enum SwitchRunState {
    LINK_EVENT = 1,
    ADDRESS_EVENT = 2,
    NEIGHBOR_EVENT = 3,
+   /*
+    * Batch of coalesced link/address/neighbor changes, see PlatformEventBatch
+    */
+   BATCH_EVENT = 4,
  }
 
 struct PlatformEvent {
   1: PlatformEventType eventType;
   2: binary eventData;
+  // incremented by one on each event of the same eventType published,
+  // starting at 1 when publisher starts. Lets subscribers of an eventType
+  // detect events dropped on the way
+  3: optional i64 seqNum;
+}
+
+/**
+ * Events coalesced within a short window, only last state of each link,
+ * address or neighbor is kept
+ */
+struct PlatformEventBatch {
+  1: list<LinkEntry> linkEntries;
+  2: list<AddrEntry> addrEntries;
+  3: list<NeighborEntry> neighborEntries;
 }
 
 exception PlatformError {
@@ -194,6 +212,29 @@ service FibService extends fb303.FacebookService {
     2: list<Network.UnicastRoute> routes,
   ) throws (1: PlatformError error)
 
+  // Chunked alternative of syncFib (and syncMplsFib if syncMpls is set) for
+  // large route tables. beginSyncFib starts sync session of client and
+  // returns its id, superseding any previous session of the client. Routes
+  // are then provided in any number of syncFibChunk calls and programmed as
+  // they are received. commitSyncFib deletes routes of client which weren't
+  // part of any chunk and ends the session
+  i64 beginSyncFib(
+    1: i16 clientId,
+    2: bool syncMpls,
+  ) throws (1: PlatformError error)
+
+  void syncFibChunk(
+    1: i16 clientId,
+    2: i64 syncId,
+    3: list<Network.UnicastRoute> unicastRoutes,
+    4: list<Network.MplsRoute> mplsRoutes,
+  ) throws (1: PlatformError error)
+
+  void commitSyncFib(
+    1: i16 clientId,
+    2: i64 syncId,
+  ) throws (1: PlatformError error)
+
   // Retreive list of unicast routes per client
   list<Network.UnicastRoute> getRouteTableByClient(
     1: i16 clientId
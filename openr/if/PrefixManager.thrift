@@ -19,6 +19,7 @@ enum PrefixManagerCommand {
   SYNC_PREFIXES_BY_TYPE = 6,
   GET_ALL_PREFIXES = 4,
   GET_PREFIXES_BY_TYPE = 5,
+  UPDATE_PREFIXES = 7,
 }
 
 struct PrefixManagerRequest {
@@ -27,6 +28,15 @@ struct PrefixManagerRequest {
   3: list<Lsdb.PrefixEntry> prefixes
   // only applies to *_BY_TYPE commands
   4: Network.PrefixType type
+  // only applies to UPDATE_PREFIXES, prefixes to withdraw in same request
+  5: list<Lsdb.PrefixEntry> withdrawPrefixes
+}
+
+// Changes of persistent prefixes since full prefix database was last saved to
+// disk. Saved instead of full database on every change
+struct PrefixDatabaseDelta {
+  1: list<Lsdb.PrefixEntry> prefixEntries
+  2: list<Network.IpPrefix> withdrawnPrefixes
 }
 
 struct PrefixManagerResponse {
@@ -64,6 +64,20 @@ struct ReflectedNeighborInfo {
   3: i64 lastMyMsgRcvdTsInUs = 0;
 }
 
+//
+// ReflectedNeighborInfo of compact hellos, with time of receipt relative to
+// timestamp of the hello packet carrying it
+//
+struct CompactReflectedNeighborInfo {
+  1: i64 seqNum = 0;
+
+  2: i64 lastNbrMsgSentTsInUs = 0;
+
+  // The hello packet timestamp minus lastMyMsgRcvdTsInUs, unset if the
+  // latter is 0
+  3: optional i64 lastMyMsgRcvdAgeInUs;
+}
+
 //
 // OpenR version
 //
@@ -95,6 +109,12 @@ struct SparkPayload {
 
   // indicating I'm going to restart gracefully
   9: optional bool restarting = 0;
+
+  // neighbor to hello packet timestamp information, keyed by 64 bit FNV-1
+  // hash of neighbor's node name instead of the name. If set, neighborInfos
+  // is empty. Only sent on interfaces where all neighbors have version of at
+  // least 20191014
+  10: optional map<i64, CompactReflectedNeighborInfo> compactNeighborInfos;
 }
 
 //
@@ -126,6 +146,13 @@ struct SparkNeighborEvent {
   6: bool supportFloodOptimization = 0
 }
 
+//
+// Neighbor events reported together, in the order they happened
+//
+struct SparkNeighborEvents {
+  1: list<SparkNeighborEvent> events
+}
+
 //
 // Spark result status
 //
@@ -7,13 +7,16 @@
 
 #include "KvStore.h"
 
-#include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/Random.h>
 #include <folly/String.h>
+#include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/OpenrClient.h>
 #include <openr/common/Util.h>
 
 using namespace std::chrono_literals;
@@ -21,6 +24,230 @@ using namespace std::chrono;
 
 namespace openr {
 
+namespace {
+
+static_assert(
+    Constants::kKvStoreSyncRangeLevels % 2 == 0,
+    "full-sync initiator must compare the leaf key ranges");
+
+const int32_t kLeafRangeBits =
+    Constants::kKvStoreSyncRangeBits * Constants::kKvStoreSyncRangeLevels;
+
+// key range digests are exchanged between nodes, hash functions must not
+// differ across builds
+uint64_t
+getKeyHash(std::string const& key) {
+  return folly::hash::fnv64(key);
+}
+
+uint64_t
+getKeyDigest(std::string const& key, thrift::Value const& value) {
+  uint64_t digest = getKeyHash(key);
+  digest = folly::hash::hash_128_to_64(digest, value.version);
+  digest = folly::hash::hash_128_to_64(
+      digest, folly::hash::fnv64(value.originatorId));
+  digest = folly::hash::hash_128_to_64(digest, value.hash.value_or(0));
+  return folly::hash::hash_128_to_64(digest, value.ttlVersion);
+}
+
+// sub-ranges of the given ranges, one level down
+std::vector<int64_t>
+getSubRanges(std::vector<int64_t> const& ranges) {
+  const int64_t fanout = int64_t{1} << Constants::kKvStoreSyncRangeBits;
+  std::vector<int64_t> subRanges;
+  subRanges.reserve(ranges.size() * fanout);
+  for (auto const range : ranges) {
+    for (int64_t i = 0; i < fanout; ++i) {
+      subRanges.emplace_back((range << Constants::kKvStoreSyncRangeBits) | i);
+    }
+  }
+  return subRanges;
+}
+
+// Copy of value with its hash instead of its value, as in hash dumps
+thrift::Value
+getHashValue(thrift::Value const& value) {
+  DCHECK(value.hash.hasValue());
+  thrift::Value hashValue;
+  hashValue.version = value.version;
+  hashValue.originatorId = value.originatorId;
+  hashValue.hash = value.hash;
+  hashValue.ttl = value.ttl;
+  hashValue.ttlVersion = value.ttlVersion;
+  return hashValue;
+}
+
+// Number of contiguous shards to split size items in, to be processed over
+// executor. A single shard is processed inline
+size_t
+getNumShards(folly::CPUThreadPoolExecutor* executor, size_t size) {
+  if (not executor or size < Constants::kKvStoreParallelMinKeys) {
+    return 1;
+  }
+  return std::min(
+      size, executor->numThreads() * Constants::kKvStoreShardsPerThread);
+}
+
+// Call shardFn(shard, begin, end) for numShards contiguous shards of
+// [0, size) over executor and wait for all of them
+template <typename ShardFn>
+void
+forEachShard(
+    folly::CPUThreadPoolExecutor* executor,
+    size_t numShards,
+    size_t size,
+    ShardFn const& shardFn) {
+  if (numShards <= 1) {
+    shardFn(0, 0, size);
+    return;
+  }
+  CHECK(executor);
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(numShards);
+  for (size_t shard = 0; shard < numShards; ++shard) {
+    const size_t begin = size * shard / numShards;
+    const size_t end = size * (shard + 1) / numShards;
+    futures.emplace_back(folly::via(executor, [&shardFn, shard, begin, end]() {
+      shardFn(shard, begin, end);
+    }));
+  }
+  for (auto& res : folly::collectAll(futures).get()) {
+    res.throwIfFailed();
+  }
+}
+
+// How a key-value of an update is merged into the store
+enum class MergeType {
+  SKIP,
+  UPDATE_ALL,
+  UPDATE_TTL,
+};
+
+// Decide how key-value of an update is merged into kvStore. Only reads
+// kvStore, hence can run concurrently for different keys
+MergeType
+getMergeType(
+    std::unordered_map<std::string, thrift::Value> const& kvStore,
+    std::string const& key,
+    thrift::Value const& value,
+    folly::Optional<KvStoreFilters> const& filters) {
+  if (filters.hasValue() && not filters->keyMatch(key, value)) {
+    VLOG(4) << "key: " << key << " not adding from " << value.originatorId;
+    return MergeType::SKIP;
+  }
+
+  // versions must start at 1; setting this to zero here means
+  // we would be beaten by any version supplied by the setter
+  int64_t myVersion{0};
+  int64_t newVersion = value.version;
+
+  // Check if TTL is valid. It must be infinite or positive number
+  // Skip if invalid!
+  if (value.ttl != Constants::kTtlInfinity && value.ttl <= 0) {
+    return MergeType::SKIP;
+  }
+
+  // if key exist, compare values first
+  // if they are the same, no need to propagate changes
+  auto kvStoreIt = kvStore.find(key);
+  if (kvStoreIt != kvStore.end()) {
+    myVersion = kvStoreIt->second.version;
+  } else {
+    VLOG(4) << "(mergeKeyValues) key: '" << key << "' not found, adding";
+  }
+
+  // If we get an old value just skip it
+  if (newVersion < myVersion) {
+    return MergeType::SKIP;
+  }
+
+  bool updateAllNeeded{false};
+  bool updateTtlNeeded{false};
+
+  //
+  // Check updateAll and updateTtl
+  //
+  if (value.value.hasValue()) {
+    if (newVersion > myVersion) {
+      // Version is newer or
+      // kvStoreIt is NULL(myVersion is set to 0)
+      updateAllNeeded = true;
+    } else if (value.originatorId > kvStoreIt->second.originatorId) {
+      // versions are the same but originatorId is higher
+      updateAllNeeded = true;
+    } else if (value.originatorId == kvStoreIt->second.originatorId) {
+      // This can occur after kvstore restarts or simply reconnects after
+      // disconnection. We let one of the two values win if they differ(higher
+      // in this case but can be lower as long as it's deterministic).
+      // Otherwise, local store can have new value while other stores have old
+      // value and they never sync.
+      int rc = (*value.value).compare(*kvStoreIt->second.value);
+      if (rc > 0) {
+        // versions and orginatorIds are same but value is higher
+        VLOG(3) << "Previous incarnation reflected back for key " << key;
+        updateAllNeeded = true;
+      } else if (rc == 0) {
+        // versions, orginatorIds, value are all same
+        // retain higher ttlVersion
+        if (value.ttlVersion > kvStoreIt->second.ttlVersion) {
+          updateTtlNeeded = true;
+        }
+      }
+    }
+  }
+
+  //
+  // Check updateTtl
+  //
+  if (not value.value.hasValue() and kvStoreIt != kvStore.end() and
+      value.version == kvStoreIt->second.version and
+      value.originatorId == kvStoreIt->second.originatorId and
+      value.ttlVersion > kvStoreIt->second.ttlVersion) {
+    updateTtlNeeded = true;
+  }
+
+  if (!updateAllNeeded and !updateTtlNeeded) {
+    VLOG(4) << "(mergeKeyValues) no need to update anything for key: '" << key
+            << "'";
+    return MergeType::SKIP;
+  }
+
+  VLOG(2) << "Updating key: " << key << "\n  Value: "
+          << (kvStoreIt != kvStore.end() && kvStoreIt->second.value.hasValue()
+                  ? kvStoreIt->second.value.value()
+                  : "null")
+          << " -> " << (value.value.hasValue() ? value.value.value() : "null")
+          << "\n  Version: " << myVersion << " -> " << newVersion
+          << "\n  Originator: "
+          << (kvStoreIt != kvStore.end() ? kvStoreIt->second.originatorId
+                                         : "null")
+          << " -> " << value.originatorId << "\n  TtlVersion: "
+          << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttlVersion : 0)
+          << " -> " << value.ttlVersion << "\n  Ttl: "
+          << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttl : 0)
+          << " -> " << value.ttl;
+
+  return updateAllNeeded ? MergeType::UPDATE_ALL : MergeType::UPDATE_TTL;
+}
+
+} // namespace
+
+std::string const*
+StringInternTable::intern(std::string const& str) {
+  auto it = strings_.emplace(str, 0).first;
+  ++it->second;
+  return &it->first;
+}
+
+void
+StringInternTable::release(std::string const* str) {
+  auto it = strings_.find(*str);
+  CHECK(it != strings_.end()) << "Releasing string not interned: " << *str;
+  if (--it->second == 0) {
+    strings_.erase(it);
+  }
+}
+
 KvStoreFilters::KvStoreFilters(
     std::vector<std::string> const& keyPrefix,
     std::set<std::string> const& nodeIds)
@@ -43,6 +270,11 @@ KvStoreFilters::keyMatch(
   return false;
 }
 
+bool
+KvStoreFilters::keyPrefixMatch(std::string const& key) const {
+  return keyPrefixList_.empty() or keyPrefixObjList_.keyMatch(key);
+}
+
 std::vector<std::string>
 KvStoreFilters::getKeyPrefixes() const {
   return keyPrefixList_;
@@ -53,6 +285,18 @@ KvStoreFilters::getOrigniatorIdList() const {
   return originatorIds_;
 }
 
+folly::Optional<std::vector<std::string>>
+KvStoreFilters::getLiteralKeyPrefixes() const {
+  if (keyPrefixList_.empty() or not originatorIds_.empty()) {
+    return folly::none;
+  }
+  if (not std::all_of(
+          keyPrefixList_.begin(), keyPrefixList_.end(), KeyPrefix::isLiteral)) {
+    return folly::none;
+  }
+  return keyPrefixList_;
+}
+
 std::string
 KvStoreFilters::str() const {
   std::string result{};
@@ -67,6 +311,20 @@ KvStoreFilters::str() const {
   return result;
 }
 
+struct KvStore::PeerStreamClient {
+  ~PeerStreamClient() {
+    if (subscription.hasValue()) {
+      subscription->cancel();
+      std::move(subscription.value()).detach();
+    }
+  }
+
+  // generation of the subscription, see peerStreamGenerations_
+  uint64_t generation{0};
+  std::unique_ptr<thrift::OpenrCtrlCppAsyncClient> client;
+  folly::Optional<apache::thrift::Subscription> subscription;
+};
+
 KvStore::KvStore(
     // initializers for immutable state
     fbzmq::Context& zmqContext,
@@ -86,7 +344,18 @@ KvStore::KvStore(
     std::chrono::milliseconds ttlDecr,
     bool enableFloodOptimization,
     bool isFloodRoot,
-    bool useFloodOptimization)
+    bool useFloodOptimization,
+    bool enableRangeSync,
+    bool enableTtlUpdateBatching,
+    size_t workerThreads,
+    bool enableValueDeltas,
+    bool enableDualMessageBatching,
+    folly::Optional<std::string> snapshotFilePath,
+    std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor,
+    size_t maxParallelSyncs,
+    KvStoreFloodRate originatorUpdateRate,
+    int32_t peerStreamPort,
+    bool enableSptFullSync)
     : OpenrEventLoop(
           nodeId,
           thrift::OpenrModuleType::KVSTORE,
@@ -94,7 +363,7 @@ KvStore::KvStore(
           std::string{globalCmdUrl},
           maybeIpTos,
           zmqHwm),
-      DualNode(nodeId, isFloodRoot),
+      DualNode(nodeId, isFloodRoot, enableDualMessageBatching),
       zmqContext_(zmqContext),
       nodeId_(std::move(nodeId)),
       localPubUrl_(std::move(localPubUrl)),
@@ -106,6 +375,9 @@ KvStore::KvStore(
       enableFloodOptimization_(enableFloodOptimization),
       isFloodRoot_(isFloodRoot),
       useFloodOptimization_(useFloodOptimization),
+      enableRangeSync_(enableRangeSync),
+      enableTtlUpdateBatching_(enableTtlUpdateBatching),
+      enableValueDeltas_(enableValueDeltas),
       filters_(std::move(filters)),
       // initialize zmq sockets
       localPubSock_{zmqContext},
@@ -115,11 +387,18 @@ KvStore::KvStore(
               Constants::kPeerSyncIdTemplate.toString(), nodeId_)},
           folly::none,
           fbzmq::NonblockingFlag{true}),
-      floodRate_(floodRate) {
+      maxParallelSyncs_(maxParallelSyncs),
+      enableSptFullSync_(enableSptFullSync),
+      floodRate_(floodRate),
+      originatorUpdateRate_(originatorUpdateRate),
+      peerStreamPort_(peerStreamPort),
+      snapshotFilePath_(std::move(snapshotFilePath)) {
   CHECK(not nodeId_.empty());
   CHECK(not localPubUrl_.empty());
   CHECK(not globalPubUrl_.empty());
 
+  leafRangeDigests_.resize(size_t{1} << kLeafRangeBits, 0);
+
   // allocate new global pub socket if not provided
   globalPubSock_ = fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER>(
       zmqContext,
@@ -132,14 +411,41 @@ KvStore::KvStore(
     floodLimiter_ = std::make_unique<folly::BasicTokenBucket<>>(
         floodRate_.value().first, // messages per sec
         floodRate_.value().second); // burst size
-    pendingPublicationTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-      if (!floodLimiter_->consume(1)) {
-        pendingPublicationTimer_->scheduleTimeout(
-            Constants::kFloodPendingPublication, false);
-        return;
-      }
-      floodBufferedUpdates();
-    });
+    pendingPublicationTimer_ = fbzmq::ZmqTimeout::make(
+        this, profiled("timer.pending_publication", [this]() noexcept {
+          if (!floodLimiter_->consume(1)) {
+            pendingPublicationTimer_->scheduleTimeout(
+                Constants::kFloodPendingPublication, false);
+            return;
+          }
+          floodBufferedUpdates();
+        }));
+  }
+
+  if (sharedExecutor) {
+    workerExecutor_ = std::move(sharedExecutor);
+  } else if (workerThreads > 0) {
+    workerExecutor_ =
+        std::make_unique<folly::CPUThreadPoolExecutor>(workerThreads);
+  }
+
+  if (enableTtlUpdateBatching_) {
+    ttlUpdateTimer_ = fbzmq::ZmqTimeout::make(
+        this, profiled("timer.ttl_update", [this]() noexcept {
+          floodBufferedTtlUpdates();
+        }));
+  }
+
+  if (enableDualMessageBatching) {
+    dualMessagesTimer_ = fbzmq::ZmqTimeout::make(
+        this, profiled("timer.dual_messages", [this]() noexcept {
+          DualNode::flushDualMessages();
+        }));
+  }
+
+  if (peerStreamPort_ > 0) {
+    peerStreamEvbThread_ =
+        std::make_unique<folly::ScopedEventBaseThread>("KvStorePeerStream");
   }
 
   zmqMonitorClient_ =
@@ -147,8 +453,8 @@ KvStore::KvStore(
 
   // Schedule periodic timer for counters submission
   const bool isPeriodic = true;
-  monitorTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+  monitorTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.monitor", [this]() noexcept { submitCounters(); }));
   monitorTimer_->scheduleTimeout(monitorSubmitInterval_, isPeriodic);
 
   //
@@ -250,7 +556,32 @@ KvStore::KvStore(
   // Hook up timer with cleanupTtlCountdownQueue(). The actual scheduling
   // happens within updateTtlCountdownQueue()
   ttlCountdownTimer_ = fbzmq::ZmqTimeout::make(
-      this, [this]() noexcept { cleanupTtlCountdownQueue(); });
+      this, profiled("timer.ttl_countdown", [this]() noexcept {
+        cleanupTtlCountdownQueue();
+      }));
+
+  peerPendingTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.peer_pending", [this]() noexcept {
+        floodPeerPendingKeys();
+      }));
+
+  if (snapshotFilePath_.hasValue()) {
+    loadSnapshot();
+    snapshotTimer_ = fbzmq::ZmqTimeout::make(
+        this,
+        profiled("timer.snapshot", [this]() noexcept { writeSnapshot(); }));
+    snapshotTimer_->scheduleTimeout(
+        Constants::kKvStoreSnapshotInterval, isPeriodic);
+  }
+}
+
+KvStore::~KvStore() {
+  if (peerStreamEvbThread_) {
+    // clients must be destroyed in their event base
+    peerStreamEvbThread_->getEventBase()->runInEventBaseThreadAndWait(
+        [this]() { peerStreamClients_.clear(); });
+    peerStreamEvbThread_.reset();
+  }
 }
 
 // static, public
@@ -258,140 +589,48 @@ std::unordered_map<std::string, thrift::Value>
 KvStore::mergeKeyValues(
     std::unordered_map<std::string, thrift::Value>& kvStore,
     std::unordered_map<std::string, thrift::Value> const& keyVals,
-    folly::Optional<KvStoreFilters> const& filters) {
+    folly::Optional<KvStoreFilters> const& filters,
+    folly::CPUThreadPoolExecutor* executor) {
   // the publication to build if we update our KV store
   std::unordered_map<std::string, thrift::Value> kvUpdates;
 
   // Counters for logging
   uint32_t ttlUpdateCnt{0}, valUpdateCnt{0};
 
-  for (const auto& kv : keyVals) {
-    auto const& key = kv.first;
-    auto const& value = kv.second;
-
-    if (filters.hasValue() && not filters->keyMatch(kv.first, kv.second)) {
-      VLOG(4) << "key: " << key << " not adding from " << value.originatorId;
-      continue;
-    }
-
-    // versions must start at 1; setting this to zero here means
-    // we would be beaten by any version supplied by the setter
-    int64_t myVersion{0};
-    int64_t newVersion = value.version;
-
-    // Check if TTL is valid. It must be infinite or positive number
-    // Skip if invalid!
-    if (value.ttl != Constants::kTtlInfinity && value.ttl <= 0) {
-      continue;
-    }
-
-    // if key exist, compare values first
-    // if they are the same, no need to propagate changes
-    auto kvStoreIt = kvStore.find(key);
-    if (kvStoreIt != kvStore.end()) {
-      myVersion = kvStoreIt->second.version;
-    } else {
-      VLOG(4) << "(mergeKeyValues) key: '" << key << "' not found, adding";
-    }
-
-    // If we get an old value just skip it
-    if (newVersion < myVersion) {
-      continue;
-    }
-
-    bool updateAllNeeded{false};
-    bool updateTtlNeeded{false};
-
-    //
-    // Check updateAll and updateTtl
-    //
-    if (value.value.hasValue()) {
-      if (newVersion > myVersion) {
-        // Version is newer or
-        // kvStoreIt is NULL(myVersion is set to 0)
-        updateAllNeeded = true;
-      } else if (value.originatorId > kvStoreIt->second.originatorId) {
-        // versions are the same but originatorId is higher
-        updateAllNeeded = true;
-      } else if (value.originatorId == kvStoreIt->second.originatorId) {
-        // This can occur after kvstore restarts or simply reconnects after
-        // disconnection. We let one of the two values win if they differ(higher
-        // in this case but can be lower as long as it's deterministic).
-        // Otherwise, local store can have new value while other stores have old
-        // value and they never sync.
-        int rc = (*value.value).compare(*kvStoreIt->second.value);
-        if (rc > 0) {
-          // versions and orginatorIds are same but value is higher
-          VLOG(3) << "Previous incarnation reflected back for key " << key;
-          updateAllNeeded = true;
-        } else if (rc == 0) {
-          // versions, orginatorIds, value are all same
-          // retain higher ttlVersion
-          if (value.ttlVersion > kvStoreIt->second.ttlVersion) {
-            updateTtlNeeded = true;
-          }
-        }
-      }
-    }
-
-    //
-    // Check updateTtl
-    //
-    if (not value.value.hasValue() and kvStoreIt != kvStore.end() and
-        value.version == kvStoreIt->second.version and
-        value.originatorId == kvStoreIt->second.originatorId and
-        value.ttlVersion > kvStoreIt->second.ttlVersion) {
-      updateTtlNeeded = true;
-    }
-
-    if (!updateAllNeeded and !updateTtlNeeded) {
-      VLOG(4) << "(mergeKeyValues) no need to update anything for key: '" << key
-              << "'";
-      continue;
+  // apply the merge of a key-value, hash is used for the new value if it
+  // comes without one
+  auto const mergeKeyValue = [&](std::string const& key,
+                                 thrift::Value const& value,
+                                 MergeType mergeType,
+                                 folly::Optional<int64_t> const& hash) {
+    if (mergeType == MergeType::SKIP) {
+      return;
     }
 
-    VLOG(2) << "Updating key: " << key << "\n  Value: "
-            << (kvStoreIt != kvStore.end() && kvStoreIt->second.value.hasValue()
-                    ? kvStoreIt->second.value.value()
-                    : "null")
-            << " -> " << (value.value.hasValue() ? value.value.value() : "null")
-            << "\n  Version: " << myVersion << " -> " << newVersion
-            << "\n  Originator: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.originatorId
-                                           : "null")
-            << " -> " << value.originatorId << "\n  TtlVersion: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttlVersion : 0)
-            << " -> " << value.ttlVersion << "\n  Ttl: "
-            << (kvStoreIt != kvStore.end() ? kvStoreIt->second.ttl : 0)
-            << " -> " << value.ttl;
-
-    // grab the new value (this will copy, intended)
-    thrift::Value newValue = value;
-
     VLOG(4) << "(mergeKeyValues) Inserting/Updating key: '" << key << "'";
 
-    if (updateAllNeeded) {
+    auto kvStoreIt = kvStore.find(key);
+    if (mergeType == MergeType::UPDATE_ALL) {
       ++valUpdateCnt;
       //
       // update everything for such key
       //
       CHECK(value.value.hasValue());
+      // grab the new value (this will copy, intended)
       if (kvStoreIt == kvStore.end()) {
         // create new entry
-        std::tie(kvStoreIt, std::ignore) = kvStore.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(key),
-            std::forward_as_tuple(std::move(newValue)));
+        std::tie(kvStoreIt, std::ignore) = kvStore.emplace(key, value);
       } else {
         // update the entry in place, the old value will be destructed
-        kvStoreIt->second = std::move(newValue);
+        kvStoreIt->second = value;
       }
       // update hash if it's not there
       if (not kvStoreIt->second.hash.hasValue()) {
-        kvStoreIt->second.hash =
-            generateHash(value.version, value.originatorId, value.value);
+        kvStoreIt->second.hash = hash.hasValue()
+            ? hash.value()
+            : generateHash(value.version, value.originatorId, value.value);
       }
-    } else if (updateTtlNeeded) {
+    } else {
       ++ttlUpdateCnt;
       //
       // update ttl,ttlVersion only
@@ -405,6 +644,51 @@ KvStore::mergeKeyValues(
 
     // announce the update
     kvUpdates.emplace(key, value);
+  };
+
+  const size_t numShards = getNumShards(executor, keyVals.size());
+  if (numShards == 1) {
+    for (const auto& kv : keyVals) {
+      mergeKeyValue(
+          kv.first,
+          kv.second,
+          getMergeType(kvStore, kv.first, kv.second, filters),
+          folly::none);
+    }
+  } else {
+    // Compare values and compute missing hashes in key shards over executor,
+    // kvStore is only read meanwhile. Updates are then applied in the same
+    // order as above, hence the result doesn't differ
+    std::vector<std::pair<const std::string, thrift::Value> const*> entries;
+    entries.reserve(keyVals.size());
+    for (auto const& kv : keyVals) {
+      entries.emplace_back(&kv);
+    }
+    std::vector<MergeType> mergeTypes(entries.size(), MergeType::SKIP);
+    std::vector<folly::Optional<int64_t>> hashes(entries.size());
+
+    forEachShard(
+        executor,
+        numShards,
+        entries.size(),
+        [&kvStore, &filters, &entries, &mergeTypes, &hashes](
+            size_t /* shard */, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            auto const& key = entries[i]->first;
+            auto const& value = entries[i]->second;
+            mergeTypes[i] = getMergeType(kvStore, key, value, filters);
+            if (mergeTypes[i] == MergeType::UPDATE_ALL and
+                not value.hash.hasValue()) {
+              hashes[i] =
+                  generateHash(value.version, value.originatorId, value.value);
+            }
+          }
+        });
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+      mergeKeyValue(
+          entries[i]->first, entries[i]->second, mergeTypes[i], hashes[i]);
+    }
   }
 
   VLOG(4) << "(mergeKeyValues) updating " << kvUpdates.size()
@@ -418,25 +702,43 @@ KvStore::updateTtlCountdownQueue(const thrift::Publication& publication) {
   for (const auto& kv : publication.keyVals) {
     const auto& key = kv.first;
     const auto& value = kv.second;
-
-    if (value.ttl != Constants::kTtlInfinity) {
-      TtlCountdownQueueEntry queueEntry;
-      queueEntry.expiryTime = std::chrono::steady_clock::now() +
-          std::chrono::milliseconds(value.ttl);
-      queueEntry.key = key;
-      queueEntry.version = value.version;
-      queueEntry.ttlVersion = value.ttlVersion;
-      queueEntry.originatorId = value.originatorId;
-
-      if ((ttlCountdownQueue_.empty() or
-           (queueEntry.expiryTime <= ttlCountdownQueue_.top().expiryTime)) and
-          ttlCountdownTimer_) {
-        // Reschedule the shorter timeout
-        ttlCountdownTimer_->scheduleTimeout(
-            std::chrono::milliseconds(value.ttl));
+    auto handleIt = ttlCountdownHandles_.find(key);
+
+    if (value.ttl == Constants::kTtlInfinity) {
+      // Key will never expire, drop entry of its previous value if any
+      if (handleIt != ttlCountdownHandles_.end()) {
+        ttlOriginatorIds_.release((*handleIt->second).originatorId);
+        ttlCountdownQueue_.erase(handleIt->second);
+        ttlCountdownHandles_.erase(handleIt);
       }
+      continue;
+    }
 
-      ttlCountdownQueue_.push(std::move(queueEntry));
+    TtlCountdownQueueEntry queueEntry;
+    queueEntry.expiryTime = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(value.ttl);
+    queueEntry.version = value.version;
+    queueEntry.ttlVersion = value.ttlVersion;
+    queueEntry.originatorId = ttlOriginatorIds_.intern(value.originatorId);
+
+    if ((ttlCountdownQueue_.empty() or
+         (queueEntry.expiryTime <= ttlCountdownQueue_.top().expiryTime)) and
+        ttlCountdownTimer_) {
+      // Reschedule the shorter timeout
+      ttlCountdownTimer_->scheduleTimeout(std::chrono::milliseconds(value.ttl));
+    }
+
+    if (handleIt == ttlCountdownHandles_.end()) {
+      handleIt =
+          ttlCountdownHandles_.emplace(key, TtlCountdownQueue::handle_type())
+              .first;
+      queueEntry.key = &handleIt->first;
+      handleIt->second = ttlCountdownQueue_.push(std::move(queueEntry));
+    } else {
+      // Refresh existing entry of the key in place
+      ttlOriginatorIds_.release((*handleIt->second).originatorId);
+      queueEntry.key = &handleIt->first;
+      ttlCountdownQueue_.update(handleIt->second, queueEntry);
     }
   }
 }
@@ -452,23 +754,89 @@ KvStore::getKeyVals(std::vector<std::string> const& keys) {
     auto it = kvStore_.find(key);
     if (it != kvStore_.end()) {
       // copy here
-      thriftPub.keyVals[key] = it->second;
+      thriftPub.keyVals.emplace(key, it->second);
     }
   }
   return thriftPub;
 }
 
+std::vector<std::pair<const std::string, thrift::Value> const*>
+KvStore::getMatchingKeyVals(KvStoreFilters const& kvFilters) const {
+  std::vector<std::pair<const std::string, thrift::Value> const*> keyVals;
+  auto const keyPrefixes = kvFilters.getLiteralKeyPrefixes();
+  if (not keyPrefixes.hasValue()) {
+    for (auto const& kv : kvStore_) {
+      if (kvFilters.keyMatch(kv.first, kv.second)) {
+        keyVals.emplace_back(&kv);
+      }
+    }
+    return keyVals;
+  }
+
+  // visit sorted keys under each prefix. Skip prefixes covered by a shorter
+  // one to not visit keys twice
+  std::set<std::string> prefixes(keyPrefixes->begin(), keyPrefixes->end());
+  folly::Optional<folly::StringPiece> lastPrefix;
+  for (auto const& prefix : prefixes) {
+    if (lastPrefix.hasValue() and
+        folly::StringPiece(prefix).startsWith(*lastPrefix)) {
+      continue;
+    }
+    lastPrefix = folly::StringPiece(prefix);
+    for (auto it = sortedKeyVals_.lower_bound(prefix);
+         it != sortedKeyVals_.end() and it->first.startsWith(prefix);
+         ++it) {
+      keyVals.emplace_back(it->second);
+    }
+  }
+  return keyVals;
+}
+
 // dump the entries of my KV store whose keys match the given prefix
 // if prefix is the empty string, the full KV store is dumped
 thrift::Publication
-KvStore::dumpAllWithFilters(KvStoreFilters const& kvFilters) const {
-  thrift::Publication thriftPub;
+KvStore::dumpAllWithFilters(
+    KvStoreFilters const& kvFilters,
+    folly::Optional<std::set<int64_t>> const& leafRanges) const {
+  auto const keyVals = getMatchingKeyVals(kvFilters);
+
+  // copy matching key-values in key shards, possibly on worker threads. TTLs
+  // are set to the time left while copying, instead of in another pass over
+  // the dump on the KvStore thread
+  const auto timeNow = std::chrono::steady_clock::now();
+  const auto numShards = getNumShards(workerExecutor_.get(), keyVals.size());
+  std::vector<std::vector<std::pair<std::string, thrift::Value>>> shards(
+      numShards);
+  forEachShard(
+      workerExecutor_.get(),
+      numShards,
+      keyVals.size(),
+      [this, &keyVals, &leafRanges, &shards, timeNow](
+          size_t shard, size_t begin, size_t end) {
+        auto& shardKeyVals = shards.at(shard);
+        shardKeyVals.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+          auto const& kv = *keyVals[i];
+          if (leafRanges.hasValue() and
+              not leafRanges->count(
+                  getKeyRange(kv.first, Constants::kKvStoreSyncRangeLevels))) {
+            continue;
+          }
+          auto ttl = getTtlToSend(kv.first, kv.second, timeNow, false);
+          if (not ttl.hasValue()) {
+            continue;
+          }
+          shardKeyVals.emplace_back(kv.first, kv.second);
+          shardKeyVals.back().second.ttl = ttl.value();
+        }
+      });
 
-  for (auto const& kv : kvStore_) {
-    if (not kvFilters.keyMatch(kv.first, kv.second)) {
-      continue;
+  thrift::Publication thriftPub;
+  thriftPub.keyVals.reserve(keyVals.size());
+  for (auto& shardKeyVals : shards) {
+    for (auto& kv : shardKeyVals) {
+      thriftPub.keyVals.emplace(std::move(kv.first), std::move(kv.second));
     }
-    thriftPub.keyVals[kv.first] = kv.second;
   }
   return thriftPub;
 }
@@ -476,23 +844,273 @@ KvStore::dumpAllWithFilters(KvStoreFilters const& kvFilters) const {
 // dump the hashes of my KV store whose keys match the given prefix
 // if prefix is the empty string, the full hash store is dumped
 thrift::Publication
-KvStore::dumpHashWithFilters(KvStoreFilters const& kvFilters) const {
+KvStore::dumpHashWithFilters(
+    KvStoreFilters const& kvFilters,
+    folly::Optional<std::set<int64_t>> const& leafRanges) {
+  auto const& hashDump = getHashDump(kvFilters);
+
   thrift::Publication thriftPub;
-  for (auto const& kv : kvStore_) {
+  if (not leafRanges.hasValue()) {
+    thriftPub.keyVals = hashDump;
+    return thriftPub;
+  }
+  for (auto const& kv : hashDump) {
+    if (leafRanges->count(
+            getKeyRange(kv.first, Constants::kKvStoreSyncRangeLevels))) {
+      thriftPub.keyVals.emplace(kv);
+    }
+  }
+  return thriftPub;
+}
+
+// dump a page of the entries of my KV store, so that large dumps are built
+// and sent in bounded chunks over as many requests
+thrift::Publication
+KvStore::dumpPageWithFilters(
+    KvStoreFilters const& kvFilters,
+    thrift::KeyDumpParams const& keyDumpParams) const {
+  CHECK_LT(0, keyDumpParams.limit);
+  auto const& cursor = keyDumpParams.cursor;
+  auto const& leafRanges = keyDumpParams.keyRanges;
+  const auto limit = static_cast<size_t>(keyDumpParams.limit);
+
+  // matching key-values after cursor, up to limit of them
+  std::vector<std::pair<const std::string, thrift::Value> const*> keyVals;
+  auto it = cursor.hasValue() ? sortedKeyVals_.upper_bound(cursor.value())
+                              : sortedKeyVals_.begin();
+  for (; it != sortedKeyVals_.end() and keyVals.size() < limit; ++it) {
+    auto const& kv = *it->second;
     if (not kvFilters.keyMatch(kv.first, kv.second)) {
       continue;
     }
-    DCHECK(kv.second.hash.hasValue());
-    auto& value = thriftPub.keyVals[kv.first];
-    value.version = kv.second.version;
-    value.originatorId = kv.second.originatorId;
-    value.hash = kv.second.hash;
-    value.ttl = kv.second.ttl;
-    value.ttlVersion = kv.second.ttlVersion;
+    if (leafRanges.hasValue() and
+        not leafRanges->count(
+            getKeyRange(kv.first, Constants::kKvStoreSyncRangeLevels))) {
+      continue;
+    }
+    keyVals.emplace_back(&kv);
+  }
+  folly::Optional<std::string> nextCursor;
+  if (it != sortedKeyVals_.end()) {
+    nextCursor = keyVals.back()->first;
+  }
+
+  if (not keyDumpParams.keyValHashes.hasValue()) {
+    thrift::Publication thriftPub;
+    thriftPub.keyVals.reserve(keyVals.size());
+    for (auto const* kv : keyVals) {
+      thriftPub.keyVals.emplace(
+          kv->first,
+          keyDumpParams.doNotPublishValue ? getHashValue(kv->second)
+                                          : kv->second);
+    }
+    thriftPub.nextCursor = std::move(nextCursor);
+    return thriftPub;
+  }
+
+  // hashes along with a cursor are of limit keys at most. The page ends at
+  // the last of them then, so that keys of the initiator after it are not
+  // taken for keys missing here
+  auto const& reqHashes = keyDumpParams.keyValHashes.value();
+  if (cursor.hasValue() and reqHashes.size() >= limit) {
+    auto const lastReqKey =
+        std::max_element(
+            reqHashes.begin(),
+            reqHashes.end(),
+            [](auto const& a, auto const& b) { return a.first < b.first; })
+            ->first;
+    if (not nextCursor.hasValue() or lastReqKey < nextCursor.value()) {
+      while (not keyVals.empty() and keyVals.back()->first > lastReqKey) {
+        keyVals.pop_back();
+      }
+      nextCursor = lastReqKey;
+    }
+  }
+
+  // diff on hashes of the keys the page covers
+  std::unordered_map<std::string, thrift::Value> myHashes;
+  myHashes.reserve(keyVals.size());
+  for (auto const* kv : keyVals) {
+    myHashes.emplace(kv->first, getHashValue(kv->second));
+  }
+  std::unordered_map<std::string, thrift::Value> pageReqHashes;
+  for (auto const& kv : reqHashes) {
+    if ((cursor.hasValue() and kv.first <= cursor.value()) or
+        (nextCursor.hasValue() and kv.first > nextCursor.value())) {
+      continue;
+    }
+    pageReqHashes.emplace(kv);
+  }
+  auto thriftPub = dumpDifference(myHashes, pageReqHashes);
+  for (auto& kv : thriftPub.keyVals) {
+    kv.second = kvStore_.at(kv.first);
   }
+  thriftPub.nextCursor = std::move(nextCursor);
   return thriftPub;
 }
 
+std::unordered_map<std::string, thrift::Value>
+KvStore::getHashPage(std::string const& cursor, int32_t limit) const {
+  std::unordered_map<std::string, thrift::Value> hashes;
+  for (auto it = sortedKeyVals_.upper_bound(cursor);
+       it != sortedKeyVals_.end() and
+       hashes.size() < static_cast<size_t>(limit);
+       ++it) {
+    hashes.emplace(it->second->first, getHashValue(it->second->second));
+  }
+  return hashes;
+}
+
+std::unordered_map<std::string, thrift::Value> const&
+KvStore::getHashDump(KvStoreFilters const& kvFilters) {
+  auto keyPrefixes = kvFilters.getKeyPrefixes();
+  auto originatorIds = kvFilters.getOrigniatorIdList();
+  auto filtersId = folly::sformat(
+      "{}|{}", folly::join(",", keyPrefixes), folly::join(",", originatorIds));
+  auto it = hashDumps_.find(filtersId);
+  if (it != hashDumps_.end()) {
+    tData_.addStatValue("kvstore.hash_dump_cache_hits", 1, fbzmq::COUNT);
+    return it->second.keyVals;
+  }
+  tData_.addStatValue("kvstore.hash_dump_cache_misses", 1, fbzmq::COUNT);
+
+  auto const keyVals = getMatchingKeyVals(kvFilters);
+
+  // copy hashes of matching keys in key shards, possibly on worker threads
+  const auto numShards = getNumShards(workerExecutor_.get(), keyVals.size());
+  std::vector<std::vector<std::pair<std::string, thrift::Value>>> shards(
+      numShards);
+  forEachShard(
+      workerExecutor_.get(),
+      numShards,
+      keyVals.size(),
+      [&keyVals, &shards](size_t shard, size_t begin, size_t end) {
+        auto& shardKeyVals = shards.at(shard);
+        shardKeyVals.reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+          auto const& kv = *keyVals[i];
+          shardKeyVals.emplace_back(kv.first, getHashValue(kv.second));
+        }
+      });
+
+  std::unordered_map<std::string, thrift::Value> hashKeyVals;
+  hashKeyVals.reserve(keyVals.size());
+  for (auto& shardKeyVals : shards) {
+    for (auto& kv : shardKeyVals) {
+      hashKeyVals.emplace(std::move(kv.first), std::move(kv.second));
+    }
+  }
+
+  // dumps are kept for a few distinct filters only, e.g. of leaf peers
+  if (hashDumps_.size() >= Constants::kKvStoreMaxHashDumps) {
+    hashDumps_.erase(hashDumps_.begin());
+  }
+  it = hashDumps_
+           .emplace(
+               std::move(filtersId),
+               HashDump{KvStoreFilters(keyPrefixes, originatorIds),
+                        std::move(hashKeyVals)})
+           .first;
+  return it->second.keyVals;
+}
+
+void
+KvStore::updateHashDumps(std::string const& key) {
+  if (hashDumps_.empty()) {
+    return;
+  }
+  auto const it = kvStore_.find(key);
+  for (auto& kv : hashDumps_) {
+    auto& hashDump = kv.second;
+    // originatorId may have changed along with the value
+    if (it != kvStore_.end() and
+        hashDump.filters.keyMatch(it->first, it->second)) {
+      hashDump.keyVals[key] = getHashValue(it->second);
+    } else {
+      hashDump.keyVals.erase(key);
+    }
+  }
+}
+
+// static
+int64_t
+KvStore::getKeyRange(std::string const& key, int32_t level) {
+  CHECK_LT(0, level);
+  CHECK_GE(Constants::kKvStoreSyncRangeLevels, level);
+  return getKeyHash(key) >> (64 - Constants::kKvStoreSyncRangeBits * level);
+}
+
+void
+KvStore::toggleKeyDigest(std::string const& key, thrift::Value const& value) {
+  leafRangeDigests_.at(getKeyRange(key, Constants::kKvStoreSyncRangeLevels)) ^=
+      getKeyDigest(key, value);
+}
+
+folly::StringPiece
+KvStore::getKeyPrefix(std::string const& key) {
+  const auto pos = key.find(Constants::kPrefixNameSeparator.toString());
+  if (pos == std::string::npos or pos == 0) {
+    return "none";
+  }
+  return folly::StringPiece(key.data(), pos);
+}
+
+void
+KvStore::updateKeyPrefixUsage(
+    std::string const& key, thrift::Value const& value, bool add) {
+  const int64_t numBytes = sizeof(std::pair<const std::string, thrift::Value>) +
+      key.size() + value.originatorId.size() +
+      (value.value.hasValue() ? value.value->size() : 0);
+  const int64_t sign = add ? 1 : -1;
+  auto& usage = keyPrefixUsage_[getKeyPrefix(key).str()];
+  usage.numKeys += sign;
+  usage.numBytes += sign * numBytes;
+  DCHECK_LE(0, usage.numKeys);
+}
+
+thrift::KeyRangeDigests
+KvStore::getKeyRangeDigests(
+    int32_t level, std::vector<int64_t> const& ranges) const {
+  CHECK_LT(0, level);
+  CHECK_GE(Constants::kKvStoreSyncRangeLevels, level);
+  const int32_t leafShift =
+      Constants::kKvStoreSyncRangeBits *
+      (Constants::kKvStoreSyncRangeLevels - level);
+
+  thrift::KeyRangeDigests rangeDigests;
+  rangeDigests.level = level;
+  for (auto const range : ranges) {
+    uint64_t digest{0};
+    const size_t firstLeaf = static_cast<size_t>(range) << leafShift;
+    const size_t lastLeaf = static_cast<size_t>(range + 1) << leafShift;
+    for (size_t leaf = firstLeaf; leaf < lastLeaf; ++leaf) {
+      digest ^= leafRangeDigests_.at(leaf);
+    }
+    rangeDigests.digests.emplace(range, static_cast<int64_t>(digest));
+  }
+  return rangeDigests;
+}
+
+std::vector<int64_t>
+KvStore::getDifferingKeyRanges(
+    thrift::KeyRangeDigests const& peerDigests) const {
+  const int64_t numRanges = int64_t{1}
+      << (Constants::kKvStoreSyncRangeBits * peerDigests.level);
+  std::vector<int64_t> ranges;
+  for (auto const& kv : peerDigests.digests) {
+    if (kv.first < 0 or kv.first >= numRanges) {
+      LOG(ERROR) << "Ignoring invalid key range " << kv.first << " at level "
+                 << peerDigests.level;
+      continue;
+    }
+    auto const myDigests = getKeyRangeDigests(peerDigests.level, {kv.first});
+    if (myDigests.digests.at(kv.first) != kv.second) {
+      ranges.emplace_back(kv.first);
+    }
+  }
+  return ranges;
+}
+
 /**
  * Compare two values to find out which value is better
  * TODO: this function can be leveraged in mergeKeyValues to perform same
@@ -531,6 +1149,83 @@ KvStore::compareValues(const thrift::Value& v1, const thrift::Value& v2) {
   }
 }
 
+folly::Optional<thrift::ValueDelta>
+KvStore::createValueDelta(
+    std::string const& key,
+    thrift::Value const& baseValue,
+    thrift::Value const& newValue) {
+  if (not baseValue.value.hasValue() or not baseValue.hash.hasValue() or
+      not newValue.value.hasValue()) {
+    return folly::none;
+  }
+  auto const& base = baseValue.value.value();
+  auto const& value = newValue.value.value();
+  if (value.size() < Constants::kKvStoreMinDeltaValueSize) {
+    return folly::none;
+  }
+
+  // Keep common head and tail of the base, patch the bytes in between
+  const size_t maxCommon = std::min(base.size(), value.size());
+  size_t headSize{0};
+  while (headSize < maxCommon and base[headSize] == value[headSize]) {
+    ++headSize;
+  }
+  size_t tailSize{0};
+  while (tailSize < maxCommon - headSize and
+         base[base.size() - tailSize - 1] ==
+             value[value.size() - tailSize - 1]) {
+    ++tailSize;
+  }
+
+  // not worth it unless it at least halves the bytes sent
+  const size_t patchSize = value.size() - headSize - tailSize;
+  if (patchSize * 2 > value.size()) {
+    return folly::none;
+  }
+
+  thrift::ValueDelta delta;
+  delta.key = key;
+  delta.version = newValue.version;
+  delta.originatorId = newValue.originatorId;
+  delta.ttl = newValue.ttl;
+  delta.ttlVersion = newValue.ttlVersion;
+  delta.baseVersion = baseValue.version;
+  delta.baseHash = baseValue.hash.value();
+  delta.headSize = headSize;
+  delta.tailSize = tailSize;
+  delta.patch = value.substr(headSize, patchSize);
+  return delta;
+}
+
+folly::Optional<thrift::Value>
+KvStore::applyValueDelta(
+    thrift::ValueDelta const& delta, thrift::Value const& baseValue) {
+  if (not baseValue.value.hasValue() or not baseValue.hash.hasValue() or
+      baseValue.version != delta.baseVersion or
+      baseValue.hash.value() != delta.baseHash) {
+    return folly::none;
+  }
+  auto const& base = baseValue.value.value();
+  if (delta.headSize < 0 or delta.tailSize < 0 or
+      static_cast<size_t>(delta.headSize) + delta.tailSize > base.size()) {
+    return folly::none;
+  }
+
+  std::string value;
+  value.reserve(delta.headSize + delta.patch.size() + delta.tailSize);
+  value.append(base, 0, delta.headSize);
+  value.append(delta.patch);
+  value.append(base, base.size() - delta.tailSize, delta.tailSize);
+
+  thrift::Value newValue;
+  newValue.version = delta.version;
+  newValue.originatorId = delta.originatorId;
+  newValue.value = std::move(value);
+  newValue.ttl = delta.ttl;
+  newValue.ttlVersion = delta.ttlVersion;
+  return newValue;
+}
+
 // dump the keys on which hashes differ from given keyVals
 // thriftPub.keyVals: better keys or keys exist only in MY-KEY-VAL
 // thriftPub.tobeUpdatedKeys: better keys or keys exist only in REQ-KEY-VAL
@@ -661,6 +1356,10 @@ KvStore::addPeers(
         }
       }
 
+      if (cmdUrlUpdated or isNewPeer) {
+        subscribePeerStream(peerName, newPeerSpec.cmdUrl);
+      }
+
       if (isNewPeer) {
         if (supportFloodOptimization) {
           // make sure let peer to unset-child for me for all roots first
@@ -676,6 +1375,9 @@ KvStore::addPeers(
           peerName,
           ExponentialBackoff<std::chrono::milliseconds>(
               Constants::kInitialBackoff, Constants::kMaxBackoff));
+      if (enableSptFullSync_ and supportFloodOptimization) {
+        sptOnlySyncPeers_.emplace(peerName);
+      }
     } catch (std::exception const& e) {
       LOG(ERROR) << "Error connecting to: `" << peerName
                  << "` reason: " << folly::exceptionStr(e);
@@ -696,7 +1398,14 @@ KvStore::addPeers(
 folly::Expected<size_t, fbzmq::Error>
 KvStore::sendMessageToPeer(
     const std::string& peerSocketId, const thrift::KvStoreRequest& request) {
-  auto msg = fbzmq::Message::fromThriftObj(request, serializer_).value();
+  return sendMessageToPeer(
+      peerSocketId,
+      fbzmq::Message::fromThriftObj(request, serializer_).value());
+}
+
+folly::Expected<size_t, fbzmq::Error>
+KvStore::sendMessageToPeer(
+    const std::string& peerSocketId, const fbzmq::Message& msg) {
   tData_.addStatValue("kvstore.peers.bytes_sent", msg.size(), fbzmq::SUM);
   return peerSyncSock_.sendMultiple(
       fbzmq::Message::from(peerSocketId).value(), fbzmq::Message(), msg);
@@ -728,7 +1437,11 @@ KvStore::delPeers(std::vector<std::string> const& peers) {
     }
 
     peersToSyncWith_.erase(peerName);
+    sptOnlySyncPeers_.erase(peerName);
+    peerPendingKeys_.erase(peerName);
+    latestSentPeerSync_.erase(it->second.second);
     peers_.erase(it);
+    unsubscribePeerStream(peerName);
   }
 
   // remove dual peers if any
@@ -740,22 +1453,272 @@ KvStore::delPeers(std::vector<std::string> const& peers) {
   }
 }
 
+void
+KvStore::addPeerStream(
+    std::string const& peerName, int64_t token, PeerStreamSink sink) {
+  runInEventLoop(
+      [this, peerName, token, sink = std::move(sink)]() mutable noexcept {
+        LOG(INFO) << "Peer " << peerName << " subscribed to flood requests";
+        peerStreams_[peerName] = std::make_pair(token, std::move(sink));
+      });
+}
+
+void
+KvStore::removePeerStream(std::string const& peerName, int64_t token) {
+  runInEventLoop([this, peerName, token]() noexcept {
+    auto it = peerStreams_.find(peerName);
+    if (it == peerStreams_.end() or it->second.first != token) {
+      // replaced by a newer stream of the peer
+      return;
+    }
+    LOG(INFO) << "Peer " << peerName << " unsubscribed from flood requests";
+    peerStreams_.erase(it);
+  });
+}
+
+void
+KvStore::subscribePeerStream(
+    std::string const& peerName, std::string const& cmdUrl) {
+  if (not peerStreamEvbThread_) {
+    return;
+  }
+
+  // cmdUrl is of form tcp://[<address>]:<port>
+  auto const addrBegin = cmdUrl.find('[');
+  auto const addrEnd = cmdUrl.find(']');
+  folly::SocketAddress peerAddr;
+  try {
+    if (addrBegin == std::string::npos or addrEnd == std::string::npos or
+        addrEnd < addrBegin) {
+      throw std::invalid_argument("no address in brackets");
+    }
+    peerAddr.setFromIpPort(
+        cmdUrl.substr(addrBegin + 1, addrEnd - addrBegin - 1),
+        peerStreamPort_);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Can't stream flood requests from peer " << peerName
+               << " at " << cmdUrl << ", reason: " << folly::exceptionStr(e);
+    unsubscribePeerStream(peerName);
+    return;
+  }
+
+  const auto generation = ++peerStreamGeneration_;
+  peerStreamGenerations_[peerName] = generation;
+  peerStreamBackoffs_.emplace(
+      peerName,
+      ExponentialBackoff<std::chrono::milliseconds>(
+          Constants::kInitialBackoff, Constants::kMaxBackoff));
+
+  LOG(INFO) << "Subscribing to flood requests of peer " << peerName << " at "
+            << peerAddr.describe();
+  auto evb = peerStreamEvbThread_->getEventBase();
+  evb->runInEventBaseThread([this, evb, peerName, peerAddr, generation]() {
+    auto onEnd = [this, peerName, generation]() {
+      runInEventLoop([this, peerName, generation]() noexcept {
+        processPeerStreamEnd(peerName, generation);
+      });
+    };
+
+    // replaces previous stream of the peer if any
+    auto& streamClient = peerStreamClients_[peerName];
+    streamClient = std::make_unique<PeerStreamClient>();
+    streamClient->generation = generation;
+    streamClient->client = getOpenrCtrlPlainTextClient(*evb, peerAddr);
+    streamClient->client->semifuture_subscribeKvStorePeer(nodeId_)
+        .via(evb)
+        .thenTry([this, evb, peerName, generation, onEnd](
+                     folly::Try<apache::thrift::SemiStream<
+                         thrift::KeySetParamsBatch>>&& stream) {
+          auto it = peerStreamClients_.find(peerName);
+          if (it == peerStreamClients_.end() or
+              it->second->generation != generation) {
+            // replaced or unsubscribed meanwhile
+            return;
+          }
+          if (stream.hasException()) {
+            LOG(ERROR) << "Failed to subscribe to flood requests of peer "
+                       << peerName << ", reason: " << stream.exception().what();
+            onEnd();
+            return;
+          }
+          it->second->subscription =
+              std::move(stream.value())
+                  .via(evb)
+                  .subscribe(
+                      [this, peerName](thrift::KeySetParamsBatch&& batch) {
+                        auto fn = [this, peerName, batch = std::move(batch)](
+                                      ) mutable noexcept {
+                          processPeerStreamBatch(peerName, batch);
+                        };
+                        runInEventLoop(std::move(fn));
+                      },
+                      [peerName, onEnd](folly::exception_wrapper ew) {
+                        LOG(ERROR) << "Stream of flood requests of peer "
+                                   << peerName << " failed: " << ew.what();
+                        onEnd();
+                      },
+                      onEnd,
+                      Constants::kKvStorePeerStreamCredits);
+        });
+  });
+}
+
+void
+KvStore::unsubscribePeerStream(std::string const& peerName) {
+  if (not peerStreamGenerations_.erase(peerName)) {
+    return;
+  }
+  peerStreamBackoffs_.erase(peerName);
+  peerStreamEvbThread_->getEventBase()->runInEventBaseThread(
+      [this, peerName]() { peerStreamClients_.erase(peerName); });
+}
+
+void
+KvStore::processPeerStreamBatch(
+    std::string const& peerName, thrift::KeySetParamsBatch& batch) {
+  tData_.addStatValue(
+      "kvstore.peer_stream.received_batch_size",
+      batch.keySetParams.size(),
+      fbzmq::AVG);
+  auto backoffIt = peerStreamBackoffs_.find(peerName);
+  if (backoffIt != peerStreamBackoffs_.end()) {
+    backoffIt->second.reportSuccess();
+  }
+  for (auto& params : batch.keySetParams) {
+    processKeySetParams(params);
+  }
+}
+
+void
+KvStore::processPeerStreamEnd(
+    std::string const& peerName, uint64_t generation) {
+  auto genIt = peerStreamGenerations_.find(peerName);
+  if (genIt == peerStreamGenerations_.end() or genIt->second != generation) {
+    return;
+  }
+
+  // we may have missed flood requests of the peer, catch up with full-sync
+  LOG(WARNING) << "Stream of flood requests of peer " << peerName
+               << " ended, requesting full-sync";
+  tData_.addStatValue("kvstore.peer_stream.ended", 1, fbzmq::COUNT);
+  peersToSyncWith_.emplace(
+      peerName,
+      ExponentialBackoff<std::chrono::milliseconds>(
+          Constants::kInitialBackoff, Constants::kMaxBackoff));
+  if (not fullSyncTimer_->isScheduled()) {
+    fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+
+  auto& backoff = peerStreamBackoffs_.at(peerName);
+  backoff.reportError();
+  scheduleTimeout(
+      backoff.getTimeRemainingUntilRetry(), [this, peerName, generation]() {
+        auto it = peerStreamGenerations_.find(peerName);
+        if (it == peerStreamGenerations_.end() or it->second != generation) {
+          return;
+        }
+        subscribePeerStream(peerName, peers_.at(peerName).first.cmdUrl);
+      });
+}
+
 // Get full KEY_DUMP from peersToSyncWith_
 void
 KvStore::requestFullSyncFromPeers() {
   // minimal timeout for next run
   auto timeout = std::chrono::milliseconds(Constants::kMaxBackoff);
+  tData_.addStatValue(
+      "kvstore.full_sync_queue_depth", peersToSyncWith_.size(), fbzmq::AVG);
 
-  // Make requests
-  for (auto it = peersToSyncWith_.begin(); it != peersToSyncWith_.end();) {
-    auto& peerName = it->first;
-    auto& expBackoff = it->second;
+  // Free slots of syncs peers never responded to
+  const auto now = std::chrono::steady_clock::now();
+  for (auto it = latestSentPeerSync_.begin();
+       it != latestSentPeerSync_.end();) {
+    if (now - it->second < Constants::kKvStoreFullSyncTimeout) {
+      ++it;
+      continue;
+    }
+    LOG(WARNING) << "No full sync response from " << it->first << " after "
+                 << Constants::kKvStoreFullSyncTimeout.count() << "s";
+    tData_.addStatValue("kvstore.full_sync_timeouts", 1, fbzmq::COUNT);
+    it = latestSentPeerSync_.erase(it);
+  }
 
+  // Peers due for sync, peers on flood SPT first as flooding relies on them
+  std::unordered_set<std::string> sptPeers;
+  if (enableFloodOptimization_) {
+    sptPeers = DualNode::getSptPeers(DualNode::getSptRootId());
+  }
+
+  // Added peers off the SPT are skipped once it has formed. Wait for it for
+  // a while, and sync with them as well if it doesn't form
+  bool skipNonSptPeers{false};
+  bool waitForSpt{false};
+  if (enableFloodOptimization_ and useFloodOptimization_ and
+      not sptOnlySyncPeers_.empty()) {
+    if (not sptPeers.empty()) {
+      sptWaitStart_ = folly::none;
+      skipNonSptPeers = true;
+    } else {
+      if (not sptWaitStart_.hasValue()) {
+        sptWaitStart_ = now;
+      }
+      waitForSpt = now - *sptWaitStart_ < Constants::kKvStoreSptFullSyncWait;
+    }
+  }
+
+  std::vector<std::pair<bool /* not on SPT */, std::string>> readyPeers;
+  std::vector<std::string> skippedPeers;
+  for (auto& kv : peersToSyncWith_) {
+    auto& expBackoff = kv.second;
     if (not expBackoff.canTryNow()) {
       timeout = std::min(timeout, expBackoff.getTimeRemainingUntilRetry());
-      ++it;
       continue;
     }
+    const bool onSpt = sptPeers.count(kv.first) != 0;
+    if (not onSpt and sptOnlySyncPeers_.count(kv.first)) {
+      if (skipNonSptPeers) {
+        skippedPeers.emplace_back(kv.first);
+        continue;
+      }
+      if (waitForSpt) {
+        timeout = std::min(timeout, Constants::kInitialBackoff);
+        continue;
+      }
+    }
+    readyPeers.emplace_back(not onSpt, kv.first);
+  }
+  std::sort(readyPeers.begin(), readyPeers.end());
+
+  if (not skippedPeers.empty()) {
+    VLOG(1) << "Skipping full sync with " << skippedPeers.size()
+            << " peers off the flood SPT";
+    tData_.addStatValue(
+        "kvstore.full_sync_skipped_non_spt", skippedPeers.size(), fbzmq::SUM);
+    for (auto const& peerName : skippedPeers) {
+      peersToSyncWith_.erase(peerName);
+      sptOnlySyncPeers_.erase(peerName);
+    }
+  }
+
+  // Make requests
+  for (size_t i = 0; i < readyPeers.size(); ++i) {
+    if (maxParallelSyncs_ > 0 and
+        latestSentPeerSync_.size() >= maxParallelSyncs_) {
+      // retried once a sync in flight completes or times out
+      tData_.addStatValue(
+          "kvstore.full_sync_deferred", readyPeers.size() - i, fbzmq::SUM);
+      for (auto const& kv : latestSentPeerSync_) {
+        timeout = std::min(
+            timeout,
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                kv.second + Constants::kKvStoreFullSyncTimeout - now));
+      }
+      break;
+    }
+
+    auto const& peerName = readyPeers[i].second;
+    auto it = peersToSyncWith_.find(peerName);
+    auto& expBackoff = it->second;
 
     // Generate and send router-socket id of peer first. If the kvstore of
     // peer is not connected over the router socket then it will error out
@@ -772,10 +1735,33 @@ KvStore::requestFullSyncFromPeers() {
       params.prefix = keyPrefix;
       params.originatorIds = filters_.value().getOrigniatorIdList();
     }
-    std::set<std::string> originator{};
-    std::vector<std::string> keyPrefixList{};
-    KvStoreFilters kvFilters{keyPrefixList, originator};
-    params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+    if (enableRangeSync_ and not filters_.hasValue()) {
+      // key ranges cover the whole store on both ends. Start with digests of
+      // the top level ranges, peer responds with digests of differing ones
+      params.keyRangeDigests = getKeyRangeDigests(1, getSubRanges({0}));
+    } else {
+      std::set<std::string> originator{};
+      std::vector<std::string> keyPrefixList{};
+      KvStoreFilters kvFilters{keyPrefixList, originator};
+      params.keyValHashes = std::move(dumpHashWithFilters(kvFilters).keyVals);
+      // peer leaves out unconfirmed key-values it has the same value of, see
+      // confirmSnapshotKeyVals()
+      for (auto const& kv : snapshotKeyVals_) {
+        if (kvStore_.count(kv.first)) {
+          continue;
+        }
+        thrift::Value value = kv.second;
+        value.value = folly::none;
+        params.keyValHashes->emplace(kv.first, std::move(value));
+      }
+      if (not snapshotKeyVals_.empty()) {
+        snapshotSyncPeers_.emplace(peerCmdSocketId);
+      } else {
+        // peer responds in pages, see requestFullSyncPage(). Peers not
+        // supporting it respond with a single full-sync response
+        params.limit = Constants::kKvStoreDumpPageSize;
+      }
+    }
 
     dumpRequest.cmd = thrift::Command::KEY_DUMP;
     dumpRequest.keyDumpParams = params;
@@ -793,12 +1779,12 @@ KvStore::requestFullSyncFromPeers() {
                  << " using id " << peerCmdSocketId << " (will try again). "
                  << ret.error();
       collectSendFailureStats(ret.error(), peerCmdSocketId);
+      latestSentPeerSync_.erase(peerCmdSocketId);
       expBackoff.reportError(); // Apply exponential backoff
       timeout = std::min(timeout, expBackoff.getTimeRemainingUntilRetry());
-      ++it;
     } else {
-      // Remove the iterator
-      it = peersToSyncWith_.erase(it);
+      peersToSyncWith_.erase(it);
+      sptOnlySyncPeers_.erase(peerName);
     }
   } // for
 
@@ -813,6 +1799,36 @@ KvStore::requestFullSyncFromPeers() {
   }
 }
 
+void
+KvStore::requestFullSyncPage(
+    std::string const& peerCmdSocketId, std::string const& cursor) {
+  thrift::KvStoreRequest dumpRequest;
+  dumpRequest.cmd = thrift::Command::KEY_DUMP;
+  thrift::KeyDumpParams params;
+  if (filters_.hasValue()) {
+    params.prefix = folly::join(",", filters_.value().getKeyPrefixes());
+    params.originatorIds = filters_.value().getOrigniatorIdList();
+  }
+  // hashes of the keys after cursor only, peer's page ends at the last of
+  // them at most
+  params.keyValHashes = getHashPage(cursor, Constants::kKvStoreDumpPageSize);
+  params.cursor = cursor;
+  params.limit = Constants::kKvStoreDumpPageSize;
+  dumpRequest.keyDumpParams = std::move(params);
+
+  VLOG(2) << "Requesting full sync page after " << cursor << " from "
+          << peerCmdSocketId;
+  tData_.addStatValue("kvstore.full_sync_pages", 1, fbzmq::COUNT);
+  auto const ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+  if (ret.hasError()) {
+    // next periodic sync starts over
+    LOG(ERROR) << "Failed to send full sync page request to "
+               << peerCmdSocketId << ". " << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+    latestSentPeerSync_.erase(peerCmdSocketId);
+  }
+}
+
 // dump all peers we are subscribed to
 thrift::PeerCmdReply
 KvStore::dumpPeers() {
@@ -820,7 +1836,202 @@ KvStore::dumpPeers() {
   for (auto const& kv : peers_) {
     reply.peers.emplace(kv.first, kv.second.first);
   }
-  return reply;
+  return reply;
+}
+
+void
+KvStore::loadSnapshot() {
+  auto const& filePath = snapshotFilePath_.value();
+  if (enableRangeSync_ and not filters_.hasValue()) {
+    // range sync doesn't send the key hashes peers confirm snapshots with
+    LOG(INFO) << "Not loading KvStore snapshot " << filePath
+              << " with range sync enabled";
+    return;
+  }
+  if (not fileExists(filePath)) {
+    LOG(INFO) << "KvStore snapshot " << filePath << " doesn't exist. "
+              << "Starting with empty database";
+    return;
+  }
+
+  std::string fileData{""};
+  if (not folly::readFile(filePath.c_str(), fileData)) {
+    LOG(ERROR) << "Failed to read KvStore snapshot '" << filePath
+               << "'. Error (" << errno << "): " << folly::errnoStr(errno);
+    return;
+  }
+  thrift::KvStoreSnapshot snapshot;
+  try {
+    snapshot = fbzmq::util::readThriftObjStr<thrift::KvStoreSnapshot>(
+        fileData, serializer_);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to parse KvStore snapshot '" << filePath
+               << "': " << folly::exceptionStr(e);
+    return;
+  }
+
+  // ttls in the snapshot are remaining as of the time it was written
+  const int64_t elapsedMs =
+      std::max(int64_t{0}, getUnixTimeStamp() - snapshot.timestampMs);
+  for (auto& kv : snapshot.keyVals) {
+    auto& value = kv.second;
+    if (filters_.hasValue() and not filters_->keyMatch(kv.first, value)) {
+      continue;
+    }
+    if (value.ttl != Constants::kTtlInfinity) {
+      value.ttl -= elapsedMs;
+      if (value.ttl <= ttlDecr_.count()) {
+        continue;
+      }
+    }
+    snapshotKeyVals_.emplace(kv.first, std::move(value));
+  }
+  snapshotLoadTime_ = std::chrono::steady_clock::now();
+  LOG(INFO) << "Loaded " << snapshotKeyVals_.size() << " unconfirmed keys "
+            << "from KvStore snapshot " << filePath << " of " << elapsedMs
+            << "ms ago";
+  tData_.addStatValue(
+      "kvstore.snapshot.loaded_keys", snapshotKeyVals_.size(), fbzmq::SUM);
+  if (snapshotKeyVals_.empty()) {
+    return;
+  }
+
+  snapshotConfirmTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.snapshot_confirm", [this]() noexcept {
+        dropSnapshotKeyVals();
+      }));
+  snapshotConfirmTimer_->scheduleTimeout(
+      Constants::kKvStoreSnapshotConfirmTimeout);
+}
+
+void
+KvStore::writeSnapshot() {
+  // keep the previous snapshot until its key-values are confirmed or dropped
+  if (not snapshotDirty_ or not snapshotKeyVals_.empty()) {
+    return;
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  thrift::Publication thriftPub;
+  thriftPub.keyVals = kvStore_;
+  updatePublicationTtl(thriftPub);
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.keyVals = std::move(thriftPub.keyVals);
+  snapshot.timestampMs = getUnixTimeStamp();
+
+  auto const& filePath = snapshotFilePath_.value();
+  const auto fileData = fbzmq::util::writeThriftObjStr(snapshot, serializer_);
+  try {
+    folly::writeFileAtomic(filePath, fileData, 0666);
+  } catch (std::exception const& e) {
+    LOG(ERROR) << "Failed to write KvStore snapshot '" << filePath
+               << "': " << folly::exceptionStr(e);
+    tData_.addStatValue("kvstore.snapshot.write_failure", 1, fbzmq::COUNT);
+    return;
+  }
+  snapshotDirty_ = false;
+
+  const auto writeDuration =
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - startTime);
+  VLOG(2) << "Wrote KvStore snapshot of " << snapshot.keyVals.size()
+          << " keys, " << fileData.size() << " bytes in "
+          << writeDuration.count() << "ms";
+  tData_.addStatValue(
+      "kvstore.snapshot.write_bytes", fileData.size(), fbzmq::AVG);
+  tData_.addStatValue(
+      "kvstore.snapshot.write_time_ms", writeDuration.count(), fbzmq::AVG);
+}
+
+void
+KvStore::confirmSnapshotKeyVals(
+    std::string const& peerCmdSocketId, thrift::Publication const& syncPub) {
+  if (snapshotSyncPeers_.erase(peerCmdSocketId) == 0) {
+    // full-sync without hashes of unconfirmed key-values
+    return;
+  }
+
+  // keys the peer doesn't have or has an older value of
+  std::unordered_set<std::string> peerMissingKeys;
+  if (syncPub.tobeUpdatedKeys.hasValue()) {
+    peerMissingKeys.insert(
+        syncPub.tobeUpdatedKeys->begin(), syncPub.tobeUpdatedKeys->end());
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - snapshotLoadTime_);
+  thrift::Publication confirmedPub;
+  size_t numDropped{0};
+  for (auto it = snapshotKeyVals_.begin(); it != snapshotKeyVals_.end();) {
+    auto const& key = it->first;
+    auto& value = it->second;
+    if (kvStore_.count(key) or syncPub.keyVals.count(key)) {
+      // superseded, e.g. by a better value of the peer
+      ++numDropped;
+      it = snapshotKeyVals_.erase(it);
+      continue;
+    }
+    if (peerMissingKeys.count(key)) {
+      // another peer may still confirm it
+      ++it;
+      continue;
+    }
+
+    // peer has the same value, left out of its response
+    if (value.ttl != Constants::kTtlInfinity) {
+      value.ttl -= elapsed.count();
+      if (value.ttl <= ttlDecr_.count()) {
+        ++numDropped;
+        it = snapshotKeyVals_.erase(it);
+        continue;
+      }
+    }
+    auto const res = kvStore_.emplace(key, std::move(value));
+    toggleKeyDigest(res.first->first, res.first->second);
+    updateKeyPrefixUsage(res.first->first, res.first->second, true);
+    sortedKeyVals_.emplace(res.first->first, &*res.first);
+    updateHashDumps(res.first->first);
+    confirmedPub.keyVals.emplace(res.first->first, res.first->second);
+    it = snapshotKeyVals_.erase(it);
+  }
+  tData_.addStatValue(
+      "kvstore.snapshot.confirmed_keys",
+      confirmedPub.keyVals.size(),
+      fbzmq::SUM);
+  tData_.addStatValue("kvstore.snapshot.dropped_keys", numDropped, fbzmq::SUM);
+  VLOG(1) << "Full-sync with " << peerCmdSocketId << " confirmed "
+          << confirmedPub.keyVals.size() << " snapshot keys, dropped "
+          << numDropped;
+
+  if (snapshotSyncPeers_.empty()) {
+    // keys none of the peers had
+    dropSnapshotKeyVals();
+  }
+  if (confirmedPub.keyVals.empty()) {
+    return;
+  }
+  snapshotDirty_ = true;
+  updateTtlCountdownQueue(confirmedPub);
+
+  // peer has them already, only local subscribers learn about them
+  updatePublicationTtl(confirmedPub);
+  confirmedPub.nodeIds = std::vector<std::string>{nodeId_};
+  localPubSock_.sendOne(
+      fbzmq::Message::fromThriftObj(confirmedPub, serializer_).value());
+}
+
+void
+KvStore::dropSnapshotKeyVals() {
+  if (snapshotKeyVals_.empty()) {
+    return;
+  }
+  LOG(INFO) << "Dropping " << snapshotKeyVals_.size()
+            << " unconfirmed keys of KvStore snapshot";
+  tData_.addStatValue(
+      "kvstore.snapshot.dropped_keys", snapshotKeyVals_.size(), fbzmq::SUM);
+  snapshotKeyVals_.clear();
+  snapshotSyncPeers_.clear();
+  snapshotConfirmTimer_->cancelTimeout();
 }
 
 // update TTL with remainng time to expire, TTL version remains
@@ -829,36 +2040,266 @@ void
 KvStore::updatePublicationTtl(
     thrift::Publication& thriftPub, bool removeAboutToExpire) {
   auto timeNow = std::chrono::steady_clock::now();
-  for (const auto& qE : ttlCountdownQueue_) {
-    // Find key and ensure we are taking time from right entry from queue
-    auto kv = thriftPub.keyVals.find(qE.key);
-    if (kv == thriftPub.keyVals.end() or kv->second.version != qE.version or
-        kv->second.originatorId != qE.originatorId or
-        kv->second.ttlVersion != qE.ttlVersion) {
+  for (auto kv = thriftPub.keyVals.begin(); kv != thriftPub.keyVals.end();) {
+    auto ttl =
+        getTtlToSend(kv->first, kv->second, timeNow, removeAboutToExpire);
+    if (not ttl.hasValue()) {
+      kv = thriftPub.keyVals.erase(kv);
       continue;
     }
+    kv->second.ttl = ttl.value();
+    ++kv;
+  }
+}
 
-    // Compute timeLeft and do sanity check on it
-    auto timeLeft = duration_cast<milliseconds>(qE.expiryTime - timeNow);
-    if (timeLeft <= ttlDecr_) {
-      thriftPub.keyVals.erase(kv);
-      continue;
-    }
+folly::Optional<int64_t>
+KvStore::getTtlToSend(
+    std::string const& key,
+    thrift::Value const& value,
+    std::chrono::steady_clock::time_point timeNow,
+    bool removeAboutToExpire) const {
+  // Find entry of the key and ensure we are taking time from right entry
+  auto handleIt = ttlCountdownHandles_.find(key);
+  if (handleIt == ttlCountdownHandles_.end()) {
+    return value.ttl;
+  }
+  const auto& qE = *handleIt->second;
+  if (value.version != qE.version or value.ttlVersion != qE.ttlVersion or
+      value.originatorId != *qE.originatorId) {
+    return value.ttl;
+  }
 
-    // filter key from publication if time left is below ttl threshold
-    if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
-      thriftPub.keyVals.erase(kv);
-      continue;
+  // Compute timeLeft and do sanity check on it
+  auto timeLeft = duration_cast<milliseconds>(qE.expiryTime - timeNow);
+  if (timeLeft <= ttlDecr_) {
+    return folly::none;
+  }
+
+  // filter key from publication if time left is below ttl threshold
+  if (removeAboutToExpire and timeLeft < Constants::kTtlThreshold) {
+    return folly::none;
+  }
+
+  // Set the time-left and decrement it by one so that ttl decrement
+  // deterministically whenever it is exchanged between KvStores. This will
+  // avoid looping of updates between stores.
+  return timeLeft.count() - ttlDecr_.count();
+}
+
+thrift::Publication
+KvStore::processKeyGet(thrift::KeyGetParams const& keyGetParams) {
+  tData_.addStatValue("kvstore.cmd_key_get", 1, fbzmq::COUNT);
+
+  auto thriftPub = getKeyVals(keyGetParams.keys);
+  updatePublicationTtl(thriftPub);
+  return thriftPub;
+}
+
+folly::Expected<thrift::Publication, fbzmq::Error>
+KvStore::processKeyDump(thrift::KeyDumpParams const& keyDumpParamsVal) {
+  VLOG(3) << "Dump all keys requested";
+  if (keyDumpParamsVal.keyRangeDigests.hasValue()) {
+    // range sync: respond with digests of the sub-ranges of the ranges
+    // which differ. The initiator compares leaf ranges
+    auto const& peerDigests = keyDumpParamsVal.keyRangeDigests.value();
+    if (peerDigests.level <= 0 or
+        peerDigests.level >= Constants::kKvStoreSyncRangeLevels) {
+      LOG(ERROR) << "received invalid key range level " << peerDigests.level;
+      return folly::makeUnexpected(fbzmq::Error(
+          EINVAL,
+          folly::sformat("invalid key range level {}", peerDigests.level)));
     }
+    VLOG(3) << "Dump key ranges requested with " << peerDigests.digests.size()
+            << " range digest(s) at level " << peerDigests.level;
+    tData_.addStatValue("kvstore.cmd_key_range_dump", 1, fbzmq::COUNT);
+
+    thrift::Publication thriftPub;
+    thriftPub.keyRangeDigests = getKeyRangeDigests(
+        peerDigests.level + 1,
+        getSubRanges(getDifferingKeyRanges(peerDigests)));
+    return thriftPub;
+  }
+  if (keyDumpParamsVal.keyValHashes.hasValue()) {
+    VLOG(3) << "Dump keys requested along with "
+            << keyDumpParamsVal.keyValHashes.value().size()
+            << " keyValHashes item(s) provided from peer";
+  } else {
+    VLOG(3) << "Dump all keys requested - "
+            << "KeyPrefixes:" << keyDumpParamsVal.prefix << " Originator IDs:"
+            << folly::join(",", keyDumpParamsVal.originatorIds);
+  }
+  // TODO, add per request id counters in thrift server
+  tData_.addStatValue("kvstore.cmd_key_dump", 1, fbzmq::COUNT);
 
-    // Set the time-left and decrement it by one so that ttl decrement
-    // deterministically whenever it is exchanged between KvStores. This will
-    // avoid looping of updates between stores.
-    kv->second.ttl = timeLeft.count() - ttlDecr_.count();
+  std::vector<std::string> keyPrefixList;
+  folly::split(",", keyDumpParamsVal.prefix, keyPrefixList, true);
+  const auto keyPrefixMatch =
+      KvStoreFilters(keyPrefixList, keyDumpParamsVal.originatorIds);
+  thrift::Publication thriftPub;
+  bool isTtlUpdated{false};
+  if (keyDumpParamsVal.limit > 0) {
+    tData_.addStatValue("kvstore.cmd_key_dump_page", 1, fbzmq::COUNT);
+    thriftPub = dumpPageWithFilters(keyPrefixMatch, keyDumpParamsVal);
+  } else if (keyDumpParamsVal.keyValHashes.hasValue()) {
+    // diff on hashes and copy values of the keys to be sent only, instead
+    // of dumping every value of the store
+    // hashes are diffed against the shared hash dump in place unless dump is
+    // limited to key ranges
+    thriftPub = keyDumpParamsVal.keyRanges.hasValue()
+        ? dumpDifference(
+              dumpHashWithFilters(keyPrefixMatch, keyDumpParamsVal.keyRanges)
+                  .keyVals,
+              keyDumpParamsVal.keyValHashes.value())
+        : dumpDifference(
+              getHashDump(keyPrefixMatch),
+              keyDumpParamsVal.keyValHashes.value());
+    for (auto& kv : thriftPub.keyVals) {
+      kv.second = kvStore_.at(kv.first);
+    }
+  } else if (keyDumpParamsVal.doNotPublishValue) {
+    thriftPub = dumpHashWithFilters(keyPrefixMatch, keyDumpParamsVal.keyRanges);
+  } else {
+    thriftPub = dumpAllWithFilters(keyPrefixMatch, keyDumpParamsVal.keyRanges);
+    // TTLs are set while dumping
+    isTtlUpdated = true;
+  }
+  if (not isTtlUpdated) {
+    updatePublicationTtl(thriftPub);
   }
+  // I'm the initiator, set flood-root-id
+  thriftPub.floodRootId = DualNode::getSptRootId();
+  return thriftPub;
+}
+
+thrift::Publication
+KvStore::processHashDump(thrift::KeyDumpParams const& keyDumpParams) {
+  tData_.addStatValue("kvstore.cmd_hash_dump", 1, fbzmq::COUNT);
+
+  std::set<std::string> originator{};
+  std::vector<std::string> keyPrefixList{};
+  folly::split(",", keyDumpParams.prefix, keyPrefixList, true);
+  KvStoreFilters kvFilters{keyPrefixList, originator};
+  auto hashDump = dumpHashWithFilters(kvFilters);
+  updatePublicationTtl(hashDump);
+  return hashDump;
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::Publication>>
+KvStore::getKvStoreKeyVals(thrift::KeyGetParams keyGetParams) {
+  return runInEventLoopWithResult<thrift::Publication>(
+      [this, keyGetParams = std::move(keyGetParams)] {
+        VLOG(3) << "Get key requested";
+        return processKeyGet(keyGetParams);
+      });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::Publication>>
+KvStore::dumpKvStoreKeys(thrift::KeyDumpParams keyDumpParams) {
+  return runInEventLoopWithResult<thrift::Publication>(
+      [this, keyDumpParams = std::move(keyDumpParams)] {
+        auto thriftPub = processKeyDump(keyDumpParams);
+        if (thriftPub.hasError()) {
+          throw thrift::OpenrError(thriftPub.error().errString);
+        }
+        return std::move(thriftPub.value());
+      });
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::Publication>>
+KvStore::dumpKvStoreHashes(thrift::KeyDumpParams keyDumpParams) {
+  return runInEventLoopWithResult<thrift::Publication>(
+      [this, keyDumpParams = std::move(keyDumpParams)] {
+        VLOG(3) << "Dump all hashes requested";
+        return processHashDump(keyDumpParams);
+      });
 }
 
 // process a request
+bool
+KvStore::processKeySetParams(thrift::KeySetParams& params) {
+  // TTL refreshes are applied as value-less key-values
+  if (params.ttlUpdates.hasValue()) {
+    tData_.addStatValue(
+        "kvstore.received_ttl_updates", params.ttlUpdates->size(), fbzmq::SUM);
+    for (auto& ttlUpdate : params.ttlUpdates.value()) {
+      thrift::Value value;
+      value.version = ttlUpdate.version;
+      value.originatorId = std::move(ttlUpdate.originatorId);
+      value.ttl = ttlUpdate.ttl;
+      value.ttlVersion = ttlUpdate.ttlVersion;
+      params.keyVals.emplace(std::move(ttlUpdate.key), std::move(value));
+    }
+  }
+
+  // Value deltas are applied on the local value they were encoded against
+  if (params.valueDeltas.hasValue()) {
+    tData_.addStatValue(
+        "kvstore.received_value_deltas",
+        params.valueDeltas->size(),
+        fbzmq::SUM);
+    size_t numMisses{0};
+    for (auto const& delta : params.valueDeltas.value()) {
+      auto it = kvStore_.find(delta.key);
+      if (it != kvStore_.end() and
+          (it->second.version > delta.version or
+           (it->second.version == delta.version and
+            it->second.originatorId == delta.originatorId))) {
+        // we have got this or a better value already
+        continue;
+      }
+      auto value = it != kvStore_.end() ? applyValueDelta(delta, it->second)
+                                        : folly::none;
+      if (not value.hasValue()) {
+        ++numMisses;
+        continue;
+      }
+      params.keyVals.emplace(delta.key, std::move(value.value()));
+    }
+
+    // we don't hold the base of some values, full-sync with the sender
+    auto const& nodeIds = params.nodeIds;
+    if (numMisses and nodeIds.hasValue() and not nodeIds->empty() and
+        peers_.count(nodeIds->back())) {
+      LOG(WARNING) << "Missing base value of " << numMisses
+                   << " value deltas, requesting full-sync with "
+                   << nodeIds->back();
+      tData_.addStatValue("kvstore.value_delta_misses", numMisses, fbzmq::SUM);
+      peersToSyncWith_.emplace(
+          nodeIds->back(),
+          ExponentialBackoff<std::chrono::milliseconds>(
+              Constants::kInitialBackoff, Constants::kMaxBackoff));
+      if (not fullSyncTimer_->isScheduled()) {
+        fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+      }
+    }
+    if (params.keyVals.empty()) {
+      // nothing new or nothing we could apply
+      return true;
+    }
+  }
+
+  if (params.keyVals.empty()) {
+    LOG(ERROR) << "Malformed set request, ignoring";
+    return false;
+  }
+
+  // Update hash for key-values
+  for (auto& kv : params.keyVals) {
+    auto& value = kv.second;
+    if (value.value.hasValue()) {
+      value.hash = generateHash(value.version, value.originatorId, value.value);
+    }
+  }
+
+  // Create publication and merge it with local KvStore
+  thrift::Publication rcvdPublication;
+  rcvdPublication.keyVals = std::move(params.keyVals);
+  rcvdPublication.nodeIds = std::move(params.nodeIds);
+  rcvdPublication.floodRootId = std::move(params.floodRootId);
+  mergePublication(rcvdPublication);
+  return true;
+}
+
 folly::Expected<fbzmq::Message, fbzmq::Error>
 KvStore::processRequestMsg(fbzmq::Message&& request) {
   auto maybeThriftReq =
@@ -870,6 +2311,8 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
     return folly::makeUnexpected(fbzmq::Error());
   }
   auto& thriftReq = maybeThriftReq.value();
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::Command>::findName(thriftReq.cmd));
 
   VLOG(3)
       << "processRequest: command: `"
@@ -888,27 +2331,10 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
     tData_.addStatValue("kvstore.cmd_key_set", 1, fbzmq::COUNT);
 
     auto& ketSetParamsVal = thriftReq.keySetParams.value();
-    if (ketSetParamsVal.keyVals.empty()) {
-      LOG(ERROR) << "Malformed set request, ignoring";
+    if (not processKeySetParams(ketSetParamsVal)) {
       return folly::makeUnexpected(fbzmq::Error());
     }
 
-    // Update hash for key-values
-    for (auto& kv : ketSetParamsVal.keyVals) {
-      auto& value = kv.second;
-      if (value.value.hasValue()) {
-        value.hash =
-            generateHash(value.version, value.originatorId, value.value);
-      }
-    }
-
-    // Create publication and merge it with local KvStore
-    thrift::Publication rcvdPublication;
-    rcvdPublication.keyVals = std::move(ketSetParamsVal.keyVals);
-    rcvdPublication.nodeIds = std::move(ketSetParamsVal.nodeIds);
-    rcvdPublication.floodRootId = std::move(ketSetParamsVal.floodRootId);
-    mergePublication(rcvdPublication);
-
     // respond to the client
     if (ketSetParamsVal.solicitResponse) {
       return fbzmq::Message::from(Constants::kSuccessResponse.toString());
@@ -922,45 +2348,20 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
       return folly::makeUnexpected(fbzmq::Error());
     }
 
-    tData_.addStatValue("kvstore.cmd_key_get", 1, fbzmq::COUNT);
-
-    auto thriftPub = getKeyVals(thriftReq.keyGetParams.value().keys);
-    updatePublicationTtl(thriftPub);
-    return fbzmq::Message::fromThriftObj(thriftPub, serializer_);
+    auto thriftPub = processKeyGet(thriftReq.keyGetParams.value());
+    return toReplyMsg(thriftPub, serializer_);
   }
   case thrift::Command::KEY_DUMP: {
-    VLOG(3) << "Dump all keys requested";
     if (not thriftReq.keyDumpParams.has_value()) {
       LOG(ERROR) << "received none keyDumpParams";
       return folly::makeUnexpected(fbzmq::Error());
     }
 
-    auto& keyDumpParamsVal = thriftReq.keyDumpParams.value();
-    if (keyDumpParamsVal.keyValHashes.hasValue()) {
-      VLOG(3) << "Dump keys requested along with "
-              << keyDumpParamsVal.keyValHashes.value().size()
-              << " keyValHashes item(s) provided from peer";
-    } else {
-      VLOG(3) << "Dump all keys requested - "
-              << "KeyPrefixes:" << keyDumpParamsVal.prefix << " Originator IDs:"
-              << folly::join(",", keyDumpParamsVal.originatorIds);
-    }
-    // TODO, add per request id counters in thrift server
-    tData_.addStatValue("kvstore.cmd_key_dump", 1, fbzmq::COUNT);
-
-    std::vector<std::string> keyPrefixList;
-    folly::split(",", keyDumpParamsVal.prefix, keyPrefixList, true);
-    const auto keyPrefixMatch =
-        KvStoreFilters(keyPrefixList, keyDumpParamsVal.originatorIds);
-    auto thriftPub = dumpAllWithFilters(keyPrefixMatch);
-    if (keyDumpParamsVal.keyValHashes.hasValue()) {
-      thriftPub = dumpDifference(
-          thriftPub.keyVals, keyDumpParamsVal.keyValHashes.value());
+    auto thriftPub = processKeyDump(thriftReq.keyDumpParams.value());
+    if (thriftPub.hasError()) {
+      return folly::makeUnexpected(thriftPub.error());
     }
-    updatePublicationTtl(thriftPub);
-    // I'm the initiator, set flood-root-id
-    thriftPub.floodRootId = DualNode::getSptRootId();
-    return fbzmq::Message::fromThriftObj(thriftPub, serializer_);
+    return toReplyMsg(thriftPub.value(), serializer_);
   }
   case thrift::Command::HASH_DUMP: {
     VLOG(3) << "Dump all hashes requested";
@@ -969,22 +2370,14 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
       return folly::makeUnexpected(fbzmq::Error());
     }
 
-    tData_.addStatValue("kvstore.cmd_hash_dump", 1, fbzmq::COUNT);
-
-    std::set<std::string> originator{};
-    std::vector<std::string> keyPrefixList{};
-    folly::split(
-        ",", thriftReq.keyDumpParams.value().prefix, keyPrefixList, true);
-    KvStoreFilters kvFilters{keyPrefixList, originator};
-    auto hashDump = dumpHashWithFilters(kvFilters);
-    updatePublicationTtl(hashDump);
-    return fbzmq::Message::fromThriftObj(hashDump, serializer_);
+    auto hashDump = processHashDump(thriftReq.keyDumpParams.value());
+    return toReplyMsg(hashDump, serializer_);
   }
   case thrift::Command::COUNTERS_GET: {
     VLOG(3) << "Counters are requested";
     fbzmq::thrift::CounterValuesResponse counters{apache::thrift::FRAGILE,
                                                   getCounters()};
-    return fbzmq::Message::fromThriftObj(counters, serializer_);
+    return toReplyMsg(counters, serializer_);
   }
   case thrift::Command::PEER_ADD: {
     VLOG(2) << "Peer addition requested";
@@ -999,7 +2392,7 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
       return folly::makeUnexpected(fbzmq::Error());
     }
     addPeers(thriftReq.peerAddParams.value().peers);
-    return fbzmq::Message::fromThriftObj(dumpPeers(), serializer_);
+    return toReplyMsg(dumpPeers(), serializer_);
   }
   case thrift::Command::PEER_DEL: {
     VLOG(2) << "Peer deletion requested";
@@ -1014,12 +2407,12 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
       return folly::makeUnexpected(fbzmq::Error());
     }
     delPeers(thriftReq.peerDelParams.value().peerNames);
-    return fbzmq::Message::fromThriftObj(dumpPeers(), serializer_);
+    return toReplyMsg(dumpPeers(), serializer_);
   }
   case thrift::Command::PEER_DUMP: {
     VLOG(2) << "Peer dump requested";
     tData_.addStatValue("kvstore.cmd_peer_dump", 1, fbzmq::COUNT);
-    return fbzmq::Message::fromThriftObj(dumpPeers(), serializer_);
+    return toReplyMsg(dumpPeers(), serializer_);
   }
   case thrift::Command::DUAL: {
     VLOG(2) << "DUAL messages received";
@@ -1046,7 +2439,7 @@ KvStore::processRequestMsg(fbzmq::Message&& request) {
   }
   case thrift::Command::FLOOD_TOPO_GET: {
     VLOG(3) << "FLOOD_TOPO_GET command requested";
-    return fbzmq::Message::fromThriftObj(processFloodTopoGet(), serializer_);
+    return toReplyMsg(processFloodTopoGet(), serializer_);
   }
   default: {
     LOG(ERROR) << "Unknown command received";
@@ -1260,11 +2653,23 @@ KvStore::processSyncResponse() noexcept {
   }
 
   const auto& syncPub = maybeSyncPub.value();
+  if (syncPub.keyRangeDigests.hasValue() and
+      processKeyRangeDigests(requestId, syncPub.keyRangeDigests.value())) {
+    // range sync continues with the next request
+    return;
+  }
   const size_t kvUpdateCnt = mergePublication(syncPub, requestId);
+  confirmSnapshotKeyVals(requestId, syncPub);
   LOG(INFO) << "Sync response received from " << requestId << " with "
             << syncPub.keyVals.size() << " key value pairs which incured "
             << kvUpdateCnt << " key-value updates";
 
+  if (syncPub.nextCursor.hasValue()) {
+    // paged full-sync continues with the next page
+    requestFullSyncPage(requestId, syncPub.nextCursor.value());
+    return;
+  }
+
   if (latestSentPeerSync_.count(requestId)) {
     auto syncDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - latestSentPeerSync_.at(requestId));
@@ -1273,9 +2678,65 @@ KvStore::processSyncResponse() noexcept {
     VLOG(1) << "It took " << syncDuration.count() << " ms to sync with "
             << requestId;
     latestSentPeerSync_.erase(requestId);
+
+    // sync of peers deferred by maxParallelSyncs_ can proceed
+    if (maxParallelSyncs_ > 0 and not peersToSyncWith_.empty()) {
+      fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    }
   }
 }
 
+bool
+KvStore::processKeyRangeDigests(
+    std::string const& peerCmdSocketId,
+    thrift::KeyRangeDigests const& peerDigests) {
+  if (peerDigests.level <= 1 or
+      peerDigests.level > Constants::kKvStoreSyncRangeLevels) {
+    LOG(ERROR) << "Received invalid key range level " << peerDigests.level
+               << " from " << peerCmdSocketId;
+    return false;
+  }
+
+  auto const ranges = getDifferingKeyRanges(peerDigests);
+  VLOG(2) << ranges.size() << " of " << peerDigests.digests.size()
+          << " key range(s) at level " << peerDigests.level
+          << " differ from " << peerCmdSocketId;
+  if (ranges.empty()) {
+    return false;
+  }
+
+  thrift::KvStoreRequest dumpRequest;
+  dumpRequest.cmd = thrift::Command::KEY_DUMP;
+  thrift::KeyDumpParams params;
+  if (peerDigests.level == Constants::kKvStoreSyncRangeLevels) {
+    // exchange hashes of the keys in differing leaf ranges only. Peer
+    // responds with the difference as for a regular full-sync
+    std::set<int64_t> leafRanges(ranges.begin(), ranges.end());
+    std::set<std::string> originator{};
+    std::vector<std::string> keyPrefixList{};
+    KvStoreFilters kvFilters{keyPrefixList, originator};
+    params.keyValHashes = dumpHashWithFilters(kvFilters, leafRanges).keyVals;
+    params.keyRanges = std::move(leafRanges);
+    tData_.addStatValue(
+        "kvstore.range_sync_leaf_ranges", ranges.size(), fbzmq::AVG);
+  } else {
+    params.keyRangeDigests =
+        getKeyRangeDigests(peerDigests.level + 1, getSubRanges(ranges));
+  }
+  dumpRequest.keyDumpParams = std::move(params);
+
+  tData_.addStatValue("kvstore.range_sync_requests", 1, fbzmq::COUNT);
+  auto const ret = sendMessageToPeer(peerCmdSocketId, dumpRequest);
+  if (ret.hasError()) {
+    // next periodic sync starts over
+    LOG(ERROR) << "Failed to send range sync request to " << peerCmdSocketId
+               << ". " << ret.error();
+    collectSendFailureStats(ret.error(), peerCmdSocketId);
+    return false;
+  }
+  return true;
+}
+
 // send sync request from one neighbor randomly
 void
 KvStore::requestSync() {
@@ -1326,15 +2787,19 @@ KvStore::attachCallbacks() {
   VLOG(2) << "KvStore: Registering events callbacks ...";
 
   addSocket(
-      fbzmq::RawZmqSocketPtr{*peerSyncSock_}, ZMQ_POLLIN, [this](int) noexcept {
+      fbzmq::RawZmqSocketPtr{*peerSyncSock_},
+      ZMQ_POLLIN,
+      profiled("socket.peer_sync", [this](int) noexcept {
         // we received a sync response
         VLOG(3) << "KvStore: sync response received";
         processSyncResponse();
-      });
+      }));
 
   // Perform full sync if there are peers to sync with.
   fullSyncTimer_ = fbzmq::ZmqTimeout::make(
-      this, [this]() noexcept { requestFullSyncFromPeers(); });
+      this, profiled("timer.full_sync", [this]() noexcept {
+        requestFullSyncFromPeers();
+      }));
 
   // Schedule periodic call to re-sync with one of our peer
   scheduleTimeout(
@@ -1349,29 +2814,37 @@ KvStore::cleanupTtlCountdownQueue() {
 
   // Iterate through ttlCountdownQueue_ until the top expires in the future
   while (not ttlCountdownQueue_.empty()) {
-    auto top = ttlCountdownQueue_.top();
+    const auto& top = ttlCountdownQueue_.top();
     if (top.expiryTime > now) {
       // Nothing in queue worth evicting
       break;
     }
-    auto it = kvStore_.find(top.key);
+    auto it = kvStore_.find(*top.key);
     if (it != kvStore_.end() and it->second.version == top.version and
-        it->second.originatorId == top.originatorId and
+        it->second.originatorId == *top.originatorId and
         it->second.ttlVersion == top.ttlVersion) {
-      expiredKeys.emplace_back(top.key);
+      expiredKeys.emplace_back(*top.key);
       LOG(WARNING)
           << "Delete expired (key, version, originatorId, ttlVersion, node) "
           << folly::sformat(
                  "({}, {}, {}, {}, {})",
-                 top.key,
+                 *top.key,
                  it->second.version,
                  it->second.originatorId,
                  it->second.ttlVersion,
                  nodeId_);
-      logKvEvent("KEY_EXPIRE", top.key);
+      logKvEvent("KEY_EXPIRE", *top.key);
+      toggleKeyDigest(it->first, it->second);
+      updateKeyPrefixUsage(it->first, it->second, false);
+      sortedKeyVals_.erase(it->first);
       kvStore_.erase(it);
+      updateHashDumps(*top.key);
     }
+    // key of the entry is owned by its handle, erase it last
+    auto handleIt = ttlCountdownHandles_.find(*top.key);
+    ttlOriginatorIds_.release(top.originatorId);
     ttlCountdownQueue_.pop();
+    ttlCountdownHandles_.erase(handleIt);
   }
 
   // Reschedule based on most recent timeout
@@ -1385,8 +2858,11 @@ KvStore::cleanupTtlCountdownQueue() {
     // no key expires
     return;
   }
+  snapshotDirty_ = true;
   tData_.addStatValue(
       "kvstore.expired_key_vals", expiredKeys.size(), fbzmq::SUM);
+  tData_.addStatValue(
+      "kvstore.ttl_expiry_batch_size", expiredKeys.size(), fbzmq::AVG);
   thrift::Publication expiredKeysPub{};
   expiredKeysPub.expiredKeys = std::move(expiredKeys);
   floodPublication(std::move(expiredKeysPub));
@@ -1422,7 +2898,7 @@ KvStore::floodBufferedUpdates() {
     for (const auto& key : kv.second) {
       auto kvStoreIt = kvStore_.find(key);
       if (kvStoreIt != kvStore_.end()) {
-        publication.keyVals.emplace(make_pair(key, kvStoreIt->second));
+        publication.keyVals.emplace(key, kvStoreIt->second);
       } else {
         publication.expiredKeys.emplace_back(key);
       }
@@ -1440,6 +2916,188 @@ KvStore::floodBufferedUpdates() {
   }
 }
 
+void
+KvStore::bufferTtlUpdates(thrift::Publication& publication) {
+  // Same flood root as floodPublication would use
+  auto floodRootId = publication.floodRootId;
+  if (not publication.nodeIds.hasValue() or publication.nodeIds->empty()) {
+    // I'm the initiator, set flood-root-id
+    floodRootId = DualNode::getSptRootId();
+  }
+
+  size_t numTtlUpdates{0};
+  for (auto it = publication.keyVals.begin();
+       it != publication.keyVals.end();) {
+    if (it->second.value.hasValue()) {
+      ++it;
+      continue;
+    }
+    ttlUpdateBuffer_[floodRootId].emplace(it->first);
+    it = publication.keyVals.erase(it);
+    ++numTtlUpdates;
+  }
+
+  if (numTtlUpdates == 0) {
+    return;
+  }
+  tData_.addStatValue(
+      "kvstore.buffered_ttl_updates", numTtlUpdates, fbzmq::SUM);
+  if (not ttlUpdateTimer_->isScheduled()) {
+    ttlUpdateTimer_->scheduleTimeout(Constants::kFloodTtlUpdateInterval);
+  }
+}
+
+void
+KvStore::floodBufferedTtlUpdates() {
+  auto ttlUpdateBuffer = std::move(ttlUpdateBuffer_);
+  ttlUpdateBuffer_.clear();
+
+  for (const auto& kv : ttlUpdateBuffer) {
+    thrift::Publication publication{};
+    publication.floodRootId = kv.first;
+    for (const auto& key : kv.second) {
+      auto kvStoreIt = kvStore_.find(key);
+      if (kvStoreIt == kvStore_.end()) {
+        // expired keys are flooded on their own
+        continue;
+      }
+      // latest TTL of the key, without its value
+      const auto& value = kvStoreIt->second;
+      thrift::Value ttlValue;
+      ttlValue.version = value.version;
+      ttlValue.originatorId = value.originatorId;
+      ttlValue.ttl = value.ttl;
+      ttlValue.ttlVersion = value.ttlVersion;
+      publication.keyVals.emplace(key, std::move(ttlValue));
+    }
+    // we act as a forwarder of buffered updates, flood-root is already set
+    floodPublication(
+        std::move(publication), true /* rate-limit */, false /* set-root */);
+  }
+}
+
+void
+KvStore::bufferPeerPendingKeys(
+    const std::string& peer, const thrift::KeySetParams& params) {
+  auto& peerKeys = peerPendingKeys_[peer];
+  auto& pendingKeys = peerKeys[params.floodRootId];
+  size_t numCoalesced{0};
+  for (auto const& kv : params.keyVals) {
+    if (not pendingKeys.emplace(kv.first).second) {
+      ++numCoalesced;
+    }
+  }
+  if (params.ttlUpdates.hasValue()) {
+    for (auto const& ttlUpdate : params.ttlUpdates.value()) {
+      if (not pendingKeys.emplace(ttlUpdate.key).second) {
+        ++numCoalesced;
+      }
+    }
+  }
+  if (params.valueDeltas.hasValue()) {
+    for (auto const& delta : params.valueDeltas.value()) {
+      if (not pendingKeys.emplace(delta.key).second) {
+        ++numCoalesced;
+      }
+    }
+  }
+  tData_.addStatValue(
+      "kvstore.peer_pending_coalesced_keys", numCoalesced, fbzmq::SUM);
+
+  size_t numPendingKeys{0};
+  for (auto const& kv : peerKeys) {
+    numPendingKeys += kv.second.size();
+  }
+  if (numPendingKeys > Constants::kMaxPeerPendingKeys) {
+    // peer is way behind, let full-sync figure out what it misses
+    LOG(WARNING) << "Dropping " << numPendingKeys << " keys pending for peer "
+                 << peer << ", requesting full-sync instead";
+    tData_.addStatValue("kvstore.peer_pending_overflow", 1, fbzmq::COUNT);
+    peerPendingKeys_.erase(peer);
+    peersToSyncWith_.emplace(
+        peer,
+        ExponentialBackoff<std::chrono::milliseconds>(
+            Constants::kInitialBackoff, Constants::kMaxBackoff));
+    if (not fullSyncTimer_->isScheduled()) {
+      fullSyncTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+    }
+    return;
+  }
+
+  if (not peerPendingTimer_->isScheduled()) {
+    peerPendingTimer_->scheduleTimeout(Constants::kFloodPendingPublication);
+  }
+}
+
+void
+KvStore::floodPeerPendingKeys() {
+  for (auto it = peerPendingKeys_.begin(); it != peerPendingKeys_.end();) {
+    auto const& peer = it->first;
+    auto& peerKeys = it->second;
+    auto const& peerCmdSocketId = peers_.at(peer).second;
+
+    while (not peerKeys.empty()) {
+      auto rootIt = peerKeys.begin();
+
+      // latest values of pending keys, expired ones are skipped
+      thrift::Publication publication;
+      for (auto const& key : rootIt->second) {
+        auto kvStoreIt = kvStore_.find(key);
+        if (kvStoreIt != kvStore_.end()) {
+          publication.keyVals.emplace(key, kvStoreIt->second);
+        }
+      }
+      updatePublicationTtl(publication, true);
+      if (publication.keyVals.empty()) {
+        peerKeys.erase(rootIt);
+        continue;
+      }
+
+      thrift::KvStoreRequest floodRequest;
+      floodRequest.cmd = thrift::Command::KEY_SET;
+      floodRequest.keySetParams = thrift::KeySetParams{};
+      auto& params = floodRequest.keySetParams.value();
+      params.keyVals = std::move(publication.keyVals);
+      params.solicitResponse = false;
+      // we are the sender, peer must not flood them back to us
+      params.nodeIds = std::vector<std::string>{nodeId_};
+      params.floodRootId = rootIt->first;
+
+      tData_.addStatValue("kvstore.sent_publications", 1, fbzmq::COUNT);
+      tData_.addStatValue(
+          "kvstore.sent_key_vals", params.keyVals.size(), fbzmq::SUM);
+      auto streamIt = peerStreams_.find(peer);
+      if (streamIt != peerStreams_.end()) {
+        if (not streamIt->second.second(params)) {
+          tData_.addStatValue(
+              "kvstore.peer_stream.backpressure", 1, fbzmq::COUNT);
+          break;
+        }
+        peerKeys.erase(rootIt);
+        continue;
+      }
+      auto const ret = sendMessageToPeer(peerCmdSocketId, floodRequest);
+      if (ret.hasError()) {
+        VLOG(2) << "Failed to flood pending keys to peer " << peer
+                << ", error: " << ret.error();
+        collectSendFailureStats(ret.error(), peerCmdSocketId);
+        break;
+      }
+      peerKeys.erase(rootIt);
+    }
+
+    if (peerKeys.empty()) {
+      it = peerPendingKeys_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  if (not peerPendingKeys_.empty()) {
+    peerPendingTimer_->scheduleTimeout(Constants::kFloodPendingPublication);
+  }
+}
+
 void
 KvStore::finalizeFullSync(
     const std::vector<std::string>& keys, const std::string& senderId) {
@@ -1514,7 +3172,10 @@ KvStore::collectSendFailureStats(
 
 void
 KvStore::floodPublication(
-    thrift::Publication&& publication, bool rateLimit, bool setFloodRoot) {
+    thrift::Publication&& publication,
+    bool rateLimit,
+    bool setFloodRoot,
+    std::unordered_map<std::string, thrift::ValueDelta> valueDeltas) {
   // rate limit if configured
   if (floodLimiter_ && rateLimit && !floodLimiter_->consume(1)) {
     bufferPublication(std::move(publication));
@@ -1556,6 +3217,8 @@ KvStore::floodPublication(
       fbzmq::Message::fromThriftObj(publication, serializer_).value();
   localPubSock_.sendOne(msg);
   globalPubSock_.sendOne(msg);
+  tData_.addStatValue("kvstore.flood.bytes_serialized", msg.size(), fbzmq::SUM);
+  tData_.addStatValue("kvstore.flood.bytes_sent", 2 * msg.size(), fbzmq::SUM);
 
   //
   // Create request and send only keyValue updates to all neighbors
@@ -1569,16 +3232,66 @@ KvStore::floodPublication(
     publication.floodRootId = DualNode::getSptRootId();
   }
 
+  // publication is not needed anymore, move its values into the request
+  // instead of copying them
+  const size_t numKeyVals = publication.keyVals.size();
   thrift::KvStoreRequest floodRequest;
-  thrift::KeySetParams params;
-
-  params.keyVals = publication.keyVals;
+  floodRequest.cmd = thrift::Command::KEY_SET;
+  floodRequest.keySetParams = thrift::KeySetParams{};
+  auto& params = floodRequest.keySetParams.value();
+  params.keyVals = std::move(publication.keyVals);
   params.solicitResponse = false;
-  params.nodeIds = publication.nodeIds;
-  params.floodRootId = publication.floodRootId;
+  params.nodeIds = std::move(publication.nodeIds);
+  params.floodRootId = std::move(publication.floodRootId);
+
+  if (enableTtlUpdateBatching_) {
+    // send TTL refreshes in compact form
+    std::vector<thrift::TtlUpdate> ttlUpdates;
+    for (auto it = params.keyVals.begin(); it != params.keyVals.end();) {
+      if (it->second.value.hasValue()) {
+        ++it;
+        continue;
+      }
+      thrift::TtlUpdate ttlUpdate;
+      ttlUpdate.key = it->first;
+      ttlUpdate.version = it->second.version;
+      ttlUpdate.originatorId = std::move(it->second.originatorId);
+      ttlUpdate.ttlVersion = it->second.ttlVersion;
+      ttlUpdate.ttl = it->second.ttl;
+      ttlUpdates.emplace_back(std::move(ttlUpdate));
+      it = params.keyVals.erase(it);
+    }
+    if (not ttlUpdates.empty()) {
+      tData_.addStatValue(
+          "kvstore.sent_ttl_update_batch_size", ttlUpdates.size(), fbzmq::AVG);
+      params.ttlUpdates = std::move(ttlUpdates);
+    }
+  }
 
-  floodRequest.cmd = thrift::Command::KEY_SET;
-  floodRequest.keySetParams = params;
+  // send large values as delta of their previous version
+  if (not valueDeltas.empty()) {
+    std::vector<thrift::ValueDelta> deltas;
+    for (auto& kv : valueDeltas) {
+      auto it = params.keyVals.find(kv.first);
+      if (it == params.keyVals.end() or
+          it->second.version != kv.second.version) {
+        continue;
+      }
+      // ttl has been updated for flooding
+      kv.second.ttl = it->second.ttl;
+      kv.second.ttlVersion = it->second.ttlVersion;
+      deltas.emplace_back(std::move(kv.second));
+      params.keyVals.erase(it);
+    }
+    if (not deltas.empty()) {
+      tData_.addStatValue(
+          "kvstore.sent_value_deltas", deltas.size(), fbzmq::SUM);
+      params.valueDeltas = std::move(deltas);
+    }
+  }
+
+  // serialize once and share the message buffer across all flood peers
+  folly::Optional<fbzmq::Message> floodMsg;
 
   const auto& floodPeers = getFloodPeers(params.floodRootId);
   for (const auto& peer : floodPeers) {
@@ -1590,19 +3303,45 @@ KvStore::floodPublication(
             << (senderId.hasValue() ? senderId.value() : "N/A")
             << ", to: " << peer << ", via: " << nodeId_;
 
+    if (peerPendingKeys_.count(peer)) {
+      // peer hasn't drained its pending keys yet, queue behind them
+      bufferPeerPendingKeys(peer, params);
+      continue;
+    }
+
     tData_.addStatValue("kvstore.sent_publications", 1, fbzmq::COUNT);
-    tData_.addStatValue(
-        "kvstore.sent_key_vals", publication.keyVals.size(), fbzmq::SUM);
+    tData_.addStatValue("kvstore.sent_key_vals", numKeyVals, fbzmq::SUM);
+
+    // Send flood request over stream of the peer if it has subscribed one
+    auto streamIt = peerStreams_.find(peer);
+    if (streamIt != peerStreams_.end()) {
+      if (not streamIt->second.second(params)) {
+        tData_.addStatValue(
+            "kvstore.peer_stream.backpressure", 1, fbzmq::COUNT);
+        bufferPeerPendingKeys(peer, params);
+      }
+      continue;
+    }
 
     // Send flood request
     auto const& peerCmdSocketId = peers_.at(peer).second;
-    auto const ret = sendMessageToPeer(peerCmdSocketId, floodRequest);
+    if (not floodMsg.hasValue()) {
+      floodMsg =
+          fbzmq::Message::fromThriftObj(floodRequest, serializer_).value();
+      tData_.addStatValue(
+          "kvstore.flood.bytes_serialized", floodMsg->size(), fbzmq::SUM);
+    }
+    tData_.addStatValue(
+        "kvstore.flood.bytes_sent", floodMsg->size(), fbzmq::SUM);
+    auto const ret = sendMessageToPeer(peerCmdSocketId, floodMsg.value());
     if (ret.hasError()) {
       // this could be pretty common on initial connection setup
       LOG(ERROR) << "Failed to flood publication to peer " << peer
                  << " using id " << peerCmdSocketId
                  << ", error: " << ret.error();
       collectSendFailureStats(ret.error(), peerCmdSocketId);
+      // retry later, e.g. once the send queue of the peer drains
+      bufferPeerPendingKeys(peer, params);
     }
   }
 }
@@ -1633,14 +3372,59 @@ KvStore::mergePublication(
     return 0;
   }
 
-  // Generate delta with local KvStore
+  // Flooded updates are rate limited per originator. Full-sync responses are
+  // not, they catch up on dropped updates at the rate of full-syncs
+  thrift::KeyVals limitedKeyVals;
+  const bool isLimited = not senderId.hasValue() and
+      rateLimitOriginators(rcvdPublication.keyVals, limitedKeyVals);
+  auto const& keyVals = isLimited ? limitedKeyVals : rcvdPublication.keyVals;
+  if (keyVals.empty() and not needFinalizeFullSync) {
+    return 0;
+  }
+
+  // Generate delta with local KvStore. Digests and memory usage of keys which
+  // may change are folded out before and back in after the merge. Values
+  // which may be flooded as delta of their current version are kept as well
+  std::unordered_map<std::string, thrift::Value> deltaBaseValues;
+  for (auto const& kv : keyVals) {
+    auto it = kvStore_.find(kv.first);
+    if (it != kvStore_.end()) {
+      toggleKeyDigest(it->first, it->second);
+      updateKeyPrefixUsage(it->first, it->second, false);
+      if (enableValueDeltas_ and kv.second.value.hasValue() and
+          kv.second.value->size() >= Constants::kKvStoreMinDeltaValueSize and
+          it->second.value.hasValue()) {
+        deltaBaseValues.emplace(it->first, it->second);
+      }
+    }
+  }
   thrift::Publication deltaPublication;
+  const auto mergeStartTime = std::chrono::steady_clock::now();
   deltaPublication.keyVals =
-      mergeKeyValues(kvStore_, rcvdPublication.keyVals, filters_);
+      mergeKeyValues(kvStore_, keyVals, filters_, workerExecutor_.get());
+  mergeHistogram_.addValue(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - mergeStartTime));
+  for (auto const& kv : deltaPublication.keyVals) {
+    // no-op for keys which already existed
+    auto const it = kvStore_.find(kv.first);
+    sortedKeyVals_.emplace(it->first, &*it);
+  }
+  for (auto const& kv : keyVals) {
+    auto it = kvStore_.find(kv.first);
+    if (it != kvStore_.end()) {
+      toggleKeyDigest(it->first, it->second);
+      updateKeyPrefixUsage(it->first, it->second, true);
+      updateHashDumps(it->first);
+    }
+  }
   deltaPublication.floodRootId = rcvdPublication.floodRootId;
 
   const size_t kvUpdateCnt = deltaPublication.keyVals.size();
   tData_.addStatValue("kvstore.updated_key_vals", kvUpdateCnt, fbzmq::SUM);
+  if (kvUpdateCnt > 0) {
+    snapshotDirty_ = true;
+  }
 
   // Populate nodeIds and our nodeId_ to the end
   if (rcvdPublication.nodeIds.hasValue()) {
@@ -1651,8 +3435,26 @@ KvStore::mergePublication(
   updateTtlCountdownQueue(deltaPublication);
 
   if (not deltaPublication.keyVals.empty()) {
+    // Coalesce TTL refreshes, they are flooded later in a batch
+    if (enableTtlUpdateBatching_) {
+      bufferTtlUpdates(deltaPublication);
+    }
+    std::unordered_map<std::string, thrift::ValueDelta> valueDeltas;
+    for (auto const& kv : deltaBaseValues) {
+      auto it = deltaPublication.keyVals.find(kv.first);
+      if (it == deltaPublication.keyVals.end()) {
+        continue;
+      }
+      auto delta = createValueDelta(kv.first, kv.second, it->second);
+      if (delta.hasValue()) {
+        valueDeltas.emplace(kv.first, std::move(delta.value()));
+      }
+    }
     // Flood change to all of our neighbors/subscribers
-    floodPublication(std::move(deltaPublication));
+    if (not deltaPublication.keyVals.empty()) {
+      floodPublication(
+          std::move(deltaPublication), true, true, std::move(valueDeltas));
+    }
   } else {
     // Keep track of received publications which din't update any field
     tData_.addStatValue(
@@ -1668,6 +3470,58 @@ KvStore::mergePublication(
   return kvUpdateCnt;
 }
 
+bool
+KvStore::rateLimitOriginators(
+    thrift::KeyVals const& keyVals, thrift::KeyVals& limitedKeyVals) {
+  if (not originatorUpdateRate_.hasValue()) {
+    return false;
+  }
+
+  std::vector<std::string> droppedKeys;
+  for (auto const& kv : keyVals) {
+    auto const& value = kv.second;
+    // TTL refreshes and our own keys are never dropped
+    if (not value.value.hasValue() or value.originatorId == nodeId_) {
+      continue;
+    }
+    // only updates which would be accepted count against the originator
+    auto it = kvStore_.find(kv.first);
+    if (it != kvStore_.end() and
+        (value.version < it->second.version or
+         (value.version == it->second.version and
+          value.originatorId == it->second.originatorId and
+          value.hash == it->second.hash))) {
+      continue;
+    }
+    auto limiterIt = originatorLimiters_.find(value.originatorId);
+    if (limiterIt == originatorLimiters_.end()) {
+      limiterIt = originatorLimiters_
+                      .emplace(
+                          value.originatorId,
+                          folly::BasicTokenBucket<>(
+                              originatorUpdateRate_->first, // updates per sec
+                              originatorUpdateRate_->second)) // burst size
+                      .first;
+    }
+    if (not limiterIt->second.consume(1)) {
+      VLOG(2) << "Dropping update of key " << kv.first << " from "
+              << value.originatorId << " above its update rate";
+      droppedKeys.emplace_back(kv.first);
+    }
+  }
+  if (droppedKeys.empty()) {
+    return false;
+  }
+
+  tData_.addStatValue(
+      "kvstore.rate_limited_key_vals", droppedKeys.size(), fbzmq::SUM);
+  limitedKeyVals = keyVals;
+  for (auto const& key : droppedKeys) {
+    limitedKeyVals.erase(key);
+  }
+  return true;
+}
+
 fbzmq::thrift::CounterMap
 KvStore::getCounters() {
   // Extract/build counters from thread-data
@@ -1675,9 +3529,41 @@ KvStore::getCounters() {
 
   // Add some more flat counters
   counters["kvstore.num_keys"] = kvStore_.size();
+  counters["kvstore.ttl_countdown_queue_size"] = ttlCountdownQueue_.size();
+  counters["kvstore.ttl_interned_originator_ids"] = ttlOriginatorIds_.size();
   counters["kvstore.num_peers"] = peers_.size();
   counters["kvstore.pending_full_sync"] = peersToSyncWith_.size();
+  counters["kvstore.full_sync_in_flight"] = latestSentPeerSync_.size();
+  counters["kvstore.peer_stream.num_subscribers"] = peerStreams_.size();
+  counters["kvstore.peer_stream.num_subscriptions"] =
+      peerStreamGenerations_.size();
+  counters["kvstore.rate_limited_originators"] = std::count_if(
+      originatorLimiters_.begin(),
+      originatorLimiters_.end(),
+      [](auto const& kv) { return kv.second.available() < 1; });
+  counters["kvstore.snapshot.unconfirmed_keys"] = snapshotKeyVals_.size();
+  for (auto const& kv : peerPendingKeys_) {
+    size_t numPendingKeys{0};
+    for (auto const& rootKeys : kv.second) {
+      numPendingKeys += rootKeys.second.size();
+    }
+    counters[folly::sformat("kvstore.peer_pending_keys.{}", kv.first)] =
+        numPendingKeys;
+  }
+  for (auto const& kv : keyPrefixUsage_) {
+    counters[folly::sformat("kvstore.key_prefix.{}.num_keys", kv.first)] =
+        kv.second.numKeys;
+    counters[folly::sformat("kvstore.key_prefix.{}.bytes", kv.first)] =
+        kv.second.numBytes;
+  }
+  int64_t numCoalescedDualMsgs{0};
+  for (auto const& kv : DualNode::getCounters().neighborCounters) {
+    numCoalescedDualMsgs += kv.second.msgCoalesced;
+  }
+  counters["kvstore.dual.coalesced_messages"] = numCoalescedDualMsgs;
   counters["kvstore.zmq_event_queue_size"] = getEventQueueSize();
+  mergeHistogram_.exportCounters("kvstore.merge_us", counters);
+  exportProfileCounters(counters);
 
   return prepareSubmitCounters(std::move(counters));
 }
@@ -1686,20 +3572,12 @@ void
 KvStore::submitCounters() {
   VLOG(3) << "Submitting counters ... ";
   zmqMonitorClient_->setCounters(getCounters());
+  exportEventLogs(*zmqMonitorClient_);
 }
 
 void
 KvStore::logKvEvent(const std::string& event, const std::string& key) {
-  fbzmq::LogSample sample{};
-
-  sample.addString("event", event);
-  sample.addString("node_name", nodeId_);
-  sample.addString("key", key);
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  logEvent(EventLogEntry(event, nodeId_).addString("key", key));
 }
 
 bool
@@ -1726,4 +3604,11 @@ KvStore::sendDualMessages(
   return true;
 }
 
+void
+KvStore::scheduleDualMessagesFlush() noexcept {
+  if (not dualMessagesTimer_->isScheduled()) {
+    dualMessagesTimer_->scheduleTimeout(Constants::kDualMessagesBatchInterval);
+  }
+}
+
 } // namespace openr
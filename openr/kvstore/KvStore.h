@@ -8,11 +8,15 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-#include <boost/heap/priority_queue.hpp>
+#include <boost/heap/d_ary_heap.hpp>
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
@@ -20,12 +24,16 @@
 #include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/Optional.h>
+#include <folly/Range.h>
 #include <folly/TokenBucket.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/OpenrEventLoop.h>
 #include <openr/common/Types.h>
 #include <openr/common/Util.h>
@@ -35,23 +43,47 @@
 
 namespace openr {
 
+// Table of reference counted strings, e.g. originator IDs repeated across
+// many keys, which are kept once and compared by address
+class StringInternTable {
+ public:
+  // Returns the interned copy of the string, valid until it is released as
+  // many times as it was interned
+  std::string const* intern(std::string const& str);
+
+  void release(std::string const* str);
+
+  size_t
+  size() const {
+    return strings_.size();
+  }
+
+ private:
+  std::unordered_map<std::string, size_t /* references */> strings_;
+};
+
 struct TtlCountdownQueueEntry {
   std::chrono::steady_clock::time_point expiryTime;
-  std::string key;
+  // key held by the handle of the entry in ttlCountdownHandles_
+  std::string const* key{nullptr};
   int64_t version{0};
   int64_t ttlVersion{0};
-  std::string originatorId;
+  // interned in KvStore::ttlOriginatorIds_
+  std::string const* originatorId{nullptr};
   bool
-  operator>(TtlCountdownQueueEntry other) const {
+  operator>(TtlCountdownQueueEntry const& other) const {
     return expiryTime > other.expiryTime;
   }
 };
 
-using TtlCountdownQueue = boost::heap::priority_queue<
+// Mutable heap holding at most one entry per key. TTL refreshes update the
+// entry of the key in place through its handle instead of queueing a new one
+using TtlCountdownQueue = boost::heap::d_ary_heap<
     TtlCountdownQueueEntry,
+    boost::heap::arity<4>,
+    boost::heap::mutable_<true>,
     // Always returns smallest first
-    boost::heap::compare<std::greater<TtlCountdownQueueEntry>>,
-    boost::heap::stable<true>>;
+    boost::heap::compare<std::greater<TtlCountdownQueueEntry>>>;
 
 // Kvstore flooding rate <messages/sec, burst size>
 using KvStoreFloodRate = folly::Optional<std::pair<const size_t, const size_t>>;
@@ -67,12 +99,20 @@ class KvStoreFilters {
   // Check if key matches the filters
   bool keyMatch(std::string const& key, thrift::Value const& value) const;
 
+  // Check if key matches the key prefixes, true if there are none. Used for
+  // keys without value, e.g. expired ones
+  bool keyPrefixMatch(std::string const& key) const;
+
   // return comma separeated string prefix
   std::vector<std::string> getKeyPrefixes() const;
 
   // return set of origninator IDs
   std::set<std::string> getOrigniatorIdList() const;
 
+  // return key prefixes if keys are matched by literal key prefixes only,
+  // i.e. there are no originator IDs and no regex in key prefixes
+  folly::Optional<std::vector<std::string>> getLiteralKeyPrefixes() const;
+
   // print filters
   std::string str() const;
 
@@ -128,15 +168,68 @@ class KvStore final : public OpenrEventLoop, public DualNode {
       std::chrono::milliseconds ttlDecr = Constants::kTtlDecrement,
       bool enableFloodOptimization = false,
       bool isFloodRoot = false,
-      bool useFloodOptimization = false);
+      bool useFloodOptimization = false,
+      // full-sync by comparing key range digests, see thrift::KeyRangeDigests
+      bool enableRangeSync = false,
+      // flood TTL refreshes as batched thrift::TtlUpdate
+      bool enableTtlUpdateBatching = false,
+      // worker threads for merging large publications and building large
+      // dumps, none if 0
+      size_t workerThreads = 0,
+      // flood large values as thrift::ValueDelta of their previous version
+      bool enableValueDeltas = false,
+      // send dual messages to peers in batches, see DualNode
+      bool enableDualMessageBatching = false,
+      // file to write snapshots of key-values to and load them from on start
+      folly::Optional<std::string> snapshotFilePath = folly::none,
+      // pool shared with other modules to use instead of workerThreads
+      std::shared_ptr<folly::CPUThreadPoolExecutor> sharedExecutor = nullptr,
+      // max number of full-syncs in flight, peers on flood SPT are synced
+      // first. Unbounded if 0
+      size_t maxParallelSyncs = 0,
+      // rate of flooded value updates accepted from each originator other
+      // than us, excess is dropped until full-sync. Unlimited if none
+      KvStoreFloodRate originatorUpdateRate = folly::none,
+      // OpenrCtrl port of peers to stream their flood requests from, see
+      // OpenrCtrlCpp.subscribeKvStorePeer. Peers flood over ZMQ if 0
+      int32_t peerStreamPort = 0,
+      // with flood optimization, full-sync with added peers only if they are
+      // on the flood SPT, unless the SPT fails to form
+      bool enableSptFullSync = false);
+
+  ~KvStore() override;
+
+  // Sink of flood requests to a peer streaming them, see
+  // OpenrCtrlCpp.subscribeKvStorePeer. Returns false if the stream can't take
+  // more for now, requests are then held back as for a congested ZMQ peer
+  using PeerStreamSink = std::function<bool(thrift::KeySetParams const&)>;
+
+  // Flood to peer over the sink instead of ZMQ until the stream of the same
+  // token is removed. Invoked from any thread
+  void addPeerStream(
+      std::string const& peerName, int64_t token, PeerStreamSink sink);
+  void removePeerStream(std::string const& peerName, int64_t token);
+
+  // Typed in-process access for ctrl-server, equivalent to KEY_GET, KEY_DUMP
+  // and HASH_DUMP requests. Served in KvStore's event loop and handed over
+  // without serialization
+  folly::SemiFuture<std::unique_ptr<thrift::Publication>> getKvStoreKeyVals(
+      thrift::KeyGetParams keyGetParams);
+  folly::SemiFuture<std::unique_ptr<thrift::Publication>> dumpKvStoreKeys(
+      thrift::KeyDumpParams keyDumpParams);
+  folly::SemiFuture<std::unique_ptr<thrift::Publication>> dumpKvStoreHashes(
+      thrift::KeyDumpParams keyDumpParams);
 
   // process the key-values publication, and attempt to
   // merge it in existing map (first argument)
   // Return a publication made out of the updated values
+  // Values of large updates are compared in key shards over executor if
+  // provided, the result is the same
   static std::unordered_map<std::string, thrift::Value> mergeKeyValues(
       std::unordered_map<std::string, thrift::Value>& kvStore,
       std::unordered_map<std::string, thrift::Value> const& update,
-      folly::Optional<KvStoreFilters> const& filters = folly::none);
+      folly::Optional<KvStoreFilters> const& filters = folly::none,
+      folly::CPUThreadPoolExecutor* executor = nullptr);
 
   // compare two thrift::Values to figure out which value is better to
   // use, it will compare following attributes in order
@@ -148,6 +241,20 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // unknown can happen if value is missing (only hash is provided)
   static int compareValues(const thrift::Value& v1, const thrift::Value& v2);
 
+  // encode newValue of a key as patch of baseValue, its previous version.
+  // Return none if values are too small or the patch isn't much smaller
+  static folly::Optional<thrift::ValueDelta> createValueDelta(
+      std::string const& key,
+      thrift::Value const& baseValue,
+      thrift::Value const& newValue);
+
+  // rebuild value from delta, none if baseValue isn't the base of delta
+  static folly::Optional<thrift::Value> applyValueDelta(
+      thrift::ValueDelta const& delta, thrift::Value const& baseValue);
+
+  // range of key at the given level of key ranges
+  static int64_t getKeyRange(std::string const& key, int32_t level);
+
  private:
   // disable copying
   KvStore(KvStore const&) = delete;
@@ -162,6 +269,9 @@ class KvStore final : public OpenrEventLoop, public DualNode {
       const std::string& neighbor,
       const thrift::DualMessages& msgs) noexcept override;
 
+  // flush batched dual messages after kDualMessagesBatchInterval
+  void scheduleDualMessagesFlush() noexcept override;
+
   // send topology-set command to peer, peer will set/unset me as child
   // rootId: action will applied on given rootId
   // peerName: peer name
@@ -209,12 +319,69 @@ class KvStore final : public OpenrEventLoop, public DualNode {
 
   // dump the entries of my KV store whose keys match the given prefix
   // if prefix is the empty sting, the full KV store is dumped
-  thrift::Publication dumpAllWithFilters(KvStoreFilters const& kvFilters) const;
+  // if leafRanges are given, only keys within these leaf key ranges are dumped
+  // TTLs of dumped entries are the time left, as by updatePublicationTtl()
+  thrift::Publication dumpAllWithFilters(
+      KvStoreFilters const& kvFilters,
+      folly::Optional<std::set<int64_t>> const& leafRanges = folly::none) const;
 
   // dump the hashes of my KV store whose keys match the given prefix
   // if prefix is the empty sting, the full hash store is dumped
+  // if leafRanges are given, only keys within these leaf key ranges are dumped
   thrift::Publication dumpHashWithFilters(
-      KvStoreFilters const& kvFilters) const;
+      KvStoreFilters const& kvFilters,
+      folly::Optional<std::set<int64_t>> const& leafRanges = folly::none);
+
+  // dump a page of at most keyDumpParams.limit entries matching the given
+  // filters and key ranges, in key order after keyDumpParams.cursor. Values
+  // are diffed against keyValHashes of the keys the page covers, if any
+  thrift::Publication dumpPageWithFilters(
+      KvStoreFilters const& kvFilters,
+      thrift::KeyDumpParams const& keyDumpParams) const;
+
+  // hashes of the first limit keys of my KV store after cursor, if any
+  std::unordered_map<std::string, thrift::Value> getHashPage(
+      std::string const& cursor, int32_t limit) const;
+
+  // hashes of key-values matching the given filters, built on first use and
+  // shared by later dumps with the same filters until evicted
+  std::unordered_map<std::string, thrift::Value> const& getHashDump(
+      KvStoreFilters const& kvFilters);
+
+  // update cached hash dumps with the current key-value of key, if any
+  void updateHashDumps(std::string const& key);
+
+  // key-values of my KV store matching the given filters. Only keys under
+  // the matching prefixes are visited if filters are literal key prefixes
+  std::vector<std::pair<const std::string, thrift::Value> const*>
+  getMatchingKeyVals(KvStoreFilters const& kvFilters) const;
+
+
+  // fold digest of a key in or out of the digest of its leaf range
+  void toggleKeyDigest(std::string const& key, thrift::Value const& value);
+
+  // key class used for memory accounting, the key up to the first ':' (e.g.
+  // "adj", "prefix") or "none" if it has none
+  static folly::StringPiece getKeyPrefix(std::string const& key);
+
+  // account a key-value in or out of the memory usage of its key class
+  void updateKeyPrefixUsage(
+      std::string const& key, thrift::Value const& value, bool add);
+
+  // digests of the given key ranges at level
+  thrift::KeyRangeDigests getKeyRangeDigests(
+      int32_t level, std::vector<int64_t> const& ranges) const;
+
+  // ranges on which peer digests differ from mine
+  std::vector<int64_t> getDifferingKeyRanges(
+      thrift::KeyRangeDigests const& peerDigests) const;
+
+  // process key range digests of a range sync response from peer, descending
+  // into differing ranges down to requesting the difference of the keys in
+  // differing leaf ranges. Returns false if nothing is left to sync
+  bool processKeyRangeDigests(
+      std::string const& peerCmdSocketId,
+      thrift::KeyRangeDigests const& peerDigests);
 
   // dump the keys on which hashes differ from given keyVals
   thrift::Publication dumpDifference(
@@ -230,9 +397,29 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // request full-sync (KEY_DUMP) with peersToSyncWith_
   void requestFullSyncFromPeers();
 
+  // request the page of a paged full-sync after cursor from peer
+  void requestFullSyncPage(
+      std::string const& peerCmdSocketId, std::string const& cursor);
+
   // dump all peers we are subscribed to
   thrift::PeerCmdReply dumpPeers();
 
+  // load key-values of snapshotFilePath_ as unconfirmed, their ttls
+  // decremented by the time elapsed since the snapshot
+  void loadSnapshot();
+
+  // write key-values to snapshotFilePath_ if changed since the last snapshot
+  void writeSnapshot();
+
+  // resolve unconfirmed key-values with the full-sync response of a peer
+  // which got their hashes. Those the peer has the same value of are merged
+  // in, the rest is dropped once no such full-sync is outstanding anymore
+  void confirmSnapshotKeyVals(
+      std::string const& peerCmdSocketId, thrift::Publication const& syncPub);
+
+  // drop unconfirmed key-values, peers didn't confirm them
+  void dropSnapshotKeyVals();
+
   // add new query entries into ttlCountdownQueue from publication
   // and Reschedule ttl expiry timer if needed
   void updateTtlCountdownQueue(const thrift::Publication& publication);
@@ -244,10 +431,12 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // publication => data element to flood
   // rateLimit => if 'false', publication will not be rate limited
   // setFloodRoot => if 'false', floodRootId will not be set
+  // valueDeltas => sent to peers instead of the matching key-values
   void floodPublication(
       thrift::Publication&& publication,
       bool rateLimit = true,
-      bool setFloodRoot = true);
+      bool setFloodRoot = true,
+      std::unordered_map<std::string, thrift::ValueDelta> valueDeltas = {});
 
   // update Time to expire filed in Publication
   // removeAboutToExpire: knob to remove keys which are about to expire
@@ -255,6 +444,16 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   void updatePublicationTtl(
       thrift::Publication& thriftPub, bool removeAboutToExpire = false);
 
+  // TTL to send value of key with at timeNow: the time left until the TTL
+  // countdown queue entry of value expires, less ttlDecr_. TTL of value if it
+  // has no entry, folly::none if it is to be left out as expired or, with
+  // removeAboutToExpire, as about to expire
+  folly::Optional<int64_t> getTtlToSend(
+      std::string const& key,
+      thrift::Value const& value,
+      std::chrono::steady_clock::time_point timeNow,
+      bool removeAboutToExpire) const;
+
   // perform last step as a 3-way full-sync request
   // full-sync initiator sends back key-val to senderId (where we made
   // full-sync request to) who need to update those keys
@@ -269,6 +468,28 @@ class KvStore final : public OpenrEventLoop, public DualNode {
       thrift::Publication const& rcvdPublication,
       folly::Optional<std::string> senderId = folly::none);
 
+  // Merge flood or set request, false if it's malformed
+  bool processKeySetParams(thrift::KeySetParams& params);
+
+  // Subscribe to flood requests of peer over stream from OpenrCtrl server at
+  // the address of its cmdUrl and peerStreamPort_, replacing previous one
+  void subscribePeerStream(
+      std::string const& peerName, std::string const& cmdUrl);
+  void unsubscribePeerStream(std::string const& peerName);
+
+  // Merge flood requests of peer received over its stream
+  void processPeerStreamBatch(
+      std::string const& peerName, thrift::KeySetParamsBatch& batch);
+
+  // Stream of peer ended, full-sync with the peer and re-subscribe after
+  // backoff unless the stream has been replaced or the peer removed since
+  void processPeerStreamEnd(std::string const& peerName, uint64_t generation);
+
+  // Drop value updates of originators above originatorUpdateRate_, returns
+  // true and sets limitedKeyVals to remaining key-vals if any is dropped
+  bool rateLimitOriginators(
+      thrift::KeyVals const& keyVals, thrift::KeyVals& limitedKeyVals);
+
   // process a request pending on cmdSock socket
   void processRequest(
       fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER>& cmdSock) noexcept;
@@ -276,6 +497,13 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
       fbzmq::Message&& msg) override;
 
+  // process KEY_GET, KEY_DUMP and HASH_DUMP requests
+  thrift::Publication processKeyGet(thrift::KeyGetParams const& keyGetParams);
+  folly::Expected<thrift::Publication, fbzmq::Error> processKeyDump(
+      thrift::KeyDumpParams const& keyDumpParams);
+  thrift::Publication processHashDump(
+      thrift::KeyDumpParams const& keyDumpParams);
+
   // process spanning-tree-set command to set/unset a child for a given root
   void processFloodTopoSet(
       const thrift::FloodTopoSetParams& setParams) noexcept;
@@ -308,9 +536,29 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // flood pending update blocked by rate limiter
   void floodBufferedUpdates(void);
 
+  // move TTL refreshes out of publication, to be flooded together after
+  // Constants::kFloodTtlUpdateInterval
+  void bufferTtlUpdates(thrift::Publication& publication);
+
+  // flood pending TTL refreshes
+  void floodBufferedTtlUpdates(void);
+
+  // queue keys of a flood request the peer couldn't take, coalesced with
+  // keys already pending for the peer
+  void bufferPeerPendingKeys(
+      const std::string& peer, const thrift::KeySetParams& params);
+
+  // flood latest values of pending keys to peers
+  void floodPeerPendingKeys(void);
+
   // Send message via socket
   folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
       const std::string& peerSocketId, const thrift::KvStoreRequest& request);
+
+  // Send already serialized request via socket. The message buffer is shared,
+  // not copied, so it can be sent to many peers
+  folly::Expected<size_t, fbzmq::Error> sendMessageToPeer(
+      const std::string& peerSocketId, const fbzmq::Message& msg);
   //
   // Private variables
   //
@@ -354,6 +602,15 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   const bool isFloodRoot_{false};
   const bool useFloodOptimization_{false};
 
+  // full-sync by comparing key range digests
+  const bool enableRangeSync_{false};
+
+  // coalesce TTL refreshes and flood them as thrift::TtlUpdate
+  const bool enableTtlUpdateBatching_{false};
+
+  // flood large values as delta of their previous version
+  const bool enableValueDeltas_{false};
+
   //
   // Mutable state
   //
@@ -385,24 +642,77 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // Callback timer to get full KEY_DUMP from peersToSyncWith_
   std::unique_ptr<fbzmq::ZmqTimeout> fullSyncTimer_;
 
+  // max number of full-syncs in latestSentPeerSync_, unbounded if 0
+  const size_t maxParallelSyncs_{0};
+
+  // Added peers in peersToSyncWith_ which are skipped unless they are on the
+  // flood SPT, see enableSptFullSync. Their updates reach us over the SPT
+  const bool enableSptFullSync_{false};
+  std::unordered_set<std::string> sptOnlySyncPeers_;
+
+  // Since when full-syncs of sptOnlySyncPeers_ have been waiting for the SPT
+  // to form, none if it has formed
+  folly::Optional<std::chrono::steady_clock::time_point> sptWaitStart_;
+
   // the serializer/deserializer helper we'll be using
   apache::thrift::CompactSerializer serializer_;
 
   // store keys mapped to (version, originatoId, value)
   std::unordered_map<std::string, thrift::Value> kvStore_;
 
+  // entries of kvStore_ sorted by key for dumps filtered by key prefixes.
+  // Keys and entries are owned by kvStore_
+  std::map<
+      folly::StringPiece,
+      std::pair<const std::string, thrift::Value> const*>
+      sortedKeyVals_;
+
+  // hash dumps of kvStore_ by filters, see getHashDump(). Maintained along
+  // with kvStore_ updates
+  struct HashDump {
+    KvStoreFilters filters;
+    std::unordered_map<std::string, thrift::Value> keyVals;
+  };
+  std::unordered_map<std::string /* filters */, HashDump> hashDumps_;
+
+  // number of keys and approximate bytes held in kvStore_ per key class, see
+  // getKeyPrefix(). Maintained along with kvStore_ updates
+  struct KeyPrefixUsage {
+    int64_t numKeys{0};
+    int64_t numBytes{0};
+  };
+  std::unordered_map<std::string, KeyPrefixUsage> keyPrefixUsage_;
+
+  // digests of the leaf key ranges of kvStore_, each the XOR of the digests of
+  // its keys. Kept up to date with every change of kvStore_
+  std::vector<uint64_t> leafRangeDigests_;
+
   // Timer for submitting to monitor periodically
   std::unique_ptr<fbzmq::ZmqTimeout> monitorTimer_;
 
+  // Worker threads for merging large publications and building large dumps.
+  // They only read kvStore_ while the KvStore thread waits for them
+  std::shared_ptr<folly::CPUThreadPoolExecutor> workerExecutor_;
+
   // TTL count down queue
   TtlCountdownQueue ttlCountdownQueue_;
 
+  // Handle of the TTL count down queue entry for every key with finite TTL
+  std::unordered_map<std::string, TtlCountdownQueue::handle_type>
+      ttlCountdownHandles_;
+
+  // Originator IDs of TTL count down queue entries
+  StringInternTable ttlOriginatorIds_;
+
   // TTL count down timer
   std::unique_ptr<fbzmq::ZmqTimeout> ttlCountdownTimer_;
 
   // Data-struct for maintaining stats/counters
   fbzmq::ThreadData tData_;
 
+  // durations of merging received publications, 100us buckets up to 100ms
+  MicrosecondsHistogram mergeHistogram_{100, 100000};
+
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 
@@ -420,6 +730,35 @@ class KvStore final : public OpenrEventLoop, public DualNode {
   // Kvstore flooding rate
   KvStoreFloodRate floodRate_ = folly::none;
 
+  // Rate of flooded value updates accepted from each originator
+  const KvStoreFloodRate originatorUpdateRate_ = folly::none;
+
+  // Rate limiter of each originator, created on its first update
+  std::unordered_map<std::string, folly::BasicTokenBucket<>>
+      originatorLimiters_;
+
+  // Sinks of peers streaming our flood requests, with their stream tokens
+  std::unordered_map<std::string, std::pair<int64_t, PeerStreamSink>>
+      peerStreams_;
+
+  // OpenrCtrl port of peers to stream flood requests from, 0 if disabled
+  const int32_t peerStreamPort_{0};
+
+  // Generation of the current stream subscription of peers, and backoff of
+  // re-subscribing after a stream ends
+  uint64_t peerStreamGeneration_{0};
+  std::unordered_map<std::string, uint64_t> peerStreamGenerations_;
+  std::unordered_map<
+      std::string,
+      ExponentialBackoff<std::chrono::milliseconds>>
+      peerStreamBackoffs_;
+
+  // Thrift clients of peer streams, only accessed in peerStreamEvbThread_
+  struct PeerStreamClient;
+  std::unordered_map<std::string, std::unique_ptr<PeerStreamClient>>
+      peerStreamClients_;
+  std::unique_ptr<folly::ScopedEventBaseThread> peerStreamEvbThread_;
+
   // timer to send pending kvstore publication
   std::unique_ptr<fbzmq::ZmqTimeout> pendingPublicationTimer_{nullptr};
 
@@ -429,6 +768,55 @@ class KvStore final : public OpenrEventLoop, public DualNode {
       folly::Optional<std::string>,
       std::unordered_set<std::string>>
       publicationBuffer_{};
+
+  // pending keys to flood to peers which couldn't take them, sent with their
+  // latest value once the peer socket drains
+  // map<peer: map<flood-root-id: set<keys>>>
+  std::unordered_map<
+      std::string,
+      std::unordered_map<
+          folly::Optional<std::string>,
+          std::unordered_set<std::string>>>
+      peerPendingKeys_{};
+
+  // timer to retry flooding pending keys to peers
+  std::unique_ptr<fbzmq::ZmqTimeout> peerPendingTimer_{nullptr};
+
+  // timer to flood coalesced TTL refreshes
+  std::unique_ptr<fbzmq::ZmqTimeout> ttlUpdateTimer_{nullptr};
+
+  // timer to flush batched dual messages
+  std::unique_ptr<fbzmq::ZmqTimeout> dualMessagesTimer_{nullptr};
+
+  // file of key-value snapshots, none if disabled
+  const folly::Optional<std::string> snapshotFilePath_;
+
+  // true if kvStore_ changed since the last snapshot
+  bool snapshotDirty_{false};
+
+  // key-values loaded from snapshot, not confirmed by any peer yet. Their
+  // hashes are sent in full-sync requests but they aren't part of kvStore_
+  std::unordered_map<std::string, thrift::Value> snapshotKeyVals_;
+
+  // time snapshotKeyVals_ were loaded at, their ttls are remaining as of then
+  std::chrono::steady_clock::time_point snapshotLoadTime_;
+
+  // socket-ids of peers with outstanding full-sync including hashes of
+  // snapshotKeyVals_
+  std::unordered_set<std::string> snapshotSyncPeers_;
+
+  // timer to write snapshots periodically
+  std::unique_ptr<fbzmq::ZmqTimeout> snapshotTimer_{nullptr};
+
+  // timer to drop snapshotKeyVals_ peers didn't confirm in time
+  std::unique_ptr<fbzmq::ZmqTimeout> snapshotConfirmTimer_{nullptr};
+
+  // pending keys to flood TTL refreshes
+  // map<flood-root-id: set<keys>>
+  std::unordered_map<
+      folly::Optional<std::string>,
+      std::unordered_set<std::string>>
+      ttlUpdateBuffer_{};
 };
 
 } // namespace openr
@@ -20,6 +20,9 @@ KvStoreClient::parseThriftValue(thrift::Value const& value) {
 
   DCHECK(value.value.hasValue());
 
+  if (isCompressedValue(*value.value)) {
+    return readThriftValue<ThriftType>(*value.value, serializer);
+  }
   auto buf =
       folly::IOBuf::wrapBufferAsValue(value.value->data(), value.value->size());
   return fbzmq::util::readThriftObj<ThriftType>(buf, serializer);
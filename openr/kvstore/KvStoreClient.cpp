@@ -9,6 +9,9 @@
 
 #include <openr/common/Util.h>
 
+#include <list>
+#include <mutex>
+
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/SharedMutex.h>
 #include <folly/String.h>
@@ -105,6 +108,19 @@ KvStoreClient::KvStoreClient(
 KvStoreClient::~KvStoreClient() {
   // Removes the KvStore socket from the eventLoop
   eventLoop_->removeSocket(fbzmq::RawZmqSocketPtr{*kvStoreSubSock_});
+  if (kvStoreAsyncCmdSock_) {
+    eventLoop_->removeSocket(fbzmq::RawZmqSocketPtr{*kvStoreAsyncCmdSock_});
+  }
+
+  // Fail outstanding pipelined requests
+  for (auto& kv : asyncRequests_) {
+    kv.second.second.setValue(
+        folly::makeUnexpected(fbzmq::Error(0, "KvStoreClient destroyed")));
+  }
+  for (auto& promise : pendingSetKeyPromises_) {
+    promise.setValue(
+        folly::makeUnexpected(fbzmq::Error(0, "KvStoreClient destroyed")));
+  }
 }
 
 void
@@ -182,76 +198,105 @@ KvStoreClient::persistKey(
     std::string const& value,
     std::chrono::milliseconds ttl /* = Constants::kTtlInfInterval */) {
   VLOG(3) << "KvStoreClient: persistKey called for key " << key;
+  persistKeys({{key, value}}, ttl);
+}
 
-  // Look it up in the existing
-  auto keyIt = persistedKeyVals_.find(key);
-
-  // Default thrift value to use with invalid version=0
-  thrift::Value thriftValue(
-      apache::thrift::FRAGILE,
-      0,
-      nodeId_,
-      value,
-      ttl.count(),
-      0 /* ttl version */,
-      0 /* hash */);
-  CHECK(thriftValue.value);
+void
+KvStoreClient::persistKeys(
+    std::unordered_map<std::string, std::string> const& keyVals,
+    std::chrono::milliseconds ttl /* = Constants::kTtlInfInterval */) {
+  VLOG(3) << "KvStoreClient: persistKeys called for " << keyVals.size()
+          << " keys";
 
-  // Retrieve the existing value for the key. If key is persisted before then
-  // it is the one we have cached locally else we need to fetch it from KvStore
-  if (keyIt == persistedKeyVals_.end()) {
-    // Get latest value from KvStore
-    auto maybeValue = getKey(key);
-    if (maybeValue.hasValue()) {
-      thriftValue = maybeValue.value();
-      // TTL update pub is never saved in kvstore
-      DCHECK(thriftValue.value);
+  // Retrieve the existing values of keys. If key is persisted before then
+  // it is the one we have cached locally else we need to fetch it from
+  // KvStore. Latest values of all such keys are fetched in one request
+  std::vector<std::string> keysToGet;
+  for (auto const& kv : keyVals) {
+    if (not persistedKeyVals_.count(kv.first)) {
+      keysToGet.emplace_back(kv.first);
     }
-  } else {
-    thriftValue = keyIt->second;
-    auto ttlIt = keyTtlBackoffs_.find(key);
-    if (ttlIt != keyTtlBackoffs_.end()) {
-      thriftValue.ttlVersion = ttlIt->second.first.ttlVersion;
+  }
+  std::unordered_map<std::string, thrift::Value> storedKeyVals;
+  if (not keysToGet.empty()) {
+    auto maybeKeyVals = getKeys(keysToGet);
+    if (maybeKeyVals.hasValue()) {
+      storedKeyVals = std::move(maybeKeyVals.value());
     }
   }
 
-  // Decide if we need to re-advertise the key back to kv-store
-  bool valueChange = false;
-  if (!thriftValue.version) {
-    thriftValue.version = 1;
-    valueChange = true;
-  } else if (
-      thriftValue.originatorId != nodeId_ || *thriftValue.value != value) {
-    thriftValue.version++;
-    thriftValue.ttlVersion = 0;
-    thriftValue.value = value;
-    thriftValue.originatorId = nodeId_;
-    valueChange = true;
-  }
+  for (auto const& kv : keyVals) {
+    auto const& key = kv.first;
+    auto const value = maybeCompressValue(key, kv.second);
 
-  // Cache it in persistedKeyVals_. Override the existing one
-  persistedKeyVals_[key] = thriftValue;
+    // Default thrift value to use with invalid version=0
+    thrift::Value thriftValue(
+        apache::thrift::FRAGILE,
+        0,
+        nodeId_,
+        value,
+        ttl.count(),
+        0 /* ttl version */,
+        0 /* hash */);
+    CHECK(thriftValue.value);
+
+    auto keyIt = persistedKeyVals_.find(key);
+    if (keyIt == persistedKeyVals_.end()) {
+      auto storedIt = storedKeyVals.find(key);
+      if (storedIt != storedKeyVals.end()) {
+        thriftValue = storedIt->second;
+        // TTL update pub is never saved in kvstore
+        DCHECK(thriftValue.value);
+      }
+    } else {
+      thriftValue = keyIt->second;
+      auto ttlIt = keyTtlBackoffs_.find(key);
+      if (ttlIt != keyTtlBackoffs_.end()) {
+        thriftValue.ttlVersion = ttlIt->second.value.ttlVersion;
+      }
+    }
+
+    // Decide if we need to re-advertise the key back to kv-store
+    bool valueChange = false;
+    if (!thriftValue.version) {
+      thriftValue.version = 1;
+      valueChange = true;
+    } else if (
+        thriftValue.originatorId != nodeId_ || *thriftValue.value != value) {
+      thriftValue.version++;
+      thriftValue.ttlVersion = 0;
+      thriftValue.value = value;
+      thriftValue.originatorId = nodeId_;
+      valueChange = true;
+    }
 
-  // Override existing backoff as well
-  backoffs_[key] = ExponentialBackoff<std::chrono::milliseconds>(
-      Constants::kInitialBackoff, Constants::kMaxBackoff);
+    // Cache it in persistedKeyVals_. Override the existing one
+    persistedKeyVals_[key] = thriftValue;
 
-  // Invoke callback with updated value
-  auto cb = keyCallbacks_.find(key);
-  if (cb != keyCallbacks_.end() && valueChange) {
-    (cb->second)(key, thriftValue);
-  }
+    // Override existing backoff as well
+    backoffs_[key] = ExponentialBackoff<std::chrono::milliseconds>(
+        Constants::kInitialBackoff, Constants::kMaxBackoff);
 
-  // Add keys to list of pending keys
-  if (valueChange) {
-    keysToAdvertise_.insert(key);
+    // Invoke callback with updated value
+    auto cb = keyCallbacks_.find(key);
+    if (cb != keyCallbacks_.end() && valueChange) {
+      (cb->second)(key, thriftValue);
+    }
+
+    // Add keys to list of pending keys
+    if (valueChange) {
+      keysToAdvertise_.insert(key);
+    }
   }
 
-  // Best effort to advertise pending keys
+  // Best effort to advertise pending keys, all in one request
   advertisePendingKeys();
 
-  scheduleTtlUpdates(
-      key, thriftValue.version, thriftValue.ttlVersion, ttl.count());
+  for (auto const& kv : keyVals) {
+    const auto& thriftValue = persistedKeyVals_.at(kv.first);
+    scheduleTtlUpdates(
+        kv.first, thriftValue.version, thriftValue.ttlVersion, ttl.count());
+  }
 }
 
 folly::Expected<folly::Unit, fbzmq::Error>
@@ -267,7 +312,7 @@ KvStoreClient::setKey(
       apache::thrift::FRAGILE,
       version,
       nodeId_,
-      value,
+      maybeCompressValue(key, value),
       ttl.count(),
       0 /* ttl version */,
       0 /* hash */);
@@ -295,6 +340,48 @@ KvStoreClient::setKey(
   return ret;
 }
 
+void
+KvStoreClient::setCompressedKeyPrefixes(
+    std::vector<std::string> const& keyPrefixes) {
+  compressedKeyPrefixes_ =
+      keyPrefixes.empty() ? nullptr : std::make_unique<KeyPrefix>(keyPrefixes);
+}
+
+std::unordered_map<std::string, int64_t>
+KvStoreClient::getCounters() {
+  return tData_.getCounters();
+}
+
+std::string
+KvStoreClient::maybeCompressValue(
+    std::string const& key, std::string const& value) {
+  if (not compressedKeyPrefixes_ or not compressedKeyPrefixes_->keyMatch(key)) {
+    return value;
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  auto compressed = compressValue(value);
+  tData_.addStatValue(
+      "kvstore_client.compression_time_us",
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - startTime)
+          .count(),
+      fbzmq::SUM);
+  if (not compressed.hasValue()) {
+    tData_.addStatValue("kvstore_client.compression_skipped", 1, fbzmq::COUNT);
+    return value;
+  }
+  tData_.addStatValue(
+      "kvstore_client.compression_ratio_pct",
+      100 * compressed->size() / value.size(),
+      fbzmq::AVG);
+  tData_.addStatValue(
+      "kvstore_client.compression_saved_bytes",
+      value.size() - compressed->size(),
+      fbzmq::SUM);
+  return std::move(compressed).value();
+}
+
 folly::Expected<folly::Unit, fbzmq::Error>
 KvStoreClient::setKey(
     std::string const& key, thrift::Value const& thriftValue) {
@@ -318,7 +405,7 @@ KvStoreClient::scheduleTtlUpdates(
   // infinite TTL does not need update
   if (ttl == Constants::kTtlInfinity) {
     // in case ttl is finite before
-    keyTtlBackoffs_.erase(key);
+    eraseTtlRefresh(key);
     return;
   }
 
@@ -334,15 +421,41 @@ KvStoreClient::scheduleTtlUpdates(
   ttlThriftValue.value = folly::none;
   CHECK(not ttlThriftValue.value.hasValue());
 
-  // renew before Ttl expires about every ttl/3, i.e., try twice
-  // use ExponentialBackoff to track remaining time
-  keyTtlBackoffs_[key] = std::make_pair(
-      ttlThriftValue,
-      ExponentialBackoff<std::chrono::milliseconds>(
-          std::chrono::milliseconds(ttl / 4),
-          std::chrono::milliseconds(ttl / 4 + 1)));
+  // renew right away and then before Ttl expires about every ttl/4. Renewal
+  // is batched with other keys on the next tick of ttlTimer_
+  auto& ttlRefresh = keyTtlBackoffs_[key];
+  ttlRefresh.value = std::move(ttlThriftValue);
+  ttlRefresh.interval = std::chrono::milliseconds(ttl / 4);
+  scheduleTtlRefresh(key, std::chrono::steady_clock::now());
+}
+
+void
+KvStoreClient::scheduleTtlRefresh(
+    std::string const& key, std::chrono::steady_clock::time_point nextRefresh) {
+  auto it = keyTtlBackoffs_.find(key);
+  CHECK(it != keyTtlBackoffs_.end());
+  auto& ttlRefresh = it->second;
+  ttlRefreshSchedule_.erase({ttlRefresh.nextRefresh, &it->first});
+  ttlRefresh.nextRefresh = nextRefresh;
+  ttlRefreshSchedule_.emplace(nextRefresh, &it->first);
+
+  // reschedule timer if this key is due before everything else
+  if (ttlRefreshSchedule_.begin()->second == &it->first) {
+    const auto now = std::chrono::steady_clock::now();
+    ttlTimer_->scheduleTimeout(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::max(nextRefresh, now) - now));
+  }
+}
 
-  advertiseTtlUpdates();
+void
+KvStoreClient::eraseTtlRefresh(std::string const& key) {
+  auto it = keyTtlBackoffs_.find(key);
+  if (it == keyTtlBackoffs_.end()) {
+    return;
+  }
+  ttlRefreshSchedule_.erase({it->second.nextRefresh, &it->first});
+  keyTtlBackoffs_.erase(it);
 }
 
 void
@@ -351,7 +464,7 @@ KvStoreClient::unsetKey(std::string const& key) {
 
   persistedKeyVals_.erase(key);
   backoffs_.erase(key);
-  keyTtlBackoffs_.erase(key);
+  eraseTtlRefresh(key);
   keysToAdvertise_.erase(key);
 }
 
@@ -392,10 +505,26 @@ folly::Expected<thrift::Value, fbzmq::Error>
 KvStoreClient::getKey(std::string const& key) {
   VLOG(3) << "KvStoreClient: getKey called for key " << key;
 
+  auto maybeKeyVals = getKeys({key});
+  if (maybeKeyVals.hasError()) {
+    return folly::makeUnexpected(maybeKeyVals.error());
+  }
+  auto it = maybeKeyVals->find(key);
+  if (it == maybeKeyVals->end()) {
+    return folly::makeUnexpected(fbzmq::Error(0, "key not found"));
+  } else {
+    return std::move(it->second);
+  }
+}
+
+folly::Expected<std::unordered_map<std::string, thrift::Value>, fbzmq::Error>
+KvStoreClient::getKeys(std::vector<std::string> const& keys) {
+  VLOG(3) << "KvStoreClient: getKeys called for " << keys.size() << " keys";
+
   // Prepare request
   thrift::KvStoreRequest request;
   thrift::KeyGetParams params;
-  params.keys.push_back(key);
+  params.keys = keys;
 
   request.cmd = thrift::Command::KEY_GET;
   request.keyGetParams = params;
@@ -414,11 +543,209 @@ KvStoreClient::getKey(std::string const& key) {
   auto& publication = *maybePublication;
   VLOG(3) << "Received " << publication.keyVals.size() << " key-vals.";
 
-  auto it = publication.keyVals.find(key);
-  if (it == publication.keyVals.end()) {
-    return folly::makeUnexpected(fbzmq::Error(0, "key not found"));
-  } else {
-    return it->second;
+  return std::move(publication.keyVals);
+}
+
+folly::Future<folly::Expected<thrift::Value, fbzmq::Error>>
+KvStoreClient::getKeyAsync(std::string const& key) {
+  VLOG(3) << "KvStoreClient: getKeyAsync called for key " << key;
+
+  thrift::KvStoreRequest request;
+  thrift::KeyGetParams params;
+  params.keys.push_back(key);
+  request.cmd = thrift::Command::KEY_GET;
+  request.keyGetParams = params;
+
+  return sendAsyncRequest(request).thenValue(
+      [this,
+       key](folly::Expected<fbzmq::Message, fbzmq::Error>&& maybeReply)
+          -> folly::Expected<thrift::Value, fbzmq::Error> {
+        if (maybeReply.hasError()) {
+          return folly::makeUnexpected(maybeReply.error());
+        }
+        auto maybePublication =
+            maybeReply->readThriftObj<thrift::Publication>(serializer_);
+        if (maybePublication.hasError()) {
+          return folly::makeUnexpected(maybePublication.error());
+        }
+        auto it = maybePublication->keyVals.find(key);
+        if (it == maybePublication->keyVals.end()) {
+          return folly::makeUnexpected(fbzmq::Error(0, "key not found"));
+        }
+        return std::move(it->second);
+      });
+}
+
+folly::Future<folly::Expected<folly::Unit, fbzmq::Error>>
+KvStoreClient::setKeyAsync(
+    std::string const& key, thrift::Value const& thriftValue) {
+  VLOG(3) << "KvStoreClient: setKeyAsync called for key " << key;
+  CHECK(thriftValue.value);
+
+  // Schedule sending of all keys set in this event loop iteration
+  if (pendingSetKeyPromises_.empty()) {
+    eventLoop_->runInEventLoop([this]() noexcept { flushPendingSetKeys(); });
+  }
+  pendingSetKeyVals_[key] = thriftValue;
+  pendingSetKeyPromises_.emplace_back();
+  auto future = pendingSetKeyPromises_.back().getFuture();
+
+  scheduleTtlUpdates(
+      key, thriftValue.version, thriftValue.ttlVersion, thriftValue.ttl);
+
+  return future;
+}
+
+folly::Future<folly::Expected<
+    std::unordered_map<std::string, thrift::Value>,
+    fbzmq::Error>>
+KvStoreClient::dumpAllWithPrefixAsync(std::string const& prefix) {
+  thrift::KvStoreRequest request;
+  thrift::KeyDumpParams params;
+  params.prefix = prefix;
+  request.cmd = thrift::Command::KEY_DUMP;
+  request.keyDumpParams = params;
+
+  return sendAsyncRequest(request).thenValue(
+      [this](folly::Expected<fbzmq::Message, fbzmq::Error>&& maybeReply)
+          -> folly::Expected<
+              std::unordered_map<std::string, thrift::Value>,
+              fbzmq::Error> {
+        if (maybeReply.hasError()) {
+          return folly::makeUnexpected(maybeReply.error());
+        }
+        auto maybePublication =
+            maybeReply->readThriftObj<thrift::Publication>(serializer_);
+        if (maybePublication.hasError()) {
+          return folly::makeUnexpected(maybePublication.error());
+        }
+        return std::move(maybePublication->keyVals);
+      });
+}
+
+void
+KvStoreClient::flushPendingSetKeys() {
+  if (pendingSetKeyPromises_.empty()) {
+    return;
+  }
+
+  thrift::KvStoreRequest request;
+  thrift::KeySetParams params;
+  params.keyVals = std::move(pendingSetKeyVals_);
+  request.cmd = thrift::Command::KEY_SET;
+  request.keySetParams = params;
+  pendingSetKeyVals_.clear();
+  auto promises = std::move(pendingSetKeyPromises_);
+  pendingSetKeyPromises_.clear();
+
+  VLOG(3) << "KvStoreClient: Sending " << params.keyVals.size()
+          << " key-vals of " << promises.size() << " setKeyAsync calls.";
+  sendAsyncRequest(request).thenValue(
+      [promises = std::move(promises)](
+          folly::Expected<fbzmq::Message, fbzmq::Error>&& maybeReply) mutable {
+        folly::Expected<folly::Unit, fbzmq::Error> ret = folly::Unit();
+        if (maybeReply.hasError()) {
+          ret = folly::makeUnexpected(maybeReply.error());
+        } else {
+          const auto response = maybeReply->read<std::string>().value();
+          if (response != Constants::kSuccessResponse.toString()) {
+            ret = folly::makeUnexpected(fbzmq::Error(
+                0, "KvStore error in SET_KEY. Received: " + response));
+          }
+        }
+        for (auto& promise : promises) {
+          promise.setValue(ret);
+        }
+      });
+}
+
+folly::Future<folly::Expected<fbzmq::Message, fbzmq::Error>>
+KvStoreClient::sendAsyncRequest(thrift::KvStoreRequest const& request) {
+  if (not kvStoreAsyncCmdSock_) {
+    kvStoreAsyncCmdSock_ =
+        std::make_unique<fbzmq::Socket<ZMQ_DEALER, fbzmq::ZMQ_CLIENT>>(
+            context_, folly::none, folly::none, fbzmq::NonblockingFlag{true});
+    const auto kvStoreCmd =
+        kvStoreAsyncCmdSock_->connect(fbzmq::SocketUrl{kvStoreLocalCmdUrl_});
+    if (kvStoreCmd.hasError()) {
+      LOG(FATAL) << "Error connecting to URL '" << kvStoreLocalCmdUrl_ << "' "
+                 << kvStoreCmd.error();
+    }
+    eventLoop_->addSocket(
+        fbzmq::RawZmqSocketPtr{*kvStoreAsyncCmdSock_},
+        ZMQ_POLLIN,
+        [this](int) noexcept { processAsyncReply(); });
+    asyncRequestsTimer_ = fbzmq::ZmqTimeout::make(
+        eventLoop_, [this]() noexcept { expireAsyncRequests(); });
+  }
+
+  const auto requestId = nextAsyncRequestId_++;
+  const auto ret = kvStoreAsyncCmdSock_->sendMultiple(
+      fbzmq::Message::from(requestId).value(),
+      fbzmq::Message::fromThriftObj(request, serializer_).value());
+  if (ret.hasError()) {
+    return folly::makeFuture<folly::Expected<fbzmq::Message, fbzmq::Error>>(
+        folly::makeUnexpected(ret.error()));
+  }
+
+  auto& asyncRequest = asyncRequests_[requestId];
+  asyncRequest.first = std::chrono::steady_clock::now() +
+      recvTimeout_.value_or(std::chrono::milliseconds(0));
+  if (recvTimeout_.hasValue() and not asyncRequestsTimer_->isScheduled()) {
+    asyncRequestsTimer_->scheduleTimeout(recvTimeout_.value());
+  }
+  return asyncRequest.second.getFuture();
+}
+
+void
+KvStoreClient::processAsyncReply() {
+  // Read all replies available
+  while (true) {
+    auto maybeReply = kvStoreAsyncCmdSock_->recvMultiple();
+    if (maybeReply.hasError()) {
+      if (maybeReply.error().errNum != EAGAIN) {
+        LOG(ERROR) << "Failed to read reply from KvStore: "
+                   << maybeReply.error();
+      }
+      return;
+    }
+
+    auto& msgs = maybeReply.value();
+    if (msgs.size() != 2) {
+      LOG(ERROR) << "Unexpected reply of " << msgs.size() << " messages.";
+      continue;
+    }
+    auto requestId = msgs.front().read<int64_t>();
+    if (requestId.hasError()) {
+      LOG(ERROR) << "Failed to read request id: " << requestId.error();
+      continue;
+    }
+    auto it = asyncRequests_.find(requestId.value());
+    if (it == asyncRequests_.end()) {
+      VLOG(2) << "Dropping reply of expired request " << requestId.value();
+      continue;
+    }
+    auto promise = std::move(it->second.second);
+    asyncRequests_.erase(it);
+    promise.setValue(std::move(msgs.back()));
+  }
+}
+
+void
+KvStoreClient::expireAsyncRequests() {
+  const auto now = std::chrono::steady_clock::now();
+  while (not asyncRequests_.empty()) {
+    auto it = asyncRequests_.begin();
+    if (it->second.first > now) {
+      asyncRequestsTimer_->scheduleTimeout(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              it->second.first - now));
+      return;
+    }
+    auto promise = std::move(it->second.second);
+    asyncRequests_.erase(it);
+    promise.setValue(folly::makeUnexpected(
+        fbzmq::Error(ETIMEDOUT, "timed out waiting for KvStore reply")));
   }
 }
 
@@ -428,19 +755,40 @@ KvStoreClient::dumpImpl(
     apache::thrift::CompactSerializer& serializer,
     std::string const& prefix,
     folly::Optional<std::chrono::milliseconds> recvTimeout) {
-  // Prepare request
+  // Prepare request. Dump is requested in pages so that KvStore builds and
+  // sends it in bounded chunks, stores not paging respond with all of it
   thrift::KvStoreRequest request;
   thrift::KeyDumpParams params;
 
   params.prefix = prefix;
+  params.limit = Constants::kKvStoreDumpPageSize;
   request.cmd = thrift::Command::KEY_DUMP;
   request.keyDumpParams = params;
 
-  // Send request
-  sock.sendThriftObj(request, serializer);
+  thrift::Publication publication;
+  while (true) {
+    // Send request
+    sock.sendThriftObj(request, serializer);
 
-  // Receive response
-  return sock.recvThriftObj<thrift::Publication>(serializer, recvTimeout);
+    // Receive response
+    auto maybePage =
+        sock.recvThriftObj<thrift::Publication>(serializer, recvTimeout);
+    if (maybePage.hasError()) {
+      return folly::makeUnexpected(maybePage.error());
+    }
+    auto& page = maybePage.value();
+    if (publication.keyVals.empty()) {
+      publication.keyVals = std::move(page.keyVals);
+    } else {
+      for (auto& kv : page.keyVals) {
+        publication.keyVals.emplace(kv.first, std::move(kv.second));
+      }
+    }
+    if (not page.nextCursor.hasValue()) {
+      return publication;
+    }
+    request.keyDumpParams->cursor = std::move(page.nextCursor);
+  }
 }
 
 // static
@@ -450,6 +798,10 @@ KvStoreClient::dumpImpl(
  * allows for very simple code logic, and does not require event loops: we
  * simply dump each KvStore in its thread directly, merging into shared array
  * as the results arrive.
+ *
+ * The shared array is split into key shards with a lock each. A thread merges
+ * its dump into whichever of its shards are free first, so that merges of
+ * large dumps run concurrently instead of one after another.
  */
 std::pair<
     folly::Optional<std::unordered_map<std::string /* key */, thrift::Value>>,
@@ -460,10 +812,16 @@ KvStoreClient::dumpAllWithPrefixMultiple(
     const std::string& prefix,
     folly::Optional<std::chrono::milliseconds> recvTimeout,
     folly::Optional<int> maybeIpTos) {
-  // this protects the shared map
-  std::mutex m;
-  // we'll aggregate responses into this map
-  std::unordered_map<std::string, thrift::Value> merged;
+  // we'll aggregate responses into these key shards, each protected by its
+  // own lock
+  const size_t numShards = std::max<size_t>(
+      1,
+      std::min<size_t>(
+          kvStoreCmdUrls.size(), std::thread::hardware_concurrency()) *
+          Constants::kKvStoreShardsPerThread);
+  std::vector<std::mutex> shardMutexes(numShards);
+  std::vector<std::unordered_map<std::string, thrift::Value>> shards(
+      numShards);
   // query threads will be here
   std::vector<std::thread> threads;
   std::atomic<size_t> failureCount{0};
@@ -517,10 +875,43 @@ KvStoreClient::dumpAllWithPrefixMultiple(
         return;
       }
 
-      const auto& dump = maybe.value();
-      {
-        std::lock_guard<std::mutex> g(m);
-        KvStore::mergeKeyValues(merged, dump.keyVals);
+      // split dump into key shards
+      auto& dump = maybe.value();
+      std::vector<std::unordered_map<std::string, thrift::Value>> updates(
+          numShards);
+      for (auto& kv : dump.keyVals) {
+        auto const shard = std::hash<std::string>{}(kv.first) % numShards;
+        updates[shard].emplace(kv.first, std::move(kv.second));
+      }
+      dump.keyVals.clear();
+      std::list<size_t> pendingShards;
+      for (size_t shard = 0; shard < numShards; ++shard) {
+        if (not updates[shard].empty()) {
+          pendingShards.emplace_back(shard);
+        }
+      }
+
+      // merge into shards not being merged by other threads first and wait
+      // only if all of them are busy
+      while (not pendingShards.empty()) {
+        bool merged{false};
+        for (auto it = pendingShards.begin(); it != pendingShards.end();) {
+          std::unique_lock<std::mutex> lock(
+              shardMutexes[*it], std::try_to_lock);
+          if (not lock.owns_lock()) {
+            ++it;
+            continue;
+          }
+          KvStore::mergeKeyValues(shards[*it], updates[*it]);
+          it = pendingShards.erase(it);
+          merged = true;
+        }
+        if (not merged) {
+          auto const shard = pendingShards.front();
+          std::lock_guard<std::mutex> lock(shardMutexes[shard]);
+          KvStore::mergeKeyValues(shards[shard], updates[shard]);
+          pendingShards.pop_front();
+        }
       }
     });
   } // for
@@ -537,7 +928,20 @@ KvStoreClient::dumpAllWithPrefixMultiple(
     return std::make_pair(folly::none, unreachedUrls);
   }
 
-  return std::make_pair(merged, unreachedUrls);
+  // keys of shards are disjoint, gather them without merging
+  size_t numKeys{0};
+  for (auto const& shard : shards) {
+    numKeys += shard.size();
+  }
+  std::unordered_map<std::string, thrift::Value> merged = std::move(shards[0]);
+  merged.reserve(numKeys);
+  for (size_t shard = 1; shard < numShards; ++shard) {
+    for (auto& kv : shards[shard]) {
+      merged.emplace(kv.first, std::move(kv.second));
+    }
+  }
+
+  return std::make_pair(std::move(merged), unreachedUrls);
 }
 
 folly::Expected<std::unordered_map<std::string, thrift::Value>, fbzmq::Error>
@@ -712,12 +1116,12 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
 
     // key set but not persisted
     if (sk != keyTtlBackoffs_.end() and it == persistedKeyVals_.end()) {
-      auto& setValue = sk->second.first;
+      auto& setValue = sk->second.value;
       if (rcvdValue.version > setValue.version or
           (rcvdValue.version == setValue.version and
            rcvdValue.originatorId > setValue.originatorId)) {
         // key lost, cancel TTL update
-        keyTtlBackoffs_.erase(sk);
+        eraseTtlRefresh(key);
       } else if (
           rcvdValue.version == setValue.version and
           rcvdValue.originatorId == setValue.originatorId and
@@ -726,7 +1130,7 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
         // ttlVersion and update local value if rcvd ttlVersion is higher
         // NOTE: We don't need to advertise the value back
         if (sk != keyTtlBackoffs_.end() and
-            sk->second.first.ttlVersion < rcvdValue.ttlVersion) {
+            sk->second.value.ttlVersion < rcvdValue.ttlVersion) {
           VLOG(1) << "Bumping TTL version for (key, version, originatorId) "
                   << folly::sformat(
                          "({}, {}, {})",
@@ -791,7 +1195,7 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
 
     // copy ttlVersion from ttl backoff map
     if (sk != keyTtlBackoffs_.end()) {
-      currentValue.ttlVersion = sk->second.first.ttlVersion;
+      currentValue.ttlVersion = sk->second.value.ttlVersion;
     }
 
     // update local ttlVersion if received higher ttlVersion.
@@ -800,7 +1204,7 @@ KvStoreClient::processPublication(thrift::Publication const& publication) {
     if (currentValue.ttlVersion < rcvdValue.ttlVersion) {
       currentValue.ttlVersion = rcvdValue.ttlVersion;
       if (sk != keyTtlBackoffs_.end()) {
-        sk->second.first.ttlVersion = rcvdValue.ttlVersion;
+        sk->second.value.ttlVersion = rcvdValue.ttlVersion;
       }
     }
 
@@ -880,31 +1284,31 @@ KvStoreClient::advertisePendingKeys() {
 
 void
 KvStoreClient::advertiseTtlUpdates() {
-  // Build set of keys to advertise ttl updates
-  auto timeout = Constants::kMaxTtlUpdateInterval;
+  const auto now = std::chrono::steady_clock::now();
 
+  // Build set of keys to advertise ttl updates. Keys due shortly are refreshed
+  // early along with keys due now, so that refreshes of keys set around the
+  // same time go out in one request
   std::unordered_map<std::string, thrift::Value> keyVals;
-
-  for (auto& kv : keyTtlBackoffs_) {
-    const auto& key = kv.first;
-    auto& backoff = kv.second.second;
-    if (not backoff.canTryNow()) {
+  for (auto it = ttlRefreshSchedule_.begin(); it != ttlRefreshSchedule_.end();
+       ++it) {
+    if (it->first > now + Constants::kTtlRefreshBatchWindow) {
+      break;
+    }
+    const auto& key = *it->second;
+    auto& ttlRefresh = keyTtlBackoffs_.at(key);
+    if (it->first > now + ttlRefresh.interval / 4) {
       VLOG(2) << "Skipping key: " << key;
-      timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
       continue;
     }
 
-    // Apply backoff
-    backoff.reportError();
-    timeout = std::min(timeout, backoff.getTimeRemainingUntilRetry());
-
-    auto& thriftValue = kv.second.first;
-    const auto it = persistedKeyVals_.find(key);
-    if (it != persistedKeyVals_.end()) {
+    auto& thriftValue = ttlRefresh.value;
+    const auto persistedIt = persistedKeyVals_.find(key);
+    if (persistedIt != persistedKeyVals_.end()) {
       // we may have got a newer vesion for persisted key
-      if (thriftValue.version < it->second.version) {
-        thriftValue.version = it->second.version;
-        thriftValue.ttlVersion = it->second.ttlVersion;
+      if (thriftValue.version < persistedIt->second.version) {
+        thriftValue.version = persistedIt->second.version;
+        thriftValue.ttlVersion = persistedIt->second.ttlVersion;
       }
     }
     // bump ttl version
@@ -922,8 +1326,18 @@ KvStoreClient::advertiseTtlUpdates() {
     keyVals.emplace(key, thriftValue);
   }
 
+  // Schedule next refresh of advertised keys
+  for (auto const& kv : keyVals) {
+    auto& ttlRefresh = keyTtlBackoffs_.at(kv.first);
+    scheduleTtlRefresh(kv.first, now + ttlRefresh.interval);
+  }
+
   // Advertise to KvStore
   if (not keyVals.empty()) {
+    tData_.addStatValue(
+        "kvstore_client.ttl_refresh_batch_size", keyVals.size(), fbzmq::AVG);
+    tData_.addStatValue(
+        "kvstore_client.ttl_refresh_keys", keyVals.size(), fbzmq::SUM);
     const auto ret = setKeysHelper(std::move(keyVals));
     if (not ret) {
       LOG(ERROR) << "Error sending SET_KEY request to KvStore. "
@@ -931,7 +1345,14 @@ KvStoreClient::advertiseTtlUpdates() {
     }
   }
 
-  // Schedule next-timeout for processing/clearing backoffs
+  // Schedule next-timeout for earliest key due for refresh
+  if (ttlRefreshSchedule_.empty()) {
+    return;
+  }
+  const auto timeout = std::min(
+      Constants::kMaxTtlUpdateInterval,
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::max(ttlRefreshSchedule_.begin()->first, now) - now));
   VLOG(2) << "Scheduling ttl timer after " << timeout.count() << "ms.";
   ttlTimer_->scheduleTimeout(timeout);
 }
@@ -8,19 +8,25 @@
 #pragma once
 
 #include <chrono>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 
 #include <folly/Function.h>
 #include <folly/Optional.h>
+#include <folly/futures/Future.h>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
+#include <fbzmq/service/stats/ThreadData.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/ExponentialBackoff.h>
+#include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
 #include <openr/kvstore/KvStore.h>
 
@@ -73,6 +79,15 @@ class KvStoreClient {
       std::string const& value,
       std::chrono::milliseconds ttl = Constants::kTtlInfInterval);
 
+  /**
+   * Bulk version of persistKey. Latest values of keys not persisted before are
+   * fetched, and changed keys are advertised, with one request to KvStore for
+   * all keys.
+   */
+  void persistKeys(
+      std::unordered_map<std::string, std::string> const& keyVals,
+      std::chrono::milliseconds ttl = Constants::kTtlInfInterval);
+
   /**
    * Advertise the key-value into KvStore with specified version. If version is
    * not specified than the one greater than the latest known will be used.
@@ -117,6 +132,15 @@ class KvStoreClient {
    */
   folly::Expected<thrift::Value, fbzmq::Error> getKey(std::string const& key);
 
+  /**
+   * Get multiple keys from KvStore in one request. Keys not found are missing
+   * from returned key-vals.
+   * Return error type:
+   *    1. zmq socket error
+   */
+  folly::Expected<std::unordered_map<std::string, thrift::Value>, fbzmq::Error>
+  getKeys(std::vector<std::string> const& keys);
+
   /**
    * Dump the entries of my KV store whose keys match the given prefix
    * If the prefix is empty string, the full KV store is dumped
@@ -126,6 +150,28 @@ class KvStoreClient {
       fbzmq::Error>
   dumpAllWithPrefix(const std::string& prefix = "");
 
+  /**
+   * Asynchronous flavours of `getKey`, `setKey` and `dumpAllWithPrefix`.
+   * Requests are pipelined over a socket of their own, i.e. many of them can
+   * be outstanding at once, and their replies are delivered to the returned
+   * futures from the event loop. Hence they must not be waited upon from the
+   * event loop thread, chain continuations instead.
+   *
+   * `setKeyAsync` calls made within the same event loop iteration are sent to
+   * KvStore as a single KEY_SET request.
+   *
+   * Futures complete with same values and errors as the synchronous APIs,
+   * also with an error if no reply is received within `recvTimeout`.
+   */
+  folly::Future<folly::Expected<thrift::Value, fbzmq::Error>> getKeyAsync(
+      std::string const& key);
+  folly::Future<folly::Expected<folly::Unit, fbzmq::Error>> setKeyAsync(
+      std::string const& key, thrift::Value const& value);
+  folly::Future<folly::Expected<
+      std::unordered_map<std::string /* key */, thrift::Value /* value */>,
+      fbzmq::Error>>
+  dumpAllWithPrefixAsync(std::string const& prefix = "");
+
   // helper for deserialization
   template <typename ThriftType>
   static ThriftType parseThriftValue(thrift::Value const& value);
@@ -246,6 +292,17 @@ class KvStoreClient {
     return eventLoop_;
   }
 
+  /**
+   * Compress large values of keys matching any of the key prefixes with zstd
+   * in `setKey` and `persistKey(s)`. Consumers decompress them when parsing,
+   * e.g. with `parseThriftValue` or `readThriftValue`. Peers must support
+   * compressed values before it is enabled
+   */
+  void setCompressedKeyPrefixes(std::vector<std::string> const& keyPrefixes);
+
+  // Counters of value compression
+  std::unordered_map<std::string, int64_t> getCounters();
+
  private:
   /**
    * Process timeout is called when timeout expires.
@@ -271,6 +328,10 @@ class KvStoreClient {
   folly::Expected<folly::Unit, fbzmq::Error> setKeysHelper(
       std::unordered_map<std::string, thrift::Value> keyVals);
 
+  // Compressed value if key has compression enabled and value is large
+  std::string maybeCompressValue(
+      std::string const& key, std::string const& value);
+
   /**
    * Utility function to del peers in KvStore
    * return error type:
@@ -297,12 +358,21 @@ class KvStoreClient {
       int64_t ttl);
 
   /**
-   * Helper function to advertise TTL update
+   * Helper function to advertise TTL update of keys due for refresh, in a
+   * single batch
    */
   void advertiseTtlUpdates();
 
   /**
-   * Helper to do full dumps
+   * Helper functions to add or remove a key from TTL refresh schedule
+   */
+  void scheduleTtlRefresh(
+      std::string const& key,
+      std::chrono::steady_clock::time_point nextRefresh);
+  void eraseTtlRefresh(std::string const& key);
+
+  /**
+   * Helper to do full dumps, requested page by page
    */
   static folly::Expected<thrift::Publication, fbzmq::Error> dumpImpl(
       fbzmq::Socket<ZMQ_REQ, fbzmq::ZMQ_CLIENT>& sock,
@@ -319,6 +389,22 @@ class KvStoreClient {
 
   void checkPersistKeyInStore();
 
+  /**
+   * Send request over pipelined socket, creating it on first use. Returned
+   * future gets the reply, or an error on failing to send or on timeout.
+   */
+  folly::Future<folly::Expected<fbzmq::Message, fbzmq::Error>>
+  sendAsyncRequest(thrift::KvStoreRequest const& request);
+
+  // Deliver reply received on pipelined socket to its request
+  void processAsyncReply();
+
+  // Fail requests which haven't got any reply within recvTimeout
+  void expireAsyncRequests();
+
+  // Send key-vals of `setKeyAsync` calls in a single request
+  void flushPendingSetKeys();
+
   //
   // Immutable state
   //
@@ -374,13 +460,21 @@ class KvStoreClient {
       ExponentialBackoff<std::chrono::milliseconds>>
       backoffs_;
 
-  // backoff associated with each key for freshing TTL
-  std::unordered_map<
-      std::string /* key */,
-      std::pair<
-          thrift::Value /* value */,
-          ExponentialBackoff<std::chrono::milliseconds>>>
-      keyTtlBackoffs_;
+  // TTL refresh state of a key
+  struct TtlRefresh {
+    // value-less key-val advertised to refresh TTL
+    thrift::Value value;
+    std::chrono::milliseconds interval{0};
+    std::chrono::steady_clock::time_point nextRefresh;
+  };
+
+  // TTL refresh state of each key with finite TTL
+  std::unordered_map<std::string /* key */, TtlRefresh> keyTtlBackoffs_;
+
+  // Keys in keyTtlBackoffs_ ordered by time of next refresh, so that a tick
+  // only visits keys due for refresh. Points into keys of keyTtlBackoffs_.
+  std::set<std::pair<std::chrono::steady_clock::time_point, std::string const*>>
+      ttlRefreshSchedule_;
 
   // Set of local keys to be re-advertised.
   std::unordered_set<std::string> keysToAdvertise_;
@@ -396,6 +490,34 @@ class KvStoreClient {
 
   // prefix key filter to apply for key updates
   KvStoreFilters keyPrefixFilter_{{}, {}};
+
+  // DEALER socket for pipelined KvStore API calls. Each request is sent with
+  // its id, which KvStore returns along with the reply
+  std::unique_ptr<fbzmq::Socket<ZMQ_DEALER, fbzmq::ZMQ_CLIENT>>
+      kvStoreAsyncCmdSock_;
+
+  // Outstanding pipelined requests by id (ordered by send time)
+  int64_t nextAsyncRequestId_{0};
+  std::map<
+      int64_t /* request id */,
+      std::pair<
+          std::chrono::steady_clock::time_point /* expiry */,
+          folly::Promise<folly::Expected<fbzmq::Message, fbzmq::Error>>>>
+      asyncRequests_;
+
+  // Timer to fail pipelined requests without reply
+  std::unique_ptr<fbzmq::ZmqTimeout> asyncRequestsTimer_;
+
+  // Key-vals of `setKeyAsync` calls yet to be sent and their promises
+  std::unordered_map<std::string, thrift::Value> pendingSetKeyVals_;
+  std::vector<folly::Promise<folly::Expected<folly::Unit, fbzmq::Error>>>
+      pendingSetKeyPromises_;
+
+  // Key prefixes whose values are compressed, none if compression is off
+  std::unique_ptr<KeyPrefix> compressedKeyPrefixes_;
+
+  // Stats of value compression
+  fbzmq::ThreadData tData_;
 };
 
 } // namespace openr
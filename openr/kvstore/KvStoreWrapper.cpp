@@ -31,7 +31,16 @@ KvStoreWrapper::KvStoreWrapper(
     KvStoreFloodRate kvStoreRate,
     std::chrono::milliseconds ttlDecr,
     bool enableFloodOptimization,
-    bool isFloodRoot)
+    bool isFloodRoot,
+    bool enableRangeSync,
+    bool enableTtlUpdateBatching,
+    size_t workerThreads,
+    bool enableValueDeltas,
+    folly::Optional<std::string> snapshotFilePath,
+    size_t maxParallelSyncs,
+    KvStoreFloodRate originatorUpdateRate,
+    int32_t peerStreamPort,
+    bool enableSptFullSync)
     : nodeId(nodeId),
       localPubUrl(folly::sformat("inproc://{}-kvstore-pub", nodeId)),
       globalCmdUrl(folly::sformat("inproc://{}-kvstore-global-cmd", nodeId)),
@@ -60,7 +69,18 @@ KvStoreWrapper::KvStoreWrapper(
       ttlDecr,
       enableFloodOptimization,
       isFloodRoot,
-      useFloodOptimization);
+      useFloodOptimization,
+      enableRangeSync,
+      enableTtlUpdateBatching,
+      workerThreads,
+      enableValueDeltas,
+      false /* enableDualMessageBatching */,
+      std::move(snapshotFilePath),
+      nullptr /* sharedExecutor */,
+      maxParallelSyncs,
+      originatorUpdateRate,
+      peerStreamPort,
+      enableSptFullSync);
 
   localCmdUrl = kvStore_->inprocCmdUrl;
 }
@@ -282,6 +302,24 @@ KvStoreWrapper::syncKeyVals(thrift::KeyVals const& keyValHashes) {
   return publication.keyVals;
 }
 
+thrift::Publication
+KvStoreWrapper::dumpWithParams(thrift::KeyDumpParams const& params) {
+  // Prepare request
+  thrift::KvStoreRequest request;
+  request.cmd = thrift::Command::KEY_DUMP;
+  request.keyDumpParams = params;
+
+  // Make ZMQ call and wait for response
+  reqSock_.sendThriftObj(request, serializer_);
+  auto maybeMsg = reqSock_.recvThriftObj<thrift::Publication>(serializer_);
+  if (maybeMsg.hasError()) {
+    throw std::runtime_error(folly::sformat(
+        "dumpWithParams recv response failed: {}",
+        maybeMsg.error().errString));
+  }
+  return maybeMsg.value();
+}
+
 thrift::Publication
 KvStoreWrapper::recvPublication(std::chrono::milliseconds timeout) {
   auto maybeMsg =
@@ -37,7 +37,16 @@ class KvStoreWrapper {
       KvStoreFloodRate kvstoreRate = folly::none,
       std::chrono::milliseconds ttlDecr = Constants::kTtlDecrement,
       bool enableFloodOptimization = false,
-      bool isFloodRoot = false);
+      bool isFloodRoot = false,
+      bool enableRangeSync = false,
+      bool enableTtlUpdateBatching = false,
+      size_t workerThreads = 0,
+      bool enableValueDeltas = false,
+      folly::Optional<std::string> snapshotFilePath = folly::none,
+      size_t maxParallelSyncs = 0,
+      KvStoreFloodRate originatorUpdateRate = folly::none,
+      int32_t peerStreamPort = 0,
+      bool enableSptFullSync = false);
 
   ~KvStoreWrapper() {
     stop();
@@ -96,6 +105,11 @@ class KvStoreWrapper {
   std::unordered_map<std::string /* key */, thrift::Value> syncKeyVals(
       thrift::KeyVals const& keyValHashes);
 
+  /**
+   * API to get the KEY_DUMP reply to params as is, e.g. a page of the dump
+   */
+  thrift::Publication dumpWithParams(thrift::KeyDumpParams const& params);
+
   /**
    * API to listen for a publication on PUB socket. This blocks until a
    * publication is received on the socket from KvStore.
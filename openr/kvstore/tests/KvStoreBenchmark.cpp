@@ -6,7 +6,9 @@
  */
 
 #include <folly/Benchmark.h>
+#include <cmath>
 #include <cstdlib>
+#include <thread>
 #include <unordered_set>
 
 #include <fbzmq/zmq/Zmq.h>
@@ -17,8 +19,25 @@
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/KvStore_types.h>
 #include <openr/kvstore/KvStore.h>
+#include <openr/kvstore/KvStoreClient.h>
 #include <openr/kvstore/KvStoreWrapper.h>
 
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to it, with a custom name for each set
+ * of parameters
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FB_STRINGIZE(name) "(" FB_STRINGIZE(param_name) ")",             \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
 namespace {
 
 // interval for periodic syncs
@@ -32,6 +51,21 @@ const std::chrono::seconds kTimeout(100);
 const int kSizeOfKey = 32;
 // The byte size of a value
 const int kSizeOfValue = 1024;
+// Number of worker threads for parallel merge
+const size_t kMergeThreads = 4;
+// Number of keys in each store dumped by dumpAllWithPrefixMultiple
+const size_t kNumKeysPerDumpedStore = 10000;
+// Number of spines (flood roots) in Clos topology
+const size_t kNumClosSpines = 4;
+// Interval for polling flooding topology until it converged
+const std::chrono::milliseconds kFloodTopoPollInterval(100);
+
+// Topologies of stores flooding to each other
+enum class FloodTopology {
+  RING,
+  GRID,
+  CLOS,
+};
 
 /**
  * Produce a random string of given length - for value generation
@@ -49,6 +83,24 @@ genRandomStr(const int len) {
   }
   return s;
 }
+
+/**
+ * Value hash previously used for thrift::Value.hash, for comparison with
+ * generateHash()
+ */
+int64_t
+generateBoostHash(
+    const int64_t version,
+    const std::string& originatorId,
+    const folly::Optional<std::string>& value) {
+  size_t seed = 0;
+  boost::hash_combine(seed, version);
+  boost::hash_combine(seed, originatorId);
+  if (value.hasValue()) {
+    boost::hash_combine(seed, value.value());
+  }
+  return static_cast<int64_t>(seed);
+}
 } // namespace
 
 namespace openr {
@@ -99,10 +151,10 @@ class KvStoreTestFixture {
     return stores_.back().get();
   }
 
- private:
   // Public member variables
   fbzmq::Context context;
 
+ private:
   // Internal stores
   std::vector<std::unique_ptr<KvStoreWrapper>> stores_{};
 };
@@ -112,13 +164,14 @@ class KvStoreTestFixture {
  * 1. Randomly choose #numOfUpdateKeys keys from kvStore
  * 2. Randomly choose a newValue for each key
  * 3. Insert (key, newValue)s into update
- * 4. Merge update with kvStore
+ * 4. Merge update with kvStore, in key shards over executor if provided
  */
 void
 updateKvStore(
     const uint32_t numOfUpdateKeys,
     uint64_t& version,
-    std::unordered_map<std::string, thrift::Value>& kvStore) {
+    std::unordered_map<std::string, thrift::Value>& kvStore,
+    folly::CPUThreadPoolExecutor* executor = nullptr) {
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> update;
   // Randomly choose the start index of the keys to be updated
@@ -127,9 +180,10 @@ updateKvStore(
       ? kvStore.size() - numOfUpdateKeys
       : offsetIdx;
 
-  for (auto idx = offsetIdx; idx < offsetIdx + numOfUpdateKeys; idx++) {
-    auto kvIt = kvStore.begin();
-    std::advance(kvIt, idx);
+  auto kvIt = kvStore.begin();
+  std::advance(kvIt, offsetIdx);
+  for (auto idx = offsetIdx; idx < offsetIdx + numOfUpdateKeys;
+       idx++, kvIt++) {
     auto key = kvIt->first;
     auto newValue = genRandomStr(kSizeOfValue);
     thrift::Value thriftValue(
@@ -150,7 +204,7 @@ updateKvStore(
   suspender.dismiss(); // Start measuring benchmark time
 
   // Merge update with kvStore
-  KvStore::mergeKeyValues(kvStore, update);
+  KvStore::mergeKeyValues(kvStore, update, folly::none, executor);
 }
 
 /**
@@ -199,8 +253,11 @@ floodingUpdate(
  * 2. Merge update with kvStore
  */
 static void
-BM_KvStoreMergeKeyValues(
-    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+runMergeKeyValues(
+    uint32_t iters,
+    uint32_t numOfKeysInStore,
+    size_t numOfUpdateKeys,
+    folly::CPUThreadPoolExecutor* executor) {
   CHECK_LE(numOfUpdateKeys, numOfKeysInStore);
   auto suspender = folly::BenchmarkSuspender();
   std::unordered_map<std::string, thrift::Value> kvStore;
@@ -229,10 +286,29 @@ BM_KvStoreMergeKeyValues(
   version++;
   suspender.dismiss(); // Start measuring benchmark time
   for (auto i = 0; i < iters; i++) {
-    updateKvStore(numOfUpdateKeys, version, kvStore);
+    updateKvStore(numOfUpdateKeys, version, kvStore, executor);
   }
 }
 
+static void
+BM_KvStoreMergeKeyValues(
+    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+  runMergeKeyValues(iters, numOfKeysInStore, numOfUpdateKeys, nullptr);
+}
+
+/**
+ * Benchmark for mergeKeyValues() comparing values in key shards over
+ * kMergeThreads worker threads
+ */
+static void
+BM_KvStoreParallelMergeKeyValues(
+    uint32_t iters, uint32_t numOfKeysInStore, size_t numOfUpdateKeys) {
+  auto suspender = folly::BenchmarkSuspender();
+  folly::CPUThreadPoolExecutor executor(kMergeThreads);
+  suspender.dismiss();
+  runMergeKeyValues(iters, numOfKeysInStore, numOfUpdateKeys, &executor);
+}
+
 /**
  * Benchmark for a full dump:
  * 1. Start kvStore
@@ -272,6 +348,263 @@ BM_KvStoreDumpAll(uint32_t iters, size_t numOfKeysInStore) {
   }
 }
 
+/**
+ * Benchmark for a full dump of keys with finite TTL, as replied to full-sync
+ * requests, which sends the time left of every key:
+ * 1. Start kvStore
+ * 2. Set (key, value)s with finite TTL into kvStore
+ * 3. Benchmark the time for dumpAll()
+ */
+static void
+BM_KvStoreDumpAllWithTtl(uint32_t iters, size_t numOfKeysInStore) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore", emptyPeers);
+  kvStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  keyVals.reserve(numOfKeysInStore);
+  for (auto idx = 0; idx < numOfKeysInStore; idx++) {
+    auto key = genRandomStr(kSizeOfKey);
+    auto value = genRandomStr(kSizeOfValue);
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        "kvStore" /* originatorId */,
+        value /* value */,
+        3600 * 1000 /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    keyVals.emplace_back(std::move(key), std::move(thriftVal));
+  }
+  // Adding keys to kvStore
+  kvStore->setKeys(keyVals);
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (auto i = 0; i < iters; i++) {
+    kvStore->dumpAll();
+  }
+}
+
+/**
+ * Benchmark for dumping and merging multiple stores:
+ * 1. Start #numOfStores kvStores
+ * 2. Set the same keys into all of them, with a different version in each
+ * 3. Benchmark the time for dumpAllWithPrefixMultiple() from all stores
+ */
+static void
+BM_KvStoreDumpAllWithPrefixMultiple(uint32_t iters, size_t numOfStores) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+
+  std::vector<std::string> keys;
+  for (size_t idx = 0; idx < kNumKeysPerDumpedStore; idx++) {
+    keys.emplace_back(genRandomStr(kSizeOfKey));
+  }
+
+  std::vector<fbzmq::SocketUrl> urls;
+  for (size_t storeIdx = 0; storeIdx < numOfStores; storeIdx++) {
+    auto kvStore = kvStoreTestFixture->createKvStore(
+        folly::sformat("kvStore{}", storeIdx), emptyPeers);
+    kvStore->run();
+
+    std::vector<std::pair<std::string, thrift::Value>> keyVals;
+    for (auto const& key : keys) {
+      thrift::Value thriftVal(
+          apache::thrift::FRAGILE,
+          1 + folly::Random::rand32() % numOfStores /* version */,
+          kvStore->nodeId /* originatorId */,
+          genRandomStr(kSizeOfValue) /* value */,
+          Constants::kTtlInfinity /* ttl */,
+          0 /* ttl version */,
+          0 /* hash */);
+      thriftVal.hash = generateHash(
+          thriftVal.version, thriftVal.originatorId, thriftVal.value);
+      keyVals.emplace_back(key, std::move(thriftVal));
+    }
+    kvStore->setKeys(keyVals);
+    urls.emplace_back(kvStore->localCmdUrl);
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (auto i = 0; i < iters; i++) {
+    auto merged = KvStoreClient::dumpAllWithPrefixMultiple(
+        kvStoreTestFixture->context,
+        urls,
+        "" /* prefix */,
+        std::chrono::milliseconds(kTimeout));
+    CHECK(merged.first.hasValue());
+  }
+}
+
+/**
+ * Benchmark for dumping keys matching a key prefix filter
+ * 1. Start kvStore
+ * 2. Add #numOfKeysInStore keys, a tenth of them with "adj:" marker
+ * 3. Benchmark the time for dumpAll() with "adj:" key prefix filter
+ */
+static void
+BM_KvStoreDumpAllWithFilters(uint32_t iters, size_t numOfKeysInStore) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore", emptyPeers);
+  kvStore->run();
+
+  for (auto idx = 0; idx < numOfKeysInStore; idx++) {
+    auto key = folly::sformat(
+        "{}{}", idx % 10 ? "prefix:" : "adj:", genRandomStr(kSizeOfKey));
+    auto value = genRandomStr(kSizeOfValue);
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        "kvStore" /* originatorId */,
+        value /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+
+    // Adding key to kvStore
+    kvStore->setKey(key, thriftVal);
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (auto i = 0; i < iters; i++) {
+    kvStore->dumpAll(KvStoreFilters({"adj:"}, {}));
+  }
+}
+
+/**
+ * Benchmark for dumping keys with key prefix and originator filters, as set
+ * on leaf nodes, which are matched key by key
+ * 1. Start kvStore
+ * 2. Add #numOfKeysInStore keys of 100 nodes with various markers
+ * 3. Benchmark the time for dumpAll() with filters of a leaf node, with its
+ *    key prefixes matched literally or as equivalent regexes
+ */
+static void
+BM_KvStoreDumpAllWithLeafFilters(
+    uint32_t iters, size_t numOfKeysInStore, bool regexPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+
+  auto kvStore = kvStoreTestFixture->createKvStore("kvStore", emptyPeers);
+  kvStore->run();
+
+  const std::vector<std::string> markers{
+      "adj:", "prefix:", "allocprefix:", "nodeLabel:", "intf:"};
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (auto idx = 0; idx < numOfKeysInStore; idx++) {
+    auto key = folly::sformat(
+        "{}node-{}:{}",
+        markers.at(idx % markers.size()),
+        idx % 100,
+        genRandomStr(kSizeOfKey));
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        folly::sformat("node-{}", idx % 100) /* originatorId */,
+        genRandomStr(kSizeOfValue) /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    keyVals.emplace_back(std::move(key), std::move(thriftVal));
+  }
+  kvStore->setKeys(keyVals);
+
+  // empty group keeps matches the same while forcing the regex matcher
+  std::vector<std::string> keyPrefixes{
+      "adj:node-1", "prefix:node-1", "allocprefix:", "nodeLabel:"};
+  if (regexPrefixes) {
+    for (auto& keyPrefix : keyPrefixes) {
+      keyPrefix += "(?:)";
+    }
+  }
+
+  suspender.dismiss(); // Start measuring benchmark time
+  for (auto i = 0; i < iters; i++) {
+    kvStore->dumpAll(KvStoreFilters(keyPrefixes, {"node-1"}));
+  }
+}
+
+/**
+ * Benchmark for matching keys with key prefixes of a leaf node, literally or
+ * as equivalent regexes
+ */
+static void
+BM_KeyPrefixMatch(uint32_t iters, bool regexPrefixes) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::vector<std::string> markers{
+      "adj:", "prefix:", "allocprefix:", "nodeLabel:", "intf:"};
+  std::vector<std::string> keys;
+  for (auto idx = 0; idx < 10000; idx++) {
+    keys.emplace_back(folly::sformat(
+        "{}node-{}:{}",
+        markers.at(idx % markers.size()),
+        idx % 100,
+        genRandomStr(kSizeOfKey)));
+  }
+  std::vector<std::string> keyPrefixes{
+      "adj:node-1", "prefix:node-1", "allocprefix:", "nodeLabel:"};
+  if (regexPrefixes) {
+    for (auto& keyPrefix : keyPrefixes) {
+      keyPrefix += "(?:)";
+    }
+  }
+  const KeyPrefix keyPrefix(keyPrefixes);
+
+  suspender.dismiss(); // Start measuring benchmark time
+  size_t numMatches{0};
+  for (auto i = 0; i < iters; i++) {
+    for (auto const& key : keys) {
+      numMatches += keyPrefix.keyMatch(key);
+    }
+  }
+  folly::doNotOptimizeAway(numMatches);
+}
+
+/**
+ * Benchmark for hashing a value of given size with generateHash()
+ */
+static void
+BM_KvStoreGenerateHash(uint32_t iters, size_t sizeOfValue) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string originatorId{"kvStore"};
+  const folly::Optional<std::string> value{genRandomStr(sizeOfValue)};
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (auto i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(generateHash(i, originatorId, value));
+  }
+}
+
+/**
+ * Benchmark for hashing a value of given size with the former boost based
+ * value hash
+ */
+static void
+BM_KvStoreGenerateBoostHash(uint32_t iters, size_t sizeOfValue) {
+  auto suspender = folly::BenchmarkSuspender();
+  const std::string originatorId{"kvStore"};
+  const folly::Optional<std::string> value{genRandomStr(sizeOfValue)};
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (auto i = 0; i < iters; i++) {
+    folly::doNotOptimizeAway(generateBoostHash(i, originatorId, value));
+  }
+}
+
 /**
  * Benchmark for synchronizing update from a peer
  * 1. Start kvStore
@@ -304,6 +637,158 @@ BM_KvStoreFloodingUpdate(uint32_t iters, size_t numOfUpdateKeys) {
   }
 }
 
+/**
+ * Sum given counters over all stores
+ */
+std::unordered_map<std::string, int64_t>
+sumCounters(
+    const std::vector<KvStoreWrapper*>& stores,
+    const std::vector<std::string>& names) {
+  std::unordered_map<std::string, int64_t> sums;
+  for (auto store : stores) {
+    const auto counters = store->getCounters();
+    for (const auto& name : names) {
+      const auto it = counters.find(name);
+      sums[name] += it == counters.end() ? 0 : it->second.value;
+    }
+  }
+  return sums;
+}
+
+/**
+ * Links of #numOfStores stores in given topology, store indices as pairs.
+ * RING connects store i to i + 1, GRID the stores of a square grid to their
+ * right and lower neighbors, CLOS every store to each of the first
+ * kNumClosSpines stores (spines)
+ */
+std::vector<std::pair<size_t, size_t>>
+getTopologyLinks(FloodTopology topology, size_t numOfStores) {
+  std::vector<std::pair<size_t, size_t>> links;
+  switch (topology) {
+  case FloodTopology::RING: {
+    for (size_t i = 0; i < numOfStores; i++) {
+      links.emplace_back(i, (i + 1) % numOfStores);
+    }
+    break;
+  }
+  case FloodTopology::GRID: {
+    const size_t n = std::ceil(std::sqrt(numOfStores));
+    for (size_t i = 0; i < numOfStores; i++) {
+      if ((i + 1) % n != 0 and i + 1 < numOfStores) {
+        links.emplace_back(i, i + 1);
+      }
+      if (i + n < numOfStores) {
+        links.emplace_back(i, i + n);
+      }
+    }
+    break;
+  }
+  case FloodTopology::CLOS: {
+    for (size_t spine = 0; spine < kNumClosSpines; spine++) {
+      for (size_t i = kNumClosSpines; i < numOfStores; i++) {
+        links.emplace_back(spine, i);
+      }
+    }
+    break;
+  }
+  }
+  return links;
+}
+
+/**
+ * Benchmark for flooding keys through a topology of stores
+ * 1. Start #numOfStores stores and peer them in given topology. With flood
+ *    optimization, wait until every store has a flooding spanning tree. The
+ *    roots are the spines in CLOS, first and middle store otherwise
+ * 2. Set a new key in first store and wait until it reached every store
+ * Reports received key-values which were not new to its receiver (duplicate
+ * receipts) and bytes flooded by all stores per key
+ */
+static void
+BM_KvStoreFloodingTopology(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    FloodTopology topology,
+    size_t numOfStores,
+    bool enableFloodOptimization) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto kvStoreTestFixture = std::make_unique<KvStoreTestFixture>();
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+
+  std::vector<KvStoreWrapper*> stores;
+  for (size_t i = 0; i < numOfStores; i++) {
+    const bool isFloodRoot = topology == FloodTopology::CLOS
+        ? i < kNumClosSpines
+        : i == 0 or i == numOfStores / 2;
+    auto store = kvStoreTestFixture->createKvStore(
+        folly::sformat("store{}", i),
+        emptyPeers,
+        folly::none /* filters */,
+        folly::none /* kvStoreRate */,
+        Constants::kTtlDecrement,
+        enableFloodOptimization,
+        isFloodRoot);
+    store->run();
+    stores.emplace_back(store);
+  }
+  for (const auto& link : getTopologyLinks(topology, numOfStores)) {
+    auto store1 = stores.at(link.first);
+    auto store2 = stores.at(link.second);
+    store1->addPeer(store2->nodeId, store2->getPeerSpec());
+    store2->addPeer(store1->nodeId, store1->getPeerSpec());
+  }
+  if (enableFloodOptimization) {
+    for (auto store : stores) {
+      while (not store->getFloodTopo().floodRootId.hasValue()) {
+        /* sleep override */
+        std::this_thread::sleep_for(kFloodTopoPollInterval);
+      }
+    }
+  }
+
+  const std::vector<std::string> counterNames{
+      "kvstore.received_key_vals.sum.0",
+      "kvstore.updated_key_vals.sum.0",
+      "kvstore.flood.bytes_sent.sum.0",
+      "kvstore.peers.bytes_sent.sum.0",
+  };
+  auto countersBefore = sumCounters(stores, counterNames);
+  suspender.dismiss(); // Start measuring benchmark time
+
+  for (uint32_t i = 0; i < iters; i++) {
+    const auto key = folly::sformat("key{}", i);
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        stores.front()->nodeId /* originatorId */,
+        genRandomStr(kSizeOfValue) /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    stores.front()->setKey(key, std::move(thriftVal));
+
+    // Wait for the key on every store, skipping older publications
+    for (auto store : stores) {
+      auto pub = store->recvPublication(kTimeout);
+      while (pub.keyVals.count(key) == 0) {
+        pub = store->recvPublication(kTimeout);
+      }
+    }
+  }
+
+  suspender.rehire(); // Stop measuring time again
+  auto countersAfter = sumCounters(stores, counterNames);
+  auto delta = [&](const std::string& name) {
+    return (countersAfter[name] - countersBefore[name]) /
+        (iters == 0 ? 1 : iters);
+  };
+  counters["dup_receipts_per_key"] = delta(counterNames[0]) -
+      delta(counterNames[1]);
+  counters["bytes_per_key"] = delta(counterNames[2]) + delta(counterNames[3]);
+}
+
 // The first integer parameter is number of keyVals already in store
 // The second integer parameter is the number of keyVals for update
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10_10, 10, 10);
@@ -313,6 +798,21 @@ BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10, 10000, 10);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_100, 10000, 100);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_1000, 10000, 1000);
 BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 10000_10000, 10000, 10000);
+BENCHMARK_NAMED_PARAM(BM_KvStoreMergeKeyValues, 100000_10000, 100000, 10000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreMergeKeyValues, 100000_100000, 100000, 100000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreMergeKeyValues, 200000_200000, 200000, 200000);
+
+// Same as above, merged over kMergeThreads worker threads
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreParallelMergeKeyValues, 10000_10000, 10000, 10000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreParallelMergeKeyValues, 100000_10000, 100000, 10000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreParallelMergeKeyValues, 100000_100000, 100000, 100000);
+BENCHMARK_NAMED_PARAM(
+    BM_KvStoreParallelMergeKeyValues, 200000_200000, 200000, 200000);
 
 // The parameter is number of keyVals already in store
 BENCHMARK_PARAM(BM_KvStoreDumpAll, 10);
@@ -320,12 +820,128 @@ BENCHMARK_PARAM(BM_KvStoreDumpAll, 100);
 BENCHMARK_PARAM(BM_KvStoreDumpAll, 1000);
 BENCHMARK_PARAM(BM_KvStoreDumpAll, 10000);
 
+// The parameter is number of keyVals with finite TTL already in store
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithTtl, 10000);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithTtl, 100000);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithTtl, 200000);
+
+// The parameter is number of stores to dump from
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithPrefixMultiple, 1);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithPrefixMultiple, 4);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithPrefixMultiple, 16);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithPrefixMultiple, 64);
+
+// The parameter is number of keyVals already in store
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithFilters, 10);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithFilters, 100);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithFilters, 1000);
+BENCHMARK_PARAM(BM_KvStoreDumpAllWithFilters, 10000);
+
+// The parameters are number of keyVals already in store and whether key
+// prefixes are matched as regexes
+BENCHMARK_NAMED_PARAM(BM_KvStoreDumpAllWithLeafFilters, 1000, 1000, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_KvStoreDumpAllWithLeafFilters, 1000_regex, 1000, true);
+BENCHMARK_NAMED_PARAM(BM_KvStoreDumpAllWithLeafFilters, 10000, 10000, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_KvStoreDumpAllWithLeafFilters, 10000_regex, 10000, true);
+BENCHMARK_NAMED_PARAM(BM_KvStoreDumpAllWithLeafFilters, 100000, 100000, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    BM_KvStoreDumpAllWithLeafFilters, 100000_regex, 100000, true);
+
+// The parameter is whether key prefixes are matched as regexes
+BENCHMARK_NAMED_PARAM(BM_KeyPrefixMatch, literal, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_KeyPrefixMatch, regex, true);
+
+// The parameter is the byte size of the value, covering adjacency and
+// prefix databases of small to very large nodes
+BENCHMARK_PARAM(BM_KvStoreGenerateHash, 128);
+BENCHMARK_RELATIVE_PARAM(BM_KvStoreGenerateBoostHash, 128);
+BENCHMARK_PARAM(BM_KvStoreGenerateHash, 1024);
+BENCHMARK_RELATIVE_PARAM(BM_KvStoreGenerateBoostHash, 1024);
+BENCHMARK_PARAM(BM_KvStoreGenerateHash, 16384);
+BENCHMARK_RELATIVE_PARAM(BM_KvStoreGenerateBoostHash, 16384);
+BENCHMARK_PARAM(BM_KvStoreGenerateHash, 131072);
+BENCHMARK_RELATIVE_PARAM(BM_KvStoreGenerateBoostHash, 131072);
+
 // The parameter is number of keyVals for update
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 10);
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 100);
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 1000);
 BENCHMARK_PARAM(BM_KvStoreFloodingUpdate, 10000);
 
+// The parameters are topology, number of stores and flood optimization
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    ring_50,
+    FloodTopology::RING,
+    50,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    ring_50_spt,
+    FloodTopology::RING,
+    50,
+    true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    grid_100,
+    FloodTopology::GRID,
+    100,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    grid_100_spt,
+    FloodTopology::GRID,
+    100,
+    true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    grid_500,
+    FloodTopology::GRID,
+    500,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    grid_500_spt,
+    FloodTopology::GRID,
+    500,
+    true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    clos_100,
+    FloodTopology::CLOS,
+    100,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    clos_100_spt,
+    FloodTopology::CLOS,
+    100,
+    true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    clos_500,
+    FloodTopology::CLOS,
+    500,
+    false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_KvStoreFloodingTopology,
+    counters,
+    clos_500_spt,
+    FloodTopology::CLOS,
+    500,
+    true);
+
 } // namespace openr
 
 int
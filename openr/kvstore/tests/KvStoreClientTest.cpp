@@ -823,6 +823,274 @@ TEST(KvStoreClient, ApiTest) {
   store->stop();
 }
 
+/**
+ * Bulk persistKeys and getKeys. Keys already known to KvStore are taken over
+ * with higher version, like with persistKey
+ */
+TEST(KvStoreClient, PersistKeysTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  fbzmq::ZmqEventLoop evl;
+  auto client1 = std::make_shared<KvStoreClient>(
+      context, &evl, "client1", store->localCmdUrl, store->localPubUrl);
+  auto client2 = std::make_shared<KvStoreClient>(
+      context, &evl, "client2", store->localCmdUrl, store->localPubUrl);
+
+  evl.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    client2->persistKey("test_key1", "test_value1-client2");
+
+    client1->persistKeys(
+        {{"test_key1", "test_value1"}, {"test_key2", "test_value2"}});
+
+    auto maybeKeyVals =
+        client1->getKeys({"test_key1", "test_key2", "test_key3"});
+    ASSERT_TRUE(maybeKeyVals.hasValue());
+    ASSERT_EQ(2, maybeKeyVals->size());
+    EXPECT_EQ("test_value1", maybeKeyVals->at("test_key1").value);
+    EXPECT_EQ(2, maybeKeyVals->at("test_key1").version);
+    EXPECT_EQ("test_value2", maybeKeyVals->at("test_key2").value);
+    EXPECT_EQ(1, maybeKeyVals->at("test_key2").version);
+
+    // unchanged values are not re-advertised
+    client1->persistKeys({{"test_key2", "test_value2"}});
+    auto maybeVal = client1->getKey("test_key2");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_EQ(1, maybeVal->version);
+
+    evl.stop();
+  });
+
+  std::thread evlThread([&]() { evl.run(); });
+  evl.waitUntilRunning();
+  evl.waitUntilStopped();
+  evlThread.join();
+
+  store->stop();
+}
+
+/**
+ * Large values of keys with compression enabled are stored compressed and
+ * parsed transparently
+ */
+TEST(KvStoreClient, CompressedKeysTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  thrift::PrefixDatabase prefixDb;
+  prefixDb.thisNodeName = "client1";
+  for (int i = 0; i < 100; ++i) {
+    prefixDb.prefixEntries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{}::/64", i)),
+        thrift::PrefixType::LOOPBACK));
+  }
+  apache::thrift::CompactSerializer serializer;
+  const auto value = fbzmq::util::writeThriftObjStr(prefixDb, serializer);
+
+  fbzmq::ZmqEventLoop evl;
+  auto client1 = std::make_shared<KvStoreClient>(
+      context, &evl, "client1", store->localCmdUrl, store->localPubUrl);
+  client1->setCompressedKeyPrefixes({"prefix:"});
+
+  evl.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    client1->persistKey("prefix:client1", value);
+    client1->persistKey("adj:client1", value);
+    client1->persistKey("prefix:small", "small");
+
+    auto maybeVal = client1->getKey("prefix:client1");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_TRUE(isCompressedValue(*maybeVal->value));
+    EXPECT_EQ(
+        prefixDb,
+        KvStoreClient::parseThriftValue<thrift::PrefixDatabase>(*maybeVal));
+
+    maybeVal = client1->getKey("adj:client1");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_EQ(value, maybeVal->value);
+    maybeVal = client1->getKey("prefix:small");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_EQ("small", maybeVal->value);
+
+    // unchanged value is not re-advertised
+    client1->persistKey("prefix:client1", value);
+    maybeVal = client1->getKey("prefix:client1");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_EQ(1, maybeVal->version);
+
+    auto counters = client1->getCounters();
+    EXPECT_EQ(1, counters["kvstore_client.compression_skipped.count.0"]);
+    EXPECT_GT(100, counters["kvstore_client.compression_ratio_pct.avg.0"]);
+
+    evl.stop();
+  });
+
+  std::thread evlThread([&]() { evl.run(); });
+  evl.waitUntilRunning();
+  evl.waitUntilStopped();
+  evlThread.join();
+
+  store->stop();
+}
+
+/**
+ * TTL refreshes of keys persisted together are advertised in batches
+ */
+TEST(KvStoreClient, TtlRefreshBatchTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+  const std::chrono::milliseconds ttl{1000};
+  const int numKeys{10};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  fbzmq::ZmqEventLoop evl;
+  auto client1 = std::make_shared<KvStoreClient>(
+      context, &evl, "client1", store->localCmdUrl, store->localPubUrl);
+
+  evl.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    for (int i = 0; i < numKeys; ++i) {
+      client1->persistKey(folly::sformat("test_key{}", i), "value", ttl);
+    }
+  });
+
+  // keys are refreshed right away and then every ttl/4
+  evl.scheduleTimeout(ttl * 3 / 2, [&]() noexcept {
+    auto counters = client1->getCounters();
+    EXPECT_EQ(
+        numKeys, counters["kvstore_client.ttl_refresh_batch_size.avg.0"]);
+    EXPECT_LE(numKeys * 5, counters["kvstore_client.ttl_refresh_keys.sum.0"]);
+
+    auto maybeVal = client1->getKey("test_key0");
+    ASSERT_TRUE(maybeVal.hasValue());
+    EXPECT_LE(5, maybeVal->ttlVersion);
+
+    evl.stop();
+  });
+
+  std::thread evlThread([&]() { evl.run(); });
+  evl.waitUntilRunning();
+  evl.waitUntilStopped();
+  evlThread.join();
+
+  store->stop();
+}
+
+/**
+ * Pipelined requests complete in the event loop, set-key calls of the same
+ * loop iteration are sent together
+ */
+TEST(KvStoreClient, AsyncApiTest) {
+  fbzmq::Context context;
+  const std::string nodeId{"test_store"};
+  const size_t kNumKeys{16};
+
+  auto store = std::make_shared<KvStoreWrapper>(
+      context,
+      nodeId,
+      std::chrono::seconds(60) /* db sync interval */,
+      std::chrono::seconds(600) /* counter submit interval */,
+      std::unordered_map<std::string, thrift::PeerSpec>{});
+  store->run();
+
+  fbzmq::ZmqEventLoop evl;
+  auto client = std::make_shared<KvStoreClient>(
+      context, &evl, nodeId, store->localCmdUrl, store->localPubUrl);
+
+  evl.scheduleTimeout(std::chrono::milliseconds(0), [&]() noexcept {
+    std::vector<folly::Future<folly::Expected<folly::Unit, fbzmq::Error>>>
+        setFutures;
+    for (size_t i = 0; i < kNumKeys; ++i) {
+      thrift::Value value(
+          apache::thrift::FRAGILE,
+          1 /* version */,
+          nodeId,
+          folly::sformat("value-{}", i),
+          Constants::kTtlInfinity /* ttl */,
+          0 /* ttl version */,
+          0 /* hash */);
+      setFutures.emplace_back(
+          client->setKeyAsync(folly::sformat("key-{}", i), value));
+    }
+
+    folly::collectAll(setFutures)
+        .thenValue([&](std::vector<folly::Try<
+                           folly::Expected<folly::Unit, fbzmq::Error>>>&&
+                           results) {
+          for (auto& result : results) {
+            EXPECT_TRUE(result.value().hasValue());
+          }
+
+          // many requests outstanding at once
+          std::vector<
+              folly::Future<folly::Expected<thrift::Value, fbzmq::Error>>>
+              getFutures;
+          for (size_t i = 0; i < kNumKeys; ++i) {
+            getFutures.emplace_back(
+                client->getKeyAsync(folly::sformat("key-{}", i)));
+          }
+          getFutures.emplace_back(client->getKeyAsync("unknown-key"));
+          return folly::collectAll(getFutures);
+        })
+        .thenValue([&](std::vector<folly::Try<
+                           folly::Expected<thrift::Value, fbzmq::Error>>>&&
+                           results) {
+          // NOTE: ASSERT_* can't be used in a non-void lambda
+          EXPECT_EQ(kNumKeys + 1, results.size());
+          for (size_t i = 0; i + 1 < results.size(); ++i) {
+            auto& maybeValue = results.at(i).value();
+            EXPECT_TRUE(maybeValue.hasValue());
+            if (maybeValue.hasValue()) {
+              EXPECT_EQ(folly::sformat("value-{}", i), maybeValue->value);
+            }
+          }
+          EXPECT_TRUE(results.back().value().hasError());
+          return client->dumpAllWithPrefixAsync("key-");
+        })
+        .thenValue([&](folly::Expected<
+                        std::unordered_map<std::string, thrift::Value>,
+                        fbzmq::Error>&& maybeKeyVals) {
+          ASSERT_TRUE(maybeKeyVals.hasValue());
+          EXPECT_EQ(kNumKeys, maybeKeyVals->size());
+          evl.stop();
+        });
+  });
+
+  std::thread evlThread([&]() { evl.run(); });
+  evl.waitUntilRunning();
+  evl.waitUntilStopped();
+  evlThread.join();
+
+  // all keys were sent in a single request
+  auto counters = store->getCounters();
+  EXPECT_EQ(1, counters["kvstore.cmd_key_set.count.0"].value);
+  EXPECT_EQ(kNumKeys, store->dumpAll().size());
+
+  client.reset();
+  store->stop();
+}
+
 TEST(KvStoreClient, SubscribeApiTest) {
   fbzmq::Context context;
   const std::string nodeId{"test_store"};
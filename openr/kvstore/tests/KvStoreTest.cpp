@@ -6,15 +6,18 @@
  */
 
 #include <sodium.h>
+#include <cstdio>
 #include <cstdlib>
 #include <thread>
 #include <tuple>
 #include <unordered_set>
 
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/FileUtil.h>
 #include <folly/Format.h>
 #include <folly/Memory.h>
 #include <folly/Random.h>
+#include <folly/Synchronized.h>
 #include <folly/gen/Base.h>
 #include <gtest/gtest.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -97,7 +100,11 @@ class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
       std::chrono::milliseconds ttlDecr = Constants::kTtlDecrement,
       bool enableFloodOptimization = false,
       bool isFloodRoot = false,
-      std::chrono::seconds dbSyncInterval = kDbSyncInterval) {
+      std::chrono::seconds dbSyncInterval = kDbSyncInterval,
+      bool enableRangeSync = false,
+      bool enableTtlUpdateBatching = false,
+      size_t workerThreads = 0,
+      bool enableValueDeltas = false) {
     auto ptr = std::make_unique<KvStoreWrapper>(
         context,
         nodeId,
@@ -108,7 +115,11 @@ class KvStoreTestFixture : public ::testing::TestWithParam<bool> {
         kvStoreRate,
         ttlDecr,
         enableFloodOptimization,
-        isFloodRoot);
+        isFloodRoot,
+        enableRangeSync,
+        enableTtlUpdateBatching,
+        workerThreads,
+        enableValueDeltas);
     stores_.emplace_back(std::move(ptr));
     return stores_.back().get();
   }
@@ -461,6 +472,65 @@ TEST(KvStore, mergeKeyValuesTest) {
 //
 // Test compareValues method
 //
+//
+// Merging a large update over an executor must not change the result
+//
+TEST(KvStore, ParallelMergeKeyValues) {
+  const size_t numKeys = 2 * Constants::kKvStoreParallelMinKeys;
+  std::unordered_map<std::string, thrift::Value> store;
+  std::unordered_map<std::string, thrift::Value> update;
+  for (size_t i = 0; i < numKeys; ++i) {
+    const auto key = folly::sformat("key-{}", i);
+    thrift::Value value(
+        apache::thrift::FRAGILE,
+        2 /* version */,
+        "node1" /* originatorId */,
+        folly::sformat("value-{}", i),
+        Constants::kTtlInfinity /* ttl */,
+        1 /* ttl version */,
+        0 /* hash */);
+    value.hash = generateHash(value.version, value.originatorId, value.value);
+    store.emplace(key, value);
+
+    // mix of new keys, newer values, older values and ttl updates
+    switch (i % 6) {
+    case 0:
+      value.version = 3;
+      value.hash = folly::none;
+      break;
+    case 1:
+      value.version = 1;
+      break;
+    case 2:
+      value.value = folly::none;
+      value.hash = folly::none;
+      value.ttlVersion = 2;
+      break;
+    case 3:
+      value.originatorId = "node2";
+      value.hash = generateHash(value.version, value.originatorId, value.value);
+      break;
+    case 4:
+      value.value = folly::sformat("value-{}-new", i);
+      value.hash = folly::none;
+      break;
+    default:
+      break;
+    }
+    update.emplace(
+        i % 5 ? key : folly::sformat("new-key-{}", i), std::move(value));
+  }
+
+  auto parallelStore = store;
+  folly::CPUThreadPoolExecutor executor(4);
+  auto updates = KvStore::mergeKeyValues(store, update);
+  auto parallelUpdates =
+      KvStore::mergeKeyValues(parallelStore, update, folly::none, &executor);
+  EXPECT_LT(0, updates.size());
+  EXPECT_EQ(updates, parallelUpdates);
+  EXPECT_EQ(store, parallelStore);
+}
+
 TEST(KvStore, compareValuesTest) {
   thrift::Value refValue(
       apache::thrift::FRAGILE,
@@ -542,6 +612,22 @@ TEST(KvStore, compareValuesTest) {
 //
 // Test counter reporting
 //
+TEST(KvStore, LiteralKeyPrefixes) {
+  EXPECT_EQ(
+      std::vector<std::string>({"adj:", "prefix:"}),
+      KvStoreFilters({"adj:", "prefix:"}, {}).getLiteralKeyPrefixes());
+  // everything is matched
+  EXPECT_FALSE(KvStoreFilters({}, {}).getLiteralKeyPrefixes().hasValue());
+  // keys are also matched by originator
+  EXPECT_FALSE(
+      KvStoreFilters({"adj:"}, {"node1"}).getLiteralKeyPrefixes().hasValue());
+  // keys are matched by regex
+  EXPECT_FALSE(
+      KvStoreFilters({"adj:", "prefix:.*:0"}, {})
+          .getLiteralKeyPrefixes()
+          .hasValue());
+}
+
 TEST(KvStore, MonitorReport) {
   fbzmq::Context context;
   CompactSerializer serializer;
@@ -2237,6 +2323,14 @@ TEST_F(KvStoreTestFixture, DumpPrefix) {
   // Verify myStore database. we only want keys with "0" prefix
   folly::Optional<KvStoreFilters> kvFilters{KvStoreFilters({"0"}, {})};
   EXPECT_EQ(expectedKeyVals, myStore->dumpAll(std::move(kvFilters)));
+
+  // overlapping literal prefixes, served from sorted keys
+  EXPECT_EQ(
+      expectedKeyVals,
+      myStore->dumpAll(KvStoreFilters({"0-test", "0", "0-"}, {})));
+  // regex prefixes are matched against every key
+  EXPECT_EQ(
+      expectedKeyVals, myStore->dumpAll(KvStoreFilters({"0-te.t"}, {})));
 }
 
 /**
@@ -2334,6 +2428,84 @@ TEST_F(KvStoreTestFixture, DumpDifference) {
   }
 }
 
+/**
+ * Start single testable store and dump it in pages, of values and of
+ * differences to hashes of another store
+ */
+TEST_F(KvStoreTestFixture, DumpPages) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto myStore = createKvStore("test-node", emptyPeers);
+  myStore->run();
+
+  auto const makeValue = [](std::string const& value) {
+    return thrift::Value(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        "gotham_city" /* originatorId */,
+        value,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        generateHash(1, "gotham_city", value));
+  };
+  for (int i = 0; i < 5; ++i) {
+    myStore->setKey(
+        folly::sformat("test-key-{}", i),
+        makeValue(folly::sformat("test-value-{}", i)));
+  }
+
+  // pages of values in key order
+  thrift::KeyDumpParams params;
+  params.limit = 2;
+  std::vector<std::vector<std::string>> pageKeys;
+  while (true) {
+    auto const page = myStore->dumpWithParams(params);
+    std::vector<std::string> keys;
+    for (auto const& kv : page.keyVals) {
+      EXPECT_TRUE(kv.second.value.hasValue());
+      keys.emplace_back(kv.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    pageKeys.emplace_back(std::move(keys));
+    if (not page.nextCursor.hasValue()) {
+      break;
+    }
+    EXPECT_EQ(pageKeys.back().back(), page.nextCursor.value());
+    params.cursor = page.nextCursor;
+  }
+  const std::vector<std::vector<std::string>> expectedPageKeys{
+      {"test-key-0", "test-key-1"},
+      {"test-key-2", "test-key-3"},
+      {"test-key-4"}};
+  EXPECT_EQ(expectedPageKeys, pageKeys);
+
+  // hashes after a cursor are cut to limit keys, page ends at the last one
+  auto const myHashes = myStore->dumpHashes();
+  params.cursor = "test-key-1";
+  params.limit = 3;
+  params.keyValHashes = thrift::KeyVals{
+      {"test-key-2", myHashes.at("test-key-2")},
+      {"test-key-3", myHashes.at("test-key-3")},
+      {"test-key-30", makeValue("test-value-30")}};
+  {
+    auto const page = myStore->dumpWithParams(params);
+    EXPECT_TRUE(page.keyVals.empty());
+    ASSERT_TRUE(page.tobeUpdatedKeys.hasValue());
+    EXPECT_EQ(
+        std::vector<std::string>{"test-key-30"}, page.tobeUpdatedKeys.value());
+    EXPECT_EQ(std::string("test-key-30"), page.nextCursor.value());
+  }
+
+  // last page, keys after the cursor the initiator has no hashes of
+  params.cursor = "test-key-30";
+  params.keyValHashes = thrift::KeyVals{};
+  {
+    auto const page = myStore->dumpWithParams(params);
+    EXPECT_EQ(1, page.keyVals.size());
+    EXPECT_EQ(1, page.keyVals.count("test-key-4"));
+    EXPECT_FALSE(page.nextCursor.hasValue());
+  }
+}
+
 /**
  * Start single testable store, and set key values with oneway method. Verify
  * content of KvStore by querying it.
@@ -2401,6 +2573,436 @@ TEST_F(KvStoreTestFixture, OneWaySetKey) {
   EXPECT_EQ(expectedKeyVals, myStore->dumpAll());
 }
 
+/**
+ * Publications are serialized once per flood, and the same message is sent
+ * on both PUB sockets and to every flood peer
+ */
+TEST_F(KvStoreTestFixture, FloodSerializeOnce) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore("store0", emptyPeers);
+  auto store1 = createKvStore("store1", emptyPeers);
+  auto store2 = createKvStore("store2", emptyPeers);
+  store0->run();
+  store1->run();
+  store2->run();
+
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+  store0->addPeer(store2->nodeId, store2->getPeerSpec());
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  thrift::Value value(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "store0" /* originatorId */,
+      "value" /* value */,
+      Constants::kTtlInfinity /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  value.hash = generateHash(value.version, value.originatorId, value.value);
+  EXPECT_TRUE(store0->setKey("key", value));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(store1->getKey("key").hasValue());
+  EXPECT_TRUE(store2->getKey("key").hasValue());
+
+  // one publication (local and global PUB) and one flood request (2 peers)
+  auto counters = store0->getCounters();
+  auto const serialized = counters["kvstore.flood.bytes_serialized.sum.0"];
+  EXPECT_LT(0, serialized.value);
+  EXPECT_EQ(
+      2 * serialized.value, counters["kvstore.flood.bytes_sent.sum.0"].value);
+}
+
+/*
+ * TTL refreshes of a key update its single TTL countdown entry in place and
+ * expired keys are removed from the TTL countdown queue
+ */
+TEST_F(KvStoreTestFixture, TtlCountdownRefresh) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store", emptyPeers);
+  store->run();
+
+  thrift::Value value(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "store" /* originatorId */,
+      "value" /* value */,
+      300000 /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  value.hash = generateHash(value.version, value.originatorId, value.value);
+  EXPECT_TRUE(store->setKey("key1", value));
+
+  // Refresh TTL of key1 several times
+  for (int i = 1; i <= 10; ++i) {
+    auto ttlUpdate = value;
+    ttlUpdate.value = folly::none;
+    ttlUpdate.ttlVersion = i;
+    EXPECT_TRUE(store->setKey("key1", ttlUpdate));
+  }
+
+  // Short lived key2 expires while key1 stays
+  value.ttl = 100;
+  value.originatorId = "store2";
+  EXPECT_TRUE(store->setKey("key2", value));
+  auto counters = store->getCounters();
+  EXPECT_EQ(2, counters["kvstore.ttl_countdown_queue_size"].value);
+  EXPECT_EQ(2, counters["kvstore.ttl_interned_originator_ids"].value);
+
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_TRUE(store->getKey("key1").hasValue());
+  EXPECT_FALSE(store->getKey("key2").hasValue());
+  counters = store->getCounters();
+  EXPECT_EQ(1, counters["kvstore.ttl_countdown_queue_size"].value);
+  EXPECT_EQ(1, counters["kvstore.ttl_interned_originator_ids"].value);
+  EXPECT_EQ(1, counters["kvstore.ttl_expiry_batch_size.avg.0"].value);
+}
+
+TEST(StringInternTable, InternAndRelease) {
+  StringInternTable table;
+  auto const node1 = table.intern("node1");
+  EXPECT_EQ("node1", *node1);
+  EXPECT_EQ(node1, table.intern(std::string("node1")));
+  auto const node2 = table.intern("node2");
+  EXPECT_NE(node1, node2);
+  EXPECT_EQ(2, table.size());
+
+  // node1 stays until all references are released
+  table.release(node1);
+  EXPECT_EQ(2, table.size());
+  EXPECT_EQ("node1", *node1);
+  table.release(node1);
+  table.release(node2);
+  EXPECT_EQ(0, table.size());
+}
+
+/*
+ * TTL refreshes are coalesced and flooded to peers as compact TTL updates
+ */
+TEST_F(KvStoreTestFixture, TtlUpdateBatching) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore(
+      "store0",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      false, /* flood-optimization */
+      false, /* is-root */
+      kDbSyncInterval,
+      false, /* range-sync */
+      true /* ttl-update-batching */);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  thrift::Value value(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "store0" /* originatorId */,
+      "value" /* value */,
+      300000 /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  value.hash = generateHash(value.version, value.originatorId, value.value);
+  EXPECT_TRUE(store0->setKey("key1", value));
+  EXPECT_TRUE(store0->setKey("key2", value));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_TRUE(store1->getKey("key1").hasValue());
+  ASSERT_TRUE(store1->getKey("key2").hasValue());
+
+  // Refresh TTL of both keys in separate requests
+  auto ttlUpdate = value;
+  ttlUpdate.value = folly::none;
+  ttlUpdate.ttlVersion = 1;
+  EXPECT_TRUE(store0->setKey("key1", ttlUpdate));
+  EXPECT_TRUE(store0->setKey("key2", ttlUpdate));
+  /* sleep override */
+  std::this_thread::sleep_for(
+      Constants::kFloodTtlUpdateInterval + std::chrono::milliseconds(200));
+
+  for (auto const& key : {"key1", "key2"}) {
+    auto res = store1->getKey(key);
+    ASSERT_TRUE(res.hasValue());
+    EXPECT_EQ(1, res->ttlVersion);
+    EXPECT_EQ("value", res->value.value());
+  }
+
+  // both refreshes went out in a single batch
+  auto counters0 = store0->getCounters();
+  EXPECT_EQ(2, counters0["kvstore.buffered_ttl_updates.sum.0"].value);
+  EXPECT_EQ(2, counters0["kvstore.sent_ttl_update_batch_size.avg.0"].value);
+  auto counters1 = store1->getCounters();
+  EXPECT_EQ(2, counters1["kvstore.received_ttl_updates.sum.0"].value);
+}
+
+/*
+ * Large publications merged and dumps built on worker threads are the same
+ * as in a store without them
+ */
+TEST_F(KvStoreTestFixture, WorkerThreads) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store", emptyPeers);
+  auto workerStore = createKvStore(
+      "workerStore",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      false, /* flood-optimization */
+      false, /* is-root */
+      kDbSyncInterval,
+      false, /* range-sync */
+      false, /* ttl-update-batching */
+      4 /* worker-threads */);
+  store->run();
+  workerStore->run();
+
+  std::vector<std::pair<std::string, thrift::Value>> keyVals;
+  for (size_t i = 0; i < 2 * Constants::kKvStoreParallelMinKeys; ++i) {
+    thrift::Value value(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        "store" /* originatorId */,
+        folly::sformat("value-{}", i),
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    value.hash = generateHash(value.version, value.originatorId, value.value);
+    keyVals.emplace_back(folly::sformat("key-{}", i), std::move(value));
+  }
+  EXPECT_TRUE(store->setKeys(keyVals));
+  EXPECT_TRUE(workerStore->setKeys(keyVals));
+
+  const auto dump = workerStore->dumpAll();
+  EXPECT_EQ(keyVals.size(), dump.size());
+  EXPECT_EQ(store->dumpAll(), dump);
+  EXPECT_EQ(store->dumpHashes(), workerStore->dumpHashes());
+  EXPECT_EQ(store->dumpHashes("key-1"), workerStore->dumpHashes("key-1"));
+}
+
+/*
+ * Hash dumps are built once per filters and kept up to date with updates and
+ * expiry of keys
+ */
+TEST_F(KvStoreTestFixture, HashDumpCache) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store", emptyPeers);
+  store->run();
+
+  auto createValue = [](int64_t version, int64_t ttl) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        version,
+        "store" /* originatorId */,
+        folly::sformat("value-{}", version),
+        ttl,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    return thriftVal;
+  };
+  // hashes of all keys as dumped without cache
+  auto expectHashes = [&store](std::string const& prefix) {
+    auto const hashes = store->dumpHashes(prefix);
+    auto const keyVals = store->dumpAll(KvStoreFilters({prefix}, {}));
+    EXPECT_EQ(keyVals.size(), hashes.size());
+    for (auto const& kv : keyVals) {
+      ASSERT_EQ(1, hashes.count(kv.first));
+      EXPECT_EQ(kv.second.version, hashes.at(kv.first).version);
+      EXPECT_EQ(kv.second.hash, hashes.at(kv.first).hash);
+      EXPECT_FALSE(hashes.at(kv.first).value.hasValue());
+    }
+    return hashes;
+  };
+
+  EXPECT_TRUE(store->setKey("adj:1", createValue(1, Constants::kTtlInfinity)));
+  EXPECT_TRUE(store->setKey("adj:2", createValue(1, Constants::kTtlInfinity)));
+  EXPECT_TRUE(store->setKey("prefix:1", createValue(1, 200)));
+  EXPECT_EQ(3, expectHashes("").size());
+  EXPECT_EQ(2, expectHashes("adj:").size());
+
+  // updates are applied to both cached dumps
+  EXPECT_TRUE(store->setKey("adj:1", createValue(2, Constants::kTtlInfinity)));
+  EXPECT_TRUE(store->setKey("adj:3", createValue(1, Constants::kTtlInfinity)));
+  EXPECT_EQ(4, expectHashes("").size());
+  EXPECT_EQ(2, expectHashes("adj:").at("adj:1").version);
+
+  // expired key is dropped
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_EQ(0, expectHashes("prefix:").size());
+  EXPECT_EQ(3, expectHashes("").size());
+
+  auto counters = store->getCounters();
+  EXPECT_EQ(3, counters["kvstore.hash_dump_cache_misses.count.0"].value);
+  EXPECT_EQ(3, counters["kvstore.hash_dump_cache_hits.count.0"].value);
+}
+
+/*
+ * Keys and bytes are accounted per key prefix on updates and expiry
+ */
+TEST_F(KvStoreTestFixture, KeyPrefixUsage) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store = createKvStore("store", emptyPeers);
+  store->run();
+
+  auto createValue = [](int64_t version, std::string value, int64_t ttl) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        version,
+        "store" /* originatorId */,
+        value,
+        ttl,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    return thriftVal;
+  };
+  EXPECT_TRUE(
+      store->setKey("adj:node1", createValue(1, "a", Constants::kTtlInfinity)));
+  EXPECT_TRUE(
+      store->setKey("adj:node2", createValue(1, "a", Constants::kTtlInfinity)));
+  EXPECT_TRUE(store->setKey("prefix:node1", createValue(1, "p", 100)));
+  EXPECT_TRUE(
+      store->setKey("key", createValue(1, "k", Constants::kTtlInfinity)));
+
+  auto counters = store->getCounters();
+  EXPECT_EQ(2, counters["kvstore.key_prefix.adj.num_keys"].value);
+  EXPECT_EQ(1, counters["kvstore.key_prefix.prefix.num_keys"].value);
+  EXPECT_EQ(1, counters["kvstore.key_prefix.none.num_keys"].value);
+  const auto adjBytes = counters["kvstore.key_prefix.adj.bytes"].value;
+
+  // updating value only changes its bytes
+  EXPECT_TRUE(store->setKey(
+      "adj:node1", createValue(2, "aaaaaaaaaaa", Constants::kTtlInfinity)));
+  counters = store->getCounters();
+  EXPECT_EQ(2, counters["kvstore.key_prefix.adj.num_keys"].value);
+  EXPECT_EQ(adjBytes + 10, counters["kvstore.key_prefix.adj.bytes"].value);
+
+  // expired key is accounted out
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  counters = store->getCounters();
+  EXPECT_EQ(0, counters["kvstore.key_prefix.prefix.num_keys"].value);
+  EXPECT_EQ(0, counters["kvstore.key_prefix.prefix.bytes"].value);
+}
+
+/*
+ * Value delta rebuilds the new value from its base only
+ */
+TEST(KvStore, ValueDelta) {
+  thrift::Value baseValue(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "node1" /* originatorId */,
+      std::string(Constants::kKvStoreMinDeltaValueSize, 'a'),
+      Constants::kTtlInfinity /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  baseValue.hash = generateHash(
+      baseValue.version, baseValue.originatorId, baseValue.value);
+  auto newValue = baseValue;
+  newValue.version = 2;
+  newValue.value->replace(10, 3, "bbbbb");
+  newValue.hash =
+      generateHash(newValue.version, newValue.originatorId, newValue.value);
+
+  auto delta = KvStore::createValueDelta("key", baseValue, newValue);
+  ASSERT_TRUE(delta.hasValue());
+  EXPECT_EQ("key", delta->key);
+  EXPECT_EQ(1, delta->baseVersion);
+  EXPECT_EQ(10, delta->headSize);
+  EXPECT_EQ("bbbbb", delta->patch);
+
+  auto value = KvStore::applyValueDelta(delta.value(), baseValue);
+  ASSERT_TRUE(value.hasValue());
+  EXPECT_EQ(2, value->version);
+  EXPECT_EQ(newValue.value, value->value);
+
+  // base value doesn't match
+  EXPECT_FALSE(KvStore::applyValueDelta(delta.value(), newValue).hasValue());
+
+  // patch as large as the value
+  auto otherValue = newValue;
+  otherValue.value = std::string(Constants::kKvStoreMinDeltaValueSize, 'c');
+  EXPECT_FALSE(
+      KvStore::createValueDelta("key", baseValue, otherValue).hasValue());
+
+  // small values are sent as is
+  auto smallValue = newValue;
+  smallValue.value = "value";
+  EXPECT_FALSE(
+      KvStore::createValueDelta("key", baseValue, smallValue).hasValue());
+}
+
+/*
+ * Updates of large values are flooded as delta of the previous version
+ */
+TEST_F(KvStoreTestFixture, ValueDeltas) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto store0 = createKvStore(
+      "store0",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      false, /* flood-optimization */
+      false, /* is-root */
+      kDbSyncInterval,
+      false, /* range-sync */
+      false, /* ttl-update-batching */
+      0, /* worker-threads */
+      true /* value-deltas */);
+  auto store1 = createKvStore("store1", emptyPeers);
+  store0->run();
+  store1->run();
+  store0->addPeer(store1->nodeId, store1->getPeerSpec());
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  thrift::Value value(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "store0" /* originatorId */,
+      std::string(2 * Constants::kKvStoreMinDeltaValueSize, 'a'),
+      300000 /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  value.hash = generateHash(value.version, value.originatorId, value.value);
+  EXPECT_TRUE(store0->setKey("key1", value));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_TRUE(store1->getKey("key1").hasValue());
+
+  value.version = 2;
+  value.value->replace(100, 1, "b");
+  value.hash = generateHash(value.version, value.originatorId, value.value);
+  EXPECT_TRUE(store0->setKey("key1", value));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  auto res = store1->getKey("key1");
+  ASSERT_TRUE(res.hasValue());
+  EXPECT_EQ(2, res->version);
+  EXPECT_EQ(value.value, res->value);
+  EXPECT_EQ(value.hash, res->hash);
+
+  auto counters0 = store0->getCounters();
+  EXPECT_EQ(1, counters0["kvstore.sent_value_deltas.sum.0"].value);
+  auto counters1 = store1->getCounters();
+  EXPECT_EQ(1, counters1["kvstore.received_value_deltas.sum.0"].value);
+  EXPECT_EQ(0, counters1["kvstore.value_delta_misses.sum.0"].value);
+}
+
 /*
  * check key value is decremented with the TTL decrement value provided,
  * and is not synced if remaining TTL is < TTL decrement value provided
@@ -2860,6 +3462,456 @@ TEST_F(KvStoreTestFixture, FullSync) {
   EXPECT_EQ(v4->value.value(), "b");
 }
 
+/**
+ * Full-syncs with initial peers are requested one at a time with at most one
+ * in flight, each once the previous one is answered
+ */
+TEST_F(KvStoreTestFixture, MaxParallelSyncs) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  std::unordered_map<std::string, thrift::PeerSpec> peers;
+  for (int i = 0; i < 4; ++i) {
+    auto store = createKvStore(folly::sformat("store{}", i), emptyPeers);
+    store->run();
+    thrift::Value val(
+        apache::thrift::FRAGILE,
+        1 /* version */,
+        store->nodeId /* originatorId */,
+        "value" /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    val.hash = generateHash(val.version, val.originatorId, val.value);
+    EXPECT_TRUE(store->setKey(folly::sformat("key{}", i), val));
+    peers.emplace(store->nodeId, store->getPeerSpec());
+  }
+
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "storeA",
+      kDbSyncInterval,
+      kMonitorSubmitInterval,
+      peers,
+      folly::none /* filters */,
+      folly::none /* flood rate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      false /* enableRangeSync */,
+      false /* enableTtlUpdateBatching */,
+      0 /* workerThreads */,
+      false /* enableValueDeltas */,
+      folly::none /* snapshotFilePath */,
+      1 /* maxParallelSyncs */));
+  auto storeA = stores_.back().get();
+  storeA->run();
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  // synced with all peers, the last three after waiting for previous ones
+  EXPECT_EQ(4, storeA->dumpAll().size());
+  auto counters = storeA->getCounters();
+  EXPECT_EQ(0, counters["kvstore.pending_full_sync"].value);
+  EXPECT_EQ(0, counters["kvstore.full_sync_in_flight"].value);
+  EXPECT_LE(3, counters["kvstore.full_sync_deferred.sum.0"].value);
+  EXPECT_EQ(0, counters["kvstore.full_sync_timeouts.count.0"].value);
+}
+
+/**
+ * With SPT full-sync, added peers are only synced with if they are on the
+ * flood SPT. n1 syncs with its SPT parent r0 but not with n0, whose updates
+ * reach it over r0
+ */
+TEST_F(KvStoreTestFixture, SptFullSync) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto r0 = createKvStore(
+      "r0",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      true,
+      true /* isRoot */);
+  auto n0 = createKvStore(
+      "n0",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      true,
+      false /* isRoot */);
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "n1",
+      kDbSyncInterval,
+      kMonitorSubmitInterval,
+      emptyPeers,
+      folly::none /* filters */,
+      folly::none /* flood rate */,
+      Constants::kTtlDecrement,
+      true /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      false /* enableRangeSync */,
+      false /* enableTtlUpdateBatching */,
+      0 /* workerThreads */,
+      false /* enableValueDeltas */,
+      folly::none /* snapshotFilePath */,
+      0 /* maxParallelSyncs */,
+      folly::none /* originatorUpdateRate */,
+      0 /* peerStreamPort */,
+      true /* enableSptFullSync */));
+  auto n1 = stores_.back().get();
+  r0->run();
+  n0->run();
+  n1->run();
+
+  thrift::Value val(
+      apache::thrift::FRAGILE,
+      1 /* version */,
+      "n0" /* originatorId */,
+      "value" /* value */,
+      Constants::kTtlInfinity /* ttl */,
+      0 /* ttl version */,
+      0 /* hash */);
+  val.hash = generateHash(val.version, val.originatorId, val.value);
+  EXPECT_TRUE(n0->setKey("key0", val));
+  EXPECT_TRUE(r0->addPeer(n0->nodeId, n0->getPeerSpec()));
+  EXPECT_TRUE(n0->addPeer(r0->nodeId, r0->getPeerSpec()));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  EXPECT_TRUE(r0->getKey("key0").hasValue());
+
+  // n1 joins the triangle
+  EXPECT_TRUE(r0->addPeer(n1->nodeId, n1->getPeerSpec()));
+  EXPECT_TRUE(n0->addPeer(n1->nodeId, n1->getPeerSpec()));
+  EXPECT_TRUE(n1->addPeer(r0->nodeId, r0->getPeerSpec()));
+  EXPECT_TRUE(n1->addPeer(n0->nodeId, n0->getPeerSpec()));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  EXPECT_EQ(r0->nodeId, n1->getFloodTopo().infos.at("r0").parent);
+  EXPECT_TRUE(n1->getKey("key0").hasValue());
+  auto counters = n1->getCounters();
+  EXPECT_EQ(0, counters["kvstore.pending_full_sync"].value);
+  EXPECT_EQ(1, counters["kvstore.full_sync_skipped_non_spt.sum.0"].value);
+}
+
+/**
+ * Flooded value updates of each originator are dropped above its update rate,
+ * TTL refreshes and updates of other originators are not
+ */
+TEST_F(KvStoreTestFixture, OriginatorRateLimit) {
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "store",
+      kDbSyncInterval,
+      kMonitorSubmitInterval,
+      std::unordered_map<std::string, thrift::PeerSpec>{},
+      folly::none /* filters */,
+      folly::none /* flood rate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      false /* enableRangeSync */,
+      false /* enableTtlUpdateBatching */,
+      0 /* workerThreads */,
+      false /* enableValueDeltas */,
+      folly::none /* snapshotFilePath */,
+      0 /* maxParallelSyncs */,
+      KvStoreFloodRate(std::make_pair(1, 2)) /* originatorUpdateRate */));
+  auto store = stores_.back().get();
+  store->run();
+
+  auto createValue = [](std::string const& originatorId, int64_t version) {
+    thrift::Value value(
+        apache::thrift::FRAGILE,
+        version,
+        originatorId,
+        folly::sformat("value-{}", version),
+        300000 /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    value.hash = generateHash(value.version, value.originatorId, value.value);
+    return value;
+  };
+
+  // burst of two updates is accepted, the rest dropped
+  for (int64_t version = 1; version <= 5; ++version) {
+    EXPECT_TRUE(store->setKey("node1-key", createValue("node1", version)));
+  }
+  auto maybeValue = store->getKey("node1-key");
+  ASSERT_TRUE(maybeValue.hasValue());
+  EXPECT_EQ(2, maybeValue->version);
+
+  // TTL refresh and stale update don't count against the originator
+  auto ttlUpdate = createValue("node1", 2);
+  ttlUpdate.value = folly::none;
+  ttlUpdate.ttlVersion = 1;
+  EXPECT_TRUE(store->setKey("node1-key", ttlUpdate));
+  EXPECT_TRUE(store->setKey("node1-key", createValue("node1", 1)));
+  EXPECT_EQ(1, store->getKey("node1-key")->ttlVersion);
+
+  // other originators are not affected
+  EXPECT_TRUE(store->setKey("node2-key", createValue("node2", 1)));
+  EXPECT_TRUE(store->getKey("node2-key").hasValue());
+
+  auto counters = store->getCounters();
+  EXPECT_EQ(3, counters["kvstore.rate_limited_key_vals.sum.0"].value);
+  EXPECT_EQ(1, counters["kvstore.rate_limited_originators"].value);
+
+  // updates are accepted again as the rate allows
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_TRUE(store->setKey("node1-key", createValue("node1", 6)));
+  EXPECT_EQ(6, store->getKey("node1-key")->version);
+}
+
+/**
+ * Flood requests to a peer streaming them go to its sink instead of ZMQ. Those
+ * the sink can't take are held back and retried, and ZMQ is used again once
+ * the stream is removed
+ */
+TEST_F(KvStoreTestFixture, PeerStream) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto storeA = createKvStore("storeA", emptyPeers);
+  auto storeB = createKvStore("storeB", emptyPeers);
+  storeA->run();
+  storeB->run();
+  EXPECT_TRUE(storeA->addPeer(storeB->nodeId, storeB->getPeerSpec()));
+
+  std::atomic<bool> accept{true};
+  folly::Synchronized<std::vector<std::string>> streamedKeys;
+  storeA->getKvStore()->addPeerStream(
+      storeB->nodeId, 1, [&](thrift::KeySetParams const& params) {
+        if (not accept) {
+          return false;
+        }
+        auto keys = streamedKeys.wlock();
+        for (auto const& kv : params.keyVals) {
+          keys->emplace_back(kv.first);
+        }
+        return true;
+      });
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  auto createValue = [](int64_t version) {
+    thrift::Value value(
+        apache::thrift::FRAGILE,
+        version,
+        "storeA" /* originatorId */,
+        "value" /* value */,
+        Constants::kTtlInfinity /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    value.hash = generateHash(value.version, value.originatorId, value.value);
+    return value;
+  };
+
+  EXPECT_TRUE(storeA->setKey("key1", createValue(1)));
+  EXPECT_EQ(std::vector<std::string>{"key1"}, *streamedKeys.rlock());
+
+  // held back while the stream pushes back
+  accept = false;
+  EXPECT_TRUE(storeA->setKey("key2", createValue(1)));
+  EXPECT_EQ(1, streamedKeys.rlock()->size());
+  EXPECT_LE(
+      1,
+      storeA->getCounters()["kvstore.peer_stream.backpressure.count.0"].value);
+  accept = true;
+  /* sleep override */
+  std::this_thread::sleep_for(3 * Constants::kFloodPendingPublication);
+  EXPECT_EQ(
+      (std::vector<std::string>{"key1", "key2"}), *streamedKeys.rlock());
+
+  // removal with a stale token is ignored
+  storeA->getKvStore()->removePeerStream(storeB->nodeId, 2);
+  storeA->getKvStore()->removePeerStream(storeB->nodeId, 1);
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(storeA->setKey("key3", createValue(1)));
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(2, streamedKeys.rlock()->size());
+  EXPECT_TRUE(storeB->getKey("key3").hasValue());
+}
+
+/**
+ * Key-values loaded from snapshot are only merged in once a peer confirms
+ * them by leaving them out of its full-sync response. Those the peer has a
+ * better value of or doesn't have are dropped
+ */
+TEST_F(KvStoreTestFixture, Snapshot) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto createValue = [](int64_t version, std::string const& value) {
+    thrift::Value thriftVal(
+        apache::thrift::FRAGILE,
+        version,
+        "storeB" /* originatorId */,
+        value,
+        30000 /* ttl */,
+        0 /* ttl version */,
+        0 /* hash */);
+    thriftVal.hash = generateHash(
+        thriftVal.version, thriftVal.originatorId, thriftVal.value);
+    return thriftVal;
+  };
+
+  // snapshot has (k1, 1), (k2, 1), (k3, 1)
+  auto tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const auto snapshotFile =
+      folly::sformat("/tmp/kvstore_ut_snapshot.bin.{}", tid);
+  thrift::KvStoreSnapshot snapshot;
+  snapshot.keyVals.emplace("key1", createValue(1, "a"));
+  snapshot.keyVals.emplace("key2", createValue(1, "a"));
+  snapshot.keyVals.emplace("key3", createValue(1, "a"));
+  snapshot.timestampMs = getUnixTimeStamp();
+  apache::thrift::CompactSerializer serializer;
+  folly::writeFileAtomic(
+      snapshotFile, fbzmq::util::writeThriftObjStr(snapshot, serializer));
+
+  // storeB has (k1, 1), (k2, 5)
+  auto storeB = createKvStore("storeB", emptyPeers);
+  storeB->run();
+  EXPECT_TRUE(storeB->setKey("key1", createValue(1, "a")));
+  EXPECT_TRUE(storeB->setKey("key2", createValue(5, "b")));
+
+  stores_.emplace_back(std::make_unique<KvStoreWrapper>(
+      context,
+      "storeA",
+      kDbSyncInterval,
+      kMonitorSubmitInterval,
+      emptyPeers,
+      folly::none /* filters */,
+      folly::none /* flood rate */,
+      Constants::kTtlDecrement,
+      false /* enableFloodOptimization */,
+      false /* isFloodRoot */,
+      false /* enableRangeSync */,
+      false /* enableTtlUpdateBatching */,
+      0 /* workerThreads */,
+      false /* enableValueDeltas */,
+      snapshotFile));
+  auto storeA = stores_.back().get();
+  storeA->run();
+
+  // unconfirmed key-values aren't visible
+  EXPECT_EQ(0, storeA->dumpAll().size());
+  auto counters = storeA->getCounters();
+  EXPECT_EQ(3, counters["kvstore.snapshot.unconfirmed_keys"].value);
+
+  storeA->addPeer("storeB", storeB->getPeerSpec());
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  // k1 is confirmed, k2 is replaced by better value of storeB and k3 dropped
+  auto v1 = storeA->getKey("key1");
+  ASSERT_TRUE(v1.hasValue());
+  EXPECT_EQ(1, v1->version);
+  EXPECT_EQ("a", v1->value.value());
+  EXPECT_GT(v1->ttl, 0);
+  auto v2 = storeA->getKey("key2");
+  ASSERT_TRUE(v2.hasValue());
+  EXPECT_EQ(5, v2->version);
+  EXPECT_FALSE(storeA->getKey("key3").hasValue());
+  EXPECT_FALSE(storeB->getKey("key3").hasValue());
+
+  counters = storeA->getCounters();
+  EXPECT_EQ(0, counters["kvstore.snapshot.unconfirmed_keys"].value);
+  EXPECT_EQ(1, counters["kvstore.snapshot.confirmed_keys.sum.0"].value);
+  EXPECT_EQ(2, counters["kvstore.snapshot.dropped_keys.sum.0"].value);
+  std::remove(snapshotFile.c_str());
+}
+
+/**
+ * Same 3-way full-sync as above on top of a thousand keys both stores agree
+ * on, with range sync enabled on storeA. Only hashes of keys in differing
+ * leaf key ranges are exchanged after descending the key range levels
+ */
+TEST_F(KvStoreTestFixture, RangeSync) {
+  const std::unordered_map<std::string, thrift::PeerSpec> emptyPeers;
+  auto storeA = createKvStore(
+      "storeA",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      false, /* flood-optimization */
+      false, /* is-root */
+      60s, /* db-sync-interval */
+      true /* range-sync */);
+  auto storeB = createKvStore(
+      "storeB",
+      emptyPeers,
+      folly::none,
+      folly::none,
+      Constants::kTtlDecrement,
+      false, /* flood-optimization */
+      false, /* is-root */
+      60s /* db-sync-interval */);
+  storeA->run();
+  storeB->run();
+
+  auto createValue = [](int64_t version, std::string const& value) {
+    thrift::Value val(
+        apache::thrift::FRAGILE,
+        version,
+        "storeA" /* originatorId */,
+        value,
+        30000 /* ttl */,
+        99 /* ttl version */,
+        0 /* hash*/);
+    val.hash = generateHash(val.version, val.originatorId, val.value);
+    return val;
+  };
+
+  for (int i = 0; i < 1000; ++i) {
+    auto const key = folly::sformat("common-key{}", i);
+    EXPECT_TRUE(storeA->setKey(key, createValue(1, "c")));
+    EXPECT_TRUE(storeB->setKey(key, createValue(1, "c")));
+  }
+
+  // storeA has (k0, 5, a), (k1, 1, a), (k2, 9, a), (k3, 1, a)
+  // storeB has             (k1, 1, a), (k2, 1, b), (k3, 9, b), (k4, 6, b)
+  EXPECT_TRUE(storeA->setKey("key0", createValue(5, "a")));
+  EXPECT_TRUE(storeA->setKey("key1", createValue(1, "a")));
+  EXPECT_TRUE(storeA->setKey("key2", createValue(9, "a")));
+  EXPECT_TRUE(storeA->setKey("key3", createValue(1, "a")));
+  EXPECT_TRUE(storeB->setKey("key1", createValue(1, "a")));
+  EXPECT_TRUE(storeB->setKey("key2", createValue(1, "b")));
+  EXPECT_TRUE(storeB->setKey("key3", createValue(9, "b")));
+  EXPECT_TRUE(storeB->setKey("key4", createValue(6, "b")));
+
+  storeA->addPeer("storeB", storeB->getPeerSpec());
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+  auto const dumpA = storeA->dumpAll();
+  auto const dumpB = storeB->dumpAll();
+  EXPECT_EQ(1005, dumpA.size());
+  ASSERT_EQ(dumpA.size(), dumpB.size());
+  for (auto const& kv : dumpA) {
+    auto const& valB = dumpB.at(kv.first);
+    EXPECT_EQ(kv.second.version, valB.version);
+    EXPECT_EQ(kv.second.value, valB.value);
+  }
+  auto v2 = storeB->getKey("key2");
+  ASSERT_TRUE(v2.hasValue());
+  EXPECT_EQ(9, v2->version);
+  EXPECT_EQ("a", v2->value.value());
+  auto v3 = storeA->getKey("key3");
+  ASSERT_TRUE(v3.hasValue());
+  EXPECT_EQ(9, v3->version);
+  EXPECT_EQ("b", v3->value.value());
+
+  // storeB compared digests at levels 1 and 3, storeA at levels 2 and 4.
+  // At most the leaf ranges of key0, key2, key3 and key4 differ
+  auto countersA = storeA->getCounters();
+  auto countersB = storeB->getCounters();
+  EXPECT_EQ(2, countersB["kvstore.cmd_key_range_dump.count.0"].value);
+  EXPECT_EQ(2, countersA["kvstore.range_sync_requests.count.0"].value);
+  EXPECT_GE(4, countersA["kvstore.range_sync_leaf_ranges.avg.0"].value);
+}
+
 int
 main(int argc, char* argv[]) {
   // Parse command line flags
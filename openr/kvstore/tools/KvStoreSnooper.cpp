@@ -14,6 +14,7 @@
 
 DEFINE_string(host, "::1", "Host to connect to");
 DEFINE_int32(port, openr::Constants::kOpenrCtrlPort, "OpenrCtrl server port");
+DEFINE_string(prefix, "", "Comma separated key prefixes to snoop on");
 
 int
 main(int argc, char** argv) {
@@ -27,7 +28,10 @@ main(int argc, char** argv) {
   // Create Open/R client
   auto client = openr::getOpenrCtrlPlainTextClient(
       evb, folly::IPAddress(FLAGS_host), FLAGS_port);
-  auto response = client->semifuture_subscribeAndGetKvStore().get();
+  openr::thrift::KeyDumpParams filter;
+  filter.prefix = FLAGS_prefix;
+  auto response =
+      client->semifuture_subscribeAndGetKvStoreFiltered(filter).get();
   auto& globalKeyVals = response.response.keyVals;
   LOG(INFO) << "Stream is connected, updates will follow";
   LOG(INFO) << "Received " << globalKeyVals.size()
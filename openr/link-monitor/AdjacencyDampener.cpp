@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "AdjacencyDampener.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+namespace openr {
+
+AdjacencyDampener::AdjacencyDampener(AdjacencyDampeningConfig const& config)
+    : config_(config),
+      maxPenalty_(
+          config.reuseLimit *
+          std::exp2(
+              static_cast<double>(config.maxSuppressTime.count()) /
+              config.halfLife.count())) {
+  CHECK_GT(config_.penalty, 0);
+  CHECK_GT(config_.reuseLimit, 0);
+  CHECK_GT(config_.halfLife.count(), 0);
+  CHECK_LT(config_.reuseLimit, config_.suppressLimit)
+      << "Reuse limit must be below suppress limit";
+  CHECK_LE(config_.suppressLimit, maxPenalty_)
+      << "Suppress limit can never be reached within max suppress time";
+}
+
+double
+AdjacencyDampener::getDecayedPenalty(Entry const& entry, TimePoint now) const {
+  const auto elapsed = std::max(
+      std::chrono::duration<double, std::milli>(0),
+      std::chrono::duration<double, std::milli>(now - entry.lastFlapTime));
+  return entry.penalty * std::exp2(-elapsed.count() / config_.halfLife.count());
+}
+
+AdjacencyDampener::TimePoint
+AdjacencyDampener::getDecayTime(Entry const& entry, double penalty) const {
+  if (entry.penalty <= penalty) {
+    return entry.lastFlapTime;
+  }
+  // round up with 1ms to spare, penalty must have decayed by then despite
+  // floating point errors
+  const auto decayTimeMs = std::ceil(
+      config_.halfLife.count() * std::log2(entry.penalty / penalty));
+  return entry.lastFlapTime +
+      std::chrono::milliseconds(static_cast<int64_t>(decayTimeMs) + 1);
+}
+
+bool
+AdjacencyDampener::flap(Key const& key, TimePoint now) {
+  auto& entry = entries_[key];
+  entry.penalty =
+      std::min(maxPenalty_, getDecayedPenalty(entry, now) + config_.penalty);
+  entry.lastFlapTime = now;
+
+  if (entry.isSuppressed or entry.penalty < config_.suppressLimit) {
+    return false;
+  }
+  VLOG(1) << "Suppressing adjacency " << key.first << " on " << key.second
+          << " with penalty " << entry.penalty;
+  entry.isSuppressed = true;
+  ++numSuppressed_;
+  return true;
+}
+
+bool
+AdjacencyDampener::isSuppressed(Key const& key) const {
+  auto it = entries_.find(key);
+  return it != entries_.end() and it->second.isSuppressed;
+}
+
+double
+AdjacencyDampener::getPenalty(Key const& key, TimePoint now) const {
+  auto it = entries_.find(key);
+  return it == entries_.end() ? 0 : getDecayedPenalty(it->second, now);
+}
+
+std::vector<AdjacencyDampener::Key>
+AdjacencyDampener::update(TimePoint now) {
+  std::vector<Key> reused;
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    auto& entry = it->second;
+    const auto penalty = getDecayedPenalty(entry, now);
+    if (entry.isSuppressed and penalty <= config_.reuseLimit) {
+      VLOG(1) << "Reusing adjacency " << it->first.first << " on "
+              << it->first.second;
+      entry.isSuppressed = false;
+      --numSuppressed_;
+      reused.emplace_back(it->first);
+    }
+    // forget history once penalty is half of reuse limit, like RFC 2439
+    if (not entry.isSuppressed and penalty <= config_.reuseLimit / 2) {
+      it = entries_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return reused;
+}
+
+folly::Optional<AdjacencyDampener::TimePoint>
+AdjacencyDampener::getNextUpdateTime() const {
+  folly::Optional<TimePoint> nextUpdateTime;
+  for (auto const& kv : entries_) {
+    auto const& entry = kv.second;
+    const auto updateTime = getDecayTime(
+        entry,
+        entry.isSuppressed ? config_.reuseLimit : config_.reuseLimit / 2);
+    if (not nextUpdateTime.hasValue() or updateTime < *nextUpdateTime) {
+      nextUpdateTime = updateTime;
+    }
+  }
+  return nextUpdateTime;
+}
+
+} // namespace openr
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+struct AdjacencyDampeningConfig {
+  // penalty added on every flap
+  double penalty{1000};
+  // adjacency is suppressed once penalty reaches it
+  double suppressLimit{2000};
+  // and reused once penalty decays back to it
+  double reuseLimit{750};
+  // time for penalty to decay by half
+  std::chrono::milliseconds halfLife{std::chrono::seconds(60)};
+  // longest time an adjacency stays suppressed after its last flap. Penalty is
+  // capped accordingly
+  std::chrono::milliseconds maxSuppressTime{std::chrono::seconds(300)};
+};
+
+/**
+ * RFC 2439 style flap dampening of adjacencies, similar to RouteDampener of
+ * fbmeshd. Each flap of an adjacency adds a fixed penalty, which decays
+ * exponentially over time. Adjacency is suppressed when its penalty goes
+ * above suppress limit, and becomes reusable when it decays below reuse limit.
+ *
+ * Penalties are decayed lazily from time of last flap, there are no timers.
+ * Owner is expected to call update() at getNextUpdateTime() to learn about
+ * reusable adjacencies. Adjacencies are keyed by <remoteNodeName, ifName>.
+ * Not thread safe.
+ */
+class AdjacencyDampener final {
+ public:
+  using Key = std::pair<std::string, std::string>;
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  explicit AdjacencyDampener(AdjacencyDampeningConfig const& config);
+
+  // Record flap of adjacency. Returns true if it got suppressed by it
+  bool flap(Key const& key, TimePoint now = std::chrono::steady_clock::now());
+
+  bool isSuppressed(Key const& key) const;
+
+  // Decayed penalty of adjacency, 0 if unknown
+  double getPenalty(
+      Key const& key, TimePoint now = std::chrono::steady_clock::now()) const;
+
+  // Reuse adjacencies which penalty decayed below reuse limit and forget ones
+  // which penalty is negligible. Returns reused adjacencies
+  std::vector<Key> update(TimePoint now = std::chrono::steady_clock::now());
+
+  // When next call to update() has anything to do, if ever
+  folly::Optional<TimePoint> getNextUpdateTime() const;
+
+  size_t
+  getNumSuppressed() const {
+    return numSuppressed_;
+  }
+
+ private:
+  struct Entry {
+    double penalty{0};
+    TimePoint lastFlapTime;
+    bool isSuppressed{false};
+  };
+
+  double getDecayedPenalty(Entry const& entry, TimePoint now) const;
+
+  // Time at which penalty of entry decays to given value
+  TimePoint getDecayTime(Entry const& entry, double penalty) const;
+
+  const AdjacencyDampeningConfig config_;
+
+  // penalty beyond which adjacency would stay suppressed longer than
+  // maxSuppressTime
+  const double maxPenalty_{0};
+
+  std::map<Key, Entry> entries_;
+  size_t numSuppressed_{0};
+};
+
+} // namespace openr
@@ -11,7 +11,6 @@
 #include <functional>
 
 #include <fbzmq/service/if/gen-cpp2/Monitor_types.h>
-#include <fbzmq/service/logging/LogSample.h>
 #include <fbzmq/zmq/Zmq.h>
 #include <folly/MapUtil.h>
 #include <folly/Memory.h>
@@ -34,14 +33,9 @@ namespace {
 
 const std::string kConfigKey{"link-monitor-config"};
 
-/**
- * Transformation function to convert measured rtt (in us) to a metric value
- * to be used. Metric can never be zero.
- */
-int32_t
-getRttMetric(int64_t rttUs) {
-  return std::max((int)(rttUs / 100), (int)1);
-}
+// max number of Spark events processed at once, before yielding to the other
+// sockets and timers of event loop
+const int kMaxSparkReportsPerPoll{100};
 
 void
 printLinkMonitorConfig(openr::thrift::LinkMonitorConfig const& config) {
@@ -99,7 +93,10 @@ LinkMonitor::LinkMonitor(
     std::chrono::seconds adjHoldTime,
     std::chrono::milliseconds flapInitialBackoff,
     std::chrono::milliseconds flapMaxBackoff,
-    std::chrono::milliseconds ttlKeyInKvStore)
+    std::chrono::milliseconds ttlKeyInKvStore,
+    bool eventDrivenInterfaceSync,
+    folly::Optional<AdjacencyDampeningConfig> adjDampeningConfig,
+    RttMetricConfig const& rttMetricConfig)
     : OpenrEventLoop(
           nodeId,
           thrift::OpenrModuleType::LINK_MONITOR,
@@ -114,6 +111,7 @@ LinkMonitor::LinkMonitor(
       redistRegexList_(std::move(redistRegexList)),
       staticPrefixes_(staticPrefixes),
       useRttMetric_(useRttMetric),
+      rttMetric_(rttMetricConfig),
       enablePerfMeasurement_(enablePerfMeasurement),
       enableV4_(enableV4),
       enableSegmentRouting_(enableSegmentRouting),
@@ -127,6 +125,7 @@ LinkMonitor::LinkMonitor(
       flapInitialBackoff_(flapInitialBackoff),
       flapMaxBackoff_(flapMaxBackoff),
       ttlKeyInKvStore_(ttlKeyInKvStore),
+      eventDrivenInterfaceSync_(eventDrivenInterfaceSync),
       adjHoldUntilTimePoint_(std::chrono::steady_clock::now() + adjHoldTime),
       // mutable states
       linkMonitorPubSock_(
@@ -147,6 +146,25 @@ LinkMonitor::LinkMonitor(
         advertiseAdjacencies();
       });
 
+  // Create adjacency dampener
+  if (adjDampeningConfig.hasValue()) {
+    adjDampener_ =
+        std::make_unique<AdjacencyDampener>(adjDampeningConfig.value());
+    adjDampenerTimer_ = fbzmq::ZmqTimeout::make(
+        this, profiled("timer.adj_dampener", [this]() noexcept {
+          bool advertise = false;
+          for (const auto& adjId : adjDampener_->update()) {
+            tData_.addStatValue(
+                "link_monitor.adjacency_reused", 1, fbzmq::SUM);
+            advertise |= adjacencies_.count(adjId) > 0;
+          }
+          if (advertise) {
+            advertiseAdjacenciesThrottled_->operator()();
+          }
+          scheduleAdjDampenerTimeout();
+        }));
+  }
+
   // Create throttled interfaces and addresses advertiser
   advertiseIfaceAddrThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
       this, Constants::kLinkThrottleTimeout, [this]() noexcept {
@@ -154,7 +172,9 @@ LinkMonitor::LinkMonitor(
       });
   // Create timer. Timer is used for immediate or delayed executions.
   advertiseIfaceAddrTimer_ = fbzmq::ZmqTimeout::make(
-      this, [this]() noexcept { advertiseIfaceAddr(); });
+      this, profiled("timer.advertise_iface_addr", [this]() noexcept {
+        advertiseIfaceAddr();
+      }));
 
   LOG(INFO) << "Loading link-monitor config";
   zmqMonitorClient_ =
@@ -200,7 +220,7 @@ LinkMonitor::LinkMonitor(
         kvStoreClient_.get(),
         [&](folly::Optional<int32_t> newVal) noexcept {
           config_.nodeLabel = newVal ? newVal.value() : 0;
-          advertiseAdjacencies();
+          advertiseAdjacenciesThrottled_->operator()();
         },
         std::chrono::milliseconds(100),
         std::chrono::seconds(2),
@@ -273,6 +293,8 @@ LinkMonitor::prepare() noexcept {
       static_cast<uint16_t>(thrift::PlatformEventType::LINK_EVENT);
   const auto addrEventType =
       static_cast<uint16_t>(thrift::PlatformEventType::ADDRESS_EVENT);
+  const auto batchEventType =
+      static_cast<uint16_t>(thrift::PlatformEventType::BATCH_EVENT);
   auto nlLinkSubOpt =
       nlEventSub_.setSockOpt(ZMQ_SUBSCRIBE, &linkEventType, sizeof(uint16_t));
   if (nlLinkSubOpt.hasError()) {
@@ -285,6 +307,12 @@ LinkMonitor::prepare() noexcept {
     LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << addrEventType << " "
                << nlAddrSubOpt.error();
   }
+  auto nlBatchSubOpt =
+      nlEventSub_.setSockOpt(ZMQ_SUBSCRIBE, &batchEventType, sizeof(uint16_t));
+  if (nlBatchSubOpt.hasError()) {
+    LOG(FATAL) << "Error setting ZMQ_SUBSCRIBE to " << batchEventType << " "
+               << nlBatchSubOpt.error();
+  }
   const auto nlSub = nlEventSub_.connect(fbzmq::SocketUrl{platformPubUrl_});
   if (nlSub.hasError()) {
     LOG(FATAL) << "Error connecting to URL '" << platformPubUrl_ << "' "
@@ -295,101 +323,24 @@ LinkMonitor::prepare() noexcept {
   addSocket(
       fbzmq::RawZmqSocketPtr{*sparkReportSock_},
       ZMQ_POLLIN,
-      [this](int) noexcept {
-        VLOG(1) << "LinkMonitor: Spark message received...";
-
-        fbzmq::Message requestIdMsg, delimMsg, thriftMsg;
-        const auto ret =
-            sparkReportSock_.recvMultiple(requestIdMsg, delimMsg, thriftMsg);
-
-        if (ret.hasError()) {
-          LOG(ERROR) << "sparkReportSock: Error receiving command: "
-                     << ret.error();
-          return;
-        }
-
-        const auto requestId = requestIdMsg.read<std::string>().value();
-        const auto delim = delimMsg.read<std::string>().value();
-        if (not delimMsg.empty()) {
-          LOG(ERROR) << "sparkReportSock: Non-empty delimiter: " << delim;
-          return;
-        }
-
-        VLOG(3) << "sparkReportSock, got id: `"
-                << folly::backslashify(requestId) << "` and delim: `"
-                << folly::backslashify(delim) << "`";
-
-        const auto maybeEvent =
-            thriftMsg.readThriftObj<thrift::SparkNeighborEvent>(serializer_);
-
-        if (maybeEvent.hasError()) {
-          LOG(ERROR) << "Error processing Spark event object: "
-                     << maybeEvent.error();
-          return;
-        }
-
-        auto event = maybeEvent.value();
-
-        auto neighborAddrV4 = event.neighbor.transportAddressV4;
-        auto neighborAddrV6 = event.neighbor.transportAddressV6;
-
-        VLOG(1) << "Received neighbor event for " << event.neighbor.nodeName
-                << " from " << event.neighbor.ifName << " at " << event.ifName
-                << " with addrs " << toString(neighborAddrV6) << " and "
-                << (enableV4_ ? toString(neighborAddrV4) : "");
-
-        switch (event.eventType) {
-        case thrift::SparkNeighborEventType::NEIGHBOR_UP: {
-          logNeighborEvent(event);
-          neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
-          break;
-        }
-
-        case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING: {
-          logNeighborEvent(event);
-          neighborRestartingEvent(event.neighbor.nodeName, event.ifName);
-          break;
-        }
-
-        case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED: {
-          logNeighborEvent(event);
-          neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
-          break;
-        }
-
-        case thrift::SparkNeighborEventType::NEIGHBOR_DOWN: {
-          logNeighborEvent(event);
-          neighborDownEvent(event.neighbor.nodeName, event.ifName);
-          break;
-        }
-
-        case thrift::SparkNeighborEventType::NEIGHBOR_RTT_CHANGE: {
-          if (!useRttMetric_) {
+      profiled("socket.spark_report", [this](int) noexcept {
+        // Drain pending reports, so that KvStore peers of neighbors coming
+        // up or going down together (e.g. on power up of a rack or flap of a
+        // shared segment) are changed in one request each
+        for (int i = 0; i < kMaxSparkReportsPerPoll; ++i) {
+          if (not processSparkReport()) {
             break;
           }
-
-          logNeighborEvent(event);
-
-          int32_t newRttMetric = getRttMetric(event.rttUs);
-          VLOG(1) << "Metric value changed for neighbor "
-                  << event.neighbor.nodeName << " to " << newRttMetric;
-          auto it = adjacencies_.find({event.neighbor.nodeName, event.ifName});
-          if (it != adjacencies_.end()) {
-            auto& adj = it->second.adjacency;
-            adj.metric = newRttMetric;
-            adj.rtt = event.rttUs;
-            advertiseAdjacenciesThrottled_->operator()();
-          }
-          break;
         }
-
-        default:
-          LOG(ERROR) << "Unknown event type " << (int32_t)event.eventType;
+        if (kvStorePeersChanged_) {
+          advertiseKvStorePeers();
         }
-      }); // sparkReportSock_ callback
+      })); // sparkReportSock_ callback
 
   addSocket(
-      fbzmq::RawZmqSocketPtr{*nlEventSub_}, ZMQ_POLLIN, [this](int) noexcept {
+      fbzmq::RawZmqSocketPtr{*nlEventSub_},
+      ZMQ_POLLIN,
+      profiled("socket.platform_event", [this](int) noexcept {
         VLOG(2) << "LinkMonitor: Netlink Platform message received....";
         fbzmq::Message eventHeader, eventData;
         const auto ret = nlEventSub_.recvMultiple(eventHeader, eventData);
@@ -407,6 +358,11 @@ LinkMonitor::prepare() noexcept {
           return;
         }
 
+        if (eventMsg.value().seqNum.hasValue()) {
+          checkPlatformEventSeqNum(
+              eventMsg.value().eventType, eventMsg.value().seqNum.value());
+        }
+
         const auto eventType = eventMsg.value().eventType;
         CHECK_EQ(
             static_cast<uint16_t>(eventType),
@@ -416,20 +372,9 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::LINK_EVENT: {
           VLOG(3) << "Received Link Event from Platform....";
           try {
-            const auto linkEvt =
+            processLinkEvent(
                 fbzmq::util::readThriftObjStr<thrift::LinkEntry>(
-                    eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
-            if (interfaceEntry) {
-              const bool wasUp = interfaceEntry->isUp();
-              interfaceEntry->updateAttrs(
-                  linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
-              logLinkEvent(
-                  interfaceEntry->getIfName(),
-                  wasUp,
-                  interfaceEntry->isUp(),
-                  interfaceEntry->getBackoffDuration());
-            }
+                    eventMsg.value().eventData, serializer_));
           } catch (std::exception const& e) {
             LOG(ERROR) << "Error parsing linkEvt. Reason: "
                        << folly::exceptionStr(e);
@@ -439,17 +384,29 @@ LinkMonitor::prepare() noexcept {
         case thrift::PlatformEventType::ADDRESS_EVENT: {
           VLOG(3) << "Received Address Event from Platform....";
           try {
-            const auto addrEvt =
+            processAddrEvent(
                 fbzmq::util::readThriftObjStr<thrift::AddrEntry>(
+                    eventMsg.value().eventData, serializer_));
+          } catch (std::exception const& e) {
+            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+                       << folly::exceptionStr(e);
+          }
+        } break;
+
+        case thrift::PlatformEventType::BATCH_EVENT: {
+          VLOG(3) << "Received Batch Event from Platform....";
+          try {
+            const auto batchEvt =
+                fbzmq::util::readThriftObjStr<thrift::PlatformEventBatch>(
                     eventMsg.value().eventData, serializer_);
-            auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
-            if (interfaceEntry) {
-              interfaceEntry->updateAddr(
-                  toIPNetwork(addrEvt.ipPrefix, false /* no masking */),
-                  addrEvt.isValid);
+            for (const auto& linkEvt : batchEvt.linkEntries) {
+              processLinkEvent(linkEvt);
+            }
+            for (const auto& addrEvt : batchEvt.addrEntries) {
+              processAddrEvent(addrEvt);
             }
           } catch (std::exception const& e) {
-            LOG(ERROR) << "Error parsing addrEvt. Reason: "
+            LOG(ERROR) << "Error parsing batchEvt. Reason: "
                        << folly::exceptionStr(e);
           }
         } break;
@@ -458,7 +415,7 @@ LinkMonitor::prepare() noexcept {
           LOG(ERROR) << "Wrong eventType received on " << nodeId_
                      << ", eventType: " << static_cast<uint16_t>(eventType);
         }
-      });
+      }));
 
   // Schedule callback to advertise the initial set of adjacencies and prefixes
   scheduleTimeoutAt(adjHoldUntilTimePoint_, [this]() noexcept {
@@ -475,34 +432,163 @@ LinkMonitor::prepare() noexcept {
 
   // Schedule periodic timer for monitor submission
   const bool isPeriodic = true;
-  monitorTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+  redistAddrsSyncTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.redist_addrs_sync", [this]() noexcept {
+        advertiseRedistAddrs(true /* fullSync */);
+      }));
+  redistAddrsSyncTimer_->scheduleTimeout(
+      Constants::kRedistAddrsSyncInterval, isPeriodic);
+
+  monitorTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.monitor", [this]() noexcept { submitCounters(); }));
   monitorTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval, isPeriodic);
 
   // Schedule periodic timer for InterfaceDb re-sync from Netlink Platform
-  interfaceDbSyncTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
-    auto success = syncInterfaces();
-    if (success) {
-      VLOG(2) << "InterfaceDb Sync is successful";
-      expBackoff_.reportSuccess();
-      interfaceDbSyncTimer_->scheduleTimeout(
-          Constants::kPlatformSyncInterval, isPeriodic);
-    } else {
-      tData_.addStatValue(
-          "link_monitor.thrift.failure.getAllLinks", 1, fbzmq::SUM);
-      // Apply exponential backoff and schedule next run
-      expBackoff_.reportError();
-      interfaceDbSyncTimer_->scheduleTimeout(
-          expBackoff_.getTimeRemainingUntilRetry());
-      LOG(ERROR) << "InterfaceDb Sync failed, apply exponential "
-                 << "backoff and retry in "
-                 << expBackoff_.getTimeRemainingUntilRetry().count() << " ms";
-    }
-  });
+  // In event driven mode, it is only re-scheduled upon failure or upon
+  // detected gap of platform events
+  interfaceDbSyncTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.interface_db_sync", [this]() noexcept {
+        tData_.addStatValue("link_monitor.interface_db_sync", 1, fbzmq::SUM);
+        auto success = syncInterfaces();
+        if (success) {
+          VLOG(2) << "InterfaceDb Sync is successful";
+          expBackoff_.reportSuccess();
+          if (not eventDrivenInterfaceSync_) {
+            interfaceDbSyncTimer_->scheduleTimeout(
+                Constants::kPlatformSyncInterval, isPeriodic);
+          }
+        } else {
+          tData_.addStatValue(
+              "link_monitor.thrift.failure.getAllLinks", 1, fbzmq::SUM);
+          // Apply exponential backoff and schedule next run
+          expBackoff_.reportError();
+          interfaceDbSyncTimer_->scheduleTimeout(
+              expBackoff_.getTimeRemainingUntilRetry());
+          LOG(ERROR) << "InterfaceDb Sync failed, apply exponential "
+                     << "backoff and retry in "
+                     << expBackoff_.getTimeRemainingUntilRetry().count()
+                     << " ms";
+        }
+      }));
   // schedule immediate with small timeout
   interfaceDbSyncTimer_->scheduleTimeout(std::chrono::milliseconds(100));
 }
 
+bool
+LinkMonitor::processSparkReport() {
+  VLOG(1) << "LinkMonitor: Spark message received...";
+
+  fbzmq::Message requestIdMsg, delimMsg, thriftMsg;
+  const auto ret =
+      sparkReportSock_.recvMultiple(requestIdMsg, delimMsg, thriftMsg);
+
+  if (ret.hasError()) {
+    // nothing left to read
+    if (ret.error().errNum != EAGAIN) {
+      LOG(ERROR) << "sparkReportSock: Error receiving command: "
+                 << ret.error();
+    }
+    return false;
+  }
+
+  const auto requestId = requestIdMsg.read<std::string>().value();
+  const auto delim = delimMsg.read<std::string>().value();
+  if (not delimMsg.empty()) {
+    LOG(ERROR) << "sparkReportSock: Non-empty delimiter: " << delim;
+    return true;
+  }
+
+  VLOG(3) << "sparkReportSock, got id: `"
+          << folly::backslashify(requestId) << "` and delim: `"
+          << folly::backslashify(delim) << "`";
+
+  const auto maybeEvents =
+      thriftMsg.readThriftObj<thrift::SparkNeighborEvents>(serializer_);
+
+  if (maybeEvents.hasError()) {
+    LOG(ERROR) << "Error processing Spark event object: "
+               << maybeEvents.error();
+    return true;
+  }
+
+  // Apply all events of report before adjacencies and KvStore peers are
+  // advertised, adjacencies once through the throttle
+  for (const auto& event : maybeEvents->events) {
+    processNeighborEvent(event);
+  }
+  return true;
+}
+
+void
+LinkMonitor::processNeighborEvent(const thrift::SparkNeighborEvent& event) {
+  const auto& neighborAddrV4 = event.neighbor.transportAddressV4;
+  const auto& neighborAddrV6 = event.neighbor.transportAddressV6;
+
+  VLOG(1) << "Received neighbor event for " << event.neighbor.nodeName
+          << " from " << event.neighbor.ifName << " at " << event.ifName
+          << " with addrs " << toString(neighborAddrV6) << " and "
+          << (enableV4_ ? toString(neighborAddrV4) : "");
+
+  switch (event.eventType) {
+  case thrift::SparkNeighborEventType::NEIGHBOR_UP: {
+    logNeighborEvent(event);
+    neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
+    break;
+  }
+
+  case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTING: {
+    logNeighborEvent(event);
+    neighborRestartingEvent(event.neighbor.nodeName, event.ifName);
+    break;
+  }
+
+  case thrift::SparkNeighborEventType::NEIGHBOR_RESTARTED: {
+    logNeighborEvent(event);
+    neighborUpEvent(neighborAddrV4, neighborAddrV6, event);
+    break;
+  }
+
+  case thrift::SparkNeighborEventType::NEIGHBOR_DOWN: {
+    logNeighborEvent(event);
+    neighborDownEvent(event.neighbor.nodeName, event.ifName);
+    break;
+  }
+
+  case thrift::SparkNeighborEventType::NEIGHBOR_RTT_CHANGE: {
+    if (!useRttMetric_) {
+      break;
+    }
+
+    logNeighborEvent(event);
+
+    auto it = adjacencies_.find({event.neighbor.nodeName, event.ifName});
+    if (it != adjacencies_.end()) {
+      auto& adj = it->second.adjacency;
+      // rtt of adjacency is left as well, so that adjacency db is unchanged
+      // and not advertised
+      auto newRttMetric = rttMetric_.getChangedMetric(adj.metric, event.rttUs);
+      if (not newRttMetric.hasValue()) {
+        VLOG(2) << "Ignoring rtt change of neighbor " << event.neighbor.nodeName
+                << " to " << event.rttUs << "us, keeping metric "
+                << adj.metric;
+        tData_.addStatValue(
+            "link_monitor.rtt_metric_suppressed", 1, fbzmq::SUM);
+        break;
+      }
+      VLOG(1) << "Metric value changed for neighbor "
+              << event.neighbor.nodeName << " to " << *newRttMetric;
+      adj.metric = *newRttMetric;
+      adj.rtt = event.rttUs;
+      advertiseAdjacenciesThrottled_->operator()();
+    }
+    break;
+  }
+
+  default:
+    LOG(ERROR) << "Unknown event type " << (int32_t)event.eventType;
+  }
+}
+
 void
 LinkMonitor::neighborUpEvent(
     const thrift::BinaryAddress& neighborAddrV4,
@@ -514,7 +600,7 @@ LinkMonitor::neighborUpEvent(
   const auto adjId = std::make_pair(remoteNodeName, ifName);
   const int32_t neighborKvStorePubPort = event.neighbor.kvStorePubPort;
   const int32_t neighborKvStoreCmdPort = event.neighbor.kvStoreCmdPort;
-  auto rttMetric = getRttMetric(event.rttUs);
+  auto rttMetric = rttMetric_.getMetric(event.rttUs);
   auto now = std::chrono::system_clock::now();
   // current unixtime in s
   int64_t timestamp =
@@ -579,8 +665,10 @@ LinkMonitor::neighborUpEvent(
       thrift::PeerSpec(FRAGILE, pubUrl, repUrl, event.supportFloodOptimization);
   adjacencies_[adjId] = AdjacencyValue(peerSpec, std::move(newAdj));
 
-  // Advertise KvStore peers immediately
-  advertiseKvStorePeers({{remoteNodeName, peerSpec}});
+  // Advertise KvStore peers right after all pending Spark events are
+  // processed, along with the other neighbors that came up with it
+  pendingUpPeers_[remoteNodeName] = peerSpec;
+  kvStorePeersChanged_ = true;
 
   // Advertise new adjancies in a throttled fashion
   advertiseAdjacenciesThrottled_->operator()();
@@ -603,10 +691,12 @@ LinkMonitor::neighborDownEvent(
 
   // remove such adjacencies
   adjacencies_.erase(adjId);
+  dampenAdjacencyFlap(adjId);
 
-  // advertise both peers and adjacencies
-  advertiseKvStorePeers();
-  advertiseAdjacencies();
+  // Remove KvStore peers right after all pending Spark events are
+  // processed, advertise adjacencies in a throttled fashion
+  kvStorePeersChanged_ = true;
+  advertiseAdjacenciesThrottled_->operator()();
 }
 
 void
@@ -627,7 +717,7 @@ LinkMonitor::neighborRestartingEvent(
   if (adjacencies_.count(adjId)) {
     adjacencies_.at(adjId).isRestarting = true;
   }
-  advertiseKvStorePeers();
+  kvStorePeersChanged_ = true;
 }
 
 std::unordered_map<std::string, thrift::PeerSpec>
@@ -661,8 +751,11 @@ LinkMonitor::getPeersFromAdjacencies(
 }
 
 void
-LinkMonitor::advertiseKvStorePeers(
-    const std::unordered_map<std::string, thrift::PeerSpec>& upPeers) {
+LinkMonitor::advertiseKvStorePeers() {
+  const auto upPeers = std::move(pendingUpPeers_);
+  pendingUpPeers_.clear();
+  kvStorePeersChanged_ = false;
+
   // Get old and new peer list. Also update local state
   const auto oldPeers = std::move(peers_);
   peers_ = getPeersFromAdjacencies(adjacencies_);
@@ -701,9 +794,11 @@ LinkMonitor::advertiseKvStorePeers(
   for (const auto& upPeer : upPeers) {
     const auto& name = upPeer.first;
     const auto& spec = upPeer.second;
-    // upPeer MUST already be in current state peers_
-    CHECK(peers_.count(name));
-
+    // upPeer may have gone down again, or be restarting, before peers are
+    // advertised
+    if (not peers_.count(name)) {
+      continue;
+    }
     if (toAddPeers.count(name)) {
       // already added, skip it
       continue;
@@ -736,6 +831,11 @@ LinkMonitor::advertiseAdjacencies() {
   adjDb.isOverloaded = config_.isOverloaded;
   adjDb.nodeLabel = config_.nodeLabel;
   for (const auto& adjKv : adjacencies_) {
+    // Skip flapping adjacencies until they are stable again
+    if (adjDampener_ and adjDampener_->isSuppressed(adjKv.first)) {
+      continue;
+    }
+
     // 'second.second' is the adj object for this peer
     // NOTE: copy on purpose
     auto adj = adjKv.second.adjacency;
@@ -757,21 +857,31 @@ LinkMonitor::advertiseAdjacencies() {
     adjDb.adjacencies.emplace_back(std::move(adj));
   }
 
-  // Add perf information if enabled
-  if (enablePerfMeasurement_) {
-    thrift::PerfEvents perfEvents;
-    addPerfEvent(perfEvents, nodeId_, "ADJ_DB_UPDATED");
-    adjDb.perfEvents = perfEvents;
+  // Skip re-flooding adjacency database if nothing changed since it was last
+  // advertised, e.g. metric override on link without adjacency or flap
+  // undone within throttle timeout
+  if (advertisedAdjDb_.hasValue() and *advertisedAdjDb_ == adjDb) {
+    VLOG(2) << "Skip updating unchanged adjacency database in KvStore.";
+    tData_.addStatValue(
+        "link_monitor.advertise_adjacencies_skipped", 1, fbzmq::SUM);
   } else {
-    DCHECK(!adjDb.perfEvents.hasValue());
-  }
+    advertisedAdjDb_ = adjDb;
+    // Add perf information if enabled
+    if (enablePerfMeasurement_) {
+      thrift::PerfEvents perfEvents;
+      addPerfEvent(perfEvents, nodeId_, "ADJ_DB_UPDATED");
+      adjDb.perfEvents = perfEvents;
+    } else {
+      DCHECK(!adjDb.perfEvents.hasValue());
+    }
 
-  LOG(INFO) << "Updating adjacency database in KvStore with "
-            << adjDb.adjacencies.size() << " entries.";
-  const auto keyName = adjacencyDbMarker_ + nodeId_;
-  std::string adjDbStr = fbzmq::util::writeThriftObjStr(adjDb, serializer_);
-  kvStoreClient_->persistKey(keyName, adjDbStr, ttlKeyInKvStore_);
-  tData_.addStatValue("link_monitor.advertise_adjacencies", 1, fbzmq::SUM);
+    LOG(INFO) << "Updating adjacency database in KvStore with "
+              << adjDb.adjacencies.size() << " entries.";
+    const auto keyName = adjacencyDbMarker_ + nodeId_;
+    std::string adjDbStr = fbzmq::util::writeThriftObjStr(adjDb, serializer_);
+    kvStoreClient_->persistKey(keyName, adjDbStr, ttlKeyInKvStore_);
+    tData_.addStatValue("link_monitor.advertise_adjacencies", 1, fbzmq::SUM);
+  }
 
   // Config is most likely to have changed. Update it in `ConfigStore`
   configStoreClient_->storeThriftObj(kConfigKey, config_);
@@ -847,14 +957,14 @@ LinkMonitor::advertiseInterfaces() {
 }
 
 void
-LinkMonitor::advertiseRedistAddrs() {
+LinkMonitor::advertiseRedistAddrs(bool fullSync) {
   if (std::chrono::steady_clock::now() < adjHoldUntilTimePoint_) {
     // Too early for advertising my own prefixes. Let timeout advertise it
     // and skip here.
     return;
   }
 
-  std::vector<thrift::PrefixEntry> prefixes;
+  std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry> prefixes;
 
   // Add static prefixes
   for (auto const& prefix : staticPrefixes_) {
@@ -869,7 +979,7 @@ LinkMonitor::advertiseRedistAddrs() {
         ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
         : thrift::PrefixForwardingAlgorithm::SP_ECMP;
     prefixEntry.ephemeral = folly::none;
-    prefixes.push_back(prefixEntry);
+    prefixes[prefix] = std::move(prefixEntry);
   }
 
   // Add redistribute addresses
@@ -891,13 +1001,62 @@ LinkMonitor::advertiseRedistAddrs() {
       prefix.forwardingAlgorithm = forwardingAlgoKsp2Ed_
           ? thrift::PrefixForwardingAlgorithm::KSP2_ED_ECMP
           : thrift::PrefixForwardingAlgorithm::SP_ECMP;
-      prefixes.emplace_back(std::move(prefix));
+      auto key = prefix.prefix;
+      prefixes[std::move(key)] = std::move(prefix);
+    }
+  }
+
+  // Advertise only changed prefixes since last advertisement, unless a full
+  // sync is requested or there was none yet
+  if (not fullSync and advertisedRedistPrefixes_.hasValue()) {
+    std::vector<thrift::PrefixEntry> toAdvertise;
+    std::vector<thrift::PrefixEntry> toWithdraw;
+    for (auto const& kv : prefixes) {
+      auto it = advertisedRedistPrefixes_->find(kv.first);
+      if (it == advertisedRedistPrefixes_->end() or it->second != kv.second) {
+        toAdvertise.emplace_back(kv.second);
+      }
+    }
+    for (auto const& kv : *advertisedRedistPrefixes_) {
+      if (prefixes.count(kv.first) == 0) {
+        toWithdraw.emplace_back(kv.second);
+      }
+    }
+    if (toAdvertise.empty() and toWithdraw.empty()) {
+      return;
+    }
+
+    tData_.addStatValue(
+        "link_monitor.redist_prefixes_advertised",
+        toAdvertise.size(),
+        fbzmq::SUM);
+    tData_.addStatValue(
+        "link_monitor.redist_prefixes_withdrawn",
+        toWithdraw.size(),
+        fbzmq::SUM);
+    const bool hasWithdrawals = not toWithdraw.empty();
+    const auto ret =
+        prefixManagerClient_->updatePrefixes(toAdvertise, toWithdraw);
+    // Update is applied all or nothing, it fails on withdrawal of prefixes
+    // PrefixManager doesn't know of. Fall back to full sync then
+    if (ret.hasValue() and (ret->success or not hasWithdrawals)) {
+      advertisedRedistPrefixes_ = std::move(prefixes);
+      return;
     }
+    LOG(WARNING) << "Incremental update of redistributed prefixes failed, "
+                 << "falling back to full sync";
   }
 
   // Advertise via prefix manager client
+  tData_.addStatValue("link_monitor.redist_prefixes_full_sync", 1, fbzmq::SUM);
+  std::vector<thrift::PrefixEntry> prefixEntries;
+  prefixEntries.reserve(prefixes.size());
+  for (auto const& kv : prefixes) {
+    prefixEntries.emplace_back(kv.second);
+  }
   prefixManagerClient_->syncPrefixesByType(
-      thrift::PrefixType::LOOPBACK, prefixes);
+      thrift::PrefixType::LOOPBACK, prefixEntries);
+  advertisedRedistPrefixes_ = std::move(prefixes);
 }
 
 std::chrono::milliseconds
@@ -922,6 +1081,91 @@ LinkMonitor::getRetryTimeOnUnstableInterfaces() {
   return hasUnstableInterface ? minRemainMs : std::chrono::milliseconds(0);
 }
 
+void
+LinkMonitor::dampenAdjacencyFlap(const AdjacencyKey& adjId) {
+  if (not adjDampener_) {
+    return;
+  }
+  if (adjDampener_->flap(adjId)) {
+    LOG(WARNING) << "Suppressing flapping adjacency to " << adjId.first
+                 << " on " << adjId.second;
+    tData_.addStatValue("link_monitor.adjacency_suppressed", 1, fbzmq::SUM);
+  }
+  scheduleAdjDampenerTimeout();
+}
+
+void
+LinkMonitor::scheduleAdjDampenerTimeout() {
+  if (adjDampenerTimer_->isScheduled()) {
+    adjDampenerTimer_->cancelTimeout();
+  }
+  const auto nextUpdateTime = adjDampener_->getNextUpdateTime();
+  if (not nextUpdateTime.hasValue()) {
+    return;
+  }
+  adjDampenerTimer_->scheduleTimeout(
+      std::max(
+          std::chrono::milliseconds(0),
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              nextUpdateTime.value() - std::chrono::steady_clock::now())));
+}
+
+void
+LinkMonitor::checkPlatformEventSeqNum(
+    thrift::PlatformEventType eventType, int64_t seqNum) {
+  auto it = lastPlatformEventSeqNums_.find(eventType);
+  if (it == lastPlatformEventSeqNums_.end()) {
+    // First event sets the baseline, missed ones are covered by initial sync
+    lastPlatformEventSeqNums_.emplace(eventType, seqNum);
+    return;
+  }
+  const auto lastSeqNum = it->second;
+  it->second = seqNum;
+  if (seqNum == lastSeqNum + 1) {
+    return;
+  }
+
+  if (seqNum > lastSeqNum) {
+    const auto numMissed = seqNum - lastSeqNum - 1;
+    LOG(WARNING) << "Missed " << numMissed << " platform events before event "
+                 << seqNum;
+    tData_.addStatValue(
+        "link_monitor.platform_event_missed", numMissed, fbzmq::SUM);
+  } else {
+    // Publisher restarted, we can't tell what we missed
+    LOG(WARNING) << "Platform event sequence number went back from "
+                 << lastSeqNum << " to " << seqNum;
+  }
+  tData_.addStatValue("link_monitor.platform_event_gap", 1, fbzmq::SUM);
+
+  if (eventDrivenInterfaceSync_ and not interfaceDbSyncTimer_->isScheduled()) {
+    interfaceDbSyncTimer_->scheduleTimeout(Constants::kLinkImmediateTimeout);
+  }
+}
+
+void
+LinkMonitor::processLinkEvent(const thrift::LinkEntry& linkEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(linkEvt.ifName);
+  if (interfaceEntry) {
+    const bool wasUp = interfaceEntry->isUp();
+    interfaceEntry->updateAttrs(linkEvt.ifIndex, linkEvt.isUp, linkEvt.weight);
+    logLinkEvent(
+        interfaceEntry->getIfName(),
+        wasUp,
+        interfaceEntry->isUp(),
+        interfaceEntry->getBackoffDuration());
+  }
+}
+
+void
+LinkMonitor::processAddrEvent(const thrift::AddrEntry& addrEvt) {
+  auto interfaceEntry = getOrCreateInterfaceEntry(addrEvt.ifName);
+  if (interfaceEntry) {
+    interfaceEntry->updateAddr(
+        toIPNetwork(addrEvt.ipPrefix, false /* no masking */), addrEvt.isValid);
+  }
+}
+
 InterfaceEntry* FOLLY_NULLABLE
 LinkMonitor::getOrCreateInterfaceEntry(const std::string& ifName) {
   // Return null if ifName doesn't quality regex match criteria
@@ -1054,8 +1298,12 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
   }
 
   // NOTE: add commands which set/unset overload bit or metric values will
-  // immediately advertise new adjacencies into the KvStore.
+  // advertise new adjacencies into the KvStore in a throttled fashion, along
+  // with other pending changes.
   const auto& req = maybeReq.value();
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::LinkMonitorCommand>::findName(
+          req.cmd));
   switch (req.cmd) {
   case thrift::LinkMonitorCommand::SET_OVERLOAD:
     if (config_.isOverloaded) {
@@ -1064,7 +1312,7 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
     }
     LOG(INFO) << "Setting overload bit for node.";
     config_.isOverloaded = true;
-    advertiseAdjacencies(); // TODO: Use throttle here
+    advertiseAdjacenciesThrottled_->operator()();
     break;
 
   case thrift::LinkMonitorCommand::UNSET_OVERLOAD:
@@ -1074,7 +1322,7 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
     }
     LOG(INFO) << "Unsetting overload bit for node.";
     config_.isOverloaded = false;
-    advertiseAdjacencies(); // TODO: Use throttle here
+    advertiseAdjacenciesThrottled_->operator()();
     break;
 
   case thrift::LinkMonitorCommand::SET_LINK_OVERLOAD:
@@ -1090,13 +1338,13 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
     }
     LOG(INFO) << "Setting overload bit for interface " << req.interfaceName;
     config_.overloadedLinks.insert(req.interfaceName);
-    advertiseAdjacencies(); // TODO: Use throttle here
+    advertiseAdjacenciesThrottled_->operator()();
     break;
 
   case thrift::LinkMonitorCommand::UNSET_LINK_OVERLOAD:
     if (config_.overloadedLinks.erase(req.interfaceName)) {
       LOG(INFO) << "Unsetting overload bit for interface " << req.interfaceName;
-      advertiseAdjacencies(); // TODO: Use throttle here
+      advertiseAdjacenciesThrottled_->operator()();
     } else {
       LOG(WARNING) << "Got unset-overload-bit request for unknown link "
                    << req.interfaceName;
@@ -1123,14 +1371,14 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
     LOG(INFO) << "Overriding metric for interface " << req.interfaceName
               << " to " << req.overrideMetric;
     config_.linkMetricOverrides[req.interfaceName] = req.overrideMetric;
-    advertiseAdjacencies(); // TODO: Use throttle here
+    advertiseAdjacenciesThrottled_->operator()();
     break;
 
   case thrift::LinkMonitorCommand::UNSET_LINK_METRIC:
     if (config_.linkMetricOverrides.erase(req.interfaceName)) {
       LOG(INFO) << "Removing metric override for interface "
                 << req.interfaceName;
-      advertiseAdjacencies(); // TODO: Use throttle here
+      advertiseAdjacenciesThrottled_->operator()();
     } else {
       LOG(WARNING) << "Got link-metric-unset request for unknown interface "
                    << req.interfaceName;
@@ -1175,7 +1423,7 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
       reply.interfaceDetails.emplace(ifName, std::move(ifDetails));
     }
 
-    return fbzmq::Message::fromThriftObj(reply, serializer_);
+    return toReplyMsg(reply, serializer_);
   }
 
   case thrift::LinkMonitorCommand::SET_ADJ_METRIC: {
@@ -1205,7 +1453,7 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
       LOG(INFO) << "Overriding metric for adjacency " << req.adjNodeName.value()
                 << " " << req.interfaceName << " to " << req.overrideMetric;
       config_.adjMetricOverrides[adjKey] = req.overrideMetric;
-      advertiseAdjacencies(); // TODO: Use throttle here
+      advertiseAdjacenciesThrottled_->operator()();
 
     } else {
       LOG(WARNING) << "SET_ADJ_METRIC - adjacency is not yet formed for: "
@@ -1230,7 +1478,7 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
 
       if (adjacencies_.count(
               std::make_pair(req.adjNodeName.value(), req.interfaceName))) {
-        advertiseAdjacencies(); // TODO: Use throttle here
+        advertiseAdjacenciesThrottled_->operator()();
       }
     } else {
       LOG(WARNING) << "Got adj-metric-unset request for unknown adjacency"
@@ -1245,12 +1493,12 @@ LinkMonitor::processRequestMsg(fbzmq::Message&& request) {
         Constants::kOpenrVersion,
         Constants::kOpenrSupportedVersion);
 
-    return fbzmq::Message::fromThriftObj(openrVersion, serializer_);
+    return toReplyMsg(openrVersion, serializer_);
   }
 
   case thrift::LinkMonitorCommand::GET_BUILD_INFO: {
     auto buildInfo = getBuildInfoThrift();
-    return fbzmq::Message::fromThriftObj(buildInfo, serializer_);
+    return toReplyMsg(buildInfo, serializer_);
   }
 
   default:
@@ -1270,7 +1518,13 @@ LinkMonitor::submitCounters() {
 
   // Add some more flat counters
   counters["link_monitor.adjacencies"] = adjacencies_.size();
+  if (adjDampener_) {
+    counters["link_monitor.suppressed_adjacencies"] =
+        adjDampener_->getNumSuppressed();
+  }
   counters["link_monitor.zmq_event_queue_size"] = getEventQueueSize();
+  exportProfileCounters(counters);
+  exportEventLogs(*zmqMonitorClient_);
   for (const auto& kv : adjacencies_) {
     auto& adj = kv.second.adjacency;
     counters["link_monitor.metric." + adj.otherNodeName] = adj.metric;
@@ -1281,21 +1535,15 @@ LinkMonitor::submitCounters() {
 
 void
 LinkMonitor::logNeighborEvent(thrift::SparkNeighborEvent const& event) {
-  fbzmq::LogSample sample{};
-  sample.addString(
-      "event",
+  EventLogEntry entry(
       apache::thrift::TEnumTraits<thrift::SparkNeighborEventType>::findName(
-          event.eventType));
-  sample.addString("node_name", nodeId_);
-  sample.addString("neighbor", event.neighbor.nodeName);
-  sample.addString("interface", event.ifName);
-  sample.addString("remote_interface", event.neighbor.ifName);
-  sample.addInt("rtt_us", event.rttUs);
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+          event.eventType),
+      nodeId_);
+  entry.addString("neighbor", event.neighbor.nodeName)
+      .addString("interface", event.ifName)
+      .addString("remote_interface", event.neighbor.ifName)
+      .addInt("rtt_us", event.rttUs);
+  logEvent(std::move(entry));
 }
 
 void
@@ -1309,18 +1557,12 @@ LinkMonitor::logLinkEvent(
     return;
   }
 
-  fbzmq::LogSample sample{};
   const std::string event = isUp ? "UP" : "DOWN";
 
-  sample.addString("event", folly::sformat("IFACE_{}", event));
-  sample.addString("node_name", nodeId_);
-  sample.addString("interface", iface);
-  sample.addInt("backoff_ms", backoffTime.count());
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogEntry entry(folly::sformat("IFACE_{}", event), nodeId_);
+  entry.addString("interface", iface)
+      .addInt("backoff_ms", backoffTime.count());
+  logEvent(std::move(entry));
 
   syslog(
       LOG_NOTICE,
@@ -1338,18 +1580,11 @@ LinkMonitor::logPeerEvent(
     const std::string& event,
     const std::string& peerName,
     const thrift::PeerSpec& peerSpec) {
-  fbzmq::LogSample sample{};
-
-  sample.addString("event", event);
-  sample.addString("node_name", nodeId_);
-  sample.addString("peer_name", peerName);
-  sample.addString("pub_url", peerSpec.pubUrl);
-  sample.addString("cmd_url", peerSpec.cmdUrl);
-
-  zmqMonitorClient_->addEventLog(fbzmq::thrift::EventLog(
-      apache::thrift::FRAGILE,
-      Constants::kEventLogCategory.toString(),
-      {sample.toJson()}));
+  EventLogEntry entry(event, nodeId_);
+  entry.addString("peer_name", peerName)
+      .addString("pub_url", peerSpec.pubUrl)
+      .addString("cmd_url", peerSpec.cmdUrl);
+  logEvent(std::move(entry));
 }
 
 } // namespace openr
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include <boost/serialization/strong_typedef.hpp>
@@ -39,7 +41,9 @@
 #include <openr/if/gen-cpp2/Platform_types.h>
 #include <openr/if/gen-cpp2/SystemService.h>
 #include <openr/kvstore/KvStoreClient.h>
+#include <openr/link-monitor/AdjacencyDampener.h>
 #include <openr/link-monitor/InterfaceEntry.h>
+#include <openr/link-monitor/RttMetric.h>
 #include <openr/platform/PlatformPublisher.h>
 #include <openr/prefix-manager/PrefixManagerClient.h>
 #include <openr/spark/Spark.h>
@@ -123,7 +127,15 @@ class LinkMonitor final : public OpenrEventLoop {
       std::chrono::milliseconds flapInitalBackoff,
       std::chrono::milliseconds flapMaxBackoff,
       // ttl for a key in the keyvalue store
-      std::chrono::milliseconds ttlKeyInKvStore);
+      std::chrono::milliseconds ttlKeyInKvStore,
+      // sync interfaces with platform only on start and on gaps of platform
+      // event sequence numbers, instead of periodically
+      bool eventDrivenInterfaceSync = false,
+      // dampen flapping adjacencies, not advertising them while suppressed
+      folly::Optional<AdjacencyDampeningConfig> adjDampeningConfig =
+          folly::none,
+      // quantization and hysteresis of rtt based metrics
+      RttMetricConfig const& rttMetricConfig = RttMetricConfig());
 
   ~LinkMonitor() override = default;
 
@@ -171,22 +183,34 @@ class LinkMonitor final : public OpenrEventLoop {
   // derive current peer-spec info from current adjacencies_
   // calculate delta and announce them to KvStore (peer add/remove) if any
   //
-  // upPeers: a set of peers we just detected them UP.
+  // pendingUpPeers_: a set of peers we just detected them UP, consumed here.
   // this covers the case where peer restarted, but we didn't detect restarting
   // spark packet (e.g peer non-graceful-shutdown or all spark messages lost)
   // in this case, the above delta will miss these peers, advertise them
   // if peer-spec matches
-  void advertiseKvStorePeers(
-      const std::unordered_map<std::string, thrift::PeerSpec>& upPeers = {});
+  void advertiseKvStorePeers();
 
-  // Advertise my adjacencies_ to the KvStore
+  // Receive and process one report of neighbor events from Spark. Returns
+  // false if there was none to receive
+  bool processSparkReport();
+
+  // Apply neighbor event to adjacencies. KvStore peers are advertised by
+  // caller once all events at hand are applied
+  void processNeighborEvent(const thrift::SparkNeighborEvent& event);
+
+  // Advertise my adjacencies_ to the KvStore. All changes to adjacencies,
+  // overload bits and metric overrides go through
+  // advertiseAdjacenciesThrottled_, so that bursts of them (e.g. flaps of many
+  // links) are flooded as one update
   void advertiseAdjacencies();
 
   // Advertise interfaces and addresses to Spark/Fib and PrefixManager
   // respectively
   void advertiseIfaceAddr();
   void advertiseInterfaces();
-  void advertiseRedistAddrs();
+  // Redistributed addresses are advertised as changes since the last
+  // advertisement, or all of them on fullSync
+  void advertiseRedistAddrs(bool fullSync = false);
 
   // get next try time, which should be the minimum remaining time among
   // all unstable (getTimeRemainingUntilRetry() > 0) interfaces.
@@ -198,6 +222,19 @@ class LinkMonitor final : public OpenrEventLoop {
   InterfaceEntry* FOLLY_NULLABLE
   getOrCreateInterfaceEntry(const std::string& ifName);
 
+  // Apply link/address events from PlatformPublisher to interface entries
+  void processLinkEvent(const thrift::LinkEntry& linkEvt);
+
+  // Record adjacency flap with dampener and (re)schedule its timer
+  void dampenAdjacencyFlap(const AdjacencyKey& adjId);
+  void scheduleAdjDampenerTimeout();
+
+  // Detect lost or out of order platform events by their sequence number, and
+  // resync interfaces right away in event driven mode
+  void checkPlatformEventSeqNum(
+      thrift::PlatformEventType eventType, int64_t seqNum);
+  void processAddrEvent(const thrift::AddrEntry& addrEvt);
+
   // Utility function to create thrift client connection to NetlinkSystemHandler
   // Can throw exception if it fails to open transport to client on
   // specified port.
@@ -246,6 +283,8 @@ class LinkMonitor final : public OpenrEventLoop {
   const std::vector<thrift::IpPrefix> staticPrefixes_;
   // Use spark measured RTT to neighbor as link metric
   const bool useRttMetric_{true};
+  // Conversion of RTT to link metric
+  const RttMetric rttMetric_;
   // enable performance measurement
   const bool enablePerfMeasurement_{false};
   // is v4 enabled in OpenR or not
@@ -272,6 +311,8 @@ class LinkMonitor final : public OpenrEventLoop {
   const std::chrono::milliseconds flapMaxBackoff_;
   // ttl for kvstore
   const std::chrono::milliseconds ttlKeyInKvStore_;
+  // resync interfaces only on gaps of platform events
+  const bool eventDrivenInterfaceSync_{false};
   // Timepoint used to hold off advertisement of link adjancecy on restart.
   const std::chrono::steady_clock::time_point adjHoldUntilTimePoint_;
   // The IO primitives provider; this is used for mocking
@@ -308,6 +349,21 @@ class LinkMonitor final : public OpenrEventLoop {
   // (we use the "min" interface) for tcp connection
   std::unordered_map<AdjacencyKey, AdjacencyValue> adjacencies_;
 
+  // Last adjacency database advertised to KvStore, without perf events
+  folly::Optional<thrift::AdjacencyDatabase> advertisedAdjDb_;
+
+  // Peers of neighbors which came up since KvStore peers were last advertised
+  std::unordered_map<std::string, thrift::PeerSpec> pendingUpPeers_;
+
+  // Whether neighbor events changed KvStore peers since they were last
+  // advertised
+  bool kvStorePeersChanged_{false};
+
+  // Redistributed addresses last advertised to PrefixManager, none until
+  // first full sync
+  folly::Optional<std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry>>
+      advertisedRedistPrefixes_;
+
   // Previously announced KvStore peers
   std::unordered_map<std::string, thrift::PeerSpec> peers_;
 
@@ -328,6 +384,18 @@ class LinkMonitor final : public OpenrEventLoop {
 
   // Timer for resyncing InterfaceDb from netlink
   std::unique_ptr<fbzmq::ZmqTimeout> interfaceDbSyncTimer_;
+
+  // Timer for periodic full sync of redistributed addresses to PrefixManager
+  std::unique_ptr<fbzmq::ZmqTimeout> redistAddrsSyncTimer_;
+
+  // Dampener of flapping adjacencies, if enabled. Suppressed adjacencies are
+  // kept in adjacencies_ and peered with, but not advertised
+  std::unique_ptr<AdjacencyDampener> adjDampener_;
+  // fires when suppressed adjacencies may be reused
+  std::unique_ptr<fbzmq::ZmqTimeout> adjDampenerTimer_;
+
+  // Sequence number of last received platform event of each type
+  std::map<thrift::PlatformEventType, int64_t> lastPlatformEventSeqNums_;
   ExponentialBackoff<std::chrono::milliseconds> expBackoff_;
 
   // DS to hold local stats/counters
@@ -0,0 +1,53 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RttMetric.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <glog/logging.h>
+
+namespace {
+
+// measured rtt per unit of metric
+const int64_t kRttUsPerMetric{100};
+
+} // namespace
+
+namespace openr {
+
+RttMetric::RttMetric(RttMetricConfig const& config) : config_(config) {
+  CHECK_GT(config_.bucketSize, 0);
+  CHECK_GE(config_.hysteresisPct, 0);
+}
+
+int32_t
+RttMetric::getMetric(int64_t rttUs) const {
+  const int64_t bucketSize = config_.bucketSize;
+  const int64_t rawMetric = std::max(rttUs / kRttUsPerMetric, int64_t{0});
+  const int64_t metric = (rawMetric + bucketSize / 2) / bucketSize * bucketSize;
+  return static_cast<int32_t>(std::max(metric, int64_t{1}));
+}
+
+folly::Optional<int32_t>
+RttMetric::getChangedMetric(int32_t metric, int64_t rttUs) const {
+  const auto newMetric = getMetric(rttUs);
+  if (newMetric == metric) {
+    return folly::none;
+  }
+  // compare unquantized metric so that rtt oscillating around a bucket
+  // boundary does not flip metric
+  const int64_t rawMetric = rttUs / kRttUsPerMetric;
+  if (std::abs(rawMetric - metric) * 100 <=
+      static_cast<int64_t>(metric) * config_.hysteresisPct) {
+    return folly::none;
+  }
+  return newMetric;
+}
+
+} // namespace openr
@@ -0,0 +1,46 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <folly/Optional.h>
+
+namespace openr {
+
+struct RttMetricConfig {
+  // metrics are rounded to multiples of it. Metric unit is 100us of RTT
+  int32_t bucketSize{1};
+  // metric of adjacency is only changed if measured one differs from it by
+  // more than this percentage of it
+  int32_t hysteresisPct{0};
+};
+
+/**
+ * Conversion of Spark measured RTT of adjacencies to link metrics. Every
+ * metric change of an adjacency triggers SPF on all nodes, so metrics are
+ * quantized, and changes within hysteresis of current metric are ignored to
+ * not turn small RTT variations into network wide route computations.
+ */
+class RttMetric final {
+ public:
+  explicit RttMetric(RttMetricConfig const& config);
+
+  // Metric of rtt, rounded to bucket size. Metric can never be zero.
+  int32_t getMetric(int64_t rttUs) const;
+
+  // New metric for adjacency with given metric on rtt change, none if metric
+  // is unchanged after quantization or rtt is within hysteresis
+  folly::Optional<int32_t> getChangedMetric(
+      int32_t metric, int64_t rttUs) const;
+
+ private:
+  const RttMetricConfig config_;
+};
+
+} // namespace openr
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/AdjacencyDampener.h>
+
+using namespace openr;
+
+namespace {
+
+const AdjacencyDampener::Key adj1{"node-1", "iface_1"};
+const AdjacencyDampener::Key adj2{"node-2", "iface_2"};
+
+AdjacencyDampeningConfig
+getConfig() {
+  AdjacencyDampeningConfig config;
+  config.penalty = 1000;
+  config.suppressLimit = 2000;
+  config.reuseLimit = 750;
+  config.halfLife = std::chrono::seconds(10);
+  config.maxSuppressTime = std::chrono::seconds(30);
+  return config;
+}
+
+} // namespace
+
+TEST(AdjacencyDampenerTest, SuppressAndReuse) {
+  AdjacencyDampener dampener(getConfig());
+  const auto start = std::chrono::steady_clock::now();
+
+  // Below suppress limit
+  EXPECT_FALSE(dampener.flap(adj1, start));
+  EXPECT_FALSE(dampener.isSuppressed(adj1));
+  EXPECT_DOUBLE_EQ(1000, dampener.getPenalty(adj1, start));
+
+  // Penalty decays by half every half-life
+  const auto t1 = start + std::chrono::seconds(10);
+  EXPECT_DOUBLE_EQ(500, dampener.getPenalty(adj1, t1));
+
+  // Two more flaps within a half-life reach suppress limit, only once
+  EXPECT_FALSE(dampener.flap(adj1, t1));
+  EXPECT_TRUE(dampener.flap(adj1, t1));
+  EXPECT_FALSE(dampener.flap(adj1, t1));
+  EXPECT_TRUE(dampener.isSuppressed(adj1));
+  EXPECT_FALSE(dampener.isSuppressed(adj2));
+  EXPECT_EQ(1, dampener.getNumSuppressed());
+
+  EXPECT_DOUBLE_EQ(3500, dampener.getPenalty(adj1, t1));
+
+  // Reused once decayed to reuse limit, i.e. log2(3500 / 750) half-lives
+  auto nextUpdateTime = dampener.getNextUpdateTime();
+  ASSERT_TRUE(nextUpdateTime.hasValue());
+  EXPECT_LT(t1 + std::chrono::milliseconds(22223), *nextUpdateTime);
+  EXPECT_GT(t1 + std::chrono::milliseconds(22230), *nextUpdateTime);
+  EXPECT_TRUE(dampener.update(*nextUpdateTime - std::chrono::seconds(1))
+                  .empty());
+  EXPECT_EQ(
+      std::vector<AdjacencyDampener::Key>({adj1}),
+      dampener.update(*nextUpdateTime));
+  EXPECT_FALSE(dampener.isSuppressed(adj1));
+  EXPECT_EQ(0, dampener.getNumSuppressed());
+
+  // History is forgotten once penalty decays to half of reuse limit
+  nextUpdateTime = dampener.getNextUpdateTime();
+  ASSERT_TRUE(nextUpdateTime.hasValue());
+  EXPECT_TRUE(dampener.update(*nextUpdateTime).empty());
+  EXPECT_EQ(0, dampener.getPenalty(adj1, *nextUpdateTime));
+  EXPECT_FALSE(dampener.getNextUpdateTime().hasValue());
+}
+
+TEST(AdjacencyDampenerTest, MaxSuppressTime) {
+  AdjacencyDampener dampener(getConfig());
+  const auto start = std::chrono::steady_clock::now();
+
+  // Adjacency keeps flapping, penalty is capped at
+  // reuseLimit * 2^(maxSuppressTime / halfLife) so that it is never suppressed
+  // longer than maxSuppressTime after last flap
+  for (int i = 0; i < 100; ++i) {
+    dampener.flap(adj1, start);
+  }
+  EXPECT_TRUE(dampener.isSuppressed(adj1));
+  auto nextUpdateTime = dampener.getNextUpdateTime();
+  ASSERT_TRUE(nextUpdateTime.hasValue());
+  EXPECT_GE(start + std::chrono::milliseconds(30002), *nextUpdateTime);
+  EXPECT_EQ(1, dampener.update(*nextUpdateTime).size());
+}
+
+TEST(AdjacencyDampenerTest, InvalidConfig) {
+  auto config = getConfig();
+  config.reuseLimit = config.suppressLimit;
+  EXPECT_DEATH(AdjacencyDampener{config}, "");
+
+  // Suppress limit can't be reached
+  config = getConfig();
+  config.maxSuppressTime = std::chrono::seconds(5);
+  EXPECT_DEATH(AdjacencyDampener{config}, "");
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
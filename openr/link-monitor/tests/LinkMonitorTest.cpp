@@ -139,6 +139,11 @@ createNeighborEvent(
       FRAGILE, eventType, ifName, neighbor, rttUs, label, false);
 }
 
+thrift::SparkNeighborEvents
+createNeighborEvents(std::vector<thrift::SparkNeighborEvent> events) {
+  return thrift::SparkNeighborEvents(FRAGILE, std::move(events));
+}
+
 thrift::AdjacencyDatabase
 createAdjDatabase(
     const std::string& thisNodeName,
@@ -723,7 +728,9 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
     EXPECT_NO_THROW(sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value()));
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value()));
     LOG(INFO) << "Testing neighbor UP event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -854,7 +861,9 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
     LOG(INFO) << "Testing neighbor down event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -946,7 +955,9 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
     LOG(INFO) << "Testing neighbor up event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -962,7 +973,9 @@ TEST_F(LinkMonitorTestFixture, BasicOperation) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
     LOG(INFO) << "Testing neighbor down event!";
     checkNextAdjPub("adj:node-1");
   }
@@ -991,7 +1004,9 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   // before throttled function kicks in
@@ -1007,7 +1022,9 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   // neighbor 3 down immediately
@@ -1021,12 +1038,60 @@ TEST_F(LinkMonitorTestFixture, Throttle) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   checkNextAdjPub("adj:node-1");
 }
 
+// neighbor events reported together are applied at once
+TEST_F(LinkMonitorTestFixture, BatchedNeighborEvents) {
+  {
+    InSequence dummy;
+
+    {
+      auto adjDb = createAdjDatabase("node-1", {adj_2_1}, kNodeLabel);
+      expectedAdjDbs.push(std::move(adjDb));
+    }
+  }
+  std::string clientId = Constants::kSparkReportClientId.toString();
+
+  // neighbors up, one of them down again, in one report
+  const auto neighborEvents = createNeighborEvents({
+      createNeighborEvent(
+          thrift::SparkNeighborEventType::NEIGHBOR_UP,
+          "iface_2_1",
+          nb2,
+          100 /* rtt-us */,
+          1 /* label */),
+      createNeighborEvent(
+          thrift::SparkNeighborEventType::NEIGHBOR_UP,
+          "iface_3_1",
+          nb3,
+          100 /* rtt-us */,
+          1 /* label */),
+      createNeighborEvent(
+          thrift::SparkNeighborEventType::NEIGHBOR_DOWN,
+          "iface_3_1",
+          nb3,
+          100 /* rtt-us */,
+          1 /* label */),
+  });
+  sparkReport.sendMultiple(
+      fbzmq::Message::from(clientId).value(),
+      fbzmq::Message(),
+      fbzmq::Message::fromThriftObj(neighborEvents, serializer).value());
+
+  checkNextAdjPub("adj:node-1");
+  // wait for this peer change to propogate
+  /* sleep override */
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  checkPeerDump(adj_2_1.otherNodeName, peerSpec_2_1);
+  EXPECT_EQ(0, kvStoreWrapper->getPeers().count(nb3.nodeName));
+}
+
 // parallel adjacencies between two nodes via different interfaces
 TEST_F(LinkMonitorTestFixture, ParallelAdj) {
   std::string clientId = Constants::kSparkReportClientId.toString();
@@ -1065,7 +1130,9 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1085,7 +1152,9 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1105,7 +1174,9 @@ TEST_F(LinkMonitorTestFixture, ParallelAdj) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   checkNextAdjPub("adj:node-1");
@@ -1131,7 +1202,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   // wait for this peer change to propogate
@@ -1150,7 +1223,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   // wait for this peer change to propogate
@@ -1169,7 +1244,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1188,7 +1265,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
 
   // wait for this peer change to propogate
@@ -1207,7 +1286,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1225,7 +1306,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1243,7 +1326,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -1261,7 +1346,9 @@ TEST_F(LinkMonitorTestFixture, NeighborRestart) {
     sparkReport.sendMultiple(
         fbzmq::Message::from(clientId).value(),
         fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(neighborEvent, serializer).value());
+        fbzmq::Message::fromThriftObj(
+            createNeighborEvents({neighborEvent}), serializer)
+            .value());
   }
   // wait for this peer change to propogate
   /* sleep override */
@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <openr/link-monitor/RttMetric.h>
+
+using namespace openr;
+
+TEST(RttMetricTest, DefaultConfig) {
+  RttMetric rttMetric(RttMetricConfig{});
+
+  // metric is rtt in units of 100us, never zero
+  EXPECT_EQ(1, rttMetric.getMetric(0));
+  EXPECT_EQ(1, rttMetric.getMetric(99));
+  EXPECT_EQ(1, rttMetric.getMetric(150));
+  EXPECT_EQ(25, rttMetric.getMetric(2550));
+
+  // every change of metric is taken
+  EXPECT_FALSE(rttMetric.getChangedMetric(25, 2550).hasValue());
+  EXPECT_EQ(26, rttMetric.getChangedMetric(25, 2600).value());
+  EXPECT_EQ(24, rttMetric.getChangedMetric(25, 2400).value());
+}
+
+TEST(RttMetricTest, Quantization) {
+  RttMetric rttMetric(RttMetricConfig{10, 0});
+
+  // metrics are rounded to nearest multiple of 10
+  EXPECT_EQ(1, rttMetric.getMetric(400));
+  EXPECT_EQ(10, rttMetric.getMetric(500));
+  EXPECT_EQ(10, rttMetric.getMetric(1400));
+  EXPECT_EQ(20, rttMetric.getMetric(1500));
+  EXPECT_EQ(100, rttMetric.getMetric(10300));
+
+  EXPECT_FALSE(rttMetric.getChangedMetric(100, 10300).hasValue());
+  EXPECT_FALSE(rttMetric.getChangedMetric(100, 9600).hasValue());
+  EXPECT_EQ(90, rttMetric.getChangedMetric(100, 9400).value());
+}
+
+TEST(RttMetricTest, Hysteresis) {
+  RttMetric rttMetric(RttMetricConfig{10, 10});
+
+  // changes within 10% of metric 100 are ignored, even across bucket
+  // boundaries
+  EXPECT_FALSE(rttMetric.getChangedMetric(100, 10500).hasValue());
+  EXPECT_FALSE(rttMetric.getChangedMetric(100, 11000).hasValue());
+  EXPECT_FALSE(rttMetric.getChangedMetric(100, 9000).hasValue());
+  EXPECT_EQ(110, rttMetric.getChangedMetric(100, 11100).value());
+  EXPECT_EQ(90, rttMetric.getChangedMetric(100, 8900).value());
+
+  // and metric follows bigger changes
+  EXPECT_EQ(500, rttMetric.getChangedMetric(100, 50000).value());
+}
+
+TEST(RttMetricTest, InvalidConfig) {
+  EXPECT_DEATH(RttMetric{RttMetricConfig{0, 0}}, "");
+  EXPECT_DEATH(RttMetric{RttMetricConfig{1, -1}}, "");
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
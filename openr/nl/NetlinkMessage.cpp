@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <thread>
 #include <vector>
 
@@ -20,12 +21,10 @@ namespace Netlink {
 uint32_t gSequenceNumber{0};
 
 NetlinkMessage::NetlinkMessage()
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
-      promise_(std::make_unique<folly::Promise<int>>()) {}
+    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())) {}
 
 NetlinkMessage::NetlinkMessage(int type)
-    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())),
-      promise_(std::make_unique<folly::Promise<int>>()) {
+    : msghdr(reinterpret_cast<struct nlmsghdr*>(msg.data())) {
   // initialize netlink header
   msghdr->nlmsg_len = NLMSG_LENGTH(0);
   msghdr->nlmsg_type = type;
@@ -103,12 +102,32 @@ NetlinkMessage::addAttributes(
 
 folly::Future<int>
 NetlinkMessage::getFuture() {
-  return promise_->getFuture();
+  return promise_.getFuture();
 }
 
 void
 NetlinkMessage::setReturnStatus(int status) {
-  promise_->setValue(status);
+  promise_.setValue(status);
+}
+
+void
+NetlinkMessage::reset() {
+  // only bytes used by previous message need clearing
+  const auto used =
+      std::min<size_t>(NLMSG_ALIGN(msghdr->nlmsg_len), msg.size());
+  std::fill(msg.begin(), msg.begin() + used, 0);
+  size_ = kMaxNlPayloadSize;
+  promise_ = folly::Promise<int>();
+}
+
+bool
+NetlinkMessage::isPooled() const {
+  return pooled_;
+}
+
+void
+NetlinkMessage::setPooled(bool pooled) {
+  pooled_ = pooled;
 }
 
 // get Message Type
@@ -142,11 +161,29 @@ NetlinkProtocolSocket::init() {
   }
   VLOG(1) << "Netlink socket created." << nlSock_;
   int size = kNetlinkSockRecvBuf;
-  // increase socket recv buffer size
-  if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
-    LOG(FATAL) << "Netlink socket set recv buffer failed.";
+  // increase socket recv buffer size. SO_RCVBUF is capped by rmem_max, use
+  // SO_RCVBUFFORCE if we have CAP_NET_ADMIN
+  if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) <
+      0) {
+    VLOG(1) << "Netlink socket force recv buffer failed: "
+            << folly::errnoStr(errno);
+    if (setsockopt(nlSock_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+      LOG(FATAL) << "Netlink socket set recv buffer failed.";
+    }
   };
 
+  // receive buffers are allocated once and reused for every receive
+  recvBuf_.resize(kNlRecvBatchSize * kNlRecvBufSize);
+  recvIov_.resize(kNlRecvBatchSize);
+  recvMsgs_.resize(kNlRecvBatchSize);
+  for (size_t i = 0; i < kNlRecvBatchSize; ++i) {
+    recvIov_[i].iov_base = recvBuf_.data() + i * kNlRecvBufSize;
+    recvIov_[i].iov_len = kNlRecvBufSize;
+    ::memset(&recvMsgs_[i], 0, sizeof(struct mmsghdr));
+    recvMsgs_[i].msg_hdr.msg_iov = &recvIov_[i];
+    recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+
   // set the source address
   ::memset(&saddr_, 0, sizeof(saddr_));
   saddr_.nl_family = AF_NETLINK;
@@ -190,6 +227,38 @@ NetlinkProtocolSocket::setNeighborEventCB(
   neighborEventCB_ = neighborEventCB;
 }
 
+void
+NetlinkProtocolSocket::setOverrunCB(std::function<void()> overrunCB) {
+  overrunCB_ = overrunCB;
+}
+
+std::unique_ptr<NetlinkRouteMessage>
+NetlinkProtocolSocket::getRouteMessage() {
+  {
+    std::lock_guard<std::mutex> lock(messagePoolMutex_);
+    if (!messagePool_.empty()) {
+      auto msg = std::move(messagePool_.back());
+      messagePool_.pop_back();
+      ++messageReuses_;
+      return msg;
+    }
+  }
+  ++messageAllocs_;
+  auto msg = std::make_unique<NetlinkRouteMessage>();
+  msg->setPooled(true);
+  return msg;
+}
+
+void
+NetlinkProtocolSocket::recycleRouteMessage(
+    std::unique_ptr<NetlinkRouteMessage> msg) {
+  msg->reset();
+  std::lock_guard<std::mutex> lock(messagePoolMutex_);
+  if (messagePool_.size() < kMaxPooledRouteMessages) {
+    messagePool_.emplace_back(std::move(msg));
+  }
+}
+
 void
 NetlinkProtocolSocket::processAck(uint32_t ack) {
   if (ack == lastSeqNo_) {
@@ -265,38 +334,61 @@ NetlinkProtocolSocket::sendNetlinkMessage() {
 
 void
 NetlinkProtocolSocket::setReturnStatusValue(uint32_t seq, int status) {
-  try {
-    auto request = nlSeqNoMap_.at(seq);
-    request->setReturnStatus(status);
-    // Remove mapping
-    nlSeqNoMap_.erase(seq);
-  } catch (const std::out_of_range& e) {
+  auto it = nlSeqNoMap_.find(seq);
+  if (it == nlSeqNoMap_.end()) {
     VLOG(2) << "No future associated with Seq#" << seq;
+    return;
+  }
+  auto request = std::move(it->second);
+  // Remove mapping
+  nlSeqNoMap_.erase(it);
+  request->setReturnStatus(status);
+  if (request->isPooled()) {
+    recycleRouteMessage(std::unique_ptr<NetlinkRouteMessage>(
+        static_cast<NetlinkRouteMessage*>(request.release())));
   }
 }
 
 void
-NetlinkProtocolSocket::processMessage(
-    const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead) {
+NetlinkProtocolSocket::processMessage(const char* rxMsg, uint32_t bytesRead) {
   // first netlink message header
-  struct nlmsghdr* nlh = (struct nlmsghdr*)rxMsg.data();
+  struct nlmsghdr* nlh = (struct nlmsghdr*)rxMsg;
   do {
     if (!NLMSG_OK(nlh, bytesRead)) {
       break;
     }
+    ++recvMessages_;
 
     VLOG(2) << "Received Netlink message of type " << nlh->nlmsg_type
             << " seq no " << nlh->nlmsg_seq;
     switch (nlh->nlmsg_type) {
     case RTM_NEWROUTE:
     case RTM_DELROUTE: {
-      // next RTM message to be processed
-      auto rtmMessage = std::make_unique<NetlinkRouteMessage>();
-      auto route = rtmMessage->parseMessage(nlh);
-      if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
-        // Synchronous event - do not generate route events
-        routeCache_.emplace_back(route);
+      // Route events are not generated, only parse responses to a request.
+      // Others, e.g. notifications of routes we programmed, are dropped
+      // without parsing
+      auto requestIt = nlSeqNoMap_.find(nlh->nlmsg_seq);
+      if (requestIt == nlSeqNoMap_.end()) {
+        ++suppressedRouteEvents_;
+        break;
+      }
+      // Dump may be for one protocol, kernel only filters on strict checking
+      const auto request = requestIt->second->getMessagePtr();
+      if (request->nlmsg_type == RTM_GETROUTE &&
+          nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct rtmsg))) {
+        const auto protocol =
+            reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(request))
+                ->rtm_protocol;
+        if (protocol != RTPROT_UNSPEC &&
+            reinterpret_cast<const struct rtmsg*>(NLMSG_DATA(nlh))
+                    ->rtm_protocol != protocol) {
+          break;
+        }
       }
+      // Synchronous event - do not generate route events. Parsed once dump
+      // is done
+      routeDumpMsgs_.emplace_back(
+          reinterpret_cast<const char*>(nlh), nlh->nlmsg_len);
     } break;
 
     case RTM_DELLINK:
@@ -326,7 +418,7 @@ NetlinkProtocolSocket::processMessage(
       }
       if (nlSeqNoMap_.count(nlh->nlmsg_seq) > 0) {
         // Response to a corresponding request
-        auto request = nlSeqNoMap_.at(nlh->nlmsg_seq);
+        auto& request = nlSeqNoMap_.at(nlh->nlmsg_seq);
         if (request->getMessageType() ==
             NetlinkMessage::MessageType::GET_ALL_ADDRS) {
           // Message in response to get addresses, store in address cache
@@ -402,21 +494,48 @@ NetlinkProtocolSocket::processMessage(
 
 void
 NetlinkProtocolSocket::recvNetlinkMessage() {
-  // messages buffer
-  std::array<char, kMaxNlPayloadSize> recvMsg = {};
-
-  int32_t bytesRead = ::recv(nlSock_, recvMsg.data(), kMaxNlPayloadSize, 0);
-  VLOG(4) << "Message received with size: " << bytesRead;
+  // drain the socket, kNlRecvBatchSize datagrams per syscall, without
+  // starving other events of the loop
+  for (size_t i = 0; i < kNlMaxRecvPerWakeup; ++i) {
+    int numMsgs = ::recvmmsg(
+        nlSock_, recvMsgs_.data(), recvMsgs_.size(), MSG_DONTWAIT, nullptr);
+
+    if (numMsgs < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      // Kernel dropped messages, socket is usable and may have more
+      if (errno == ENOBUFS) {
+        ++recvOverruns_;
+        LOG(WARNING) << "Netlink socket receive buffer overrun, events lost";
+        if (overrunCB_) {
+          overrunCB_();
+        }
+        continue;
+      }
+      LOG(INFO) << "Error in netlink socket receive: " << numMsgs
+                << " err: " << folly::errnoStr(std::abs(errno));
+      return;
+    }
+    ++recvSyscalls_;
+    recvDatagrams_ += numMsgs;
+
+    for (int j = 0; j < numMsgs; ++j) {
+      const auto& msg = recvMsgs_[j];
+      VLOG(4) << "Message received with size: " << msg.msg_len;
+      if (msg.msg_hdr.msg_flags & MSG_TRUNC) {
+        LOG(ERROR) << "Netlink message truncated to " << msg.msg_len
+                   << " bytes";
+        ++errors_;
+      }
+      processMessage(recvBuf_.data() + j * kNlRecvBufSize, msg.msg_len);
+    }
 
-  if (bytesRead < 0) {
-    if (errno == EINTR || errno == EAGAIN) {
+    // socket is drained
+    if (static_cast<size_t>(numMsgs) < recvMsgs_.size()) {
       return;
     }
-    LOG(INFO) << "Error in netlink socket receive: " << bytesRead
-              << " err: " << folly::errnoStr(std::abs(errno));
-    return;
   }
-  processMessage(recvMsg, static_cast<uint32_t>(bytesRead));
 }
 
 uint32_t
@@ -429,6 +548,41 @@ NetlinkProtocolSocket::getAckCount() const {
   return acks_;
 }
 
+uint64_t
+NetlinkProtocolSocket::getRecvSyscallCount() const {
+  return recvSyscalls_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getRecvDatagramCount() const {
+  return recvDatagrams_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getRecvMessageCount() const {
+  return recvMessages_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getRecvOverrunCount() const {
+  return recvOverruns_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getMessageAllocCount() const {
+  return messageAllocs_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getMessageReuseCount() const {
+  return messageReuses_;
+}
+
+uint64_t
+NetlinkProtocolSocket::getSuppressedRouteEventCount() const {
+  return suppressedRouteEvents_;
+}
+
 NetlinkProtocolSocket::~NetlinkProtocolSocket() {
   LOG(INFO) << "Closing netlink socket.";
   close(nlSock_);
@@ -492,7 +646,7 @@ NetlinkProtocolSocket::getReturnStatus(
 
 ResultCode
 NetlinkProtocolSocket::addRoute(const openr::fbnl::Route& route) {
-  auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+  auto rtmMsg = getRouteMessage();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(rtmMsg->getFuture());
   ResultCode status{ResultCode::SUCCESS};
@@ -512,7 +666,7 @@ NetlinkProtocolSocket::addRoutes(const std::vector<openr::fbnl::Route> routes) {
   std::vector<folly::Future<int>> futures;
 
   for (const auto& route : routes) {
-    auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+    auto rtmMsg = getRouteMessage();
     ResultCode status{ResultCode::SUCCESS};
     if (route.getFamily() == AF_MPLS) {
       status = rtmMsg->addLabelRoute(route);
@@ -535,7 +689,7 @@ NetlinkProtocolSocket::addRoutes(const std::vector<openr::fbnl::Route> routes) {
 
 ResultCode
 NetlinkProtocolSocket::deleteRoute(const openr::fbnl::Route& route) {
-  auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+  auto rtmMsg = getRouteMessage();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(rtmMsg->getFuture());
   ResultCode status{ResultCode::SUCCESS};
@@ -553,7 +707,7 @@ NetlinkProtocolSocket::deleteRoute(const openr::fbnl::Route& route) {
 
 ResultCode
 NetlinkProtocolSocket::addLabelRoute(const openr::fbnl::Route& route) {
-  auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+  auto rtmMsg = getRouteMessage();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(rtmMsg->getFuture());
   ResultCode status{ResultCode::SUCCESS};
@@ -569,7 +723,7 @@ NetlinkProtocolSocket::addLabelRoute(const openr::fbnl::Route& route) {
 
 ResultCode
 NetlinkProtocolSocket::deleteLabelRoute(const openr::fbnl::Route& route) {
-  auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+  auto rtmMsg = getRouteMessage();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(rtmMsg->getFuture());
   ResultCode status{ResultCode::SUCCESS};
@@ -592,7 +746,7 @@ NetlinkProtocolSocket::deleteRoutes(
   std::vector<folly::Future<int>> futures;
 
   for (const auto& route : routes) {
-    auto rtmMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
+    auto rtmMsg = getRouteMessage();
     ResultCode status{ResultCode::SUCCESS};
     if (route.getFamily() == AF_MPLS) {
       status = rtmMsg->deleteLabelRoute(route);
@@ -616,6 +770,62 @@ NetlinkProtocolSocket::deleteRoutes(
       kNlRequestTimeout);
 }
 
+std::vector<folly::Future<int>>
+NetlinkProtocolSocket::addRoutesAsync(
+    const std::vector<openr::fbnl::Route>& routes) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  std::vector<folly::Future<int>> futures;
+
+  for (const auto& route : routes) {
+    auto rtmMsg = getRouteMessage();
+    ResultCode status{ResultCode::SUCCESS};
+    if (route.getFamily() == AF_MPLS) {
+      status = rtmMsg->addLabelRoute(route);
+    } else {
+      status = rtmMsg->addRoute(route);
+    }
+    if (status == ResultCode::SUCCESS) {
+      futures.emplace_back(rtmMsg->getFuture());
+      msg.emplace_back(std::move(rtmMsg));
+    } else {
+      LOG(ERROR) << "Error adding route " << route.str();
+      futures.emplace_back(folly::makeFuture<int>(-EBADMSG));
+    }
+  }
+  if (msg.size()) {
+    addNetlinkMessage(std::move(msg));
+  }
+  return futures;
+}
+
+std::vector<folly::Future<int>>
+NetlinkProtocolSocket::deleteRoutesAsync(
+    const std::vector<openr::fbnl::Route>& routes) {
+  std::vector<std::unique_ptr<NetlinkMessage>> msg;
+  std::vector<folly::Future<int>> futures;
+
+  for (const auto& route : routes) {
+    auto rtmMsg = getRouteMessage();
+    ResultCode status{ResultCode::SUCCESS};
+    if (route.getFamily() == AF_MPLS) {
+      status = rtmMsg->deleteLabelRoute(route);
+    } else {
+      status = rtmMsg->deleteRoute(route);
+    }
+    if (status == ResultCode::SUCCESS) {
+      futures.emplace_back(rtmMsg->getFuture());
+      msg.emplace_back(std::move(rtmMsg));
+    } else {
+      LOG(ERROR) << "Error deleting route " << route.str();
+      futures.emplace_back(folly::makeFuture<int>(-EBADMSG));
+    }
+  }
+  if (msg.size()) {
+    addNetlinkMessage(std::move(msg));
+  }
+  return futures;
+}
+
 ResultCode
 NetlinkProtocolSocket::addIfAddress(const openr::fbnl::IfAddress& ifAddr) {
   auto addrMsg = std::make_unique<openr::Netlink::NetlinkAddrMessage>();
@@ -709,17 +919,58 @@ NetlinkProtocolSocket::getAllNeighbors() {
 }
 
 std::vector<fbnl::Route>
-NetlinkProtocolSocket::getAllRoutes() {
+NetlinkProtocolSocket::getAllRoutes(folly::Optional<uint8_t> protocolId) {
   routeCache_.clear();
+  routeDumpMsgs_.clear();
   auto routeMsg = std::make_unique<openr::Netlink::NetlinkRouteMessage>();
   std::vector<folly::Future<int>> futures;
   futures.emplace_back(routeMsg->getFuture());
   fbnl::RouteBuilder builder; // to create empty route
+  // RTPROT_UNSPEC dumps routes of all protocols
+  builder.setProtocolId(protocolId.value_or(RTPROT_UNSPEC));
   routeMsg->init(RTM_GETROUTE, 0, builder.build());
   std::vector<std::unique_ptr<NetlinkMessage>> msg;
   msg.emplace_back(std::move(routeMsg));
   addNetlinkMessage(std::move(msg));
   getReturnStatus(futures, std::unordered_set<int>{}, kNlRequestTimeout);
+
+  // Parse dumped messages, large dumps in parallel chunks, keeping order
+  const auto numMsgs = routeDumpMsgs_.size();
+  const auto numParsers = std::max<size_t>(
+      1,
+      std::min(
+          {kMaxRouteParsers,
+           numMsgs / kMinRoutesPerParser,
+           static_cast<size_t>(std::thread::hardware_concurrency())}));
+  const auto chunkSize = (numMsgs + numParsers - 1) / numParsers;
+  std::vector<std::vector<fbnl::Route>> parsed(numParsers);
+  auto parse = [this, &parsed, chunkSize, numMsgs](size_t i) {
+    NetlinkRouteMessage parser;
+    const auto end = std::min(numMsgs, (i + 1) * chunkSize);
+    for (size_t j = i * chunkSize; j < end; ++j) {
+      try {
+        parsed[i].emplace_back(parser.parseMessage(
+            reinterpret_cast<const struct nlmsghdr*>(
+                routeDumpMsgs_[j].data())));
+      } catch (std::exception const& ex) {
+        LOG(ERROR) << "Error parsing dumped route: " << folly::exceptionStr(ex);
+      }
+    }
+  };
+  std::vector<std::thread> parsers;
+  for (size_t i = 1; i < numParsers; ++i) {
+    parsers.emplace_back(parse, i);
+  }
+  parse(0);
+  for (auto& parser : parsers) {
+    parser.join();
+  }
+  routeDumpMsgs_.clear();
+
+  routeCache_.reserve(numMsgs);
+  for (auto& routes : parsed) {
+    std::move(routes.begin(), routes.end(), std::back_inserter(routeCache_));
+  }
   return std::move(routeCache_);
 }
 
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
 #include <queue>
+#include <vector>
 
 #include <limits.h>
 #include <linux/lwtunnel.h>
@@ -15,6 +18,7 @@
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
@@ -33,13 +37,31 @@ class NetlinkSocket;
 namespace openr {
 namespace Netlink {
 
+class NetlinkRouteMessage;
+
 constexpr uint16_t kMaxNlPayloadSize{4096};
-constexpr uint32_t kNetlinkSockRecvBuf{1 * 1024 * 1024};
+// receive buffer of netlink socket. Set past net.core.rmem_max if allowed, as
+// bursts of events overrun smaller buffers
+constexpr uint32_t kNetlinkSockRecvBuf{8 * 1024 * 1024};
+// size of each receive buffer. Kernel sizes dump datagrams after the largest
+// buffer seen, so larger buffers pack more messages of a dump in a datagram
+constexpr size_t kNlRecvBufSize{32 * 1024};
+// datagrams received with one recvmmsg() call
+constexpr size_t kNlRecvBatchSize{16};
+// recvmmsg() calls per event loop wakeup, before yielding to other events
+constexpr size_t kNlMaxRecvPerWakeup{64};
 
 constexpr uint32_t kMaxNlMessageQueue{126001};
 constexpr size_t kMaxIovMsg{500};
 constexpr std::chrono::milliseconds kNlMessageAckTimer{1000};
 constexpr std::chrono::milliseconds kNlRequestTimeout{30000};
+// max route requests outstanding at once when programming routes in batches
+constexpr size_t kMaxRouteBatchSize{10000};
+// max route messages kept for reuse, ~4KB each
+constexpr size_t kMaxPooledRouteMessages{4096};
+// dumped routes parsed by one thread, larger dumps are parsed in parallel
+constexpr size_t kMinRoutesPerParser{10000};
+constexpr size_t kMaxRouteParsers{8};
 
 enum class ResultCode {
   SUCCESS = 0,
@@ -78,6 +100,13 @@ class NetlinkMessage {
   // set status value (in promise)
   void setReturnStatus(int status);
 
+  // clear message and renew its promise, for reuse of the message
+  void reset();
+
+  // whether message is returned to message pool once acked
+  bool isPooled() const;
+  void setPooled(bool pooled);
+
   folly::Future<int> getFuture();
 
   /* Netlink MessageType denotes the type of request sent to the kernel, so that
@@ -133,7 +162,9 @@ class NetlinkMessage {
   uint32_t size_{kMaxNlPayloadSize};
 
   // Promise to relay the status code received from kernel
-  std::unique_ptr<folly::Promise<int>> promise_{nullptr};
+  folly::Promise<int> promise_;
+
+  bool pooled_{false};
 };
 
 class NetlinkProtocolSocket {
@@ -161,9 +192,11 @@ class NetlinkProtocolSocket {
   void setNeighborEventCB(
       std::function<void(fbnl::Neighbor, bool)> neighborEventCB);
 
-  // process message
-  void processMessage(
-      const std::array<char, kMaxNlPayloadSize>& rxMsg, uint32_t bytesRead);
+  // Set callback for receive buffer overruns, events may have been lost
+  void setOverrunCB(std::function<void()> overrunCB);
+
+  // process all netlink messages of a datagram
+  void processMessage(const char* rxMsg, uint32_t bytesRead);
 
   // synchronous add route and nexthop paths
   ResultCode addRoute(const openr::fbnl::Route& route);
@@ -183,6 +216,16 @@ class NetlinkProtocolSocket {
   // synchronous delete a list of given IP or label routes
   ResultCode deleteRoutes(const std::vector<openr::fbnl::Route> routes);
 
+  // queue add requests of given IP or label routes without waiting for their
+  // acks. Returned futures are fulfilled with the status of each route, in
+  // order, as acks are received
+  std::vector<folly::Future<int>> addRoutesAsync(
+      const std::vector<openr::fbnl::Route>& routes);
+
+  // queue delete requests of given IP or label routes, see addRoutesAsync()
+  std::vector<folly::Future<int>> deleteRoutesAsync(
+      const std::vector<openr::fbnl::Route>& routes);
+
   // synchronous add interface address
   ResultCode addIfAddress(const openr::fbnl::IfAddress& ifAddr);
 
@@ -204,6 +247,27 @@ class NetlinkProtocolSocket {
   // ack count
   uint32_t getAckCount() const;
 
+  // number of recvmmsg() calls which returned data
+  uint64_t getRecvSyscallCount() const;
+
+  // number of datagrams received
+  uint64_t getRecvDatagramCount() const;
+
+  // number of netlink messages received
+  uint64_t getRecvMessageCount() const;
+
+  // number of times kernel dropped messages as receive buffer was full
+  // (ENOBUFS)
+  uint64_t getRecvOverrunCount() const;
+
+  // number of route messages allocated, and reused from message pool
+  uint64_t getMessageAllocCount() const;
+  uint64_t getMessageReuseCount() const;
+
+  // number of route messages dropped without parsing, as they do not answer
+  // any request
+  uint64_t getSuppressedRouteEventCount() const;
+
   // get all link interfaces from kernel using Netlink
   std::vector<fbnl::Link> getAllLinks();
 
@@ -213,8 +277,10 @@ class NetlinkProtocolSocket {
   // get all neighbors from kernel using Netlink
   std::vector<fbnl::Neighbor> getAllNeighbors();
 
-  // get all routes from kernel using Netlink
-  std::vector<fbnl::Route> getAllRoutes();
+  // get all routes from kernel using Netlink, only of given protocol if set.
+  // Routes of other protocols are skipped without parsing
+  std::vector<fbnl::Route> getAllRoutes(
+      folly::Optional<uint8_t> protocolId = folly::none);
 
  private:
   NetlinkProtocolSocket(NetlinkProtocolSocket const&) = delete;
@@ -229,6 +295,8 @@ class NetlinkProtocolSocket {
 
   std::function<void(fbnl::Neighbor, bool)> neighborEventCB_;
 
+  std::function<void()> overrunCB_;
+
   // netlink message queue
   std::queue<std::unique_ptr<NetlinkMessage>> msgQueue_;
 
@@ -238,6 +306,19 @@ class NetlinkProtocolSocket {
   // process ack message
   void processAck(uint32_t ack);
 
+  // route message from message pool, allocated if pool is empty. Thread safe
+  std::unique_ptr<NetlinkRouteMessage> getRouteMessage();
+
+  // return route message to pool for reuse, if pool is not full
+  void recycleRouteMessage(std::unique_ptr<NetlinkRouteMessage> msg);
+
+  // route messages kept for reuse, taken by API callers and returned by
+  // event loop once acked
+  std::mutex messagePoolMutex_;
+  std::vector<std::unique_ptr<NetlinkRouteMessage>> messagePool_;
+  std::atomic<uint64_t> messageAllocs_{0};
+  std::atomic<uint64_t> messageReuses_{0};
+
   // netlink socket
   int nlSock_{-1};
 
@@ -253,11 +334,24 @@ class NetlinkProtocolSocket {
   // NLMSG acks
   uint32_t acks_{0};
 
+  // reusable receive buffers, kNlRecvBatchSize of kNlRecvBufSize bytes, and
+  // recvmmsg() headers pointing to them
+  std::vector<char> recvBuf_;
+  std::vector<struct iovec> recvIov_;
+  std::vector<struct mmsghdr> recvMsgs_;
+
+  // receive stats
+  uint64_t recvSyscalls_{0};
+  uint64_t recvDatagrams_{0};
+  uint64_t recvMessages_{0};
+  uint64_t recvOverruns_{0};
+  uint64_t suppressedRouteEvents_{0};
+
   // last sent sequence number
   uint32_t lastSeqNo_;
 
   // Sequence number -> NetlinkMesage request Map
-  std::unordered_map<uint32_t, std::shared_ptr<NetlinkMessage>> nlSeqNoMap_;
+  std::unordered_map<uint32_t, std::unique_ptr<NetlinkMessage>> nlSeqNoMap_;
 
   // Set ack status value to promise in the netlink request message
   void setReturnStatusValue(uint32_t seq, int ackStatus);
@@ -271,6 +365,9 @@ class NetlinkProtocolSocket {
   std::vector<fbnl::IfAddress> addressCache_{};
   std::vector<fbnl::Neighbor> neighborCache_{};
   std::vector<fbnl::Route> routeCache_{};
+
+  // dumped route messages, parsed by getAllRoutes() once dump is done
+  std::vector<std::string> routeDumpMsgs_{};
 };
 } // namespace Netlink
 } // namespace openr
@@ -525,6 +525,12 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
       }
     } break;
 
+    case RTA_NH_ID: {
+      // route programmed with a kernel nexthop group
+      routeBuilder.setNexthopGroupId(
+          *(reinterpret_cast<uint32_t*> RTA_DATA(routeAttr)));
+    } break;
+
     case RTA_PRIORITY: {
       // parse route priority
       routeBuilder.setPriority(*(reinterpret_cast<int*> RTA_DATA(routeAttr)));
@@ -557,7 +563,7 @@ NetlinkRouteMessage::parseMessage(const struct nlmsghdr* nlmsg) const {
     routeBuilder.addNextHop(nhBuilder.build());
   }
 
-  auto route = routeBuilder.build();
+  auto route = std::move(routeBuilder).build();
   VLOG(2) << route.str();
   return route;
 }
@@ -635,6 +641,16 @@ NetlinkRouteMessage::addRoute(const openr::fbnl::Route& route) {
     };
   }
 
+  // nexthops are held by the kernel nexthop group, if any
+  if (route.getNexthopGroupId().hasValue()) {
+    const uint32_t nhId = route.getNexthopGroupId().value();
+    return addAttributes(
+        RTA_NH_ID,
+        reinterpret_cast<const char*>(&nhId),
+        sizeof(nhId),
+        msghdr_);
+  }
+
   return addNextHops(route);
 }
 
@@ -719,6 +735,129 @@ NetlinkRouteMessage::deleteLabelRoute(const openr::fbnl::Route& route) {
   return status;
 }
 
+NetlinkNexthopMessage::NetlinkNexthopMessage() {
+  // get pointer to NLMSG header
+  msghdr_ = getMessagePtr();
+}
+
+void
+NetlinkNexthopMessage::init(int type, bool replace, uint8_t protocolId) {
+  if (type != RTM_NEWNEXTHOP && type != RTM_DELNEXTHOP) {
+    LOG(ERROR) << "Incorrect Netlink message type";
+    return;
+  }
+  // initialize netlink header
+  msghdr_->nlmsg_len = NLMSG_LENGTH(sizeof(struct nhmsg));
+  msghdr_->nlmsg_type = type;
+  msghdr_->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+
+  if (type == RTM_NEWNEXTHOP) {
+    msghdr_->nlmsg_flags |= NLM_F_CREATE;
+    msghdr_->nlmsg_flags |= replace ? NLM_F_REPLACE : NLM_F_EXCL;
+  }
+
+  // intialize the nexthop message header
+  auto nlmsgAlen = NLMSG_ALIGN(sizeof(struct nlmsghdr));
+  nhmsg_ = reinterpret_cast<struct nhmsg*>((char*)msghdr_ + nlmsgAlen);
+
+  nhmsg_->nh_family = AF_UNSPEC;
+  nhmsg_->nh_scope = 0;
+  nhmsg_->nh_protocol = protocolId;
+  nhmsg_->resvd = 0;
+  nhmsg_->nh_flags = 0;
+}
+
+ResultCode
+NetlinkNexthopMessage::addNexthop(
+    uint32_t id,
+    const openr::fbnl::NextHop& nextHop,
+    uint8_t protocolId,
+    bool replace) {
+  VLOG(1) << "Adding nexthop id " << id << ": " << nextHop.str();
+
+  auto const via = nextHop.getGateway();
+  if (!via.hasValue()) {
+    LOG(ERROR) << "Nexthop IP not provided";
+    return ResultCode::NO_NEXTHOP_IP;
+  }
+  if (!nextHop.getIfIndex().hasValue()) {
+    LOG(ERROR) << "Nexthop interface index not provided";
+    return ResultCode::FAIL;
+  }
+
+  init(RTM_NEWNEXTHOP, replace, protocolId);
+  nhmsg_->nh_family = via.value().family();
+
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = addAttributes(
+           NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_)) !=
+      ResultCode::SUCCESS) {
+    return status;
+  }
+
+  const uint32_t oif = nextHop.getIfIndex().value();
+  if ((status = addAttributes(
+           NHA_OIF,
+           reinterpret_cast<const char*>(&oif),
+           sizeof(oif),
+           msghdr_)) != ResultCode::SUCCESS) {
+    return status;
+  }
+
+  return addAttributes(
+      NHA_GATEWAY,
+      reinterpret_cast<const char*>(via.value().bytes()),
+      via.value().byteCount(),
+      msghdr_);
+}
+
+ResultCode
+NetlinkNexthopMessage::addNexthopGroup(
+    uint32_t id,
+    const std::vector<uint32_t>& members,
+    uint8_t protocolId,
+    bool replace) {
+  VLOG(1) << "Adding nexthop group id " << id << " with " << members.size()
+          << " nexthops";
+
+  if (members.empty()) {
+    LOG(ERROR) << "Nexthop group without nexthops";
+    return ResultCode::FAIL;
+  }
+
+  init(RTM_NEWNEXTHOP, replace, protocolId);
+
+  ResultCode status{ResultCode::SUCCESS};
+  if ((status = addAttributes(
+           NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_)) !=
+      ResultCode::SUCCESS) {
+    return status;
+  }
+
+  // members are of equal weight, as rtnh_hops of RTA_MULTIPATH nexthops
+  std::vector<struct nexthop_grp> group(members.size());
+  for (size_t i = 0; i < members.size(); ++i) {
+    group[i].id = members[i];
+    group[i].weight = 0;
+    group[i].resvd1 = 0;
+    group[i].resvd2 = 0;
+  }
+  return addAttributes(
+      NHA_GROUP,
+      reinterpret_cast<const char*>(group.data()),
+      group.size() * sizeof(struct nexthop_grp),
+      msghdr_);
+}
+
+ResultCode
+NetlinkNexthopMessage::deleteNexthop(uint32_t id) {
+  VLOG(1) << "Deleting nexthop id " << id;
+
+  init(RTM_DELNEXTHOP, false, 0);
+  return addAttributes(
+      NHA_ID, reinterpret_cast<const char*>(&id), sizeof(id), msghdr_);
+}
+
 NetlinkLinkMessage::NetlinkLinkMessage() {
   // get pointer to NLMSG header
   msghdr_ = getMessagePtr();
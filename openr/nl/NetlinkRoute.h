@@ -9,6 +9,7 @@
 
 #include <linux/lwtunnel.h>
 #include <linux/mpls.h>
+#include <linux/nexthop.h>
 #include <linux/rtnetlink.h>
 #include <net/if_arp.h>
 #include <netinet/ether.h>
@@ -154,6 +155,45 @@ class NetlinkRouteMessage final : public NetlinkMessage {
   } __attribute__((__packed__));
 };
 
+/**
+ * Kernel nexthop object (RTM_NEWNEXTHOP/RTM_DELNEXTHOP) message. Routes refer
+ * to a nexthop group by id with RTA_NH_ID instead of listing RTA_MULTIPATH,
+ * so that changing the members of a group updates all routes using it with a
+ * single message
+ */
+class NetlinkNexthopMessage final : public NetlinkMessage {
+ public:
+  NetlinkNexthopMessage();
+
+  // initiallize nexthop message with default params. If replace is false
+  // creating an id which already exists fails with EEXIST
+  void init(int type, bool replace, uint8_t protocolId);
+
+  // add a single IP nexthop with id, from gateway and interface of nextHop
+  ResultCode addNexthop(
+      uint32_t id,
+      const openr::fbnl::NextHop& nextHop,
+      uint8_t protocolId,
+      bool replace);
+
+  // add a group of nexthop ids, or replace members of an existing group
+  ResultCode addNexthopGroup(
+      uint32_t id,
+      const std::vector<uint32_t>& members,
+      uint8_t protocolId,
+      bool replace);
+
+  // delete nexthop or nexthop group with id
+  ResultCode deleteNexthop(uint32_t id);
+
+ private:
+  // pointer to nexthop message header
+  struct nhmsg* nhmsg_{nullptr};
+
+  // pointer to the netlink message header
+  struct nlmsghdr* msghdr_{nullptr};
+};
+
 class NetlinkLinkMessage final : public NetlinkMessage {
  public:
   NetlinkLinkMessage();
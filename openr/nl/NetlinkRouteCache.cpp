@@ -0,0 +1,380 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <openr/nl/NetlinkRouteCache.h>
+
+#include <folly/hash/Hash.h>
+#include <glog/logging.h>
+
+namespace openr {
+namespace fbnl {
+
+size_t
+UnicastRouteCache::PackedPrefixHash::operator()(
+    const PackedPrefix& prefix) const {
+  static_assert(sizeof(PackedPrefix) == 18, "PackedPrefix must be packed");
+  return folly::hash::fnv64_buf(&prefix, sizeof(PackedPrefix));
+}
+
+size_t
+UnicastRouteCache::RouteKeyHash::operator()(const RouteKey& key) const {
+  return folly::hash::hash_128_to_64(
+      key.protocolId, PackedPrefixHash()(key.prefix));
+}
+
+size_t
+UnicastRouteCache::NextHopSetHash::operator()(
+    const NextHopSet& nextHops) const {
+  size_t res = nextHops.size();
+  for (auto const& nextHop : nextHops) {
+    res += NextHopHash()(nextHop);
+  }
+  return res;
+}
+
+UnicastRouteCache::PackedPrefix
+UnicastRouteCache::packPrefix(const folly::CIDRNetwork& prefix) {
+  PackedPrefix packed;
+  std::copy(
+      prefix.first.bytes(),
+      prefix.first.bytes() + prefix.first.byteCount(),
+      packed.addr.begin());
+  packed.prefixLength = prefix.second;
+  packed.isV4 = prefix.first.isV4() ? 1 : 0;
+  return packed;
+}
+
+folly::CIDRNetwork
+UnicastRouteCache::unpackPrefix(const PackedPrefix& prefix) {
+  return {folly::IPAddress::fromBinary(
+              folly::ByteRange(prefix.addr.data(), prefix.isV4 ? 4 : 16)),
+          prefix.prefixLength};
+}
+
+const NextHopSet*
+UnicastRouteCache::acquireNextHops(const NextHopSet& nextHops) {
+  auto it = nextHopSets_.find(nextHops);
+  if (it == nextHopSets_.end()) {
+    it = nextHopSets_.emplace(nextHops, 0).first;
+  }
+  ++it->second;
+  return &it->first;
+}
+
+void
+UnicastRouteCache::releaseNextHops(const NextHopSet* nextHops) {
+  auto it = nextHopSets_.find(*nextHops);
+  CHECK(it != nextHopSets_.end());
+  CHECK_GT(it->second, 0);
+  if (--it->second == 0) {
+    nextHopSets_.erase(it);
+  }
+}
+
+void
+UnicastRouteCache::indexGateways(
+    const RouteKey& key, const NextHopSet& nextHops) {
+  for (auto const& nextHop : nextHops) {
+    if (nextHop.getGateway().hasValue()) {
+      gatewayRoutes_[nextHop.getGateway().value()].emplace(key);
+    }
+  }
+}
+
+void
+UnicastRouteCache::unindexGateways(
+    const RouteKey& key, const NextHopSet& nextHops) {
+  for (auto const& nextHop : nextHops) {
+    if (!nextHop.getGateway().hasValue()) {
+      continue;
+    }
+    // Nexthops on different interfaces may share gateway, erased once
+    auto it = gatewayRoutes_.find(nextHop.getGateway().value());
+    if (it == gatewayRoutes_.end()) {
+      continue;
+    }
+    it->second.erase(key);
+    if (it->second.empty()) {
+      gatewayRoutes_.erase(it);
+    }
+  }
+}
+
+void
+UnicastRouteCache::update(const Route& route) {
+  auto& routes = routes_[route.getProtocolId()];
+  const auto prefix = packPrefix(route.getDestination());
+
+  Entry entry;
+  // Acquire new nexthops first, old ones are kept if they are the same
+  entry.nextHops = acquireNextHops(route.getNextHops());
+  entry.type = route.getType();
+  entry.routeTable = route.getRouteTable();
+  entry.scope = route.getScope();
+  if (route.isValid()) {
+    entry.attrs |= kIsValid;
+  }
+  if (route.getFlags().hasValue()) {
+    entry.attrs |= kHasFlags;
+    entry.flags = route.getFlags().value();
+  }
+  if (route.getPriority().hasValue()) {
+    entry.attrs |= kHasPriority;
+    entry.priority = route.getPriority().value();
+  }
+  if (route.getTos().hasValue()) {
+    entry.attrs |= kHasTos;
+    entry.tos = route.getTos().value();
+  }
+  if (route.getMtu().hasValue()) {
+    entry.attrs |= kHasMtu;
+    entry.mtu = route.getMtu().value();
+  }
+  if (route.getAdvMss().hasValue()) {
+    entry.attrs |= kHasAdvMss;
+    entry.advMss = route.getAdvMss().value();
+  }
+  if (route.getNexthopGroupId().hasValue()) {
+    entry.attrs |= kHasNexthopGroupId;
+    entry.nexthopGroupId = route.getNexthopGroupId().value();
+  }
+  if (route.getRouteIfName().hasValue()) {
+    entry.attrs |= kHasRouteIfName;
+    routes.ifNames[prefix] = route.getRouteIfName().value();
+  } else {
+    routes.ifNames.erase(prefix);
+  }
+
+  const RouteKey key{route.getProtocolId(), prefix};
+  auto it = routes.entries.find(prefix);
+  if (it == routes.entries.end()) {
+    indexGateways(key, *entry.nextHops);
+    routes.entries.emplace(prefix, entry);
+    return;
+  }
+  if (it->second.nextHops != entry.nextHops) {
+    unindexGateways(key, *it->second.nextHops);
+    indexGateways(key, *entry.nextHops);
+  }
+  releaseNextHops(it->second.nextHops);
+  it->second = entry;
+}
+
+bool
+UnicastRouteCache::erase(uint8_t protocolId, const folly::CIDRNetwork& prefix) {
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return false;
+  }
+  auto& routes = routesIt->second;
+  const auto packed = packPrefix(prefix);
+  auto it = routes.entries.find(packed);
+  if (it == routes.entries.end()) {
+    return false;
+  }
+  unindexGateways(RouteKey{protocolId, packed}, *it->second.nextHops);
+  releaseNextHops(it->second.nextHops);
+  routes.entries.erase(it);
+  routes.ifNames.erase(packed);
+  return true;
+}
+
+bool
+UnicastRouteCache::contains(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) const {
+  auto routesIt = routes_.find(protocolId);
+  return routesIt != routes_.end() &&
+      routesIt->second.entries.count(packPrefix(prefix));
+}
+
+folly::Optional<Route>
+UnicastRouteCache::get(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) const {
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return folly::none;
+  }
+  const auto packed = packPrefix(prefix);
+  auto it = routesIt->second.entries.find(packed);
+  if (it == routesIt->second.entries.end()) {
+    return folly::none;
+  }
+  return buildRoute(protocolId, packed, it->second, routesIt->second);
+}
+
+bool
+UnicastRouteCache::isSameRoute(const Route& route) const {
+  auto routesIt = routes_.find(route.getProtocolId());
+  if (routesIt == routes_.end()) {
+    return false;
+  }
+  auto& routes = routesIt->second;
+  const auto packed = packPrefix(route.getDestination());
+  auto it = routes.entries.find(packed);
+  if (it == routes.entries.end() || route.getMplsLabel().hasValue()) {
+    return false;
+  }
+
+  auto const& entry = it->second;
+  auto optional = [&entry](uint8_t attr, uint32_t value) {
+    folly::Optional<uint32_t> result;
+    if (entry.attrs & attr) {
+      result = value;
+    }
+    return result;
+  };
+  folly::Optional<uint8_t> tos;
+  if (entry.attrs & kHasTos) {
+    tos = entry.tos;
+  }
+  folly::Optional<std::string> routeIfName;
+  if (entry.attrs & kHasRouteIfName) {
+    routeIfName = routes.ifNames.at(packed);
+  }
+  return route.getType() == entry.type &&
+      route.getRouteTable() == entry.routeTable &&
+      route.getScope() == entry.scope &&
+      route.isValid() == static_cast<bool>(entry.attrs & kIsValid) &&
+      route.getFlags() == optional(kHasFlags, entry.flags) &&
+      route.getPriority() == optional(kHasPriority, entry.priority) &&
+      route.getTos() == tos &&
+      route.getMtu() == optional(kHasMtu, entry.mtu) &&
+      route.getAdvMss() == optional(kHasAdvMss, entry.advMss) &&
+      route.getRouteIfName() == routeIfName &&
+      route.getNextHops() == *entry.nextHops;
+}
+
+folly::Optional<uint32_t>
+UnicastRouteCache::getNexthopGroupId(
+    uint8_t protocolId, const folly::CIDRNetwork& prefix) const {
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return folly::none;
+  }
+  auto it = routesIt->second.entries.find(packPrefix(prefix));
+  if (it == routesIt->second.entries.end() ||
+      !(it->second.attrs & kHasNexthopGroupId)) {
+    return folly::none;
+  }
+  return it->second.nexthopGroupId;
+}
+
+NlUnicastRoutes
+UnicastRouteCache::getRoutes(uint8_t protocolId) const {
+  NlUnicastRoutes result;
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return result;
+  }
+  result.reserve(routesIt->second.entries.size());
+  for (auto const& kv : routesIt->second.entries) {
+    auto route = buildRoute(protocolId, kv.first, kv.second, routesIt->second);
+    auto prefix = route.getDestination();
+    result.emplace(std::move(prefix), std::move(route));
+  }
+  return result;
+}
+
+void
+UnicastRouteCache::forEachRoute(
+    uint8_t protocolId,
+    const std::function<void(const Route&)>& visitor) const {
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return;
+  }
+  for (auto const& kv : routesIt->second.entries) {
+    visitor(buildRoute(protocolId, kv.first, kv.second, routesIt->second));
+  }
+}
+
+std::vector<folly::CIDRNetwork>
+UnicastRouteCache::getPrefixes(uint8_t protocolId) const {
+  std::vector<folly::CIDRNetwork> prefixes;
+  auto routesIt = routes_.find(protocolId);
+  if (routesIt == routes_.end()) {
+    return prefixes;
+  }
+  prefixes.reserve(routesIt->second.entries.size());
+  for (auto const& kv : routesIt->second.entries) {
+    prefixes.emplace_back(unpackPrefix(kv.first));
+  }
+  return prefixes;
+}
+
+std::vector<std::pair<uint8_t, folly::CIDRNetwork>>
+UnicastRouteCache::getRoutesViaGateway(const folly::IPAddress& gateway) const {
+  std::vector<std::pair<uint8_t, folly::CIDRNetwork>> routes;
+  auto it = gatewayRoutes_.find(gateway);
+  if (it == gatewayRoutes_.end()) {
+    return routes;
+  }
+  routes.reserve(it->second.size());
+  for (auto const& key : it->second) {
+    routes.emplace_back(key.protocolId, unpackPrefix(key.prefix));
+  }
+  return routes;
+}
+
+size_t
+UnicastRouteCache::size() const {
+  size_t count{0};
+  for (auto const& kv : routes_) {
+    count += kv.second.entries.size();
+  }
+  return count;
+}
+
+size_t
+UnicastRouteCache::size(uint8_t protocolId) const {
+  auto routesIt = routes_.find(protocolId);
+  return routesIt == routes_.end() ? 0 : routesIt->second.entries.size();
+}
+
+Route
+UnicastRouteCache::buildRoute(
+    uint8_t protocolId,
+    const PackedPrefix& prefix,
+    const Entry& entry,
+    const ProtocolRoutes& routes) const {
+  RouteBuilder builder;
+  builder.setDestination(unpackPrefix(prefix))
+      .setProtocolId(protocolId)
+      .setType(entry.type)
+      .setRouteTable(entry.routeTable)
+      .setScope(entry.scope)
+      .setValid(entry.attrs & kIsValid);
+  if (entry.attrs & kHasFlags) {
+    builder.setFlags(entry.flags);
+  }
+  if (entry.attrs & kHasPriority) {
+    builder.setPriority(entry.priority);
+  }
+  if (entry.attrs & kHasTos) {
+    builder.setTos(entry.tos);
+  }
+  if (entry.attrs & kHasMtu) {
+    builder.setMtu(entry.mtu);
+  }
+  if (entry.attrs & kHasAdvMss) {
+    builder.setAdvMss(entry.advMss);
+  }
+  if (entry.attrs & kHasNexthopGroupId) {
+    builder.setNexthopGroupId(entry.nexthopGroupId);
+  }
+  if (entry.attrs & kHasRouteIfName) {
+    builder.setRouteIfName(routes.ifNames.at(prefix));
+  }
+  builder.reserveNextHops(entry.nextHops->size());
+  for (auto const& nextHop : *entry.nextHops) {
+    builder.addNextHop(nextHop);
+  }
+  return std::move(builder).build();
+}
+
+} // namespace fbnl
+} // namespace openr
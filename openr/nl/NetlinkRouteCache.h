@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <folly/IPAddress.h>
+#include <folly/Optional.h>
+
+#include <openr/nl/NetlinkTypes.h>
+
+namespace openr {
+namespace fbnl {
+
+/**
+ * Compact cache of unicast routes programmed by NetlinkSocket, by protocol
+ * and destination. Routes are not kept as Route objects, which carry every
+ * optional attribute, their own set of heap allocated nexthops and rtnl
+ * objects once programmed. Instead each entry holds
+ * - packed destination as key, address bytes and prefix length
+ * - fixed size attributes without heap allocations
+ * - pointer to interned set of nexthops, shared by all routes with the same
+ *   nexthops (e.g. all routes towards the same set of neighbors)
+ *
+ * Routes are rebuilt when read, so only use get/getRoutes where a Route is
+ * actually needed. Routes are also indexed by gateways of their nexthops, so
+ * that routes via a neighbor are found without visiting all routes.
+ * Not thread safe, accessed from event loop of NetlinkSocket.
+ */
+class UnicastRouteCache {
+ public:
+  UnicastRouteCache() = default;
+
+  // No-copy, entries point into interned nexthop sets
+  UnicastRouteCache(const UnicastRouteCache&) = delete;
+  UnicastRouteCache& operator=(const UnicastRouteCache&) = delete;
+
+  // Add or replace route of its protocol and destination
+  void update(const Route& route);
+
+  // Remove route. Returns false if there was no such route
+  bool erase(uint8_t protocolId, const folly::CIDRNetwork& prefix);
+
+  bool contains(uint8_t protocolId, const folly::CIDRNetwork& prefix) const;
+
+  // Rebuild cached route if any
+  folly::Optional<Route> get(
+      uint8_t protocolId, const folly::CIDRNetwork& prefix) const;
+
+  // Same as get(...) == route, without rebuilding cached route
+  bool isSameRoute(const Route& route) const;
+
+  folly::Optional<uint32_t> getNexthopGroupId(
+      uint8_t protocolId, const folly::CIDRNetwork& prefix) const;
+
+  // Rebuild all routes of protocol
+  NlUnicastRoutes getRoutes(uint8_t protocolId) const;
+
+  // Rebuild routes of protocol one at a time, without keeping them in a table
+  void forEachRoute(
+      uint8_t protocolId,
+      const std::function<void(const Route&)>& visitor) const;
+
+  std::vector<folly::CIDRNetwork> getPrefixes(uint8_t protocolId) const;
+
+  // Protocol and destination of routes, of all protocols, with a nexthop via
+  // gateway
+  std::vector<std::pair<uint8_t, folly::CIDRNetwork>> getRoutesViaGateway(
+      const folly::IPAddress& gateway) const;
+
+  // Number of routes of all protocols and of one protocol
+  size_t size() const;
+  size_t size(uint8_t protocolId) const;
+
+  // Number of distinct sets of nexthops
+  size_t
+  getNumNextHopSets() const {
+    return nextHopSets_.size();
+  }
+
+ private:
+  // Destination address bytes, v4 addresses use first 4. No padding, it is
+  // hashed as raw bytes
+  struct PackedPrefix {
+    std::array<uint8_t, 16> addr{};
+    uint8_t prefixLength{0};
+    uint8_t isV4{0};
+
+    bool
+    operator==(const PackedPrefix& other) const {
+      return addr == other.addr && prefixLength == other.prefixLength &&
+          isV4 == other.isV4;
+    }
+  };
+
+  struct PackedPrefixHash {
+    size_t operator()(const PackedPrefix& prefix) const;
+  };
+
+  struct RouteKey {
+    uint8_t protocolId{0};
+    PackedPrefix prefix;
+
+    bool
+    operator==(const RouteKey& other) const {
+      return protocolId == other.protocolId && prefix == other.prefix;
+    }
+  };
+
+  struct RouteKeyHash {
+    size_t operator()(const RouteKey& key) const;
+  };
+
+  // NextHopSet is unordered, hash is by sum of hashes of nexthops
+  struct NextHopSetHash {
+    size_t operator()(const NextHopSet& nextHops) const;
+  };
+
+  // Interned nexthop sets and number of routes using each one
+  using NextHopSets = std::unordered_map<NextHopSet, size_t, NextHopSetHash>;
+
+  // Bits of Entry::attrs for optional attributes
+  enum : uint8_t {
+    kHasFlags = 1 << 0,
+    kHasPriority = 1 << 1,
+    kHasTos = 1 << 2,
+    kHasMtu = 1 << 3,
+    kHasAdvMss = 1 << 4,
+    kHasNexthopGroupId = 1 << 5,
+    kHasRouteIfName = 1 << 6,
+    kIsValid = 1 << 7,
+  };
+
+  struct Entry {
+    // Points to key of nextHopSets_ entry, stable until it is erased
+    const NextHopSet* nextHops{nullptr};
+    uint32_t flags{0};
+    uint32_t priority{0};
+    uint32_t mtu{0};
+    uint32_t advMss{0};
+    uint32_t nexthopGroupId{0};
+    uint8_t type{0};
+    uint8_t routeTable{0};
+    uint8_t scope{0};
+    uint8_t tos{0};
+    uint8_t attrs{0};
+  };
+
+  struct ProtocolRoutes {
+    std::unordered_map<PackedPrefix, Entry, PackedPrefixHash> entries;
+    // Route interface names, only set for few routes
+    std::unordered_map<PackedPrefix, std::string, PackedPrefixHash> ifNames;
+  };
+
+  static PackedPrefix packPrefix(const folly::CIDRNetwork& prefix);
+  static folly::CIDRNetwork unpackPrefix(const PackedPrefix& prefix);
+
+  const NextHopSet* acquireNextHops(const NextHopSet& nextHops);
+  void releaseNextHops(const NextHopSet* nextHops);
+
+  // Add or remove route in gatewayRoutes_ for gateways of its nexthops
+  void indexGateways(const RouteKey& key, const NextHopSet& nextHops);
+  void unindexGateways(const RouteKey& key, const NextHopSet& nextHops);
+
+  Route buildRoute(
+      uint8_t protocolId,
+      const PackedPrefix& prefix,
+      const Entry& entry,
+      const ProtocolRoutes& routes) const;
+
+  std::unordered_map<uint8_t, ProtocolRoutes> routes_;
+  NextHopSets nextHopSets_;
+
+  // Reverse index of nexthops, gateway => routes with a nexthop via it
+  std::unordered_map<
+      folly::IPAddress,
+      std::unordered_set<RouteKey, RouteKeyHash>>
+      gatewayRoutes_;
+};
+
+} // namespace fbnl
+} // namespace openr
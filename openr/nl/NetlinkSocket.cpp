@@ -5,17 +5,73 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <numeric>
+#include <set>
+
 #include <openr/nl/NetlinkSocket.h>
 #include <openr/if/gen-cpp2/Platform_constants.h>
+#include <openr/nl/NetlinkRoute.h>
 
 namespace openr {
 namespace fbnl {
 
+namespace {
+
+// attempts to find free ids when creating nexthop objects
+const size_t kMaxNexthopIdRetries{8};
+
+// delay of resync after receive buffer overrun
+const std::chrono::milliseconds kOverrunResyncDelay{100};
+
+// wait for acks of requests sharing one deadline. Returns the error code of
+// each request, ETIMEDOUT for requests without ack
+std::vector<int>
+waitForAcks(
+    std::vector<folly::Future<int>>& futures,
+    std::chrono::steady_clock::time_point deadline) {
+  std::vector<int> errors;
+  errors.reserve(futures.size());
+  for (auto& future : futures) {
+    future.wait(std::max(
+        std::chrono::milliseconds(0),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())));
+    errors.emplace_back(
+        future.isReady() && future.hasValue() ? std::abs(future.value())
+                                              : ETIMEDOUT);
+  }
+  return errors;
+}
+
+// whether routes only differ by their nexthops
+bool
+isSameRouteExceptNextHops(const Route& lhs, const Route& rhs) {
+  return lhs.getDestination() == rhs.getDestination() &&
+      lhs.getType() == rhs.getType() &&
+      lhs.getRouteTable() == rhs.getRouteTable() &&
+      lhs.getProtocolId() == rhs.getProtocolId() &&
+      lhs.getScope() == rhs.getScope() && lhs.isValid() == rhs.isValid() &&
+      lhs.getFlags() == rhs.getFlags() &&
+      lhs.getPriority() == rhs.getPriority() && lhs.getTos() == rhs.getTos() &&
+      lhs.getMtu() == rhs.getMtu() && lhs.getAdvMss() == rhs.getAdvMss() &&
+      lhs.getRouteIfName() == rhs.getRouteIfName() &&
+      lhs.getFamily() == rhs.getFamily();
+}
+
+} // namespace
+
 NetlinkSocket::NetlinkSocket(
     fbzmq::ZmqEventLoop* evl,
     EventsHandler* handler,
-    std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlSock)
-    : evl_(evl), handler_(handler), nlSock_(std::move(nlSock)) {
+    std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlSock,
+    bool enableNexthopObjects,
+    std::vector<uint8_t> cachedRouteProtocols)
+    : evl_(evl),
+      handler_(handler),
+      nlSock_(std::move(nlSock)),
+      enableNexthopObjects_(enableNexthopObjects),
+      cachedRouteProtocols_(std::move(cachedRouteProtocols)) {
   CHECK(evl_ != nullptr) << "Missing event loop.";
 
   CHECK(nlSock_ != nullptr) << "Missing NetlinkProtocolSocket";
@@ -54,6 +110,17 @@ NetlinkSocket::NetlinkSocket(
     });
   });
 
+  // Resync caches with kernel when events were lost
+  overrunResyncTimer_ = fbzmq::ZmqTimeout::make(
+      evl_, [this]() noexcept { doResyncAfterOverrun(); });
+  nlSock_->setOverrunCB([this]() noexcept {
+    evl_->runImmediatelyOrInEventLoop([this]() {
+      if (!overrunResyncTimer_->isScheduled()) {
+        overrunResyncTimer_->scheduleTimeout(kOverrunResyncDelay);
+      }
+    });
+  });
+
   // need to reload routes from kernel to avoid re-adding existing route
   // type of exception in NetlinkSocket
   updateRouteCache();
@@ -88,6 +155,13 @@ NetlinkSocket::doHandleRouteEvent(
 void
 NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
   const auto linkName = link.getLinkName();
+  auto it = links_.find(linkName);
+  if (it == links_.end() || it->second.ifIndex != link.getIfIndex()) {
+    updateLinkIndexes(linkName, link.getIfIndex());
+    ++linksVersion_;
+  } else if (it->second.isUp != link.isUp()) {
+    ++linksVersion_;
+  }
   auto& linkAttr = links_[linkName];
   linkAttr.isUp = link.isUp();
   linkAttr.ifIndex = link.getIfIndex();
@@ -103,6 +177,25 @@ NetlinkSocket::doHandleLinkEvent(Link link, bool runHandler) noexcept {
   }
 }
 
+void
+NetlinkSocket::updateLinkIndexes(const std::string& ifName, int ifIndex) {
+  auto linkIndexes = std::make_shared<LinkIndexes>(**linkIndexes_.rlock());
+  auto& ifNameToIndex = linkIndexes->ifNameToIndex;
+  auto& ifIndexToName = linkIndexes->ifIndexToName;
+  auto it = ifNameToIndex.find(ifName);
+  if (it != ifNameToIndex.end()) {
+    // link got a new index, its old one may be reused by another link
+    auto nameIt = ifIndexToName.find(it->second);
+    if (nameIt != ifIndexToName.end() && nameIt->second == ifName) {
+      ifIndexToName.erase(nameIt);
+    }
+  }
+  ifNameToIndex[ifName] = ifIndex;
+  // latest link of a reused index, e.g. of a renamed link
+  ifIndexToName[ifIndex] = ifName;
+  *linkIndexes_.wlock() = std::move(linkIndexes);
+}
+
 void
 NetlinkSocket::removeNeighborCacheEntries(const std::string& ifName) {
   for (auto it = neighbors_.begin(); it != neighbors_.end();) {
@@ -118,13 +211,14 @@ void
 NetlinkSocket::doHandleAddrEvent(IfAddress ifAddr, bool runHandler) noexcept {
   std::string ifName = getIfName(ifAddr.getIfIndex()).get();
   if (ifAddr.isValid()) {
-    if (links_[ifName].networks.count(ifAddr.getPrefix().value()) == 0) {
-      links_[ifName].networks.insert(ifAddr.getPrefix().value());
+    if (links_[ifName].networks.insert(ifAddr.getPrefix().value()).second) {
+      ++linksVersion_;
     }
   } else if (!ifAddr.isValid()) {
     auto it = links_.find(ifName);
-    if (it != links_.end()) {
-      it->second.networks.erase(ifAddr.getPrefix().value());
+    if (it != links_.end() &&
+        it->second.networks.erase(ifAddr.getPrefix().value())) {
+      ++linksVersion_;
     }
   }
 
@@ -140,6 +234,7 @@ NetlinkSocket::doHandleNeighborEvent(
   std::string ifName = getIfName(neighbor.getIfIndex()).get();
   auto key = std::make_pair(ifName, neighbor.getDestination());
   neighbors_.erase(key);
+  doRepairRoutesViaNeighbor(neighbor);
 
   NeighborUpdate neighborUpdate;
   if (neighbor.isReachable()) {
@@ -165,6 +260,201 @@ NetlinkSocket::doHandleNeighborEvent(
   }
 }
 
+bool
+NetlinkSocket::isFailedNextHop(const NextHop& nextHop) const {
+  if (!nextHop.getGateway().hasValue()) {
+    return false;
+  }
+  auto it = failedGateways_.find(nextHop.getGateway().value());
+  return it != failedGateways_.end() &&
+      (!nextHop.getIfIndex().hasValue() ||
+       it->second.count(nextHop.getIfIndex().value()));
+}
+
+void
+NetlinkSocket::pruneFailedNextHops(Route& route) {
+  if (failedGateways_.empty() && repairedRoutes_.empty()) {
+    return;
+  }
+  const auto key =
+      std::make_pair(route.getProtocolId(), route.getDestination());
+  NextHopSet nextHops;
+  for (auto const& nextHop : route.getNextHops()) {
+    if (!isFailedNextHop(nextHop)) {
+      nextHops.emplace(nextHop);
+    }
+  }
+  // Keep route as requested if no nexthop is pruned, or if all of them would
+  // be, routes without valid nexthops are up to the client
+  if (nextHops.empty() || nextHops.size() == route.getNextHops().size()) {
+    repairedRoutes_.erase(key);
+    return;
+  }
+  repairedRoutes_.erase(key);
+  repairedRoutes_.emplace(key, route);
+  route.setNextHops(std::move(nextHops));
+}
+
+void
+NetlinkSocket::doRepairRoutesViaNeighbor(const Neighbor& neighbor) noexcept {
+  const auto gateway = neighbor.getDestination();
+  const auto ifIndex = neighbor.getIfIndex();
+  auto isViaNeighbor = [&gateway, ifIndex](const Route& route) {
+    for (auto const& nextHop : route.getNextHops()) {
+      if (nextHop.getGateway() == gateway &&
+          (!nextHop.getIfIndex().hasValue() ||
+           nextHop.getIfIndex().value() == ifIndex)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Routes as requested, to reprogram with nexthops via failed neighbors
+  // pruned. Only routes via neighbor are visited, not whole route cache
+  std::vector<Route> routes;
+  if (neighbor.isFailed()) {
+    if (!failedGateways_[gateway].emplace(ifIndex).second) {
+      return;
+    }
+    for (auto const& key : unicastRoutesCache_.getRoutesViaGateway(gateway)) {
+      // Only routes of clients, not other routes loaded from kernel
+      auto const& priorities =
+          openr::thrift::Platform_constants::protocolIdtoPriority();
+      if (priorities.find(key.first) == priorities.end()) {
+        continue;
+      }
+      auto it = repairedRoutes_.find(key);
+      auto route = it != repairedRoutes_.end()
+          ? it->second
+          : unicastRoutesCache_.get(key.first, key.second).value();
+      if (isViaNeighbor(route)) {
+        routes.emplace_back(std::move(route));
+      }
+    }
+    ++numNeighborFailures_;
+    numNeighborFailureRoutes_ += routes.size();
+    lastNeighborFailureRoutes_ = routes.size();
+  } else {
+    auto it = failedGateways_.find(gateway);
+    if (it == failedGateways_.end() || it->second.erase(ifIndex) == 0) {
+      return;
+    }
+    if (it->second.empty()) {
+      failedGateways_.erase(it);
+    }
+    // Nexthops via neighbor are pruned off repaired routes only
+    for (auto const& kv : repairedRoutes_) {
+      if (isViaNeighbor(kv.second)) {
+        routes.emplace_back(kv.second);
+      }
+    }
+  }
+  if (routes.empty()) {
+    return;
+  }
+
+  LOG(INFO) << "Neighbor " << gateway.str() << " on ifIndex " << ifIndex
+            << (neighbor.isFailed() ? " failed" : " recovered")
+            << ", reprogramming " << routes.size() << " routes via it";
+  try {
+    doAddUpdateRoutes(std::move(routes));
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Failed to repair routes via neighbor " << gateway.str()
+               << ": " << folly::exceptionStr(ex);
+  }
+}
+
+void
+NetlinkSocket::doResyncAfterOverrun() noexcept {
+  LOG(INFO) << "Resyncing links, addresses and neighbors after overrun";
+  ++numOverrunResyncs_;
+  try {
+    // Links, marking those still present
+    std::unordered_set<std::string> seenLinks;
+    for (auto& link : nlSock_->getAllLinks()) {
+      seenLinks.emplace(link.getLinkName());
+      auto it = links_.find(link.getLinkName());
+      const bool changed = it == links_.end() ||
+          it->second.isUp != link.isUp() ||
+          it->second.ifIndex != link.getIfIndex();
+      doHandleLinkEvent(std::move(link), changed);
+    }
+    for (auto const& kv : links_) {
+      if (seenLinks.count(kv.first) == 0 && kv.second.isUp) {
+        LinkBuilder builder;
+        doHandleLinkEvent(
+            builder.setLinkName(kv.first)
+                .setIfIndex(kv.second.ifIndex)
+                .setFlags(0)
+                .build(),
+            true);
+      }
+    }
+
+    // Addresses, marking those still present
+    std::unordered_set<std::pair<int, folly::CIDRNetwork>> seenAddrs;
+    for (auto& addr : nlSock_->getAllIfAddresses()) {
+      if (!addr.getPrefix().hasValue()) {
+        continue;
+      }
+      const auto& prefix = addr.getPrefix().value();
+      seenAddrs.emplace(addr.getIfIndex(), prefix);
+      auto it = links_.find(getIfName(addr.getIfIndex()).get());
+      const bool changed = addr.isValid() !=
+          (it != links_.end() && it->second.networks.count(prefix) > 0);
+      doHandleAddrEvent(std::move(addr), changed);
+    }
+    std::vector<IfAddress> removedAddrs;
+    for (auto const& kv : links_) {
+      for (auto const& network : kv.second.networks) {
+        if (seenAddrs.count(std::make_pair(kv.second.ifIndex, network)) == 0) {
+          IfAddressBuilder builder;
+          removedAddrs.emplace_back(builder.setIfIndex(kv.second.ifIndex)
+                                        .setPrefix(network)
+                                        .setValid(false)
+                                        .build());
+        }
+      }
+    }
+    for (auto& addr : removedAddrs) {
+      doHandleAddrEvent(std::move(addr), true);
+    }
+
+    // Neighbors, marking those still present
+    std::unordered_set<std::pair<std::string, folly::IPAddress>> seenNeighbors;
+    for (auto& neighbor : nlSock_->getAllNeighbors()) {
+      auto key = std::make_pair(
+          getIfName(neighbor.getIfIndex()).get(), neighbor.getDestination());
+      auto it = neighbors_.find(key);
+      const bool changed = it == neighbors_.end()
+          ? neighbor.isReachable()
+          : !neighbor.isReachable() ||
+              it->second.getLinkAddress() != neighbor.getLinkAddress();
+      seenNeighbors.emplace(std::move(key));
+      doHandleNeighborEvent(std::move(neighbor), changed);
+    }
+    std::vector<Neighbor> removedNeighbors;
+    for (auto const& kv : neighbors_) {
+      if (seenNeighbors.count(kv.first) == 0) {
+        NeighborBuilder builder;
+        removedNeighbors.emplace_back(
+            builder.setIfIndex(kv.second.getIfIndex())
+                .setDestination(kv.first.second)
+                .setState(NUD_FAILED, true /* deleted */)
+                .build());
+      }
+    }
+    // Gone neighbors have no link address to report to handler, they are
+    // only removed from cache and neighbor listener
+    for (auto& neighbor : removedNeighbors) {
+      doHandleNeighborEvent(std::move(neighbor), false);
+    }
+  } catch (const std::exception& ex) {
+    LOG(ERROR) << "Resync after overrun failed: " << folly::exceptionStr(ex);
+  }
+}
+
 void
 NetlinkSocket::doUpdateRouteCache(Route route, bool updateUnicastRoute) {
   // Skip cached route entries and any routes not in the main table
@@ -225,10 +515,8 @@ NetlinkSocket::doUpdateRouteCache(Route route, bool updateUnicastRoute) {
   }
 
   if (updateUnicastRoute) {
-    auto& unicastRoutes = unicastRoutesCache_[protocol];
     if (route.isValid()) {
-      unicastRoutes.erase(prefix);
-      unicastRoutes.emplace(prefix, std::move(route));
+      unicastRoutesCache_.update(route);
     }
     // NOTE: We are just updating cache. This called during initialization
   }
@@ -349,28 +637,70 @@ NetlinkSocket::syncMplsRoutes(uint8_t protocolId, NlMplsRoutes newMplsRouteDb) {
                                      protocolId]() mutable {
     try {
       LOG(INFO) << "Syncing " << syncDb.size() << " mpls routes";
-      auto& mplsRoutes = mplsRoutesCache_[protocolId];
-      std::unordered_set<int32_t> toDelete;
-      // collect label routes to delete
-      for (auto const& kv : mplsRoutes) {
-        if (syncDb.find(kv.first) == syncDb.end()) {
-          toDelete.insert(kv.first);
+      doSyncMplsRoutes(protocolId, std::move(syncDb));
+      p.setValue();
+      LOG(INFO) << "Sync done.";
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "Error syncing MPLS routeDb with Fib: "
+                 << folly::exceptionStr(ex);
+      p.setException(ex);
+    }
+  });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::deleteUnicastRoutesExcept(
+    uint8_t protocolId, std::unordered_set<folly::CIDRNetwork> prefixes) {
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     p = std::move(promise),
+                                     prefixes = std::move(prefixes),
+                                     protocolId]() mutable {
+    try {
+      std::vector<Route> toDelete;
+      for (auto const& prefix : unicastRoutesCache_.getPrefixes(protocolId)) {
+        if (prefixes.count(prefix) == 0) {
+          toDelete.emplace_back(
+              unicastRoutesCache_.get(protocolId, prefix).value());
         }
       }
-      // delete
-      LOG(INFO) << "Sync: Deleting " << toDelete.size() << " mpls routes";
-      for (auto label : toDelete) {
-        auto mplsRouteEntry = mplsRoutes.at(label);
-        doDeleteMplsRoute(mplsRouteEntry);
-      }
-      // Go over MPLS routes in new routeDb, update/add
-      for (auto& kv : syncDb) {
-        doAddUpdateMplsRoute(kv.second);
+      LOG(INFO) << "Sync: number of routes to delete: " << toDelete.size();
+      doDeleteRoutes(std::move(toDelete));
+      p.setValue();
+    } catch (std::exception const& ex) {
+      LOG(ERROR) << "Error deleting stale unicast routes: "
+                 << folly::exceptionStr(ex);
+      p.setException(ex);
+    }
+  });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::deleteMplsRoutesExcept(
+    uint8_t protocolId, std::unordered_set<int32_t> labels) {
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     p = std::move(promise),
+                                     labels = std::move(labels),
+                                     protocolId]() mutable {
+    try {
+      std::vector<Route> toDelete;
+      for (auto const& kv : mplsRoutesCache_[protocolId]) {
+        if (labels.count(kv.first) == 0) {
+          toDelete.emplace_back(kv.second);
+        }
       }
+      LOG(INFO) << "Sync: Deleting " << toDelete.size() << " mpls routes";
+      doDeleteRoutes(std::move(toDelete));
       p.setValue();
-      LOG(INFO) << "Sync done.";
     } catch (std::exception const& ex) {
-      LOG(ERROR) << "Error syncing MPLS routeDb with Fib: "
+      LOG(ERROR) << "Error deleting stale MPLS routes: "
                  << folly::exceptionStr(ex);
       p.setException(ex);
     }
@@ -418,26 +748,20 @@ void
 NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
   checkUnicastRoute(route);
 
+  // keep references of nexthop groups in one place
+  if (enableNexthopObjects_) {
+    std::vector<Route> routes;
+    routes.emplace_back(std::move(route));
+    doAddUpdateRoutes(std::move(routes));
+    return;
+  }
+
   const auto& dest = route.getDestination();
 
-  // Create new set of nexthops to be programmed. Existing + New ones
-  auto& unicastRoutes = unicastRoutesCache_[route.getProtocolId()];
-  auto iter = unicastRoutes.find(dest);
-  // if user did not speicify priority
-  if (!route.getPriority()) {
-    const auto routePair =
-        openr::thrift::Platform_constants::protocolIdtoPriority().find(
-            route.getProtocolId());
-    if (routePair ==
-        openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
-      route.setPriority(
-          openr::thrift::Platform_constants::kUnknowProtAdminDistance());
-    } else {
-      route.setPriority(routePair->second);
-    }
-  }
+  pruneFailedNextHops(route);
+  setDefaultPriority(route);
   // Same route
-  if (iter != unicastRoutes.end() && iter->second == route) {
+  if (unicastRoutesCache_.isSameRoute(route)) {
     return;
   }
 
@@ -447,20 +771,21 @@ NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
     // (like gateway or metric or..) the existing one will not be replaced,
     // instead a new route will be created, which may cause underlying kernel
     // crash when releasing netdevices
-    if (iter != unicastRoutes.end()) {
+    auto oldRoute = unicastRoutesCache_.get(route.getProtocolId(), dest);
+    if (oldRoute.hasValue()) {
       int err{0};
 
-      err = static_cast<int>(nlSock_->deleteRoute(iter->second));
+      err = static_cast<int>(nlSock_->deleteRoute(oldRoute.value()));
 
       if (0 != err) {
         throw fbnl::NlException(folly::sformat(
-            "Failed to delete route\n{}\nError: {}", iter->second.str(), err));
+            "Failed to delete route\n{}\nError: {}", oldRoute->str(), err));
       }
     }
   }
 
   // Remove route from cache
-  unicastRoutes.erase(dest);
+  unicastRoutesCache_.erase(route.getProtocolId(), dest);
 
   // Add new route
   int err{0};
@@ -473,7 +798,786 @@ NetlinkSocket::doAddUpdateUnicastRoute(Route route) {
   }
 
   // Add route entry in cache on successful addition
-  unicastRoutes.emplace(std::make_pair(dest, std::move(route)));
+  unicastRoutesCache_.update(route);
+}
+
+void
+NetlinkSocket::setDefaultPriority(Route& route) const {
+  // if user did not speicify priority
+  if (!route.getPriority()) {
+    const auto routePair =
+        openr::thrift::Platform_constants::protocolIdtoPriority().find(
+            route.getProtocolId());
+    if (routePair ==
+        openr::thrift::Platform_constants::protocolIdtoPriority().end()) {
+      route.setPriority(
+          openr::thrift::Platform_constants::kUnknowProtAdminDistance());
+    } else {
+      route.setPriority(routePair->second);
+    }
+  }
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::addRoutes(std::vector<Route> routes) {
+  VLOG(3) << "NetlinkSocket add " << routes.size() << " routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), rs = std::move(routes)]() mutable {
+        try {
+          doAddUpdateRoutes(std::move(rs));
+          p.setValue();
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error adding routes. Exception: "
+                     << folly::exceptionStr(ex);
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::delRoutes(std::vector<Route> routes) {
+  VLOG(3) << "NetlinkSocket delete " << routes.size() << " routes";
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise), rs = std::move(routes)]() mutable {
+        try {
+          doDeleteRoutes(std::move(rs));
+          p.setValue();
+        } catch (std::exception const& ex) {
+          LOG(ERROR) << "Error deleting routes. Exception: "
+                     << folly::exceptionStr(ex);
+          p.setException(ex);
+        }
+      });
+  return future;
+}
+
+folly::Future<std::map<std::string, int64_t>>
+NetlinkSocket::getRouteBatchCounters() const {
+  folly::Promise<std::map<std::string, int64_t>> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
+    std::map<std::string, int64_t> counters;
+    counters["route_batches"] = routeBatchStats_.numBatches;
+    counters["route_batch_routes"] = routeBatchStats_.numRoutes;
+    counters["route_batch_failures"] = routeBatchStats_.numFailures;
+    counters["route_batch_last_latency_ms"] = routeBatchStats_.lastLatencyMs;
+    counters["route_batch_max_latency_ms"] = routeBatchStats_.maxLatencyMs;
+    // receive stats of the netlink socket
+    const auto recvSyscalls = nlSock_->getRecvSyscallCount();
+    const auto recvMessages = nlSock_->getRecvMessageCount();
+    counters["netlink_recv_syscalls"] = recvSyscalls;
+    counters["netlink_recv_datagrams"] = nlSock_->getRecvDatagramCount();
+    counters["netlink_recv_messages"] = recvMessages;
+    counters["netlink_recv_overruns"] = nlSock_->getRecvOverrunCount();
+    counters["netlink_overrun_resyncs"] = numOverrunResyncs_;
+    counters["netlink_neighbor_failures"] = numNeighborFailures_;
+    counters["netlink_neighbor_failure_routes"] = numNeighborFailureRoutes_;
+    counters["netlink_neighbor_failure_last_routes"] =
+        lastNeighborFailureRoutes_;
+    counters["netlink_repaired_routes"] = repairedRoutes_.size();
+    counters["netlink_message_allocs"] = nlSock_->getMessageAllocCount();
+    counters["netlink_message_reuses"] = nlSock_->getMessageReuseCount();
+    counters["netlink_suppressed_route_events"] =
+        nlSock_->getSuppressedRouteEventCount();
+    counters["netlink_recv_messages_per_syscall"] =
+        recvSyscalls ? recvMessages / recvSyscalls : 0;
+    if (enableNexthopObjects_) {
+      counters["nexthop_groups"] = nexthopGroups_.size();
+      counters["nexthop_objects"] = nexthopObjects_.size();
+      counters["nexthop_group_updates"] = routeBatchStats_.numGroupUpdates;
+      counters["nexthop_group_update_routes"] =
+          routeBatchStats_.numGroupUpdateRoutes;
+    }
+    p.setValue(std::move(counters));
+  });
+  return future;
+}
+
+std::vector<int>
+NetlinkSocket::doProgramRoutes(std::vector<Route> const& routes, bool add) {
+  // errors ignored on delete, as in NetlinkProtocolSocket::deleteRoutes()
+  const std::unordered_set<int> ignoredErrors = add
+      ? std::unordered_set<int>{EEXIST}
+      : std::unordered_set<int>{EEXIST, ESRCH, EINVAL};
+
+  std::vector<int> errors;
+  errors.reserve(routes.size());
+  for (size_t start = 0; start < routes.size();
+       start += Netlink::kMaxRouteBatchSize) {
+    const auto end =
+        std::min(routes.size(), start + Netlink::kMaxRouteBatchSize);
+    const std::vector<Route> batch(
+        routes.begin() + start, routes.begin() + end);
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // all requests of the batch are sent before waiting for any ack
+    auto futures = add ? nlSock_->addRoutesAsync(batch)
+                       : nlSock_->deleteRoutesAsync(batch);
+    const auto deadline = startTime + Netlink::kNlRequestTimeout;
+
+    int64_t numFailures{0};
+    // requests of the batch share one deadline
+    for (auto err : waitForAcks(futures, deadline)) {
+      if (ignoredErrors.count(err)) {
+        err = 0;
+      }
+      if (err != 0) {
+        ++numFailures;
+      }
+      errors.emplace_back(err);
+    }
+
+    const auto latencyMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime)
+            .count();
+    ++routeBatchStats_.numBatches;
+    routeBatchStats_.numRoutes += batch.size();
+    routeBatchStats_.numFailures += numFailures;
+    routeBatchStats_.lastLatencyMs = latencyMs;
+    routeBatchStats_.maxLatencyMs =
+        std::max(routeBatchStats_.maxLatencyMs, latencyMs);
+    LOG(INFO) << (add ? "Added " : "Deleted ") << batch.size() - numFailures
+              << " of " << batch.size() << " routes in " << latencyMs << "ms";
+  }
+  return errors;
+}
+
+void
+NetlinkSocket::doAddUpdateRoutes(std::vector<Route> routes) {
+  const auto numRoutes = routes.size();
+  for (auto& route : routes) {
+    if (route.getFamily() != AF_MPLS) {
+      pruneFailedNextHops(route);
+    }
+  }
+  if (enableNexthopObjects_) {
+    routes = doUpdateNexthopGroups(std::move(routes));
+  }
+
+  // routes which changed, and V6 routes they replace. As in
+  // doAddUpdateUnicastRoute() those are deleted explicitly first
+  std::vector<Route> toAdd;
+  std::vector<Route> toReplace;
+  std::vector<size_t> replacedBy;
+  // nexthop group of the route each route in toAdd replaces, if any
+  std::vector<folly::Optional<uint32_t>> oldGroupIds;
+  // nexthop group references to drop once routes are programmed
+  std::vector<uint32_t> releasedGroupIds;
+  int64_t numFailures{0};
+  std::string lastError;
+
+  for (auto& route : routes) {
+    if (route.getFamily() == AF_MPLS) {
+      auto label = route.getMplsLabel();
+      if (!label.hasValue()) {
+        LOG(ERROR) << "MPLS route add - no label provided";
+        continue;
+      }
+      auto& mplsRoutes = mplsRoutesCache_[route.getProtocolId()];
+      auto mplsRouteEntry = mplsRoutes.find(label.value());
+      // Same route
+      if (mplsRouteEntry != mplsRoutes.end() &&
+          mplsRouteEntry->second == route) {
+        continue;
+      }
+      toAdd.emplace_back(std::move(route));
+      oldGroupIds.emplace_back(folly::none);
+      continue;
+    }
+
+    uint8_t type = route.getType();
+    if (type != RTN_UNICAST && type != RTN_BLACKHOLE) {
+      ++numFailures;
+      lastError = folly::sformat("Unsupported route type {}", (int)type);
+      continue;
+    }
+    try {
+      checkUnicastRoute(route);
+    } catch (fbnl::NlException const& ex) {
+      ++numFailures;
+      lastError = ex.what();
+      continue;
+    }
+
+    const auto& dest = route.getDestination();
+    setDefaultPriority(route);
+    // Same route
+    if (unicastRoutesCache_.isSameRoute(route)) {
+      continue;
+    }
+    if (dest.first.isV6()) {
+      auto oldRoute = unicastRoutesCache_.get(route.getProtocolId(), dest);
+      if (oldRoute.hasValue()) {
+        toReplace.emplace_back(std::move(oldRoute.value()));
+        replacedBy.emplace_back(toAdd.size());
+      }
+    }
+    oldGroupIds.emplace_back(
+        unicastRoutesCache_.getNexthopGroupId(route.getProtocolId(), dest));
+    toAdd.emplace_back(std::move(route));
+  }
+
+  // routes not to add, as the route they replace couldn't be deleted
+  std::vector<bool> skipped(toAdd.size(), false);
+  const auto replaceErrors = doProgramRoutes(toReplace, false);
+  for (size_t i = 0; i < toReplace.size(); ++i) {
+    if (replaceErrors[i] != 0) {
+      ++numFailures;
+      lastError = folly::sformat(
+          "Failed to delete route\n{}\nError: {}",
+          toReplace[i].str(),
+          replaceErrors[i]);
+      skipped[replacedBy[i]] = true;
+      continue;
+    }
+    auto& oldGroupId = oldGroupIds[replacedBy[i]];
+    if (oldGroupId.hasValue()) {
+      releasedGroupIds.emplace_back(oldGroupId.value());
+      oldGroupId.clear();
+    }
+  }
+
+  // Remove routes from cache, added back on successful addition
+  std::vector<Route> batch;
+  std::vector<folly::Optional<uint32_t>> batchOldGroupIds;
+  batch.reserve(toAdd.size());
+  for (size_t i = 0; i < toAdd.size(); ++i) {
+    if (skipped[i]) {
+      continue;
+    }
+    batchOldGroupIds.emplace_back(oldGroupIds[i]);
+    auto& route = toAdd[i];
+    if (route.getFamily() == AF_MPLS) {
+      mplsRoutesCache_[route.getProtocolId()].erase(
+          route.getMplsLabel().value());
+    } else {
+      unicastRoutesCache_.erase(route.getProtocolId(), route.getDestination());
+    }
+    batch.emplace_back(std::move(route));
+  }
+
+  if (enableNexthopObjects_) {
+    doAcquireNexthopGroups(batch);
+  }
+  const auto addErrors = doProgramRoutes(batch, true);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    auto& route = batch[i];
+    if (addErrors[i] != 0) {
+      ++numFailures;
+      lastError = folly::sformat(
+          "Could not add route\n{}\nError: {}", route.str(), addErrors[i]);
+      // the route replaced may still use its group
+      if (route.getNexthopGroupId().hasValue()) {
+        releasedGroupIds.emplace_back(route.getNexthopGroupId().value());
+      }
+      continue;
+    }
+    if (batchOldGroupIds[i].hasValue()) {
+      releasedGroupIds.emplace_back(batchOldGroupIds[i].value());
+    }
+    if (route.getFamily() == AF_MPLS) {
+      auto label = static_cast<int32_t>(route.getMplsLabel().value());
+      mplsRoutesCache_[route.getProtocolId()].emplace(label, std::move(route));
+    } else {
+      unicastRoutesCache_.update(route);
+    }
+  }
+
+  if (enableNexthopObjects_) {
+    doReleaseNexthopGroups(releasedGroupIds);
+  }
+
+  if (numFailures) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to add {} of {} routes. Last error: {}",
+        numFailures,
+        numRoutes,
+        lastError));
+  }
+}
+
+void
+NetlinkSocket::doDeleteRoutes(std::vector<Route> routes) {
+  std::vector<Route> toDelete;
+  int64_t numFailures{0};
+  std::string lastError;
+
+  for (auto& route : routes) {
+    if (route.getFamily() == AF_MPLS) {
+      auto label = route.getMplsLabel();
+      if (!label.hasValue()) {
+        continue;
+      }
+      if (mplsRoutesCache_[route.getProtocolId()].count(label.value()) == 0) {
+        LOG(ERROR) << "Trying to delete non-existing label: " << label.value();
+        continue;
+      }
+      toDelete.emplace_back(std::move(route));
+      continue;
+    }
+
+    uint8_t type = route.getType();
+    if (type != RTN_UNICAST && type != RTN_BLACKHOLE) {
+      ++numFailures;
+      lastError = folly::sformat("Unsupported route type {}", (int)type);
+      continue;
+    }
+    try {
+      checkUnicastRoute(route);
+    } catch (fbnl::NlException const& ex) {
+      ++numFailures;
+      lastError = ex.what();
+      continue;
+    }
+    const auto& prefix = route.getDestination();
+    if (!unicastRoutesCache_.contains(route.getProtocolId(), prefix)) {
+      LOG(ERROR) << "Trying to delete non-existing prefix "
+                 << folly::IPAddress::networkToString(prefix);
+      continue;
+    }
+    toDelete.emplace_back(std::move(route));
+  }
+
+  const auto errors = doProgramRoutes(toDelete, false);
+  std::vector<uint32_t> releasedGroupIds;
+  for (size_t i = 0; i < toDelete.size(); ++i) {
+    auto const& route = toDelete[i];
+    if (errors[i] != 0) {
+      ++numFailures;
+      lastError = folly::sformat(
+          "Failed to delete route\n{}\nError: {}", route.str(), errors[i]);
+      continue;
+    }
+    // Update local cache with removed route
+    if (route.getFamily() == AF_MPLS) {
+      mplsRoutesCache_[route.getProtocolId()].erase(
+          route.getMplsLabel().value());
+    } else {
+      auto groupId = unicastRoutesCache_.getNexthopGroupId(
+          route.getProtocolId(), route.getDestination());
+      if (groupId.hasValue()) {
+        releasedGroupIds.emplace_back(groupId.value());
+      }
+      unicastRoutesCache_.erase(route.getProtocolId(), route.getDestination());
+      repairedRoutes_.erase(
+          std::make_pair(route.getProtocolId(), route.getDestination()));
+    }
+  }
+  if (enableNexthopObjects_) {
+    doReleaseNexthopGroups(releasedGroupIds);
+  }
+
+  if (numFailures) {
+    throw fbnl::NlException(folly::sformat(
+        "Failed to delete {} of {} routes. Last error: {}",
+        numFailures,
+        routes.size(),
+        lastError));
+  }
+}
+
+bool
+NetlinkSocket::isNexthopGroupRoute(const Route& route) const {
+  if (!enableNexthopObjects_ || route.getType() != RTN_UNICAST ||
+      route.getFamily() == AF_MPLS || route.getNextHops().empty()) {
+    return false;
+  }
+  // only IP nexthops of the family of the route, others are encoded in
+  // RTA_MULTIPATH as before
+  const auto family = route.getDestination().first.family();
+  for (auto const& nextHop : route.getNextHops()) {
+    if (nextHop.getLabelAction().hasValue() ||
+        nextHop.getPushLabels().hasValue() ||
+        !nextHop.getIfIndex().hasValue() ||
+        !nextHop.getGateway().hasValue() ||
+        nextHop.getGateway()->family() != family) {
+      return false;
+    }
+  }
+  return true;
+}
+
+folly::Optional<std::vector<uint32_t>>
+NetlinkSocket::getNexthopIds(const NextHopSet& nextHops) const {
+  std::vector<uint32_t> ids;
+  ids.reserve(nextHops.size());
+  for (auto const& nextHop : nextHops) {
+    auto iter = nexthopObjects_.find(nextHop);
+    if (iter == nexthopObjects_.end()) {
+      return folly::none;
+    }
+    ids.emplace_back(iter->second.id);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+std::vector<Route>
+NetlinkSocket::doUpdateNexthopGroups(std::vector<Route> routes) {
+  // routes moving off a nexthop group, and their new nexthops
+  struct GroupUpdate {
+    NextHopSet nextHops;
+    std::vector<size_t> routes;
+    bool isValid{true};
+  };
+  std::unordered_map<uint32_t, GroupUpdate> updates;
+
+  for (size_t i = 0; i < routes.size(); ++i) {
+    auto& route = routes[i];
+    if (!isNexthopGroupRoute(route)) {
+      continue;
+    }
+    setDefaultPriority(route);
+    auto groupId = unicastRoutesCache_.getNexthopGroupId(
+        route.getProtocolId(), route.getDestination());
+    if (!groupId.hasValue() || unicastRoutesCache_.isSameRoute(route)) {
+      continue;
+    }
+    auto& update = updates[groupId.value()];
+    auto oldRoute =
+        unicastRoutesCache_.get(route.getProtocolId(), route.getDestination());
+    if (!isSameRouteExceptNextHops(oldRoute.value(), route)) {
+      // route is rewritten anyway
+      update.isValid = false;
+    } else if (update.routes.empty()) {
+      update.nextHops = route.getNextHops();
+    } else if (update.nextHops != route.getNextHops()) {
+      update.isValid = false;
+    }
+    update.routes.emplace_back(i);
+  }
+
+  // groups of which all routes move to the same nexthops, if no other group
+  // has those nexthops already
+  std::vector<uint32_t> groupIds;
+  std::vector<NextHopSet const*> nextHopSets;
+  for (auto const& kv : updates) {
+    auto const& update = kv.second;
+    auto groupIter = nexthopGroups_.find(kv.first);
+    if (!update.isValid || groupIter == nexthopGroups_.end() ||
+        update.routes.size() != groupIter->second.refCount) {
+      continue;
+    }
+    auto memberIds = getNexthopIds(update.nextHops);
+    if (memberIds.hasValue() && nexthopGroupIds_.count(memberIds.value())) {
+      continue;
+    }
+    groupIds.emplace_back(kv.first);
+    nextHopSets.emplace_back(&update.nextHops);
+  }
+  if (groupIds.empty()) {
+    return routes;
+  }
+
+  auto releasedNextHops = doCreateNexthops(nextHopSets);
+
+  // replace members of groups in place
+  std::vector<size_t> replaced;
+  std::vector<std::vector<uint32_t>> replacedMemberIds;
+  std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs;
+  for (size_t i = 0; i < groupIds.size(); ++i) {
+    auto memberIds = getNexthopIds(*nextHopSets[i]);
+    if (!memberIds.hasValue()) {
+      continue;
+    }
+    auto msg = std::make_unique<Netlink::NetlinkNexthopMessage>();
+    if (msg->addNexthopGroup(
+            groupIds[i], memberIds.value(), DEFAULT_PROTOCOL_ID, true) !=
+        Netlink::ResultCode::SUCCESS) {
+      LOG(ERROR) << "Error encoding nexthop group " << groupIds[i];
+      continue;
+    }
+    msgs.emplace_back(std::move(msg));
+    replaced.emplace_back(i);
+    replacedMemberIds.emplace_back(std::move(memberIds.value()));
+  }
+  const auto errors = doSendNexthopMessages(std::move(msgs));
+
+  std::vector<bool> isUpdated(routes.size(), false);
+  for (size_t j = 0; j < replaced.size(); ++j) {
+    const auto groupId = groupIds[replaced[j]];
+    if (errors[j] != 0) {
+      LOG(ERROR) << "Failed to update nexthop group " << groupId
+                 << " Error: " << errors[j];
+      continue;
+    }
+    auto const& nextHops = *nextHopSets[replaced[j]];
+    auto& group = nexthopGroups_.at(groupId);
+    for (auto const& nextHop : nextHops) {
+      ++nexthopObjects_.at(nextHop).refCount;
+    }
+    for (auto const& nextHop : group.members) {
+      --nexthopObjects_.at(nextHop).refCount;
+      releasedNextHops.emplace_back(nextHop);
+    }
+    nexthopGroupIds_.erase(group.memberIds);
+    nexthopGroupIds_.emplace(replacedMemberIds[j], groupId);
+    group.memberIds = std::move(replacedMemberIds[j]);
+    group.members.assign(nextHops.begin(), nextHops.end());
+
+    // routes now use the new nexthops without being rewritten
+    auto const& update = updates.at(groupId);
+    for (auto index : update.routes) {
+      auto& route = routes[index];
+      route.setNexthopGroupId(groupId);
+      unicastRoutesCache_.update(route);
+      isUpdated[index] = true;
+    }
+    ++routeBatchStats_.numGroupUpdates;
+    routeBatchStats_.numGroupUpdateRoutes += update.routes.size();
+    VLOG(1) << "Updated nexthop group " << groupId << " of "
+            << update.routes.size() << " routes";
+  }
+  doDeleteUnusedNexthops(releasedNextHops);
+
+  std::vector<Route> remaining;
+  for (size_t i = 0; i < routes.size(); ++i) {
+    if (!isUpdated[i]) {
+      remaining.emplace_back(std::move(routes[i]));
+    }
+  }
+  return remaining;
+}
+
+void
+NetlinkSocket::doAcquireNexthopGroups(std::vector<Route>& routes) {
+  std::vector<NextHopSet const*> nextHopSets;
+  for (auto& route : routes) {
+    route.setNexthopGroupId(folly::none);
+    if (isNexthopGroupRoute(route)) {
+      nextHopSets.emplace_back(&route.getNextHops());
+    }
+  }
+  if (nextHopSets.empty()) {
+    return;
+  }
+  const auto createdNextHops = doCreateNexthops(nextHopSets);
+
+  // groups missing for nexthops of routes
+  std::vector<std::vector<uint32_t>> newGroups;
+  std::vector<NextHopSet const*> newGroupNextHops;
+  std::set<std::vector<uint32_t>> seen;
+  for (auto const* nextHops : nextHopSets) {
+    auto memberIds = getNexthopIds(*nextHops);
+    if (!memberIds.hasValue() || nexthopGroupIds_.count(memberIds.value()) ||
+        !seen.insert(memberIds.value()).second) {
+      continue;
+    }
+    newGroups.emplace_back(std::move(memberIds.value()));
+    newGroupNextHops.emplace_back(nextHops);
+  }
+  const auto ids = doCreateNexthopObjects(
+      newGroups.size(),
+      [&newGroups](
+          Netlink::NetlinkNexthopMessage& msg, size_t index, uint32_t id) {
+        return msg.addNexthopGroup(
+            id, newGroups[index], DEFAULT_PROTOCOL_ID, false);
+      });
+  for (size_t i = 0; i < newGroups.size(); ++i) {
+    if (!ids[i].hasValue()) {
+      continue;
+    }
+    NexthopGroup group;
+    group.memberIds = newGroups[i];
+    group.members.assign(
+        newGroupNextHops[i]->begin(), newGroupNextHops[i]->end());
+    for (auto const& nextHop : group.members) {
+      ++nexthopObjects_.at(nextHop).refCount;
+    }
+    nexthopGroupIds_.emplace(std::move(newGroups[i]), ids[i].value());
+    nexthopGroups_.emplace(ids[i].value(), std::move(group));
+  }
+
+  // routes without group are programmed with their nexthops
+  for (auto& route : routes) {
+    if (!isNexthopGroupRoute(route)) {
+      continue;
+    }
+    auto memberIds = getNexthopIds(route.getNextHops());
+    if (!memberIds.hasValue()) {
+      continue;
+    }
+    auto iter = nexthopGroupIds_.find(memberIds.value());
+    if (iter == nexthopGroupIds_.end()) {
+      continue;
+    }
+    ++nexthopGroups_.at(iter->second).refCount;
+    route.setNexthopGroupId(iter->second);
+  }
+
+  // nexthop objects of groups which couldn't be created
+  doDeleteUnusedNexthops(createdNextHops);
+}
+
+void
+NetlinkSocket::doReleaseNexthopGroups(std::vector<uint32_t> const& groupIds) {
+  std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs;
+  std::vector<NextHop> releasedNextHops;
+  for (auto groupId : groupIds) {
+    auto iter = nexthopGroups_.find(groupId);
+    if (iter == nexthopGroups_.end()) {
+      // group not created by us, e.g. by a previous run
+      continue;
+    }
+    auto& group = iter->second;
+    if (group.refCount > 0) {
+      --group.refCount;
+    }
+    if (group.refCount > 0) {
+      continue;
+    }
+    auto msg = std::make_unique<Netlink::NetlinkNexthopMessage>();
+    if (msg->deleteNexthop(groupId) == Netlink::ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(msg));
+    }
+    for (auto const& nextHop : group.members) {
+      --nexthopObjects_.at(nextHop).refCount;
+      releasedNextHops.emplace_back(nextHop);
+    }
+    nexthopGroupIds_.erase(group.memberIds);
+    nexthopGroups_.erase(iter);
+  }
+  for (auto err : doSendNexthopMessages(std::move(msgs))) {
+    if (err != 0) {
+      LOG(ERROR) << "Failed to delete nexthop group. Error: " << err;
+    }
+  }
+  // members are deleted once no group uses them
+  doDeleteUnusedNexthops(releasedNextHops);
+}
+
+std::vector<NextHop>
+NetlinkSocket::doCreateNexthops(
+    std::vector<NextHopSet const*> const& nextHopSets) {
+  std::vector<NextHop> nextHops;
+  // may span nexthops of many groups, so hashed unlike NextHopSet
+  std::unordered_set<NextHop, NextHopHash> seen;
+  for (auto const* nextHopSet : nextHopSets) {
+    for (auto const& nextHop : *nextHopSet) {
+      if (!nexthopObjects_.count(nextHop) && seen.insert(nextHop).second) {
+        nextHops.emplace_back(nextHop);
+      }
+    }
+  }
+  const auto ids = doCreateNexthopObjects(
+      nextHops.size(),
+      [&nextHops](
+          Netlink::NetlinkNexthopMessage& msg, size_t index, uint32_t id) {
+        return msg.addNexthop(id, nextHops[index], DEFAULT_PROTOCOL_ID, false);
+      });
+
+  std::vector<NextHop> created;
+  for (size_t i = 0; i < nextHops.size(); ++i) {
+    if (!ids[i].hasValue()) {
+      continue;
+    }
+    NexthopObject object;
+    object.id = ids[i].value();
+    nexthopObjects_.emplace(nextHops[i], object);
+    created.emplace_back(nextHops[i]);
+  }
+  return created;
+}
+
+std::vector<folly::Optional<uint32_t>>
+NetlinkSocket::doCreateNexthopObjects(
+    size_t count,
+    std::function<Netlink::ResultCode(
+        Netlink::NetlinkNexthopMessage& msg, size_t index, uint32_t id)>
+        makeMsg) {
+  std::vector<folly::Optional<uint32_t>> ids(count);
+  std::vector<size_t> pending(count);
+  std::iota(pending.begin(), pending.end(), 0);
+
+  for (size_t attempt = 0; attempt < kMaxNexthopIdRetries && !pending.empty();
+       ++attempt) {
+    std::vector<std::pair<size_t, uint32_t>> sent;
+    std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs;
+    for (auto index : pending) {
+      // id 0 lets the kernel pick one
+      if (nextNexthopId_ == 0) {
+        ++nextNexthopId_;
+      }
+      const auto id = nextNexthopId_++;
+      auto msg = std::make_unique<Netlink::NetlinkNexthopMessage>();
+      if (makeMsg(*msg, index, id) != Netlink::ResultCode::SUCCESS) {
+        LOG(ERROR) << "Error encoding nexthop object " << id;
+        continue;
+      }
+      sent.emplace_back(index, id);
+      msgs.emplace_back(std::move(msg));
+    }
+
+    const auto errors = doSendNexthopMessages(std::move(msgs));
+    pending.clear();
+    for (size_t i = 0; i < sent.size(); ++i) {
+      if (errors[i] == 0) {
+        ids[sent[i].first] = sent[i].second;
+      } else if (errors[i] == EEXIST) {
+        pending.emplace_back(sent[i].first);
+      } else {
+        LOG(ERROR) << "Failed to create nexthop object " << sent[i].second
+                   << " Error: " << errors[i];
+      }
+    }
+    // ids in use are likely contiguous, skip further ahead on each attempt
+    nextNexthopId_ += pending.size() << attempt;
+  }
+
+  if (!pending.empty()) {
+    LOG(ERROR) << "No free id found for " << pending.size()
+               << " nexthop objects";
+  }
+  return ids;
+}
+
+void
+NetlinkSocket::doDeleteUnusedNexthops(std::vector<NextHop> const& nextHops) {
+  std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs;
+  for (auto const& nextHop : nextHops) {
+    auto iter = nexthopObjects_.find(nextHop);
+    if (iter == nexthopObjects_.end() || iter->second.refCount > 0) {
+      continue;
+    }
+    auto msg = std::make_unique<Netlink::NetlinkNexthopMessage>();
+    if (msg->deleteNexthop(iter->second.id) == Netlink::ResultCode::SUCCESS) {
+      msgs.emplace_back(std::move(msg));
+    }
+    nexthopObjects_.erase(iter);
+  }
+  for (auto err : doSendNexthopMessages(std::move(msgs))) {
+    if (err != 0) {
+      LOG(ERROR) << "Failed to delete nexthop object. Error: " << err;
+    }
+  }
+}
+
+std::vector<int>
+NetlinkSocket::doSendNexthopMessages(
+    std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs) {
+  std::vector<folly::Future<int>> futures;
+  std::vector<std::unique_ptr<Netlink::NetlinkMessage>> nlmsgs;
+  for (auto& msg : msgs) {
+    futures.emplace_back(msg->getFuture());
+    nlmsgs.emplace_back(std::move(msg));
+  }
+  if (nlmsgs.empty()) {
+    return {};
+  }
+  nlSock_->addNetlinkMessage(std::move(nlmsgs));
+  return waitForAcks(
+      futures, std::chrono::steady_clock::now() + Netlink::kNlRequestTimeout);
 }
 
 folly::Future<folly::Unit>
@@ -576,9 +1680,15 @@ void
 NetlinkSocket::doDeleteUnicastRoute(Route route) {
   checkUnicastRoute(route);
 
+  if (enableNexthopObjects_) {
+    std::vector<Route> routes;
+    routes.emplace_back(std::move(route));
+    doDeleteRoutes(std::move(routes));
+    return;
+  }
+
   const auto& prefix = route.getDestination();
-  auto& unicastRoutes = unicastRoutesCache_[route.getProtocolId()];
-  if (unicastRoutes.count(prefix) == 0) {
+  if (!unicastRoutesCache_.contains(route.getProtocolId(), prefix)) {
     LOG(ERROR) << "Trying to delete non-existing prefix "
                << folly::IPAddress::networkToString(prefix);
     return;
@@ -595,7 +1705,9 @@ NetlinkSocket::doDeleteUnicastRoute(Route route) {
   }
 
   // Update local cache with removed prefix
-  unicastRoutes.erase(route.getDestination());
+  unicastRoutesCache_.erase(route.getProtocolId(), route.getDestination());
+  repairedRoutes_.erase(
+      std::make_pair(route.getProtocolId(), route.getDestination()));
 }
 
 void
@@ -706,31 +1818,81 @@ NetlinkSocket::syncUnicastRoutes(
 
 void
 NetlinkSocket::doSyncUnicastRoutes(uint8_t protocolId, NlUnicastRoutes syncDb) {
-  auto& unicastRoutes = unicastRoutesCache_[protocolId];
+  // Single pass over new routeDb. Routes already programmed as they are are
+  // skipped, and routes found in cache are counted, so that cache needs to be
+  // scanned for stale routes only if there are some
+  std::vector<Route> toAdd;
+  size_t numCached{0};
+  for (auto& kv : syncDb) {
+    auto& route = kv.second;
+    if (!unicastRoutesCache_.contains(protocolId, kv.first)) {
+      toAdd.emplace_back(std::move(route));
+      continue;
+    }
+    ++numCached;
+    // Same as in doAddUpdateRoutes(), before comparing with cached route
+    setDefaultPriority(route);
+    if (!unicastRoutesCache_.isSameRoute(route)) {
+      toAdd.emplace_back(std::move(route));
+    }
+  }
 
   // Go over routes that are not in new routeDb, delete
-  std::unordered_set<folly::CIDRNetwork> toDelete;
-  for (auto const& kv : unicastRoutes) {
-    if (syncDb.find(kv.first) == syncDb.end()) {
-      toDelete.insert(kv.first);
-    }
-  }
-  // Delete routes from kernel
-  LOG(INFO) << "Sync: number of routes to delete: " << toDelete.size();
-  for (auto it = toDelete.begin(); it != toDelete.end(); ++it) {
-    auto const& prefix = *it;
-    auto iter = unicastRoutes.find(prefix);
-    if (iter == unicastRoutes.end()) {
-      continue;
+  std::vector<Route> toDelete;
+  if (numCached < unicastRoutesCache_.size(protocolId)) {
+    for (auto const& prefix : unicastRoutesCache_.getPrefixes(protocolId)) {
+      if (syncDb.find(prefix) == syncDb.end()) {
+        toDelete.emplace_back(
+            unicastRoutesCache_.get(protocolId, prefix).value());
+      }
     }
-    doDeleteUnicastRoute(iter->second);
   }
 
-  // Go over routes in new routeDb, update/add
-  LOG(INFO) << "Sync: number of routes to add: " << syncDb.size();
+  LOG(INFO) << "Sync: number of routes to delete: " << toDelete.size()
+            << ", to add or update: " << toAdd.size() << ", unchanged: "
+            << syncDb.size() - toAdd.size();
+
+  // Delete and add routes in kernel, in batches
+  doDeleteRoutes(std::move(toDelete));
+  doAddUpdateRoutes(std::move(toAdd));
+}
+
+void
+NetlinkSocket::doSyncMplsRoutes(uint8_t protocolId, NlMplsRoutes syncDb) {
+  // As doSyncUnicastRoutes(), single pass over new label routes. Labels
+  // programmed as they are, most of them on resync, are not touched
+  auto& mplsRoutes = mplsRoutesCache_[protocolId];
+  std::vector<Route> toAdd;
+  size_t numCached{0};
   for (auto& kv : syncDb) {
-    doAddUpdateUnicastRoute(kv.second);
+    auto it = mplsRoutes.find(kv.first);
+    if (it == mplsRoutes.end()) {
+      toAdd.emplace_back(std::move(kv.second));
+      continue;
+    }
+    ++numCached;
+    if (!(it->second == kv.second)) {
+      toAdd.emplace_back(std::move(kv.second));
+    }
   }
+
+  // Go over labels that are not in new routeDb, delete
+  std::vector<Route> toDelete;
+  if (numCached < mplsRoutes.size()) {
+    for (auto const& kv : mplsRoutes) {
+      if (syncDb.find(kv.first) == syncDb.end()) {
+        toDelete.emplace_back(kv.second);
+      }
+    }
+  }
+
+  LOG(INFO) << "Sync: number of mpls routes to delete: " << toDelete.size()
+            << ", to add or update: " << toAdd.size() << ", unchanged: "
+            << syncDb.size() - toAdd.size();
+
+  // Delete and add label routes in kernel, in batches
+  doDeleteRoutes(std::move(toDelete));
+  doAddUpdateRoutes(std::move(toAdd));
 }
 
 folly::Future<folly::Unit>
@@ -811,16 +1973,53 @@ NetlinkSocket::getCachedUnicastRoutes(uint8_t protocolId) const {
 
   evl_->runImmediatelyOrInEventLoop(
       [this, p = std::move(promise), protocolId]() mutable {
-        auto iter = unicastRoutesCache_.find(protocolId);
-        if (iter != unicastRoutesCache_.end()) {
-          p.setValue(iter->second);
-        } else {
-          p.setValue(NlUnicastRoutes{});
-        }
+        p.setValue(unicastRoutesCache_.getRoutes(protocolId));
       });
   return future;
 }
 
+folly::Future<folly::Unit>
+NetlinkSocket::forEachCachedUnicastRoute(
+    uint8_t protocolId, folly::Function<void(const Route&)> visitor) const {
+  VLOG(3) << "NetlinkSocket forEachCachedUnicastRoute by protocol "
+          << (int)protocolId;
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     p = std::move(promise),
+                                     protocolId,
+                                     visitor = std::move(visitor)]() mutable {
+    unicastRoutesCache_.forEachRoute(
+        protocolId, [&visitor](const Route& route) { visitor(route); });
+    p.setValue();
+  });
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkSocket::forEachCachedMplsRoute(
+    uint8_t protocolId, folly::Function<void(const Route&)> visitor) const {
+  VLOG(3) << "NetlinkSocket forEachCachedMplsRoute by protocol "
+          << (int)protocolId;
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop([this,
+                                     p = std::move(promise),
+                                     protocolId,
+                                     visitor = std::move(visitor)]() mutable {
+    auto iter = mplsRoutesCache_.find(protocolId);
+    if (iter != mplsRoutesCache_.end()) {
+      for (auto const& kv : iter->second) {
+        visitor(kv.second);
+      }
+    }
+    p.setValue();
+  });
+  return future;
+}
+
 folly::Future<NlMulticastRoutes>
 NetlinkSocket::getCachedMulticastRoutes(uint8_t protocolId) const {
   VLOG(3) << "NetlinkSocket getCachedMulticastRoutes by protocol "
@@ -868,10 +2067,7 @@ NetlinkSocket::getRouteCount() const {
   auto future = promise.getFuture();
 
   evl_->runImmediatelyOrInEventLoop([this, p = std::move(promise)]() mutable {
-    int64_t count = 0;
-    for (const auto& routes : unicastRoutesCache_) {
-      count += routes.second.size();
-    }
+    int64_t count = unicastRoutesCache_.size();
     p.setValue(count);
   });
   return future;
@@ -879,19 +2075,10 @@ NetlinkSocket::getRouteCount() const {
 
 folly::Future<int>
 NetlinkSocket::getIfIndex(const std::string& ifName) {
-  folly::Promise<int> promise;
-  auto future = promise.getFuture();
-  evl_->runImmediatelyOrInEventLoop(
-      [this, p = std::move(promise), ifName = folly::copy(ifName)]() mutable {
-        int ifIndex{-1};
-
-        if (links_.count(ifName)) {
-          ifIndex = links_[ifName].ifIndex;
-        }
-
-        p.setValue(ifIndex);
-      });
-  return future;
+  auto const linkIndexes = *linkIndexes_.rlock();
+  auto it = linkIndexes->ifNameToIndex.find(ifName);
+  return folly::makeFuture<int>(
+      it != linkIndexes->ifNameToIndex.end() ? it->second : -1);
 }
 
 folly::Future<folly::Optional<int>>
@@ -906,21 +2093,10 @@ NetlinkSocket::getLoopbackIfindex() {
 
 folly::Future<std::string>
 NetlinkSocket::getIfName(int ifIndex) const {
-  folly::Promise<std::string> promise;
-  auto future = promise.getFuture();
-  evl_->runImmediatelyOrInEventLoop(
-      [this, p = std::move(promise), ifIndex]() mutable {
-        std::string ifName{""};
-
-        for (const auto& linkEntry : links_) {
-          if (linkEntry.second.ifIndex == ifIndex) {
-            ifName = linkEntry.first;
-          }
-        }
-
-        p.setValue(ifName);
-      });
-  return future;
+  auto const linkIndexes = *linkIndexes_.rlock();
+  auto it = linkIndexes->ifIndexToName.find(ifIndex);
+  return folly::makeFuture<std::string>(
+      it != linkIndexes->ifIndexToName.end() ? it->second : "");
 }
 
 folly::Future<folly::Unit>
@@ -1098,6 +2274,21 @@ NetlinkSocket::getAllLinks() {
   return future;
 }
 
+folly::Future<NlLinks>
+NetlinkSocket::getCachedLinks() {
+  VLOG(3) << "NetlinkSocket get cached links...";
+  folly::Promise<NlLinks> promise;
+  auto future = promise.getFuture();
+  evl_->runImmediatelyOrInEventLoop(
+      [this, p = std::move(promise)]() mutable { p.setValue(links_); });
+  return future;
+}
+
+int64_t
+NetlinkSocket::getLinksVersion() const {
+  return linksVersion_.load();
+}
+
 folly::Future<NlNeighbors>
 NetlinkSocket::getAllReachableNeighbors() {
   VLOG(3) << "NetlinkSocket get neighbors...";
@@ -1122,9 +2313,16 @@ NetlinkSocket::getAllReachableNeighbors() {
 
 void
 NetlinkSocket::updateRouteCache() {
-  auto routes = nlSock_->getAllRoutes();
-  for (auto& route : routes) {
-    doHandleRouteEvent(route, false, true);
+  if (cachedRouteProtocols_.empty()) {
+    for (auto& route : nlSock_->getAllRoutes()) {
+      doHandleRouteEvent(route, false, true);
+    }
+    return;
+  }
+  for (auto protocolId : cachedRouteProtocols_) {
+    for (auto& route : nlSock_->getAllRoutes(protocolId)) {
+      doHandleRouteEvent(route, false, true);
+    }
   }
 }
 
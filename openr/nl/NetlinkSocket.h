@@ -7,16 +7,31 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <boost/variant.hpp>
 #include <fbzmq/async/ZmqEventLoop.h>
+#include <fbzmq/async/ZmqTimeout.h>
 #include <folly/AtomicBitSet.h>
+#include <folly/Function.h>
 #include <folly/IPAddress.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <openr/nl/NetlinkMessage.h>
+#include <openr/nl/NetlinkRouteCache.h>
 #include <openr/nl/NetlinkTypes.h>
 
 namespace openr {
+namespace Netlink {
+class NetlinkNexthopMessage;
+} // namespace Netlink
+
 namespace fbnl {
 
 using EventVariant = boost::variant<Route, Neighbor, IfAddress, Link>;
@@ -47,6 +62,13 @@ struct PrefixCmp {
  * A ZmqEventLoop is provided which the implementation uses to register
  * socket fds. Caller is responsible for running the zmq event loop.
  *
+ * For nexthop objects:
+ *   If enableNexthopObjects is set, unicast routes with IP nexthops are
+ *   programmed with kernel nexthop groups (RTA_NH_ID) shared by all routes
+ *   with the same nexthops. When every route of a group moves to the same new
+ *   nexthops in one addRoutes() call, e.g. on link failure, the members of the
+ *   group are replaced in place and the routes themselves are not rewritten
+ *
  * For concurrency model:
  *   User can create the object in main thread. Internally we register fds with
  *   the provided zmq event loop. So user must make sure that the event loop is
@@ -166,7 +188,9 @@ class NetlinkSocket {
   explicit NetlinkSocket(
       fbzmq::ZmqEventLoop* evl,
       EventsHandler* handler = nullptr,
-      std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlSock = nullptr);
+      std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlSock = nullptr,
+      bool enableNexthopObjects = false,
+      std::vector<uint8_t> cachedRouteProtocols = {});
 
   virtual ~NetlinkSocket();
 
@@ -205,6 +229,34 @@ class NetlinkSocket {
    */
   virtual folly::Future<folly::Unit> delMplsRoute(Route route);
 
+  /**
+   * Add or update unicast and MPLS label routes in batches. Requests are
+   * pipelined, up to Netlink::kMaxRouteBatchSize of them outstanding at once,
+   * instead of waiting for the ack of each route. Routes which were programmed
+   * are cached even if others fail
+   * @throws fbnl::NlException if any route couldn't be programmed
+   */
+  virtual folly::Future<folly::Unit> addRoutes(std::vector<Route> routes);
+
+  /**
+   * Delete unicast and MPLS label routes in batches, see addRoutes()
+   * @throws fbnl::NlException if any route couldn't be deleted
+   */
+  virtual folly::Future<folly::Unit> delRoutes(std::vector<Route> routes);
+
+  /**
+   * Counters of batched route programming: number of batches, routes and
+   * failed routes, and latency of batches. With nexthop objects, also number
+   * of nexthop groups and objects, and of groups updated in place. Also
+   * syscalls, datagrams and netlink messages received by the netlink socket,
+   * its receive buffer overruns, route messages it dropped as they answer no
+   * request, and route messages allocated and reused from its pool. Also
+   * neighbor failures, routes via failed neighbors, in total and on last
+   * failure, and routes programmed with nexthops via failed neighbors pruned
+   */
+  virtual folly::Future<std::map<std::string, int64_t>> getRouteBatchCounters()
+      const;
+
   /**
    * Sync route table in kernel with given route table
    * Delete routes that not in the 'newRouteDb' but in kernel
@@ -223,6 +275,23 @@ class NetlinkSocket {
   virtual folly::Future<folly::Unit> syncMplsRoutes(
       uint8_t protocolId, NlMplsRoutes newMplsRouteDb);
 
+  /**
+   * Delete routes of protocolId whose prefix is not in 'prefixes'. Completes
+   * a sync whose routes were added in chunks with addRoutes(), without the
+   * whole route table to sync in memory at once
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> deleteUnicastRoutesExcept(
+      uint8_t protocolId, std::unordered_set<folly::CIDRNetwork> prefixes);
+
+  /**
+   * Delete MPLS label routes of protocolId whose label is not in 'labels',
+   * see deleteUnicastRoutesExcept()
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> deleteMplsRoutesExcept(
+      uint8_t protocolId, std::unordered_set<int32_t> labels);
+
   /**
    * Delete routes that not in the 'newRouteDb' but in kernel
    * Add/Update routes in 'newRouteDb'
@@ -245,6 +314,19 @@ class NetlinkSocket {
   virtual folly::Future<NlMplsRoutes> getCachedMplsRoutes(
       uint8_t protocolId) const;
 
+  /**
+   * Visit cached unicast or MPLS routes of protocol ID in the netlink event
+   * loop, without copying them into a routing table. Routes are only valid
+   * for the duration of the call. Future is fulfilled once all are visited
+   * @throws fbnl::NlException
+   */
+  virtual folly::Future<folly::Unit> forEachCachedUnicastRoute(
+      uint8_t protocolId,
+      folly::Function<void(const Route&)> visitor) const;
+  virtual folly::Future<folly::Unit> forEachCachedMplsRoute(
+      uint8_t protocolId,
+      folly::Function<void(const Route&)> visitor) const;
+
   /**
    * Get cached multicast routing by protocol ID
    * @throws fbnl::NlException
@@ -314,6 +396,7 @@ class NetlinkSocket {
   /**
    * Get interface index from name
    * -1 means no such interface
+   * Resolved right away in the calling thread, see linkIndexes_
    * @throws fbnl::NlException
    */
   virtual folly::Future<int> getIfIndex(const std::string& ifName);
@@ -325,6 +408,7 @@ class NetlinkSocket {
 
   /**
    * Get interface name form index
+   * Resolved right away in the calling thread, see linkIndexes_
    * @throws fbnl::NlException
    */
   virtual folly::Future<std::string> getIfName(int ifIndex) const;
@@ -337,6 +421,20 @@ class NetlinkSocket {
    */
   virtual folly::Future<NlLinks> getAllLinks();
 
+  /**
+   * Get all links entries as kept up to date by link and address events,
+   * without dumping them from the kernel
+   */
+  virtual folly::Future<NlLinks> getCachedLinks();
+
+  /**
+   * Version of the links cache, bumped whenever a link is added, changes
+   * ifIndex or status, or gains or loses an address. Callers can compare
+   * versions to tell whether links changed without reading them.
+   * Resolved right away in the calling thread
+   */
+  int64_t getLinksVersion() const;
+
   /**
    * Get all the neighbor entries
    * This can be used to obtain link addresses of nextHops
@@ -379,10 +477,83 @@ class NetlinkSocket {
 
   void doHandleNeighborEvent(Neighbor neighbor, bool runHandler) noexcept;
 
+  // Whether nexthop is via a neighbor in failedGateways_
+  bool isFailedNextHop(const NextHop& nextHop) const;
+
+  // Prune nexthops via failed neighbors off unicast route to program, unless
+  // all of its nexthops are. Route as requested is kept in repairedRoutes_
+  // while it is programmed with pruned nexthops
+  void pruneFailedNextHops(Route& route);
+
+  // Reprogram client routes via neighbor when its address resolution fails
+  // (NUD_FAILED), or when it no longer has failed. Routes are found by the
+  // gateway index of route cache, or among repaired routes, without a scan
+  // of all routes
+  void doRepairRoutesViaNeighbor(const Neighbor& neighbor) noexcept;
+
+  // Dump links, addresses and neighbors after a receive buffer overrun and
+  // reconcile caches with them. Handlers get events only for changes missed,
+  // including links gone down and addresses removed meanwhile. Routes are
+  // not resynced, route events are not received
+  void doResyncAfterOverrun() noexcept;
+
   void doUpdateRouteCache(Route route, bool updateUnicastRoute = false);
 
   void doAddUpdateUnicastRoute(Route route);
 
+  // set priority of protocol if route has none
+  void setDefaultPriority(Route& route) const;
+
+  void doAddUpdateRoutes(std::vector<Route> routes);
+
+  void doDeleteRoutes(std::vector<Route> routes);
+
+  // send add or delete requests of routes in batches of at most
+  // Netlink::kMaxRouteBatchSize outstanding requests. Returns the error code of
+  // each route, 0 on success or for errors ignored on delete
+  std::vector<int> doProgramRoutes(std::vector<Route> const& routes, bool add);
+
+  // whether route is programmed with a kernel nexthop group
+  bool isNexthopGroupRoute(const Route& route) const;
+
+  // sorted ids of nexthop objects of nextHops, none if any is missing
+  folly::Optional<std::vector<uint32_t>> getNexthopIds(
+      const NextHopSet& nextHops) const;
+
+  // replace in place members of nexthop groups whose routes all move to the
+  // same new nexthops. Returns the routes which still need to be programmed
+  std::vector<Route> doUpdateNexthopGroups(std::vector<Route> routes);
+
+  // set nexthop group of routes to be programmed with one, creating missing
+  // nexthop objects and groups, and take a reference of it for each route
+  void doAcquireNexthopGroups(std::vector<Route>& routes);
+
+  // drop one reference of each group, deleting unused groups and nexthop
+  // objects used by no group
+  void doReleaseNexthopGroups(std::vector<uint32_t> const& groupIds);
+
+  // create nexthop objects missing for nextHopSets, unused by any group yet.
+  // Returns their nexthops
+  std::vector<NextHop> doCreateNexthops(
+      std::vector<NextHopSet const*> const& nextHopSets);
+
+  // create count kernel nexthop objects or groups, encoded by makeMsg with
+  // a new id. Ids already used in the kernel, e.g. by a previous run, are
+  // skipped. Returns the id of each object, none if it couldn't be created
+  std::vector<folly::Optional<uint32_t>> doCreateNexthopObjects(
+      size_t count,
+      std::function<Netlink::ResultCode(
+          Netlink::NetlinkNexthopMessage& msg, size_t index, uint32_t id)>
+          makeMsg);
+
+  // delete nexthop objects of nextHops used by no group
+  void doDeleteUnusedNexthops(std::vector<NextHop> const& nextHops);
+
+  // send nexthop messages and wait for their acks. Returns the error code of
+  // each message, 0 on success
+  std::vector<int> doSendNexthopMessages(
+      std::vector<std::unique_ptr<Netlink::NetlinkNexthopMessage>> msgs);
+
   void doDeleteUnicastRoute(Route route);
 
   void doAddUpdateMplsRoute(Route route);
@@ -395,6 +566,8 @@ class NetlinkSocket {
 
   void doSyncUnicastRoutes(uint8_t protocolId, NlUnicastRoutes syncDb);
 
+  void doSyncMplsRoutes(uint8_t protocolId, NlMplsRoutes syncDb);
+
   void doSyncLinkRoutes(uint8_t protocolId, NlLinkRoutes syncDb);
 
   void checkMulticastRoute(const Route& route);
@@ -420,11 +593,17 @@ class NetlinkSocket {
  private:
   fbzmq::ZmqEventLoop* evl_{nullptr};
 
+  // resync of links, addresses and neighbors, deferred after an overrun so
+  // that overruns of one burst of events share a single resync
+  std::unique_ptr<fbzmq::ZmqTimeout> overrunResyncTimer_{nullptr};
+  int64_t numOverrunResyncs_{0};
+
   /**
    * Local cache. We do not use this to enforce any checks
-   * for incoming requests. Merely an optimization for get cached routes
+   * for incoming requests. Merely an optimization for get cached routes.
+   * Kept in compact form, routes are rebuilt when read
    */
-  NlUnicastRoutesDb unicastRoutesCache_;
+  UnicastRouteCache unicastRoutesCache_;
 
   /**
    * MPLS label route cache
@@ -447,11 +626,84 @@ class NetlinkSocket {
   NlNeighbors neighbors_{};
   NlLinks links_{};
 
+  // Version of links_, see getLinksVersion()
+  std::atomic<int64_t> linksVersion_{0};
+
+  // Interface names and indexes of links_, for lookups from any thread
+  // without hopping onto the event loop. Readers take the current snapshot,
+  // the event loop replaces it with an updated copy on link changes
+  struct LinkIndexes {
+    std::unordered_map<std::string, int> ifNameToIndex;
+    std::unordered_map<int, std::string> ifIndexToName;
+  };
+  folly::Synchronized<std::shared_ptr<const LinkIndexes>> linkIndexes_{
+      std::make_shared<const LinkIndexes>()};
+
+  // Update linkIndexes_ with ifIndex of link ifName
+  void updateLinkIndexes(const std::string& ifName, int ifIndex);
+
+  // Neighbors which failed address resolution, address => ifIndexes
+  std::unordered_map<folly::IPAddress, std::unordered_set<int>>
+      failedGateways_;
+
+  // Routes as requested, of routes programmed with nexthops via failed
+  // neighbors pruned
+  std::unordered_map<std::pair<uint8_t, folly::CIDRNetwork>, Route>
+      repairedRoutes_;
+
+  // Neighbor failures, routes via failed neighbors in total and on last one
+  int64_t numNeighborFailures_{0};
+  int64_t numNeighborFailureRoutes_{0};
+  int64_t lastNeighborFailureRoutes_{0};
+
   // Indicating to run which event type's handler
   folly::AtomicBitSet<MAX_EVENT_TYPE> eventFlags_;
 
   std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlSock_{nullptr};
 
+  // stats of batched route programming
+  struct RouteBatchStats {
+    int64_t numBatches{0};
+    int64_t numRoutes{0};
+    int64_t numFailures{0};
+    int64_t lastLatencyMs{0};
+    int64_t maxLatencyMs{0};
+    // nexthop groups updated in place, and routes moved by them
+    int64_t numGroupUpdates{0};
+    int64_t numGroupUpdateRoutes{0};
+  } routeBatchStats_;
+
+  // program unicast routes with kernel nexthop groups
+  const bool enableNexthopObjects_{false};
+
+  // protocols of kernel routes loaded in route caches, all if empty
+  const std::vector<uint8_t> cachedRouteProtocols_;
+
+  // kernel nexthop object of a single nexthop, shared by nexthop groups
+  struct NexthopObject {
+    uint32_t id{0};
+    // number of nexthop groups using it
+    uint32_t refCount{0};
+  };
+  std::unordered_map<NextHop, NexthopObject, NextHopHash> nexthopObjects_;
+
+  // kernel nexthop group, shared by routes with the same nexthops
+  struct NexthopGroup {
+    // sorted ids of member nexthop objects, and their nexthops
+    std::vector<uint32_t> memberIds;
+    std::vector<NextHop> members;
+    // number of routes using it
+    uint32_t refCount{0};
+  };
+  std::unordered_map<uint32_t, NexthopGroup> nexthopGroups_;
+
+  // sorted member ids -> nexthop group id
+  std::map<std::vector<uint32_t>, uint32_t> nexthopGroupIds_;
+
+  // next id to try for a nexthop object or group
+  uint32_t nextNexthopId_{1};
+
+
   std::mutex neighborListenerMutex_;
   std::function<void(const NeighborUpdate& neighborUpdate)> neighborListener_{
       nullptr};
@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <iterator>
 #include <set>
 
 #include <glog/logging.h>
@@ -24,10 +26,15 @@ isNeighborReachable(int state) {
 }
 
 Route
-RouteBuilder::build() const {
+RouteBuilder::build() const& {
   return Route(*this);
 }
 
+Route
+RouteBuilder::build() && {
+  return Route(std::move(*this));
+}
+
 Route
 RouteBuilder::buildFromObject(struct rtnl_route* obj) {
   return loadFromObject(obj).build();
@@ -277,11 +284,34 @@ RouteBuilder::addNextHop(const NextHop& nextHop) {
   return *this;
 }
 
+RouteBuilder&
+RouteBuilder::addNextHop(NextHop&& nextHop) {
+  nextHops_.insert(std::move(nextHop));
+  return *this;
+}
+
+RouteBuilder&
+RouteBuilder::reserveNextHops(size_t numNextHops) {
+  nextHops_.reserve(numNextHops);
+  return *this;
+}
+
 const NextHopSet&
 RouteBuilder::getNextHops() const {
   return nextHops_;
 }
 
+RouteBuilder&
+RouteBuilder::setNexthopGroupId(uint32_t nexthopGroupId) {
+  nexthopGroupId_ = nexthopGroupId;
+  return *this;
+}
+
+folly::Optional<uint32_t>
+RouteBuilder::getNexthopGroupId() const {
+  return nexthopGroupId_;
+}
+
 uint8_t
 RouteBuilder::getFamily() const {
   return family_;
@@ -312,6 +342,7 @@ RouteBuilder::reset() {
   advMss_.clear();
   nextHops_.clear();
   routeIfName_.clear();
+  nexthopGroupId_.clear();
 }
 
 Route::Route(const RouteBuilder& builder)
@@ -329,7 +360,26 @@ Route::Route(const RouteBuilder& builder)
       nextHops_(builder.getNextHops()),
       dst_(builder.getDestination()),
       routeIfName_(builder.getRouteIfName()),
-      mplsLabel_(builder.getMplsLabel()) {}
+      mplsLabel_(builder.getMplsLabel()),
+      nexthopGroupId_(builder.getNexthopGroupId()) {}
+
+Route::Route(RouteBuilder&& builder)
+    : type_(builder.type_),
+      routeTable_(builder.routeTable_),
+      protocolId_(builder.protocolId_),
+      scope_(builder.scope_),
+      family_(builder.family_),
+      isValid_(builder.isValid_),
+      flags_(builder.flags_),
+      priority_(builder.priority_),
+      tos_(builder.tos_),
+      mtu_(builder.mtu_),
+      advMss_(builder.advMss_),
+      nextHops_(std::move(builder.nextHops_)),
+      dst_(builder.dst_),
+      routeIfName_(std::move(builder.routeIfName_)),
+      mplsLabel_(builder.mplsLabel_),
+      nexthopGroupId_(builder.nexthopGroupId_) {}
 
 Route::~Route() {
   if (route_) {
@@ -366,6 +416,7 @@ Route::operator=(Route&& other) noexcept {
   routeIfName_ = std::move(other.routeIfName_);
   family_ = std::move(other.family_);
   mplsLabel_ = std::move(other.mplsLabel_);
+  nexthopGroupId_ = std::move(other.nexthopGroupId_);
   if (route_) {
     rtnl_route_put(route_);
     route_ = nullptr;
@@ -410,6 +461,7 @@ Route::operator=(const Route& other) {
   routeIfName_ = other.routeIfName_;
   family_ = other.family_;
   mplsLabel_ = other.mplsLabel_;
+  nexthopGroupId_ = other.nexthopGroupId_;
   // Free our route_ if any
   if (route_) {
     rtnl_route_put(route_);
@@ -569,6 +621,9 @@ Route::str() const {
   if (advMss_) {
     result += folly::sformat(", advmss {}", advMss_.value());
   }
+  if (nexthopGroupId_) {
+    result += folly::sformat(", nhid {}", nexthopGroupId_.value());
+  }
   for (auto const& nextHop : nextHops_) {
     result += "\n  " + nextHop.str();
   }
@@ -686,6 +741,25 @@ Route::setPriority(uint32_t priority) {
   priority_ = priority;
 }
 
+void
+Route::setNextHops(NextHopSet nextHops) {
+  nextHops_ = std::move(nextHops);
+  if (route_) {
+    rtnl_route_put(route_);
+    route_ = nullptr;
+  }
+}
+
+folly::Optional<uint32_t>
+Route::getNexthopGroupId() const {
+  return nexthopGroupId_;
+}
+
+void
+Route::setNexthopGroupId(folly::Optional<uint32_t> nexthopGroupId) {
+  nexthopGroupId_ = nexthopGroupId;
+}
+
 /*=================================NextHop====================================*/
 
 NextHop
@@ -829,6 +903,74 @@ NextHopHash::operator()(const NextHop& nh) const {
   return res;
 }
 
+constexpr size_t NextHopSet::kInlineNextHops;
+
+NextHopSet::NextHopSet(std::initializer_list<NextHop> nextHops) {
+  nextHops_.reserve(nextHops.size());
+  for (auto const& nextHop : nextHops) {
+    insert(nextHop);
+  }
+}
+
+std::pair<NextHopSet::iterator, bool>
+NextHopSet::insert(const NextHop& nextHop) {
+  auto it = find(nextHop);
+  if (it != end()) {
+    return std::make_pair(it, false);
+  }
+  nextHops_.push_back(nextHop);
+  return std::make_pair(std::prev(end()), true);
+}
+
+std::pair<NextHopSet::iterator, bool>
+NextHopSet::insert(NextHop&& nextHop) {
+  auto it = find(nextHop);
+  if (it != end()) {
+    return std::make_pair(it, false);
+  }
+  nextHops_.push_back(std::move(nextHop));
+  return std::make_pair(std::prev(end()), true);
+}
+
+NextHopSet::iterator
+NextHopSet::find(const NextHop& nextHop) const {
+  return std::find(nextHops_.cbegin(), nextHops_.cend(), nextHop);
+}
+
+size_t
+NextHopSet::count(const NextHop& nextHop) const {
+  return find(nextHop) != end() ? 1 : 0;
+}
+
+size_t
+NextHopSet::erase(const NextHop& nextHop) {
+  auto it = std::find(nextHops_.begin(), nextHops_.end(), nextHop);
+  if (it == nextHops_.end()) {
+    return 0;
+  }
+  nextHops_.erase(it);
+  return 1;
+}
+
+bool
+operator==(const NextHopSet& lhs, const NextHopSet& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  // nexthops are unique in both sets
+  for (auto const& nextHop : lhs) {
+    if (!rhs.count(nextHop)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+operator!=(const NextHopSet& lhs, const NextHopSet& rhs) {
+  return !(lhs == rhs);
+}
+
 folly::Optional<int>
 NextHop::getIfIndex() const {
   return ifIndex_;
@@ -1365,6 +1507,7 @@ NeighborBuilder&
 NeighborBuilder::setState(int state, bool deleted) {
   state_ = state;
   isReachable_ = deleted ? false : isNeighborReachable(state);
+  isFailed_ = !deleted && state == NUD_FAILED;
   return *this;
 }
 
@@ -1378,9 +1521,15 @@ NeighborBuilder::getIsReachable() const {
   return isReachable_;
 }
 
+bool
+NeighborBuilder::getIsFailed() const {
+  return isFailed_;
+}
+
 Neighbor::Neighbor(const NeighborBuilder& builder)
     : ifIndex_(builder.getIfIndex()),
       isReachable_(builder.getIsReachable()),
+      isFailed_(builder.getIsFailed()),
       destination_(builder.getDestination()),
       linkAddress_(builder.getLinkAddress()),
       state_(builder.getState()) {}
@@ -1404,6 +1553,7 @@ Neighbor::operator=(Neighbor&& other) noexcept {
 
   ifIndex_ = other.ifIndex_;
   isReachable_ = other.isReachable_;
+  isFailed_ = other.isFailed_;
   destination_ = other.destination_;
   linkAddress_ = other.linkAddress_;
   state_ = other.state_;
@@ -1431,6 +1581,7 @@ Neighbor::operator=(const Neighbor& other) {
 
   ifIndex_ = other.ifIndex_;
   isReachable_ = other.isReachable_;
+  isFailed_ = other.isFailed_;
   destination_ = other.destination_;
   linkAddress_ = other.linkAddress_;
   state_ = other.state_;
@@ -1475,6 +1626,11 @@ Neighbor::isReachable() const {
   return isReachable_;
 }
 
+bool
+Neighbor::isFailed() const {
+  return isFailed_;
+}
+
 std::string
 Neighbor::str() const {
   std::string stateStr{"n/a"};
@@ -7,14 +7,17 @@
 
 #pragma once
 
+#include <initializer_list>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <folly/Format.h>
 #include <folly/IPAddress.h>
 #include <folly/MacAddress.h>
 #include <folly/Optional.h>
+#include <folly/small_vector.h>
 #include <thrift/lib/cpp2/Thrift.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
@@ -156,7 +159,87 @@ struct NextHopHash {
   size_t operator()(const openr::fbnl::NextHop& nh) const;
 };
 
-using NextHopSet = std::unordered_set<NextHop, NextHopHash>;
+/**
+ * Set of unique nexthops of a route. Nexthops of typical ECMP widths are kept
+ * inline without allocation, and lookup is by linear scan. Iteration follows
+ * insertion order, equality doesn't depend on it.
+ */
+class NextHopSet final {
+ public:
+  // nexthops kept inline before spilling to heap
+  static constexpr size_t kInlineNextHops{4};
+
+  using Storage = folly::small_vector<NextHop, kInlineNextHops>;
+  using value_type = NextHop;
+  using size_type = size_t;
+  // nexthops are immutable once added, like with std::unordered_set
+  using const_iterator = Storage::const_iterator;
+  using iterator = const_iterator;
+
+  NextHopSet() = default;
+  NextHopSet(std::initializer_list<NextHop> nextHops);
+
+  template <typename... Args>
+  std::pair<iterator, bool>
+  emplace(Args&&... args) {
+    return insert(NextHop(std::forward<Args>(args)...));
+  }
+
+  std::pair<iterator, bool> insert(const NextHop& nextHop);
+  std::pair<iterator, bool> insert(NextHop&& nextHop);
+
+  iterator find(const NextHop& nextHop) const;
+
+  size_t count(const NextHop& nextHop) const;
+
+  size_t erase(const NextHop& nextHop);
+
+  void
+  reserve(size_t size) {
+    nextHops_.reserve(size);
+  }
+
+  void
+  clear() {
+    nextHops_.clear();
+  }
+
+  size_t
+  size() const {
+    return nextHops_.size();
+  }
+
+  bool
+  empty() const {
+    return nextHops_.empty();
+  }
+
+  iterator
+  begin() const {
+    return nextHops_.cbegin();
+  }
+
+  iterator
+  end() const {
+    return nextHops_.cend();
+  }
+
+  iterator
+  cbegin() const {
+    return nextHops_.cbegin();
+  }
+
+  iterator
+  cend() const {
+    return nextHops_.cend();
+  }
+
+ private:
+  Storage nextHops_;
+};
+
+bool operator==(const NextHopSet& lhs, const NextHopSet& rhs);
+bool operator!=(const NextHopSet& lhs, const NextHopSet& rhs);
 /**
  * Values for core fields
  * ============================
@@ -198,7 +281,10 @@ class RouteBuilder {
    * ProtocolId, Destination, Nexthop
    * @throw fbnl::NlException on failed
    */
-  Route build() const;
+  Route build() const&;
+
+  // Build route moving fields out of the builder, reset() it before reuse
+  Route build() &&;
 
   Route buildFromObject(struct rtnl_route* obj);
 
@@ -274,6 +360,11 @@ class RouteBuilder {
 
   RouteBuilder& addNextHop(const NextHop& nextHop);
 
+  RouteBuilder& addNextHop(NextHop&& nextHop);
+
+  // Reserve room for nexthops about to be added
+  RouteBuilder& reserveNextHops(size_t numNextHops);
+
   RouteBuilder& setRouteIfName(const std::string& ifName);
 
   folly::Optional<std::string> getRouteIfName() const;
@@ -285,11 +376,18 @@ class RouteBuilder {
 
   const NextHopSet& getNextHops() const;
 
+  // kernel nexthop group used instead of the nexthops, if any
+  RouteBuilder& setNexthopGroupId(uint32_t nexthopGroupId);
+
+  folly::Optional<uint32_t> getNexthopGroupId() const;
+
   uint8_t getFamily() const;
 
   void reset();
 
  private:
+  friend class Route;
+
   uint8_t type_{RTN_UNICAST};
   uint8_t routeTable_{RT_TABLE_MAIN};
   uint8_t protocolId_{DEFAULT_PROTOCOL_ID};
@@ -306,12 +404,14 @@ class RouteBuilder {
   folly::Optional<int> routeIfIndex_; // for multicast or link route
   folly::Optional<std::string> routeIfName_; // for multicast or linkroute
   folly::Optional<uint32_t> mplsLabel_;
+  folly::Optional<uint32_t> nexthopGroupId_;
 };
 
 // Wrapper class for rtnl_route
 class Route final {
  public:
   explicit Route(const RouteBuilder& builder);
+  explicit Route(RouteBuilder&& builder);
   ~Route();
 
   // Copy+Move constructor and assignment operator
@@ -352,6 +452,18 @@ class Route final {
 
   void setPriority(uint32_t priority);
 
+  // Replace nexthops, rtnl_route object is rebuilt on next use
+  void setNextHops(NextHopSet nextHops);
+
+  /**
+   * Kernel nexthop group (RTM_NEWNEXTHOP) the route is programmed with. The
+   * group holds the same nexthops as getNextHops(), and is not compared by
+   * operator==
+   */
+  folly::Optional<uint32_t> getNexthopGroupId() const;
+
+  void setNexthopGroupId(folly::Optional<uint32_t> nexthopGroupId);
+
   std::string str() const;
 
   /**
@@ -387,6 +499,7 @@ class Route final {
   struct rtnl_route* route_{nullptr};
   struct rtnl_route* routeKey_{nullptr};
   folly::Optional<uint32_t> mplsLabel_;
+  folly::Optional<uint32_t> nexthopGroupId_;
 };
 
 bool operator==(const Route& lhs, const Route& rhs);
@@ -524,6 +637,8 @@ class NeighborBuilder final {
 
   bool getIsReachable() const;
 
+  bool getIsFailed() const;
+
   /**
    * NUD_INCOMPLETE
    * NUD_REACHABLE
@@ -541,6 +656,7 @@ class NeighborBuilder final {
  private:
   int ifIndex_{0};
   bool isReachable_{false};
+  bool isFailed_{false};
   folly::IPAddress destination_;
   folly::Optional<folly::MacAddress> linkAddress_;
   folly::Optional<int> state_;
@@ -562,6 +678,9 @@ class Neighbor final {
 
   bool isReachable() const;
 
+  // Address resolution failed (NUD_FAILED), and entry is not deleted
+  bool isFailed() const;
+
   int getFamily() const;
 
   folly::IPAddress getDestination() const;
@@ -577,6 +696,7 @@ class Neighbor final {
  private:
   int ifIndex_{0};
   bool isReachable_{false};
+  bool isFailed_{false};
   folly::IPAddress destination_;
   folly::Optional<folly::MacAddress> linkAddress_;
   folly::Optional<int> state_;
@@ -1210,9 +1210,16 @@ TEST_F(NlMessageFixture, MultipleIpV4RouteLabelNexthop) {
 
   LOG(INFO) << "Getting all routes...";
   // verify Netlink getAllRoutes at scale
+  const auto recvSyscalls = nlSock->getRecvSyscallCount();
+  const auto recvMessages = nlSock->getRecvMessageCount();
   auto kernelRoutes = nlSock->getAllRoutes();
   LOG(INFO) << "Checking if all routes are added to kernel";
   EXPECT_EQ(findRoutesInKernelRoutes(kernelRoutes, routes), count);
+  // dump is received with many messages per syscall
+  EXPECT_GE(nlSock->getRecvMessageCount() - recvMessages, count);
+  EXPECT_LT(
+      (nlSock->getRecvSyscallCount() - recvSyscalls) * kNlRecvBatchSize,
+      count);
 
   // delete routes
   LOG(INFO) << "Deleting in bulk " << count << " routes";
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <malloc.h>
+
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/nl/NetlinkRouteCache.h>
+#include <openr/nl/NetlinkTypes.h>
+
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to another one, with a custom name for
+ * each set of parameters
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FB_STRINGIZE(name) "(" FB_STRINGIZE(param_name) ")",             \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
+namespace openr {
+
+namespace {
+
+const uint8_t kProtocolId = 99;
+
+// Number of distinct sets of nexthops routes are spread over
+const uint32_t kNumNextHopSets = 16;
+
+// Bytes currently allocated from heap
+size_t
+getAllocatedBytes() {
+  return mallinfo().uordblks;
+}
+
+std::vector<fbnl::Route>
+buildRoutes(uint32_t numOfRoutes, uint32_t numOfNextHops) {
+  std::vector<std::vector<fbnl::NextHop>> nextHopSets(kNumNextHopSets);
+  for (uint32_t i = 0; i < kNumNextHopSets; ++i) {
+    for (uint32_t j = 0; j < numOfNextHops; ++j) {
+      fbnl::NextHopBuilder builder;
+      nextHopSets[i].emplace_back(
+          builder.setIfIndex(j + 1)
+              .setGateway(folly::IPAddress(
+                  folly::sformat("fe80::{}:{}", i + 1, j + 1)))
+              .build());
+    }
+  }
+
+  std::vector<fbnl::Route> routes;
+  routes.reserve(numOfRoutes);
+  for (uint32_t i = 0; i < numOfRoutes; ++i) {
+    fbnl::RouteBuilder builder;
+    builder
+        .setDestination(folly::IPAddress::createNetwork(folly::sformat(
+            "fc00:{:x}:{:x}::/64", (i >> 16) & 0xffff, i & 0xffff)))
+        .setProtocolId(kProtocolId)
+        .setValid(true);
+    for (auto const& nextHop : nextHopSets[i % kNumNextHopSets]) {
+      builder.addNextHop(nextHop);
+    }
+    routes.emplace_back(builder.build());
+  }
+  return routes;
+}
+
+} // namespace
+
+/**
+ * Heap memory used per route by the NetlinkSocket unicast route cache, for
+ * Route objects as previously kept in NlUnicastRoutesDb and for compact
+ * UnicastRouteCache. Routes are spread over kNumNextHopSets sets of nexthops
+ */
+static void
+BM_NetlinkRouteCacheMemory(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numOfRoutes,
+    uint32_t numOfNextHops,
+    bool compact) {
+  size_t totalBytes{0};
+  for (uint32_t i = 0; i < iters; ++i) {
+    folly::BenchmarkSuspender suspender;
+    auto routes = buildRoutes(numOfRoutes, numOfNextHops);
+    const auto before = getAllocatedBytes();
+    suspender.dismiss();
+
+    if (compact) {
+      auto cache = std::make_unique<fbnl::UnicastRouteCache>();
+      for (auto const& route : routes) {
+        cache->update(route);
+      }
+      suspender.rehire();
+      totalBytes += getAllocatedBytes() - before;
+    } else {
+      auto cache = std::make_unique<fbnl::NlUnicastRoutesDb>();
+      auto& unicastRoutes = (*cache)[kProtocolId];
+      for (auto const& route : routes) {
+        unicastRoutes.emplace(route.getDestination(), route);
+      }
+      suspender.rehire();
+      totalBytes += getAllocatedBytes() - before;
+    }
+  }
+  counters["bytes_per_route"] = totalBytes / iters / numOfRoutes;
+}
+
+// The parameters are the number of routes, nexthops per route and whether
+// the compact cache is used
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 10000_1_routes, 10000, 1, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 10000_1_compact, 10000, 1, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 10000_4_routes, 10000, 4, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 10000_4_compact, 10000, 4, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 500000_1_routes, 500000, 1, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 500000_1_compact, 500000, 1, true);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 500000_4_routes, 500000, 4, false);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkRouteCacheMemory, counters, 500000_4_compact, 500000, 4, true);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+
+#include <openr/nl/NetlinkRouteCache.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+using namespace openr;
+using namespace openr::fbnl;
+
+namespace {
+
+const uint8_t kProtocolId = 99;
+const uint8_t kOtherProtocolId = 100;
+
+const folly::CIDRNetwork prefix1 =
+    folly::IPAddress::createNetwork("fc00::1/128");
+const folly::CIDRNetwork prefix2 =
+    folly::IPAddress::createNetwork("fc00::/64");
+const folly::CIDRNetwork prefix3 =
+    folly::IPAddress::createNetwork("192.168.0.0/16");
+
+NextHop
+buildNextHop(int ifIndex, const std::string& gateway) {
+  NextHopBuilder builder;
+  return builder.setIfIndex(ifIndex)
+      .setGateway(folly::IPAddress(gateway))
+      .build();
+}
+
+Route
+buildRoute(
+    uint8_t protocolId,
+    const folly::CIDRNetwork& prefix,
+    const std::vector<NextHop>& nextHops) {
+  RouteBuilder builder;
+  builder.setDestination(prefix).setProtocolId(protocolId).setValid(true);
+  for (auto const& nextHop : nextHops) {
+    builder.addNextHop(nextHop);
+  }
+  return builder.build();
+}
+
+} // namespace
+
+TEST(UnicastRouteCache, UpdateGetErase) {
+  UnicastRouteCache cache;
+  const auto nh1 = buildNextHop(1, "fe80::1");
+  const auto nh2 = buildNextHop(2, "fe80::2");
+
+  RouteBuilder builder;
+  auto route1 = builder.setDestination(prefix1)
+                    .setProtocolId(kProtocolId)
+                    .setValid(true)
+                    .setPriority(10)
+                    .setMtu(1500)
+                    .setNexthopGroupId(7)
+                    .addNextHop(nh1)
+                    .addNextHop(nh2)
+                    .build();
+  cache.update(route1);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_TRUE(cache.contains(kProtocolId, prefix1));
+  EXPECT_FALSE(cache.contains(kOtherProtocolId, prefix1));
+  EXPECT_FALSE(cache.contains(kProtocolId, prefix2));
+
+  // Rebuilt route is the same as the cached one
+  auto cachedRoute = cache.get(kProtocolId, prefix1);
+  ASSERT_TRUE(cachedRoute.hasValue());
+  EXPECT_EQ(route1, cachedRoute.value());
+  EXPECT_TRUE(cache.isSameRoute(route1));
+  EXPECT_EQ(7, cache.getNexthopGroupId(kProtocolId, prefix1).value());
+
+  // Any change of attributes or nexthops is a different route
+  EXPECT_FALSE(cache.isSameRoute(buildRoute(kProtocolId, prefix1, {nh1})));
+  EXPECT_FALSE(
+      cache.isSameRoute(buildRoute(kOtherProtocolId, prefix1, {nh1, nh2})));
+
+  // Replace route
+  auto route2 = buildRoute(kProtocolId, prefix1, {nh2});
+  cache.update(route2);
+  EXPECT_EQ(1, cache.size());
+  EXPECT_EQ(route2, cache.get(kProtocolId, prefix1).value());
+  EXPECT_FALSE(cache.getNexthopGroupId(kProtocolId, prefix1).hasValue());
+
+  EXPECT_TRUE(cache.erase(kProtocolId, prefix1));
+  EXPECT_FALSE(cache.erase(kProtocolId, prefix1));
+  EXPECT_FALSE(cache.get(kProtocolId, prefix1).hasValue());
+  EXPECT_EQ(0, cache.size());
+  EXPECT_EQ(0, cache.getNumNextHopSets());
+}
+
+TEST(UnicastRouteCache, SharedNextHopSets) {
+  UnicastRouteCache cache;
+  const auto nh1 = buildNextHop(1, "fe80::1");
+  const auto nh2 = buildNextHop(2, "fe80::2");
+
+  // Routes with the same nexthops, in any order, share one set
+  cache.update(buildRoute(kProtocolId, prefix1, {nh1, nh2}));
+  cache.update(buildRoute(kProtocolId, prefix2, {nh2, nh1}));
+  cache.update(buildRoute(kOtherProtocolId, prefix1, {nh1, nh2}));
+  EXPECT_EQ(3, cache.size());
+  EXPECT_EQ(2, cache.size(kProtocolId));
+  EXPECT_EQ(1, cache.size(kOtherProtocolId));
+  EXPECT_EQ(1, cache.getNumNextHopSets());
+
+  // Old set is kept while in use
+  cache.update(buildRoute(kProtocolId, prefix2, {nh1}));
+  EXPECT_EQ(2, cache.getNumNextHopSets());
+  EXPECT_TRUE(cache.erase(kProtocolId, prefix2));
+  EXPECT_EQ(1, cache.getNumNextHopSets());
+  EXPECT_TRUE(cache.erase(kProtocolId, prefix1));
+  EXPECT_TRUE(cache.erase(kOtherProtocolId, prefix1));
+  EXPECT_EQ(0, cache.getNumNextHopSets());
+}
+
+TEST(UnicastRouteCache, GetRoutesAndPrefixes) {
+  UnicastRouteCache cache;
+  const auto nh1 = buildNextHop(1, "fe80::1");
+  const auto nh2 = buildNextHop(2, "10.0.0.1");
+
+  auto route1 = buildRoute(kProtocolId, prefix1, {nh1});
+  auto route3 = buildRoute(kProtocolId, prefix3, {nh2});
+  cache.update(route1);
+  cache.update(route3);
+
+  auto routes = cache.getRoutes(kProtocolId);
+  ASSERT_EQ(2, routes.size());
+  EXPECT_EQ(route1, routes.at(prefix1));
+  EXPECT_EQ(route3, routes.at(prefix3));
+  EXPECT_TRUE(cache.getRoutes(kOtherProtocolId).empty());
+
+  auto prefixes = cache.getPrefixes(kProtocolId);
+  std::sort(prefixes.begin(), prefixes.end());
+  std::vector<folly::CIDRNetwork> expected{prefix1, prefix3};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected, prefixes);
+}
+
+TEST(UnicastRouteCache, RoutesViaGateway) {
+  UnicastRouteCache cache;
+  const auto gateway1 = folly::IPAddress("fe80::1");
+  const auto gateway2 = folly::IPAddress("fe80::2");
+  const auto nh1 = buildNextHop(1, "fe80::1");
+  const auto nh2 = buildNextHop(2, "fe80::2");
+  // Same gateway as nh1, on another interface
+  const auto nh3 = buildNextHop(3, "fe80::1");
+
+  cache.update(buildRoute(kProtocolId, prefix1, {nh1, nh2}));
+  cache.update(buildRoute(kProtocolId, prefix2, {nh2}));
+  cache.update(buildRoute(kOtherProtocolId, prefix1, {nh1, nh3}));
+
+  using RouteKeys = std::vector<std::pair<uint8_t, folly::CIDRNetwork>>;
+  auto routes = cache.getRoutesViaGateway(gateway1);
+  std::sort(routes.begin(), routes.end());
+  EXPECT_EQ(
+      RouteKeys({{kProtocolId, prefix1}, {kOtherProtocolId, prefix1}}),
+      routes);
+  routes = cache.getRoutesViaGateway(gateway2);
+  std::sort(routes.begin(), routes.end());
+  EXPECT_EQ(
+      RouteKeys({{kProtocolId, prefix1}, {kProtocolId, prefix2}}), routes);
+
+  // Index follows nexthops of updated and erased routes
+  cache.update(buildRoute(kProtocolId, prefix1, {nh2}));
+  cache.update(buildRoute(kOtherProtocolId, prefix1, {nh3}));
+  EXPECT_EQ(
+      RouteKeys({{kOtherProtocolId, prefix1}}),
+      cache.getRoutesViaGateway(gateway1));
+  EXPECT_TRUE(cache.erase(kOtherProtocolId, prefix1));
+  EXPECT_TRUE(cache.getRoutesViaGateway(gateway1).empty());
+  EXPECT_TRUE(cache.erase(kProtocolId, prefix1));
+  EXPECT_TRUE(cache.erase(kProtocolId, prefix2));
+  EXPECT_TRUE(cache.getRoutesViaGateway(gateway2).empty());
+}
+
+int
+main(int argc, char* argv[]) {
+  // Parse command line flags
+  testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+
+  // Run the tests
+  return RUN_ALL_TESTS();
+}
@@ -120,7 +120,7 @@ class NetlinkSocketFixture : public testing::Test {
 
     // create netlink route socket
     netlinkSocket = std::make_unique<NetlinkSocket>(
-        &evl, nullptr, std::move(nlProtocolSocket));
+        &evl, nullptr, std::move(nlProtocolSocket), enableNexthopObjects);
 
     // Run the zmq event loop in its own thread
     // We will either timeout if expected events are not received
@@ -220,6 +220,9 @@ class NetlinkSocketFixture : public testing::Test {
     return builder.buildLinkRoute();
   }
 
+  // program unicast routes with kernel nexthop groups
+  bool enableNexthopObjects{false};
+
   std::unique_ptr<NetlinkSocket> netlinkSocket;
   std::unique_ptr<openr::Netlink::NetlinkProtocolSocket> nlProtocolSocket;
   fbzmq::ZmqEventLoop evl;
@@ -853,6 +856,141 @@ TEST_F(NetlinkSocketFixture, SingleRouteTestV4) {
   EXPECT_EQ(0, routes.size());
 }
 
+// - Add routes in a batch
+// - verify they are added,
+// - Update their nexthops in a batch, replacing V6 routes
+// - Delete them in a batch and then verify they are deleted
+TEST_F(NetlinkSocketFixture, BatchRouteTest) {
+  const size_t kNumRoutes{100};
+  std::vector<folly::IPAddress> nexthops1{folly::IPAddress("fe80::1")};
+  std::vector<folly::IPAddress> nexthops2{folly::IPAddress("fe80::2")};
+  int ifIndex = rtnl_link_name2i(linkCache_, kVethNameY.c_str());
+
+  auto buildRoutes = [&](const std::vector<folly::IPAddress>& nexthops) {
+    std::vector<Route> routes;
+    for (size_t i = 0; i < kNumRoutes; ++i) {
+      folly::CIDRNetwork prefix{
+          folly::IPAddress(folly::sformat("fc00:cafe:5::{}", i + 1)), 128};
+      routes.emplace_back(
+          buildRoute(ifIndex, kAqRouteProtoId, nexthops, prefix));
+    }
+    return routes;
+  };
+
+  // Add routes
+  netlinkSocket->addRoutes(buildRoutes(nexthops1)).get();
+  auto routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(kNumRoutes, routes.size());
+  for (const auto& kv : routes) {
+    EXPECT_EQ(1, kv.second.getNextHops().size());
+    EXPECT_EQ(nexthops1[0], kv.second.getNextHops().begin()->getGateway());
+  }
+
+  // Same routes again are not programmed
+  auto counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(kNumRoutes, counters["route_batch_routes"]);
+  netlinkSocket->addRoutes(buildRoutes(nexthops1)).get();
+  counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(kNumRoutes, counters["route_batch_routes"]);
+
+  // Update nexthops, old V6 routes are deleted first
+  netlinkSocket->addRoutes(buildRoutes(nexthops2)).get();
+  routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(kNumRoutes, routes.size());
+  for (const auto& kv : routes) {
+    EXPECT_EQ(1, kv.second.getNextHops().size());
+    EXPECT_EQ(nexthops2[0], kv.second.getNextHops().begin()->getGateway());
+  }
+  counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(3 * kNumRoutes, counters["route_batch_routes"]);
+  EXPECT_EQ(0, counters["route_batch_failures"]);
+
+  // Delete routes
+  netlinkSocket->delRoutes(buildRoutes(nexthops2)).get();
+  routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(0, routes.size());
+}
+
+class NetlinkNexthopObjectFixture : public NetlinkSocketFixture {
+ public:
+  NetlinkNexthopObjectFixture() {
+    enableNexthopObjects = true;
+  }
+};
+
+// - Add routes sharing nexthops, verify they use one nexthop group
+// - Remove a nexthop of all routes, verify only the group is updated
+// - Delete routes, verify group and nexthop objects are deleted
+TEST_F(NetlinkNexthopObjectFixture, NexthopGroupTest) {
+  const size_t kNumRoutes{100};
+  std::vector<folly::IPAddress> nexthops1{folly::IPAddress("fe80::1"),
+                                          folly::IPAddress("fe80::2")};
+  std::vector<folly::IPAddress> nexthops2{folly::IPAddress("fe80::1")};
+  int ifIndex = rtnl_link_name2i(linkCache_, kVethNameY.c_str());
+
+  auto buildRoutes = [&](const std::vector<folly::IPAddress>& nexthops) {
+    std::vector<Route> routes;
+    for (size_t i = 0; i < kNumRoutes; ++i) {
+      folly::CIDRNetwork prefix{
+          folly::IPAddress(folly::sformat("fc00:cafe:6::{}", i + 1)), 128};
+      routes.emplace_back(
+          buildRoute(ifIndex, kAqRouteProtoId, nexthops, prefix));
+    }
+    return routes;
+  };
+
+  // Add routes, all of them use the same group
+  netlinkSocket->addRoutes(buildRoutes(nexthops1)).get();
+  auto routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(kNumRoutes, routes.size());
+  auto groupId = routes.begin()->second.getNexthopGroupId();
+  ASSERT_TRUE(groupId.hasValue());
+  for (const auto& kv : routes) {
+    EXPECT_EQ(2, kv.second.getNextHops().size());
+    EXPECT_EQ(groupId, kv.second.getNexthopGroupId());
+  }
+  auto counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(kNumRoutes, counters["route_batch_routes"]);
+  EXPECT_EQ(1, counters["nexthop_groups"]);
+  EXPECT_EQ(2, counters["nexthop_objects"]);
+
+  // Remove a nexthop of all routes, group is updated in place and no route
+  // is programmed
+  netlinkSocket->addRoutes(buildRoutes(nexthops2)).get();
+  routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(kNumRoutes, routes.size());
+  for (const auto& kv : routes) {
+    EXPECT_EQ(1, kv.second.getNextHops().size());
+    EXPECT_EQ(nexthops2[0], kv.second.getNextHops().begin()->getGateway());
+    EXPECT_EQ(groupId, kv.second.getNexthopGroupId());
+  }
+  counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(kNumRoutes, counters["route_batch_routes"]);
+  EXPECT_EQ(1, counters["nexthop_group_updates"]);
+  EXPECT_EQ(kNumRoutes, counters["nexthop_group_update_routes"]);
+  EXPECT_EQ(1, counters["nexthop_groups"]);
+  EXPECT_EQ(1, counters["nexthop_objects"]);
+
+  // Move half of routes back, they are programmed with a new group
+  auto moved = buildRoutes(nexthops1);
+  moved.resize(kNumRoutes / 2);
+  netlinkSocket->addRoutes(std::move(moved)).get();
+  counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(kNumRoutes + kNumRoutes, counters["route_batch_routes"]);
+  EXPECT_EQ(1, counters["nexthop_group_updates"]);
+  EXPECT_EQ(2, counters["nexthop_groups"]);
+  EXPECT_EQ(2, counters["nexthop_objects"]);
+
+  // Delete routes, groups and nexthop objects are deleted with them
+  netlinkSocket->delRoutes(buildRoutes(nexthops2)).get();
+  routes = netlinkSocket->getCachedUnicastRoutes(kAqRouteProtoId).get();
+  EXPECT_EQ(0, routes.size());
+  counters = netlinkSocket->getRouteBatchCounters().get();
+  EXPECT_EQ(0, counters["route_batch_failures"]);
+  EXPECT_EQ(0, counters["nexthop_groups"]);
+  EXPECT_EQ(0, counters["nexthop_objects"]);
+}
+
 // - Add a null route (nexthops empty)
 // - verify it is added,
 // - Delete it and then verify it is deleted
@@ -2210,6 +2348,43 @@ TEST_F(NetlinkSocketFixture, AddDelIfAddressBaseTest) {
   EXPECT_FALSE(found);
 }
 
+// Links version is bumped by link changes only, not by dumps of unchanged
+// links, and cached links hold dumped links
+TEST_F(NetlinkSocketFixture, LinksVersionTest) {
+  const folly::CIDRNetwork prefix{folly::IPAddress("fc00:cafe:4::4"), 128};
+  int ifIndex = netlinkSocket->getIfIndex(kVethNameX).get();
+  ASSERT_NE(0, ifIndex);
+
+  netlinkSocket->getAllLinks().get();
+  const auto version = netlinkSocket->getLinksVersion();
+  netlinkSocket->getAllLinks().get();
+  EXPECT_EQ(version, netlinkSocket->getLinksVersion());
+
+  // added address is in links once dumped or received as event
+  IfAddressBuilder builder;
+  netlinkSocket
+      ->addIfAddress(builder.setPrefix(prefix).setIfIndex(ifIndex).build())
+      .get();
+  auto links = netlinkSocket->getAllLinks().get();
+  EXPECT_EQ(1, links.at(kVethNameX).networks.count(prefix));
+  const auto addedVersion = netlinkSocket->getLinksVersion();
+  EXPECT_LT(version, addedVersion);
+  auto cachedLinks = netlinkSocket->getCachedLinks().get();
+  EXPECT_EQ(links.size(), cachedLinks.size());
+  EXPECT_EQ(1, cachedLinks.at(kVethNameX).networks.count(prefix));
+
+  netlinkSocket->getAllLinks().get();
+  EXPECT_EQ(addedVersion, netlinkSocket->getLinksVersion());
+
+  builder.reset();
+  netlinkSocket
+      ->delIfAddress(builder.setPrefix(prefix).setIfIndex(ifIndex).build())
+      .get();
+  links = netlinkSocket->getAllLinks().get();
+  EXPECT_EQ(0, links.at(kVethNameX).networks.count(prefix));
+  EXPECT_LT(addedVersion, netlinkSocket->getLinksVersion());
+}
+
 TEST_F(NetlinkSocketFixture, AddDelDuplicatedIfAddressTest) {
   folly::CIDRNetwork prefix{folly::IPAddress("fc00:cafe:3::3"), 128};
   IfAddressBuilder builder;
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+
+#include <openr/nl/NetlinkTypes.h>
+
+namespace openr {
+
+namespace {
+
+const uint8_t kProtocolId = 99;
+
+std::vector<fbnl::NextHop>
+buildNextHops(uint32_t numOfNextHops) {
+  std::vector<fbnl::NextHop> nextHops;
+  for (uint32_t i = 0; i < numOfNextHops; ++i) {
+    fbnl::NextHopBuilder builder;
+    nextHops.emplace_back(
+        builder.setIfIndex(i + 1)
+            .setGateway(folly::IPAddress(folly::sformat("fe80::{}", i + 1)))
+            .build());
+  }
+  return nextHops;
+}
+
+std::vector<folly::CIDRNetwork>
+buildPrefixes(uint32_t numOfRoutes) {
+  std::vector<folly::CIDRNetwork> prefixes;
+  prefixes.reserve(numOfRoutes);
+  for (uint32_t i = 0; i < numOfRoutes; ++i) {
+    prefixes.emplace_back(folly::IPAddress::createNetwork(folly::sformat(
+        "fc00:{:x}:{:x}::/64", (i >> 16) & 0xffff, i & 0xffff)));
+  }
+  return prefixes;
+}
+
+} // namespace
+
+/**
+ * Build routes with RouteBuilder, either copying fields out of the builder
+ * or moving them
+ */
+static void
+BM_RouteBuild(
+    uint32_t iters, uint32_t numOfRoutes, uint32_t numOfNextHops, bool move) {
+  folly::BenchmarkSuspender suspender;
+  const auto nextHops = buildNextHops(numOfNextHops);
+  const auto prefixes = buildPrefixes(numOfRoutes);
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    std::vector<fbnl::Route> routes;
+    routes.reserve(numOfRoutes);
+    for (auto const& prefix : prefixes) {
+      fbnl::RouteBuilder builder;
+      builder.setDestination(prefix).setProtocolId(kProtocolId).setValid(true);
+      for (auto const& nextHop : nextHops) {
+        builder.addNextHop(nextHop);
+      }
+      if (move) {
+        routes.emplace_back(std::move(builder).build());
+      } else {
+        routes.emplace_back(builder.build());
+      }
+    }
+    folly::doNotOptimizeAway(routes);
+  }
+}
+
+/**
+ * Copy built routes, as when handing a routing table over by value
+ */
+static void
+BM_RouteCopy(uint32_t iters, uint32_t numOfRoutes, uint32_t numOfNextHops) {
+  folly::BenchmarkSuspender suspender;
+  const auto nextHops = buildNextHops(numOfNextHops);
+  std::vector<fbnl::Route> routes;
+  routes.reserve(numOfRoutes);
+  for (auto const& prefix : buildPrefixes(numOfRoutes)) {
+    fbnl::RouteBuilder builder;
+    builder.setDestination(prefix).setProtocolId(kProtocolId).setValid(true);
+    for (auto const& nextHop : nextHops) {
+      builder.addNextHop(nextHop);
+    }
+    routes.emplace_back(std::move(builder).build());
+  }
+  suspender.dismiss();
+
+  for (uint32_t i = 0; i < iters; ++i) {
+    std::vector<fbnl::Route> copy(routes);
+    folly::doNotOptimizeAway(copy);
+  }
+}
+
+// The parameters are the number of routes, nexthops per route and whether
+// the builder is moved from
+BENCHMARK_NAMED_PARAM(BM_RouteBuild, 100000_1_copy, 100000, 1, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_RouteBuild, 100000_1_move, 100000, 1, true);
+BENCHMARK_NAMED_PARAM(BM_RouteBuild, 100000_4_copy, 100000, 4, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_RouteBuild, 100000_4_move, 100000, 4, true);
+BENCHMARK_NAMED_PARAM(BM_RouteBuild, 100000_16_copy, 100000, 16, false);
+BENCHMARK_RELATIVE_NAMED_PARAM(BM_RouteBuild, 100000_16_move, 100000, 16, true);
+
+// The parameters are the number of routes and nexthops per route
+BENCHMARK_NAMED_PARAM(BM_RouteCopy, 100000_1, 100000, 1);
+BENCHMARK_NAMED_PARAM(BM_RouteCopy, 100000_4, 100000, 4);
+BENCHMARK_NAMED_PARAM(BM_RouteCopy, 100000_16, 100000, 16);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -435,6 +435,50 @@ TEST(NetlinkTypes, RouteCopyTest) {
   nl_object_put(OBJ_CAST(nlPtr2));
 }
 
+TEST(NetlinkTypes, RouteBuildMoveTest) {
+  folly::CIDRNetwork dst{folly::IPAddress("fc00:cafe:3::3"), 128};
+  NextHopBuilder nhBuilder;
+  std::vector<NextHop> nextHops;
+  // spill nexthops past the inline storage of NextHopSet
+  for (size_t i = 0; i < NextHopSet::kInlineNextHops + 2; ++i) {
+    nextHops.emplace_back(
+        nhBuilder.setIfIndex(kIfIndex)
+            .setGateway(folly::IPAddress(folly::sformat("face:cafe::{}", i)))
+            .build());
+    nhBuilder.reset();
+  }
+
+  RouteBuilder builder;
+  builder.setDestination(dst).setProtocolId(kProtocolId).setValid(true);
+  for (auto const& nextHop : nextHops) {
+    builder.addNextHop(nextHop);
+  }
+  // duplicate nexthops are ignored
+  builder.addNextHop(nextHops.front());
+  EXPECT_EQ(nextHops.size(), builder.getNextHops().size());
+
+  auto route = builder.build();
+  auto movedRoute = std::move(builder).build();
+  EXPECT_EQ(route, movedRoute);
+  EXPECT_EQ(nextHops.size(), movedRoute.getNextHops().size());
+  for (auto const& nextHop : nextHops) {
+    EXPECT_EQ(1, movedRoute.getNextHops().count(nextHop));
+  }
+
+  // equality of nexthops doesn't depend on order
+  NextHopSet reversed;
+  for (auto it = nextHops.rbegin(); it != nextHops.rend(); ++it) {
+    EXPECT_TRUE(reversed.insert(*it).second);
+  }
+  EXPECT_FALSE(reversed.insert(nextHops.front()).second);
+  EXPECT_EQ(route.getNextHops(), reversed);
+  EXPECT_EQ(1, reversed.erase(nextHops.front()));
+  EXPECT_NE(route.getNextHops(), reversed);
+
+  builder.reset();
+  EXPECT_EQ(0, builder.getNextHops().size());
+}
+
 TEST(NetlinkTypes, RouteOptionalParamTest) {
   folly::CIDRNetwork dst{folly::IPAddress("fc00:cafe:3::3"), 128};
   uint32_t flags = 0x01;
@@ -28,6 +28,11 @@ DEFINE_string(
     platform_pub_url,
     "ipc://platform-pub-url",
     "Publisher URL for interface/address notifications");
+DEFINE_int32(
+    platform_event_batch_window_ms,
+    0,
+    "If set, link/address events within this window are coalesced and "
+    "published as one batch. 0 publishes every event");
 DEFINE_bool(
     enable_netlink_fib_handler,
     true,
@@ -60,11 +65,15 @@ main(int argc, char** argv) {
 
   std::vector<std::thread> allThreads{};
 
-  // Create event publisher to handle event subscription
-  auto eventPublisher = std::make_unique<openr::PlatformPublisher>(
-      context, openr::PlatformPublisherUrl{FLAGS_platform_pub_url});
-
   auto nlEventLoop = std::make_unique<fbzmq::ZmqEventLoop>();
+
+  // Create event publisher to handle event subscription, events are received
+  // in the thread of nlEventLoop
+  auto eventPublisher = std::make_unique<openr::PlatformPublisher>(
+      context,
+      openr::PlatformPublisherUrl{FLAGS_platform_pub_url},
+      nlEventLoop.get(),
+      std::chrono::milliseconds(FLAGS_platform_event_batch_window_ms));
   auto nlSocket = std::make_shared<openr::fbnl::NetlinkSocket>(
       nlEventLoop.get(), eventPublisher.get());
   // Subscribe selected network events
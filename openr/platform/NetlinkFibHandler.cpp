@@ -170,34 +170,23 @@ NetlinkFibHandler::buildNextHops(const fbnl::NextHopSet& nextHops) {
   return thriftNextHops;
 }
 
-std::vector<thrift::UnicastRoute>
-NetlinkFibHandler::toThriftUnicastRoutes(const fbnl::NlUnicastRoutes& routeDb) {
-  std::vector<thrift::UnicastRoute> routes;
-
-  for (auto const& kv : routeDb) {
-    thrift::UnicastRoute route;
-    route.dest = toIpPrefix(kv.first);
-    route.nextHops = buildNextHops(kv.second.getNextHops());
-    // DEPRECATED - Only for backward compatibility
-    route.deprecatedNexthops = createDeprecatedNexthops(route.nextHops);
-
-    routes.emplace_back(std::move(route));
-  }
-  return routes;
+thrift::UnicastRoute
+NetlinkFibHandler::toThriftUnicastRoute(const fbnl::Route& route) {
+  thrift::UnicastRoute thriftRoute;
+  thriftRoute.dest = toIpPrefix(route.getDestination());
+  thriftRoute.nextHops = buildNextHops(route.getNextHops());
+  // DEPRECATED - Only for backward compatibility
+  thriftRoute.deprecatedNexthops =
+      createDeprecatedNexthops(thriftRoute.nextHops);
+  return thriftRoute;
 }
 
-std::vector<thrift::MplsRoute>
-NetlinkFibHandler::toThriftMplsRoutes(const fbnl::NlMplsRoutes& routeDb) {
-  std::vector<thrift::MplsRoute> routes;
-
-  for (auto const& kv : routeDb) {
-    thrift::MplsRoute route;
-    route.topLabel = kv.first;
-    route.nextHops = buildNextHops(kv.second.getNextHops());
-
-    routes.emplace_back(std::move(route));
-  }
-  return routes;
+thrift::MplsRoute
+NetlinkFibHandler::toThriftMplsRoute(const fbnl::Route& route) {
+  thrift::MplsRoute thriftRoute;
+  thriftRoute.topLabel = static_cast<int32_t>(route.getMplsLabel().value());
+  thriftRoute.nextHops = buildNextHops(route.getNextHops());
+  return thriftRoute;
 }
 
 folly::Future<folly::Unit>
@@ -212,7 +201,9 @@ NetlinkFibHandler::future_addUnicastRoute(
     return future;
   }
 
-  return netlinkSocket_->addRoute(buildRoute(*route, protocol.value()));
+  IfIndexCache ifIndexCache;
+  return netlinkSocket_->addRoute(
+      buildRoute(*route, protocol.value(), ifIndexCache));
 }
 
 folly::Future<folly::Unit>
@@ -230,7 +221,7 @@ NetlinkFibHandler::future_deleteUnicastRoute(
   fbnl::RouteBuilder rtBuilder;
   rtBuilder.setDestination(toIPNetwork(*prefix))
       .setProtocolId(protocol.value());
-  return netlinkSocket_->delRoute(rtBuilder.build());
+  return netlinkSocket_->delRoute(std::move(rtBuilder).build());
 }
 
 folly::Future<folly::Unit>
@@ -242,21 +233,30 @@ NetlinkFibHandler::future_addUnicastRoutes(
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  // Run all route updates in a single eventloop
+  // Run all route updates in a single eventloop, programmed in batches
   evl_->runImmediatelyOrInEventLoop([this,
                                      clientId,
                                      promise = std::move(promise),
                                      routes = std::move(routes)]() mutable {
-    for (auto& route : *routes) {
-      auto ptr = std::make_unique<thrift::UnicastRoute>(std::move(route));
-      try {
-        // This is going to be synchronous call as we are invoking from
-        // within event loop
-        future_addUnicastRoute(clientId, std::move(ptr)).get();
-      } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
-      }
+    auto protocol = getProtocol(promise, clientId);
+    if (protocol.hasError()) {
+      return;
+    }
+    std::vector<fbnl::Route> nlRoutes;
+    nlRoutes.reserve(routes->size());
+    IfIndexCache ifIndexCache;
+    for (auto const& route : *routes) {
+      nlRoutes.emplace_back(buildRoute(route, protocol.value(), ifIndexCache));
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+    try {
+      // This is going to be synchronous call as we are invoking from
+      // within event loop
+      netlinkSocket_->addRoutes(std::move(nlRoutes)).get();
+      recordKernelLatency("unicast_add", startTime);
+    } catch (std::exception const& e) {
+      promise.setException(e);
+      return;
     }
     promise.setValue();
   });
@@ -276,14 +276,25 @@ NetlinkFibHandler::future_deleteUnicastRoutes(
                                      clientId,
                                      promise = std::move(promise),
                                      prefixes = std::move(prefixes)]() mutable {
-    for (auto& prefix : *prefixes) {
-      auto ptr = std::make_unique<thrift::IpPrefix>(std::move(prefix));
-      try {
-        future_deleteUnicastRoute(clientId, std::move(ptr)).get();
-      } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
-      }
+    auto protocol = getProtocol(promise, clientId);
+    if (protocol.hasError()) {
+      return;
+    }
+    std::vector<fbnl::Route> nlRoutes;
+    nlRoutes.reserve(prefixes->size());
+    for (auto const& prefix : *prefixes) {
+      fbnl::RouteBuilder rtBuilder;
+      rtBuilder.setDestination(toIPNetwork(prefix))
+          .setProtocolId(protocol.value());
+      nlRoutes.emplace_back(std::move(rtBuilder).build());
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+    try {
+      netlinkSocket_->delRoutes(std::move(nlRoutes)).get();
+      recordKernelLatency("unicast_delete", startTime);
+    } catch (std::exception const& e) {
+      promise.setException(e);
+      return;
     }
     promise.setValue();
   });
@@ -302,7 +313,9 @@ NetlinkFibHandler::future_addMplsRoute(
   if (protocol.hasError()) {
     return future;
   }
-  return netlinkSocket_->addMplsRoute(buildMplsRoute(*route, protocol.value()));
+  IfIndexCache ifIndexCache;
+  return netlinkSocket_->addMplsRoute(
+      buildMplsRoute(*route, protocol.value(), ifIndexCache));
 }
 
 folly::Future<folly::Unit>
@@ -317,7 +330,7 @@ NetlinkFibHandler::future_deleteMplsRoute(int16_t clientId, int32_t topLabel) {
   }
   fbnl::RouteBuilder rtBuilder;
   rtBuilder.setMplsLabel(topLabel).setProtocolId(protocol.value());
-  return netlinkSocket_->delMplsRoute(rtBuilder.build());
+  return netlinkSocket_->delMplsRoute(std::move(rtBuilder).build());
 }
 
 folly::Future<folly::Unit>
@@ -328,21 +341,31 @@ NetlinkFibHandler::future_addMplsRoutes(
   folly::Promise<folly::Unit> promise;
   auto future = promise.getFuture();
 
-  // Run all route updates in a single eventloop
+  // Run all route updates in a single eventloop, programmed in batches
   evl_->runImmediatelyOrInEventLoop([this,
                                      clientId,
                                      promise = std::move(promise),
                                      routes = std::move(routes)]() mutable {
-    for (auto& route : *routes) {
-      auto ptr = std::make_unique<thrift::MplsRoute>(std::move(route));
-      try {
-        // This is going to be synchronous call as we are invoking from
-        // within event loop
-        future_addMplsRoute(clientId, std::move(ptr)).get();
-      } catch (std::exception const& e) {
-        promise.setException(e);
-        return;
-      }
+    auto protocol = getProtocol(promise, clientId);
+    if (protocol.hasError()) {
+      return;
+    }
+    std::vector<fbnl::Route> nlRoutes;
+    nlRoutes.reserve(routes->size());
+    IfIndexCache ifIndexCache;
+    for (auto const& route : *routes) {
+      nlRoutes.emplace_back(
+          buildMplsRoute(route, protocol.value(), ifIndexCache));
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+    try {
+      // This is going to be synchronous call as we are invoking from
+      // within event loop
+      netlinkSocket_->addRoutes(std::move(nlRoutes)).get();
+      recordKernelLatency("mpls_add", startTime);
+    } catch (std::exception const& e) {
+      promise.setException(e);
+      return;
     }
     promise.setValue();
   });
@@ -363,13 +386,24 @@ NetlinkFibHandler::future_deleteMplsRoutes(
        clientId,
        promise = std::move(promise),
        topLabels = std::move(topLabels)]() mutable {
-        for (auto& label : *topLabels) {
-          try {
-            future_deleteMplsRoute(clientId, label).get();
-          } catch (std::exception const& e) {
-            promise.setException(e);
-            return;
-          }
+        auto protocol = getProtocol(promise, clientId);
+        if (protocol.hasError()) {
+          return;
+        }
+        std::vector<fbnl::Route> nlRoutes;
+        nlRoutes.reserve(topLabels->size());
+        for (auto const& label : *topLabels) {
+          fbnl::RouteBuilder rtBuilder;
+          rtBuilder.setMplsLabel(label).setProtocolId(protocol.value());
+          nlRoutes.emplace_back(std::move(rtBuilder).build());
+        }
+        const auto startTime = std::chrono::steady_clock::now();
+        try {
+          netlinkSocket_->delRoutes(std::move(nlRoutes)).get();
+          recordKernelLatency("mpls_delete", startTime);
+        } catch (std::exception const& e) {
+          promise.setException(e);
+          return;
         }
         promise.setValue();
       });
@@ -393,9 +427,11 @@ NetlinkFibHandler::future_syncFib(
 
   // Build new routeDb
   fbnl::NlUnicastRoutes newRoutes;
+  IfIndexCache ifIndexCache;
   for (auto const& route : *routes) {
-    newRoutes.emplace(
-        toIPNetwork(route.dest), buildRoute(route, protocol.value()));
+    auto nlRoute = buildRoute(route, protocol.value(), ifIndexCache);
+    auto dest = nlRoute.getDestination();
+    newRoutes.emplace(std::move(dest), std::move(nlRoute));
   }
 
   return netlinkSocket_->syncUnicastRoutes(
@@ -417,15 +453,152 @@ NetlinkFibHandler::future_syncMplsFib(
   }
 
   fbnl::NlMplsRoutes newMplsRoutes;
+  IfIndexCache ifIndexCache;
   for (auto const& mplsRoute : *mplsRoutes) {
     newMplsRoutes.emplace(
-        mplsRoute.topLabel, buildMplsRoute(mplsRoute, protocol.value()));
+        mplsRoute.topLabel,
+        buildMplsRoute(mplsRoute, protocol.value(), ifIndexCache));
   }
 
   return netlinkSocket_->syncMplsRoutes(
       protocol.value(), std::move(newMplsRoutes));
 }
 
+folly::Future<int64_t>
+NetlinkFibHandler::future_beginSyncFib(int16_t clientId, bool syncMpls) {
+  LOG(INFO) << "Beginning chunked FIB sync. Client: "
+            << getClientName(clientId);
+
+  folly::Promise<int64_t> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, clientId, syncMpls, promise = std::move(promise)]() mutable {
+        auto protocol = getProtocol(promise, clientId);
+        if (protocol.hasError()) {
+          return;
+        }
+        // Supersedes previous session of client, if any
+        auto& session = syncSessions_[clientId];
+        session.syncId = nextSyncId_++;
+        session.syncMpls = syncMpls;
+        session.prefixes.clear();
+        session.labels.clear();
+        ++numSyncFibBegins_;
+        promise.setValue(session.syncId);
+      });
+
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_syncFibChunk(
+    int16_t clientId,
+    int64_t syncId,
+    std::unique_ptr<std::vector<thrift::UnicastRoute>> unicastRoutes,
+    std::unique_ptr<std::vector<thrift::MplsRoute>> mplsRoutes) {
+  VLOG(1) << "Syncing FIB chunk of " << unicastRoutes->size() << " unicast "
+          << mplsRoutes->size() << " mpls routes. Client: "
+          << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this,
+       clientId,
+       syncId,
+       promise = std::move(promise),
+       unicastRoutes = std::move(unicastRoutes),
+       mplsRoutes = std::move(mplsRoutes)]() mutable {
+        auto protocol = getProtocol(promise, clientId);
+        if (protocol.hasError()) {
+          return;
+        }
+        auto it = syncSessions_.find(clientId);
+        if (it == syncSessions_.end() || it->second.syncId != syncId) {
+          promise.setException(fbnl::NlException(
+              folly::sformat("Unknown sync session : {}", syncId)));
+          return;
+        }
+        auto& session = it->second;
+
+        // Routes are diffed against kernel routes and programmed right away,
+        // only changed routes are sent to kernel
+        std::vector<fbnl::Route> nlRoutes;
+        nlRoutes.reserve(unicastRoutes->size() + mplsRoutes->size());
+        IfIndexCache ifIndexCache;
+        for (auto const& route : *unicastRoutes) {
+          nlRoutes.emplace_back(
+              buildRoute(route, protocol.value(), ifIndexCache));
+          session.prefixes.emplace(nlRoutes.back().getDestination());
+        }
+        if (session.syncMpls) {
+          for (auto const& route : *mplsRoutes) {
+            session.labels.emplace(route.topLabel);
+            nlRoutes.emplace_back(
+                buildMplsRoute(route, protocol.value(), ifIndexCache));
+          }
+        }
+        ++numSyncFibChunks_;
+        try {
+          netlinkSocket_->addRoutes(std::move(nlRoutes)).get();
+        } catch (std::exception const& e) {
+          promise.setException(e);
+          return;
+        }
+        promise.setValue();
+      });
+
+  return future;
+}
+
+folly::Future<folly::Unit>
+NetlinkFibHandler::future_commitSyncFib(int16_t clientId, int64_t syncId) {
+  LOG(INFO) << "Committing chunked FIB sync. Client: "
+            << getClientName(clientId);
+
+  folly::Promise<folly::Unit> promise;
+  auto future = promise.getFuture();
+
+  evl_->runImmediatelyOrInEventLoop(
+      [this, clientId, syncId, promise = std::move(promise)]() mutable {
+        auto protocol = getProtocol(promise, clientId);
+        if (protocol.hasError()) {
+          return;
+        }
+        auto it = syncSessions_.find(clientId);
+        if (it == syncSessions_.end() || it->second.syncId != syncId) {
+          promise.setException(fbnl::NlException(
+              folly::sformat("Unknown sync session : {}", syncId)));
+          return;
+        }
+        auto session = std::move(it->second);
+        syncSessions_.erase(it);
+
+        // Delete routes which were not synced
+        try {
+          netlinkSocket_
+              ->deleteUnicastRoutesExcept(
+                  protocol.value(), std::move(session.prefixes))
+              .get();
+          if (session.syncMpls) {
+            netlinkSocket_
+                ->deleteMplsRoutesExcept(
+                    protocol.value(), std::move(session.labels))
+                .get();
+          }
+        } catch (std::exception const& e) {
+          promise.setException(e);
+          return;
+        }
+        ++numSyncFibCommits_;
+        promise.setValue();
+      });
+
+  return future;
+}
+
 int64_t
 NetlinkFibHandler::aliveSince() {
   VLOG(3) << "Received KeepAlive from OpenR";
@@ -458,10 +631,17 @@ NetlinkFibHandler::future_getRouteTableByClient(int16_t clientId) {
     return future;
   }
 
-  return netlinkSocket_->getCachedUnicastRoutes(protocol.value())
-      .thenValue([this](fbnl::NlUnicastRoutes res) mutable {
+  // convert cached routes in place, without copying the routing table
+  auto routes = std::make_shared<std::vector<openr::thrift::UnicastRoute>>();
+  return netlinkSocket_
+      ->forEachCachedUnicastRoute(
+          protocol.value(),
+          [this, routes](const fbnl::Route& route) {
+            routes->emplace_back(toThriftUnicastRoute(route));
+          })
+      .thenValue([routes](folly::Unit) mutable {
         return std::make_unique<std::vector<openr::thrift::UnicastRoute>>(
-            toThriftUnicastRoutes(res));
+            std::move(*routes));
       })
       .thenError<std::runtime_error>([](std::exception const& ex) {
         LOG(ERROR) << "Failed to get unicast routing table by client: "
@@ -483,10 +663,17 @@ NetlinkFibHandler::future_getMplsRouteTableByClient(int16_t clientId) {
     return future;
   }
 
-  return netlinkSocket_->getCachedMplsRoutes(protocol.value())
-      .thenValue([this](fbnl::NlMplsRoutes res) mutable {
+  // convert cached routes in place, without copying the routing table
+  auto routes = std::make_shared<std::vector<openr::thrift::MplsRoute>>();
+  return netlinkSocket_
+      ->forEachCachedMplsRoute(
+          protocol.value(),
+          [this, routes](const fbnl::Route& route) {
+            routes->emplace_back(toThriftMplsRoute(route));
+          })
+      .thenValue([routes](folly::Unit) mutable {
         return std::make_unique<std::vector<openr::thrift::MplsRoute>>(
-            toThriftMplsRoutes(res));
+            std::move(*routes));
       })
       .thenError<std::runtime_error>([](std::exception const& ex) {
         LOG(ERROR) << "Failed to get Mpls routing table by client: "
@@ -526,14 +713,18 @@ NetlinkFibHandler::buildMplsAction(
 void
 NetlinkFibHandler::buildNextHop(
     fbnl::RouteBuilder& rtBuilder,
-    const std::vector<thrift::NextHopThrift>& nhop) const {
+    const std::vector<thrift::NextHopThrift>& nhop,
+    IfIndexCache& ifIndexCache) const {
   // add nexthops
   fbnl::NextHopBuilder nhBuilder;
+  rtBuilder.reserveNextHops(nhop.size());
   for (const auto& nh : nhop) {
+    const auto gateway = toIPAddress(nh.address);
     // if recursive lookup is enabled, try resolve nexthop first
-    if (FLAGS_enable_recursive_lookup) {
-      const auto& resolvedNhSet = lookupNexthop(nh.address);
-      for (const auto& resolvedNh : resolvedNhSet) {
+    const fbnl::NextHopSet* resolvedNhSet =
+        FLAGS_enable_recursive_lookup ? lookupNexthop(gateway) : nullptr;
+    if (resolvedNhSet) {
+      for (const auto& resolvedNh : *resolvedNhSet) {
         if (resolvedNh.getIfIndex().hasValue()) {
           nhBuilder.setIfIndex(resolvedNh.getIfIndex().value());
         }
@@ -544,40 +735,55 @@ NetlinkFibHandler::buildNextHop(
         nhBuilder.reset();
       }
       // This nexthop has been resolved, continue to next
-      if (resolvedNhSet.size()) {
+      if (resolvedNhSet->size()) {
         continue;
       }
     }
     // recursive lookup is not enabled, or nexthop is not resolved
     if (nh.address.ifName.hasValue()) {
-      nhBuilder.setIfIndex(
-          netlinkSocket_->getIfIndex(nh.address.ifName.value()).get());
+      nhBuilder.setIfIndex(getIfIndex(nh.address.ifName.value(), ifIndexCache));
     }
-    nhBuilder.setGateway(toIPAddress(nh.address));
+    nhBuilder.setGateway(gateway);
     buildMplsAction(nhBuilder, nh);
     rtBuilder.addNextHop(nhBuilder.setWeight(0).build());
     nhBuilder.reset();
   }
 }
 
+int
+NetlinkFibHandler::getIfIndex(
+    const std::string& ifName, IfIndexCache& ifIndexCache) const {
+  auto it = ifIndexCache.find(ifName);
+  if (it == ifIndexCache.end()) {
+    it = ifIndexCache.emplace(ifName, netlinkSocket_->getIfIndex(ifName).get())
+             .first;
+  }
+  return it->second;
+}
+
 fbnl::Route
 NetlinkFibHandler::buildRoute(
-    const thrift::UnicastRoute& route, int protocol) const noexcept {
+    const thrift::UnicastRoute& route,
+    int protocol,
+    IfIndexCache& ifIndexCache) const noexcept {
   fbnl::RouteBuilder rtBuilder;
   rtBuilder.setDestination(toIPNetwork(route.dest)).setProtocolId(protocol);
 
   // treat empty nexthop as null route
   if (route.nextHops.empty()) {
     rtBuilder.setType(RTN_BLACKHOLE);
-    return rtBuilder.build();
+    return std::move(rtBuilder).build();
   }
-  buildNextHop(rtBuilder, route.nextHops);
-  return rtBuilder.setFlags(0).setValid(true).build();
+  buildNextHop(rtBuilder, route.nextHops, ifIndexCache);
+  rtBuilder.setFlags(0).setValid(true);
+  return std::move(rtBuilder).build();
 }
 
 fbnl::Route
 NetlinkFibHandler::buildMplsRoute(
-    const thrift::MplsRoute& mplsRoute, int protocol) const noexcept {
+    const thrift::MplsRoute& mplsRoute,
+    int protocol,
+    IfIndexCache& ifIndexCache) const noexcept {
   fbnl::RouteBuilder rtBuilder;
   rtBuilder.setMplsLabel(static_cast<uint32_t>(mplsRoute.topLabel));
   rtBuilder.setProtocolId(protocol);
@@ -586,25 +792,43 @@ NetlinkFibHandler::buildMplsRoute(
   if (mplsRoute.nextHops.empty()) {
     rtBuilder.setType(RTN_BLACKHOLE);
   }
-  buildNextHop(rtBuilder, mplsRoute.nextHops);
-  return rtBuilder.setFlags(0).setValid(true).build();
+  buildNextHop(rtBuilder, mplsRoute.nextHops, ifIndexCache);
+  rtBuilder.setFlags(0).setValid(true);
+  return std::move(rtBuilder).build();
 }
 
-fbnl::NextHopSet
-NetlinkFibHandler::lookupNexthop(const thrift::BinaryAddress& nh) const
-    noexcept {
-  VLOG(3) << "Nexthop Lookup for " << toIPAddress(nh).str();
-  const auto& staticRoute = staticRouteCache_.find(
-      folly::IPAddress::createNetwork(toIPAddress(nh).str()));
+const fbnl::NextHopSet*
+NetlinkFibHandler::lookupNexthop(const folly::IPAddress& nh) const noexcept {
+  VLOG(3) << "Nexthop Lookup for " << nh.str();
+  const auto& staticRoute =
+      staticRouteCache_.find(folly::CIDRNetwork(nh, nh.bitCount()));
   if (staticRoute == staticRouteCache_.cend()) {
-    return fbnl::NextHopSet{};
+    return nullptr;
   }
-  return staticRoute->second.getNextHops();
+  return &staticRoute->second.getNextHops();
 }
 
 void
 NetlinkFibHandler::getCounters(std::map<std::string, int64_t>& counters) {
   counters["fibagent.num_of_routes"] = netlinkSocket_->getRouteCount().get();
+  counters["fibagent.sync_fib_begins"] = numSyncFibBegins_;
+  counters["fibagent.sync_fib_chunks"] = numSyncFibChunks_;
+  counters["fibagent.sync_fib_commits"] = numSyncFibCommits_;
+  for (auto const& kv : netlinkSocket_->getRouteBatchCounters().get()) {
+    counters[folly::sformat("fibagent.{}", kv.first)] = kv.second;
+  }
+  for (auto const& kv : *kernelLatencyHistograms_.rlock()) {
+    kv.second.exportCounters(
+        folly::sformat("fibagent.latency.kernel_ms.{}", kv.first), counters);
+  }
+}
+
+void
+NetlinkFibHandler::recordKernelLatency(
+    const std::string& name, std::chrono::steady_clock::time_point startTime) {
+  const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - startTime);
+  (*kernelLatencyHistograms_.wlock())[name].addValue(duration);
 }
 
 void
@@ -7,17 +7,22 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <fbzmq/async/ZmqTimeout.h>
 #include <folly/Expected.h>
+#include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/NetworkUtil.h>
 #include <openr/common/Util.h>
 #include <openr/if/gen-cpp2/FibService.h>
@@ -75,6 +80,18 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
       int16_t clientId,
       std::unique_ptr<std::vector<thrift::MplsRoute>> routes) override;
 
+  folly::Future<int64_t> future_beginSyncFib(
+      int16_t clientId, bool syncMpls) override;
+
+  folly::Future<folly::Unit> future_syncFibChunk(
+      int16_t clientId,
+      int64_t syncId,
+      std::unique_ptr<std::vector<thrift::UnicastRoute>> unicastRoutes,
+      std::unique_ptr<std::vector<thrift::MplsRoute>> mplsRoutes) override;
+
+  folly::Future<folly::Unit> future_commitSyncFib(
+      int16_t clientId, int64_t syncId) override;
+
   void sendNeighborDownInfo(
       std::unique_ptr<std::vector<std::string>> neighborIp) override;
 
@@ -127,27 +144,36 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
   folly::Expected<int16_t, bool> getProtocol(
       folly::Promise<A>& promise, int16_t clientId);
 
-  std::vector<thrift::UnicastRoute> toThriftUnicastRoutes(
-      const fbnl::NlUnicastRoutes& routeDb);
+  thrift::UnicastRoute toThriftUnicastRoute(const fbnl::Route& route);
 
-  std::vector<thrift::MplsRoute> toThriftMplsRoutes(
-      const fbnl::NlMplsRoutes& routeDb);
+  thrift::MplsRoute toThriftMplsRoute(const fbnl::Route& route);
 
   std::vector<thrift::NextHopThrift> buildNextHops(
       const fbnl::NextHopSet& nextHopSet);
 
-  fbnl::Route buildRoute(const thrift::UnicastRoute& route, int protocol) const
-      noexcept;
+  // Interface indexes of nexthop ifNames resolved while building a batch of
+  // routes, so that each is looked up once per batch
+  using IfIndexCache = std::unordered_map<std::string, int>;
+
+  fbnl::Route buildRoute(
+      const thrift::UnicastRoute& route,
+      int protocol,
+      IfIndexCache& ifIndexCache) const noexcept;
 
   fbnl::Route buildMplsRoute(
-      const thrift::MplsRoute& mplsRoute, int protocol) const noexcept;
+      const thrift::MplsRoute& mplsRoute,
+      int protocol,
+      IfIndexCache& ifIndexCache) const noexcept;
 
   void buildMplsAction(
       fbnl::NextHopBuilder& nhBuilder, const thrift::NextHopThrift& nhop) const;
 
   void buildNextHop(
       fbnl::RouteBuilder& rtBuilder,
-      const std::vector<thrift::NextHopThrift>& nhop) const;
+      const std::vector<thrift::NextHopThrift>& nhop,
+      IfIndexCache& ifIndexCache) const;
+
+  int getIfIndex(const std::string& ifName, IfIndexCache& ifIndexCache) const;
 
   // This function only gets used when enable_recursive_lookup flags is set
   // Do recursive look up among static routes for current nexthop
@@ -155,7 +181,8 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
   // E.g. if "10.0.0.0/32 via 127.0.0.1 protoco static" exits,
   //     "ip add 1.1.1.1/32 via 10.0.0.0" will be resolved to
   //     "ip add 1.1.1.1/32 via 127.0.0.1"
-  fbnl::NextHopSet lookupNexthop(const thrift::BinaryAddress& nh) const
+  // Returns nullptr if nexthop doesn't resolve
+  const fbnl::NextHopSet* lookupNexthop(const folly::IPAddress& nh) const
       noexcept;
 
   // Used to interact with Linux kernel routing table
@@ -178,6 +205,31 @@ class NetlinkFibHandler : public thrift::FibServiceSvIf {
 
   // ZmqTimeout timer to periodically sync static routes
   std::unique_ptr<fbzmq::ZmqTimeout> syncStaticRouteTimer_;
+
+  // Chunked sync in progress of a client, only keys of routes received so far
+  // are kept to find routes to delete on commit. Accessed from evl_ only
+  struct SyncSession {
+    int64_t syncId{0};
+    bool syncMpls{false};
+    std::unordered_set<folly::CIDRNetwork> prefixes;
+    std::unordered_set<int32_t> labels;
+  };
+  std::unordered_map<int16_t /* clientId */, SyncSession> syncSessions_;
+  int64_t nextSyncId_{1};
+
+  // Number of chunked syncs started, chunks received and syncs committed
+  std::atomic<int64_t> numSyncFibBegins_{0};
+  std::atomic<int64_t> numSyncFibChunks_{0};
+  std::atomic<int64_t> numSyncFibCommits_{0};
+
+  // Record duration of successful netlink programming call of given type
+  void recordKernelLatency(
+      const std::string& name, std::chrono::steady_clock::time_point startTime);
+
+  // Durations of netlink calls until kernel has acked all routes, by type.
+  // Recorded from evl_, exported from thrift threads
+  folly::Synchronized<std::unordered_map<std::string, LatencyHistogram>>
+      kernelLatencyHistograms_;
 };
 
 } // namespace openr
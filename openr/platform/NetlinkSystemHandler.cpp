@@ -43,36 +43,58 @@ folly::Future<std::unique_ptr<std::vector<thrift::Link>>>
 NetlinkSystemHandler::future_getAllLinks() {
   VLOG(3) << "Query links from Netlink according to link name";
 
-  folly::Promise<std::unique_ptr<std::vector<thrift::Link>>> promise;
-  auto future = promise.getFuture();
-  mainEventLoop_->runInEventLoop([this, p = std::move(promise)]() mutable {
-    try {
-      auto links = doGetAllLinks();
-      p.setValue(std::move(links));
-    } catch (const std::exception& ex) {
-      p.setException(ex);
-    }
+  // served from the snapshot in the calling thread, links are kept up to date
+  // by netlink events rather than dumped from the kernel for every query
+  return folly::makeFutureWith([this]() {
+    return std::make_unique<std::vector<thrift::Link>>(getLinkDb()->links);
   });
-  return future;
 }
 
-std::unique_ptr<std::vector<thrift::Link>>
-NetlinkSystemHandler::doGetAllLinks() {
-  auto linkDb = std::make_unique<std::vector<thrift::Link>>();
-  auto links = netlinkSocket_->getAllLinks().get();
+std::shared_ptr<const NetlinkSystemHandler::LinkDb>
+NetlinkSystemHandler::getLinkDb() {
+  // read version ahead of links, so that changes racing with the rebuild
+  // leave an older version behind and cause another rebuild
+  const auto version = netlinkSocket_->getLinksVersion();
+  auto linkDb = *linkDb_.rlock();
+  if (linkDb->version == version) {
+    return linkDb;
+  }
+
+  linkDb = buildLinkDb(version);
+  auto lockedLinkDb = linkDb_.wlock();
+  // keep the newer snapshot if another reader rebuilt one meanwhile
+  if ((*lockedLinkDb)->version < version) {
+    *lockedLinkDb = linkDb;
+  }
+  return linkDb;
+}
+
+std::shared_ptr<const NetlinkSystemHandler::LinkDb>
+NetlinkSystemHandler::getLinkDbIfChanged(int64_t version) {
+  if (netlinkSocket_->getLinksVersion() == version) {
+    return nullptr;
+  }
+  auto linkDb = getLinkDb();
+  return linkDb->version == version ? nullptr : linkDb;
+}
 
-  linkDb->clear();
+std::shared_ptr<const NetlinkSystemHandler::LinkDb>
+NetlinkSystemHandler::buildLinkDb(int64_t version) {
+  auto linkDb = std::make_shared<LinkDb>();
+  linkDb->version = version;
+  auto links = netlinkSocket_->getCachedLinks().get();
+  linkDb->links.reserve(links.size());
 
-  for (const auto kv : links) {
+  for (const auto& kv : links) {
     thrift::Link linkEntry;
     linkEntry.ifName = kv.first;
     linkEntry.ifIndex = kv.second.ifIndex;
     linkEntry.isUp = kv.second.isUp;
-    for (const auto network : kv.second.networks) {
+    for (const auto& network : kv.second.networks) {
       linkEntry.networks.push_back(thrift::IpPrefix(
           FRAGILE, toBinaryAddress(network.first), network.second));
     }
-    linkDb->push_back(linkEntry);
+    linkDb->links.push_back(std::move(linkEntry));
   }
   return linkDb;
 }
@@ -13,10 +13,12 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
 #include <thrift/lib/cpp/async/TAsyncSocket.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -45,6 +47,21 @@ class NetlinkSystemHandler final : public thrift::SystemServiceSvIf {
   NetlinkSystemHandler(const NetlinkSystemHandler&) = delete;
   NetlinkSystemHandler& operator=(const NetlinkSystemHandler&) = delete;
 
+  // Immutable snapshot of links with their addresses, tagged with the
+  // links version of NetlinkSocket it was built from
+  struct LinkDb {
+    int64_t version{-1};
+    std::vector<thrift::Link> links;
+  };
+
+  // Current snapshot of links, rebuilt only if links changed since the last
+  // snapshot. Readers share the snapshot without copying it
+  std::shared_ptr<const LinkDb> getLinkDb();
+
+  // Current snapshot of links if its version differs from version, nullptr
+  // otherwise, so that pollers skip reading unchanged links
+  std::shared_ptr<const LinkDb> getLinkDbIfChanged(int64_t version);
+
   folly::Future<std::unique_ptr<std::vector<thrift::Link>>> future_getAllLinks()
       override;
 
@@ -89,13 +106,18 @@ class NetlinkSystemHandler final : public thrift::SystemServiceSvIf {
   std::unique_ptr<std::vector<openr::thrift::IpPrefix>> doGetIfaceAddrs(
       const std::string& iface, int16_t family, int16_t scope);
 
-  std::unique_ptr<std::vector<openr::thrift::Link>> doGetAllLinks();
+  // Build snapshot of links of version from the links cache of netlinkSocket_
+  std::shared_ptr<const LinkDb> buildLinkDb(int64_t version);
 
   std::unique_ptr<std::vector<openr::thrift::NeighborEntry>>
   doGetAllNeighbors();
 
   fbzmq::ZmqEventLoop* mainEventLoop_;
   std::shared_ptr<fbnl::NetlinkSocket> netlinkSocket_;
+
+  // Latest snapshot of links, see getLinkDb()
+  folly::Synchronized<std::shared_ptr<const LinkDb>> linkDb_{
+      std::make_shared<const LinkDb>()};
 };
 
 } // namespace openr
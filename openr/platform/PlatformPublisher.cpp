@@ -26,8 +26,11 @@ using apache::thrift::FRAGILE;
 namespace openr {
 
 PlatformPublisher::PlatformPublisher(
-    fbzmq::Context& context, const PlatformPublisherUrl& platformPubUrl)
-    : platformPubUrl_(platformPubUrl) {
+    fbzmq::Context& context,
+    const PlatformPublisherUrl& platformPubUrl,
+    fbzmq::ZmqEventLoop* evl,
+    std::chrono::milliseconds batchWindow)
+    : platformPubUrl_(platformPubUrl), batchWindow_(batchWindow) {
   // Initialize ZMQ sockets
   platformPubSock_ = fbzmq::Socket<ZMQ_PUB, fbzmq::ZMQ_SERVER>(
       context, folly::none, folly::none, fbzmq::NonblockingFlag{true});
@@ -38,6 +41,12 @@ PlatformPublisher::PlatformPublisher(
     LOG(FATAL) << "Error binding to URL '" << platformPubUrl_ << "' "
                << platformPub.error();
   }
+
+  if (batchWindow_.count() > 0) {
+    CHECK(evl) << "Batching platform events requires an event loop";
+    batchTimer_ = fbzmq::ZmqTimeout::make(
+        evl, [this]() noexcept { flushPendingEvents(); });
+  }
 }
 
 void
@@ -71,6 +80,15 @@ PlatformPublisher::publishNeighborEvent(
   publishPlatformEvent(msg);
 }
 
+void
+PlatformPublisher::publishEventBatch(
+    const thrift::PlatformEventBatch& batch) const {
+  thrift::PlatformEvent msg;
+  msg.eventType = thrift::PlatformEventType::BATCH_EVENT;
+  msg.eventData = fbzmq::util::writeThriftObjStr(batch, serializer_);
+  publishPlatformEvent(msg);
+}
+
 void
 PlatformPublisher::publishPlatformEvent(
     const thrift::PlatformEvent& msg) const {
@@ -79,7 +97,12 @@ PlatformPublisher::publishPlatformEvent(
   // send header of event in the first 2 byte
   platformPubSock_.sendMore(
       fbzmq::Message::from(static_cast<uint16_t>(eventType)).value());
-  const auto sendNeighEntry = platformPubSock_.sendThriftObj(msg, serializer_);
+  // NOTE: copy on purpose, to stamp sequence number
+  auto event = msg;
+  auto& nextSeqNum = nextSeqNums_.emplace(eventType, 1).first->second;
+  event.seqNum = nextSeqNum++;
+  const auto sendNeighEntry =
+      platformPubSock_.sendThriftObj(event, serializer_);
   if (sendNeighEntry.hasError()) {
     LOG(ERROR) << "Error in sending PlatformEventType Entry, event Type: "
                << folly::get_default(
@@ -93,12 +116,20 @@ void
 PlatformPublisher::linkEventFunc(
     const std::string& ifName, const openr::fbnl::Link& linkEntry) noexcept {
   VLOG(4) << "Handling Link Event in NetlinkSystemHandler...";
-  publishLinkEvent(thrift::LinkEntry(
+  thrift::LinkEntry link(
       FRAGILE,
       ifName,
       linkEntry.getIfIndex(),
       linkEntry.isUp(),
-      Constants::kDefaultAdjWeight));
+      Constants::kDefaultAdjWeight);
+  if (!batchTimer_) {
+    publishLinkEvent(link);
+    return;
+  }
+  pendingLinks_[ifName] = std::move(link);
+  if (!batchTimer_->isScheduled()) {
+    batchTimer_->scheduleTimeout(batchWindow_);
+  }
 }
 
 void
@@ -106,11 +137,17 @@ PlatformPublisher::addrEventFunc(
     const std::string& ifName,
     const openr::fbnl::IfAddress& addrEntry) noexcept {
   VLOG(4) << "Handling Address Event in NetlinkSystemHandler...";
-  publishAddrEvent(thrift::AddrEntry(
-      FRAGILE,
-      ifName,
-      toIpPrefix(addrEntry.getPrefix().value()),
-      addrEntry.isValid()));
+  const auto& prefix = addrEntry.getPrefix().value();
+  thrift::AddrEntry addr(
+      FRAGILE, ifName, toIpPrefix(prefix), addrEntry.isValid());
+  if (!batchTimer_) {
+    publishAddrEvent(addr);
+    return;
+  }
+  pendingAddrs_[std::make_pair(ifName, prefix)] = std::move(addr);
+  if (!batchTimer_->isScheduled()) {
+    batchTimer_->scheduleTimeout(batchWindow_);
+  }
 }
 
 void
@@ -118,12 +155,46 @@ PlatformPublisher::neighborEventFunc(
     const std::string& ifName,
     const openr::fbnl::Neighbor& neighborEntry) noexcept {
   VLOG(4) << "Handling Neighbor Event in NetlinkSystemHandler...";
-  publishNeighborEvent(thrift::NeighborEntry(
+  thrift::NeighborEntry neighbor(
       FRAGILE,
       ifName,
       toBinaryAddress(neighborEntry.getDestination()),
       neighborEntry.getLinkAddress().value().toString(),
-      neighborEntry.isReachable()));
+      neighborEntry.isReachable());
+  if (!batchTimer_) {
+    publishNeighborEvent(neighbor);
+    return;
+  }
+  pendingNeighbors_[std::make_pair(ifName, neighborEntry.getDestination())] =
+      std::move(neighbor);
+  if (!batchTimer_->isScheduled()) {
+    batchTimer_->scheduleTimeout(batchWindow_);
+  }
+}
+
+void
+PlatformPublisher::flushPendingEvents() {
+  thrift::PlatformEventBatch batch;
+  batch.linkEntries.reserve(pendingLinks_.size());
+  for (auto& kv : pendingLinks_) {
+    batch.linkEntries.emplace_back(std::move(kv.second));
+  }
+  batch.addrEntries.reserve(pendingAddrs_.size());
+  for (auto& kv : pendingAddrs_) {
+    batch.addrEntries.emplace_back(std::move(kv.second));
+  }
+  batch.neighborEntries.reserve(pendingNeighbors_.size());
+  for (auto& kv : pendingNeighbors_) {
+    batch.neighborEntries.emplace_back(std::move(kv.second));
+  }
+  pendingLinks_.clear();
+  pendingAddrs_.clear();
+  pendingNeighbors_.clear();
+
+  VLOG(2) << "Publishing batch of " << batch.linkEntries.size() << " link, "
+          << batch.addrEntries.size() << " address and "
+          << batch.neighborEntries.size() << " neighbor events";
+  publishEventBatch(batch);
 }
 
 void
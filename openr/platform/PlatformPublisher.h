@@ -10,11 +10,16 @@
 #include <syslog.h>
 #include <chrono>
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
+#include <fbzmq/async/ZmqEventLoop.h>
+#include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/zmq/Zmq.h>
+#include <folly/IPAddress.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Types.h>
@@ -29,6 +34,16 @@ namespace openr {
  * message passing mechanism. Event will be sent over Zmq PUB socket which
  * OpenR modules can subscribe through SUB socket. The subscriber modules is
  * LinkMonitor from Open/R side.
+ *
+ * With a batch window, events received within the window are coalesced and
+ * published as one BATCH_EVENT carrying the last state of each link, address
+ * and neighbor. Events must then be delivered in the thread of given event
+ * loop, e.g. the one of NetlinkSocket.
+ *
+ * Published events of each type are stamped with consecutive sequence
+ * numbers, so that subscribers can detect events lost on the way (PUB drops
+ * messages past its high water mark) and only resync on gaps. They are per
+ * type, as subscribers only receive types they subscribe to.
  */
 class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
  public:
@@ -37,7 +52,9 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       // Immutable state initializers
       //
       fbzmq::Context& context,
-      const PlatformPublisherUrl& platformPubUrl);
+      const PlatformPublisherUrl& platformPubUrl,
+      fbzmq::ZmqEventLoop* evl = nullptr,
+      std::chrono::milliseconds batchWindow = std::chrono::milliseconds(0));
 
   ~PlatformPublisher() = default;
 
@@ -53,6 +70,8 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
 
   void publishNeighborEvent(const thrift::NeighborEntry& neighbor) const;
 
+  void publishEventBatch(const thrift::PlatformEventBatch& batch) const;
+
   void stop();
 
  private:
@@ -69,6 +88,9 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
       const std::string& ifName,
       const openr::fbnl::Neighbor& neighborEntry) noexcept override;
 
+  // Publish pending events of batch window as one batch
+  void flushPendingEvents();
+
   // Publish link events to, e.g., LinkMonitor and Squire
   const std::string platformPubUrl_;
 
@@ -77,6 +99,23 @@ class PlatformPublisher final : public fbnl::NetlinkSocket::EventsHandler {
 
   // used for communicating over thrift/zmq sockets
   apache::thrift::CompactSerializer serializer_;
+
+  // sequence number of next published event of each type. Consumed by every
+  // event, even if sending it fails, so that subscribers see the gap
+  mutable std::map<thrift::PlatformEventType, int64_t> nextSeqNums_;
+
+  // window to coalesce events in, 0 to publish each event
+  const std::chrono::milliseconds batchWindow_{0};
+
+  // fires at the end of batch window. Only set in batch mode
+  std::unique_ptr<fbzmq::ZmqTimeout> batchTimer_{nullptr};
+
+  // last state of links, addresses and neighbors changed within batch window
+  std::unordered_map<std::string, thrift::LinkEntry> pendingLinks_;
+  std::map<std::pair<std::string, folly::CIDRNetwork>, thrift::AddrEntry>
+      pendingAddrs_;
+  std::map<std::pair<std::string, folly::IPAddress>, thrift::NeighborEntry>
+      pendingNeighbors_;
 };
 
 } // namespace openr
@@ -27,8 +27,25 @@ extern "C" {
 #include <netlink/route/link/veth.h>
 #include <netlink/route/route.h>
 #include <sys/ioctl.h>
+#include <sys/resource.h>
 }
 
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes parameters to another one, with a custom name for
+ * each set of parameters
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FB_STRINGIZE(name) "(" FB_STRINGIZE(param_name) ")",             \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
 using namespace openr::fbnl;
 
 namespace {
@@ -39,6 +56,8 @@ const std::string kVethNameY("vethTestY");
 static const uint8_t kBitMaskLen = 128;
 // Number of nexthops
 const uint8_t kNumOfNexthops = 128;
+// Number of nexthops of routes programmed one by one or in batches
+const uint8_t kNumOfBatchNexthops = 4;
 
 } // namespace
 
@@ -46,6 +65,18 @@ namespace openr {
 
 const int16_t kFibId{static_cast<int16_t>(thrift::FibClient::OPENR)};
 
+// Route operation measured by BM_NetlinkFibHandlerScale
+enum class RouteOp {
+  // Add routes to empty route table
+  ADD,
+  // Delete all routes
+  DELETE,
+  // Replace next-hops of all routes with wider ECMP groups
+  ECMP_CHANGE,
+  // Sync route table with the routes already programmed
+  SYNC,
+};
+
 // This class creates virtual interface (veths)
 // which the Benchmark test can use to add routes (via interface)
 class NetlinkFibWrapper {
@@ -225,12 +256,232 @@ BM_NetlinkFibHandler(uint32_t iters, size_t numOfPrefixes) {
   }
 }
 
+/**
+ * Benchmark programming routes one at a time, waiting for the netlink ack of
+ * each route, against programming them in pipelined batches
+ * 1. Generate random IpV6 routes
+ * 2. Add routes through netlink, one by one or in batches
+ * 3. Delete them again, not measured
+ */
+static void
+BM_NetlinkFibHandlerProgramming(
+    uint32_t iters, size_t numOfPrefixes, bool batched) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto netlinkFibWrapper = std::make_unique<NetlinkFibWrapper>();
+
+  // Randomly generate IPV6 prefixes
+  auto prefixes = netlinkFibWrapper->prefixGenerator.ipv6PrefixGenerator(
+      numOfPrefixes, kBitMaskLen);
+  std::vector<thrift::UnicastRoute> routes;
+  routes.reserve(prefixes.size());
+  for (auto const& prefix : prefixes) {
+    routes.emplace_back(createUnicastRoute(
+        prefix,
+        netlinkFibWrapper->prefixGenerator.getRandomNextHopsUnicast(
+            kNumOfBatchNexthops, kVethNameY)));
+  }
+
+  for (uint32_t i = 0; i < iters; i++) {
+    suspender.dismiss(); // Start measuring benchmark time
+    if (batched) {
+      netlinkFibWrapper->fibHandler
+          ->future_addUnicastRoutes(
+              kFibId,
+              std::make_unique<std::vector<thrift::UnicastRoute>>(routes))
+          .wait();
+    } else {
+      for (auto const& route : routes) {
+        netlinkFibWrapper->fibHandler
+            ->future_addUnicastRoute(
+                kFibId, std::make_unique<thrift::UnicastRoute>(route))
+            .wait();
+      }
+    }
+    suspender.rehire(); // Stop measuring time again
+
+    netlinkFibWrapper->fibHandler
+        ->future_deleteUnicastRoutes(
+            kFibId, std::make_unique<std::vector<thrift::IpPrefix>>(prefixes))
+        .wait();
+  }
+}
+
+/**
+ * Benchmark throughput of one route operation at scale, exported as routes
+ * per second along with peak RSS of benchmark process
+ * 1. Generate random IpV6 routes
+ * 2. Program them if operation expects them, not measured
+ * 3. Apply operation to all routes through NetlinkFibHandler
+ * 4. Delete remaining routes, not measured
+ */
+static void
+BM_NetlinkFibHandlerScale(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    size_t numOfPrefixes,
+    RouteOp op) {
+  auto suspender = folly::BenchmarkSuspender();
+  auto netlinkFibWrapper = std::make_unique<NetlinkFibWrapper>();
+  auto& fibHandler = netlinkFibWrapper->fibHandler;
+
+  auto prefixes = netlinkFibWrapper->prefixGenerator.ipv6PrefixGenerator(
+      numOfPrefixes, kBitMaskLen);
+  std::vector<thrift::UnicastRoute> routes;
+  std::vector<thrift::UnicastRoute> wideRoutes;
+  routes.reserve(prefixes.size());
+  for (auto const& prefix : prefixes) {
+    routes.emplace_back(createUnicastRoute(
+        prefix,
+        netlinkFibWrapper->prefixGenerator.getRandomNextHopsUnicast(
+            kNumOfBatchNexthops, kVethNameY)));
+    if (op == RouteOp::ECMP_CHANGE) {
+      wideRoutes.emplace_back(createUnicastRoute(
+          prefix,
+          netlinkFibWrapper->prefixGenerator.getRandomNextHopsUnicast(
+              kNumOfNexthops, kVethNameY)));
+    }
+  }
+
+  std::chrono::steady_clock::duration measuredTime{0};
+  for (uint32_t i = 0; i < iters; i++) {
+    if (op != RouteOp::ADD) {
+      fibHandler
+          ->future_addUnicastRoutes(
+              kFibId,
+              std::make_unique<std::vector<thrift::UnicastRoute>>(routes))
+          .wait();
+    }
+
+    suspender.dismiss(); // Start measuring benchmark time
+    const auto startTime = std::chrono::steady_clock::now();
+    switch (op) {
+    case RouteOp::ADD:
+      fibHandler
+          ->future_addUnicastRoutes(
+              kFibId,
+              std::make_unique<std::vector<thrift::UnicastRoute>>(routes))
+          .wait();
+      break;
+    case RouteOp::DELETE:
+      fibHandler
+          ->future_deleteUnicastRoutes(
+              kFibId, std::make_unique<std::vector<thrift::IpPrefix>>(prefixes))
+          .wait();
+      break;
+    case RouteOp::ECMP_CHANGE:
+      fibHandler
+          ->future_addUnicastRoutes(
+              kFibId,
+              std::make_unique<std::vector<thrift::UnicastRoute>>(wideRoutes))
+          .wait();
+      break;
+    case RouteOp::SYNC:
+      fibHandler
+          ->future_syncFib(
+              kFibId,
+              std::make_unique<std::vector<thrift::UnicastRoute>>(routes))
+          .wait();
+      break;
+    }
+    measuredTime += std::chrono::steady_clock::now() - startTime;
+    suspender.rehire(); // Stop measuring time again
+
+    if (op != RouteOp::DELETE) {
+      fibHandler
+          ->future_deleteUnicastRoutes(
+              kFibId, std::make_unique<std::vector<thrift::IpPrefix>>(prefixes))
+          .wait();
+    }
+  }
+
+  const auto measuredUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(measuredTime)
+          .count();
+  counters["routes_per_sec"] = measuredUs == 0
+      ? 0
+      : numOfPrefixes * iters * 1000000 / static_cast<uint64_t>(measuredUs);
+
+  // Peak resident memory of process so far, in KB
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  counters["peak_rss_kb"] = usage.ru_maxrss;
+}
+
 // The parameter is the number of prefixes
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 10);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 100);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 1000);
 BENCHMARK_PARAM(BM_NetlinkFibHandler, 10000);
 
+// The first parameter is the number of prefixes, the second whether routes
+// are programmed in batches
+BENCHMARK_NAMED_PARAM(
+    BM_NetlinkFibHandlerProgramming, 10000_per_route, 10000, false);
+BENCHMARK_NAMED_PARAM(
+    BM_NetlinkFibHandlerProgramming, 10000_batched, 10000, true);
+BENCHMARK_NAMED_PARAM(
+    BM_NetlinkFibHandlerProgramming, 100000_per_route, 100000, false);
+BENCHMARK_NAMED_PARAM(
+    BM_NetlinkFibHandlerProgramming, 100000_batched, 100000, true);
+
+// The first parameter is the number of prefixes, the second the operation
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 1000_add, 1000, RouteOp::ADD);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 1000_delete, 1000, RouteOp::DELETE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    1000_ecmp_change,
+    1000,
+    RouteOp::ECMP_CHANGE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 1000_sync, 1000, RouteOp::SYNC);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 10000_add, 10000, RouteOp::ADD);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 10000_delete, 10000, RouteOp::DELETE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    10000_ecmp_change,
+    10000,
+    RouteOp::ECMP_CHANGE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 10000_sync, 10000, RouteOp::SYNC);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 100000_add, 100000, RouteOp::ADD);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    100000_delete,
+    100000,
+    RouteOp::DELETE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    100000_ecmp_change,
+    100000,
+    RouteOp::ECMP_CHANGE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 100000_sync, 100000, RouteOp::SYNC);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 500000_add, 500000, RouteOp::ADD);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    500000_delete,
+    500000,
+    RouteOp::DELETE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale,
+    counters,
+    500000_ecmp_change,
+    500000,
+    RouteOp::ECMP_CHANGE);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_NetlinkFibHandlerScale, counters, 500000_sync, 500000, RouteOp::SYNC);
+
 } // namespace openr
 
 int
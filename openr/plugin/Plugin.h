@@ -7,15 +7,24 @@
 
 #pragma once
 
+#include <memory>
+
 #include <fbzmq/zmq/Zmq.h>
 #include <openr/common/Types.h>
 
 namespace openr {
+class Decision;
+class PrefixManager;
+
 struct PluginArgs {
   std::string myNodeName;
   fbzmq::Context& zmqContext;
   PrefixManagerLocalCmdUrl prefixManagerUrl;
   DecisionPubUrl decisionPubUrl;
+  // In-process access to modules skipping serialization, see
+  // Decision::setRouteDeltaCallback and PrefixManager::processPrefixRequest
+  std::shared_ptr<Decision> decision;
+  std::shared_ptr<PrefixManager> prefixManager;
 };
 
 void pluginStart(const PluginArgs& /* pluginArgs */);
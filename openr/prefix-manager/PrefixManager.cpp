@@ -19,6 +19,10 @@ namespace openr {
 namespace {
 // key for the persist config on disk
 const std::string kConfigKey{"prefix-manager-config"};
+// key for changes to persist config on disk since it was saved
+const std::string kConfigDeltaKey{"prefix-manager-config-delta"};
+// max size of delta before it is compacted into persist config
+const size_t kMaxConfigDeltaSize{1000};
 // various error messages
 const std::string kErrorNoChanges{"No changes in prefixes to be advertised"};
 const std::string kErrorNoPrefixToRemove{"No prefix to remove"};
@@ -37,19 +41,28 @@ PrefixManager::PrefixManager(
     bool enablePerfMeasurement,
     const std::chrono::seconds prefixHoldTime,
     const std::chrono::milliseconds ttlKeyInKvStore,
-    fbzmq::Context& zmqContext)
+    fbzmq::Context& zmqContext,
+    const std::chrono::milliseconds persistThrottleTimeout,
+    int32_t numPrefixDbShards,
+    bool compressPrefixDb)
     : OpenrEventLoop(
           nodeId, thrift::OpenrModuleType::PREFIX_MANAGER, zmqContext),
       nodeId_(nodeId),
       configStoreClient_{persistentStoreUrl, zmqContext},
       prefixDbMarker_{prefixDbMarker},
       perPrefixKeys_{perPrefixKeys},
+      numPrefixDbShards_{perPrefixKeys ? 0 : numPrefixDbShards},
       enablePerfMeasurement_{enablePerfMeasurement},
       prefixHoldUntilTimePoint_(
           std::chrono::steady_clock::now() + prefixHoldTime),
       ttlKeyInKvStore_(ttlKeyInKvStore),
       kvStoreClient_{
           zmqContext, this, nodeId_, kvStoreLocalCmdUrl, kvStoreLocalPubUrl} {
+  if (compressPrefixDb) {
+    kvStoreClient_.setCompressedKeyPrefixes(
+        {static_cast<std::string>(prefixDbMarker_)});
+  }
+
   // pick up prefixes from disk
   auto maybePrefixDb =
       configStoreClient_.loadThriftObj<thrift::PrefixDatabase>(kConfigKey);
@@ -59,9 +72,29 @@ PrefixManager::PrefixManager(
     for (const auto& entry : maybePrefixDb.value().prefixEntries) {
       LOG(INFO) << "  > " << toString(entry.prefix);
       prefixMap_[entry.prefix] = entry;
+      persistedFullPrefixes_.emplace(entry.prefix);
     }
     // Prefixes will be advertised after prefixHoldUntilTimePoint_
   }
+  // and apply changes saved since
+  auto maybePrefixDbDelta =
+      configStoreClient_.loadThriftObj<thrift::PrefixDatabaseDelta>(
+          kConfigDeltaKey);
+  if (maybePrefixDbDelta.hasValue()) {
+    LOG(INFO) << "Successfully loaded "
+              << maybePrefixDbDelta->prefixEntries.size() << " and "
+              << maybePrefixDbDelta->withdrawnPrefixes.size()
+              << " withdrawn prefixes from disk";
+    for (const auto& prefix : maybePrefixDbDelta->withdrawnPrefixes) {
+      prefixMap_.erase(prefix);
+      persistedPrefixDelta_[prefix] = folly::none;
+    }
+    for (const auto& entry : maybePrefixDbDelta->prefixEntries) {
+      LOG(INFO) << "  > " << toString(entry.prefix);
+      prefixMap_[entry.prefix] = entry;
+      persistedPrefixDelta_[entry.prefix] = entry;
+    }
+  }
 
   // register kvstore publication callback
   std::vector<std::string> keyPrefixList;
@@ -77,6 +110,12 @@ PrefixManager::PrefixManager(
         processKeyPrefixUpdate(key, thriftVal);
       });
 
+  // Create throttled persistPrefixDb, to inline it if no timeout
+  if (persistThrottleTimeout != std::chrono::milliseconds(0)) {
+    persistPrefixDbThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
+        this, persistThrottleTimeout, [this]() noexcept { persistPrefixDb(); });
+  }
+
   // Create throttled updateKvStore
   updateKvStoreThrottled_ = std::make_unique<fbzmq::ZmqThrottle>(
       this, Constants::kPrefixMgrKvThrottleTimeout, [this]() noexcept {
@@ -95,6 +134,10 @@ PrefixManager::PrefixManager(
           prefixesToUpdate_.emplace_back(kv.second.prefix, kv.second.type);
         }
       }
+      // advertise all shards, including empty ones
+      for (int32_t shard = 0; shard < numPrefixDbShards_; ++shard) {
+        shardsToUpdate_.emplace(shard);
+      }
       updateKvStore();
     });
 
@@ -119,11 +162,39 @@ PrefixManager::processKeyPrefixUpdate(
     std::string const& key, folly::Optional<thrift::Value> value) noexcept {
   LOG(INFO) << nodeId_ << ": Received update for " << key;
   if (!value.hasValue()) {
+    valueHashes_.erase(key);
+    advertisedPrefixKeys_.erase(key);
     return;
   }
+  if (value->value.hasValue() and
+      not valueHashes_.update(key, value->value.value())) {
+    // same prefix database under new version, handled already
+    tData_.addStatValue(
+        "prefix_manager.unchanged_values_skipped", 1, fbzmq::COUNT);
+    return;
+  }
+  auto advertisedIt = advertisedPrefixKeys_.find(key);
+  if (advertisedIt != advertisedPrefixKeys_.end()) {
+    if (value->value.hasValue() and
+        advertisedIt->second.second ==
+            std::hash<std::string>{}(value->value.value())) {
+      // echo of our current advertisement of key
+      tData_.addStatValue(
+          "prefix_manager.own_prefix_keys_skipped", 1, fbzmq::COUNT);
+      return;
+    }
+    auto it = prefixMap_.find(advertisedIt->second.first);
+    if (it != prefixMap_.end()) {
+      // stale value of an advertised prefix, override it
+      advertisePrefix(it->second);
+      return;
+    }
+    // withdrawn prefix, value tells whether it is withdrawn already
+  }
   auto prefixKey = PrefixKey::fromStr(key);
+  auto prefixShardKey = PrefixShardKey::fromStr(key);
   if (prefixKey.hasValue()) {
-    auto prefixDb = fbzmq::util::readThriftObjStr<thrift::PrefixDatabase>(
+    auto prefixDb = readThriftValue<thrift::PrefixDatabase>(
         value.value().value.value(), serializer_);
 
     CHECK_EQ(prefixDb.prefixEntries.size(), 1);
@@ -146,12 +217,56 @@ PrefixManager::processKeyPrefixUpdate(
       // update just in case.
       advertisePrefix(it->second);
     }
+  } else if (prefixShardKey.hasValue()) {
+    processPrefixShardUpdate(prefixShardKey.value(), value.value());
   } else {
     // old key format, send prefix key update
     updateKvStore();
   }
 }
 
+void
+PrefixManager::processPrefixShardUpdate(
+    const PrefixShardKey& prefixShardKey, const thrift::Value& value) {
+  // key of other node with our name as prefix
+  if (prefixShardKey.getNodeName() != nodeId_ or not value.value.hasValue()) {
+    return;
+  }
+
+  const auto shard = prefixShardKey.getShard();
+  if (shard >= numPrefixDbShards_) {
+    // left over of more shards before restart, empty it so that prefixes now
+    // in other shards are not advertised twice until it expires. Keys of past
+    // shards expire on their own if prefix shards are not used anymore
+    if (numPrefixDbShards_ == 0) {
+      return;
+    }
+    auto prefixDb = readThriftValue<thrift::PrefixDatabase>(
+        value.value.value(), serializer_);
+    if (prefixDb.prefixEntries.empty()) {
+      return;
+    }
+    LOG(INFO) << "Clearing stale prefix shard "
+              << prefixShardKey.getPrefixShardKey();
+    thrift::PrefixDatabase emptyPrefixDb;
+    emptyPrefixDb.thisNodeName = nodeId_;
+    kvStoreClient_.clearKey(
+        prefixShardKey.getPrefixShardKey(),
+        fbzmq::util::writeThriftObjStr(emptyPrefixDb, serializer_),
+        ttlKeyInKvStore_);
+    return;
+  }
+
+  // our own update, or stale one to override with current shard
+  auto it = advertisedPrefixShardHashes_.find(shard);
+  if (it != advertisedPrefixShardHashes_.end() and
+      it->second == std::hash<std::string>{}(value.value.value())) {
+    return;
+  }
+  shardsToUpdate_.emplace(shard);
+  updateKvStore();
+}
+
 void
 PrefixManager::persistPrefixDb() {
   if (std::chrono::steady_clock::now() < prefixHoldUntilTimePoint_) {
@@ -159,14 +274,63 @@ PrefixManager::persistPrefixDb() {
     return;
   }
 
-  // prefixDb persistent entries have changed,
+  // prefixDb persistent entries have changed, add the changes to delta on top
+  // of full prefixDb saved to disk
+  bool deltaChanged{false};
+  for (const auto& prefix : prefixesToPersist_) {
+    auto it = prefixMap_.find(prefix);
+    if (it != prefixMap_.end() and
+        ((not it->second.ephemeral.hasValue()) ||
+         (not it->second.ephemeral.value()))) {
+      persistedPrefixDelta_[prefix] = it->second;
+      deltaChanged = true;
+    } else if (persistedFullPrefixes_.count(prefix)) {
+      persistedPrefixDelta_[prefix] = folly::none;
+      deltaChanged = true;
+    } else if (persistedPrefixDelta_.erase(prefix)) {
+      deltaChanged = true;
+    }
+  }
+  prefixesToPersist_.clear();
+
+  if (not deltaChanged) {
+    return;
+  }
+
+  // Saving delta gets as expensive as saving everything as it grows
+  if (persistedPrefixDelta_.size() > kMaxConfigDeltaSize) {
+    tData_.addStatValue("prefix_manager.compact_prefix_db", 1, fbzmq::COUNT);
+    persistFullPrefixDb();
+    return;
+  }
+
+  thrift::PrefixDatabaseDelta prefixDbDelta;
+  for (const auto& kv : persistedPrefixDelta_) {
+    if (kv.second.hasValue()) {
+      prefixDbDelta.prefixEntries.emplace_back(kv.second.value());
+    } else {
+      prefixDbDelta.withdrawnPrefixes.emplace_back(kv.first);
+    }
+  }
+
+  auto ret = configStoreClient_.storeThriftObj(kConfigDeltaKey, prefixDbDelta);
+  if (ret.hasError()) {
+    LOG(ERROR) << "Error saving persistent prefixDb delta to file. "
+               << ret.error();
+  }
+}
+
+void
+PrefixManager::persistFullPrefixDb() {
   // save the newest persistent entries to disk.
   thrift::PrefixDatabase persistentPrefixDb;
   persistentPrefixDb.thisNodeName = nodeId_;
+  persistedFullPrefixes_.clear();
   for (const auto& kv : prefixMap_) {
     if ((not kv.second.ephemeral.hasValue()) ||
         (not kv.second.ephemeral.value())) {
       persistentPrefixDb.prefixEntries.emplace_back(kv.second);
+      persistedFullPrefixes_.emplace(kv.first);
     }
   }
 
@@ -182,6 +346,15 @@ PrefixManager::persistPrefixDb() {
   auto ret = configStoreClient_.storeThriftObj(kConfigKey, persistentPrefixDb);
   if (ret.hasError()) {
     LOG(ERROR) << "Error saving persistent prefixDb to file. " << ret.error();
+    return;
+  }
+
+  // Delta is part of saved prefixDb now
+  persistedPrefixDelta_.clear();
+  auto ret2 = configStoreClient_.erase(kConfigDeltaKey);
+  if (ret2.hasError()) {
+    LOG(ERROR) << "Error erasing persistent prefixDb delta from file. "
+               << ret2.error();
   }
 }
 
@@ -196,13 +369,21 @@ PrefixManager::advertisePrefixWithdraw(const thrift::PrefixEntry& prefixEntry) {
       nodeId_,
       folly::IPAddress::createNetwork(toString(prefixEntry.prefix)),
       0);
+  advertisedPrefixKeys_[prefixKey.getPrefixKey()] = std::make_pair(
+      prefixEntry.prefix, std::hash<std::string>{}(prefxDbStr));
   kvStoreClient_.clearKey(
       prefixKey.getPrefixKey(), prefxDbStr, ttlKeyInKvStore_);
 }
 
 void
 PrefixManager::advertisePrefix(const thrift::PrefixEntry& prefixEntry) {
-  /* code */
+  auto keyVal = getPrefixKeyVal(prefixEntry);
+  VLOG(1) << "Writing prefix to KvStore " << keyVal.first;
+  kvStoreClient_.persistKey(keyVal.first, keyVal.second, ttlKeyInKvStore_);
+}
+
+std::pair<std::string, std::string>
+PrefixManager::getPrefixKeyVal(const thrift::PrefixEntry& prefixEntry) {
   thrift::PrefixDatabase prefixDb;
   prefixDb.thisNodeName = nodeId_;
   prefixDb.prefixEntries.emplace_back(prefixEntry);
@@ -211,17 +392,20 @@ PrefixManager::advertisePrefix(const thrift::PrefixEntry& prefixEntry) {
       nodeId_,
       folly::IPAddress::createNetwork(toString(prefixEntry.prefix)),
       0);
-  auto prefixKeyStr = ipPrefixKey.getPrefixKey();
-  const auto prefixDbVal =
-      fbzmq::util::writeThriftObjStr(prefixDb, serializer_);
-  VLOG(1) << "Writing prefix to KvStore " << prefixKeyStr;
-  kvStoreClient_.persistKey(prefixKeyStr, prefixDbVal, ttlKeyInKvStore_);
+  auto keyVal = std::make_pair(
+      ipPrefixKey.getPrefixKey(),
+      fbzmq::util::writeThriftObjStr(prefixDb, serializer_));
+  advertisedPrefixKeys_[keyVal.first] = std::make_pair(
+      prefixEntry.prefix, std::hash<std::string>{}(keyVal.second));
+  return keyVal;
 }
 
 void
 PrefixManager::updateKvStorePrefixKeys() {
   // Incremental prefix updates, either add or delete from kvstore
   // Check prefixMap_ to decide whether to add or delete
+  // Added prefixes are persisted with a single request to KvStore
+  std::unordered_map<std::string, std::string> keyVals;
   for (const auto& ipPrefix : prefixesToUpdate_) {
     auto it = prefixMap_.find(ipPrefix.first);
     if (it == prefixMap_.end()) {
@@ -230,10 +414,54 @@ PrefixManager::updateKvStorePrefixKeys() {
       prefixEntry.type = ipPrefix.second;
       advertisePrefixWithdraw(prefixEntry);
     } else {
-      advertisePrefix(it->second);
+      keyVals.insert(getPrefixKeyVal(it->second));
     }
   }
   prefixesToUpdate_.clear();
+
+  if (not keyVals.empty()) {
+    VLOG(1) << "Writing " << keyVals.size() << " prefixes to KvStore";
+    kvStoreClient_.persistKeys(keyVals, ttlKeyInKvStore_);
+  }
+}
+
+void
+PrefixManager::updateKvStorePrefixShards() {
+  for (const auto& ipPrefix : prefixesToUpdate_) {
+    shardsToUpdate_.emplace(
+        PrefixShardKey::getShardOfPrefix(ipPrefix.first, numPrefixDbShards_));
+  }
+  prefixesToUpdate_.clear();
+  if (shardsToUpdate_.empty()) {
+    return;
+  }
+
+  // Collect prefixes of changed shards only, so that flooded update is bound
+  // by size of a shard
+  std::unordered_map<int32_t, thrift::PrefixDatabase> shardPrefixDbs;
+  for (const auto shard : shardsToUpdate_) {
+    shardPrefixDbs[shard].thisNodeName = nodeId_;
+  }
+  shardsToUpdate_.clear();
+  for (const auto& kv : prefixMap_) {
+    auto it = shardPrefixDbs.find(
+        PrefixShardKey::getShardOfPrefix(kv.first, numPrefixDbShards_));
+    if (it != shardPrefixDbs.end()) {
+      it->second.prefixEntries.emplace_back(kv.second);
+    }
+  }
+
+  std::unordered_map<std::string, std::string> keyVals;
+  for (const auto& kv : shardPrefixDbs) {
+    auto prefixDbVal = fbzmq::util::writeThriftObjStr(kv.second, serializer_);
+    advertisedPrefixShardHashes_[kv.first] =
+        std::hash<std::string>{}(prefixDbVal);
+    keyVals.emplace(
+        PrefixShardKey(nodeId_, kv.first).getPrefixShardKey(),
+        std::move(prefixDbVal));
+  }
+  VLOG(1) << "Writing " << keyVals.size() << " prefix shards to KvStore";
+  kvStoreClient_.persistKeys(keyVals, ttlKeyInKvStore_);
 }
 
 void
@@ -248,6 +476,9 @@ PrefixManager::updateKvStore() {
   if (perPrefixKeys_) {
     return updateKvStorePrefixKeys();
   }
+  if (numPrefixDbShards_ > 0) {
+    return updateKvStorePrefixShards();
+  }
   // Update the kvstore with both persistent and ephemeral entries
   thrift::PrefixDatabase prefixDb;
   prefixDb.thisNodeName = nodeId_;
@@ -273,8 +504,23 @@ PrefixManager::processRequestMsg(fbzmq::Message&& request) {
                << maybeThriftReq.error();
     return folly::makeUnexpected(fbzmq::Error());
   }
+  setProfiledRequestName(
+      apache::thrift::TEnumTraits<thrift::PrefixManagerCommand>::findName(
+          maybeThriftReq->cmd));
+
+  return toReplyMsg(processRequest(maybeThriftReq.value()), serializer_);
+}
+
+folly::SemiFuture<std::unique_ptr<thrift::PrefixManagerResponse>>
+PrefixManager::processPrefixRequest(thrift::PrefixManagerRequest request) {
+  return runInEventLoopWithResult<thrift::PrefixManagerResponse>(
+      [this, request = std::move(request)]() {
+        return processRequest(request);
+      });
+}
 
-  const auto& thriftReq = maybeThriftReq.value();
+thrift::PrefixManagerResponse
+PrefixManager::processRequest(const thrift::PrefixManagerRequest& thriftReq) {
   thrift::PrefixManagerResponse response;
   bool persistentEntryChange = false;
   bool kvStoreChange = false;
@@ -308,6 +554,29 @@ PrefixManager::processRequestMsg(fbzmq::Message&& request) {
     }
     break;
   }
+  case thrift::PrefixManagerCommand::UPDATE_PREFIXES: {
+    tData_.addStatValue("prefix_manager.update_prefixes", 1, fbzmq::COUNT);
+    if (isAnyExistingPrefixPersistent(thriftReq.withdrawPrefixes) or
+        isAnyInputPrefixPersistent(thriftReq.prefixes)) {
+      persistentEntryChange = true;
+    }
+    // Withdrawals are verified before anything is changed, to apply all or
+    // nothing of the update
+    if (not removePrefixes(thriftReq.withdrawPrefixes)) {
+      response.success = false;
+      response.message = kErrorNoPrefixToRemove;
+      break;
+    }
+    if (addOrUpdatePrefixes(thriftReq.prefixes) or
+        not thriftReq.withdrawPrefixes.empty()) {
+      kvStoreChange = true;
+      response.success = true;
+    } else {
+      response.success = false;
+      response.message = kErrorNoChanges;
+    }
+    break;
+  }
   case thrift::PrefixManagerCommand::WITHDRAW_PREFIXES_BY_TYPE: {
     if (isAnyExistingPrefixPersistentByType(thriftReq.type)) {
       persistentEntryChange = true;
@@ -361,7 +630,11 @@ PrefixManager::processRequestMsg(fbzmq::Message&& request) {
 
   if (response.success) {
     if (persistentEntryChange) {
-      persistPrefixDb();
+      if (persistPrefixDbThrottled_) {
+        persistPrefixDbThrottled_->operator()();
+      } else {
+        persistPrefixDb();
+      }
     }
     if ((kvStoreChange) and
         (std::chrono::steady_clock::now() >= prefixHoldUntilTimePoint_)) {
@@ -371,7 +644,7 @@ PrefixManager::processRequestMsg(fbzmq::Message&& request) {
     }
   }
 
-  return fbzmq::Message::fromThriftObj(response, serializer_);
+  return response;
 }
 
 void
@@ -381,6 +654,10 @@ PrefixManager::submitCounters() {
   // Extract/build counters from thread-data
   auto counters = tData_.getCounters();
   counters["prefix_manager.zmq_event_queue_size"] = getEventQueueSize();
+  for (auto const& kv : kvStoreClient_.getCounters()) {
+    counters.emplace(kv);
+  }
+  exportProfileCounters(counters);
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
@@ -412,6 +689,11 @@ PrefixManager::getPrefixWithdrawCounter() {
   return getCounter("prefix_manager.withdraw_prefixes.count.0");
 }
 
+int64_t
+PrefixManager::getOwnPrefixKeysSkippedCounter() {
+  return getCounter("prefix_manager.own_prefix_keys_skipped.count.0");
+}
+
 // helpers for modifying our Prefix Db
 bool
 PrefixManager::addOrUpdatePrefixes(
@@ -426,14 +708,16 @@ PrefixManager::addOrUpdatePrefixes(
     if (it == prefixMap_.end()) {
       // Add missing prefix
       prefixMap_.emplace(prefix.prefix, prefix);
+      prefixesToPersist_.emplace(prefix.prefix);
       updated = true;
-      if (perPrefixKeys_) {
+      if (perPrefixKeys_ or numPrefixDbShards_ > 0) {
         prefixesToUpdate_.emplace_back(prefix.prefix, prefix.type);
       }
     } else if (it->second != prefix) {
       it->second = prefix;
+      prefixesToPersist_.emplace(prefix.prefix);
       updated = true;
-      if (perPrefixKeys_) {
+      if (perPrefixKeys_ or numPrefixDbShards_ > 0) {
         prefixesToUpdate_.emplace_back(prefix.prefix, prefix.type);
       }
     }
@@ -464,7 +748,8 @@ PrefixManager::removePrefixes(
               << apache::thrift::TEnumTraits<thrift::PrefixType>::findName(
                      prefix.type);
     if (prefixMap_.erase(prefix.prefix)) {
-      if (perPrefixKeys_) {
+      prefixesToPersist_.emplace(prefix.prefix);
+      if (perPrefixKeys_ or numPrefixDbShards_ > 0) {
         prefixesToUpdate_.emplace_back(prefix.prefix, prefix.type);
       }
     }
@@ -484,7 +769,8 @@ PrefixManager::syncPrefixesByType(
   }
   for (auto it = prefixMap_.begin(); it != prefixMap_.end();) {
     if (it->second.type == type and newPrefixes.count(it->first) == 0) {
-      if (perPrefixKeys_) {
+      prefixesToPersist_.emplace(it->first);
+      if (perPrefixKeys_ or numPrefixDbShards_ > 0) {
         prefixesToUpdate_.emplace_back(it->second.prefix, it->second.type);
       }
       it = prefixMap_.erase(it);
@@ -505,7 +791,8 @@ PrefixManager::removePrefixesByType(thrift::PrefixType type) {
   bool changed = false;
   for (auto iter = prefixMap_.begin(); iter != prefixMap_.end();) {
     if (iter->second.type == type) {
-      if (perPrefixKeys_) {
+      prefixesToPersist_.emplace(iter->first);
+      if (perPrefixKeys_ or numPrefixDbShards_ > 0) {
         prefixesToUpdate_.emplace_back(iter->second.prefix, iter->second.type);
       }
       changed = true;
@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqThrottle.h>
@@ -16,6 +19,7 @@
 #include <folly/IPAddress.h>
 #include <folly/Optional.h>
 
+#include <openr/common/Constants.h>
 #include <openr/common/Util.h>
 #include <openr/config-store/PersistentStoreClient.h>
 #include <openr/if/gen-cpp2/Lsdb_types.h>
@@ -39,7 +43,15 @@ class PrefixManager final : public OpenrEventLoop {
       bool enablePerfMeasurement,
       const std::chrono::seconds prefixHoldTime,
       const std::chrono::milliseconds ttlKeyInKvStore,
-      fbzmq::Context& zmqContext);
+      fbzmq::Context& zmqContext,
+      // coalesce prefix changes saved to disk, zero saves them immediately
+      const std::chrono::milliseconds persistThrottleTimeout =
+          Constants::kPrefixMgrPersistThrottleTimeout,
+      // advertise prefixes hashed into this many prefix shard keys, instead
+      // of one key for all, unless per prefix keys are created
+      int32_t numPrefixDbShards = 0,
+      // compress large prefix databases advertised in KvStore
+      bool compressPrefixDb = false);
 
   // disable copying
   PrefixManager(PrefixManager const&) = delete;
@@ -51,19 +63,41 @@ class PrefixManager final : public OpenrEventLoop {
   // get prefix withdraw counter
   int64_t getPrefixWithdrawCounter();
 
+  // get counter of received prefix keys skipped as our own advertisements
+  int64_t getOwnPrefixKeysSkippedCounter();
+
+  // Typed in-process access, e.g. for plugins injecting batches of prefixes.
+  // Same semantic as a request over the cmd socket, without serialization
+  folly::SemiFuture<std::unique_ptr<thrift::PrefixManagerResponse>>
+  processPrefixRequest(thrift::PrefixManagerRequest request);
+
  private:
-  // Update persistent store with non-ephemeral prefix entries
+  // Update persistent store with changes of non-ephemeral prefix entries
   void persistPrefixDb();
 
+  // Save all non-ephemeral prefix entries to persistent store and discard
+  // saved delta
+  void persistFullPrefixDb();
+
   // Update kvstore with both ephemeral and non-ephemeral prefixes
   void updateKvStore();
 
   // update all IP keys in KvStore
   void updateKvStorePrefixKeys();
 
+  // update prefix shard keys of changed prefixes in KvStore
+  void updateKvStorePrefixShards();
+
+  // handle update of prefix shard key in KvStore, overriding stale ones
+  void processPrefixShardUpdate(
+      const PrefixShardKey& prefixShardKey, const thrift::Value& value);
+
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
       fbzmq::Message&& request) override;
 
+  thrift::PrefixManagerResponse processRequest(
+      const thrift::PrefixManagerRequest& thriftReq);
+
   // helpers to modify prefix db, returns true if the db is modified
   bool addOrUpdatePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
   bool removePrefixes(const std::vector<thrift::PrefixEntry>& prefixes);
@@ -98,6 +132,11 @@ class PrefixManager final : public OpenrEventLoop {
   // add prefix entry in kvstore
   void advertisePrefix(const thrift::PrefixEntry& prefixEntry);
 
+  // key and serialized prefix DB to advertise prefix entry with, recorded in
+  // advertisedPrefixKeys_ as our current advertisement of key
+  std::pair<std::string, std::string> getPrefixKeyVal(
+      const thrift::PrefixEntry& prefixEntry);
+
   // called when withdrawing a prefix, add prefix DB into kvstore with
   // delete prefix DB flag set to true
   void advertisePrefixWithdraw(const thrift::PrefixEntry& prefixEntry);
@@ -113,6 +152,16 @@ class PrefixManager final : public OpenrEventLoop {
   // create IP keys
   bool perPrefixKeys_{false};
 
+  // number of prefix shard keys to spread prefixes in, if more than zero
+  const int32_t numPrefixDbShards_{0};
+
+  // prefix shards to advertise to kvstore
+  std::set<int32_t> shardsToUpdate_;
+
+  // hash of prefix DB last advertised for each prefix shard, to tell our own
+  // updates from stale ones
+  std::unordered_map<int32_t, size_t> advertisedPrefixShardHashes_;
+
   // enable convergence performance measurement for Adjacencies update
   const bool enablePerfMeasurement_{false};
 
@@ -120,6 +169,20 @@ class PrefixManager final : public OpenrEventLoop {
   // timepoint.
   std::chrono::steady_clock::time_point prefixHoldUntilTimePoint_;
 
+  // Throttled version of persistPrefixDb
+  std::unique_ptr<fbzmq::ZmqThrottle> persistPrefixDbThrottled_;
+
+  // Prefixes changed since last persistPrefixDb
+  std::unordered_set<thrift::IpPrefix> prefixesToPersist_;
+
+  // Prefixes of full prefix database last saved to disk
+  std::unordered_set<thrift::IpPrefix> persistedFullPrefixes_;
+
+  // Delta saved to disk on top of full prefix database, persistent entries
+  // added or updated since and folly::none for withdrawn ones
+  std::unordered_map<thrift::IpPrefix, folly::Optional<thrift::PrefixEntry>>
+      persistedPrefixDelta_;
+
   // Throttled version of updateKvStore. It batches up multiple calls and
   // send them in one go!
   std::unique_ptr<fbzmq::ZmqThrottle> updateKvStoreThrottled_;
@@ -133,6 +196,15 @@ class PrefixManager final : public OpenrEventLoop {
   // the current prefix db this node is advertising
   std::unordered_map<thrift::IpPrefix, thrift::PrefixEntry> prefixMap_;
 
+  // prefix databases of our keys last received from kvstore
+  KeyValueHashCache valueHashes_;
+
+  // prefix keys we advertised or withdrew, to their prefix and hash of prefix
+  // DB last written. Tells echoes of our own advertisements from stale values
+  // without parsing them
+  std::unordered_map<std::string, std::pair<thrift::IpPrefix, size_t>>
+      advertisedPrefixKeys_;
+
   // the serializer/deserializer helper we'll be using
   apache::thrift::CompactSerializer serializer_;
 
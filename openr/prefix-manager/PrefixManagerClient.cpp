@@ -40,6 +40,17 @@ PrefixManagerClient::withdrawPrefixes(
   return sendRequest(req);
 }
 
+folly::Expected<thrift::PrefixManagerResponse, fbzmq::Error>
+PrefixManagerClient::updatePrefixes(
+    const std::vector<thrift::PrefixEntry>& prefixesToAdvertise,
+    const std::vector<thrift::PrefixEntry>& prefixesToWithdraw) {
+  thrift::PrefixManagerRequest req;
+  req.cmd = thrift::PrefixManagerCommand::UPDATE_PREFIXES;
+  req.prefixes = prefixesToAdvertise;
+  req.withdrawPrefixes = prefixesToWithdraw;
+  return sendRequest(req);
+}
+
 folly::Expected<thrift::PrefixManagerResponse, fbzmq::Error>
 PrefixManagerClient::withdrawPrefixesByType(thrift::PrefixType type) {
   thrift::PrefixManagerRequest req;
@@ -33,6 +33,11 @@ class PrefixManagerClient {
   folly::Expected<thrift::PrefixManagerResponse, fbzmq::Error> withdrawPrefixes(
       const std::vector<thrift::PrefixEntry>& prefixes);
 
+  // advertise and withdraw prefixes in one request
+  folly::Expected<thrift::PrefixManagerResponse, fbzmq::Error> updatePrefixes(
+      const std::vector<thrift::PrefixEntry>& prefixesToAdvertise,
+      const std::vector<thrift::PrefixEntry>& prefixesToWithdraw);
+
   folly::Expected<thrift::PrefixManagerResponse, fbzmq::Error>
   withdrawPrefixesByType(thrift::PrefixType type);
 
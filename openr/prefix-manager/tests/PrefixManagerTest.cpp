@@ -127,7 +127,8 @@ class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
         false /* prefix-mananger perf measurement */,
         std::chrono::seconds{0},
         Constants::kKvStoreDbTtl,
-        context);
+        context,
+        std::chrono::milliseconds{0} /* persist throttle timeout */);
 
     prefixManagerThread = std::make_unique<std::thread>([this]() {
       LOG(INFO) << "PrefixManager thread starting";
@@ -151,6 +152,7 @@ class PrefixManagerTestFixture : public testing::TestWithParam<bool> {
     PersistentStoreClient configStoreClient{
         PersistentStoreUrl{configStore->inprocCmdUrl}, context};
     configStoreClient.erase("prefix-manager-config");
+    configStoreClient.erase("prefix-manager-config-delta");
 
     // stop config store
     configStore->stop();
@@ -247,6 +249,27 @@ TEST_P(PrefixManagerTestFixture, AddRemovePrefix) {
   EXPECT_TRUE(resp18.value().success);
 }
 
+// Batches injected in-process behave as requests over the cmd socket
+TEST_P(PrefixManagerTestFixture, InProcessRequests) {
+  thrift::PrefixManagerRequest request;
+  request.cmd = thrift::PrefixManagerCommand::ADD_PREFIXES;
+  request.prefixes = {prefixEntry1, prefixEntry2, prefixEntry3};
+  auto resp1 = prefixManager->processPrefixRequest(request).get();
+  EXPECT_TRUE(resp1->success);
+  auto resp2 = prefixManager->processPrefixRequest(request).get();
+  EXPECT_FALSE(resp2->success);
+
+  request.cmd = thrift::PrefixManagerCommand::WITHDRAW_PREFIXES;
+  request.prefixes = {prefixEntry1, prefixEntry2};
+  auto resp3 = prefixManager->processPrefixRequest(request).get();
+  EXPECT_TRUE(resp3->success);
+
+  auto resp4 = prefixManagerClient->getPrefixes();
+  ASSERT_TRUE(resp4.hasValue());
+  ASSERT_EQ(1, resp4.value().prefixes.size());
+  EXPECT_EQ(prefixEntry3, resp4.value().prefixes.at(0));
+}
+
 TEST_P(PrefixManagerTestFixture, RemoveUpdateType) {
   prefixManagerClient->addPrefixes({prefixEntry1});
   prefixManagerClient->addPrefixes({prefixEntry2});
@@ -333,6 +356,37 @@ TEST_P(PrefixManagerTestFixture, RemoveInvalidType) {
   EXPECT_EQ(0, resp4.value().prefixes.size());
 }
 
+TEST_P(PrefixManagerTestFixture, UpdatePrefixes) {
+  EXPECT_TRUE(prefixManagerClient->addPrefixes({prefixEntry1}).value().success);
+
+  // Nothing is applied if any withdrawal is invalid
+  auto resp1 = prefixManagerClient->updatePrefixes(
+      {prefixEntry2, prefixEntry3}, {prefixEntry1, prefixEntry4});
+  EXPECT_FALSE(resp1.value().success);
+  auto resp2 = prefixManagerClient->getPrefixes();
+  EXPECT_EQ(1, resp2.value().prefixes.size());
+
+  // Advertise and withdraw in one update
+  auto resp3 = prefixManagerClient->updatePrefixes(
+      {prefixEntry2, prefixEntry3}, {prefixEntry1});
+  EXPECT_TRUE(resp3.value().success);
+  auto resp4 = prefixManagerClient->getPrefixes();
+  EXPECT_EQ(2, resp4.value().prefixes.size());
+  EXPECT_FALSE(
+      prefixManagerClient->withdrawPrefixes({prefixEntry1}).value().success);
+
+  // No changes
+  auto resp5 = prefixManagerClient->updatePrefixes({prefixEntry2}, {});
+  EXPECT_FALSE(resp5.value().success);
+
+  // Withdraw only
+  auto resp6 =
+      prefixManagerClient->updatePrefixes({}, {prefixEntry2, prefixEntry3});
+  EXPECT_TRUE(resp6.value().success);
+  auto resp7 = prefixManagerClient->getPrefixes();
+  EXPECT_EQ(0, resp7.value().prefixes.size());
+}
+
 TEST_P(PrefixManagerTestFixture, VerifyKvStore) {
   prefixManagerClient->addPrefixes({prefixEntry1});
 
@@ -402,6 +456,78 @@ TEST_P(PrefixManagerTestFixture, VerifyKvStore) {
  * the prefixes managed by the prefix manager. This test does not apply to
  * the old key format
  */
+TEST_P(PrefixManagerTestFixture, VerifyKvStorePrefixShards) {
+  const int32_t numShards{4};
+  auto prefixManager2 = std::make_unique<PrefixManager>(
+      "node-3",
+      PersistentStoreUrl{configStore->inprocCmdUrl},
+      KvStoreLocalCmdUrl{kvStoreWrapper->localCmdUrl},
+      KvStoreLocalPubUrl{kvStoreWrapper->localPubUrl},
+      MonitorSubmitUrl{"inproc://monitor_submit"},
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      false /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds(0),
+      Constants::kKvStoreDbTtl,
+      context,
+      std::chrono::milliseconds{0} /* persist throttle timeout */,
+      numShards);
+
+  auto prefixManagerThread2 = std::make_unique<std::thread>([&]() {
+    LOG(INFO) << "PrefixManager thread starting";
+    prefixManager2->run();
+    LOG(INFO) << "PrefixManager thread finishing";
+  });
+  prefixManager2->waitUntilRunning();
+
+  auto prefixManagerClient2 = std::make_unique<PrefixManagerClient>(
+      PrefixManagerLocalCmdUrl{prefixManager2->inprocCmdUrl}, context);
+
+  auto getShardKey = [&](const thrift::IpPrefix& prefix) {
+    return PrefixShardKey(
+               "node-3", PrefixShardKey::getShardOfPrefix(prefix, numShards))
+        .getPrefixShardKey();
+  };
+
+  const std::vector<thrift::PrefixEntry> prefixEntries{
+      prefixEntry1, prefixEntry2, prefixEntry3, prefixEntry4, prefixEntry5};
+  prefixManagerClient2->addPrefixes(prefixEntries);
+
+  // Wait for throttled update to announce to kvstore
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+
+  // Each prefix is advertised in key of its shard
+  std::set<std::string> shardKeys;
+  for (const auto& entry : prefixEntries) {
+    shardKeys.emplace(getShardKey(entry.prefix));
+  }
+  auto keyVals = kvStoreClient->dumpAllWithPrefix("prefix:node-3:");
+  ASSERT_TRUE(keyVals.hasValue());
+  EXPECT_EQ(shardKeys.size(), keyVals->size());
+  for (const auto& key : shardKeys) {
+    EXPECT_EQ(1, keyVals->count(key));
+  }
+  EXPECT_EQ(5, getPrefixDb("prefix:node-3").size());
+
+  // Withdrawal updates only shard of withdrawn prefix
+  prefixManagerClient2->withdrawPrefixes({prefixEntry1});
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+
+  auto keyVals2 = kvStoreClient->dumpAllWithPrefix("prefix:node-3:");
+  ASSERT_TRUE(keyVals2.hasValue());
+  EXPECT_EQ(keyVals->size(), keyVals2->size());
+  for (const auto& kv : keyVals2.value()) {
+    const auto expectedVersion = keyVals->at(kv.first).version +
+        (kv.first == getShardKey(prefixEntry1.prefix) ? 1 : 0);
+    EXPECT_EQ(expectedVersion, kv.second.version);
+  }
+  EXPECT_EQ(4, getPrefixDb("prefix:node-3").size());
+
+  // cleanup
+  prefixManager2->stop();
+  prefixManagerThread2->join();
+}
+
 TEST_P(PrefixManagerTestFixture, PrefixKeyUpdates) {
   // Create ZmqEventLoop
   fbzmq::ZmqEventLoop evl;
@@ -906,6 +1032,25 @@ TEST_P(PrefixManagerTestFixture, PrefixWithdrawCount) {
   EXPECT_EQ(2, count5);
 }
 
+// Echo of withdrawn prefix key is told from a stale value without parsing it
+TEST_P(PrefixManagerTestFixture, OwnPrefixKeysSkipped) {
+  if (!perPrefixKeys_) {
+    return;
+  }
+  EXPECT_EQ(0, prefixManager->getOwnPrefixKeysSkippedCounter());
+
+  prefixManagerClient->addPrefixes({prefixEntry1});
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+  // persisted keys are not reported back
+  EXPECT_EQ(0, prefixManager->getOwnPrefixKeysSkippedCounter());
+
+  // withdrawn key is reported back with the value we set
+  prefixManagerClient->withdrawPrefixes({prefixEntry1});
+  std::this_thread::sleep_for(2 * Constants::kPrefixMgrKvThrottleTimeout);
+  EXPECT_EQ(1, prefixManager->getOwnPrefixKeysSkippedCounter());
+  EXPECT_EQ(0, getPrefixDb("prefix:node-1").size());
+}
+
 TEST(PrefixManagerTest, HoldTimeout) {
   fbzmq::Context context;
 
@@ -977,6 +1122,64 @@ TEST(PrefixManagerTest, HoldTimeout) {
   configStoreThread.join();
 }
 
+// Verify that prefixes are reloaded from both full prefix db and delta saved
+// on top of it, either before or after delta is compacted
+TEST_P(PrefixManagerTestFixture, CheckReloadDelta) {
+  // Enough prefixes to compact delta into full prefix db
+  std::vector<thrift::PrefixEntry> prefixEntries;
+  for (int i = 0; i < 1001; ++i) {
+    prefixEntries.emplace_back(createPrefixEntry(
+        toIpPrefix(folly::sformat("fc00:{}::/64", i)),
+        thrift::PrefixType::DEFAULT));
+  }
+  EXPECT_TRUE(prefixManagerClient->addPrefixes(prefixEntries).value().success);
+
+  // Changes are saved in delta
+  EXPECT_TRUE(prefixManagerClient->withdrawPrefixes({prefixEntries.at(0)})
+                  .value()
+                  .success);
+  EXPECT_TRUE(prefixManagerClient->addPrefixes({prefixEntry1}).value().success);
+  EXPECT_TRUE(prefixManagerClient->addPrefixes({ephemeralPrefixEntry9})
+                  .value()
+                  .success);
+
+  auto prefixManager2 = std::make_unique<PrefixManager>(
+      "node-2",
+      PersistentStoreUrl{configStore->inprocCmdUrl},
+      KvStoreLocalCmdUrl{kvStoreWrapper->localCmdUrl},
+      KvStoreLocalPubUrl{kvStoreWrapper->localPubUrl},
+      MonitorSubmitUrl{"inproc://monitor_submit"},
+      PrefixDbMarker{Constants::kPrefixDbMarker.toString()},
+      perPrefixKeys_ /* create IP prefix keys */,
+      false /* prefix-mananger perf measurement */,
+      std::chrono::seconds(0),
+      Constants::kKvStoreDbTtl,
+      context);
+
+  auto prefixManagerThread2 = std::make_unique<std::thread>([&]() {
+    LOG(INFO) << "PrefixManager thread starting";
+    prefixManager2->run();
+    LOG(INFO) << "PrefixManager thread finishing";
+  });
+  prefixManager2->waitUntilRunning();
+
+  auto prefixManagerClient2 = std::make_unique<PrefixManagerClient>(
+      PrefixManagerLocalCmdUrl{prefixManager2->inprocCmdUrl}, context);
+
+  auto resp = prefixManagerClient2->getPrefixes();
+  ASSERT_TRUE(resp.value().success);
+  EXPECT_EQ(1001, resp.value().prefixes.size());
+  EXPECT_FALSE(prefixManagerClient2->withdrawPrefixes({prefixEntries.at(0)})
+                   .value()
+                   .success);
+  EXPECT_TRUE(
+      prefixManagerClient2->withdrawPrefixes({prefixEntry1}).value().success);
+
+  // cleanup
+  prefixManager2->stop();
+  prefixManagerThread2->join();
+}
+
 // Verify that persist store is updated only when
 // non-ephemeral types are effected
 TEST_P(PrefixManagerTestFixture, CheckPersistStoreUpdate) {
@@ -22,6 +22,8 @@ class PeekCmd(OpenrCtrlCmd):
             "Last Value Sent",
             "Last Ack From Node",
             "Last Ack To Node",
+            "Lost Pings",
+            "Last RTT (us)",
         ]
         rows = []
         for name, node in resp.nodeInfo.items():
@@ -32,6 +34,8 @@ class PeekCmd(OpenrCtrlCmd):
                     node.lastValSent,
                     node.lastAckFromNode,
                     node.lastAckToNode,
+                    node.lastValSent - node.numAcksFromNode,
+                    node.lastRttUs,
                 ]
             )
 
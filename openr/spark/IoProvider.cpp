@@ -16,6 +16,83 @@
 
 namespace openr {
 
+namespace {
+
+// fill in ifIndex and hopLimit, kernel timestamp and socket drop counter from
+// control data of received message, if present
+void
+parseControlData(
+    struct msghdr* msg,
+    int& ifIndex,
+    int& hopLimit,
+    std::chrono::microseconds& recvTs,
+    folly::Optional<uint32_t>& numDropped) {
+  // grab the inIndex we received this packet on and the hopLimit
+  // those are available since we requested them via socket options
+  struct cmsghdr* cmsg{nullptr};
+  for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+    if (cmsg->cmsg_level == IPPROTO_IPV6) {
+      if (cmsg->cmsg_type == IPV6_PKTINFO) {
+        struct in6_pktinfo pktinfo;
+        memcpy(
+            reinterpret_cast<void*>(&pktinfo),
+            CMSG_DATA(cmsg),
+            sizeof(pktinfo));
+        ifIndex = pktinfo.ipi6_ifindex;
+      } else if (cmsg->cmsg_type == IPV6_HOPLIMIT) {
+        memcpy(
+            reinterpret_cast<void*>(&hopLimit),
+            CMSG_DATA(cmsg),
+            sizeof(hopLimit));
+      }
+    }
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+      struct timespec ts {
+        0, 0
+      };
+      memcpy(reinterpret_cast<void*>(&ts), CMSG_DATA(cmsg), sizeof(ts));
+
+      // cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
+      const int64_t usecs =
+          static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+      const std::chrono::microseconds kernelRecvTs(usecs);
+
+      // sanity check
+      DCHECK(recvTs >= kernelRecvTs) << "Time anomaly";
+      VLOG(4) << "Got kernel-timestamp. It took "
+              << (recvTs - kernelRecvTs).count()
+              << " us for the packet to get from kernel to user space";
+      recvTs = kernelRecvTs;
+    }
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPING) {
+      // software, deprecated and raw hardware timestamps. Hardware one is set
+      // only if NIC supports it, and is on NIC clock which is expected to be
+      // synchronized with system clock, so no sanity check against it
+      struct timespec ts[3];
+      memcpy(reinterpret_cast<void*>(&ts), CMSG_DATA(cmsg), sizeof(ts));
+      const auto& hwTs = ts[2];
+      const bool isHardware = hwTs.tv_sec != 0 || hwTs.tv_nsec != 0;
+      const auto& recvTime = isHardware ? hwTs : ts[0];
+
+      const int64_t usecs = static_cast<int64_t>(recvTime.tv_sec) * 1000000 +
+          recvTime.tv_nsec / 1000;
+      if (usecs) {
+        DCHECK(isHardware || recvTs >= std::chrono::microseconds(usecs))
+            << "Time anomaly";
+        recvTs = std::chrono::microseconds(usecs);
+      }
+    }
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+      uint32_t dropped{0};
+      memcpy(
+          reinterpret_cast<void*>(&dropped), CMSG_DATA(cmsg), sizeof(dropped));
+      numDropped = dropped;
+    }
+  } // for
+}
+
+} // namespace
+
 int
 IoProvider::socket(int domain, int type, int protocol) {
   return ::socket(domain, type, protocol);
@@ -70,6 +147,22 @@ IoProvider::sendmsg(int sockfd, const struct msghdr* msg, int flags) {
   return ::sendmsg(sockfd, msg, flags);
 }
 
+int
+IoProvider::recvmmsg(
+    int sockfd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* timeout) {
+  return ::recvmmsg(sockfd, msgvec, vlen, flags, timeout);
+}
+
+int
+IoProvider::sendmmsg(
+    int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  return ::sendmmsg(sockfd, msgvec, vlen, flags);
+}
+
 std::tuple<
     ssize_t /* size */,
     int /* ifIndex */,
@@ -130,52 +223,16 @@ IoProvider::recvMessage(
     throw std::runtime_error("Message truncated");
   }
 
-  // grab the inIndex we received this packet on and the hopLimit
-  // those are available since we requested them via socket options
-  struct cmsghdr* cmsg{nullptr};
   int ifIndex{-1};
   int hopLimit{0};
+  folly::Optional<uint32_t> numDropped;
 
   // use user space timestamp if kernel timestamp is not found
   std::chrono::microseconds recvTs{
       std::chrono::duration_cast<std::chrono::microseconds>(
           std::chrono::system_clock::now().time_since_epoch())};
 
-  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-    if (cmsg->cmsg_level == IPPROTO_IPV6) {
-      if (cmsg->cmsg_type == IPV6_PKTINFO) {
-        struct in6_pktinfo pktinfo;
-        memcpy(
-            reinterpret_cast<void*>(&pktinfo),
-            CMSG_DATA(cmsg),
-            sizeof(pktinfo));
-        ifIndex = pktinfo.ipi6_ifindex;
-      } else if (cmsg->cmsg_type == IPV6_HOPLIMIT) {
-        memcpy(
-            reinterpret_cast<void*>(&hopLimit),
-            CMSG_DATA(cmsg),
-            sizeof(hopLimit));
-      }
-    }
-    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
-      struct timespec ts {
-        0, 0
-      };
-      memcpy(reinterpret_cast<void*>(&ts), CMSG_DATA(cmsg), sizeof(ts));
-
-      // cast to int64_t since ts.tv_sec is 32 bits on some platforms like arm
-      const int64_t usecs =
-          static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
-      const std::chrono::microseconds kernelRecvTs(usecs);
-
-      // sanity check
-      DCHECK(recvTs >= kernelRecvTs) << "Time anomaly";
-      VLOG(4) << "Got kernel-timestamp. It took "
-              << (recvTs - kernelRecvTs).count()
-              << " us for the packet to get from kernel to user space";
-      recvTs = kernelRecvTs;
-    }
-  } // for
+  parseControlData(&msg, ifIndex, hopLimit, recvTs, numDropped);
 
   // build the source socket address from recvmsg data
   folly::SocketAddress srcAddr{};
@@ -239,4 +296,158 @@ IoProvider::sendMessage(
   return ioProvider->sendmsg(fd, &msg, MSG_DONTWAIT);
 }
 
+std::vector<IoProvider::ReceivedMessage>
+IoProvider::recvMessages(
+    int fd,
+    int len,
+    unsigned int maxMessages,
+    IoProvider* ioProvider,
+    folly::Optional<uint32_t>* numDropped) {
+  // control message buffer of each message, aligned by control message hdr
+  union CtrlBuf {
+    char cbuf[CMSG_SPACE(1024)];
+    struct cmsghdr align;
+  };
+
+  std::vector<CtrlBuf> ctrlBufs(maxMessages);
+  std::vector<unsigned char> bufs(static_cast<size_t>(len) * maxMessages);
+  std::vector<struct iovec> entries(maxMessages);
+  std::vector<sockaddr_storage> addrStorages(maxMessages);
+  std::vector<struct mmsghdr> msgs(maxMessages);
+
+  // zero the buffers for CMSG_NXTHDR, see recvMessage()
+  ::memset(ctrlBufs.data(), 0, maxMessages * sizeof(CtrlBuf));
+  ::memset(addrStorages.data(), 0, maxMessages * sizeof(sockaddr_storage));
+  ::memset(msgs.data(), 0, maxMessages * sizeof(struct mmsghdr));
+
+  for (unsigned int i = 0; i < maxMessages; ++i) {
+    auto& msg = msgs[i].msg_hdr;
+    entries[i].iov_base = &bufs[static_cast<size_t>(len) * i];
+    entries[i].iov_len = len;
+    msg.msg_iov = &entries[i];
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrlBufs[i].cbuf;
+    msg.msg_controllen = sizeof(ctrlBufs[i].cbuf);
+    msg.msg_name = &addrStorages[i];
+    msg.msg_namelen = sizeof(sockaddr_storage);
+  }
+
+  const int numRead =
+      ioProvider->recvmmsg(fd, msgs.data(), maxMessages, MSG_DONTWAIT, nullptr);
+
+  if (numRead < 0) {
+    throw std::runtime_error(folly::sformat(
+        "Failed reading messages on fd {}: {}", fd, folly::errnoStr(errno)));
+  }
+
+  // use user space timestamp if kernel timestamp is not found
+  const std::chrono::microseconds now{
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch())};
+
+  folly::Optional<uint32_t> dropped;
+  std::vector<ReceivedMessage> messages;
+  messages.reserve(numRead);
+  for (int i = 0; i < numRead; ++i) {
+    auto& msg = msgs[i].msg_hdr;
+    if (msg.msg_flags & MSG_TRUNC) {
+      LOG(ERROR) << "Message truncated on fd " << fd;
+      continue;
+    }
+
+    ReceivedMessage message;
+    message.recvTime = now;
+    parseControlData(
+        &msg, message.ifIndex, message.hopLimit, message.recvTime, dropped);
+    // this will throw if sender address was not filled in
+    message.srcAddr.setFromSockaddr(
+        reinterpret_cast<struct sockaddr*>(&addrStorages[i]));
+    message.packet.assign(
+        reinterpret_cast<const char*>(entries[i].iov_base), msgs[i].msg_len);
+
+    DCHECK(message.ifIndex != -1) << "ifIndex is not found";
+    DCHECK(message.hopLimit) << "hopLimit is not found";
+    messages.emplace_back(std::move(message));
+  }
+  if (numDropped && dropped.hasValue()) {
+    *numDropped = dropped;
+  }
+  return messages;
+}
+
+std::vector<ssize_t>
+IoProvider::sendMessages(
+    int fd,
+    folly::SocketAddress dstAddr,
+    std::vector<OutgoingMessage> const& messages,
+    IoProvider* ioProvider,
+    std::vector<int>* errors) {
+  // pack control buffer, aligned by control message hdr
+  union CtrlBuf {
+    char cbuf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    struct cmsghdr align;
+  };
+
+  // same destination address for all messages
+  sockaddr_storage addrStorage;
+  dstAddr.getAddress(&addrStorage);
+
+  const size_t numMessages = messages.size();
+  std::vector<CtrlBuf> ctrlBufs(numMessages);
+  std::vector<struct iovec> entries(numMessages);
+  std::vector<struct mmsghdr> msgs(numMessages);
+  ::memset(ctrlBufs.data(), 0, numMessages * sizeof(CtrlBuf));
+  ::memset(msgs.data(), 0, numMessages * sizeof(struct mmsghdr));
+
+  for (size_t i = 0; i < numMessages; ++i) {
+    auto const& message = messages[i];
+    auto& msg = msgs[i].msg_hdr;
+    msg.msg_name = reinterpret_cast<void*>(&addrStorage);
+    msg.msg_namelen = dstAddr.getActualSize();
+
+    // set the source address and source if index for this message
+    msg.msg_control = ctrlBufs[i].cbuf;
+    msg.msg_controllen = sizeof(ctrlBufs[i].cbuf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = IPPROTO_IPV6;
+    cmsg->cmsg_type = IPV6_PKTINFO;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+
+    auto pktinfo = (struct in6_pktinfo*)CMSG_DATA(cmsg);
+    pktinfo->ipi6_ifindex = message.ifIndex;
+    ::memcpy(
+        &pktinfo->ipi6_addr,
+        message.srcAddr.bytes(),
+        message.srcAddr.byteCount());
+
+    entries[i].iov_base = const_cast<char*>(message.packet->data());
+    entries[i].iov_len = message.packet->size();
+    msg.msg_iov = &entries[i];
+    msg.msg_iovlen = 1;
+  }
+
+  // sendmmsg stops at the first message it fails to send, and reports the
+  // error only if that is the first one. Skip failed message and go on
+  std::vector<ssize_t> bytesSent(numMessages, -1);
+  if (errors) {
+    errors->assign(numMessages, 0);
+  }
+  size_t offset = 0;
+  while (offset < numMessages) {
+    const int numSent = ioProvider->sendmmsg(
+        fd, &msgs[offset], numMessages - offset, MSG_DONTWAIT);
+    if (numSent <= 0) {
+      if (errors) {
+        (*errors)[offset] = errno;
+      }
+      ++offset;
+      continue;
+    }
+    for (int i = 0; i < numSent; ++i, ++offset) {
+      bytesSent[offset] = msgs[offset].msg_len;
+    }
+  }
+  return bytesSent;
+}
+
 } // namespace openr
@@ -13,8 +13,10 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <chrono>
+#include <vector>
 
 #include <folly/IPAddress.h>
+#include <folly/Optional.h>
 #include <folly/SocketAddress.h>
 
 namespace openr {
@@ -59,6 +61,16 @@ class IoProvider {
 
   virtual ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags);
 
+  virtual int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags,
+      struct timespec* timeout);
+
+  virtual int sendmmsg(
+      int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags);
+
   virtual int setsockopt(
       int sockfd, int level, int optname, const void* optval, socklen_t optlen);
 
@@ -76,6 +88,29 @@ class IoProvider {
       std::chrono::microseconds /* kernel timestamp */>
   recvMessage(int fd, unsigned char* buf, int len, IoProvider* ioProvider);
 
+  // Message received with recvMessages()
+  struct ReceivedMessage {
+    std::string packet;
+    int ifIndex{-1};
+    folly::SocketAddress srcAddr;
+    int hopLimit{0};
+    // kernel timestamp, or user space one if not available
+    std::chrono::microseconds recvTime{0};
+  };
+
+  /*
+   * Receive up to maxMessages messages of up to len bytes on fd with a single
+   * recvmmsg call. Truncated messages are skipped. Throws if nothing could be
+   * read. numDropped, if given, is set to the socket drop counter carried by
+   * the last message, if the socket reports it (SO_RXQ_OVFL)
+   */
+  static std::vector<ReceivedMessage> recvMessages(
+      int fd,
+      int len,
+      unsigned int maxMessages,
+      IoProvider* ioProvider,
+      folly::Optional<uint32_t>* numDropped = nullptr);
+
   /*
    * Send message on fd via given interface to the address provided
    * We supply socket address, which has dst IPv6 and port
@@ -88,6 +123,25 @@ class IoProvider {
       std::string const& packet,
       IoProvider* ioProvider);
 
+  // Message to send with sendMessages(), packet is not copied
+  struct OutgoingMessage {
+    int ifIndex{0};
+    folly::IPAddressV6 srcAddr;
+    std::string const* packet{nullptr};
+  };
+
+  /*
+   * Same as sendMessage() for each message, all to the same address, in as
+   * few sendmmsg calls as possible. Returns number of bytes sent for each
+   * message, or -1 if it was not sent, with its errno in errors if given
+   */
+  static std::vector<ssize_t> sendMessages(
+      int fd,
+      folly::SocketAddress dstAddr,
+      std::vector<OutgoingMessage> const& messages,
+      IoProvider* ioProvider,
+      std::vector<int>* errors = nullptr);
+
  private:
   IoProvider(IoProvider const&) = delete;
   IoProvider& operator=(IoProvider const&) = delete;
@@ -8,6 +8,7 @@
 #include "Spark.h"
 
 #include <ifaddrs.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <sodium.h>
@@ -26,6 +27,7 @@
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/gen/Base.h>
+#include <folly/hash/Hash.h>
 
 #include <openr/common/Constants.h>
 #include <openr/common/NetworkUtil.h>
@@ -44,12 +46,6 @@ const int kMinIpv6Mtu = 1280;
 //
 const int kSparkHopLimit = 255;
 
-// number of samples in fast sliding window
-const size_t kFastWndSize = 10;
-
-// number of samples in slow sliding window
-const size_t kSlowWndSize = 60;
-
 // lower threshold, in percentage
 const uint8_t kLoThreshold = 2;
 
@@ -62,6 +58,15 @@ const int64_t kAbsThreshold = 500;
 // number of restarting packets to send out per interface before I'm going down
 const int kNumRestartingPktSent = 3;
 
+// hello packets read per recvmmsg call, and at most per socket wakeup so that
+// a backlog of hellos does not starve other events. Rest is read on next one
+const unsigned int kHelloRecvBatchSize = 16;
+const unsigned int kMaxHelloPacketsPerWakeup = 64;
+
+// hellos of interfaces due within a slot are sent together. Slot is this
+// fraction of fast init keep alive time, well within hello time variance
+const int kNumHelloSlotsPerKeepAlive = 10;
+
 //
 // Function to get current timestamp in microseconds using steady clock
 // NOTE: we use non-monotonic clock since kernel time-stamps do not support
@@ -73,6 +78,43 @@ getCurrentTimeInUs() {
       std::chrono::system_clock::now().time_since_epoch());
 }
 
+//
+// Key of neighbor in compactNeighborInfos of hello packets
+//
+int64_t
+getNeighborId(const std::string& nodeName) {
+  return static_cast<int64_t>(folly::hash::fnv64(nodeName));
+}
+
+//
+// What neighbor has reflected about us in its hello packet, with either
+// encoding of neighbor infos
+//
+folly::Optional<openr::thrift::ReflectedNeighborInfo>
+findReflectedInfo(
+    const openr::thrift::SparkPayload& payload, const std::string& nodeName) {
+  if (payload.compactNeighborInfos.hasValue()) {
+    auto it = payload.compactNeighborInfos->find(getNeighborId(nodeName));
+    if (it == payload.compactNeighborInfos->end()) {
+      return folly::none;
+    }
+    openr::thrift::ReflectedNeighborInfo info;
+    info.seqNum = it->second.seqNum;
+    info.lastNbrMsgSentTsInUs = it->second.lastNbrMsgSentTsInUs;
+    if (it->second.lastMyMsgRcvdAgeInUs.hasValue()) {
+      info.lastMyMsgRcvdTsInUs =
+          payload.timestamp - *it->second.lastMyMsgRcvdAgeInUs;
+    }
+    return info;
+  }
+
+  auto it = payload.neighborInfos.find(nodeName);
+  if (it == payload.neighborInfos.end()) {
+    return folly::none;
+  }
+  return it->second;
+}
+
 //
 // Subscribe/unsubscribe to a multicast group on given interface
 //
@@ -134,23 +176,17 @@ Spark::Neighbor::Neighbor(
     thrift::SparkNeighbor const& info,
     uint32_t label,
     uint64_t seqNum,
-    std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
     const std::chrono::milliseconds& samplingPeriod,
     std::function<void(const int64_t&)> rttChangeCb)
     : info(info),
-      holdTimer(std::move(holdTimer)),
       label(label),
       seqNum(seqNum),
       stepDetector(
           samplingPeriod /* sampling period */,
-          kFastWndSize /* fast window size */,
-          kSlowWndSize /* slow window size */,
           kLoThreshold /* lower threshold */,
           kHiThreshold /* upper threshold */,
           kAbsThreshold /* absolute threshold */,
-          rttChangeCb /* callback function */) {
-  CHECK_NE(this->holdTimer.get(), static_cast<void*>(nullptr));
-}
+          rttChangeCb /* callback function */) {}
 
 Spark::Spark(
     std::string const& myDomainName,
@@ -168,7 +204,8 @@ Spark::Spark(
     KvStoreCmdPort kvStoreCmdPort,
     std::pair<uint32_t, uint32_t> version,
     fbzmq::Context& zmqContext,
-    bool enableFloodOptimization)
+    bool enableFloodOptimization,
+    bool enableHardwareTimestamps)
     : OpenrEventLoop(myNodeName, thrift::OpenrModuleType::SPARK, zmqContext),
       myDomainName_(myDomainName),
       myNodeName_(myNodeName),
@@ -187,6 +224,10 @@ Spark::Spark(
       kKvStoreCmdPort_(kvStoreCmdPort),
       kVersion_(apache::thrift::FRAGILE, version.first, version.second),
       enableFloodOptimization_(enableFloodOptimization),
+      enableHardwareTimestamps_(enableHardwareTimestamps),
+      helloSlot_(std::max(
+          std::chrono::milliseconds(1),
+          fastInitKeepAliveTime / kNumHelloSlotsPerKeepAlive)),
       ioProvider_(std::make_shared<IoProvider>()) {
   CHECK(myHoldTime_ >= 3 * myKeepAliveTime)
       << "Keep-alive-time must be less than hold-time.";
@@ -206,6 +247,24 @@ Spark::Spark(
             numBuckets, sec));
   }
 
+  // Single timer for hellos of all interfaces
+  helloTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.hello", [this]() noexcept {
+        processHelloTimeout();
+      }));
+
+  // Single timer for hold timeouts of all neighbors
+  holdTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.hold", [this]() noexcept {
+        processHoldTimeouts();
+      }));
+
+  // Neighbor events are reported together at the end of each loop iteration
+  reportTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.report", [this]() noexcept {
+        sendNeighborEvents();
+      }));
+
   // Initialize ZMQ sockets
   scheduleTimeout(
       std::chrono::seconds(0), [this, maybeIpTos]() { prepare(maybeIpTos); });
@@ -219,12 +278,12 @@ Spark::stop() {
   // send out restarting packets for all interfaces before I'm going down
   // here we are sending duplicate restarting packets (3 times per interface)
   // in case some packets get lost
+  std::vector<std::pair<std::string, bool>> ifNames;
+  for (const auto& kv : interfaceDb_) {
+    ifNames.emplace_back(kv.first, false /* inFastInitState */);
+  }
   for (int i = 0; i < kNumRestartingPktSent; ++i) {
-    for (const auto& kv : interfaceDb_) {
-      const auto& ifName = kv.first;
-      sendHelloPacket(
-          ifName, false /* inFastInitState */, true /* restarting */);
-    }
+    sendHelloPackets(ifNames, true /* restarting */);
   }
 
   LOG(INFO)
@@ -351,36 +410,78 @@ Spark::prepare(folly::Optional<int> maybeIpTos) noexcept {
                << folly::errnoStr(errno);
   }
 
-  // enable timestamping for this socket
+  // enable timestamping for this socket. Hardware timestamps are preferred if
+  // enabled and NIC supports them, software ones are reported otherwise
   const int enabled = 1;
-  if (ioProvider_->setsockopt(
+  const int timestampingFlags = SOF_TIMESTAMPING_RX_HARDWARE |
+      SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+      SOF_TIMESTAMPING_SOFTWARE;
+  if (enableHardwareTimestamps_ and
+      ioProvider_->setsockopt(
+          fd,
+          SOL_SOCKET,
+          SO_TIMESTAMPING,
+          &timestampingFlags,
+          sizeof(timestampingFlags)) == 0) {
+    LOG(INFO) << "Enabled hardware timestamping on Spark socket";
+  } else if (
+      ioProvider_->setsockopt(
           fd, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) != 0) {
     LOG(ERROR) << "Failed to enable kernel timestamping. Measured RTTs are "
                << "likely to have more noise in them. Error: "
                << folly::errnoStr(errno);
   }
 
+  // report socket buffer overflow drops along with received packets
+  if (ioProvider_->setsockopt(
+          fd, SOL_SOCKET, SO_RXQ_OVFL, &enabled, sizeof(enabled)) != 0) {
+    LOG(ERROR) << "Failed to enable socket drop counter. Error: "
+               << folly::errnoStr(errno);
+  }
+
   LOG(INFO) << "Spark thread attaching socket/events callbacks...";
 
   // Schedule periodic timer for monitor submission
   const bool isPeriodic = true;
-  monitorTimer_ =
-      fbzmq::ZmqTimeout::make(this, [this]() noexcept { submitCounters(); });
+  monitorTimer_ = fbzmq::ZmqTimeout::make(
+      this, profiled("timer.monitor", [this]() noexcept { submitCounters(); }));
   monitorTimer_->scheduleTimeout(Constants::kMonitorSubmitInterval, isPeriodic);
 
   // Listen for incoming messages on multicast FD
-  addSocketFd(mcastFd_, ZMQ_POLLIN, [this](int) noexcept {
-    try {
-      processHelloPacket();
-    } catch (std::exception const& err) {
-      LOG(ERROR) << "Spark: error processing hello packet "
-                 << folly::exceptionStr(err);
-    }
-  });
+  addSocketFd(
+      mcastFd_, ZMQ_POLLIN, profiled("socket.hello", [this](int) noexcept {
+        try {
+          processHelloPackets();
+        } catch (std::exception const& err) {
+          LOG(ERROR) << "Spark: error processing hello packet "
+                     << folly::exceptionStr(err);
+        }
+      }));
 }
 
-PacketValidationResult
-Spark::validateHelloPacket(
+size_t
+Spark::getHelloSignature(
+    std::string const& ifName, thrift::SparkHelloPacket const& helloPacket) {
+  // everything validated by isValidHelloOriginator(), on both ends. Seq num,
+  // timestamps and neighbor infos change with every hello and are left out
+  auto const& originator = helloPacket.payload.originator;
+  auto const& myV4Network = interfaceDb_.at(ifName).v4Network;
+  return folly::hash::hash_combine(
+      originator.domainName,
+      originator.nodeName,
+      originator.holdTime,
+      originator.transportAddressV6.addr,
+      originator.transportAddressV4.addr,
+      originator.kvStorePubPort,
+      originator.kvStoreCmdPort,
+      originator.ifName,
+      helloPacket.payload.version,
+      myV4Network.first.hash(),
+      myV4Network.second);
+}
+
+bool
+Spark::isValidHelloOriginator(
     std::string const& ifName, thrift::SparkHelloPacket const& helloPacket) {
   auto const& originator = helloPacket.payload.originator;
   auto const& neighborName = originator.nodeName;
@@ -395,7 +496,7 @@ Spark::validateHelloPacket(
                << originator.domainName << ". My domain is " << myDomainName_;
     tData_.addStatValue(
         "spark.invalid_keepalive.different_domain", 1, fbzmq::SUM);
-    return PacketValidationResult::FAILURE;
+    return false;
   }
   // version check
   if (remoteVersion < static_cast<uint32_t>(kVersion_.lowestSupportedVersion)) {
@@ -404,7 +505,7 @@ Spark::validateHelloPacket(
                << ", must be >= " << kVersion_.lowestSupportedVersion;
     tData_.addStatValue(
         "spark.invalid_keepalive.invalid_version", 1, fbzmq::SUM);
-    return PacketValidationResult::FAILURE;
+    return false;
   }
 
   // validate v4 address subnet
@@ -420,7 +521,7 @@ Spark::validateHelloPacket(
       LOG(ERROR) << "Neighbor V4 address is not known";
       tData_.addStatValue(
           "spark.invalid_keepalive.missing_v4_addr", 1, fbzmq::SUM);
-      return PacketValidationResult::FAILURE;
+      return false;
     }
 
     // validate subnet of v4 address
@@ -433,9 +534,17 @@ Spark::validateHelloPacket(
                  << myV4Addr.str() << "/" << +myV4PrefixLen;
       tData_.addStatValue(
           "spark.invalid_keepalive.different_subnet", 1, fbzmq::SUM);
-      return PacketValidationResult::FAILURE;
+      return false;
     }
   }
+  return true;
+}
+
+PacketValidationResult
+Spark::validateHelloPacket(
+    std::string const& ifName, thrift::SparkHelloPacket const& helloPacket) {
+  auto const& originator = helloPacket.payload.originator;
+  auto const& neighborName = originator.nodeName;
 
   // get the map of tracked neighbors on this interface
   auto& ifNeighbors = neighbors_.at(ifName);
@@ -443,13 +552,17 @@ Spark::validateHelloPacket(
   // see if we already track this neighbor
   auto it = ifNeighbors.find(neighborName);
 
+  // skip validation of originator if it is the same as in last valid hello
+  // from this neighbor, which is the case for almost every hello
+  const auto signature = getHelloSignature(ifName, helloPacket);
+  if (it != ifNeighbors.end() and it->second.helloSignature == signature) {
+    tData_.addStatValue("spark.hello_validation_skipped", 1, fbzmq::SUM);
+  } else if (not isValidHelloOriginator(ifName, helloPacket)) {
+    return PacketValidationResult::FAILURE;
+  }
+
   // first time we hear from this guy, add to tracking list
   if (it == ifNeighbors.end()) {
-    auto holdTimer =
-        fbzmq::ZmqTimeout::make(this, [this, ifName, neighborName]() noexcept {
-          processNeighborHoldTimeout(ifName, neighborName);
-        });
-
     // Report RTT change
     // capture ifName & originator by copy
     auto rttChangeCb = [this, ifName, originator](const int64_t& newRtt) {
@@ -463,15 +576,16 @@ Spark::validateHelloPacket(
             originator,
             getNewLabelForIface(ifName),
             helloPacket.payload.seqNum,
-            std::move(holdTimer),
             myKeepAliveTime_,
             std::move(rttChangeCb)));
+    ifNeighbors.at(neighborName).helloSignature = signature;
     return PacketValidationResult::SUCCESS;
   }
 
   // grab existing neighbor; second.first on iterator is the SparkNeighbor
   auto& neighbor = it->second;
   auto newSeqNum = static_cast<uint64_t>(helloPacket.payload.seqNum);
+  neighbor.helloSignature = signature;
 
   // Sender's sequence number received in helloPacket is always increasing. If
   // we receive a packet with lower sequence number from adjacent neighbor, then
@@ -531,14 +645,36 @@ Spark::processNeighborRttChange(
       neighbor.rtt.count(),
       neighbor.label,
       false /* supportFloodOptimization: doesn't matter in RTT event*/);
+  reportNeighborEvent(std::move(event));
+}
+
+void
+Spark::reportNeighborEvent(thrift::SparkNeighborEvent event) {
+  pendingNeighborEvents_.events.emplace_back(std::move(event));
+  if (not reportTimer_->isScheduled()) {
+    reportTimer_->scheduleTimeout(std::chrono::milliseconds(0));
+  }
+}
+
+void
+Spark::sendNeighborEvents() noexcept {
+  if (pendingNeighborEvents_.events.empty()) {
+    return;
+  }
+  tData_.addStatValue(
+      "spark.neighbor_events_per_report",
+      pendingNeighborEvents_.events.size(),
+      fbzmq::AVG);
   auto ret = reportSocket_.sendMultiple(
       fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
           .value(),
       fbzmq::Message(),
-      fbzmq::Message::fromThriftObj(event, serializer_).value());
+      fbzmq::Message::fromThriftObj(pendingNeighborEvents_, serializer_)
+          .value());
   if (ret.hasError()) {
-    LOG(ERROR) << "Error sending spark event: " << ret.error();
+    LOG(ERROR) << "Error sending spark events: " << ret.error();
   }
+  pendingNeighborEvents_.events.clear();
 }
 
 void
@@ -573,19 +709,95 @@ Spark::processNeighborHoldTimeout(
         neighbor.rtt.count(),
         neighbor.label,
         false /* supportFloodOptimization: doesn't matter in GR-expired event*/);
-    auto ret = reportSocket_.sendMultiple(
-        fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
-            .value(),
-        fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(event, serializer_).value());
-    if (ret.hasError()) {
-      LOG(ERROR) << "Error sending spark event: " << ret.error();
-    }
+    reportNeighborEvent(std::move(event));
   } else {
     VLOG(2) << "Neighbor went down, but was not adjacent, not reporting";
   }
 }
 
+void
+Spark::scheduleNeighborHoldTimeout(
+    std::string const& ifName,
+    std::string const& neighborName,
+    std::chrono::milliseconds holdTime) {
+  auto& neighbor = neighbors_.at(ifName).at(neighborName);
+  const auto timeout = std::chrono::steady_clock::now() + holdTime;
+  neighbor.holdTimeout = timeout;
+
+  // refreshed timeout is requeued when queued one is due. Only queue it now
+  // if it is earlier, e.g. neighbor has lowered its hold time
+  if (neighbor.queuedHoldTimeout.hasValue() and
+      *neighbor.queuedHoldTimeout <= timeout) {
+    return;
+  }
+  neighbor.queuedHoldTimeout = timeout;
+  const bool isEarliest =
+      holdTimeouts_.empty() or timeout < holdTimeouts_.top().timeout;
+  holdTimeouts_.push(HoldTimeout{timeout, ifName, neighborName});
+  if (isEarliest) {
+    if (holdTimer_->isScheduled()) {
+      holdTimer_->cancelTimeout();
+    }
+    holdTimer_->scheduleTimeout(holdTime);
+  }
+}
+
+void
+Spark::cancelNeighborHoldTimeout(
+    std::string const& ifName, std::string const& neighborName) {
+  // queued entry becomes stale, and is dropped when due
+  neighbors_.at(ifName).at(neighborName).holdTimeout = folly::none;
+}
+
+void
+Spark::processHoldTimeouts() noexcept {
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<std::pair<std::string, std::string>> expiredNeighbors;
+  while (not holdTimeouts_.empty() and holdTimeouts_.top().timeout <= now) {
+    auto entry = holdTimeouts_.top();
+    holdTimeouts_.pop();
+
+    // skip stale entries of removed neighbors or of superseded timeouts
+    auto ifIt = neighbors_.find(entry.ifName);
+    if (ifIt == neighbors_.end()) {
+      continue;
+    }
+    auto it = ifIt->second.find(entry.neighborName);
+    if (it == ifIt->second.end()) {
+      continue;
+    }
+    auto& neighbor = it->second;
+    if (neighbor.queuedHoldTimeout != entry.timeout) {
+      continue;
+    }
+    neighbor.queuedHoldTimeout = folly::none;
+
+    if (not neighbor.holdTimeout.hasValue()) {
+      continue;
+    }
+    if (*neighbor.holdTimeout <= now) {
+      expiredNeighbors.emplace_back(entry.ifName, entry.neighborName);
+      continue;
+    }
+    // refreshed since queued
+    entry.timeout = *neighbor.holdTimeout;
+    neighbor.queuedHoldTimeout = entry.timeout;
+    holdTimeouts_.push(std::move(entry));
+  }
+
+  for (auto const& kv : expiredNeighbors) {
+    processNeighborHoldTimeout(kv.first, kv.second);
+  }
+
+  // round up, so that the next one is due when timer fires
+  if (not holdTimeouts_.empty()) {
+    holdTimer_->scheduleTimeout(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            holdTimeouts_.top().timeout - now) +
+        std::chrono::milliseconds(1));
+  }
+}
+
 bool
 Spark::shouldProcessHelloPacket(
     std::string const& ifName, folly::IPAddress const& addr) {
@@ -605,18 +817,70 @@ Spark::shouldProcessHelloPacket(
 }
 
 void
-Spark::processHelloPacket() {
-  // the read buffer
-  uint8_t buf[kMinIpv6Mtu];
+Spark::processHelloPackets() {
+  // drain backlog of hellos, up to budget of this wakeup
+  size_t numPackets{0};
+  while (numPackets < kMaxHelloPacketsPerWakeup) {
+    folly::Optional<uint32_t> numDropped;
+    std::vector<IoProvider::ReceivedMessage> messages;
+    try {
+      messages = IoProvider::recvMessages(
+          mcastFd_,
+          kMinIpv6Mtu,
+          std::min(
+              kHelloRecvBatchSize,
+              static_cast<unsigned int>(
+                  kMaxHelloPacketsPerWakeup - numPackets)),
+          ioProvider_.get(),
+          &numDropped);
+    } catch (std::exception const&) {
+      // nothing (more) to read
+      if (numPackets == 0) {
+        throw;
+      }
+      break;
+    }
 
-  ssize_t bytesRead;
-  int ifIndex;
-  folly::SocketAddress clientAddr;
-  int hopLimit;
-  std::chrono::microseconds myRecvTime;
+    // socket drop counter is cumulative, report what is new
+    if (numDropped.hasValue()) {
+      if (lastSocketDropCount_.hasValue() and
+          *numDropped > *lastSocketDropCount_) {
+        tData_.addStatValue(
+            "spark.hello_packet_socket_dropped",
+            *numDropped - *lastSocketDropCount_,
+            fbzmq::SUM);
+      }
+      lastSocketDropCount_ = numDropped;
+    }
 
-  std::tie(bytesRead, ifIndex, clientAddr, hopLimit, myRecvTime) =
-      IoProvider::recvMessage(mcastFd_, buf, kMinIpv6Mtu, ioProvider_.get());
+    for (auto const& message : messages) {
+      const auto startTime = std::chrono::steady_clock::now();
+      try {
+        processHelloPacket(message);
+      } catch (std::exception const& err) {
+        LOG(ERROR) << "Spark: error processing hello packet "
+                   << folly::exceptionStr(err);
+      }
+      helloProcessingHistogram_.addValue(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - startTime));
+    }
+    // recvmmsg returns fewer messages only if socket has no more
+    numPackets += messages.size();
+    if (messages.size() < kHelloRecvBatchSize) {
+      break;
+    }
+  }
+  tData_.addStatValue("spark.hello_packets_per_wakeup", numPackets, fbzmq::AVG);
+}
+
+void
+Spark::processHelloPacket(IoProvider::ReceivedMessage const& message) {
+  const ssize_t bytesRead = message.packet.size();
+  const int ifIndex = message.ifIndex;
+  folly::SocketAddress const& clientAddr = message.srcAddr;
+  const int hopLimit = message.hopLimit;
+  const std::chrono::microseconds myRecvTime = message.recvTime;
 
   if (hopLimit < kSparkHopLimit) {
     LOG(ERROR) << "Rejecting packet from " << clientAddr.getAddressStr()
@@ -651,26 +915,19 @@ Spark::processHelloPacket() {
 
   tData_.addStatValue("spark.hello_packet_processed", 1, fbzmq::SUM);
 
-  if (bytesRead >= 0) {
-    VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
+  VLOG(4) << "Read a total of " << bytesRead << " bytes from fd " << mcastFd_;
 
-    if (static_cast<size_t>(bytesRead) > kMinIpv6Mtu) {
-      LOG(ERROR) << "Message from " << clientAddr.getAddressStr()
-                 << " has been truncated";
-      return;
-    }
-  } else {
-    LOG(ERROR) << "Failed reading from fd " << mcastFd_ << " error "
-               << folly::errnoStr(errno);
+  if (static_cast<size_t>(bytesRead) > kMinIpv6Mtu) {
+    LOG(ERROR) << "Message from " << clientAddr.getAddressStr()
+               << " has been truncated";
     return;
   }
 
-  // Copy buffer into string object and parse it into helloPacket.
-  std::string readBuf(reinterpret_cast<const char*>(&buf[0]), bytesRead);
+  // Parse buffer into helloPacket.
   thrift::SparkHelloPacket helloPacket;
   try {
-    helloPacket =
-        util::readThriftObjStr<thrift::SparkHelloPacket>(readBuf, serializer_);
+    helloPacket = util::readThriftObjStr<thrift::SparkHelloPacket>(
+        message.packet, serializer_);
   } catch (std::exception const& err) {
     LOG(ERROR) << "Failed parsing hello packet " << folly::exceptionStr(err);
     return;
@@ -699,6 +956,7 @@ Spark::processHelloPacket() {
   auto nbrSentTime = std::chrono::microseconds(helloPacket.payload.timestamp);
   neighbor.neighborTimestamp = nbrSentTime;
   neighbor.localTimestamp = myRecvTime;
+  neighbor.version = helloPacket.payload.version;
 
   // check if it's a restarting packet
   if (helloPacket.payload.restarting.hasValue() and
@@ -721,22 +979,16 @@ Spark::processHelloPacket() {
         neighbor.rtt.count(),
         neighbor.label,
         false /* supportDual: doesn't matter in DOWN event*/);
-    auto ret = reportSocket_.sendMultiple(
-        fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
-            .value(),
-        fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(event, serializer_).value());
-    if (ret.hasError()) {
-      LOG(ERROR) << "Error sending spark event: " << ret.error();
-    }
+    reportNeighborEvent(std::move(event));
 
     return;
   }
 
   // Try to deduce RTT for this neighbor and update timestamps for recvd hello
-  auto it = helloPacket.payload.neighborInfos.find(myNodeName_);
-  if (it != helloPacket.payload.neighborInfos.end()) {
-    auto& tstamps = it->second;
+  const auto reflectedInfo =
+      findReflectedInfo(helloPacket.payload, myNodeName_);
+  if (reflectedInfo.hasValue()) {
+    auto& tstamps = *reflectedInfo;
     auto mySentTime = std::chrono::microseconds(tstamps.lastNbrMsgSentTsInUs);
     auto nbrRecvTime = std::chrono::microseconds(tstamps.lastMyMsgRcvdTsInUs);
     auto myRecvTimeMs =
@@ -806,13 +1058,12 @@ Spark::processHelloPacket() {
   //
 
   bool foundSelf{false};
-  auto myIt = helloPacket.payload.neighborInfos.find(myNodeName_);
-  if (myIt != helloPacket.payload.neighborInfos.end()) {
+  if (reflectedInfo.hasValue()) {
     // the seq# neighbor has seen from us could not be higher than ours if it
     // is, this normally means we have restarted, and seeing our previous
     // incarnation and we act like we haven't heard from the neighbor (wait
     // for it to catch with our hello packets).
-    uint64_t seqNumSeen = static_cast<uint64_t>(myIt->second.seqNum);
+    uint64_t seqNumSeen = static_cast<uint64_t>(reflectedInfo->seqNum);
     foundSelf = (seqNumSeen < mySeqNum_);
 
     if (not foundSelf) {
@@ -852,14 +1103,7 @@ Spark::processHelloPacket() {
         neighbor.label,
         supportFloodOptimization);
     neighbor.numRecvRestarting = 0; // reset counter when neighbor comes up
-    auto ret = reportSocket_.sendMultiple(
-        fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
-            .value(),
-        fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(event, serializer_).value());
-    if (ret.hasError()) {
-      LOG(ERROR) << "Error sending spark event: " << ret.error();
-    }
+    reportNeighborEvent(std::move(event));
 
     return;
   }
@@ -874,7 +1118,9 @@ Spark::processHelloPacket() {
     // Reset the hold-timer for neighbor as we have received a keep-alive
     // message. Note that we are using hold-time sent by neighbor so neighbor
     // can reset it on the fly.
-    neighbor.holdTimer->scheduleTimeout(
+    scheduleNeighborHoldTimeout(
+        ifName,
+        originator.nodeName,
         std::chrono::milliseconds(originator.holdTime));
 
     return;
@@ -903,18 +1149,13 @@ Spark::processHelloPacket() {
         neighbor.label,
         supportFloodOptimization);
     neighbor.numRecvRestarting = 0; // reset counter when neighbor comes up
-    auto ret = reportSocket_.sendMultiple(
-        fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
-            .value(),
-        fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(event, serializer_).value());
-    if (ret.hasError()) {
-      LOG(ERROR) << "Error sending spark event: " << ret.error();
-    }
+    reportNeighborEvent(std::move(event));
     neighbor.isAdjacent = true;
 
     // Start hold-timer
-    neighbor.holdTimer->scheduleTimeout(
+    scheduleNeighborHoldTimeout(
+        ifName,
+        originator.nodeName,
         std::chrono::milliseconds(originator.holdTime));
 
     return;
@@ -936,40 +1177,33 @@ Spark::processHelloPacket() {
         neighbor.rtt.count(),
         neighbor.label,
         false /* supportFloodOptimization: doesn't matter in DOWN event*/);
-    auto ret = reportSocket_.sendMultiple(
-        fbzmq::Message::from(openr::Constants::kSparkReportClientId.toString())
-            .value(),
-        fbzmq::Message(),
-        fbzmq::Message::fromThriftObj(event, serializer_).value());
-    if (ret.hasError()) {
-      LOG(ERROR) << "Error sending spark event: " << ret.error();
-    }
+    reportNeighborEvent(std::move(event));
     neighbor.isAdjacent = false;
 
     // Stop hold-timer
-    neighbor.holdTimer->cancelTimeout();
+    cancelNeighborHoldTimeout(ifName, originator.nodeName);
 
     return;
   }
 }
 
-void
-Spark::sendHelloPacket(
+folly::Optional<std::string>
+Spark::createHelloPacket(
     std::string const& ifName, bool inFastInitState, bool restarting) {
-  VLOG(3) << "Send hello packet called for " << ifName;
+  VLOG(3) << "Create hello packet called for " << ifName;
 
   if (interfaceDb_.count(ifName) == 0) {
     LOG(ERROR) << "Interface " << ifName << " is no longer being tracked";
-    return;
+    return folly::none;
   }
 
   SCOPE_EXIT {
-    // increment seq# after packet has been sent (even if it didnt go out)
+    // increment seq# after packet has been created (even if it didnt go out)
     ++mySeqNum_;
   };
 
   SCOPE_FAIL {
-    LOG(ERROR) << "Failed sending Hello packet on " << ifName;
+    LOG(ERROR) << "Failed creating Hello packet on " << ifName;
   };
 
   // in some cases, getting link-local address may fail and throw
@@ -977,7 +1211,6 @@ Spark::sendHelloPacket(
   // down event has not arrived yet
 
   const auto& interfaceEntry = interfaceDb_.at(ifName);
-  const auto ifIndex = interfaceEntry.ifIndex;
   const auto v4Addr = interfaceEntry.v4Network.first;
   const auto v6Addr = interfaceEntry.v6LinkLocalNetwork.first;
   thrift::OpenrVersion openrVer(kVersion_.version);
@@ -1006,8 +1239,22 @@ Spark::sendHelloPacket(
       enableFloodOptimization_,
       restarting);
 
+  // neighbors are keyed by id rather than name if all of them understand it,
+  // which keeps hellos small on segments with many neighbors
+  const auto& ifNeighbors = neighbors_.at(ifName);
+  const bool compact =
+      kVersion_.version >= Constants::kOpenrCompactHelloVersion and
+      std::all_of(ifNeighbors.begin(), ifNeighbors.end(), [](const auto& kv) {
+        return kv.second.version >= Constants::kOpenrCompactHelloVersion;
+      });
+  if (compact) {
+    payload.compactNeighborInfos =
+        std::map<int64_t, thrift::CompactReflectedNeighborInfo>{};
+    tData_.addStatValue("spark.hello_packet_compact", 1, fbzmq::SUM);
+  }
+
   // add all neighbors we have heard from on this interface
-  for (const auto& kv : neighbors_.at(ifName)) {
+  for (const auto& kv : ifNeighbors) {
     std::string const& neighborName = kv.first;
     auto& neighbor = kv.second;
 
@@ -1017,6 +1264,17 @@ Spark::sendHelloPacket(
     // Add timestamp and sequence number from last hello. Will be 0 if we
     // haven't heard before from the neighbor.
     // Refer to thrift for definition of timestampts.
+    if (compact) {
+      auto& neighborInfo =
+          (*payload.compactNeighborInfos)[getNeighborId(neighborName)];
+      neighborInfo.seqNum = seqNum;
+      neighborInfo.lastNbrMsgSentTsInUs = neighbor.neighborTimestamp.count();
+      if (neighbor.localTimestamp.count()) {
+        neighborInfo.lastMyMsgRcvdAgeInUs =
+            payload.timestamp - neighbor.localTimestamp.count();
+      }
+      continue;
+    }
     auto& neighborInfo = payload.neighborInfos[neighborName];
     neighborInfo.seqNum = seqNum;
     neighborInfo.lastNbrMsgSentTsInUs = neighbor.neighborTimestamp.count();
@@ -1028,30 +1286,125 @@ Spark::sendHelloPacket(
       thrift::SparkHelloPacket{apache::thrift::FRAGILE, payload, ""},
       serializer_);
 
-  // send the payload
-  folly::SocketAddress dstAddr(
-      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
-
   if (kMinIpv6Mtu < packet.size()) {
     LOG(ERROR) << "Hello packet is too big, cannot sent!";
-    return;
+    return folly::none;
   }
+  return packet;
+}
 
-  auto bytesSent = IoProvider::sendMessage(
-      mcastFd_, ifIndex, v6Addr.asV6(), dstAddr, packet, ioProvider_.get());
+void
+Spark::sendHelloPacket(
+    std::string const& ifName, bool inFastInitState, bool restarting) {
+  sendHelloPackets({{ifName, inFastInitState}}, restarting);
+}
 
-  if ((bytesSent < 0) || (static_cast<size_t>(bytesSent) != packet.size())) {
-    VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
-            << ifName << " failed due to error " << folly::errnoStr(errno);
+void
+Spark::sendHelloPackets(
+    std::vector<std::pair<std::string, bool>> const& ifNames,
+    bool restarting) {
+  VLOG(3) << "Send hello packets called for " << ifNames.size()
+          << " interfaces";
+
+  std::vector<std::string> sentIfNames;
+  std::vector<std::string> packets;
+  for (auto const& kv : ifNames) {
+    auto packet = createHelloPacket(kv.first, kv.second, restarting);
+    if (packet.hasValue()) {
+      sentIfNames.emplace_back(kv.first);
+      packets.emplace_back(std::move(packet.value()));
+    }
+  }
+  if (packets.empty()) {
     return;
   }
 
-  // update counters for number of pkts and total size of pkts sent
+  std::vector<IoProvider::OutgoingMessage> messages;
+  messages.reserve(packets.size());
+  for (size_t i = 0; i < packets.size(); ++i) {
+    const auto& interfaceEntry = interfaceDb_.at(sentIfNames[i]);
+    messages.emplace_back(IoProvider::OutgoingMessage{
+        interfaceEntry.ifIndex,
+        interfaceEntry.v6LinkLocalNetwork.first.asV6(),
+        &packets[i]});
+  }
+
+  // send the payloads, in a single syscall if all go out
+  folly::SocketAddress dstAddr(
+      folly::IPAddress(Constants::kSparkMcastAddr.toString()), udpMcastPort_);
+  std::vector<int> errors;
+  const auto bytesSent = IoProvider::sendMessages(
+      mcastFd_, dstAddr, messages, ioProvider_.get(), &errors);
   tData_.addStatValue(
-      "spark.hello_packet_sent_size", packet.size(), fbzmq::SUM);
-  tData_.addStatValue("spark.hello_packet_sent", 1, fbzmq::SUM);
+      "spark.hello_packets_per_batch", packets.size(), fbzmq::AVG);
+
+  for (size_t i = 0; i < packets.size(); ++i) {
+    if ((bytesSent[i] < 0) ||
+        (static_cast<size_t>(bytesSent[i]) != packets[i].size())) {
+      VLOG(1) << "Sending multicast to " << dstAddr.getAddressStr() << " on "
+              << sentIfNames[i] << " failed due to error "
+              << folly::errnoStr(errors[i]);
+      continue;
+    }
+
+    // update counters for number of pkts and total size of pkts sent
+    tData_.addStatValue(
+        "spark.hello_packet_sent_size", packets[i].size(), fbzmq::SUM);
+    tData_.addStatValue("spark.hello_packet_sent", 1, fbzmq::SUM);
+    tData_.addStatValue(
+        "spark.hello_packet_bytes", packets[i].size(), fbzmq::AVG);
 
-  VLOG(4) << "Sent " << bytesSent << " bytes in hello packet";
+    VLOG(4) << "Sent " << bytesSent[i] << " bytes in hello packet on "
+            << sentIfNames[i];
+  }
+}
+
+void
+Spark::processHelloTimeout() noexcept {
+  const auto now = std::chrono::steady_clock::now();
+  std::vector<std::pair<std::string, bool>> ifNames;
+  for (auto& kv : ifNameToHelloSchedule_) {
+    auto& schedule = kv.second;
+    if (schedule.nextHelloTime > now + helloSlot_) {
+      continue;
+    }
+    VLOG(3) << "Sending hello multicast packet on interface " << kv.first;
+    // We will send atleast 3 and atmost 4 packets in fast mode. Only one
+    // packet is enough for discovering neighbors in fast mode, however we
+    // send multiple for redundancy to overcome packet drops and compute
+    bool inFastInitState =
+        (now - schedule.addedTime) <= 3 * fastInitKeepAliveTime_;
+    ifNames.emplace_back(kv.first, inFastInitState);
+
+    // Schedule next hello (add 20% variance)
+    // overriding timeoutPeriod if I am in fast initial state
+    schedule.nextHelloTime =
+        now + (inFastInitState ? schedule.rollFast() : schedule.roll());
+  }
+
+  sendHelloPackets(ifNames);
+  scheduleHelloTimeout();
+}
+
+void
+Spark::scheduleHelloTimeout() {
+  if (helloTimer_->isScheduled()) {
+    helloTimer_->cancelTimeout();
+  }
+  if (ifNameToHelloSchedule_.empty()) {
+    return;
+  }
+
+  auto nextHelloTime = ifNameToHelloSchedule_.begin()->second.nextHelloTime;
+  for (const auto& kv : ifNameToHelloSchedule_) {
+    nextHelloTime = std::min(nextHelloTime, kv.second.nextHelloTime);
+  }
+  const auto now = std::chrono::steady_clock::now();
+  helloTimer_->scheduleTimeout(
+      nextHelloTime > now
+          ? std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextHelloTime - now)
+          : std::chrono::milliseconds(0));
 }
 
 folly::Expected<fbzmq::Message, fbzmq::Error>
@@ -1179,15 +1532,7 @@ Spark::processRequestMsg(fbzmq::Message&& request) {
           neighbor.rtt.count(),
           neighbor.label,
           false /* supportFloodOptimization: doesn't matter in DOWN event*/);
-      auto ret = reportSocket_.sendMultiple(
-          fbzmq::Message::from(
-              openr::Constants::kSparkReportClientId.toString())
-              .value(),
-          fbzmq::Message(),
-          fbzmq::Message::fromThriftObj(event, serializer_).value());
-      if (ret.hasError()) {
-        LOG(ERROR) << "Error sending spark event: " << ret.error();
-      }
+      reportNeighborEvent(std::move(event));
     }
 
     // unsubscribe the socket from mcast group on this interface
@@ -1203,7 +1548,7 @@ Spark::processRequestMsg(fbzmq::Message&& request) {
     }
     // cleanup for this interface
     neighbors_.erase(ifName);
-    ifNameToHelloTimers_.erase(ifName);
+    ifNameToHelloSchedule_.erase(ifName);
     interfaceDb_.erase(ifName);
   }
 
@@ -1251,36 +1596,19 @@ Spark::processRequestMsg(fbzmq::Message&& request) {
       };
     };
 
-    auto roll = rollHelper(myKeepAliveTime_);
-    auto rollFast = rollHelper(fastInitKeepAliveTime_);
-    auto timePoint = std::chrono::steady_clock::now();
-
     // NOTE: We do not send hello packet immediately after adding new interface
     // this is due to the fact that it may not have yet configured a link-local
     // address. The hello packet will be sent later and will have good chances
     // of making it out if small delay is introduced.
-    auto helloTimer = fbzmq::ZmqTimeout::make(
-        this, [this, ifName, timePoint, roll, rollFast]() mutable noexcept {
-          VLOG(3) << "Sending hello multicast packet on interface " << ifName;
-          // We will send atleast 3 and atmost 4 packets in fast mode. Only one
-          // packet is enough for discovering neighbors in fast mode, however we
-          // send multiple for redundancy to overcome packet drops and compute
-          bool inFastInitState = (std::chrono::steady_clock::now() -
-                                  timePoint) <= 3 * fastInitKeepAliveTime_;
-          sendHelloPacket(ifName, inFastInitState);
-
-          // Schedule next run (add 20% variance)
-          // overriding timeoutPeriod if I am in fast initial state
-          std::chrono::milliseconds timeoutPeriod =
-              inFastInitState ? rollFast() : roll();
-
-          ifNameToHelloTimers_.at(ifName)->scheduleTimeout(timeoutPeriod);
-        });
-
-    // should be in fast init state when the node just starts
-    helloTimer->scheduleTimeout(rollFast());
-    ifNameToHelloTimers_[ifName] = std::move(helloTimer);
+    // Should be in fast init state when the node just starts
+    HelloSchedule schedule;
+    schedule.addedTime = std::chrono::steady_clock::now();
+    schedule.roll = rollHelper(myKeepAliveTime_);
+    schedule.rollFast = rollHelper(fastInitKeepAliveTime_);
+    schedule.nextHelloTime = schedule.addedTime + schedule.rollFast();
+    ifNameToHelloSchedule_[ifName] = std::move(schedule);
   }
+  scheduleHelloTimeout();
 
   //
   // Updating interface. If ifindex changes, we need to unsubscribe old ifindex
@@ -1334,7 +1662,7 @@ Spark::processRequestMsg(fbzmq::Message&& request) {
   }
   thrift::SparkIfDbUpdateResult result;
   result.isSuccess = true;
-  return fbzmq::Message::fromThriftObj(result, serializer_);
+  return toReplyMsg(result, serializer_);
 }
 
 folly::Optional<std::string>
@@ -1398,6 +1726,9 @@ Spark::submitCounters() {
   counters["spark.my_seq_num"] = mySeqNum_;
   counters["spark.pending_timers"] = getNumPendingTimeouts();
   counters["spark.zmq_event_queue_size"] = getEventQueueSize();
+  helloProcessingHistogram_.exportCounters(
+      "spark.hello_processing_us", counters);
+  exportProfileCounters(counters);
 
   zmqMonitorClient_->setCounters(prepareSubmitCounters(std::move(counters)));
 }
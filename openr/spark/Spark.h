@@ -9,6 +9,7 @@
 
 #include <chrono>
 #include <functional>
+#include <queue>
 
 #include <boost/serialization/strong_typedef.hpp>
 #include <fbzmq/async/ZmqEventLoop.h>
@@ -22,6 +23,7 @@
 #include <folly/stats/BucketedTimeSeries.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/OpenrEventLoop.h>
 #include <openr/common/StepDetector.h>
 #include <openr/common/Types.h>
@@ -66,7 +68,8 @@ class Spark final : public OpenrEventLoop {
       KvStoreCmdPort kvStoreCmdPort,
       std::pair<uint32_t, uint32_t> version,
       fbzmq::Context& zmqContext,
-      bool enableFloodOptimization = false);
+      bool enableFloodOptimization = false,
+      bool enableHardwareTimestamps = false);
 
   ~Spark() override = default;
 
@@ -94,9 +97,19 @@ class Spark final : public OpenrEventLoop {
   // (2) validate hello packet sequence number. detects neighbor restart if
   //     sequence number gets wrapped up again.
   // (3) performs various other validation e.g. domain, subnet validation etc.
+  //     skipped if hello signature is the same as of last valid hello
   PacketValidationResult validateHelloPacket(
       std::string const& ifName, thrift::SparkHelloPacket const& helloPacket);
 
+  // domain, version and subnet validation of hello packet originator
+  bool isValidHelloOriginator(
+      std::string const& ifName, thrift::SparkHelloPacket const& helloPacket);
+
+  // hash of the part of hello packet which is validated by
+  // isValidHelloOriginator() along with my address on the interface
+  size_t getHelloSignature(
+      std::string const& ifName, thrift::SparkHelloPacket const& helloPacket);
+
   // invoked when a neighbor's rtt changes
   void processNeighborRttChange(
       std::string const& ifName,
@@ -108,13 +121,30 @@ class Spark final : public OpenrEventLoop {
   void processNeighborHoldTimeout(
       std::string const& ifName, std::string const& neighborName);
 
+  // (Re)start or stop hold timer of a neighbor. Cheap enough to be done on
+  // every hello, all neighbors share holdTimer_
+  void scheduleNeighborHoldTimeout(
+      std::string const& ifName,
+      std::string const& neighborName,
+      std::chrono::milliseconds holdTime);
+  void cancelNeighborHoldTimeout(
+      std::string const& ifName, std::string const& neighborName);
+
+  // expire neighbors whose hold timer is due, and schedule holdTimer_ for
+  // the next one
+  void processHoldTimeouts() noexcept;
+
   // Determine if we should process the next packte from this ifName, addr pair
   bool shouldProcessHelloPacket(
       std::string const& ifName, folly::IPAddress const& addr);
 
+  // read pending hello packets on socket readiness, up to a budget, and
+  // process each of them
+  void processHelloPackets();
+
   // process hello packet from a neighbor. we want to see if
   // the neighbor could be added as adjacent peer.
-  void processHelloPacket();
+  void processHelloPacket(IoProvider::ReceivedMessage const& message);
 
   // originate my hello packet on given interface
   void sendHelloPacket(
@@ -122,9 +152,32 @@ class Spark final : public OpenrEventLoop {
       bool inFastInitState = false,
       bool restarting = false);
 
+  // originate my hello packets on given (interface, inFastInitState) pairs,
+  // with as few syscalls as possible
+  void sendHelloPackets(
+      std::vector<std::pair<std::string, bool>> const& ifNames,
+      bool restarting = false);
+
+  // build and serialize my hello packet for given interface. Consumes a seq#
+  folly::Optional<std::string> createHelloPacket(
+      std::string const& ifName, bool inFastInitState, bool restarting);
+
+  // send hellos of all interfaces which are due within helloSlot_
+  void processHelloTimeout() noexcept;
+
+  // (re)schedule helloTimer_ for the earliest due hello
+  void scheduleHelloTimeout();
+
   folly::Expected<fbzmq::Message, fbzmq::Error> processRequestMsg(
       fbzmq::Message&& request) override;
 
+  // queue neighbor event, all events queued in a loop iteration are sent to
+  // downstream consumer as one report
+  void reportNeighborEvent(thrift::SparkNeighborEvent event);
+
+  // send queued neighbor events, if any
+  void sendNeighborEvents() noexcept;
+
   // find an interface name in the interfaceDb given an ifIndex
   folly::Optional<std::string> findInterfaceFromIfindex(int ifIndex);
 
@@ -176,6 +229,9 @@ class Spark final : public OpenrEventLoop {
   // the multicast socket we use
   int mcastFd_{-1};
 
+  // last socket drop counter reported with received hellos, it is cumulative
+  folly::Optional<uint32_t> lastSocketDropCount_;
+
   //
   // zmq sockets section
   //
@@ -184,6 +240,10 @@ class Spark final : public OpenrEventLoop {
   const std::string reportUrl_{""};
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_SERVER> reportSocket_;
 
+  // neighbor events not yet sent on reportSocket_, sent by reportTimer_
+  thrift::SparkNeighborEvents pendingNeighborEvents_;
+  std::unique_ptr<fbzmq::ZmqTimeout> reportTimer_;
+
   // this is used to inform peers about my kvstore tcp ports
   const uint16_t kKvStorePubPort_;
   const uint16_t kKvStoreCmdPort_;
@@ -194,6 +254,12 @@ class Spark final : public OpenrEventLoop {
   // enable dual or not
   const bool enableFloodOptimization_{false};
 
+  // use hardware receive timestamps of hello packets if NIC supports them
+  const bool enableHardwareTimestamps_{false};
+
+  // hellos of interfaces due within this duration are sent together
+  const std::chrono::milliseconds helloSlot_{0};
+
   //
   // Interface tracking
   //
@@ -223,11 +289,20 @@ class Spark final : public OpenrEventLoop {
   // Map of interface entries keyed by ifName
   std::unordered_map<std::string, Interface> interfaceDb_{};
 
-  // Hello packet send timers for each interface
-  std::unordered_map<
-      std::string /* ifName */,
-      std::unique_ptr<fbzmq::ZmqTimeout>>
-      ifNameToHelloTimers_;
+  // Hello packet send schedule of an interface
+  struct HelloSchedule {
+    // when interface was added, for fast init state
+    std::chrono::steady_clock::time_point addedTime;
+    std::chrono::steady_clock::time_point nextHelloTime;
+    // hello intervals with variance, in normal and fast init state
+    std::function<std::chrono::milliseconds()> roll;
+    std::function<std::chrono::milliseconds()> rollFast;
+  };
+
+  // Hello packet send schedules for each interface, served by a single timer
+  std::unordered_map<std::string /* ifName */, HelloSchedule>
+      ifNameToHelloSchedule_;
+  std::unique_ptr<fbzmq::ZmqTimeout> helloTimer_;
 
   // Ordered set to keep track of allocated labels
   std::set<int32_t> allocatedLabels_;
@@ -242,15 +317,19 @@ class Spark final : public OpenrEventLoop {
         thrift::SparkNeighbor const& info,
         uint32_t label,
         uint64_t seqNum,
-        std::unique_ptr<fbzmq::ZmqTimeout> holdTimer,
         const std::chrono::milliseconds& samplingPeriod,
         std::function<void(const int64_t&)> rttChangeCb);
 
     // Neighbor info
     thrift::SparkNeighbor info;
 
-    // Hold timer. If expired will declare the neighbor as stopped.
-    const std::unique_ptr<fbzmq::ZmqTimeout> holdTimer{nullptr};
+    // Hold timeout, if running. If expired will declare the neighbor as
+    // stopped.
+    folly::Optional<std::chrono::steady_clock::time_point> holdTimeout;
+
+    // Time of the entry of this neighbor in holdTimeouts_ which is not stale,
+    // at or before holdTimeout. Refreshing hold timeout doesn't touch it
+    folly::Optional<std::chrono::steady_clock::time_point> queuedHoldTimeout;
 
     // SR Label to reach Neighbor over this specific adjacency. Generated
     // using ifIndex to this neighbor. Only local within the node.
@@ -259,6 +338,12 @@ class Spark final : public OpenrEventLoop {
     // Last sequence number received from neighbor
     uint64_t seqNum{0};
 
+    // Version of last hello packet received from neighbor
+    thrift::OpenrVersion version{0};
+
+    // Signature of last valid hello packet received from neighbor
+    size_t helloSignature{0};
+
     // Timestamps of last hello packet received from this neighbor. All
     // timestamps are derived from std::chrono::steady_clock.
     std::chrono::microseconds neighborTimestamp{0};
@@ -277,8 +362,8 @@ class Spark final : public OpenrEventLoop {
     // Lastest measured RTT on receipt of every hello packet
     std::chrono::microseconds rttLatest{0};
 
-    // detect rtt changes
-    StepDetector<int64_t, std::chrono::milliseconds> stepDetector;
+    // detect rtt changes, over fast and slow windows of 10 and 60 samples
+    StepDetector<int64_t, std::chrono::milliseconds, 10, 60> stepDetector;
   };
 
   std::unordered_map<
@@ -286,6 +371,26 @@ class Spark final : public OpenrEventLoop {
       std::unordered_map<std::string /* neighborName */, Neighbor>>
       neighbors_{};
 
+  // Hold timeouts of all neighbors, earliest first. Entries are not removed
+  // when timeout is refreshed or stopped, but checked against neighbor when
+  // due, and requeued if refreshed
+  struct HoldTimeout {
+    std::chrono::steady_clock::time_point timeout;
+    std::string ifName;
+    std::string neighborName;
+
+    bool
+    operator>(const HoldTimeout& other) const {
+      return timeout > other.timeout;
+    }
+  };
+  std::priority_queue<
+      HoldTimeout,
+      std::vector<HoldTimeout>,
+      std::greater<HoldTimeout>>
+      holdTimeouts_;
+  std::unique_ptr<fbzmq::ZmqTimeout> holdTimer_;
+
   // to serdeser messages over ZMQ sockets
   apache::thrift::CompactSerializer serializer_;
 
@@ -305,6 +410,9 @@ class Spark final : public OpenrEventLoop {
   // DS to hold local stats/counters
   fbzmq::ThreadData tData_;
 
+  // durations of processing one hello packet, 10us buckets up to 10ms
+  MicrosecondsHistogram helloProcessingHistogram_{10, 10000};
+
   // client to interact with monitor
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient_;
 };
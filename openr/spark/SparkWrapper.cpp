@@ -7,6 +7,9 @@
 
 #include "SparkWrapper.h"
 
+#include <pthread.h>
+#include <time.h>
+
 using namespace fbzmq;
 
 namespace openr {
@@ -117,18 +120,37 @@ SparkWrapper::updateInterfaceDb(
 folly::Expected<thrift::SparkNeighborEvent, Error>
 SparkWrapper::recvNeighborEvent(
     folly::Optional<std::chrono::milliseconds> timeout) {
-  fbzmq::Message requestIdMsg, delimMsg, thriftMsg;
-  const auto ret = reportSock_.recvMultipleTimeout(
-      timeout, requestIdMsg, delimMsg, thriftMsg);
-  if (ret.hasError()) {
-    return folly::makeUnexpected(ret.error());
+  if (pendingEvents_.empty()) {
+    fbzmq::Message requestIdMsg, delimMsg, thriftMsg;
+    const auto ret = reportSock_.recvMultipleTimeout(
+        timeout, requestIdMsg, delimMsg, thriftMsg);
+    if (ret.hasError()) {
+      return folly::makeUnexpected(ret.error());
+    }
+    auto maybeMsg =
+        thriftMsg.readThriftObj<thrift::SparkNeighborEvents>(serializer_);
+    if (maybeMsg.hasError()) {
+      return folly::makeUnexpected(maybeMsg.error());
+    }
+    for (auto& event : maybeMsg->events) {
+      pendingEvents_.emplace_back(std::move(event));
+    }
   }
-  const auto maybeMsg =
-      thriftMsg.readThriftObj<thrift::SparkNeighborEvent>(serializer_);
-  if (maybeMsg.hasError()) {
-    return folly::makeUnexpected(maybeMsg.error());
+  if (pendingEvents_.empty()) {
+    return folly::makeUnexpected(fbzmq::Error(EAGAIN));
   }
-  return maybeMsg.value();
+  auto event = std::move(pendingEvents_.front());
+  pendingEvents_.pop_front();
+  return event;
+}
+
+std::chrono::nanoseconds
+SparkWrapper::getCpuTime() const {
+  clockid_t clockId;
+  struct timespec ts;
+  CHECK_EQ(0, pthread_getcpuclockid(thread_->native_handle(), &clockId));
+  CHECK_EQ(0, clock_gettime(clockId, &ts));
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
 }
 
 } // namespace openr
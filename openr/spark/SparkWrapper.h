@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include "Spark.h"
 
 namespace openr {
@@ -55,10 +57,14 @@ class SparkWrapper {
   bool updateInterfaceDb(
       const std::vector<SparkInterfaceEntry>& interfaceEntries);
 
-  // receive spark neighbor event
+  // receive spark neighbor event, events reported together are returned one
+  // by one
   folly::Expected<thrift::SparkNeighborEvent, fbzmq::Error> recvNeighborEvent(
       folly::Optional<std::chrono::milliseconds> timeout = folly::none);
 
+  // CPU time consumed so far by thread running Spark
+  std::chrono::nanoseconds getCpuTime() const;
+
   //
   // Private state
   //
@@ -85,6 +91,9 @@ class SparkWrapper {
   // ZMQ pair socket for listening realtime updates from Spark
   fbzmq::Socket<ZMQ_ROUTER, fbzmq::ZMQ_CLIENT> reportSock_;
 
+  // Received neighbor events not yet returned by recvNeighborEvent()
+  std::deque<thrift::SparkNeighborEvent> pendingEvents_;
+
   // Spark owned by this wrapper.
   std::shared_ptr<Spark> spark_{nullptr};
 
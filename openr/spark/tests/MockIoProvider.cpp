@@ -14,6 +14,7 @@
 #include <glog/logging.h>
 
 #include <folly/Exception.h>
+#include <folly/Random.h>
 #include <folly/ScopeGuard.h>
 #include <folly/SocketAddress.h>
 
@@ -35,6 +36,14 @@ MockIoProvider::setConnectedPairs(ConnectedIfPairs connectedIfPairs) {
   connectedIfPairs_ = std::move(connectedIfPairs);
 }
 
+void
+MockIoProvider::setPacketLossRate(double lossRate) {
+  VLOG(4) << "MockIoProvider::setPacketLossRate called";
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  lossRate_ = lossRate;
+}
+
 int
 MockIoProvider::socket(int /* domain */, int /* type */, int /* protocol */) {
   VLOG(4) << "MockIoProvider::socket called";
@@ -228,6 +237,12 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
     // this prevents sending to self
     CHECK(otherFd != sockFd);
 
+    // lost on the wire, still sent from sender's point of view
+    sent = true;
+    if (lossRate_ > 0 and folly::Random::randDouble01() < lossRate_) {
+      continue;
+    }
+
     auto& msgQueue = mailboxes_[otherFd];
 
     // copy the data from iov
@@ -240,8 +255,6 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
         srcAddr,
         std::move(packet),
         std::chrono::milliseconds(latency));
-
-    sent = true;
   }
 
   // return the length of single vector sent
@@ -251,6 +264,55 @@ MockIoProvider::sendmsg(int sockFd, const struct msghdr* msg, int /* flags */) {
   return -1;
 }
 
+int
+MockIoProvider::recvmmsg(
+    int sockFd,
+    struct mmsghdr* msgvec,
+    unsigned int vlen,
+    int flags,
+    struct timespec* /* timeout */) {
+  VLOG(4) << "MockIoProvider::recvmmsg called for " << vlen << " messages";
+
+  numRecvmmsgCalls_.fetch_add(1, std::memory_order_relaxed);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    // later messages have not arrived yet, do not deliver them early
+    if (i > 0 and not hasActiveMessage(sockFd)) {
+      return i;
+    }
+    auto bytesRead = recvmsg(sockFd, &msgvec[i].msg_hdr, flags);
+    if (bytesRead < 0) {
+      return i ? i : -1;
+    }
+    msgvec[i].msg_len = bytesRead;
+  }
+  return vlen;
+}
+
+int
+MockIoProvider::sendmmsg(
+    int sockFd, struct mmsghdr* msgvec, unsigned int vlen, int flags) {
+  VLOG(4) << "MockIoProvider::sendmmsg called with " << vlen << " messages";
+
+  numSendmmsgCalls_.fetch_add(1, std::memory_order_relaxed);
+  for (unsigned int i = 0; i < vlen; ++i) {
+    auto bytesSent = sendmsg(sockFd, &msgvec[i].msg_hdr, flags);
+    if (bytesSent < 0) {
+      return i ? i : -1;
+    }
+    msgvec[i].msg_len = bytesSent;
+  }
+  return vlen;
+}
+
+bool
+MockIoProvider::hasActiveMessage(int sockFd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = mailboxes_.find(sockFd);
+  return it != mailboxes_.end() and it->second.size() and
+      it->second.front().isActive();
+}
+
 //
 // Simply accept all setsockopts, and build fd to ifName mapping
 //
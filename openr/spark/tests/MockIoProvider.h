@@ -9,6 +9,7 @@
 
 #include <openr/spark/IoProvider.h>
 
+#include <atomic>
 #include <list>
 #include <map>
 #include <mutex>
@@ -83,6 +84,22 @@ class MockIoProvider final : public IoProvider {
   // packet sent off of x will be delivered to y, z
   void setConnectedPairs(ConnectedIfPairs connectedIfPairs);
 
+  // fraction of packets dropped, independently for each connected interface
+  // a packet is delivered to
+  void setPacketLossRate(double lossRate);
+
+  // number of sendmmsg()/recvmmsg() calls made so far, by all sockets. Each
+  // batch of hellos sent or received by Spark is one call
+  uint64_t
+  getNumSendmmsgCalls() const {
+    return numSendmmsgCalls_.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  getNumRecvmmsgCalls() const {
+    return numRecvmmsgCalls_.load(std::memory_order_relaxed);
+  }
+
   //
   // The usual IO jazz
   //
@@ -98,6 +115,22 @@ class MockIoProvider final : public IoProvider {
 
   ssize_t sendmsg(int sockfd, const struct msghdr* msg, int flags) override;
 
+  // recvmsg() for each message, up to first one which fails or is not yet
+  // to be delivered
+  int recvmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags,
+      struct timespec* timeout) override;
+
+  // sendmsg() for each message, up to first one which fails
+  int sendmmsg(
+      int sockfd,
+      struct mmsghdr* msgvec,
+      unsigned int vlen,
+      int flags) override;
+
   int setsockopt(
       int sockfd,
       int level,
@@ -111,6 +144,9 @@ class MockIoProvider final : public IoProvider {
   void addIfNameIfIndex(const IfNameAndifIndex& entries);
 
  private:
+  // is first message in mailbox of fd ready to be delivered
+  bool hasActiveMessage(int sockFd);
+
   // Boolean to keep track of running-state of MockIoProvider
   std::atomic<bool> isRunning_{false};
 
@@ -119,6 +155,11 @@ class MockIoProvider final : public IoProvider {
 
   ConnectedIfPairs connectedIfPairs_{};
 
+  double lossRate_{0};
+
+  std::atomic<uint64_t> numSendmmsgCalls_{0};
+  std::atomic<uint64_t> numRecvmmsgCalls_{0};
+
   // Map of send/recv fds. All fds used below belong to recv-fd which is being
   // polled by Spark (or returned to spark).
   std::map<int /* recv-fd */, int /* send-fd */> pipeFds_;
@@ -0,0 +1,367 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MockIoProvider.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/Format.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/Constants.h>
+#include <openr/common/NetworkUtil.h>
+#include <openr/common/Util.h>
+#include <openr/spark/IoProvider.h>
+#include <openr/spark/SparkWrapper.h>
+
+/**
+ * Defines a benchmark that allows users to record customized counter during
+ * benchmarking and passes a parameter to another one. This is common for
+ * benchmarks that need a "problem size" in addition to "number of iterations".
+ */
+#define BENCHMARK_COUNTERS_PARAM(name, counters, param) \
+  BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param, param)
+
+/*
+ * Like BENCHMARK_COUNTERS_PARAM(), but allows a custom name to be specified for
+ * each parameter, rather than using the parameter value.
+ */
+#define BENCHMARK_COUNTERS_NAME_PARAM(name, counters, param_name, ...) \
+  BENCHMARK_IMPL_COUNTERS(                                             \
+      FB_CONCATENATE(name, FB_CONCATENATE(_, param_name)),             \
+      FB_STRINGIZE(name) "(" FB_STRINGIZE(param_name) ")",             \
+      counters,                                                        \
+      iters,                                                           \
+      unsigned,                                                        \
+      iters) {                                                         \
+    name(counters, iters, ##__VA_ARGS__);                              \
+  }
+
+using apache::thrift::CompactSerializer;
+
+namespace openr {
+
+namespace {
+
+const std::string kDomainName("terragraph");
+
+// the Spark under test, all simulated neighbors peer with it
+const std::string kNodeName("node-0");
+
+const std::string kSparkReportUrl("inproc://spark_benchmark_report");
+const std::string kSparkCounterCmdUrl("inproc://spark_benchmark_counter_cmd");
+
+const std::chrono::milliseconds kHoldTime(3000);
+const std::chrono::milliseconds kKeepAliveTime(1000);
+const std::chrono::milliseconds kFastInitKeepAliveTime(100);
+
+// how long to wait for all neighbors to come up
+const std::chrono::seconds kNeighborUpTimeout(60);
+
+// how long to measure steady state once all neighbors are up
+const std::chrono::seconds kSteadyStateTime(5);
+
+// interfaces of simulated neighbors are numbered after the ones of Spark
+const int kNeighborIfIndexBase{100000};
+
+const int kMaxPacketSize{1280};
+const unsigned int kRecvBatchSize{64};
+
+std::string
+getIfName(uint32_t i) {
+  return folly::sformat("iface-{}", i);
+}
+
+std::string
+getNeighborName(uint32_t i) {
+  return folly::sformat("nbr-{}", i);
+}
+
+folly::IPAddressV6
+getLinkLocalAddr(uint32_t id) {
+  return folly::IPAddressV6(
+      folly::sformat("fe80::{:x}:{:x}", id >> 16, id & 0xffff));
+}
+
+/**
+ * Simulates neighbors of the Spark under test, one per interface on their
+ * side, all from one socket. Every hello from Spark is answered right away
+ * by the neighbor on the interface it is received on, reflecting its
+ * sequence number and timestamps, so hello rate of neighbors follows the one
+ * of Spark.
+ */
+class NeighborSimulator {
+ public:
+  NeighborSimulator(
+      std::shared_ptr<MockIoProvider> ioProvider, uint32_t numNeighbors)
+      : ioProvider_(std::move(ioProvider)) {
+    fd_ = ioProvider_->socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    for (uint32_t i = 0; i < numNeighbors; ++i) {
+      const auto ifName = getNeighborName(i);
+      const auto v6Addr = getLinkLocalAddr(kNeighborIfIndexBase + i);
+
+      thrift::SparkNeighbor originator;
+      originator.domainName = kDomainName;
+      originator.nodeName = getNeighborName(i);
+      originator.holdTime = kHoldTime.count();
+      originator.transportAddressV6 = toBinaryAddress(v6Addr);
+      originator.transportAddressV4 =
+          toBinaryAddress(folly::IPAddress("0.0.0.0"));
+      originator.kvStorePubPort = 10001;
+      originator.kvStoreCmdPort = 10002;
+      originator.ifName = ifName;
+      neighbors_.emplace_back(SimulatedNeighbor{std::move(originator), 1});
+
+      struct ipv6_mreq mreq;
+      mreq.ipv6mr_interface = kNeighborIfIndexBase + i;
+      CHECK_EQ(
+          0,
+          ioProvider_->setsockopt(
+              fd_, IPPROTO_IPV6, IPV6_JOIN_GROUP, &mreq, sizeof(mreq)));
+    }
+
+    thread_ = std::thread([this]() { run(); });
+  }
+
+  ~NeighborSimulator() {
+    isRunning_.store(false, std::memory_order_relaxed);
+    thread_.join();
+  }
+
+  uint64_t
+  getNumHellosSent() const {
+    return numHellosSent_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct SimulatedNeighbor {
+    thrift::SparkNeighbor originator;
+    int64_t seqNum{1};
+  };
+
+  void
+  run() {
+    while (isRunning_.load(std::memory_order_relaxed)) {
+      struct pollfd pfd;
+      pfd.fd = fd_;
+      pfd.events = POLLIN;
+      if (poll(&pfd, 1, 10 /* ms */) <= 0) {
+        continue;
+      }
+      try {
+        for (auto const& message : IoProvider::recvMessages(
+                 fd_, kMaxPacketSize, kRecvBatchSize, ioProvider_.get())) {
+          processHello(message);
+        }
+      } catch (std::exception const&) {
+        // mailbox is empty
+      }
+    }
+  }
+
+  void
+  processHello(IoProvider::ReceivedMessage const& message) {
+    auto hello = fbzmq::util::readThriftObjStr<thrift::SparkHelloPacket>(
+        message.packet, serializer_);
+    if (hello.payload.originator.nodeName != kNodeName or
+        hello.payload.restarting.value_or(false)) {
+      return;
+    }
+
+    const uint32_t i = message.ifIndex - kNeighborIfIndexBase;
+    CHECK_LT(i, neighbors_.size());
+    auto& neighbor = neighbors_[i];
+
+    thrift::SparkPayload payload;
+    payload.version = Constants::kOpenrVersion;
+    payload.originator = neighbor.originator;
+    payload.seqNum = neighbor.seqNum++;
+    payload.timestamp = getCurrentTimeInUs().count();
+    auto& neighborInfo = payload.neighborInfos[kNodeName];
+    neighborInfo.seqNum = hello.payload.seqNum;
+    neighborInfo.lastNbrMsgSentTsInUs = hello.payload.timestamp;
+    neighborInfo.lastMyMsgRcvdTsInUs = message.recvTime.count();
+
+    const auto packet = fbzmq::util::writeThriftObjStr(
+        thrift::SparkHelloPacket(apache::thrift::FRAGILE, payload, ""),
+        serializer_);
+    IoProvider::sendMessage(
+        fd_,
+        message.ifIndex,
+        getLinkLocalAddr(message.ifIndex),
+        folly::SocketAddress(folly::IPAddress("ff02::1"), 6666),
+        packet,
+        ioProvider_.get());
+    numHellosSent_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static std::chrono::microseconds
+  getCurrentTimeInUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+  }
+
+  std::shared_ptr<MockIoProvider> ioProvider_;
+  int fd_{-1};
+  std::vector<SimulatedNeighbor> neighbors_;
+  CompactSerializer serializer_;
+  std::atomic<bool> isRunning_{true};
+  std::atomic<uint64_t> numHellosSent_{0};
+  std::thread thread_;
+};
+
+} // namespace
+
+/**
+ * Bring up numNeighbors simulated neighbors, spread evenly over numInterfaces
+ * interfaces of one Spark, with given loss and one way delay, and report
+ * - neighbor up latency since interfaces were added, median and maximum
+ * - CPU time of Spark thread per neighbor per second in steady state
+ * - sendmmsg()/recvmmsg() calls of Spark per second in steady state, each
+ *   one is a wakeup of its event loop for hello timer or socket
+ *
+ * Hello packets carry info of all neighbors on their interface and must fit
+ * in minimum IPv6 MTU, so keep it to a few tens of neighbors per interface.
+ */
+static void
+BM_SparkNeighbors(
+    folly::UserCounters& counters,
+    uint32_t iters,
+    uint32_t numInterfaces,
+    uint32_t numNeighbors,
+    uint32_t lossPercent,
+    uint32_t delayMs) {
+  auto suspender = folly::BenchmarkSuspender();
+
+  for (uint32_t iter = 0; iter < iters; ++iter) {
+    fbzmq::Context context;
+    auto ioProvider = std::make_shared<MockIoProvider>();
+    std::thread ioProviderThread([ioProvider]() { ioProvider->start(); });
+    ioProvider->waitUntilRunning();
+
+    // wire up iface-(i % numInterfaces) <=> nbr-i
+    IfNameAndifIndex ifNameAndIfIndex;
+    ConnectedIfPairs connectedPairs;
+    std::vector<SparkInterfaceEntry> interfaceEntries;
+    for (uint32_t i = 0; i < numInterfaces; ++i) {
+      ifNameAndIfIndex.emplace_back(getIfName(i), i + 1);
+      interfaceEntries.push_back(SparkInterfaceEntry{
+          getIfName(i),
+          static_cast<int>(i + 1),
+          folly::IPAddress::createNetwork("0.0.0.0/32"),
+          folly::CIDRNetwork{getLinkLocalAddr(i + 1), 128}});
+    }
+    for (uint32_t i = 0; i < numNeighbors; ++i) {
+      const auto ifName = getIfName(i % numInterfaces);
+      ifNameAndIfIndex.emplace_back(
+          getNeighborName(i), kNeighborIfIndexBase + i);
+      connectedPairs[ifName].emplace_back(getNeighborName(i), delayMs);
+      connectedPairs[getNeighborName(i)].emplace_back(ifName, delayMs);
+    }
+    ioProvider->addIfNameIfIndex(ifNameAndIfIndex);
+    ioProvider->setConnectedPairs(std::move(connectedPairs));
+    ioProvider->setPacketLossRate(lossPercent / 100.0);
+
+    auto spark = std::make_unique<SparkWrapper>(
+        kDomainName,
+        kNodeName,
+        kHoldTime,
+        kKeepAliveTime,
+        kFastInitKeepAliveTime,
+        false /* enable v4 */,
+        false /* enable subnet validation */,
+        SparkReportUrl{kSparkReportUrl},
+        MonitorSubmitUrl{kSparkCounterCmdUrl},
+        std::make_pair(
+            Constants::kOpenrVersion, Constants::kOpenrSupportedVersion),
+        context,
+        ioProvider);
+    auto simulator = std::make_unique<NeighborSimulator>(
+        ioProvider, numNeighbors);
+
+    // neighbor up latency
+    suspender.dismiss();
+    const auto startTime = std::chrono::steady_clock::now();
+    CHECK(spark->updateInterfaceDb(interfaceEntries));
+    std::vector<int64_t> upLatenciesMs;
+    while (upLatenciesMs.size() < numNeighbors and
+           std::chrono::steady_clock::now() - startTime < kNeighborUpTimeout) {
+      auto maybeEvent = spark->recvNeighborEvent(kKeepAliveTime);
+      if (maybeEvent.hasError() or
+          maybeEvent->eventType !=
+              thrift::SparkNeighborEventType::NEIGHBOR_UP) {
+        continue;
+      }
+      upLatenciesMs.emplace_back(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - startTime)
+              .count());
+    }
+    suspender.rehire();
+
+    // steady state, neighbor events are left in report socket
+    const auto cpuTimeBefore = spark->getCpuTime();
+    const auto numSendCallsBefore = ioProvider->getNumSendmmsgCalls();
+    const auto numRecvCallsBefore = ioProvider->getNumRecvmmsgCalls();
+    const auto numHellosBefore = simulator->getNumHellosSent();
+    std::this_thread::sleep_for(kSteadyStateTime);
+    const auto cpuTime = spark->getCpuTime() - cpuTimeBefore;
+    const auto cpuTimeUs =
+        std::chrono::duration_cast<std::chrono::microseconds>(cpuTime).count();
+    const auto numHellos = simulator->getNumHellosSent() - numHellosBefore;
+
+    counters["neighbors_up"] = upLatenciesMs.size();
+    if (not upLatenciesMs.empty()) {
+      std::sort(upLatenciesMs.begin(), upLatenciesMs.end());
+      counters["neighbor_up_p50_ms"] =
+          upLatenciesMs.at(upLatenciesMs.size() / 2);
+      counters["neighbor_up_max_ms"] = upLatenciesMs.back();
+    }
+    counters["cpu_us_per_neighbor_per_sec"] =
+        cpuTimeUs / numNeighbors / kSteadyStateTime.count();
+    counters["cpu_ns_per_hello"] = numHellos ? cpuTimeUs * 1000 / numHellos : 0;
+    counters["send_calls_per_sec"] =
+        (ioProvider->getNumSendmmsgCalls() - numSendCallsBefore) /
+        kSteadyStateTime.count();
+    counters["recv_calls_per_sec"] =
+        (ioProvider->getNumRecvmmsgCalls() - numRecvCallsBefore) /
+        kSteadyStateTime.count();
+
+    simulator.reset();
+    spark.reset();
+    ioProvider->stop();
+    ioProviderThread.join();
+  }
+}
+
+// The parameters are number of interfaces, number of neighbors, percentage
+// of lost packets and one way delay in ms
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SparkNeighbors, counters, 100_1000_0_0, 100, 1000, 0, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SparkNeighbors, counters, 100_1000_5_10, 100, 1000, 5, 10);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SparkNeighbors, counters, 400_10000_0_0, 400, 10000, 0, 0);
+BENCHMARK_COUNTERS_NAME_PARAM(
+    BM_SparkNeighbors, counters, 400_10000_5_10, 400, 10000, 5, 10);
+
+} // namespace openr
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2014-present, Facebook, Inc.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/**
+ * Emulates a topology of many Open/R nodes in one process and reports how
+ * long it takes for routes to converge and the CPU time each node consumes.
+ *
+ * Nodes are OpenrWrapper instances sharing one ZMQ context, with Spark links
+ * emulated by a single MockIoProvider and Fib in dry run mode. Every node
+ * still runs its own module threads, so the number of nodes is bound by the
+ * number of threads the host can bear, in the order of hundreds.
+ *
+ * Routes of a node have converged once it has a route to the allocated
+ * prefix of every other node.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fbzmq/zmq/Zmq.h>
+#include <folly/Format.h>
+#include <folly/IPAddress.h>
+#include <folly/init/Init.h>
+#include <glog/logging.h>
+#include <sodium.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include <openr/common/NetworkUtil.h>
+#include <openr/spark/tests/MockIoProvider.h>
+#include <openr/tests/OpenrWrapper.h>
+
+DEFINE_int32(num_nodes, 100, "Number of emulated nodes");
+DEFINE_string(
+    topology,
+    "ring",
+    "Topology of nodes: ring, or grid of ceil(sqrt(num_nodes)) columns");
+DEFINE_int32(link_latency_ms, 1, "One way latency of emulated links");
+DEFINE_int32(
+    convergence_timeout_s, 600, "How long to wait for routes to converge");
+DEFINE_int32(
+    steady_state_s, 10, "How long to measure CPU time once routes converged");
+
+using apache::thrift::CompactSerializer;
+using namespace openr;
+
+namespace {
+
+const std::chrono::seconds kKvStoreDbSyncInterval(60);
+const std::chrono::seconds kKvStoreMonitorSubmitInterval(3600);
+const std::chrono::milliseconds kSparkHoldTime(3000);
+const std::chrono::milliseconds kSparkKeepAliveTime(1000);
+const std::chrono::milliseconds kSparkFastInitKeepAliveTime(100);
+const std::chrono::seconds kLinkMonitorAdjHoldTime(1);
+const std::chrono::milliseconds kLinkFlapInitialBackoff(1);
+const std::chrono::milliseconds kLinkFlapMaxBackoff(8);
+const std::chrono::seconds kFibColdStartDuration(1);
+
+// how often to check nodes for convergence
+const std::chrono::milliseconds kPollInterval(500);
+
+// Links between nodes, by node index
+std::vector<std::pair<int, int>>
+createLinks(const std::string& topology, int numNodes) {
+  std::vector<std::pair<int, int>> links;
+  if (topology == "ring") {
+    // two nodes are linked once
+    const int numLinks = numNodes == 2 ? 1 : numNodes;
+    for (int i = 0; i < numLinks; ++i) {
+      links.emplace_back(i, (i + 1) % numNodes);
+    }
+  } else if (topology == "grid") {
+    const int numColumns = std::ceil(std::sqrt(numNodes));
+    for (int i = 0; i < numNodes; ++i) {
+      if ((i + 1) % numColumns != 0 and i + 1 < numNodes) {
+        links.emplace_back(i, i + 1);
+      }
+      if (i + numColumns < numNodes) {
+        links.emplace_back(i, i + numColumns);
+      }
+    }
+  } else {
+    LOG(FATAL) << "Unknown topology " << topology;
+  }
+  return links;
+}
+
+std::string
+getNodeName(int index) {
+  return folly::sformat("node-{}", index);
+}
+
+int64_t
+getPercentile(const std::vector<int64_t>& sortedValues, double percentile) {
+  const auto rank = static_cast<size_t>(percentile * sortedValues.size());
+  return sortedValues.at(std::min(rank, sortedValues.size() - 1));
+}
+
+void
+printSummary(const std::string& name, std::vector<int64_t> values) {
+  if (values.empty()) {
+    return;
+  }
+  std::sort(values.begin(), values.end());
+  std::cout << folly::sformat(
+                   "{}: p50 {} p90 {} max {}",
+                   name,
+                   getPercentile(values, 0.5),
+                   getPercentile(values, 0.9),
+                   values.back())
+            << std::endl;
+}
+
+} // namespace
+
+int
+main(int argc, char** argv) {
+  folly::init(&argc, &argv);
+  CHECK_LT(1, FLAGS_num_nodes);
+  CHECK_LE(0, FLAGS_link_latency_ms);
+
+  // init sodium security library
+  if (::sodium_init() == -1) {
+    LOG(ERROR) << "Failed initializing sodium";
+    return 1;
+  }
+
+  // Interfaces of each node and the interface pairs linking them
+  const auto links = createLinks(FLAGS_topology, FLAGS_num_nodes);
+  std::vector<std::vector<SparkInterfaceEntry>> nodeInterfaces(
+      FLAGS_num_nodes);
+  IfNameAndifIndex ifIndexes;
+  ConnectedIfPairs connectedPairs;
+  for (const auto& link : links) {
+    const auto ifName1 = folly::sformat("if_{}_{}", link.first, link.second);
+    const auto ifName2 = folly::sformat("if_{}_{}", link.second, link.first);
+    for (const auto& end :
+         {std::make_pair(link.first, ifName1),
+          std::make_pair(link.second, ifName2)}) {
+      const int ifIndex = ifIndexes.size() + 1;
+      ifIndexes.emplace_back(end.second, ifIndex);
+      nodeInterfaces.at(end.first).emplace_back(SparkInterfaceEntry{
+          end.second,
+          ifIndex,
+          folly::IPAddress::createNetwork(folly::sformat(
+              "10.{}.{}.1/32", (end.first >> 8) & 0xff, end.first & 0xff)),
+          folly::CIDRNetwork(
+              folly::IPAddress(folly::sformat("fe80::{:x}", end.first + 1)),
+              128)});
+    }
+    connectedPairs[ifName1].emplace_back(ifName2, FLAGS_link_latency_ms);
+    connectedPairs[ifName2].emplace_back(ifName1, FLAGS_link_latency_ms);
+  }
+  LOG(INFO) << "Emulating " << FLAGS_num_nodes << " nodes with "
+            << links.size() << " links in " << FLAGS_topology << " topology";
+
+  auto mockIoProvider = std::make_shared<MockIoProvider>();
+  std::thread mockIoProviderThread([&mockIoProvider]() {
+    LOG(INFO) << "Starting mockIoProvider thread.";
+    mockIoProvider->start();
+    LOG(INFO) << "mockIoProvider thread got stopped.";
+  });
+  mockIoProvider->waitUntilRunning();
+  mockIoProvider->addIfNameIfIndex(ifIndexes);
+  mockIoProvider->setConnectedPairs(connectedPairs);
+
+  fbzmq::Context context;
+  std::vector<std::unique_ptr<OpenrWrapper<CompactSerializer>>> nodes;
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    nodes.emplace_back(std::make_unique<OpenrWrapper<CompactSerializer>>(
+        context,
+        getNodeName(i),
+        false /* v4Enabled */,
+        kKvStoreDbSyncInterval,
+        kKvStoreMonitorSubmitInterval,
+        kSparkHoldTime,
+        kSparkKeepAliveTime,
+        kSparkFastInitKeepAliveTime,
+        kLinkMonitorAdjHoldTime,
+        kLinkFlapInitialBackoff,
+        kLinkFlapMaxBackoff,
+        kFibColdStartDuration,
+        mockIoProvider,
+        0 /* systemPort: loopback addresses are not set */,
+        openr::memLimitMB,
+        false /* per_prefix_keys */,
+        false /* enableWatchdog: memory is of whole process */));
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  for (auto& node : nodes) {
+    node->run();
+  }
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    CHECK(nodes.at(i)->sparkUpdateInterfaceDb(nodeInterfaces.at(i)));
+  }
+
+  // Wait for every node to have its prefix allocated, then for routes to all
+  // of them
+  const auto deadline =
+      startTime + std::chrono::seconds(FLAGS_convergence_timeout_s);
+  std::vector<folly::Optional<thrift::IpPrefix>> prefixes(FLAGS_num_nodes);
+  std::vector<folly::Optional<std::chrono::milliseconds>> convergenceTimes(
+      FLAGS_num_nodes);
+  std::vector<std::chrono::nanoseconds> convergenceCpuTimes(FLAGS_num_nodes);
+  int numConverged{0};
+  while (numConverged < FLAGS_num_nodes and
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(kPollInterval);
+    const bool allAllocated = std::all_of(
+        prefixes.begin(), prefixes.end(), [](const auto& prefix) {
+          return prefix.hasValue();
+        });
+    if (not allAllocated) {
+      for (int i = 0; i < FLAGS_num_nodes; ++i) {
+        prefixes.at(i) = nodes.at(i)->getIpPrefix();
+      }
+      continue;
+    }
+
+    for (int i = 0; i < FLAGS_num_nodes; ++i) {
+      if (convergenceTimes.at(i).hasValue()) {
+        continue;
+      }
+      const auto routeDb = nodes.at(i)->fibDumpRouteDatabase();
+      bool converged{true};
+      for (int j = 0; j < FLAGS_num_nodes and converged; ++j) {
+        if (i != j) {
+          converged = OpenrWrapper<CompactSerializer>::checkPrefixExists(
+              prefixes.at(j).value(), routeDb);
+        }
+      }
+      if (converged) {
+        convergenceTimes.at(i) =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTime);
+        convergenceCpuTimes.at(i) = nodes.at(i)->getCpuTime();
+        ++numConverged;
+      }
+    }
+  }
+
+  std::cout << "nodes: " << FLAGS_num_nodes << std::endl;
+  std::cout << "links: " << links.size() << std::endl;
+  std::cout << "converged_nodes: " << numConverged << std::endl;
+  std::vector<int64_t> convergenceMs;
+  std::vector<int64_t> convergenceCpuMs;
+  for (int i = 0; i < FLAGS_num_nodes; ++i) {
+    if (convergenceTimes.at(i).hasValue()) {
+      convergenceMs.emplace_back(convergenceTimes.at(i)->count());
+      convergenceCpuMs.emplace_back(
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              convergenceCpuTimes.at(i))
+              .count());
+    }
+  }
+  printSummary("convergence_ms", convergenceMs);
+  printSummary("convergence_cpu_ms_per_node", convergenceCpuMs);
+
+  // CPU time of nodes once converged, i.e. of keep alives and refreshes
+  if (numConverged == FLAGS_num_nodes and FLAGS_steady_state_s > 0) {
+    std::vector<std::chrono::nanoseconds> cpuTimesBefore;
+    for (auto& node : nodes) {
+      cpuTimesBefore.emplace_back(node->getCpuTime());
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(FLAGS_steady_state_s));
+    std::vector<int64_t> steadyStateCpuUs;
+    for (int i = 0; i < FLAGS_num_nodes; ++i) {
+      const auto cpuTime = nodes.at(i)->getCpuTime() - cpuTimesBefore.at(i);
+      steadyStateCpuUs.emplace_back(
+          std::chrono::duration_cast<std::chrono::microseconds>(cpuTime)
+              .count() /
+          FLAGS_steady_state_s);
+    }
+    printSummary("steady_state_cpu_us_per_node_per_sec", steadyStateCpuUs);
+  }
+
+  // nodes are stopped when destroyed
+  nodes.clear();
+  mockIoProvider->stop();
+  mockIoProviderThread.join();
+  return numConverged == FLAGS_num_nodes ? 0 : 1;
+}
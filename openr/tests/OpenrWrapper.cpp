@@ -30,7 +30,8 @@ OpenrWrapper<Serializer>::OpenrWrapper(
     std::shared_ptr<IoProvider> ioProvider,
     int32_t systemPort,
     uint32_t memLimit,
-    bool per_prefix_keys)
+    bool per_prefix_keys,
+    bool enableWatchdog)
     : context_(context),
       nodeId_(nodeId),
       ioProvider_(std::move(ioProvider)),
@@ -262,8 +263,10 @@ OpenrWrapper<Serializer>::OpenrWrapper(
   fibReqSock_.connect(fbzmq::SocketUrl{fibCmdUrl_}).value();
 
   // Watchdog thread to monitor thread aliveness
-  watchdog = std::make_unique<Watchdog>(
-      nodeId_, std::chrono::seconds(1), std::chrono::seconds(60), memLimit);
+  if (enableWatchdog) {
+    watchdog = std::make_unique<Watchdog>(
+        nodeId_, std::chrono::seconds(1), std::chrono::seconds(60), memLimit);
+  }
 
   // Zmq monitor client to get counters
   zmqMonitorClient = std::make_unique<fbzmq::ZmqMonitorClient>(
@@ -333,8 +336,9 @@ OpenrWrapper<Serializer>::run() {
     }
   });
 
+  // room for a /64 of each node of large emulated topologies
   const auto seedPrefix =
-      folly::IPAddress::createNetwork("fc00:cafe:babe::/62");
+      folly::IPAddress::createNetwork("fc00:cafe:babe::/48");
   const uint8_t allocPrefixLen = 64;
   prefixAllocator_ = std::make_unique<PrefixAllocator>(
       nodeId_,
@@ -411,13 +415,15 @@ OpenrWrapper<Serializer>::run() {
   allThreads_.emplace_back(std::move(fibThread));
 
   // start watchdog
-  std::thread watchdogThread([this]() noexcept {
-    VLOG(1) << nodeId_ << " watchdog running.";
-    watchdog->run();
-    VLOG(1) << nodeId_ << " watchdog stopped.";
-  });
-  watchdog->waitUntilRunning();
-  allThreads_.emplace_back(std::move(watchdogThread));
+  if (watchdog) {
+    std::thread watchdogThread([this]() noexcept {
+      VLOG(1) << nodeId_ << " watchdog running.";
+      watchdog->run();
+      VLOG(1) << nodeId_ << " watchdog stopped.";
+    });
+    watchdog->waitUntilRunning();
+    allThreads_.emplace_back(std::move(watchdogThread));
+  }
 
   // start eventLoop_
   allThreads_.emplace_back([&]() {
@@ -433,8 +439,10 @@ OpenrWrapper<Serializer>::stop() {
   // stop all modules in reverse order
   eventLoop_.stop();
   eventLoop_.waitUntilStopped();
-  watchdog->stop();
-  watchdog->waitUntilStopped();
+  if (watchdog) {
+    watchdog->stop();
+    watchdog->waitUntilStopped();
+  }
   fib_->stop();
   fib_->waitUntilStopped();
   decision_->stop();
@@ -581,6 +589,21 @@ OpenrWrapper<Serializer>::withdrawPrefixEntries(
   return resp.value().success;
 }
 
+template <class Serializer>
+std::chrono::nanoseconds
+OpenrWrapper<Serializer>::getCpuTime() {
+  std::chrono::nanoseconds cpuTime{0};
+  for (auto& thread : allThreads_) {
+    clockid_t clockId;
+    struct timespec ts;
+    CHECK_EQ(0, pthread_getcpuclockid(thread.native_handle(), &clockId));
+    CHECK_EQ(0, clock_gettime(clockId, &ts));
+    cpuTime +=
+        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+  }
+  return cpuTime;
+}
+
 template <class Serializer>
 bool
 OpenrWrapper<Serializer>::checkPrefixExists(
@@ -52,7 +52,8 @@ class OpenrWrapper {
       std::shared_ptr<IoProvider> ioProvider,
       int32_t systemPort,
       uint32_t memLimit = openr::memLimitMB,
-      bool per_prefix_keys = false);
+      bool per_prefix_keys = false,
+      bool enableWatchdog = true);
 
   ~OpenrWrapper() {
     stop();
@@ -106,6 +107,11 @@ class OpenrWrapper {
    */
   bool withdrawPrefixEntries(const std::vector<thrift::PrefixEntry>& prefixes);
 
+  /**
+   * CPU time consumed so far by all threads of this node, while running
+   */
+  std::chrono::nanoseconds getCpuTime();
+
   /**
    * check if a given prefix exists in routeDb
    */
@@ -118,7 +124,8 @@ class OpenrWrapper {
   std::unique_ptr<fbzmq::ZmqMonitorClient> zmqMonitorClient{nullptr};
 
   /*
-   * watchdog thread (used for checking memory limit exceeded)
+   * watchdog thread (used for checking memory limit exceeded), nullptr if
+   * disabled. Memory usage is of whole process, i.e. of all nodes in it
    */
   std::unique_ptr<Watchdog> watchdog;
 
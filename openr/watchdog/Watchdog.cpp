@@ -29,6 +29,7 @@ Watchdog::Watchdog(
   watchdogTimer_ = fbzmq::ZmqTimeout::make(this, [this]() noexcept {
     updateCounters();
     monitorMemory();
+    probeEvls();
   });
   watchdogTimer_->scheduleTimeout(healthCheckInterval_, true /* isPeriodic */);
 }
@@ -46,9 +47,52 @@ Watchdog::delEvl(ZmqEventLoop* evl) {
   runImmediatelyOrInEventLoop([&, evl]() {
     CHECK_NE(allEvls_.count(evl), 0);
     allEvls_.erase(evl);
+    probesInFlight_.erase(evl);
   });
 }
 
+std::unordered_map<std::string, int64_t>
+Watchdog::getCounters() const {
+  std::unordered_map<std::string, int64_t> counters;
+  for (auto const& kv : *evlLatencyHistograms_.rlock()) {
+    kv.second.exportCounters(
+        folly::sformat("watchdog.evl_latency_ms.{}", kv.first), counters);
+  }
+  for (auto const& kv : *evlCpuTimes_.rlock()) {
+    counters[folly::sformat("watchdog.thread_cpu_time_ms.{}", kv.first)] =
+        kv.second.count();
+  }
+  return counters;
+}
+
+void
+Watchdog::probeEvls() {
+  const auto sentTs = std::chrono::steady_clock::now();
+  for (auto const& kv : allEvls_) {
+    auto evl = kv.first;
+    // Stalled loop, its latency gets recorded once it runs the probe
+    if (not probesInFlight_.insert(evl).second) {
+      continue;
+    }
+    evl->runInEventLoop([this, evl, name = kv.second, sentTs]() noexcept {
+      const auto latency =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::steady_clock::now() - sentTs);
+      // probe runs in thread of evl, sample its CPU time too
+      const auto cpuTime = getThreadCpuTime();
+      runInEventLoop([this, evl, name, latency, cpuTime]() noexcept {
+        probesInFlight_.erase(evl);
+        (*evlLatencyHistograms_.wlock())[name].addValue(latency);
+        (*evlCpuTimes_.wlock())[name] = cpuTime;
+        if (latency > healthCheckInterval_) {
+          LOG(WARNING) << "Watchdog: " << name << " thread took "
+                       << latency.count() << "ms to run scheduled callback";
+        }
+      });
+    });
+  }
+}
+
 bool
 Watchdog::memoryLimitExceeded() const {
   return memExceedTime_.hasValue();
@@ -10,15 +10,18 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <fbzmq/async/ZmqEventLoop.h>
 #include <fbzmq/async/ZmqTimeout.h>
 #include <fbzmq/service/monitor/ZmqMonitorClient.h>
 #include <fbzmq/service/resource-monitor/ResourceMonitor.h>
 #include <fbzmq/service/stats/ThreadData.h>
+#include <folly/Synchronized.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include <openr/common/Constants.h>
+#include <openr/common/LatencyHistogram.h>
 #include <openr/common/Types.h>
 
 namespace openr {
@@ -43,9 +46,17 @@ class Watchdog final : public fbzmq::ZmqEventLoop {
 
   bool memoryLimitExceeded() const;
 
+  // Scheduling latency of monitored event loops, as percentiles per module,
+  // and CPU time consumed by their threads. Thread safe
+  std::unordered_map<std::string, int64_t> getCounters() const;
+
  private:
   void updateCounters();
 
+  // Measure how long it takes each event loop to run a probe callback, which
+  // goes up way before the loop is considered dead
+  void probeEvls();
+
   // monitor memory usage
   void monitorMemory();
 
@@ -77,6 +88,19 @@ class Watchdog final : public fbzmq::ZmqEventLoop {
 
   // resource monitor
   fbzmq::ResourceMonitor resourceMonitor_{};
+
+  // event loops which haven't run last probe yet, not probed again until then
+  std::unordered_set<ZmqEventLoop*> probesInFlight_;
+
+  // scheduling latency by module name. Recorded from this loop, exported from
+  // any thread
+  folly::Synchronized<std::unordered_map<std::string, LatencyHistogram>>
+      evlLatencyHistograms_;
+
+  // CPU time of event loop threads by module name, sampled by probes
+  folly::Synchronized<
+      std::unordered_map<std::string, std::chrono::milliseconds>>
+      evlCpuTimes_;
 };
 
 } // namespace openr